@@ -7,7 +7,9 @@
 
 using namespace CNTK;
 
-class UserTimesFunction final : public Function
+// Also implements UserFunctionKernel, so that inside a network the multiplication is computed directly on the
+// buffers of the engine.
+class UserTimesFunction final : public Function, public UserFunctionKernel
 {
 public:
     static FunctionPtr Create(const Variable& leftOperand, const Variable& rightOperand, const Dictionary& attributes, const std::wstring& name)
@@ -25,7 +27,7 @@ public:
     {}
 
 private:
-    static void MatrixMultiply(const NDArrayViewPtr& leftMatrix, const NDArrayViewPtr& rightMatrix, NDArrayViewPtr& outputMatrix, bool transposeRight = false)
+    static void MatrixMultiply(const NDArrayViewPtr& leftMatrix, const NDArrayViewPtr& rightMatrix, NDArrayViewPtr& outputMatrix, bool transposeRight = false, bool accumulate = false)
     {
         auto GetNumRowsAndCols = [](const NDShape& shape, bool transpose = false) {
             auto numRows = shape[0];
@@ -49,7 +51,8 @@ private:
         assert(!leftMatrix->IsSparse() && !rightMatrix->IsSparse() && !outputMatrix->IsSparse());
         assert(K == rightNumRows);
         assert((outputMatrix->Shape()[0] == numOutRows) && (outputMatrix->Shape()[1] == numOutCols));
-        outputMatrix->SetValue(0.0f);
+        if (!accumulate)
+            outputMatrix->SetValue(0.0f);
 
         // The operands values are in column major layout
         auto Offset = [](size_t rowIdx, size_t colIdx, const NDShape& matrixShape, bool transpose = false) {
@@ -114,6 +117,32 @@ private:
         MatrixMultiply(rootGradientData, rightInputData, inputGradientData, /*transposeRight =*/ true);
     }
 
+    // The views of the kernel are packed, with the sequences and time steps as trailing axes; they are
+    // multiplied as matrices with one column per sample.
+    static NDArrayViewPtr AsMatrix(const NDArrayViewPtr& view, size_t numRows)
+    {
+        return view->AsShape(NDShape({ numRows, view->Shape().TotalSize() / numRows }));
+    }
+
+    void ForwardKernel(const std::vector<NDArrayViewPtr>& inputs, const std::vector<NDArrayViewPtr>& outputs, bool /*isTraining*/) override
+    {
+        auto outputMatrix = AsMatrix(outputs[0], inputs[0]->Shape()[0]);
+        MatrixMultiply(inputs[0], AsMatrix(inputs[1], inputs[0]->Shape()[1]), outputMatrix);
+    }
+
+    void BackwardKernel(const std::vector<NDArrayViewPtr>& inputs, const std::vector<NDArrayViewPtr>& /*outputs*/,
+                        const std::vector<NDArrayViewPtr>& outputGradients, const std::vector<NDArrayViewPtr>& inputGradients) override
+    {
+        if (inputGradients[1] != nullptr)
+            throw std::runtime_error("UserTimesFunction does not support computing gradient wrt right operand");
+
+        if ((inputGradients[0] == nullptr) || (outputGradients[0] == nullptr))
+            return;
+
+        auto inputGradient = inputGradients[0];
+        MatrixMultiply(AsMatrix(outputGradients[0], inputs[0]->Shape()[0]), AsMatrix(inputs[1], inputs[0]->Shape()[1]), inputGradient, /*transposeRight =*/ true, /*accumulate =*/ true);
+    }
+
     const std::wstring& OpName() const override
     {
         static const std::wstring opName = L"NativeUserTimesOp";
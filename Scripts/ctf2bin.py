@@ -0,0 +1,209 @@
+#!/usr/bin/env python
+# ==============================================================================
+# Copyright (c) Microsoft. All rights reserved.
+# Licensed under the MIT license. See LICENSE.md file in the project root
+# for full license information.
+# ==============================================================================
+
+# Converts a file in the CNTK text format (as read by the CNTKTextFormatReader) into the CNTK binary format, as read
+# by the CNTKBinaryReader. Optionally, the values are stored as half precision numbers (--float16, converted to the
+# precision of the reader when the chunks are read), and the indices of sparse streams are delta and var-int
+# encoded (--compress-sparse-indices), which usually makes the files several times smaller.
+#
+# Each stream is given by its name, the alias used in the text file, its dimension and its format (dense or sparse).
+# The rows of a sequence share its id (the first column); rows without an id are sequences of their own.
+#
+# Example:
+#   python ctf2bin.py --input train.ctf --output train.bin --stream features x 784 dense --stream labels y 10 sparse
+# and reading it with
+#   reader = { readerType = "CNTKBinaryReader" ; file = "train.bin" }
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x636e746b5f62696e  # "cntk_bin"
+VERSION = 1
+
+# matrix encoding types
+DENSE = 0
+SPARSE_CSC = 1
+COMPRESSED_SPARSE_CSC = 2
+
+# data types
+FLOAT = 0
+DOUBLE = 1
+FLOAT16 = 2
+
+VALUE_FORMATS = {FLOAT: 'f', DOUBLE: 'd', FLOAT16: 'e'}
+
+
+class Stream(object):
+    def __init__(self, name, alias, dim, is_sparse):
+        self.name = name
+        self.alias = alias
+        self.dim = dim
+        self.is_sparse = is_sparse
+
+
+class Sequence(object):
+    def __init__(self, num_streams):
+        self.samples = [[] for _ in range(num_streams)]
+
+    def num_samples(self):
+        return max(len(s) for s in self.samples)
+
+
+def parse_sequences(input_file, streams):
+    aliases = dict((s.alias, i) for i, s in enumerate(streams))
+    sequence, sequence_id = None, None
+    with open(input_file, 'r') as f:
+        for line_index, line in enumerate(f):
+            line = line.strip()
+            if not line:
+                continue
+            bar = line.find('|')
+            if bar < 0:
+                raise ValueError("Invalid line %d in file %s, no input found." % (line_index, input_file))
+            row_id = line[:bar].strip() or None
+            if sequence is None or row_id is None or row_id != sequence_id:
+                if sequence is not None:
+                    yield sequence
+                sequence, sequence_id = Sequence(len(streams)), row_id
+
+            for field in line[bar + 1:].split('|'):
+                if field.startswith('#'):
+                    continue
+                tokens = field.split()
+                if not tokens:
+                    continue
+                if tokens[0] not in aliases:
+                    raise ValueError("Unknown input '%s' on line %d in file %s." % (tokens[0], line_index, input_file))
+                i = aliases[tokens[0]]
+                stream = streams[i]
+                if stream.is_sparse:
+                    sample = []
+                    for token in tokens[1:]:
+                        index, value = token.split(':')
+                        index = int(index)
+                        if index < 0 or index >= stream.dim:
+                            raise ValueError("Index %d of input '%s' exceeds its dimension on line %d in file %s."
+                                             % (index, stream.alias, line_index, input_file))
+                        sample.append((index, float(value)))
+                    sample.sort()
+                else:
+                    sample = [float(token) for token in tokens[1:]]
+                    if len(sample) != stream.dim:
+                        raise ValueError("Input '%s' has %d values instead of %d on line %d in file %s."
+                                         % (stream.alias, len(sample), stream.dim, line_index, input_file))
+                sequence.samples[i].append(sample)
+    if sequence is not None:
+        yield sequence
+
+
+def encode_varint(value, out):
+    while value >= 0x80:
+        out.append((value & 0x7f) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def encode_stream(sequences, i, stream, data_type, compress_indices):
+    out = bytearray()
+    value_format = VALUE_FORMATS[data_type]
+    for sequence in sequences:
+        samples = sequence.samples[i]
+        if not stream.is_sparse:
+            out += struct.pack('<I', len(samples))
+            out += struct.pack('<%d%s' % (len(samples) * stream.dim, value_format), *[v for s in samples for v in s])
+            continue
+
+        values = [v for s in samples for _, v in s]
+        out += struct.pack('<II', len(samples), len(values))
+        out += struct.pack('<%d%s' % (len(values), value_format), *values)
+        if compress_indices:
+            encoded = bytearray()
+            for sample in samples:
+                previous = 0
+                for index, _ in sample:
+                    encode_varint(index - previous, encoded)
+                    previous = index
+            out += struct.pack('<I', len(encoded))
+            out += encoded
+        else:
+            indices = [index for s in samples for index, _ in s]
+            out += struct.pack('<%di' % len(indices), *indices)
+        out += struct.pack('<%di' % len(samples), *[len(s) for s in samples])
+    return out
+
+
+def write_chunk(f, sequences, streams, data_type, compress_indices):
+    offset = f.tell()
+    lengths = [s.num_samples() for s in sequences]
+    f.write(struct.pack('<%dI' % len(lengths), *lengths))
+    for i, stream in enumerate(streams):
+        f.write(encode_stream(sequences, i, stream, data_type, compress_indices))
+    return (offset, len(sequences), sum(lengths))
+
+
+def write_header(f, streams, chunks, data_type, compress_indices):
+    header_offset = f.tell()
+    f.write(struct.pack('<QII', MAGIC, len(chunks), len(streams)))
+    for stream in streams:
+        encoding = DENSE
+        if stream.is_sparse:
+            encoding = COMPRESSED_SPARSE_CSC if compress_indices else SPARSE_CSC
+        name = stream.name.encode('utf-8')
+        f.write(struct.pack('<BI', encoding, len(name)))
+        f.write(name)
+        f.write(struct.pack('<BI', data_type, stream.dim))
+    for offset, num_sequences, num_samples in chunks:
+        f.write(struct.pack('<qII', offset, num_sequences, num_samples))
+    f.write(struct.pack('<q', header_offset))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Converts a file in the CNTK text format into the CNTK binary format.")
+    parser.add_argument('--input', required=True, help='input file in the CNTK text format')
+    parser.add_argument('--output', required=True, help='output file')
+    parser.add_argument('--stream', nargs=4, action='append', required=True, metavar=('NAME', 'ALIAS', 'DIM', 'FORMAT'),
+                        help='an input stream, with FORMAT dense or sparse (repeated for each stream)')
+    parser.add_argument('--chunk-size', type=int, default=32, help='approximate size of a chunk in MB (default: 32)')
+    parser.add_argument('--precision', choices=['float', 'double'], default='float',
+                        help='precision of the values (default: float), which has to match the one of the reader')
+    parser.add_argument('--float16', action='store_true', help='store the values as half precision numbers')
+    parser.add_argument('--compress-sparse-indices', action='store_true',
+                        help='delta and var-int encode the indices of sparse streams')
+    args = parser.parse_args()
+
+    streams = []
+    for name, alias, dim, fmt in args.stream:
+        if fmt not in ('dense', 'sparse'):
+            raise ValueError("Invalid format '%s' of stream '%s', must be dense or sparse." % (fmt, name))
+        streams.append(Stream(name, alias, int(dim), fmt == 'sparse'))
+
+    data_type = FLOAT16 if args.float16 else (FLOAT if args.precision == 'float' else DOUBLE)
+    value_size = {FLOAT: 4, DOUBLE: 8, FLOAT16: 2}[data_type]
+
+    chunks = []
+    with open(args.output, 'wb') as f:
+        f.write(struct.pack('<QI', MAGIC, VERSION))
+        pending, pending_bytes = [], 0
+        for sequence in parse_sequences(args.input, streams):
+            pending.append(sequence)
+            pending_bytes += sum(len(s) * (value_size + 4) for samples in sequence.samples for s in samples)
+            if pending_bytes >= args.chunk_size * 1024 * 1024:
+                chunks.append(write_chunk(f, pending, streams, data_type, args.compress_sparse_indices))
+                pending, pending_bytes = [], 0
+        if pending:
+            chunks.append(write_chunk(f, pending, streams, data_type, args.compress_sparse_indices))
+        if not chunks:
+            raise ValueError("The input file %s has no sequences." % args.input)
+        write_header(f, streams, chunks, data_type, args.compress_sparse_indices)
+
+    print("Written %d sequences in %d chunks to %s." % (sum(c[1] for c in chunks), len(chunks), args.output))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,105 @@
+#!/usr/bin/env python
+# ==============================================================================
+# Copyright (c) Microsoft. All rights reserved.
+# Licensed under the MIT license. See LICENSE.md file in the project root
+# for full license information.
+# ==============================================================================
+
+# Converts an image map file (as read by the ImageDeserializer) into image packs, as read by the
+# ImagePackDeserializer: files that hold the encoded images back to back, preceded by a table with the key,
+# the class id, the offset and the size of each image. The images are not decoded or re-encoded.
+#
+# The map file has 2 (image path, class id) or 3 (sequence key, image path, class id) tab separated columns
+# per line; without keys, the line number is used (as by the ImageDeserializer). Relative image paths are
+# taken to be relative to the current directory.
+#
+# Example, writing packs of 1GB each (imagenet.000.imgpack, imagenet.001.imgpack, ...) in random order:
+#   python map2imagepack.py --map train_map.txt --output imagenet --shard-size 1024 --shuffle
+# and reading them with
+#   deserializers = [{ type = "ImagePackDeserializer" ; module = "ImageReader"
+#                      file = "imagenet.000.imgpack,imagenet.001.imgpack,..." ; input = [...] }]
+
+import argparse
+import os
+import random
+import struct
+import sys
+
+MAGIC = 0x4b50495f4b544e43  # "CNTK_IPK"
+VERSION = 1
+
+
+def read_map(map_file):
+    records = []
+    with open(map_file, 'r') as f:
+        for line_index, line in enumerate(f):
+            columns = line.rstrip('\r\n').split('\t')
+            if len(columns) == 2:
+                columns = [str(line_index)] + columns
+            if len(columns) != 3 or not columns[1] or not columns[2]:
+                raise ValueError("Invalid map file format, must contain 2 or 3 tab-delimited columns, line %d in file %s."
+                                 % (line_index, map_file))
+            key, path, class_id = columns
+            records.append((key, path, int(class_id)))
+    return records
+
+
+def write_pack(pack_file, records):
+    entries = []
+    for key, path, class_id in records:
+        size = os.path.getsize(path)
+        if size == 0:
+            raise ValueError("Image '%s' is empty." % path)
+        entries.append((key.encode('utf-8'), path, class_id, size))
+
+    table_size = sum(4 + len(key) + 4 + 8 + 4 for key, _, _, _ in entries)
+    offset = 8 + 4 + 8 + table_size
+    with open(pack_file, 'wb') as f:
+        f.write(struct.pack('<QIQ', MAGIC, VERSION, len(entries)))
+        for key, _, class_id, size in entries:
+            f.write(struct.pack('<I', len(key)))
+            f.write(key)
+            f.write(struct.pack('<IQI', class_id, offset, size))
+            offset += size
+        for _, path, _, size in entries:
+            with open(path, 'rb') as image:
+                data = image.read()
+            if len(data) != size:
+                raise ValueError("Image '%s' has changed while writing the pack." % path)
+            f.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Converts an image map file into image packs for the ImagePackDeserializer.")
+    parser.add_argument('--map', required=True, help='input map file')
+    parser.add_argument('--output', required=True, help='prefix of the output files; the packs are named <prefix>.<n>.imgpack')
+    parser.add_argument('--shard-size', type=int, default=0, help='approximate size of a pack in MB (default: a single pack)')
+    parser.add_argument('--shuffle', action='store_true', help='store the images in random order')
+    parser.add_argument('--seed', type=int, default=0, help='seed for --shuffle')
+    args = parser.parse_args()
+
+    records = read_map(args.map)
+    if args.shuffle:
+        random.Random(args.seed).shuffle(records)
+
+    # split into shards by the (encoded) size of the images
+    shards = [[]]
+    shard_bytes = 0
+    for record in records:
+        size = os.path.getsize(record[1])
+        if args.shard_size > 0 and shards[-1] and shard_bytes + size > args.shard_size * 1024 * 1024:
+            shards.append([])
+            shard_bytes = 0
+        shards[-1].append(record)
+        shard_bytes += size
+
+    for n, shard in enumerate(shards):
+        pack_file = '%s.%03d.imgpack' % (args.output, n)
+        write_pack(pack_file, shard)
+        print("Written %d images to %s." % (len(shard), pack_file))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -44,6 +44,10 @@ template <typename ElemType>
 void DoEdit(const ConfigParameters& config);
 template <typename ElemType>
 void DoBatchNormalizationStat(const ConfigParameters& config);
+template <typename ElemType>
+void DoDryRun(const ConfigParameters& config);
+template <typename ElemType>
+void DoBenchmarkCommunication(const ConfigParameters& config);
 
 // evaluation (EvalActions.cpp)
 template <typename ElemType>
@@ -57,8 +61,16 @@ void DoWriteOutput(const ConfigParameters& config);
 template <typename ElemType>
 void DoCreateLabelMap(const ConfigParameters& config);
 template <typename ElemType>
+void DoBenchmarkReader(const ConfigParameters& config);
+template <typename ElemType>
 void DoParameterSVD(const ConfigParameters& config);
 template <typename ElemType>
+void DoFoldBatchNormalization(const ConfigParameters& config);
+template <typename ElemType>
+void DoParameterPruning(const ConfigParameters& config);
+template <typename ElemType>
+void DoQuantizeModel(const ConfigParameters& config);
+template <typename ElemType>
 void DoWriteWordAndClassInfo(const ConfigParameters& config);
 template <typename ElemType>
 void DoTopologyPlot(const ConfigParameters& config);
@@ -68,3 +80,5 @@ template <typename ElemType>
 void DoConvertFromDbn(const ConfigParameters& config);
 template<typename ElemType>
 void DoExportToDbn(const ConfigParameters& config);
+template <typename ElemType>
+void DoCompactLatticeArchive(const ConfigParameters& config);
@@ -45,6 +45,31 @@ bool GetDistributedMBReadingDefaultValue(const ConfigParameters& config, const I
     return (MPIWrapper::GetInstance() != nullptr && !reader.IsLegacyReader());
 }
 
+// optionally move loop-invariant terms out of recurrent loops (config "hoistLoopInvariants"),
+// fuse recurrent cells (config "fuseRecurrentCells") and chains of element-wise nodes (config "fuseElementwiseOps")
+// Evaluation needs no gradients, so all parameters are frozen first; otherwise the chain fusion pass would not touch anything that depends on them.
+template <typename ElemType>
+static void FuseElementwiseChainsIfRequested(const ConfigParameters& config, const ComputationNetworkPtr& net)
+{
+    if (config(L"hoistLoopInvariants", false))
+    {
+        size_t numRewritten = net->HoistLoopInvariantTerms<ElemType>();
+        fprintf(stderr, "hoistLoopInvariants: the loop-invariant terms of %d nodes were moved out of recurrent loops.\n", (int)numRewritten);
+    }
+    // (the cells are inside loops, which the chain fusion skips)
+    if (config(L"fuseRecurrentCells", false))
+    {
+        size_t numFused = net->FuseRecurrentCells<ElemType>();
+        fprintf(stderr, "fuseRecurrentCells: %d element-wise nodes of recurrent cells were fused away.\n", (int)numFused);
+    }
+    if (!config(L"fuseElementwiseOps", false))
+        return;
+    net->SetLearnableNodesBelowLearningRateMultiplier(0);
+    net->CompileNetwork(); // (recompute which nodes need gradients)
+    size_t numFused = net->FuseElementwiseChains<ElemType>();
+    fprintf(stderr, "fuseElementwiseOps: %d element-wise nodes were fused away.\n", (int)numFused);
+}
+
 // ===========================================================================
 // DoEvalBase() - implements CNTK "eval" command
 // ===========================================================================
@@ -73,6 +98,7 @@ static void DoEvalBase(const ConfigParameters& config, IDataReader& reader)
     vector<wstring> evalNodeNamesVector;
 
     let net = GetModelFromConfig<ConfigParameters, ElemType>(config, L"evalNodeNames", evalNodeNamesVector);
+    FuseElementwiseChainsIfRequested<ElemType>(config, net);
 
     // set tracing flags
     net->EnableNodeTracing(config(L"traceNodeNamesReal",     ConfigParameters::Array(stringargvector())),
@@ -238,13 +264,19 @@ void DoWriteOutput(const ConfigParameters& config)
     vector<wstring> outputNodeNamesVector;
 
     let net = GetModelFromConfig<ConfigParameters, ElemType>(config, L"outputNodeNames", outputNodeNamesVector);
+    FuseElementwiseChainsIfRequested<ElemType>(config, net);
 
     // set tracing flags
     net->EnableNodeTracing(config(L"traceNodeNamesReal",     ConfigParameters::Array(stringargvector())),
                            config(L"traceNodeNamesCategory", ConfigParameters::Array(stringargvector())),
                            config(L"traceNodeNamesSparse",   ConfigParameters::Array(stringargvector())));
 
-    SimpleOutputWriter<ElemType> writer(net, 1);
+    // under MPI, each rank writes the outputs of its own shard of the data (only when writing to 'outputPath')
+    bool enableDistributedMBReading = config(L"distributedMBReading", GetDistributedMBReadingDefaultValue(config, testDataReader));
+    bool mergeDistributedOutputs = config(L"mergeDistributedOutputs", true);
+    // write the outputs on a separate thread, overlapped with the evaluation of the next minibatch
+    bool asyncWrite = config(L"asyncWrite", false);
+    SimpleOutputWriter<ElemType> writer(net, 1, MPIWrapper::GetInstance(), enableDistributedMBReading, mergeDistributedOutputs, asyncWrite);
 
     if (config.Exists("writer"))
     {
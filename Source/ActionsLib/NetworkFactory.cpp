@@ -12,6 +12,7 @@
 #include "ScriptableObjects.h"
 #include "BrainScriptEvaluator.h"
 #include "BrainScriptParser.h"
+#include "TimerUtility.h"
 
 function<ComputationNetworkPtr(DEVICEID_TYPE)> GetCreateNetworkFn(const ScriptableObjects::IConfigRecord& config)
 {
@@ -100,14 +101,23 @@ bool TryGetNetworkFactory(const ConfigRecordType& config, function<ComputationNe
 
         // the rest is done in a lambda that is only evaluated when a virgin network is needed
         // Note that evaluating the BrainScript *is* instantiating the network, so the evaluate call must be inside the lambda.
-        createNetworkFn = [expr](DEVICEID_TYPE /*deviceId*/)
+        createNetworkFn = [expr, traceLevel](DEVICEID_TYPE /*deviceId*/)
         {
             // evaluate the parse tree, particularly the top-level field 'network'
             // Evaluating it will create the network.
+            Timer timer;
+            timer.Start();
+            BS::EnableEvaluationProfile(traceLevel > 1);
             let object = EvaluateField(expr, L"network");                   // this comes back as a BS::Object
             let network = dynamic_pointer_cast<ComputationNetwork>(object); // cast it
             if (!network)
                 LogicError("BuildNetworkFromDescription: ComputationNetwork not what it was meant to be");
+            timer.Stop();
+            if (traceLevel > 0)
+                fprintf(stderr, "BrainScript network construction took %.1f seconds.\n", timer.ElapsedSeconds());
+            if (traceLevel > 1)
+                BS::PrintEvaluationProfile(20);
+            BS::EnableEvaluationProfile(false);
             return network;
         };
         return true;
@@ -14,9 +14,15 @@
 #include "ComputationNetwork.h"
 #include "ComputationNode.h"
 #include "Config.h"
+#include "BestGpu.h"
 #include "ScriptableObjects.h"
 #include "BrainScriptEvaluator.h"
 
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/resource.h>
+#endif
 #include <string>
 #include <chrono>
 #include <algorithm>
@@ -26,6 +32,7 @@
 #include <set>
 #include <memory>
 #include <map>
+#include <thread>
 
 #ifndef let
 #define let const auto
@@ -112,6 +119,148 @@ void DoCreateLabelMap(const ConfigParameters& config)
 template void DoCreateLabelMap<float>(const ConfigParameters& config);
 template void DoCreateLabelMap<double>(const ConfigParameters& config);
 
+// ===========================================================================
+// DoBenchmarkReader() - implements CNTK "benchmarkReader" command
+// ===========================================================================
+
+// Reads minibatches of the given reader without a network, and reports the throughput of the reader: samples/s and
+// MB/s of the minibatch data, the CPU utilization of the process (all reader threads, in cores), and the time the
+// main thread was blocked in GetMinibatch(). This is for sizing reader threads and storage independently of models.
+// Parameters:
+//   reader                  - the reader configuration, as in "train"
+//   minibatchSize           - in samples (default 256)
+//   epochSize               - in samples (default 0, the whole data)
+//   numMinibatches          - number of minibatches to time (default 1000); the epoch is restarted as needed
+//   warmupMinibatches       - number of minibatches read before timing (default 10), e.g. to open files and fill the prefetch
+//   computeTimePerMinibatch - in ms, time the main thread sleeps after each minibatch, to emulate a model, so that the
+//                             overlap of prefetching with compute shows in the blocked time (default 0)
+//   inputs                  - colon-separated names of the streams to read; by default all streams of the reader.
+//                             Legacy readers do not know their streams, and need this; they are read into dense matrices.
+
+// process CPU time of all threads, in seconds
+static double ProcessCpuSeconds()
+{
+#ifdef _WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+        return 0;
+    auto toSeconds = [](const FILETIME& t) { return (((unsigned long long) t.dwHighDateTime << 32) | t.dwLowDateTime) * 1e-7; };
+    return toSeconds(kernelTime) + toSeconds(userTime);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+template <typename ElemType>
+void DoBenchmarkReader(const ConfigParameters& config)
+{
+    ConfigParameters readerConfig(config(L"reader"));
+    readerConfig.Insert("traceLevel", config(L"traceLevel", "0"));
+
+    DEVICEID_TYPE deviceId = DeviceFromConfig(config);
+    size_t minibatchSize = config(L"minibatchSize", "256");
+    size_t epochSize = config(L"epochSize", "0");
+    if (epochSize == 0)
+        epochSize = requestDataSize;
+    size_t numMinibatches = config(L"numMinibatches", "1000");
+    size_t warmupMinibatches = config(L"warmupMinibatches", "10");
+    double computeTimePerMinibatch = config(L"computeTimePerMinibatch", 0.0);
+    ConfigArray inputsArg = config(L"inputs", "");
+    set<wstring> inputNames;
+    for (size_t i = 0; i < inputsArg.size(); i++)
+        inputNames.insert(inputsArg[i]);
+
+    DataReader reader(readerConfig);
+
+    // set up a matrix for each stream
+    vector<InputStreamDescription> streams;
+    if (reader.IsLegacyReader())
+    {
+        if (inputNames.empty())
+            InvalidArgument("benchmarkReader: The reader is a legacy reader, which does not know its streams. Please specify them with the 'inputs' parameter.");
+        for (const auto& name : inputNames)
+            streams.push_back(InputStreamDescription(name, deviceId, MatrixType::DENSE, matrixFormatDense));
+    }
+    else
+    {
+        for (const auto& stream : reader.GetStreamDescriptions(deviceId))
+            if (inputNames.empty() || inputNames.find(stream.GetStreamName()) != inputNames.end())
+                streams.push_back(stream);
+    }
+    if (streams.empty())
+        InvalidArgument("benchmarkReader: None of the requested inputs is a stream of the reader.");
+
+    StreamMinibatchInputs matrices;
+    for (const auto& stream : streams)
+    {
+        auto matrix = make_shared<Matrix<ElemType>>(0, 0, stream.GetDeviceId(), stream.GetMatrixType(), stream.GetMatrixFormat());
+        matrices.AddInput(stream.GetStreamName(), matrix, make_shared<MBLayout>(), TensorShape());
+        fprintf(stderr, "benchmarkReader: Reading stream '%ls' (%s).\n", stream.GetStreamName().c_str(), stream.GetMatrixType() == MatrixType::SPARSE ? "sparse" : "dense");
+    }
+
+    size_t epoch = 0;
+    reader.StartMinibatchLoop(minibatchSize, epoch, matrices.GetStreamDescriptions(), epochSize);
+
+    // read the next minibatch, restarting the epoch at its end; returns the number of samples and bytes read
+    auto readMinibatch = [&](size_t& numBytes) -> size_t
+    {
+        for (size_t attempt = 0; !reader.GetMinibatch(matrices); attempt++)
+        {
+            if (attempt > 0)
+                RuntimeError("benchmarkReader: The reader returned no data.");
+            reader.StartMinibatchLoop(minibatchSize, ++epoch, matrices.GetStreamDescriptions(), epochSize);
+        }
+
+        size_t numSamples = 0;
+        numBytes = 0;
+        for (const auto& input : matrices)
+        {
+            const auto& matrix = input.second.GetMatrix<ElemType>();
+            // (for sparse matrices, this is the size of the buffers, which is an upper bound of the data)
+            numBytes += matrix.GetMatrixType() == MatrixType::SPARSE ? matrix.BufferSize() : matrix.GetNumElements() * sizeof(ElemType);
+            numSamples = (max)(numSamples, input.second.pMBLayout->GetActualNumSamples());
+        }
+        return numSamples;
+    };
+
+    size_t numBytes;
+    for (size_t i = 0; i < warmupMinibatches; i++)
+        readMinibatch(numBytes);
+
+    size_t totalSamples = 0;
+    double totalBytes = 0;
+    double blockedSeconds = 0;
+    double cpuSecondsBegin = ProcessCpuSeconds();
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < numMinibatches; i++)
+    {
+        auto getBegin = chrono::steady_clock::now();
+        totalSamples += readMinibatch(numBytes);
+        blockedSeconds += chrono::duration<double>(chrono::steady_clock::now() - getBegin).count();
+        totalBytes += numBytes;
+
+        if (computeTimePerMinibatch > 0)
+            this_thread::sleep_for(chrono::duration<double, milli>(computeTimePerMinibatch));
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    double cpuSeconds = ProcessCpuSeconds() - cpuSecondsBegin;
+    if (seconds <= 0)
+        seconds = 1e-9;
+
+    fprintf(stderr, "benchmarkReader: Read %d minibatches, %d samples, %.3f MB in %.3f seconds (%d epoch restarts).\n",
+            (int) numMinibatches, (int) totalSamples, totalBytes / (1024 * 1024), seconds, (int) epoch);
+    fprintf(stderr, "benchmarkReader: samplesPerSecond = %.1f; MBPerSecond = %.3f; cpuUtilization = %.2f cores; "
+                    "blockedInGetMinibatch = %.3f seconds (%.1f%%, %.3f ms per minibatch)\n",
+            totalSamples / seconds, totalBytes / (1024 * 1024) / seconds, cpuSeconds / seconds,
+            blockedSeconds, 100 * blockedSeconds / seconds, numMinibatches > 0 ? 1000 * blockedSeconds / numMinibatches : 0.0);
+}
+
+template void DoBenchmarkReader<float>(const ConfigParameters& config);
+template void DoBenchmarkReader<double>(const ConfigParameters& config);
+
 // ===========================================================================
 // DoParameterSVD() - implements CNTK "SVD" command
 // ===========================================================================
@@ -203,6 +352,145 @@ void DoParameterSVD(const ConfigParameters& config)
 template void DoParameterSVD<float>(const ConfigParameters& config);
 template void DoParameterSVD<double>(const ConfigParameters& config);
 
+// ===========================================================================
+// DoFoldBatchNormalization() - implements CNTK "foldBatchNormalization" command
+// ===========================================================================
+
+//////////////////////////////////////////////////////////////////////////
+//  for action foldBatchNormalization
+//      An action "foldBatchNormalization" prepares an existing model for inference:
+//          every spatial BatchNormalization node that directly follows a convolution (optionally plus a bias)
+//          is folded into the convolution kernel and a bias, see ComputationNetwork::FoldBatchNormalization().
+//          The running statistics are frozen, so the resulting model should not be trained further.
+//
+//      To use this command,
+//          user need to specify:
+//                  1)  modelPath           -- path to the existing model
+//                  2)  outputModelPath     -- where to write the transformed model
+//
+//////////////////////////////////////////////////////////////////////////
+template <typename ElemType>
+void DoFoldBatchNormalization(const ConfigParameters& config)
+{
+    DEVICEID_TYPE deviceID = -1; // the folding is cheap; use CPU
+    wstring modelPath = config(L"modelPath");
+    wstring outputModelPath = config(L"outputModelPath");
+    if (outputModelPath.empty())
+        InvalidArgument("foldBatchNormalization: outputModelPath must be specified.");
+
+    ComputationNetwork net(deviceID);
+    net.Load<ElemType>(modelPath);
+
+    net.FoldBatchNormalization<ElemType>();
+    net.Save(outputModelPath);
+}
+
+template void DoFoldBatchNormalization<float>(const ConfigParameters& config);
+template void DoFoldBatchNormalization<double>(const ConfigParameters& config);
+
+// ===========================================================================
+// DoParameterPruning() - implements CNTK "prune" command
+// ===========================================================================
+
+//////////////////////////////////////////////////////////////////////////
+//  for action prune
+//      An action "prune" sparsifies the Learnable Parameters of an existing model:
+//          the blocks of values with the smallest L2 norms are set to zero, see ComputationNetwork::PruneParameters().
+//          BlockRows = BlockCols = 1 is magnitude pruning; a block dimension of 0 spans the whole parameter,
+//          e.g. BlockRows = 0 prunes whole columns (the output channels of a convolution kernel).
+//          To recover the accuracy, retrain the pruned model with the SGD option keepParameterSparsity = true,
+//          possibly pruning further in steps.
+//
+//      To use this command,
+//          user need to specify:
+//                  1)  modelPath           -- path to the existing model
+//                  2)  outputModelPath     -- where to write the pruned model
+//                  3)  Sparsity            -- fraction of the blocks to set to zero (0.5 by default)
+//                  4)  BlockRows, BlockCols -- size of the blocks (1 by default)
+//                  5)  NodeNameRegex       -- name (regex) of the parameter nodes to prune, or alternatively
+//                      PruneConfig         -- a file with a regex and its sparsity per line (as the SVDConfig file)
+//
+//////////////////////////////////////////////////////////////////////////
+template <typename ElemType>
+void DoParameterPruning(const ConfigParameters& config)
+{
+    DEVICEID_TYPE deviceID = -1; // use CPU for the pruning
+    wstring modelPath = config(L"modelPath");
+    wstring outputModelPath = config(L"outputModelPath");
+    if (outputModelPath.empty())
+        InvalidArgument("prune: outputModelPath must be specified.");
+
+    float sparsity = config(L"Sparsity", "0.5");
+    size_t blockRows = config(L"BlockRows", "1");
+    size_t blockCols = config(L"BlockCols", "1");
+    map<wstring, float> pruneConfig;
+    wstring nodeRegex = config(L"NodeNameRegex", L"");
+    if (!nodeRegex.empty())
+        pruneConfig[nodeRegex] = sparsity;
+    else if (!ParseSVDConfigFile(config(L"PruneConfig", L""), pruneConfig))
+        InvalidArgument("prune: Either NodeNameRegex or a PruneConfig file with a regex and its sparsity per line must be specified.");
+
+    ComputationNetwork net(deviceID);
+    net.Load<ElemType>(modelPath);
+
+    net.PruneParameters<ElemType>(pruneConfig, blockRows, blockCols);
+    net.Save(outputModelPath);
+}
+
+template void DoParameterPruning<float>(const ConfigParameters& config);
+template void DoParameterPruning<double>(const ConfigParameters& config);
+
+// ===========================================================================
+// DoQuantizeModel() - implements CNTK "quantizeModel" command
+// ===========================================================================
+
+//////////////////////////////////////////////////////////////////////////
+//  for action quantizeModel
+//      An action "quantizeModel" writes an existing model with its Learnable Parameters stored in fewer bits,
+//          for smaller model files to deploy, see ComputationNetwork::SetParameterStorageFormat().
+//          Loading the model (in CNTK, the evaluation libraries or the V2 Function::Load()) converts the values
+//          back into the precision of the model, so the result behaves like the original with rounded parameters.
+//
+//      To use this command,
+//          user need to specify:
+//                  1)  modelPath           -- path to the existing model
+//                  2)  outputModelPath     -- where to write the quantized model
+//                  3)  storageFormat       -- float16, int8PerRow (the default) or int8PerColumn, where the int8 formats
+//                                             scale each row or column by its maximum absolute value
+//                  4)  NodeNameRegex       -- name (regex) of the parameter nodes to quantize (all by default)
+//
+//////////////////////////////////////////////////////////////////////////
+template <typename ElemType>
+void DoQuantizeModel(const ConfigParameters& config)
+{
+    DEVICEID_TYPE deviceID = -1; // use CPU for the conversion
+    wstring modelPath = config(L"modelPath");
+    wstring outputModelPath = config(L"outputModelPath");
+    if (outputModelPath.empty())
+        InvalidArgument("quantizeModel: outputModelPath must be specified.");
+
+    wstring storageFormatName = config(L"storageFormat", L"int8PerRow");
+    MatrixStorageFormat storageFormat;
+    if (EqualCI(storageFormatName, L"float16"))
+        storageFormat = MatrixStorageFormat::float16;
+    else if (EqualCI(storageFormatName, L"int8PerRow"))
+        storageFormat = MatrixStorageFormat::int8PerRow;
+    else if (EqualCI(storageFormatName, L"int8PerColumn"))
+        storageFormat = MatrixStorageFormat::int8PerColumn;
+    else
+        InvalidArgument("quantizeModel: Invalid storageFormat '%ls', must be float16, int8PerRow or int8PerColumn.", storageFormatName.c_str());
+
+    ComputationNetwork net(deviceID);
+    net.Load<ElemType>(modelPath);
+
+    size_t numParameters = net.SetParameterStorageFormat(config(L"NodeNameRegex", L".*"), storageFormat);
+    fprintf(stderr, "quantizeModel: storing %d parameters as %ls.\n", (int) numParameters, storageFormatName.c_str());
+    net.Save(outputModelPath);
+}
+
+template void DoQuantizeModel<float>(const ConfigParameters& config);
+template void DoQuantizeModel<double>(const ConfigParameters& config);
+
 // ===========================================================================
 // DoWriteWordAndClassInfo() - implements CNTK "writeWordAndClass" command
 // ===========================================================================
@@ -17,6 +17,7 @@
 #include "SimpleNetworkBuilder.h"
 #include "Config.h"
 #include "ScriptableObjects.h"
+#include "latticearchive.h"
 
 #include <string>
 #include <chrono>
@@ -69,7 +70,23 @@ void DoExportToDbn(const ConfigParameters& config)
     net->SaveToDbnFile<ElemType>(net, dbnModelPath);
 }
 
+// ===========================================================================
+// DoCompactLatticeArchive() - implements CNTK "compactLatticeArchive" command
+// Converts a lattice archive for sequence training into the compact, memory-mapped format (see latticecompact.h).
+// ===========================================================================
+
+template <typename ElemType>
+void DoCompactLatticeArchive(const ConfigParameters& config)
+{
+    const wstring latticeTocPath = config(L"latticeTocFile");
+    const wstring outputPath = config(L"outputFile"); // the TOC and symbol list are written next to it
+
+    msra::lattices::archive::compact(latticeTocPath, outputPath);
+}
+
 template void DoConvertFromDbn<float>(const ConfigParameters& config);
 template void DoConvertFromDbn<double>(const ConfigParameters& config);
 template void DoExportToDbn<float>(const ConfigParameters& config);
 template void DoExportToDbn<double>(const ConfigParameters& config);
+template void DoCompactLatticeArchive<float>(const ConfigParameters& config);
+template void DoCompactLatticeArchive<double>(const ConfigParameters& config);
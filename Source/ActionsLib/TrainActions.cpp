@@ -27,6 +27,15 @@
 #include "BrainScriptEvaluator.h"
 #include "BrainScriptParser.h"
 #include "PostComputingActions.h"
+#include "SimpleDistGradAggregator.h"
+#include "MatrixQuantizerImpl.h"
+#include "ConvolutionalNodes.h"
+#include "InputAndParamNodes.h"
+#include "Globals.h"
+
+#ifdef CNTK_PARALLEL_TRAINING_SUPPORT
+#include "AllReduceDistGradAggregator.h"
+#endif
 
 #include <string>
 #include <chrono>
@@ -310,3 +319,415 @@ void DoBatchNormalizationStat(const ConfigParameters& config)
 template void DoBatchNormalizationStat<double>(const ConfigParameters& config);
 template void DoBatchNormalizationStat<float>(const ConfigParameters& config);
 
+
+// ===========================================================================
+// DoDryRun() - implements CNTK "dryRun" command
+// ===========================================================================
+
+// Estimates the peak memory of training a network at a given minibatch size without reading any data, e.g. to know
+// whether a config fits on a 16 GB GPU before launching a multi-node job. The network is built as for "train" (or
+// loaded from modelPath), and its matrices are planned the way SGD plans them, by AllocateAllMatrices(), which does not
+// allocate the memory yet. Parameters:
+//   minibatchSize            - in samples (default: the first minibatchSize of the SGD section, else 256)
+//   numSequences, sequenceLength - alternatively, the minibatch as sequences, of numSequences * sequenceLength samples (without padding)
+//   memoryLimitInMB          - memory to fit into (default: the total memory of the GPU less reservedMemoryInMB;
+//                              on the CPU, no minibatch size is suggested unless this is given)
+//   reservedMemoryInMB       - memory for the CUDA context, cuDNN, NCCL and the like (default 512)
+// The optimizer state follows SGD.gradUpdateType. The convolution workspace is an upper estimate, the unrolled input
+// of the largest convolution; the actual cuDNN workspace depends on the algorithm that autotuning picks.
+template <typename ElemType>
+void DoDryRun(const ConfigParameters& config)
+{
+    DEVICEID_TYPE deviceId = DeviceFromConfig(config);
+
+    wstring gradUpdateType = L"None";
+    size_t defaultMinibatchSize = 256;
+    if (config.Exists(L"SGD"))
+    {
+        ConfigParameters configSGD(config(L"SGD"));
+        gradUpdateType = (wstring) configSGD(L"gradUpdateType", L"None");
+        ConfigArray minibatchSizes = configSGD(L"minibatchSize", "256");
+        intargvector mbSizes = minibatchSizes;
+        defaultMinibatchSize = mbSizes[0];
+    }
+    size_t numSequences = config(L"numSequences", (size_t) 0);
+    size_t sequenceLength = config(L"sequenceLength", (size_t) 0);
+    size_t minibatchSize = (numSequences > 0 && sequenceLength > 0) ? numSequences * sequenceLength : config(L"minibatchSize", defaultMinibatchSize);
+    double reservedMB = config(L"reservedMemoryInMB", 512.0);
+    double limitMB = config(L"memoryLimitInMB", 0.0);
+    if (limitMB <= 0 && deviceId >= 0)
+        limitMB = (double) TracingGPUMemoryAllocator::GetFreeAndTotalMemoryInMBs(deviceId).second - reservedMB;
+
+    // plan the matrices like SGD::TrainOrAdaptModel()
+    vector<wstring> outputNodeNames;
+    let net = GetModelFromConfig<ConfigParameters, ElemType>(config, L"outputNodeNames", outputNodeNames);
+    if (net->FinalCriterionNodes().empty())
+        InvalidArgument("dryRun: The network has no criterion node, so it cannot be trained.");
+    let criterionNode = net->FinalCriterionNodes().front();
+    vector<ComputationNodeBasePtr> evaluationNodes;
+    for (const auto& node : net->EvaluationNodes())
+        if (node != criterionNode)
+            evaluationNodes.push_back(node);
+    vector<ComputationNodeBasePtr> additionalNodesToEvaluate;
+    if (!Globals::ShouldEnableShareNodeValueMatrices())
+        additionalNodesToEvaluate.insert(additionalNodesToEvaluate.end(), net->OutputNodes().cbegin(), net->OutputNodes().cend());
+    let preComputeNodes = net->GetNodesRequiringPreComputation();
+    additionalNodesToEvaluate.insert(additionalNodesToEvaluate.end(), preComputeNodes.cbegin(), preComputeNodes.cend());
+    net->AllocateAllMatrices(evaluationNodes, additionalNodesToEvaluate, criterionNode);
+
+    // what the matrices of the pool hold; the parameter values are not in the pool, they exist already
+    enum Category { Activations, ActivationGradients, ParameterGradients, Temporaries, Workspaces, NumCategories };
+    static const char* categoryNames[NumCategories] = { "activations", "activation gradients", "parameter gradients", "temporaries", "workspaces" };
+    map<const shared_ptr<Matrix<ElemType>>*, Category> categoryOf;
+    size_t parameterBytes = 0;
+    vector<pair<size_t, size_t>> convolutionWorkspaces; // (elements per sample, maximum samples or 0)
+    for (const auto& node : net->GetAllNodes())
+    {
+        auto n = dynamic_pointer_cast<ComputationNode<ElemType>>(node);
+        if (!n)
+            continue;
+        bool isParameter = n->template Is<LearnableParameter<ElemType>>();
+        if (isParameter)
+            parameterBytes += n->Value().GetNumElements() * sizeof(ElemType);
+        else
+            categoryOf[&n->ValuePtrRef()] = Activations;
+        categoryOf[&n->GradientPtrRef()] = isParameter ? ParameterGradients : ActivationGradients;
+
+        auto convolution = dynamic_pointer_cast<ConvolutionNode<ElemType>>(n);
+        if (convolution)
+        {
+            size_t numPositions = node->GetSampleLayout().GetNumElements() / (max)(convolution->MapCount().GetNumElements(), (size_t) 1);
+            convolutionWorkspaces.push_back(make_pair(convolution->KernelShape().GetNumElements() * numPositions, convolution->MaxTempMemSizeInSamples()));
+        }
+    }
+
+    // optimizer state, see SGD::UpdateWeights(): one smoothed gradient per parameter, which RmsProp and FSAdaGrad widen
+    size_t stateMultiplier = EqualCI(gradUpdateType, L"rmsProp") ? 3 : EqualCI(gradUpdateType, L"fsAdagrad") ? 2 : 1;
+    size_t optimizerStateBytes = 0;
+    for (const auto& node : net->LearnableParameterNodes(criterionNode))
+        optimizerStateBytes += stateMultiplier * node->GetSampleLayout().GetNumElements() * sizeof(ElemType);
+
+    size_t sharedPerSampleBytes = 0, sharedFixedBytes = 0, plannedPerSampleBytes = 0, plannedFixedBytes = 0, numUnsizedRequests = 0;
+    for (const auto& iter : net->GetMatrixPool().GetMemoryPlans())
+    {
+        sharedPerSampleBytes += iter.second.sharedPerSampleBytes;
+        sharedFixedBytes += iter.second.sharedFixedBytes;
+        plannedPerSampleBytes += iter.second.perSampleBytes;
+        plannedFixedBytes += iter.second.fixedBytes;
+        numUnsizedRequests += iter.second.numUnsizedRequests;
+    }
+    let workspaceBytes = [&](size_t mbSize) -> size_t
+    {
+        size_t bytes = 0;
+        for (const auto& workspace : convolutionWorkspaces)
+            bytes = (max)(bytes, workspace.first * (workspace.second > 0 ? (min)(mbSize, workspace.second) : mbSize) * sizeof(ElemType));
+        return bytes;
+    };
+    // what training allocates: the buffers of the buffer-sharing assignment, which is what is used, and the rest
+    let totalBytes = [&](size_t mbSize) -> double
+    {
+        return (double) sharedPerSampleBytes * mbSize + sharedFixedBytes + parameterBytes + optimizerStateBytes + workspaceBytes(mbSize);
+    };
+
+    // breakdown at the step of the plan at which the most memory is in use, from the occupancy of all requests
+    const auto& requests = net->GetMatrixPool().template GetMemRequests<ElemType>();
+    int numSteps = 1;
+    for (const auto& request : requests)
+        for (const auto& occ : request.GetOccupancy())
+            numSteps = (max)(numSteps, (occ.second != INT_MAX ? occ.second : occ.first) + 2);
+    vector<vector<double>> liveDelta(NumCategories, vector<double>(numSteps + 1, 0));
+    for (const auto& request : requests)
+    {
+        auto categoryIter = categoryOf.find(request.pMatrixPtrs[0]);
+        Category category = request.isWorkSpace ? Workspaces : categoryIter != categoryOf.end() ? categoryIter->second : Temporaries;
+        double bytes = (double) request.matrixSize * sizeof(ElemType) * (request.mbScale ? minibatchSize : 1);
+        for (const auto& occ : request.GetOccupancy())
+        {
+            liveDelta[category][occ.first] += bytes;
+            liveDelta[category][occ.second != INT_MAX ? occ.second + 1 : numSteps] -= bytes;
+        }
+    }
+    vector<double> live(NumCategories, 0), liveAtPeak(NumCategories, 0);
+    double livePeak = 0;
+    for (int step = 0; step < numSteps; step++)
+    {
+        double liveTotal = 0;
+        for (int c = 0; c < NumCategories; c++)
+            liveTotal += (live[c] += liveDelta[c][step]);
+        if (liveTotal > livePeak)
+        {
+            livePeak = liveTotal;
+            liveAtPeak = live;
+        }
+    }
+
+    const double MB = 1024.0 * 1024.0;
+    fprintf(stderr, "\nDry run: estimated memory for training at a minibatch of %d samples", (int) minibatchSize);
+    if (numSequences > 0 && sequenceLength > 0)
+        fprintf(stderr, " (%d sequences of %d samples)", (int) numSequences, (int) sequenceLength);
+    fprintf(stderr, ", %d-byte elements:\n", (int) sizeof(ElemType));
+    fprintf(stderr, "\tparameters:                       %12.2f MB\n", parameterBytes / MB);
+    fprintf(stderr, "\toptimizer state (%ls):        %12.2f MB\n", gradUpdateType.c_str(), optimizerStateBytes / MB);
+    fprintf(stderr, "\tnetwork matrices (buffer sharing): %12.2f MB = %.2f MB + %.2f KB per sample\n",
+            ((double) sharedPerSampleBytes * minibatchSize + sharedFixedBytes) / MB, sharedFixedBytes / MB, sharedPerSampleBytes / 1024.0);
+    fprintf(stderr, "\t  of which in use at the peak:    %12.2f MB\n", livePeak / MB);
+    for (int c = 0; c < NumCategories; c++)
+        fprintf(stderr, "\t    %-28s %12.2f MB\n", categoryNames[c], liveAtPeak[c] / MB);
+    fprintf(stderr, "\t  (static memory plan:            %12.2f MB)\n", ((double) plannedPerSampleBytes * minibatchSize + plannedFixedBytes) / MB);
+    fprintf(stderr, "\tconvolution workspace (estimate): %12.2f MB\n", workspaceBytes(minibatchSize) / MB);
+    fprintf(stderr, "\ttotal:                            %12.2f MB\n", totalBytes(minibatchSize) / MB);
+    if (numUnsizedRequests > 0)
+        fprintf(stderr, "\t(%d matrices of unknown size, e.g. sparse matrices and the cuDNN workspaces, are not included in the network matrices.)\n", (int) numUnsizedRequests);
+
+    // suggest the largest minibatch that fits
+    if (limitMB <= 0)
+    {
+        fprintf(stderr, "Dry run: Specify memoryLimitInMB to get the largest minibatch size that fits.\n");
+        return;
+    }
+    double limitBytes = limitMB * MB;
+    if (totalBytes(1) > limitBytes)
+    {
+        fprintf(stderr, "Dry run: The network does not fit into %.0f MB even at a minibatch of one sample.\n", limitMB);
+        return;
+    }
+    const size_t maxMinibatchSize = (size_t) 1 << 40;
+    size_t fits = 1, fitsNot = 2;
+    while (fitsNot < maxMinibatchSize && totalBytes(fitsNot) <= limitBytes)
+    {
+        fits = fitsNot;
+        fitsNot *= 2;
+    }
+    if (fitsNot >= maxMinibatchSize)
+    {
+        fprintf(stderr, "Dry run: The memory does not grow with the minibatch size, any minibatch size fits into %.0f MB.\n", limitMB);
+        return;
+    }
+    while (fitsNot - fits > 1)
+    {
+        size_t mid = fits + (fitsNot - fits) / 2;
+        if (totalBytes(mid) <= limitBytes)
+            fits = mid;
+        else
+            fitsNot = mid;
+    }
+    fprintf(stderr, "Dry run: The largest minibatch that fits into %.0f MB is %d samples", limitMB, (int) fits);
+    if (sequenceLength > 0)
+        fprintf(stderr, " (%d sequences of %d samples)", (int) (fits / sequenceLength), (int) sequenceLength);
+    fprintf(stderr, ". Minibatch size %d %s.\n", (int) minibatchSize, minibatchSize <= fits ? "fits" : "does not fit");
+}
+
+template void DoDryRun<float>(const ConfigParameters& config);
+template void DoDryRun<double>(const ConfigParameters& config);
+
+// ===========================================================================
+// DoBenchmarkCommunication() - implements CNTK "benchmarkCommunication" command
+// ===========================================================================
+
+// Measures the latency and bandwidth of all-reduce across the ranks of an MPI job, for a range of message sizes, with
+// each of the ways gradients can be aggregated, so that numGradientBits, packThresholdSizeInBytes, the bucket size and
+// hierarchicalAllReduce can be chosen from measured data for a given interconnect. Must be launched like parallel
+// training, e.g. 'mpiexec -n 4 cntk configFile=... command=benchmarkCommunication'. Parameters:
+//   messageSizes              - colon-separated sizes in bytes (default 4 KB to 64 MB)
+//   modes                     - colon-separated subset of (default all):
+//                                 mpiAllReduce   - MPIWrapper::AllReduce() of a CPU buffer
+//                                 mpiIallreduce  - MPIWrapper::AllReduceAsync() of a CPU buffer, and Wait()
+//                                 nccl           - NcclComm::AllReduce() of a GPU buffer (skipped if NCCL is not available)
+//                                 aggregator     - SimpleDistGradAggregator, as in data-parallel SGD with full precision
+//                                 quantized      - AllReduceDistGradAggregator, as in data-parallel SGD with gradientBits < 32
+//   numGradients              - number of gradient matrices the message is split into for the aggregators (default 16)
+//   packThresholdSizeInBytes  - colon-separated values to try for the aggregator (default DEFAULT_PACK_THRESHOLD_SIZE_IN_BYTES)
+//   gradientBucketSizeInBytes - colon-separated values to try for the aggregator, 0 means no buckets (default 0)
+//   hierarchicalAllReduce     - colon-separated values to try for the aggregator (default false)
+//   gradientBits              - colon-separated values to try for the quantized aggregator (default 1)
+//   iterations                - timed iterations per measurement (default 20), after warmupIterations (default 3)
+//   outputFile                - if given, the main node writes the results there as CSV
+// The reported time of a measurement is the mean over the iterations of the slowest rank. The bus bandwidth follows
+// the NCCL convention, algorithm bandwidth * 2 (n - 1) / n, which does not depend on the number of ranks for a ring.
+template <typename ElemType>
+void DoBenchmarkCommunication(const ConfigParameters& config)
+{
+    let mpi = MPIWrapper::GetInstance();
+    if (!mpi)
+        InvalidArgument("benchmarkCommunication: This command must be run as an MPI job, with parallelTrain=true.");
+
+    DEVICEID_TYPE deviceId = DeviceFromConfig(config);
+    intargvector messageSizes = config(L"messageSizes", "4096:65536:1048576:16777216:67108864");
+    ConfigArray modesArg = config(L"modes", "mpiAllReduce:mpiIallreduce:nccl:aggregator:quantized");
+    size_t numGradients = config(L"numGradients", "16");
+    ConfigArray packThresholdsArg = config(L"packThresholdSizeInBytes", to_string(DEFAULT_PACK_THRESHOLD_SIZE_IN_BYTES).c_str());
+    intargvector packThresholds = packThresholdsArg;
+    intargvector bucketSizes = config(L"gradientBucketSizeInBytes", "0");
+    ConfigArray hierarchicalArg = config(L"hierarchicalAllReduce", "false");
+    intargvector gradientBits = config(L"gradientBits", "1");
+    size_t iterations = config(L"iterations", "20");
+    size_t warmupIterations = config(L"warmupIterations", "3");
+    wstring outputFile = config(L"outputFile", L"");
+
+    set<wstring> modes;
+    for (size_t i = 0; i < modesArg.size(); i++)
+        modes.insert(modesArg[i]);
+    vector<bool> hierarchicalValues;
+    for (size_t i = 0; i < hierarchicalArg.size(); i++)
+        hierarchicalValues.push_back((bool) hierarchicalArg[i]);
+
+    size_t numRanks = mpi->NumNodesInUse();
+    if (mpi->IsMainNode())
+    {
+        fprintf(stderr, "benchmarkCommunication: %d ranks, %s, %d-byte elements\n", (int) numRanks, deviceId < 0 ? "CPU" : "GPU", (int) sizeof(ElemType));
+        fprintf(stderr, "%-64s %12s %12s %12s %12s\n", "mode", "bytes", "time [ms]", "algBW [GB/s]", "busBW [GB/s]");
+    }
+
+    let synchronizeDevice = [deviceId]()
+    {
+        std::unique_ptr<MatrixComputeStreamEvent> event(MatrixComputeStreamEvent::Create(deviceId));
+        event->SynchronizeEvent();
+    };
+
+    // times fn, which does one all-reduce of 'bytes'; all ranks must call this in the same order
+    string csv = "mode,bytes,ranks,timeMs,algBandwidthGBs,busBandwidthGBs\n";
+    let measure = [&](const string& mode, size_t bytes, const function<void()>& fn)
+    {
+        double seconds = 0;
+        try
+        {
+            for (size_t i = 0; i < warmupIterations + iterations; i++)
+            {
+                mpi->WaitAll(); // barrier, so that all ranks start together
+                auto begin = chrono::steady_clock::now();
+                fn();
+                synchronizeDevice();
+                if (i >= warmupIterations)
+                    seconds += chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+            }
+        }
+        catch (const exception& e)
+        {
+            // (errors are raised on all ranks alike, e.g. for a missing feature, so the ranks stay in step)
+            if (mpi->IsMainNode())
+                fprintf(stderr, "%-64s %12d skipped: %s\n", mode.c_str(), (int) bytes, e.what());
+            return;
+        }
+        seconds /= (max)(iterations, (size_t) 1);
+        mpi->AllReduce(&seconds, 1, MPI_MAX);
+
+        double algBandwidth = seconds > 0 ? bytes / seconds / 1e9 : 0;
+        double busBandwidth = algBandwidth * 2 * (numRanks - 1) / numRanks;
+        if (mpi->IsMainNode())
+        {
+            fprintf(stderr, "%-64s %12d %12.4f %12.3f %12.3f\n", mode.c_str(), (int) bytes, seconds * 1000, algBandwidth, busBandwidth);
+            char line[256];
+            sprintf(line, "%s,%d,%d,%.6f,%.4f,%.4f\n", mode.c_str(), (int) bytes, (int) numRanks, seconds * 1000, algBandwidth, busBandwidth);
+            csv += line;
+        }
+    };
+
+    // gradient matrices on the device, holding 'count' elements in all
+    let createGradients = [deviceId, numGradients](size_t count) -> vector<shared_ptr<Matrix<ElemType>>>
+    {
+        vector<shared_ptr<Matrix<ElemType>>> gradients;
+        size_t numMatrices = (min)((max)(numGradients, (size_t) 1), count);
+        for (size_t i = 0; i < numMatrices; i++)
+        {
+            size_t numElements = count / numMatrices + (i < count % numMatrices ? 1 : 0);
+            gradients.push_back(make_shared<Matrix<ElemType>>(numElements, 1, deviceId));
+            gradients.back()->SetValue((ElemType) 1);
+        }
+        return gradients;
+    };
+
+    // times an aggregator on the gradients of one message, the way SGD calls it each minibatch
+    let measureAggregator = [&](const string& mode, size_t bytes, IDistGradAggregator<ElemType>& aggregator)
+    {
+        auto gradients = createGradients(bytes / sizeof(ElemType));
+        vector<Matrix<ElemType>*> gradientPtrs;
+        for (const auto& gradient : gradients)
+            gradientPtrs.push_back(gradient.get());
+        shared_ptr<DistGradHeader> header(DistGradHeader::Create(0), [](DistGradHeader* ptr) { DistGradHeader::Destroy(ptr); });
+        bool resetState = true;
+        measure(mode, bytes, [&]()
+        {
+            header->Clear();
+            header->numSamples = header->numSamplesWithLabel = 1;
+            aggregator.AggregateGradients(gradientPtrs, header.get(), resetState);
+            resetState = false;
+        });
+    };
+
+    for (int messageSize : messageSizes)
+    {
+        size_t count = (max)((size_t) messageSize / sizeof(ElemType), (size_t) 1);
+        size_t bytes = count * sizeof(ElemType);
+
+        if (modes.find(L"mpiAllReduce") != modes.end() || modes.find(L"mpiIallreduce") != modes.end())
+        {
+            vector<ElemType> buffer(count, (ElemType) 1);
+            if (modes.find(L"mpiAllReduce") != modes.end())
+                measure("mpi/AllReduce", bytes, [&]() { mpi->AllReduce(buffer.data(), count); });
+            if (modes.find(L"mpiIallreduce") != modes.end())
+                measure("mpi/Iallreduce", bytes, [&]()
+                {
+                    MPI_Request request;
+                    mpi->AllReduceAsync(buffer.data(), count, &request);
+                    mpi->Wait(&request);
+                });
+        }
+
+        if (modes.find(L"nccl") != modes.end() && deviceId >= 0)
+        {
+            for (bool hierarchical : hierarchicalValues)
+            {
+                NcclComm::SetHierarchicalAllReduce(hierarchical);
+                NcclComm nccl(deviceId, mpi);
+                if (!nccl.IsSupported())
+                    continue;
+                Matrix<ElemType> buffer(count, 1, deviceId);
+                buffer.SetValue((ElemType) 1);
+                measure(string("nccl/AllReduce") + (hierarchical ? " hierarchical" : ""), bytes, [&]()
+                {
+                    nccl.AllReduce(buffer.Data(), buffer.Data(), count);
+                    nccl.Sync();
+                });
+            }
+        }
+
+        if (modes.find(L"aggregator") != modes.end())
+        {
+            for (bool hierarchical : hierarchicalValues)
+                for (int packThreshold : packThresholds)
+                    for (int bucketSize : bucketSizes)
+                    {
+                        NcclComm::SetHierarchicalAllReduce(hierarchical);
+                        SimpleDistGradAggregator<ElemType> aggregator(mpi, false /*useAsyncAggregation*/, deviceId, 0 /*syncStatsTrace*/, packThreshold, bucketSize);
+                        measureAggregator("aggregator/simple pack=" + to_string(packThreshold) + " bucket=" + to_string(bucketSize) + (hierarchical ? " hierarchical" : ""),
+                                          bytes, aggregator);
+                    }
+        }
+
+        if (modes.find(L"quantized") != modes.end())
+        {
+            for (int bits : gradientBits)
+            {
+#ifdef CNTK_PARALLEL_TRAINING_SUPPORT
+                AllReduceDistGradAggregator<ElemType> aggregator(mpi, bits, true /*zeroThresholdFor1Bit*/, true /*useQuantizationForSelfStripe*/, false /*useAsyncAggregation*/, 0 /*traceLevel*/, 0 /*syncStatsTrace*/);
+                measureAggregator("aggregator/quantized bits=" + to_string(bits), bytes, aggregator);
+#else
+                if (mpi->IsMainNode())
+                    fprintf(stderr, "%-64s %12d skipped: CNTK was built without quantized gradient aggregation support.\n",
+                            ("aggregator/quantized bits=" + to_string(bits)).c_str(), (int) bytes);
+#endif
+            }
+        }
+    }
+    NcclComm::SetHierarchicalAllReduce(false);
+
+    if (mpi->IsMainNode() && !outputFile.empty())
+    {
+        FILE* f = fopenOrDie(outputFile, L"w");
+        fputs(csv.c_str(), f);
+        fcloseOrDie(f);
+    }
+}
+
+template void DoBenchmarkCommunication<float>(const ConfigParameters& config);
+template void DoBenchmarkCommunication<double>(const ConfigParameters& config);
@@ -8,11 +8,13 @@
 #include "BrainScriptEvaluator.h"
 #include "BrainScriptParser.h"
 
+#include <algorithm>
 #include <deque>
 #include <set>
 #include <functional>
 #include <memory>
 #include <cmath>
+#include <chrono>
 
 #ifndef let
 #define let const auto
@@ -202,13 +204,15 @@ typedef function<ConfigValuePtr(const ExpressionPtr &e, ConfigValuePtr leftVal,
 struct InfixOps
 {
     wstring prettyName;    // pretty-printable name of this op, e.g. "Plus" for +
+    wstring leftArgName;   // expression names of the operands, e.g. "PlusArgs[0]"
+    wstring rightArgName;
     InfixOp NumbersOp;     // number OP number -> number
     InfixOp StringsOp;     // string OP string -> string
     InfixOp BoolOp;        // bool OP bool -> bool
     InfixOp ComputeNodeOp; // one operand is ComputeNode -> ComputeNode
     InfixOp OtherOp;       // other OP other
     InfixOps(const wchar_t *name, InfixOp NumbersOp, InfixOp StringsOp, InfixOp BoolOp, InfixOp ComputeNodeOp, InfixOp OtherOp)
-        : prettyName(name), NumbersOp(NumbersOp), StringsOp(StringsOp), BoolOp(BoolOp), ComputeNodeOp(ComputeNodeOp), OtherOp(OtherOp)
+        : prettyName(name), leftArgName(prettyName + L"Args[0]"), rightArgName(prettyName + L"Args[1]"), NumbersOp(NumbersOp), StringsOp(StringsOp), BoolOp(BoolOp), ComputeNodeOp(ComputeNodeOp), OtherOp(OtherOp)
     {
     }
 };
@@ -535,10 +539,66 @@ static ConfigValuePtr MakeEvaluateThunkPtr(const ExpressionPtr &expr, const ICon
     return ConfigValuePtr::MakeThunk(f, MakeFailFn(expr->location), exprPath);
 }
 
+// -----------------------------------------------------------------------
+// profile of the evaluation
+// -----------------------------------------------------------------------
+
+// time spent in the macros (functions defined in BrainScript), until they return
+// Since values are evaluated lazily, this does not include the parts of their results that are only evaluated when used.
+struct MacroProfile
+{
+    size_t numCalls = 0;
+    double seconds = 0;     // including nested and recursive calls
+};
+static bool profile = false;
+static map<wstring, MacroProfile> macroProfiles;
+
+void EnableEvaluationProfile(bool enable)
+{
+    profile = enable;
+    macroProfiles.clear();
+}
+
+void PrintEvaluationProfile(size_t maxMacros)
+{
+    vector<pair<wstring, MacroProfile>> sorted(macroProfiles.begin(), macroProfiles.end());
+    sort(sorted.begin(), sorted.end(), [](const pair<wstring, MacroProfile>& a, const pair<wstring, MacroProfile>& b) { return a.second.seconds > b.second.seconds; });
+    if (sorted.size() > maxMacros)
+        sorted.resize(maxMacros);
+    fprintf(stderr, "BrainScript macros taking the most time to evaluate (including nested calls):\n");
+    for (let& macro : sorted)
+        fprintf(stderr, "\t%10.3f seconds in %8d calls of %ls\n", macro.second.seconds, (int) macro.second.numCalls, macro.first.c_str());
+}
+
 // -----------------------------------------------------------------------
 // main evaluator function (highly recursive)
 // -----------------------------------------------------------------------
 
+// the operations of Expression::op, as dispatched in Evaluate()
+enum class EvalOp
+{
+    doubleLiteral, stringLiteral, boolLiteral, newObject, ifThenElse, lambda, apply, record, identifier, recordMember,
+    arrayConcat, arrayConstructor, arrayIndex, unaryPlusMinus, unaryNot, infix
+};
+
+static EvalOp GetEvalOp(const Expression &e)
+{
+    if (e.evalOp < 0)
+    {
+        static const map<wstring, EvalOp> evalOps =
+        {
+            { L"d", EvalOp::doubleLiteral }, { L"s", EvalOp::stringLiteral }, { L"b", EvalOp::boolLiteral }, { L"new", EvalOp::newObject },
+            { L"if", EvalOp::ifThenElse }, { L"=>", EvalOp::lambda }, { L"(", EvalOp::apply }, { L"{", EvalOp::apply },
+            { L"[]", EvalOp::record }, { L"id", EvalOp::identifier }, { L".", EvalOp::recordMember }, { L":", EvalOp::arrayConcat },
+            { L"array", EvalOp::arrayConstructor }, { L"[", EvalOp::arrayIndex }, { L"+(", EvalOp::unaryPlusMinus }, { L"-(", EvalOp::unaryPlusMinus },
+            { L"!(", EvalOp::unaryNot }
+        };
+        let iter = evalOps.find(e.op);
+        e.evalOp = (int) (iter != evalOps.end() ? iter->second : EvalOp::infix);
+    }
+    return (EvalOp) e.evalOp;
+}
+
 // Evaluate()
 //  - input:  expression
 //  - output: ConfigValuePtr that holds the evaluated value of the expression
@@ -564,13 +624,14 @@ static ConfigValuePtr Evaluate(const ExpressionPtr &e, const IConfigRecordPtr &s
         if (trace)
             TextLocation::Trace(e->location, msra::strfun::wstrprintf(L"eval SP=0x%p", &exprPath).c_str(), e->op.c_str(), exprPath.c_str());
         // --- literals
-        if (e->op == L"d")
+        let op = GetEvalOp(*e);
+        if (op == EvalOp::doubleLiteral)
             return MakePrimitiveConfigValuePtr(e->d, MakeFailFn(e->location), exprPath); // === double literal
-        else if (e->op == L"s")
+        else if (op == EvalOp::stringLiteral)
             return ConfigValuePtr(make_shared<String>(e->s), MakeFailFn(e->location), exprPath); // === string literal
-        else if (e->op == L"b")
+        else if (op == EvalOp::boolLiteral)
             return MakePrimitiveConfigValuePtr(e->b, MakeFailFn(e->location), exprPath); // === bool literal
-        else if (e->op == L"new")                                                        // === 'new' expression: instantiate C++ runtime object right here
+        else if (op == EvalOp::newObject)                                                        // === 'new' expression: instantiate C++ runtime object right here
         {
             // find the constructor lambda
             let rtInfo = FindRuntimeTypeInfo(e->id);
@@ -586,7 +647,7 @@ static ConfigValuePtr Evaluate(const ExpressionPtr &e, const IConfigRecordPtr &s
                 valueWithName->SetName(value.GetExpressionName());
             return value; // we return the created but not initialized object as the value, so others can reference it
         }
-        else if (e->op == L"if") // === conditional expression
+        else if (op == EvalOp::ifThenElse) // === conditional expression
         {
             let argValPtr = Evaluate(e->args[0], scope, exprPath, L"if");
             if (argValPtr.Is<ComputationNodeObject>()) // if ComputationNode becomes If(c,t,e)
@@ -601,14 +662,19 @@ static ConfigValuePtr Evaluate(const ExpressionPtr &e, const IConfigRecordPtr &s
                 return Evaluate(e->args[2], scope, exprPath, L"");
         }
         // --- functions
-        else if (e->op == L"=>") // === lambda (all macros are stored as lambdas)
+        else if (op == EvalOp::lambda) // === lambda (all macros are stored as lambdas)
         {
             // on scope: The lambda expression remembers the lexical scope of the '=>'; this is how it captures its context.
             let &argListExpr = e->args[0]; // [0] = argument list ("()" expression of identifiers, possibly optional args)
             if (argListExpr->op != L"()")
                 LogicError("parameter list expected");
             let &fnExpr = e->args[1]; // [1] = expression of the function itself
-            let f = [argListExpr, fnExpr, scope, exprPath](vector<ConfigValuePtr> &&args, ConfigLambda::NamedParams &&namedArgs, const wstring &callerExprPath) -> ConfigValuePtr
+            // get the macro name for the exprPath
+            wstring macroId = exprPath;
+            let pos = macroId.find(L".");
+            if (pos != wstring::npos)
+                macroId.erase(0, pos + 1);
+            let f = [argListExpr, fnExpr, scope, macroId](vector<ConfigValuePtr> &&args, ConfigLambda::NamedParams &&namedArgs, const wstring &callerExprPath) -> ConfigValuePtr
             {
                 // TODO: document namedArgs--does it have a parent scope? Or is it just a dictionary? Should we just use a shared_ptr<map,ConfigValuPtr>> instead for clarity?
                 // on exprName
@@ -634,7 +700,6 @@ static ConfigValuePtr Evaluate(const ExpressionPtr &e, const IConfigRecordPtr &s
                     if (argName->op != L"id")
                         LogicError("function parameter list must consist of identifiers");
                     auto argVal = move(args[i]); // value of the parameter  --TODO: Is this ever unresolved?
-                    let failfn = argVal.GetFailFn();
                     argScope->Add(argName->id, MakeFailFn(argName->location), move(argVal));
                     // note: these are expressions for the parameter values; so they must be evaluated in the current scope
                 }
@@ -646,13 +711,15 @@ static ConfigValuePtr Evaluate(const ExpressionPtr &e, const IConfigRecordPtr &s
                     let failfn = argVal.GetFailFn();         // note: do before argVal gets destroyed in the upcoming move()
                     argScope->Add(id, failfn, move(argVal)); // TODO: is the failfn the right one?
                 }
-                // get the macro name for the exprPath
-                wstring macroId = exprPath;
-                let pos = macroId.find(L".");
-                if (pos != wstring::npos)
-                    macroId.erase(0, pos + 1);
                 // now evaluate the function
-                return Evaluate(fnExpr, argScope, callerExprPath, L"" /*L"[" + macroId + L"]"*/); // bring args into scope; keep lex scope of '=>' as upwards chain
+                if (!profile)
+                    return Evaluate(fnExpr, argScope, callerExprPath, L"" /*L"[" + macroId + L"]"*/); // bring args into scope; keep lex scope of '=>' as upwards chain
+                let startTime = chrono::steady_clock::now();
+                let value = Evaluate(fnExpr, argScope, callerExprPath, L"");
+                auto &macroProfile = macroProfiles[macroId];
+                macroProfile.numCalls++;
+                macroProfile.seconds += chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+                return value;
             };
             // positional args
             vector<wstring> paramNames;
@@ -677,7 +744,7 @@ static ConfigValuePtr Evaluate(const ExpressionPtr &e, const IConfigRecordPtr &s
             }
             return ConfigValuePtr(make_shared<ConfigLambda>(move(paramNames), move(namedParams), f), MakeFailFn(e->location), exprPath);
         }
-        else if (e->op == L"(" || e->op == L"{") // === apply a function to its arguments
+        else if (op == EvalOp::apply) // === apply a function to its arguments
         {
             // Note: "{" is experimental and currently ignored as a distinction. To do it more completely, we need
             //  - remember how a function was declared (currently not possible for lambdas)
@@ -730,7 +797,7 @@ static ConfigValuePtr Evaluate(const ExpressionPtr &e, const IConfigRecordPtr &s
             return lambda->Apply(move(argVals), move(namedArgVals), exprPath);
         }
         // --- variable access
-        else if (e->op == L"[]") // === record (-> ConfigRecord)
+        else if (op == EvalOp::record) // === record (-> ConfigRecord)
         {
             let newScope = make_shared<ConfigRecord>(scope, MakeFailFn(e->location)); // new scope: inside this record, all symbols from above are also visible
             // ^^ The failfn here will be used if C++ code uses operator[] to retrieve a value. It will report the text location where the record was defined.
@@ -750,15 +817,15 @@ static ConfigValuePtr Evaluate(const ExpressionPtr &e, const IConfigRecordPtr &s
             // BUGBUG: wrong text location passed in. Should be the one of the identifier, not the RHS. NamedArgs store no location for their identifier.
             return ConfigValuePtr(newScope, MakeFailFn(e->location), exprPath);
         }
-        else if (e->op == L"id")
+        else if (op == EvalOp::identifier)
             return ResolveIdentifier(e->id, e->location, scope); // === variable/macro access within current scope
-        else if (e->op == L".")                                  // === variable/macro access in given ConfigRecord element
+        else if (op == EvalOp::recordMember)                                  // === variable/macro access in given ConfigRecord element
         {
             let &recordExpr = e->args[0];
             return RecordLookup(recordExpr, e->id, e->location, scope /*for evaluating recordExpr*/, exprPath);
         }
         // --- arrays
-        else if (e->op == L":") // === array expression (-> ConfigArray)
+        else if (op == EvalOp::arrayConcat) // === array expression (-> ConfigArray)
         {
             // this returns a flattened list of all members as a ConfigArray type
             let arr = make_shared<ConfigArray>();       // note: we could speed this up by keeping the left arg and appending to it
@@ -769,7 +836,7 @@ static ConfigValuePtr Evaluate(const ExpressionPtr &e, const IConfigRecordPtr &s
             }
             return ConfigValuePtr(arr, MakeFailFn(e->location), exprPath); // location will be that of the first ':', not sure if that is best way
         }
-        else if (e->op == L"array") // === array constructor from lambda function
+        else if (op == EvalOp::arrayConstructor) // === array constructor from lambda function
         {
             let &firstIndexExpr = e->args[0]; // first index
             let &lastIndexExpr = e->args[1];  // last index
@@ -806,7 +873,7 @@ static ConfigValuePtr Evaluate(const ExpressionPtr &e, const IConfigRecordPtr &s
             auto arr = make_shared<ConfigArray>(firstIndex, move(elementThunks));
             return ConfigValuePtr(arr, MakeFailFn(e->location), exprPath);
         }
-        else if (e->op == L"[") // === access array element by index
+        else if (op == EvalOp::arrayIndex) // === access array element by index
         {
             let arrValue = Evaluate(e->args[0], scope, exprPath, L"_vector");
             let &indexExpr = e->args[1];
@@ -815,7 +882,7 @@ static ConfigValuePtr Evaluate(const ExpressionPtr &e, const IConfigRecordPtr &s
             return arr->At(index, MakeFailFn(indexExpr->location)); // note: the array element may be as of now unresolved; this resolved it
         }
         // --- unary operators '+' '-' and '!'
-        else if (e->op == L"+(" || e->op == L"-(") // === unary operators + and -
+        else if (op == EvalOp::unaryPlusMinus) // === unary operators + and -
         {
             let argValPtr = Evaluate(e->args[0], scope, exprPath, e->op == L"+(" ? L"" : L"_negate");
             // note on exprPath: since - has only one argument, we do not include it in the expressionPath  --TODO: comment correct?
@@ -832,7 +899,7 @@ static ConfigValuePtr Evaluate(const ExpressionPtr &e, const IConfigRecordPtr &s
             else
                 Fail(L"operator '" + e->op.substr(0, 1) + L"' cannot be applied to this operand (which has type " + msra::strfun::utf16(argValPtr.TypeName()) + L")", e->location);
         }
-        else if (e->op == L"!(") // === unary operator !
+        else if (op == EvalOp::unaryNot) // === unary operator !
         {
             let argValPtr = Evaluate(e->args[0], scope, exprPath, L"_not");
             // note on exprPath: since ! has only one argument, we do not include it in the expressionPath  --TODO: comment correct?
@@ -851,8 +918,8 @@ static ConfigValuePtr Evaluate(const ExpressionPtr &e, const IConfigRecordPtr &s
             let &leftArg = e->args[0];
             let &rightArg = e->args[1];
 #if 1
-            let leftValPtr  = Evaluate(leftArg,  scope, exprPath, functions.prettyName + L"Args[0]");
-            let rightValPtr = Evaluate(rightArg, scope, exprPath, functions.prettyName + L"Args[1]");
+            let leftValPtr  = Evaluate(leftArg,  scope, exprPath, functions.leftArgName);
+            let rightValPtr = Evaluate(rightArg, scope, exprPath, functions.rightArgName);
 #else       // This does not actually work.  --TODO: find out why
             // In the special case of >>, we evaluate the right arg first, as to mimic the same behavior
             // as writing the functions as a direct nested evaluation.
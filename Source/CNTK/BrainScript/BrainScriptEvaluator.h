@@ -22,4 +22,8 @@ ConfigValuePtr Evaluate(ExpressionPtr);                               // evaluat
 void Do(ExpressionPtr e);                                             // evaluate e.do
 shared_ptr<Object> EvaluateField(ExpressionPtr e, const wstring& id); // for experimental CNTK integration
 
+// profile of the time spent in BrainScript macros, e.g. to find out where the construction of a large network goes
+void EnableEvaluationProfile(bool enable); // (also clears the profile)
+void PrintEvaluationProfile(size_t maxMacros);
+
 }}} // end namespaces
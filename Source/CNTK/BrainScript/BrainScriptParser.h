@@ -109,6 +109,7 @@ struct Expression
     vector<ExpressionPtr> args;                                // position-dependent expression/function args
     map<wstring, pair<TextLocation, ExpressionPtr>> namedArgs; // named expression/function args; also dictionary members (loc is of the identifier)
     TextLocation location;                                     // where in the source code (for downstream error reporting)
+    mutable int evalOp = -1;                                   // 'op' as encoded by the evaluator, set upon first evaluation (string compares are too slow for large networks)
     // constructors
     Expression(TextLocation location)
         : location(location), d(0.0), b(false)
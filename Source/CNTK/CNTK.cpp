@@ -24,6 +24,10 @@
 #include "ModelEditLanguage.h"
 #include "CPUMatrix.h" // used for SetNumThreads()
 #include "CommonMatrix.h"
+#include "CUDACachingMemAllocator.h"
+#include "GPUMemoryTimeline.h"
+#include "TensorOpAutotuner.h"
+#include "CuDnnAlgorithmCache.h"
 #include "SGD.h"
 #include "MPIWrapper.h"
 #include "Config.h"
@@ -74,13 +78,27 @@ void TestCn(const ConfigParameters& config);
 template <typename ConfigParamType>
 void SetupProfiling(ProfilerContext& profilerContext, const ConfigParamType& config, int nodeRank)
 {
+    if (config(L"nvtxRanges", false))
+        ProfilerEnableNvtx(true);
+
     if (config(L"profilerEnabled", false))
     {
         wstring workDir = config(L"WorkDir", L".");
         profilerContext.Init(workDir + L"/profiler",
                              config(L"profilerBufferSize", static_cast<uint64_t>(32 * 1024 * 1024)),
                              std::to_wstring(nodeRank),
-                             config(L"profilerSyncGpu", true));
+                             config(L"profilerSyncGpu", true),
+                             config(L"profilerNodes", false));
+    }
+
+    if (config(L"profilerContinuous", false))
+    {
+        wstring workDir = config(L"WorkDir", L".");
+        profilerContext.InitContinuous(workDir + L"/profiler",
+                                       std::to_wstring(nodeRank),
+                                       config(L"profilerContinuousSummarySeconds", 60),
+                                       config(L"profilerContinuousDumpSeconds", 30),
+                                       config(L"profilerContinuousSlowdownFactor", 0.0));
     }
 }
 
@@ -196,6 +214,15 @@ void DoCommands(const ConfigParameters& config, const shared_ptr<MPIWrapper>& mp
         }
     }
 
+    // The readers' parallel loops and worker threads are limited to these threads (e.g. the cores not used by the
+    // math kernels), rather than all of them adding up to the threads of the math kernels.
+    int numReaderThreads = config(L"numReaderThreads", 0);
+    if (numReaderThreads > 0)
+    {
+        Globals::SetNumReaderThreads(numReaderThreads);
+        LOGPRINTF(stderr, "Using %d CPU threads for the readers.\n", numReaderThreads);
+    }
+
     bool progressTracing = config(L"progressTracing", false);
 
     // temporary hack to prevent users from failing due to a small breaking change related to the "truncated" flag (will be redone bigger and better some day)
@@ -323,10 +350,26 @@ void DoCommands(const ConfigParameters& config, const shared_ptr<MPIWrapper>& mp
                 {
                     DoExportToDbn<ElemType>(commandParams);
                 }
+                else if (thisAction == "compactLatticeArchive")
+                {
+                    DoCompactLatticeArchive<ElemType>(commandParams);
+                }
                 else if (thisAction == "createLabelMap")
                 {
                     DoCreateLabelMap<ElemType>(commandParams);
                 }
+                else if (thisAction == "dryRun")
+                {
+                    DoDryRun<ElemType>(commandParams);
+                }
+                else if (thisAction == "benchmarkCommunication")
+                {
+                    DoBenchmarkCommunication<ElemType>(commandParams);
+                }
+                else if (thisAction == "benchmarkReader")
+                {
+                    DoBenchmarkReader<ElemType>(commandParams);
+                }
                 else if (thisAction == "writeWordAndClass")
                 {
                     DoWriteWordAndClassInfo<ElemType>(commandParams);
@@ -339,6 +382,18 @@ void DoCommands(const ConfigParameters& config, const shared_ptr<MPIWrapper>& mp
                 {
                     DoParameterSVD<ElemType>(commandParams);
                 }
+                else if (thisAction == "foldBatchNormalization")
+                {
+                    DoFoldBatchNormalization<ElemType>(commandParams);
+                }
+                else if (thisAction == "prune")
+                {
+                    DoParameterPruning<ElemType>(commandParams);
+                }
+                else if (thisAction == "quantizeModel")
+                {
+                    DoQuantizeModel<ElemType>(commandParams);
+                }
                 else
                 {
                     RuntimeError("unknown action: %s  in command set: %s", thisAction.c_str(), command[i].c_str());
@@ -505,13 +560,25 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
 
     if (paralleltrain)
     {
+        MPIWrapper::RequestMultipleThreadSupport(config(L"mpiThreadMultiple", false));
+        MPIWrapper::RequestProgressThread(config(L"mpiProgressThread", false));
         mpi = MPIWrapper::GetInstance(true /*create*/);
     }  
 
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
+    Globals::SetParallelTraversal(config(L"parallelTraversal", false));
+    Globals::SetCounterBasedRandomInit(config(L"counterBasedRandomInit", false));
+    Globals::SetCounterBasedRandomStreams(config(L"counterBasedRandomStreams", false));
+    Globals::SetSparseProductDensity(config(L"sparseProductDensity", 0.0));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
+    CUDACachingMemAllocator::SetEnabled(config(L"cacheGPUMemory", false));
+    TensorOpAutotuner::SetEnabled(config(L"autotuneTensorOps", false));
+    TensorOpAutotuner::SetCacheFile(config(L"tensorOpAutotuneCache", L""));
+    CuDnnAlgorithmCache::SetCacheFile(config(L"cuDnnAlgorithmCache", L""));
+    if (config(L"traceGPUMemoryTimeline", false))
+        GPUMemoryTimeline::Enable(config(L"gpuMemoryTimelineFile", L""), (size_t)(int)config(L"gpuMemoryTimelineTopN", 20));
 
     // logging
     wstring logpath = config(L"stderr", L"");
@@ -546,6 +613,15 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
             LOGPRINTF(stderr, "Using %d CPU threads.\n", numCPUThreads);
     }
 
+    // The readers' parallel loops and worker threads are limited to these threads (e.g. the cores not used by the
+    // math kernels), rather than all of them adding up to the threads of the math kernels.
+    int numReaderThreads = config(L"numReaderThreads", 0);
+    if (numReaderThreads > 0)
+    {
+        Globals::SetNumReaderThreads(numReaderThreads);
+        LOGPRINTF(stderr, "Using %d CPU threads for the readers.\n", numReaderThreads);
+    }
+
     bool progressTracing = config(L"progressTracing", false);
     size_t fullTotalMaxEpochs = 1; // BUGBUG: BS does not allow me to read out the max epochs parameters, as that would instantiate and thus execute the objects
 
@@ -571,6 +647,9 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
     }
     // else action has already been executed, see comment above
 
+    if (CUDACachingMemAllocator::IsEnabled())
+        CUDACachingMemAllocator::PrintAllStatistics();
+
     // write a doneFile if requested
     wstring doneFile = config(L"doneFile", L"");
     if (doneFile != L"")
@@ -653,13 +732,25 @@ int wmainOldCNTKConfig(int argc, wchar_t* argv[])
 
     if (paralleltrain)
     {
+       MPIWrapper::RequestMultipleThreadSupport(config(L"mpiThreadMultiple", false));
+       MPIWrapper::RequestProgressThread(config(L"mpiProgressThread", false));
        mpi = MPIWrapper::GetInstance(true /*create*/);
     } 
 
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
+    Globals::SetParallelTraversal(config(L"parallelTraversal", false));
+    Globals::SetCounterBasedRandomInit(config(L"counterBasedRandomInit", false));
+    Globals::SetCounterBasedRandomStreams(config(L"counterBasedRandomStreams", false));
+    Globals::SetSparseProductDensity(config(L"sparseProductDensity", 0.0));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
+    CUDACachingMemAllocator::SetEnabled(config(L"cacheGPUMemory", false));
+    TensorOpAutotuner::SetEnabled(config(L"autotuneTensorOps", false));
+    TensorOpAutotuner::SetCacheFile(config(L"tensorOpAutotuneCache", L""));
+    CuDnnAlgorithmCache::SetCacheFile(config(L"cuDnnAlgorithmCache", L""));
+    if (config(L"traceGPUMemoryTimeline", false))
+        GPUMemoryTimeline::Enable(config(L"gpuMemoryTimelineFile", L""), (size_t)(int)config(L"gpuMemoryTimelineTopN", 20));
 
     if (logpath != L"")
     {
@@ -749,6 +840,9 @@ int wmainOldCNTKConfig(int argc, wchar_t* argv[])
     else
         RuntimeError("CNTK: Invalid precision string: \"%s\", must be \"float\" or \"double\"", type.c_str());
 
+    if (CUDACachingMemAllocator::IsEnabled())
+        CUDACachingMemAllocator::PrintAllStatistics();
+
     // if completed then write a doneFile if requested
     if (!doneFile.empty())
     {
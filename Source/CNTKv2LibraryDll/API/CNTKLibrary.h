@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <mutex>
 #include <future>
+#include <chrono>
 #include <cstddef>
 
 #ifdef SWIG
@@ -588,6 +589,8 @@ namespace CNTK
         friend class PackedValue;
         friend class MPICommunicatorImpl;
         friend class BlockMomentumDistributedLearner;
+        friend class LocalSGDDistributedLearner;
+        friend class PipelinedQuantizedMPICommunicatorImpl;
         friend class Internal::VariableResolver;
         friend class Trainer;
 
@@ -1878,6 +1881,7 @@ private:
         CNTK_API const Variable& BlockFunctionVariableMapping() const;
 
         CNTK_API Variable Clone() const;
+        CNTK_API Variable Clone(const DeviceDescriptor& device) const;
 
         CNTK_API virtual Dictionary Serialize() const override;
 
@@ -2433,6 +2437,22 @@ namespace CNTK
             return CreateSequence(sampleShape, sequenceData, true, device, readOnly);
         }
 
+        ///
+        /// Creates a new read-only Value object containing a batch of samples, which aliases the caller-owned 'batchData' buffer
+        /// instead of copying it. The number of samples is numElements divided by the size of the (fully defined) sample shape.
+        /// The buffer must have been allocated on the specified 'device' (i.e. device memory in case of a GPU), must not be modified
+        /// while the Value is in use, and must outlive the created Value object and all Values and NDArrayViews aliasing it.
+        ///
+        template <typename ElementType>
+        CNTK_API static ValuePtr CreateBatch(const NDShape& sampleShape, const ElementType* batchData, size_t numElements, const DeviceDescriptor& device);
+
+        ///
+        /// Creates a new read-only Value object containing a sequence of samples, which aliases the caller-owned 'sequenceData' buffer
+        /// instead of copying it (see the overload of CreateBatch taking a buffer for the lifetime of the buffer).
+        ///
+        template <typename ElementType>
+        CNTK_API static ValuePtr CreateSequence(const NDShape& sampleShape, const ElementType* sequenceData, size_t numElements, bool sequenceStartFlag, const DeviceDescriptor& device);
+
         ///
         /// Creates a new Value object containing a batch of variable length sequences.
         /// The created Value object contains a copy of the specified data in batchOfSequences.
@@ -2929,6 +2949,41 @@ namespace CNTK
     };
     typedef std::shared_ptr<BackPropState> BackPropStatePtr;
 
+    ///
+    /// Optional interface of a user-defined Function, which lets the computation engine compute the Function directly
+    /// on its own buffers instead of through the Value objects of the Forward and Backward methods (which, for
+    /// sequences, involves unpacking the inputs and copying the outputs back).
+    /// Each view aliases the storage of the engine; its shape is the sample shape of the input or output, followed,
+    /// for variables with dynamic axes, by the number of parallel sequences and the number of time steps of the
+    /// minibatch, as packed by the engine (the contents of the gaps between the sequences are undefined).
+    /// The inputs are in the order of the (unique) Inputs() of the Function, and the outputs have fully defined shapes
+    /// and the dynamic axes of the inputs.
+    /// Computations on the GPU have to be issued on the stream returned by ComputeStream().
+    ///
+    class UserFunctionKernel
+    {
+    public:
+        ///
+        /// Computes the outputs of the Function from its inputs, writing into the output views.
+        ///
+        virtual void ForwardKernel(const std::vector<NDArrayViewPtr>& inputs, const std::vector<NDArrayViewPtr>& outputs, bool isTraining) = 0;
+
+        ///
+        /// Adds the gradients of the inputs (with respect to the outputs of the last ForwardKernel call) to the input
+        /// gradient views. The views are null for outputs and inputs that do not need gradients.
+        ///
+        virtual void BackwardKernel(const std::vector<NDArrayViewPtr>& inputs, const std::vector<NDArrayViewPtr>& outputs,
+                                    const std::vector<NDArrayViewPtr>& outputGradients, const std::vector<NDArrayViewPtr>& inputGradients) = 0;
+
+        ///
+        /// Returns the stream the computations of the engine are issued on for the specified device
+        /// (a cudaStream_t for GPU devices, nullptr for the CPU).
+        ///
+        CNTK_API static void* ComputeStream(const DeviceDescriptor& device);
+
+        virtual ~UserFunctionKernel() {}
+    };
+
     ///
     /// How are Parameters handled when cloning a Function
     ///
@@ -2974,6 +3029,15 @@ namespace CNTK
         return nullptr;
     };
 
+    ///
+    /// Formats of a model file written by Function::Save.
+    ///
+    enum class ModelFormat
+    {
+        CNTKv2,         // a protobuf message
+        CNTKv2Mappable, // the graph as protobuf, followed by the uncompressed, aligned parameter data; Function::Load maps it into memory
+    };
+
     ///
     /// Represents a function (optionally differentiable w.r.t. its inputs)
     /// A Function denotes a symbolic computation with zero or more input arguments and one or more outputs. 
@@ -3016,6 +3080,37 @@ namespace CNTK
                                           const std::unordered_set<Variable>& outputsToRetainBackwardStateFor = {},
                                           const std::unordered_set<Variable>& inputsToExcludeGradientsFor = {});
 
+        ///
+        /// Asynchronous version of Forward for evaluation: the computation runs on a background thread, so that the caller can prepare the
+        /// next inputs or process earlier outputs meanwhile (or drive Functions on other devices from the same thread). The returned future
+        /// yields the 'outputs' map, with the Values filled in or, for null Values, allocated by the implementation; the latter only are
+        /// copied out of the network's storage when first accessed, and are valid until the next Forward/Backward call.
+        /// The 'arguments' and specified 'outputs' Values must not be accessed, and 'this' Function (as well as Functions sharing its
+        /// Parameters) must not be used, until the future is ready.
+        ///
+        CNTK_API std::future<std::unordered_map<Variable, ValuePtr>> ForwardAsync(const std::unordered_map<Variable, ValuePtr>& arguments,
+                                                                                  const std::unordered_map<Variable, ValuePtr>& outputs,
+                                                                                  const DeviceDescriptor& computeDevice = DeviceDescriptor::UseDefaultDevice());
+
+        ///
+        /// Incremental evaluation of recurrent models (e.g. step-wise autoregressive decoding) for several independent sequences,
+        /// each identified by an id chosen by the caller: sequence i of the 'arguments' Values belongs to sequenceIds[i].
+        /// A sequence with a sequence start flag (re)starts the sequence of its id. A sequence without one continues the sequence of
+        /// its id from the state its PastValue operations had at the end of the previous call for that id, independent of which
+        /// other sequences are evaluated in between or in the same call. Thus only the new steps are computed, instead of the whole prefix.
+        /// The outputs hold the values of the new steps. All calls for sequences that have not been ended must request the same outputs
+        /// on the same device. Only PastValue operations with an offset of 1 can carry the state of a sequence from one call to the next.
+        ///
+        CNTK_API void ForwardSequences(const std::vector<size_t>& sequenceIds,
+                                       const std::unordered_map<Variable, ValuePtr>& arguments,
+                                       std::unordered_map<Variable, ValuePtr>& outputs,
+                                       const DeviceDescriptor& computeDevice = DeviceDescriptor::UseDefaultDevice());
+
+        ///
+        /// Releases the state of a sequence evaluated with ForwardSequences.
+        ///
+        CNTK_API void EndSequence(size_t sequenceId);
+
         ///
         /// Backpropagates supplied 'rootGradientValues' for one or more of the output variables of the Function, to produce gradient Values
         /// corresponding to the specified set of input variables in 'backPropagatedGradientValuesForInputs'.
@@ -3145,6 +3240,14 @@ namespace CNTK
         ///
         CNTK_API FunctionPtr Clone(ParameterCloningMethod parameterCloneMethod = ParameterCloningMethod::Clone, const std::unordered_map<Variable, Variable>& replacements = {}) const;
 
+        ///
+        /// Clones 'this' Function onto the specified device: the values of the Parameters and Constants of the clone are
+        /// copied directly to that device. This allows to load a model once (e.g. onto the CPU) and replicate it onto
+        /// several devices, instead of loading the model separately for each device.
+        /// The parameterCloneMethod must be either ParameterCloningMethod::Clone or ParameterCloningMethod::Freeze.
+        ///
+        CNTK_API FunctionPtr Clone(const DeviceDescriptor& device, ParameterCloningMethod parameterCloneMethod = ParameterCloningMethod::Clone, const std::unordered_map<Variable, Variable>& replacements = {}) const;
+
         ///
         /// Deserializes a Function from the model dictionary, using the specified UDF deserializer to 
         //  reconstruct user defined functions if the model contains any (in which case an exception will be raised 
@@ -3339,6 +3442,11 @@ namespace CNTK
         ///
         CNTK_API void Save(const std::wstring& filepath);
 
+        ///
+        /// Save this Function graph into a model file of the specified format.
+        ///
+        CNTK_API void Save(const std::wstring& filepath, ModelFormat format);
+
         ///
         /// Restore the models parameters (in-place) from a model file
         ///
@@ -3379,6 +3487,16 @@ namespace CNTK
         /// function instance returned from the Dropout(), RandomSample(), RandomSampleInclusionFrequency() 
         /// method or a corresponding primitive function returned from FindByName()).
         ///
+        /// * 'recompute' with a bool value. If true, the function's output is not kept in memory from the forward
+        /// pass for the backward pass, but recomputed when needed (activation recomputation, trading compute for
+        /// memory). Takes effect when the computation network for the function is created, i.e. it must be set before
+        /// the function is first evaluated or trained.
+        ///
+        /// * 'offload' with a bool value. If true, the function's output (if on a GPU) is not kept in device memory from the
+        /// forward pass for the backward pass, but copied to host memory and back, overlapping with the computation
+        /// (activation offload, trading PCIe bandwidth for memory). Like 'recompute', it must be set before the function
+        /// is first evaluated or trained.
+        ///
         CNTK_API void SetAttribute(const std::wstring& name, const DictionaryValue& value);
 
         ///
@@ -3505,9 +3623,13 @@ namespace CNTK
                                         std::unordered_set<const Function*>& visitedFunctions,
                                         std::unordered_set<Variable>& replacedPlaceholders);
 
+        // A null device keeps the values of the cloned Parameters and Constants on their current device.
+        FunctionPtr Clone(ParameterCloningMethod parameterCloneMethod, const std::unordered_map<Variable, Variable>& replacements, const DeviceDescriptor* device) const;
+
         static FunctionPtr Clone(const FunctionPtr& clonee,
                                  ParameterCloningMethod parameterCloneMethod,
                                  const std::unordered_map<Variable, Variable>& replacements,
+                                 const DeviceDescriptor* device,
                                  std::unordered_map<const Function*, FunctionPtr>& cloneMap,
                                  std::unordered_map<Variable, Variable>& leafVariablesCloneMap,
                                  std::unordered_map<Variable, Variable>& placeholderReplacements);
@@ -4489,6 +4611,19 @@ namespace CNTK
         // This option results in the mean value of the gradients across the samples in the minibatch to be used by the learner.
         // The mean gradient is computed by dividing the gradient values accumulated across all samples by the actual number of samples (labels) in the minibatch.
         bool useMeanGradient = false;
+
+        // This option stores the smoothed gradients (e.g. the moments of Adam) in bfloat16 with stochastic rounding, which takes
+        // half (float) or a quarter (double) of the memory. They are converted to the precision of the parameters for each update.
+        bool bfloat16SmoothedGradients = false;
+
+        // This option (for the Adam learner) approximates the second moment of a parameter with two axes by the products of
+        // moving averages of row and column sums, which takes memory proportional to rows + columns instead of rows x columns.
+        bool factoredSecondMoments = false;
+
+        // This option (for the SGD, momentum SGD, Nesterov and Adam learners) updates all parameters of the learner at once, with a
+        // few GPU kernel launches in total rather than a few per parameter, when their gradients are dense and on the same device.
+        // This speeds up the update of models with many small parameters; the results may differ from the regular update by rounding.
+        bool fusedUpdates = false;
     };
 
     ///  
@@ -4793,6 +4928,16 @@ namespace CNTK
 
     CNTK_API DistributedLearnerPtr CreateDataParallelDistributedLearner(DistributedCommunicatorPtr communicator, LearnerPtr learner, size_t distributeAfterSamples, bool useAsyncBufferedParameterUpdate = false);
 
+    ///
+    /// Create a data parallel distributed learner which shards the optimizer state between the workers: the parameters
+    /// are partitioned between the workers (balancing their number of elements), and each worker keeps the learner state
+    /// (e.g. the Adam moments) of its own parameters only, in the learner created by 'createLearner' for them.
+    /// The gradients are aggregated as with CreateDataParallelDistributedLearner; each worker then updates its own parameters,
+    /// and the new values are shared with all workers. There is no warm-up: the learner is distributed from the start.
+    /// There must be at least as many parameters as workers. Checkpoints can only be restored with the same number of workers.
+    ///
+    CNTK_API DistributedLearnerPtr CreateShardedDataParallelDistributedLearner(DistributedCommunicatorPtr communicator, const std::vector<Parameter>& parameters, const std::function<LearnerPtr(const std::vector<Parameter>&)>& createLearner);
+
     CNTK_API DistributedLearnerPtr CreateQuantizedDataParallelDistributedLearner(QuantizedDistributedCommunicatorPtr communicator, LearnerPtr learner, size_t distributeAfterSamples, bool useAsyncBufferedParameterUpdate = false);
 
     CNTK_API DistributedLearnerPtr CreateBlockMomentumDistributedLearner(
@@ -4814,6 +4959,25 @@ namespace CNTK
         bool resetSGDMomentumAfterAggregation = true,
         double blockLearningRate = 1.0);
 
+    ///
+    /// Create a local SGD distributed learner: each worker updates its own copy of the parameters with its local gradients,
+    /// and the parameters are averaged across the workers every 'averagingPeriod' minibatches.
+    /// During the first 'averagingPeriodWarmupSamples' samples after 'distributeAfterSamples' the period is ramped up linearly
+    /// from averaging after every minibatch.
+    /// With a non-zero 'maxCommunicationRatio' the period is adapted (between 1 and 'maxAveragingPeriod') from the measured
+    /// times of a minibatch and of an averaging, to the shortest period for which the averaging takes at most this fraction
+    /// of the compute time; this lets low-bandwidth clusters trade averaging frequency for throughput.
+    /// Training stops when none of the workers has any samples left.
+    ///
+    CNTK_API DistributedLearnerPtr CreateLocalSGDDistributedLearner(
+        DistributedCommunicatorPtr communicator,
+        LearnerPtr learner,
+        size_t distributeAfterSamples,
+        size_t averagingPeriod,
+        size_t maxAveragingPeriod = 0,
+        double maxCommunicationRatio = 0.0,
+        size_t averagingPeriodWarmupSamples = 0);
+
     ///
     /// Evaluator is a top-level abstraction for evaluating a model's performance with specified error criterion.
     ///
@@ -5015,7 +5179,9 @@ namespace CNTK
         bool TrainLocalMinibatch(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputsToFetch, bool sweepEnd, const DeviceDescriptor& computeDevice);
         bool TrainDistributedMinibatch(const std::unordered_map<Variable, ValuePtr>& arguments, std::unordered_map<Variable, ValuePtr>& outputsToFetch, bool sweepEnd, const DeviceDescriptor& computeDevice);
 
-        void Save(const std::wstring& modelFilePath, const std::vector<DictionaryValue>& learnerState, 
+        // Takes a snapshot of the model and the trainer state, and returns a function writing it to the checkpoint files.
+        std::function<void()> SnapshotCheckpoint(const std::wstring& modelFilePath, const Dictionary& externalState);
+        std::function<void()> Snapshot(const std::wstring& modelFilePath, const std::vector<DictionaryValue>& learnerState,
             const Dictionary& externalState, const Dictionary& distributedState = {});
 
         void UpdateTrainingProgress(size_t numSamples, const ValuePtr& loss, const ValuePtr& evalCriterion, const DeviceDescriptor& computeDevice);
@@ -5277,6 +5443,74 @@ namespace CNTK
     ///
     CNTK_API MinibatchSourcePtr CreateCompositeMinibatchSource(const MinibatchSourceConfig& configuration);
 
+    ///
+    /// A configuration required to instantiate a streaming minibatch source.
+    ///
+    struct StreamingMinibatchSourceConfig
+    {
+        ///
+        /// Creates a new streaming minibatch source configuration for records of the given streams.
+        /// The ids of the streams are assigned in the order of the streams.
+        ///
+        CNTK_API StreamingMinibatchSourceConfig(const std::vector<StreamInformation>& streams);
+
+        ///
+        /// The maximum number of records the source holds; AddRecord() blocks while it is full, which
+        /// slows down the producer of the records if training cannot keep up with them.
+        ///
+        size_t maxQueuedRecords{ 4096 };
+
+        ///
+        /// The maximum time (in milliseconds) GetNextMinibatch() waits for a minibatch to fill up, counted from the
+        /// time its first record was added. Once it has passed, the records received so far make up the minibatch.
+        ///
+        size_t maxLatencyInMilliseconds{ 10 };
+
+        ///
+        /// The streams of the records.
+        ///
+        std::vector<StreamInformation> streams;
+    };
+
+    ///
+    /// A minibatch source for online learning, which is fed with records by the application (e.g. as they are received
+    /// from a socket or a queue) instead of reading them from files. A record holds one sequence for each stream, and the
+    /// number of its samples is that of its longest sequence. The records are returned in the order they were added:
+    /// there is no index, no sweep and no randomization. In a distributed job, each worker feeds a source of its own,
+    /// and the number of workers and the worker rank passed to GetNextMinibatch() are ignored.
+    /// GetNextMinibatch() waits for the first record of a minibatch, and returns an empty map once the source is closed
+    /// and all of its records have been returned.
+    ///
+    class StreamingMinibatchSource : public MinibatchSource
+    {
+    public:
+        typedef std::chrono::system_clock::time_point Timestamp;
+
+        ///
+        /// Adds a record, which maps every stream to a sequence (an NDArrayView on the CPU of the shape
+        /// [sample shape x #samples]); the data is copied when the minibatch is created.
+        /// The timestamp (e.g. the time the record was created) is returned with the minibatch, see LastMinibatchTimestamps().
+        /// Blocks while the source is full. Returns false if the source has been closed.
+        ///
+        virtual bool AddRecord(const std::unordered_map<StreamInformation, NDArrayViewPtr>& record, Timestamp timestamp = std::chrono::system_clock::now()) = 0;
+
+        ///
+        /// Ends the stream of records: GetNextMinibatch() returns the records added so far, and an empty map after them.
+        ///
+        virtual void Close() = 0;
+
+        ///
+        /// The timestamps of the records of the minibatch last returned by GetNextMinibatch(), in the order of its sequences,
+        /// e.g. to measure how fresh the data is a model is trained on.
+        ///
+        virtual const std::vector<Timestamp>& LastMinibatchTimestamps() const = 0;
+    };
+
+    ///
+    /// Instantiate a streaming minibatch source.
+    ///
+    CNTK_API StreamingMinibatchSourcePtr CreateStreamingMinibatchSource(const StreamingMinibatchSourceConfig& configuration);
+
     struct StreamConfiguration
     {
         StreamConfiguration(const std::wstring& streamName, size_t dim, bool isSparse = false, const std::wstring& streamAlias = L"", bool definesMbSize = false)
@@ -5365,6 +5599,23 @@ namespace CNTK
     /// 
     CNTK_API  Deserializer HTKMLFDeserializer(const std::wstring& streamName, const std::wstring& labelMappingFile, size_t dimension, const std::vector<std::wstring>& mlfFiles, bool phoneBoundaries = false);
 
+    /// 
+    /// Create a KaldiFeatureDeserializer with the specified options; m_scp of each stream is a Kaldi script file pointing into binary archives
+    /// 
+    CNTK_API  Deserializer KaldiFeatureDeserializer(const std::vector<HTKFeatureConfiguration>& streams);
+
+    /// 
+    /// Create a KaldiAlignmentDeserializer with the specified options; the script file points to int32 vectors of class ids (e.g. from ali-to-pdf)
+    /// 
+    CNTK_API  Deserializer KaldiAlignmentDeserializer(const std::wstring& streamName, const std::wstring& scp, size_t dimension);
+
+    /// 
+    /// Create a TextSequenceDeserializer for a text corpus with one sentence per line; each stream is given by its name and the shift of its words
+    /// (e.g. { L"features", 0 }, { L"labels", 1 } for a language model). Without an unknownWord, words that are not in the vocabulary are an error.
+    /// 
+    CNTK_API  Deserializer TextSequenceDeserializer(const std::wstring& fileName, const std::wstring& vocabularyFile, const std::vector<std::pair<std::wstring, size_t>>& streams,
+                                                    const std::wstring& unknownWord = L"", const std::wstring& sentenceBegin = L"", const std::wstring& sentenceEnd = L"");
+
     /// 
     /// Instantiate the CNTK built-in text format minibatch source
     ///
@@ -5395,6 +5646,16 @@ namespace CNTK
         std::unordered_map<StreamInformation, std::pair<NDArrayViewPtr, NDArrayViewPtr>>& computedMeanAndVariances,
         const DeviceDescriptor& device = DeviceDescriptor::CPUDevice());
 
+    ///
+    /// Same as above, with the data partitioned across the workers of the specified communicator: each worker reads its
+    /// partition, and the statistics of all workers are merged, so that each worker gets those of all the data.
+    /// Must be called by all workers.
+    ///
+    CNTK_API void ComputeInputPerDimMeansAndInvStdDevs(const MinibatchSourcePtr& minibatchSource,
+        std::unordered_map<StreamInformation, std::pair<NDArrayViewPtr, NDArrayViewPtr>>& computedMeanAndVariances,
+        const DistributedCommunicatorPtr& communicator,
+        const DeviceDescriptor& device = DeviceDescriptor::CPUDevice());
+
     ///
     /// Set the process-wide setting for maximum number of CPU threads to be used by any individual compute operation
     /// Note that this is a per compute operation limit and if the user performs multiple compute operations concurrently
@@ -5408,6 +5669,18 @@ namespace CNTK
     ///
     CNTK_API size_t GetMaxNumCPUThreads();
 
+    ///
+    /// Sets the process-wide maximum number of CPU threads to be used by the parallel work of the readers (i.e. of the
+    /// minibatch sources), so that the readers and the compute operations (see SetMaxNumCPUThreads) can be given separate
+    /// shares of the cores instead of each using all of them. 0 (the default) does not limit the readers.
+    ///
+    CNTK_API void SetMaxNumReaderThreads(size_t numReaderThreads);
+
+    ///
+    /// Returns the current process-wide setting for maximum number of CPU threads of the readers (0 if not limited)
+    ///
+    CNTK_API size_t GetMaxNumReaderThreads();
+
     struct DistributedWorkerDescriptor
     {
         size_t m_globalRank;
@@ -5529,6 +5802,13 @@ namespace CNTK
     ///
     CNTK_API QuantizedDistributedCommunicatorPtr QuantizedMPICommunicator(bool zeroThresholdFor1Bit, bool useQuantizationForSelfStripe, size_t numQuantizationBits);
 
+    ///
+    /// Distributed communicator for quantized aggregations that pipelines the values: a value is quantized while the
+    /// previous ones are exchanged, and the results are unquantized as they arrive. Values smaller than
+    /// quantizationThresholdSizeInBytes are aggregated without quantization.
+    ///
+    CNTK_API QuantizedDistributedCommunicatorPtr PipelinedQuantizedMPICommunicator(bool zeroThresholdFor1Bit, size_t numQuantizationBits, size_t quantizationThresholdSizeInBytes = 0);
+
     ///
     /// Cross validation configuration
     ///
@@ -5567,12 +5847,18 @@ namespace CNTK
         /// checkpointFrequencyInSamples: frequency in samples when to perform checkpointing.
         /// restoreFromCheckpointIfExists: if flag is set, the training session will try to restore before training.
         /// preserveAllCheckpoints: if flag is set, all checkpoints will be preserved.
+        /// asyncCheckpointing: if flag is set, the checkpoint is written on a background thread, while training continues
+        ///                     (the model and trainer state are copied to host memory before).
+        /// maxPendingCheckpoints: the number of checkpoints that may be being written at a time in async mode;
+        ///                        training waits for the oldest one when another checkpoint is due.
         ///
         CNTK_API CheckpointConfig(
             const std::wstring& checkPointFileName,
             size_t checkpointFrequencyInSamples = std::numeric_limits<size_t>::max(),
             bool restoreFromCheckpointIfExists = true,
-            bool preserveAllCheckpoints = false);
+            bool preserveAllCheckpoints = false,
+            bool asyncCheckpointing = false,
+            size_t maxPendingCheckpoints = 1);
 
     private:
         friend class TrainingSession;
@@ -5580,6 +5866,8 @@ namespace CNTK
         const bool m_restore;
         const bool m_preserveAll;
         const size_t m_frequency;
+        const bool m_async;
+        const size_t m_maxPending;
     };
 
     ///
@@ -5648,7 +5936,7 @@ namespace CNTK
         ///
         CNTK_API void RestoreFromCheckpoint(const std::wstring& checkpointFileName);
 
-        CNTK_API virtual ~TrainingSession() {}
+        CNTK_API virtual ~TrainingSession();
 
     public:
         ///
@@ -5677,7 +5965,8 @@ namespace CNTK
         CNTK_API virtual void OnCheckpointStart(size_t /*checkpointIndex*/) {};
 
         ///
-        /// Optionally overridable callback that is invoked after each checkpoint.
+        /// Optionally overridable callback that is invoked after each checkpoint
+        /// (in async mode, when the checkpoint has been taken, but not necessarily written yet).
         ///
         CNTK_API virtual void OnCheckpointEnd(size_t /*checkpointIndex*/) {};
 
@@ -5716,6 +6005,7 @@ namespace CNTK
         void RestoreFromCheckpoint();
         void SaveCheckpoint(size_t currentIndex);
         void SaveFinalCheckpoint();
+        void WaitForPendingCheckpoints(size_t maxPending = 0);
 
         bool CrossValidate(size_t currentIndex, const DeviceDescriptor& computeDevice);
         void ReportProgress(size_t currentIndex);
@@ -5742,6 +6032,9 @@ namespace CNTK
         CheckpointConfig m_checkpoint;
         CrossValidationConfig m_cv;
         TestConfig m_test;
+
+        // Checkpoints being written in async mode, oldest first.
+        std::vector<std::future<void>> m_pendingCheckpoints;
     };
 
     ///
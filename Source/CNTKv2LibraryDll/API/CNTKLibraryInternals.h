@@ -194,6 +194,9 @@ namespace CNTK
     class MinibatchSource;
     typedef std::shared_ptr<MinibatchSource> MinibatchSourcePtr;
 
+    class StreamingMinibatchSource;
+    typedef std::shared_ptr<StreamingMinibatchSource> StreamingMinibatchSourcePtr;
+
     class DistributedCommunicator;
     typedef std::shared_ptr<DistributedCommunicator> DistributedCommunicatorPtr;
 
@@ -277,11 +280,28 @@ namespace CNTK
 
         CNTK_API void SetGPUMemoryAllocationTraceLevel(int traceLevel);
 
+        // Memory in use on a GPU device, by all processes (0 for the CPU).
+        CNTK_API size_t GetGPUMemoryUsedInMBs(const ::CNTK::DeviceDescriptor& device);
+
         CNTK_API void SetMathLibTraceLevel(int traceLevel);
 
         CNTK_API void ForceDeterministicAlgorithms();
         CNTK_API bool ShouldForceDeterministicAlgorithms();
 
+        // Initialize random Parameters on their device, with a generator whose values do not depend on the device.
+        CNTK_API void SetCounterBasedParameterInitialization(bool enable);
+        CNTK_API bool IsCounterBasedParameterInitializationEnabled();
+
+        // Draw the values of random operations (dropout, random distributions, sampling) from stateless per-Function streams,
+        // which do not need to be computed in sequence.
+        CNTK_API void SetCounterBasedRandomStreams(bool enable);
+        CNTK_API bool IsCounterBasedRandomStreamsEnabled();
+
+        // Multiply parameters with dense inputs whose fraction of nonzeros is below 'density' from a sparse copy of the
+        // inputs. 0 (the default) disables this.
+        CNTK_API void SetSparseProductDensity(double density);
+        CNTK_API double GetSparseProductDensity();
+
         CNTK_API void EnableSynchronousGPUKernelExecution();
         CNTK_API bool IsSynchronousGPUKernelExecutionEnabled();
 
@@ -297,12 +317,31 @@ namespace CNTK
         CNTK_API void EnableGradientAccumulationOptimization();
         CNTK_API void DisableGradientAccumulationOptimization();
 
+        // precompute the subgraphs of a Function that only depend on Constants when compiling it (enabled by default)
+        CNTK_API void EnableConstantFolding();
+        CNTK_API void DisableConstantFolding();
+        CNTK_API bool IsConstantFoldingEnabled();
+
+        // two-level (intra-host, then inter-host) NCCL all-reduce for distributed training across hosts
+        CNTK_API void EnableHierarchicalAllReduce();
+        CNTK_API void DisableHierarchicalAllReduce();
+
         static const uint64_t DefaultProfilerBufferSize = 32 * 1024 * 1024;
-        CNTK_API void StartProfiler(const std::wstring& profilerDir = L"profiler", bool profilerSyncGpu = false, size_t profilerBufferSize = DefaultProfilerBufferSize);
+        CNTK_API void StartProfiler(const std::wstring& profilerDir = L"profiler", bool profilerSyncGpu = false, size_t profilerBufferSize = DefaultProfilerBufferSize, bool profileNodes = false);
         CNTK_API void EnableProfiler();
         CNTK_API void DisableProfiler();
         CNTK_API void StopProfiler();
 
+        // continuous profiling for production jobs: per-interval summaries of the training events, and timeline dumps of the
+        // last seconds on SIGUSR2 or on a slowdown of the minibatch time by slowdownFactor (0: off); independent of StartProfiler()
+        CNTK_API void StartContinuousProfiler(const std::wstring& profilerDir = L"profiler", int summarySeconds = 60, int dumpSeconds = 30, double slowdownFactor = 0);
+        CNTK_API void DumpContinuousProfiler(const std::string& reason);
+        CNTK_API void StopContinuousProfiler();
+
+        // NVTX ranges (shown by nvprof and Nsight Systems) around the nodes and the phases of training; loads nvToolsExt at run time
+        CNTK_API bool EnableNvtxRanges();
+        CNTK_API void DisableNvtxRanges();
+
         CNTK_API bool AreEquivalent(const ::CNTK::FunctionPtr& f1, const ::CNTK::FunctionPtr& f2);
         CNTK_API bool AreEquivalent(const ::CNTK::Variable& v1, const ::CNTK::Variable& v2, bool allowParameterAndConstantsEquivalence = false);
 
@@ -342,6 +381,8 @@ namespace CNTK
         /// TensorBoardFileWriter allows collecting various metrics (e.g. loss/error etc.) as the training progresses,
         /// so that they can be analyzed in TensorBoard.
         /// It also provides an option to serialize the model being trained, so that it can also be visualized.
+        /// Records are serialized on the calling thread and handed over in batches (one per Flush) to a background
+        /// thread that writes them to disk, so that logging does not stall the training loop on file I/O.
         /// The class is NOT thread-safe: it is assumed that only one thread is using each instance.
         ///
         class TensorBoardFileWriter final
@@ -363,7 +404,7 @@ namespace CNTK
             ///
             /// Destruct the TensorBoardFileWriter and close any open files.
             ///
-            CNTK_API ~TensorBoardFileWriter() { Close(); }
+            CNTK_API ~TensorBoardFileWriter();
 
             ///
             /// Record a value of some metric at a particular step.
@@ -373,13 +414,16 @@ namespace CNTK
             CNTK_API void WriteValue(const std::wstring& name, float value, uint64_t step);
 
             ///
-            /// Flushes any outstanding records to disk. Returns true on success, false otherwise.
+            /// Hands any outstanding records over to the background writer, which writes and flushes them to disk.
+            /// Blocks only if the writer is several batches behind. Returns false if there was nothing to flush, or
+            /// if writing an earlier batch has failed (subsequent writes will then open a new file), true otherwise.
             ///
             CNTK_API bool Flush();
 
             ///
-            /// Flushes any outstanding records to disk and closes a currently open underlying file.
-            /// Subsequent calls to WriteValue will open a new file. Returns true on success, false otherwise.
+            /// Flushes any outstanding records to disk, waits for the background writer to finish, and closes
+            /// a currently open underlying file. Subsequent calls to WriteValue will open a new file.
+            /// Returns true on success, false otherwise.
             ///
             CNTK_API bool Close();
 
@@ -388,6 +432,7 @@ namespace CNTK
             void WriteModel();
             void WriteRecord(const std::string& data);
             void WriteVersion(time_t time);
+            bool CheckWriterSucceeded();
 
             // Disable copy-construction and assignment.
             TensorBoardFileWriter(const TensorBoardFileWriter& other) = delete;
@@ -395,8 +440,11 @@ namespace CNTK
 
             const FunctionPtr m_model;
             const std::wstring m_dir;
-            FILE* m_file;
-            std::wstring m_fileName;
+            std::wstring m_fileName;  // the file the records go to; empty until the first record after construction or Close()
+            std::string m_pending;    // the framed records written since the last Flush()
+
+            class EventFileWriter;    // the background thread that owns the file
+            std::unique_ptr<EventFileWriter> m_writer;
         };
 
         // SWIG callback wrapper for the UDF deserialization.
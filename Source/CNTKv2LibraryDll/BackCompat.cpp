@@ -146,7 +146,7 @@ namespace CNTK
                     opType = PrimitiveOpType::Cos;
                 else if (node->OperationName() == OperationNameOf(SinNode))
                     opType = PrimitiveOpType::Sin;
-                else if (node->OperationName() == OperationNameOf(PassNode))
+                else if (node->OperationName() == OperationNameOf(PassNode) || node->OperationName() == OperationNameOf(DeviceTransferNode))
                     opType = PrimitiveOpType::Pass;
                 else if (node->OperationName() == OperationNameOf(LabelsToGraphNode))
                     opType = PrimitiveOpType::LabelsToGraph;
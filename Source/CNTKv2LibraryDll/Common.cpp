@@ -20,6 +20,7 @@
 #include "ProgressTracing.h"
 #include "buildinfo.h"
 #include "Constants.h"
+#include "NcclComm.h"
 
 extern bool g_shareNodeValueMatrices;
 using namespace Microsoft::MSR::CNTK;
@@ -170,7 +171,33 @@ namespace CNTK
             Microsoft::MSR::CNTK::Globals::SetGradientAccumulationOptimization(/* enable = */ false);
         }
 
-        void StartProfiler(const wstring& profilerDir, bool profilerSyncGpu, size_t profilerBufferSize)
+        std::atomic<bool> s_disableConstantFolding(false);
+        void EnableConstantFolding()
+        {
+            s_disableConstantFolding.store(false);
+        }
+
+        void DisableConstantFolding()
+        {
+            s_disableConstantFolding.store(true);
+        }
+
+        bool IsConstantFoldingEnabled()
+        {
+            return !s_disableConstantFolding.load();
+        }
+
+        void EnableHierarchicalAllReduce()
+        {
+            Microsoft::MSR::CNTK::NcclComm::SetHierarchicalAllReduce(/* enable = */ true);
+        }
+
+        void DisableHierarchicalAllReduce()
+        {
+            Microsoft::MSR::CNTK::NcclComm::SetHierarchicalAllReduce(/* enable = */ false);
+        }
+
+        void StartProfiler(const wstring& profilerDir, bool profilerSyncGpu, size_t profilerBufferSize, bool profileNodes)
         {
             std::wstring logSuffix = L"";
             auto mpi = Microsoft::MSR::CNTK::MPIWrapper::GetInstance();
@@ -183,7 +210,8 @@ namespace CNTK
                 profilerDir,
                 profilerBufferSize,
                 logSuffix,
-                profilerSyncGpu);
+                profilerSyncGpu,
+                profileNodes);
         }
 
         void EnableProfiler()
@@ -196,11 +224,43 @@ namespace CNTK
             Microsoft::MSR::CNTK::ProfilerEnable(false);
         }
 
+        bool EnableNvtxRanges()
+        {
+            return Microsoft::MSR::CNTK::ProfilerEnableNvtx(true);
+        }
+
+        void DisableNvtxRanges()
+        {
+            Microsoft::MSR::CNTK::ProfilerEnableNvtx(false);
+        }
+
         void StopProfiler()
         {
             Microsoft::MSR::CNTK::ProfilerClose();
         }
 
+        void StartContinuousProfiler(const wstring& profilerDir, int summarySeconds, int dumpSeconds, double slowdownFactor)
+        {
+            std::wstring logSuffix = L"";
+            auto mpi = Microsoft::MSR::CNTK::MPIWrapper::GetInstance();
+            if (mpi)
+            {
+                logSuffix = std::to_wstring(mpi->CurrentNodeRank());
+            }
+
+            Microsoft::MSR::CNTK::ProfilerContinuousInit(profilerDir, logSuffix, summarySeconds, dumpSeconds, slowdownFactor);
+        }
+
+        void DumpContinuousProfiler(const std::string& reason)
+        {
+            Microsoft::MSR::CNTK::ProfilerContinuousDump(reason.c_str());
+        }
+
+        void StopContinuousProfiler()
+        {
+            Microsoft::MSR::CNTK::ProfilerContinuousClose();
+        }
+
         bool AreEquivalent(const Variable& var1, const Variable& var2, bool allowParameterAndConstantsEquivalence)
         {
             bool areDynamicAxesCompatible = (var1.DynamicAxes().size() == var2.DynamicAxes().size());
@@ -533,6 +593,15 @@ namespace CNTK
             Microsoft::MSR::CNTK::TracingGPUMemoryAllocator::SetTraceLevel(traceLevel);
         }
 
+        size_t GetGPUMemoryUsedInMBs(const DeviceDescriptor& device)
+        {
+            if (device.Type() != DeviceKind::GPU)
+                return 0;
+
+            auto freeAndTotalMemory = Microsoft::MSR::CNTK::TracingGPUMemoryAllocator::GetFreeAndTotalMemoryInMBs(device.Id());
+            return freeAndTotalMemory.second - freeAndTotalMemory.first;
+        }
+
         void SetMathLibTraceLevel(int traceLevel)
         {
             Microsoft::MSR::CNTK::SetMathLibTraceLevel(traceLevel);
@@ -548,6 +617,36 @@ namespace CNTK
             return Microsoft::MSR::CNTK::Globals::ShouldForceDeterministicAlgorithms();
         }
 
+        void SetCounterBasedParameterInitialization(bool enable)
+        {
+            Microsoft::MSR::CNTK::Globals::SetCounterBasedRandomInit(enable);
+        }
+
+        bool IsCounterBasedParameterInitializationEnabled()
+        {
+            return Microsoft::MSR::CNTK::Globals::ShouldUseCounterBasedRandomInit();
+        }
+
+        void SetCounterBasedRandomStreams(bool enable)
+        {
+            Microsoft::MSR::CNTK::Globals::SetCounterBasedRandomStreams(enable);
+        }
+
+        bool IsCounterBasedRandomStreamsEnabled()
+        {
+            return Microsoft::MSR::CNTK::Globals::ShouldUseCounterBasedRandomStreams();
+        }
+
+        void SetSparseProductDensity(double density)
+        {
+            Microsoft::MSR::CNTK::Globals::SetSparseProductDensity(density);
+        }
+
+        double GetSparseProductDensity()
+        {
+            return Microsoft::MSR::CNTK::Globals::GetSparseProductDensity();
+        }
+
         void EnableSynchronousGPUKernelExecution()
         {
             SyncGuard::EnableSync();
@@ -773,6 +872,17 @@ namespace CNTK
         return *result;
     }
 
+    /*static*/ void* UserFunctionKernel::ComputeStream(const DeviceDescriptor& device)
+    {
+#ifndef CPUONLY
+        if (device.Type() == DeviceKind::GPU)
+            return GetStream();
+#else
+        UNUSED(device);
+#endif
+        return nullptr;
+    }
+
     /*static*/ const std::wstring Axis::StaticAxisNamePrefix = L"staticAxisIdx=";
 
     /*static*/ const int Axis::SentinelStaticAxisIndexValueForDynamicAxes = std::numeric_limits<int>::max();
@@ -886,6 +996,16 @@ namespace CNTK
         return Microsoft::MSR::CNTK::CPUMatrix<float>::GetMaxNumThreads();
     }
 
+    void SetMaxNumReaderThreads(size_t numReaderThreads)
+    {
+        Microsoft::MSR::CNTK::Globals::SetNumReaderThreads((int)numReaderThreads);
+    }
+
+    size_t GetMaxNumReaderThreads()
+    {
+        return Microsoft::MSR::CNTK::Globals::GetNumReaderThreads();
+    }
+
     static std::atomic<bool> s_defaultUnitGainValue(true);
 
     bool DefaultUnitGainValue() 
@@ -543,6 +543,180 @@ namespace CNTK
         return computationNodePtr;
     }
 
+    // Deterministic operations without state or side effects, the outputs of which can be precomputed when all inputs are Constants
+    static bool IsFoldablePrimitiveOp(PrimitiveOpType op)
+    {
+        switch (op)
+        {
+        case PrimitiveOpType::Negate:
+        case PrimitiveOpType::Sigmoid:
+        case PrimitiveOpType::StableSigmoid:
+        case PrimitiveOpType::Tanh:
+        case PrimitiveOpType::ReLU:
+        case PrimitiveOpType::ELU:
+        case PrimitiveOpType::Exp:
+        case PrimitiveOpType::Log:
+        case PrimitiveOpType::Sqrt:
+        case PrimitiveOpType::Floor:
+        case PrimitiveOpType::Abs:
+        case PrimitiveOpType::Reciprocal:
+        case PrimitiveOpType::Sin:
+        case PrimitiveOpType::Cos:
+        case PrimitiveOpType::Softmax:
+        case PrimitiveOpType::LogSoftmax:
+        case PrimitiveOpType::Hardmax:
+        case PrimitiveOpType::Plus:
+        case PrimitiveOpType::LogPlus:
+        case PrimitiveOpType::Minus:
+        case PrimitiveOpType::ElementTimes:
+        case PrimitiveOpType::Pow:
+        case PrimitiveOpType::Equal:
+        case PrimitiveOpType::NotEqual:
+        case PrimitiveOpType::Less:
+        case PrimitiveOpType::LessEqual:
+        case PrimitiveOpType::Greater:
+        case PrimitiveOpType::GreaterEqual:
+        case PrimitiveOpType::Clip:
+        case PrimitiveOpType::Select:
+        case PrimitiveOpType::Times:
+        case PrimitiveOpType::TransposeTimes:
+        case PrimitiveOpType::SumAll:
+        case PrimitiveOpType::ReduceElements:
+        case PrimitiveOpType::TransposeAxes:
+        case PrimitiveOpType::Reshape:
+        case PrimitiveOpType::Slice:
+        case PrimitiveOpType::Splice:
+        case PrimitiveOpType::Gather:
+        case PrimitiveOpType::OneHot:
+        case PrimitiveOpType::StopGradient:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Precompute the subgraphs that only depend on Constants (e.g. normalization parameters derived from Constants in a loaded model):
+    // each output of such a subgraph that is used by the rest of the graph (or requested) gets a LearnableParameter node holding its
+    // value, so that the nodes of the subgraph are not part of the network at all. Constants that are assigned to or requested as
+    // outputs are not folded. The timestamps of the folded Constants are recorded, for recompiling the network when they change.
+    template <typename ElementType>
+    /*static*/ void CompositeFunction::FoldConstants(const FunctionPtr& compositeFunction,
+                                                     const std::unordered_set<Variable>& outputs,
+                                                     ComputationNetworkPtr& network,
+                                                     ComputationNetworkBuilder<ElementType>& builder,
+                                                     std::unordered_map<Variable, ComputationNodeBasePtr>& variableToNodeMap,
+                                                     std::unordered_map<Variable, size_t>& foldedConstantTimeStamps)
+    {
+        auto compositeFunctionPtr = dynamic_cast<CompositeFunction*>(compositeFunction.get());
+        if (compositeFunctionPtr && compositeFunctionPtr->m_constantFoldingDisabled)
+            return;
+
+        std::vector<FunctionPtr> functions;
+        std::unordered_set<Variable> refVariables;
+        PreorderTraverseFunctions(compositeFunction->RootFunction(), [&functions, &refVariables](const FunctionPtr& function) {
+            auto primitiveFunction = dynamic_cast<PrimitiveFunction*>(function.get());
+            if (primitiveFunction && (primitiveFunction->OpType() == PrimitiveOpType::Assign))
+                refVariables.insert(primitiveFunction->Inputs()[0]);
+            functions.push_back(function);
+        }, /*nestedSearchInsideBlockFunction =*/ true);
+
+        std::unordered_map<Variable, bool> isVariableFoldableMap;
+        std::function<bool(const Variable&)> IsFoldable;
+        IsFoldable = [&isVariableFoldableMap, &refVariables, &outputs, &IsFoldable](const Variable& var) -> bool {
+            if (var.IsConstant())
+                return (refVariables.find(var) == refVariables.end()) && (outputs.find(var) == outputs.end());
+
+            if (!var.IsOutput())
+                return false;
+
+            auto iter = isVariableFoldableMap.find(var);
+            if (iter != isVariableFoldableMap.end())
+                return iter->second;
+
+            isVariableFoldableMap[var] = false; // (for recurrent graphs)
+            auto primitiveFunction = dynamic_cast<PrimitiveFunction*>(var.Owner().get());
+            bool isFoldable = primitiveFunction && IsFoldablePrimitiveOp(primitiveFunction->OpType()) &&
+                              var.DynamicAxes().empty() && !var.Shape().HasUnboundDimension() && !var.IsSparse() &&
+                              (var.GetDataType() == AsDataType<ElementType>());
+            if (isFoldable)
+            {
+                auto inputs = primitiveFunction->Inputs();
+                isFoldable = std::all_of(inputs.begin(), inputs.end(), IsFoldable);
+            }
+
+            isVariableFoldableMap[var] = isFoldable;
+            return isFoldable;
+        };
+
+        // The outputs of the folded subgraphs are inputs of Functions that cannot be folded themselves, and requested outputs
+        std::vector<Variable> foldedOutputs;
+        std::unordered_set<Variable> foldedOutputsSet;
+        auto AddIfFoldable = [&foldedOutputs, &foldedOutputsSet, &IsFoldable](const Variable& var) {
+            if (var.IsOutput() && IsFoldable(var) && foldedOutputsSet.insert(var).second)
+                foldedOutputs.push_back(var);
+        };
+
+        for (auto& function : functions)
+        {
+            auto primitiveFunction = dynamic_cast<PrimitiveFunction*>(function.get());
+            if (primitiveFunction && IsFoldablePrimitiveOp(primitiveFunction->OpType()) && IsFoldable(function->RawOutputs()[0]))
+                continue;
+
+            for (auto& input : function->Inputs())
+                AddIfFoldable(input);
+        }
+
+        for (auto& output : compositeFunction->RootFunction()->RawOutputs())
+            AddIfFoldable(output);
+
+        for (auto& output : outputs)
+            AddIfFoldable(output);
+
+        if (foldedOutputs.empty())
+            return;
+
+        // Evaluate all folded subgraphs in one go, with a network of their own
+        auto evaluationFunction = Combine(foldedOutputs);
+        dynamic_cast<CompositeFunction*>(evaluationFunction.get())->m_constantFoldingDisabled = true;
+
+        std::unordered_map<Variable, ValuePtr> foldedValues;
+        for (auto& foldedOutput : foldedOutputs)
+            foldedValues[foldedOutput] = nullptr;
+
+        evaluationFunction->Forward(std::unordered_map<Variable, ValuePtr>(), foldedValues, AsDeviceDescriptor(network->GetDeviceId()));
+
+        for (auto& foldedOutput : foldedOutputs)
+        {
+            auto internalNodeName = CNTKInternalNodeNameFromUidAndName(foldedOutput.Uid(), foldedOutput.Name(), /*useMangledNamesForComputationNodes =*/ false);
+            auto computationNodePtr = builder.CreateLearnableParameter(internalNodeName, AsTensorShape(foldedOutput.Shape()));
+            network->InitLearnableParameters(computationNodePtr, L"fixedValue", 0); // must call this to follow protocol; overwritten below
+            computationNodePtr->SetLearningRateMultiplier(0.0);
+
+            auto valueMatrix = foldedValues.at(foldedOutput)->Data()->GetMatrix<ElementType>();
+            Matrix<ElementType> foldedMatrix(network->GetDeviceId());
+            foldedMatrix.SwitchToMatrixType(valueMatrix->GetMatrixType(), valueMatrix->GetFormat(), false);
+            foldedMatrix.AssignValuesOf(*valueMatrix);
+            computationNodePtr->Value() = std::move(foldedMatrix);
+
+            variableToNodeMap[foldedOutput] = computationNodePtr;
+        }
+
+        std::unordered_set<Variable> visitedOutputs;
+        std::function<void(const Variable&)> RecordFoldedConstants;
+        RecordFoldedConstants = [&foldedConstantTimeStamps, &visitedOutputs, &RecordFoldedConstants](const Variable& var) {
+            if (var.IsConstant())
+                foldedConstantTimeStamps[var] = var.CurrentValueTimeStamp();
+            else if (visitedOutputs.insert(var).second)
+            {
+                for (auto& input : var.Owner()->Inputs())
+                    RecordFoldedConstants(input);
+            }
+        };
+
+        for (auto& foldedOutput : foldedOutputs)
+            RecordFoldedConstants(foldedOutput);
+    }
+
     /*static*/ Variable CompositeFunction::GetMappingForNoOpOutput(const Variable& variable, bool recursive)
     {
         Variable mappingVariable = variable;
@@ -558,6 +732,77 @@ namespace CNTK
             return mappingVariable;
     }
 
+    // A Reshape restoring the shape at the beginning of a chain of Reshapes, a TransposeAxes that does not permute any axes,
+    // or one that swaps back the axes swapped by its input, leaves the data as is; returns the Variable holding the same data
+    // (the variable itself if there is none), for using its computation node instead of computing the same data again.
+    /*static*/ Variable CompositeFunction::GetMappingForNoOpReshapeOrTranspose(const Variable& variable)
+    {
+        auto OwnerOpType = [](const Variable& var) -> PrimitiveOpType {
+            auto ownerPrimitiveFunc = var.IsOutput() ? dynamic_cast<PrimitiveFunction*>(var.Owner().get()) : nullptr;
+            return ownerPrimitiveFunc ? ownerPrimitiveFunc->OpType() : PrimitiveOpType::NoOp;
+        };
+
+        if (variable.Shape().HasUnboundDimension())
+            return variable;
+
+        auto opType = OwnerOpType(variable);
+        if (opType == PrimitiveOpType::Reshape)
+        {
+            Variable mappingVariable = variable;
+            Variable source = variable;
+            while (OwnerOpType(source) == PrimitiveOpType::Reshape)
+            {
+                source = source.Owner()->Inputs()[0];
+                if ((source.DynamicAxes() != variable.DynamicAxes()) || (source.GetDataType() != variable.GetDataType()) || (source.IsSparse() != variable.IsSparse()))
+                    break;
+
+                if (source.Shape() == variable.Shape())
+                    mappingVariable = source;
+            }
+
+            return mappingVariable;
+        }
+        else if (opType == PrimitiveOpType::TransposeAxes)
+        {
+            // The axes moved by a TransposeAxes, in ascending order; none for an identity permutation, two for a swap of two axes
+            auto SwappedAxes = [](const Variable& var) -> std::vector<int> {
+                auto rank = var.Shape().Rank();
+                auto& attributes = var.Owner()->Attributes();
+                std::vector<int> swappedAxes;
+                if (attributes.Contains(PrimitiveFunction::AttributeNameAxisVec))
+                {
+                    auto perm = AsVector<Axis>(attributes[PrimitiveFunction::AttributeNameAxisVec].Value<std::vector<DictionaryValue>>());
+                    for (size_t i = 0; i < perm.size(); ++i)
+                    {
+                        if (NormalizeStaticAxis(perm[i], perm.size()).StaticAxisIndex() != (int)i)
+                            swappedAxes.push_back((int)i);
+                    }
+                }
+                else
+                {
+                    auto axis1 = attributes[PrimitiveFunction::AttributeNameAxis1].Value<Axis>();
+                    auto axis2 = attributes[PrimitiveFunction::AttributeNameAxis2].Value<Axis>();
+                    auto axisIndex1 = NormalizeStaticAxis(axis1, rank).StaticAxisIndex();
+                    auto axisIndex2 = NormalizeStaticAxis(axis2, rank).StaticAxisIndex();
+                    if (axisIndex1 != axisIndex2)
+                        swappedAxes = { (std::min)(axisIndex1, axisIndex2), (std::max)(axisIndex1, axisIndex2) };
+                }
+
+                return swappedAxes;
+            };
+
+            auto source = variable.Owner()->Inputs()[0];
+            auto swappedAxes = SwappedAxes(variable);
+            if (swappedAxes.empty())
+                return source;
+
+            if ((swappedAxes.size() == 2) && (OwnerOpType(source) == PrimitiveOpType::TransposeAxes) && !source.Shape().HasUnboundDimension() && (SwappedAxes(source) == swappedAxes))
+                return source.Owner()->Inputs()[0];
+        }
+
+        return variable;
+    }
+
     /*static*/ Variable CompositeFunction::GetMappingVariable(const Variable& variable, bool recursive)
     {
         Variable mappingVariable = variable;
@@ -1101,6 +1346,13 @@ namespace CNTK
             inputNodesBasePtrs = { variableToNodeMap[outputs[0]] };
         }
 
+        // activation recomputation (see ComputationNodeBase::SetValueRecomputedInBackprop())
+        if (primitiveFunction && function->Attributes().Contains(PrimitiveFunction::AttributeNameRecompute))
+            computationNodePtr->SetValueRecomputedInBackprop(function->Attributes()[PrimitiveFunction::AttributeNameRecompute].Value<bool>());
+        // activation offload (see ComputationNodeBase::SetValueOffloadedInBackprop())
+        if (primitiveFunction && function->Attributes().Contains(PrimitiveFunction::AttributeNameOffload))
+            computationNodePtr->SetValueOffloadedInBackprop(function->Attributes()[PrimitiveFunction::AttributeNameOffload].Value<bool>());
+
         network->AddNodeToNetAndAttachInputs(computationNodePtr, inputNodesBasePtrs);
         return computationNodePtr;
     }
@@ -1117,6 +1369,25 @@ namespace CNTK
     {
         assert(variable.IsOutput());
 
+        // Use the node of the data for no-op Reshapes and Transposes; unless that node is pending inputs due to recurrence,
+        // which are attached based on the Function of the variable mapped to it.
+        auto noOpMappingVariable = GetMappingForNoOpReshapeOrTranspose(variable);
+        if (noOpMappingVariable != variable)
+        {
+            auto noOpMappingNode = GetNode(noOpMappingVariable, network, builder, fullyDefinedArgumentsMap, variableToNodeMap, isVariableRootMap, inputsToExcludeGradientsFor, useMangledNamesForComputationNodes);
+            if (noOpMappingNode)
+            {
+                auto& noOpMappingNodeInputs = noOpMappingNode->GetInputs();
+                if (std::find(noOpMappingNodeInputs.begin(), noOpMappingNodeInputs.end(), nullptr) == noOpMappingNodeInputs.end())
+                {
+                    // The node is not a root of the network for the variable, so the variable needs to be an explicit output of it
+                    isVariableRootMap[noOpMappingVariable] = false;
+                    isVariableRootMap[variable] = false;
+                    return noOpMappingNode;
+                }
+            }
+        }
+
         Function* function = variable.Owner().get();
         ComputationNodeBasePtr computationNodePtr;
         auto& functionInputs = function->m_inputs;
@@ -1212,7 +1483,8 @@ namespace CNTK
                                                     const std::unordered_set<Variable>& outputs,
                                                     const std::unordered_map<Variable, Variable>& fullyDefinedArgumentsMap,
                                                     const std::unordered_set<Variable>& inputsExcludedFromGradientComputation,
-                                                    bool useMangledNamesForComputationNodes)
+                                                    bool useMangledNamesForComputationNodes,
+                                                    std::unordered_map<Variable, size_t>* foldedConstantTimeStamps)
     {
         auto computationNetwork = std::make_shared<ComputationNetwork>(AsCNTKImplDeviceId(device));
         ComputationNetworkBuilder<ElementType> builder(*computationNetwork);
@@ -1220,6 +1492,10 @@ namespace CNTK
         std::unordered_map<Variable, bool> isVariableRootMap;
         std::unordered_map<Variable, ComputationNodeBasePtr> variableToNodeMap;
 
+        // The nodes of precomputed subgraphs are created upfront, so that the traversal below stops at them
+        if (foldedConstantTimeStamps)
+            FoldConstants(compositeFunction, outputs, computationNetwork, builder, variableToNodeMap, *foldedConstantTimeStamps);
+
         // Now recursively create the network in a top-down fashion
         auto rootFunction = compositeFunction->RootFunction();
         auto rootFunctionOutputs = rootFunction->RawOutputs();
@@ -1349,28 +1625,13 @@ namespace CNTK
                                                                    const std::unordered_set<Variable>& inputsToExcludeGradientsFor,
                                                                    bool allocateNetworkMatrices)
     {
-        // Lets purge the current computation network and regenerate the network if the CompositeFunction
-        // was previously compiled just for evaluation and not for gradient backpropagation.
-        if ((m_computationNetwork != nullptr) && (m_currentBackpropRoots.empty() && !backpropRoots.empty()))
-            PurgeComputationNetwork();
+        // Switch to a (cached or new) computation network if the current one was compiled for a different device,
+        // different backprop roots (e.g. just for evaluation and not for gradient backpropagation) or outputs.
+        if ((m_computationNetwork != nullptr) && !CanReuseComputationNetwork(device, backpropRoots, outputs, inputsToExcludeGradientsFor))
+            SwitchComputationNetwork(device, backpropRoots, outputs, inputsToExcludeGradientsFor);
 
         if (m_computationNetwork != nullptr)
         {
-            // TODO: We should either invalidate and readapt the network if the backpropRoots change compared to what was specified when the network
-            // was last constructed, to just recreate a new network.
-            // For now just disallow changing the backpropRoots after the network is created
-            if (!backpropRoots.empty() && (m_currentBackpropRoots != backpropRoots))
-                LogicError("Function '%S': Changing backprop roots (Current = '%S', New = '%S') across different Forward calls on a CNTK composite Function is currently unsupported.",
-                            AsString().c_str(), NamedListString(m_currentBackpropRoots).c_str(), NamedListString(backpropRoots).c_str());
-
-            // TODO: Support changing the device across different invocations of the forward method on a Function instance
-            if (AsDeviceDescriptor(m_computationNetwork->GetDeviceId()) != device)
-                LogicError("Function '%S': Changing device (Current = '%S', New = %S') across different Forward calls on a CNTK composite Function is currently unsupported.",
-                            AsString().c_str(), AsDeviceDescriptor(m_computationNetwork->GetDeviceId()).AsString().c_str(), device.AsString().c_str());
-            
-            if (!backpropRoots.empty() && (inputsToExcludeGradientsFor != m_inputsExcludedFromGradientComputation))
-                LogicError("Function '%S': Changing the set of inputs to exclude from gradient computation, across different Forward calls on a CNTK composite Function, is currently unsupported.", AsString().c_str());
-
             // Verify if the free dimensions of any of the arguments have changed, and if so, update the corresponding
             // input ComputationNodes and rerun validation on the computation network
             for (auto freeDimensionArgumentMapping : m_fullyDefinedArgumentsMap)
@@ -1424,7 +1685,9 @@ namespace CNTK
             // internal computation network
             ValidateOrUpdateOutputs();
 
-            std::tie(m_computationNetwork, m_variableToNodeMap) = CreateComputationNetwork<ElementType>(this->shared_from_this(), device, outputs, m_fullyDefinedArgumentsMap, m_inputsExcludedFromGradientComputation, /*useMangledNamesForComputationNodes =*/ false);
+            assert(m_foldedConstantTimeStamps.empty());
+            auto foldedConstantTimeStamps = (!m_constantFoldingDisabled && Internal::IsConstantFoldingEnabled()) ? &m_foldedConstantTimeStamps : nullptr;
+            std::tie(m_computationNetwork, m_variableToNodeMap) = CreateComputationNetwork<ElementType>(this->shared_from_this(), device, outputs, m_fullyDefinedArgumentsMap, m_inputsExcludedFromGradientComputation, /*useMangledNamesForComputationNodes =*/ false, foldedConstantTimeStamps);
 
             // Record the timestamps of Parameters and Constants
             assert(m_lastRecordedTimeStamps.empty());
@@ -1466,20 +1729,75 @@ namespace CNTK
             m_computationNetwork->AllocateAllMatrices(forwardRootNodes, forwardOutputNodes, backpropRootNode);
             m_networkMatricesAllocated = allocateNetworkMatrices;
         }
-        else
+
+        return m_computationNetwork;
+    }
+
+    // The current computation network can be used if it lives on the device, was compiled for the backprop roots (any network
+    // can be used for evaluation only), has its matrices allocated for all requested outputs, and its precomputed values are current.
+    bool CompositeFunction::CanReuseComputationNetwork(const DeviceDescriptor& device,
+                                                       const std::unordered_set<Variable>& backpropRoots,
+                                                       const std::unordered_set<Variable>& outputs,
+                                                       const std::unordered_set<Variable>& inputsToExcludeGradientsFor) const
+    {
+        if (AsDeviceDescriptor(m_computationNetwork->GetDeviceId()) != device)
+            return false;
+
+        if (HasOutdatedFoldedConstants())
+            return false;
+
+        if (!backpropRoots.empty() && ((m_currentBackpropRoots != backpropRoots) || (inputsToExcludeGradientsFor != m_inputsExcludedFromGradientComputation)))
+            return false;
+
+        if (m_networkMatricesAllocated)
         {
-            // Make sure the outputs requested are a subset of the outputs we setup the current matrix allocation structure
-            // in the cached computation network
             for (auto output : outputs)
             {
                 if (m_allNetworkRoots.find(output) == m_allNetworkRoots.end())
-                    LogicError("Function '%S': Requested output '%S' is not part of the list of outputs '%S' that the Function was initially compiled for. "
-                                "Changing requested outputs across different Forward calls is currently unsupported.",
-                                AsString().c_str(), output.AsString().c_str(), NamedListString(m_allNetworkRoots).c_str());
+                    return false;
             }
         }
 
-        return m_computationNetwork;
+        return true;
+    }
+
+    // Moves the current computation network into the cache, and makes a cached one current that can be reused for the request;
+    // if there is none, no network is current afterwards, and the caller compiles a new one.
+    void CompositeFunction::SwitchComputationNetwork(const DeviceDescriptor& device,
+                                                     const std::unordered_set<Variable>& backpropRoots,
+                                                     const std::unordered_set<Variable>& outputs,
+                                                     const std::unordered_set<Variable>& inputsToExcludeGradientsFor)
+    {
+        // The state of stateful Functions (e.g. the random number generators of Dropout) lives in the nodes; carry it over.
+        auto internalState = GetInternalState();
+
+        // Output values handed out so far refer to the matrices of the current network
+        ClearExistingOutputOrGradientStorageReferences();
+
+        // A network with outdated precomputed values is of no further use
+        bool keepPrevious = !HasOutdatedFoldedConstants();
+        CachedComputationNetwork previous;
+        SwapComputationNetwork(previous);
+
+        for (auto iter = m_cachedComputationNetworks.begin(); iter != m_cachedComputationNetworks.end(); ++iter)
+        {
+            SwapComputationNetwork(*iter);
+            if (CanReuseComputationNetwork(device, backpropRoots, outputs, inputsToExcludeGradientsFor))
+            {
+                m_cachedComputationNetworks.erase(iter); // (now empty)
+                break;
+            }
+            SwapComputationNetwork(*iter);
+        }
+
+        if (keepPrevious)
+            m_cachedComputationNetworks.push_back(std::move(previous));
+
+        if (m_cachedComputationNetworks.size() > s_maxCachedComputationNetworks)
+            m_cachedComputationNetworks.erase(m_cachedComputationNetworks.begin());
+
+        if (m_computationNetwork != nullptr)
+            SetInternalState(internalState);
     }
 
     template <typename ElementType>
@@ -1757,7 +2075,8 @@ namespace CNTK
                                                             std::unordered_map<Variable, ValuePtr>& outputs,
                                                             const DeviceDescriptor& computeDevice,
                                                             const std::unordered_set<Variable>& outputsToRetainBackwardStateFor,
-                                                            const std::unordered_set<Variable>& inputsToExcludeGradientsFor)
+                                                            const std::unordered_set<Variable>& inputsToExcludeGradientsFor,
+                                                            const std::vector<size_t>* sequenceIds)
     {
         // Validate arguments and outputs
         if (outputs.empty())
@@ -1841,7 +2160,11 @@ namespace CNTK
             if (newTimeStamp > prevTimeStamp)
             {
                 timeStampRecord.second = newTimeStamp;
-                m_variableToNodeMap.at(variable)->BumpEvalTimeStamp();
+
+                // (Constants only used by precomputed subgraphs have no node; the network is recompiled when they change)
+                auto nodeIter = m_variableToNodeMap.find(variable);
+                if (nodeIter != m_variableToNodeMap.end())
+                    nodeIter->second->BumpEvalTimeStamp();
             }
         }
 
@@ -1856,6 +2179,14 @@ namespace CNTK
                 outputsToEvaluate.push_back(m_variableToNodeMap.at(rootVarForBackprop));
         }
 
+        if (sequenceIds)
+        {
+            if (dataType == DataType::Float)
+                ImportSequenceStates<float>(*sequenceIds, requiredArgumentValues, outputsToEvaluate);
+            else
+                ImportSequenceStates<double>(*sequenceIds, requiredArgumentValues, outputsToEvaluate);
+        }
+
         // Reset the timestamps of all backward roots to record an update in one or more inputs
         for (auto& backpropRoot : m_currentBackpropRoots)
             m_variableToNodeMap.at(backpropRoot)->SetEvalTimeStampOutdatedWrtAll();
@@ -1872,6 +2203,14 @@ namespace CNTK
 
         m_computationNetwork->ForwardProp(outputsToEvaluate);
 
+        if (sequenceIds)
+        {
+            if (dataType == DataType::Float)
+                ExportSequenceStates<float>(*sequenceIds);
+            else
+                ExportSequenceStates<double>(*sequenceIds);
+        }
+
         // Call PostForwardAndBackProp after ForwardProp only in evaluation mode.
         if (outputsToRetainBackwardStateFor.empty())
         {
@@ -1894,6 +2233,187 @@ namespace CNTK
         return backpropStatePtr;
     }
 
+    // The sequences of a ForwardSequences() call are evaluated as the parallel sequences of one minibatch, laid out as in Forward().
+    // A continued sequence begins before the minibatch, and the frame before the minibatch is imported into the PastValue nodes from
+    // the sequence's column of m_sequenceStates; after the forward pass, that column is set to the value of the sequence's last step.
+    template <typename ElementType>
+    void CompositeFunction::ImportSequenceStates(const std::vector<size_t>& sequenceIds, const std::unordered_map<Variable, ValuePtr>& arguments, const std::vector<ComputationNodeBasePtr>& outputsToEvaluate)
+    {
+        auto& sequenceStates = m_sequenceStates;
+        if ((sequenceStates.computationNetwork != m_computationNetwork) || (sequenceStates.outputsToEvaluate != outputsToEvaluate))
+        {
+            if (!sequenceStates.slots.empty())
+                InvalidArgument("Function '%S' ForwardSequences: The requested outputs or the device differ from the earlier calls for the %d sequences that have not been ended.",
+                                AsString().c_str(), (int)sequenceStates.slots.size());
+
+            // collect the nodes that carry the state of a sequence from one call to the next
+            sequenceStates = SequenceStates();
+            sequenceStates.computationNetwork = m_computationNetwork;
+            sequenceStates.outputsToEvaluate = outputsToEvaluate;
+            std::unordered_set<ComputationNodeBasePtr> visited;
+            for (auto& outputNode : outputsToEvaluate)
+            {
+                for (auto& node : m_computationNetwork->GetAllNodesForRoot(outputNode))
+                {
+                    if (!visited.insert(node).second || !std::dynamic_pointer_cast<IStatefulNode>(node))
+                        continue;
+
+                    auto pastValueNode = std::dynamic_pointer_cast<PastValueNode<ElementType>>(node);
+                    if (!pastValueNode || (pastValueNode->TimeStep() != 1))
+                        InvalidArgument("Function '%S' ForwardSequences: %S %S operation is not supported, only PastValue with an offset of 1 can carry the state of a sequence across calls.",
+                                        AsString().c_str(), node->NodeName().c_str(), node->OperationName().c_str());
+
+                    sequenceStates.nodes.push_back(node);
+                    sequenceStates.states.push_back(std::make_shared<Matrix<ElementType>>(node->GetSampleLayout().GetNumElements(), 0, node->GetDeviceId()));
+                }
+            }
+        }
+
+        if (std::unordered_set<size_t>(sequenceIds.begin(), sequenceIds.end()).size() != sequenceIds.size())
+            InvalidArgument("Function '%S' ForwardSequences: The sequence ids must be distinct.", AsString().c_str());
+
+        // determine from the layouts of the arguments which sequences continue
+        std::unordered_set<MBLayoutPtr> argumentLayouts;
+        for (auto& argumentValuePair : arguments)
+        {
+            auto& layout = m_variableToNodeMap.at(argumentValuePair.first)->GetMBLayout();
+            if (layout)
+                argumentLayouts.insert(layout);
+        }
+
+        std::vector<int> isContinued(sequenceIds.size(), -1);
+        for (auto& layout : argumentLayouts)
+        {
+            if (layout->GetNumSequences() != sequenceIds.size())
+                InvalidArgument("Function '%S' ForwardSequences: %d sequence ids were specified for arguments with %d sequences.",
+                                AsString().c_str(), (int)sequenceIds.size(), (int)layout->GetNumSequences());
+
+            for (auto& sequence : layout->GetAllSequences())
+            {
+                if (sequence.seqId == GAP_SEQUENCE_ID)
+                    continue;
+
+                if (sequence.seqId >= sequenceIds.size())
+                    InvalidArgument("Function '%S' ForwardSequences: The arguments have a sequence with index %d, but there are only %d sequence ids.",
+                                    AsString().c_str(), (int)sequence.seqId, (int)sequenceIds.size());
+
+                int continued = (sequence.tBegin < 0) ? 1 : 0;
+                if ((isContinued[sequence.seqId] >= 0) && (isContinued[sequence.seqId] != continued))
+                    InvalidArgument("Function '%S' ForwardSequences: The sequence start flags of sequence %d differ between the arguments.", AsString().c_str(), (int)sequence.seqId);
+
+                isContinued[sequence.seqId] = continued;
+            }
+        }
+
+        // assign the state columns; new sequences get a free one
+        for (size_t i = 0; i < sequenceIds.size(); ++i)
+        {
+            auto iter = sequenceStates.slots.find(sequenceIds[i]);
+            if (iter != sequenceStates.slots.end())
+                continue;
+
+            if (isContinued[i] > 0)
+                InvalidArgument("Function '%S' ForwardSequences: Sequence %d continues the sequence with id %d (it has no sequence start flag), but no such sequence has been evaluated yet.",
+                                AsString().c_str(), (int)i, (int)sequenceIds[i]);
+
+            size_t slot;
+            if (!sequenceStates.freeSlots.empty())
+            {
+                slot = sequenceStates.freeSlots.back();
+                sequenceStates.freeSlots.pop_back();
+            }
+            else
+                slot = sequenceStates.numSlots++;
+
+            sequenceStates.slots.insert({ sequenceIds[i], slot });
+        }
+
+        for (auto& states : sequenceStates.states)
+        {
+            auto& matrix = static_cast<Matrix<ElementType>&>(*states);
+            size_t capacity = matrix.GetNumCols();
+            if (capacity >= sequenceStates.numSlots)
+                continue;
+
+            auto grown = std::make_shared<Matrix<ElementType>>(matrix.GetNumRows(), std::max(2 * capacity, sequenceStates.numSlots), matrix.GetDeviceId());
+            grown->SetValue(0);
+            if (capacity > 0)
+                grown->SetColumnSlice(matrix, 0, capacity);
+
+            states = grown;
+        }
+
+        // import the state of the continued sequences into the frame before the minibatch
+        for (size_t k = 0; k < sequenceStates.nodes.size(); ++k)
+        {
+            auto& node = sequenceStates.nodes[k];
+            auto& layout = node->GetMBLayout();
+            if (argumentLayouts.find(layout) == argumentLayouts.end())
+                InvalidArgument("Function '%S' ForwardSequences: %S %S operation is not supported, as it does not operate on the sequence axis of an argument.",
+                                AsString().c_str(), node->NodeName().c_str(), node->OperationName().c_str());
+
+            size_t numParallelSequences = layout->GetNumParallelSequences();
+            auto delayedLayout = std::make_shared<MBLayout>();
+            delayedLayout->Init(numParallelSequences, 1);
+            std::vector<ElementType> streamColumns(numParallelSequences, 0);
+            std::vector<bool> hasContinuedSequence(numParallelSequences, false);
+            for (auto& sequence : layout->GetAllSequences())
+            {
+                if ((sequence.seqId == GAP_SEQUENCE_ID) || (sequence.tBegin >= 0))
+                    continue;
+
+                delayedLayout->AddSequence(sequence.seqId, sequence.s, -1, 1);
+                streamColumns[sequence.s] = (ElementType)sequenceStates.slots.at(sequenceIds[sequence.seqId]);
+                hasContinuedSequence[sequence.s] = true;
+            }
+
+            for (size_t s = 0; s < numParallelSequences; ++s)
+            {
+                if (!hasContinuedSequence[s])
+                    delayedLayout->AddGap(s, 0, 1);
+            }
+
+            Matrix<ElementType> streamColumnsMatrix(1, numParallelSequences, streamColumns.data(), node->GetDeviceId());
+            std::static_pointer_cast<PastValueNode<ElementType>>(node)->ImportStreamStates(static_cast<Matrix<ElementType>&>(*sequenceStates.states[k]), streamColumnsMatrix, delayedLayout);
+        }
+    }
+
+    template <typename ElementType>
+    void CompositeFunction::ExportSequenceStates(const std::vector<size_t>& sequenceIds)
+    {
+        auto& sequenceStates = m_sequenceStates;
+        for (size_t k = 0; k < sequenceStates.nodes.size(); ++k)
+        {
+            auto& node = sequenceStates.nodes[k];
+            auto& states = static_cast<Matrix<ElementType>&>(*sequenceStates.states[k]);
+            auto& layout = node->GetMBLayout();
+
+            // keep the last step of each sequence; the columns of the other slots are left untouched
+            std::vector<ElementType> frameColumns(states.GetNumCols(), (ElementType)-1);
+            for (auto& sequence : layout->GetAllSequences())
+            {
+                if (sequence.seqId == GAP_SEQUENCE_ID)
+                    continue;
+
+                size_t tEnd = std::min(sequence.tEnd, layout->GetNumTimeSteps());
+                frameColumns[sequenceStates.slots.at(sequenceIds[sequence.seqId])] = (ElementType)((tEnd - 1) * layout->GetNumParallelSequences() + sequence.s);
+            }
+
+            Matrix<ElementType> frameColumnsMatrix(1, frameColumns.size(), frameColumns.data(), node->GetDeviceId());
+            std::static_pointer_cast<PastValueNode<ElementType>>(node)->ExportStreamStates(states, frameColumnsMatrix);
+        }
+    }
+
+    void CompositeFunction::EndSequence(size_t sequenceId)
+    {
+        auto iter = m_sequenceStates.slots.find(sequenceId);
+        if (iter == m_sequenceStates.slots.end())
+            return;
+
+        m_sequenceStates.freeSlots.push_back(iter->second);
+        m_sequenceStates.slots.erase(iter);
+    }
+
     /*virtual*/ void CompositeFunction::Backward(const BackPropStatePtr& state,
                                                  const std::unordered_map<Variable, ValuePtr>& rootGradientValues,
                                                  std::unordered_map<Variable, ValuePtr>& backPropagatedGradientValuesForInputs)
@@ -55,6 +55,7 @@ namespace CNTK
 
         friend void ComputeInputPerDimMeansAndInvStdDevs(const MinibatchSourcePtr& minibatchSource,
                                                          std::unordered_map<StreamInformation, std::pair<NDArrayViewPtr, NDArrayViewPtr>>& computedMeanAndInvStdDevs,
+                                                         const DistributedCommunicatorPtr& communicator,
                                                          const DeviceDescriptor& device /*= DeviceDescriptor::CPUDevice()*/);
 
         static std::atomic<unsigned int> s_nextAutoGeneratedDynamicAxis;
@@ -88,7 +89,10 @@ namespace CNTK
                                  std::unordered_map<Variable, ValuePtr>& outputs,
                                  const DeviceDescriptor& computeDevice,
                                  const std::unordered_set<Variable>& outputsToRetainBackwardStateFor,
-                                 const std::unordered_set<Variable>& inputsToExcludeGradientsFor);
+                                 const std::unordered_set<Variable>& inputsToExcludeGradientsFor,
+                                 const std::vector<size_t>* sequenceIds = nullptr); // (see Function::ForwardSequences())
+
+        void EndSequence(size_t sequenceId);
 
         virtual BackPropStatePtr Forward(const std::vector<ValuePtr>& /*inputValues*/,
                                          std::unordered_map<Variable, ValuePtr>& /*outputs*/,
@@ -187,7 +191,8 @@ namespace CNTK
                                      const std::unordered_set<Variable>& networkOutputs,
                                      const std::unordered_map<Variable, Variable>& fullyDefinedArgumentsMap,
                                      const std::unordered_set<Variable>& inputsExcludedFromGradientComputation,
-                                     bool useMangledNamesForComputationNodes);
+                                     bool useMangledNamesForComputationNodes,
+                                     std::unordered_map<Variable, size_t>* foldedConstantTimeStamps = nullptr);
 
     private:
         // Replace any PlaceHolder Variables in the graph of Functions underlying 'this' CompositeFunction. All PlaceHolder variables
@@ -214,7 +219,7 @@ namespace CNTK
 
         CompositeFunction(const FunctionPtr& rootFunction, std::unordered_set<FunctionPtr>&& allPrimitiveFunctions, const std::wstring& name, const std::wstring& uid = Internal::GenerateUid(L"CompositeFunction"))
             : Function({}, Dictionary(), rootFunction, name, uid),
-            m_allPrimitiveFunctions(std::move(allPrimitiveFunctions)), m_networkMatricesAllocated(false)
+            m_allPrimitiveFunctions(std::move(allPrimitiveFunctions)), m_networkMatricesAllocated(false), m_constantFoldingDisabled(false)
         {}
 
         std::vector<Variable> DetermineInputs(bool pythonOperandOrder = false) const
@@ -272,6 +277,7 @@ namespace CNTK
         static void RestoreStatefulFunctions(size_t version, const Dictionary& dict, std::unordered_set<FunctionPtr> PrimitiveFunctions);
 
         static Variable GetMappingForNoOpOutput(const Variable& variable, bool recursive = false);
+        static Variable GetMappingForNoOpReshapeOrTranspose(const Variable& variable);
         static Variable GetMappingVariable(const Variable& variable, bool recursive = false);
 
         std::unordered_map<Variable, NDShape> InferFreeDimensionsOfArguments(const std::unordered_map<Variable, ValuePtr>& arguments);
@@ -310,6 +316,14 @@ namespace CNTK
                                                                     const std::unordered_set<Variable>& inputsToExcludeGradientsFor,
                                                                     bool useMangledNamesForComputationNodes);
 
+        template <typename ElementType>
+        static void FoldConstants(const FunctionPtr& compositeFunction,
+                                  const std::unordered_set<Variable>& outputs,
+                                  Microsoft::MSR::CNTK::ComputationNetworkPtr& network,
+                                  Microsoft::MSR::CNTK::ComputationNetworkBuilder<ElementType>& builder,
+                                  std::unordered_map<Variable, Microsoft::MSR::CNTK::ComputationNodeBasePtr>& variableToNodeMap,
+                                  std::unordered_map<Variable, size_t>& foldedConstantTimeStamps);
+
         template <typename ElementType>
         static void PopulateComputationNodeValue(const std::pair<Variable, ValuePtr>& variableValue, Microsoft::MSR::CNTK::ComputationNodeBasePtr& computationNode, std::unordered_map< Microsoft::MSR::CNTK::MBLayoutPtr, Variable>& layoutsPopulated);
         void PopulateNetworkInputs(const std::unordered_map<Variable, ValuePtr>& arguments);
@@ -341,18 +355,61 @@ namespace CNTK
             m_existingNetworkStorageReferences.clear();
         }
 
-        void PurgeComputationNetwork()
+        // The state of a compiled computation network (see m_cachedComputationNetworks)
+        struct CachedComputationNetwork
+        {
+            Microsoft::MSR::CNTK::ComputationNetworkPtr computationNetwork;
+            std::unordered_map<Variable, Microsoft::MSR::CNTK::ComputationNodeBasePtr> variableToNodeMap;
+            std::unordered_set<Variable> currentBackpropRoots;
+            std::vector<Microsoft::MSR::CNTK::ComputationNodeBasePtr> currentOutputsToEvaluate;
+            bool networkMatricesAllocated = false;
+            std::unordered_set<Variable> allNetworkRoots;
+            std::unordered_map<Variable, size_t> lastRecordedTimeStamps;
+            std::unordered_set<Variable> inputsExcludedFromGradientComputation;
+            std::unordered_map<Variable, size_t> foldedConstantTimeStamps;
+        };
+
+        void SwapComputationNetwork(CachedComputationNetwork& other)
+        {
+            std::swap(m_computationNetwork, other.computationNetwork);
+            std::swap(m_variableToNodeMap, other.variableToNodeMap);
+            std::swap(m_currentBackpropRoots, other.currentBackpropRoots);
+            std::swap(m_currentOutputsToEvaluate, other.currentOutputsToEvaluate);
+            std::swap(m_networkMatricesAllocated, other.networkMatricesAllocated);
+            std::swap(m_allNetworkRoots, other.allNetworkRoots);
+            std::swap(m_lastRecordedTimeStamps, other.lastRecordedTimeStamps);
+            std::swap(m_inputsExcludedFromGradientComputation, other.inputsExcludedFromGradientComputation);
+            std::swap(m_foldedConstantTimeStamps, other.foldedConstantTimeStamps);
+        }
+
+        // The values of the Constants folded into the current computation network have changed since it was compiled
+        bool HasOutdatedFoldedConstants() const
         {
-            m_currentBackpropRoots.clear();
-            m_inputsExcludedFromGradientComputation.clear();
-            m_variableToNodeMap.clear();
-            m_currentOutputsToEvaluate.clear();
-            m_lastRecordedTimeStamps.clear();
-
-            m_networkMatricesAllocated = false;
-            m_computationNetwork = nullptr;
+            for (auto& foldedConstantTimeStamp : m_foldedConstantTimeStamps)
+            {
+                if (foldedConstantTimeStamp.first.CurrentValueTimeStamp() != foldedConstantTimeStamp.second)
+                    return true;
+            }
+
+            return false;
         }
 
+        bool CanReuseComputationNetwork(const DeviceDescriptor& device,
+                                        const std::unordered_set<Variable>& backpropRoots,
+                                        const std::unordered_set<Variable>& outputs,
+                                        const std::unordered_set<Variable>& inputsToExcludeGradientsFor) const;
+
+        void SwitchComputationNetwork(const DeviceDescriptor& device,
+                                      const std::unordered_set<Variable>& backpropRoots,
+                                      const std::unordered_set<Variable>& outputs,
+                                      const std::unordered_set<Variable>& inputsToExcludeGradientsFor);
+
+        // incremental evaluation of sequences (see Function::ForwardSequences())
+        template <typename ElementType>
+        void ImportSequenceStates(const std::vector<size_t>& sequenceIds, const std::unordered_map<Variable, ValuePtr>& arguments, const std::vector<Microsoft::MSR::CNTK::ComputationNodeBasePtr>& outputsToEvaluate);
+        template <typename ElementType>
+        void ExportSequenceStates(const std::vector<size_t>& sequenceIds);
+
         void RecordRefVariableUpdates()
         {
             for (auto refVar : m_refVariables)
@@ -399,6 +456,32 @@ namespace CNTK
 
         std::unordered_set<Variable> m_inputsExcludedFromGradientComputation;
 
+        // The Constants whose values were precomputed into the current computation network, and their timestamps at the time
+        std::unordered_map<Variable, size_t> m_foldedConstantTimeStamps;
+
+        // Set for the Functions that evaluate the folded subgraphs themselves
+        bool m_constantFoldingDisabled;
+
+        // Computation networks compiled earlier for other combinations of device, backprop roots, requested outputs and inputs
+        // excluded from gradient computation, least recently used first, so that alternating between them (e.g. evaluating
+        // other outputs in between training steps) does not recompile the network every time. The Parameters are shared.
+        std::vector<CachedComputationNetwork> m_cachedComputationNetworks;
+        static const size_t s_maxCachedComputationNetworks = 4;
+
+        // The state of the sequences evaluated with ForwardSequences(): for every PastValue node, the value of the last step of each
+        // sequence, as one column per sequence slot. It belongs to the network and requested outputs of the first call for the sequences.
+        struct SequenceStates
+        {
+            Microsoft::MSR::CNTK::ComputationNetworkPtr computationNetwork;
+            std::vector<Microsoft::MSR::CNTK::ComputationNodeBasePtr> outputsToEvaluate;
+            std::vector<Microsoft::MSR::CNTK::ComputationNodeBasePtr> nodes;
+            std::vector<std::shared_ptr<Microsoft::MSR::CNTK::MatrixBase>> states;
+            std::unordered_map<size_t, size_t> slots; // by sequence id
+            std::vector<size_t> freeSlots;
+            size_t numSlots = 0;
+        };
+        SequenceStates m_sequenceStates;
+
         // Version history:
         // 1 -- initial version.
         // 2 -- add support for stateful functions (with corresponding nodes inheriting from RngUser).
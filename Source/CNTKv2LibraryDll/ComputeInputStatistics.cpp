@@ -9,6 +9,7 @@
 #include "CompositeFunction.h"
 #include <tuple>
 #include "ComputationNetworkBuilder.h"
+#include "PreComputeNodes.h"
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -17,6 +18,14 @@ namespace CNTK
     void ComputeInputPerDimMeansAndInvStdDevs(const MinibatchSourcePtr& minibatchSource,
                                               std::unordered_map<StreamInformation, std::pair<NDArrayViewPtr, NDArrayViewPtr>>& computedMeanAndInvStdDevs,
                                               const DeviceDescriptor& device /*= DeviceDescriptor::CPUDevice()*/)
+    {
+        ComputeInputPerDimMeansAndInvStdDevs(minibatchSource, computedMeanAndInvStdDevs, nullptr, device);
+    }
+
+    void ComputeInputPerDimMeansAndInvStdDevs(const MinibatchSourcePtr& minibatchSource,
+                                              std::unordered_map<StreamInformation, std::pair<NDArrayViewPtr, NDArrayViewPtr>>& computedMeanAndInvStdDevs,
+                                              const DistributedCommunicatorPtr& communicator,
+                                              const DeviceDescriptor& device /*= DeviceDescriptor::CPUDevice()*/)
     {
         typedef std::shared_ptr<ComputationNode<float>> ComputationNodePtr;
         const auto& minibatchSourceStreams = minibatchSource->StreamInfos();
@@ -80,9 +89,11 @@ namespace CNTK
         std::unordered_map<MBLayoutPtr, Variable> layoutsPopulated;
         const size_t maxMinibatchDataSize = (1 << 27); // 128 MB
         const size_t minibatchSize = maxMinibatchDataSize / totalSizePerSample;
+        const size_t numWorkers = communicator ? communicator->Workers().size() : 1;
+        const size_t workerRank = communicator ? communicator->CurrentWorker().m_globalRank : 0;
         for (;;)
         {
-            auto minibatchData = minibatchSource->GetNextMinibatch(minibatchSize, device);
+            auto minibatchData = minibatchSource->GetNextMinibatch(/*minibatchSizeInSequences=*/0, minibatchSize, numWorkers, workerRank, device);
             if (minibatchData.empty())
                 break;
 
@@ -94,6 +105,18 @@ namespace CNTK
             computationNetwork->ForwardProp(preComputeNodes);
         }
 
+        // merge the statistics of the partitions of all workers
+        if (numWorkers > 1)
+        {
+            AggregatePreComputedStatistics<float>(preComputeNodes, [&communicator](std::vector<double>& values)
+            {
+                auto aggregated = MakeSharedObject<NDArrayView>(0.0, NDShape{ values.size() }, DeviceDescriptor::CPUDevice());
+                std::copy(values.begin(), values.end(), aggregated->WritableDataBuffer<double>());
+                communicator->AggregateInPlace({ aggregated }, communicator->Workers());
+                std::copy(aggregated->DataBuffer<double>(), aggregated->DataBuffer<double>() + values.size(), values.begin());
+            });
+        }
+
         // finalize
         for (auto & preComputeNode : preComputeNodes)
             dynamic_pointer_cast<IPreComputeNode>(preComputeNode)->MarkComputed(true /*done accumulating*/);
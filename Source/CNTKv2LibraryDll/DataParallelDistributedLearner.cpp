@@ -114,6 +114,11 @@ namespace CNTK
         return MakeSharedObject<DataParallelDistributedLearner>(communicator, learner, distributedAfterSamples, useAsyncBufferedParameterUpdate);
     }
 
+    DistributedLearnerPtr CreateShardedDataParallelDistributedLearner(DistributedCommunicatorPtr communicator, const std::vector<Parameter>& parameters, const std::function<LearnerPtr(const std::vector<Parameter>&)>& createLearner)
+    {
+        return MakeSharedObject<DataParallelDistributedLearner>(communicator, parameters, createLearner);
+    }
+
     DataParallelDistributedLearner::DataParallelDistributedLearner(DistributedCommunicatorPtr communicator, LearnerPtr learner, size_t distributedAfterSamples, bool useAsyncBufferedParameterUpdate)
         : DistributedLearnerBase(communicator, learner, distributedAfterSamples)
     {
@@ -121,6 +126,69 @@ namespace CNTK
             LogicError("Asynchronous parameter update is not yet supported for the DataParallelDistributedLearner.");
     }
 
+    DataParallelDistributedLearner::DataParallelDistributedLearner(DistributedCommunicatorPtr communicator, const std::vector<Parameter>& parameters, const std::function<LearnerPtr(const std::vector<Parameter>&)>& createLearner)
+        : DistributedLearnerBase(communicator, CreateShardLearner(communicator, parameters, createLearner), /*distributeAfterSamples=*/0)
+    {
+        // The local learner only covers the owned parameters, but this learner is responsible for all of them.
+        Learner::m_parameters = parameters;
+
+        m_orderedParameters = parameters;
+        std::sort(m_orderedParameters.begin(), m_orderedParameters.end(),
+            [](const Parameter& a, const Parameter& b) { return a.Uid() < b.Uid(); });
+
+        const std::unordered_set<Parameter> allParameters(parameters.begin(), parameters.end());
+        for (const auto& parameter : m_learner->Parameters())
+        {
+            if (allParameters.find(parameter) == allParameters.end())
+                LogicError("The learner of the sharded DataParallelDistributedLearner covers parameter '%S', which is not one of its parameters.", parameter.AsString().c_str());
+            m_ownedParameters.insert(parameter);
+        }
+    }
+
+    // Partitions the parameters between the workers, and creates the learner of the parameters owned by this worker.
+    // The partition balances the number of elements per worker; it only depends on the parameter Uids and shapes,
+    // so all workers compute the same one.
+    /*static*/ LearnerPtr DataParallelDistributedLearner::CreateShardLearner(DistributedCommunicatorPtr communicator, const std::vector<Parameter>& parameters, const std::function<LearnerPtr(const std::vector<Parameter>&)>& createLearner)
+    {
+        if (!communicator)
+            InvalidArgument("Communicator of a DistributedLearner cannot be null.");
+
+        if (!createLearner)
+            InvalidArgument("The learner factory of a sharded DataParallelDistributedLearner cannot be null.");
+
+        const size_t numWorkers = communicator->Workers().size();
+        if (parameters.size() < numWorkers)
+            InvalidArgument("Sharding the optimizer state needs at least as many parameters (%zu) as workers (%zu).", parameters.size(), numWorkers);
+
+        std::vector<Parameter> ordered = parameters;
+        std::sort(ordered.begin(), ordered.end(), [](const Parameter& a, const Parameter& b)
+        {
+            const size_t aSize = a.Shape().TotalSize(), bSize = b.Shape().TotalSize();
+            return (aSize != bSize) ? (aSize > bSize) : (a.Uid() < b.Uid());
+        });
+
+        // largest first, each to the worker with the fewest elements (and then the fewest parameters) so far
+        std::vector<size_t> numElements(numWorkers, 0), numParameters(numWorkers, 0);
+        std::vector<Parameter> ownedParameters;
+        const size_t currentRank = communicator->CurrentWorker().m_globalRank;
+        for (const auto& parameter : ordered)
+        {
+            size_t owner = 0;
+            for (size_t rank = 1; rank < numWorkers; ++rank)
+            {
+                if ((numElements[rank] < numElements[owner]) || ((numElements[rank] == numElements[owner]) && (numParameters[rank] < numParameters[owner])))
+                    owner = rank;
+            }
+
+            numElements[owner] += parameter.Shape().TotalSize();
+            numParameters[owner]++;
+            if (owner == currentRank)
+                ownedParameters.push_back(parameter);
+        }
+
+        return createLearner(ownedParameters);
+    }
+
     bool DataParallelDistributedLearner::Update(std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, MinibatchInfo& info)
     {
         if (m_sampleCount >= m_distributeAfterSamples)
@@ -152,6 +220,88 @@ namespace CNTK
         if (info.IsEmpty())
             return false;
 
-        return m_learner->Update(gradientValues, info.numberOfSamples, info.atEndOfSweep);
+        if (!IsSharded())
+            return m_learner->Update(gradientValues, info.numberOfSamples, info.atEndOfSweep);
+
+        // Each worker updates the parameters it owns with the aggregated gradients, and then shares the new values.
+        std::unordered_map<Parameter, NDArrayViewPtr> ownedGradientValues;
+        for (const auto& parameter : m_ownedParameters)
+        {
+            auto gradientValue = gradientValues.find(parameter);
+            if (gradientValue == gradientValues.end())
+                LogicError("No gradient was given for parameter '%S' of the sharded DataParallelDistributedLearner.", parameter.AsString().c_str());
+            ownedGradientValues.insert(*gradientValue);
+        }
+
+        bool updated = m_learner->Update(ownedGradientValues, info.numberOfSamples, info.atEndOfSweep);
+        GatherParameterValues();
+        return updated;
+    }
+
+    // Replaces the values of the parameters owned by other workers by their new values.
+    // The communicator only aggregates across all workers, so every worker zeroes the parameters it does
+    // not own, and the aggregate of all parameter values is then exactly the value computed by the owner.
+    void DataParallelDistributedLearner::GatherParameterValues()
+    {
+        std::vector<NDArrayViewPtr> values;
+        values.reserve(m_orderedParameters.size());
+        for (const auto& parameter : m_orderedParameters)
+        {
+            auto value = parameter.Value();
+            if (m_ownedParameters.find(parameter) == m_ownedParameters.end())
+            {
+                if (value->GetDataType() == DataType::Double)
+                    value->SetValue(0.0);
+                else
+                    value->SetValue(0.0f);
+            }
+            values.push_back(value);
+        }
+
+        m_communicator->AggregateInPlace(values, m_communicator->Workers());
+    }
+
+    // With a sharded optimizer state, each worker checkpoints the state of its own parameters; the states are
+    // collected on the main worker, which is the one that saves the checkpoint.
+    Dictionary DataParallelDistributedLearner::CreateCheckpoint()
+    {
+        if (!IsSharded())
+            return DistributedLearnerBase::CreateCheckpoint();
+
+        std::vector<DictionaryPtr> shards;
+        m_communicator->Gather(m_learner->CreateCheckpoint(), shards, m_communicator->Workers());
+
+        std::vector<DictionaryValue> localLearnerShards;
+        if (m_communicator->CurrentWorker().IsMain())
+        {
+            for (const auto& shard : shards)
+                localLearnerShards.push_back(*shard);
+        }
+
+        Dictionary result;
+        result[L"localLearnerShards"] = localLearnerShards;
+        result[L"totalNumberOfSamplesSeen"] = m_sampleCount;
+        return result;
+    }
+
+    void DataParallelDistributedLearner::RestoreFromCheckpoint(const Dictionary& checkpoint)
+    {
+        if (!IsSharded())
+        {
+            if (checkpoint.Contains(L"localLearnerShards"))
+                RuntimeError("Cannot restore a DataParallelDistributedLearner from the checkpoint of a sharded one.");
+            DistributedLearnerBase::RestoreFromCheckpoint(checkpoint);
+            return;
+        }
+
+        if (!checkpoint.Contains(L"localLearnerShards"))
+            RuntimeError("Cannot restore a sharded DataParallelDistributedLearner from the checkpoint of a non-sharded one.");
+
+        const auto& localLearnerShards = checkpoint[L"localLearnerShards"].Value<std::vector<DictionaryValue>>();
+        if (localLearnerShards.size() != m_communicator->Workers().size())
+            RuntimeError("The checkpoint of the sharded DataParallelDistributedLearner was made with %zu workers, but there are %zu now.", localLearnerShards.size(), m_communicator->Workers().size());
+
+        m_learner->RestoreFromCheckpoint(localLearnerShards[m_communicator->CurrentWorker().m_globalRank].Value<Dictionary>());
+        m_sampleCount = checkpoint[L"totalNumberOfSamplesSeen"].Value<size_t>();
     }
 }
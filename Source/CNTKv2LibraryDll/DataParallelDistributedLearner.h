@@ -18,7 +18,26 @@ namespace CNTK
     public:
         DataParallelDistributedLearner(DistributedCommunicatorPtr communicator, LearnerPtr learner, size_t distributedAfterSamples, bool useAsyncBufferedParameterUpdate);
 
+        // Sharded optimizer state: the parameters are partitioned between the workers, and the local learner
+        // (created by createLearner) only covers, and keeps the state of, the parameters owned by this worker.
+        DataParallelDistributedLearner(DistributedCommunicatorPtr communicator, const std::vector<Parameter>& parameters, const std::function<LearnerPtr(const std::vector<Parameter>&)>& createLearner);
+
         // Optional override that gets called per minibatch after finishing gradient computation but before updating model parameters
         bool Update(std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, MinibatchInfo& trainingSampleCount) override;
+
+        Dictionary CreateCheckpoint() override;
+
+        void RestoreFromCheckpoint(const Dictionary& checkpoint) override;
+
+    private:
+        static LearnerPtr CreateShardLearner(DistributedCommunicatorPtr communicator, const std::vector<Parameter>& parameters, const std::function<LearnerPtr(const std::vector<Parameter>&)>& createLearner);
+
+        void GatherParameterValues();
+
+        bool IsSharded() const { return !m_orderedParameters.empty(); }
+
+        // (sharded optimizer state only) all parameters ordered by Uid, and the ones owned by this worker
+        std::vector<Parameter> m_orderedParameters;
+        std::unordered_set<Parameter> m_ownedParameters;
     };
 }
\ No newline at end of file
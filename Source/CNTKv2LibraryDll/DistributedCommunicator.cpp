@@ -14,6 +14,7 @@
 #include "GPUDataTransferer.h"
 #include <numeric>
 #include "Utils.h"
+#include "PerformanceProfiler.h"
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -404,6 +405,7 @@ namespace CNTK
 
         if (m_nccl->IsSupported())
         {
+            Microsoft::MSR::CNTK::ScopeProfile profile(Microsoft::MSR::CNTK::profilerEvtNcclSync);
             m_nccl->Sync();
         }
 
@@ -413,7 +415,10 @@ namespace CNTK
         while (numAllReduceRequestsCompleted < allReduceRequests.size())
         {
             int idx = MPI_UNDEFINED;
-            m_mpi->WaitAny(allReduceRequests.data(), (int)allReduceRequests.size(), &idx);
+            {
+                Microsoft::MSR::CNTK::ScopeProfile profile(Microsoft::MSR::CNTK::profilerEvtMPIWait);
+                m_mpi->WaitAny(allReduceRequests.data(), (int)allReduceRequests.size(), &idx);
+            }
             if (idx == MPI_UNDEFINED)
             {
                 break;
@@ -550,13 +555,16 @@ namespace CNTK
     {
         if (m_nccl->IsSupported() && !dataOnCPU)
         {
+            Microsoft::MSR::CNTK::ScopeProfile profile(Microsoft::MSR::CNTK::profilerEvtNcclAllReduce);
             m_nccl->AllReduce(inputData, outputData, numElements);
 
             return;
         }
 
-        if (m_mpi->UseGpuGdr())
+        // a CUDA-aware MPI that only takes GPU buffers in blocking calls
+        if (m_mpi->UseGpuGdr() && !m_mpi->UseGpuGdrForNonblockingCollectives())
         {
+            Microsoft::MSR::CNTK::ScopeProfile profile(Microsoft::MSR::CNTK::profilerEvtMPIAllReduce);
             if (inputData == outputData)
                 m_mpi->AllReduce(outputData, numElements);
             else
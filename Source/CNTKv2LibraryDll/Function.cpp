@@ -11,6 +11,7 @@
 #include "Utils.h"
 #include "UserFunctionFactory.h"
 #include "TrainingNodes.h"
+#include "Serialization.h"
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -191,6 +192,39 @@ namespace CNTK
         return Forward(inputValues, outputs, computeDevice, outputsToRetainBackwardStateFor);
     }
 
+    std::future<std::unordered_map<Variable, ValuePtr>> Function::ForwardAsync(const std::unordered_map<Variable, ValuePtr>& arguments,
+                                                                             const std::unordered_map<Variable, ValuePtr>& outputs,
+                                                                             const DeviceDescriptor& computeDevice)
+    {
+        // The lambda holds references to 'this' Function and all Values till it is done.
+        auto function = shared_from_this();
+        auto results = outputs;
+        return std::async(std::launch::async, [function, arguments, results, computeDevice]() mutable
+        {
+            function->Forward(arguments, results, computeDevice);
+            return results;
+        });
+    }
+
+    void Function::ForwardSequences(const std::vector<size_t>& sequenceIds,
+                                    const std::unordered_map<Variable, ValuePtr>& arguments,
+                                    std::unordered_map<Variable, ValuePtr>& outputs,
+                                    const DeviceDescriptor& computeDevice)
+    {
+        auto compositeFunction = dynamic_cast<CompositeFunction*>(this);
+        if (!compositeFunction)
+            InvalidArgument("Function '%S' ForwardSequences: Only supported for composite Functions.", AsString().c_str());
+
+        compositeFunction->Forward(arguments, outputs, computeDevice, {}, {}, &sequenceIds);
+    }
+
+    void Function::EndSequence(size_t sequenceId)
+    {
+        auto compositeFunction = dynamic_cast<CompositeFunction*>(this);
+        if (compositeFunction)
+            compositeFunction->EndSequence(sequenceId);
+    }
+
     /*virtual*/ void Function::Backward(const BackPropStatePtr& /*state*/,
                                         const std::unordered_map<Variable, ValuePtr>& /*rootGradientValues*/,
                                         std::unordered_map<Variable, ValuePtr>& /*backPropagatedGradientValuesForInputs*/)
@@ -463,8 +497,30 @@ namespace CNTK
         stream->flush();
     }
 
+    void Function::Save(const std::wstring& filepath, ModelFormat format)
+    {
+        switch (format)
+        {
+        case ModelFormat::CNTKv2:
+            Save(filepath);
+            break;
+        case ModelFormat::CNTKv2Mappable:
+            SaveMappableModel(Serialize(), filepath);
+            break;
+        default:
+            InvalidArgument("Function::Save: Unknown model format.");
+        }
+    }
+
     /*static*/ FunctionPtr Function::Load(const std::wstring& filepath, const DeviceDescriptor& computeDevice)
     {
+        if (IsMappableModel(filepath))
+        {
+            FunctionPtr function;
+            LoadMappableModel(filepath, [&](const Dictionary& model) { function = Function::Deserialize(model, computeDevice); });
+            return function;
+        }
+
         auto stream = GetFstream(filepath, true);
         if (!Internal::IsLegacyModel(*stream))
         {
@@ -492,6 +548,12 @@ namespace CNTK
             }
         };
 
+        if (IsMappableModel(buffer, length))
+        {
+            FunctionPtr function;
+            LoadMappableModel(buffer, length, [&](const Dictionary& model) { function = Function::Deserialize(model, computeDevice); });
+            return function;
+        }
         if (Internal::IsLegacyModel(buffer, length))
             InvalidArgument("Loading a legacy model from byte array is not supported.");
         else
@@ -512,6 +574,12 @@ namespace CNTK
 
     void Function::Restore(const std::wstring& filepath)
     {
+        if (IsMappableModel(filepath))
+        {
+            LoadMappableModel(filepath, [this](const Dictionary& model) { RestoreFromCheckpoint(model); });
+            return;
+        }
+
         auto stream = GetFstream(filepath, true);
         if (!Internal::IsLegacyModel(*stream))
         {
@@ -641,6 +709,7 @@ namespace CNTK
     FunctionPtr Function::Clone(const FunctionPtr& clonee,
                                 ParameterCloningMethod parameterCloneMethod,
                                 const std::unordered_map<Variable, Variable>& replacements,
+                                const DeviceDescriptor* device,
                                 std::unordered_map<const Function*, FunctionPtr>& cloneMap,
                                 std::unordered_map<Variable, Variable>& leafVariablesCloneMap,
                                 std::unordered_map<Variable, Variable>& placeholderReplacements)
@@ -678,7 +747,7 @@ namespace CNTK
                             switch (parameterCloneMethod)
                             {
                             case ParameterCloningMethod::Clone:
-                                clonedInput = cloneeInput.Clone();
+                                clonedInput = device ? cloneeInput.Clone(*device) : cloneeInput.Clone();
                                 leafVariablesCloneMap[cloneeInput] = clonedInput;
                                 break;
                             case ParameterCloningMethod::Share:
@@ -689,13 +758,13 @@ namespace CNTK
                                 {
                                     //parameter values can be updated so we need our own copy
                                     const auto& ndav = Parameter(cloneeInput).Value();
-                                    clonedInput = Constant(ndav->DeepClone(ndav->Device(), ndav->IsReadOnly()), cloneeInput.Name());
+                                    clonedInput = Constant(ndav->DeepClone(device ? *device : ndav->Device(), ndav->IsReadOnly()), cloneeInput.Name());
                                 }
                                 else
                                 {
                                     //constants can also be updated via non-sgd means
                                     const auto& ndav = Constant(cloneeInput).Value();
-                                    clonedInput = Constant(ndav->DeepClone(ndav->Device(), ndav->IsReadOnly()), cloneeInput.Name());
+                                    clonedInput = Constant(ndav->DeepClone(device ? *device : ndav->Device(), ndav->IsReadOnly()), cloneeInput.Name());
                                 }
                                 leafVariablesCloneMap[cloneeInput] = clonedInput;
                                 break;
@@ -737,7 +806,7 @@ namespace CNTK
                     }
                     else
                     {
-                        auto clonedFunction = Clone(cloneeInput.Owner(), parameterCloneMethod, replacements, cloneMap, leafVariablesCloneMap, placeholderReplacements);
+                        auto clonedFunction = Clone(cloneeInput.Owner(), parameterCloneMethod, replacements, device, cloneMap, leafVariablesCloneMap, placeholderReplacements);
                         clonedInput = GetCorrespondingOutputVariableFromClone(cloneeInput, cloneeInput.Owner(), clonedFunction);
                     }
                 }
@@ -822,6 +891,19 @@ namespace CNTK
     }
 
     FunctionPtr Function::Clone(ParameterCloningMethod parameterCloneMethod, const std::unordered_map<Variable, Variable>& replacements) const
+    {
+        return Clone(parameterCloneMethod, replacements, nullptr);
+    }
+
+    FunctionPtr Function::Clone(const DeviceDescriptor& device, ParameterCloningMethod parameterCloneMethod, const std::unordered_map<Variable, Variable>& replacements) const
+    {
+        if (parameterCloneMethod == ParameterCloningMethod::Share)
+            InvalidArgument("Function '%S': Parameters cannot be shared when cloning onto device '%S'.", AsString().c_str(), device.AsString().c_str());
+
+        return Clone(parameterCloneMethod, replacements, &device);
+    }
+
+    FunctionPtr Function::Clone(ParameterCloningMethod parameterCloneMethod, const std::unordered_map<Variable, Variable>& replacements, const DeviceDescriptor* device) const
     {
         const CompositeFunction* compositeFunction = dynamic_cast<const CompositeFunction*>(this);
         if (compositeFunction == nullptr)
@@ -861,7 +943,7 @@ namespace CNTK
         std::unordered_map<const Function*, FunctionPtr> cloneMap;
         std::unordered_map<Variable, Variable> leafVariablesCloneMap;
         std::unordered_map<Variable, Variable> placeholderReplacements;
-        auto clonedRootFunction = Function::Clone(compositeRootFunction, parameterCloneMethod, replacements, cloneMap, leafVariablesCloneMap, placeholderReplacements);
+        auto clonedRootFunction = Function::Clone(compositeRootFunction, parameterCloneMethod, replacements, device, cloneMap, leafVariablesCloneMap, placeholderReplacements);
 
         // Patch the values in the placeholderReplacements map with newly cloned Variables where applicable
         std::unordered_set<FunctionPtr> replacementClones;
@@ -1007,6 +1089,14 @@ namespace CNTK
 
             primitiveFunctionPtr->SetRandomSeed(seed);
         }
+        else if (name == PrimitiveFunction::AttributeNameRecompute)
+        {
+            primitiveFunctionPtr->SetRecompute(value.Value<bool>());
+        }
+        else if (name == PrimitiveFunction::AttributeNameOffload)
+        {
+            primitiveFunctionPtr->SetOffload(value.Value<bool>());
+        }
         else 
         {
             LogicError("SetAttribute: '%S' is not supported (this attribute cannot be updated).", name.c_str());
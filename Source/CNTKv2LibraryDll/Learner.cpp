@@ -8,6 +8,7 @@
 #include "TensorView.h"
 #include "Utils.h"
 #include "Serialization.h"
+#include "BFloat16.h"
 
 #define DISPATCH_TO_TYPED_UPDATE_FUNCTION                                                                     \
     switch (smoothedGradientValue->GetDataType())                                                             \
@@ -27,6 +28,33 @@
     const auto& gradientMatrix = GetWritableMatrix<ElementType>(gradientValue);                               \
     const auto& parameterMatrix = GetWritableMatrix<ElementType>(parameter.Value());
 
+#define DISPATCH_TO_TYPED_FUSED_UPDATE_FUNCTION                                                               \
+    switch (parameters.front().GetDataType())                                                                 \
+    {                                                                                                         \
+    case DataType::Float:                                                                                     \
+        FusedUpdate<float>(parameters, gradientValues, smoothedGradientValues, trainingSampleCount);          \
+        break;                                                                                                \
+    case DataType::Double:                                                                                    \
+        FusedUpdate<double>(parameters, gradientValues, smoothedGradientValues, trainingSampleCount);         \
+        break;                                                                                                \
+    default:                                                                                                  \
+        NOT_IMPLEMENTED;                                                                                      \
+    }
+
+// the matrices of the parameters, gradients and smoothed gradients of a fused update (the shared pointers keep them alive)
+#define GET_WRITABLE_MATRIX_LISTS                                                                             \
+    std::vector<std::shared_ptr<Matrix<ElementType>>> matrices;                                               \
+    std::vector<Matrix<ElementType>*> parameterMatrices, gradientMatrices, smoothedGradientMatrices;          \
+    for (size_t i = 0; i < parameters.size(); i++)                                                            \
+    {                                                                                                         \
+        matrices.push_back(GetWritableMatrix<ElementType>(parameters[i].Value()));                            \
+        parameterMatrices.push_back(matrices.back().get());                                                   \
+        matrices.push_back(GetWritableMatrix<ElementType>(gradientValues[i]));                                \
+        gradientMatrices.push_back(matrices.back().get());                                                    \
+        matrices.push_back(GetWritableMatrix<ElementType>(smoothedGradientValues[i]));                        \
+        smoothedGradientMatrices.push_back(matrices.back().get());                                            \
+    }
+
 using namespace Microsoft::MSR::CNTK;
 using namespace std;
 
@@ -202,7 +230,8 @@ namespace CNTK
                              bool allocateSmoothGradients /* = true */)
                              : Learner(parameters, learningRateSchedule),
                              m_additionalOptions(additionalOptions), 
-                             m_noiseInjectionSeed(Internal::GenerateRandomSeed())
+                             m_noiseInjectionSeed(Internal::GenerateRandomSeed()),
+                             m_roundingSeed(Internal::GenerateRandomSeed())
     {
         if (parameters.empty())
             InvalidArgument("The parameters list specified to a Learner must not be empty.");
@@ -216,8 +245,7 @@ namespace CNTK
         {
             for (const auto& parameter : parameters)
             {
-                NDArrayViewPtr view = AllocateNDArrayView(parameter, parameter.Shape());
-                m_smoothedGradientValues.emplace(parameter, view);
+                AllocateSmoothedGradient(parameter, parameter.Shape());
             }
         }
 
@@ -239,6 +267,51 @@ namespace CNTK
         }
     }
 
+    void LearnerBase::AllocateSmoothedGradient(const Parameter& parameter, const NDShape& shape)
+    {
+        if (!m_additionalOptions.bfloat16SmoothedGradients)
+        {
+            m_smoothedGradientValues.emplace(parameter, AllocateNDArrayView(parameter, shape));
+            return;
+        }
+
+        size_t numPackedElements = (parameter.GetDataType() == DataType::Float) ? BFloat16::NumPackedElements<float>(shape.TotalSize()) :
+                                                                                  BFloat16::NumPackedElements<double>(shape.TotalSize());
+        m_smoothedGradientValues.emplace(parameter, AllocateNDArrayView(parameter, { numPackedElements }));
+        m_packedSmoothedGradientShapes.emplace(parameter, shape);
+    }
+
+    template <typename ElementType>
+    NDArrayViewPtr LearnerBase::ScratchNDArrayView(const NDShape& shape, const DeviceDescriptor& device, size_t index) const
+    {
+        if (m_scratchBuffers.size() <= index)
+            m_scratchBuffers.resize(index + 1);
+
+        auto& scratchBuffer = m_scratchBuffers[index];
+        if (!scratchBuffer || (scratchBuffer->GetDataType() != AsDataType<ElementType>()) || (scratchBuffer->Device() != device) ||
+            (scratchBuffer->Shape().TotalSize() < shape.TotalSize()))
+        {
+            scratchBuffer = nullptr; // (release the old one first)
+            scratchBuffer = MakeSharedObject<NDArrayView>(ElementType(0), NDShape({ shape.TotalSize() }), device);
+        }
+
+        return scratchBuffer->SliceView({ 0 }, { shape.TotalSize() })->AsShape(shape);
+    }
+
+    template <typename ElementType>
+    NDArrayViewPtr LearnerBase::UnpackSmoothedGradient(const NDArrayViewPtr& packedValue, const NDShape& shape) const
+    {
+        auto value = ScratchNDArrayView<ElementType>(shape, packedValue->Device(), 0);
+        GetWritableMatrix<ElementType>(value)->AssignUnpackedBFloat16Of(*GetMatrix<ElementType>(packedValue));
+        return value;
+    }
+
+    template <typename ElementType>
+    void LearnerBase::PackSmoothedGradient(const NDArrayViewPtr& value, const NDArrayViewPtr& packedValue) const
+    {
+        GetWritableMatrix<ElementType>(packedValue)->AssignPackedBFloat16Of(*GetMatrix<ElementType>(value), (unsigned long)m_roundingSeed++);
+    }
+
     /*static*/ NDShape LearnerBase::GetMatrixShape(const Parameter& parameter)
     {
         if (parameter.GetDataType() == DataType::Float)
@@ -268,41 +341,71 @@ namespace CNTK
 
         UpdateOnMinibatch(trainingSampleCount);
 
-        for (const auto& parameter : Parameters())
+        if (CanFuseUpdates(gradientValues))
         {
-            const auto& smoothedGradientValue = m_smoothedGradientValues.at(parameter);
-            const auto& gradientValue = gradientValues.at(parameter);
-            // TODO: make this a runtime parameter.
+            if (Parameters().front().GetDataType() == DataType::Float)
+                FusedUpdate<float>(gradientValues, trainingSampleCount);
+            else
+                FusedUpdate<double>(gradientValues, trainingSampleCount);
+        }
+        else
+        {
+            for (const auto& parameter : Parameters())
+            {
+                auto smoothedGradientValue = m_smoothedGradientValues.at(parameter);
+                const auto& gradientValue = gradientValues.at(parameter);
+
+                NDArrayViewPtr packedSmoothedGradientValue;
+                auto packedShapeIter = m_packedSmoothedGradientShapes.find(parameter);
+                if (packedShapeIter != m_packedSmoothedGradientShapes.end())
+                {
+                    packedSmoothedGradientValue = smoothedGradientValue;
+                    if (packedSmoothedGradientValue->GetDataType() == DataType::Float)
+                        smoothedGradientValue = UnpackSmoothedGradient<float>(packedSmoothedGradientValue, packedShapeIter->second);
+                    else
+                        smoothedGradientValue = UnpackSmoothedGradient<double>(packedSmoothedGradientValue, packedShapeIter->second);
+                }
+
+                // TODO: make this a runtime parameter.
 #if DUMPOUTPUT
-            LOGPRINTF(stderr, "Update_%ls\n", parameter.Uid().c_str());
+                LOGPRINTF(stderr, "Update_%ls\n", parameter.Uid().c_str());
 #endif
 
 #ifdef _DEBUG
-            if (HasNan(smoothedGradientValue, "TrainOneEpoch/UpdateWeights/Learner::Update(): "))
-                LogicError("%ls has NaNs in smoothedGradient.", parameter.Uid().c_str());
+                if (HasNan(smoothedGradientValue, "TrainOneEpoch/UpdateWeights/Learner::Update(): "))
+                    LogicError("%ls has NaNs in smoothedGradient.", parameter.Uid().c_str());
 #endif
 
 #if DUMPOUTPUT
-            const auto learningRate = LearningRate(trainingSampleCount);
-            const auto momentum = MomentumValueForMB(trainingSampleCount);
-            LOGPRINTF(stderr, "learnRatePerSample=%0.8f, momentum=%0.8f, actualMBSize=%ld\n",
-                      learningRate, momentum, trainingSampleCount);
-            LOGPRINTF(stderr, "GradUpdateType()=%s, GradientUpdateNoiseStd()=%0.8f\n",
-                      LearnerType().c_str(), m_additionalOptions.gaussianNoiseInjectionStdDev);
-            Print(gradientValue, "Gradient Update");
-            Print(smoothedGradientValue, "Smoothed Gradient Input");
+                const auto learningRate = LearningRate(trainingSampleCount);
+                const auto momentum = MomentumValueForMB(trainingSampleCount);
+                LOGPRINTF(stderr, "learnRatePerSample=%0.8f, momentum=%0.8f, actualMBSize=%ld\n",
+                          learningRate, momentum, trainingSampleCount);
+                LOGPRINTF(stderr, "GradUpdateType()=%s, GradientUpdateNoiseStd()=%0.8f\n",
+                          LearnerType().c_str(), m_additionalOptions.gaussianNoiseInjectionStdDev);
+                Print(gradientValue, "Gradient Update");
+                Print(smoothedGradientValue, "Smoothed Gradient Input");
 #endif
-            DISPATCH_TO_TYPED_UPDATE_FUNCTION;
+                DISPATCH_TO_TYPED_UPDATE_FUNCTION;
+
+                if (packedSmoothedGradientValue)
+                {
+                    if (packedSmoothedGradientValue->GetDataType() == DataType::Float)
+                        PackSmoothedGradient<float>(smoothedGradientValue, packedSmoothedGradientValue);
+                    else
+                        PackSmoothedGradient<double>(smoothedGradientValue, packedSmoothedGradientValue);
+                }
 
 #if DUMPOUTPUT
-            Print(parameter.Value(), "Parameter Update");
+                Print(parameter.Value(), "Parameter Update");
 #endif
 
 #ifdef _DEBUG
-            const auto& parameterValue = parameter.Value();
-            if (HasNan(parameterValue, "TrainOneEpoch/UpdateWeights/Learner::Update(): "))
-                LogicError("%ls has NaNs in parameter values after parameter update.", parameter.Uid().c_str());
+                const auto& parameterValue = parameter.Value();
+                if (HasNan(parameterValue, "TrainOneEpoch/UpdateWeights/Learner::Update(): "))
+                    LogicError("%ls has NaNs in parameter values after parameter update.", parameter.Uid().c_str());
 #endif
+            }
         }
         m_sampleCount += trainingSampleCount;
         m_minibatchCount++;
@@ -327,6 +430,53 @@ namespace CNTK
         paramRef.RecordValueUpdate();
     }
 
+    bool LearnerBase::CanFuseUpdates(const unordered_map<Parameter, NDArrayViewPtr>& gradientValues) const
+    {
+        if (!m_additionalOptions.fusedUpdates || !SupportsFusedUpdate() || !m_packedSmoothedGradientShapes.empty())
+            return false;
+
+        const auto& firstValue = Parameters().front().Value();
+        for (const auto& parameter : Parameters())
+        {
+            const auto& parameterValue = parameter.Value();
+            const auto& gradientValue = gradientValues.at(parameter);
+            if (parameterValue->IsSparse() || gradientValue->IsSparse() ||
+                (parameterValue->GetDataType() != firstValue->GetDataType()) || (gradientValue->GetDataType() != firstValue->GetDataType()) ||
+                (parameterValue->Device() != firstValue->Device()) || (gradientValue->Device() != firstValue->Device()))
+                return false;
+        }
+
+        return true;
+    }
+
+    template <typename ElementType>
+    void LearnerBase::FusedUpdate(const unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount) const
+    {
+        const auto& parameters = Parameters();
+        vector<NDArrayViewPtr> parameterGradientValues, smoothedGradientValues;
+        for (const auto& parameter : parameters)
+        {
+            parameterGradientValues.push_back(gradientValues.at(parameter));
+            smoothedGradientValues.push_back(m_smoothedGradientValues.at(parameter));
+            PreProcess<ElementType>(parameter.Value(), parameterGradientValues.back(), trainingSampleCount);
+        }
+
+        FusedUpdate(parameters, parameterGradientValues, smoothedGradientValues, trainingSampleCount);
+
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            PostProcess<ElementType>(parameters[i], parameterGradientValues[i], trainingSampleCount);
+
+            auto paramRef = parameters[i];
+            paramRef.RecordValueUpdate();
+
+#ifdef _DEBUG
+            if (HasNan(parameters[i].Value(), "TrainOneEpoch/UpdateWeights/Learner::Update(): "))
+                LogicError("%ls has NaNs in parameter values after parameter update.", parameters[i].Uid().c_str());
+#endif
+        }
+    }
+
     string LearnerBase::LearnerType() const
     {
         return Typename(this);
@@ -485,6 +635,23 @@ namespace CNTK
         parameterMatrix->SGDUpdate(*gradientMatrix, learningRate);
     }
 
+    /*virtual*/ void LearnerSGD::FusedUpdate(const vector<Parameter>& parameters, const vector<NDArrayViewPtr>& gradientValues,
+                                             const vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const /*override*/
+    {
+        DISPATCH_TO_TYPED_FUSED_UPDATE_FUNCTION;
+    }
+
+    template <typename ElementType>
+    void LearnerSGD::FusedUpdate(const vector<Parameter>& parameters, const vector<NDArrayViewPtr>& gradientValues,
+                                 const vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const
+    {
+        GET_WRITABLE_MATRIX_LISTS;
+
+        const auto learningRate = ElementType(LearningRate(trainingSampleCount));
+
+        Matrix<ElementType>::MultiSGDUpdate(parameterMatrices, gradientMatrices, learningRate);
+    }
+
     double LearnerMomentumSGD::MomentumValueForMB(const MomentumSchedule& schedule, size_t minibatchSize) const
     {
         double currentMomentum = GetCurrentTrainingParameterValue(schedule);
@@ -520,6 +687,27 @@ namespace CNTK
                                            learningRate, momentum, UseUnitGainMomentum());
     }
 
+    /*virtual*/ void LearnerMomentumSGD::FusedUpdate(const vector<Parameter>& parameters, const vector<NDArrayViewPtr>& gradientValues,
+                                                     const vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const /*override*/
+    {
+        ReportTrainingParameterValue(m_momentumSchedule, L"Momentum");
+
+        DISPATCH_TO_TYPED_FUSED_UPDATE_FUNCTION;
+    }
+
+    template <typename ElementType>
+    void LearnerMomentumSGD::FusedUpdate(const vector<Parameter>& parameters, const vector<NDArrayViewPtr>& gradientValues,
+                                         const vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const
+    {
+        GET_WRITABLE_MATRIX_LISTS;
+
+        const auto learningRate = ElementType(LearningRate(trainingSampleCount));
+        const auto momentum = ElementType(MomentumValueForMB(trainingSampleCount));
+
+        Matrix<ElementType>::MultiMomentumSGDUpdate(parameterMatrices, gradientMatrices, smoothedGradientMatrices,
+                                                    learningRate, momentum, UseUnitGainMomentum());
+    }
+
     /*virtual*/ void LearnerNesterov::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, 
                                              const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const /*override*/
     {
@@ -539,6 +727,25 @@ namespace CNTK
                                                               learningRate, momentum, UseUnitGainMomentum());
     }
 
+    /*virtual*/ void LearnerNesterov::FusedUpdate(const vector<Parameter>& parameters, const vector<NDArrayViewPtr>& gradientValues,
+                                                  const vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const /*override*/
+    {
+        DISPATCH_TO_TYPED_FUSED_UPDATE_FUNCTION;
+    }
+
+    template <typename ElementType>
+    void LearnerNesterov::FusedUpdate(const vector<Parameter>& parameters, const vector<NDArrayViewPtr>& gradientValues,
+                                      const vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const
+    {
+        GET_WRITABLE_MATRIX_LISTS;
+
+        const auto learningRate = ElementType(LearningRate(trainingSampleCount));
+        const auto momentum = ElementType(MomentumValueForMB(trainingSampleCount));
+
+        Matrix<ElementType>::MultiMomentumSGDUpdate(parameterMatrices, gradientMatrices, smoothedGradientMatrices,
+                                                    learningRate, momentum, UseUnitGainMomentum(), /*nesterov=*/true);
+    }
+
     LearnerAdaGrad::LearnerAdaGrad(const std::vector<Parameter>& parameters,
                                    const LearningRateSchedule& learningRateSchedule,
                                    bool needAveMultiplier,
@@ -556,9 +763,7 @@ namespace CNTK
             }
 
             const auto shape = GetMatrixShape(parameter);
-            NDArrayViewPtr view = AllocateNDArrayView(parameter, { shape[0], factor * shape[1] });
-
-            m_smoothedGradientValues.emplace(parameter, view);
+            AllocateSmoothedGradient(parameter, { shape[0], factor * shape[1] });
         }
     }
 
@@ -591,8 +796,7 @@ namespace CNTK
         for (const auto& parameter : parameters)
         {
             const auto shape = GetMatrixShape(parameter);
-            NDArrayViewPtr view = AllocateNDArrayView(parameter, { shape[0], 2 * shape[1] });
-            m_smoothedGradientValues.emplace(parameter, view);
+            AllocateSmoothedGradient(parameter, { shape[0], 2 * shape[1] });
         }
     }
 
@@ -629,8 +833,7 @@ namespace CNTK
         for (const auto& parameter : parameters)
         {
             const auto shape = GetMatrixShape(parameter);
-            NDArrayViewPtr view = AllocateNDArrayView(parameter, { shape[0], 2 * shape[1] });
-            m_smoothedGradientValues.emplace(parameter, view);
+            AllocateSmoothedGradient(parameter, { shape[0], 2 * shape[1] });
         }
     }
 
@@ -706,11 +909,20 @@ namespace CNTK
             InvalidArgument("Epsilon should be non-negative. You are trying to set it to %g.", m_epsilon);
         }
 
+        if (additionalOptions.factoredSecondMoments && m_adamax)
+            InvalidArgument("The factored second moments option cannot be used with Adamax.");
+
         for (const auto& parameter : parameters)
         {
             const auto shape = GetMatrixShape(parameter);
-            NDArrayViewPtr view = AllocateNDArrayView(parameter, {shape[0], 2 * shape[1]});
-            m_smoothedGradientValues.emplace(parameter, view);
+            if (additionalOptions.factoredSecondMoments && (shape[0] > 1) && (shape[1] > 1))
+            {
+                // the first moment, followed by the moving averages of the row and column sums of the squared gradients
+                AllocateSmoothedGradient(parameter, { shape.TotalSize() + shape[0] + shape[1] });
+                m_factoredParameters.insert(parameter);
+            }
+            else
+                AllocateSmoothedGradient(parameter, {shape[0], 2 * shape[1]});
         }
         m_smoothedCount = 0.0;
     }
@@ -756,8 +968,87 @@ namespace CNTK
 
         const auto varMomentum = VarianceMomentumValueForMB(trainingSampleCount);
 
-        smoothedGradientMatrix->AdamUpdate(*gradientMatrix, *parameterMatrix, m_smoothedCount, learningRate,
-                                           momentum, varMomentum, (ElementType)m_epsilon, UseUnitGainMomentum(), m_adamax);
+        if (m_factoredParameters.find(parameter) != m_factoredParameters.end())
+            FactoredUpdate<ElementType>(parameter, gradientValue, smoothedGradientValue, trainingSampleCount);
+        else
+            smoothedGradientMatrix->AdamUpdate(*gradientMatrix, *parameterMatrix, m_smoothedCount, learningRate,
+                                               momentum, varMomentum, (ElementType)m_epsilon, UseUnitGainMomentum(), m_adamax);
+    }
+
+    /*virtual*/ void LearnerAdam::FusedUpdate(const vector<Parameter>& parameters, const vector<NDArrayViewPtr>& gradientValues,
+                                              const vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const /*override*/
+    {
+        DISPATCH_TO_TYPED_FUSED_UPDATE_FUNCTION;
+    }
+
+    template <typename ElementType>
+    void LearnerAdam::FusedUpdate(const vector<Parameter>& parameters, const vector<NDArrayViewPtr>& gradientValues,
+                                  const vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const
+    {
+        GET_WRITABLE_MATRIX_LISTS;
+
+        const auto learningRate = LearningRate(trainingSampleCount);
+        const auto momentum = MomentumValueForMB(trainingSampleCount);
+        const auto varMomentum = VarianceMomentumValueForMB(trainingSampleCount);
+
+        Matrix<ElementType>::MultiAdamUpdate(parameterMatrices, gradientMatrices, smoothedGradientMatrices, m_smoothedCount, learningRate,
+                                             momentum, varMomentum, m_epsilon, UseUnitGainMomentum(), m_adamax);
+    }
+
+    // Adam with the second moment of the gradient of a [rows x columns] parameter approximated as in Adafactor
+    // (Shazeer & Stern, https://arxiv.org/abs/1804.04235): the moving averages R and C of the row and column sums
+    // of the squared gradients give the estimate R C^T / sum(R).
+    template <typename ElementType>
+    void LearnerAdam::FactoredUpdate(const Parameter& parameter, const NDArrayViewPtr& gradientValue,
+        const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
+    {
+        GET_WRITABLE_MATRICES;
+
+        const auto learningRate = LearningRate(trainingSampleCount);
+        const auto momentum = MomentumValueForMB(trainingSampleCount);
+        const auto varMomentum = VarianceMomentumValueForMB(trainingSampleCount);
+        const auto unitGainFactor = UseUnitGainMomentum() ? (1.0 - momentum) : 1.0;
+        const auto biasCorrection = sqrt(1 - pow(varMomentum, m_smoothedCount)) / (1 - pow(momentum, m_smoothedCount));
+
+        const size_t numRows = parameterMatrix->GetNumRows();
+        const size_t numCols = parameterMatrix->GetNumCols();
+        const size_t numElements = numRows * numCols;
+
+        auto state = smoothedGradientMatrix->Reshaped(1, smoothedGradientMatrix->GetNumElements());
+        auto smoothedMoment = state.ColumnSlice(0, numElements).Reshaped(numRows, numCols);
+        auto smoothedRowSums = state.ColumnSlice(numElements, numRows).Reshaped(numRows, 1);
+        auto smoothedColSums = state.ColumnSlice(numElements + numRows, numCols).Reshaped(numCols, 1);
+
+        // The gradient, a temporary of its size and a vector of ones live in a scratch buffer
+        const size_t numOnes = (std::max)(numRows, numCols);
+        auto scratchMatrix = GetWritableMatrix<ElementType>(ScratchNDArrayView<ElementType>({ 2 * numElements + numOnes }, parameter.Value()->Device(), 1));
+        auto scratch = scratchMatrix->Reshaped(1, scratchMatrix->GetNumElements());
+        auto gradient = scratch.ColumnSlice(0, numElements).Reshaped(numRows, numCols);
+        auto temp = scratch.ColumnSlice(numElements, numElements).Reshaped(numRows, numCols);
+        scratch.ColumnSlice(2 * numElements, numOnes).SetValue(1);
+        auto rowOnes = scratch.ColumnSlice(2 * numElements, numRows).Reshaped(numRows, 1);
+        auto colOnes = scratch.ColumnSlice(2 * numElements, numCols).Reshaped(numCols, 1);
+
+        // (sparse gradients are made dense)
+        gradient.SetValue(0);
+        Matrix<ElementType>::ScaleAndAdd(1, *gradientMatrix, gradient);
+
+        temp.AssignElementProductOf(gradient, gradient);
+        Matrix<ElementType>::MultiplyAndWeightedAdd((ElementType)(1 - varMomentum), temp, false, colOnes, false, (ElementType)varMomentum, smoothedRowSums);
+        Matrix<ElementType>::MultiplyAndWeightedAdd((ElementType)(1 - varMomentum), temp, true, rowOnes, false, (ElementType)varMomentum, smoothedColSums);
+
+        // sqrt(second moment) + epsilon
+        const auto rowSumsTotal = smoothedRowSums.SumOfElements();
+        const auto normalizer = (rowSumsTotal > 0) ? (ElementType)(1 / rowSumsTotal) : (ElementType)0;
+        Matrix<ElementType>::MultiplyAndWeightedAdd(normalizer, smoothedRowSums, false, smoothedColSums, true, 0, temp);
+        temp.InplaceSqrt();
+        temp.AssignSumOf((ElementType)m_epsilon, temp);
+
+        Matrix<ElementType>::Scale((ElementType)momentum, smoothedMoment);
+        Matrix<ElementType>::ScaleAndAdd((ElementType)unitGainFactor, gradient, smoothedMoment);
+
+        temp.AssignElementDivisionOf(smoothedMoment, temp);
+        Matrix<ElementType>::ScaleAndAdd((ElementType)(-learningRate * biasCorrection), temp, *parameterMatrix);
     }
 
     LearnerRMSProp::LearnerRMSProp(const vector<Parameter>& parameters,
@@ -794,9 +1085,7 @@ namespace CNTK
             }
 
             const auto shape = GetMatrixShape(parameter);
-            NDArrayViewPtr view = AllocateNDArrayView(parameter, { shape[0], factor * shape[1] });
-
-            m_smoothedGradientValues.emplace(parameter, view);
+            AllocateSmoothedGradient(parameter, { shape[0], factor * shape[1] });
         }
         m_smoothedCount = 0.0;
     }
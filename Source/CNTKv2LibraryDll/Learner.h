@@ -43,6 +43,16 @@ namespace CNTK
         // Allows derived class may override this to perform per-minibatch update actions
         virtual void UpdateOnMinibatch(size_t /*trainingSampleCount*/) {}
 
+        // Learners that can update all of their parameters at once (see AdditionalLearningOptions::fusedUpdates) override these.
+        // The fused update gets the parameters in the order of Parameters(), with their gradients and smoothed gradients, all of
+        // which are dense, of the same data type and on the same device.
+        virtual bool SupportsFusedUpdate() const { return false; }
+        virtual void FusedUpdate(const std::vector<Parameter>& /*parameters*/, const std::vector<NDArrayViewPtr>& /*gradientValues*/,
+                                 const std::vector<NDArrayViewPtr>& /*smoothedGradientValues*/, size_t /*trainingSampleCount*/) const
+        {
+            LogicError("This learner does not support fused updates.");
+        }
+
         std::string LearnerType() const;
 
         // Returns current (per-sample) learning rate.
@@ -104,12 +114,41 @@ namespace CNTK
         // Retrieves the shape of the matrix corresponding to the parameter value.
         static NDShape GetMatrixShape(const Parameter& parameter);
 
+        // Allocates the smoothed gradient of the parameter with the required shape, in bfloat16 if the additional learning
+        // options say so (see UnpackSmoothedGradient()).
+        void AllocateSmoothedGradient(const Parameter& parameter, const NDShape& shape);
+
+        // Returns a view with the required shape on the scratch buffer 'index' of the learner, which is reused for the updates of
+        // all parameters, for temporaries of the size of a parameter.
+        template <typename ElementType>
+        NDArrayViewPtr ScratchNDArrayView(const NDShape& shape, const DeviceDescriptor& device, size_t index) const;
+
     private:
         // Templatized update function, it invokes preprocess and postprocess using the provided
         // template parameter and also invokes virtual Update method implemented in one of the subclasses.
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
 
+        // Whether the fused update can be used for these gradients (see SupportsFusedUpdate())
+        bool CanFuseUpdates(const std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues) const;
+
+        // Templatized fused update function, it invokes preprocess and postprocess for every parameter around the virtual FusedUpdate method.
+        template <typename ElementType>
+        void FusedUpdate(const std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount) const;
+
+        // Smoothed gradients stored in bfloat16 are unpacked into a scratch buffer for the update, and packed again afterwards.
+        template <typename ElementType>
+        NDArrayViewPtr UnpackSmoothedGradient(const NDArrayViewPtr& packedValue, const NDShape& shape) const;
+
+        template <typename ElementType>
+        void PackSmoothedGradient(const NDArrayViewPtr& value, const NDArrayViewPtr& packedValue) const;
+
+        // The shapes of the smoothed gradients stored in bfloat16, by parameter
+        std::unordered_map<Parameter, NDShape> m_packedSmoothedGradientShapes;
+        mutable size_t m_roundingSeed;
+
+        mutable std::vector<NDArrayViewPtr> m_scratchBuffers;
+
         // TODO: make these functions friends of NDViewArray and move to Utils?
         static bool HasNan(const NDArrayViewPtr& value, const char* name);
         static void Print(const NDArrayViewPtr& value, const char* msg);
@@ -136,6 +175,14 @@ namespace CNTK
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
+
+        virtual bool SupportsFusedUpdate() const override { return true; }
+        virtual void FusedUpdate(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& gradientValues,
+                                 const std::vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const override;
+
+        template <typename ElementType>
+        void FusedUpdate(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& gradientValues,
+                         const std::vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const;
     };
 
     // SGD optimization with momentum. 
@@ -165,6 +212,14 @@ namespace CNTK
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
 
+        virtual bool SupportsFusedUpdate() const override { return true; }
+        virtual void FusedUpdate(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& gradientValues,
+                                 const std::vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const override;
+
+        template <typename ElementType>
+        void FusedUpdate(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& gradientValues,
+                         const std::vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const;
+
         // returns current per-minibatch momentum value from the provided schedule.
         double MomentumValueForMB(const MomentumSchedule& schedule, size_t minibatchSize) const;
 
@@ -198,6 +253,14 @@ namespace CNTK
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
+
+        virtual bool SupportsFusedUpdate() const override { return true; }
+        virtual void FusedUpdate(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& gradientValues,
+                                 const std::vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const override;
+
+        template <typename ElementType>
+        void FusedUpdate(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& gradientValues,
+                         const std::vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const;
     };
 
     class LearnerAdaGrad : public LearnerBase
@@ -258,6 +321,9 @@ namespace CNTK
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const override;
         virtual void UpdateOnMinibatch(size_t trainingSampleCount) override;
 
+        // (unlike its base class)
+        virtual bool SupportsFusedUpdate() const override { return false; }
+
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
 
@@ -302,6 +368,18 @@ namespace CNTK
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
 
+        virtual bool SupportsFusedUpdate() const override { return m_factoredParameters.empty(); }
+        virtual void FusedUpdate(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& gradientValues,
+                                 const std::vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const override;
+
+        template <typename ElementType>
+        void FusedUpdate(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& gradientValues,
+                         const std::vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const;
+
+        // The update with a factored second moment (see AdditionalLearningOptions::factoredSecondMoments)
+        template <typename ElementType>
+        void FactoredUpdate(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
+
     private:
 
         // returns current per-minibatch variance momentum value.
@@ -314,6 +392,9 @@ namespace CNTK
         MomentumSchedule m_varianceMomentumSchedule;
         double m_epsilon;
         bool m_adamax;
+
+        // The parameters with two axes, the second moments of which are factored
+        std::unordered_set<Parameter> m_factoredParameters;
     };
 
     class LearnerRMSProp : public LearnerBase
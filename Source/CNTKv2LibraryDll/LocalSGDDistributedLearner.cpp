@@ -0,0 +1,201 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include <algorithm>
+#include <cmath>
+#include "LocalSGDDistributedLearner.h"
+#include "DistributedCommunicator.h"
+#include "Learner.h"
+#include "PerformanceProfiler.h"
+
+namespace CNTK
+{
+    // weight of a new measurement in the smoothed step and communication times
+    static const double s_measurementWeight = 0.2;
+
+    DistributedLearnerPtr CreateLocalSGDDistributedLearner(
+        DistributedCommunicatorPtr communicator,
+        LearnerPtr learner,
+        size_t distributeAfterSamples,
+        size_t averagingPeriod,
+        size_t maxAveragingPeriod,
+        double maxCommunicationRatio,
+        size_t averagingPeriodWarmupSamples)
+    {
+        return MakeSharedObject<LocalSGDDistributedLearner>(communicator, learner, distributeAfterSamples, averagingPeriod, maxAveragingPeriod, maxCommunicationRatio, averagingPeriodWarmupSamples);
+    }
+
+    LocalSGDDistributedLearner::LocalSGDDistributedLearner(
+        DistributedCommunicatorPtr communicator,
+        LearnerPtr learner,
+        size_t distributeAfterSamples,
+        size_t averagingPeriod,
+        size_t maxAveragingPeriod,
+        double maxCommunicationRatio,
+        size_t averagingPeriodWarmupSamples)
+        : DistributedLearnerBase(communicator, learner, distributeAfterSamples),
+          m_maxAveragingPeriod(std::max(maxAveragingPeriod, averagingPeriod)),
+          m_maxCommunicationRatio(maxCommunicationRatio),
+          m_averagingPeriodWarmupSamples(averagingPeriodWarmupSamples),
+          m_averagingPeriod(averagingPeriod),
+          m_stepsSinceAveraging(0),
+          m_samplesSinceAveraging(0),
+          m_numAveragings(0),
+          m_lastSecondsOnCommunication(0),
+          m_smoothedSecondsPerStep(0),
+          m_smoothedSecondsOnCommunication(0)
+    {
+        if (averagingPeriod == 0)
+            InvalidArgument("The averaging period of a LocalSGDDistributedLearner must be at least 1.");
+
+        if (maxCommunicationRatio < 0)
+            InvalidArgument("The maximum communication ratio of a LocalSGDDistributedLearner must not be negative.");
+
+        m_orderedParameters = m_learner->Parameters();
+        std::sort(m_orderedParameters.begin(), m_orderedParameters.end(),
+            [](const Parameter& a, const Parameter& b) { return a.Uid() < b.Uid(); });
+    }
+
+    // Before the distribution starts all workers see the same data and update the parameters identically. Then each worker
+    // updates its parameters locally, and they are averaged every CurrentAveragingPeriod() minibatches. The workers count the
+    // minibatches in lockstep: a worker that ran out of data keeps getting empty minibatches, and training stops for all workers
+    // at the first averaging at which none of them processed any samples.
+    bool LocalSGDDistributedLearner::Update(std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, MinibatchInfo& info)
+    {
+        if (m_sampleCount < m_distributeAfterSamples)
+        {
+            auto profWeights = Microsoft::MSR::CNTK::ScopeProfile(Microsoft::MSR::CNTK::profilerEvtMainWeights);
+
+            m_sampleCount += info.numberOfSamples;
+            if (info.IsEmpty())
+                return false;
+
+            return m_learner->Update(gradientValues, info.numberOfSamples, info.atEndOfSweep);
+        }
+
+        if (info.IsEmpty())
+        {
+            PrepaireZeroGradients(gradientValues, info);
+        }
+        else
+        {
+            auto profWeights = Microsoft::MSR::CNTK::ScopeProfile(Microsoft::MSR::CNTK::profilerEvtMainWeights);
+            m_learner->Update(gradientValues, info.numberOfSamples, info.atEndOfSweep);
+        }
+
+        m_samplesSinceAveraging += info.numberOfSamples;
+        if (++m_stepsSinceAveraging < CurrentAveragingPeriod())
+            return true;
+
+        auto profGradientAgg = Microsoft::MSR::CNTK::ScopeProfile(Microsoft::MSR::CNTK::profilerEvtMainGradient);
+        size_t totalSamples = AverageParameters();
+        m_sampleCount += totalSamples;
+        return totalSamples > 0;
+    }
+
+    size_t LocalSGDDistributedLearner::CurrentAveragingPeriod() const
+    {
+        const size_t distributedSamples = m_sampleCount - m_distributeAfterSamples;
+        if (distributedSamples >= m_averagingPeriodWarmupSamples)
+            return m_averagingPeriod;
+
+        // linear ramp from averaging after each minibatch
+        return std::max<size_t>(1, (size_t)(m_averagingPeriod * ((double)distributedSamples / m_averagingPeriodWarmupSamples)));
+    }
+
+    // The measurements of the workers are aggregated together with the parameters, so that all workers adapt the averaging period identically.
+    size_t LocalSGDDistributedLearner::AverageParameters()
+    {
+        auto startTime = std::chrono::steady_clock::now();
+
+        std::vector<NDArrayViewPtr> values;
+        values.reserve(m_orderedParameters.size() + 1);
+        for (const auto& parameter : m_orderedParameters)
+            values.push_back(parameter.Value());
+
+        // samples since the last averaging, seconds per minibatch in this period, seconds on the previous averaging
+        auto measurements = MakeSharedObject<NDArrayView>(0.0, NDShape{ 3 }, DeviceDescriptor::CPUDevice());
+        double* measurementData = measurements->WritableDataBuffer<double>();
+        measurementData[0] = (double)m_samplesSinceAveraging;
+        if (m_numAveragings > 0)
+        {
+            measurementData[1] = std::chrono::duration<double>(startTime - m_lastAveragingEndTime).count() / m_stepsSinceAveraging;
+            measurementData[2] = m_lastSecondsOnCommunication;
+        }
+        values.push_back(measurements);
+
+        m_communicator->AggregateInPlace(values, m_communicator->Workers());
+        measurementData = measurements->WritableDataBuffer<double>();
+
+        const size_t numWorkers = m_communicator->Workers().size();
+        for (const auto& parameter : m_orderedParameters)
+        {
+            auto value = parameter.Value();
+            if (value->GetDataType() == DataType::Double)
+                Microsoft::MSR::CNTK::Matrix<double>::Scale(1.0 / numWorkers, *value->GetWritableMatrix<double>());
+            else if (value->GetDataType() == DataType::Float)
+                Microsoft::MSR::CNTK::Matrix<float>::Scale(1.0f / numWorkers, *value->GetWritableMatrix<float>());
+            else
+                LogicError("LocalSGDDistributedLearner: unsupported data type of parameter '%S'.", parameter.AsString().c_str());
+        }
+
+        if (m_numAveragings > 0)
+            AdaptAveragingPeriod(measurementData[1] / numWorkers, measurementData[2] / numWorkers);
+
+        const size_t totalSamples = (size_t)measurementData[0];
+        m_numAveragings++;
+        m_stepsSinceAveraging = 0;
+        m_samplesSinceAveraging = 0;
+        m_lastAveragingEndTime = std::chrono::steady_clock::now();
+        m_lastSecondsOnCommunication = std::chrono::duration<double>(m_lastAveragingEndTime - startTime).count();
+        return totalSamples;
+    }
+
+    // Chooses the shortest period for which the communication takes at most m_maxCommunicationRatio of the compute time.
+    void LocalSGDDistributedLearner::AdaptAveragingPeriod(double secondsPerStep, double secondsOnCommunication)
+    {
+        if (m_maxCommunicationRatio == 0) // fixed period
+            return;
+
+        if (m_smoothedSecondsPerStep == 0)
+        {
+            m_smoothedSecondsPerStep = secondsPerStep;
+            m_smoothedSecondsOnCommunication = secondsOnCommunication;
+        }
+        else
+        {
+            m_smoothedSecondsPerStep += s_measurementWeight * (secondsPerStep - m_smoothedSecondsPerStep);
+            m_smoothedSecondsOnCommunication += s_measurementWeight * (secondsOnCommunication - m_smoothedSecondsOnCommunication);
+        }
+
+        if (m_smoothedSecondsPerStep <= 0)
+            return;
+
+        double period = std::ceil(m_smoothedSecondsOnCommunication / (m_maxCommunicationRatio * m_smoothedSecondsPerStep));
+        m_averagingPeriod = (size_t)std::min(std::max(period, 1.0), (double)m_maxAveragingPeriod);
+    }
+
+    Dictionary LocalSGDDistributedLearner::CreateCheckpoint()
+    {
+        Dictionary result = DistributedLearnerBase::CreateCheckpoint();
+        result[L"averagingPeriod"] = m_averagingPeriod;
+        return result;
+    }
+
+    void LocalSGDDistributedLearner::RestoreFromCheckpoint(const Dictionary& checkpoint)
+    {
+        DistributedLearnerBase::RestoreFromCheckpoint(checkpoint);
+        if (checkpoint.Contains(L"averagingPeriod"))
+            m_averagingPeriod = checkpoint[L"averagingPeriod"].Value<size_t>();
+
+        // the workers restart their measurements together
+        m_stepsSinceAveraging = 0;
+        m_samplesSinceAveraging = 0;
+        m_numAveragings = 0;
+        m_smoothedSecondsPerStep = 0;
+        m_smoothedSecondsOnCommunication = 0;
+    }
+}
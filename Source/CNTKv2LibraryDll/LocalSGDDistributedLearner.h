@@ -0,0 +1,63 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma  once
+
+#include <chrono>
+#include "CNTKLibrary.h"
+#include "DistributedLearnerBase.h"
+
+namespace CNTK
+{
+    ///
+    /// Local SGD: each worker updates its own copy of the parameters with its local gradients, and the parameters are
+    /// averaged across the workers every few minibatches (the averaging period).
+    ///
+    class LocalSGDDistributedLearner : public DistributedLearnerBase
+    {
+    public:
+        LocalSGDDistributedLearner(
+            DistributedCommunicatorPtr communicator,
+            LearnerPtr learner,
+            size_t distributeAfterSamples,
+            size_t averagingPeriod,
+            size_t maxAveragingPeriod,
+            double maxCommunicationRatio,
+            size_t averagingPeriodWarmupSamples);
+
+        bool Update(std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, MinibatchInfo& info) override;
+
+        Dictionary CreateCheckpoint() override;
+
+        void RestoreFromCheckpoint(const Dictionary& checkpoint) override;
+
+    private:
+        // The averaging period for the current number of samples seen (ramped up during the warm-up).
+        size_t CurrentAveragingPeriod() const;
+
+        // Averages the parameters across all workers, and returns the number of samples all workers processed since the last averaging.
+        size_t AverageParameters();
+
+        void AdaptAveragingPeriod(double secondsPerStep, double secondsOnCommunication);
+
+        const size_t m_maxAveragingPeriod;
+        const double m_maxCommunicationRatio;
+        const size_t m_averagingPeriodWarmupSamples;
+        size_t m_averagingPeriod;
+
+        // parameters ordered by Uid, so that all workers aggregate them in the same order
+        std::vector<Parameter> m_orderedParameters;
+
+        size_t m_stepsSinceAveraging;
+        size_t m_samplesSinceAveraging;
+        size_t m_numAveragings;
+
+        // measurements of this worker, and their averages over all workers (smoothed)
+        std::chrono::time_point<std::chrono::steady_clock> m_lastAveragingEndTime;
+        double m_lastSecondsOnCommunication;
+        double m_smoothedSecondsPerStep;
+        double m_smoothedSecondsOnCommunication;
+    };
+}
@@ -304,6 +304,156 @@ namespace CNTK
         m_prevMinibatchSize = 0;
     }
 
+    StreamingMinibatchSourceConfig::StreamingMinibatchSourceConfig(const std::vector<StreamInformation>& streams)
+        : streams(streams)
+    {
+        for (size_t i = 0; i < this->streams.size(); ++i)
+            this->streams[i].m_id = i;
+    }
+
+    StreamingMinibatchSourcePtr CreateStreamingMinibatchSource(const StreamingMinibatchSourceConfig& configuration)
+    {
+        return StreamingMinibatchSourcePtr(new StreamingMinibatchSourceImpl(configuration));
+    }
+
+    StreamingMinibatchSourceImpl::StreamingMinibatchSourceImpl(const StreamingMinibatchSourceConfig& configuration)
+        : m_maxQueuedRecords(configuration.maxQueuedRecords),
+          m_maxLatency(configuration.maxLatencyInMilliseconds),
+          m_closed(false)
+    {
+        if (configuration.streams.empty())
+            InvalidArgument("StreamingMinibatchSource: At least one stream must be specified.");
+
+        if (m_maxQueuedRecords == 0)
+            InvalidArgument("StreamingMinibatchSource: The maximum number of queued records must be > 0.");
+
+        for (const auto& stream : configuration.streams)
+        {
+            if (stream.m_elementType != DataType::Float && stream.m_elementType != DataType::Double)
+                InvalidArgument("StreamingMinibatchSource: The element type of stream '%S' must be float or double.", stream.m_name.c_str());
+
+            if (stream.m_storageFormat != StorageFormat::Dense && stream.m_storageFormat != StorageFormat::SparseCSC)
+                InvalidArgument("StreamingMinibatchSource: The storage format of stream '%S' must be dense or sparse CSC.", stream.m_name.c_str());
+
+            if (stream.m_sampleLayout.IsUnknown() || stream.m_sampleLayout.HasUnboundDimension() || stream.m_sampleLayout.TotalSize() == 0)
+                InvalidArgument("StreamingMinibatchSource: The sample layout of stream '%S' must be fully defined.", stream.m_name.c_str());
+
+            if (!m_streamInfos.insert(stream).second)
+                InvalidArgument("StreamingMinibatchSource: Stream '%S' is specified more than once.", stream.m_name.c_str());
+        }
+    }
+
+    /*virtual*/ bool StreamingMinibatchSourceImpl::AddRecord(const std::unordered_map<StreamInformation, NDArrayViewPtr>& record, Timestamp timestamp) /*override*/
+    {
+        if (record.size() != m_streamInfos.size())
+            InvalidArgument("StreamingMinibatchSource::AddRecord: The record has %zu sequences, but the source has %zu streams.", record.size(), m_streamInfos.size());
+
+        size_t numberOfSamples = 0;
+        for (const auto& sequence : record)
+        {
+            const auto& stream = sequence.first;
+            if (m_streamInfos.find(stream) == m_streamInfos.end())
+                InvalidArgument("StreamingMinibatchSource::AddRecord: Stream '%S' is not a stream of the source.", stream.m_name.c_str());
+
+            const auto& data = sequence.second;
+            if (!data || data->GetDataType() != stream.m_elementType || data->GetStorageFormat() != stream.m_storageFormat || data->Device() != DeviceDescriptor::CPUDevice())
+                InvalidArgument("StreamingMinibatchSource::AddRecord: The sequence of stream '%S' must be an NDArrayView on the CPU with the element type and storage format of the stream.", stream.m_name.c_str());
+
+            if (data->Shape().TotalSize() == 0 || data->Shape().TotalSize() % stream.m_sampleLayout.TotalSize() != 0)
+                InvalidArgument("StreamingMinibatchSource::AddRecord: The shape '%S' of the sequence of stream '%S' does not hold whole samples of the shape '%S'.",
+                                data->Shape().AsString().c_str(), stream.m_name.c_str(), stream.m_sampleLayout.AsString().c_str());
+
+            numberOfSamples = std::max(numberOfSamples, data->Shape().TotalSize() / stream.m_sampleLayout.TotalSize());
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_recordRemoved.wait(lock, [this] { return m_closed || m_records.size() < m_maxQueuedRecords; });
+            if (m_closed)
+                return false;
+
+            m_records.push_back(Record{ record, numberOfSamples, timestamp, std::chrono::steady_clock::now() });
+        }
+        m_recordAdded.notify_all();
+        return true;
+    }
+
+    /*virtual*/ void StreamingMinibatchSourceImpl::Close() /*override*/
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_recordAdded.notify_all();
+        m_recordRemoved.notify_all();
+    }
+
+    /*virtual*/ const std::unordered_map<StreamInformation, MinibatchData>&
+    StreamingMinibatchSourceImpl::GetNextMinibatch(size_t minibatchSizeInSequences,
+                                                   size_t minibatchSizeInSamples,
+                                                   size_t /*numberOfWorkers*/,
+                                                   size_t /*workerRank*/,
+                                                   const DeviceDescriptor& device /*= DeviceDescriptor::UseDefaultDevice()*/) /*override*/
+    {
+        m_minibatchData.clear();
+        m_timestamps.clear();
+
+        if (minibatchSizeInSequences == 0 && minibatchSizeInSamples == 0)
+            InvalidArgument("GetNextMinibatch: Requested minibatch size must be > 0.");
+
+        const size_t maxNumSequences = minibatchSizeInSequences != 0 ? minibatchSizeInSequences : SIZE_MAX;
+        const size_t maxNumSamples = minibatchSizeInSamples != 0 ? minibatchSizeInSamples : SIZE_MAX;
+
+        // Take the records of the minibatch: the first one is waited for as long as it takes, the others
+        // until the deadline set by the arrival of the first one (which may have passed already).
+        std::vector<Record> records;
+        size_t numberOfSamples = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_recordAdded.wait(lock, [this] { return m_closed || !m_records.empty(); });
+            if (m_records.empty())
+                return m_minibatchData; // closed, and all records have been returned
+
+            const auto deadline = m_records.front().m_arrival + m_maxLatency;
+            for (;;)
+            {
+                while (!m_records.empty() && records.size() < maxNumSequences &&
+                       (records.empty() || numberOfSamples + m_records.front().m_numberOfSamples <= maxNumSamples))
+                {
+                    numberOfSamples += m_records.front().m_numberOfSamples;
+                    records.push_back(std::move(m_records.front()));
+                    m_records.pop_front();
+                }
+                m_recordRemoved.notify_all();
+
+                // (records that are left over do not fit into the minibatch)
+                bool full = records.size() >= maxNumSequences || numberOfSamples >= maxNumSamples || !m_records.empty();
+                if (full || m_closed || !m_recordAdded.wait_until(lock, deadline, [this] { return m_closed || !m_records.empty(); }))
+                    break;
+            }
+        }
+
+        std::vector<NDArrayViewPtr> sequences(records.size());
+        const std::vector<bool> sequenceStartFlags(records.size(), true);
+        for (const auto& stream : m_streamInfos)
+        {
+            size_t numberOfStreamSamples = 0;
+            for (size_t i = 0; i < records.size(); ++i)
+            {
+                sequences[i] = records[i].m_sequences.at(stream);
+                numberOfStreamSamples += sequences[i]->Shape().TotalSize() / stream.m_sampleLayout.TotalSize();
+            }
+
+            auto value = Value::Create(stream.m_sampleLayout, sequences, sequenceStartFlags, device, /*readOnly=*/false, /*createNewCopy=*/true);
+            m_minibatchData[stream] = MinibatchData(value, records.size(), numberOfStreamSamples, /*sweepEnd=*/false);
+        }
+
+        for (const auto& record : records)
+            m_timestamps.push_back(record.m_timestamp);
+
+        return m_minibatchData;
+    }
+
     /* static */ ImageTransform ReaderCrop(const wchar_t* cropType,
             std::pair<int, int> cropSize, std::pair<float, float> sideRatio, std::pair<float, float> areaRatio,
             std::pair<float, float> aspectRatio, const wchar_t* jitterType)
@@ -472,6 +622,56 @@ namespace CNTK
         return htk;
     }
 
+    Deserializer KaldiFeatureDeserializer(const std::vector<HTKFeatureConfiguration>& streams)
+    {
+        Deserializer kaldi;
+        Dictionary input;
+        for (const auto& s : streams)
+        {
+            if (s.m_broadcast)
+                InvalidArgument("KaldiFeatureDeserializer: expanding features to the utterance is not supported.");
+            Dictionary stream;
+            std::vector<DictionaryValue> ctxWindow = { DictionaryValue(s.m_left), DictionaryValue(s.m_right) };
+            stream.Add(L"scpFile", s.m_scp, L"dim", s.m_dim, L"contextWindow", ctxWindow);
+            stream[L"definesMBSize"] = s.m_definesMbSize;
+            input[s.m_streamName] = stream;
+        }
+        kaldi.Add(L"type", L"KaldiFeatureDeserializer", L"input", input);
+        return kaldi;
+    }
+
+    Deserializer KaldiAlignmentDeserializer(const std::wstring& streamName, const std::wstring& scp, size_t dimension)
+    {
+        Deserializer kaldi;
+        Dictionary input;
+        Dictionary labels;
+        labels.Add(L"scpFile", scp, L"dim", dimension);
+        input[streamName] = labels;
+        kaldi.Add(L"type", L"KaldiAlignmentDeserializer", L"input", input);
+        return kaldi;
+    }
+
+    Deserializer TextSequenceDeserializer(const std::wstring& fileName, const std::wstring& vocabularyFile, const std::vector<std::pair<std::wstring, size_t>>& streams,
+                                          const std::wstring& unknownWord, const std::wstring& sentenceBegin, const std::wstring& sentenceEnd)
+    {
+        Deserializer text;
+        Dictionary input;
+        for (const auto& s : streams)
+        {
+            Dictionary stream;
+            stream[L"shift"] = s.second;
+            input[s.first] = stream;
+        }
+        text.Add(L"type", L"TextSequenceDeserializer", L"file", fileName, L"vocabulary", vocabularyFile, L"input", input);
+        if (!unknownWord.empty())
+            text[L"unknownWord"] = unknownWord;
+        if (!sentenceBegin.empty())
+            text[L"sentenceBegin"] = sentenceBegin;
+        if (!sentenceEnd.empty())
+            text[L"sentenceEnd"] = sentenceEnd;
+        return text;
+    }
+
     namespace Internal 
     {
 
@@ -532,15 +732,20 @@ namespace CNTK
             {
                 static const std::unordered_map<std::wstring, std::wstring> deserializerTypeToModule = {
                     { L"CNTKTextFormatDeserializer",   L"CNTKTextFormatReader" },
+                    { L"TextSequenceDeserializer",     L"CNTKTextFormatReader" },
                     { L"CNTKBinaryFormatDeserializer", L"CNTKBinaryReader" },
                     { L"ImageDeserializer",            L"ImageReader" },
                     { L"Base64ImageDeserializer",      L"ImageReader" },
+                    { L"ImagePackDeserializer",        L"ImageReader" },
                     { L"HTKFeatureDeserializer",       L"HTKDeserializers" },
                     { L"HTKMLFDeserializer",           L"HTKDeserializers" },
+                    { L"KaldiFeatureDeserializer",     L"HTKDeserializers" },
+                    { L"KaldiAlignmentDeserializer",   L"HTKDeserializers" },
                 };
 
                 auto deserializerTypeName = deserializerConfig[L"type"].Value<std::wstring>();
-                if (deserializerTypeName == L"ImageDeserializer" || deserializerTypeName == L"Base64ImageDeserializer")
+                if (deserializerTypeName == L"ImageDeserializer" || deserializerTypeName == L"Base64ImageDeserializer" ||
+                    deserializerTypeName == L"ImagePackDeserializer")
                 {
                     defaultMultithreaded = true;
                 }
@@ -10,6 +10,8 @@
 #include "Utils.h"
 #include "ReaderShim.h"
 #include "DataReader.h"
+#include <condition_variable>
+#include <deque>
 
 namespace CNTK
 {
@@ -66,4 +68,45 @@ namespace CNTK
         std::shared_ptr<ReaderShim<float>> m_shim;
         Microsoft::MSR::CNTK::StreamMinibatchInputs m_matrices;
     };
+
+    class StreamingMinibatchSourceImpl final : public StreamingMinibatchSource
+    {
+    public:
+        StreamingMinibatchSourceImpl(const StreamingMinibatchSourceConfig& configuration);
+
+        virtual const std::unordered_set<StreamInformation>& StreamInfos() override { return m_streamInfos; }
+
+        const std::unordered_map<StreamInformation, MinibatchData>& GetNextMinibatch(
+            size_t minibatchSizeInSequences,
+            size_t minibatchSizeInSamples,
+            size_t numberOfWorkers,
+            size_t workerRank,
+            const DeviceDescriptor& device = DeviceDescriptor::UseDefaultDevice()) override;
+
+        virtual bool AddRecord(const std::unordered_map<StreamInformation, NDArrayViewPtr>& record, Timestamp timestamp) override;
+        virtual void Close() override;
+        virtual const std::vector<Timestamp>& LastMinibatchTimestamps() const override { return m_timestamps; }
+
+    private:
+        struct Record
+        {
+            std::unordered_map<StreamInformation, NDArrayViewPtr> m_sequences;
+            size_t m_numberOfSamples;
+            Timestamp m_timestamp;
+            std::chrono::steady_clock::time_point m_arrival; // when it was added, which starts the deadline of its minibatch
+        };
+
+        std::unordered_set<StreamInformation> m_streamInfos;
+        const size_t m_maxQueuedRecords;
+        const std::chrono::milliseconds m_maxLatency;
+
+        std::mutex m_mutex;
+        std::condition_variable m_recordAdded;   // or closed
+        std::condition_variable m_recordRemoved; // or closed
+        std::deque<Record> m_records;
+        bool m_closed;
+
+        std::vector<Timestamp> m_timestamps;
+        std::unordered_map<StreamInformation, MinibatchData> m_minibatchData;
+    };
 }
@@ -0,0 +1,383 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include <cstring>
+#include "PipelinedQuantizedMPICommunicator.h"
+#include "PerformanceProfiler.h"
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace CNTK
+{
+    // the tags of the two exchanges of each value
+    static const int s_stripeTag = 0x51; // the stripes of the quantized local values, to the worker that sums them
+    static const int s_sumTag = 0x52;    // the quantized sums of the stripes, to all workers
+
+    QuantizedDistributedCommunicatorPtr PipelinedQuantizedMPICommunicator(bool zeroThresholdFor1Bit, size_t numQuantizationBits, size_t quantizationThresholdSizeInBytes)
+    {
+        return MakeSharedObject<PipelinedQuantizedMPICommunicatorImpl>(zeroThresholdFor1Bit, numQuantizationBits, quantizationThresholdSizeInBytes);
+    }
+
+    PipelinedQuantizedMPICommunicatorImpl::PipelinedQuantizedMPICommunicatorImpl(bool zeroThresholdFor1Bit, size_t numQuantizationBits, size_t quantizationThresholdSizeInBytes)
+        : m_zeroThresholdFor1Bit(zeroThresholdFor1Bit),
+          m_numQuantizationBits(numQuantizationBits),
+          m_quantizationThresholdSizeInBytes(quantizationThresholdSizeInBytes),
+          m_communicator(std::make_shared<MPICommunicatorImpl>())
+    {
+        if (numQuantizationBits == 0 || numQuantizationBits > 32)
+            InvalidArgument("PipelinedQuantizedMPICommunicator: the number of quantization bits must be between 1 and 32.");
+
+        m_mpi = MPIWrapper::GetInstance();
+    }
+
+    const std::unordered_set<DistributedWorkerDescriptor>& PipelinedQuantizedMPICommunicatorImpl::Workers() const
+    {
+        return m_communicator->Workers();
+    }
+
+    const DistributedWorkerDescriptor& PipelinedQuantizedMPICommunicatorImpl::CurrentWorker() const
+    {
+        return m_communicator->CurrentWorker();
+    }
+
+    DistributedCommunicatorPtr PipelinedQuantizedMPICommunicatorImpl::SubGroup(const std::unordered_set<DistributedWorkerDescriptor>& subGroupWorkers) const
+    {
+        return m_communicator->SubGroup(subGroupWorkers);
+    }
+
+    void PipelinedQuantizedMPICommunicatorImpl::Concatenate(const std::vector<ValuePtr>& values, std::vector<ValuePtr>& outValues, const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers)
+    {
+        m_communicator->Concatenate(values, outValues, sendToWorkers);
+    }
+
+    void PipelinedQuantizedMPICommunicatorImpl::Concatenate(const std::vector<NDArrayViewPtr>& input, std::vector<NDArrayViewPtr>& output, const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers)
+    {
+        m_communicator->Concatenate(input, output, sendToWorkers);
+    }
+
+    void PipelinedQuantizedMPICommunicatorImpl::Gather(const Dictionary& input, std::vector<DictionaryPtr>& output, const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers)
+    {
+        m_communicator->Gather(input, output, sendToWorkers);
+    }
+
+    void PipelinedQuantizedMPICommunicatorImpl::AggregateInPlace(const std::vector<NDArrayViewPtr>& values, const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers)
+    {
+        m_communicator->AggregateInPlace(values, sendToWorkers);
+    }
+
+    void PipelinedQuantizedMPICommunicatorImpl::Aggregate(const std::vector<NDArrayViewPtr>& inValues, std::vector<NDArrayViewPtr>& outValues, const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers)
+    {
+        m_communicator->Aggregate(inValues, outValues, sendToWorkers);
+    }
+
+    void PipelinedQuantizedMPICommunicatorImpl::Barrier()
+    {
+        m_communicator->Barrier();
+    }
+
+    void PipelinedQuantizedMPICommunicatorImpl::QuantizedAggregate(
+        const std::vector<NDArrayViewPtr>& inValues,
+        const std::vector<NDArrayViewPtr>& valueQuantizationResidues,
+        const std::vector<NDArrayViewPtr>& stripeQuantizationResidues,
+        std::vector<NDArrayViewPtr>& aggregatedOutputs,
+        std::vector<NDArrayViewPtr>& newQuantizationResidues,
+        std::vector<NDArrayViewPtr>& newStripeQuantizationResidues,
+        const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers)
+    {
+        if (aggregatedOutputs.empty())
+        {
+            for (const auto& value : inValues)
+                aggregatedOutputs.push_back(value->DeepClone());
+        }
+        else if (aggregatedOutputs.size() == inValues.size())
+        {
+            for (size_t i = 0; i < inValues.size(); i++)
+                aggregatedOutputs[i]->CopyFrom(*inValues[i]);
+        }
+        else
+        {
+            NOT_IMPLEMENTED;
+        }
+
+        auto clone = [](const std::vector<NDArrayViewPtr>& residues, std::vector<NDArrayViewPtr>& newResidues)
+        {
+            newResidues.resize(residues.size());
+            for (size_t i = 0; i < residues.size(); i++)
+                newResidues[i] = residues[i] ? residues[i]->DeepClone() : nullptr;
+        };
+        clone(valueQuantizationResidues, newQuantizationResidues);
+        clone(stripeQuantizationResidues, newStripeQuantizationResidues);
+
+        QuantizedAggregateInPlace(aggregatedOutputs, newQuantizationResidues, newStripeQuantizationResidues, sendToWorkers);
+    }
+
+    // Missing residues are created (zero), and the stripe residues are replaced if the number of workers has changed.
+    void PipelinedQuantizedMPICommunicatorImpl::QuantizedAggregateInPlace(
+        std::vector<NDArrayViewPtr>& inValues,
+        std::vector<NDArrayViewPtr>& valueQuantizationResidues,
+        std::vector<NDArrayViewPtr>& stripeQuantizationResidues,
+        const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers)
+    {
+        if (sendToWorkers.size() != Workers().size())
+            LogicError("PipelinedQuantizedMPICommunicator: aggregation to a subset of the workers is not supported.");
+
+        if (m_mpi->NumNodesInUse() == 1) // No need to aggregate anything.
+            return;
+
+        valueQuantizationResidues.resize(inValues.size());
+        stripeQuantizationResidues.resize(inValues.size());
+
+        std::vector<NDArrayViewPtr> unquantizedValues;
+        std::vector<size_t> floatIndices, doubleIndices;
+        for (size_t i = 0; i < inValues.size(); i++)
+        {
+            const auto& value = inValues[i];
+            if (value->GetStorageFormat() != StorageFormat::Dense)
+                RuntimeError("PipelinedQuantizedMPICommunicator: Aggregation for sparse matrices is currently not supported.");
+
+            if (value->Shape().TotalSize() * DataTypeSize(value->GetDataType()) < m_quantizationThresholdSizeInBytes)
+                unquantizedValues.push_back(value);
+            else if (value->GetDataType() == DataType::Float)
+                floatIndices.push_back(i);
+            else if (value->GetDataType() == DataType::Double)
+                doubleIndices.push_back(i);
+            else
+                LogicError("PipelinedQuantizedMPICommunicator: Unsupported DataType.");
+        }
+
+        // the values below the threshold are not worth the quantization error
+        if (!unquantizedValues.empty())
+            m_communicator->AggregateInPlace(unquantizedValues, sendToWorkers);
+
+        QuantizedAggregateInPlaceImpl<float>(floatIndices, inValues, valueQuantizationResidues, stripeQuantizationResidues);
+        QuantizedAggregateInPlaceImpl<double>(doubleIndices, inValues, valueQuantizationResidues, stripeQuantizationResidues);
+    }
+
+    template <>
+    std::vector<std::unique_ptr<PipelinedQuantizedMPICommunicatorImpl::QuantizedValue<float>>>& PipelinedQuantizedMPICommunicatorImpl::QuantizedValues<float>()
+    {
+        return m_floatValues;
+    }
+
+    template <>
+    std::vector<std::unique_ptr<PipelinedQuantizedMPICommunicatorImpl::QuantizedValue<double>>>& PipelinedQuantizedMPICommunicatorImpl::QuantizedValues<double>()
+    {
+        return m_doubleValues;
+    }
+
+    template <typename ElemType>
+    PipelinedQuantizedMPICommunicatorImpl::QuantizedValue<ElemType>& PipelinedQuantizedMPICommunicatorImpl::GetQuantizedValue(size_t index, const NDArrayViewPtr& value)
+    {
+        auto& quantizedValues = QuantizedValues<ElemType>();
+        if (quantizedValues.size() <= index)
+            quantizedValues.resize(index + 1);
+
+        auto matrix = GetWritableMatrix<ElemType>(value);
+        const size_t numRows = matrix->GetNumRows();
+        const size_t numCols = matrix->GetNumCols();
+        const int deviceId = matrix->GetDeviceId();
+        const size_t numWorkers = m_mpi->NumNodesInUse();
+        auto& quantizedValue = quantizedValues[index];
+        if (quantizedValue && quantizedValue->m_numRows == numRows && quantizedValue->m_numCols == numCols && quantizedValue->m_deviceId == deviceId &&
+            quantizedValue->m_stripeStart.size() == numWorkers + 1)
+            return *quantizedValue;
+
+        quantizedValue.reset(new QuantizedValue<ElemType>());
+        auto& q = *quantizedValue;
+        q.m_numRows = numRows;
+        q.m_numCols = numCols;
+        q.m_deviceId = deviceId;
+
+        for (size_t worker = 0; worker <= numWorkers; worker++)
+            q.m_stripeStart.push_back(worker * numCols / numWorkers);
+
+        q.m_valueQuantizer.reset(MatrixQuantizerImpl<ElemType>::Create(deviceId, true /*useAsync*/));
+        q.m_stripesUnquantizer.reset(MatrixQuantizerImpl<ElemType>::Create(deviceId, true /*useAsync*/));
+        q.m_stripeSumQuantizer.reset(MatrixQuantizerImpl<ElemType>::Create(deviceId, true /*useAsync*/));
+        q.m_valueUnquantizer.reset(MatrixQuantizerImpl<ElemType>::Create(deviceId, true /*useAsync*/));
+
+        // the quantized matrices are exchanged from pinned host memory
+        if (deviceId != CPUDEVICE)
+            q.m_allocator.reset(new CUDAPageLockedMemAllocator(deviceId));
+
+        q.m_quantizedValue.reset(new QuantizedMatrix<ElemType>(numRows, numCols, m_numQuantizationBits, CPUDEVICE, q.m_allocator.get()));
+        const size_t stripeColumns = q.StripeColumns(m_mpi->CurrentNodeRank());
+        if (stripeColumns > 0)
+        {
+            q.m_receivedStripes.reset(new QuantizedMatrix<ElemType>(numRows, stripeColumns * numWorkers, m_numQuantizationBits, CPUDEVICE, q.m_allocator.get()));
+            q.m_quantizedStripeSum.reset(new QuantizedMatrix<ElemType>(numRows, stripeColumns, m_numQuantizationBits, CPUDEVICE, q.m_allocator.get()));
+            q.m_unquantizedStripes.reset(new Matrix<ElemType>(numRows, stripeColumns * numWorkers, deviceId));
+            q.m_stripeSum.reset(new Matrix<ElemType>(numRows, stripeColumns, deviceId));
+        }
+        return q;
+    }
+
+    // The aggregation of each value goes through three steps, of which the exchanges overlap with the quantization of the
+    // other values:
+    //  1. quantize the value with its residue and send stripe s to worker s (SendStripes())
+    //  2. wait for the stripes from all workers, sum them, quantize the sum with the stripe residue and send it to all
+    //     workers (SumAndSendStripe())
+    //  3. wait for the sums of all stripes and unquantize them into the value.
+    // All workers unquantize the same quantized sums, so that they end up with the same values.
+    template <typename ElemType>
+    void PipelinedQuantizedMPICommunicatorImpl::QuantizedAggregateInPlaceImpl(const std::vector<size_t>& indices,
+                                                                              std::vector<NDArrayViewPtr>& values,
+                                                                              std::vector<NDArrayViewPtr>& valueQuantizationResidues,
+                                                                              std::vector<NDArrayViewPtr>& stripeQuantizationResidues)
+    {
+        if (indices.empty())
+            return;
+
+        auto profGradientAgg = Microsoft::MSR::CNTK::ScopeProfile(Microsoft::MSR::CNTK::profilerEvtMainGradient);
+
+        const size_t myRank = m_mpi->CurrentNodeRank();
+        std::vector<QuantizedValue<ElemType>*> pipeline;
+        for (size_t i : indices)
+        {
+            auto& q = GetQuantizedValue<ElemType>(i, values[i]);
+            pipeline.push_back(&q);
+
+            if (!valueQuantizationResidues[i])
+                valueQuantizationResidues[i] = MakeSharedObject<NDArrayView>(ElemType(0), values[i]->Shape(), values[i]->Device());
+
+            const size_t stripeColumns = q.StripeColumns(myRank);
+            const NDShape stripeShape = { q.m_numRows, stripeColumns };
+            if (stripeColumns > 0 && (!stripeQuantizationResidues[i] || stripeQuantizationResidues[i]->Shape() != stripeShape))
+                stripeQuantizationResidues[i] = MakeSharedObject<NDArrayView>(ElemType(0), stripeShape, values[i]->Device());
+        }
+
+        // the quantization runs on its own stream, which has to wait for the computation of the values
+        if (pipeline.front()->m_deviceId != CPUDEVICE)
+        {
+            std::unique_ptr<MatrixComputeStreamEvent> mainStreamSyncEvent(MatrixComputeStreamEvent::Create(pipeline.front()->m_deviceId));
+            mainStreamSyncEvent->SynchronizeQuantizationComputeStreamWithEvent<ElemType>();
+        }
+
+        auto quantize = [&](size_t k)
+        {
+            auto value = GetWritableMatrix<ElemType>(values[indices[k]]);
+            auto residue = GetWritableMatrix<ElemType>(valueQuantizationResidues[indices[k]]);
+            pipeline[k]->m_valueQuantizer->QuantizeAsync(*value, *residue, *pipeline[k]->m_quantizedValue, *residue, m_zeroThresholdFor1Bit);
+        };
+
+        // 1. the next value is quantized while the stripes of this one are sent
+        quantize(0);
+        for (size_t k = 0; k < pipeline.size(); k++)
+        {
+            pipeline[k]->m_valueQuantizer->WaitQuantizeAsyncDone();
+            SendStripes(*pipeline[k]);
+            if (k + 1 < pipeline.size())
+                quantize(k + 1);
+        }
+
+        // 2. the sums of the stripes of the earlier values are in flight while the stripes of the later ones arrive
+        for (size_t k = 0; k < pipeline.size(); k++)
+            SumAndSendStripe(*pipeline[k], stripeQuantizationResidues[indices[k]]);
+
+        // 3.
+        for (size_t k = 0; k < pipeline.size(); k++)
+        {
+            auto& q = *pipeline[k];
+            if (!q.m_requests.empty())
+                m_mpi->WaitAll(q.m_requests);
+            q.m_requests.clear();
+            q.m_valueUnquantizer->UnquantizeAsync(*q.m_quantizedValue, *GetWritableMatrix<ElemType>(values[indices[k]]), false /*add*/);
+        }
+        for (auto q : pipeline)
+            q->m_valueUnquantizer->WaitUnquantizeAsyncDone();
+    }
+
+    template <typename ElemType>
+    void PipelinedQuantizedMPICommunicatorImpl::SendStripes(QuantizedValue<ElemType>& q)
+    {
+        const size_t numWorkers = m_mpi->NumNodesInUse();
+        const size_t myRank = m_mpi->CurrentNodeRank();
+        const size_t columnSize = QuantizedColumn<ElemType>::QuantizedColumnSize(m_numQuantizationBits, q.m_numRows);
+        const size_t myStripeColumns = q.StripeColumns(myRank);
+
+        char* quantizedValue = q.m_quantizedValue->Buffer();
+        for (size_t worker = 0; worker < numWorkers; worker++)
+        {
+            char* received = myStripeColumns > 0 ? q.m_receivedStripes->Buffer() + worker * myStripeColumns * columnSize : nullptr;
+            if (worker == myRank)
+            {
+                if (myStripeColumns > 0)
+                    memcpy(received, quantizedValue + q.m_stripeStart[myRank] * columnSize, myStripeColumns * columnSize);
+                continue;
+            }
+
+            MPI_Request request;
+            if (q.StripeColumns(worker) > 0)
+            {
+                m_mpi->Isend(quantizedValue + q.m_stripeStart[worker] * columnSize, (int)(q.StripeColumns(worker) * columnSize), MPI_CHAR, (int)worker, s_stripeTag, &request)
+                    || MpiFail("PipelinedQuantizedMPICommunicator: MPI_Isend");
+                q.m_requests.push_back(request);
+            }
+            if (myStripeColumns > 0)
+            {
+                m_mpi->Irecv(received, (int)(myStripeColumns * columnSize), MPI_CHAR, (int)worker, s_stripeTag, &request)
+                    || MpiFail("PipelinedQuantizedMPICommunicator: MPI_Irecv");
+                q.m_requests.push_back(request);
+            }
+        }
+    }
+
+    template <typename ElemType>
+    void PipelinedQuantizedMPICommunicatorImpl::SumAndSendStripe(QuantizedValue<ElemType>& q, const NDArrayViewPtr& stripeResidue)
+    {
+        const size_t numWorkers = m_mpi->NumNodesInUse();
+        const size_t myRank = m_mpi->CurrentNodeRank();
+        const size_t columnSize = QuantizedColumn<ElemType>::QuantizedColumnSize(m_numQuantizationBits, q.m_numRows);
+        const size_t myStripeColumns = q.StripeColumns(myRank);
+
+        if (!q.m_requests.empty())
+            m_mpi->WaitAll(q.m_requests);
+        q.m_requests.clear();
+
+        // the sums are received into the buffer the stripes were sent from
+        char* quantizedSums = q.m_quantizedValue->Buffer();
+        if (myStripeColumns > 0)
+        {
+            q.m_stripesUnquantizer->UnquantizeAsync(*q.m_receivedStripes, *q.m_unquantizedStripes, false /*add*/);
+            q.m_stripesUnquantizer->WaitUnquantizeAsyncDone();
+
+            q.m_stripeSum->SetValue(q.m_unquantizedStripes->ColumnSlice(0, myStripeColumns));
+            for (size_t worker = 1; worker < numWorkers; worker++)
+                Matrix<ElemType>::ScaleAndAdd(1, q.m_unquantizedStripes->ColumnSlice(worker * myStripeColumns, myStripeColumns), *q.m_stripeSum);
+
+            if (q.m_deviceId != CPUDEVICE)
+            {
+                std::unique_ptr<MatrixComputeStreamEvent> mainStreamSyncEvent(MatrixComputeStreamEvent::Create(q.m_deviceId));
+                mainStreamSyncEvent->SynchronizeQuantizationComputeStreamWithEvent<ElemType>();
+            }
+
+            auto residue = GetWritableMatrix<ElemType>(stripeResidue);
+            q.m_stripeSumQuantizer->QuantizeAsync(*q.m_stripeSum, *residue, *q.m_quantizedStripeSum, *residue, m_zeroThresholdFor1Bit);
+            q.m_stripeSumQuantizer->WaitQuantizeAsyncDone();
+            memcpy(quantizedSums + q.m_stripeStart[myRank] * columnSize, q.m_quantizedStripeSum->Buffer(), myStripeColumns * columnSize);
+        }
+
+        for (size_t worker = 0; worker < numWorkers; worker++)
+        {
+            if (worker == myRank)
+                continue;
+
+            MPI_Request request;
+            if (myStripeColumns > 0)
+            {
+                m_mpi->Isend(quantizedSums + q.m_stripeStart[myRank] * columnSize, (int)(myStripeColumns * columnSize), MPI_CHAR, (int)worker, s_sumTag, &request)
+                    || MpiFail("PipelinedQuantizedMPICommunicator: MPI_Isend");
+                q.m_requests.push_back(request);
+            }
+            if (q.StripeColumns(worker) > 0)
+            {
+                m_mpi->Irecv(quantizedSums + q.m_stripeStart[worker] * columnSize, (int)(q.StripeColumns(worker) * columnSize), MPI_CHAR, (int)worker, s_sumTag, &request)
+                    || MpiFail("PipelinedQuantizedMPICommunicator: MPI_Irecv");
+                q.m_requests.push_back(request);
+            }
+        }
+    }
+}
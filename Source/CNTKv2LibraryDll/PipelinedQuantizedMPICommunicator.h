@@ -0,0 +1,138 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "CNTKLibrary.h"
+#include "DistributedCommunicator.h"
+#include "CUDAPageLockedMemAllocator.h"
+#include "MatrixQuantizerImpl.h"
+
+namespace CNTK
+{
+    ///
+    /// Quantized aggregation in two exchanges per value, as in 1-bit SGD: each worker quantizes its value (keeping the
+    /// quantization error in the value residue) and sends stripe s of its columns to worker s, which sums the stripes of
+    /// all workers, quantizes the sum (keeping the error in the stripe residue) and sends it back to all workers.
+    /// The values are pipelined: the next value is quantized on the GPU while the stripes of the previous ones are in
+    /// flight, and the sums are unquantized as they arrive. Values smaller than the quantization threshold are aggregated
+    /// without quantization.
+    ///
+    class PipelinedQuantizedMPICommunicatorImpl final : public QuantizedDistributedCommunicator
+    {
+    public:
+        PipelinedQuantizedMPICommunicatorImpl(bool zeroThresholdFor1Bit, size_t numQuantizationBits, size_t quantizationThresholdSizeInBytes);
+
+        const std::unordered_set<DistributedWorkerDescriptor>& Workers() const override;
+
+        const DistributedWorkerDescriptor& CurrentWorker() const override;
+
+        DistributedCommunicatorPtr SubGroup(const std::unordered_set<DistributedWorkerDescriptor>& subGroupWorkers) const override;
+
+        void Concatenate(
+            const std::vector<ValuePtr>& values,
+            std::vector<ValuePtr>& outValues,
+            const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers) override;
+
+        void Concatenate(
+            const std::vector<NDArrayViewPtr>& input,
+            std::vector<NDArrayViewPtr>& output,
+            const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers) override;
+
+        void Gather(
+            const Dictionary& input,
+            std::vector<DictionaryPtr>& output,
+            const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers) override;
+
+        void AggregateInPlace(
+            const std::vector<NDArrayViewPtr>& values,
+            const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers) override;
+
+        void Aggregate(
+            const std::vector<NDArrayViewPtr>& inValues,
+            std::vector<NDArrayViewPtr>& outValues,
+            const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers) override;
+
+        void Barrier() override;
+
+        void QuantizedAggregate(
+            const std::vector<NDArrayViewPtr>& inValues,
+            const std::vector<NDArrayViewPtr>& valueQuantizationResidues,
+            const std::vector<NDArrayViewPtr>& stripeQuantizationResidues,
+            std::vector<NDArrayViewPtr>& aggregatedOutputs,
+            std::vector<NDArrayViewPtr>& newQuantizationResidues,
+            std::vector<NDArrayViewPtr>& newStripeQuantizationResidues,
+            const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers) override;
+
+        void QuantizedAggregateInPlace(
+            std::vector<NDArrayViewPtr>& inValues,
+            std::vector<NDArrayViewPtr>& valueQuantizationResidues,
+            std::vector<NDArrayViewPtr>& stripeQuantizationResidues,
+            const std::unordered_set<DistributedWorkerDescriptor>& sendToWorkers) override;
+
+    private:
+        // The buffers for the quantized aggregation of one value (reused as long as the value keeps its shape).
+        template <typename ElemType>
+        struct QuantizedValue
+        {
+            size_t m_numRows;
+            size_t m_numCols;
+            int m_deviceId;
+            std::vector<size_t> m_stripeStart; // first column of the stripe of each worker, and the number of columns at the end
+
+            // one per operation, since each uses temporary GPU buffers of its own size
+            std::unique_ptr<Microsoft::MSR::CNTK::MatrixQuantizerImpl<ElemType>> m_valueQuantizer;
+            std::unique_ptr<Microsoft::MSR::CNTK::MatrixQuantizerImpl<ElemType>> m_stripesUnquantizer;
+            std::unique_ptr<Microsoft::MSR::CNTK::MatrixQuantizerImpl<ElemType>> m_stripeSumQuantizer;
+            std::unique_ptr<Microsoft::MSR::CNTK::MatrixQuantizerImpl<ElemType>> m_valueUnquantizer;
+
+            std::unique_ptr<Microsoft::MSR::CNTK::CUDAPageLockedMemAllocator> m_allocator;
+            std::unique_ptr<Microsoft::MSR::CNTK::QuantizedMatrix<ElemType>> m_quantizedValue;     // the quantized local value, and then the quantized sums of all stripes
+            std::unique_ptr<Microsoft::MSR::CNTK::QuantizedMatrix<ElemType>> m_receivedStripes;    // the stripe of this worker from all workers, one after the other
+            std::unique_ptr<Microsoft::MSR::CNTK::QuantizedMatrix<ElemType>> m_quantizedStripeSum;
+            std::unique_ptr<Microsoft::MSR::CNTK::Matrix<ElemType>> m_unquantizedStripes;
+            std::unique_ptr<Microsoft::MSR::CNTK::Matrix<ElemType>> m_stripeSum;
+
+            std::vector<MPI_Request> m_requests;
+
+            size_t StripeColumns(size_t worker) const { return m_stripeStart[worker + 1] - m_stripeStart[worker]; }
+        };
+
+        template <typename ElemType>
+        std::vector<std::unique_ptr<QuantizedValue<ElemType>>>& QuantizedValues();
+
+        template <typename ElemType>
+        QuantizedValue<ElemType>& GetQuantizedValue(size_t index, const NDArrayViewPtr& value);
+
+        template <typename ElemType>
+        void QuantizedAggregateInPlaceImpl(const std::vector<size_t>& indices,
+                                           std::vector<NDArrayViewPtr>& values,
+                                           std::vector<NDArrayViewPtr>& valueQuantizationResidues,
+                                           std::vector<NDArrayViewPtr>& stripeQuantizationResidues);
+
+        // the steps of the aggregation of one value, see QuantizedAggregateInPlaceImpl()
+        template <typename ElemType>
+        void SendStripes(QuantizedValue<ElemType>& quantizedValue);
+
+        template <typename ElemType>
+        void SumAndSendStripe(QuantizedValue<ElemType>& quantizedValue, const NDArrayViewPtr& stripeResidue);
+
+        template <typename ElemType>
+        std::shared_ptr<Microsoft::MSR::CNTK::Matrix<ElemType>> GetWritableMatrix(const NDArrayViewPtr& arrayView)
+        {
+            return arrayView->GetWritableMatrix<ElemType>();
+        }
+
+        const bool m_zeroThresholdFor1Bit;
+        const size_t m_numQuantizationBits;
+        const size_t m_quantizationThresholdSizeInBytes;
+
+        std::shared_ptr<MPICommunicatorImpl> m_communicator; // for everything but the quantized values
+        Microsoft::MSR::CNTK::MPIWrapperPtr m_mpi;
+
+        std::vector<std::unique_ptr<QuantizedValue<float>>> m_floatValues;
+        std::vector<std::unique_ptr<QuantizedValue<double>>> m_doubleValues;
+    };
+}
@@ -87,6 +87,8 @@ namespace CNTK
     /*static*/ const std::wstring PrimitiveFunction::AttributeNameRecurrentOp = L"recurrentOp";
     /*static*/ const std::wstring PrimitiveFunction::AttributeNameRngSeed = L"rngSeed";
     /*static*/ const std::wstring PrimitiveFunction::AttributeNameRngOffset = L"rngOffset";
+    /*static*/ const std::wstring PrimitiveFunction::AttributeNameRecompute = L"recompute";
+    /*static*/ const std::wstring PrimitiveFunction::AttributeNameOffload = L"offload";
     /*static*/ const std::wstring PrimitiveFunction::AttributeNameUnpoolingWindowShape = L"unpoolingWindowShape";
     /*static*/ const std::wstring PrimitiveFunction::AttributeNameSubstitutionPenalty = L"SubstitutionPenalty";
     /*static*/ const std::wstring PrimitiveFunction::AttributeNameDeletionPenalty = L"DeletionPenalty";
@@ -1288,4 +1290,17 @@ namespace CNTK
         m_attributes[AttributeNameRngSeed] = seed;
         m_dirtyAttributes.insert(AttributeNameRngSeed);
     }
+
+    // Note: this affects the memory plan of the computation network, so unlike the attributes above
+    // it is only picked up when the network is created for the function, not for an existing one.
+    void PrimitiveFunction::SetRecompute(bool recompute)
+    {
+        m_attributes[AttributeNameRecompute] = recompute;
+    }
+
+    // same as for SetRecompute()
+    void PrimitiveFunction::SetOffload(bool offload)
+    {
+        m_attributes[AttributeNameOffload] = offload;
+    }
 }
@@ -245,6 +245,8 @@ namespace CNTK
         static const std::wstring AttributeNameReductionKeepDimensions;
         static const std::wstring AttributeNameRngSeed;
         static const std::wstring AttributeNameRngOffset;
+        static const std::wstring AttributeNameRecompute;
+        static const std::wstring AttributeNameOffload;
         static const std::wstring AttributeNameBidirectional;
         static const std::wstring AttributeNameNumLayers;
         static const std::wstring AttributeNameHiddenSize;
@@ -752,6 +754,10 @@ namespace CNTK
 
         void SetRandomSeed(size_t seed);
 
+        void SetRecompute(bool recompute);
+
+        void SetOffload(bool offload);
+
     private:
         PrimitiveOpType m_op;
         // Increasing s_serializationVersion every time we add more ops allows us to print 
@@ -14,6 +14,11 @@
 
 #ifdef _MSC_VER
 #include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #pragma warning(push)
@@ -23,6 +28,13 @@
 #include <google/protobuf/arena.h>
 #pragma warning(pop)
 
+#ifdef _MSC_VER
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h> // (after protobuf, which has members named like Windows macros, e.g. GetMessage)
+#endif
+
 namespace CNTK
 {
 
@@ -31,6 +43,13 @@ namespace CNTK
     static const uint32 MAGIC_NUMBER = 0x636e746bU;
     static const uint32 BLOCK_SIZE = 8 << 10; // 8Kb;
 
+    // mappable model format: header (magic number, format version, metadata byte size as uint64), the metadata
+    // protobuf without NDArrayView payload, and then the payload of each NDArrayView, uncompressed and aligned
+    static const uint32 MAPPABLE_MAGIC_NUMBER = 0x6d746e63U;
+    static const uint32 MAPPABLE_FORMAT_VERSION = 1;
+    static const size_t MAPPABLE_HEADER_SIZE = 2 * sizeof(uint32) + sizeof(uint64);
+    static const size_t MAPPABLE_ALIGNMENT = 64;
+
     static void SetUTF8Locale()
     {
 #ifndef _MSC_VER
@@ -124,6 +143,9 @@ namespace CNTK
         friend class Dictionary;
         friend class DictionaryValue;
 
+        friend void SaveMappableModel(const Dictionary& model, const std::wstring& filename);
+        friend void LoadMappableModel(const char* buffer, size_t bufferSize, const std::function<void(const Dictionary&)>& use);
+
         Serializer(const Dictionary& dict);
         Serializer(const DictionaryValue& dict);
 
@@ -158,6 +180,9 @@ namespace CNTK
 
         bool ReadNDArrayViewData(io::ZeroCopyInputStream& input);
 
+        void WriteMappable(const std::wstring& filename);
+        bool ReadMappable(const char* buffer, size_t bufferSize, Dictionary& dict);
+
         size_t GetTotalByteSize() 
         {
             return m_byteSize + m_proto->ByteSizeLong();
@@ -285,6 +310,11 @@ namespace CNTK
         Message* m_proto;
         std::vector<std::pair<NDArrayView*, proto::NDArrayView*>> m_arrayViews;
         size_t m_byteSize {0};
+
+        // when reading the mappable format: NDArrayViews alias the payload, which is consumed in order
+        const char* m_mappedBuffer {nullptr};
+        size_t m_mappedSize {0};
+        size_t m_mappedOffset {0};
     };
 
 
@@ -430,6 +460,20 @@ namespace CNTK
         std::unique_ptr<NDShape> shape(CreateFromProto(src.shape()));
         auto dataType = FromProtoType(src.data_type());
         auto storageFormat = FromProtoType(src.storage_format());
+
+        if (m_mappedBuffer != nullptr)
+        {
+            if (storageFormat != StorageFormat::Dense)
+                RuntimeError("The mappable model format only supports dense NDArrayViews.");
+            size_t numBytes = shape->TotalSize() * DataTypeSize(dataType);
+            size_t offset = (m_mappedOffset + MAPPABLE_ALIGNMENT - 1) / MAPPABLE_ALIGNMENT * MAPPABLE_ALIGNMENT;
+            if (offset > m_mappedSize || numBytes > m_mappedSize - offset)
+                RuntimeError("The model is truncated: NDArrayView data at offset %zu exceeds its size (%zu bytes).", offset, m_mappedSize);
+            m_mappedOffset = offset + numBytes;
+            // read-only alias of the mapping; the caller copies what it keeps (see LoadMappableModel())
+            return new NDArrayView(dataType, *shape, const_cast<char*>(m_mappedBuffer) + offset, numBytes, DeviceDescriptor::CPUDevice(), /*readOnly=*/true);
+        }
+
         NDArrayView* dst = new NDArrayView(dataType, storageFormat, *shape, DeviceDescriptor::CPUDevice());
 
         if (dataType == DataType::Float)
@@ -651,6 +695,182 @@ namespace CNTK
 #endif
     }
 
+    void Serializer::WriteMappable(const std::wstring& filename)
+    {
+        size_t metadataSize = m_proto->ByteSizeLong();
+        if (metadataSize >= static_cast<size_t>(INT_MAX))
+            RuntimeError("The model metadata exceeds the protobuf size limit (%zu bytes).", metadataSize);
+
+        auto fd = GetFileDescriptor(filename, false);
+        {
+            io::FileOutputStream output(fd);
+            io::CodedOutputStream codedOutput(&output);
+            codedOutput.WriteLittleEndian32(MAPPABLE_MAGIC_NUMBER);
+            codedOutput.WriteLittleEndian32(MAPPABLE_FORMAT_VERSION);
+            codedOutput.WriteLittleEndian64(metadataSize);
+            m_proto->SerializeToCodedStream(&codedOutput);
+
+            // the payload, raw in the (little-endian) memory layout of the NDArrayViews
+            static const char padding[MAPPABLE_ALIGNMENT] = {};
+            size_t offset = MAPPABLE_HEADER_SIZE + metadataSize;
+            for (auto& pair : m_arrayViews)
+            {
+                const auto& src = *(pair.first);
+                if (src.GetStorageFormat() != StorageFormat::Dense)
+                    RuntimeError("The mappable model format only supports dense NDArrayViews.");
+
+                size_t paddingSize = (MAPPABLE_ALIGNMENT - offset % MAPPABLE_ALIGNMENT) % MAPPABLE_ALIGNMENT;
+                codedOutput.WriteRaw(padding, (int)paddingSize);
+                offset += paddingSize;
+
+                const char* data = (src.GetDataType() == DataType::Float) ? reinterpret_cast<const char*>(src.DataBuffer<float>())
+                                                                          : reinterpret_cast<const char*>(src.DataBuffer<double>());
+                size_t numBytes = src.Shape().TotalSize() * DataTypeSize(src.GetDataType());
+                for (size_t done = 0; done < numBytes;) // (WriteRaw() takes an int)
+                {
+                    int chunkSize = (int)(std::min)(numBytes - done, (size_t)(1 << 30));
+                    codedOutput.WriteRaw(data + done, chunkSize);
+                    done += chunkSize;
+                }
+                offset += numBytes;
+            }
+        }
+#ifdef _MSC_VER
+        _close(fd);
+#else
+        close(fd);
+#endif
+    }
+
+    bool Serializer::ReadMappable(const char* buffer, size_t bufferSize, Dictionary& dict)
+    {
+        if (bufferSize < MAPPABLE_HEADER_SIZE)
+            return false;
+        uint32 magic, version;
+        uint64 metadataSize;
+        auto header = reinterpret_cast<const uint8*>(buffer);
+        io::CodedInputStream::ReadLittleEndian32FromArray(header, &magic);
+        io::CodedInputStream::ReadLittleEndian32FromArray(header + sizeof(uint32), &version);
+        io::CodedInputStream::ReadLittleEndian64FromArray(header + 2 * sizeof(uint32), &metadataSize);
+        if (magic != MAPPABLE_MAGIC_NUMBER)
+            return false;
+        if (version > MAPPABLE_FORMAT_VERSION)
+            RuntimeError("The model has mappable format version %d, but this version only supports up to %d.", (int)version, (int)MAPPABLE_FORMAT_VERSION);
+        if (metadataSize > bufferSize - MAPPABLE_HEADER_SIZE || metadataSize >= static_cast<uint64>(INT_MAX))
+            return false;
+
+        m_proto = Arena::CreateMessage<proto::Dictionary>(&m_arena);
+        io::CodedInputStream codedInput(header + MAPPABLE_HEADER_SIZE, (int)metadataSize);
+        codedInput.SetTotalBytesLimit((int)metadataSize, (int)metadataSize);
+        if (!m_proto->ParseFromCodedStream(&codedInput) || !codedInput.ConsumedEntireMessage())
+            return false;
+
+        m_mappedBuffer = buffer;
+        m_mappedSize = bufferSize;
+        m_mappedOffset = MAPPABLE_HEADER_SIZE + metadataSize;
+        Copy(*dynamic_cast<proto::Dictionary*>(m_proto), dict);
+        return true;
+    }
+
+    // read-only mapping of a whole file into memory
+    class MappedFile
+    {
+    public:
+        MappedFile(const std::wstring& filename)
+        {
+#ifdef _MSC_VER
+            HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                RuntimeError("Cannot open file '%S' for reading.", filename.c_str());
+            LARGE_INTEGER size;
+            m_mapping = nullptr;
+            if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+                m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            CloseHandle(file); // (the mapping keeps the file open)
+            m_data = m_mapping ? static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+            if (m_data == nullptr)
+            {
+                if (m_mapping)
+                    CloseHandle(m_mapping);
+                RuntimeError("Cannot map file '%S' into memory.", filename.c_str());
+            }
+            m_size = (size_t)size.QuadPart;
+#else
+            int fd = open(ToString(filename).c_str(), O_RDONLY);
+            if (fd < 0)
+                RuntimeError("Cannot open file '%S' for reading.", filename.c_str());
+            struct stat fileInfo;
+            void* data = MAP_FAILED;
+            if (fstat(fd, &fileInfo) == 0 && fileInfo.st_size > 0)
+                data = mmap(nullptr, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd); // (the mapping keeps the file open)
+            if (data == MAP_FAILED)
+                RuntimeError("Cannot map file '%S' into memory.", filename.c_str());
+            m_data = static_cast<const char*>(data);
+            m_size = (size_t)fileInfo.st_size;
+            madvise(data, m_size, MADV_SEQUENTIAL);
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifdef _MSC_VER
+            UnmapViewOfFile(m_data);
+            CloseHandle(m_mapping);
+#else
+            munmap(const_cast<char*>(m_data), m_size);
+#endif
+        }
+
+        const char* Data() const { return m_data; }
+        size_t Size() const { return m_size; }
+
+    private:
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+#ifdef _MSC_VER
+        HANDLE m_mapping;
+#endif
+        const char* m_data;
+        size_t m_size;
+    };
+
+    void SaveMappableModel(const Dictionary& model, const std::wstring& filename)
+    {
+        Serializer(model).WriteMappable(filename);
+    }
+
+    bool IsMappableModel(const char* buffer, size_t bufferSize)
+    {
+        uint32 magic = 0;
+        if (bufferSize >= sizeof(magic))
+            io::CodedInputStream::ReadLittleEndian32FromArray(reinterpret_cast<const uint8*>(buffer), &magic);
+        return magic == MAPPABLE_MAGIC_NUMBER;
+    }
+
+    bool IsMappableModel(const std::wstring& filename)
+    {
+        char buffer[sizeof(uint32)];
+        auto stream = GetFstream(filename, true);
+        stream->read(buffer, sizeof(buffer));
+        return stream->gcount() == sizeof(buffer) && IsMappableModel(buffer, sizeof(buffer));
+    }
+
+    void LoadMappableModel(const char* buffer, size_t bufferSize, const std::function<void(const Dictionary&)>& use)
+    {
+        Dictionary model;
+        if (!Serializer().ReadMappable(buffer, bufferSize, model))
+            RuntimeError("Failed to parse the mappable model.");
+        use(model);
+    }
+
+    void LoadMappableModel(const std::wstring& filename, const std::function<void(const Dictionary&)>& use)
+    {
+        MappedFile file(filename);
+        LoadMappableModel(file.Data(), file.Size(), use);
+    }
+
     bool ParseMessage(io::ZeroCopyInputStream& input, Message& msg)
     {
         uint32 prefix = 0, limit = INT_MAX;;
@@ -50,6 +50,15 @@ namespace CNTK
     const std::wstring udfFactoryMethodNameKey = L"deserialize_method";
     const std::wstring nativeUDFKey = L"native";
 
+    // The mappable model format (ModelFormat::CNTKv2Mappable): the Dictionary as protobuf without the NDArrayView data,
+    // followed by the data of all NDArrayViews, uncompressed and aligned, so that loading can map the file into memory.
+    void SaveMappableModel(const Dictionary& model, const std::wstring& filename);
+    bool IsMappableModel(const char* buffer, size_t bufferSize);
+    bool IsMappableModel(const std::wstring& filename);
+    // 'use' is called with the model while its NDArrayViews alias the mapped file (or the buffer), and must copy what it keeps.
+    void LoadMappableModel(const std::wstring& filename, const std::function<void(const Dictionary&)>& use);
+    void LoadMappableModel(const char* buffer, size_t bufferSize, const std::function<void(const Dictionary&)>& use);
+
     template <typename T> 
     inline std::string GetVersionsString(size_t currentVersion, size_t dictVersion)
     {
@@ -360,11 +360,21 @@ namespace CNTK
     }
 
     void Trainer::SaveCheckpoint(const std::wstring& modelFilePath, Dictionary externalState)
+    {
+        SnapshotCheckpoint(modelFilePath, externalState)();
+
+        // all workers need to sync up after saving model to avoid read-after-write hazard
+        // i.e. one worker is in the middle of write while another tries to read
+        if (m_distributed)
+            MPICommunicator()->Barrier();
+    }
+
+    std::function<void()> Trainer::SnapshotCheckpoint(const std::wstring& modelFilePath, const Dictionary& externalState)
     {
         auto learnersState = m_parameterLearners->CreateCheckpoint();
 
         if (!m_distributed)
-            return Save(modelFilePath, learnersState, externalState);
+            return Snapshot(modelFilePath, learnersState, externalState);
 
         auto compositeFunction = dynamic_cast<CompositeFunction*>(m_combinedTrainingFunction.get());
 
@@ -386,34 +396,46 @@ namespace CNTK
         }
 
         if (communicator->CurrentWorker().IsMain())
-            Save(modelFilePath, learnersState, externalState, aggregatedState);
+            return Snapshot(modelFilePath, learnersState, externalState, aggregatedState);
 
-        // all workers need to sync up after saving model to avoid read-after-write hazard
-        // i.e. one worker is in the middle of write while another tries to read
-        communicator->Barrier();
+        return [] {};
     }
 
-    void Trainer::Save(const std::wstring& modelFilePath, const std::vector<DictionaryValue>& learnerState, const Dictionary& externalState, const Dictionary& distributedState)
+    // The NDArrayViews of a serialized Dictionary are copies in CPU memory, so the writer returned here
+    // is not affected by further training, and may run on another thread.
+    std::function<void()> Trainer::Snapshot(const std::wstring& modelFilePath, const std::vector<DictionaryValue>& learnerState, const Dictionary& externalState, const Dictionary& distributedState)
     {
-        std::wstring tempModelFile = modelFilePath + L".tmp";
-        Dictionary state;
-        state[versionPropertyName] = trainerCheckpointVersion;
-        state[learnersPropertyName] = learnerState;
-        state[externalStatePropertyName] = externalState;
-        state[distributedStatePropertyName] = distributedState;
+        auto state = std::make_shared<Dictionary>();
+        (*state)[versionPropertyName] = trainerCheckpointVersion;
+        (*state)[learnersPropertyName] = learnerState;
+        (*state)[externalStatePropertyName] = externalState;
+        (*state)[distributedStatePropertyName] = distributedState;
 
-        m_combinedTrainingFunction->Save(tempModelFile);
-        std::wstring trainerStateCheckpointFilePath = GetTrainerStateCheckpointFilePath(modelFilePath);
-        std::wstring tempCheckpointFile = trainerStateCheckpointFilePath + L".tmp";
+        auto model = std::make_shared<Dictionary>(m_combinedTrainingFunction->Serialize());
 
-        state.Save(tempCheckpointFile);
-
-        // The return value is ignored here.
-        _wunlink(modelFilePath.c_str());
-        _wunlink(trainerStateCheckpointFilePath.c_str());
-
-        renameOrDie(tempModelFile, modelFilePath);
-        renameOrDie(tempCheckpointFile, trainerStateCheckpointFilePath);
+        return [modelFilePath, model, state]()
+        {
+            std::wstring tempModelFile = modelFilePath + L".tmp";
+            std::wstring trainerStateCheckpointFilePath = GetTrainerStateCheckpointFilePath(modelFilePath);
+            std::wstring tempCheckpointFile = trainerStateCheckpointFilePath + L".tmp";
+
+            // the model and the trainer state are serialized and written in parallel
+            auto modelWritten = std::async(std::launch::async, [&]()
+            {
+                auto stream = GetFstream(tempModelFile, false);
+                *stream << *model;
+                stream->flush();
+            });
+            state->Save(tempCheckpointFile);
+            modelWritten.get();
+
+            // The return value is ignored here.
+            _wunlink(modelFilePath.c_str());
+            _wunlink(trainerStateCheckpointFilePath.c_str());
+
+            renameOrDie(tempModelFile, modelFilePath);
+            renameOrDie(tempCheckpointFile, trainerStateCheckpointFilePath);
+        };
     }
 
     Dictionary Trainer::RestoreFromCheckpoint(const std::wstring& modelFilePath)
@@ -9,6 +9,7 @@
 #include "CNTKLibrary.h"
 #include "fileutil.h"
 #include "PerformanceProfiler.h"
+#include "Utils.h"
 
 namespace CNTK
 {
@@ -26,12 +27,19 @@ namespace CNTK
         const std::wstring& checkPointFileName,
         size_t checkpointFrequencyInSamples,
         bool restoreFromCheckpointIfExists,
-        bool preserveAllCheckpoints) :
+        bool preserveAllCheckpoints,
+        bool asyncCheckpointing,
+        size_t maxPendingCheckpoints) :
         m_preserveAll(preserveAllCheckpoints),
         m_restore(restoreFromCheckpointIfExists),
         m_fileName(checkPointFileName),
-        m_frequency(checkpointFrequencyInSamples)
+        m_frequency(checkpointFrequencyInSamples),
+        m_async(asyncCheckpointing),
+        m_maxPending(maxPendingCheckpoints)
     {
+        if (asyncCheckpointing && maxPendingCheckpoints == 0)
+            InvalidArgument("The maximum number of pending checkpoints must not be zero if asynchronous checkpointing is specified.");
+
         if (m_fileName.empty())
         {
             if (checkpointFrequencyInSamples != 0 && checkpointFrequencyInSamples != std::numeric_limits<size_t>::max())
@@ -164,6 +172,18 @@ namespace CNTK
                 [this](size_t currentIndex, const DeviceDescriptor& d) { return CrossValidate(currentIndex, d); } });
     }
 
+    TrainingSession::~TrainingSession()
+    {
+        try
+        {
+            WaitForPendingCheckpoints();
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "~TrainingSession: Writing a checkpoint failed: %s\n", e.what());
+        }
+    }
+
     void TrainingSession::Train(const DeviceDescriptor& computeDevice)
     {
         std::unordered_map<Variable, ValuePtr> minibatch;
@@ -224,6 +244,8 @@ namespace CNTK
             }
         }
 
+        WaitForPendingCheckpoints();
+
         // In case of incremental - save final checkpoint.
         // This is required only when we keep all existing checkpoints, otherwise 
         // The checkpoint was already saved with the proper name.
@@ -242,7 +264,9 @@ namespace CNTK
         if (m_cv.m_source) // Running cross validation
         {
             std::unordered_map<Variable, ValuePtr> minibatch;
-            double accumulatedError = 0;
+            // The error is accumulated on the compute device, so that it is transferred only once at the end
+            // instead of synchronizing with the device after each minibatch.
+            auto accumulatedError = std::make_shared<Accumulator>();
             size_t totalNumberOfSamples = 0;
             size_t numberOfMinibatches = 0;
 
@@ -254,12 +278,10 @@ namespace CNTK
                 size_t samplesLeft = m_cv.m_maxSamples <= totalNumberOfSamples ? 0 : m_cv.m_maxSamples - totalNumberOfSamples;
                 GetCrossValidationMinibatch(minibatch, std::min(m_cv.m_mbSize[totalNumberOfSamples], samplesLeft), computeDevice);                
 
-                // TODO: it may be slow to rely on TestMinibatch to return error each time, since it may require transfer
-                // of error from the GPU each time, accumulatedError can be allocated on GPU
                 shouldCV = m_trainer->TestMinibatch(minibatch, errorAndCount, computeDevice, m_numberOfWorkers != 1);
                 if (shouldCV)
                 {
-                    accumulatedError += errorAndCount.first->AsScalar<double>();
+                    accumulatedError->Update(errorAndCount.first, computeDevice);
                     totalNumberOfSamples += errorAndCount.second;
                     numberOfMinibatches++;
                 }                
@@ -267,7 +289,8 @@ namespace CNTK
 
             m_cv.m_source->RestoreFromCheckpoint(checkpoint);
             Trainer()->SummarizeTestProgress();
-            return OnCrossValidationEnd(currentIndex, accumulatedError / totalNumberOfSamples, totalNumberOfSamples, numberOfMinibatches);
+            double error = numberOfMinibatches > 0 ? accumulatedError->AsScalar<double>() : 0;
+            return OnCrossValidationEnd(currentIndex, error / totalNumberOfSamples, totalNumberOfSamples, numberOfMinibatches);
         }
         else // Only invoking the callback.
         {
@@ -348,6 +371,7 @@ namespace CNTK
 
     void TrainingSession::RestoreFromCheckpoint(const std::wstring& checkpointFileName)
     {
+        WaitForPendingCheckpoints();
         Dictionary externalState = Trainer()->RestoreFromCheckpoint(checkpointFileName);
         m_source->RestoreFromCheckpoint(externalState[s_trainingMinibatchSource].Value<Dictionary>());
     }
@@ -361,10 +385,29 @@ namespace CNTK
         wstring checkpointFile = m_checkpoint.m_fileName;
         if (m_checkpoint.m_preserveAll)
             checkpointFile += std::to_wstring(currentIndex);
-        Trainer()->SaveCheckpoint(checkpointFile, externalState);
+
+        if (m_checkpoint.m_async)
+        {
+            WaitForPendingCheckpoints(m_checkpoint.m_maxPending - 1);
+            // Only the snapshot is taken on the training thread; the files are written in the background.
+            m_pendingCheckpoints.push_back(std::async(std::launch::async, Trainer()->SnapshotCheckpoint(checkpointFile, externalState)));
+        }
+        else
+            Trainer()->SaveCheckpoint(checkpointFile, externalState);
         OnCheckpointEnd(currentIndex);
     }
 
+    // Waits until at most maxPending checkpoints are being written. Rethrows the error of a failed write.
+    void TrainingSession::WaitForPendingCheckpoints(size_t maxPending)
+    {
+        while (m_pendingCheckpoints.size() > maxPending)
+        {
+            auto checkpoint = std::move(m_pendingCheckpoints.front());
+            m_pendingCheckpoints.erase(m_pendingCheckpoints.begin());
+            checkpoint.get();
+        }
+    }
+
     void TrainingSession::SaveFinalCheckpoint()
     {
         Dictionary externalState;
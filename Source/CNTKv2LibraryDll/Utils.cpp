@@ -877,6 +877,20 @@ namespace CNTK
         return GetValueObjectFromCNTKImplMatrixAndMBLayout(varShape, var.DynamicAxes(), matrix, layout, readOnly);
     }
 
+    template <typename ElementType>
+    NDArrayViewPtr Utils::GetNDArrayViewAliasOfCNTKImplMatrix(const NDShape& sampleShape, const Matrix<ElementType>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/)
+    {
+        auto viewShape = sampleShape;
+        if (layout != nullptr)
+            viewShape = viewShape.AppendShape(NDShape({ layout->GetNumParallelSequences(), layout->GetNumTimeSteps() }));
+
+        if (matrix.GetNumElements() != viewShape.TotalSize())
+            LogicError("Unexpected matrix size: The number (%d) of elements in the matrix does not match the size (%d) of the shape '%S' of its view", (int)matrix.GetNumElements(), (int)viewShape.TotalSize(), viewShape.AsString().c_str());
+
+        auto tensorView = new TensorView<ElementType>(std::make_shared<Matrix<ElementType>>(matrix.AsReference()), AsTensorViewShape(viewShape));
+        return MakeSharedObject<NDArrayView>(AsDataType<ElementType>(), AsDeviceDescriptor(matrix.GetDeviceId()), AsStorageFormat(matrix.GetFormat()), viewShape, readOnly, tensorView);
+    }
+
     NDMaskPtr CreateMask(const std::vector<size_t>& sequenceLengths, const std::vector<bool>& sequenceStartFlags, const DeviceDescriptor& device)
     {
         size_t numSequences = sequenceLengths.size();
@@ -1060,6 +1074,9 @@ namespace CNTK
     template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<float>(const Variable& var, const ComputationNodeBasePtr& computationNode, const Matrix<float>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/);
     template ValuePtr Utils::GetValueObjectFromCNTKImplMatrixAndMBLayout<double>(const Variable& var, const ComputationNodeBasePtr& computationNode, const Matrix<double>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/);
 
+    template NDArrayViewPtr Utils::GetNDArrayViewAliasOfCNTKImplMatrix<float>(const NDShape& sampleShape, const Matrix<float>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/);
+    template NDArrayViewPtr Utils::GetNDArrayViewAliasOfCNTKImplMatrix<double>(const NDShape& sampleShape, const Matrix<double>& matrix, const MBLayoutPtr& layout, bool readOnly /*= true*/);
+
     void Accumulator::Update(const ValuePtr& delta, const DeviceDescriptor& device)
     {
         if (!delta)
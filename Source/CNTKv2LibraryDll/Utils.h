@@ -691,6 +691,11 @@ namespace CNTK
 
         template <typename ElementType>
         static ValuePtr GetValueObjectFromCNTKImplMatrixAndMBLayout(const Variable& var, const Microsoft::MSR::CNTK::ComputationNodeBasePtr& computationNode, const Microsoft::MSR::CNTK::Matrix<ElementType>& matrix, const Microsoft::MSR::CNTK::MBLayoutPtr& layout, bool readOnly = true);
+
+        // Returns an NDArrayView that aliases the storage of the matrix (no copy is made), in the packed form of the
+        // engine: the sample shape, followed by the parallel sequences and the time steps of the layout if it has one.
+        template <typename ElementType>
+        static NDArrayViewPtr GetNDArrayViewAliasOfCNTKImplMatrix(const NDShape& sampleShape, const Microsoft::MSR::CNTK::Matrix<ElementType>& matrix, const Microsoft::MSR::CNTK::MBLayoutPtr& layout, bool readOnly = true);
     };
 
     template <typename Container>
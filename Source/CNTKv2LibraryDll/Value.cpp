@@ -17,9 +17,71 @@
 #include "CommonMatrix.h"
 #include "CPUSparseMatrix.h"
 #include "RecurrentNodes.h"
+#include "CUDAPageLockedMemAllocator.h"
 
 namespace CNTK
 {
+    //
+    // Pool of page-locked host buffers, for copying the data of GPU Values to the host with full DMA speed.
+    // A buffer is taken for the duration of a copy, and put back for reuse by later copies from the same device.
+    //
+    class PinnedStagingBufferPool
+    {
+    public:
+        typedef std::shared_ptr<void> Buffer;
+
+        static PinnedStagingBufferPool& Instance()
+        {
+            static PinnedStagingBufferPool pool;
+            return pool;
+        }
+
+        // returns a buffer of at least 'size' bytes
+        Buffer Acquire(int deviceId, size_t& size)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto& freeBuffers = m_freeBuffers[deviceId];
+                for (auto iter = freeBuffers.begin(); iter != freeBuffers.end(); ++iter)
+                {
+                    if (iter->second >= size)
+                    {
+                        auto buffer = iter->first;
+                        size = iter->second;
+                        freeBuffers.erase(iter);
+                        return buffer;
+                    }
+                }
+            }
+
+            // round up to a power of 2, so that buffers are reused for outputs of varying size
+            size_t allocationSize = s_minBufferSize;
+            while (allocationSize < size)
+                allocationSize *= 2;
+            size = allocationSize;
+            return Buffer(Microsoft::MSR::CNTK::CUDAPageLockedMemAllocator::Malloc(allocationSize, deviceId),
+                          [deviceId](void* p) { Microsoft::MSR::CNTK::CUDAPageLockedMemAllocator::Free(p, deviceId); });
+        }
+
+        void Release(int deviceId, const Buffer& buffer, size_t size)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto& freeBuffers = m_freeBuffers[deviceId];
+            freeBuffers.push_back({ buffer, size });
+            // keep the largest ones
+            std::sort(freeBuffers.begin(), freeBuffers.end(), [](const std::pair<Buffer, size_t>& a, const std::pair<Buffer, size_t>& b) { return a.second < b.second; });
+            if (freeBuffers.size() > s_maxFreeBuffersPerDevice)
+                freeBuffers.erase(freeBuffers.begin());
+        }
+
+    private:
+        static const size_t s_minBufferSize = 4096;
+        static const size_t s_maxFreeBuffersPerDevice = 4;
+
+        std::mutex m_mutex;
+        std::map<int, std::vector<std::pair<Buffer, size_t>>> m_freeBuffers; // by size, ascending
+    };
+
     Value::Value(const NDArrayViewPtr& data)
         : Value(data, nullptr)
     {
@@ -193,7 +255,7 @@ namespace CNTK
         if (numSequences == 1)
         {
             if (createNewCopy)
-                valueData = sequences[0]->DeepClone();
+                valueData = sequences[0]->DeepClone(device, readOnly); // (copying right to the device)
             else
                 valueData = sequences[0];
 
@@ -321,6 +383,13 @@ namespace CNTK
                             batchData.size(), shapeSize, sampleShape.AsString().c_str());
 
         auto numOfSequences = batchData.size() / shapeSize;
+        if (!sampleShape.HasUnboundDimension() && (numOfSequences > 0))
+        {
+            // All sequences have length 1, so the buffer can be copied to the device as it is
+            NDArrayView batchView(sampleShape.AppendShape({ 1, numOfSequences }), batchData.data(), batchData.size(), DeviceDescriptor::CPUDevice());
+            return MakeSharedObject<Value>(batchView.DeepClone(device, readOnly));
+        }
+
         std::vector<NDArrayViewPtr> sequencesView(numOfSequences);
         for (size_t i = 0; i < numOfSequences; i++)
         {
@@ -343,10 +412,41 @@ namespace CNTK
         auto sequenceLength = sequenceData.size() / shapeSize;
         std::vector<NDArrayViewPtr> sequencesView(1);
         auto sequenceDataShape = sampleShape.AppendShape({ sequenceLength });
-        sequencesView[0] = MakeSharedObject<NDArrayView>(sequenceDataShape, sequenceData);
+        // (an alias of the vector, which Create copies)
+        sequencesView[0] = MakeSharedObject<NDArrayView>(sequenceDataShape, sequenceData.data(), sequenceData.size(), DeviceDescriptor::CPUDevice());
         return Create(sampleShape, sequencesView, { sequenceStartFlag }, device, readOnly, /*createNewCopy =*/ true);
     }
 
+    template <typename ElementType>
+    /*static*/ ValuePtr Value::CreateBatch(const NDShape& sampleShape, const ElementType* batchData, size_t numElements, const DeviceDescriptor& device)
+    {
+        if (sampleShape.HasUnboundDimension())
+            InvalidArgument("Value::CreateBatch: The sample shape '%S' must be fully defined to create a Value from a buffer.", sampleShape.AsString().c_str());
+
+        auto shapeSize = sampleShape.TotalSize();
+        if ((numElements == 0) || (numElements % shapeSize != 0))
+            InvalidArgument("The number of elements (%zu) in the batch data buffer must be a non-zero multiple of the size (%zu) of the sample shape '%S'.",
+                            numElements, shapeSize, sampleShape.AsString().c_str());
+
+        auto batchView = MakeSharedObject<NDArrayView>(sampleShape.AppendShape({ 1, numElements / shapeSize }), batchData, numElements, device);
+        return MakeSharedObject<Value>(batchView);
+    }
+
+    template <typename ElementType>
+    /*static*/ ValuePtr Value::CreateSequence(const NDShape& sampleShape, const ElementType* sequenceData, size_t numElements, bool sequenceStartFlag, const DeviceDescriptor& device)
+    {
+        if (sampleShape.HasUnboundDimension())
+            InvalidArgument("Value::CreateSequence: The sample shape '%S' must be fully defined to create a Value from a buffer.", sampleShape.AsString().c_str());
+
+        auto shapeSize = sampleShape.TotalSize();
+        if ((numElements == 0) || (numElements % shapeSize != 0))
+            InvalidArgument("The number of elements (%zu) in the sequence data buffer must be a non-zero multiple of the size (%zu) of the sample shape '%S'.",
+                            numElements, shapeSize, sampleShape.AsString().c_str());
+
+        auto sequenceView = MakeSharedObject<NDArrayView>(sampleShape.AppendShape({ numElements / shapeSize }), sequenceData, numElements, device);
+        return Create(sampleShape, { sequenceView }, { sequenceStartFlag }, device, /*readOnly =*/ true, /*createNewCopy =*/ false);
+    }
+
     template <typename ElementType>
     /*static*/ ValuePtr Value::CreateBatch(size_t dimension, const std::vector<size_t>& batchData, const DeviceDescriptor& device, bool readOnly/* = false*/)
     {
@@ -522,10 +622,14 @@ namespace CNTK
         // Copy data to the CPU device if required.
         const ValueType *valueData;
         NDArrayViewPtr cpuArrayView;
+        PinnedStagingBufferPool::Buffer stagingBuffer;
+        size_t stagingBufferSize = 0;
         if (Device().Type() == DeviceKind::GPU)
         {
             // TODO: leverage sparse if the original NDArrayView is in spase.
-            cpuArrayView = MakeSharedObject<NDArrayView>(GetDataType(), Shape(), DeviceDescriptor::CPUDevice());
+            stagingBufferSize = Shape().TotalSize() * DataTypeSize(GetDataType());
+            stagingBuffer = PinnedStagingBufferPool::Instance().Acquire(Device().Id(), stagingBufferSize);
+            cpuArrayView = MakeSharedObject<NDArrayView>(GetDataType(), Shape(), stagingBuffer.get(), stagingBufferSize, DeviceDescriptor::CPUDevice());
             cpuArrayView->CopyFrom(*Data());
         }
         else if (Device().Type() == DeviceKind::CPU)
@@ -570,6 +674,12 @@ namespace CNTK
                 DirectCopy<ValueType, DestType>(valueData + seqStart * sampleSize, sequences[seqIndex].size(), sequences[seqIndex]);
             }
         }
+
+        if (stagingBuffer)
+        {
+            cpuArrayView = nullptr;
+            PinnedStagingBufferPool::Instance().Release(Device().Id(), stagingBuffer, stagingBufferSize);
+        }
     }
 
     std::pair<size_t, size_t> Value::GetSequenceAndBatchLength(const Variable& outputVariable)
@@ -757,6 +867,10 @@ namespace CNTK
     template /*static*/ CNTK_API ValuePtr Value::CreateBatch<double>(const NDShape& sampleShape, const std::vector<double>& batchData, const DeviceDescriptor& device, bool readOnly /*= false */);
     template /*static*/ CNTK_API ValuePtr Value::CreateSequence<float>(const NDShape& sampleShape, const std::vector<float>& sequenceData, bool sequenceStartFlag, const DeviceDescriptor& device, bool readOnly /*= false */);
     template /*static*/ CNTK_API ValuePtr Value::CreateSequence<double>(const NDShape& sampleShape, const std::vector<double>& sequenceData, bool sequenceStartFlag, const DeviceDescriptor& device, bool readOnly /*= false */);
+    template /*static*/ CNTK_API ValuePtr Value::CreateBatch<float>(const NDShape& sampleShape, const float* batchData, size_t numElements, const DeviceDescriptor& device);
+    template /*static*/ CNTK_API ValuePtr Value::CreateBatch<double>(const NDShape& sampleShape, const double* batchData, size_t numElements, const DeviceDescriptor& device);
+    template /*static*/ CNTK_API ValuePtr Value::CreateSequence<float>(const NDShape& sampleShape, const float* sequenceData, size_t numElements, bool sequenceStartFlag, const DeviceDescriptor& device);
+    template /*static*/ CNTK_API ValuePtr Value::CreateSequence<double>(const NDShape& sampleShape, const double* sequenceData, size_t numElements, bool sequenceStartFlag, const DeviceDescriptor& device);
     template /*static*/ CNTK_API ValuePtr Value::CreateBatch<float>(size_t dimension, const std::vector<size_t>& batchData, const DeviceDescriptor& device, bool readOnly/* = false*/);
     template /*static*/ CNTK_API ValuePtr Value::CreateBatch<double>(size_t dimension, const std::vector<size_t>& batchData, const DeviceDescriptor& device, bool readOnly/* = false*/);
     template /*static*/ CNTK_API ValuePtr Value::CreateSequence<float>(size_t dimension, const std::vector<size_t>& sequenceData, bool sequenceStartFlag, const DeviceDescriptor& device, bool readOnly/* = false*/);
@@ -65,6 +65,14 @@ namespace CNTK
         return clonedVariable;
     }
 
+    Variable Variable::Clone(const DeviceDescriptor& device) const
+    {
+        Variable clonedVariable;
+        clonedVariable.m_dataFields = m_dataFields->Clone(&device);
+
+        return clonedVariable;
+    }
+
     const Variable& Variable::BlockFunctionVariableMapping() const
     {
         return m_dataFields->m_blockFunctionVariableMapping;
@@ -222,7 +230,7 @@ namespace CNTK
             return nullptr;
     }
 
-    std::shared_ptr<VariableFields> VariableFields::Clone() const
+    std::shared_ptr<VariableFields> VariableFields::Clone(const DeviceDescriptor* device) const
     {
         if (Owner() != nullptr)
             InvalidArgument("Output variable '%S' cannot be cloned.", AsString().c_str());
@@ -232,7 +240,7 @@ namespace CNTK
             m_varKind,
             m_dataType,
             m_ownerFunction,
-            (m_value) ? m_value->DeepClone() : nullptr,
+            (m_value) ? m_value->DeepClone(device ? *device : m_value->Device(), m_value->IsReadOnly()) : nullptr,
             m_needsGradient,
             m_dynamicAxes,
             m_isSparse,
@@ -240,7 +248,7 @@ namespace CNTK
             Internal::GenerateUid(m_varKind));
 
         if (m_valueInitializer)
-            clone->SetValueInitialization(*m_valueInitializer, *m_valueInitializationDevice);
+            clone->SetValueInitialization(*m_valueInitializer, device ? *device : *m_valueInitializationDevice);
 
         return clone;
     }
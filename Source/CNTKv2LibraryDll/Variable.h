@@ -63,7 +63,8 @@ namespace CNTK
         }
 
         std::wstring AsString() const;
-        std::shared_ptr<VariableFields> Clone() const;
+        // A null device keeps the value on its current device.
+        std::shared_ptr<VariableFields> Clone(const DeviceDescriptor* device = nullptr) const;
         FunctionPtr Owner() const;
 
         CNTK_API void SetValueInitialization(const ParameterInitializer& initializationConfig, const DeviceDescriptor& device);
@@ -7,11 +7,15 @@
 #include "CNTKLibraryInternals.h"
 
 #include <cassert>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
 #include <ctime>
+#include <deque>
 #include <iomanip>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 #pragma warning(push)
 #pragma warning(disable : 4244 4245)
@@ -74,11 +78,202 @@ namespace CNTK
             return record;
         }
 
+        // The background thread of a TensorBoardFileWriter. It owns the event file, and executes the commands
+        // (open a file, append records to it, close it) in the order in which they were queued.
+        // After a failure, records are dropped until the next file is opened.
+        class TensorBoardFileWriter::EventFileWriter
+        {
+        public:
+            EventFileWriter()
+                : m_failed(false),
+                m_stop(false),
+                m_busy(false),
+                m_file(NULL),
+                m_fileName(),
+                m_skipRecords(false),
+                m_thread(&EventFileWriter::Run, this)
+            {
+            }
+
+            ~EventFileWriter()
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_cv.notify_all();
+                m_thread.join();
+                CloseFile();
+            }
+
+            void Open(const std::wstring& fileName)   { Enqueue(Command{ Command::Open, fileName, std::string() }); }
+            void Write(std::string&& records)         { Enqueue(Command{ Command::Write, std::wstring(), std::move(records) }); }
+            void Close()                              { Enqueue(Command{ Command::Close, std::wstring(), std::string() }); }
+
+            // Wait until all queued commands have been executed.
+            void Drain()
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this] { return m_queue.empty() && !m_busy; });
+            }
+
+            // Returns whether a command has failed since the last call, and resets the failure.
+            bool TakeFailure()
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                bool failed = m_failed;
+                m_failed = false;
+                return failed;
+            }
+
+        private:
+            struct Command
+            {
+                enum Kind { Open, Write, Close } kind;
+                std::wstring fileName; // for Open
+                std::string records;   // for Write
+            };
+
+            // Logging is expected to be far less frequent than the writes take, so a few commands suffice to absorb
+            // a slow disk; beyond that, the caller is blocked rather than buffering without bound.
+            static const size_t MaxQueuedCommands = 16;
+
+            void Enqueue(Command&& command)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_cv.wait(lock, [this] { return m_queue.size() < MaxQueuedCommands; });
+                    m_queue.push_back(std::move(command));
+                }
+                m_cv.notify_all();
+            }
+
+            void Run()
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                for (;;)
+                {
+                    m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+                    if (m_queue.empty()) // (m_stop, and nothing left to do)
+                        break;
+
+                    Command command = std::move(m_queue.front());
+                    m_queue.pop_front();
+                    m_busy = true;
+                    lock.unlock();
+                    m_cv.notify_all(); // (there is room in the queue again)
+
+                    bool success = Execute(command);
+
+                    lock.lock();
+                    m_failed |= !success;
+                    m_busy = false;
+                    m_cv.notify_all();
+                }
+            }
+
+            bool Execute(const Command& command)
+            {
+                switch (command.kind)
+                {
+                case Command::Open:
+                {
+                    bool success = CloseFile();
+                    m_skipRecords = false;
+                    try
+                    {
+                        msra::files::make_intermediate_dirs(command.fileName);
+                        m_file = fopenOrDie(ToString(command.fileName), "wb");
+                        m_fileName = command.fileName;
+                    }
+                    catch (const std::exception&)
+                    {
+                        fprintf(stderr, "TensorBoardFileWriter: Unable to open the event file (%ls).", command.fileName.c_str());
+                        m_skipRecords = true;
+                        return false;
+                    }
+                    return success;
+                }
+                case Command::Write:
+                    if (m_skipRecords || m_file == NULL)
+                    {
+                        return true; // (the records of a failed file are dropped; the failure was already reported)
+                    }
+
+                    try
+                    {
+                        fwriteOrDie(command.records.data(), sizeof(command.records[0]), command.records.size(), m_file);
+                    }
+                    catch (const std::exception&)
+                    {
+                        // Close the existing file. The failure is reported by the next Flush() or Close(), and
+                        // subsequent writes will then create a new file.
+                        fprintf(stderr,
+                            "TensorBoardFileWriter: Unable to write to the currently open file. "
+                            "Subsequent writes will attempt to re-open a new one. (%ls)", m_fileName.c_str());
+                        CloseFile();
+                        m_skipRecords = true;
+                        return false;
+                    }
+
+                    if (fflush(m_file))
+                    {
+                        fprintf(stderr, "TensorBoardFileWriter: Error flushing the event file (%ls).", m_fileName.c_str());
+                        return false;
+                    }
+                    return true;
+
+                case Command::Close:
+                    return CloseFile();
+                }
+                return false;
+            }
+
+            bool CloseFile()
+            {
+                if (m_file == NULL)
+                {
+                    return true;
+                }
+
+                bool success = true;
+                if (fclose(m_file))
+                {
+                    fprintf(stderr,
+                            "TensorBoardFileWriter: Error closing the previous event file (%ls).", m_fileName.c_str());
+                    success = false;
+                }
+
+                m_file = NULL;
+                m_fileName.clear();
+                return success;
+            }
+
+            // shared with the calling thread, guarded by m_mutex
+            std::mutex m_mutex;
+            std::condition_variable m_cv;
+            std::deque<Command> m_queue;
+            bool m_failed;
+            bool m_stop;
+            bool m_busy;
+
+            // owned by the background thread
+            FILE* m_file;
+            std::wstring m_fileName;
+            bool m_skipRecords;
+
+            std::thread m_thread; // (last, so that the state above is initialized before the thread starts)
+        };
+
+        // Hand the pending records over to the background writer once they exceed this size, even without a Flush().
+        static const size_t MaxPendingRecordBytes = 1 << 20;
+
         TensorBoardFileWriter::TensorBoardFileWriter(const std::wstring& dir, const FunctionPtr& modelToVisualize)
             : m_model(modelToVisualize),
             m_dir(dir),
-            m_file(NULL),
-            m_fileName()
+            m_fileName(),
+            m_pending(),
+            m_writer(new EventFileWriter())
         {
         }
 
@@ -88,14 +283,17 @@ namespace CNTK
         {
         }
 
+        TensorBoardFileWriter::~TensorBoardFileWriter()
+        {
+            Close();
+        }
+
         void TensorBoardFileWriter::Init()
         {
             time_t time = std::time(0);
             std::wstring filePath = GetNewFilePath(m_dir, time);
 
-            msra::files::make_intermediate_dirs(filePath);
-
-            m_file = fopenOrDie(ToString(filePath), "wb");
+            m_writer->Open(filePath);
             m_fileName = filePath;
 
             // Write the first record with the current version, and flush
@@ -107,7 +305,8 @@ namespace CNTK
                 WriteModel();
             }
 
-            Flush();
+            m_writer->Write(std::move(m_pending));
+            m_pending.clear();
         }
 
         void TensorBoardFileWriter::WriteValue(const std::wstring& name, float value, uint64_t step)
@@ -145,7 +344,7 @@ namespace CNTK
 
         void TensorBoardFileWriter::WriteRecord(const std::string& data)
         {
-            if (m_file == NULL)
+            if (m_fileName.empty())
             {
                 Init();
             }
@@ -159,22 +358,14 @@ namespace CNTK
             char footer[sizeof(uint32_t)];
             Encode(footer, GetMaskedCrc(data.data(), data.size()));
 
-            try
-            {
-                // Record = Header + Data + Footer.
-                fwriteOrDie(header, sizeof(header[0]), sizeof(header), m_file);
-                fwriteOrDie(data.data(), sizeof(data[0]), data.size(), m_file);
-                fwriteOrDie(footer, sizeof(footer[0]), sizeof(footer), m_file);
-            }
-            catch (const std::runtime_error&)
+            // Record = Header + Data + Footer.
+            m_pending.append(header, sizeof(header));
+            m_pending.append(data);
+            m_pending.append(footer, sizeof(footer));
+
+            if (m_pending.size() >= MaxPendingRecordBytes)
             {
-                // Close the existing file.
-                // If the exception was caught upstream, a new file will be created on subsequent writes.
-                fprintf(stderr,
-                    "TensorBoardFileWriter: Unable to write to the currently open file. "
-                    "Subsequent writes will attempt to re-open a new one. (%ls)", m_fileName.c_str());
-                Close();
-                throw;
+                Flush();
             }
         }
 
@@ -188,38 +379,48 @@ namespace CNTK
             WriteRecord(Serialize(event));
         }
 
+        bool TensorBoardFileWriter::CheckWriterSucceeded()
+        {
+            if (!m_writer->TakeFailure())
+            {
+                return true;
+            }
+
+            // The background writer has closed the file (or could not open it); start a new one on the next write.
+            m_pending.clear();
+            m_fileName.clear();
+            return false;
+        }
+
         bool TensorBoardFileWriter::Flush()
         {
-            if (m_file == NULL)
+            if (m_fileName.empty())
             {
                 return false;
             }
 
-            if (fflush(m_file))
+            if (!m_pending.empty())
             {
-                fprintf(stderr, "TensorBoardFileWriter: Error flushing the event file (%ls).", m_fileName.c_str());
-                return false;
+                m_writer->Write(std::move(m_pending));
+                m_pending.clear();
             }
 
-            return true;
+            return CheckWriterSucceeded();
         }
 
         bool TensorBoardFileWriter::Close()
         {
-            if (m_file == NULL)
+            if (m_fileName.empty())
             {
                 return false;
             }
 
-            bool success = Flush();
-            if (fclose(m_file))
-            {
-                fprintf(stderr,
-                        "TensorBoardFileWriter: Error closing the previous event file (%ls).", m_fileName.c_str());
-                success = false;
-            }
+            Flush();
+            m_writer->Close();
+            m_writer->Drain();
 
-            m_file = NULL;
+            bool success = CheckWriterSucceeded();
+            m_pending.clear();
             m_fileName.clear();
             return success;
         }
@@ -48,6 +48,8 @@ int bestGPUDummy = 42; // put something into this CPP, as to avoid a linker warn
 
 #include <memory>
 #include "CrossProcessMutex.h"
+#include "GpuTopology.h"
+#include "MPIWrapper.h"
 
 // ---------------------------------------------------------------------------
 // BestGpu class
@@ -110,6 +112,7 @@ public:
     void AllowAll();                                                                          // reset to allow all GPUs (no allowed list)
     bool UseMultiple();                                                                       // using multiple GPUs?
     int GetDevice(BestGpuFlags flags = bestGpuNormal);                                        // get a single device
+    int GetDeviceForLocalRank(size_t localRank, size_t numLocalRanks, bool lock);             // get the device of one of the ranks on this host
     static const int AllDevices = -1;                                                         // can be used to specify all GPUs in GetDevices() call
     static const int RequeryDevices = -2;                                                     // Requery refreshing statistics and picking the same number as last query
     static const int MininumCCMajorForGpu = 3;                                                // cntk supports GPUs with Compute Capability > 3.0
@@ -156,13 +159,29 @@ static DEVICEID_TYPE SelectDevice(DEVICEID_TYPE deviceId, bool bLockGPU, const i
                 s_bestGpu->DisallowUnsupportedDevices();
             }
 
-            s_bestDeviceId = (DEVICEID_TYPE)s_bestGpu->GetDevice(BestGpuFlags(bLockGPU ? (bestGpuAvoidSharing | bestGpuExclusiveLock) : bestGpuAvoidSharing));
+            auto mpi = MPIWrapper::GetInstance();
+            if (GpuTopology::IsEnabled() && mpi && mpi->NumLocalRanks() > 1)
+                s_bestDeviceId = (DEVICEID_TYPE)s_bestGpu->GetDeviceForLocalRank(mpi->LocalRank(), mpi->NumLocalRanks(), bLockGPU);
+            else
+                s_bestDeviceId = (DEVICEID_TYPE)s_bestGpu->GetDevice(BestGpuFlags(bLockGPU ? (bestGpuAvoidSharing | bestGpuExclusiveLock) : bestGpuAvoidSharing));
             // TODO: Do we need to hold this pointer at all? We will only query it once. Or is it used to hold lock to a GPU?
         }
         // already chosen
         deviceId = s_bestDeviceId;
     }
 
+    // bind the main thread, and with it the threads it creates later (e.g. the prefetch threads of the readers), to the
+    // CPUs closest to the GPU
+    static bool threadBound = false;
+    if (GpuTopology::IsEnabled() && deviceId >= 0 && !threadBound)
+    {
+        threadBound = true;
+        if (GpuTopology::BindCurrentThreadToDevice(deviceId))
+            fprintf(stderr, "SelectDevice: bound to the CPUs closest to GPU %d.\n", (int)deviceId);
+        else
+            fprintf(stderr, "SelectDevice: could not bind to the CPUs closest to GPU %d.\n", (int)deviceId);
+    }
+
     return deviceId;
 }
 
@@ -255,6 +274,7 @@ DEVICEID_TYPE DeviceFromConfig(const ScriptableObjects::IConfigRecord& config)
 {
     intargvector excludedDevices = ConfigArray(config(L"excludedDevices", ""), ':', false);
     bool bLockGPU = config(L"lockGPU", true);
+    GpuTopology::SetEnabled(config(L"topologyAwareGpuPlacement", false));
     // we need to deal with the old CNTK config semantics where 'deviceId' can be either a string or an int
     auto valpp = config.Find(L"deviceId");
     if (!valpp)
@@ -282,6 +302,7 @@ DEVICEID_TYPE DeviceFromConfig(const ConfigParameters& config)
     intargvector excludedDevices = ConfigArray(config("excludedDevices", ""), ':', false);
     ConfigValue val = config("deviceId", "auto");
     bool bLockGPU = config(L"lockGPU", true);
+    GpuTopology::SetEnabled(config(L"topologyAwareGpuPlacement", false));
 
     if (EqualCI(val, "cpu"))  return SelectDevice(CPUDEVICE, false, excludedDevices);
     else if (EqualCI(val, "auto")) return SelectDevice(DEVICEID_AUTO, bLockGPU, excludedDevices);
@@ -422,6 +443,37 @@ int BestGpu::GetDevice(BestGpuFlags bestFlags)
     return best[0];
 }
 
+// GetDeviceForLocalRank - Determine the device of one of the ranks on this host
+// The allowed devices are ordered by their topology (see GpuTopology::RingOrder), and the ranks get them in that order,
+// so that ranks next to each other (which are neighbours in the rings of the aggregation) are on GPUs next to each other.
+// All ranks of the host must use the same allowed devices. Unlike GetDevice(), this does not look at the load of the GPUs.
+int BestGpu::GetDeviceForLocalRank(size_t localRank, size_t numLocalRanks, bool lock)
+{
+    std::vector<int> devices;
+    for (ProcessorData* pd : m_procData)
+    {
+        if (DeviceAllowed(pd->deviceId))
+            devices.push_back(pd->deviceId);
+    }
+
+    if (devices.empty())
+        RuntimeError("Device selection: No eligible device found.");
+
+    if (numLocalRanks > devices.size())
+        fprintf(stderr, "WARNING: Device selection: %d ranks on this host share %d GPUs.\n", (int)numLocalRanks, (int)devices.size());
+
+    std::sort(devices.begin(), devices.end());
+    devices = GpuTopology::RingOrder(devices);
+    int deviceId = devices[localRank % devices.size()];
+
+    // as in GetDevices(), respect the exclusive locks of others even if we do not lock the GPU ourselves
+    if (!LockDevice(deviceId, /*trial=*/!lock))
+        RuntimeError("Device selection: GPU %d chosen for local rank %d is locked by another process.", deviceId, (int)localRank);
+
+    fprintf(stderr, "Device selection: local rank %d of %d uses GPU %d.\n", (int)localRank, (int)numLocalRanks, deviceId);
+    return deviceId;
+}
+
 // SetAllowedDevices - set the allowed devices array up
 // devices - vector of allowed devices
 void BestGpu::SetAllowedDevices(const std::vector<int>& devices)
@@ -269,6 +269,19 @@ bool DataReader::GetMinibatch(StreamMinibatchInputs& matrices)
     return bRet;
 }
 
+// GetStreamDescriptions - Get the streams of all underlying readers
+// deviceId - [in] device of the matrices to read the streams into
+std::vector<InputStreamDescription> DataReader::GetStreamDescriptions(int deviceId)
+{
+    std::vector<InputStreamDescription> streams;
+    for (size_t i = 0; i < m_ioNames.size(); i++)
+    {
+        auto readerStreams = m_dataReaders[m_ioNames[i]]->GetStreamDescriptions(deviceId);
+        streams.insert(streams.end(), readerStreams.begin(), readerStreams.end());
+    }
+    return streams;
+}
+
 // GetMinibatch4SE - Get the next minibatch for SE training, including lattice, labels and phone boundary
 // latticeinput - lattice for each utterances in this minibatch
 // uids - lables stored in size_t vector instead of ElemType matrix
@@ -30,6 +30,7 @@
 
 #define PCLOSE_ERROR -1
 #define WRITE_BUFFER_SIZE (1024 * 1024)
+#define SEQUENTIAL_BUFFER_SIZE (8 * 1024 * 1024)
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -147,6 +148,19 @@ void File::Init(const wchar_t* filename, int fileOptions)
                     m_file = fopenOrDie(filename, options.c_str());
                     m_seekable = true;
                 });
+    if (fileOptions & fileOptionsSequential)
+        SetBuffer(SEQUENTIAL_BUFFER_SIZE); // OK if it fails
+}
+
+// Replace the stdio buffer of the file by one of the given size. This must be done before the first read or write.
+// We pass our own buffer, since e.g. glibc ignores the size in setvbuf() when no buffer is given.
+int File::SetBuffer(size_t size)
+{
+    std::unique_ptr<char[]> buffer(new char[size]);
+    int rc = setvbuf(m_file, buffer.get(), _IOFBF, size);
+    if (rc == 0)
+        m_buffer = std::move(buffer); // the previous one (if any) is no longer used
+    return rc;
 }
 
 // determine the directory for a given pathname
@@ -656,7 +670,9 @@ int File::EndOfLineOrEOF(bool skip)
 // Buffer write stream
 int File::Setvbuf()
 {
-    return setvbuf(this->m_file, NULL, _IOFBF, WRITE_BUFFER_SIZE);
+    if (m_buffer) // already has a (larger) buffer from fileOptionsSequential
+        return 0;
+    return SetBuffer(WRITE_BUFFER_SIZE);
 }
 
 // Get a marker from the file
@@ -16,6 +16,11 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
     std::atomic<bool> Globals::m_enableShareNodeValueMatrices(true);
     std::atomic<bool> Globals::m_optimizeGradientAccumulation(true);
+    std::atomic<bool> Globals::m_enableParallelTraversal(false);
+    std::atomic<bool> Globals::m_useCounterBasedRandomInit(false);
+    std::atomic<bool> Globals::m_useCounterBasedRandomStreams(false);
+    std::atomic<int> Globals::m_numReaderThreads(0);
+    std::atomic<double> Globals::m_sparseProductDensity(0);
 
     // Note: this is a map that transfers the old reader and writer names to
     //       the new naming scheme
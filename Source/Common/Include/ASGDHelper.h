@@ -6,6 +6,7 @@
 
 #include <list>
 #include "ComputationNetwork.h"
+#include "MPIWrapper.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -62,6 +63,9 @@ ASGDHelper<ElemType>* NewASGDHelper(
     double adjustCoef = 0.2,                                                 // see in DecayCoefficient()
     size_t adjustPerMinibatches = 600,                                       //
     int traceLevel = 0,                                                      // log level
-    int syncPerfStats = 0);                                                  // shown perf data every syncPerfStats
+    int syncPerfStats = 0,                                                   // shown perf data every syncPerfStats
+    bool useNativeParameterServer = false,                                   // use the parameter server built on MPIWrapper rather than Multiverso
+    size_t maxStaleness = SIZE_MAX,                                          // (native parameter server) max number of syncs a worker may be ahead of the others
+    const MPIWrapperPtr& pMPI = nullptr);                                    // (native parameter server)
 
 }}}
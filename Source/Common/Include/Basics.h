@@ -124,6 +124,17 @@ __declspec_noreturn static inline void InvalidArgument(const char* format, _Type
 }
 #endif
 
+// DeviceOutOfMemoryError - thrown when a device (GPU) memory allocation fails. It is a std::runtime_error and is
+// handled as such, but lets the callers that can make do with less memory recover (see SGD's autoSubminibatches).
+class DeviceOutOfMemoryError : public std::runtime_error
+{
+public:
+    explicit DeviceOutOfMemoryError(const std::string& what)
+        : std::runtime_error(what)
+    {
+    }
+};
+
 // Warning - warn with a formatted error string
 #pragma warning(push)
 #pragma warning(disable : 4996)
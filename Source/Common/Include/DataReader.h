@@ -264,6 +264,14 @@ public:
     }
 
     virtual bool GetMinibatch(StreamMinibatchInputs& matrices) = 0;
+
+    // Descriptions of the matrices to read all streams of the reader into on the given device, for callers that
+    // read without a network (e.g. the "benchmarkReader" command). Legacy readers output whatever they are asked for.
+    virtual std::vector<InputStreamDescription> GetStreamDescriptions(int /*deviceId*/)
+    {
+        NOT_IMPLEMENTED;
+    }
+
     virtual bool GetMinibatch4SE(std::vector<shared_ptr<const msra::dbn::latticepair>>& /*latticeinput*/, vector<size_t>& /*uids*/, vector<size_t>& /*boundaries*/, vector<size_t>& /*extrauttmap*/)
     {
         NOT_IMPLEMENTED;
@@ -444,6 +452,7 @@ public:
     //             [out] each matrix resized if necessary containing data.
     // returns - true if there are more minibatches, false if no more minibatches remain
     virtual bool GetMinibatch(StreamMinibatchInputs& matrices);
+    virtual std::vector<InputStreamDescription> GetStreamDescriptions(int deviceId) override;
     virtual bool GetMinibatch4SE(std::vector<shared_ptr<const msra::dbn::latticepair>>& latticeinput, vector<size_t>& uids, vector<size_t>& boundaries, vector<size_t>& extrauttmap);
     virtual bool GetHmmData(msra::asr::simplesenonehmm* hmm);
 
@@ -355,6 +355,49 @@ public:
     // resetRNN - flags whether to reset memory cells of RNN. 
     //
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) = 0;
+
+    //
+    // ForwardPassTopK - Same as ForwardPass(), but returns only the k largest values of every sample (column) of every
+    // output, in descending order, and their indices into the sample. They are selected on the device, so that only
+    // these are copied back instead of the (possibly very wide) outputs, e.g. for classification or retrieval.
+    // k - number of values per sample, at most the dimension of the outputs
+    // topValues, topIndices - vectors of output buffers, with room for k values per sample of every output
+    //
+    virtual void ForwardPassTopK(const Values<ElemType>& inputs, size_t k, Values<ElemType>& topValues, Values<ElemType>& topIndices) = 0;
+
+    //
+    // ForwardPassStreams - Evaluate the next chunk of frames of several independent streams (e.g. the sessions of a
+    // speech recognition service) with a recurrent model in one forward pass.
+    // Every stream is identified by an id chosen by the caller. The first chunk of a new id starts the stream; every
+    // further chunk continues from the recurrent state (PastValue) the stream had at the end of its previous chunk,
+    // independent of which other streams are evaluated together with it. The chunks may have different lengths.
+    // Do not mix this with the ForwardPass() calls that keep the recurrent state (resetRNN = false).
+    // streamIds - the distinct ids of the streams in this call
+    // inputs - for every stream, its buffers as in ForwardPass(); all inputs of a stream must have the same number of frames
+    // outputs - for every stream, its preallocated output buffers as in ForwardPass(), receiving the frames of its chunk
+    //
+    virtual void ForwardPassStreams(const std::vector<size_t>& streamIds, const std::vector<Values<ElemType>>& inputs, std::vector<Values<ElemType>>& outputs) = 0;
+
+    //
+    // ForkStreams - Continue streams from the recurrent state of other streams, e.g. the hypotheses of a beam search
+    // from the hypotheses they extend. After the call, stream targetStreamIds[i] has the state that stream
+    // sourceStreamIds[i] had before the call; targets that do not exist yet are started. A stream may be both a source
+    // and a target. The states are copied on the device of the network.
+    //
+    virtual void ForkStreams(const std::vector<size_t>& sourceStreamIds, const std::vector<size_t>& targetStreamIds) = 0;
+
+    //
+    // EndStream - Release the recurrent state of a stream. A later chunk with the same id starts a new stream.
+    //
+    virtual void EndStream(size_t streamId) = 0;
+
+    //
+    // Clone - Create another evaluator of the same network, e.g. for another thread of a service. It shares the
+    // parameters with this one, and only has its own memory for the activations. Clones may be used concurrently.
+    // This evaluator must not be in use while it is cloned. StartForwardEvaluation() has to be called on the clone,
+    // which is destroyed with Destroy() like any evaluator.
+    //
+    virtual IEvaluateModelExtended<ElemType>* Clone() = 0;
 };
 
 template <typename ElemType>
@@ -362,4 +405,93 @@ void EVAL_API GetEvalExtended(IEvaluateModelExtended<ElemType>** peval);
 extern "C" EVAL_API void GetEvalExtendedF(IEvaluateModelExtended<float>** peval);
 extern "C" EVAL_API void GetEvalExtendedD(IEvaluateModelExtended<double>** peval);
 
+//
+// Batching of concurrent requests, for services whose clients send a single example at a time.
+// Requests submitted from many threads are queued and evaluated together with one ForwardPassStreams() call of the
+// model, each request being a stream of its own. A batch is evaluated as soon as it has maxBatchSize requests, or when
+// its oldest request has waited for maxLatencyMs.
+//
+template <typename ElemType>
+class IEvaluateModelBatching
+{
+public:
+    //
+    // ForwardPass - Evaluate a single request. Inputs and outputs are as in IEvaluateModelExtended::ForwardPass().
+    // This method is thread-safe. It blocks until the batch containing the request has been evaluated.
+    //
+    virtual void ForwardPass(const Values<ElemType>& inputs, Values<ElemType>& outputs) = 0;
+
+    //
+    // GetLatencyHistogram - the number of requests by their latency (from submission to result).
+    // counts[i] is the number of requests with a latency below upperBoundsMs[i] (and at least upperBoundsMs[i - 1]);
+    // the last count, which has no upper bound, is that of all slower ones.
+    //
+    virtual void GetLatencyHistogram(std::vector<double>& upperBoundsMs, std::vector<size_t>& counts) const = 0;
+
+    //
+    // Destroy - evaluate the pending requests and remove this class. The model is not destroyed.
+    //
+    virtual void Destroy() = 0;
+};
+
+//
+// GetEvalBatching - create a batching layer for a model on which StartForwardEvaluation() has been called.
+// The model must not be used by anybody else until the batching layer is destroyed.
+//
+template <typename ElemType>
+void EVAL_API GetEvalBatching(IEvaluateModelExtended<ElemType>* model, size_t maxBatchSize, double maxLatencyMs, IEvaluateModelBatching<ElemType>** pbatching);
+extern "C" EVAL_API void GetEvalBatchingF(IEvaluateModelExtended<float>* model, size_t maxBatchSize, double maxLatencyMs, IEvaluateModelBatching<float>** pbatching);
+extern "C" EVAL_API void GetEvalBatchingD(IEvaluateModelExtended<double>* model, size_t maxBatchSize, double maxLatencyMs, IEvaluateModelBatching<double>** pbatching);
+
+//
+// Beam search decoding with a recurrent model that predicts the next token of a sequence, e.g. the decoder of a
+// sequence-to-sequence model for translation.
+// The model's input 'tokenInputName' receives the previous token as a one-hot vector over the vocabulary, and its
+// only output has a score for every token of the vocabulary. Decoding of a request starts with its prefix, e.g. the
+// source sentence followed by a start token, whose last frame gives the scores of the first token. Then every
+// hypothesis receives its last token, while the other inputs of the model receive the last frame of the prefix again.
+// All hypotheses of all requests are evaluated as the streams of one ForwardPassStreams() call per step. The states of
+// the hypotheses that are kept are forked on the device from those they extend (ForkStreams()), and finished
+// hypotheses drop out of the next step, the beam of a request shrinking accordingly.
+//
+struct BeamSearchHypothesis
+{
+    std::vector<size_t> m_tokens; // without the end token
+    double m_score;               // the sum of the log probabilities of the tokens, including the end token
+};
+
+template <typename ElemType>
+class IBeamSearchDecoder
+{
+public:
+    //
+    // Decode - Decode several requests together.
+    // prefixes - for every request, the buffers of all inputs of the model for its prefix, as in ForwardPass(); at least one frame
+    // results - for every request, receives up to beamWidth hypotheses, the best first (by score / length ^ lengthPenalty)
+    //
+    virtual void Decode(const std::vector<Values<ElemType>>& prefixes, std::vector<std::vector<BeamSearchHypothesis>>& results) = 0;
+
+    //
+    // Destroy - remove this class. The model is not destroyed.
+    //
+    virtual void Destroy() = 0;
+};
+
+//
+// GetBeamSearchDecoder - create a beam search decoder for a model on which StartForwardEvaluation() has been called.
+// beamWidth - the number of hypotheses kept for a request
+// maxLength - the maximum number of tokens of a hypothesis; longer ones are finished without the end token
+// endToken - the token that finishes a hypothesis
+// applyLogSoftmax - whether the output of the model are scores that are turned into log probabilities, or already log probabilities
+// lengthPenalty - the exponent of the length by which the scores of the finished hypotheses are divided for their ranking (0 for none)
+// The model must not be used by anybody else while a Decode() call is running.
+//
+template <typename ElemType>
+void EVAL_API GetBeamSearchDecoder(IEvaluateModelExtended<ElemType>* model, const std::wstring& tokenInputName, size_t beamWidth, size_t maxLength, size_t endToken,
+                                   bool applyLogSoftmax, double lengthPenalty, IBeamSearchDecoder<ElemType>** pdecoder);
+extern "C" EVAL_API void GetBeamSearchDecoderF(IEvaluateModelExtended<float>* model, const wchar_t* tokenInputName, size_t beamWidth, size_t maxLength, size_t endToken,
+                                               bool applyLogSoftmax, double lengthPenalty, IBeamSearchDecoder<float>** pdecoder);
+extern "C" EVAL_API void GetBeamSearchDecoderD(IEvaluateModelExtended<double>* model, const wchar_t* tokenInputName, size_t beamWidth, size_t maxLength, size_t endToken,
+                                               bool applyLogSoftmax, double lengthPenalty, IBeamSearchDecoder<double>** pdecoder);
+
 } } }
@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <memory>
 #include <stdint.h>
 #ifdef _WIN32
 #define NOMINMAX
@@ -33,7 +34,7 @@ enum FileOptions
     fileOptionsType = fileOptionsBinary | fileOptionsText,      // file types
     fileOptionsRead = 8,                                        // open in read mode
     fileOptionsWrite = 16,                                      // open in write mode
-    fileOptionsSequential = 32,                                 // optimize for sequential reads (allocates big buffer)
+    fileOptionsSequential = 32,                                 // optimize for sequential access (allocates big buffer, and tells the OS to read ahead)
     fileOptionsReadWrite = fileOptionsRead | fileOptionsWrite,  // read/write mode
 };
 
@@ -99,7 +100,9 @@ private:
     bool m_pcloseNeeded; // was opened with popen(), use pclose() when destructing
     bool m_seekable;     // this stream is seekable
     int m_options;       // FileOptions ored togther
+    std::unique_ptr<char[]> m_buffer; // stdio buffer of m_file, see SetBuffer()
     void Init(const wchar_t* filename, int fileOptions);
+    int SetBuffer(size_t size);
 
 public:
     File(const std::wstring& filename, int fileOptions);
@@ -195,6 +198,30 @@ public:
         return *this;
     }
 
+    // get and put operators for arrays of basic types, in a single read or write for binary files (e.g. for the elements of matrices)
+    template <typename T>
+    void ReadArray(T* data, size_t count)
+    {
+        if (IsTextBased())
+        {
+            for (size_t i = 0; i < count; i++)
+                fgetText(m_file, data[i]);
+        }
+        else if (count > 0)
+            freadOrDie(data, sizeof(T), count, m_file);
+    }
+    template <typename T>
+    void WriteArray(const T* data, size_t count)
+    {
+        if (IsTextBased())
+        {
+            for (size_t i = 0; i < count; i++)
+                fputText(m_file, data[i]);
+        }
+        else if (count > 0)
+            fwriteOrDie(data, sizeof(T), count, m_file);
+    }
+
     void WriteString(const char* str, int size = 0);                   // zero terminated strings use size=0
     void ReadString(char* str, int size);                              // read up to size bytes, or a zero terminator (or space in text mode)
     void WriteString(const wchar_t* str, int size = 0);                // zero terminated strings use size=0
@@ -6,6 +6,11 @@
 #pragma once
 
 #include <atomic>
+#include <algorithm>
+#include <thread>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -28,11 +33,63 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         static void SetShareNodeValueMatrices(bool enable) { m_enableShareNodeValueMatrices = enable; }
         static bool ShouldEnableShareNodeValueMatrices() { return m_enableShareNodeValueMatrices; }
 
+        // execute independent branches of the network concurrently (see PARTraversalFlowControlNode)
+        static void SetParallelTraversal(bool enable) { m_enableParallelTraversal = enable; }
+        static bool ShouldUseParallelTraversal() { return m_enableParallelTraversal; }
+
+        // initialize random parameters with a counter-based generator, in place on their device (see CounterBasedRandom.h)
+        // The values differ from those of the default (sequential) generators, hence this is opt-in.
+        static void SetCounterBasedRandomInit(bool enable) { m_useCounterBasedRandomInit = enable; }
+        static bool ShouldUseCounterBasedRandomInit() { return m_useCounterBasedRandomInit; }
+
+        // draw the random values of the RngUser nodes (dropout, random distributions, sampling) statelessly, as a function
+        // of the node's seed and its position in the node's stream (see RngUser), instead of from a sequential generator
+        static void SetCounterBasedRandomStreams(bool enable) { m_useCounterBasedRandomStreams = enable; }
+        static bool ShouldUseCounterBasedRandomStreams() { return m_useCounterBasedRandomStreams; }
+
+        // CPU threads of the readers (of their parallel loops and worker threads), so that the readers and the math
+        // kernels (see CPUMatrix::SetNumThreads()) can be given separate shares of the cores, rather than each using
+        // all of them. 0 (the default) does not limit the readers.
+        static void SetNumReaderThreads(int numThreads) { m_numReaderThreads = (std::max)(0, numThreads); }
+        static int GetNumReaderThreads() { return m_numReaderThreads; }
+
+        // density (fraction of nonzeros) below which the dense minibatch input of a product with a parameter is
+        // multiplied from a sparse copy instead (see TimesNodeBase::UseSparseInput1()). 0 (the default) disables this.
+        static void SetSparseProductDensity(double density) { m_sparseProductDensity = (std::max)(0.0, density); }
+        static double GetSparseProductDensity() { return m_sparseProductDensity; }
+
+        // Number of worker threads of a reader that asks for 'requested' of them, at most the reader threads. 0 asks
+        // for all of the reader threads or, if not limited, for as many as there are cores.
+        static size_t GetNumReaderWorkerThreads(size_t requested)
+        {
+            int limit = m_numReaderThreads;
+            if (limit > 0)
+                return requested > 0 ? (std::min)(requested, (size_t)limit) : (size_t)limit;
+            return requested > 0 ? requested : (std::max)(1u, std::thread::hardware_concurrency());
+        }
+
+        // Number of threads of a parallel loop of a reader (for its 'num_threads' clause), i.e. the reader threads
+        // or, if not limited, as many as for any other parallel loop.
+        static int GetNumReaderOmpThreads()
+        {
+            int limit = m_numReaderThreads;
+#ifdef _OPENMP
+            return limit > 0 ? limit : omp_get_max_threads();
+#else
+            return limit > 0 ? limit : 1;
+#endif
+        }
+
     private:
         static std::atomic<bool> m_forceDeterministicAlgorithms;
         // The global flag to enable matrices values in forward and backward prop
         static std::atomic<bool> m_enableShareNodeValueMatrices;
         static std::atomic<bool> m_forceConstantRandomSeed;
         static std::atomic<bool> m_optimizeGradientAccumulation;
+        static std::atomic<bool> m_enableParallelTraversal;
+        static std::atomic<bool> m_useCounterBasedRandomInit;
+        static std::atomic<bool> m_useCounterBasedRandomStreams;
+        static std::atomic<int> m_numReaderThreads;
+        static std::atomic<double> m_sparseProductDensity;
     };
 }}}
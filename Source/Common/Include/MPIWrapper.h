@@ -43,6 +43,7 @@ typedef void *MPI_Status;
 #include <array>
 #include <vector>
 #include <memory>
+#include <stdexcept>
 
 #include "CommonMatrix.h"
 
@@ -58,6 +59,17 @@ struct MpiFail : public std::string
 
 extern int operator||(int rc, const MpiFail &what);
 
+// Thrown instead of aborting the job when an MPI operation failed because a rank died, once fault tolerance has been
+// enabled (see MPIWrapper::EnableFaultTolerance()). The survivors can then re-form the communicator and continue.
+class MpiProcessFailure : public std::runtime_error
+{
+public:
+    explicit MpiProcessFailure(const std::string& what)
+        : std::runtime_error(what)
+    {
+    }
+};
+
 class MPIWrapper;
 typedef std::shared_ptr<MPIWrapper> MPIWrapperPtr;
 
@@ -87,6 +99,16 @@ public:
     // TODO: Once we move to dynamic loading for MPI libs on Linux, move it to utilities.
     static int GetTotalNumberOfMPINodes();
 
+    // Initialize MPI with MPI_THREAD_MULTIPLE rather than MPI_THREAD_SERIALIZED, so that several threads can call into
+    // MPI at the same time (e.g. the parameter server thread of DataParallelASGD). Must be called before GetInstance(true).
+    static void RequestMultipleThreadSupport(bool request);
+
+    // Drive the outstanding non-blocking calls (Isend, Irecv, Iallreduce, Ibcast, AllReduceAsync, AllGatherAsync) from a
+    // dedicated thread, since many MPI implementations only progress them inside MPI calls, that is, not before the Wait.
+    // This needs MPI_THREAD_MULTIPLE; if the MPI library does not provide it, MPI is used without the progress thread.
+    // Can also be enabled with the environment variable CNTK_MPI_PROGRESS_THREAD=1. Must be called before GetInstance(true).
+    static void RequestProgressThread(bool request);
+
     virtual size_t NumNodesInUse() const = 0;
     virtual size_t CurrentNodeRank() const = 0;
     virtual bool IsMainNode() const = 0;
@@ -95,9 +117,30 @@ public:
     virtual bool UsingAllNodes() const = 0;
     virtual size_t MainNodeRank() const = 0;
     virtual bool IsMultiHost() const = 0;
-
-    // Use GPUDirect RDMA support
+    // the rank among the ranks on the same host (in the order of their ranks), and the number of ranks on this host
+    virtual size_t LocalRank() const = 0;
+    virtual size_t NumLocalRanks() const = 0;
+
+    // Whether GPU buffers are passed to MPI directly instead of being copied to the host first (CUDA-aware MPI, GPUDirect RDMA).
+    // This is determined when MPI is initialized, from the build (USE_CUDA_GDR) or by asking the MPI library,
+    // and can be overridden with the environment variable CNTK_CUDA_AWARE_MPI (0: never, 1: blocking calls, 2: also non-blocking collectives).
+    // All ranks agree on it, since blocking and non-blocking collectives must not be mixed.
     virtual bool UseGpuGdr() = 0;
+    // whether GPU buffers can also be passed to non-blocking collectives (MPI_Iallreduce), which not all CUDA-aware MPIs support
+    virtual bool UseGpuGdrForNonblockingCollectives() = 0;
+
+    // Elastic training: report the failure of a rank as MpiProcessFailure instead of aborting the job.
+    // Returns false if the MPI implementation does not support this (it needs the ULFM extension, MPIX_Comm_shrink()).
+    virtual bool EnableFaultTolerance() = 0;
+    virtual bool IsProcessFailure(int errorcode) const = 0;
+    // Re-forms the communicator from the surviving ranks after a MpiProcessFailure. This changes NumNodesInUse() and
+    // CurrentNodeRank() (and which node is the main node), so that everything that depends on them must be set up again.
+    virtual void RecoverFromProcessFailure() = 0;
+
+    // whether MPI has been initialized with MPI_THREAD_MULTIPLE, see RequestMultipleThreadSupport()
+    virtual bool SupportsMultipleThreads() const = 0;
+    // whether the progress thread is running, see RequestProgressThread()
+    virtual bool UsesProgressThread() const = 0;
 
     // -----------------------------------------------------------------------
     // data-exchange functions (wrappers around MPI functions)
@@ -111,6 +154,7 @@ public:
     virtual int Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag, /*MPI_Comm comm,*/ MPI_Status* status) = 0;
     virtual int Irecv(void* buf, int count, MPI_Datatype datatype, int source, int tag, /*MPI_Comm comm,*/ MPI_Request* request) = 0;
     virtual int Iallreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op, /*MPI_Comm comm,*/ MPI_Request* request) = 0;
+    virtual int Ibcast(void* buffer, int count, MPI_Datatype datatype, int root, /*MPI_Comm comm,*/ MPI_Request* request) = 0;
     virtual int Abort(int errorcode) = 0;
     virtual int Error_string(int errorcode, char* string, int* resultlen) = 0;
 
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <vector>
+#include <map>
 #include <memory> // for shared_ptr
 #include <mutex>
 #include "Basics.h"
@@ -140,6 +141,7 @@ struct MBLayout
         m_timeStepHasGap = other->m_timeStepHasGap;
 
         m_columnsValidityMask.SetValue(other->m_columnsValidityMask);
+        m_columnsValidityMaskCopies.clear();
         m_writable = other->m_writable;
 
         if (!keepName)
@@ -166,6 +168,7 @@ struct MBLayout
         m_timeStepHasGap = std::move(other->m_timeStepHasGap);
 
         m_columnsValidityMask = std::move(other->m_columnsValidityMask);
+        m_columnsValidityMaskCopies = std::move(other->m_columnsValidityMaskCopies);
         m_writable = other->m_writable;
 
         m_axisName = std::move(other->m_axisName);
@@ -187,6 +190,7 @@ public:
         m_distanceToNearestEnd.assign(m_numTimeSteps, PTRDIFF_MAX);
         m_timeStepHasGap.assign(m_numTimeSteps, false);
         m_columnsValidityMask.Resize(0, 0); // invalidate
+        m_columnsValidityMaskCopies.clear();
         // reset state
         m_numFramesDeclared = 0;
         m_numGapFrames = 0;
@@ -603,6 +607,8 @@ private:
     // A value of 1 indicates that the column has valid content
     // and 0 indicates invalid (aka MinibatchPackingFlags::NoInput)
     mutable Matrix<char> m_columnsValidityMask;
+    // copies of m_columnsValidityMask on other devices, for networks whose nodes are on several devices
+    mutable std::map<DEVICEID_TYPE, Matrix<char>> m_columnsValidityMaskCopies;
 
     // A boolean flag indicating whether the MBLayout can be further modified
     // When it's value is false, no set operations are allowed on the MBLayout.
@@ -938,7 +944,16 @@ inline const Matrix<char>& MBLayout::GetColumnsValidityMask(DEVICEID_TYPE device
             m_columnsValidityMask = Matrix<char>(deviceId);
         m_columnsValidityMask.SetValue(1, nS * nT, deviceId, columnsValidityMask.data());
     }
-    return m_columnsValidityMask;
+    if (deviceId == m_columnsValidityMask.GetDeviceId())
+        return m_columnsValidityMask;
+
+    auto iter = m_columnsValidityMaskCopies.find(deviceId);
+    if (iter == m_columnsValidityMaskCopies.end())
+    {
+        iter = m_columnsValidityMaskCopies.emplace(deviceId, Matrix<char>(deviceId)).first;
+        iter->second.AssignValuesOf(m_columnsValidityMask);
+    }
+    return iter->second;
 }
 
 // class for defining an iteration over a sequence, forward and backward
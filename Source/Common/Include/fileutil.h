@@ -43,6 +43,22 @@
 FILE* fopenOrDie(const std::string& pathname, const char* mode);
 FILE* fopenOrDie(const std::wstring& pathname, const wchar_t* mode);
 
+// ----------------------------------------------------------------------------
+// fetchRemoteFile(): local path for a file in remote storage, e.g. s3://bucket/key.
+// For a pathname of the form <scheme>://..., if the environment variable
+// CNTK_FETCH_<SCHEME> (e.g. CNTK_FETCH_S3) is set, the file is copied into the
+// cache directory CNTK_REMOTE_FILE_CACHE (default: the temp directory) with that
+// command, in which %u is replaced by the URL and %f by the local file, e.g.
+//   CNTK_FETCH_S3="aws s3 cp %u %f"
+//   CNTK_FETCH_HDFS="hdfs dfs -get %u %f"
+// Files are fetched once per machine and then read from the cache, and
+// different files are fetched concurrently. All other pathnames are returned
+// unchanged. fopenOrDie() does this for all pathnames.
+// ----------------------------------------------------------------------------
+
+std::string fetchRemoteFile(const std::string& pathname);
+std::wstring fetchRemoteFile(const std::wstring& pathname);
+
 #ifndef __unix__
 // ----------------------------------------------------------------------------
 // fsetmode(): set mode to binary or text
@@ -15,6 +15,7 @@
 
 #include "Basics.h"
 #include "latticestorage.h"
+#include "latticecompact.h"
 #include "simple_checked_arrays.h"
 #include "fileutil.h"
 #include <vector>
@@ -983,84 +984,183 @@ public:
         }
         else if (version == 2)
         {
-            freadOrDie(&info, sizeof(info), 1, f);
-            freadvector(f, "NODS", nodes, info.numnodes);
-            if (nodes.back().t != info.numframes)
-                RuntimeError("fread: mismatch between info.numframes and last node's time");
-            freadvector(f, "EDGS", edges2, info.numedges); // uniqued edges
-            freadvector(f, "ALNS", uniquededgedatatokens); // uniqued alignments
-            fcheckTag(f, "END ");
+            freadv2(f);
+            fromuniquealignments(idmap, spunit);
+        }
+        else if (version == 3)
+            RuntimeError("fread: compact (version 3) lattices can only be read from a compact archive, see archive::getlattice()");
+        else
+            RuntimeError("fread: unsupported lattice format version");
+    }
+
+    // read the body of a V2 lattice (following the "LAT " tag) as stored, i.e. without mapping or rebuilding edges
+    void freadv2(FILE* f)
+    {
+        freadOrDie(&info, sizeof(info), 1, f);
+        freadvector(f, "NODS", nodes, info.numnodes);
+        if (nodes.back().t != info.numframes)
+            RuntimeError("fread: mismatch between info.numframes and last node's time");
+        freadvector(f, "EDGS", edges2, info.numedges); // uniqued edges
+        freadvector(f, "ALNS", uniquededgedatatokens); // uniqued alignments
+        fcheckTag(f, "END ");
+    }
+
+    // write in the compact format (version 3, see latticecompact.h); requires the uniq'ed representation (edges2, uniquededgedatatokens)
+    // The caller must have aligned the file position, see compact::fpadtoalignment().
+    void fwritecompact(FILE* f)
+    {
+        fwritetag(f, "LAT ", 3);
+        fwriteOrDie(&info, sizeof(info), 1, f);
+        std::vector<unsigned char> buf;
+        buf.reserve(nodes.size() + 4 * edges2.size());
+        // node times: deltas to the previous node
+        int64_t prevt = 0;
+        foreach_index (i, nodes)
+        {
+            compact::appendsvarint(buf, (int64_t) nodes[i].t - prevt);
+            prevt = nodes[i].t;
+        }
+        fwritevector(f, "NODZ", buf);
+        // edges: deltas to the previous edge; edges are sorted by end node, then start node, so these are mostly small
+        buf.clear();
+        int64_t prevS = 0, prevE = 0, prevfirstalign = 0;
+        foreach_index (j, edges2)
+        {
+            const auto& e = edges2[j];
+            compact::appendsvarint(buf, (int64_t) e.E - prevE);
+            compact::appendsvarint(buf, (int64_t) e.S - prevS);
+            compact::appendvarint(buf, (compact::zigzag((int64_t) e.firstalign - prevfirstalign) << 1) | e.implysp);
+            prevS = e.S;
+            prevE = e.E;
+            prevfirstalign = e.firstalign;
+        }
+        fwritevector(f, "EDGZ", buf);
+        // tokens as is, payload aligned (tag and size are 8 bytes)
+        compact::fpadtoalignment(f);
+        fwritevector(f, "ALNS", uniquededgedatatokens);
+        fputTag(f, "END ");
+    }
+
+    // read a compact (version 3) lattice out of a mapped compact archive; otherwise like fread()
+    template <class IDMAP>
+    void freadcompact(compact::bytereader r, const IDMAP& idmap, size_t spunit)
+    {
+        if (r.tagged("LAT ") != 3)
+            RuntimeError("freadcompact: unsupported lattice format version in compact archive");
+        memcpy(&info, r.bytes(sizeof(info)), sizeof(info));
+
+        if (info.numnodes == 0)
+            RuntimeError("freadcompact: malformed lattice without nodes");
+
+        compact::bytereader noderecords = r.subrange(r.tagged("NODZ"));
+        nodes.resize(info.numnodes);
+        int64_t t = 0;
+        foreach_index (i, nodes)
+        {
+            t += noderecords.svarint();
+            nodes[i] = nodeinfo((size_t) t);
+        }
+        if (!noderecords.atend())
+            RuntimeError("freadcompact: malformed file, node records do not match the header");
+        if (nodes.back().t != info.numframes)
+            RuntimeError("freadcompact: mismatch between info.numframes and last node's time");
+
+        compact::bytereader edgerecords = r.subrange(r.tagged("EDGZ"));
+        edges2.resize(info.numedges);
+        int64_t S = 0, E = 0, firstalign = 0;
+        foreach_index (j, edges2)
+        {
+            E += edgerecords.svarint();
+            S += edgerecords.svarint();
+            const uint64_t v = edgerecords.varint();
+            firstalign += compact::unzigzag(v >> 1);
+            edges2[j] = edgeinfo((size_t) S, (size_t) E, (size_t) firstalign);
+            edges2[j].implysp = v & 1;
+        }
+        if (!edgerecords.atend())
+            RuntimeError("freadcompact: malformed file, edge records do not match the header");
+
+        r.skiptoalignment();
+        uniquededgedatatokens.resize(r.tagged("ALNS"));
+        if (!uniquededgedatatokens.empty())
+            memcpy(uniquededgedatatokens.data(), r.bytes(uniquededgedatatokens.size() * sizeof(aligninfo)), uniquededgedatatokens.size() * sizeof(aligninfo));
+        r.checktag("END ");
+
+        fromuniquealignments(idmap, spunit);
+    }
+
+    // map the unit ids of a lattice read in the uniq'ed representation and reconstruct the edges/align arrays from it
+    template <class IDMAP>
+    void fromuniquealignments(const IDMAP& idmap, size_t spunit)
+    {
 // check if we need to map
 #if 1                                                                                     // post-bugfix for incorrect inference of spunit
-            if (info.impliedspunitid != SIZE_MAX && info.impliedspunitid >= idmap.size()) // we have buggy lattices like that--what do they mean??
-            {
-                fprintf(stderr, "fread: detected buggy spunit id %d which is out of range (%d entries in map)\n", (int) info.impliedspunitid, (int) idmap.size());
-                RuntimeError("fread: out of bounds spunitid");
-            }
+        if (info.impliedspunitid != SIZE_MAX && info.impliedspunitid >= idmap.size()) // we have buggy lattices like that--what do they mean??
+        {
+            fprintf(stderr, "fread: detected buggy spunit id %d which is out of range (%d entries in map)\n", (int) info.impliedspunitid, (int) idmap.size());
+            RuntimeError("fread: out of bounds spunitid");
+        }
 #endif
-            // This is critical--we have a buggy lattice set that requires no mapping where mapping would fail
-            bool needsmapping = false;
-            foreach_index (k, idmap)
-            {
-                if (idmap[k] != (size_t) k
+        // This is critical--we have a buggy lattice set that requires no mapping where mapping would fail
+        bool needsmapping = false;
+        foreach_index (k, idmap)
+        {
+            if (idmap[k] != (size_t) k
 #if 1
-                    && (k != (int) idmap.size() - 1 || idmap[k] != spunit) // that HACK that we add one more /sp/ entry at the end...
+                && (k != (int) idmap.size() - 1 || idmap[k] != spunit) // that HACK that we add one more /sp/ entry at the end...
 #endif
-                    )
-                {
-                    needsmapping = true;
-                    break;
-                }
+                )
+            {
+                needsmapping = true;
+                break;
             }
-            // map align ids to user's symmap  --the lattice gets updated in place here
-            if (needsmapping)
+        }
+        // map align ids to user's symmap  --the lattice gets updated in place here
+        if (needsmapping)
+        {
+            if (info.impliedspunitid != SIZE_MAX)
+                info.impliedspunitid = idmap[info.impliedspunitid];
+
+            // deal with broken (zero-token) edges
+            std::vector<bool> isendworkaround;
+            if (info.impliedspunitid != spunit)
             {
-                if (info.impliedspunitid != SIZE_MAX)
-                    info.impliedspunitid = idmap[info.impliedspunitid];
+                fprintf(stderr, "fread: lattice with broken spunit, using workaround to handle potentially broken zero-token edges\n");
+                inferends(isendworkaround);
+            }
 
-                // deal with broken (zero-token) edges
-                std::vector<bool> isendworkaround;
-                if (info.impliedspunitid != spunit)
+            size_t uniquealignments = 1;
+            const size_t skipscoretokens = info.hasacscores ? 2 : 1;
+            for (size_t k = skipscoretokens; k < uniquededgedatatokens.size(); k++)
+            {
+                if (!isendworkaround.empty() && isendworkaround[k]) // secondary criterion to detect ends in broken lattices
                 {
-                    fprintf(stderr, "fread: lattice with broken spunit, using workaround to handle potentially broken zero-token edges\n");
-                    inferends(isendworkaround);
+                    k--; // don't advance, since nothing to advance over
                 }
-
-                size_t uniquealignments = 1;
-                const size_t skipscoretokens = info.hasacscores ? 2 : 1;
-                for (size_t k = skipscoretokens; k < uniquededgedatatokens.size(); k++)
+                else
                 {
-                    if (!isendworkaround.empty() && isendworkaround[k]) // secondary criterion to detect ends in broken lattices
-                    {
-                        k--; // don't advance, since nothing to advance over
-                    }
-                    else
-                    {
-                        // this is a regular token: update it in-place
-                        auto& ai = uniquededgedatatokens[k];
-                        if (ai.unit >= idmap.size())
-                            RuntimeError("fread: broken-file heuristics failed");
-                        ai.updateunit(idmap); // updates itself
-                        if (!ai.last)
-                            continue;
-                    }
-                    // if last then skip over the lm and ac scores
-                    k += skipscoretokens;
-                    uniquealignments++;
+                    // this is a regular token: update it in-place
+                    auto& ai = uniquededgedatatokens[k];
+                    if (ai.unit >= idmap.size())
+                        RuntimeError("fread: broken-file heuristics failed");
+                    ai.updateunit(idmap); // updates itself
+                    if (!ai.last)
+                        continue;
                 }
-                fprintf(stderr, "fread: mapped %d unique alignments\n", (int) uniquealignments);
+                // if last then skip over the lm and ac scores
+                k += skipscoretokens;
+                uniquealignments++;
             }
-            if (info.impliedspunitid != spunit)
-            {
-                // fprintf (stderr, "fread: inconsistent spunit id in file %d vs. expected %d; due to erroneous heuristic\n", info.impliedspunitid, spunit);    // [v-hansu] comment out becaues it takes up most of the log
-                // it's actually OK, we can live with this, since we only decompress and then move on without any assumptions
-                // RuntimeError("fread: mismatching /sp/ units");
-            }
-            // reconstruct old lattice format from this   --TODO: remove once we change to new data representation
-            rebuildedges(info.impliedspunitid != spunit /*to be able to read somewhat broken V2 lattice archives*/);
+            fprintf(stderr, "fread: mapped %d unique alignments\n", (int) uniquealignments);
         }
-        else
-            RuntimeError("fread: unsupported lattice format version");
+        if (info.impliedspunitid != spunit)
+        {
+            // fprintf (stderr, "fread: inconsistent spunit id in file %d vs. expected %d; due to erroneous heuristic\n", info.impliedspunitid, spunit);    // [v-hansu] comment out becaues it takes up most of the log
+            // it's actually OK, we can live with this, since we only decompress and then move on without any assumptions
+            // RuntimeError("fread: mismatching /sp/ units");
+        }
+        // reconstruct old lattice format from this   --TODO: remove once we change to new data representation
+        rebuildedges(info.impliedspunitid != spunit /*to be able to read somewhat broken V2 lattice archives*/);
     }
 
     // parallel versions (defined in parallelforwardbackward.cpp)
@@ -1212,6 +1312,23 @@ class archive
 
     mutable size_t currentarchiveindex;               // which archive is open
     mutable auto_file_ptr f;                          // cached archive file handle of currentarchiveindex
+    mutable std::vector<bool> formatknown;            // [archiveindex] -> true once we checked whether it is a compact archive
+    mutable std::vector<std::shared_ptr<compact::mappedfile>> mappedarchives; // [archiveindex] -> mapping if a compact archive, see latticecompact.h
+
+    // check whether an archive is in the compact format, and if so, map it (on first use)
+    bool iscompactarchive(size_t archiveindex) const
+    {
+        if (!formatknown[archiveindex])
+        {
+            {
+                auto_file_ptr af(fopenOrDie(archivepaths[archiveindex], L"rbS"));
+                if (fgetTag(af) == compact::archivetag)
+                    mappedarchives[archiveindex] = std::make_shared<compact::mappedfile>(archivepaths[archiveindex]);
+            }
+            formatknown[archiveindex] = true;
+        }
+        return mappedarchives[archiveindex] != nullptr;
+    }
     std::unordered_map<std::wstring, latticeref> toc; // [key] -> (file, offset)  --table of content (.toc file)
 public:
     // construct = open the archive
@@ -1293,6 +1410,8 @@ public:
 
         // initialize symmaps  --alloc the array, but actually read the symmap on demand
         symmaps.resize(archivepaths.size());
+        formatknown.resize(archivepaths.size(), false);
+        mappedarchives.resize(archivepaths.size());
     }
 
     // check if a lattice for a given key is available  --do this during initial check ideally
@@ -1335,30 +1454,39 @@ public:
         if (spunit2 != spunit)
             LogicError("getlattice: huh? same lookup of /sp/ gives different result?");
 #endif
-        // open archive file in case it is not the current one
-        if (archiveindex != currentarchiveindex)
+        // compact archives are read directly from their memory mapping
+        if (iscompactarchive(archiveindex))
         {
-            f = fopenOrDie(archivepaths[archiveindex], L"rbS"); // or throw (will close old 'f' iff succeeded)
-            currentarchiveindex = archiveindex;
+            L.freadcompact(mappedarchives[archiveindex]->from(offset), idmap, spunit);
+            L.setverbosity(verbosity);
         }
-        try // (for read operation)
+        else
         {
-            // seek to start
-            fsetpos(f, offset);
-            // get it
-            L.fread(f, idmap, spunit);
-            L.setverbosity(verbosity);
+            // open archive file in case it is not the current one
+            if (archiveindex != currentarchiveindex)
+            {
+                f = fopenOrDie(archivepaths[archiveindex], L"rbS"); // or throw (will close old 'f' iff succeeded)
+                currentarchiveindex = archiveindex;
+            }
+            try // (for read operation)
+            {
+                // seek to start
+                fsetpos(f, offset);
+                // get it
+                L.fread(f, idmap, spunit);
+                L.setverbosity(verbosity);
 #ifdef HACK_IN_SILENCE // hack to simulate DEL in the lattice
-            const size_t silunit = getid(modelsymmap, "sil");
-            const bool addsp = true;
-            L.hackinsilencesubstitutionedges(silunit, spunit, addsp);
+                const size_t silunit = getid(modelsymmap, "sil");
+                const bool addsp = true;
+                L.hackinsilencesubstitutionedges(silunit, spunit, addsp);
 #endif
-        }
-        catch (...) // to retry a read error due to a disconnected file handle, we need to reopen the file
-        {
-            currentarchiveindex = SIZE_MAX;
-            f = NULL; // this closes the file handle
-            throw;
+            }
+            catch (...) // to retry a read error due to a disconnected file handle, we need to reopen the file
+            {
+                currentarchiveindex = SIZE_MAX;
+                f = NULL; // this closes the file handle
+                throw;
+            }
         }
         // check if number of frames is as expected
         if (expectedframes != SIZE_MAX && L.getnumframes() != expectedframes)
@@ -1380,6 +1508,70 @@ public:
     //  - merge two lattices (for merging numer into denom lattices)
     static void convert(const std::wstring& intocpath, const std::wstring& intocpath2, const std::wstring& outpath,
                         const msra::asr::simplesenonehmm& hset);
+
+    // static method for converting a V2 archive into a compact archive (see latticecompact.h)
+    // Lattices are transcoded as stored, i.e. without mapping their unit ids; hence all archives referenced by the
+    // TOC must share the same .symlist, which is copied to outpath.symlist. The TOC is written to outpath.toc.
+    static void compact(const std::wstring& intocpath, const std::wstring& outpath)
+    {
+        const std::unordered_map<std::string, size_t> nosymmap; // (not used, since we do not map)
+        archive in(std::vector<std::wstring>(1, intocpath), nosymmap);
+        if (in.empty())
+            RuntimeError("compact: no lattice archive referenced by '%ls'", intocpath.c_str());
+
+        // all archives must share the symbol list, since we keep the unit ids
+        const auto symlist = msra::files::fgetfilelines(in.archivepaths[0] + L".symlist");
+        for (size_t k = 1; k < in.archivepaths.size(); k++)
+            if (msra::files::fgetfilelines(in.archivepaths[k] + L".symlist") != symlist)
+                RuntimeError("compact: archives '%ls' and '%ls' have different symbol lists; please convert them separately",
+                             in.archivepaths[0].c_str(), in.archivepaths[k].c_str());
+
+        msra::files::make_intermediate_dirs(outpath);
+        auto_file_ptr fout(fopenOrDie(outpath, L"wb"));
+        auto_file_ptr ftoc(fopenOrDie(outpath + L".toc", L"wb"));
+        {
+            auto_file_ptr fsymlist(fopenOrDie(outpath + L".symlist", L"wb"));
+            for (const auto& line : symlist)
+                fprintfOrDie(fsymlist, "%s\n", line.c_str());
+        }
+        fputTag(fout, compact::archivetag);
+        fputint(fout, 1); // archive format version
+
+        // read the TOC once again to write the lattices in their original order
+        std::vector<char> textbuffer;
+        auto toclines = msra::files::fgetfilelines(intocpath, textbuffer);
+        uint64_t inbytes = 0;
+        lattice L;
+        foreach_index (i, toclines)
+        {
+            const char* p = strchr(toclines[i], '=');
+            if (p == NULL)
+                RuntimeError("compact: invalid TOC line (no = sign): %s", toclines[i]);
+            const std::wstring key = msra::strfun::utf16(std::string(toclines[i], p - toclines[i]));
+            const auto& ref = in.toc.find(key)->second;
+
+            if (ref.archiveindex != in.currentarchiveindex)
+            {
+                in.f = fopenOrDie(in.archivepaths[ref.archiveindex], L"rbS");
+                in.currentarchiveindex = ref.archiveindex;
+            }
+            fsetpos(in.f, ref.offset);
+            if (L.freadtag(in.f, "LAT ") != 2)
+                RuntimeError("compact: lattice '%ls' is not in V2 format; please convert the archive first, see convert()", key.c_str());
+            L.freadv2(in.f);
+            inbytes += fgetpos(in.f) - ref.offset;
+
+            compact::fpadtoalignment(fout);
+            const uint64_t offset = fgetpos(fout);
+            L.fwritecompact(fout);
+            // (TOC is a headerless UTF8 file, see convert())
+            fprintfOrDie(ftoc, "%s=%s[%llu]\n", msra::strfun::utf8(key).c_str(), (i == 0) ? msra::strfun::utf8(outpath).c_str() : "", (unsigned long long) offset);
+        }
+        fflushOrDie(fout);
+        fflushOrDie(ftoc);
+        const uint64_t outbytes = fgetpos(fout);
+        fprintf(stderr, "compact: converted %d lattices from %.1f MB to %.1f MB\n", (int) toclines.size(), inbytes / 1048576.0, outbytes / 1048576.0);
+    }
 };
 };
 };
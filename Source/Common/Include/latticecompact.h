@@ -0,0 +1,230 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// latticecompact.h -- helpers for compact, memory-mapped lattice archives
+//
+// A compact lattice archive is written by archive::compact() from a regular (V2) archive. It begins with a "LATC"
+// tag and stores each lattice in format version 3 (see lattice::fwritecompact()):
+//  - the node times and the uniq'ed edges are delta- and varint-encoded instead of stored as 2- and 8-byte records;
+//  - the uniq'ed alignment and score tokens are stored as is, with the payload at a file offset that is a multiple
+//    of 8, so that they can be copied (or uploaded) directly out of the mapped file;
+//  - every lattice starts at a file offset that is a multiple of 8.
+// Compact archives are read through a read-only memory mapping of the whole file instead of a buffered read per
+// lattice, so that the OS page cache keeps the archive across epochs and no intermediate copy is made.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "fileutil.h"
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace msra { namespace lattices { namespace compact {
+
+static const char* const archivetag = "LATC"; // first tag of a compact archive; regular archives start with "LAT "
+static const size_t alignment = 8;            // alignment of lattices and of the raw token arrays in a compact archive
+
+// zigzag mapping of signed deltas to unsigned, so that small negative values also encode into few bytes
+static inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t) v << 1) ^ (uint64_t)(v >> 63);
+}
+static inline int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// append an unsigned LEB128 varint
+static inline void appendvarint(std::vector<unsigned char>& buf, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        buf.push_back((unsigned char) (v | 0x80));
+        v >>= 7;
+    }
+    buf.push_back((unsigned char) v);
+}
+static inline void appendsvarint(std::vector<unsigned char>& buf, int64_t v)
+{
+    appendvarint(buf, zigzag(v));
+}
+
+// write zeros until the file position is a multiple of 'alignment'
+static inline void fpadtoalignment(FILE* f)
+{
+    static const char zeros[alignment] = { 0 };
+    const uint64_t pos = fgetpos(f);
+    if (pos % alignment != 0)
+        fwriteOrDie(zeros, 1, (size_t) (alignment - pos % alignment), f);
+}
+
+// bounds-checked sequential reader over a byte range of a mapped file
+class bytereader
+{
+    const unsigned char* p;
+    const unsigned char* end;
+
+    void need(size_t n) const
+    {
+        if ((size_t) (end - p) < n)
+            RuntimeError("compact lattice: malformed archive, unexpected end of data");
+    }
+
+public:
+    bytereader(const void* data, size_t size)
+        : p((const unsigned char*) data), end((const unsigned char*) data + size)
+    {
+    }
+
+    bool atend() const
+    {
+        return p == end;
+    }
+
+    const void* bytes(size_t n)
+    {
+        need(n);
+        const void* data = p;
+        p += n;
+        return data;
+    }
+
+    // reader over the next n bytes, which are skipped in this one
+    bytereader subrange(size_t n)
+    {
+        return bytereader(bytes(n), n);
+    }
+
+    int int32()
+    {
+        int v;
+        memcpy(&v, bytes(sizeof(v)), sizeof(v));
+        return v;
+    }
+
+    // read a tag as written by fputTag() followed by an int as written by fputint(), and return the int
+    size_t tagged(const char* tag)
+    {
+        if (memcmp(bytes(4), tag, 4) != 0)
+            RuntimeError("compact lattice: malformed archive, tag '%s' expected", tag);
+        return (size_t) (unsigned int) int32();
+    }
+    void checktag(const char* tag)
+    {
+        if (memcmp(bytes(4), tag, 4) != 0)
+            RuntimeError("compact lattice: malformed archive, tag '%s' expected", tag);
+    }
+
+    uint64_t varint()
+    {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            need(1);
+            const unsigned char b = *p++;
+            v |= (uint64_t) (b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return v;
+        }
+        RuntimeError("compact lattice: malformed archive, varint too long");
+    }
+    int64_t svarint()
+    {
+        return unzigzag(varint());
+    }
+
+    // skip the zero padding written by fpadtoalignment()
+    // The mapping begins at a page boundary, so alignment in memory is the same as alignment in the file.
+    void skiptoalignment()
+    {
+        const size_t misalignment = (size_t) ((uintptr_t) p % alignment);
+        if (misalignment != 0)
+            bytes(alignment - misalignment);
+    }
+};
+
+// read-only memory mapping of a whole file
+class mappedfile
+{
+    std::wstring pathname;
+    const unsigned char* data;
+    uint64_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int file;
+#endif
+
+    mappedfile(const mappedfile&);            // non-copyable
+    mappedfile& operator=(const mappedfile&); // non-copyable
+
+public:
+    explicit mappedfile(const std::wstring& path)
+        : pathname(path), data(nullptr), size(0)
+    {
+#ifdef _WIN32
+        mapping = NULL;
+        file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            RuntimeError("mappedfile: error opening '%ls': error %u", path.c_str(), (unsigned int) GetLastError());
+        LARGE_INTEGER filesize;
+        if (!GetFileSizeEx(file, &filesize))
+            RuntimeError("mappedfile: error determining the size of '%ls': error %u", path.c_str(), (unsigned int) GetLastError());
+        size = filesize.QuadPart;
+        mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL)
+            RuntimeError("mappedfile: error mapping '%ls': error %u", path.c_str(), (unsigned int) GetLastError());
+        data = (const unsigned char*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data == nullptr)
+            RuntimeError("mappedfile: error mapping '%ls': error %u", path.c_str(), (unsigned int) GetLastError());
+#else
+        file = open(wtocharpath(path).c_str(), O_RDONLY);
+        if (file < 0)
+            RuntimeError("mappedfile: error opening '%ls': %s", path.c_str(), strerror(errno));
+        struct stat filestat;
+        if (fstat(file, &filestat) != 0)
+            RuntimeError("mappedfile: error determining the size of '%ls': %s", path.c_str(), strerror(errno));
+        size = filestat.st_size;
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (p == MAP_FAILED)
+            RuntimeError("mappedfile: error mapping '%ls': %s", path.c_str(), strerror(errno));
+        data = (const unsigned char*) p;
+#endif
+    }
+
+    ~mappedfile()
+    {
+#ifdef _WIN32
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping != NULL)
+            CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        if (data)
+            munmap((void*) data, size);
+        close(file);
+#endif
+    }
+
+    // bytes from 'offset' to the end of the file
+    bytereader from(uint64_t offset) const
+    {
+        if (offset > size)
+            RuntimeError("mappedfile: offset %llu is beyond the end of '%ls' (%llu bytes)", (unsigned long long) offset, pathname.c_str(), (unsigned long long) size);
+        return bytereader(data + offset, (size_t) (size - offset));
+    }
+};
+
+}}}
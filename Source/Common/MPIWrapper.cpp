@@ -7,6 +7,12 @@
 
 #if HAS_MPI
 #pragma comment(lib, "msmpi.lib")
+#if defined(OPEN_MPI)
+#include <mpi-ext.h> // the ULFM fault tolerance extension and the CUDA support query, if Open MPI was built with them
+#endif
+#if defined(MPIX_ERR_PROC_FAILED) && defined(MPIX_ERR_REVOKED)
+#define HAS_MPI_FAULT_TOLERANCE 1
+#endif
 #else
 #define MPI_SUCCESS             0
 #define MPI_ERR_INTERN          1
@@ -15,6 +21,12 @@
 
 #define FFLUSH_SUCCESS          0
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 namespace Microsoft { namespace MSR { namespace CNTK {
 
 // -----------------------------------------------------------------------
@@ -29,6 +41,20 @@ class MPIWrapperMpi : public MPIWrapper
     int m_numMPINodes;
     size_t m_numNodesInUse;
     bool m_multiHost;
+    size_t m_localRank;
+    size_t m_numLocalRanks;
+    bool m_faultTolerant;
+    int m_cudaAwareLevel; // 0: host buffers only, 1: GPU buffers for all but non-blocking collectives, 2: GPU buffers for all calls
+
+    // progress thread, see RequestProgressThread()
+    // It polls the outstanding requests with MPI_Request_get_status(), which progresses them without freeing them, so
+    // that they remain the caller's to wait for. The Wait functions take their requests off the list before waiting,
+    // so that the progress thread never looks at a request that has been freed.
+    std::thread m_progressThread;
+    mutable std::mutex m_progressMutex;
+    mutable std::condition_variable m_progressCondition;
+    mutable std::vector<MPI_Request> m_progressRequests; // requests that have not completed yet
+    bool m_stopProgressThread;
 
     // MPI communicator that reflects the current subset selection
     MPI_Comm m_currentComm;
@@ -60,6 +86,19 @@ private:
 
     void RequestNodes(const char *msg, size_t requestednodes = SIZE_MAX /*default: all*/);
 
+    // determines m_multiHost, m_localRank and m_numLocalRanks for the current communicator
+    void DetermineHosts();
+
+    // determines m_cudaAwareLevel, see UseGpuGdr()
+    void DetermineCudaAwareness();
+
+    void StartProgressThread();
+    void StopProgressThread();
+    void ProgressThreadLoop();
+    // put a request started by one of the non-blocking calls on the list of the progress thread, or take requests off it
+    void TrackRequest(MPI_Request request) const;
+    void UntrackRequests(const MPI_Request* requests, int count) const;
+
 public:
 
     size_t NumNodesInUse() const;
@@ -70,9 +109,18 @@ public:
     bool UsingAllNodes() const;
     size_t MainNodeRank() const;
     bool IsMultiHost() const;
+    size_t LocalRank() const;
+    size_t NumLocalRanks() const;
 
     // Use GPUDirect RDMA support
     virtual bool UseGpuGdr() override;
+    virtual bool UseGpuGdrForNonblockingCollectives() override;
+
+    bool EnableFaultTolerance() override;
+    bool IsProcessFailure(int errorcode) const override;
+    void RecoverFromProcessFailure() override;
+    bool SupportsMultipleThreads() const override;
+    bool UsesProgressThread() const override;
 
     // -----------------------------------------------------------------------
     // data-exchange functions (wrappers around MPI functions)
@@ -86,6 +134,7 @@ public:
     virtual int Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag, /*MPI_Comm comm,*/ MPI_Status* status);
     virtual int Irecv(void* buf, int count, MPI_Datatype datatype, int source, int tag, /*MPI_Comm comm,*/ MPI_Request* request);
     virtual int Iallreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op, /*MPI_Comm comm,*/ MPI_Request* request);
+    virtual int Ibcast(void* buffer, int count, MPI_Datatype datatype, int root, /*MPI_Comm comm,*/ MPI_Request* request);
     virtual int Abort(int errorcode);
     virtual int Error_string(int errorcode, char* string, int* resultlen);
 
@@ -168,8 +217,17 @@ public:
     bool UsingAllNodes() const;
     size_t MainNodeRank() const;
     bool IsMultiHost() const;
+    size_t LocalRank() const;
+    size_t NumLocalRanks() const;
     // Use GPUDirect RDMA
     virtual bool UseGpuGdr() override;
+    virtual bool UseGpuGdrForNonblockingCollectives() override;
+
+    bool EnableFaultTolerance() override;
+    bool IsProcessFailure(int errorcode) const override;
+    void RecoverFromProcessFailure() override;
+    bool SupportsMultipleThreads() const override;
+    bool UsesProgressThread() const override;
 
     // -----------------------------------------------------------------------
     // data-exchange functions (wrappers around MPI functions)
@@ -183,6 +241,7 @@ public:
     virtual int Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag, /*MPI_Comm comm,*/ MPI_Status* status);
     virtual int Irecv(void* buf, int count, MPI_Datatype datatype, int source, int tag, /*MPI_Comm comm,*/ MPI_Request* request);
     virtual int Iallreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op, /*MPI_Comm comm,*/ MPI_Request* request);
+    virtual int Ibcast(void* buffer, int count, MPI_Datatype datatype, int root, /*MPI_Comm comm,*/ MPI_Request* request);
     virtual int Abort(int errorcode);
     virtual int Error_string(int errorcode, char* string, int* resultlen);
 
@@ -285,6 +344,10 @@ int operator||(int rc, const MpiFail &what)
 
     if (MPIWrapper::s_mpi != nullptr)
     {
+        // with fault tolerance the survivors of a failed rank carry on
+        if (MPIWrapper::s_mpi->IsProcessFailure(rc))
+            throw MpiProcessFailure(what);
+
         // (special case: we use that code to indicate a missing msmpi.dll...)
         if (rc != MPI_ERR_INTERN)
         {
@@ -310,6 +373,34 @@ int operator||(int rc, const MpiFail &what)
 //       to make this threadsafe, remove the "create" parameter,
 //       replace the s_mpi init with a run-once statement (or guard it with a mutex),
 //       and remove the DeleteInstance() function.
+static bool s_multipleThreadSupportRequested = false;
+
+void MPIWrapper::RequestMultipleThreadSupport(bool request)
+{
+    if (s_mpi != nullptr)
+        LogicError("RequestMultipleThreadSupport: MPI has already been initialized.");
+
+    s_multipleThreadSupportRequested = request;
+}
+
+static bool s_progressThreadRequested = false;
+
+void MPIWrapper::RequestProgressThread(bool request)
+{
+    if (s_mpi != nullptr)
+        LogicError("RequestProgressThread: MPI has already been initialized.");
+
+    s_progressThreadRequested = request;
+}
+
+static bool IsProgressThreadRequested()
+{
+    const char* p = std::getenv("CNTK_MPI_PROGRESS_THREAD");
+    if (p && *p)
+        return atoi(p) != 0;
+    return s_progressThreadRequested;
+}
+
 MPIWrapperPtr MPIWrapper::GetInstance(bool create)
 {
     if (create)
@@ -394,7 +485,7 @@ int MPIWrapper::GetTotalNumberOfMPINodes()
 int MPIWrapperMpi::s_myRank = -1;
 
 MPIWrapperMpi::MPIWrapperMpi()
-    : m_currentComm(MPI_COMM_WORLD)
+    : m_faultTolerant(false), m_cudaAwareLevel(0), m_stopProgressThread(false), m_currentComm(MPI_COMM_WORLD)
 {
     static bool initialized = false;
     if (initialized)
@@ -413,6 +504,8 @@ MPIWrapperMpi::MPIWrapperMpi()
     MPI_Comm_size(MPI_COMM_WORLD, &m_numMPINodes);
     m_numNodesInUse = m_numMPINodes;
     m_multiHost = true;
+    m_localRank = 0;
+    m_numLocalRanks = 1;
 
     // Verify that the environment variable used by GetTotalNumberOfMPINodes()  
     // matches what the MPI API says. There're actually two possible cases:
@@ -447,6 +540,16 @@ MPIWrapperMpi::MPIWrapperMpi()
     // do an initial handshake
     Ping("mpihelper");
 
+    DetermineCudaAwareness();
+
+    if (IsProgressThreadRequested())
+    {
+        if (SupportsMultipleThreads())
+            StartProgressThread();
+        else
+            fprintf(stderr, "MPIWrapperMpi: the MPI library does not support MPI_THREAD_MULTIPLE, running without the progress thread\n");
+    }
+
     // stagger the jobs just a little to get a sort-of deterministic order e.g. in GPU allocation when running on one machine
     // continue 0.5 seconds apart
     ::Sleep((DWORD)(500 * CurrentNodeRank()));
@@ -459,6 +562,8 @@ MPIWrapperMpi::~MPIWrapperMpi()
     if (GetMathLibTraceLevel() > 0)
         fprintf(stderr, "~MPIWrapperMpi\n");
 
+    StopProgressThread();
+
     int rc = fflush(stderr);
     if (!std::uncaught_exception())
     {
@@ -485,11 +590,12 @@ int MPIWrapperMpi::MPI_Init_DL()
 
     int argc = 0;
     char **argv = NULL;
-    // TODO(qiwye) Multiverso(parameter server) will benefit from MPI_THREAD_MULTIPLE .
-    int requiredThreadLevelSupport = MPI_THREAD_SERIALIZED;
+    int requiredThreadLevelSupport = s_multipleThreadSupportRequested ? MPI_THREAD_MULTIPLE : MPI_THREAD_SERIALIZED;
+    // the progress thread asks for MPI_THREAD_MULTIPLE too, but falls back to running without it
+    int requestedThreadLevelSupport = IsProgressThreadRequested() ? MPI_THREAD_MULTIPLE : requiredThreadLevelSupport;
     int provided;
-    int ret = MPI_Init_thread(&argc, &argv, requiredThreadLevelSupport, &provided);
-    if (provided != requiredThreadLevelSupport)
+    int ret = MPI_Init_thread(&argc, &argv, requestedThreadLevelSupport, &provided);
+    if (provided < requiredThreadLevelSupport)
         LogicError("Failed to initialize MPI with the desired level of thread support");
 
     return ret;
@@ -580,19 +686,29 @@ void MPIWrapperMpi::RequestNodes(const char *msg, size_t requestednodes /*defaul
     }
     Ping("requestnodes (after change)");
 
+    DetermineHosts();
+
+    fprintf(stderr, "requestnodes [%s]: using %d out of %d MPI nodes on %s (%d requested); we (%d) are %s\n",
+        msg, (int)m_numNodesInUse, (int)m_numMPINodes, m_multiHost ? "multiple hosts" : "a single host",
+        (int)requestednodes, (int)CurrentNodeRank(), IsIdle() ? "out (idle)" : "in (participating)");
+    fflush(stderr);
+}
+
+void MPIWrapperMpi::DetermineHosts()
+{
     // If all ranks run on a single host, we can enable optimized communication
     // paths (e.g. NCCL). To determine if a single machine is being used, we
     // check that MPI_Get_processor_name matches for all ranks.
     const int nameMax = MPI_MAX_PROCESSOR_NAME + 1;
     char myName[nameMax] = { 0 };
     int  myNameLen = 0;
-    MPI_Get_processor_name(myName, &myNameLen) || MpiFail("requestnodes: MPI_Get_processor_name");
+    MPI_Get_processor_name(myName, &myNameLen) || MpiFail("determinehosts: MPI_Get_processor_name");
     myName[myNameLen] = '\0';
 
     std::vector<char> nameBuffer(m_numNodesInUse * nameMax);
     char* allNames = nameBuffer.data();
     MPI_Allgather(myName, nameMax, MPI_CHAR, allNames, nameMax, MPI_CHAR, m_currentComm)
-        || MpiFail("requestnodes: MPI_Allgather");
+        || MpiFail("determinehosts: MPI_Allgather");
 
     m_multiHost = false;
     for (size_t i = 1; i<m_numNodesInUse; i++)
@@ -604,10 +720,81 @@ void MPIWrapperMpi::RequestNodes(const char *msg, size_t requestednodes /*defaul
         }
     }
 
-    fprintf(stderr, "requestnodes [%s]: using %d out of %d MPI nodes on %s (%d requested); we (%d) are %s\n",
-        msg, (int)m_numNodesInUse, (int)m_numMPINodes, m_multiHost ? "multiple hosts" : "a single host",
-        (int)requestednodes, (int)CurrentNodeRank(), IsIdle() ? "out (idle)" : "in (participating)");
+    m_localRank = 0;
+    m_numLocalRanks = 0;
+    for (size_t i = 0; i < m_numNodesInUse; i++)
+    {
+        if (strcmp(myName, allNames + i*nameMax) == 0)
+        {
+            if (i < CurrentNodeRank())
+                m_localRank++;
+            m_numLocalRanks++;
+        }
+    }
+}
+
+bool MPIWrapperMpi::EnableFaultTolerance()
+{
+#if HAS_MPI_FAULT_TOLERANCE
+    MPI_Comm_set_errhandler(m_currentComm, MPI_ERRORS_RETURN) || MpiFail("enablefaulttolerance: MPI_Comm_set_errhandler");
+    m_faultTolerant = true;
+#else
+    fprintf(stderr, "enablefaulttolerance: this MPI implementation does not support fault tolerance (ULFM), the failure of a rank will end the job\n");
     fflush(stderr);
+#endif
+    return m_faultTolerant;
+}
+
+bool MPIWrapperMpi::IsProcessFailure(int errorcode) const
+{
+#if HAS_MPI_FAULT_TOLERANCE
+    if (!m_faultTolerant || errorcode == MPI_SUCCESS)
+        return false;
+
+    int errorClass = errorcode;
+    MPI_Error_class(errorcode, &errorClass);
+    return errorClass == MPIX_ERR_PROC_FAILED || errorClass == MPIX_ERR_REVOKED
+#ifdef MPIX_ERR_PROC_FAILED_PENDING
+        || errorClass == MPIX_ERR_PROC_FAILED_PENDING
+#endif
+        ;
+#else
+    UNUSED(errorcode);
+    return false;
+#endif
+}
+
+void MPIWrapperMpi::RecoverFromProcessFailure()
+{
+#if HAS_MPI_FAULT_TOLERANCE
+    if (!m_faultTolerant)
+        LogicError("RecoverFromProcessFailure: fault tolerance has not been enabled.");
+
+    // revoking makes the operations still pending on the other survivors fail as well, so that they all get here
+    // (the communicator may have been revoked by another survivor already, which is not an error)
+    MPIX_Comm_revoke(m_currentComm);
+
+    MPI_Comm survivors;
+    MPIX_Comm_shrink(m_currentComm, &survivors) || MpiFail("recoverfromprocessfailure: MPIX_Comm_shrink");
+    if (m_currentComm != MPI_COMM_WORLD)
+        MPI_Comm_free(&m_currentComm);
+    m_currentComm = survivors;
+    MPI_Comm_set_errhandler(m_currentComm, MPI_ERRORS_RETURN) || MpiFail("recoverfromprocessfailure: MPI_Comm_set_errhandler");
+
+    const int previousNumNodes = m_numMPINodes;
+    MPI_Comm_rank(m_currentComm, &m_myRank);
+    MPI_Comm_size(m_currentComm, &m_numMPINodes);
+    m_numNodesInUse = m_numMPINodes;
+    s_myRank = m_myRank;
+
+    DetermineHosts();
+
+    fprintf(stderr, "recoverfromprocessfailure: %d of %d MPI nodes survived on %s; we are now %d\n",
+        m_numMPINodes, previousNumNodes, m_multiHost ? "multiple hosts" : "a single host", m_myRank);
+    fflush(stderr);
+#else
+    LogicError("RecoverFromProcessFailure: this MPI implementation does not support fault tolerance.");
+#endif
 }
 
 bool MPIWrapperMpi::IsMultiHost() const
@@ -615,6 +802,16 @@ bool MPIWrapperMpi::IsMultiHost() const
     return m_multiHost;
 }
 
+size_t MPIWrapperMpi::LocalRank() const
+{
+    return m_localRank;
+}
+
+size_t MPIWrapperMpi::NumLocalRanks() const
+{
+    return m_numLocalRanks;
+}
+
 MPI_Comm MPIWrapperMpi::Communicator() const
 {
     return m_currentComm;
@@ -622,6 +819,7 @@ MPI_Comm MPIWrapperMpi::Communicator() const
 
 int MPIWrapperMpi::Finalize(void)
 {
+    StopProgressThread();
     return MPI_Finalize();
 }
 
@@ -633,27 +831,37 @@ int MPIWrapperMpi::WaitAll()
 
 int MPIWrapperMpi::Wait(MPI_Request* request, MPI_Status* status)
 {
+    UntrackRequests(request, 1);
     return MPI_Wait(request, status);
 }
 
 int MPIWrapperMpi::WaitAll(std::vector<MPI_Request>& requests)
 {
+    UntrackRequests(requests.data(), (int)requests.size());
     return MPI_Waitall((int)requests.size(), &requests[0], MPI_STATUSES_IGNORE) || MpiFail("waitall: MPI_Waitall");
 }
 
 int MPIWrapperMpi::Waitany(int count, MPI_Request array_of_requests[], int* index, MPI_Status* status)
 {
-    return MPI_Waitany(count, array_of_requests, index, status);
+    // the requests that do not complete here stay outstanding, so they go back on the list of the progress thread
+    UntrackRequests(array_of_requests, count);
+    int ret = MPI_Waitany(count, array_of_requests, index, status);
+    for (int i = 0; i < count; i++)
+        TrackRequest(array_of_requests[i]);
+    return ret;
 }
 
 int MPIWrapperMpi::Waitall(int count, MPI_Request array_of_requests[], MPI_Status array_of_statuses[])
 {
+    UntrackRequests(array_of_requests, count);
     return MPI_Waitall(count, array_of_requests, array_of_statuses);
 }
 
 int MPIWrapperMpi::Isend(const void* buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Request* request)
 {
-    return MPI_Isend(buf, count, datatype, dest, tag, m_currentComm, request);
+    int ret = MPI_Isend(buf, count, datatype, dest, tag, m_currentComm, request);
+    TrackRequest(*request);
+    return ret;
 }
 
 int MPIWrapperMpi::Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Status* status)
@@ -663,12 +871,23 @@ int MPIWrapperMpi::Recv(void* buf, int count, MPI_Datatype datatype, int source,
 
 int MPIWrapperMpi::Irecv(void* buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Request* request)
 {
-    return MPI_Irecv(buf, count, datatype, source, tag, m_currentComm, request);
+    int ret = MPI_Irecv(buf, count, datatype, source, tag, m_currentComm, request);
+    TrackRequest(*request);
+    return ret;
 }
 
 int MPIWrapperMpi::Iallreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Request* request)
 {
-    return MPI_Iallreduce(sendbuf, recvbuf, count, datatype, op, m_currentComm, request);
+    int ret = MPI_Iallreduce(sendbuf, recvbuf, count, datatype, op, m_currentComm, request);
+    TrackRequest(*request);
+    return ret;
+}
+
+int MPIWrapperMpi::Ibcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Request* request)
+{
+    int ret = MPI_Ibcast(buffer, count, datatype, root, m_currentComm, request);
+    TrackRequest(*request);
+    return ret;
 }
 
 int MPIWrapperMpi::Abort(int errorcode)
@@ -682,14 +901,147 @@ int MPIWrapperMpi::Error_string(int errorcode, char* str, int* resultlen)
     return MPI_Error_string(errorcode, str, resultlen);
 }
 
-bool MPIWrapperMpi::UseGpuGdr()
+bool MPIWrapperMpi::SupportsMultipleThreads() const
 {
-    // Only support GPUDirect RDMA on Unix and built with GDR
-#if defined(USE_CUDA_GDR) && defined(__unix__)
-    return true;
-#else
-    return false;
+    int provided = MPI_THREAD_SINGLE;
+    MPI_Query_thread(&provided) || MpiFail("supportsmultiplethreads: MPI_Query_thread");
+    return provided == MPI_THREAD_MULTIPLE;
+}
+
+bool MPIWrapperMpi::UsesProgressThread() const
+{
+    return m_progressThread.joinable();
+}
+
+void MPIWrapperMpi::StartProgressThread()
+{
+    m_stopProgressThread = false;
+    m_progressThread = std::thread([this]() { ProgressThreadLoop(); });
+    if (GetMathLibTraceLevel() > 0)
+        fprintf(stderr, "MPIWrapperMpi: started the progress thread for non-blocking calls\n");
+}
+
+void MPIWrapperMpi::StopProgressThread()
+{
+    if (!m_progressThread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_progressMutex);
+        m_stopProgressThread = true;
+    }
+    m_progressCondition.notify_one();
+    m_progressThread.join();
+    m_progressRequests.clear();
+}
+
+void MPIWrapperMpi::ProgressThreadLoop()
+{
+    std::unique_lock<std::mutex> lock(m_progressMutex);
+    while (!m_stopProgressThread)
+    {
+        if (m_progressRequests.empty())
+        {
+            m_progressCondition.wait(lock);
+            continue;
+        }
+
+        // Errors are left to the Wait, which reports them to the caller.
+        for (size_t i = 0; i < m_progressRequests.size();)
+        {
+            int completed = 0;
+            if (MPI_Request_get_status(m_progressRequests[i], &completed, MPI_STATUS_IGNORE) != MPI_SUCCESS || completed)
+            {
+                m_progressRequests[i] = m_progressRequests.back();
+                m_progressRequests.pop_back();
+            }
+            else
+                i++;
+        }
+
+        // let the Wait functions and the non-blocking calls of the other threads get at the list between the polls
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+        lock.lock();
+    }
+}
+
+void MPIWrapperMpi::TrackRequest(MPI_Request request) const
+{
+    if (!m_progressThread.joinable() || request == MPI_REQUEST_NULL)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_progressMutex);
+        m_progressRequests.push_back(request);
+    }
+    m_progressCondition.notify_one();
+}
+
+void MPIWrapperMpi::UntrackRequests(const MPI_Request* requests, int count) const
+{
+    if (!m_progressThread.joinable())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_progressMutex);
+    for (int i = 0; i < count; i++)
+    {
+        auto iter = std::find(m_progressRequests.begin(), m_progressRequests.end(), requests[i]);
+        if (iter != m_progressRequests.end())
+        {
+            *iter = m_progressRequests.back();
+            m_progressRequests.pop_back();
+        }
+    }
+}
+
+void MPIWrapperMpi::DetermineCudaAwareness()
+{
+    int level = 0;
+    const char* p = std::getenv("CNTK_CUDA_AWARE_MPI");
+    if (p && *p)
+        level = std::max(0, std::min(2, atoi(p)));
+    else
+    {
+        // Only support GPUDirect RDMA on Unix
+#if defined(__unix__)
+#if defined(USE_CUDA_GDR)
+        level = 1;
 #endif
+#if defined(MPIX_CUDA_AWARE_SUPPORT) && MPIX_CUDA_AWARE_SUPPORT
+        // Open MPI built with CUDA support; the library we run with may still have been built without it
+        if (MPIX_Query_cuda_support())
+            level = 1;
+#endif
+#if defined(MVAPICH2_VERSION)
+        // MVAPICH2(-GDR) handles GPU buffers in all calls, if enabled for this run
+        const char* useCuda = std::getenv("MV2_USE_CUDA");
+        if (useCuda && atoi(useCuda) == 1)
+            level = 2;
+#endif
+#endif
+    }
+
+    // all ranks must take the same code paths
+    MPI_Allreduce(MPI_IN_PLACE, &level, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD) || MpiFail("DetermineCudaAwareness: MPI_Allreduce");
+    m_cudaAwareLevel = level;
+
+    if (m_cudaAwareLevel > 0 && m_numMPINodes > 1)
+    {
+        fprintf(stderr, "mpihelper: CUDA-aware MPI, GPU buffers are passed to MPI directly%s\n",
+                m_cudaAwareLevel < 2 ? " (except for non-blocking collectives)" : "");
+        fflush(stderr);
+    }
+}
+
+bool MPIWrapperMpi::UseGpuGdr()
+{
+    return m_cudaAwareLevel > 0;
+}
+
+bool MPIWrapperMpi::UseGpuGdrForNonblockingCollectives()
+{
+    return m_cudaAwareLevel > 1;
 }
 
 size_t MPIWrapperMpi::NumNodesInUse() const
@@ -833,19 +1185,23 @@ void MPIWrapperMpi::AllReduceAsync(float* sendData, size_t numElements, MPI_Requ
 void MPIWrapperMpi::AllReduceAsync(size_t *sendData, size_t *receiveData, size_t numElements, MPI_Request* request, MPI_Op op) const
 {
     MPI_Iallreduce(sendData, receiveData, (int)numElements, GetDataType(sendData), op, Communicator(), request) || MpiFail("AllReduceAsync: MPI_Iallreduce");
+    TrackRequest(*request);
 }
 
 void MPIWrapperMpi::AllReduceAsync(int *sendData, int *receiveData, size_t numElements, MPI_Request* request, MPI_Op op) const
 {
     MPI_Iallreduce(sendData, receiveData, (int)numElements, GetDataType(sendData), op, Communicator(), request) || MpiFail("AllReduceAsync: MPI_Iallreduce");
+    TrackRequest(*request);
 }
 void MPIWrapperMpi::AllReduceAsync(double *sendData, double *receiveData, size_t numElements, MPI_Request* request, MPI_Op op) const
 {
     MPI_Iallreduce(sendData, receiveData, (int)numElements, GetDataType(sendData), op, Communicator(), request) || MpiFail("AllReduceAsync: MPI_Iallreduce");
+    TrackRequest(*request);
 }
 void MPIWrapperMpi::AllReduceAsync(float *sendData, float *receiveData, size_t numElements, MPI_Request* request, MPI_Op op) const
 {
     MPI_Iallreduce(sendData, receiveData, (int)numElements, GetDataType(sendData), op, Communicator(), request) || MpiFail("AllReduceAsync: MPI_Iallreduce");
+    TrackRequest(*request);
 }
 
 
@@ -867,21 +1223,25 @@ void MPIWrapperMpi::Bcast(void* buffer, int count, MPI_Datatype datatype, int ro
 void MPIWrapperMpi::AllGatherAsync(const size_t *sendData, size_t numSendElements, size_t *receiveData, size_t numRecvElements, MPI_Request* request) const
 {
     MPI_Iallgather(sendData, (int)numSendElements, GetDataType(receiveData), receiveData, (int)numRecvElements, GetDataType(receiveData), Communicator(), request) || MpiFail("AllReduceAsync: MPI_Iallgather");
+    TrackRequest(*request);
 }
 
 void MPIWrapperMpi::AllGatherAsync(const int *sendData, size_t numSendElements, int *receiveData, size_t numRecvElements, MPI_Request* request) const
 {
     MPI_Iallgather(sendData, (int)numSendElements, GetDataType(receiveData), receiveData, (int)numRecvElements, GetDataType(receiveData), Communicator(), request) || MpiFail("AllReduceAsync: MPI_Iallgather");
+    TrackRequest(*request);
 }
 
 void MPIWrapperMpi::AllGatherAsync(const float *sendData, size_t numSendElements, float *receiveData, size_t numRecvElements, MPI_Request* request) const
 {
     MPI_Iallgather(sendData, (int)numSendElements, GetDataType(receiveData), receiveData, (int)numRecvElements, GetDataType(receiveData), Communicator(), request) || MpiFail("AllReduceAsync: MPI_Iallgather");
+    TrackRequest(*request);
 }
 
 void MPIWrapperMpi::AllGatherAsync(const double *sendData, size_t numSendElements, double *receiveData, size_t numRecvElements, MPI_Request* request) const
 {
     MPI_Iallgather(sendData, (int)numSendElements, GetDataType(receiveData), receiveData, (int)numRecvElements, GetDataType(receiveData), Communicator(), request) || MpiFail("AllReduceAsync: MPI_Iallgather");
+    TrackRequest(*request);
 }
 
 void MPIWrapperMpi::AllGather(const size_t *sendData, size_t numSendElements, size_t *receiveData, size_t numRecvElements) const
@@ -957,12 +1317,16 @@ void MPIWrapperMpi::Gatherv(const double *sendData, size_t numSendElements, doub
 // wait for an async request to finish
 void MPIWrapperMpi::Wait(MPI_Request* request)
 {
+    UntrackRequests(request, 1);
     MPI_Wait(request, MPI_STATUSES_IGNORE) || MpiFail("Wait: MPI_Wait");
 }
 
 void MPIWrapperMpi::WaitAny(MPI_Request* requests, int numRequests, int* index)
 {
+    UntrackRequests(requests, numRequests);
     MPI_Waitany(numRequests, requests, index, MPI_STATUSES_IGNORE) || MpiFail("WaitAny: MPI_Waitany");
+    for (int i = 0; i < numRequests; i++)
+        TrackRequest(requests[i]);
 }
 
 #endif
@@ -998,11 +1362,51 @@ bool MPIWrapperEmpty::IsMultiHost() const
     return false;
 }
 
+size_t MPIWrapperEmpty::LocalRank() const
+{
+    return 0;
+}
+
+size_t MPIWrapperEmpty::NumLocalRanks() const
+{
+    return 1;
+}
+
 bool MPIWrapperEmpty::UseGpuGdr()
 {
     return false;
 }
 
+bool MPIWrapperEmpty::UseGpuGdrForNonblockingCollectives()
+{
+    return false;
+}
+
+bool MPIWrapperEmpty::EnableFaultTolerance()
+{
+    return false;
+}
+
+bool MPIWrapperEmpty::IsProcessFailure(int /*errorcode*/) const
+{
+    return false;
+}
+
+void MPIWrapperEmpty::RecoverFromProcessFailure()
+{
+    LogicError("RecoverFromProcessFailure: not supported without MPI.");
+}
+
+bool MPIWrapperEmpty::SupportsMultipleThreads() const
+{
+    return false;
+}
+
+bool MPIWrapperEmpty::UsesProgressThread() const
+{
+    return false;
+}
+
 int MPIWrapperEmpty::Finalize(void)
 {
     return MPI_UNDEFINED;
@@ -1054,6 +1458,11 @@ int MPIWrapperEmpty::Iallreduce(const void* sendbuf, void* recvbuf, int count, M
     return MPI_UNDEFINED;
 }
 
+int MPIWrapperEmpty::Ibcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Request* request)
+{
+    return MPI_UNDEFINED;
+}
+
 int MPIWrapperEmpty::Abort(int errorcode)
 {
     return MPI_UNDEFINED;
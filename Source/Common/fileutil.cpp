@@ -27,6 +27,7 @@
 #include <glob.h>
 #include <dirent.h>
 #include <sys/sendfile.h>
+#include <fcntl.h> // for posix_fadvise()
 #endif
 #include <stdio.h>
 #include <string.h>
@@ -40,6 +41,7 @@
 #include <algorithm> // for std::find
 #include <limits.h>
 #include <memory>
+#include <mutex>
 #include <cwctype>
 #ifndef UNDER_CE // some headers don't exist under winCE - the appropriate definitions seem to be in stdlib.h
 #if defined(_WIN32) || defined(__CYGWIN__)
@@ -251,9 +253,105 @@ FILE* fopenStdHandle(const _T* mode)
     return f;
 }
 
+// tell the OS that the file will be read sequentially, so that it reads ahead more aggressively
+// (On Windows, the 'S' mode flag of fopen() does that.)
+// ----------------------------------------------------------------------------
+// fetchRemoteFile(): local copy of a file in remote storage (see fileutil.h)
+// ----------------------------------------------------------------------------
+
+static std::wstring remoteFileCacheDir()
+{
+    const char* dir = getenv("CNTK_REMOTE_FILE_CACHE");
+    if (dir && *dir)
+        return msra::strfun::utf16(dir);
+#ifdef _WIN32
+    const wchar_t* temp = _wgetenv(L"TEMP");
+    return std::wstring(temp ? temp : L".") + L"\\CNTKRemoteFileCache";
+#else
+    const char* temp = getenv("TMPDIR");
+    return msra::strfun::utf16(temp && *temp ? temp : "/tmp") + L"/CNTKRemoteFileCache";
+#endif
+}
+
+std::wstring fetchRemoteFile(const std::wstring& pathname)
+{
+    // <scheme>://; a single letter is a Windows drive
+    auto schemeEnd = pathname.find(L"://");
+    if (schemeEnd == std::wstring::npos || schemeEnd < 2 ||
+        !std::all_of(pathname.begin(), pathname.begin() + schemeEnd, [](wchar_t c) { return iswalnum(c) || c == L'+' || c == L'-' || c == L'.'; }))
+        return pathname;
+
+    std::string variable = "CNTK_FETCH_";
+    for (size_t i = 0; i < schemeEnd; i++)
+        variable += (char) toupper((char) pathname[i]);
+    const char* command = getenv(variable.c_str());
+    if (!command || !*command)
+        return pathname; // not configured: fails when opened
+
+    // The cached file keeps the name of the remote one (e.g. image decoders look at the extension).
+    auto nameBegin = pathname.find_last_of(L'/') + 1;
+    wchar_t hash[32];
+    swprintf(hash, sizeof(hash) / sizeof(*hash), L"%016llx_", (unsigned long long) std::hash<std::wstring>()(pathname));
+    const std::wstring cachePath = remoteFileCacheDir() + L"/" + hash + pathname.substr(nameBegin);
+
+    // each file is fetched by one thread, while the others that want it wait
+    static std::mutex s_fetchesMutex;
+    static std::map<std::wstring, std::shared_ptr<std::mutex>> s_fetches;
+    std::shared_ptr<std::mutex> fetchMutex;
+    {
+        std::lock_guard<std::mutex> lock(s_fetchesMutex);
+        auto& entry = s_fetches[cachePath];
+        if (!entry)
+            entry = std::make_shared<std::mutex>();
+        fetchMutex = entry;
+    }
+    std::lock_guard<std::mutex> lock(*fetchMutex);
+    if (fexists(cachePath))
+        return cachePath;
+
+    // Fetch into a temporary file, so that other processes on this machine never see a partial file.
+    msra::files::make_intermediate_dirs(cachePath);
+    const std::wstring partPath = cachePath + L".part" + std::to_wstring(GetCurrentProcessId());
+    std::wstring fetchCommand = msra::strfun::utf16(command);
+    fetchCommand = msra::strfun::ReplaceAll<std::wstring>(fetchCommand, L"%f", L"\"" + partPath + L"\"");
+    fetchCommand = msra::strfun::ReplaceAll<std::wstring>(fetchCommand, L"%u", L"\"" + pathname + L"\""); // last, since URLs may contain %
+    int rc = _wsystem(fetchCommand.c_str());
+    if (rc != 0 || !fexists(partPath))
+    {
+        _wunlink(partPath.c_str());
+        RuntimeError("error fetching file '%ls': command '%ls' failed with exit code %d", pathname.c_str(), fetchCommand.c_str(), rc);
+    }
+    renameOrDie(partPath, cachePath);
+    return cachePath;
+}
+
+std::string fetchRemoteFile(const std::string& pathname)
+{
+    if (pathname.find("://") == std::string::npos)
+        return pathname;
+    return msra::strfun::utf8(fetchRemoteFile(msra::strfun::utf16(pathname)));
+}
+
+#ifdef __unix__
+static void fadviseSequential(FILE* f)
+{
+    if (f != stdin && f != stdout)
+        posix_fadvise(fileno(f), 0, 0, POSIX_FADV_SEQUENTIAL); // OK if it fails
+}
+#else
+static void fadviseSequential(FILE*) { }
+#endif
+
+// remote files can only be read (see fetchRemoteFile())
+template <class _T>
+static bool isReadOnlyMode(const _T* mode)
+{
+    return strchr(mode, 'r') && !strchr(mode, '+');
+}
+
 FILE* fopenOrDie(const string& pathname, const char* mode)
 {
-    FILE* f = (pathname[0] == '-') ? fopenStdHandle(mode) : fopen(pathname.c_str(), mode);
+    FILE* f = (pathname[0] == '-') ? fopenStdHandle(mode) : fopen(isReadOnlyMode(mode) ? fetchRemoteFile(pathname).c_str() : pathname.c_str(), mode);
     if (f == NULL)
     {
         RuntimeError("error opening file '%s': %s", pathname.c_str(), strerror(errno));
@@ -262,13 +360,14 @@ FILE* fopenOrDie(const string& pathname, const char* mode)
     {
         // If optimized for sequential access, then use large buffer. OK if it fails
         setvbuf(f, NULL, _IOFBF, LARGE_BUF_SIZE);
+        fadviseSequential(f);
     }
     return f;
 }
 
 FILE* fopenOrDie(const wstring& pathname, const wchar_t* mode)
 {
-    FILE* f = (pathname[0] == '-') ? fopenStdHandle(mode) : _wfopen(pathname.c_str(), mode);
+    FILE* f = (pathname[0] == '-') ? fopenStdHandle(mode) : _wfopen(isReadOnlyMode(mode) ? fetchRemoteFile(pathname).c_str() : pathname.c_str(), mode);
     if (f == NULL)
     {
         RuntimeError("error opening file '%ls': %s", pathname.c_str(), strerror(errno));
@@ -277,6 +376,7 @@ FILE* fopenOrDie(const wstring& pathname, const wchar_t* mode)
     {
         // If optimized for sequential access, then use large buffer. OK if it fails
         setvbuf(f, NULL, _IOFBF, LARGE_BUF_SIZE);
+        fadviseSequential(f);
     }
     return f;
 }
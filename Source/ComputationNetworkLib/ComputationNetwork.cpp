@@ -47,6 +47,12 @@ vector<MemRequestInfo<double>>& MatrixPool::GetMemRequestInfoVec<double>()
     return m_memRequestInfoDoubleVec;
 }
 
+template <>
+vector<MemRequestInfo<half>>& MatrixPool::GetMemRequestInfoVec<half>()
+{
+    return m_memRequestInfoHalfVec;
+}
+
 // -----------------------------------------------------------------------
 // construction
 // -----------------------------------------------------------------------
@@ -95,6 +101,7 @@ void ComputationNetwork::SaveEdited(const wstring& fileName, const FileOptions f
 void ComputationNetwork::Save(const wstring& fileName, const FileOptions fileFormat) const
 {
     VerifyIsCompiled("Save");
+    WaitForAsyncSave();
     // Saving into temporary file and then renaming it to the requested fileName
     // This is a standard trick to avoid havign corrupted model files if process dies during writing
     wstring tmpFileName = fileName + L".tmp";
@@ -105,7 +112,7 @@ void ComputationNetwork::Save(const wstring& fileName, const FileOptions fileFor
 // TODO: how does the file distinguish float vs double nodes?
 void ComputationNetwork::SaveToFileImpl(const wstring& fileName, const FileOptions fileFormat) const
 {
-    File fstream(fileName, fileFormat | FileOptions::fileOptionsWrite);
+    File fstream(fileName, fileFormat | FileOptions::fileOptionsWrite | FileOptions::fileOptionsSequential);
     // Buffer writes in memory then flush to filesystem, which reduces number of small writes
     fstream.Setvbuf();
     fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BCN");
@@ -196,6 +203,243 @@ void ComputationNetwork::SaveToFileImpl(const wstring& fileName, const FileOptio
     fstream.Flush();
 }
 
+// -----------------------------------------------------------------------
+// saving in the background, and delta models
+// -----------------------------------------------------------------------
+
+// the nodes whose Save() writes their value (which may change during training)
+static bool SavesValue(const ComputationNodeBasePtr& node)
+{
+    return node->OperationName() == OperationNameOf(LearnableParameter) || dynamic_pointer_cast<IPreComputeNode>(node);
+}
+
+// copy the value of a node into host memory for SaveAsync(), see ComputationNode::ValueToSave()
+template <class ElemType>
+static bool TrySetValueToSave(const ComputationNodeBasePtr& node)
+{
+    auto n = dynamic_pointer_cast<ComputationNode<ElemType>>(node);
+    if (!n)
+        return false;
+    auto value = make_shared<Matrix<ElemType>>(CPUDEVICE);
+    value->AssignValuesOf(n->Value());
+    n->SetValueToSave(value);
+    return true;
+}
+
+// FNV-1a hash of the saved value of a node (in host memory), to find the parameters that changed since the base of the delta models
+template <class ElemType>
+static bool TryHashValueToSave(const ComputationNodeBasePtr& node, uint64_t& hash)
+{
+    auto n = dynamic_pointer_cast<ComputationNode<ElemType>>(node);
+    if (!n)
+        return false;
+    const auto& value = n->ValueToSave();
+    const char* data = (const char*) value.Data();
+    const size_t numBytes = value.GetNumElements() * sizeof(ElemType);
+    const uint64_t prime = 1099511628211ull;
+    hash = 14695981039346656037ull;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= numBytes; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < numBytes; i++)
+        hash = (hash ^ (unsigned char) data[i]) * prime;
+    // (the learning-rate multiplier is saved as well)
+    double learningRateMultiplier = n->GetLearningRateMultiplier();
+    uint64_t word;
+    memcpy(&word, &learningRateMultiplier, sizeof(word));
+    hash = (hash ^ word) * prime;
+    return true;
+}
+
+template <class ElemType>
+static void TryResetValueToSave(const ComputationNodeBasePtr& node)
+{
+    auto n = dynamic_pointer_cast<ComputationNode<ElemType>>(node);
+    if (n)
+        n->SetValueToSave(nullptr);
+}
+
+// The values that may change during training are copied into host memory here. The rest of what nodes save is their
+// configuration, which the background thread can read while training goes on.
+void ComputationNetwork::SaveAsync(const wstring& fileName, bool delta, const function<void()>& onSaved)
+{
+    VerifyIsCompiled("SaveAsync");
+    WaitForAsyncSave();
+
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        if (!SavesValue(node))
+            continue;
+        if (node->ValuePtr()->GetMatrixType() != DENSE) // (sparse values cannot be copied into host memory, so fall back to saving synchronously)
+        {
+            Save(fileName);
+            if (onSaved)
+                onSaved();
+            return;
+        }
+    }
+
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        if (!SavesValue(node))
+            continue;
+        if (!TrySetValueToSave<float>(node) && !TrySetValueToSave<double>(node))
+            LogicError("SaveAsync: Unexpected precision of node '%ls'.", node->NodeName().c_str());
+        m_asyncSaveNodes.push_back(node);
+    }
+
+    auto nodes = m_asyncSaveNodes;
+    m_asyncSave = async(launch::async, [this, fileName, delta, onSaved, nodes]()
+    {
+        map<wstring, uint64_t> hashes;
+        if (delta)
+        {
+            for (const auto& node : nodes)
+            {
+                uint64_t hash;
+                if (!TryHashValueToSave<float>(node, hash) && !TryHashValueToSave<double>(node, hash))
+                    LogicError("SaveAsync: Unexpected precision of node '%ls'.", node->NodeName().c_str());
+                hashes[node->NodeName()] = hash;
+            }
+        }
+
+        // Saving into temporary file and then renaming it to the requested fileName, see Save()
+        wstring tmpFileName = fileName + L".tmp";
+        if (delta && !m_deltaBaseFileName.empty() && fexists(m_deltaBaseFileName))
+        {
+            vector<ComputationNodeBasePtr> changedNodes;
+            for (const auto& node : nodes)
+            {
+                auto baseHash = m_deltaBaseValueHashes.find(node->NodeName());
+                if (baseHash == m_deltaBaseValueHashes.end() || baseHash->second != hashes[node->NodeName()])
+                    changedNodes.push_back(node);
+            }
+            SaveDeltaToFileImpl(tmpFileName, changedNodes);
+            renameOrDie(tmpFileName, fileName);
+        }
+        else
+        {
+            SaveToFileImpl(tmpFileName, FileOptions::fileOptionsBinary);
+            renameOrDie(tmpFileName, fileName);
+            if (delta) // this is the new base
+            {
+                m_deltaBaseFileName = fileName;
+                m_deltaBaseValueHashes = move(hashes);
+            }
+        }
+
+        if (onSaved)
+            onSaved();
+    });
+}
+
+void ComputationNetwork::WaitForAsyncSave() const
+{
+    if (!m_asyncSave.valid())
+        return;
+
+    auto nodes = move(m_asyncSaveNodes);
+    m_asyncSaveNodes.clear();
+    for (const auto& node : nodes)
+    {
+        TryResetValueToSave<float>(node);
+        TryResetValueToSave<double>(node);
+    }
+    m_asyncSave.get(); // (rethrows the error of the save)
+}
+
+template <class ElemType>
+static bool TrySetStorageFormat(const ComputationNodeBasePtr& node, MatrixStorageFormat storageFormat)
+{
+    auto n = dynamic_pointer_cast<LearnableParameter<ElemType>>(node);
+    if (!n)
+        return false;
+    // (with a scale per row or column, the int8 formats would not make a vector any smaller)
+    const bool isVector = n->Value().GetNumRows() == 1 || n->Value().GetNumCols() == 1;
+    n->SetStorageFormat(isVector && storageFormat != MatrixStorageFormat::float16 ? MatrixStorageFormat::full : storageFormat);
+    return true;
+}
+
+size_t ComputationNetwork::SetParameterStorageFormat(const wstring& nodeNameRegex, MatrixStorageFormat storageFormat)
+{
+    wregex nameFilter(nodeNameRegex);
+    size_t numMatched = 0;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        if (regex_match(iter.first, nameFilter) &&
+            (TrySetStorageFormat<float>(iter.second, storageFormat) || TrySetStorageFormat<double>(iter.second, storageFormat)))
+            numMatched++;
+    }
+    return numMatched;
+}
+
+// A delta model has the parameters whose values changed since the base was saved, in the format of Read(). The base
+// is referred to by its file name in the same directory, and its size, to detect that it has been overwritten since.
+void ComputationNetwork::SaveDeltaToFileImpl(const wstring& fileName, const vector<ComputationNodeBasePtr>& changedNodes) const
+{
+    size_t baseFileSize;
+    {
+        File baseFile(m_deltaBaseFileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+        baseFileSize = baseFile.Size();
+    }
+
+    File fstream(fileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsWrite);
+    fstream.Setvbuf();
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BCNDelta");
+    fstream << (size_t) CURRENT_CNTK_MODEL_VERSION;
+    fstream << File::FileNameOf(m_deltaBaseFileName) << baseFileSize;
+    fstream << changedNodes.size();
+    for (const auto& node : changedNodes)
+    {
+        fstream << node->NodeName();
+        node->Save(fstream);
+    }
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ECNDelta");
+    fstream.Flush();
+}
+
+/*static*/ wstring ComputationNetwork::GetBaseOfDeltaModel(const wstring& fileName)
+{
+    File fstream(fileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+    if (!fstream.TryGetMarker(FileMarker::fileMarkerBeginSection, L"BCNDelta"))
+        return wstring();
+
+    size_t modelVersion, baseFileSize;
+    wstring baseName;
+    fstream >> modelVersion >> baseName >> baseFileSize;
+    wstring baseFileName = File::DirectoryPathOf(fileName) + L"/" + baseName;
+    if (!fexists(baseFileName))
+        RuntimeError("Read: The base '%ls' of the delta model '%ls' does not exist.", baseFileName.c_str(), fileName.c_str());
+    File baseFile(baseFileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+    if (baseFile.Size() != baseFileSize)
+        RuntimeError("Read: The base '%ls' of the delta model '%ls' has been overwritten since the delta model was saved.", baseFileName.c_str(), fileName.c_str());
+    return baseFileName;
+}
+
+void ComputationNetwork::ReadDeltaModel(const wstring& fileName)
+{
+    File fstream(fileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead | FileOptions::fileOptionsSequential);
+    fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BCNDelta");
+    size_t modelVersion, baseFileSize, numNodes;
+    wstring baseName;
+    fstream >> modelVersion >> baseName >> baseFileSize >> numNodes;
+    if (modelVersion > CURRENT_CNTK_MODEL_VERSION)
+        InvalidArgument("Read: The model file has a newer format version (%d) than this CNTK version can handle (%d).", (int)modelVersion, (int)CURRENT_CNTK_MODEL_VERSION);
+    for (size_t i = 0; i < numNodes; i++)
+    {
+        wstring nodeName;
+        fstream >> nodeName;
+        GetNodeFromName(nodeName)->Load(fstream, modelVersion);
+    }
+    fstream.GetMarker(FileMarker::fileMarkerEndSection, L"ECNDelta");
+}
+
 
 size_t ComputationNetwork::GetModelVersion(File& fstream) 
 {
@@ -272,9 +516,19 @@ void ComputationNetwork::ReadPersistableParameters(size_t modelVersion, File& fs
 template <class ElemType> // for ReadPersistableParameters()
 void ComputationNetwork::Read(const wstring& fileName)
 {
+    WaitForAsyncSave();
     ClearNetwork();
 
-    File fstream(fileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+    auto baseFileName = GetBaseOfDeltaModel(fileName);
+    if (!baseFileName.empty())
+    {
+        Read<ElemType>(baseFileName);
+        ReadDeltaModel(fileName);
+        ReadShards(fileName);
+        return;
+    }
+
+    File fstream(fileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead | FileOptions::fileOptionsSequential);
 
     auto modelVersion = GetModelVersion(fstream);
 
@@ -406,6 +660,77 @@ void ComputationNetwork::Read(const wstring& fileName)
     fstream.GetMarker(FileMarker::fileMarkerEndSection, L"ERootNodes");
 
     fstream.GetMarker(FileMarker::fileMarkerEndSection, L"ECN");
+
+    ReadShards(fileName);
+}
+
+// the parameters that are partitioned across the workers, i.e. input 0 of the sharded nodes (IShardedNode)
+vector<ComputationNodeBasePtr> ComputationNetwork::GetShardedParameters() const
+{
+    vector<ComputationNodeBasePtr> parameters;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        if (dynamic_pointer_cast<IShardedNode>(node) && node->GetNumInputs() > 0 &&
+            find(parameters.begin(), parameters.end(), node->Input(0)) == parameters.end())
+            parameters.push_back(node->Input(0));
+    }
+    return parameters;
+}
+
+static wstring ShardFileName(const wstring& fileName, size_t rank)
+{
+    return fileName + L".shard" + to_wstring(rank);
+}
+
+void ComputationNetwork::SaveShards(const wstring& fileName) const
+{
+    auto mpi = MPIWrapper::GetInstance();
+    auto parameters = GetShardedParameters();
+    if (parameters.empty() || !mpi || mpi->NumNodesInUse() == 1)
+        return;
+
+    wstring shardFileName = ShardFileName(fileName, mpi->CurrentNodeRank());
+    wstring tmpFileName = shardFileName + L".tmp";
+    {
+        File fstream(tmpFileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsWrite);
+        fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BShards");
+        fstream << mpi->NumNodesInUse() << mpi->CurrentNodeRank() << parameters.size();
+        for (const auto& parameter : parameters)
+        {
+            fstream << parameter->NodeName();
+            parameter->Save(fstream);
+        }
+        fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EShards");
+    }
+    renameOrDie(tmpFileName, shardFileName);
+}
+
+void ComputationNetwork::ReadShards(const wstring& fileName)
+{
+    auto mpi = MPIWrapper::GetInstance();
+    auto parameters = GetShardedParameters();
+    if (parameters.empty() || !mpi || mpi->NumNodesInUse() == 1)
+        return;
+
+    wstring shardFileName = ShardFileName(fileName, mpi->CurrentNodeRank());
+    if (!fexists(shardFileName))
+        RuntimeError("ReadShards: The model '%ls' has sharded embedding tables, but the shard file '%ls' of this worker does not exist.", fileName.c_str(), shardFileName.c_str());
+
+    File fstream(shardFileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+    fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BShards");
+    size_t numShards, rank, numParameters;
+    fstream >> numShards >> rank >> numParameters;
+    if (numShards != mpi->NumNodesInUse() || rank != mpi->CurrentNodeRank())
+        RuntimeError("ReadShards: The shard file '%ls' was saved by worker %d of %d, but this is worker %d of %d. Sharded models must be loaded with the same number of workers.",
+                     shardFileName.c_str(), (int) rank, (int) numShards, (int) mpi->CurrentNodeRank(), (int) mpi->NumNodesInUse());
+    for (size_t i = 0; i < numParameters; i++)
+    {
+        wstring nodeName;
+        fstream >> nodeName;
+        GetNodeFromName(nodeName)->Load(fstream, CURRENT_CNTK_MODEL_VERSION);
+    }
+    fstream.GetMarker(FileMarker::fileMarkerEndSection, L"EShards");
 }
 
 // -----------------------------------------------------------------------
@@ -611,6 +936,16 @@ template <class ElemType>
     }
 }
 
+template <class ElemType>
+/*static*/ void ComputationNetwork::SetBatchNormalizationSyncWorkers(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const MPIWrapperPtr& syncWorkers)
+{
+    for (auto& nodeIter : net->GetNodesWithType(OperationNameOf(BatchNormalizationNode), criterionNode))
+    {
+        auto node = dynamic_pointer_cast<BatchNormalizationNode<ElemType>>(nodeIter);
+        node->SetSyncWorkers(syncWorkers);
+    }
+}
+
 //set sequence training parameters, e.g. smoothing weight, frame drop threshhold
 template <class ElemType>
 void ComputationNetwork::SetSeqParam(ComputationNetworkPtr net,
@@ -651,6 +986,7 @@ void ComputationNetwork::SetSeqParam(ComputationNetworkPtr net,
     if (maxTempMemSizeInSamples > 0)
         fprintf(stderr, "Setting max temp memory size for Convolution operations to %lu samples.\n", (unsigned long)maxTempMemSizeInSamples);
     list<ComputationNodeBasePtr> convolutionNodes = net->GetNodesWithType(OperationNameOf(ConvolutionNode), criterionNode);
+    convolutionNodes.splice(convolutionNodes.end(), net->GetNodesWithType(OperationNameOf(BinaryConvolutionNode), criterionNode));
     if (convolutionNodes.size() == 0 && maxTempMemSizeInSamples != 0)
     {
         fprintf(stderr, "WARNING: No Convolution operation found.\n");
@@ -1154,6 +1490,263 @@ void ComputationNetwork::PerformSVDecomposition(const map<wstring, float>& SVDCo
     CompileNetwork();
 }
 
+// ========================================
+// This function folds inference-mode batch normalization into the convolution that feeds it.
+// A spatial BatchNormalization node computes per output channel k
+//  y = (x - mean[k]) * scale[k] / sqrt(var[k] + eps) + bias[k]
+// which is linear in x. If x = W * input (+ b) is the output of a convolution, the node can be removed by
+// scaling the kernel of channel k by alpha[k] = scale[k] / sqrt(var[k] + eps) and adding the bias
+//  (b[k] - mean[k]) * alpha[k] + bias[k]
+// The BatchNormalization node is replaced by a Plus node of the same name, so that e.g. a following ReLU or the
+// output node groups are not affected. The statistics are frozen, so the result is only meant for inference.
+// Only convolutions whose kernel and output are used by nothing else are folded.
+// ========================================
+template <class ElemType>
+void ComputationNetwork::FoldBatchNormalization()
+{
+    // the BN node's inputs, see BatchNormalizationNode
+    enum { SCALE = 1, BIAS, RUN_MEAN, RUN_VAR };
+
+    auto IsOnlyUsedBy = [this](const ComputationNodeBasePtr& node, const ComputationNodeBasePtr& user)
+    {
+        auto parents = GetParentNodes(node->NodeName());
+        return parents.size() == 1 && parents[0] == user;
+    };
+
+    auto ValueOf = [](const ComputationNodeBasePtr& node) -> Matrix<ElemType>&
+    {
+        return dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value();
+    };
+
+    vector<shared_ptr<BatchNormalizationNode<ElemType>>> bnNodes;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        auto bn = dynamic_pointer_cast<BatchNormalizationNode<ElemType>>(iter.second);
+        if (bn && bn->Spatial())
+            bnNodes.push_back(bn);
+    }
+
+    size_t numFolded = 0;
+    for (const auto& bn : bnNodes)
+    {
+        // find the convolution, possibly followed by the addition of a bias
+        auto bnInputs = bn->GetInputs(); // (the node's accessors are protected, ComputationNodeBase's are not)
+        ComputationNodeBasePtr plus;
+        shared_ptr<LearnableParameter<ElemType>> convBias;
+        auto conv = dynamic_pointer_cast<ConvolutionNode<ElemType>>(bnInputs[0]);
+        if (!conv && bnInputs[0]->OperationName() == OperationNameOf(PlusNode) && IsOnlyUsedBy(bnInputs[0], bn))
+        {
+            plus = bnInputs[0];
+            for (size_t i = 0; i < 2 && !conv; i++)
+            {
+                conv     = dynamic_pointer_cast<ConvolutionNode<ElemType>>(plus->GetInputs()[i]);
+                convBias = dynamic_pointer_cast<LearnableParameter<ElemType>>(plus->GetInputs()[1 - i]);
+                if (!convBias)
+                    conv = nullptr;
+            }
+        }
+        if (!conv || conv->Transpose() || conv->PoolingKind() != PoolKind::None)
+            continue;
+        auto kernel = dynamic_pointer_cast<LearnableParameter<ElemType>>(conv->GetInputs()[0]);
+        if (!kernel || !IsOnlyUsedBy(conv, plus ? plus : bn) || !IsOnlyUsedBy(kernel, conv) || (convBias && !IsOnlyUsedBy(convBias, plus)))
+            continue;
+
+        // channels are the last axis of the convolution output, or the first one for the legacy HWC layout
+        bool hwc = conv->ImageLayout() == ImageLayoutKind::HWC;
+        const auto& outShape = bnInputs[0]->GetSampleLayout(); // (the convolution output, or that plus a bias)
+        size_t numChannels = bnInputs[SCALE]->GetSampleLayout().GetNumElements();
+        size_t channelAxis = hwc ? 0 : outShape.GetRank() - 1;
+        if (outShape.GetRank() == 0 || outShape[channelAxis] != numChannels ||
+            kernel->Value().GetNumElements() % numChannels != 0 ||
+            (convBias && convBias->Value().GetNumElements() != numChannels) ||
+            (!convBias && NodeNameExists(bn->NodeName() + L".bias")))
+            continue;
+
+        // alpha = scale / sqrt(var + eps), with the same epsilon as BatchNormEngine (cuDNN clamps it)
+        double epsilon = bn->UseCNTKEngine() ? bn->Epsilon() : max(bn->Epsilon(), 1e-5);
+        Matrix<ElemType> alpha = ValueOf(bnInputs[RUN_VAR]).Reshaped(numChannels, 1).DeepClone();
+        alpha += (ElemType) epsilon;
+        alpha.InplaceSqrt();
+        alpha.ElementInverse();
+        alpha.ElementMultiplyWith(ValueOf(bnInputs[SCALE]).Reshaped(numChannels, 1));
+
+        // scale the kernel of each output channel
+        // The legacy HWC engine stores the kernel as [K x XYC], the other engines as [XYC x K].
+        size_t kernelSize = kernel->Value().GetNumElements() / numChannels;
+        if (hwc)
+            kernel->Value().Reshaped(numChannels, kernelSize).ColumnElementMultiplyWith(alpha);
+        else
+        {
+            Matrix<ElemType> kernelMatrix = kernel->Value().Reshaped(kernelSize, numChannels);
+            kernelMatrix.RowElementMultiplyWith(alpha.Transpose());
+        }
+
+        // the new bias
+        Matrix<ElemType> newBias(numChannels, 1, m_deviceId);
+        if (convBias)
+            newBias.AssignDifferenceOf(convBias->Value().Reshaped(numChannels, 1), ValueOf(bnInputs[RUN_MEAN]).Reshaped(numChannels, 1));
+        else
+            newBias.AssignDifferenceOf((ElemType) 0, ValueOf(bnInputs[RUN_MEAN]).Reshaped(numChannels, 1));
+        newBias.ElementMultiplyWith(alpha);
+        newBias += ValueOf(bnInputs[BIAS]).Reshaped(numChannels, 1);
+
+        const wstring name = bn->NodeName();
+        if (!convBias)
+        {
+            SmallVector<size_t> biasDims(outShape.GetRank(), 1);
+            biasDims[channelAxis] = numChannels;
+            convBias = AddNodeToNetWithElemType(New<LearnableParameter<ElemType>>(m_deviceId, name + L".bias", TensorShape(biasDims)));
+            InitLearnableParameters(convBias, L"fixedValue", 0); // follow the protocol; otherwise deferred initialization will overwrite the value in validation
+        }
+        convBias->Value().Reshaped(numChannels, 1).AssignValuesOf(newBias);
+
+        // replace the BN node by conv + bias under the same name
+        InvalidateCompiledNetwork();
+        auto newNode = New<PlusNode<ElemType>>(m_deviceId, name);
+        newNode->AttachInputs({ conv, convBias });
+        ChangeNodeInputs(bn, newNode);
+        for (auto groupIter : GetAllNodeGroups())
+            std::replace(groupIter->begin(), groupIter->end(), (ComputationNodeBasePtr) bn, (ComputationNodeBasePtr) newNode);
+        RemoveNodeFromNet(bn);
+        AddNodeToNet(newNode);
+
+        // remove what only the BN node used (the statistics, and the Plus node that was replaced)
+        if (plus)
+            DeleteNode(plus->NodeName());
+        for (size_t i = 1; i < bnInputs.size(); i++)
+            if (m_nameToNodeMap.find(bnInputs[i]->NodeName()) != m_nameToNodeMap.end() && GetParentNodes(bnInputs[i]->NodeName()).empty())
+                DeleteNode(bnInputs[i]->NodeName());
+
+        fprintf(stderr, "FoldBatchNormalization: folded %ls into convolution %ls.\n", name.c_str(), conv->NodeName().c_str());
+        numFolded++;
+    }
+    fprintf(stderr, "FoldBatchNormalization: folded %d of %d spatial batch normalization nodes.\n", (int) numFolded, (int) bnNodes.size());
+
+    // redo necessary post-processing
+    CompileNetwork();
+}
+
+// ========================================
+// This function prunes the learnable parameters whose names match a regex of the config, by setting the blocks
+// of blockRows x blockCols values with the smallest L2 norms to zero, until the given fraction (the sparsity) of
+// the blocks of the parameter is zero. Blocks of 1 x 1 are magnitude pruning; a block dimension of 0 spans the
+// whole parameter, e.g. blockRows = 0 prunes whole columns, which are the output channels of a convolution kernel.
+// Blocks that are already zero are the first to be selected, so that the sparsity can be raised in steps with
+// retraining in between (see the SGD option keepParameterSparsity, which keeps the pruned values at zero).
+// ========================================
+template <class ElemType>
+void ComputationNetwork::PruneParameters(const map<wstring, float>& pruneConfig, size_t blockRows, size_t blockCols)
+{
+    for (const auto& entry : pruneConfig)
+    {
+        const float sparsity = entry.second;
+        if (sparsity < 0 || sparsity >= 1)
+            InvalidArgument("PruneParameters: The sparsity (%f) of the parameters matching '%ls' must be in [0, 1).", sparsity, entry.first.c_str());
+
+        wregex nameFilter(entry.first);
+        for (const auto& n : m_nameToNodeMap)
+        {
+            if (!regex_match(n.first, nameFilter))
+                continue;
+            auto node = dynamic_pointer_cast<LearnableParameter<ElemType>>(n.second);
+            if (!node)
+                continue;
+
+            Matrix<ElemType>& value = node->Value();
+            const size_t rows = value.GetNumRows();
+            const size_t cols = value.GetNumCols();
+            if (rows <= 1 || cols <= 1) // (biases and other vectors are left alone)
+                continue;
+
+            const size_t br = blockRows == 0 ? rows : min(blockRows, rows);
+            const size_t bc = blockCols == 0 ? cols : min(blockCols, cols);
+            const size_t numBlockRows = (rows + br - 1) / br;
+            const size_t numBlocks = numBlockRows * ((cols + bc - 1) / bc);
+            const size_t numPruned = (size_t) (sparsity * numBlocks);
+            if (numPruned == 0)
+                continue;
+
+            // the values are column major
+            unique_ptr<ElemType[]> data(value.CopyToArray());
+            vector<double> norms(numBlocks, 0);
+            for (size_t j = 0; j < cols; j++)
+                for (size_t i = 0; i < rows; i++)
+                    norms[(j / bc) * numBlockRows + i / br] += (double) data[j * rows + i] * data[j * rows + i];
+
+            vector<size_t> order(numBlocks);
+            for (size_t k = 0; k < numBlocks; k++)
+                order[k] = k;
+            nth_element(order.begin(), order.begin() + (numPruned - 1), order.end(), [&norms](size_t a, size_t b) { return norms[a] < norms[b]; });
+            vector<bool> pruned(numBlocks, false);
+            for (size_t k = 0; k < numPruned; k++)
+                pruned[order[k]] = true;
+
+            size_t numZeros = 0;
+            for (size_t j = 0; j < cols; j++)
+                for (size_t i = 0; i < rows; i++)
+                {
+                    ElemType& v = data[j * rows + i];
+                    if (pruned[(j / bc) * numBlockRows + i / br])
+                        v = 0;
+                    numZeros += v == 0;
+                }
+            value.SetValue(rows, cols, value.GetDeviceId(), data.get());
+
+            fprintf(stderr, "PruneParameters: %ls [%d x %d]: pruned %d of %d blocks of %d x %d, %.1f%% of the values are zero.\n",
+                    n.first.c_str(), (int) rows, (int) cols, (int) numPruned, (int) numBlocks, (int) br, (int) bc, 100.0 * numZeros / (rows * cols));
+        }
+    }
+}
+
+// ========================================
+// This function places the gradients of the given learnable parameters one after another into a single matrix, in
+// the order of the list, and makes each gradient a view of its part of it. The all-reduce of the data-parallel
+// training can then run over the adjacent gradients in place, instead of packing them into a buffer and back (see
+// SimpleDistGradAggregator). Gradients that are shared with another node or that are already sparse keep their own
+// matrices, as do those of parameters on another device than the first one. A gradient that is replaced by a sparse
+// one in the first backprop (e.g. of an embedding, see TimesNode) leaves its part of the matrix unused.
+// The values and the optimizer state remain separate matrices: they are loaded from checkpoints, moved between
+// devices and replaced by sparse ones, which would silently turn views into copies.
+// Must be called after AllocateAllMatrices(). Returns the number of gradients that are views.
+// ========================================
+template <class ElemType>
+size_t ComputationNetwork::AllocateContiguousGradients(const std::list<ComputationNodeBasePtr>& learnableNodes)
+{
+    if (!AreMatricesAllocated())
+        LogicError("AllocateContiguousGradients: Must be called after AllocateAllMatrices().");
+
+    std::vector<shared_ptr<ComputationNode<ElemType>>> nodes;
+    DEVICEID_TYPE deviceId = CPUDEVICE;
+    size_t numElements = 0;
+    for (const auto& learnableNode : learnableNodes)
+    {
+        auto node = dynamic_pointer_cast<ComputationNode<ElemType>>(learnableNode);
+        if (!node || !node->NeedsGradient() || !node->GradientPtr() || node->ParentGradientReused() ||
+            node->GetPreferredGradientMatrixType() == SPARSE || node->Gradient().GetMatrixType() != DENSE)
+            continue;
+        if (nodes.empty())
+            deviceId = node->GetDeviceId();
+        else if (node->GetDeviceId() != deviceId)
+            continue;
+        nodes.push_back(node);
+        numElements += node->Value().GetNumElements();
+    }
+    if (nodes.empty())
+        return 0;
+
+    auto gradients = make_shared<Matrix<ElemType>>(1, numElements, deviceId);
+    gradients->SetValue(0);
+    size_t offset = 0;
+    for (const auto& node : nodes) // (the views keep the storage of the matrix alive)
+    {
+        size_t rows = node->Value().GetNumRows();
+        size_t cols = node->Value().GetNumCols();
+        node->GradientPtrRef() = make_shared<Matrix<ElemType>>(gradients->ColumnSlice(offset, rows * cols).Reshaped(rows, cols));
+        offset += rows * cols;
+    }
+    return nodes.size();
+}
+
 // Helper class to form a logical DBN layer while exporting the network (used by SaveToDbnFile)
 class DbnLayer
 {
@@ -1521,7 +2114,11 @@ template void ComputationNetwork::InitLearnableParametersWithBilinearFill<float>
 template void ComputationNetwork::Read<float>(const wstring& fileName);
 template void ComputationNetwork::ReadPersistableParameters<float>(size_t modelVersion, File& fstream, bool create);
 template void ComputationNetwork::PerformSVDecomposition<float>(const map<wstring, float>& SVDConfig, size_t alignedsize);
+template void ComputationNetwork::FoldBatchNormalization<float>();
+template void ComputationNetwork::PruneParameters<float>(const map<wstring, float>& pruneConfig, size_t blockRows, size_t blockCols);
+template size_t ComputationNetwork::AllocateContiguousGradients<float>(const std::list<ComputationNodeBasePtr>& learnableNodes);
 template /*static*/ void ComputationNetwork::SetBatchNormalizationTimeConstants<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double normalizationTimeConstant, double& prevNormalizationTimeConstant, double blendTimeConstant, double& prevBlendTimeConstant);
+template /*static*/ void ComputationNetwork::SetBatchNormalizationSyncWorkers<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const MPIWrapperPtr& syncWorkers);
 template void ComputationNetwork::SetSeqParam<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr criterionNode, const double& hsmoothingWeight, const double& frameDropThresh, const bool& doreferencealign,
                                                      const double& amf, const double& lmf, const double& wp, const double& bMMIfactor, const bool& sMBR);
 template void ComputationNetwork::SaveToDbnFile<float>(ComputationNetworkPtr net, const std::wstring& fileName) const;
@@ -1530,7 +2127,11 @@ template void ComputationNetwork::InitLearnableParametersWithBilinearFill<double
 template void ComputationNetwork::Read<double>(const wstring& fileName);
 template void ComputationNetwork::ReadPersistableParameters<double>(size_t modelVersion, File& fstream, bool create);
 template void ComputationNetwork::PerformSVDecomposition<double>(const map<wstring, float>& SVDConfig, size_t alignedsize);
+template void ComputationNetwork::FoldBatchNormalization<double>();
+template void ComputationNetwork::PruneParameters<double>(const map<wstring, float>& pruneConfig, size_t blockRows, size_t blockCols);
+template size_t ComputationNetwork::AllocateContiguousGradients<double>(const std::list<ComputationNodeBasePtr>& learnableNodes);
 template /*static*/ void ComputationNetwork::SetBatchNormalizationTimeConstants<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double normalizationTimeConstant, double& prevNormalizationTimeConstant, double blendTimeConstant, double& prevBlendTimeConstant);
+template /*static*/ void ComputationNetwork::SetBatchNormalizationSyncWorkers<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const MPIWrapperPtr& syncWorkers);
 template void ComputationNetwork::SetSeqParam<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr criterionNode, const double& hsmoothingWeight, const double& frameDropThresh, const bool& doreferencealign,
                                                       const double& amf, const double& lmf, const double& wp, const double& bMMIfactor, const bool& sMBR);
 template void ComputationNetwork::SaveToDbnFile<double>(ComputationNetworkPtr net, const std::wstring& fileName) const;
@@ -29,9 +29,12 @@
 #include <chrono>
 #include <unordered_map>
 #include <set>
+#include <future>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+class MPIWrapper;
+
 // ===========================================================================
 // ComputationNetwork -- computation graph and operations
 // ===========================================================================
@@ -67,6 +70,13 @@ public:
 
     virtual ~ComputationNetwork()
     {
+        try
+        {
+            WaitForAsyncSave();
+        }
+        catch (...) // (an error of a SaveAsync() that nobody waited for can only be dropped here)
+        {
+        }
         ClearNetwork(); // This will explicitly remove all nodes. This is needed to break circular references in loops.
     }
 
@@ -94,9 +104,19 @@ public:
     template <class ElemType>
     void RereadPersistableParameters(const std::wstring& fileName)
     {
-        File fstream(fileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+        WaitForAsyncSave(); // (it may be writing this very file)
+        auto baseFileName = GetBaseOfDeltaModel(fileName);
+        if (!baseFileName.empty())
+        {
+            RereadPersistableParameters<ElemType>(baseFileName);
+            ReadDeltaModel(fileName);
+            ReadShards(fileName);
+            return;
+        }
+        File fstream(fileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead | FileOptions::fileOptionsSequential);
         auto modelVersion = GetModelVersion(fstream);
         ReadPersistableParameters<ElemType>(modelVersion, fstream, false);
+        ReadShards(fileName);
     }
     // design BUGBUG: binary files do not know whether they are float or double.
     // TODO: modify file format to know this; then eliminate the <ElemType> dependency (and in some future, allow nodes to be different)
@@ -120,9 +140,37 @@ public:
     void Save(const std::wstring& fileName, const FileOptions fileFormat = FileOptions::fileOptionsBinary) const;
     void SaveEdited(const std::wstring& fileName, const FileOptions fileFormat = FileOptions::fileOptionsBinary);
 
+    // Sets how Save() stores the values of the learnable parameters whose names match the regex, e.g. as 8-bit integers
+    // for smaller models to deploy; Read() converts them back into the precision of the nodes. The int8 formats keep
+    // vectors such as biases in full precision. Returns the number of parameters that matched.
+    size_t SetParameterStorageFormat(const std::wstring& nodeNameRegex, MatrixStorageFormat storageFormat);
+
+    // Saves the model (in binary format) in the background: the values of the parameters are copied into host memory,
+    // and the file is written by another thread while training goes on. 'onSaved' is called on that thread once the file
+    // has been written. With 'delta', only the parameters whose values differ from those in the base are written, into a
+    // delta model that Read() loads on top of the base; the base is the last full model written by a delta SaveAsync() of
+    // this network (so the first one writes the full model), and must stay next to the delta models.
+    // Any further save, and Read(), wait for the SaveAsync() to complete.
+    void SaveAsync(const std::wstring& fileName, bool delta = false, const std::function<void()>& onSaved = nullptr);
+    // waits for a SaveAsync() to complete and releases the copies of the values, rethrowing the error of the save, if any
+    void WaitForAsyncSave() const;
+
+    // The parameter shards of sharded nodes (IShardedNode) differ between workers, so each worker saves its shards into a
+    // file of its own next to the model, which Read() and RereadPersistableParameters() load. Unlike Save(), this must be
+    // called on all workers. Without shards, or with a single worker, there is no such file.
+    void SaveShards(const std::wstring& fileName) const;
+    void ReadShards(const std::wstring& fileName);
+    std::vector<ComputationNodeBasePtr> GetShardedParameters() const;
+
 private:
 
     void SaveToFileImpl(const std::wstring& fileName, const FileOptions fileFormat) const;
+    void SaveDeltaToFileImpl(const std::wstring& fileName, const std::vector<ComputationNodeBasePtr>& changedNodes) const;
+
+    // if fileName is a delta model written by SaveAsync(), returns the path of its base, otherwise an empty string
+    static std::wstring GetBaseOfDeltaModel(const std::wstring& fileName);
+    // loads the parameter values of a delta model into this network, which has been loaded from the base
+    void ReadDeltaModel(const std::wstring& fileName);
     
     static size_t GetModelVersion(File& fstream);
 
@@ -139,7 +187,16 @@ public:
     void PostForwardAndBackProp(const ComputationNodeBasePtr rootNode);
 
     // main entry point for backprop
-    void Backprop(const ComputationNodeBasePtr rootNode);
+    // If given, 'gradientCompletedCallback' is called for every top-level node (or loop) right after it has been backpropagated,
+    // at which point its gradient is final. This allows e.g. to start aggregating parameter gradients while backprop continues.
+    void Backprop(const ComputationNodeBasePtr rootNode, const std::function<void(const ComputationNodeBasePtr&)>& gradientCompletedCallback = nullptr);
+
+    // A worker that has no data in a minibatch does not call ForwardProp() and Backprop(), but the sharded nodes (IShardedNode)
+    // of all workers exchange data in every minibatch. These let it take part in the exchanges, in the same order.
+    void ForwardPropShardedNodesWithoutLocalData(const std::vector<ComputationNodeBasePtr>& rootNodes);
+    void BackpropShardedNodesWithoutLocalData(const ComputationNodeBasePtr& rootNode);
+    // sums the gradients of the parameter shards that are held by several workers (IShardedNode::AggregateShardGradient()); must be called on all workers
+    void AggregateShardGradients();
 
     template <class NODESET> // version that takes multiple nodes
     void TravserseInSortedGlobalEvalOrder(const NODESET& nodes, const std::function<void(const ComputationNodeBasePtr&)>& action)
@@ -174,6 +231,15 @@ public:
     template <class NODESET> // version that takes multiple nodes
     void ForwardProp(const NODESET& nodes)
     {
+        if (Globals::ShouldUseParallelTraversal())
+        {
+            std::vector<ComputationNodeBasePtr> combinedNodes;
+            TravserseInSortedGlobalEvalOrder(nodes, [&combinedNodes](const ComputationNodeBasePtr& node) {
+                combinedNodes.push_back(node);
+            });
+            PARTraversalFlowControlNode::ForwardProp(PARTraversalFlowControlNode::DetermineForwardWaves(combinedNodes), FrameRange(nullptr));
+            return;
+        }
         TravserseInSortedGlobalEvalOrder(nodes, [](const ComputationNodeBasePtr& node) {
             PARTraversalFlowControlNode::ForwardProp(node, FrameRange(nullptr));
         });
@@ -243,7 +309,7 @@ public:
     void ValidateNetwork();
 
 private:
-    size_t ValidateNodes(list<ComputationNodeBasePtr> nodes, bool isFirstPass, bool isFinalValidationPass);
+    size_t ValidateNodes(const list<ComputationNodeBasePtr>& nodes, bool isFirstPass, bool isFinalValidationPass);
     bool ValidateNode(ComputationNodeBasePtr node, bool isFinalValidationPass) const;
     void MarkValueNonSharableNodes();
     void ChangeNodeInputs(ComputationNodeBasePtr fromNode, ComputationNodeBasePtr toNode);
@@ -258,14 +324,29 @@ private:
     void VerifyIsCompiled(const char* where) const;
 public:
     void AllocateAllMatrices(const std::vector<ComputationNodeBasePtr>& evalRootNodes, const std::vector<ComputationNodeBasePtr>& outValueRootNodes, ComputationNodeBasePtr trainRootNode);
+    // the static memory plan lets one know the peak memory before the first minibatch (see MatrixPool::GetMemoryPlans())
+    const MatrixPool& GetMatrixPool() const { return m_matrixPool; }
+    // activation offload (see ComputationNodeBase::SetValueOffloadedInBackprop()): if minSampleSize > 0, AllocateAllMatrices()
+    // also marks the values of at least that many elements per sample whose copies are estimated to hide behind the
+    // computation. bandwidthRatio is the ratio of device memory to PCIe bandwidth assumed by that estimate.
+    void SetValueOffload(size_t minSampleSize, double bandwidthRatio)
+    {
+        m_valueOffloadMinSampleSize = minSampleSize;
+        m_valueOffloadBandwidthRatio = bandwidthRatio;
+    }
 
     // From the set of nodes extract all nodes which are used as accumulator nodes.
     std::set<ComputationNodeBasePtr> ExtractNodesWhichAccumulateResult(std::set<ComputationNodeBasePtr> nodes);
 
 private:
     void PrintMemorySharingStructure(const std::vector<ComputationNodeBasePtr>& nodes);
+    void PrintMemoryPlan() const;
     void ReleaseMatricesAfterEvalForChildren(ComputationNodeBasePtr n, std::unordered_map<ComputationNodeBasePtr, std::unordered_set<ComputationNodeBasePtr>>& parentsMap);
     void AllocateGradientMatricesForInputs(ComputationNodeBasePtr parentNode);
+    void SelectValuesToOffload(const std::vector<ComputationNodeBasePtr>& forwardPropRoots, const std::unordered_set<ComputationNodeBasePtr>& forwardPropNodes, const ComputationNodeBasePtr& trainRootNode,
+                               const std::unordered_map<ComputationNodeBasePtr, std::unordered_set<ComputationNodeBasePtr>>& parentsMap,
+                               std::unordered_map<ComputationNodeBasePtr, bool>& outputValueNeededDuringBackProp);
+    std::vector<std::vector<ComputationNodeBasePtr>> ScheduleValuePrefetch(const std::vector<std::vector<ComputationNodeBasePtr>>& backpropSteps) const;
 
 public:
     // -----------------------------------------------------------------------
@@ -462,6 +543,8 @@ public:
     ComputationNodeBasePtr CopyNode(const ComputationNetwork& fromNet, const std::wstring fromName, std::wstring toName, const CopyNodeFlags flags);
     void CopySubTree(const ComputationNetwork& fromNet, const std::wstring fromName, std::wstring toNamePrefix, const CopyNodeFlags flags);
     void CopyInputs(const std::wstring fromName, std::wstring toName);
+    template <class ElemType>
+    ComputationNetworkPtr CloneSharingParameters();
     void RenameNode(const std::wstring& nodeNameOrig, const std::wstring& nodeNameNew);
     void RenameNode(ComputationNodeBasePtr node, const std::wstring& newNodeName);
     void DeleteNode(const std::wstring& nodeName);
@@ -473,6 +556,28 @@ public:
     //ComputationNodeBasePtr RemoveFeatureNode(ComputationNodeBasePtr featureNode);
     void SetLearnableNodesBelowLearningRateMultiplier(const float learningRateMultiplier, const ComputationNodeBasePtr& rootNode = nullptr);
 
+    // replace chains of element-wise nodes that need no gradient by single FusedElementwiseNodes; returns the number of nodes fused away
+    template <class ElemType>
+    size_t FuseElementwiseChains();
+
+    // replace the element-wise parts of LSTM and GRU cells by fused nodes that support backprop; returns the number of nodes fused away
+    template <class ElemType>
+    size_t FuseRecurrentCells();
+
+    // move loop-invariant input projections and sums of recurrent loops out of the loops; returns the number of rewritten nodes
+    template <class ElemType>
+    size_t HoistLoopInvariantTerms();
+
+    // place the nodes on several devices in consecutive stages of the evaluation order of 'root', connected by
+    // DeviceTransferNodes, for models that do not fit on one device; returns the number of transfers
+    template <class ElemType>
+    size_t PartitionIntoPipelineStages(const ComputationNodeBasePtr& root, const std::vector<DEVICEID_TYPE>& stageDevices,
+                                       const std::vector<std::wstring>& lastNodesOfStages, const std::wstring& tempFileName);
+
+    // create a copy of this network on another device, for data parallelism across the GPUs of one process
+    template <class ElemType>
+    ComputationNetworkPtr CloneToDevice(DEVICEID_TYPE deviceId, const std::wstring& tempFileName);
+
     // -----------------------------------------------------------------------
     // node access
     // -----------------------------------------------------------------------
@@ -542,6 +647,10 @@ public:
                                                    double normalizationTimeConstant, double& prevNormalizationTimeConstant,
                                                    double blendTimeConstant, double& prevBlendTimeConstant);
 
+    // synchronized batch normalization across the given data-parallel workers (nullptr: per-worker statistics)
+    template <class ElemType>
+    static void SetBatchNormalizationSyncWorkers(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const shared_ptr<MPIWrapper>& syncWorkers);
+
     template <class ElemType>
     static void SetSeqParam(ComputationNetworkPtr net,
                             const ComputationNodeBasePtr criterionNode,
@@ -844,6 +953,15 @@ public:
     template <class ElemType>
     void PerformSVDecomposition(const map<wstring, float>& SVDConfig, size_t AlignedSize);
 
+    template <class ElemType>
+    void FoldBatchNormalization();
+
+    template <class ElemType>
+    void PruneParameters(const map<wstring, float>& pruneConfig, size_t blockRows, size_t blockCols);
+
+    template <class ElemType>
+    size_t AllocateContiguousGradients(const std::list<ComputationNodeBasePtr>& learnableNodes);
+
     template <class ElemType>
     void SaveToDbnFile(ComputationNetworkPtr net, const std::wstring& fileName) const;
 
@@ -1185,6 +1303,26 @@ protected:
         static void ForwardProp(const ComputationNodeBasePtr& node, const FrameRange& fr);
         static void PostForwardAndBackProp(const ComputationNodeBasePtr& node);
 
+        // parallel traversal (Globals::ShouldUseParallelTraversal())
+        // A wave is a set of nodes (or SEQ loops) that are mutually independent and can thus be executed concurrently.
+        typedef std::vector<std::vector<ComputationNodeBasePtr>> Waves;
+        static Waves DetermineForwardWaves(const std::vector<ComputationNodeBasePtr>& nodes /*in eval order*/);
+        static Waves DetermineBackwardWaves(const std::vector<ComputationNodeBasePtr>& nodes /*in eval order*/);
+        static void ForwardProp(const Waves& forwardWaves, const FrameRange& fr);
+        const Waves& GetForwardWaves() const { return m_forwardWaves; }
+        const Waves& GetBackwardWaves() const { return m_backwardWaves; }
+        // activation recomputation: before 'node' is backpropagated, call 'fn' in dependency order on every node marked for
+        // recomputation whose value this needs and that has not been recomputed yet (as recorded in 'recomputed')
+        static void ForEachValueToRecompute(const ComputationNodeBasePtr& node, std::set<ComputationNodeBasePtr>& recomputed, const std::function<void(const ComputationNodeBasePtr&)>& fn);
+        // the nodes whose values the backprop of 'node' may use: its inputs and itself, unless it is a loop or needs no gradient
+        static void ForEachValueUsedInBackprop(const ComputationNodeBasePtr& node, const std::function<void(const ComputationNodeBasePtr&)>& fn);
+        // activation offload: the steps of Backprop() (the nodes in reverse evaluation order, resp. the backward waves), and for
+        // each the offloaded values to copy back to the device before it, as scheduled by ComputationNetwork::AllocateAllMatrices()
+        Waves GetBackpropSteps() const;
+        void SetValuesToPrefetch(const Waves& valuesToPrefetch) { m_valuesToPrefetch = valuesToPrefetch; }
+        // called by Backprop() for each node that needs a gradient, once that has been backpropagated (see ComputationNetwork::Backprop())
+        void SetGradientCompletedCallback(const std::function<void(const ComputationNodeBasePtr&)>& callback) { m_gradientCompletedCallback = callback; }
+
         virtual void BeginForwardProp() override {}
         virtual void ForwardProp(const FrameRange&) override;
         virtual void EndForwardProp() override {}
@@ -1210,6 +1348,17 @@ protected:
         // There is currently no other constructor for inner nested PAR-traversed sub-networks, but there will be.
         PARTraversalFlowControlNode(const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes);
         // Base::m_nestedNodes contains all top-level nodes, in evaluation order
+    private:
+        static std::set<ComputationNodeBasePtr> GetTopLevelInputs(const ComputationNodeBasePtr& node);
+        static std::map<ComputationNodeBasePtr, ComputationNodeBasePtr> GetTopLevelNodeMap(const std::vector<ComputationNodeBasePtr>& nodes);
+        static void ForEachNodeInWave(const std::vector<ComputationNodeBasePtr>& wave, const std::function<void(const ComputationNodeBasePtr&)>& fn);
+        static void ForwardPropWave(const std::vector<ComputationNodeBasePtr>& wave, const FrameRange& fr);
+        static void ForEachValueToRecomputeRec(const ComputationNodeBasePtr& node, std::set<ComputationNodeBasePtr>& recomputed, const std::function<void(const ComputationNodeBasePtr&)>& fn);
+
+        Waves m_forwardWaves;  // m_nestedNodes grouped into waves in dependency order
+        Waves m_backwardWaves; // same for backprop; nodes in one wave have disjoint inputs, so that gradient accumulation does not race
+        std::function<void(const ComputationNodeBasePtr&)> m_gradientCompletedCallback;
+        Waves m_valuesToPrefetch; // [backprop step] (empty if no value is offloaded)
     };
 
 public:
@@ -1256,6 +1405,12 @@ private:
 
     std::map<std::wstring, std::vector<ComputationNodeBasePtr>> m_namedCriterionNodes;
 
+    // state of SaveAsync()
+    mutable std::future<void> m_asyncSave;
+    mutable std::vector<ComputationNodeBasePtr> m_asyncSaveNodes;    // the nodes whose ValueToSave() is a copy of their value
+    std::wstring m_deltaBaseFileName;                                // the base of delta models (only used by the background thread)
+    std::map<std::wstring, uint64_t> m_deltaBaseValueHashes;         // [node name] -> hash of its saved value in the base
+
 private:
     // -----------------------------------------------------------------------
     // the following members are all result of post-processing by CompileNetwork()
@@ -1271,6 +1426,10 @@ private:
     bool m_isCompiled; // CompileNetwork has been called
     bool m_areMatricesAllocated; // AllocateAllMatrices has been called
 
+    // activation offload, see SetValueOffload()
+    size_t m_valueOffloadMinSampleSize = 0;
+    double m_valueOffloadBandwidthRatio = 25;
+
     // cached network iterations
     std::map<const ComputationNodeBasePtr, std::list<ComputationNodeBasePtr>> m_evalOrders; // [out node] flat depth-first traversal starting from out node
     std::map<const ComputationNodeBasePtr, ComputationNodeBasePtr> m_nestedNetworks;        // [out node] network rewritten as recursive traveral, potentially optimized; execution plan
@@ -9,8 +9,14 @@
 #include "ComputationNode.h"
 #include "ComputationNetwork.h"
 #include "RecurrentNodes.h"
+#include "LinearAlgebraNodes.h"
+#include "NonlinearityNodes.h"
+#include "ReshapingNodes.h"
+#include "SpecialPurposeNodes.h"
+#include "ComputationNetworkBuilder.h"
 #include <string>
 #include <set>
+#include <map>
 
 using namespace std;
 
@@ -475,4 +481,734 @@ static int DetermineLoopDirection(const std::vector<ComputationNodeBasePtr>& nes
     return steppingDirection;
 }
 
+// -----------------------------------------------------------------------
+// element-wise fusion
+// -----------------------------------------------------------------------
+
+// map an element-wise node to the opcode its ForwardProp() executes; returns the number of arguments, or 0 if not fusable
+static size_t GetFusableElementwiseOp(const ComputationNodeBasePtr& node, ElementWiseOperator& op)
+{
+    static const map<wstring, pair<ElementWiseOperator, size_t>> fusableOps =
+    {
+        { OperationNameOf(PlusNode),                  { ElementWiseOperator::opSum,                   2 } },
+        { OperationNameOf(MinusNode),                 { ElementWiseOperator::opDifference,            2 } },
+        { OperationNameOf(ElementTimesNode),          { ElementWiseOperator::opElementwiseProduct,    2 } },
+        { OperationNameOf(AbsNode),                   { ElementWiseOperator::opAbs,                   1 } },
+        { OperationNameOf(CosineNode),                { ElementWiseOperator::opCosine,                1 } },
+        { OperationNameOf(ExpNode),                   { ElementWiseOperator::opExp,                   1 } },
+        { OperationNameOf(FloorNode),                 { ElementWiseOperator::opFloor,                 1 } },
+        { OperationNameOf(LogNode),                   { ElementWiseOperator::opLog,                   1 } },
+        { OperationNameOf(NegateNode),                { ElementWiseOperator::opNegate,                1 } },
+        { OperationNameOf(PassNode),                  { ElementWiseOperator::opCopy,                  1 } },
+        { OperationNameOf(ReciprocalNode),            { ElementWiseOperator::opReciprocal,            1 } },
+        { OperationNameOf(RectifiedLinearNode),       { ElementWiseOperator::opLinearRectifier,       1 } },
+        { OperationNameOf(SigmoidNode),               { ElementWiseOperator::opSigmoid,               1 } },
+        { OperationNameOf(SinNode),                   { ElementWiseOperator::opSin,                   1 } },
+        { OperationNameOf(SqrtNode),                  { ElementWiseOperator::opSqrt,                  1 } },
+        { OperationNameOf(TanhNode),                  { ElementWiseOperator::opTanh,                  1 } },
+        { OperationNameOf(ExponentialLinearUnitNode), { ElementWiseOperator::opExponentialLinearUnit, 1 } },
+        { OperationNameOf(StableSigmoidNode),         { ElementWiseOperator::opStableSigmoid,         1 } },
+    };
+    auto iter = fusableOps.find(node->OperationName());
+    if (iter == fusableOps.end() || node->GetNumInputs() != iter->second.second)
+        return 0;
+    op = iter->second.first;
+    return iter->second.second;
+}
+
+// state of an element-wise chain while it is being grown from its root
+struct ElementwiseChain
+{
+    ElementWiseProgram program;
+    vector<ComputationNodeBasePtr> inputs;   // external inputs, in register order
+    vector<ComputationNodeBasePtr> absorbed; // nodes folded into the chain, excluding the root
+
+    ElementwiseChain() { program.numSteps = 0; }
+
+    // append the computation of 'node' to the program, absorbing inputs recursively where 'canAbsorb' allows
+    // Returns false if the program limits are exceeded, in which case the state is undefined and must be restored by the caller.
+    template <class CanAbsorbFn>
+    bool Append(const ComputationNodeBasePtr& node, const CanAbsorbFn& canAbsorb, unsigned char& resultReg)
+    {
+        ElementWiseOperator op;
+        size_t numArgs = GetFusableElementwiseOp(node, op);
+        unsigned char args[2] = { 0, 0 };
+        for (size_t i = 0; i < numArgs; i++)
+        {
+            const auto& input = node->Input(i);
+            if (canAbsorb(input))
+            {
+                ElementwiseChain saved = *this; // try to absorb; on failure, fall back to using it as an external input
+                if (Append(input, canAbsorb, args[i]))
+                {
+                    absorbed.push_back(input);
+                    continue;
+                }
+                *this = saved;
+            }
+            auto iter = find(inputs.begin(), inputs.end(), input);
+            if (iter == inputs.end())
+            {
+                if (inputs.size() >= ElementWiseProgram::MaxInputs)
+                    return false;
+                iter = inputs.insert(inputs.end(), input);
+            }
+            args[i] = (unsigned char)(iter - inputs.begin());
+        }
+        if (program.numSteps >= ElementWiseProgram::MaxSteps)
+            return false;
+        auto& step = program.steps[program.numSteps];
+        step.op = op;
+        step.arg0 = args[0];
+        step.arg1 = args[1];
+        resultReg = (unsigned char)(ElementWiseProgram::MaxInputs + program.numSteps);
+        program.numSteps++;
+        return true;
+    }
+};
+
+// FuseElementwiseChains() -- replace chains of element-wise nodes by FusedElementwiseNodes
+// Each chain is rooted at a fusable node and absorbs those of its (transitive) inputs that
+//  - are fusable element-wise nodes,
+//  - are consumed by nobody else, and are not members of any node group (outputs, criteria, etc.),
+//  - are not part of a recurrent loop and need no gradient,
+//  - have the same MBLayout as the root (so that nothing is recomputed per frame that was computed once before).
+// The root keeps its name and node-group memberships. A chain has at most 3 external inputs and 8 steps.
+// Since FusedElementwiseNode has no backprop, only sub-graphs that need no gradient are fused, e.g. for evaluation,
+// or below frozen parameters. Must be called on a compiled network before matrices are allocated; recompiles the network.
+template <class ElemType>
+size_t ComputationNetwork::FuseElementwiseChains()
+{
+    VerifyIsCompiled("FuseElementwiseChains");
+    if (AreMatricesAllocated())
+        LogicError("FuseElementwiseChains: Must be called before matrices are allocated.");
+
+    // count consumers, and collect all nodes that are referenced by the outside world
+    map<ComputationNodeBasePtr, size_t> numConsumers;
+    for (const auto& iter : m_nameToNodeMap)
+        for (const auto& input : iter.second->GetInputs())
+            numConsumers[input]++;
+    set<ComputationNodeBasePtr> groupNodes;
+    for (auto group : GetAllNodeGroups())
+        groupNodes.insert(group->begin(), group->end());
+
+    auto isFusable = [](const ComputationNodeBasePtr& node)
+    {
+        ElementWiseOperator op;
+        return GetFusableElementwiseOp(node, op) > 0 && !node->IsPartOfLoop() && !node->NeedsGradient();
+    };
+
+    // visit roots in reverse evaluation order, so that chains are grown from their last node
+    set<ComputationNodeBasePtr> fused;
+    list<pair<ComputationNodeBasePtr, ElementwiseChain>> chains;
+    const auto& evalOrder = GetEvalOrder(nullptr);
+    for (auto nodeIter = evalOrder.rbegin(); nodeIter != evalOrder.rend(); nodeIter++)
+    {
+        const auto& root = *nodeIter;
+        if (fused.find(root) != fused.end() || !isFusable(root))
+            continue;
+        auto canAbsorb = [&](const ComputationNodeBasePtr& node)
+        {
+            return isFusable(node) && numConsumers[node] == 1 && groupNodes.find(node) == groupNodes.end() &&
+                   fused.find(node) == fused.end() && node->GetMBLayout() == root->GetMBLayout();
+        };
+        ElementwiseChain chain;
+        unsigned char resultReg;
+        if (!chain.Append(root, canAbsorb, resultReg) || chain.absorbed.empty())
+            continue; // nothing to gain
+        fused.insert(root);
+        fused.insert(chain.absorbed.begin(), chain.absorbed.end());
+        chains.push_back(make_pair(root, chain));
+    }
+    if (chains.empty())
+        return 0;
+
+    // rewire the network
+    InvalidateCompiledNetwork();
+    size_t numRemoved = 0;
+    for (const auto& entry : chains)
+    {
+        const auto& root = entry.first;
+        const auto& chain = entry.second;
+        auto fusedNode = New<FusedElementwiseNode<ElemType>>(root->GetDeviceId(), root->NodeName());
+        fusedNode->SetProgram(chain.program);
+        fusedNode->AttachInputs(chain.inputs);
+
+        ChangeNodeInputs(root, fusedNode);
+        for (const auto& node : chain.absorbed)
+            RemoveNodeFromNet(node);
+        RemoveNodeFromNet(root);
+        AddNodeToNet(fusedNode);
+        for (auto groupIter : GetAllNodeGroups())
+        {
+            auto& group = *groupIter;
+            for (auto& node : group)
+                if (node == root)
+                    node = fusedNode;
+        }
+        numRemoved += chain.absorbed.size();
+        fprintf(stderr, "FuseElementwiseChains: Fused %d nodes into %ls %ls operation with %d inputs.\n",
+                (int)chain.absorbed.size() + 1, fusedNode->NodeName().c_str(), OperationNameOf(FusedElementwiseNode).c_str(), (int)chain.inputs.size());
+    }
+    CompileNetwork();
+    return numRemoved;
+}
+
+template size_t ComputationNetwork::FuseElementwiseChains<float>();
+template size_t ComputationNetwork::FuseElementwiseChains<double>();
+
+// -----------------------------------------------------------------------
+// recurrent cell fusion
+// -----------------------------------------------------------------------
+
+// a recognized cell: the operation of the fused node, its inputs, and the nodes it replaces besides the root
+struct RecurrentCellMatch
+{
+    wstring operationName;
+    vector<ComputationNodeBasePtr> inputs;
+    vector<ComputationNodeBasePtr> absorbed;
+};
+
+// FuseRecurrentCells() -- replace the element-wise parts of LSTM and GRU cells by fused nodes (see FusedCellNodeBase)
+// The following patterns are recognized, where the operands of ElementTimes and Plus may come in any order:
+//   Plus(ElementTimes(Sigmoid(i), Tanh(g)), ElementTimes(Sigmoid(f), c'))  ->  LSTMCellState(i, g, f, c')
+//   Plus(ElementTimes(m, Tanh(u)), ElementTimes(z, h'))                    ->  GRUCellOutput(m, u, z, h')
+//   ElementTimes(Sigmoid(o), Tanh(c))                                      ->  LSTMCellOutput(o, c)
+// The nodes below the root are absorbed only if nobody else consumes them and they are not members of any node group.
+// All inputs of the fused node must have the dimensions and the MBLayout of the root, i.e. nothing is broadcast.
+// The root keeps its name and node-group memberships. Unlike FuseElementwiseChains(), the fused nodes implement backprop
+// and run inside recurrent loops, so this can be used for training; the results are identical to those of the unfused nodes.
+// Must be called on a compiled network before matrices are allocated; recompiles the network.
+template <class ElemType>
+size_t ComputationNetwork::FuseRecurrentCells()
+{
+    VerifyIsCompiled("FuseRecurrentCells");
+    if (AreMatricesAllocated())
+        LogicError("FuseRecurrentCells: Must be called before matrices are allocated.");
+
+    map<ComputationNodeBasePtr, size_t> numConsumers;
+    for (const auto& iter : m_nameToNodeMap)
+        for (const auto& input : iter.second->GetInputs())
+            numConsumers[input]++;
+    set<ComputationNodeBasePtr> groupNodes;
+    for (auto group : GetAllNodeGroups())
+        groupNodes.insert(group->begin(), group->end());
+    set<ComputationNodeBasePtr> fused;
+
+    ComputationNodeBasePtr root;
+    auto isCompatible = [&](const ComputationNodeBasePtr& node)
+    {
+        return node->GetSampleLayout() == root->GetSampleLayout() && node->GetMBLayout() == root->GetMBLayout();
+    };
+    auto canAbsorb = [&](const ComputationNodeBasePtr& node, const wstring& operationName, size_t numInputs)
+    {
+        return node->OperationName() == operationName && node->GetNumInputs() == numInputs && isCompatible(node) &&
+               numConsumers[node] == 1 && groupNodes.find(node) == groupNodes.end() && fused.find(node) == fused.end();
+    };
+    // match 'node' as ElementTimes(op0(x), op1(y)) in either order, where an empty op name means that the operand is taken as is
+    auto matchProduct = [&](const ComputationNodeBasePtr& node, bool absorbNode, const wstring& op0, const wstring& op1, RecurrentCellMatch& match)
+    {
+        if (absorbNode ? !canAbsorb(node, OperationNameOf(ElementTimesNode), 2) : node->OperationName() != OperationNameOf(ElementTimesNode))
+            return false;
+        for (size_t k = 0; k < 2; k++)
+        {
+            ComputationNodeBasePtr operands[2] = { node->Input(k), node->Input(1 - k) };
+            const wstring* ops[2] = { &op0, &op1 };
+            bool matches = true;
+            for (size_t j = 0; j < 2 && matches; j++)
+                matches = ops[j]->empty() ? isCompatible(operands[j]) : canAbsorb(operands[j], *ops[j], 1) && isCompatible(operands[j]->Input(0));
+            if (!matches || (op0 == op1 && k == 1))
+                continue;
+            for (size_t j = 0; j < 2; j++)
+            {
+                if (ops[j]->empty())
+                    match.inputs.push_back(operands[j]);
+                else
+                {
+                    match.inputs.push_back(operands[j]->Input(0));
+                    match.absorbed.push_back(operands[j]);
+                }
+            }
+            if (absorbNode)
+                match.absorbed.push_back(node);
+            return true;
+        }
+        return false;
+    };
+
+    // find the cells; the cell states and GRU outputs first, since their first product would also match LSTMCellOutput
+    const wstring sigmoid = OperationNameOf(SigmoidNode), tanh = OperationNameOf(TanhNode), none;
+    list<pair<ComputationNodeBasePtr, RecurrentCellMatch>> cells;
+    const auto& evalOrder = GetEvalOrder(nullptr);
+    for (size_t pass = 0; pass < 2; pass++)
+    {
+        for (auto nodeIter = evalOrder.rbegin(); nodeIter != evalOrder.rend(); nodeIter++)
+        {
+            root = *nodeIter;
+            if (fused.find(root) != fused.end())
+                continue;
+            RecurrentCellMatch match;
+            bool matched = false;
+            if (pass == 0 && root->OperationName() == OperationNameOf(PlusNode) && root->GetNumInputs() == 2)
+            {
+                for (size_t k = 0; k < 2 && !matched; k++)
+                {
+                    match = RecurrentCellMatch{ OperationNameOf(LSTMCellStateNode) };
+                    matched = matchProduct(root->Input(k), true, sigmoid, tanh, match) && matchProduct(root->Input(1 - k), true, sigmoid, none, match);
+                }
+                for (size_t k = 0; k < 2 && !matched; k++)
+                {
+                    match = RecurrentCellMatch{ OperationNameOf(GRUCellOutputNode) };
+                    matched = matchProduct(root->Input(k), true, none, tanh, match) && matchProduct(root->Input(1 - k), true, none, none, match);
+                }
+            }
+            else if (pass == 1)
+            {
+                match = RecurrentCellMatch{ OperationNameOf(LSTMCellOutputNode) };
+                matched = matchProduct(root, false, sigmoid, tanh, match);
+            }
+            if (!matched)
+                continue;
+            fused.insert(root);
+            fused.insert(match.absorbed.begin(), match.absorbed.end());
+            cells.push_back(make_pair(root, match));
+        }
+    }
+    if (cells.empty())
+        return 0;
+
+    // rewire the network
+    InvalidateCompiledNetwork();
+    size_t numRemoved = 0;
+    for (const auto& entry : cells)
+    {
+        const auto& cellRoot = entry.first;
+        const auto& match = entry.second;
+        auto fusedNode = ComputationNetworkBuilder<ElemType>::NewNode(match.operationName, cellRoot->GetDeviceId(), cellRoot->NodeName());
+        fusedNode->AttachInputs(match.inputs);
+
+        ChangeNodeInputs(cellRoot, fusedNode);
+        for (const auto& node : match.absorbed)
+            RemoveNodeFromNet(node);
+        RemoveNodeFromNet(cellRoot);
+        AddNodeToNet(fusedNode);
+        for (auto groupIter : GetAllNodeGroups())
+        {
+            auto& group = *groupIter;
+            for (auto& node : group)
+                if (node == cellRoot)
+                    node = fusedNode;
+        }
+        numRemoved += match.absorbed.size();
+        fprintf(stderr, "FuseRecurrentCells: Fused %d nodes into %ls %ls operation.\n",
+                (int)match.absorbed.size() + 1, fusedNode->NodeName().c_str(), fusedNode->OperationName().c_str());
+    }
+    CompileNetwork();
+    return numRemoved;
+}
+
+template size_t ComputationNetwork::FuseRecurrentCells<float>();
+template size_t ComputationNetwork::FuseRecurrentCells<double>();
+
+// -----------------------------------------------------------------------
+// hoisting of loop-invariant terms
+// -----------------------------------------------------------------------
+
+// HoistLoopInvariantTerms() -- move the input projections of recurrent loops out of the loops
+// A node is inside a loop only if it is on a cycle, so Times(W, x) is computed once for the whole minibatch if x
+// does not depend on the loop. Two common ways of writing a recurrent cell defeat this, and are rewritten here:
+//  - A stacked projection Times(W, RowStack(x, h')) of a loop-invariant input x and a recurrent input h' is inside the
+//    loop as a whole. It becomes Times(Slice(W), x) + Times(Slice(W), h'), where the first product is outside the loop.
+//  - A sum like (W * x + H * h') + b adds the loop-invariant terms inside the loop, one frame at a time. The Plus
+//    nodes of such a sum are reassociated so that all loop-invariant terms are summed first, outside the loop.
+// The rewrites are repeated until nothing changes, so that the split products are reassociated as well.
+// Only nodes that are consumed by nobody else and are not members of any node group are rewritten. The rewritten
+// sums add up the same terms in a different order, so the results differ by rounding.
+// Must be called on a compiled network before matrices are allocated; recompiles the network.
+template <class ElemType>
+size_t ComputationNetwork::HoistLoopInvariantTerms()
+{
+    VerifyIsCompiled("HoistLoopInvariantTerms");
+    if (AreMatricesAllocated())
+        LogicError("HoistLoopInvariantTerms: Must be called before matrices are allocated.");
+
+    // a rewrite replaces 'root' by 'replacement', which is computed by the 'added' nodes
+    struct Rewrite
+    {
+        ComputationNodeBasePtr root;
+        ComputationNodeBasePtr replacement;
+        vector<ComputationNodeBasePtr> removed;
+        vector<ComputationNodeBasePtr> added;
+    };
+
+    size_t numRewrites = 0;
+    for (;;)
+    {
+        map<ComputationNodeBasePtr, size_t> numConsumers;
+        for (const auto& iter : m_nameToNodeMap)
+            for (const auto& input : iter.second->GetInputs())
+                numConsumers[input]++;
+        set<ComputationNodeBasePtr> groupNodes;
+        for (auto group : GetAllNodeGroups())
+            groupNodes.insert(group->begin(), group->end());
+
+        auto loopOf = [this](const ComputationNodeBasePtr& node)
+        {
+            return node->IsPartOfLoop() ? FindInRecurrentLoops(m_allSEQNodes, node) : nullptr;
+        };
+        auto isInternal = [&](const ComputationNodeBasePtr& node)
+        {
+            return numConsumers[node] == 1 && groupNodes.find(node) == groupNodes.end();
+        };
+        set<wstring> newNames;
+        auto newName = [&](const wstring& baseName)
+        {
+            for (size_t k = 0;; k++)
+            {
+                wstring name = baseName + L".hoisted" + to_wstring(k);
+                if (!NodeNameExists(name) && newNames.insert(name).second)
+                    return name;
+            }
+        };
+
+        // collect the rewrites on the compiled network
+        vector<Rewrite> rewrites;
+        set<ComputationNodeBasePtr> rewritten;
+        const auto& evalOrder = GetEvalOrder(nullptr);
+        for (auto nodeIter = evalOrder.rbegin(); nodeIter != evalOrder.rend(); nodeIter++)
+        {
+            const auto& root = *nodeIter;
+            auto loop = loopOf(root);
+            if (!loop || rewritten.find(root) != rewritten.end() || root->GetNumInputs() != 2)
+                continue;
+            auto isInvariant = [&](const ComputationNodeBasePtr& node) { return loopOf(node) != loop; };
+
+            Rewrite rewrite;
+            rewrite.root = root;
+            auto addNode = [&](const ComputationNodeBasePtr& node, const vector<ComputationNodeBasePtr>& inputs)
+            {
+                node->AttachInputs(inputs);
+                rewrite.added.push_back(node);
+                return node;
+            };
+            auto newNode = [&](const wstring& operationName, const vector<ComputationNodeBasePtr>& inputs, const wstring& name)
+            {
+                return addNode(ComputationNetworkBuilder<ElemType>::NewNode(operationName, root->GetDeviceId(), name), inputs);
+            };
+            // left-fold the terms with Plus nodes; the last one is named 'sumName'
+            auto sumOf = [&](const vector<ComputationNodeBasePtr>& terms, const wstring& sumName)
+            {
+                ComputationNodeBasePtr sum = terms[0];
+                for (size_t i = 1; i < terms.size(); i++)
+                    sum = newNode(OperationNameOf(PlusNode), { sum, terms[i] }, i + 1 == terms.size() ? sumName : newName(root->NodeName()));
+                return sum;
+            };
+
+            vector<ComputationNodeBasePtr> invariantTerms, recurrentTerms;
+            if (root->OperationName() == OperationNameOf(TimesNode))
+            {
+                // Times(W, RowStack(...)) with a matrix W and stacked vectors, some of which are loop-invariant
+                const auto& weights = root->Input(0);
+                const auto& stack = root->Input(1);
+                if (stack->OperationName() != OperationNameOf(RowStackNode) || !isInternal(stack) || !isInvariant(weights) ||
+                    weights->HasMBLayout() || weights->GetSampleLayout().GetRank() != 2 || stack->GetSampleLayout().GetRank() != 1)
+                    continue;
+                const auto& inputs = stack->GetInputs();
+                if (none_of(inputs.begin(), inputs.end(), isInvariant) || all_of(inputs.begin(), inputs.end(), isInvariant) ||
+                    any_of(inputs.begin(), inputs.end(), [](const ComputationNodeBasePtr& input) { return input->GetSampleLayout().GetRank() != 1; }))
+                    continue;
+
+                // one product per run of stacked inputs that are all invariant or all recurrent, with the matching columns of W
+                size_t firstColumn = 0;
+                for (size_t begin = 0, end; begin < inputs.size(); begin = end)
+                {
+                    bool invariant = isInvariant(inputs[begin]);
+                    size_t numColumns = 0;
+                    for (end = begin; end < inputs.size() && isInvariant(inputs[end]) == invariant; end++)
+                        numColumns += inputs[end]->GetSampleLayout().GetNumElements();
+                    ComputationNodeBasePtr part = inputs[begin];
+                    if (end - begin > 1)
+                        part = newNode(OperationNameOf(RowStackNode), vector<ComputationNodeBasePtr>(inputs.begin() + begin, inputs.begin() + end), newName(stack->NodeName()));
+                    auto slice = addNode(New<SliceNode<ElemType>>(root->GetDeviceId(), newName(weights->NodeName()),
+                                                                  vector<int>{ (int) firstColumn }, vector<int>{ (int) (firstColumn + numColumns) }, vector<int>{ 2 }),
+                                         { weights });
+                    (invariant ? invariantTerms : recurrentTerms).push_back(newNode(OperationNameOf(TimesNode), { slice, part }, newName(root->NodeName())));
+                    firstColumn += numColumns;
+                }
+                rewrite.removed.push_back(stack);
+            }
+            else if (root->OperationName() == OperationNameOf(PlusNode))
+            {
+                // a tree of Plus nodes in the loop with more than one loop-invariant term
+                function<void(const ComputationNodeBasePtr&)> collect = [&](const ComputationNodeBasePtr& node)
+                {
+                    for (const auto& input : node->GetInputs())
+                    {
+                        if (input->OperationName() == OperationNameOf(PlusNode) && input->GetNumInputs() == 2 && !isInvariant(input) &&
+                            isInternal(input) && rewritten.find(input) == rewritten.end())
+                        {
+                            rewrite.removed.push_back(input);
+                            collect(input);
+                        }
+                        else
+                            (isInvariant(input) ? invariantTerms : recurrentTerms).push_back(input);
+                    }
+                };
+                collect(root);
+                if (invariantTerms.size() < 2 || recurrentTerms.empty())
+                    continue;
+            }
+            else
+                continue;
+
+            // the invariant terms are summed first, outside the loop; then the recurrent terms are added to that
+            vector<ComputationNodeBasePtr> terms(1, invariantTerms.size() > 1 ? sumOf(invariantTerms, newName(root->NodeName())) : invariantTerms[0]);
+            terms.insert(terms.end(), recurrentTerms.begin(), recurrentTerms.end());
+            rewrite.replacement = sumOf(terms, root->NodeName());
+
+            rewritten.insert(root);
+            rewritten.insert(rewrite.removed.begin(), rewrite.removed.end());
+            rewrites.push_back(rewrite);
+        }
+        if (rewrites.empty())
+            return numRewrites;
+
+        // rewire the network
+        InvalidateCompiledNetwork();
+        for (const auto& rewrite : rewrites)
+        {
+            ChangeNodeInputs(rewrite.root, rewrite.replacement);
+            for (const auto& node : rewrite.removed)
+                RemoveNodeFromNet(node);
+            RemoveNodeFromNet(rewrite.root);
+            for (const auto& node : rewrite.added)
+                AddNodeToNet(node);
+            for (auto groupIter : GetAllNodeGroups())
+            {
+                auto& group = *groupIter;
+                for (auto& node : group)
+                    if (node == rewrite.root)
+                        node = rewrite.replacement;
+            }
+            fprintf(stderr, "HoistLoopInvariantTerms: Moved the loop-invariant terms of %ls %ls operation out of its loop.\n",
+                    rewrite.root->NodeName().c_str(), rewrite.root->OperationName().c_str());
+        }
+        CompileNetwork();
+        numRewrites += rewrites.size();
+    }
+}
+
+template size_t ComputationNetwork::HoistLoopInvariantTerms<float>();
+template size_t ComputationNetwork::HoistLoopInvariantTerms<double>();
+
+// -----------------------------------------------------------------------
+// pipeline partitioning
+// -----------------------------------------------------------------------
+
+static wstring DeviceName(DEVICEID_TYPE deviceId)
+{
+    return deviceId < 0 ? L"CPU" : L"GPU" + to_wstring(deviceId);
+}
+
+// create a node of the given operation with the precision of 'like'
+template <class ElemType>
+static ComputationNodeBasePtr NewNodeWithPrecisionOf(const ComputationNodeBasePtr& like, const wstring& operationName, DEVICEID_TYPE deviceId, const wstring& nodeName)
+{
+    if (dynamic_pointer_cast<ComputationNode<float>>(like))
+        return ComputationNetworkBuilder<float>::NewNode(operationName, deviceId, nodeName);
+    else if (dynamic_pointer_cast<ComputationNode<double>>(like))
+        return ComputationNetworkBuilder<double>::NewNode(operationName, deviceId, nodeName);
+    else
+        return ComputationNetworkBuilder<ElemType>::NewNode(operationName, deviceId, nodeName);
+}
+
+// PartitionIntoPipelineStages() -- place the nodes on several devices, for models that do not fit on one
+// The nodes in the evaluation order of 'root' are assigned to consecutive stages, one per device. A stage ends after each
+// node of 'lastNodesOfStages' if given, and otherwise once its nodes have reached their share of the total cost, which is
+// estimated by the number of elements of their outputs (for parameters, the number of parameters). Leaves (inputs and
+// parameters) and DeviceTransferNodes go to the stage of their first consumer; all other nodes keep their devices.
+// Each node is moved to its device by saving it to 'tempFileName' and loading it into a new node on that device (which
+// also works for state that is not a parameter, like the statistics of batch normalization). Each input on another
+// device than its consumer is then passed through a DeviceTransferNode. The transfers become part of the model, and keep
+// it loadable on a single device, where they are plain copies; partitioning such a model again reuses them.
+// Must be called on a compiled network before matrices are allocated; recompiles the network.
+template <class ElemType>
+size_t ComputationNetwork::PartitionIntoPipelineStages(const ComputationNodeBasePtr& root, const vector<DEVICEID_TYPE>& stageDevices,
+                                                       const vector<wstring>& lastNodesOfStages, const wstring& tempFileName)
+{
+    VerifyIsCompiled("PartitionIntoPipelineStages");
+    if (AreMatricesAllocated())
+        LogicError("PartitionIntoPipelineStages: Must be called before matrices are allocated.");
+    if (stageDevices.empty())
+        InvalidArgument("PartitionIntoPipelineStages: No devices were specified.");
+    if (!lastNodesOfStages.empty() && lastNodesOfStages.size() + 1 != stageDevices.size())
+        InvalidArgument("PartitionIntoPipelineStages: %d stages need %d last nodes of stages, but %d were specified.",
+                        (int)stageDevices.size(), (int)stageDevices.size() - 1, (int)lastNodesOfStages.size());
+
+    const size_t numStages = stageDevices.size();
+    const set<wstring> stageEnds(lastNodesOfStages.begin(), lastNodesOfStages.end());
+    for (const auto& name : stageEnds)
+    {
+        if (!NodeNameExists(name))
+            InvalidArgument("PartitionIntoPipelineStages: The last node of a stage '%ls' does not exist.", name.c_str());
+    }
+
+    const wstring deviceTransfer = OperationNameOf(DeviceTransferNode);
+    auto followsConsumer = [&](const ComputationNodeBasePtr& node) { return node->IsLeaf() || node->OperationName() == deviceTransfer; };
+    auto cost = [](const ComputationNodeBasePtr& node) { return (double)node->GetSampleLayout().GetNumElements(); };
+
+    // assign the stages
+    const auto& evalOrder = GetEvalOrder(root);
+    double totalCost = 0;
+    for (const auto& node : evalOrder)
+        totalCost += cost(node);
+    map<ComputationNodeBasePtr, size_t> stageOf;
+    vector<size_t> numNodesOfStage(numStages, 0);
+    size_t stage = 0;
+    double costSoFar = 0;
+    for (const auto& node : evalOrder)
+    {
+        if (followsConsumer(node) && node != root)
+            continue;
+        stageOf[node] = stage;
+        costSoFar += cost(node);
+        for (const auto& input : node->GetInputs())
+        {
+            if (followsConsumer(input) && stageOf.insert(make_pair(input, stage)).second)
+                costSoFar += cost(input);
+        }
+        numNodesOfStage[stage]++;
+        bool isLastOfStage = stageEnds.empty() ? costSoFar >= totalCost * (stage + 1) / numStages : stageEnds.find(node->NodeName()) != stageEnds.end();
+        if (isLastOfStage && stage + 1 < numStages)
+            stage++;
+    }
+    for (size_t i = 0; i < numStages; i++)
+        fprintf(stderr, "PartitionIntoPipelineStages: Stage %d on %ls has %d nodes.\n", (int)i, DeviceName(stageDevices[i]).c_str(), (int)numNodesOfStage[i]);
+
+    InvalidateCompiledNetwork();
+
+    // move the nodes to their devices
+    for (const auto& entry : stageOf)
+    {
+        const auto& node = entry.first;
+        const DEVICEID_TYPE deviceId = stageDevices[entry.second];
+        if (node->GetDeviceId() == deviceId)
+            continue;
+
+        auto movedNode = NewNodeWithPrecisionOf<ElemType>(node, node->OperationName(), deviceId, node->NodeName());
+        {
+            File file(tempFileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsWrite);
+            node->Save(file);
+        }
+        {
+            File file(tempFileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+            movedNode->Load(file, CURRENT_CNTK_MODEL_VERSION);
+        }
+        movedNode->AttachInputs(node->GetInputs());
+
+        ChangeNodeInputs(node, movedNode);
+        RemoveNodeFromNet(node);
+        AddNodeToNet(movedNode);
+        for (auto groupIter : GetAllNodeGroups())
+        {
+            auto& group = *groupIter;
+            for (auto& groupNode : group)
+                if (groupNode == node)
+                    groupNode = movedNode;
+        }
+    }
+    if (!stageOf.empty())
+        unlinkOrDie(tempFileName);
+
+    // connect the stages
+    map<pair<ComputationNodeBasePtr, DEVICEID_TYPE>, ComputationNodeBasePtr> transfers;
+    vector<ComputationNodeBasePtr> nodes;
+    for (const auto& iter : m_nameToNodeMap)
+        nodes.push_back(iter.second);
+    for (const auto& node : nodes)
+    {
+        if (node->OperationName() == deviceTransfer)
+            continue;
+        for (size_t i = 0; i < node->GetNumInputs(); i++)
+        {
+            const auto input = node->Input(i);
+            if (input->GetDeviceId() == node->GetDeviceId())
+                continue;
+
+            auto& transfer = transfers[make_pair(input, node->GetDeviceId())];
+            if (!transfer)
+            {
+                const wstring baseName = input->NodeName() + L".to" + DeviceName(node->GetDeviceId());
+                wstring name = baseName;
+                for (size_t k = 1; NodeNameExists(name); k++)
+                    name = baseName + L"." + to_wstring(k);
+                transfer = NewNodeWithPrecisionOf<ElemType>(input, deviceTransfer, node->GetDeviceId(), name);
+                transfer->AttachInputs({ input });
+                AddNodeToNet(transfer);
+            }
+            node->SetInput(i, transfer);
+        }
+    }
+    fprintf(stderr, "PartitionIntoPipelineStages: Inserted %d device transfers.\n", (int)transfers.size());
+
+    CompileNetwork();
+    return transfers.size();
+}
+
+template size_t ComputationNetwork::PartitionIntoPipelineStages<float>(const ComputationNodeBasePtr&, const vector<DEVICEID_TYPE>&, const vector<wstring>&, const wstring&);
+template size_t ComputationNetwork::PartitionIntoPipelineStages<double>(const ComputationNodeBasePtr&, const vector<DEVICEID_TYPE>&, const vector<wstring>&, const wstring&);
+
+// CloneToDevice() -- create a copy of this network with all nodes on 'deviceId'
+// As in PartitionIntoPipelineStages(), the nodes are saved to 'tempFileName' and loaded into new nodes on the device, so that
+// the copy also gets the state that is not a parameter. The copy has the same node groups, and is compiled; its matrices are
+// not allocated yet.
+template <class ElemType>
+ComputationNetworkPtr ComputationNetwork::CloneToDevice(DEVICEID_TYPE deviceId, const wstring& tempFileName)
+{
+    VerifyIsCompiled("CloneToDevice");
+
+    auto net = make_shared<ComputationNetwork>(deviceId);
+    net->SetTraceLevel(TraceLevel());
+    net->SetRandomSeedOffset(GetRandomSeedOffset());
+
+    vector<ComputationNodeBasePtr> nodes;
+    for (const auto& iter : m_nameToNodeMap)
+        nodes.push_back(iter.second);
+    {
+        File file(tempFileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsWrite);
+        for (const auto& node : nodes)
+            node->Save(file);
+    }
+    {
+        File file(tempFileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+        for (const auto& node : nodes)
+        {
+            auto newNode = NewNodeWithPrecisionOf<ElemType>(node, node->OperationName(), deviceId, node->NodeName());
+            newNode->Load(file, CURRENT_CNTK_MODEL_VERSION);
+            net->AddNodeToNet(newNode);
+        }
+    }
+    unlinkOrDie(tempFileName);
+
+    for (const auto& node : nodes)
+    {
+        vector<ComputationNodeBasePtr> inputs;
+        for (const auto& input : node->GetInputs())
+            inputs.push_back(net->GetNodeFromName(input->NodeName()));
+        net->GetNodeFromName(node->NodeName())->AttachInputs(inputs);
+    }
+
+    for (const wchar_t* groupTag : { L"feature", L"label", L"criterion", L"evaluation", L"output" })
+    {
+        for (const auto& node : GetNodeGroup(groupTag))
+            net->AddToNodeGroup(groupTag, net->GetNodeFromName(node->NodeName()));
+    }
+
+    net->CompileNetwork();
+    return net;
+}
+
+template ComputationNetworkPtr ComputationNetwork::CloneToDevice<float>(DEVICEID_TYPE, const wstring&);
+template ComputationNetworkPtr ComputationNetwork::CloneToDevice<double>(DEVICEID_TYPE, const wstring&);
+
 }}}
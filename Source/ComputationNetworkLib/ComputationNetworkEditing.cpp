@@ -367,4 +367,51 @@ void ComputationNetwork::SetLearnableNodesBelowLearningRateMultiplier(const floa
     }
 }
 
+// create a copy of this network that shares the values of all LearnableParameters with it
+// This is for evaluating the same model from several threads: each copy has its own nodes, and thus its own
+// activations and MatrixPool, while the parameters, which are only read during evaluation, are kept once.
+// The network must not be in use while it is copied.
+template <class ElemType>
+ComputationNetworkPtr ComputationNetwork::CloneSharingParameters()
+{
+    auto net = make_shared<ComputationNetwork>(GetDeviceId());
+    net->SetTraceLevel(TraceLevel());
+
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        auto parameter = dynamic_pointer_cast<LearnableParameter<ElemType>>(node);
+        shared_ptr<Matrix<ElemType>> sharedValue;
+        if (parameter) // detach the value temporarily, so that Duplicate() does not copy it
+            swap(sharedValue, parameter->ValuePtrRef());
+        auto newNode = node->Duplicate(node->NodeName(), CopyNodeFlags::copyNodeValue);
+        if (parameter)
+        {
+            parameter->ValuePtrRef() = sharedValue;
+            dynamic_pointer_cast<LearnableParameter<ElemType>>(newNode)->ValuePtrRef() = sharedValue;
+        }
+        net->AddNodeToNet(newNode);
+    }
+
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        auto newNode = net->GetNodeFromName(node->NodeName());
+        for (size_t i = 0; i < node->GetNumInputs(); i++)
+            newNode->SetInput(i, net->GetNodeFromName(node->GetInputs()[i]->NodeName()));
+    }
+
+    for (const wchar_t* groupTag : { L"feature", L"label", L"criterion", L"evaluation", L"output" })
+    {
+        for (const auto& node : GetNodeGroup(groupTag))
+            net->AddToNodeGroup(groupTag, net->GetNodeFromName(node->NodeName()));
+    }
+
+    net->CompileNetwork();
+    return net;
+}
+
+template ComputationNetworkPtr ComputationNetwork::CloneSharingParameters<float>();
+template ComputationNetworkPtr ComputationNetwork::CloneSharingParameters<double>();
+
 }}}
@@ -11,12 +11,17 @@
 #include "RecurrentNodes.h"
 #include "InputAndParamNodes.h"
 #include "LinearAlgebraNodes.h"
+#include "SpecialPurposeNodes.h"
+#include "TrainingNodes.h"
+#include "PerformanceProfiler.h"
+#include "GPUMemoryTimeline.h"
 #include <string>
 #include <vector>
 #include <list>
 #include <set>
 #include <algorithm>
 #include <map>
+#include <future>
 
 using namespace std;
 
@@ -72,7 +77,8 @@ static bool SetRootGradientToScalarOne(ComputationNodeBasePtr nodep)
 //  - ForwardProp() for eval nodes
 //  - ForwardProp() for the training criterion (which will reuse computation results from the previous step)
 //  - Backprop() for the training criterion
-void ComputationNetwork::Backprop(const ComputationNodeBasePtr rootNode) // training criterion to compute the gradients for
+void ComputationNetwork::Backprop(const ComputationNodeBasePtr rootNode, // training criterion to compute the gradients for
+                                  const std::function<void(const ComputationNodeBasePtr&)>& gradientCompletedCallback)
 {
     if (!Environment().IsTraining())
         LogicError("Backprop: Requires network is to be in training mode.");
@@ -85,7 +91,45 @@ void ComputationNetwork::Backprop(const ComputationNodeBasePtr rootNode) // trai
     ZeroInputGradients(rootNode);
 
     // backpropagate through the network
-    GetNestedNetwork(rootNode)->Backprop(FrameRange(nullptr), true, true);
+    auto nestedNetwork = dynamic_pointer_cast<PARTraversalFlowControlNode>(GetNestedNetwork(rootNode));
+    nestedNetwork->SetGradientCompletedCallback(gradientCompletedCallback);
+    nestedNetwork->Backprop(FrameRange(nullptr), true, true);
+    nestedNetwork->SetGradientCompletedCallback(nullptr);
+}
+
+void ComputationNetwork::ForwardPropShardedNodesWithoutLocalData(const std::vector<ComputationNodeBasePtr>& rootNodes)
+{
+    TravserseInSortedGlobalEvalOrder(rootNodes, [](const ComputationNodeBasePtr& node)
+    {
+        if (auto shardedNode = dynamic_pointer_cast<IShardedNode>(node))
+            shardedNode->ForwardPropWithoutLocalData();
+    });
+}
+
+void ComputationNetwork::BackpropShardedNodesWithoutLocalData(const ComputationNodeBasePtr& rootNode)
+{
+    const auto& evalOrder = GetEvalOrder(rootNode);
+    for (auto iter = evalOrder.rbegin(); iter != evalOrder.rend(); iter++)
+    {
+        if (auto shardedNode = dynamic_pointer_cast<IShardedNode>(*iter))
+        {
+            if ((*iter)->NeedsGradient())
+                shardedNode->BackpropWithoutLocalData();
+        }
+    }
+}
+
+// in the order of the node names, which is the same on all workers; a shard used by several nodes is aggregated once
+void ComputationNetwork::AggregateShardGradients()
+{
+    set<ComputationNodeBasePtr> aggregated;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        auto shardedNode = dynamic_pointer_cast<IShardedNode>(node);
+        if (shardedNode && node->GetNumInputs() > 0 && node->Input(0)->NeedsGradient() && aggregated.insert(node->Input(0)).second)
+            shardedNode->AggregateShardGradient();
+    }
 }
 
 void ComputationNetwork::FormNestedNetwork(const ComputationNodeBasePtr& rootNode)
@@ -139,17 +183,247 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
             nodeIter++; // and consume this node
         }
     }
+
+    // group the nodes into waves of independent nodes for parallel traversal
+    m_forwardWaves  = DetermineForwardWaves(m_nestedNodes);
+    m_backwardWaves = DetermineBackwardWaves(m_nestedNodes);
+}
+
+// get the inputs of a top-level node; for a SEQ loop, these are the inputs of the loop from outside
+/*static*/ std::set<ComputationNodeBasePtr> ComputationNetwork::PARTraversalFlowControlNode::GetTopLevelInputs(const ComputationNodeBasePtr& node)
+{
+    if (!node->Is<SEQTraversalFlowControlNode>())
+        return std::set<ComputationNodeBasePtr>(node->GetInputs().begin(), node->GetInputs().end());
+    const auto& loopNodes = node->As<SEQTraversalFlowControlNode>()->m_nestedNodes;
+    std::set<ComputationNodeBasePtr> inputs;
+    for (const auto& loopNode : loopNodes)
+        for (const auto& input : loopNode->GetInputs())
+            if (std::find(loopNodes.begin(), loopNodes.end(), input) == loopNodes.end())
+                inputs.insert(input);
+    return inputs;
+}
+
+// map each node to the top-level node (itself, or its SEQ loop) that executes it
+/*static*/ map<ComputationNodeBasePtr, ComputationNodeBasePtr> ComputationNetwork::PARTraversalFlowControlNode::GetTopLevelNodeMap(const std::vector<ComputationNodeBasePtr>& nodes)
+{
+    map<ComputationNodeBasePtr, ComputationNodeBasePtr> topLevelNodeOf;
+    for (const auto& node : nodes)
+    {
+        topLevelNodeOf[node] = node;
+        if (node->Is<SEQTraversalFlowControlNode>())
+            for (const auto& loopNode : node->As<SEQTraversalFlowControlNode>()->m_nestedNodes)
+                topLevelNodeOf[loopNode] = node;
+    }
+    return topLevelNodeOf;
+}
+
+// Forward waves: wave[k] holds all nodes whose longest input path within 'nodes' has length k.
+// All inputs of a node are thus computed in an earlier wave. The wave index of a node only depends on the
+// graph, not on the root, so any two traversals agree on it (AllocateAllMatrices() relies on that).
+/*static*/ ComputationNetwork::PARTraversalFlowControlNode::Waves ComputationNetwork::PARTraversalFlowControlNode::DetermineForwardWaves(const std::vector<ComputationNodeBasePtr>& nodes)
+{
+    let topLevelNodeOf = GetTopLevelNodeMap(nodes);
+    map<ComputationNodeBasePtr, size_t> waveOf;
+    Waves waves;
+    for (const auto& node : nodes) // (in eval order, so all inputs have been assigned already)
+    {
+        size_t wave = 0;
+        for (const auto& input : GetTopLevelInputs(node))
+        {
+            auto iter = topLevelNodeOf.find(input);
+            if (iter != topLevelNodeOf.end())
+                wave = max(wave, waveOf[iter->second] + 1);
+        }
+        waveOf[node] = wave;
+        if (waves.size() <= wave)
+            waves.resize(wave + 1);
+        waves[wave].push_back(node);
+    }
+    return waves;
+}
+
+// Backward waves: a node goes into a later wave than all of its consumers (which produce its gradient),
+// and into a later wave than any node that comes after it in eval order and shares an input with it,
+// since both accumulate into that input's gradient. This also keeps the relative order of such nodes the same
+// as in sequential traversal, which matters for the first one that overwrites the gradient (IsGradientInitializedBy()).
+/*static*/ ComputationNetwork::PARTraversalFlowControlNode::Waves ComputationNetwork::PARTraversalFlowControlNode::DetermineBackwardWaves(const std::vector<ComputationNodeBasePtr>& nodes)
+{
+    let topLevelNodeOf = GetTopLevelNodeMap(nodes);
+    map<ComputationNodeBasePtr, size_t> waveOf;           // [top-level node] -> wave
+    map<ComputationNodeBasePtr, size_t> minWaveOfConsumer; // [top-level node] -> first wave after all of its consumers
+    map<ComputationNodeBasePtr, size_t> minWaveOfInput;    // [input] -> first wave after all nodes that write into its gradient
+    Waves waves;
+    for (auto iter = nodes.rbegin(); iter != nodes.rend(); iter++) // (in reverse eval order, so all consumers have been assigned already)
+    {
+        const auto& node = *iter;
+        let inputs = GetTopLevelInputs(node);
+        size_t wave = minWaveOfConsumer[node];
+        for (const auto& input : inputs)
+            wave = max(wave, minWaveOfInput[input]);
+        waveOf[node] = wave;
+        for (const auto& input : inputs)
+        {
+            minWaveOfInput[input] = wave + 1;
+            auto inputIter = topLevelNodeOf.find(input);
+            if (inputIter != topLevelNodeOf.end())
+                minWaveOfConsumer[inputIter->second] = max(minWaveOfConsumer[inputIter->second], wave + 1);
+        }
+        if (waves.size() <= wave)
+            waves.resize(wave + 1);
+        waves[wave].push_back(node);
+    }
+    return waves;
+}
+
+// execute 'fn' on all nodes of a wave
+// Waves of CPU nodes (outside of loops) are executed concurrently on multiple threads.
+// TODO: On GPU, the nodes of a wave are still launched sequentially on the one stream; the next step is to assign one CUDA stream per branch.
+/*static*/ void ComputationNetwork::PARTraversalFlowControlNode::ForEachNodeInWave(const std::vector<ComputationNodeBasePtr>& wave, const function<void(const ComputationNodeBasePtr&)>& fn)
+{
+    bool runConcurrently = wave.size() > 1 && all_of(wave.begin(), wave.end(), [](const ComputationNodeBasePtr& node)
+    {
+        return !node->Is<SEQTraversalFlowControlNode>() && node->GetDeviceId() == CPUDEVICE;
+    });
+    if (!runConcurrently)
+    {
+        for (const auto& node : wave)
+            fn(node);
+        return;
+    }
+
+    // exceptions must not escape an OpenMP region, so we pass the first one on after the loop
+    std::exception_ptr firstException;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < (int)wave.size(); i++)
+    {
+        try
+        {
+            fn(wave[i]);
+        }
+        catch (...)
+        {
+#pragma omp critical
+            if (!firstException)
+                firstException = std::current_exception();
+        }
+    }
+    if (firstException)
+        std::rethrow_exception(firstException);
+}
+
+// helper for per-node profiling: runs fn, the forward or backward pass of the node, and reports it to the profiler if
+// node profiling is on. A loop is not reported itself, its nodes are, for each time step; flopsScale is the
+// fraction of the minibatch processed by fn. The backward pass is estimated to take twice the operations of the forward pass.
+// If NVTX ranges are on, fn is also wrapped in a range named after the node. The GPU allocations made by fn are
+// attributed to the node in the GPU memory timeline, see GPUMemoryTimeline.h.
+template <class F>
+static void ProfileNode(const ComputationNodeBasePtr& node, bool backprop, double flopsScale, const F& fn)
+{
+    ScopedGPUMemoryOwner memoryOwner(node->NodeName().c_str(), backprop);
+    let rangeNode = ProfilerNvtxEnabled() &&
+                    ProfilerRangePush(msra::strfun::utf8(node->NodeName() + L" (" + node->OperationName() + (backprop ? L") backprop" : L") forward")).c_str());
+    let profNode = node->Is<FlowControlNode>() ? -1 : ProfilerNodeBegin(node->GetDeviceId());
+    fn();
+    if (rangeNode)
+        ProfilerRangePop();
+    if (profNode >= 0)
+    {
+        let flops = node->ForwardPropFlopsEstimate() * flopsScale * (backprop ? 2 : 1);
+        ProfilerNodeEnd(profNode, node->NodeName(), node->OperationName(), backprop, flops, (long long)node->GetAllocatedBytes());
+    }
+}
+
+/*static*/ void ComputationNetwork::PARTraversalFlowControlNode::ForwardProp(const Waves& forwardWaves, const FrameRange& fr)
+{
+    for (const auto& wave : forwardWaves)
+        ForwardPropWave(wave, fr);
+}
+
+// forward-propagate the nodes of a wave
+// Host-bound nodes (see IsHostBound()) of a network on a GPU get their inputs moved to the CPU (keeping the device copy)
+// before, and their values to the device after, here on the main thread rather than implicitly inside the node code.
+// They run on a separate thread meanwhile, overlapping with the other nodes of the wave, whose GPU work is launched
+// asynchronously. That is not done if the other nodes read any of the same inputs, since the transfers of a matrix
+// are not thread-safe.
+/*static*/ void ComputationNetwork::PARTraversalFlowControlNode::ForwardPropWave(const std::vector<ComputationNodeBasePtr>& wave, const FrameRange& fr)
+{
+    let forwardProp = [&fr](const ComputationNodeBasePtr& node) { ForwardProp(node, fr); };
+    std::vector<ComputationNodeBasePtr> hostNodes;
+    std::vector<ComputationNodeBasePtr> otherNodes;
+    for (const auto& node : wave)
+    {
+        bool isHostBound = !node->Is<SEQTraversalFlowControlNode>() && node->IsHostBound() && node->GetDeviceId() != CPUDEVICE;
+        (isHostBound ? hostNodes : otherNodes).push_back(node);
+    }
+    if (hostNodes.empty())
+        return ForEachNodeInWave(wave, forwardProp);
+
+    std::set<ComputationNodeBasePtr> hostInputs;
+    for (const auto& node : hostNodes)
+    {
+        for (const auto& input : node->GetInputs())
+        {
+            input->TransferValueToDevice(CPUDEVICE, /*isBeingMoved=*/false);
+            hostInputs.insert(input);
+        }
+    }
+    bool overlap = !otherNodes.empty() && none_of(otherNodes.begin(), otherNodes.end(), [&hostInputs](const ComputationNodeBasePtr& node)
+    {
+        let inputs = GetTopLevelInputs(node);
+        return any_of(inputs.begin(), inputs.end(), [&hostInputs](const ComputationNodeBasePtr& input) { return hostInputs.find(input) != hostInputs.end(); });
+    });
+
+    if (overlap)
+    {
+        auto hostNodesDone = std::async(std::launch::async, [&]()
+        {
+            for (const auto& node : hostNodes)
+                forwardProp(node);
+        });
+        try
+        {
+            ForEachNodeInWave(otherNodes, forwardProp);
+        }
+        catch (...)
+        {
+            hostNodesDone.wait(); // (the host nodes reference the wave)
+            throw;
+        }
+        hostNodesDone.get();
+    }
+    else
+    {
+        for (const auto& node : hostNodes)
+            forwardProp(node);
+        ForEachNodeInWave(otherNodes, forwardProp);
+    }
+
+    for (const auto& node : hostNodes)
+        node->TransferValueToDevice(node->GetDeviceId(), /*isBeingMoved=*/false);
 }
 /*static*/ void ComputationNetwork::PARTraversalFlowControlNode::ForwardProp(const ComputationNodeBasePtr& node, const FrameRange& fr)
 {
     if (node->IsOutOfDateWrtInputs())
     {
-        node->BeginForwardProp();
-        node->ForwardProp(fr.WithLayout(node->GetMBLayout()));
-        node->EndForwardProp();
+        ProfileNode(node, /*backprop=*/false, 1.0, [&]()
+        {
+            node->BeginForwardProp();
+            node->ForwardProp(fr.WithLayout(node->GetMBLayout()));
+            node->EndForwardProp();
+        });
 
         node->BumpEvalTimeStamp();
 
+        // activation offload: start copying the value to host memory; and before the memory of offloaded inputs is reused
+        // after this node (as planned by AllocateAllMatrices()), let the computation wait for their copies
+        if (node->IsValueOffloadedInBackprop() && node->HasEnvironmentPtr() && node->Environment().IsTraining())
+            node->OffloadValueAsync();
+        for (const auto& input : node->GetInputs())
+        {
+            if (input->GetValueOffloadWaitNode() == node.get())
+                input->WaitForValueTransfer();
+        }
+
         // Extreme Tracing, part 1/4
         if (node->HasEnvironmentPtr() && node->Environment().ShouldDumpNode())
             DumpNode<float>(node, /*dumpGradient=*/false) || DumpNode<double>(node, false);
@@ -159,6 +433,9 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
 
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::ForwardProp(const FrameRange& fr) /*override*/
 {
+    if (Globals::ShouldUseParallelTraversal())
+        return ForwardProp(m_forwardWaves, fr);
+
     for (auto& node : m_nestedNodes)
         ForwardProp(node, fr);
 }
@@ -174,21 +451,140 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
         PostForwardAndBackProp(node);
 }
 
+/*static*/ void ComputationNetwork::PARTraversalFlowControlNode::ForEachValueToRecompute(const ComputationNodeBasePtr& node, std::set<ComputationNodeBasePtr>& recomputed, const function<void(const ComputationNodeBasePtr&)>& fn)
+{
+    // only nodes outside of loops can be marked, and a marked node does not feed into a loop (see AllocateAllMatrices())
+    if (node->Is<SEQTraversalFlowControlNode>() || node->IsPartOfLoop() || !node->NeedsGradient())
+        return;
+    for (const auto& input : node->GetInputs())
+        ForEachValueToRecomputeRec(input, recomputed, fn);
+    ForEachValueToRecomputeRec(node, recomputed, fn);
+}
+/*static*/ void ComputationNetwork::PARTraversalFlowControlNode::ForEachValueToRecomputeRec(const ComputationNodeBasePtr& node, std::set<ComputationNodeBasePtr>& recomputed, const function<void(const ComputationNodeBasePtr&)>& fn)
+{
+    if (!node->IsValueRecomputedInBackprop() || !recomputed.insert(node).second)
+        return;
+    for (const auto& input : node->GetInputs()) // a segment of marked nodes is recomputed from its unmarked inputs
+        ForEachValueToRecomputeRec(input, recomputed, fn);
+    fn(node);
+}
+
+/*static*/ void ComputationNetwork::PARTraversalFlowControlNode::ForEachValueUsedInBackprop(const ComputationNodeBasePtr& node, const function<void(const ComputationNodeBasePtr&)>& fn)
+{
+    if (node->Is<SEQTraversalFlowControlNode>() || node->IsPartOfLoop() || !node->NeedsGradient())
+        return;
+    for (const auto& input : node->GetInputs())
+        fn(input);
+    fn(node);
+}
+
+ComputationNetwork::PARTraversalFlowControlNode::Waves ComputationNetwork::PARTraversalFlowControlNode::GetBackpropSteps() const
+{
+    if (Globals::ShouldUseParallelTraversal())
+        return m_backwardWaves;
+    Waves steps;
+    for (auto pnode = m_nestedNodes.rbegin(); pnode != m_nestedNodes.rend(); pnode++)
+        steps.push_back({ *pnode });
+    return steps;
+}
+
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::Backprop(const FrameRange& fr, bool childrenInThisLoop, bool childrenInOuterLoop) /*override*/
 {
     childrenInThisLoop, childrenInOuterLoop; // TODO: think through what these mean when coming from PAR mode
-    // process nodes in pre-determined order
-    for (auto pnode = m_nestedNodes.rbegin(); pnode != m_nestedNodes.rend(); pnode++) // iterate backwards over evaluation order
+    // Usually no value is recomputed; then skip looking for values to recompute for each node and each minibatch.
+    const bool anyValueRecomputed = std::any_of(m_nestedNodes.begin(), m_nestedNodes.end(),
+                                                [](const ComputationNodeBasePtr& node) { return node->IsValueRecomputedInBackprop(); });
+    std::set<ComputationNodeBasePtr> recomputed;
+    auto recompute = [&fr](const ComputationNodeBasePtr& node)
     {
-        auto& node = *pnode;
-
-        node->BeginBackprop();
-        node->Backprop(fr.WithLayout(node->GetMBLayout()), true /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
-        node->EndBackprop();
+        // the value was released after ForwardProp(); it is a function of the (unchanged) input values, so just run it again
+        ProfileNode(node, /*backprop=*/false, 1.0, [&]()
+        {
+            node->BeginForwardProp();
+            node->ForwardProp(fr.WithLayout(node->GetMBLayout()));
+            node->EndForwardProp();
+        });
+    };
+    // activation offload: copy the values scheduled for a step back to the device, to overlap with the backprop of the
+    // steps up to their first use; only then does the computation wait for them
+    auto prefetch = [this](size_t step)
+    {
+        if (step < m_valuesToPrefetch.size())
+        {
+            for (const auto& value : m_valuesToPrefetch[step])
+                value->PrefetchValueAsync();
+        }
+    };
+    auto waitForPrefetch = [](const ComputationNodeBasePtr& node)
+    {
+        ForEachValueUsedInBackprop(node, [](const ComputationNodeBasePtr& value)
+        {
+            if (value->IsValueOffloadedInBackprop())
+                value->WaitForValueTransfer();
+        });
+    };
+    const bool anyValueOffloaded = !m_valuesToPrefetch.empty();
+    auto gradientCompleted = [this](const ComputationNodeBasePtr& node)
+    {
+        if (m_gradientCompletedCallback && node->NeedsGradient())
+            m_gradientCompletedCallback(node);
+    };
+    // A node that needs no gradient has no input that needs one either, since m_needsGradient is propagated upwards from
+    // the parameters that are updated (see ValidateNetwork()). This is e.g. the case for all nodes below frozen parameters,
+    // and for whole SEQ loops over them. Such nodes are skipped altogether, as MatrixPool allocated no gradients for them.
+    auto backprop = [&fr](const ComputationNodeBasePtr& node)
+    {
+        if (!node->NeedsGradient())
+            return;
+        ProfileNode(node, /*backprop=*/true, 1.0, [&]()
+        {
+            node->BeginBackprop();
+            node->Backprop(fr.WithLayout(node->GetMBLayout()), true /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
+            node->EndBackprop();
+        });
 
         // Extreme Tracing, part 2/4
         if (node->HasEnvironmentPtr() && node->Environment().ShouldDumpNode() && node->NeedsGradient())
             DumpNode<float>(node, /*dumpGradient=*/true) || DumpNode<double>(node, true);
+    };
+
+    if (Globals::ShouldUseParallelTraversal())
+    {
+        for (size_t step = 0; step < m_backwardWaves.size(); step++)
+        {
+            const auto& wave = m_backwardWaves[step];
+            if (anyValueOffloaded)
+            {
+                prefetch(step);
+                for (const auto& node : wave)
+                    waitForPrefetch(node);
+            }
+            if (anyValueRecomputed)
+            {
+                for (const auto& node : wave) // (recomputation is done sequentially, in the same order as planned by AllocateAllMatrices())
+                    ForEachValueToRecompute(node, recomputed, recompute);
+            }
+            if (any_of(wave.begin(), wave.end(), [](const ComputationNodeBasePtr& node) { return node->NeedsGradient(); }))
+                ForEachNodeInWave(wave, backprop);
+            for (const auto& node : wave)
+                gradientCompleted(node);
+        }
+        return;
+    }
+
+    // process nodes in pre-determined order
+    size_t step = 0;
+    for (auto pnode = m_nestedNodes.rbegin(); pnode != m_nestedNodes.rend(); pnode++, step++) // iterate backwards over evaluation order
+    {
+        if (anyValueOffloaded)
+        {
+            prefetch(step);
+            waitForPrefetch(*pnode);
+        }
+        if (anyValueRecomputed)
+            ForEachValueToRecompute(*pnode, recomputed, recompute);
+        backprop(*pnode);
+        gradientCompleted(*pnode);
     }
 }
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) /*override*/
@@ -266,11 +662,12 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
     // Note: Currently, this is limited to linear-time loops. But nothing stops the iteration below to, e.g., be a 2D iteration over an image
     // if we implement an according FrameRangeIteration.
     FrameRangeIteration range(GetMBLayout(), m_steppingDirection);
+    let flopsScale = 1.0 / GetMBLayout()->GetNumTimeSteps(); // (each time step is profiled separately)
     for (auto t = range.begin(); t != range.end(); t++)
     {
         for (auto& node : m_nestedNodes)
         {
-            node->ForwardProp(t);
+            ProfileNode(node, /*backprop=*/false, flopsScale, [&]() { node->ForwardProp(t); });
             node->BumpEvalTimeStamp();
         }
     }
@@ -305,12 +702,13 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
     const auto& recurrentNodes = m_nestedNodes; // BUGBUG: -ForForward?? Does this mean we can remove non-ForForward?
     auto pMBLayout = recurrentNodes[0]->GetMBLayout();
     FrameRangeIteration range(pMBLayout, m_steppingDirection);
+    let flopsScale = 1.0 / pMBLayout->GetNumTimeSteps(); // (each time step is profiled separately)
     for (auto t = range.rbegin(); t != range.rend(); t++) // note: reverse iteration
     {
         for (auto nodeIter2 = recurrentNodes.rbegin(); nodeIter2 != recurrentNodes.rend(); ++nodeIter2)
         {
             auto& node2 = *nodeIter2;
-            node2->Backprop(t, true /*childrenInThisLoop*/, false /*childrenInOuterLoop*/);
+            ProfileNode(node2, /*backprop=*/true, flopsScale, [&]() { node2->Backprop(t, true /*childrenInThisLoop*/, false /*childrenInOuterLoop*/); });
             // The above flags tell Backprop() to skip back-propagation from inside a node into
             // a node that is outside the loop, which is done later in EndBackprop() in PAR mode.
         }
@@ -776,8 +1174,10 @@ bool ComputationNetwork::ValidateNode(ComputationNodeBasePtr node, bool isFinalV
 
 // perform one pass of validation over the topologically-sorted node set
 // returns how many nodes either could not yet be validated yet or have changed and thus must be redone
-size_t ComputationNetwork::ValidateNodes(list<ComputationNodeBasePtr> nodes, bool isFirstPass, bool isFinalValidationPass)
+size_t ComputationNetwork::ValidateNodes(const list<ComputationNodeBasePtr>& nodes, bool isFirstPass, bool isFinalValidationPass)
 {
+    // the prototypes are only formatted for logging, since this is costly for large networks
+    const bool tracePrototypes = TraceLevel() > 0;
     size_t todo = 0;
     for (auto& node : nodes)
     {
@@ -793,7 +1193,7 @@ size_t ComputationNetwork::ValidateNodes(list<ComputationNodeBasePtr> nodes, boo
 
             // Make sure we don't use DynamicAxis in places where it was not designed for.
             // This is a stop-gap. We need a more coherent concept for passing of shapes.
-            if (child->OperationName() == L"DynamicAxis")
+            if (isFirstPass && child->OperationName() == L"DynamicAxis")
                 RuntimeError("%ls: Cannot be used as input to another node. It can only be used on the 'dynamicAxis' property of an Input node.", child->NodeDescription().c_str());
         }
 
@@ -801,24 +1201,26 @@ size_t ComputationNetwork::ValidateNodes(list<ComputationNodeBasePtr> nodes, boo
         bool valid = false;
         if (hasVisitedChild || isLeaf) // got at least one child: it makes sense to call Validate()
         {
-            string prevPrototype = node->FormatOperationPrototype("");
+            string prevPrototype = tracePrototypes ? node->FormatOperationPrototype("") : string();
             bool unchanged;
             try
             {
                 unchanged = !ValidateNode(node, isFinalValidationPass);
-                string updatedPrototype = node->FormatOperationPrototype("");
-#if 0           // print prototype in final validation pass. Problematic for tracking down validation errors in loops.
-                unchanged;
-                if (isFinalValidationPass)
-#else           // print prototype upon every change (useful for debugging)
-                if (isFirstPass || !unchanged || prevPrototype != updatedPrototype)
+                if (tracePrototypes)
+                {
+                    string updatedPrototype = node->FormatOperationPrototype("");
+#if 0               // print prototype in final validation pass. Problematic for tracking down validation errors in loops.
+                    unchanged;
+                    if (isFinalValidationPass)
+#else               // print prototype upon every change (useful for debugging)
+                    if (isFirstPass || !unchanged || prevPrototype != updatedPrototype)
 #endif
-                    if (TraceLevel() > 0)
-                    fprintf(stderr, "Validating --> %s\n", updatedPrototype.c_str());
+                        fprintf(stderr, "Validating --> %s\n", updatedPrototype.c_str());
+                }
             }
             catch (...) // if validation failed then print the prototype anyway so one can see the input args
             {
-                fprintf(stderr, "Validating --> %s FAILED\n", prevPrototype.c_str());
+                fprintf(stderr, "Validating --> %s FAILED\n", (tracePrototypes ? prevPrototype : node->FormatOperationPrototype("")).c_str());
                 throw;
             }
             node->m_visited = true;
@@ -845,15 +1247,16 @@ size_t ComputationNetwork::ValidateNodes(list<ComputationNodeBasePtr> nodes, boo
 void ComputationNetwork::MarkValueNonSharableNodes()
 {
     const auto& nodes = GetEvalOrder(nullptr);
-    std::map<wstring, bool> allLeafDescendentsAreParametersOrPreComputeNodes;
-    std::list<ComputationNodeBasePtr> allLearnableParameters = GetNodesWithType(OperationNameOf(LearnableParameter));
+    std::unordered_map<wstring, bool> allLeafDescendentsAreParametersOrPreComputeNodes;
+    auto learnableParameters = GetNodesWithType(OperationNameOf(LearnableParameter));
+    std::unordered_set<ComputationNodeBasePtr> allLearnableParameters(learnableParameters.begin(), learnableParameters.end());
     // note that: we cannot use m_learnableParameters because we need all parameters node, regardless whether it requires update or not
 
-    std::list<ComputationNodeBasePtr> allPreComputeNodes;
+    std::unordered_set<ComputationNodeBasePtr> allPreComputeNodes;
     for (const auto& node : nodes)
     {
         if (node->Is<IPreComputeNode>())
-            allPreComputeNodes.push_back(node);
+            allPreComputeNodes.insert(node);
     }
 
     for (auto& node : nodes)
@@ -878,7 +1281,7 @@ void ComputationNetwork::MarkValueNonSharableNodes()
 
         if (inputs.size()) // we don't do the check for leaf node, cause all the possible leaf nodes (input/parameters/precompute node) are marked as non-sharable already
         {
-            if (std::find(allPreComputeNodes.begin(), allPreComputeNodes.end(), node) == allPreComputeNodes.end())
+            if (allPreComputeNodes.find(node) == allPreComputeNodes.end())
             {
                 for (auto input : inputs)
                 {
@@ -887,7 +1290,7 @@ void ComputationNetwork::MarkValueNonSharableNodes()
                     {
                         // not found, means it is a leaf node (we are at eval order )
                         assert(input->IsLeaf() || input->IsPartOfLoop());
-                        if (std::find(allLearnableParameters.begin(), allLearnableParameters.end(), input) != allLearnableParameters.end())
+                        if (allLearnableParameters.find(input) != allLearnableParameters.end())
                         {
                             allLeafDescendentsAreParametersOrPreComputeNodes[inputName] = true;
                         }
@@ -1037,6 +1440,163 @@ void ComputationNetwork::PrintMemorySharingStructure(const vector<ComputationNod
 }
 
 
+// can the value of 'node' be released after ForwardProp() and recomputed during backprop?
+// This requires ForwardProp() to be a pure function of the input values.
+static bool CanRecomputeValue(const ComputationNodeBasePtr& node, const std::unordered_set<ComputationNodeBasePtr>& parents)
+{
+    if (!Globals::ShouldEnableShareNodeValueMatrices() || !node->IsValueSharable())
+        return false; // value is kept anyway
+    if (node->IsLeaf() || node->IsPartOfLoop() || node->RequiresPreCompute())
+        return false;
+    // nodes with state that ForwardProp() updates, or that draw random numbers
+    if (dynamic_pointer_cast<IStatefulNode>(node) || dynamic_pointer_cast<IRngUser>(node) || dynamic_pointer_cast<IFreezable>(node) ||
+        node->OperationName() == OperationNameOf(EpochAccumulatorNode) || node->OperationName() == OperationNameOf(AssignNode))
+        return false;
+    // loops backprop frame by frame and need their input values throughout
+    for (const auto& parent : parents)
+    {
+        if (parent->IsPartOfLoop())
+            return false;
+    }
+    return true;
+}
+
+// can the value of 'node' be released after ForwardProp() and copied back from host memory for backprop?
+// Only dense values on a GPU are copied, and, like recomputation, not within or into loops.
+static bool CanOffloadValue(const ComputationNodeBasePtr& node, const std::unordered_set<ComputationNodeBasePtr>& parents)
+{
+    if (!Globals::ShouldEnableShareNodeValueMatrices() || !node->IsValueSharable() || node->IsValueSparse())
+        return false;
+    if (node->GetDeviceId() < 0 || node->IsLeaf() || node->IsPartOfLoop() || node->IsValueRecomputedInBackprop())
+        return false;
+    for (const auto& parent : parents)
+    {
+        if (parent->IsPartOfLoop() || parent->IsValueRecomputedInBackprop()) // (a recomputation would need the value before it is copied back)
+            return false;
+    }
+    return true;
+}
+
+// cost model of activation offload, per sample: ForwardProp() of a node is taken to touch about as many elements as its
+// value has, its backprop twice as many (cf. ProfileNode()), a loop the sum of its nodes. Copying an element between
+// device and host memory is taken to cost as much as m_valueOffloadBandwidthRatio such element operations.
+static double EstimatedWorkPerSample(const ComputationNodeBasePtr& node, bool backprop)
+{
+    auto flowControlNode = dynamic_pointer_cast<FlowControlNode>(node);
+    if (!flowControlNode)
+        return (double)node->GetSampleLayout().GetNumElements() * (backprop ? 2 : 1);
+    double work = 0;
+    for (const auto& nestedNode : flowControlNode->m_nestedNodes)
+        work += EstimatedWorkPerSample(nestedNode, backprop);
+    return work;
+}
+
+static double EstimatedWorkPerSample(const std::vector<ComputationNodeBasePtr>& backpropStep)
+{
+    double work = 0;
+    for (const auto& node : backpropStep)
+        work += EstimatedWorkPerSample(node, /*backprop=*/true);
+    return work;
+}
+
+// activation offload: unmark the nodes whose value cannot be offloaded, and with automatic selection (see SetValueOffload())
+// mark the values whose copies are estimated to hide behind the computation: the copy to host memory behind the ForwardProp()
+// of the nodes up to the last one using the value, and the copy back behind the backprop before its first use.
+// An offloaded value is then released after ForwardProp() like any value not needed for backprop.
+void ComputationNetwork::SelectValuesToOffload(const std::vector<ComputationNodeBasePtr>& forwardPropRoots, const std::unordered_set<ComputationNodeBasePtr>& forwardPropNodes, const ComputationNodeBasePtr& trainRootNode,
+                                               const std::unordered_map<ComputationNodeBasePtr, std::unordered_set<ComputationNodeBasePtr>>& parentsMap,
+                                               std::unordered_map<ComputationNodeBasePtr, bool>& outputValueNeededDuringBackProp)
+{
+    // the work done in ForwardProp() up to and including each node, and in backprop before the first use of each value
+    std::unordered_map<ComputationNodeBasePtr, double> forwardWork;
+    double work = 0;
+    std::vector<ComputationNodeBasePtr> forwardOrder;
+    TravserseInSortedGlobalEvalOrder(forwardPropRoots, [&](const ComputationNodeBasePtr& node) {
+        forwardOrder.push_back(node);
+        forwardWork[node] = (work += EstimatedWorkPerSample(node, /*backprop=*/false));
+    });
+    std::unordered_map<ComputationNodeBasePtr, double> backpropWorkBeforeFirstUse;
+    work = 0;
+    for (const auto& step : dynamic_pointer_cast<PARTraversalFlowControlNode>(GetNestedNetwork(trainRootNode))->GetBackpropSteps())
+    {
+        for (const auto& node : step)
+            PARTraversalFlowControlNode::ForEachValueUsedInBackprop(node, [&](const ComputationNodeBasePtr& value) { backpropWorkBeforeFirstUse.insert(make_pair(value, work)); });
+        work += EstimatedWorkPerSample(step);
+    }
+
+    auto canOffload = [&](const ComputationNodeBasePtr& node)
+    {
+        auto parentsIter = parentsMap.find(node);
+        return parentsIter != parentsMap.end() && CanOffloadValue(node, parentsIter->second) &&
+               outputValueNeededDuringBackProp[node] && backpropWorkBeforeFirstUse.find(node) != backpropWorkBeforeFirstUse.end();
+    };
+    for (const auto& node : forwardPropNodes)
+    {
+        node->m_valueOffloadWaitNode = nullptr;
+        if (node->IsValueOffloadedInBackprop() && !canOffload(node))
+        {
+            fprintf(stderr, "AllocateAllMatrices: The value of %ls is not needed for backprop or cannot be offloaded to host memory, and will not be offloaded.\n", node->NodeDescription().c_str());
+            node->SetValueOffloadedInBackprop(false);
+        }
+    }
+
+    if (m_valueOffloadMinSampleSize > 0)
+    {
+        size_t numSelected = 0;
+        for (const auto& node : forwardOrder)
+        {
+            if (node->IsValueOffloadedInBackprop() || node->GetSampleLayout().GetNumElements() < m_valueOffloadMinSampleSize || !canOffload(node))
+                continue;
+            double forwardWorkUntilReleased = 0;
+            for (const auto& parent : parentsMap.find(node)->second)
+                forwardWorkUntilReleased = max(forwardWorkUntilReleased, forwardWork[parent] - forwardWork[node]);
+            double copyWork = m_valueOffloadBandwidthRatio * node->GetSampleLayout().GetNumElements();
+            if (forwardWorkUntilReleased < copyWork || backpropWorkBeforeFirstUse[node] < copyWork)
+                continue;
+            node->SetValueOffloadedInBackprop(true);
+            numSelected++;
+        }
+        if (TraceLevel() > 0)
+            fprintf(stderr, "AllocateAllMatrices: Selected %d values of at least %d elements per sample to offload to host memory.\n", (int)numSelected, (int)m_valueOffloadMinSampleSize);
+    }
+
+    for (const auto& node : forwardPropNodes)
+    {
+        if (node->IsValueOffloadedInBackprop())
+            outputValueNeededDuringBackProp[node] = false;
+    }
+}
+
+// activation offload: determine before which backprop step to copy each offloaded value back to the device (see
+// PARTraversalFlowControlNode::Backprop()). This is ahead of its first use by as many steps as are estimated to hide the
+// copy; any earlier would occupy the memory longer than needed.
+std::vector<std::vector<ComputationNodeBasePtr>> ComputationNetwork::ScheduleValuePrefetch(const std::vector<std::vector<ComputationNodeBasePtr>>& backpropSteps) const
+{
+    std::vector<std::vector<ComputationNodeBasePtr>> valuesToPrefetch(backpropSteps.size());
+    bool anyValueOffloaded = false;
+    std::set<ComputationNodeBasePtr> scheduled;
+    for (size_t firstUse = 0; firstUse < backpropSteps.size(); firstUse++)
+    {
+        for (const auto& node : backpropSteps[firstUse])
+        {
+            PARTraversalFlowControlNode::ForEachValueUsedInBackprop(node, [&](const ComputationNodeBasePtr& value) {
+                if (!value->IsValueOffloadedInBackprop() || !scheduled.insert(value).second)
+                    return;
+                double copyWork = m_valueOffloadBandwidthRatio * value->GetSampleLayout().GetNumElements();
+                double work = 0;
+                size_t step = firstUse;
+                while (step > 0 && work < copyWork)
+                    work += EstimatedWorkPerSample(backpropSteps[--step]);
+                valuesToPrefetch[step].push_back(value);
+                anyValueOffloaded = true;
+            });
+        }
+    }
+    if (!anyValueOffloaded)
+        valuesToPrefetch.clear();
+    return valuesToPrefetch;
+}
+
 // this function will need to be called before actual validation and execution to
 // predetermine how to share matrices to reduce memory usage.
 // TODO: find a simple topological order and allocateEvalMatrices on that order directly
@@ -1100,6 +1660,37 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         }
     }
 
+    // activation recomputation: a marked node's value is released after ForwardProp() like any value not needed for backprop,
+    // while the inputs needed to recompute it are kept
+    if (performingBackPropagation)
+    {
+        for (const auto& node : uniqueForwardPropEvalNodes)
+        {
+            if (!node->IsValueRecomputedInBackprop())
+                continue;
+            auto parentsIter = parentsMap.find(node);
+            if (parentsIter == parentsMap.end() || !CanRecomputeValue(node, parentsIter->second))
+            {
+                fprintf(stderr, "AllocateAllMatrices: The value of %ls cannot be recomputed during backprop and will be kept instead.\n", node->NodeDescription().c_str());
+                node->SetValueRecomputedInBackprop(false);
+            }
+        }
+        for (const auto& node : uniqueForwardPropEvalNodes)
+        {
+            if (!node->IsValueRecomputedInBackprop())
+                continue;
+            outputValueNeededDuringBackProp[node] = false;
+            for (const auto& input : node->GetInputs())
+            {
+                if (!input->IsValueRecomputedInBackprop())
+                    outputValueNeededDuringBackProp[input] = true;
+            }
+        }
+    }
+
+    if (performingBackPropagation)
+        SelectValuesToOffload(forwardPropRoots, uniqueForwardPropEvalNodes, trainRootNode, parentsMap, outputValueNeededDuringBackProp);
+
     // gradient reuse maps
     std::unordered_map<MatrixPool::AliasNodePtr, std::unordered_set<MatrixPool::AliasNodePtr>> gradientReuseChildrenMap;
     std::unordered_map<MatrixPool::AliasNodePtr, MatrixPool::AliasNodePtr> gradientReuseParentMap;
@@ -1138,7 +1729,7 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
 
     m_matrixPool.Reset();
 
-    TravserseInSortedGlobalEvalOrder(forwardPropRoots, [&outputValueNeededDuringBackProp, &parentsMap, this](const ComputationNodeBasePtr& node) {
+    auto requestMatricesForForwardProp = [&outputValueNeededDuringBackProp, this](const ComputationNodeBasePtr& node) {
         if (node->Is<SEQTraversalFlowControlNode>())
         {
             auto seqTraversalFlowControlNode = node->As<SEQTraversalFlowControlNode>();
@@ -1146,19 +1737,49 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
                 loopNode->SetOutputNeededDuringBackprop(outputValueNeededDuringBackProp[loopNode]);
 
             seqTraversalFlowControlNode->RequestMatricesBeforeForwardProp(m_matrixPool);
-
-            for (auto& loopNode : seqTraversalFlowControlNode->m_nestedNodes)
-                ReleaseMatricesAfterEvalForChildren(loopNode, parentsMap);
         }
         else
         {
             node->SetOutputNeededDuringBackprop(outputValueNeededDuringBackProp[node]);
             node->RequestMatricesBeforeForwardProp(m_matrixPool);
+        }
+    };
+    auto releaseMatricesAfterForwardProp = [&parentsMap, this](const ComputationNodeBasePtr& node) {
+        if (node->Is<SEQTraversalFlowControlNode>())
+        {
+            for (auto& loopNode : node->As<SEQTraversalFlowControlNode>()->m_nestedNodes)
+                ReleaseMatricesAfterEvalForChildren(loopNode, parentsMap);
+        }
+        else
+        {
             // we only release matrices for the children since the root node's information will be used
             // and should not be shared with others
             ReleaseMatricesAfterEvalForChildren(node, parentsMap);
         }
-    });
+    };
+
+    if (Globals::ShouldUseParallelTraversal())
+    {
+        // nodes of a wave may run concurrently, so a matrix released by one of them may only be reused from the next wave on
+        std::vector<ComputationNodeBasePtr> combinedNodes;
+        TravserseInSortedGlobalEvalOrder(forwardPropRoots, [&combinedNodes](const ComputationNodeBasePtr& node) {
+            combinedNodes.push_back(node);
+        });
+        for (const auto& wave : PARTraversalFlowControlNode::DetermineForwardWaves(combinedNodes))
+        {
+            for (const auto& node : wave)
+                requestMatricesForForwardProp(node);
+            for (const auto& node : wave)
+                releaseMatricesAfterForwardProp(node);
+        }
+    }
+    else
+    {
+        TravserseInSortedGlobalEvalOrder(forwardPropRoots, [&](const ComputationNodeBasePtr& node) {
+            requestMatricesForForwardProp(node);
+            releaseMatricesAfterForwardProp(node);
+        });
+    }
 
     if (trainRootNode != nullptr)
     {
@@ -1220,30 +1841,99 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         // we need to call it here since we always compute gradients for children and root node is not children of other node
         trainRootNode->RequestMatricesBeforeBackprop(m_matrixPool);
 
-        for (auto iter = backPropNodes.rbegin(); iter != backPropNodes.rend(); iter++) // for gradient computation, traverse in reverse order
+        // values recomputed for backprop are requested again before the first node that needs them,
+        // and released after their own node, their last user, like PARTraversalFlowControlNode::Backprop() does
+        std::set<ComputationNodeBasePtr> recomputed;
+        auto requestMatricesForRecompute = [this, &recomputed](const ComputationNodeBasePtr& n) {
+            PARTraversalFlowControlNode::ForEachValueToRecompute(n, recomputed, [this](const ComputationNodeBasePtr& node) {
+                node->RequestMatricesBeforeForwardProp(m_matrixPool);
+            });
+        };
+        auto releaseMatricesAfterRecompute = [this, &recomputed](const ComputationNodeBasePtr& n) {
+            if (recomputed.find(n) != recomputed.end())
+                n->ReleaseMatricesAfterForwardProp(m_matrixPool);
+        };
+
+        // offloaded values are requested again before the step that copies them back to the device, and released after
+        // their own node, likewise
+        auto nestedNetwork = dynamic_pointer_cast<PARTraversalFlowControlNode>(GetNestedNetwork(trainRootNode));
+        const auto backpropSteps = nestedNetwork->GetBackpropSteps();
+        const auto valuesToPrefetch = ScheduleValuePrefetch(backpropSteps);
+        nestedNetwork->SetValuesToPrefetch(valuesToPrefetch);
+        std::unordered_map<ComputationNodeBasePtr, size_t> backpropStepOf;
+        for (size_t step = 0; step < backpropSteps.size(); step++)
         {
-            auto n = *iter;
-            if (n->IsPartOfLoop())
+            for (const auto& n : backpropSteps[step])
+                backpropStepOf[n] = step;
+        }
+        std::set<ComputationNodeBasePtr> prefetched;
+        auto requestMatricesForPrefetch = [this, &valuesToPrefetch, &backpropStepOf, &prefetched](const ComputationNodeBasePtr& stepNode) {
+            auto stepIter = backpropStepOf.find(stepNode);
+            if (stepIter == backpropStepOf.end() || stepIter->second >= valuesToPrefetch.size())
+                return;
+            for (const auto& value : valuesToPrefetch[stepIter->second])
             {
-                std::vector<ComputationNodeBasePtr> recurrentNodes;
-                shared_ptr<SEQTraversalFlowControlNode> recInfo = FindInRecurrentLoops(m_allSEQNodes, n);
-                if (completedGradient.insert(recInfo).second)
+                if (prefetched.insert(value).second)
+                    value->RequestMatricesBeforeForwardProp(m_matrixPool);
+            }
+        };
+        auto releaseMatricesAfterPrefetch = [this, &prefetched](const ComputationNodeBasePtr& n) {
+            if (prefetched.find(n) != prefetched.end())
+                n->ReleaseMatricesAfterForwardProp(m_matrixPool);
+        };
+
+        if (Globals::ShouldUseParallelTraversal())
+        {
+            // same order as PARTraversalFlowControlNode::Backprop(); matrices released within a wave are only reused from the next wave on
+            for (const auto& wave : backpropSteps)
+            {
+                requestMatricesForPrefetch(wave.front());
+                for (const auto& n : wave)
+                    requestMatricesForRecompute(n);
+                for (const auto& n : wave)
+                    n->AllocateGradientMatricesForInputs(m_matrixPool);
+                for (const auto& n : wave)
                 {
-                    // SEQ mode: allocate all in loop first, then deallocate again
-                    // TODO: next step: use PARTraversalFlowControlNode::AllocateGradientMatricesForInputs() and ReleaseMatricesAfterBackprop()...
-                    // BUGBUG: naw, ^^ would not work! Wrong order! Need to rethink this. Need to make AllocateEvalMatrices() and AllocateGradientMatrices() the virtual functions.
-                    recInfo->AllocateGradientMatricesForInputs(m_matrixPool);
-                    // Loops are computed sample by sample so we have to allocate them all
-                    recInfo->ReleaseMatricesAfterBackprop(m_matrixPool);
+                    // Root node's information will be used and should not be shared with others, also it's small (1x1)
+                    if (n->Is<SEQTraversalFlowControlNode>() || ((n != trainRootNode) && n->NeedsGradient()))
+                        n->ReleaseMatricesAfterBackprop(m_matrixPool);
+                    releaseMatricesAfterRecompute(n);
+                    releaseMatricesAfterPrefetch(n);
                 }
             }
-            else
+        }
+        else
+        {
+            for (auto iter = backPropNodes.rbegin(); iter != backPropNodes.rend(); iter++) // for gradient computation, traverse in reverse order
             {
-                // PAR mode: we can allocate and immediately deallocate one by one
-                n->AllocateGradientMatricesForInputs(m_matrixPool);
-                // Root node's information will be used and should not be shared with others, also it's small (1x1)
-                if ((n != trainRootNode) && n->NeedsGradient())
-                    n->ReleaseMatricesAfterBackprop(m_matrixPool);
+                auto n = *iter;
+                if (n->IsPartOfLoop())
+                {
+                    std::vector<ComputationNodeBasePtr> recurrentNodes;
+                    shared_ptr<SEQTraversalFlowControlNode> recInfo = FindInRecurrentLoops(m_allSEQNodes, n);
+                    if (completedGradient.insert(recInfo).second)
+                    {
+                        requestMatricesForPrefetch(recInfo);
+                        // SEQ mode: allocate all in loop first, then deallocate again
+                        // TODO: next step: use PARTraversalFlowControlNode::AllocateGradientMatricesForInputs() and ReleaseMatricesAfterBackprop()...
+                        // BUGBUG: naw, ^^ would not work! Wrong order! Need to rethink this. Need to make AllocateEvalMatrices() and AllocateGradientMatrices() the virtual functions.
+                        recInfo->AllocateGradientMatricesForInputs(m_matrixPool);
+                        // Loops are computed sample by sample so we have to allocate them all
+                        recInfo->ReleaseMatricesAfterBackprop(m_matrixPool);
+                    }
+                }
+                else
+                {
+                    // PAR mode: we can allocate and immediately deallocate one by one
+                    requestMatricesForPrefetch(n);
+                    requestMatricesForRecompute(n);
+                    n->AllocateGradientMatricesForInputs(m_matrixPool);
+                    // Root node's information will be used and should not be shared with others, also it's small (1x1)
+                    if ((n != trainRootNode) && n->NeedsGradient())
+                        n->ReleaseMatricesAfterBackprop(m_matrixPool);
+                    releaseMatricesAfterRecompute(n);
+                    releaseMatricesAfterPrefetch(n);
+                }
             }
         }
     }
@@ -1260,7 +1950,25 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
 
     // print the memory sharing structure
     if (TraceLevel() > 0)
+    {
         PrintMemorySharingStructure(GetAllNodes());
+        PrintMemoryPlan();
+    }
+}
+
+// print the peak memory of the static memory plan, which is known before the first minibatch
+void ComputationNetwork::PrintMemoryPlan() const
+{
+    for (const auto& iter : m_matrixPool.GetMemoryPlans())
+    {
+        const auto& plan = iter.second;
+        fprintf(stderr, "\nStatic memory plan for device %d: %d requests, %.2f MB + %.2f KB per sample (buffer sharing: %.2f MB + %.2f KB per sample).\n",
+                (int)iter.first, (int)plan.numRequests,
+                plan.fixedBytes / 1048576.0, plan.perSampleBytes / 1024.0,
+                plan.sharedFixedBytes / 1048576.0, plan.sharedPerSampleBytes / 1024.0);
+        if (plan.numUnsizedRequests > 0)
+            fprintf(stderr, "\t%d requests of unknown size are not included.\n", (int)plan.numUnsizedRequests);
+    }
 }
 
 void ComputationNetwork::ReleaseMatricesAfterEvalForChildren(ComputationNodeBasePtr n, std::unordered_map<ComputationNodeBasePtr, std::unordered_set<ComputationNodeBasePtr>>& parentsMap)
@@ -1272,7 +1980,11 @@ void ComputationNetwork::ReleaseMatricesAfterEvalForChildren(ComputationNodeBase
         {
             parentsMap[pNode].erase(n);
             if (parentsMap[pNode].empty())
+            {
                 pNode->ReleaseMatricesAfterForwardProp(m_matrixPool);
+                if (pNode->IsValueOffloadedInBackprop()) // its copy to host memory must be complete before the memory is reused
+                    pNode->m_valueOffloadWaitNode = n.get();
+            }
         }
     }
 }
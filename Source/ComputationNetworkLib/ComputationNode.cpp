@@ -9,6 +9,7 @@
 #include "InputAndParamNodes.h"
 #include "ComputationNetworkBuilder.h" // TODO: We should only pull in NewComputationNodeFromConfig(). Nodes should not know about network at large.
 #include "TensorShape.h"
+#include "CUDAPageLockedMemAllocator.h"
 
 #ifndef let
 #define let const auto
@@ -770,6 +771,65 @@ template <class ElemType>
     }
 }
 
+// activation offload (see SetValueOffloadedInBackprop())
+// The copies run on the streams of an offload data transferer. Each waits on the compute stream for the value (resp. the
+// memory) to be ready. The compute stream in turn waits for the copy to host memory before the memory is reused by
+// other matrices, and for the copy back before the value is used; see WaitForValueTransfer().
+template <class ElemType>
+/*virtual*/ void ComputationNode<ElemType>::OffloadValueAsync()
+{
+    const auto& value = Value();
+    if (value.GetMatrixType() != DENSE || m_deviceId < 0)
+        LogicError("%ls: Only dense values on a GPU can be offloaded to host memory.", NodeDescription().c_str());
+
+    size_t numElements = value.GetNumElements();
+    if (numElements > m_offloadedValueCapacity)
+    {
+        int deviceId = m_deviceId;
+        m_offloadedValue.reset((ElemType*)CUDAPageLockedMemAllocator::Malloc(sizeof(ElemType) * numElements, deviceId), [deviceId](ElemType* p) { CUDAPageLockedMemAllocator::Free(p, deviceId); });
+        m_offloadedValueCapacity = numElements;
+    }
+    if (!m_valueTransferer)
+        m_valueTransferer = CreateOffloadDataTransferer(m_deviceId);
+
+    m_valueTransferer->RecordComputeStreamSyncPoint();
+    m_valueTransferer->WaitForSyncPointOnFetchStreamAsync();
+    m_valueTransferer->CopyGPUToCPUAsync(value.Data(), numElements, sizeof(ElemType), m_offloadedValue.get());
+    m_valueTransferer->RecordGPUToCPUCopy();
+    m_valueTransfer = ValueTransfer::toHost;
+
+    m_offloadedValueNumRows = value.GetNumRows();
+    m_offloadedValueNumCols = value.GetNumCols();
+    m_hasOffloadedValue = true;
+}
+
+template <class ElemType>
+/*virtual*/ void ComputationNode<ElemType>::PrefetchValueAsync()
+{
+    if (!m_hasOffloadedValue)
+        LogicError("%ls: The value was not offloaded to host memory during ForwardProp().", NodeDescription().c_str());
+    WaitForValueTransfer(); // (the copy to host memory has usually been waited for already)
+
+    // the memory is shared with other matrices, which may have resized it in between
+    auto& value = Value();
+    value.Resize(m_offloadedValueNumRows, m_offloadedValueNumCols);
+    m_valueTransferer->RecordComputeStreamSyncPoint();
+    m_valueTransferer->WaitForSyncPointOnAssignStreamAsync();
+    m_valueTransferer->CopyCPUToGPUAsync(m_offloadedValue.get(), value.GetNumElements(), sizeof(ElemType), value.Data());
+    m_valueTransferer->RecordCPUToGPUCopy();
+    m_valueTransfer = ValueTransfer::toDevice;
+}
+
+template <class ElemType>
+/*virtual*/ void ComputationNode<ElemType>::WaitForValueTransfer()
+{
+    if (m_valueTransfer == ValueTransfer::toHost)
+        m_valueTransferer->WaitForCopyGPUToCPUOnComputeStreamAsync();
+    else if (m_valueTransfer == ValueTransfer::toDevice)
+        m_valueTransferer->WaitForCopyCPUToGPUOnComputeStreamAsync();
+    m_valueTransfer = ValueTransfer::none;
+}
+
 template <class ElemType>
 /*virtual*/ void ComputationNode<ElemType>::DumpNodeInfo(const bool /*printValues*/, const bool printMetadata, File& fstream) const
 {
@@ -806,26 +866,45 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f,
                                                              bool onlyShowAbsSumForDense,
                                                              std::function<std::string(size_t)> getKeyById) const
 {
-    // get minibatch matrix -> matData, matRows, matStride
+    // get minibatch matrix -> matData
     const Matrix<ElemType>& outputValues = outputGradient ? Gradient() : Value();
-    let matRows   = outputValues.GetNumRows();
-    let matStride = matRows; // how to get from one column to the next
     unique_ptr<ElemType[]> matDataPtr(outputValues.CopyToArray());
-    ElemType* matData = matDataPtr.get();
-    let sampleLayout = GetSampleLayout(); // this is currently only used for sparse; dense tensors are linearized
+
+    WriteMinibatchWithFormatting(f, matDataPtr.get(), outputValues.GetNumRows(), outputValues.GetNumCols(), GetMBLayout(), GetSampleLayout(), fr,
+                                 onlyUpToRow, onlyUpToT, transpose, isCategoryLabel, isSparse, labelMapping, sequenceSeparator,
+                                 sequencePrologue, sequenceEpilogue, elementSeparator, sampleSeparator, valueFormatString,
+                                 onlyShowAbsSumForDense, getKeyById);
+    fflushOrDie(f);
+}
+
+// same on a host copy of the values (column-major, matRows x matCols), with the layout and sample layout of the node
+// This does not touch the node, so that SimpleOutputWriter can format a minibatch while the next one is evaluated.
+// 'matData' is modified in place for category labels. The file is not flushed.
+template <class ElemType>
+/*static*/ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f, ElemType* matData, size_t matRows, size_t matCols,
+                                                                         MBLayoutPtr pMBLayout, const TensorShape& sampleLayout,
+                                                                         const FrameRange& fr,
+                                                                         size_t onlyUpToRow, size_t onlyUpToT, bool transpose, bool isCategoryLabel, bool isSparse,
+                                                                         const vector<string>& labelMapping, const string& sequenceSeparator, 
+                                                                         const string& sequencePrologue, const string& sequenceEpilogue,
+                                                                         const string& elementSeparator, const string& sampleSeparator,
+                                                                         string valueFormatString,
+                                                                         bool onlyShowAbsSumForDense,
+                                                                         std::function<std::string(size_t)> getKeyById)
+{
+    let matStride = matRows; // how to get from one column to the next
 
     // process all sequences one by one
-    MBLayoutPtr pMBLayout = GetMBLayout();
     if (!pMBLayout) // no MBLayout: We are printing aggregates (or LearnableParameters?)
     {
         pMBLayout = make_shared<MBLayout>();
-        pMBLayout->Init(1, outputValues.GetNumCols()); // treat this as if we have one single sequence consisting of the columns
-        pMBLayout->AddSequence(0, 0, 0, outputValues.GetNumCols());
+        pMBLayout->Init(1, matCols); // treat this as if we have one single sequence consisting of the columns
+        pMBLayout->AddSequence(0, 0, 0, matCols);
     }
     let& sequences = pMBLayout->GetAllSequences();
     let  width     = pMBLayout->GetNumTimeSteps();
 
-    TensorShape tensorShape = GetSampleLayout();
+    TensorShape tensorShape = sampleLayout;
     stringstream str;
     let dims = tensorShape.GetDims();
     for (auto dim : dims)
@@ -906,7 +985,7 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f,
         {
             if (formatChar == 's') // verify label dimension
             {
-                if (outputValues.GetNumRows() != labelMapping.size() &&
+                if (matRows != labelMapping.size() &&
                     sampleLayout[0] != labelMapping.size()) // if we match the first dim then use that
                 {
                     static size_t warnings = 0;
@@ -1050,7 +1129,6 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f,
         }
         fprintfOrDie(f, "%s", sequenceEpilogue.c_str());
     } // end loop over sequences
-    fflushOrDie(f);
 }
 
 /*static*/ string WriteFormattingOptions::Processed(const wstring& nodeName, string fragment, size_t minibatchId)
@@ -1081,7 +1159,8 @@ WriteFormattingOptions::WriteFormattingOptions(const ConfigRecordType& config) :
             if      (type == L"real")     ; // default
             else if (type == L"category") isCategoryLabel = true;
             else if (type == L"sparse")   isSparse = true;
-            else                         InvalidArgument("write: type must be 'real', 'category', or 'sparse'");
+            else if (type == L"binary")   isBinary = true;
+            else                         InvalidArgument("write: type must be 'real', 'category', 'sparse', or 'binary'");
             labelMappingFile = (wstring)formatConfig(L"labelMappingFile", L"");
         }
         transpose = formatConfig(L"transpose", transpose);
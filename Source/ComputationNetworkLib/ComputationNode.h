@@ -174,7 +174,7 @@ struct ComputationNetworkOwnedNodeState
     friend class ComputationNetwork;
 
     ComputationNetworkOwnedNodeState()
-        : m_needsGradient(false), m_needsDynamicValidation(false), m_valueSharable(true), m_parentGradientOptimization(ParentGradientOptimization::None)
+        : m_needsGradient(false), m_needsDynamicValidation(false), m_valueSharable(true), m_valueRecomputedInBackprop(false), m_valueOffloadedInBackprop(false), m_valueOffloadWaitNode(nullptr), m_parentGradientOptimization(ParentGradientOptimization::None)
     {
         PurgeStateForFormingRecurrentLoops();
         m_isPartOfLoop = false;
@@ -186,6 +186,8 @@ struct ComputationNetworkOwnedNodeState
         other.m_needsGradient                 = m_needsGradient;
         other.m_needsDynamicValidation        = m_needsDynamicValidation;
         other.m_valueSharable                 = m_valueSharable;
+        other.m_valueRecomputedInBackprop     = m_valueRecomputedInBackprop;
+        other.m_valueOffloadedInBackprop      = m_valueOffloadedInBackprop;
         other.m_traceNodeValueReal            = m_traceNodeValueReal;
         other.m_traceNodeValueAsCategoryLabel = m_traceNodeValueAsCategoryLabel;
         other.m_traceNodeValueSparse          = m_traceNodeValueSparse;
@@ -204,6 +206,24 @@ struct ComputationNetworkOwnedNodeState
     virtual void MarkValueSharable() { m_valueSharable = true; }
     bool IsValueSharable() const { return m_valueSharable; }
 
+    // activation recomputation (gradient checkpointing)
+    // The value of a node marked for recomputation is not kept alive from ForwardProp() until backprop. Instead, the
+    // network runs the node's ForwardProp() again when the value is first needed during backprop, together with any
+    // marked inputs (a segment), trading compute for memory. Nodes for which this is not possible are unmarked in
+    // ComputationNetwork::AllocateAllMatrices().
+    void SetValueRecomputedInBackprop(bool f) { m_valueRecomputedInBackprop = f; }
+    bool IsValueRecomputedInBackprop() const { return m_valueRecomputedInBackprop; }
+
+    // activation offload
+    // The value of a node marked for offload is not kept on the device from ForwardProp() until backprop either. Instead,
+    // it is copied to page-locked host memory right after ForwardProp(), and copied back ahead of its first use during
+    // backprop, overlapping with the computation, trading PCIe bandwidth for memory. Nodes for which this is not possible
+    // are unmarked, and further nodes may be marked automatically, in ComputationNetwork::AllocateAllMatrices().
+    void SetValueOffloadedInBackprop(bool f) { m_valueOffloadedInBackprop = f; }
+    bool IsValueOffloadedInBackprop() const { return m_valueOffloadedInBackprop; }
+    // the node after whose ForwardProp() the memory of the offloaded value may be reused, as planned by AllocateAllMatrices()
+    const ComputationNodeBase* GetValueOffloadWaitNode() const { return m_valueOffloadWaitNode; }
+
     // tracing flags
     // Enable to print the value of the function-value matrix in somewhat readable format.
     // These are public since you are meant to set these flags manually in the debugger or temporarily poke into them from code as needed.
@@ -224,6 +244,10 @@ protected:                // TODO: should be fully encapsulated here
                           // If it is false (e.g., LearnableParameters/InputValue and those nodes are solely induced by LearnableParameters),
                           // it will never be released to memory pool
 
+    bool m_valueRecomputedInBackprop; // value is released after ForwardProp() and recomputed when needed for backprop
+    bool m_valueOffloadedInBackprop;  // value is released after ForwardProp() and copied back from host memory for backprop
+    const ComputationNodeBase* m_valueOffloadWaitNode;
+
     ParentGradientOptimization m_parentGradientOptimization; // flag indicating whether the parent of this node overwrites the gradient of this node instead of accumulating to it
 
 private:
@@ -722,6 +746,22 @@ public:
 
     virtual std::set<std::pair<const MatrixBase*, std::wstring>> GetMatrixInfo() const = 0; // to be defined by <ElemType> version
 
+    // for per-node profiling: the memory of the value and gradient (which may be shared with other nodes), and an
+    // estimate of the number of floating point operations of ForwardProp() over the whole minibatch
+    virtual size_t GetAllocatedBytes() const = 0;          // to be defined by <ElemType> version
+    virtual double ForwardPropFlopsEstimate() const = 0;   // to be defined by <ElemType> version
+
+    // activation offload (see SetValueOffloadedInBackprop()); the copies are asynchronous w.r.t. the computation on the device
+    virtual void OffloadValueAsync() = 0;    // after ForwardProp(): start copying the value to host memory
+    virtual void PrefetchValueAsync() = 0;   // before backprop: start copying it back into the value matrix
+    virtual void WaitForValueTransfer() = 0; // let the computation on the device wait for the copy last started, if any
+
+    // Host-bound nodes compute on the CPU even in a network on a GPU (e.g. the sampling nodes). In parallel traversal, the
+    // network moves their inputs to the CPU before ForwardProp() and their value to the device after it, instead of
+    // leaving these transfers to the node code, and runs them concurrently with the other nodes of their wave.
+    virtual bool IsHostBound() const { return false; }
+    virtual void TransferValueToDevice(DEVICEID_TYPE deviceId, bool isBeingMoved) = 0; // to be defined by <ElemType> version
+
     // -----------------------------------------------------------------------
     // validation
     // -----------------------------------------------------------------------
@@ -1555,6 +1595,10 @@ public:
     MatrixBasePtr ValuePtr() const override final { return m_value; }    // readers want this as a shared_ptr straight
     std::shared_ptr<Matrix<ElemType>>& ValuePtrRef() { return m_value; }
 
+    // the value that Save() writes: Value(), or a copy of it in host memory while the network is saved in the background (see ComputationNetwork::SaveAsync())
+    const Matrix<ElemType>& ValueToSave() const { return m_valueToSave ? *m_valueToSave : Value(); }
+    void SetValueToSave(const std::shared_ptr<Matrix<ElemType>>& value) { m_valueToSave = value; }
+
     // Note: We cannot return a const& since returning m_value as a MatrixBasePtr is a type cast that generates a temporary. Interesting.
 
     const Matrix<ElemType>& Gradient() const { return *m_gradient; }
@@ -1665,13 +1709,25 @@ public:
             Rethrow(e);
         }
     }
+    // same for a typed matrix, which avoids the type check (nodes call this per operation and, in loops, per time step)
+    TensorView<ElemType> DataTensorFor(const std::shared_ptr<Matrix<ElemType>>& data, size_t rank, const FrameRange& fr) const
+    {
+        try
+        {
+            return TensorView<ElemType>(data, GetTensorSliceFor(rank, fr));
+        }
+        catch (const std::exception& e) // catch the error and rethrow it with the node name attached
+        {
+            Rethrow(e);
+        }
+    }
     TensorView<ElemType> ValueTensorFor(size_t rank, const FrameRange& fr)
     {
-        return DataTensorFor(ValuePtr(), rank, fr);
+        return DataTensorFor(m_value, rank, fr);
     }
     TensorView<ElemType> GradientTensorFor(size_t rank, const FrameRange& fr)
     {
-        return DataTensorFor(GradientPtr(), rank, fr);
+        return DataTensorFor(m_gradient, rank, fr);
     }
 
     // TODO: Are all these meant to read out a scalar? Then rename and verify dimensions.
@@ -1825,6 +1881,27 @@ public:
         return matrixInfo;
     }
 
+    virtual size_t GetAllocatedBytes() const override
+    {
+        return (m_value ? m_value->BufferSize() : 0) + (m_gradient ? m_gradient->BufferSize() : 0);
+    }
+
+    // Base-class version assumes one operation per output element. Override for nodes that do more.
+    virtual double ForwardPropFlopsEstimate() const override
+    {
+        return m_value ? (double)m_value->GetNumElements() : 0.0;
+    }
+
+    virtual void OffloadValueAsync() override;
+    virtual void PrefetchValueAsync() override;
+    virtual void WaitForValueTransfer() override;
+
+    virtual void TransferValueToDevice(DEVICEID_TYPE deviceId, bool isBeingMoved) override
+    {
+        if (m_value)
+            m_value->TransferToDeviceIfNotThere(deviceId, isBeingMoved, /*emptyTransfer=*/false, /*updatePreferredDevice=*/false);
+    }
+
     // request matrices needed to do node function value evaluation
     // for memory pool utilization optimization, the requested pointer is not immediately useable until the entire network has gone through all requests 
     virtual void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) override
@@ -1947,6 +2024,8 @@ protected:
             else
                 matrixPool.RequestAllocate<ElemType>(m_deviceId, &matrixPtr, matrixSize, mbScale, isWorkSpace);
         }
+        else if (!aliasing) // requested again after its release, e.g. to recompute the value during backprop
+            matrixPool.RequestReallocate<ElemType>(&matrixPtr);
     }
 
     void ReleaseMatrixToPool(shared_ptr<Matrix<ElemType>>& matrixPtr, MatrixPool& matrixPool, bool aliasing=false)
@@ -1972,6 +2051,12 @@ public:
                                       const std::string& sampleSeparator, std::string valueFormatString,
                                       bool outputGradient = false, bool onlyShowAbsSumForDense = false,
                                       std::function<std::string(size_t)> getKeyById = std::function<std::string(size_t)>()) const;
+    static void WriteMinibatchWithFormatting(FILE* f, ElemType* matData, size_t matRows, size_t matCols, MBLayoutPtr pMBLayout, const TensorShape& sampleLayout,
+                                             const FrameRange& fr, size_t onlyUpToRow, size_t onlyUpToT, bool transpose, bool isCategoryLabel, bool isSparse,
+                                             const std::vector<std::string>& labelMapping, const std::string& sequenceSeparator,
+                                             const std::string& sequencePrologue, const std::string& sequenceEpilogue, const std::string& elementSeparator,
+                                             const std::string& sampleSeparator, std::string valueFormatString, bool onlyShowAbsSumForDense,
+                                             std::function<std::string(size_t)> getKeyById);
 
     // simple helper to log the content of a minibatch
     void DebugLogMinibatch(bool outputGradient = false) const
@@ -2140,10 +2225,21 @@ public:
 protected:
 
     shared_ptr<Matrix<ElemType>> m_value, m_gradient;
+    shared_ptr<Matrix<ElemType>> m_valueToSave; // see ValueToSave()
 
     static std::map<size_t, std::map<size_t, shared_ptr<Matrix<ElemType>>>> s_constOnes;
 
     MatrixType m_preferredGradientMatrixType = UNDETERMINED;
+
+    // activation offload, see OffloadValueAsync()
+    enum class ValueTransfer { none, toHost, toDevice };
+    std::shared_ptr<ElemType> m_offloadedValue; // page-locked host copy of the value, reused for the following minibatches
+    size_t m_offloadedValueCapacity = 0;
+    size_t m_offloadedValueNumRows = 0;
+    size_t m_offloadedValueNumCols = 0;
+    bool m_hasOffloadedValue = false;
+    ValueTransfer m_valueTransfer = ValueTransfer::none; // copy started last and not waited for yet
+    DataTransfererPtr m_valueTransferer;                 // (created on first use, with events of its own)
 };
 
 // convenience wrapper for ComputationNode::New()
@@ -2161,6 +2257,7 @@ struct WriteFormattingOptions
     bool isCategoryLabel = false;  // true: find max value in column and output the index instead of the entire vector
     std::wstring labelMappingFile; // optional dictionary for pretty-printing category labels
     bool isSparse = false;
+    bool isBinary = false;         // true: write the values in the format of the CNTKBinaryReader instead of text (only for the "write" command, not saved)
     bool transpose = true;         // true: one line per sample, each sample (column vector) forms one line; false: one column per sample
     // The following strings are interspersed with the data:
     // overall
@@ -2270,6 +2367,12 @@ public:
     virtual std::string FormatOperationPrototype(const std::string& extraArgs) const override { return ""; }
     virtual void DumpNodeInfo(const bool /*printValues*/, const bool /*printMetadata*/, File& fstream) const override {}
     virtual std::set<std::pair<const MatrixBase*, std::wstring>> GetMatrixInfo() const override { NOT_IMPLEMENTED; }
+    virtual size_t GetAllocatedBytes() const override { NOT_IMPLEMENTED; }
+    virtual double ForwardPropFlopsEstimate() const override { NOT_IMPLEMENTED; }
+    virtual void OffloadValueAsync() override { NOT_IMPLEMENTED; }
+    virtual void PrefetchValueAsync() override { NOT_IMPLEMENTED; }
+    virtual void WaitForValueTransfer() override { NOT_IMPLEMENTED; }
+    virtual void TransferValueToDevice(DEVICEID_TYPE, bool) override { NOT_IMPLEMENTED; }
 
 protected: public:                                     // needed in ComputationNetwork::FindInRecurrentLoops(), which really should be part of SEQTraversalFlowControlNode
     std::vector<ComputationNodeBasePtr> m_nestedNodes; // nodes tucked away in this node, in evaluation order
@@ -2298,6 +2401,20 @@ struct IRecurrentNode { virtual int GetRecurrenceSteppingDirection() const = 0;
 
 struct IFreezable { virtual void FreezeParameters() { } };
 
+// =======================================================================
+// IShardedNode -- nodes that exchange data with other workers in every minibatch, e.g. ShardedEmbeddingNode
+// Their input 0 is the parameter shard held by this worker.
+// =======================================================================
+
+struct IShardedNode
+{
+    // take part in the exchanges of a minibatch in which this worker has no data
+    virtual void ForwardPropWithoutLocalData() = 0;
+    virtual void BackpropWithoutLocalData() = 0;
+    // sum the gradient of the shard over the workers that hold the same shard, if any; called after backprop on all workers
+    virtual void AggregateShardGradient() { }
+};
+
 // =======================================================================
 // PreComputedNodeBase -- interface implemented by ComputationNodes that precompute
 // TODO: We can use this interface in more places.
@@ -2411,6 +2528,7 @@ protected:
     using Base::ValueFor;                                                                                                                                \
     using Base::ValuePtr;                                                                                                                                \
     using Base::ValueTensorFor;                                                                                                                          \
+    using Base::ValueToSave;                                                                                                                             \
     using Base::VerifyDataSize;                                                                                                                          \
     using Base::VerifyDims;                                                                                                                              \
     using Base::WriteMinibatchWithFormatting;                                                                                                            \
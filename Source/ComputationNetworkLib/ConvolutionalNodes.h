@@ -171,6 +171,7 @@ public:
     PoolKind PoolingKind() const { return m_poolKind; }
     bool CeilOutDim() const { return m_ceilOutDim; }
     bool PoolIncludePad() const { return m_poolIncludePad; }
+    ImageLayoutKind ImageLayout() const { return m_imageLayout; }
 
     // bottomlessly expand shape to filterRank, then expand to inputRank using defaults or given 'from' values
     template<class V, typename T>
@@ -301,15 +302,17 @@ class ConvolutionNode : public ConvolutionNodeBase<ElemType>, public NumInputs<2
     static const std::wstring TypeName() { return L"Convolution"; }
 public:
     ConvolutionNode(DEVICEID_TYPE deviceId, const wstring& name)
-        : Base(deviceId, name)
+        : Base(deviceId, name), m_groups(1)
     {
     }
     ConvolutionNode(DEVICEID_TYPE deviceId, const wstring& name, const TensorShape& kernelShape, const TensorShape& mapCount, const TensorShape& strideShape,
                     const std::vector<bool>& sharing, const std::vector<bool>& autoPadding, const TensorShape& lowerPad, const TensorShape& upperPad,
-                    bool transpose, const TensorShape &outputShape, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples)
+                    bool transpose, const TensorShape &outputShape, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, size_t groups = 1)
                     : Base(deviceId, name, kernelShape, mapCount, strideShape, sharing, autoPadding, lowerPad, upperPad, PoolKind::None, false, transpose, outputShape, false, imageLayout, maxTempMemSizeInSamples),
-                    m_convolution2D(false)
+                    m_convolution2D(false), m_groups(groups)
     {
+        if (m_groups == 0)
+            InvalidArgument("Convolution: the number of groups must be positive.");
     }
     ConvolutionNode(DEVICEID_TYPE deviceId, const wstring& name, const size_t kernelWidth, const size_t kernelHeight, const size_t outputChannels,
                     const size_t horizontalSubsample, const size_t verticalSubsample, ImageLayoutKind imageLayout,
@@ -324,7 +327,8 @@ public:
     ConvolutionNode(const ScriptableObjects::IConfigRecordPtr configp)
         : ConvolutionNode(configp->Get(L"deviceId"), L"<placeholder>", configp->Get(L"kernelShape"), configp->Get(L"mapCount"), configp->Get(L"strideShape"),
                           configp->Get(L"dimSharing"), configp->Get(L"dimPadding"), configp->Get(L"dimPadLower"), configp->Get(L"dimPadUpper"),
-                          configp->Get(L"transpose"), configp->Get(L"dimOutputShape"), ImageLayoutKindFrom(configp->Get(L"imageLayout")), configp->Get(L"maxTempMemSizeInSamples"))
+                          configp->Get(L"transpose"), configp->Get(L"dimOutputShape"), ImageLayoutKindFrom(configp->Get(L"imageLayout")), configp->Get(L"maxTempMemSizeInSamples"),
+                          configp->Exists(L"groups") ? (size_t)configp->Get(L"groups") : 1)
     {
         AttachInputsFromConfig(configp, GetExpectedNumInputs());
     }
@@ -393,9 +397,18 @@ public:
         {
             auto node = dynamic_pointer_cast<ConvolutionNode<ElemType>>(nodeP);
             node->m_convolution2D = m_convolution2D;
+            node->m_groups = m_groups;
         }
     }
 
+    // 2 operations per kernel weight of a map, for each output element (or, if transposed, each input element)
+    double ForwardPropFlopsEstimate() const override
+    {
+        size_t kernelSize = InputRef(0).GetSampleLayout().GetNumElements() / (std::max)(m_mapCount.GetNumElements(), (size_t)1);
+        double numElements = m_transpose ? (double)InputRef(1).Value().GetNumElements() : Base::ForwardPropFlopsEstimate();
+        return 2.0 * numElements * (std::max)(kernelSize, (size_t)1);
+    }
+
     void ForwardProp(const FrameRange& fr) override
     {
         Matrix<ElemType> sliceOutputValue = ValueFor(fr);
@@ -492,6 +505,7 @@ public:
             inputShape = GetInputSampleLayout(inputIdx);
             // infer reduction dimensions if not given
             InferReductionDims(inputShape, inputShape);
+            ApplyGroups(inputShape);
             if (!m_transpose)
             {
                 outputShape = ConvolveGeometry::ComputeOutputShape(inputShape, m_kernelShape, m_mapCount, m_stride,
@@ -545,15 +559,18 @@ public:
         {
             // BUGBUG: Inference does not support sharing. Problem is that we have the information too late.
             //         In this case, users will have to specify the correct dimensions. Good luck.
+            // A grouped convolution has a kernel for each map of each group.
+            size_t groups = ConvolveGeometry::ComputeGroups(inputShape, m_kernelShape, m_mapCount, m_stride, m_sharing, m_autoPad, m_lowerPad, m_upperPad);
 #if 1       // old style for back compat with previous results. Randomization will differ.
             if (Input(0)->GetSampleLayout().GetRank() == 2)
-                Input(0)->ValidateInferInputDimsFrom(TensorShape(m_mapCount.GetNumElements(), m_kernelShape.GetNumElements()));
+                Input(0)->ValidateInferInputDimsFrom(TensorShape(m_mapCount.GetNumElements() * groups, m_kernelShape.GetNumElements()));
             else
 #endif
             {
                 auto weightShape = m_kernelShape.GetDims();
                 for (auto outDim : m_mapCount.GetDims())
                     weightShape.push_back(outDim);
+                weightShape.back() *= groups;
                 Input(0)->ValidateInferInputDimsFrom(TensorShape(weightShape));
             }
         }
@@ -567,7 +584,7 @@ public:
                                                                    m_sharing, m_autoPad, m_lowerPad, m_upperPad);
                 m_convEng = ConvolutionEngine<ElemType>::Create(geometry, m_deviceId, m_imageLayout,
                                                                 m_maxTempMemSizeInSamples, m_poolKind,
-                                                                ConvolutionEngineKind::All, NodeName(), Globals::ShouldForceDeterministicAlgorithms());
+                                                                EnabledEngines(), NodeName(), Globals::ShouldForceDeterministicAlgorithms());
             }
 
             if (Input(0)->GetSampleLayout().GetNumElements() != m_kernelShape.GetNumElements() * m_convEng->Geometry()->KernelCount())
@@ -614,9 +631,55 @@ public:
 
     bool IsConvolution2D() const { return m_convolution2D; }
 
+    size_t Groups() const
+    {
+        if (m_groups > 1 || !m_convEng)
+            return m_groups;
+        return m_convEng->Geometry()->Groups();
+    }
+
     bool OutputUsedInComputingInputNodesGradients() const override { return false; }
 
 private:
+    // A grouped convolution with G groups (see ConvolveGeometry::ComputeGroups()) is given by the kernel shape without
+    // the input maps, and the number K of output maps of all groups. Once the number C of input maps is known, the
+    // kernel is made to span C/G input maps and to step by C/G of them without sharing, and the map count to K/G,
+    // which is all the geometry needs, and what is saved with the model. m_groups is then reset to 1.
+    void ApplyGroups(const TensorShape& inputShape)
+    {
+        if (m_groups == 1)
+            return;
+        size_t rank = inputShape.GetRank();
+        if (m_transpose)
+            InvalidArgument("%ls %ls operation does not support groups for convolution transpose.", NodeName().c_str(), OperationName().c_str());
+        if (rank < 2 || m_kernelShape.GetRank() != rank || m_mapCount.GetRank() != 1)
+            InvalidArgument("%ls %ls operation with groups requires a kernel without the input map dimension and a map count of rank 1.", NodeName().c_str(), OperationName().c_str());
+        size_t mapInCount = inputShape[rank - 1];
+        if (mapInCount == 0)
+            return; // (not inferred yet)
+        size_t mapOutCount = m_mapCount[0];
+        if (mapInCount % m_groups != 0 || mapOutCount % m_groups != 0)
+            InvalidArgument("%ls %ls operation: the number of input maps (%d) and of output maps (%d) must be multiples of the number of groups (%d).",
+                            NodeName().c_str(), OperationName().c_str(), (int)mapInCount, (int)mapOutCount, (int)m_groups);
+
+        size_t mapsPerGroup = mapInCount / m_groups;
+        auto kernelDims = m_kernelShape.GetDims();
+        kernelDims[rank - 1] = mapsPerGroup;
+        m_kernelShape = TensorShape(kernelDims);
+        auto strideDims = m_stride.GetDims();
+        strideDims.resize(rank, strideDims.back());
+        strideDims[rank - 1] = mapsPerGroup;
+        m_stride = TensorShape(strideDims);
+        m_sharing.resize(rank, m_sharing.back());
+        m_sharing[rank - 1] = false;
+        m_autoPad.resize(rank, m_autoPad.back());
+        m_autoPad[rank - 1] = false;
+        m_mapCount = TensorShape(mapOutCount / m_groups);
+        if (ConvolveGeometry::ComputeGroups(inputShape, m_kernelShape, m_mapCount, m_stride, m_sharing, m_autoPad, m_lowerPad, m_upperPad) != m_groups)
+            InvalidArgument("%ls %ls operation with groups does not support padding the input maps.", NodeName().c_str(), OperationName().c_str());
+        m_groups = 1;
+    }
+
     using TransformerNode::m_transforms;
     using ConvolutionNodeBase<ElemType>::ComputeFilterTransform;
 
@@ -642,8 +705,39 @@ private:
     }
 
 protected:
+    // the convolution engines the node may use
+    virtual ConvolutionEngineKind EnabledEngines() const { return ConvolutionEngineKind::All; }
+
     // Flag that indicates whether the node is created using 2D-syntax.
     bool m_convolution2D;
+    size_t m_groups;
+};
+
+// -----------------------------------------------------------------------
+// BinaryConvolutionNode (convolutionWeights, inputFeature)
+// Convolution of the signs (+1 or -1) of the weights and the input, as in binarized networks, computed
+// with bit-packed operands on the CPU. The gradients are those of the convolution of the signs with
+// respect to the signs (straight-through estimator), so that such networks can also be trained.
+// Has the parameters and the serialization of the ConvolutionNode.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class BinaryConvolutionNode : public ConvolutionNode<ElemType>
+{
+    typedef ConvolutionNode<ElemType> Base; UsingConvolutionNodeBaseMembers;
+    static const std::wstring TypeName() { return L"BinaryConvolution"; }
+public:
+    BinaryConvolutionNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name)
+    {
+    }
+    BinaryConvolutionNode(const ScriptableObjects::IConfigRecordPtr configp)
+        : Base(configp)
+    {
+    }
+
+protected:
+    ConvolutionEngineKind EnabledEngines() const override { return ConvolutionEngineKind::Binary; }
 };
 
 // -----------------------------------------------------------------------
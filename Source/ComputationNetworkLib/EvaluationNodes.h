@@ -511,8 +511,7 @@ public:
 
         MaskMissingColumnsToZero(*m_maxIndexes0, Input(0)->GetMBLayout(), frameRange);
         MaskMissingColumnsToZero(*m_maxIndexes1, Input(1)->GetMBLayout(), frameRange);
-        Value()(0, 0) = ComputeEditDistanceError(*m_maxIndexes0, *m_maxIndexes1, Input(0)->GetMBLayout(), m_subPen, m_delPen, m_insPen, m_squashInputs, m_tokensToIgnore);
-        Value().TransferToDeviceIfNotThere(Input(0)->GetDeviceId());
+        Value().SetValue(ComputeEditDistanceError(*m_maxIndexes0, *m_maxIndexes1, Input(0)->GetMBLayout(), m_subPen, m_delPen, m_insPen, m_squashInputs, m_tokensToIgnore));
     }
 
     virtual void Validate(bool isFinalValidationPass) override
@@ -576,22 +575,14 @@ public:
     // insPen - insertion penalty
     // squashInputs - whether to merge sequences of identical samples.
     // tokensToIgnore - list of samples to ignore during edit distance evaluation
-    ElemType ComputeEditDistanceError(Matrix<ElemType>& firstSeq, const Matrix<ElemType> & secondSeq, MBLayoutPtr pMBLayout, 
+    // The two sample rows are copied to the host in one transfer each; the grids are computed there one row at a time.
+    ElemType ComputeEditDistanceError(const Matrix<ElemType>& firstSeq, const Matrix<ElemType> & secondSeq, MBLayoutPtr pMBLayout, 
         float subPen, float delPen, float insPen, bool squashInputs, const vector<size_t>& tokensToIgnore)
     {
         std::vector<int> firstSeqVec, secondSeqVec;
 
-        // Edit distance between subsequences
-        Matrix<float> grid(CPUDEVICE);
-        
-        // Number of insertions between subsequences
-        Matrix<float> insMatrix(CPUDEVICE);
-        
-        //Number of deletions between subsequences
-        Matrix<float> delMatrix(CPUDEVICE);
-
-        // Number of substitutions between subsequences
-        Matrix<float> subMatrix(CPUDEVICE);
+        CopySamplesToHost(firstSeq, m_firstSamples);
+        CopySamplesToHost(secondSeq, m_secondSamples);
 
         float del, ins, sub;
         ElemType wrongSampleNum = 0.0;
@@ -611,8 +602,8 @@ public:
 
                 auto columnIndices = pMBLayout->GetColumnIndices(sequence);
 
-                ExtractSampleSequence(firstSeq, columnIndices, squashInputs, tokensToIgnore, firstSeqVec);
-                ExtractSampleSequence(secondSeq, columnIndices, squashInputs, tokensToIgnore, secondSeqVec);
+                ExtractSampleSequence(m_firstSamples, columnIndices, squashInputs, tokensToIgnore, firstSeqVec);
+                ExtractSampleSequence(m_secondSamples, columnIndices, squashInputs, tokensToIgnore, secondSeqVec);
 
                 //calculate edit distance
                 size_t firstSize = firstSeqVec.size();
@@ -622,67 +613,45 @@ public:
                 else 
                     totalSampleNum += firstSize;
 
-                grid.Resize(firstSize + 1, secondSize + 1);
-                insMatrix.Resize(firstSize + 1, secondSize + 1);
-                delMatrix.Resize(firstSize + 1, secondSize + 1);
-                subMatrix.Resize(firstSize + 1, secondSize + 1);
-                insMatrix.SetValue(0.0f);
-                delMatrix.SetValue(0.0f);
-                subMatrix.SetValue(0.0f);
-
-                for (size_t i = 0; i < firstSize + 1; i++)
-                {
-                    grid(i, 0) = (float)(i * delPen);
-                    delMatrix(i, 0) = (float)i;
-                }
-
+                // row i - 1 and row i of the grids; cell j holds the edit distance between the subsequences and the
+                // number of insertions, deletions and substitutions it consists of
+                m_prevRow.resize(secondSize + 1);
+                m_curRow.resize(secondSize + 1);
                 for (size_t j = 0; j < secondSize + 1; j++)
-                {
-                    grid(0, j) = (float)(j * insPen);
-                    insMatrix(0, j) = (float)j;
-                }
+                    m_curRow[j] = { (float)(j * insPen), (float)j, 0.0f, 0.0f };
+
                 for (size_t i = 1; i < firstSize + 1; i++)
                 {
+                    std::swap(m_prevRow, m_curRow);
+                    m_curRow[0] = { (float)(i * delPen), 0.0f, (float)i, 0.0f };
+
                     for (size_t j = 1; j < secondSize + 1; j++)
                     {
+                        const auto& diag = m_prevRow[j - 1];
+                        const auto& up   = m_prevRow[j];
+                        const auto& left = m_curRow[j - 1];
+                        auto& cell = m_curRow[j];
                         if (firstSeqVec[i - 1] == secondSeqVec[j - 1])
                         {
-                            grid(i, j) = grid(i - 1, j - 1);
-                            insMatrix(i, j) = insMatrix(i - 1, j - 1);
-                            delMatrix(i, j) = delMatrix(i - 1, j - 1);
-                            subMatrix(i, j) = subMatrix(i - 1, j - 1);
+                            cell = diag;
                         }
                         else
                         {
-                            del = grid(i - 1, j) + delPen; //deletion 
-                            ins = grid(i, j - 1) + insPen;  //insertion
-                            sub = grid(i - 1, j - 1) + subPen; //substitution 
+                            del = up.cost + delPen; //deletion 
+                            ins = left.cost + insPen;  //insertion
+                            sub = diag.cost + subPen; //substitution 
                             if (sub <= del && sub <= ins)
-                            {
-                                insMatrix(i, j) = insMatrix(i - 1, j - 1);
-                                delMatrix(i, j) = delMatrix(i - 1, j - 1);
-                                subMatrix(i, j) = subMatrix(i - 1, j - 1) + 1.0f;
-                                grid(i, j) = sub;
-                            }
+                                cell = { sub, diag.ins, diag.del, diag.sub + 1.0f };
                             else if (del < ins)
-                            {
-                                insMatrix(i, j) = insMatrix(i - 1, j);
-                                subMatrix(i, j) = subMatrix(i - 1, j);
-                                delMatrix(i, j) = delMatrix(i - 1, j) + 1.0f;
-                                grid(i, j) = del;
-                            }
+                                cell = { del, up.ins, up.del + 1.0f, up.sub };
                             else
-                            {
-                                delMatrix(i, j) = delMatrix(i, j - 1);
-                                subMatrix(i, j) = subMatrix(i, j - 1);
-                                insMatrix(i, j) = insMatrix(i, j - 1) + 1.0f;
-                                grid(i, j) = ins;
-                            }
+                                cell = { ins, left.ins + 1.0f, left.del, left.sub };
                         }
                     }
                 }
 
-                wrongSampleNum += insMatrix(firstSize, secondSize) + delMatrix(firstSize, secondSize) + subMatrix(firstSize, secondSize);
+                const auto& last = m_curRow[secondSize];
+                wrongSampleNum += last.ins + last.del + last.sub;
             }
 
             sequenceStartFrame += numFrames;
@@ -726,13 +695,36 @@ private:
     float m_insPen;
     std::vector<size_t> m_tokensToIgnore;
 
+    // one cell of the edit distance grids
+    struct EditDistanceCell
+    {
+        float cost;
+        float ins;
+        float del;
+        float sub;
+    };
+
+    // host copies of the sample rows and the grid rows, to avoid reallocation
+    std::vector<ElemType> m_firstSamples, m_secondSamples;
+    std::vector<EditDistanceCell> m_prevRow, m_curRow;
+
+    static void CopySamplesToHost(const Matrix<ElemType>& samples, std::vector<ElemType>& out_samples)
+    {
+        out_samples.resize(samples.GetNumElements());
+        if (out_samples.empty())
+            return;
+        ElemType* data = out_samples.data();
+        size_t size = out_samples.size();
+        samples.CopyToArray(data, size);
+    }
+
     // Clear out_SampleSeqVec and extract a vector of samples from the matrix into out_SampleSeqVec.
-    static void ExtractSampleSequence(const Matrix<ElemType>& firstSeq, vector<size_t>& columnIndices, bool squashInputs, const vector<size_t>& tokensToIgnore, std::vector<int>& out_SampleSeqVec)
+    static void ExtractSampleSequence(const std::vector<ElemType>& firstSeq, vector<size_t>& columnIndices, bool squashInputs, const vector<size_t>& tokensToIgnore, std::vector<int>& out_SampleSeqVec)
     {
         out_SampleSeqVec.clear();
 
         // Get the first element in the sequence
-        size_t lastId = (int)firstSeq(0, columnIndices[0]);
+        size_t lastId = (int)firstSeq[columnIndices[0]];
         if (std::find(tokensToIgnore.begin(), tokensToIgnore.end(), lastId) == tokensToIgnore.end())
             out_SampleSeqVec.push_back(lastId);
 
@@ -742,7 +734,7 @@ private:
             //squash sequences of identical samples
             for (size_t i = 1; i < columnIndices.size(); i++)
             {
-                size_t refId = (int)firstSeq(0, columnIndices[i]);
+                size_t refId = (int)firstSeq[columnIndices[i]];
                 if (lastId != refId)
                 {
                     lastId = refId;
@@ -755,7 +747,7 @@ private:
         {
             for (size_t i = 1; i < columnIndices.size(); i++)
             {
-                auto refId = (int)firstSeq(0, columnIndices[i]);
+                auto refId = (int)firstSeq[columnIndices[i]];
                 if (std::find(tokensToIgnore.begin(), tokensToIgnore.end(), refId) == tokensToIgnore.end())
                     out_SampleSeqVec.push_back(refId);
             }
@@ -278,6 +278,20 @@ std::tuple<size_t, size_t, ElemType> LearnableParameter<ElemType>::InitRandom(Ma
     range *= initValueScale;
 
     // the random seed offset is set via the "randomSeedOffset" parameter in config
+    if (Globals::ShouldUseCounterBasedRandomInit())
+    {
+        // generated in place, by all threads resp. on the GPU; the values do not depend on the device, so
+        // there is no need to go through the CPU for 'initOnCPUOnly'
+        if (initOnCPUOnly)
+            valueMatrix.TransferToDeviceIfNotThere(deviceId, true);
+        let distribution = opts.first == DistributionType::Uniform ? RandomDistribution::Uniform :
+                           opts.first == DistributionType::Normal  ? RandomDistribution::Normal  : RandomDistribution::TruncatedNormal;
+        if (distribution == RandomDistribution::Uniform)
+            valueMatrix.SetCounterBasedRandomValue(distribution, -range, range, randomSeed);
+        else
+            valueMatrix.SetCounterBasedRandomValue(distribution, 0, range, randomSeed);
+        return std::make_tuple(fanOut, fanIn, range);
+    }
     if (initOnCPUOnly)
         valueMatrix.TransferToDeviceIfNotThere(CPUDEVICE, true);
     if (opts.first == DistributionType::Uniform)
@@ -427,7 +441,7 @@ void LearnableParameter<ElemType>::Save(File& fstream) const /*override*/
     Base::Save(fstream);
     fstream << m_learningRateMultiplier;
     m_sampleLayout.Save(fstream);
-    fstream << Value();
+    ValueToSave().Write(fstream, m_storageFormat);
 }
 
 template <class ElemType>
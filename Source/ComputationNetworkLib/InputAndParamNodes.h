@@ -51,6 +51,7 @@ public:
         m_initString = L"fromValue"; // default init is with 0; typically overwritten
         m_initValue = 0;
         m_regMultiplier = 1.0f; // enable reg in update by default
+        m_storageFormat = MatrixStorageFormat::full;
     }
     LearnableParameter(DEVICEID_TYPE deviceId, const wstring& name, const TensorShape& shape) :
         LearnableParameter(deviceId, name)
@@ -154,6 +155,9 @@ public:
     // called from SGD UpdateWeights, to adjust the reg for each node
     float GetRegMultiplier() const { return m_regMultiplier; }
 
+    // how Save() stores the value, e.g. quantized for smaller model files (which Load() converts back), see ComputationNetwork::SetParameterStorageFormat()
+    void SetStorageFormat(MatrixStorageFormat storageFormat) { m_storageFormat = storageFormat; }
+
     virtual bool /*TransformerNode::*/SupportsTransformOnInput(size_t /*index*/) override
     {
         RuntimeError("LearnableParameter should not be asked for input transforms, since it has no inputs.");
@@ -177,6 +181,8 @@ private:
 
     // flags related to gradient update
     float m_regMultiplier; // The multiplier to adjust the L1Reg and L2Reg for Learnable node
+
+    MatrixStorageFormat m_storageFormat; // (not saved itself; the matrix is self-describing)
 };
 
 // -----------------------------------------------------------------------
@@ -350,6 +356,16 @@ public:
         Init(sampleLayout, m_isSparse, m_dynamicAxisNodeName, learningRateMultiplier);
     }
 
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
+    {
+        Base::CopyTo(nodeP, newName, flags);
+        if (flags & CopyNodeFlags::copyNodeValue)
+        {
+            auto node = dynamic_pointer_cast<InputValueBase<ElemType>>(nodeP);
+            node->m_dynamicAxisNodeName = m_dynamicAxisNodeName;
+        }
+    }
+
     // InputValue must not resize its inputs because that might destroy it. It should already have the correct size.
     virtual void UpdateFunctionMBSize() override
     {
@@ -4,6 +4,8 @@
 //
 
 #include "LinearAlgebraNodes.h"
+#include "MPIWrapper.h"
+#include "NcclComm.h"
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -127,4 +129,594 @@ void EpochAccumulatorNode<ElemType>::Reset()
 }
 
 template class EpochAccumulatorNode<float>;
-template class EpochAccumulatorNode<double>;
\ No newline at end of file
+template class EpochAccumulatorNode<double>;
+// -----------------------------------------------------------------------
+// ShardedEmbeddingNode -- embedding with a table that is partitioned across the workers
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+ShardedEmbeddingNode<ElemType>::ShardedEmbeddingNode(DEVICEID_TYPE deviceId, const wstring& name)
+    : Base(deviceId, name)
+{
+    m_shardInput = make_shared<Matrix<ElemType>>(0, 0, deviceId, SPARSE, matrixFormatSparseCSC);
+    m_allColumns = make_shared<Matrix<ElemType>>(deviceId);
+}
+
+template <class ElemType>
+ShardedEmbeddingNode<ElemType>::ShardedEmbeddingNode(const Microsoft::MSR::ScriptableObjects::IConfigRecordPtr configp)
+    : ShardedEmbeddingNode(configp->Get(L"deviceId"), L"<placeholder>")
+{
+    AttachInputsFromConfig(configp, this->GetExpectedNumInputs());
+}
+
+template <class ElemType>
+/*static*/ size_t ShardedEmbeddingNode<ElemType>::NumShards()
+{
+    auto mpi = MPIWrapper::GetInstance();
+    return mpi ? mpi->NumNodesInUse() : 1;
+}
+
+template <class ElemType>
+/*static*/ size_t ShardedEmbeddingNode<ElemType>::ShardIndex()
+{
+    auto mpi = MPIWrapper::GetInstance();
+    return mpi ? mpi->CurrentNodeRank() : 0;
+}
+
+template <class ElemType>
+void ShardedEmbeddingNode<ElemType>::Validate(bool isFinalValidationPass)
+{
+    Base::Validate(isFinalValidationPass);
+    InferMBLayoutFromInputsForStandardCase(isFinalValidationPass);
+
+    if (Input(0)->HasMBLayout())
+        InvalidArgument("%ls %ls operation: The embedding table (input 0) must be a parameter without a minibatch layout.", NodeName().c_str(), OperationName().c_str());
+
+    // the shard is [D x ShardSize()]; its second dimension is inferred
+    const auto& shardShape = Input(0)->GetSampleLayout();
+    if (shardShape.GetRank() == 0)
+        InvalidArgument("%ls %ls operation: The embedding table (input 0) must have a dimension.", NodeName().c_str(), OperationName().c_str());
+    const size_t dim = shardShape[0];
+    if (Input(1)->GetSampleLayout().GetNumElements() != 0)
+        Input(0)->ValidateInferInputDimsFrom(TensorShape(dim, ShardSize()));
+
+    if (isFinalValidationPass)
+    {
+        const auto& inferredShape = Input(0)->GetSampleLayout();
+        if (inferredShape.GetRank() != 2 || inferredShape[1] != ShardSize())
+            InvalidArgument("%ls %ls operation: The embedding table shard (input 0) must have the dimensions [%d x %d] for an input dimension of %d and %d workers, but it has [%s].",
+                            NodeName().c_str(), OperationName().c_str(), (int) dim, (int) ShardSize(),
+                            (int) Input(1)->GetSampleLayout().GetNumElements(), (int) NumShards(), string(inferredShape).c_str());
+    }
+
+    SetDims(TensorShape(dim), HasMBLayout());
+}
+
+template <class ElemType>
+void ShardedEmbeddingNode<ElemType>::ForwardPropNonLooping()
+{
+    if (NumShards() == 1)
+    {
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, InputRef(0).Value(), false, InputRef(1).Value(), false, 0, Value());
+        return;
+    }
+
+    std::vector<CPUSPARSE_INDEX_TYPE> colStarts, rowIndices;
+    std::vector<ElemType> values;
+    InputRef(1).Value().CopyToCSCFormat(colStarts, rowIndices, values);
+    ExchangeInput(colStarts, rowIndices, values);
+    ComputeOutput(/*hasLocalData=*/true);
+}
+
+template <class ElemType>
+void ShardedEmbeddingNode<ElemType>::ForwardPropWithoutLocalData()
+{
+    if (NumShards() == 1)
+        return;
+
+    ExchangeInput(std::vector<CPUSPARSE_INDEX_TYPE>(1, 0), std::vector<CPUSPARSE_INDEX_TYPE>(), std::vector<ElemType>());
+    ComputeOutput(/*hasLocalData=*/false);
+}
+
+// Gathers the sparse inputs of all workers and keeps the elements that fall into the rows of this worker's shard.
+// Every exchange is an MPI all-gather, with the data of each worker padded to the largest one.
+template <class ElemType>
+void ShardedEmbeddingNode<ElemType>::ExchangeInput(const std::vector<CPUSPARSE_INDEX_TYPE>& colStarts, const std::vector<CPUSPARSE_INDEX_TYPE>& rowIndices, const std::vector<ElemType>& values)
+{
+    auto mpi = MPIWrapper::GetInstance();
+    const size_t numShards = NumShards();
+
+    // the number of columns and of non-zero elements of each worker
+    size_t localCounts[2] = { colStarts.size() - 1, rowIndices.size() };
+    std::vector<size_t> counts(2 * numShards);
+    mpi->AllGather(localCounts, 2, counts.data(), 2);
+    size_t maxNumCols = 0, maxNumNonZeros = 0;
+    m_numColsOfWorkers.resize(numShards);
+    for (size_t q = 0; q < numShards; q++)
+    {
+        m_numColsOfWorkers[q] = counts[2 * q];
+        maxNumCols = max(maxNumCols, counts[2 * q]);
+        maxNumNonZeros = max(maxNumNonZeros, counts[2 * q + 1]);
+    }
+
+    std::vector<CPUSPARSE_INDEX_TYPE> sendIndices(maxNumCols + 1 + maxNumNonZeros, 0);
+    std::copy(colStarts.begin(), colStarts.end(), sendIndices.begin());
+    std::copy(rowIndices.begin(), rowIndices.end(), sendIndices.begin() + maxNumCols + 1);
+    std::vector<ElemType> sendValues(maxNumNonZeros, 0);
+    std::copy(values.begin(), values.end(), sendValues.begin());
+
+    std::vector<CPUSPARSE_INDEX_TYPE> allIndices(sendIndices.size() * numShards);
+    std::vector<ElemType> allValues(sendValues.size() * numShards);
+    mpi->AllGather(sendIndices.data(), sendIndices.size(), allIndices.data(), sendIndices.size());
+    if (maxNumNonZeros > 0)
+        mpi->AllGather(sendValues.data(), sendValues.size(), allValues.data(), sendValues.size());
+
+    // the columns of all workers, in the order of the workers, restricted to the rows of this shard
+    const size_t shardSize = ShardSize();
+    const CPUSPARSE_INDEX_TYPE firstRow = (CPUSPARSE_INDEX_TYPE) (ShardIndex() * shardSize);
+    const CPUSPARSE_INDEX_TYPE endRow = firstRow + (CPUSPARSE_INDEX_TYPE) shardSize;
+    std::vector<CPUSPARSE_INDEX_TYPE> shardColStarts(1, 0), shardRowIndices;
+    std::vector<ElemType> shardValues;
+    for (size_t q = 0; q < numShards; q++)
+    {
+        const CPUSPARSE_INDEX_TYPE* workerColStarts = allIndices.data() + q * sendIndices.size();
+        const CPUSPARSE_INDEX_TYPE* workerRowIndices = workerColStarts + maxNumCols + 1;
+        const ElemType* workerValues = allValues.data() + q * sendValues.size();
+        for (size_t j = 0; j < m_numColsOfWorkers[q]; j++)
+        {
+            for (CPUSPARSE_INDEX_TYPE p = workerColStarts[j]; p < workerColStarts[j + 1]; p++)
+            {
+                if (workerRowIndices[p] >= firstRow && workerRowIndices[p] < endRow)
+                {
+                    shardRowIndices.push_back(workerRowIndices[p] - firstRow);
+                    shardValues.push_back(workerValues[p]);
+                }
+            }
+            shardColStarts.push_back((CPUSPARSE_INDEX_TYPE) shardRowIndices.size());
+        }
+    }
+
+    m_shardInput->SetMatrixFromCSCFormat(shardColStarts.data(), shardRowIndices.data(), shardValues.data(),
+                                         shardRowIndices.size(), shardSize, shardColStarts.size() - 1);
+}
+
+// The partial products of the shards are summed by an all-reduce, of which each worker keeps its own columns.
+// (MPIWrapper has no reduce-scatter; the all-reduce transfers the outputs of all workers to all workers.)
+template <class ElemType>
+void ShardedEmbeddingNode<ElemType>::ComputeOutput(bool hasLocalData)
+{
+    const size_t dim = GetSampleLayout().GetNumElements();
+    const size_t numCols = m_shardInput->GetNumCols();
+    if (numCols == 0)
+        return;
+
+    Matrix<ElemType>::MultiplyAndWeightedAdd(1, InputRef(0).Value(), false, *m_shardInput, false, 0, *m_allColumns);
+    std::vector<ElemType> allColumns(dim * numCols);
+    m_allColumns->CopySection(dim, numCols, allColumns.data(), dim);
+    MPIWrapper::GetInstance()->AllReduce(allColumns.data(), allColumns.size());
+
+    if (!hasLocalData)
+        return;
+    size_t firstCol = 0;
+    for (size_t q = 0; q < ShardIndex(); q++)
+        firstCol += m_numColsOfWorkers[q];
+    Value().SetValue(dim, m_numColsOfWorkers[ShardIndex()], Value().GetDeviceId(), allColumns.data() + firstCol * dim);
+}
+
+template <class ElemType>
+void ShardedEmbeddingNode<ElemType>::BackpropToNonLooping(size_t inputIndex)
+{
+    if (inputIndex != 0)
+        InvalidArgument("%ls %ls operation: The gradient of the input (input 1) is not supported.", NodeName().c_str(), OperationName().c_str());
+    ComputeShardGradient(/*hasLocalData=*/true);
+}
+
+template <class ElemType>
+void ShardedEmbeddingNode<ElemType>::BackpropWithoutLocalData()
+{
+    if (NumShards() == 1 || !InputRef(0).NeedsGradient())
+        return;
+    ComputeShardGradient(/*hasLocalData=*/false);
+}
+
+// The gradient of the shard is the product of the output gradients of all workers with the exchanged input of the shard.
+template <class ElemType>
+void ShardedEmbeddingNode<ElemType>::ComputeShardGradient(bool hasLocalData)
+{
+    bool overwriteInputGradient = InputRef(0).IsGradientInitializedBy(this);
+
+    // as in TimesNode, the gradient of a table that is multiplied with sparse input is sparse
+    if (!InputRef(0).GradientPtr() || InputRef(0).GetPreferredGradientMatrixType() == UNDETERMINED)
+    {
+        InputRef(0).GradientPtrRef() = std::make_shared<Matrix<ElemType>>(InputRef(0).GetSampleLayout()[0], ShardSize(),
+                                                                          InputRef(0).Value().GetPreferredDeviceId(), SPARSE, MatrixFormat::matrixFormatSparseBlockCol);
+        InputRef(0).SetPreferredGradientMatrixType(SPARSE);
+    }
+
+    const Matrix<ElemType>& shardInput = NumShards() == 1 ? InputRef(1).Value() : *m_shardInput;
+    if (NumShards() > 1)
+    {
+        auto mpi = MPIWrapper::GetInstance();
+        const size_t dim = GetSampleLayout().GetNumElements();
+        const size_t numCols = m_shardInput->GetNumCols();
+        if (numCols == 0)
+            return;
+
+        size_t maxNumCols = *std::max_element(m_numColsOfWorkers.begin(), m_numColsOfWorkers.end());
+        std::vector<ElemType> sendColumns(dim * maxNumCols, 0);
+        if (hasLocalData)
+            Gradient().CopySection(dim, m_numColsOfWorkers[ShardIndex()], sendColumns.data(), dim);
+        std::vector<ElemType> receiveColumns(sendColumns.size() * NumShards());
+        mpi->AllGather(sendColumns.data(), sendColumns.size(), receiveColumns.data(), sendColumns.size());
+
+        std::vector<ElemType> allColumns;
+        allColumns.reserve(dim * numCols);
+        for (size_t q = 0; q < NumShards(); q++)
+            allColumns.insert(allColumns.end(), receiveColumns.begin() + q * sendColumns.size(), receiveColumns.begin() + q * sendColumns.size() + dim * m_numColsOfWorkers[q]);
+        m_allColumns->SetValue(dim, numCols, m_allColumns->GetDeviceId(), allColumns.data());
+    }
+
+    const Matrix<ElemType>& outputGradient = NumShards() == 1 ? Gradient() : *m_allColumns;
+    Matrix<ElemType>::MultiplyAndWeightedAdd(1, outputGradient, false, shardInput, true, overwriteInputGradient ? 0 : 1, InputRef(0).Gradient());
+}
+
+template class ShardedEmbeddingNode<float>;
+template class ShardedEmbeddingNode<double>;
+
+// -----------------------------------------------------------------------
+// TensorParallelTimesNode -- Times with a weight matrix that is partitioned across groups of workers
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+TensorParallelTimesNode<ElemType>::TensorParallelTimesNode(DEVICEID_TYPE deviceId, const wstring& name, size_t outputDim, size_t tensorParallelDegree, bool shardOutput)
+    : Base(deviceId, name), m_outputDim(outputDim), m_tensorParallelDegree(tensorParallelDegree), m_shardOutput(shardOutput), m_maxNumCols(0), m_outputGradientExchanged(false)
+{
+    m_groupInput = make_shared<Matrix<ElemType>>(deviceId);
+    m_groupOutputGradient = make_shared<Matrix<ElemType>>(deviceId);
+    m_sendBuffer = make_shared<Matrix<ElemType>>(deviceId);
+    m_receiveBuffer = make_shared<Matrix<ElemType>>(deviceId);
+}
+
+template <class ElemType>
+TensorParallelTimesNode<ElemType>::TensorParallelTimesNode(const Microsoft::MSR::ScriptableObjects::IConfigRecordPtr configp)
+    : TensorParallelTimesNode(configp->Get(L"deviceId"), L"<placeholder>", configp->Get(L"outputDim"),
+                              configp->Exists(L"tensorParallelDegree") ? (size_t) configp->Get(L"tensorParallelDegree") : 0,
+                              configp->Exists(L"shardOutput") ? (bool) configp->Get(L"shardOutput") : true)
+{
+    AttachInputsFromConfig(configp, this->GetExpectedNumInputs());
+}
+
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const
+{
+    Base::CopyTo(nodeP, newName, flags);
+    if (flags & CopyNodeFlags::copyNodeValue)
+    {
+        auto node = dynamic_pointer_cast<TensorParallelTimesNode<ElemType>>(nodeP);
+        node->m_outputDim = m_outputDim;
+        node->m_tensorParallelDegree = m_tensorParallelDegree;
+        node->m_shardOutput = m_shardOutput;
+    }
+}
+
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::Save(File& fstream) const
+{
+    Base::Save(fstream);
+    fstream << m_outputDim << m_tensorParallelDegree << (int) m_shardOutput;
+}
+
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::Load(File& fstream, size_t modelVersion)
+{
+    Base::Load(fstream, modelVersion);
+    int shardOutput;
+    fstream >> m_outputDim >> m_tensorParallelDegree >> shardOutput;
+    m_shardOutput = shardOutput != 0;
+}
+
+template <class ElemType>
+size_t TensorParallelTimesNode<ElemType>::Degree() const
+{
+    auto mpi = MPIWrapper::GetInstance();
+    if (!mpi || mpi->NumNodesInUse() == 1)
+        return 1;
+    return m_tensorParallelDegree == 0 ? mpi->NumNodesInUse() : m_tensorParallelDegree;
+}
+
+template <class ElemType>
+size_t TensorParallelTimesNode<ElemType>::ShardIndex() const
+{
+    return Degree() == 1 ? 0 : MPIWrapper::GetInstance()->CurrentNodeRank() % Degree();
+}
+
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::Validate(bool isFinalValidationPass)
+{
+    Base::Validate(isFinalValidationPass);
+    InferMBLayoutFromInputsForStandardCase(isFinalValidationPass);
+
+    if (Input(0)->HasMBLayout())
+        InvalidArgument("%ls %ls operation: The weight (input 0) must be a parameter without a minibatch layout.", NodeName().c_str(), OperationName().c_str());
+    if (m_outputDim == 0)
+        InvalidArgument("%ls %ls operation: The outputDim must be specified.", NodeName().c_str(), OperationName().c_str());
+
+    const size_t degree = Degree();
+    auto mpi = MPIWrapper::GetInstance();
+    if (degree > 1 && mpi->NumNodesInUse() % degree != 0)
+        InvalidArgument("%ls %ls operation: The number of workers (%d) must be a multiple of the tensorParallelDegree (%d).",
+                        NodeName().c_str(), OperationName().c_str(), (int) mpi->NumNodesInUse(), (int) degree);
+
+    // the shard is [M/P x K] resp. [M x K/P]; its dimensions are inferred
+    const size_t inputDim = InputDim();
+    if (inputDim != 0)
+    {
+        const size_t shardedDim = m_shardOutput ? m_outputDim : inputDim;
+        if (shardedDim % degree != 0)
+            InvalidArgument("%ls %ls operation: The %ls dimension (%d) must be a multiple of the tensorParallelDegree (%d).",
+                            NodeName().c_str(), OperationName().c_str(), m_shardOutput ? L"output" : L"input", (int) shardedDim, (int) degree);
+        TensorShape shardShape = m_shardOutput ? TensorShape(m_outputDim / degree, inputDim) : TensorShape(m_outputDim, inputDim / degree);
+        Input(0)->ValidateInferInputDimsFrom(shardShape);
+
+        if (isFinalValidationPass && Input(0)->GetSampleLayout() != shardShape)
+            InvalidArgument("%ls %ls operation: The weight shard (input 0) must have the dimensions [%s] for an output dimension of %d, an input dimension of %d and a tensorParallelDegree of %d, but it has [%s].",
+                            NodeName().c_str(), OperationName().c_str(), string(shardShape).c_str(), (int) m_outputDim, (int) inputDim, (int) degree,
+                            string(Input(0)->GetSampleLayout()).c_str());
+    }
+
+    SetDims(TensorShape(m_outputDim), HasMBLayout());
+}
+
+// The communicators are created by the first minibatch, in which all workers get here in the same order.
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::EnsureCommunicators()
+{
+    if (m_groupComm)
+        return;
+
+    auto mpi = MPIWrapper::GetInstance();
+    const size_t degree = Degree();
+    const size_t rank = mpi->CurrentNodeRank();
+    m_groupComm = make_shared<NcclComm>(Value().GetDeviceId(), mpi, rank / degree);
+    if (mpi->NumNodesInUse() > degree)
+        m_dataParallelComm = make_shared<NcclComm>(Value().GetDeviceId(), mpi, rank % degree);
+    if (!m_groupComm->IsSupported() || (m_dataParallelComm && !m_dataParallelComm->IsSupported()))
+        RuntimeError("%ls %ls operation: Tensor parallelism requires NCCL, with all workers on GPUs.", NodeName().c_str(), OperationName().c_str());
+}
+
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::ForwardPropNonLooping()
+{
+    if (Degree() == 1)
+    {
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, InputRef(0).Value(), false, InputRef(1).Value(), false, 0, Value());
+        return;
+    }
+
+    ExchangeInput(/*hasLocalData=*/true);
+    ComputeOutput(/*hasLocalData=*/true);
+}
+
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::ForwardPropWithoutLocalData()
+{
+    if (Degree() == 1)
+        return;
+
+    ExchangeInput(/*hasLocalData=*/false);
+    ComputeOutput(/*hasLocalData=*/false);
+}
+
+// Gathers the inputs of the workers of the group, each padded with zeros to the largest minibatch of the group. The
+// minibatch sizes are all-gathered over all workers by MPI.
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::ExchangeInput(bool hasLocalData)
+{
+    EnsureCommunicators();
+    auto mpi = MPIWrapper::GetInstance();
+    const size_t degree = Degree();
+    const size_t inputDim = InputDim();
+    const auto& input = InputRef(1).Value();
+    if (hasLocalData && input.GetMatrixType() != DENSE)
+        InvalidArgument("%ls %ls operation: The input (input 1) must be dense.", NodeName().c_str(), OperationName().c_str());
+
+    size_t numCols = hasLocalData ? input.GetNumCols() : 0;
+    std::vector<size_t> numColsOfAllWorkers(mpi->NumNodesInUse());
+    mpi->AllGather(&numCols, 1, numColsOfAllWorkers.data(), 1);
+    const size_t firstRankOfGroup = mpi->CurrentNodeRank() - ShardIndex();
+    m_numColsOfWorkers.assign(numColsOfAllWorkers.begin() + firstRankOfGroup, numColsOfAllWorkers.begin() + firstRankOfGroup + degree);
+    m_maxNumCols = *std::max_element(m_numColsOfWorkers.begin(), m_numColsOfWorkers.end());
+    m_outputGradientExchanged = false;
+    if (m_maxNumCols == 0)
+        return;
+
+    m_sendBuffer->Resize(inputDim, m_maxNumCols);
+    m_sendBuffer->SetValue(0);
+    if (numCols > 0)
+        m_sendBuffer->SetColumnSlice(input, 0, numCols);
+    m_receiveBuffer->Resize(inputDim, degree * m_maxNumCols);
+    m_groupComm->AllGather(m_sendBuffer->Data(), m_receiveBuffer->Data(), inputDim * m_maxNumCols);
+    m_groupComm->Sync();
+
+    if (m_shardOutput)
+        std::swap(m_groupInput, m_receiveBuffer);
+    else
+        m_groupInput->AssignRowSliceValuesOf(*m_receiveBuffer, ShardIndex() * (inputDim / degree), inputDim / degree);
+}
+
+// Each shard computes its part of the products of the group: output rows [M/P x P*maxNumCols], which are all-gathered,
+// resp. partial sums [M x P*maxNumCols], which are reduce-scattered by the column blocks of the workers.
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::ComputeOutput(bool hasLocalData)
+{
+    if (m_maxNumCols == 0)
+        return;
+
+    const size_t degree = Degree();
+    const size_t shard = ShardIndex();
+    const size_t numCols = m_numColsOfWorkers[shard];
+    Matrix<ElemType>::MultiplyAndWeightedAdd(1, InputRef(0).Value(), false, *m_groupInput, false, 0, *m_sendBuffer);
+    if (m_shardOutput)
+    {
+        const size_t shardDim = m_outputDim / degree;
+        m_receiveBuffer->Resize(shardDim, degree * degree * m_maxNumCols);
+        m_groupComm->AllGather(m_sendBuffer->Data(), m_receiveBuffer->Data(), m_sendBuffer->GetNumElements());
+        m_groupComm->Sync();
+        if (!hasLocalData)
+            return;
+        Value().Resize(m_outputDim, numCols);
+        for (size_t k = 0; k < degree; k++)
+            Value().AssignToRowSliceValuesOf(m_receiveBuffer->ColumnSlice((k * degree + shard) * m_maxNumCols, numCols), k * shardDim, shardDim);
+    }
+    else
+    {
+        m_receiveBuffer->Resize(m_outputDim, m_maxNumCols);
+        m_groupComm->ReduceScatter(m_sendBuffer->Data(), m_receiveBuffer->Data(), m_receiveBuffer->GetNumElements());
+        m_groupComm->Sync();
+        if (hasLocalData)
+            Value().SetValue(m_receiveBuffer->ColumnSlice(0, numCols));
+    }
+}
+
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::BackpropToNonLooping(size_t inputIndex)
+{
+    if (Degree() == 1)
+    {
+        auto& inputGradient = InputRef(inputIndex).Gradient();
+        ElemType beta = InputRef(inputIndex).IsGradientInitializedBy(this) ? 0 : 1;
+        if (inputIndex == 0)
+            Matrix<ElemType>::MultiplyAndWeightedAdd(1, Gradient(), false, InputRef(1).Value(), true, beta, inputGradient);
+        else
+            Matrix<ElemType>::MultiplyAndWeightedAdd(1, InputRef(0).Value(), true, Gradient(), false, beta, inputGradient);
+        return;
+    }
+
+    ExchangeOutputGradient(/*hasLocalData=*/true);
+    if (inputIndex == 0)
+        ComputeShardGradient(/*overwrite=*/InputRef(0).IsGradientInitializedBy(this));
+    else
+        ComputeInputGradient(/*hasLocalData=*/true);
+}
+
+// The shard gradient is overwritten, as a worker without data does not run the backprop that clears the gradients.
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::BackpropWithoutLocalData()
+{
+    if (Degree() == 1)
+        return;
+
+    ExchangeOutputGradient(/*hasLocalData=*/false);
+    if (InputRef(0).NeedsGradient())
+        ComputeShardGradient(/*overwrite=*/true);
+    if (InputRef(1).NeedsGradient())
+        ComputeInputGradient(/*hasLocalData=*/false);
+}
+
+// Gathers the output gradients of the group [M x P*maxNumCols], of which the row-sharded weight only needs its rows.
+// This happens once per backprop, for whichever input comes first.
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::ExchangeOutputGradient(bool hasLocalData)
+{
+    if (m_outputGradientExchanged || m_maxNumCols == 0)
+        return;
+    m_outputGradientExchanged = true;
+
+    const size_t degree = Degree();
+    const size_t numCols = hasLocalData ? m_numColsOfWorkers[ShardIndex()] : 0;
+    m_sendBuffer->Resize(m_outputDim, m_maxNumCols);
+    m_sendBuffer->SetValue(0);
+    if (numCols > 0)
+        m_sendBuffer->SetColumnSlice(Gradient(), 0, numCols);
+    m_receiveBuffer->Resize(m_outputDim, degree * m_maxNumCols);
+    m_groupComm->AllGather(m_sendBuffer->Data(), m_receiveBuffer->Data(), m_sendBuffer->GetNumElements());
+    m_groupComm->Sync();
+
+    if (m_shardOutput)
+        m_groupOutputGradient->AssignRowSliceValuesOf(*m_receiveBuffer, ShardIndex() * (m_outputDim / degree), m_outputDim / degree);
+    else
+        std::swap(m_groupOutputGradient, m_receiveBuffer);
+}
+
+// The gradient of the shard is the product of the output gradients of the group with its inputs, in the rows of the shard.
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::ComputeShardGradient(bool overwrite)
+{
+    auto& shardGradient = InputRef(0).Gradient();
+    if (m_maxNumCols == 0)
+    {
+        if (overwrite)
+        {
+            shardGradient.Resize(InputRef(0).Value());
+            shardGradient.SetValue(0);
+        }
+        return;
+    }
+    Matrix<ElemType>::MultiplyAndWeightedAdd(1, *m_groupOutputGradient, false, *m_groupInput, true, overwrite ? 0 : 1, shardGradient);
+}
+
+// The input gradient of the group is the sum of the partial products of the row shards, which are reduce-scattered,
+// resp. the rows of the column shards [K/P x P*maxNumCols], which are all-gathered.
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::ComputeInputGradient(bool hasLocalData)
+{
+    if (m_maxNumCols == 0)
+        return;
+
+    const size_t degree = Degree();
+    const size_t shard = ShardIndex();
+    const size_t numCols = m_numColsOfWorkers[shard];
+    const size_t inputDim = InputDim();
+    Matrix<ElemType>::MultiplyAndWeightedAdd(1, InputRef(0).Value(), true, *m_groupOutputGradient, false, 0, *m_sendBuffer);
+    if (m_shardOutput)
+    {
+        m_receiveBuffer->Resize(inputDim, m_maxNumCols);
+        m_groupComm->ReduceScatter(m_sendBuffer->Data(), m_receiveBuffer->Data(), m_receiveBuffer->GetNumElements());
+    }
+    else
+    {
+        m_receiveBuffer->Resize(inputDim / degree, degree * degree * m_maxNumCols);
+        m_groupComm->AllGather(m_sendBuffer->Data(), m_receiveBuffer->Data(), m_sendBuffer->GetNumElements());
+    }
+    m_groupComm->Sync();
+    if (!hasLocalData)
+        return;
+
+    auto& inputGradient = InputRef(1).Gradient();
+    bool overwrite = InputRef(1).IsGradientInitializedBy(this);
+    if (m_shardOutput)
+    {
+        if (overwrite)
+            inputGradient.SetValue(m_receiveBuffer->ColumnSlice(0, numCols));
+        else
+            inputGradient += m_receiveBuffer->ColumnSlice(0, numCols);
+    }
+    else
+    {
+        const size_t shardDim = inputDim / degree;
+        if (overwrite)
+            inputGradient.SetValue(0);
+        for (size_t k = 0; k < degree; k++)
+            inputGradient.AddToRowSliceValuesOf(m_receiveBuffer->ColumnSlice((k * degree + shard) * m_maxNumCols, numCols), k * shardDim, shardDim);
+    }
+}
+
+// The groups have different data, so the gradient of the shard is summed over the workers that hold the same shard.
+template <class ElemType>
+void TensorParallelTimesNode<ElemType>::AggregateShardGradient()
+{
+    if (!m_dataParallelComm)
+        return;
+
+    auto& shardGradient = InputRef(0).Gradient();
+    if (shardGradient.GetNumElements() == 0) // (no backprop yet on this worker, but the others may have one)
+    {
+        shardGradient.Resize(InputRef(0).Value());
+        shardGradient.SetValue(0);
+    }
+    m_dataParallelComm->AllReduce(shardGradient.Data(), shardGradient.Data(), shardGradient.GetNumElements());
+    m_dataParallelComm->Sync();
+}
+
+template class TensorParallelTimesNode<float>;
+template class TensorParallelTimesNode<double>;
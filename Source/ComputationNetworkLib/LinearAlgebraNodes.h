@@ -361,6 +361,321 @@ public:
 template class ElementTimesNode<float>;
 template class ElementTimesNode<double>;
 
+// -----------------------------------------------------------------------
+// FusedElementwiseNode (input1[, input2[, input3]])
+// Computes a chain of element-wise operations (as an ElementWiseProgram) in a single pass,
+// i.e. one kernel launch on GPU and one loop on CPU, without materializing the intermediate values.
+// This node is not meant to be created by users. It is created by ComputationNetwork::FuseElementwiseChains(),
+// which only fuses sub-graphs that need no gradient, so no backprop is implemented.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class FusedElementwiseNode : public ComputationNode<ElemType>, public IdentityTransformerNode
+{
+    typedef ComputationNode<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"FusedElementwise"; }
+
+public:
+    DeclareConstructorFromConfig(FusedElementwiseNode);
+    FusedElementwiseNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name)
+    {
+        m_program.numSteps = 0;
+    }
+
+    void SetProgram(const ElementWiseProgram& program) { m_program = program; }
+    const ElementWiseProgram& GetProgram() const { return m_program; }
+
+    virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
+    {
+        size_t rank = DetermineElementwiseTensorRank();
+        auto result = ValueTensorFor(rank, fr);
+        auto input0 = InputRef(0).ValueTensorFor(rank, fr.AllowBroadcast());
+        // unused inputs alias input 0; the program never reads their registers
+        auto input1 = InputRef(GetNumInputs() > 1 ? 1 : 0).ValueTensorFor(rank, fr.AllowBroadcast());
+        auto input2 = InputRef(GetNumInputs() > 2 ? 2 : 0).ValueTensorFor(rank, fr.AllowBroadcast());
+        result.DoElementWiseProgramOf(0, input0, input1, input2, 1, m_program);
+    }
+
+    virtual void /*ComputationNode::*/ BackpropTo(const size_t /*inputIndex*/, const FrameRange& /*fr*/) override
+    {
+        LogicError("%ls %ls operation does not support gradient computation. Element-wise chains that need a gradient must not be fused.", NodeName().c_str(), OperationName().c_str());
+    }
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
+
+    virtual void /*IComputationNode::*/ BeginForwardProp() override // called before first iteration step of ForwardProp()
+    {
+        Base::BeginForwardProp();
+        Value().SwitchToMatrixType(MatrixType::DENSE, MatrixFormat::matrixFormatDense, false);
+    }
+
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
+    {
+        if (GetNumInputs() < 1 || GetNumInputs() > ElementWiseProgram::MaxInputs)
+            InvalidArgument("%ls %ls operation requires between 1 and %d inputs.", NodeName().c_str(), OperationName().c_str(), (int)ElementWiseProgram::MaxInputs);
+        if (m_program.numSteps == 0 || m_program.numSteps > ElementWiseProgram::MaxSteps)
+            InvalidArgument("%ls %ls operation has an invalid element-wise program (%d steps).", NodeName().c_str(), OperationName().c_str(), (int)m_program.numSteps);
+        ValidateNaryZip(isFinalValidationPass, true /*allowBroadcast*/, GetNumInputs());
+    }
+
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
+    {
+        Base::CopyTo(nodeP, newName, flags);
+        if (flags & CopyNodeFlags::copyNodeValue)
+        {
+            auto node = dynamic_pointer_cast<FusedElementwiseNode<ElemType>>(nodeP);
+            node->m_program = m_program;
+        }
+    }
+
+    virtual void Save(File& fstream) const override
+    {
+        Base::Save(fstream);
+        fstream << (size_t)m_program.numSteps;
+        for (size_t i = 0; i < m_program.numSteps; i++)
+            fstream << (int)m_program.steps[i].op << (int)m_program.steps[i].arg0 << (int)m_program.steps[i].arg1;
+    }
+
+    virtual void Load(File& fstream, size_t modelVersion) override
+    {
+        Base::Load(fstream, modelVersion);
+        size_t numSteps;
+        fstream >> numSteps;
+        if (numSteps > ElementWiseProgram::MaxSteps)
+            RuntimeError("%ls %ls operation: Invalid number of steps (%d) in model file.", NodeName().c_str(), OperationName().c_str(), (int)numSteps);
+        m_program.numSteps = (unsigned char)numSteps;
+        for (size_t i = 0; i < numSteps; i++)
+        {
+            int op, arg0, arg1;
+            fstream >> op >> arg0 >> arg1;
+            m_program.steps[i].op   = (ElementWiseOperator)op;
+            m_program.steps[i].arg0 = (unsigned char)arg0;
+            m_program.steps[i].arg1 = (unsigned char)arg1;
+        }
+    }
+
+private:
+    ElementWiseProgram m_program;
+};
+
+template class FusedElementwiseNode<float>;
+template class FusedElementwiseNode<double>;
+
+// -----------------------------------------------------------------------
+// FusedCellNodeBase -- the element-wise combination of the gates of a recurrent cell in a few passes
+// The value is the sum of 'forward terms', and the gradient of each input the sum of 'gradient terms'. Each term is an
+// ElementWiseProgram over up to three tensors (input values, or the gradient of this node), i.e. one kernel launch on
+// GPU and one loop on CPU. The programs perform the operations of the unfused SigmoidNode, TanhNode, ElementTimesNode and
+// PlusNode forward and backward, in the same order and with the same opcodes, so the results are identical.
+// These nodes are not meant to be created by users. They are created by ComputationNetwork::FuseRecurrentCells().
+// Broadcasting is not supported: all inputs have the dimensions and the MBLayout of the output.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class FusedCellNodeBase : public ComputationNode<ElemType>
+{
+    typedef ComputationNode<ElemType> Base; UsingComputationNodeMembers;
+
+public:
+    FusedCellNodeBase(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name)
+    {
+    }
+
+    virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
+    {
+        size_t rank = DetermineElementwiseTensorRank();
+        auto result = ValueTensorFor(rank, fr);
+        for (size_t i = 0; i < m_forwardTerms.size(); i++)
+            RunTerm(i == 0 ? 0 : 1, result, m_forwardTerms[i], rank, fr);
+    }
+
+    virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
+    {
+        size_t rank = DetermineElementwiseTensorRank();
+        auto inputGradient = InputRef(inputIndex).GradientTensorFor(rank, fr);
+        // an input that is used twice is initialized by the first one
+        bool overwrite = Input(inputIndex)->IsGradientInitializedBy(this) &&
+                         find(m_inputs.begin(), m_inputs.end(), Input(inputIndex)) - m_inputs.begin() == (ptrdiff_t) inputIndex;
+        const auto& terms = m_gradientTerms[inputIndex];
+        for (size_t i = 0; i < terms.size(); i++)
+            RunTerm(overwrite && i == 0 ? 0 : 1, inputGradient, terms[i], rank, fr);
+    }
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return true; }
+    virtual ParentGradientOptimization ImplementsGradientOptimization(const ComputationNodeBase*) const override { return ParentGradientOptimization::Overwrite; }
+
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
+    {
+        Base::Validate(isFinalValidationPass);
+        InferMBLayoutFromInputsForStandardCase(isFinalValidationPass);
+        if (isFinalValidationPass)
+        {
+            for (size_t i = 1; i < GetNumInputs(); i++)
+            {
+                if (Input(i)->GetSampleLayout() != Input(0)->GetSampleLayout() || Input(i)->GetMBLayout() != Input(0)->GetMBLayout())
+                    InvalidArgument("%ls %ls operation requires all inputs to have the same dimensions and MBLayout, but input %d is [%s] while input 0 is [%s].",
+                                    NodeName().c_str(), OperationName().c_str(), (int) i,
+                                    string(Input(i)->GetSampleLayout()).c_str(), string(Input(0)->GetSampleLayout()).c_str());
+            }
+        }
+        SetDims(Input(0));
+    }
+
+protected:
+    static const int GradientArg = -1; // a term argument that is the gradient of this node
+
+    struct Term
+    {
+        ElementWiseProgram program;
+        int args[ElementWiseProgram::MaxInputs]; // for each input register: the index of the input whose value it holds, or GradientArg
+    };
+
+    // add the terms of the element-wise operations of the unfused nodes; x, y, etc. are input indices
+    // Registers 0..2 hold the arguments; step i writes register 3 + i.
+    void AddSigmoidTimesTanh(int x, int y) // Sigmoid(x) .* Tanh(y)
+    {
+        AddForwardTerm({ x, y }, { { opSigmoid, 0, 0 }, { opTanh, 1, 0 }, { opElementwiseProduct, 3, 4 } });
+        AddGradientTerm(x, { GradientArg, x, y }, { { opTanh, 2, 0 }, { opElementwiseProduct, 0, 3 }, { opSigmoid, 1, 0 }, { opElementwiseProductWithSigmoidDerivativeFromOutput, 4, 5 } });
+        AddGradientTerm(y, { GradientArg, x, y }, { { opSigmoid, 1, 0 }, { opElementwiseProduct, 0, 3 }, { opTanh, 2, 0 }, { opElementwiseProductWithTanhDerivativeFromOutput, 4, 5 } });
+    }
+    void AddSigmoidTimes(int x, int y) // Sigmoid(x) .* y
+    {
+        AddForwardTerm({ x, y }, { { opSigmoid, 0, 0 }, { opElementwiseProduct, 3, 1 } });
+        AddGradientTerm(x, { GradientArg, x, y }, { { opElementwiseProduct, 0, 2 }, { opSigmoid, 1, 0 }, { opElementwiseProductWithSigmoidDerivativeFromOutput, 3, 4 } });
+        AddGradientTerm(y, { GradientArg, x }, { { opSigmoid, 1, 0 }, { opElementwiseProduct, 0, 3 } });
+    }
+    void AddTimesTanh(int x, int y) // x .* Tanh(y)
+    {
+        AddForwardTerm({ x, y }, { { opTanh, 1, 0 }, { opElementwiseProduct, 0, 3 } });
+        AddGradientTerm(x, { GradientArg, y }, { { opTanh, 1, 0 }, { opElementwiseProduct, 0, 3 } });
+        AddGradientTerm(y, { GradientArg, x, y }, { { opElementwiseProduct, 0, 1 }, { opTanh, 2, 0 }, { opElementwiseProductWithTanhDerivativeFromOutput, 3, 4 } });
+    }
+    void AddTimes(int x, int y) // x .* y
+    {
+        AddForwardTerm({ x, y }, { { opElementwiseProduct, 0, 1 } });
+        AddGradientTerm(x, { GradientArg, y }, { { opElementwiseProduct, 0, 1 } });
+        AddGradientTerm(y, { GradientArg, x }, { { opElementwiseProduct, 0, 1 } });
+    }
+
+private:
+    static Term MakeTerm(std::initializer_list<int> args, std::initializer_list<ElementWiseProgram::Step> steps)
+    {
+        Term term;
+        size_t i = 0;
+        for (auto arg : args)
+            term.args[i++] = arg;
+        for (; i < ElementWiseProgram::MaxInputs; i++)
+            term.args[i] = *args.begin(); // (unused registers alias the first argument)
+        term.program.numSteps = 0;
+        for (const auto& step : steps)
+            term.program.steps[term.program.numSteps++] = step;
+        return term;
+    }
+    void AddForwardTerm(std::initializer_list<int> args, std::initializer_list<ElementWiseProgram::Step> steps)
+    {
+        m_forwardTerms.push_back(MakeTerm(args, steps));
+    }
+    void AddGradientTerm(int inputIndex, std::initializer_list<int> args, std::initializer_list<ElementWiseProgram::Step> steps)
+    {
+        if (m_gradientTerms.size() <= (size_t) inputIndex)
+            m_gradientTerms.resize(inputIndex + 1);
+        m_gradientTerms[inputIndex].push_back(MakeTerm(args, steps));
+    }
+
+    void RunTerm(ElemType beta, TensorView<ElemType>& target, const Term& term, size_t rank, const FrameRange& fr)
+    {
+        auto tensorFor = [&](int arg)
+        {
+            return arg == GradientArg ? GradientTensorFor(rank, fr) : InputRef(arg).ValueTensorFor(rank, fr);
+        };
+        target.DoElementWiseProgramOf(beta, tensorFor(term.args[0]), tensorFor(term.args[1]), tensorFor(term.args[2]), 1, term.program);
+    }
+
+    std::vector<Term> m_forwardTerms;
+    std::vector<std::vector<Term>> m_gradientTerms; // [inputIndex]
+};
+
+#define UsingFusedCellNodeBaseMembers UsingComputationNodeMembersBoilerplate; \
+    using Base::AddSigmoidTimesTanh; using Base::AddSigmoidTimes; using Base::AddTimesTanh; using Base::AddTimes
+
+// -----------------------------------------------------------------------
+// LSTMCellStateNode (inputGate, cellInput, forgetGate, prevState)
+// The cell state of an LSTM from the pre-activations of its gates:
+//   Sigmoid(inputGate) .* Tanh(cellInput) + Sigmoid(forgetGate) .* prevState
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class LSTMCellStateNode : public FusedCellNodeBase<ElemType>, public NumInputs<4>
+{
+    typedef FusedCellNodeBase<ElemType> Base; UsingFusedCellNodeBaseMembers;
+    static const std::wstring TypeName() { return L"LSTMCellState"; }
+
+public:
+    DeclareConstructorFromConfigWithNumInputs(LSTMCellStateNode);
+    LSTMCellStateNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name)
+    {
+        AddSigmoidTimesTanh(0, 1);
+        AddSigmoidTimes(2, 3);
+    }
+};
+
+template class LSTMCellStateNode<float>;
+template class LSTMCellStateNode<double>;
+
+// -----------------------------------------------------------------------
+// LSTMCellOutputNode (outputGate, state)
+// The output of an LSTM from the pre-activation of its output gate and the cell state:
+//   Sigmoid(outputGate) .* Tanh(state)
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class LSTMCellOutputNode : public FusedCellNodeBase<ElemType>, public NumInputs<2>
+{
+    typedef FusedCellNodeBase<ElemType> Base; UsingFusedCellNodeBaseMembers;
+    static const std::wstring TypeName() { return L"LSTMCellOutput"; }
+
+public:
+    DeclareConstructorFromConfigWithNumInputs(LSTMCellOutputNode);
+    LSTMCellOutputNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name)
+    {
+        AddSigmoidTimesTanh(0, 1);
+    }
+};
+
+template class LSTMCellOutputNode<float>;
+template class LSTMCellOutputNode<double>;
+
+// -----------------------------------------------------------------------
+// GRUCellOutputNode (candidateWeight, candidate, prevOutputWeight, prevOutput)
+// The output of a GRU from the (activated) weights of the candidate and of the previous output, e.g. 1 - z and z:
+//   candidateWeight .* Tanh(candidate) + prevOutputWeight .* prevOutput
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class GRUCellOutputNode : public FusedCellNodeBase<ElemType>, public NumInputs<4>
+{
+    typedef FusedCellNodeBase<ElemType> Base; UsingFusedCellNodeBaseMembers;
+    static const std::wstring TypeName() { return L"GRUCellOutput"; }
+
+public:
+    DeclareConstructorFromConfigWithNumInputs(GRUCellOutputNode);
+    GRUCellOutputNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name)
+    {
+        AddTimesTanh(0, 1);
+        AddTimes(2, 3);
+    }
+};
+
+template class GRUCellOutputNode<float>;
+template class GRUCellOutputNode<double>;
+
 // -----------------------------------------------------------------------
 // TimesNodeBase (A, B, outputRank=1)
 // shared code of TimesNode and TransposeTimesNode (which transposes A)
@@ -388,7 +703,8 @@ public:
 
 public:
     TimesNodeBase(DEVICEID_TYPE deviceId, const wstring& name, size_t outputRank = 1, int inferInputRankToMap = NoInferredInputRank)
-        : Base(deviceId, name), m_outputRank(outputRank), m_inferInputRankToMap(inferInputRankToMap), m_beingUnrolled(false)
+        : Base(deviceId, name), m_outputRank(outputRank), m_inferInputRankToMap(inferInputRankToMap), m_beingUnrolled(false),
+          m_sparseInput1ValueValid(false), m_input1Density(1), m_minibatchesUntilDensityCheck(0)
     {
     }
 
@@ -423,13 +739,21 @@ public:
             m_inferInputRankToMap = NoInferredInputRank;
     }
 
+    // 2 k operations per output element, for a left operand of m x k
+    virtual double ForwardPropFlopsEstimate() const override
+    {
+        size_t m = GetSampleLayout().GetNumElements();
+        size_t k = m > 0 ? InputRef(0).GetSampleLayout().GetNumElements() / m : 0;
+        return 2.0 * Base::ForwardPropFlopsEstimate() * (std::max)(k, (size_t)1);
+    }
+
 protected:
     // if the left argument of the matrix product (A) has a time axis, it can only be applied sample by sample
     // where each sample is treated as a separate matrix object (as a consequence, it then also applies to B and the result as well)
     TensorView<ElemType> OneSampleTensorFor(int inputIndex/*-1 for output*/, bool gradient/*instead of value*/, const FrameRange& fr)
     {
         auto input = inputIndex < 0 ? this : Input(inputIndex).get();
-        auto data = gradient ? input->GradientPtr() : input->ValuePtr();
+        auto& data = gradient ? input->GradientPtrRef() : input->ValuePtrRef();
         size_t rank = input->GetSampleLayout().GetRank();
         if (inputIndex == 0 && m_transpose && rank == 1) // transposing a 1D tensor implies it is really a 2D tensor. Note that m_transpose applies to left operand only.
             rank = 2;
@@ -472,6 +796,50 @@ private:
         return input0_ok && input1_ok && outputScalar && notBothSparse && (m_transpose || !hasSparse);
     }
 
+    // If A is minibatch data, then there is one product per sample. Instead of unrolling them, they can be done by
+    // a single batched GEMM if all operands are dense and A and B either have the layout of the output, or, for B only, none.
+    // Returns the dimensions of each product op(A_i)[m x k] * B_i[k x n], flattened the same way as TensorView::DoMatrixProductOf().
+    bool IsBatchedProduct(const FrameRange& fr, size_t& m, size_t& n, size_t& k) const
+    {
+        if (fr.seqIndex != SIZE_MAX || // individual sequences are not contiguous in the minibatch
+            InputRef(0).GetMBLayout() != GetMBLayout() ||
+            (InputRef(1).HasMBLayout() && InputRef(1).GetMBLayout() != GetMBLayout()) ||
+            InputRef(0).Value().GetMatrixType() != DENSE || InputRef(1).Value().GetMatrixType() != DENSE)
+            return false;
+
+        const auto& shapeA = InputRef(0).GetSampleLayout();
+        const auto& shapeB = InputRef(1).GetSampleLayout();
+        const auto& shapeC =             GetSampleLayout();
+        if (shapeA.GetRank() + shapeB.GetRank() < shapeC.GetRank())
+            return false;
+        size_t removedDims = shapeA.GetRank() + shapeB.GetRank() - shapeC.GetRank();
+        size_t numReducedDims = removedDims / 2;
+        if (numReducedDims * 2 != removedDims || numReducedDims > shapeA.GetRank())
+            return false;
+        size_t firstReducedDim = shapeA.GetRank() - numReducedDims;
+
+        size_t rowsA = 1;
+        for (size_t i = 0; i < firstReducedDim; i++)
+            rowsA *= shapeA[i];
+        if (rowsA == 0)
+            return false;
+        size_t colsA = shapeA.GetNumElements() / rowsA;
+        m = m_transpose ? colsA : rowsA;
+        k = m_transpose ? rowsA : colsA;
+        if (k == 0 || shapeB.GetNumElements() % k != 0)
+            return false;
+        n = shapeB.GetNumElements() / k;
+        return m * n == shapeC.GetNumElements();
+    }
+
+    // B without layout is a single sample that is used for all products; its matrix may not be a single column
+    Matrix<ElemType> BatchedProductInput1(const Matrix<ElemType>& input1) const
+    {
+        if (InputRef(1).HasMBLayout())
+            return input1.AsReference();
+        return input1.Reshaped(InputRef(1).GetSampleLayout().GetNumElements(), 1);
+    }
+
     void RequestReduceSequenceAxisMatricesIfNeeded(MatrixPool& matrixPool)
     {
         if (!ReduceSequenceAxis()) return;
@@ -622,6 +990,8 @@ private:
 public:
     virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
     {
+        m_sparseInput1ValueValid = false;
+
         // If argument A is minibatch data, then this must be performed frame-by-frame, sequence-by-sequence, one GEMM call each.
         // This will be inefficient. We hope this will be the baseline of a future, more efficient TensorView-based implementation.
         auto inputMBLayout = InputRef(0).GetMBLayout();
@@ -663,6 +1033,17 @@ public:
                 return;
             }
 
+            // all products at once
+            size_t m, n, k;
+            if (IsBatchedProduct(fr, m, n, k))
+            {
+                Matrix<ElemType> value  = ValueFor(fr);
+                Matrix<ElemType> input0 = InputRef(0).ValueFor(fr);
+                Matrix<ElemType> input1 = BatchedProductInput1(InputRef(1).ValueFor(fr));
+                Matrix<ElemType>::BatchedMultiplyAndWeightedAdd(1, input0, m_transpose, input1, false, 0, value, m, n, k);
+                return;
+            }
+
             // recursively call ourselves for each individual time and sequence
 
             // note this is not performant, warn user about the slow path being used
@@ -682,10 +1063,16 @@ public:
         // TensorView::DoMatrixProductOf() will reduce each tensor object into a 2D tensor (or fail if it cannot)
         // and recreate actual Matrix objects (in case of sparse, they must be identical to the original tensor storage object).
         // Transposition is applied after flattening into 2D, but only allowed if the input sample is 2D anyway.
+        if (UseSparseInput1(fr))
+        {
+            Matrix<ElemType> value = ValueFor(fr);
+            Matrix<ElemType>::MultiplyAndWeightedAdd(1, InputRef(0).Value(), false, *m_sparseInput1Value, false, 0, value);
+            return;
+        }
         auto input0 = OneSampleTensorFor(0,  /*gradient=*/false, fr.AllowBroadcast());
         auto input1 = OneSampleTensorFor(1,  /*gradient=*/false, fr.AllowBroadcast());
         auto output = OneSampleTensorFor(-1, /*gradient=*/false, fr);
-        output.AssignMatrixProductOf(false/*transC*/, input0, m_transpose/*transA*/, input1, false/*transB*/, 1.0f, this->m_pQuantizedMultiplier);
+        output.AssignMatrixProductOf(false/*transC*/, input0, m_transpose/*transA*/, input1, false/*transB*/, 1.0f, this->m_pQuantizedMultiplier, PackedInput0Cache());
     }
 
     virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
@@ -726,6 +1113,24 @@ public:
                 return;
             }
 
+            // all products at once, unless the gradient of B is a reduction over the batch
+            size_t m, n, k;
+            if (IsBatchedProduct(fr, m, n, k) && InputRef(inputIndex).HasMBLayout() && Gradient().GetMatrixType() == DENSE)
+            {
+                Matrix<ElemType> gradient      = GradientFor(fr);
+                Matrix<ElemType> inputGradient = InputRef(inputIndex).GradientFor(fr);
+                Matrix<ElemType> input0        = InputRef(0).ValueFor(fr);
+                Matrix<ElemType> input1        = BatchedProductInput1(InputRef(1).ValueFor(fr));
+                ElemType beta = Input(inputIndex)->IsGradientInitializedBy(this) ? (ElemType)0.0 : (ElemType)1.0;
+                if (inputIndex == 0 && !m_transpose) // dA_i[m x k] = dC_i * B_i'
+                    Matrix<ElemType>::BatchedMultiplyAndWeightedAdd(1, gradient, false, input1, true, beta, inputGradient, m, k, n);
+                else if (inputIndex == 0)            // dA_i[k x m] = B_i * dC_i'
+                    Matrix<ElemType>::BatchedMultiplyAndWeightedAdd(1, input1, false, gradient, true, beta, inputGradient, k, m, n);
+                else                                 // dB_i[k x n] = op(A_i)' * dC_i
+                    Matrix<ElemType>::BatchedMultiplyAndWeightedAdd(1, input0, !m_transpose, gradient, false, beta, inputGradient, k, n, m);
+                return;
+            }
+
             auto timeRange     = fr.GetTimeRange();
             auto sequenceRange = fr.GetSequenceRange();
             // when unroll, parent overwrite gradient should be ignored
@@ -788,6 +1193,15 @@ public:
                 InputRef(0).SetPreferredGradientMatrixType(DENSE);
             }
 
+            // dA = dC * B' from the sparse copy of B made by ForwardProp()
+            if (m_sparseInput1ValueValid && fr.IsAllFrames() && !m_beingUnrolled &&
+                InputRef(0).Gradient().GetMatrixType() == DENSE && Gradient().GetMatrixType() == DENSE)
+            {
+                Matrix<ElemType> gradient = GradientFor(fr);
+                Matrix<ElemType>::MultiplyAndWeightedAdd(1, gradient, false, *m_sparseInput1Value, true, overwriteInputGradient ? 0 : 1, InputRef(0).Gradient());
+                return;
+            }
+
             auto input0Gradient = OneSampleTensorFor(0,  /*gradient=*/true,  fr.AllowBroadcast());
             auto input1         = OneSampleTensorFor(1,  /*gradient=*/false, fr.AllowBroadcast());
             auto outputGradient = OneSampleTensorFor(-1, /*gradient=*/true,  fr);
@@ -1002,6 +1416,69 @@ protected:
     shared_ptr<QuantizedMultiplier<ElemType>> m_pQuantizedMultiplier;
 
 private:
+    // During inference on the CPU, weights of the product are reused across calls in their packed form.
+    // The cache is keyed by the time stamp of the LearnableParameter, which is bumped whenever its value is written.
+    shared_ptr<PackedGemmCache<ElemType>> PackedInput0Cache()
+    {
+        if (this->m_pQuantizedMultiplier || !Base::HasEnvironmentPtr() || !Base::Environment().IsInferring() ||
+            Value().GetDeviceId() != CPUDEVICE || InputRef(0).Value().GetMatrixType() != DENSE ||
+            !dynamic_pointer_cast<LearnableParameter<ElemType>>(Input(0)))
+        {
+            m_pPackedInput0.reset();
+            return nullptr;
+        }
+        if (!m_pPackedInput0)
+            m_pPackedInput0 = make_shared<PackedGemmCache<ElemType>>();
+        m_pPackedInput0->SetSourceTimeStamp(InputRef(0).GetEvalTimeStamp());
+        return m_pPackedInput0;
+    }
+
+    shared_ptr<PackedGemmCache<ElemType>> m_pPackedInput0;
+
+    // A dense minibatch input B of a product A * B with a parameter A is often mostly zeros (e.g. the output of a ReLU, or
+    // bag-of-words features that are not read as sparse). With Globals::GetSparseProductDensity() > 0, its density is
+    // measured on its device every DensityCheckInterval minibatches. While it is below that density, B is copied into a
+    // sparse (CSC) matrix, and the product and the gradient of A (dA = dC * B') are computed by the dense x sparse kernels.
+    // The copy is also used by BackpropTo(), hence it is the node's own rather than from the matrix pool.
+    bool UseSparseInput1(const FrameRange& fr)
+    {
+        const double density = Globals::GetSparseProductDensity();
+        if (density <= 0 || m_transpose || this->m_pQuantizedMultiplier || !fr.IsAllFrames() || m_beingUnrolled ||
+            InputRef(0).HasMBLayout() || !InputRef(1).HasMBLayout() || InputRef(1).GetMBLayout() != GetMBLayout())
+            return false;
+        const auto& input0 = InputRef(0).Value();
+        const auto& input1 = InputRef(1).Value();
+        if (input0.GetMatrixType() != DENSE || input1.GetMatrixType() != DENSE || input1.IsEmpty() ||
+            input0.GetNumCols() != input1.GetNumRows() || input0.GetNumRows() != Value().GetNumRows())
+            return false; // (not a plain 2D product, e.g. with an output rank > 1)
+
+        // gaps are set to 0 anyway before the gradient of A is computed, and this way they are not stored
+        if (GetMBLayout()->HasGaps())
+            Input(1)->MaskMissingValueColumnsToZero(fr);
+
+        if (m_minibatchesUntilDensityCheck == 0)
+        {
+            m_input1Density = (double)input1.MatrixNorm0() / input1.GetNumElements();
+            m_minibatchesUntilDensityCheck = DensityCheckInterval;
+        }
+        m_minibatchesUntilDensityCheck--;
+        if (m_input1Density >= density)
+            return false;
+
+        if (!m_sparseInput1Value)
+            m_sparseInput1Value = make_shared<Matrix<ElemType>>(input1.GetNumRows(), input1.GetNumCols(), input1.GetDeviceId(), SPARSE, matrixFormatSparseCSC);
+        m_sparseInput1Value->AssignValuesOf(input1);
+        m_sparseInput1ValueValid = true;
+        return true;
+    }
+
+    static const size_t DensityCheckInterval = 64;
+
+    shared_ptr<Matrix<ElemType>> m_sparseInput1Value;
+    bool m_sparseInput1ValueValid;    // m_sparseInput1Value holds the input of the last ForwardProp()
+    double m_input1Density;           // at the last check
+    size_t m_minibatchesUntilDensityCheck;
+
     size_t m_outputRank;
     int m_inferInputRankToMap;  // -1 (not specified) or says how to expand shape of W, to keep this many mapping dims
     bool m_beingUnrolled;
@@ -1082,7 +1559,9 @@ template class TransposeTimesNode<float>;
 template class TransposeTimesNode<double>;
 
 // Fixed-point matrix product. This scales inputs to 16bit signed integers by Symmetric quantizers, performs
-// integer multiplication using SSE/AVX2, and transforms the results back.
+// integer multiplication using SSE/AVX2/AVX-512, and transforms the results back.
+// The first input (usually the weights) is quantized per output channel, i.e. with a separate scale for each of its rows,
+// so rows with small weights keep their precision next to rows with large ones.
 // Only dense untransposed matrix multiplication will be quantized. If at least one matrix is sparse then it will fall back to un-quantized default evaluation
 // Currently it works for CPU only. On GPU logicError will be thrown.
 // One way to include this node to the network is with the Edit command:
@@ -1115,9 +1594,7 @@ public:
         if (deviceId != CPUDEVICE)
             LogicError("Quantized operation is supposed to be used on CPU device only.");
 
-        shared_ptr<SymmetricQuantizer<ElemType, short>> pQA(new SymmetricQuantizer<ElemType, short>(m_bitShiftA));
-        shared_ptr<SymmetricQuantizer<ElemType, short>> qQB(new SymmetricQuantizer<ElemType, short>(m_bitShiftB));
-        this->m_pQuantizedMultiplier = shared_ptr<QuantizedMultiplier<ElemType>>(new QuantizedMultiplier<ElemType>(pQA, qQB));
+        CreateQuantizedMultiplier();
     }
 
     QuantizedTimesNode(const ScriptableObjects::IConfigRecordPtr configp)
@@ -1134,6 +1611,7 @@ public:
             auto node = dynamic_pointer_cast<QuantizedTimesNode<ElemType>>(nodeP);
             node->m_bitShiftA = m_bitShiftA;
             node->m_bitShiftB = m_bitShiftB;
+            node->CreateQuantizedMultiplier();
         }
     }
 
@@ -1149,6 +1627,7 @@ public:
         Base::Load(fstream, modelVersion);
         fstream >> m_bitShiftA;
         fstream >> m_bitShiftB;
+        CreateQuantizedMultiplier();
     }
 
     virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
@@ -1166,6 +1645,16 @@ public:
         // This operation is intended only for inference
         NOT_IMPLEMENTED;
     }
+
+private:
+    // (Re-)creates the multiplier whenever the bit shifts change, so that a loaded or copied node
+    // quantizes with its own parameters rather than with the constructor defaults.
+    void CreateQuantizedMultiplier()
+    {
+        shared_ptr<PerChannelSymmetricQuantizer<ElemType, short>> pQA(new PerChannelSymmetricQuantizer<ElemType, short>(m_bitShiftA));
+        shared_ptr<SymmetricQuantizer<ElemType, short>> qQB(new SymmetricQuantizer<ElemType, short>(m_bitShiftB));
+        this->m_pQuantizedMultiplier = shared_ptr<QuantizedMultiplier<ElemType>>(new QuantizedMultiplier<ElemType>(pQA, qQB));
+    }
 };
 
 template class QuantizedTimesNode<float>;
@@ -1346,9 +1835,15 @@ public:
         size_t rank = DetermineElementwiseTensorRank();
         auto outputGradient =                                  GradientTensorFor(                         rank, fr);
         auto inputGradient  = TensorView<ElemType>(InputRef(0).GradientPtr(), GetTransposedTensorSliceFor(rank, fr));
-        inputGradient.AddCopyOf(outputGradient);
+        if (InputRef(0).IsGradientInitializedBy(this))
+            inputGradient.AssignCopyOf(outputGradient);
+        else
+            inputGradient.AddCopyOf(outputGradient);
     }
 
+    // the transposed view covers all of the input, so the gradient can be written instead of accumulated
+    virtual ParentGradientOptimization ImplementsGradientOptimization(const ComputationNodeBase*) const override { return ParentGradientOptimization::Overwrite; }
+
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
 
@@ -1625,116 +2120,21 @@ public:
     {
     }
 
+    // The norms, the shifted columns and the dot products are computed by a single Matrix function, which runs as fused kernels
+    // on the GPU, rather than by a sequence of matrix operations with (negNumber + 1) x n intermediates.
     virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
     {
+        if (inputIndex > 1)
+            return; // (shift and #neg are constants)
+
         Matrix<ElemType> sliceInput0Value = InputRef(0).ValueFor(fr);
         Matrix<ElemType> sliceInput1Value = InputRef(1).ValueFor(fr);
         Matrix<ElemType> sliceOutputValue = ValueFor(fr);
         Matrix<ElemType> sliceInputGrad = Input(inputIndex)->GradientFor(fr);
         Matrix<ElemType> sliceThisGrad = GradientFor(fr);
 
-        BackpropToS(inputIndex, *m_invNorm0, *m_invNorm1, sliceOutputValue, *m_temp, *m_rightTerm, *m_leftTerm, *m_invNormSquare, sliceInput0Value, sliceInput1Value, InputRef(2).Value(), InputRef(3).Value(), sliceInputGrad, sliceThisGrad);
-    }
-
-    // functionValues, invNorm0, invNorm1 - output from the EvaluateNode() method
-    // temp, rightTerm, leftTerm - temporary matrices
-    // in0, in1, in2, in3 - input functionValues from other nodes
-    // inputGradientValues(x) - gradients to update, where x matches inputIndex
-    /*TODO: merge with call site*/ void BackpropToS(const size_t inputIndex, const Matrix<ElemType>& invNorm0, const Matrix<ElemType>& invNorm1, const Matrix<ElemType>& functionValues,
-                                                    Matrix<ElemType>& temp, Matrix<ElemType>& rightTerm, Matrix<ElemType>& leftTerm, Matrix<ElemType>& invNormSquare, // the temporary variables
-                                                    const Matrix<ElemType>& in0, const Matrix<ElemType>& in1, const Matrix<ElemType>& in2, const Matrix<ElemType>& in3,
-                                                    Matrix<ElemType>& inputGradientValues, Matrix<ElemType>& thisGradientValues)
-    {
-        size_t shift = (size_t) in2.Get00Element();
-        size_t negNumber = (size_t) in3.Get00Element();
-        size_t numCols = in0.GetNumCols(); // used in computing right child's graident
-
-        if (inputIndex == 0) // left derivative
-        {
-            invNormSquare.AssignElementProductOf(invNorm0, invNorm0);
-
-            for (long m = 0; m < negNumber + 1; m++)
-            {
-                temp.GetARowByIndex(functionValues, m); // set this matrx to be the m-th row in functionValues
-                temp.ElementMultiplyWith(invNormSquare);
-
-                Matrix<ElemType>::ConductRowElementMultiplyWithShift(temp, in0, rightTerm, 0, true);
-
-                if (m == 0)
-                {
-                    temp.AssignElementProductOf(invNorm0, invNorm1);
-
-                    Matrix<ElemType>::ConductRowElementMultiplyWithShift(temp, in1, leftTerm, 0, true);
-                }
-                else
-                {
-                    size_t currshift = m + shift - 1; // for current line, how much should we shift
-
-                    temp.AssignElementProductOfWithShift(invNorm0, invNorm1, currshift); // this is a row vector
-
-                    Matrix<ElemType>::ConductRowElementMultiplyWithShift(temp, in1, leftTerm, currshift, true);
-                }
-
-                leftTerm -= rightTerm;
-
-                temp.GetARowByIndex(thisGradientValues, m);
-
-                Matrix<ElemType>::ConductRowElementMultiplyWithShift(temp, leftTerm, rightTerm, 0, true);
-
-                inputGradientValues += rightTerm;
-            }
-        }
-        else // right part
-        {
-            invNormSquare.AssignElementProductOf(invNorm1, invNorm1); // this matrix should be save and unchanged. It should not be changed
-
-            for (long m = 0; m < negNumber + 1; m++)
-            {
-                temp.GetARowByIndex(functionValues, m); // set this matrx to be the m-th row in functionValues
-
-                if (m == 0) // this is the first line. computation should be symmetric
-                {
-                    // the following is for the right part
-                    temp.ElementMultiplyWith(invNormSquare);
-
-                    Matrix<ElemType>::ConductRowElementMultiplyWithShift(temp, in1, rightTerm, 0, true);
-
-                    // the following is for the left part
-                    temp.AssignElementProductOf(invNorm0, invNorm1);
-
-                    Matrix<ElemType>::ConductRowElementMultiplyWithShift(temp, in0, leftTerm, 0, true);
-
-                    leftTerm -= rightTerm;
-
-                    temp.GetARowByIndex(thisGradientValues, m);
-
-                    Matrix<ElemType>::ConductRowElementMultiplyWithShift(temp, leftTerm, rightTerm, 0, true);
-
-                    inputGradientValues += rightTerm;
-                }
-                else // this requires shift
-                {
-                    size_t currshift = (m + shift - 1) % numCols;
-                    size_t reverseshift = numCols - currshift;
-
-                    leftTerm.AssignElementProductOfWithShift(invNormSquare, temp, reverseshift); // use leftTerm as a temp variable here
-
-                    Matrix<ElemType>::ConductRowElementMultiplyWithShift(leftTerm, in1, rightTerm, 0, true);
-
-                    temp.AssignElementProductOfWithShift(invNorm1, invNorm0, reverseshift);
-
-                    Matrix<ElemType>::ConductRowElementMultiplyWithShift(temp, in0, leftTerm, reverseshift, true);
-
-                    leftTerm -= rightTerm;
-
-                    temp.GetARowByIndex(thisGradientValues, m);
-
-                    Matrix<ElemType>::ConductRowElementMultiplyWithShift(temp, leftTerm, rightTerm, reverseshift, false);
-
-                    inputGradientValues += rightTerm;
-                }
-            }
-        }
+        Matrix<ElemType>::AddCosSimilarityWithNegativeSamplesGradient(inputIndex, sliceInput0Value, sliceInput1Value, *m_invNorm0, *m_invNorm1, sliceOutputValue, sliceThisGrad, sliceInputGrad,
+                                                                      GetShift(), GetNegNumber());
     }
 
     virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
@@ -1743,32 +2143,13 @@ public:
         Matrix<ElemType> sliceInput1Value = InputRef(1).ValueFor(fr);
         Matrix<ElemType> sliceOutputValue = ValueFor(fr);
 
-        ForwardPropS(*m_invNorm0, *m_invNorm1, sliceOutputValue, sliceInput0Value, sliceInput1Value, InputRef(2).Value(), InputRef(3).Value(), *m_leftTerm, *m_rightTerm);
+        // the result is a matrix of (negNumber + 1, n)
+        Matrix<ElemType>::CosSimilarityWithNegativeSamples(sliceInput0Value, sliceInput1Value, *m_invNorm0, *m_invNorm1, sliceOutputValue, GetShift(), GetNegNumber());
     }
 
-    /*TODO: merge with call site*/ void ForwardPropS(Matrix<ElemType>& invNorm0, Matrix<ElemType>& invNorm1, Matrix<ElemType>& functionValues, Matrix<ElemType>& in0, Matrix<ElemType>& in1, Matrix<ElemType>& in2, Matrix<ElemType>& in3, Matrix<ElemType>& leftTermTemp, Matrix<ElemType>& rightTermTemp)
-    {
-        invNorm0.AssignVectorNorm2Of(in0, true); // seems to modify input (in0)
-        invNorm0.AssignElementInverseOf(invNorm0);
-
-        invNorm1.AssignVectorNorm2Of(in1, true); // seems to modify the input (in1)
-        invNorm1.AssignElementInverseOf(invNorm1);
-
-        size_t shift = (size_t) in2.Get00Element();
-        size_t negNumber = (size_t) in3.Get00Element();
-
-        // mutiply invNorm0 and invNorm1 with shift and neg.
-        // The result is a matrix of (numberneg+1, invNorm0.Cols)
-        leftTermTemp.AssignElementProductOfWithShiftNeg(invNorm0, invNorm1, shift, negNumber);
-
-        // compute the right values
-        // Again, the output is a matrix of (negNumber+1, invNorm0.cols)
-        rightTermTemp.AssignInnerProductOfWithShiftNeg(in0, in1, true, shift, negNumber);
-
-        // compute the evaluation result matrix by multiply these two matrices, element by element
-        // we get a (negNumber+1, n) matrix
-        functionValues.AssignElementProductOf(leftTermTemp, rightTermTemp);
-    }
+    // input(2) is shift, input(3) is the #neg
+    size_t GetShift() const { return (size_t) InputRef(2).Value().Get00Element(); }
+    size_t GetNegNumber() const { return (size_t) InputRef(3).Value().Get00Element(); }
 
     virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
     {
@@ -1802,10 +2183,6 @@ public:
             auto node = dynamic_pointer_cast<CosDistanceWithNegativeSamplesNode<ElemType>>(nodeP);
             node->m_invNorm0->SetValue(*m_invNorm0);
             node->m_invNorm1->SetValue(*m_invNorm1);
-            node->m_invNormSquare->SetValue(*m_invNormSquare);
-            node->m_leftTerm->SetValue(*m_leftTerm);
-            node->m_rightTerm->SetValue(*m_rightTerm);
-            node->m_temp->SetValue(*m_temp);
         }
     }
     // request matrices needed to do node function value evaluation
@@ -1814,16 +2191,6 @@ public:
         Base::RequestMatricesBeforeForwardProp(matrixPool);
         RequestMatrixFromPool(m_invNorm0, matrixPool);
         RequestMatrixFromPool(m_invNorm1, matrixPool);
-        RequestMatrixFromPool(m_leftTerm, matrixPool);
-        RequestMatrixFromPool(m_rightTerm, matrixPool);
-    }
-
-    // request matrices that are needed for gradient computation
-    virtual void RequestMatricesBeforeBackprop(MatrixPool& matrixPool)
-    {
-        Base::RequestMatricesBeforeBackprop(matrixPool);
-        RequestMatrixFromPool(m_invNormSquare, matrixPool);
-        RequestMatrixFromPool(m_temp, matrixPool);
     }
 
     // release gradient and temp matrices that no longer needed after all the children's gradients are computed.
@@ -1832,21 +2199,12 @@ public:
         Base::ReleaseMatricesAfterBackprop(matrixPool);
         ReleaseMatrixToPool(m_invNorm0, matrixPool);
         ReleaseMatrixToPool(m_invNorm1, matrixPool);
-        ReleaseMatrixToPool(m_leftTerm, matrixPool);
-        ReleaseMatrixToPool(m_rightTerm, matrixPool);
-        ReleaseMatrixToPool(m_invNormSquare, matrixPool);
-        ReleaseMatrixToPool(m_temp, matrixPool);
     }
 
 private:
     // invNorm nodes tranfer data between ForwardProp and BackpropTo
     shared_ptr<Matrix<ElemType>> m_invNorm0;
     shared_ptr<Matrix<ElemType>> m_invNorm1;
-    shared_ptr<Matrix<ElemType>> m_leftTerm;
-    shared_ptr<Matrix<ElemType>> m_rightTerm;
-    // the rest are temporaries, values don't need to be maintained
-    shared_ptr<Matrix<ElemType>> m_invNormSquare;
-    shared_ptr<Matrix<ElemType>> m_temp;
 };
 
 template class CosDistanceWithNegativeSamplesNode<float>;
@@ -1930,4 +2288,141 @@ protected:
     size_t m_numSamples;
 };
 
+// -----------------------------------------------------------------------
+// ShardedEmbeddingNode (W, x) -- embedding of sparse input with a table that is partitioned across the workers
+// The table E [D x V] of an embedding Times(E, x) is split by columns (i.e. by the embedding vectors of the V input
+// classes) into N shards of ceil(V/N) columns, where N is the number of workers of a data-parallel MPI run. Each worker
+// only holds its own shard W as input 0 (declared with an inferred dimension, e.g. ParameterTensor {(D, 0)}), so that
+// tables that do not fit into the memory of one GPU can be trained.
+// Forward, all workers exchange their sparse input x [V x T] (CSC). Each worker multiplies its shard with the part of
+// all workers' inputs that falls into its columns, the partial products are summed over the workers, and each worker
+// keeps the columns of its own minibatch. Backward, the output gradients of all workers are exchanged, and the gradient
+// of the shard is returned as a sparse matrix in matrixFormatSparseBlockCol format, like TimesNode's for sparse input.
+// The shard gradients are complete on each worker, so SGD does not aggregate them; the shards are saved next to the
+// model (see ComputationNetwork::SaveShards()). Without MPI, or with a single worker, this is Times(W, x).
+// A worker that has no data in a minibatch must still take part in the exchanges, see IShardedNode.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class ShardedEmbeddingNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<2>, public IShardedNode
+{
+    typedef ComputationNodeNonLooping<ElemType> Base;
+    UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"ShardedEmbedding"; }
+
+public:
+    ShardedEmbeddingNode(DEVICEID_TYPE deviceId, const wstring& name);
+
+    ShardedEmbeddingNode(const ScriptableObjects::IConfigRecordPtr configp);
+
+    virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override;
+
+    virtual void BackpropToNonLooping(size_t inputIndex) override;
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+
+    // the gradient uses the exchanged input of all workers, which is kept in m_shardInput
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
+
+    virtual void Validate(bool isFinalValidationPass) override;
+
+    virtual void ForwardPropWithoutLocalData() override;
+    virtual void BackpropWithoutLocalData() override;
+
+    // the number of workers the table is partitioned across, and the one this worker holds
+    static size_t NumShards();
+    static size_t ShardIndex();
+
+private:
+    void ExchangeInput(const std::vector<CPUSPARSE_INDEX_TYPE>& colStarts, const std::vector<CPUSPARSE_INDEX_TYPE>& rowIndices, const std::vector<ElemType>& values);
+    void ComputeOutput(bool hasLocalData);
+    void ComputeShardGradient(bool hasLocalData);
+
+    size_t ShardSize() const { return (Input(1)->GetSampleLayout().GetNumElements() + NumShards() - 1) / NumShards(); }
+
+    std::vector<size_t> m_numColsOfWorkers;  // minibatch size of each worker in the last exchange
+    shared_ptr<Matrix<ElemType>> m_shardInput; // [ShardSize() x sum of m_numColsOfWorkers] the inputs of all workers in the columns of this shard
+    shared_ptr<Matrix<ElemType>> m_allColumns; // dense [D x sum of m_numColsOfWorkers], the partial outputs resp. the output gradients of all workers
+};
+
+class NcclComm;
+
+// -----------------------------------------------------------------------
+// TensorParallelTimesNode (W, x) -- Times(W, x) with a weight matrix that is partitioned across groups of workers
+// The weight E [M x K] of Times(E, x), with M = outputDim and K the dimension of x, is split into P shards, where P is
+// the tensorParallelDegree (0 for all workers). The workers form groups of P consecutive ranks, and the worker at
+// position p of its group holds shard p as input 0 (declared with inferred dimensions, e.g. ParameterTensor {(0, 0)}):
+//  - shardOutput=true:  rows p*M/P ... of E, [M/P x K], for output layers too wide for one GPU
+//  - shardOutput=false: columns p*K/P ... of E, [M x K/P]
+// Each worker has its own minibatch. Forward, the workers of a group all-gather their inputs; each multiplies its shard
+// with the inputs of the group, and the partial products are combined by an all-gather of the output rows resp. a
+// reduce-scatter of the partial sums, of which each worker keeps the columns of its own minibatch. Backward, the output
+// gradients are all-gathered, the shard gradient is complete for the data of the group, and the input gradient is
+// combined by a reduce-scatter resp. an all-gather. The groups are data-parallel replicas of each other: SGD aggregates
+// the other parameters over all workers as usual, and the shard gradients over the workers at the same position of all
+// groups (AggregateShardGradient()). The exchanges use NCCL, so all workers must run on GPUs. The shards are saved next
+// to the model (see ComputationNetwork::SaveShards()). Without MPI, or with a single worker, this is Times(W, x).
+// A worker that has no data in a minibatch must still take part in the exchanges, see IShardedNode.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class TensorParallelTimesNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<2>, public IShardedNode
+{
+    typedef ComputationNodeNonLooping<ElemType> Base;
+    UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"TensorParallelTimes"; }
+
+public:
+    TensorParallelTimesNode(DEVICEID_TYPE deviceId, const wstring& name, size_t outputDim = 0, size_t tensorParallelDegree = 0, bool shardOutput = true);
+
+    TensorParallelTimesNode(const ScriptableObjects::IConfigRecordPtr configp);
+
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override;
+    virtual void Save(File& fstream) const override;
+    virtual void Load(File& fstream, size_t modelVersion) override;
+
+    virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override;
+
+    virtual void BackpropToNonLooping(size_t inputIndex) override;
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+
+    // the gradients use the exchanged inputs of the group, which are kept in m_groupInput
+    virtual bool InputUsedInComputingInputNodesGradients(size_t childIndex) const override { return childIndex == 0 || Degree() == 1; }
+
+    virtual void Validate(bool isFinalValidationPass) override;
+
+    virtual void ForwardPropWithoutLocalData() override;
+    virtual void BackpropWithoutLocalData() override;
+    virtual void AggregateShardGradient() override;
+
+    // the number of shards P, and the position of this worker in its group, which is the shard it holds
+    size_t Degree() const;
+    size_t ShardIndex() const;
+
+private:
+    void EnsureCommunicators();
+    void ExchangeInput(bool hasLocalData);
+    void ComputeOutput(bool hasLocalData);
+    void ExchangeOutputGradient(bool hasLocalData);
+    void ComputeShardGradient(bool overwrite);
+    void ComputeInputGradient(bool hasLocalData);
+
+    size_t InputDim() const { return Input(1)->GetSampleLayout().GetNumElements(); }
+
+    size_t m_outputDim;
+    size_t m_tensorParallelDegree;
+    bool m_shardOutput;
+
+    shared_ptr<NcclComm> m_groupComm;        // the workers of this group
+    shared_ptr<NcclComm> m_dataParallelComm; // the workers at the same position of all groups, if there is more than one group
+    std::vector<size_t> m_numColsOfWorkers;  // minibatch size of each worker of the group in the last exchange
+    size_t m_maxNumCols;                     // the largest of them; the data of each worker is padded to it
+    bool m_outputGradientExchanged;          // whether the output gradients of the group have been exchanged in this backprop
+    shared_ptr<Matrix<ElemType>> m_groupInput;          // the inputs of the group [K x P*m_maxNumCols], or their rows of this shard [K/P x P*m_maxNumCols]
+    shared_ptr<Matrix<ElemType>> m_groupOutputGradient; // the output gradients of the group [M x P*m_maxNumCols], or their rows of this shard [M/P x P*m_maxNumCols]
+    shared_ptr<Matrix<ElemType>> m_sendBuffer;
+    shared_ptr<Matrix<ElemType>> m_receiveBuffer;
+};
+
 }}}
@@ -9,6 +9,7 @@
 #include <stdexcept>
 #include <vector>
 #include <set>
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -31,13 +32,29 @@ struct MemRequestInfo
     bool isWorkSpace;                           // workspace memory or not, by workspace we indicate whether a memory space will be released very shortly after allocation 
     int allocStep;                              // at what step counter memory allocation is requested 
     int releaseStep;                            // at what step counter memory release is requested  
+    std::vector<pair<int, int>> earlierOccupancy; // earlier [allocStep, releaseStep] ranges, if the matrix was requested again after its release
     int memoryId;                               // integer indexing the memory buffer ID 
+    size_t arenaOffset;                         // offset (in elements, resp. elements per sample if mbScale) assigned by the static memory planner
     MemRequestInfo(DEVICEID_TYPE deviceId, shared_ptr<Matrix<ElemType>>*pMatrixPtr, size_t matrixSize, bool mbScale, bool isWorkSpace, int allocStep)
-        :deviceId(deviceId), matrixSize(matrixSize), mbScale(mbScale), isWorkSpace(isWorkSpace), allocStep(allocStep), releaseStep(INT_MAX), memoryId(-1)
+        :deviceId(deviceId), matrixSize(matrixSize), mbScale(mbScale), isWorkSpace(isWorkSpace), allocStep(allocStep), releaseStep(INT_MAX), memoryId(-1), arenaOffset(SIZE_MAX)
     {
         pMatrixPtrs.push_back(pMatrixPtr);
     }
     void SetReleaseStep(int step) { releaseStep = step; }
+    // start another occupancy range, e.g. for a value that is recomputed during backprop
+    void SetReallocStep(int step)
+    {
+        earlierOccupancy.push_back(make_pair(allocStep, releaseStep));
+        allocStep = step;
+        releaseStep = INT_MAX;
+    }
+    bool IsReleased() const { return releaseStep != INT_MAX; }
+    std::vector<pair<int, int>> GetOccupancy() const
+    {
+        auto occ = earlierOccupancy;
+        occ.push_back(make_pair(allocStep, releaseStep));
+        return occ;
+    }
     void SetMemoryId(int id) { memoryId = id;  }
 };
 
@@ -61,6 +78,27 @@ struct MemAllocInfo
     }
 };
 
+// MemoryPlan -- per-device summary of the static memory plan computed by MatrixPool::OptimizedMemoryAllocation()
+// The planner packs all requests of a device into one arena (best-fit offset packing over the occupancy ranges),
+// so that the peak memory is known before the first minibatch. Sizes are split into a part that scales with the
+// minibatch size (in bytes per sample) and a part that does not. For comparison, the same numbers are given for the
+// buffer-sharing assignment that is actually used.
+struct MemoryPlan
+{
+    size_t numRequests;         // number of requests with a known size that participated in the plan
+    size_t numUnsizedRequests;  // number of requests of unknown size (matrixSize = 0); these are not accounted for
+    size_t perSampleBytes;      // arena size of requests that scale with the minibatch size, per sample
+    size_t fixedBytes;          // arena size of requests that do not scale with the minibatch size
+    size_t sharedPerSampleBytes; // same for the buffer-sharing assignment
+    size_t sharedFixedBytes;
+    MemoryPlan()
+        : numRequests(0), numUnsizedRequests(0), perSampleBytes(0), fixedBytes(0), sharedPerSampleBytes(0), sharedFixedBytes(0)
+    {
+    }
+    size_t PeakBytes(size_t mbSize) const { return perSampleBytes * mbSize + fixedBytes; }
+    size_t SharedPeakBytes(size_t mbSize) const { return sharedPerSampleBytes * mbSize + sharedFixedBytes; }
+};
+
 // MatrixPool -- class to support memory sharing
 // Despite the gather general name of this class, it is specifically designed to support the memory sharing of ComputationNodes.
 // Note: see #define SUPRESS_MEMSHARING below as for how to temporarily disable memory sharing altogether, for debugging
@@ -72,7 +110,9 @@ public:
 protected:
     vector<MemRequestInfo<float>> m_memRequestInfoFloatVec; 
     vector<MemRequestInfo<double>> m_memRequestInfoDoubleVec;
+    vector<MemRequestInfo<half>> m_memRequestInfoHalfVec;
     set<DEVICEID_TYPE> m_deviceIDSet; 
+    map<DEVICEID_TYPE, MemoryPlan> m_memoryPlans;
     int m_stepCounter; 
 
     template <class ElemType>
@@ -133,6 +173,20 @@ public:
     // global memory allocation optimziation is run to improve memory efficiency 
     // mbScale is another flag indicating if the size of the memory will scale w.r.t. the minibatch size. Unfortunately, at the time of memory
     // request and pointer assignment, we don't known the minibatch size. Thus our memory sharing algorithm is sub-optimal. 
+    // A matrix that is requested again after its release (e.g. to recompute a node value during backprop, see
+    // ComputationNodeBase::SetValueRecomputedInBackprop()) keeps its memory assignment but gets another occupancy range,
+    // so that the memory can be used by others in between.
+    template <class ElemType>
+    void RequestReallocate(shared_ptr<Matrix<ElemType>> *pMatrixPtr)
+    {
+        auto memInfo = GetMemInfo(pMatrixPtr);
+        if (memInfo != nullptr && memInfo->IsReleased())
+        {
+            memInfo->SetReallocStep(m_stepCounter);
+            m_stepCounter++;
+        }
+    }
+
     template <class ElemType>
     void RequestAllocate(DEVICEID_TYPE deviceId, shared_ptr<Matrix<ElemType>>*pMatrixPtr, size_t matrixSize, bool mbScale, bool isWorkSpace)
     {
@@ -148,12 +202,21 @@ public:
 
     void OptimizedMemoryAllocation()
     {
-        // MatrixPool is not templated, so we call both float and double versions here 
+        // MatrixPool is not templated, so we call the float, double and half versions here 
+        m_memoryPlans.clear();
         OptimizedMemoryAllocationFunc<float>(); 
         OptimizedMemoryAllocationFunc<double>();
+        OptimizedMemoryAllocationFunc<half>();
         return; 
     }
 
+    // static memory plan per device, valid after OptimizedMemoryAllocation()
+    const map<DEVICEID_TYPE, MemoryPlan>& GetMemoryPlans() const { return m_memoryPlans; }
+
+    // the requests of dense matrices, valid after OptimizedMemoryAllocation(), e.g. to break the plan down by what the matrices hold
+    template <class ElemType>
+    const vector<MemRequestInfo<ElemType>>& GetMemRequests() const { return const_cast<MatrixPool*>(this)->GetMemRequestInfoVec<ElemType>(); }
+
     void SetAliasInfo(
         const unordered_map<AliasNodePtr, unordered_set<AliasNodePtr>>& groupMap,
         const unordered_map<AliasNodePtr, AliasNodePtr>& rootLookupMap)
@@ -245,6 +308,125 @@ private:
         return bRet;
     }
 
+    bool CheckOverlap(const vector<pair<int, int>>& occs, vector<pair<int, int>>& occVec)
+    {
+        for (auto& occ : occs)
+        {
+            if (CheckOverlap(occ, occVec))
+                return true;
+        }
+        return false;
+    }
+
+    static bool Overlaps(const vector<pair<int, int>>& occs1, const vector<pair<int, int>>& occs2)
+    {
+        for (auto& a : occs1)
+        {
+            for (auto& b : occs2)
+            {
+                if (a.first <= b.second && a.second >= b.first)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    // static memory planner: assign each request of one device an offset into a single arena such that no two requests
+    // whose occupancy ranges overlap share any memory. Requests are placed from largest to smallest, each into the
+    // smallest gap among the already placed, time-overlapping requests that can hold it (best fit), or on top of them.
+    // The order is fully determined by (size, allocStep), so the resulting arena size is reproducible.
+    // Requests that scale with the minibatch size and those that don't are packed separately, since their sizes are in
+    // different units. Returns the arena size in elements (resp. elements per sample).
+    template <class ElemType>
+    static size_t PlanArena(vector<MemRequestInfo<ElemType>*>& requests)
+    {
+        std::sort(requests.begin(), requests.end(), [](const MemRequestInfo<ElemType>* a, const MemRequestInfo<ElemType>* b)
+        {
+            return a->matrixSize != b->matrixSize ? a->matrixSize > b->matrixSize : a->allocStep < b->allocStep;
+        });
+
+        size_t arenaSize = 0;
+        vector<const MemRequestInfo<ElemType>*> placed;
+        vector<pair<size_t, size_t>> live; // [begin, end) of placed requests overlapping the current one, sorted by begin
+        for (auto memInfo : requests)
+        {
+            const auto occ = memInfo->GetOccupancy();
+            live.clear();
+            for (auto other : placed)
+            {
+                if (Overlaps(occ, other->GetOccupancy()))
+                    live.push_back(make_pair(other->arenaOffset, other->arenaOffset + other->matrixSize));
+            }
+            std::sort(live.begin(), live.end());
+
+            size_t bestOffset = SIZE_MAX;
+            size_t bestGap = SIZE_MAX;
+            size_t end = 0; // end of the occupied region scanned so far
+            for (const auto& range : live)
+            {
+                if (range.first > end)
+                {
+                    size_t gap = range.first - end;
+                    if (gap >= memInfo->matrixSize && gap < bestGap)
+                    {
+                        bestGap = gap;
+                        bestOffset = end;
+                    }
+                }
+                end = max(end, range.second);
+            }
+            memInfo->arenaOffset = (bestOffset != SIZE_MAX) ? bestOffset : end;
+            arenaSize = max(arenaSize, memInfo->arenaOffset + memInfo->matrixSize);
+            placed.push_back(memInfo);
+        }
+        return arenaSize;
+    }
+
+    template <class ElemType>
+    void PlanStaticMemoryFunc(vector<MemRequestInfo<ElemType>>& memInfoVec)
+    {
+        for (auto& devId : m_deviceIDSet)
+        {
+            auto& plan = m_memoryPlans[devId];
+            vector<MemRequestInfo<ElemType>*> perSampleRequests, fixedRequests;
+            for (auto& memInfo : memInfoVec)
+            {
+                if (memInfo.deviceId != devId)
+                    continue;
+                if (memInfo.matrixSize == 0)
+                    plan.numUnsizedRequests++;
+                else
+                    (memInfo.mbScale ? perSampleRequests : fixedRequests).push_back(&memInfo);
+            }
+            plan.numRequests += perSampleRequests.size() + fixedRequests.size();
+            plan.perSampleBytes += PlanArena(perSampleRequests) * sizeof(ElemType);
+            plan.fixedBytes += PlanArena(fixedRequests) * sizeof(ElemType);
+        }
+    }
+
+    // account the buffers of the buffer-sharing assignment in the plan, for comparison
+    // A buffer is counted per sample if any of its users scales with the minibatch size (as it will eventually be resized to that).
+    template <class ElemType>
+    void AccountSharedBuffers(const vector<MemRequestInfo<ElemType>>& memInfoVec, DEVICEID_TYPE devId, bool wsFlag, int numBuffers)
+    {
+        vector<size_t> perSampleSize(numBuffers, 0), fixedSize(numBuffers, 0);
+        for (auto& memInfo : memInfoVec)
+        {
+            if (memInfo.deviceId != devId || memInfo.isWorkSpace != wsFlag || memInfo.memoryId < 0)
+                continue;
+            auto& size = memInfo.mbScale ? perSampleSize[memInfo.memoryId] : fixedSize[memInfo.memoryId];
+            size = max(size, memInfo.matrixSize);
+        }
+        auto& plan = m_memoryPlans[devId];
+        for (int i = 0; i < numBuffers; i++)
+        {
+            if (perSampleSize[i] > 0)
+                plan.sharedPerSampleBytes += perSampleSize[i] * sizeof(ElemType);
+            else
+                plan.sharedFixedBytes += fixedSize[i] * sizeof(ElemType);
+        }
+    }
+
     template <class ElemType>
     void OptimizedMemoryAllocationFunc()
     {
@@ -266,11 +448,14 @@ private:
             }
 
             if (hasSparse)
-                memInfoVec.erase(iter);
+                iter = memInfoVec.erase(iter);
             else
                 iter++; 
         }
 
+        // compute the static memory plan; this does not depend on the buffer-sharing assignment below
+        PlanStaticMemoryFunc(memInfoVec);
+
         // sort the memory request from largest size to smallest 
         std::sort(memInfoVec.begin(), memInfoVec.end(), greater_than_mem_req_size<ElemType>());
 
@@ -294,14 +479,12 @@ private:
                         // since we assign from highest memory to lowest, every memory that has been allocated can accommodate the 
                         // current memory request, unless there is a conflict (overlap) 
                         auto iter = memAllocInfoVec.begin();
-                        while (iter != memAllocInfoVec.end() && CheckOverlap(make_pair(memInfo.allocStep, memInfo.releaseStep), iter->occupancy))
+                        while (iter != memAllocInfoVec.end() && CheckOverlap(memInfo.GetOccupancy(), iter->occupancy))
                             iter++;
                         if (iter == memAllocInfoVec.end())
                         {
                             // no current memory can be assigned, need to create a new one 
-                            vector<pair<int, int>> occ;
-                            occ.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
-                            MemAllocInfo ma(memoryCounter, memInfo.matrixSize, occ);
+                            MemAllocInfo ma(memoryCounter, memInfo.matrixSize, memInfo.GetOccupancy());
                             // insert in the front of the vector to maintain sorted order 
                             memAllocInfoVec.insert(memAllocInfoVec.begin(), ma);
                             memInfo.SetMemoryId(memoryCounter);
@@ -309,15 +492,14 @@ private:
                         }
                         else
                         {
-                            iter->occupancy.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
+                            auto occ = memInfo.GetOccupancy();
+                            iter->occupancy.insert(iter->occupancy.end(), occ.begin(), occ.end());
                             memInfo.SetMemoryId(iter->memoryId);
                         }
                     }
                     else
                     {
-                        vector<pair<int, int>> occ;
-                        occ.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
-                        MemAllocInfo ma(memoryCounter, memInfo.matrixSize, occ);
+                        MemAllocInfo ma(memoryCounter, memInfo.matrixSize, memInfo.GetOccupancy());
                         memAllocInfoVec.push_back(ma);
                         memInfo.SetMemoryId(memoryCounter);
                         memoryCounter++;
@@ -337,35 +519,34 @@ private:
                         auto workingAlloc = memAllocInfoVec.end();
                         for (auto iter = memAllocInfoVec.begin(); iter != memAllocInfoVec.end(); iter++)
                         {
-                            if (!CheckOverlap(make_pair(memInfo.allocStep, memInfo.releaseStep), iter->occupancy))
+                            if (!CheckOverlap(memInfo.GetOccupancy(), iter->occupancy))
                                 workingAlloc = iter;
                         }
                         if (workingAlloc == memAllocInfoVec.end())  // nothing works 
                         {
-                            vector<pair<int, int>> occ;
-                            occ.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
-                            MemAllocInfo ma(memoryCounter, memInfo.matrixSize, occ);
+                            MemAllocInfo ma(memoryCounter, memInfo.matrixSize, memInfo.GetOccupancy());
                             memAllocInfoVec.push_back(ma);  // add as the last one 
                             memInfo.SetMemoryId(memoryCounter);
                             memoryCounter++;
                         }
                         else
                         {
-                            workingAlloc->occupancy.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
+                            auto occ = memInfo.GetOccupancy();
+                            workingAlloc->occupancy.insert(workingAlloc->occupancy.end(), occ.begin(), occ.end());
                             memInfo.SetMemoryId(workingAlloc->memoryId);
                         }
                     }
                     else
                     {
-                        vector<pair<int, int>> occ;
-                        occ.push_back(make_pair(memInfo.allocStep, memInfo.releaseStep));
-                        MemAllocInfo ma(memoryCounter, memInfo.matrixSize, occ);
+                        MemAllocInfo ma(memoryCounter, memInfo.matrixSize, memInfo.GetOccupancy());
                         memAllocInfoVec.push_back(ma);
                         memInfo.SetMemoryId(memoryCounter);
                         memoryCounter++;
                     }
                 }
 
+                AccountSharedBuffers(memInfoVec, devId, wsFlag, memoryCounter);
+
                 // now assign the actual pointers 
                 for (int i = 0; i < memoryCounter; i++)
                 {
@@ -284,9 +284,14 @@ public:
         gradient.AssignInnerProductOf(gradientValues, functionValues, true);
         diff.AssignDifferenceOf(gradientValues, gradient);
 
-        inputGradientValues.AddElementProductOf(diff, functionValues);
+        if (InputRef(0).IsGradientInitializedBy(this))
+            inputGradientValues.AssignElementProductOf(diff, functionValues);
+        else
+            inputGradientValues.AddElementProductOf(diff, functionValues);
     }
 
+    virtual ParentGradientOptimization ImplementsGradientOptimization(const ComputationNodeBase*) const override { return ParentGradientOptimization::Overwrite; }
+
     /*virtual*/ void ForwardPropV(Matrix<ElemType>& functionValues, const Matrix<ElemType>& inputFunctionValues) override
     {
         functionValues.AssignLogSoftmaxOf(inputFunctionValues, true);
@@ -352,9 +357,14 @@ public:
         softmax.AssignExpOf(functionValues);
         Matrix<ElemType>::VectorSum(gradientValues, gradient, true);
         softmax.RowElementMultiplyWith(gradient);
-        Matrix<ElemType>::AddScaledDifference(1.0, gradientValues, softmax, inputGradientValues);
+        if (InputRef(0).IsGradientInitializedBy(this))
+            inputGradientValues.AssignDifferenceOf(gradientValues, softmax);
+        else
+            Matrix<ElemType>::AddScaledDifference(1.0, gradientValues, softmax, inputGradientValues);
     }
 
+    virtual ParentGradientOptimization ImplementsGradientOptimization(const ComputationNodeBase*) const override { return ParentGradientOptimization::Overwrite; }
+
     /*virtual*/ void ForwardPropV(Matrix<ElemType>& functionValues, const Matrix<ElemType>& inputFunctionValues) override
     {
         functionValues.AssignLogSoftmaxOf(inputFunctionValues, true);
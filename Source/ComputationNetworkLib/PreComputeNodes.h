@@ -10,6 +10,7 @@
 #include "LinearAlgebraNodes.h"
 #include "Matrix.h"
 
+#include <functional>
 #include <iostream>
 #include <list>
 #include <map>
@@ -58,7 +59,7 @@ public:
     {
         Base::Save(fstream);
         fstream << m_hasComputed;
-        fstream << Value();
+        fstream << ValueToSave();
     }
 
     virtual void Load(File& fstream, size_t modelVersion) override
@@ -190,6 +191,12 @@ public:
         }
     }
 
+    // the accumulators, for merging those of data-parallel workers before MarkComputed(true), see AggregatePreComputedStatistics()
+    size_t GetNumAccumulatedSamples() const { return m_numSamples; }
+    void SetNumAccumulatedSamples(size_t numSamples) { m_numSamples = numSamples; }
+    virtual Matrix<ElemType>& AccumulatedMean() = 0;
+    virtual Matrix<ElemType>* AccumulatedVariance() { return nullptr; } // (biased) variance, if accumulated
+
 protected:
     size_t m_numSamples; // (SIZE_MAX while outside accumulation state)
     bool IsAccumulating() const { return m_numSamples != SIZE_MAX; }
@@ -248,6 +255,8 @@ public:
 
         UpdateRunningAverage(InputRef(0), mean, m_numSamples);
     }
+
+    virtual Matrix<ElemType>& AccumulatedMean() override { return Value(); }
 };
 
 template class MeanNode<float>;
@@ -354,6 +363,9 @@ public:
         }
     }
 
+    virtual Matrix<ElemType>& AccumulatedMean() override { return *m_mean; }
+    virtual Matrix<ElemType>* AccumulatedVariance() override { return m_var.get(); }
+
 private:
     shared_ptr<Matrix<ElemType>> m_mean;
     shared_ptr<Matrix<ElemType>> m_var;
@@ -363,6 +375,98 @@ private:
 template class InvStdDevNode<float>;
 template class InvStdDevNode<double>;
 
+// -----------------------------------------------------------------------
+// AggregatePreComputedStatistics() -- merges the accumulators of the Mean and InvStdDev nodes of data-parallel workers
+// that each precomputed over a part of the data, before MarkComputed(true). 'allReduce' sums a vector over the workers.
+// The merge is the parallel one of Chan et al.: the variance of the union is the sample-weighted mean of the variances
+// of the parts plus that of the squared deviations of their means from the overall mean, so a second reduction follows
+// the one that forms the overall mean. The sums are formed in double precision.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+void AggregatePreComputedStatistics(const std::list<ComputationNodeBasePtr>& preComputeNodes, const std::function<void(std::vector<double>&)>& allReduce)
+{
+    std::vector<MeanInvStdDevNodeBase<ElemType>*> nodes;
+    for (const auto& preComputeNode : preComputeNodes)
+    {
+        auto node = dynamic_cast<MeanInvStdDevNodeBase<ElemType>*>(preComputeNode.get());
+        if (!node)
+            LogicError("AggregatePreComputedStatistics: %ls %ls operation cannot be aggregated across workers.", preComputeNode->NodeName().c_str(), preComputeNode->OperationName().c_str());
+        nodes.push_back(node);
+    }
+
+    const auto copyToHost = [](const Matrix<ElemType>& m, std::vector<ElemType>& values)
+    {
+        values.resize(m.GetNumElements());
+        ElemType* data = values.data();
+        size_t capacity = values.size();
+        if (!values.empty())
+            m.CopyToArray(data, capacity);
+    };
+    const auto setFromHost = [](Matrix<ElemType>& m, std::vector<ElemType>& values)
+    {
+        if (!values.empty())
+            m.SetValue(m.GetNumRows(), m.GetNumCols(), m.GetDeviceId(), values.data());
+    };
+
+    // the sample counts, and the sums of the samples
+    std::vector<std::vector<ElemType>> localMeans(nodes.size());
+    std::vector<double> sums(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        sums[i] = (double)nodes[i]->GetNumAccumulatedSamples();
+        copyToHost(nodes[i]->AccumulatedMean(), localMeans[i]);
+        for (const auto& mean : localMeans[i])
+            sums.push_back(sums[i] * mean);
+    }
+    std::vector<double> localNumSamples(sums.begin(), sums.begin() + nodes.size());
+    allReduce(sums);
+
+    // the means, and the sums of the squared deviations from them
+    std::vector<ElemType> values;
+    std::vector<double> deviations;
+    for (size_t i = 0, k = nodes.size(); i < nodes.size(); i++)
+    {
+        const double numSamples = sums[i];
+        values.resize(localMeans[i].size());
+        for (auto& mean : values)
+        {
+            const double sum = sums[k++];
+            mean = (ElemType)(numSamples > 0 ? sum / numSamples : 0);
+        }
+        if (auto variance = nodes[i]->AccumulatedVariance())
+        {
+            std::vector<ElemType> localVariance;
+            copyToHost(*variance, localVariance);
+            for (size_t j = 0; j < localVariance.size(); j++)
+            {
+                const double deviation = (double)localMeans[i][j] - values[j];
+                deviations.push_back(localNumSamples[i] * (localVariance[j] + deviation * deviation));
+            }
+        }
+        setFromHost(nodes[i]->AccumulatedMean(), values);
+        nodes[i]->SetNumAccumulatedSamples((size_t)numSamples);
+    }
+    if (deviations.empty())
+        return;
+    allReduce(deviations);
+
+    for (size_t i = 0, k = 0; i < nodes.size(); i++)
+    {
+        if (auto variance = nodes[i]->AccumulatedVariance())
+        {
+            const double numSamples = sums[i];
+            values.resize(variance->GetNumElements());
+            for (auto& v : values)
+            {
+                const double sum = deviations[k++];
+                v = (ElemType)(numSamples > 0 ? sum / numSamples : 0);
+            }
+            setFromHost(*variance, values);
+        }
+    }
+}
+
 // -----------------------------------------------------------------------
 // PerDimMeanVarDeNormalizationNode (feature, mean, invStdDev)
 // Computes
@@ -8,6 +8,7 @@
 #include "Matrix.h"
 #include "TensorView.h"
 #include "RNNNodes.h"
+#include "PerformanceProfiler.h"
 
 #include <unordered_set>
 #include <map>
@@ -22,7 +23,6 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
-vector<size_t> numSequencesForFrame;
 // -----------------------------------------------------------------------
 // OptimizedRNNStackNode
 // -----------------------------------------------------------------------
@@ -103,6 +103,10 @@ void OptimizedRNNStackNode<ElemType>::ForwardProp(const FrameRange& fr)
     // The parameters are stored in a column matrix
     Matrix<ElemType>& paramW = InputRef(0).Value();
 
+    // Without a backward pass, cuDNN runs the inference algorithms, which need no reserve space and may use the
+    // persistent kernels for small minibatches. BackpropTo() is not called for nodes that do not need a gradient.
+    bool inferenceOnly = !NeedsGradient() || (HasEnvironmentPtr() && !Environment().IsTraining());
+
     MBLayoutPtr mb = GetMBLayout();
     if (m_rnnAttributes.IsSpatialRecurrence())
     {
@@ -130,8 +134,8 @@ void OptimizedRNNStackNode<ElemType>::ForwardProp(const FrameRange& fr)
         shapeYT = TensorShape(shapeYT.GetDims());
 
         // create a vector with the correct number of timesteps(shapeXT[2]) containing the sequence count (shapeXT[1])
-        numSequencesForFrame = vector<size_t>(shapeXT[2], shapeXT[1]);
-        m_transposedOutput->RNNForward(*m_transposedInput, paramW, shapeXT[0], shapeYT[0], numSequencesForFrame, m_rnnAttributes, *m_reserve, *m_workspace);
+        m_numSequencesForFrame = vector<size_t>(shapeXT[2], shapeXT[1]);
+        m_transposedOutput->RNNForward(*m_transposedInput, paramW, shapeXT[0], shapeYT[0], m_numSequencesForFrame, m_rnnAttributes, *m_reserve, *m_workspace, inferenceOnly);
 
         // No one uses shapeY, but it is necessary
         TensorShape shapeY;
@@ -145,13 +149,15 @@ void OptimizedRNNStackNode<ElemType>::ForwardProp(const FrameRange& fr)
         shapeXT = TensorShape(InputRef(1).GetTensorSliceFor(SIZE_MAX, fr));
         shapeYT = TensorShape(          GetTensorSliceFor(SIZE_MAX, fr));
 
-        // This changes the data from "minibatch paking" in InputRef(0).Value() to "dense CuDNN packing" in m_transposedInput
-        this->PackSequencesForCuDNN(InputRef(1).Value(), *m_transposedInput, numSequencesForFrame);
+        // This changes the data from "minibatch paking" in InputRef(0).Value() to "dense CuDNN packing" in m_transposedInput.
+        // The gaps of the minibatch are dropped, and cuDNN only computes the frames that each sequence has, see PackSequencesForCuDNN().
+        this->PackSequencesForCuDNN(InputRef(1).Value(), *m_transposedInput, m_numSequencesForFrame);
+        ProfilerRatio(profilerEvtRNNPaddingEfficiency, mb->GetActualNumSamples(), mb->GetNumCols());
 
         // ensure enough storage
         m_transposedOutput->Resize(this->Value().GetNumRows(), m_transposedInput->GetNumCols());
 
-        m_transposedOutput->RNNForward(*m_transposedInput, paramW, shapeXT[0], shapeYT[0], numSequencesForFrame, m_rnnAttributes, *m_reserve, *m_workspace);
+        m_transposedOutput->RNNForward(*m_transposedInput, paramW, shapeXT[0], shapeYT[0], m_numSequencesForFrame, m_rnnAttributes, *m_reserve, *m_workspace, inferenceOnly);
         this->UnpackSequencesFromCuDNN(*m_transposedOutput, this->Value());
     }
     m_BackwardDataCalledYet = false;
@@ -176,7 +182,9 @@ void OptimizedRNNStackNode<ElemType>::BackpropTo(const size_t inputIndex, const
         }
         else
         {
+            auto profPack = ProfilerTimeBegin();
             m_transposedDOutput->DoGatherColumnsOf(0.0, *(this->m_packingIndex), this->Gradient(), 1.0);
+            ProfilerTimeEnd(profPack, profilerEvtRNNPackSequences);
         }
 
         // Ensure enough space for the result
@@ -201,7 +209,9 @@ void OptimizedRNNStackNode<ElemType>::BackpropTo(const size_t inputIndex, const
         }
         else
         {
+            auto profPack = ProfilerTimeBegin();
             InputRef(1).Gradient().DoScatterColumnsOf(1.0, *(this->m_packingIndex), *m_transposedDInput, 1.0);
+            ProfilerTimeEnd(profPack, profilerEvtRNNPackSequences);
         }
     }
 }
@@ -264,6 +274,7 @@ void OptimizedRNNStackNode<ElemType>::Validate(bool isFinalValidationPass)
 template<class ElemType>
 void OptimizedRNNStackNode<ElemType>::PackSequencesForCuDNN(const Matrix<ElemType>& src, Matrix<ElemType>& dst, vector<size_t>& numSequencesForFrame2)
 {
+    auto profPack = ProfilerTimeBegin();
     MBLayoutPtr mb = this->GetMBLayout();
     if (mb->HasSequenceBeyondBegin())
         RuntimeError("Invalid MBLayout: Only whole-utterance processing is supported");
@@ -306,36 +317,35 @@ void OptimizedRNNStackNode<ElemType>::PackSequencesForCuDNN(const Matrix<ElemTyp
     // a count of how many sequnces are packed for a particular frame.
     // reset to zero, and compute from current layout information
     // this information is useful when creating the tensor descriptors for CuDNN.
-    numSequencesForFrame2.resize(maxSeqLength);
-    fill(numSequencesForFrame2.begin(), numSequencesForFrame2.end(), 0L);
-
-    // make sure the index is on CPU so we can use SetValue()
-    // 
-    m_packingIndex->TransferToDeviceIfNotThere(-1, true/*isBeingMoved*/, false/*emptyTransfer*/, false/*updatePreferredDevice*/);
-
-    // Reserve one element for every valid sample. DoGatherColumnsOf() requires it to be a row vector
-    m_packingIndex->Resize(1, mb->GetActualNumSamples());
+    // Since the sequences are sorted by decreasing length, this is the number of sequences that are longer than a frame.
+    numSequencesForFrame2.assign(maxSeqLength, 0);
 
-    size_t dst_frame = 0;
+    // The index is built on the CPU and copied to the device in one go. There is one element for every valid sample,
+    // as DoGatherColumnsOf() requires it to be a row vector.
+    m_packingIndexBuffer.clear();
     for (size_t fr = 0; fr < maxSeqLength; fr++)
     {
         for (size_t j = 0; j < numSequences && seq[sequenceOrder[j]].GetNumTimeSteps()>fr; j++)
         {
-            m_packingIndex->SetValue(0, dst_frame++, (ElemType)mb->GetColumnIndex(seq[sequenceOrder[j]], fr));
+            m_packingIndexBuffer.push_back((ElemType)mb->GetColumnIndex(seq[sequenceOrder[j]], fr));
             numSequencesForFrame2[fr]++;
         }
     }
+    m_packingIndex->SetValue(1, m_packingIndexBuffer.size(), src.GetDeviceId(), m_packingIndexBuffer.data(), matrixFlagNormal);
 
     // this->gather(beta,idx,a,alpha) operation is defined as
     // *this[:,j] = a[:,idx[j]] * alpha + *this[:,j] * beta
     dst.DoGatherColumnsOf(0.0, *(this->m_packingIndex), src, 1.0);
+    ProfilerTimeEnd(profPack, profilerEvtRNNPackSequences);
 }
 template<class ElemType>
 void OptimizedRNNStackNode<ElemType>::UnpackSequencesFromCuDNN(const Matrix<ElemType>& src, Matrix<ElemType>& dst)
 {
     // this->scatter(beta,ndx,a,alpha) operation is defined as
     // *this[:,idx[j]] = a[:,j] * alpha + *this[:,idx[j]] * beta
+    auto profPack = ProfilerTimeBegin();
     dst.DoScatterColumnsOf(0.0, *(this->m_packingIndex), src, 1.0);
+    ProfilerTimeEnd(profPack, profilerEvtRNNPackSequences);
 }
 
 
@@ -95,6 +95,8 @@ protected:
     shared_ptr<Matrix<ElemType>> m_workspace;
     shared_ptr<Matrix<ElemType>> m_reserve;
     shared_ptr<Matrix<ElemType>> m_packingIndex;
+    vector<ElemType> m_packingIndexBuffer;     // (CPU-side copy of m_packingIndex)
+    vector<size_t> m_numSequencesForFrame;     // number of sequences in each frame of the packed data, for the cuDNN descriptors
 
 private:
     void TransposeHelper(const MatrixBasePtr matX, const TensorShape &shapeX, MatrixBasePtr matY, TensorShape &shapeY);
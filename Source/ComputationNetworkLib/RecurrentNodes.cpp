@@ -404,6 +404,27 @@ template<class ElemType, int direction>
     Base::EndForwardProp();
 }
 
+template<class ElemType, int direction>
+void DelayedValueNodeBase<ElemType, direction>::ImportStreamStates(const Matrix<ElemType>& states, const Matrix<ElemType>& streamColumns, const MBLayoutPtr& pMBLayout)
+{
+    if (direction != -1 || m_timeStep != 1)
+        RuntimeError("%ls %ls operation: Streaming evaluation is only supported for PastValue with timeStep=1.", NodeName().c_str(), OperationName().c_str());
+    if (pMBLayout->GetNumTimeSteps() != 1 || pMBLayout->GetNumParallelSequences() != streamColumns.GetNumCols())
+        LogicError("ImportStreamStates: The layout must have one time step for each of the %d streams.", (int)streamColumns.GetNumCols());
+
+    m_delayedValue->DoGatherColumnsOf(/*beta=*/0, streamColumns, states, /*alpha=*/1);
+    if (!m_delayedActivationMBLayout)
+        m_delayedActivationMBLayout = make_shared<MBLayout>();
+    m_delayedActivationMBLayout->CopyFrom(pMBLayout);
+}
+
+template<class ElemType, int direction>
+void DelayedValueNodeBase<ElemType, direction>::ExportStreamStates(Matrix<ElemType>& states, const Matrix<ElemType>& frameColumns) const
+{
+    // m_delayedValue holds the input of the whole last minibatch (see EndForwardProp()); beta=0 leaves the columns with index -1 untouched
+    states.DoGatherColumnsOf(/*beta=*/0, frameColumns, *m_delayedValue, /*alpha=*/1);
+}
+
 template<class ElemType, int direction>
 /*virtual*/ void DelayedValueNodeBase<ElemType,direction>::/*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) /*override*/
 {
@@ -576,6 +597,12 @@ template<class ElemType, int direction>
 }
 
 // instantiate the classes that derive from the above
+// (and the base classes themselves, for their non-virtual members)
+template class DelayedValueNodeBase<float, -1>;
+template class DelayedValueNodeBase<double, -1>;
+template class DelayedValueNodeBase<float, +1>;
+template class DelayedValueNodeBase<double, +1>;
+
 template class PastValueNode<float>;
 template class PastValueNode<double>;
 
@@ -76,6 +76,13 @@ public:
     int TimeStep() const { return m_timeStep; }
     ElemType InitialActivationValue() const { return m_initialStateValue; }
 
+    // streaming evaluation of many streams (see CNTKEvalExtended::ForwardPassStreams())
+    // The state of all streams is kept outside, as one column per stream. Parallel sequence s of the next minibatch
+    // continues from column streamColumns[s] of 'states'; 'pMBLayout' is the layout of the carried-over frame (one time step).
+    void ImportStreamStates(const Matrix<ElemType>& states, const Matrix<ElemType>& streamColumns, const MBLayoutPtr& pMBLayout);
+    // sets column j of 'states' to the input of the last minibatch at column frameColumns[j], unless that is negative
+    void ExportStreamStates(Matrix<ElemType>& states, const Matrix<ElemType>& frameColumns) const;
+
 protected:
     ElemType m_initialStateValue;                           // starting value for hidden activation vector at boundary
     int m_timeStep;                                         // delay in frames (typ. 1)
@@ -373,6 +373,14 @@ template <class ElemType>
     let& inMBLayout = InputRef(0).GetMBLayout();
     let& input = InputRef(0).Value();
     let& sequences = inMBLayout->GetAllSequences();
+    // the condition check needs the values on the CPU; fetch them in one transfer, leaving the input where it is
+    vector<ElemType> inputValues(input.GetNumElements());
+    if (!inputValues.empty())
+    {
+        ElemType* inputData = inputValues.data();
+        size_t inputSize = inputValues.size();
+        input.CopyToArray(inputData, inputSize);
+    }
     auto& indexSequences = m_indexSequenceBuffer;
     if (indexSequences.size() < sequences.size())
         indexSequences.resize(sequences.size());
@@ -388,7 +396,7 @@ template <class ElemType>
         double desiredCount = 0.0;
         for (size_t t = 0; t < seq.GetNumTimeSteps(); t++)
         {
-            double delta = input(0, inMBLayout->GetColumnIndex(seq, t)); // how many frames the current time step should expand into
+            double delta = inputValues[inMBLayout->GetColumnIndex(seq, t)]; // how many frames the current time step should expand into
             desiredCount += delta; // this is now how many frames we should have
             // use a margin against round-off errors, so that we get non-binary ratios like 1/3 and 1/5 right
             // This really means generate a frame if too few, unless we are within machine accuracy of the target.
@@ -398,9 +406,7 @@ template <class ElemType>
                    || indexSequence.size() < desiredCount * relativeMargin)
                 indexSequence.push_back(t);
         }
-        // Note: The above accesses m_value directly on the CPU, putting it into BOTH state, possibly for other consumers as well.
     }
-    input.CollapseDataLocation(); // BUGBUG: Move back, since BOTH state is broken at present.
     // create a new MBLayout
     let& outMBLayout = GetMBLayout();
     outMBLayout->InitAsPackedSequences(SequenceLengthVector(sequences, indexSequences), /*temp*/m_placementBuffer, /*temp*/m_rowAllocationsBuffer);
@@ -465,6 +471,16 @@ template <class ElemType>
     let& indexMBLayout  = InputRef(INDEXDATA).GetMBLayout();
     let&  index  = InputRef(INDEXDATA).Value(); // per-seq index values that are to be mapped
     auto& result =                     Value(); // packed index values as mapped to sourceData's layout
+    // The mapping is done on the CPU, on a copy of the index values fetched in one transfer.
+    // The result is uploaded in one transfer as well. Gaps are NaN, which gather/scatter skip.
+    vector<ElemType> indexValues(index.GetNumElements());
+    if (!indexValues.empty())
+    {
+        ElemType* indexData = indexValues.data();
+        size_t indexSize = indexValues.size();
+        index.CopyToArray(indexData, indexSize);
+    }
+    vector<ElemType> buf(indexValues.size(), numeric_limits<ElemType>::quiet_NaN());
     // loop over sourceSequences
     // Input matrix contains time indices for each sequence that refer to frames inside that sequence.
     // We replace every per-sequence index by the resolved column index w.r.t. the same MBLayout.
@@ -478,13 +494,12 @@ template <class ElemType>
         for (size_t tIndex = 0; tIndex < indexSeq.GetNumTimeSteps(); tIndex++)   // map all index values in index sequence
         {
             let jIndex  = indexMBLayout->GetColumnIndex(indexSeq, tIndex);    // map time index to actual location in the matrix storage object
-            let tSource = (size_t)index(0, jIndex);                           // the new time location (relative to source sequence)
+            let tSource = (size_t)indexValues[jIndex];                        // the new time location (relative to source sequence)
             let jSource = sourceMBLayout->GetColumnIndex(sourceSeq, tSource); // map new time index as well. This performs a range check.
-            result(0, jIndex) = (ElemType)jSource;
+            buf[jIndex] = (ElemType)jSource;
         }
     }
-    // Note: maybe this is no longer needed, now that we do the same inside UpdateFunctionValueSize() for all nodes.
-    result.CollapseDataLocation(); // BUGBUG: Move back, since BOTH state is broken at present.
+    result.SetValue(index.GetNumRows(), index.GetNumCols(), result.GetDeviceId(), buf.data(), MatrixFormat::matrixFormatColMajor);
 }
 
 template <class ElemType>
@@ -848,12 +848,22 @@ public:
         auto inputGrad = InputRef(inputIndex).GradientTensorFor(rank, fr.AllowBroadcast());
         let outputSubSlice = NarrowToStripe(outputSlice, inputIndex);
         let outputGrad = TensorView<ElemType>(GradientPtr(), outputSubSlice);
-        inputGrad.AddCopyOf(outputGrad);
+        if (Input(inputIndex)->IsGradientOptimized(this))
+            inputGrad.AssignCopyOf(outputGrad);
+        else
+            inputGrad.AddCopyOf(outputGrad);
     }
 
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
 
+    // Each input's gradient is its stripe of our gradient, so it can be assigned instead of zeroed and accumulated into.
+    // Not for an input that is broadcast along our dynamic axis, which would be overwritten frame by frame inside a loop.
+    virtual ParentGradientOptimization ImplementsGradientOptimization(const ComputationNodeBase* input) const override
+    {
+        return input->GetMBLayout() == GetMBLayout() ? ParentGradientOptimization::Overwrite : ParentGradientOptimization::None;
+    }
+
     virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
     {
         Base::Validate(isFinalValidationPass);
@@ -1694,7 +1704,6 @@ public:
         if (inputIndex == 1) //only right operand need calculate gradient
         {
             let&  indices = InputRef(0).Value();
-            auto& sourceGradient = InputRef(1).Gradient();
             auto& outputGradient = Gradient();
             const auto& sampleLayout = InputRef(1).GetSampleLayout();
             const auto& dims = sampleLayout.GetDims();
@@ -1710,7 +1719,18 @@ public:
                 row_elements *= dims[i];
             }
 
-            sourceGradient.ScatterToIndices(outputGradient, indices, row_elements);
+            // As in TimesNode with sparse input, the gradient of a table of embeddings is sparse: the rows that are
+            // looked up are summed into a matrixFormatSparseBlockCol gradient, once per row, instead of adding each index
+            // into a dense gradient. This applies to the columns of a learnable table [row_elements x V].
+            if (InputRef(1).IsParameterUpdateRequired() && InputRef(1).GetAsMatrixNumRows() == row_elements &&
+                InputRef(1).GetPreferredGradientMatrixType() == UNDETERMINED)
+            {
+                InputRef(1).GradientPtrRef() = std::make_shared<Matrix<ElemType>>(row_elements, InputRef(1).GetAsMatrixNumCols(),
+                                                                                  InputRef(1).Value().GetPreferredDeviceId(), SPARSE, MatrixFormat::matrixFormatSparseBlockCol);
+                InputRef(1).SetPreferredGradientMatrixType(SPARSE);
+            }
+
+            InputRef(1).Gradient().ScatterToIndices(outputGradient, indices, row_elements);
         }
         else
         {
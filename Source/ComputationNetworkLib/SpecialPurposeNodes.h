@@ -1013,6 +1013,65 @@ public:
 template class StopGradientNode<float>;
 template class StopGradientNode<double>;
 
+// -----------------------------------------------------------------------
+// DeviceTransferNode (input)
+// Outputs its input on the device of this node, and passes the gradient back to the device of the input.
+// Connects the stages of a network that is partitioned across devices (see ComputationNetwork::PartitionIntoPipelineStages());
+// on a single device it is a plain copy.
+// -----------------------------------------------------------------------
+template <class ElemType>
+class DeviceTransferNode : public ComputationNode<ElemType>, public NumInputs<1>
+{
+    typedef ComputationNode<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"DeviceTransfer"; }
+
+public:
+    DeclareConstructorFromConfigWithNumInputs(DeviceTransferNode);
+    DeviceTransferNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name)
+    {
+    }
+
+    virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
+    {
+        auto result = ValueFor(fr);
+        result.AssignValuesOf(InputRef(0).ValueFor(fr));
+    }
+
+    virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
+    {
+        assert(inputIndex == 0), inputIndex;
+
+        auto inputGradient = InputRef(0).GradientFor(fr);
+        if (Input(0)->IsGradientInitializedBy(this))
+            inputGradient.AssignValuesOf(GradientFor(fr));
+        else
+        {
+            // the gradient is copied to the device of the input first, and then accumulated there
+            if (!m_gradientOnInputDevice || m_gradientOnInputDevice->GetDeviceId() != InputRef(0).GetDeviceId())
+                m_gradientOnInputDevice = make_shared<Matrix<ElemType>>(InputRef(0).GetDeviceId());
+            m_gradientOnInputDevice->AssignValuesOf(GradientFor(fr));
+            inputGradient += *m_gradientOnInputDevice;
+        }
+    }
+
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
+    {
+        ValidateUnaryMap(isFinalValidationPass);
+    }
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
+
+    virtual ParentGradientOptimization ImplementsGradientOptimization(const ComputationNodeBase*) const override { return ParentGradientOptimization::Overwrite; }
+
+private:
+    shared_ptr<Matrix<ElemType>> m_gradientOnInputDevice;
+};
+
+template class DeviceTransferNode<float>;
+template class DeviceTransferNode<double>;
+
 // -----------------------------------------------------------------------
 // AssignNode (RefInput, Input)
 // -----------------------------------------------------------------------
@@ -4,6 +4,7 @@
 //
 
 #include "TrainingNodes.h"
+#include "CounterBasedRandom.h"
 #include <boost/random/uniform_real_distribution.hpp>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -12,6 +13,19 @@ template <class ElemType>
 /*virtual*/ void RandomDistributionNode<ElemType>::ForwardProp(const FrameRange& fr) /*override*/
 {
     auto&& result = ValueFor(fr);
+    if (UsesCounterBasedRandomStream())
+    {
+        switch (m_type)
+        {
+        case RandomDistributionType::Uniform:   DrawCounterBasedRandomValue(result, RandomDistribution::Uniform, m_args[0], m_args[1]); break;
+        case RandomDistributionType::Normal:    DrawCounterBasedRandomValue(result, RandomDistribution::Normal, m_args[0], m_args[1]); break;
+        case RandomDistributionType::Gumbel:    DrawCounterBasedRandomValue(result, RandomDistribution::Gumbel, m_args[0], m_args[1]); break;
+        case RandomDistributionType::Bernoulli: DrawCounterBasedRandomValue(result, RandomDistribution::Bernoulli, ElemType(1 - m_args[0]), ElemType(1)); break;
+        default:
+            RuntimeError("RandomDistributionNode::ForwardProp: Unknown random distribution type code %d", m_type);
+        }
+        return;
+    }
     switch (m_type)
     {
     case RandomDistributionType::Uniform:
@@ -123,7 +137,8 @@ const std::vector<size_t> RandomSampleNodeBase<ElemType>::RunSampling(size_t& nT
     boost::random::uniform_real_distribution<double> r(0, m_samplingWeightsPrefixSum.back());
     std::unordered_set<int> alreadySampled;
     std::vector<size_t> samples;
-    CPURNGHandle* cpuRNGHandle = dynamic_cast<CPURNGHandle*>(&GetRNGHandle(CPUDEVICE));
+    const bool counterBased = UsesCounterBasedRandomStream();
+    CPURNGHandle* cpuRNGHandle = counterBased ? nullptr : dynamic_cast<CPURNGHandle*>(&GetRNGHandle(CPUDEVICE));
 
     // find random samples using the specified weight
     if (m_allowDuplicates)
@@ -134,7 +149,8 @@ const std::vector<size_t> RandomSampleNodeBase<ElemType>::RunSampling(size_t& nT
     auto offset = GetRngOffset();
     while (samples.size() < m_sizeOfSampledSet)
     {
-        double randomValue = r(cpuRNGHandle->Generator());
+        double randomValue = counterBased ? CounterBasedRandom::Value(RandomDistribution::Uniform, 0.0, m_samplingWeightsPrefixSum.back(), GetCounterBasedRandomKey(), offset)
+                                          : r(cpuRNGHandle->Generator());
         offset++;
         // Find the first index where value[idx] >= randomValue.
         auto lower = std::lower_bound(m_samplingWeightsPrefixSum.begin(), m_samplingWeightsPrefixSum.end(), randomValue);
@@ -304,6 +320,308 @@ void RandomSampleInclusionFrequencyNode<ElemType>::Validate(bool isFinalValidati
 template class RandomSampleInclusionFrequencyNode<float>;
 template class RandomSampleInclusionFrequencyNode<double>;
 
+template <class ElemType>
+SampledCrossEntropyWithSoftmaxNode<ElemType>::SampledCrossEntropyWithSoftmaxNode(DEVICEID_TYPE deviceId, const wstring& name, size_t numSamples)
+    : Base(deviceId, name), m_numSamples(numSamples), m_aliasTableTimeStamp(0), m_needRecomputeLogitGradients(true)
+{
+    SetRngState(CreateUniqId());
+    for (auto m : { &m_keepProbability, &m_alias, &m_logExpectedCount, &m_classIndices, &m_classes, &m_weights, &m_biasMinusLogQ,
+                    &m_logProbabilities, &m_labelLogitGradient, &m_sampleLogitGradient, &m_uniform, &m_samples, &m_temp, &m_temp2 })
+        *m = make_shared<Matrix<ElemType>>(deviceId);
+    m_oneHotClasses = make_shared<Matrix<ElemType>>(0, 0, deviceId, SPARSE, matrixFormatSparseCSC);
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const
+{
+    Base::CopyTo(nodeP, newName, flags);
+    if (flags & CopyNodeFlags::copyNodeValue)
+    {
+        auto node = dynamic_pointer_cast<SampledCrossEntropyWithSoftmaxNode<ElemType>>(nodeP);
+        node->m_numSamples = m_numSamples;
+        node->SetRngState(GetRngSeed(), GetRngOffset());
+    }
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::Save(File& fstream) const
+{
+    Base::Save(fstream);
+    fstream << m_numSamples;
+    RngUser::Save(fstream);
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::Load(File& fstream, size_t modelVersion)
+{
+    Base::Load(fstream, modelVersion);
+    fstream >> m_numSamples;
+    RngUser::Load(fstream, modelVersion);
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::Validate(bool isFinalValidationPass)
+{
+    Base::Validate(isFinalValidationPass);
+    m_pMBLayout = nullptr; // this node does not hold mini-batch data
+
+    if (m_numSamples == 0)
+        InvalidArgument("%ls %ls operation: The number of samples must be greater than zero.", NodeName().c_str(), OperationName().c_str());
+
+    const size_t numClasses = Input(0)->GetSampleLayout().GetNumElements();
+    const size_t hiddenDim = Input(1)->GetSampleLayout().GetNumElements();
+    if (numClasses != 0 && hiddenDim != 0)
+    {
+        Input(2)->ValidateInferInputDimsFrom(TensorShape(hiddenDim, numClasses));
+        Input(3)->ValidateInferInputDimsFrom(TensorShape(numClasses));
+    }
+
+    if (isFinalValidationPass)
+    {
+        if (!Input(0)->HasMBLayout() || !Input(1)->HasMBLayout() || Input(2)->HasMBLayout() || Input(3)->HasMBLayout() || Input(4)->HasMBLayout())
+            InvalidArgument("%ls %ls operation requires the labels (input 0) and the hidden activation (input 1) to be a minibatch, and the other inputs to be parameters.",
+                            NodeName().c_str(), OperationName().c_str());
+        if (Input(0)->GetMBLayout() != Input(1)->GetMBLayout())
+            InvalidArgument("%ls %ls operation requires the labels (input 0) and the hidden activation (input 1) to have the same layout.", NodeName().c_str(), OperationName().c_str());
+        if (Input(2)->GetAsMatrixNumRows() != hiddenDim || Input(2)->GetAsMatrixNumCols() != numClasses)
+            InvalidArgument("%ls %ls operation: The output weights (input 2) must have the dimensions [%d x %d].", NodeName().c_str(), OperationName().c_str(), (int)hiddenDim, (int)numClasses);
+        if (Input(3)->GetSampleLayout().GetNumElements() != numClasses || Input(4)->GetSampleLayout().GetNumElements() != numClasses)
+            InvalidArgument("%ls %ls operation: The output bias (input 3) and the sampling weights (input 4) must have the dimension %d of the labels.",
+                            NodeName().c_str(), OperationName().c_str(), (int)numClasses);
+        // class indices are stored in matrices of ElemType
+        if (sizeof(ElemType) == sizeof(float) && numClasses > (1 << 24))
+            InvalidArgument("%ls %ls operation: More than %d classes require double precision.", NodeName().c_str(), OperationName().c_str(), 1 << 24);
+    }
+
+    SetDims(TensorShape(1), false);
+}
+
+// Walker's alias method, built with Vose's algorithm: class j is drawn as a uniformly chosen bucket j, which is kept with probability
+// keep[j], and otherwise replaced by alias[j].
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::UpdateAliasTable()
+{
+    if (m_aliasTableTimeStamp == Input(4)->GetEvalTimeStamp() && m_classIndices->GetNumCols() != 0)
+        return;
+
+    const Matrix<ElemType>& samplingWeights = InputRef(4).ValueAsMatrix();
+    const size_t numClasses = samplingWeights.GetNumElements();
+    std::vector<ElemType> weights(numClasses);
+    samplingWeights.CopySection(samplingWeights.GetNumRows(), samplingWeights.GetNumCols(), weights.data(), samplingWeights.GetNumRows());
+
+    double sum = 0, minWeight = std::numeric_limits<double>::infinity();
+    for (auto w : weights)
+    {
+        if (w < 0)
+            InvalidArgument("%ls %ls operation: Sampling weights contain negative number %f.", NodeName().c_str(), OperationName().c_str(), (double)w);
+        sum += w;
+        if (w > 0)
+            minWeight = std::min(minWeight, (double)w);
+    }
+    if (sum == 0)
+        InvalidArgument("%ls %ls operation: All sampling weights are zero.", NodeName().c_str(), OperationName().c_str());
+
+    std::vector<double> scaled(numClasses);
+    std::vector<ElemType> keep(numClasses), alias(numClasses), logExpectedCount(numClasses), classIndices(numClasses);
+    std::vector<size_t> small, large;
+    for (size_t i = 0; i < numClasses; i++)
+    {
+        scaled[i] = weights[i] * numClasses / sum;
+        (scaled[i] < 1 ? small : large).push_back(i);
+        alias[i] = (ElemType)i;
+        classIndices[i] = (ElemType)i;
+        // (classes that are never sampled can still be labels, their correction is that of the least likely class)
+        logExpectedCount[i] = (ElemType)log(m_numSamples * std::max((double)weights[i], minWeight) / sum);
+    }
+    while (!small.empty() && !large.empty())
+    {
+        size_t s = small.back(), l = large.back();
+        small.pop_back();
+        keep[s] = (ElemType)scaled[s];
+        alias[s] = (ElemType)l;
+        scaled[l] -= 1 - scaled[s];
+        if (scaled[l] < 1)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // the remaining buckets are full (up to rounding)
+    for (auto i : small)
+        keep[i] = 1;
+    for (auto i : large)
+        keep[i] = 1;
+
+    const DEVICEID_TYPE deviceId = ValuePtr()->GetDeviceId();
+    m_keepProbability->SetValue(1, numClasses, deviceId, keep.data());
+    m_alias->SetValue(1, numClasses, deviceId, alias.data());
+    m_logExpectedCount->SetValue(1, numClasses, deviceId, logExpectedCount.data());
+    m_classIndices->SetValue(1, numClasses, deviceId, classIndices.data());
+    m_aliasTableTimeStamp = Input(4)->GetEvalTimeStamp();
+}
+
+// Draws the samples [1 x numSamples] into m_samples, on the device of the node.
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::DrawSamples()
+{
+    const size_t numClasses = m_classIndices->GetNumCols();
+    const TensorShape shape(m_numSamples);
+    m_uniform->Resize(1, m_numSamples);
+    m_samples->Resize(1, m_numSamples);
+    if (UsesCounterBasedRandomStream())
+    {
+        DrawCounterBasedRandomValue(*m_uniform, RandomDistribution::Uniform, ElemType(0), ElemType(1));
+        DrawCounterBasedRandomValue(*m_samples, RandomDistribution::Uniform, ElemType(0), ElemType(1));
+    }
+    else
+    {
+        m_uniform->SetUniformRandomValue(GetRNGHandle(ValuePtr()->GetDeviceId()), 0, 1);
+        m_samples->SetUniformRandomValue(GetRNGHandle(ValuePtr()->GetDeviceId()), 0, 1);
+        UpdateRngOffset(GetRngOffset() + 2 * m_numSamples);
+    }
+
+    // the bucket: floor(u * numClasses), where u may be 1
+    TensorView<ElemType> bucket(m_uniform, shape);
+    *m_uniform *= (ElemType)numClasses;
+    bucket.AssignFloorOf(bucket);
+    m_uniform->InplaceTruncateTop((ElemType)(numClasses - 1));
+
+    // keep the bucket if the second uniform number is below its probability, else take its alias
+    m_temp->DoGatherColumnsOf(0, *m_uniform, *m_keepProbability, 1);
+    m_temp2->DoGatherColumnsOf(0, *m_uniform, *m_alias, 1);
+    TensorView<ElemType> keep(m_temp, shape), samples(m_samples, shape);
+    keep.AssignLessOf(samples, keep);
+    samples.AssignCondOf(keep, bucket, TensorView<ElemType>(m_temp2, shape));
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::ForwardPropNonLooping()
+{
+    FrameRange fr(InputRef(0).GetMBLayout());
+    UpdateAliasTable();
+    DrawSamples();
+
+    const Matrix<ElemType>& hidden = InputRef(1).Value();
+    const size_t numClasses = m_classIndices->GetNumCols();
+    const size_t numFrames = hidden.GetNumCols();
+    const size_t k = m_numSamples;
+
+    // the classes: the labels (as indices, gaps are class 0 with a masked gradient), followed by the samples
+    m_temp->Resize(1, numFrames);
+    Matrix<ElemType>::MultiplyAndWeightedAdd(1, *m_classIndices, false, InputRef(0).Value(), false, 0, *m_temp);
+    m_classes->Resize(1, numFrames + k);
+    m_classes->SetColumnSlice(*m_temp, 0, numFrames);
+    m_classes->SetColumnSlice(*m_samples, numFrames, k);
+
+    // gather the columns of W and the entries of b - log Q of these classes only
+    m_weights->DoGatherColumnsOf(0, *m_classes, InputRef(2).ValueAsMatrix(), 1);
+    m_biasMinusLogQ->DoGatherColumnsOf(0, *m_classes, InputRef(3).ValueAsMatrix().Reshaped(1, numClasses), 1);
+    m_temp2->DoGatherColumnsOf(0, *m_classes, *m_logExpectedCount, 1);
+    *m_biasMinusLogQ -= *m_temp2;
+
+    // the logits of the labels: z(t) = h(t)' W[:,y(t)] + b[y(t)] - log Q(y(t))
+    m_logProbabilities->Resize(1 + k, numFrames);
+    m_temp->AssignInnerProductOf(hidden, m_weights->ColumnSlice(0, numFrames), true);
+    *m_temp += m_biasMinusLogQ->ColumnSlice(0, numFrames);
+    m_logProbabilities->AssignToRowSliceValuesOf(*m_temp, 0, 1);
+
+    // the logits of the samples, by a single GEMM of the gathered columns with all frames: z(j,t) = h(t)' W[:,s(j)] + b[s(j)] - log Q(s(j)),
+    // excluding the samples that are the label of a frame
+    Matrix<ElemType>::MultiplyAndWeightedAdd(1, m_weights->ColumnSlice(numFrames, k), true, hidden, false, 0, *m_temp2);
+    m_uniform->AssignValuesOf(m_biasMinusLogQ->ColumnSlice(numFrames, k));
+    m_temp->AssignValuesOf(m_classes->ColumnSlice(0, numFrames));
+    TensorView<ElemType> sampleLogits(m_temp2, TensorShape(k, numFrames));
+    sampleLogits.AddCopyOf(TensorView<ElemType>(m_uniform, TensorShape(k, 1)));
+    sampleLogits.AddEqualOf(TensorView<ElemType>(m_samples, TensorShape(k, 1)), TensorView<ElemType>(m_temp, TensorShape(1, numFrames)), (ElemType)-1e30);
+    m_logProbabilities->AssignToRowSliceValuesOf(*m_temp2, 1, k);
+
+    m_logProbabilities->InplaceLogSoftmax(true);
+    m_temp->AssignRowSliceValuesOf(*m_logProbabilities, 0, 1);
+    MaskMissingColumnsToZero(*m_temp, InputRef(1).GetMBLayout(), fr);
+    Value().AssignSumOfElements(*m_temp);
+    Value() *= -1;
+
+    m_needRecomputeLogitGradients = true;
+}
+
+// The gradient w.r.t. the logits of a frame is softmax - e(label), scaled by the gradient of the criterion.
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::ComputeLogitGradients()
+{
+    FrameRange fr(InputRef(0).GetMBLayout());
+    const size_t k = m_numSamples;
+
+    m_temp->AssignExpOf(*m_logProbabilities);
+    m_temp2->AssignRowSliceValuesOf(*m_temp, 0, 1);
+    *m_temp2 -= 1;
+    m_temp->AssignToRowSliceValuesOf(*m_temp2, 0, 1);
+    MaskMissingColumnsToZero(*m_temp, InputRef(1).GetMBLayout(), fr);
+    Matrix<ElemType>::Multiply1x1AndWeightedAdd(1, Gradient(), *m_temp, 0, *m_temp2);
+
+    m_labelLogitGradient->AssignRowSliceValuesOf(*m_temp2, 0, 1);
+    m_sampleLogitGradient->AssignRowSliceValuesOf(*m_temp2, 1, k);
+    m_needRecomputeLogitGradients = false;
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::BackpropToNonLooping(size_t inputIndex)
+{
+    if (inputIndex == 0 || inputIndex == 4)
+        InvalidArgument("%ls %ls operation: The labels (input 0) and the sampling weights (input 4) have no gradient.", NodeName().c_str(), OperationName().c_str());
+
+    if (m_needRecomputeLogitGradients)
+        ComputeLogitGradients();
+
+    const Matrix<ElemType>& hidden = InputRef(1).Value();
+    const size_t numClasses = m_classIndices->GetNumCols();
+    const size_t numFrames = hidden.GetNumCols();
+    const size_t k = m_numSamples;
+
+    if (inputIndex == 1) // dh(t) = W[:,y(t)] dz(t) + sum_j W[:,s(j)] dz(j,t)
+    {
+        Matrix<ElemType>& gradient = InputRef(1).Gradient();
+        m_temp->AssignValuesOf(m_weights->ColumnSlice(0, numFrames));
+        m_temp->RowElementMultiplyWith(*m_labelLogitGradient);
+        gradient += *m_temp;
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, m_weights->ColumnSlice(numFrames, k), false, *m_sampleLogitGradient, false, 1, gradient);
+    }
+    else if (inputIndex == 2) // dW[:,c] for the gathered classes c, scattered into a sparse gradient by the product with their one-hot matrix
+    {
+        m_temp->Resize(hidden.GetNumRows(), numFrames + k);
+        m_temp->SetColumnSlice(hidden, 0, numFrames);
+        auto labelColumns = m_temp->ColumnSlice(0, numFrames);
+        labelColumns.RowElementMultiplyWith(*m_labelLogitGradient);
+        auto sampleColumns = m_temp->ColumnSlice(numFrames, k);
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, hidden, false, *m_sampleLogitGradient, true, 0, sampleColumns);
+
+        std::vector<size_t> shape(1, numClasses);
+        m_oneHotClasses->Resize(numClasses, numFrames + k, numFrames + k);
+        m_oneHotClasses->AssignOneHot(*m_classes, shape, 0, /*is_sparse=*/true);
+
+        // as in TimesNode, the gradient of the weights that are multiplied with a sparse matrix is sparse
+        if (!InputRef(2).GradientPtr() || InputRef(2).GetPreferredGradientMatrixType() == UNDETERMINED)
+        {
+            InputRef(2).GradientPtrRef() = std::make_shared<Matrix<ElemType>>(InputRef(2).GetAsMatrixNumRows(), numClasses,
+                                                                              InputRef(2).Value().GetPreferredDeviceId(), SPARSE, MatrixFormat::matrixFormatSparseBlockCol);
+            InputRef(2).SetPreferredGradientMatrixType(SPARSE);
+        }
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, *m_temp, false, *m_oneHotClasses, true, 1, InputRef(2).Gradient());
+    }
+    else if (inputIndex == 3) // db[c] for the gathered classes c, scattered into the gradient
+    {
+        Matrix<ElemType>::VectorSum(*m_sampleLogitGradient, *m_temp2, /*isColWise=*/false);
+        m_temp2->Reshape(1, k);
+        m_temp->Resize(1, numFrames + k);
+        m_temp->SetColumnSlice(*m_labelLogitGradient, 0, numFrames);
+        m_temp->SetColumnSlice(*m_temp2, numFrames, k);
+        auto biasGradient = InputRef(3).GradientAsMatrix().Reshaped(1, numClasses);
+        biasGradient.DoScatterColumnsOf(1, *m_classes, *m_temp, 1);
+    }
+}
+
+template class SampledCrossEntropyWithSoftmaxNode<float>;
+template class SampledCrossEntropyWithSoftmaxNode<double>;
+
 template<class ElemType>
 void DropoutNode<ElemType>::Save(File& fstream) const
 {
@@ -125,7 +125,7 @@ class CrossEntropyWithSoftmaxNode : public ComputationNodeNonLooping /*Computati
 public:
     DeclareConstructorFromConfigWithNumInputs(CrossEntropyWithSoftmaxNode);
     CrossEntropyWithSoftmaxNode(DEVICEID_TYPE deviceId, const wstring& name)
-        : Base(deviceId, name)
+        : Base(deviceId, name), m_logSoftmaxExponentiated(false)
     {
     }
 
@@ -141,8 +141,11 @@ public:
             InputRef(0).GradientFor(fr).Print("CrossEntropyWithSoftmaxNode Partial-Left-in");
 #endif
 
+            if (m_logSoftmaxExponentiated)
+                LogicError("%ls %ls operation: The gradient of the labels must be computed before that of the prediction.", NodeName().c_str(), OperationName().c_str());
+
             auto gradient = InputRef(0).GradientFor(fr);
-            Matrix<ElemType>::Multiply1x1AndWeightedAdd(-1.0f, Gradient() /*1x1*/, *m_logSoftmaxOfRight, 1.0f, gradient);
+            Matrix<ElemType>::Multiply1x1AndWeightedAdd(-1.0f, Gradient() /*1x1*/, *m_logSoftmaxOfRight, InputRef(0).IsGradientInitializedBy(this) ? 0.0f : 1.0f, gradient);
 #if DUMPOUTPUT
             InputRef(0).GradientFor(fr).Print("CrossEntropyWithSoftmaxNode Partial-Left-out");
 #endif
@@ -150,15 +153,27 @@ public:
 
         else if (inputIndex == 1) // right derivative
         {
+            // turn the log softmax into the softmax in place, instead of keeping a second matrix of that size from ForwardProp
+            // The inputs are backpropagated in order, so the labels gradient above does not need the log softmax any longer.
+            // The gaps become 1, which only affects the gaps of the gradient.
+            if (!m_logSoftmaxExponentiated)
+            {
+                m_logSoftmaxOfRight->InplaceExp();
+                m_logSoftmaxExponentiated = true;
+            }
+            const auto& softmaxOfRight = *m_logSoftmaxOfRight;
 #if DUMPOUTPUT
-            m_softmaxOfRight->Print("CrossEntropyWithSoftmax Partial-softmaxOfRight");
+            softmaxOfRight.Print("CrossEntropyWithSoftmax Partial-softmaxOfRight");
             InputRef(0).ValueFor(fr).Print("CrossEntropyWithSoftmax Partial-inputFunctionValues");
             Gradient().Print("CrossEntropyWithSoftmax Partial-gradientValues");
             InputRef(1).GradientFor(fr).Print("CrossEntropyWithSoftmaxNode Partial-Right-in");
 #endif
 
             auto gradient = InputRef(1).GradientFor(fr);
-            Matrix<ElemType>::AddScaledDifference(Gradient(), *m_softmaxOfRight, InputRef(0).ValueFor(fr), gradient);
+            if (InputRef(1).IsGradientInitializedBy(this))
+                Matrix<ElemType>::AssignScaledDifference(Gradient(), softmaxOfRight, InputRef(0).ValueFor(fr), gradient);
+            else
+                Matrix<ElemType>::AddScaledDifference(Gradient(), softmaxOfRight, InputRef(0).ValueFor(fr), gradient);
 #if DUMPOUTPUT
             InputRef(1).GradientFor(fr).Print("CrossEntropyWithSoftmaxNode Partial-Right");
 #endif
@@ -173,21 +188,22 @@ public:
         return false;
     }
 
+    // both gradients are dense and cover all of the input, so they can be written instead of accumulated;
+    // for the prediction this saves a read of a (typically vocabulary-sized) gradient per sample
+    virtual ParentGradientOptimization ImplementsGradientOptimization(const ComputationNodeBase*) const override { return ParentGradientOptimization::Overwrite; }
+
     virtual void UpdateFunctionMBSize() override
     {
         m_logSoftmaxOfRight->Resize(Input(1)->Value());
-        m_softmaxOfRight->Resize(*m_logSoftmaxOfRight);
     }
 
     virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override // -sum(left_i * log(softmax_i(right)))
     {
         FrameRange fr(InputRef(0).GetMBLayout());
-        // first compute the softmax (column-wise)
-        // Note that we need both log and non-log for gradient computation.
+        // first compute the log softmax (column-wise)
+        // The gradient also needs the softmax, which BackpropTo() computes from it in place.
         m_logSoftmaxOfRight->AssignLogSoftmaxOf(InputRef(1).ValueFor(fr), true);
-        // BUGBUG: No need to compute m_softmaxOfRight in ForwardProp, should be moved to BackpropTo().
-        m_softmaxOfRight->SetValue(*m_logSoftmaxOfRight);
-        m_softmaxOfRight->InplaceExp();
+        m_logSoftmaxExponentiated = false;
         // flatten all gaps to zero, such that gaps will contribute zero to the sum
         MaskMissingColumnsToZero(*m_logSoftmaxOfRight, InputRef(1).GetMBLayout(), fr);
         // reduce over all frames
@@ -213,7 +229,7 @@ public:
         {
             auto node = dynamic_pointer_cast<CrossEntropyWithSoftmaxNode<ElemType>>(nodeP);
             node->m_logSoftmaxOfRight->SetValue(*m_logSoftmaxOfRight);
-            node->m_softmaxOfRight->SetValue(*m_softmaxOfRight);
+            node->m_logSoftmaxExponentiated = m_logSoftmaxExponentiated;
         }
     }
 
@@ -222,7 +238,6 @@ public:
     {
         Base::RequestMatricesBeforeForwardProp(matrixPool);
         RequestMatrixFromPool(m_logSoftmaxOfRight, matrixPool);
-        RequestMatrixFromPool(m_softmaxOfRight, matrixPool);
     }
 
     // release gradient and temp matrices that no longer needed after all the children's gradients are computed.
@@ -230,12 +245,11 @@ public:
     {
         Base::ReleaseMatricesAfterBackprop(matrixPool);
         ReleaseMatrixToPool(m_logSoftmaxOfRight, matrixPool);
-        ReleaseMatrixToPool(m_softmaxOfRight, matrixPool);
     }
 
 protected:
-    shared_ptr<Matrix<ElemType>> m_logSoftmaxOfRight;
-    shared_ptr<Matrix<ElemType>> m_softmaxOfRight;
+    shared_ptr<Matrix<ElemType>> m_logSoftmaxOfRight; // holds the softmax instead once m_logSoftmaxExponentiated
+    bool m_logSoftmaxExponentiated;
 };
 
 template class CrossEntropyWithSoftmaxNode<float>;
@@ -488,7 +502,12 @@ public:
     {
         FrameRange fr(Input(0)->GetMBLayout());
 
-        if (inputIndex == 1 &&  // right derivative
+        if (inputIndex == 1 && IsOnDevice()) // right derivative, all pairs of each query in one kernel
+        {
+            auto gradient = Input(1)->GradientFor(fr);
+            Matrix<ElemType>::AddLambdaRankGradient(Input(0)->ValueFor(fr), Input(1)->ValueFor(fr), *m_queryBegins, *m_ranks, *m_metrics, m_sigma, gradient);
+        }
+        else if (inputIndex == 1 &&  // right derivative
             m_numberOfUrlPairs > 0)   // 
         {
             auto gradient = Input(1)->GradientFor(fr);
@@ -558,6 +577,12 @@ public:
 
     virtual void UpdateFunctionMBSize() override
     {
+        if (IsOnDevice())
+        {
+            UpdateQueryBegins();
+            return;
+        }
+
         UpdateCounts();
 
         // clean up first
@@ -606,6 +631,26 @@ public:
         const Matrix<ElemType>& preds = Input(1)->ValueFor(fr);
         const Matrix<ElemType>& queryIds = Input(2)->ValueFor(fr);
 
+        // On the GPU, the ranks and the metrics of all queries are computed by one kernel, and only the metrics are copied back.
+        if (IsOnDevice())
+        {
+            const size_t numberOfQueries = m_hostQueryBegins.size() - 1;
+            if (numberOfQueries == 0)
+                LogicError("In %ls %ls numberOfQueries==0, check your data.", NodeName().c_str(), OperationName().c_str());
+
+            Matrix<ElemType>::LambdaRankMetrics(gains, preds, *m_queryBegins, *m_ranks, *m_metrics);
+            CopyToHost(*m_metrics, m_hostMetrics);
+            ElemType irMetricValue = 0.0;
+            for (size_t q = 0; q < numberOfQueries; q++)
+            {
+                if (m_hostMetrics[2 * q] != 0.0)
+                    irMetricValue += m_hostMetrics[2 * q + 1] / m_hostMetrics[2 * q];
+            }
+            irMetricValue = (1.0f - irMetricValue / numberOfQueries) * 100 * gains.GetNumCols();
+            Value().SetValue(irMetricValue);
+            return;
+        }
+
         // Iterate through all samples
         size_t numberOfSamples = gains.GetNumCols();
         QueryUrls aqu;
@@ -756,10 +801,14 @@ public:
             node->m_urlGain1->SetValue(*m_urlGain1);
             node->m_urlDiscount0->SetValue(*m_urlDiscount0);
             node->m_urlDiscount1->SetValue(*m_urlDiscount1);
+            node->m_queryBegins->SetValue(*m_queryBegins);
+            node->m_ranks->SetValue(*m_ranks);
+            node->m_metrics->SetValue(*m_metrics);
 
             node->m_queryUrls = m_queryUrls;
             node->m_urlSorter = m_urlSorter;
             node->m_logWeights = m_logWeights;
+            node->m_hostQueryBegins = m_hostQueryBegins;
         }
     }
 
@@ -774,6 +823,9 @@ public:
         RequestMatrixFromPool(m_urlGain1, matrixPool);
         RequestMatrixFromPool(m_urlDiscount0, matrixPool);
         RequestMatrixFromPool(m_urlDiscount1, matrixPool);
+        RequestMatrixFromPool(m_queryBegins, matrixPool);
+        RequestMatrixFromPool(m_ranks, matrixPool);
+        RequestMatrixFromPool(m_metrics, matrixPool);
     }
 
     // release gradient and temp matrices that no longer needed after all the children's gradients are computed.
@@ -787,6 +839,9 @@ public:
         ReleaseMatrixToPool(m_urlGain1, matrixPool);
         ReleaseMatrixToPool(m_urlDiscount0, matrixPool);
         ReleaseMatrixToPool(m_urlDiscount1, matrixPool);
+        ReleaseMatrixToPool(m_queryBegins, matrixPool);
+        ReleaseMatrixToPool(m_ranks, matrixPool);
+        ReleaseMatrixToPool(m_metrics, matrixPool);
         
         // is this the right place?  it was not called after bp.
         m_queryUrls.clear();
@@ -796,6 +851,45 @@ public:
 
 protected:
 
+    // The CPU computes the queries in m_queryUrls; on the GPU, LambdaRankMetrics() and AddLambdaRankGradient() compute
+    // them from the columns at which the queries begin.
+    bool IsOnDevice() const
+    {
+        return Value().GetDeviceId() != CPUDEVICE;
+    }
+
+    static void CopyToHost(const Matrix<ElemType>& m, std::vector<ElemType>& out)
+    {
+        out.resize(m.GetNumElements());
+        if (out.empty())
+            return;
+        ElemType* data = out.data();
+        size_t size = out.size();
+        m.CopyToArray(data, size);
+    }
+
+    // the begin of each query and the end of the last, from one copy of the query ids to the host
+    void UpdateQueryBegins()
+    {
+        FrameRange fr(Input(0)->GetMBLayout());
+        const Matrix<ElemType>& queryIds = Input(2)->ValueFor(fr);
+        CopyToHost(queryIds, m_hostQueryIds);
+
+        m_hostQueryBegins.clear();
+        int previousQueryId = -1;
+        for (size_t i = 0; i < m_hostQueryIds.size(); i++)
+        {
+            int queryId = (int)m_hostQueryIds[i];
+            if (queryId != previousQueryId)
+            {
+                m_hostQueryBegins.push_back((ElemType)i);
+                previousQueryId = queryId;
+            }
+        }
+        m_hostQueryBegins.push_back((ElemType)m_hostQueryIds.size());
+        m_queryBegins->SetValue(1, m_hostQueryBegins.size(), Value().GetDeviceId(), m_hostQueryBegins.data());
+    }
+
     void UpdateCounts()
     {
         FrameRange fr(Input(0)->GetMBLayout());
@@ -915,6 +1009,15 @@ protected:
     shared_ptr<Matrix<ElemType>> m_urlGain1;
     shared_ptr<Matrix<ElemType>> m_urlDiscount0;
     shared_ptr<Matrix<ElemType>> m_urlDiscount1;
+
+    // GPU: the columns at which the queries begin (and the end of the last), the rank of each url by its score, and the
+    // ideal metric and the metric of each query
+    shared_ptr<Matrix<ElemType>> m_queryBegins;
+    shared_ptr<Matrix<ElemType>> m_ranks;
+    shared_ptr<Matrix<ElemType>> m_metrics;
+    std::vector<ElemType> m_hostQueryIds;
+    std::vector<ElemType> m_hostQueryBegins;
+    std::vector<ElemType> m_hostMetrics;
 };
 
 template class LambdaRankNode<float>;
@@ -1202,6 +1305,32 @@ public:
         m_rngOffset = val;
     }
 
+    // With Globals::ShouldUseCounterBasedRandomStreams(), the values are not drawn from the RNGHandle but are a function of
+    // (seed, offset) (see CounterBasedRandom.h). The seed identifies the node (see ComputationNetwork::SetIRngUserSeed()) and
+    // the offset advances by the number of values drawn, i.e. from minibatch to minibatch. Nothing needs to be drawn in sequence,
+    // so that random nodes can run concurrently, and their values do not depend on the device or the number of threads.
+    static bool UsesCounterBasedRandomStream() { return Globals::ShouldUseCounterBasedRandomStreams(); }
+
+    // fill 'result' with the next values of the node's stream, from position 'offset'
+    template <class ElemType>
+    void SetCounterBasedRandomValue(Matrix<ElemType>& result, RandomDistribution distribution, ElemType a, ElemType b, uint64_t offset) const
+    {
+        result.SetCounterBasedRandomValue(distribution, a, b, GetCounterBasedRandomKey(), offset);
+    }
+
+    template <class ElemType>
+    void DrawCounterBasedRandomValue(Matrix<ElemType>& result, RandomDistribution distribution, ElemType a, ElemType b)
+    {
+        SetCounterBasedRandomValue(result, distribution, a, b, m_rngOffset);
+        m_rngOffset += result.GetNumElements();
+    }
+
+    // the seed as the key of SetCounterBasedRandomValue(), which takes an unsigned long that must not be USE_TIME_BASED_SEED
+    unsigned long GetCounterBasedRandomKey() const
+    {
+        return (unsigned long)((m_rngSeed ^ (m_rngSeed >> 32)) % USE_TIME_BASED_SEED);
+    }
+
 protected:
 
     void Load(File& fstream, size_t modelVersion)
@@ -1368,6 +1497,7 @@ public:
     virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override;
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false;}
+    virtual bool /*ComputationNodeBase::*/ IsHostBound() const override { return true; } // (the sampling runs on the CPU)
     virtual void /*ComputationNode::*/ ForwardPropNonLooping() override{}
     virtual bool GetAllowDuplicates() const { return m_allowDuplicates; }
     virtual size_t GetNumSamples() const { return m_sizeOfSampledSet; }
@@ -1456,6 +1586,91 @@ private:
     double EstimateNumberOfTries();
 };
 
+// ------------------------------------------------------------------------------------------------------------------------------------------------
+// SampledCrossEntropyWithSoftmaxNode(labels, hidden, outputWeights, outputBias, samplingWeights, numSamples):
+// Sampled softmax criterion for large output vocabularies, e.g. language models.
+// Each minibatch draws one set of numSamples negative classes that is shared by all frames, with a probability proportional to
+// samplingWeights (with replacement). The softmax of each frame is computed only over its label and the sampled classes, with the
+// logits z_c = h' * W[:,c] + b[c] - log(E[#samples of c]); sampled classes that equal the label of a frame are excluded for that frame.
+// The value is the sum of the sampled cross entropies over the frames. It is a training criterion, for evaluation use the full softmax.
+//
+// Everything is done on the device of the node: the samples are drawn with Walker's alias method from uniform random numbers, only the
+// columns of W of the labels and the samples are gathered, and the gradient of W is a sparse block-column matrix (as for a sparse input
+// to Times) whose nonzero columns are those of the labels and the samples.
+//
+// Parameters:
+// * Input(0): labels, one-hot [numClasses x T] (dense or sparse).
+// * Input(1): hidden activation [hiddenDim x T].
+// * Input(2): output weights [hiddenDim x numClasses], one column per class.
+// * Input(3): output bias [numClasses].
+// * Input(4): sampling weights [numClasses] >= 0, e.g. the unigram counts; not learnable. The alias table is rebuilt when its value changes.
+// * numSamples: number of negative classes per minibatch.
+// --------------------------------------------------------------------------------------------------------------------------------------------------
+template <class ElemType>
+class SampledCrossEntropyWithSoftmaxNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<5>, public RngUser
+{
+    typedef ComputationNodeNonLooping<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"SampledCrossEntropyWithSoftmax"; }
+
+public:
+    SampledCrossEntropyWithSoftmaxNode(DEVICEID_TYPE deviceId, const wstring& name, size_t numSamples = 0);
+
+    SampledCrossEntropyWithSoftmaxNode(const ScriptableObjects::IConfigRecordPtr configp)
+        : SampledCrossEntropyWithSoftmaxNode(configp->Get(L"deviceId"), L"<placeholder>", configp->Get(L"numSamples"))
+    {
+        AttachInputsFromConfig(configp, this->GetExpectedNumInputs());
+    }
+
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override;
+    virtual void Save(File& fstream) const override;
+    virtual void Load(File& fstream, size_t modelVersion) override;
+
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override;
+    virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override;
+    virtual void /*ComputationNodeNonLooping::*/ BackpropToNonLooping(size_t inputIndex) override;
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t childIndex) const override { return childIndex == 1; }
+    virtual bool IsOutOfDateWrtInputs() const override { return true; } // new samples for every minibatch
+
+    size_t GetNumSamples() const { return m_numSamples; }
+
+private:
+    void UpdateAliasTable();
+    void DrawSamples();
+    void ComputeLogitGradients();
+
+    size_t m_numSamples;
+
+    // Alias table of the sampling weights, as rows [1 x numClasses]: the probability to keep the drawn class, its alias,
+    // and the log of the expected number of samples of each class. Also a row with the class indices 0..numClasses-1.
+    shared_ptr<Matrix<ElemType>> m_keepProbability;
+    shared_ptr<Matrix<ElemType>> m_alias;
+    shared_ptr<Matrix<ElemType>> m_logExpectedCount;
+    shared_ptr<Matrix<ElemType>> m_classIndices;
+    uint64_t m_aliasTableTimeStamp;
+
+    // per minibatch: the classes [1 x (T + numSamples)], i.e. the labels followed by the samples,
+    // and their gathered columns of W [hiddenDim x (T + numSamples)] and b - log Q [1 x (T + numSamples)]
+    shared_ptr<Matrix<ElemType>> m_classes;
+    shared_ptr<Matrix<ElemType>> m_weights;
+    shared_ptr<Matrix<ElemType>> m_biasMinusLogQ;
+
+    // log softmax over [label; samples] of each frame [(1 + numSamples) x T],
+    // and the gradient of the criterion w.r.t. the logits of the labels [1 x T] and of the samples [numSamples x T]
+    shared_ptr<Matrix<ElemType>> m_logProbabilities;
+    shared_ptr<Matrix<ElemType>> m_labelLogitGradient;
+    shared_ptr<Matrix<ElemType>> m_sampleLogitGradient;
+    bool m_needRecomputeLogitGradients;
+
+    // temporaries
+    shared_ptr<Matrix<ElemType>> m_uniform;
+    shared_ptr<Matrix<ElemType>> m_samples;
+    shared_ptr<Matrix<ElemType>> m_temp;
+    shared_ptr<Matrix<ElemType>> m_temp2;
+    shared_ptr<Matrix<ElemType>> m_oneHotClasses; // sparse
+};
+
 // -----------------------------------------------------------------------
 // ClassBasedCrossEntropyWithSoftmaxNode (labeldata(.,t), inputdata(.,t), embeddingMatrix, clsProbBeforeSoftmaxData(.,t))
 //  - Input(0) [4 x T] label in dense matrix in
@@ -1489,39 +1704,116 @@ public:
           m_softMax(deviceId),
           m_grdToSoftMaxInput(deviceId),
           m_clsLogSoftmax(deviceId),
-          m_clsSoftmax(deviceId)
+          m_tokenInput(deviceId),
+          m_tokenGradient(deviceId),
+          m_tokenClsLogSoftmax(deviceId),
+          m_tokenClsGradient(deviceId),
+          m_clsObjective(deviceId),
+          m_columnIndices(deviceId),
+          m_targetMask(deviceId),
+          m_classMask(deviceId),
+          m_numTokens(0),
+          m_totalNbrWords(0)
     {
     }
 
 private:
-    // iterate over a large workspace that contains all class-conditioned probs concatenated
-    // 'sz' is the offset into that vector. We will iterate over these vectors at a few places. Always use this same boilerplate code.
-    template<class F>
-    size_t ForColumnsWithClass(const F& op)
-    {
-        const size_t nT = Input(LABELDATA)->GetNumTimeSteps();
-        const size_t nS = Input(LABELDATA)->GetNumParallelSequences();
-        size_t sz = 0; // iterate over the packed concatenated class-conditioned prob vectors
+    // The tokens of a minibatch are processed in groups of tokens with the same class, so that each class needs a single
+    // product with its slice of the weight matrix, instead of one per token. The tokens are gathered in group order
+    // ("token order"), and the class-conditioned probs of a group form a [numTokens x nbr_wrd] matrix in a large
+    // workspace that contains those of all groups concatenated.
+    struct ClassGroup
+    {
+        size_t lft_bnd;    // index of the first word belonging to the class
+        size_t nbr_wrd;    // number of words in the class
+        size_t firstToken; // first token of the group in token order
+        size_t numTokens;
+        size_t offset;     // offset of the group's class-conditioned probs in the workspace
+    };
+
+    // view of the class-conditioned values of a group in a workspace, as a [numTokens x nbr_wrd] matrix
+    static Matrix<ElemType> GroupSlice(const Matrix<ElemType>& workspace, const ClassGroup& group)
+    {
+        Matrix<ElemType> slice = workspace.ColumnSlice(group.offset, group.numTokens * group.nbr_wrd);
+        slice.Reshape(group.numTokens, group.nbr_wrd);
+        return slice;
+    }
+
+    // Groups the tokens of the minibatch by class, and uploads the column index of each token in token order, the
+    // one-hot targets within the class-conditioned probs, and the one-hot classes of the tokens.
+    // This is the only place where the labels are looked at on the CPU.
+    void PrepareClassGroups()
+    {
+        // get the label matrix to CPU, ideally in location=BOTH state
+        InputRef(LABELDATA).Value().TransferToDeviceIfNotThere(CPUDEVICE, /*ismoved =*/ false/*means: BOTH state OK*/, /*emptyTransfer =*/ false, /*updatePreferredDevice =*/ false);
+        const Matrix<ElemType>& labels = InputRef(LABELDATA).Value();
+        const auto& pMBLayout = InputRef(LABELDATA).GetMBLayout();
+        const size_t nT = pMBLayout->GetNumTimeSteps();
+        const size_t nS = pMBLayout->GetNumParallelSequences();
+
+        struct Token { size_t group, column, y_t, c_t; };
+        std::vector<Token> tokens;
+        std::map<size_t, size_t> groupOfClass;
+        m_groups.clear();
         for (size_t s = 0; s < nS; s++)
             for (size_t t = 0; t < nT; t++)
             {
-                FrameRange fr = FrameRange(Input(LABELDATA)->GetMBLayout(), t).Sequence(s);
-                if (Input(LABELDATA)->GetMBLayout()->IsGap(fr)) // skip gaps
+                if (pMBLayout->IsGap(FrameRange(pMBLayout, t).Sequence(s))) // skip gaps
                     continue;
 
-                const Matrix<ElemType>& lbl_t = Input(LABELDATA)->ValueFor(fr);
-                size_t y_t = (size_t)lbl_t(0, 0);     // current word token index
-                size_t c_t = (size_t)lbl_t(1, 0);     // current word token's class index
-                size_t lft_bnd = (size_t)lbl_t(2, 0); // index of first word belonging to current word token's class
-                size_t rgt_bnd = (size_t)lbl_t(3, 0); // and end of that range
-                size_t nbr_wrd = (rgt_bnd - lft_bnd); // number of words in the class
+                const size_t j = t * nS + s;
+                size_t y_t = (size_t)labels(0, j);     // current word token index
+                size_t c_t = (size_t)labels(1, j);     // current word token's class index
+                size_t lft_bnd = (size_t)labels(2, j); // index of first word belonging to current word token's class
+                size_t rgt_bnd = (size_t)labels(3, j); // and end of that range
+                size_t nbr_wrd = (rgt_bnd - lft_bnd);  // number of words in the class
+
+                if (nbr_wrd == 0)
+                    LogicError("ClassBasedCrossEntropyWithSoftmax: Encountered a class of size 0.");
+                if (y_t < lft_bnd || y_t >= lft_bnd + nbr_wrd)
+                    LogicError("ClassBasedCrossEntropyWithSoftmax: Word index out of bounds of class-member index range (word not a class member).");
+                if (c_t >= m_nbrCls)
+                    LogicError("ClassBasedCrossEntropyWithSoftmax: Class index %d out of bounds of the %d classes.", (int)c_t, (int)m_nbrCls);
+
+                auto iter = groupOfClass.insert(make_pair(c_t, m_groups.size())).first;
+                if (iter->second == m_groups.size())
+                    m_groups.push_back(ClassGroup{ lft_bnd, nbr_wrd, 0, 0, 0 });
+                auto& group = m_groups[iter->second];
+                if (group.lft_bnd != lft_bnd || group.nbr_wrd != nbr_wrd)
+                    LogicError("ClassBasedCrossEntropyWithSoftmax: Inconsistent class-member index ranges for class %d.", (int)c_t);
+                group.numTokens++;
+                tokens.push_back(Token{ iter->second, j, y_t, c_t });
+            }
 
-                // perform the operation
-                op(s, t, fr, y_t, c_t, sz, lft_bnd, nbr_wrd);
+        // lay out the groups
+        m_numTokens = 0;
+        m_totalNbrWords = 0;
+        for (auto& group : m_groups)
+        {
+            group.firstToken = m_numTokens;
+            group.offset = m_totalNbrWords;
+            m_numTokens += group.numTokens;
+            m_totalNbrWords += group.numTokens * group.nbr_wrd;
+        }
+        if (m_numTokens == 0)
+            return;
 
-                sz += nbr_wrd;
-            }
-        return sz;
+        m_hostColumnIndices.resize(m_numTokens);
+        m_hostTargetMask.assign(m_totalNbrWords, 0);
+        m_hostClassMask.assign(m_nbrCls * m_numTokens, 0);
+        std::vector<size_t> numTokensInGroup(m_groups.size(), 0);
+        for (const auto& token : tokens)
+        {
+            const auto& group = m_groups[token.group];
+            size_t r = numTokensInGroup[token.group]++; // row of the token in the group
+            size_t k = group.firstToken + r;            // index of the token in token order
+            m_hostColumnIndices[k] = (ElemType)token.column;
+            m_hostTargetMask[group.offset + r + (token.y_t - group.lft_bnd) * group.numTokens] = 1;
+            m_hostClassMask[token.c_t + k * m_nbrCls] = 1;
+        }
+        m_columnIndices.SetValue(1, m_numTokens, m_deviceId, m_hostColumnIndices.data());
+        m_targetMask.SetValue(1, m_totalNbrWords, m_deviceId, m_hostTargetMask.data());
+        m_classMask.SetValue(m_nbrCls, m_numTokens, m_deviceId, m_hostClassMask.data());
     }
 
     // compute gradients to input observations, the weights to the observations, and the class log posterior probabilites
@@ -1531,67 +1823,62 @@ private:
         if (inputIndex != 1 && inputIndex != 2 && inputIndex != 3)
             InvalidArgument("ClassCrossEntropyWithSoftmaxNode criterion only takes with respect to input, weight to the input and class log posterior probability.");
 
+        if (m_numTokens == 0)
+            return;
+
         ComputeSoftMaxPartial(); // Note: Flag m_needRecomputeGradientToSoftmaxInput guards so that this computes only once.
 
-        ForColumnsWithClass([&](size_t /*s*/, size_t /*t*/, const FrameRange& fr, size_t /*y_t*/, size_t c_t, size_t sz, size_t lft_bnd, size_t nbr_wrd)
+        switch (inputIndex)
         {
-            // compute prb - 1 and prb
-            Matrix<ElemType> weightForClass = InputRef(EMBEDDINGMATRIX).ValueAsMatrix().ColumnSlice(lft_bnd, nbr_wrd);
-            Matrix<ElemType> obs = InputRef(INPUTDATA).ValueFor(fr); // hidden activation vector for current word token
-            Matrix<ElemType> grd_to_soft_max_input = m_grdToSoftMaxInput.ColumnSlice(sz, nbr_wrd);
-
-            switch (inputIndex)
+            case 1:
             {
-                case 1:
+                // gradient to input, computed in token order and then added to the columns of the tokens
+                m_tokenGradient.Resize(InputRef(INPUTDATA).GetSampleMatrixNumRows(), m_numTokens);
+                for (const auto& group : m_groups)
                 {
-                    // gradient to input
-                    Matrix<ElemType> grd_t = InputRef(INPUTDATA).GradientFor(fr);
-                    Matrix<ElemType>::MultiplyAndAdd(weightForClass, false, grd_to_soft_max_input, true, grd_t);
-                    break;
+                    Matrix<ElemType> weightForClass = InputRef(EMBEDDINGMATRIX).ValueAsMatrix().ColumnSlice(group.lft_bnd, group.nbr_wrd);
+                    Matrix<ElemType> grd_to_soft_max_input = GroupSlice(m_grdToSoftMaxInput, group);
+                    Matrix<ElemType> grd_t = m_tokenGradient.ColumnSlice(group.firstToken, group.numTokens);
+                    grd_t.AssignProductOf(weightForClass, false, grd_to_soft_max_input, true); // -> hdSize x numTokens
                 }
-                case 2:
+                InputRef(INPUTDATA).Gradient().DoScatterColumnsOf(/*beta=*/1, m_columnIndices, m_tokenGradient, /*alpha=*/1);
+                break;
+            }
+            case 2:
+            {
+                // gradient to input weight
+                for (const auto& group : m_groups)
                 {
-                    // gradient to input weight
-                    Matrix<ElemType> grd_to_wgt_t = InputRef(EMBEDDINGMATRIX).GradientAsMatrix().ColumnSlice(lft_bnd, nbr_wrd);
+                    Matrix<ElemType> obs = m_tokenInput.ColumnSlice(group.firstToken, group.numTokens); // hidden activation vectors of the group's tokens
+                    Matrix<ElemType> grd_to_soft_max_input = GroupSlice(m_grdToSoftMaxInput, group);
+                    Matrix<ElemType> grd_to_wgt_t = InputRef(EMBEDDINGMATRIX).GradientAsMatrix().ColumnSlice(group.lft_bnd, group.nbr_wrd);
                     Matrix<ElemType>::MultiplyAndAdd(obs, false, grd_to_soft_max_input, false, grd_to_wgt_t);
-                    break;
-                }
-                case 3:
-                {
-                    Matrix<ElemType> grd_t = InputRef(CLASSPROBINDATA).GradientFor(fr);
-                    grd_t.AssignValuesOf(InputRef(CLASSPROBINDATA).DataFor(m_clsSoftmax, fr));
-                    ComputeCEPartialToSoftmaxInputs(grd_t, Gradient(), c_t);
-                    break;
                 }
+                break;
             }
-        });
+            case 3:
+            {
+                // (softmax - 1 at the class) of each token, assigned to the columns of the tokens
+                m_tokenClsGradient.AssignExpOf(m_tokenClsLogSoftmax);
+                m_tokenClsGradient -= m_classMask;
+                Matrix<ElemType>::Scale(Gradient(), m_tokenClsGradient);
+                InputRef(CLASSPROBINDATA).Gradient().DoScatterColumnsOf(/*beta=*/0, m_columnIndices, m_tokenClsGradient, /*alpha=*/1);
+                break;
+            }
+        }
     }
 
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
 
 private:
-    void ComputeCEPartialToSoftmaxInputs(Matrix<ElemType>& inputGradientValues, Matrix<ElemType>& gradientValues, size_t y_t)
-    {
-        Matrix<ElemType>::MinusOneAt(inputGradientValues, y_t);
-        Matrix<ElemType>::Scale(gradientValues, inputGradientValues);
-    }
-
     // gradient of cross entropy w.r.t. to input to softmax
     void ComputeSoftMaxPartial()
     {
         if (m_needRecomputeGradientToSoftmaxInput)
         {
-            m_grdToSoftMaxInput.Resize(1, m_totalNbrWords); // buffer that contains a concatenation of class-conditional values
-
-            ForColumnsWithClass([&](size_t /*s*/, size_t /*t*/, const FrameRange& /*fr*/, size_t y_t, size_t /*c_t*/, size_t sz, size_t lft_bnd, size_t nbr_wrd)
-            {
-                Matrix<ElemType> softMax = m_softMax.ColumnSlice(sz, nbr_wrd);
-
-                size_t idx_in_class = y_t - lft_bnd;
-                ComputeCEPartialToSoftmaxInputs(softMax, Gradient(), idx_in_class);
-
-                m_grdToSoftMaxInput.ColumnSlice(sz, nbr_wrd).AssignValuesOf(softMax);
-            });
+            // (softmax - 1 at the word) of all class-conditional distributions at once
+            m_grdToSoftMaxInput.AssignDifferenceOf(m_softMax, m_targetMask);
+            Matrix<ElemType>::Scale(Gradient(), m_grdToSoftMaxInput);
 
             m_needRecomputeGradientToSoftmaxInput = false;
         }
@@ -1606,76 +1893,57 @@ public:
     // -sum(left_i * log(softmax_i(right)))
     virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override
     {
-        // get the label matrix to CPU, ideally in location=BOTH state
-        InputRef(LABELDATA).Value().TransferToDeviceIfNotThere(CPUDEVICE, /*ismoved =*/ false/*means: BOTH state OK*/, /*emptyTransfer =*/ false, /*updatePreferredDevice =*/ false);
-
         auto& functionValues = Value();
 
-        const size_t hdSize = InputRef(INPUTDATA).GetSampleMatrixNumRows();
         assert(m_nbrCls == InputRef(CLASSPROBINDATA).GetSampleMatrixNumRows());
 
+        PrepareClassGroups();
+        m_needRecomputeGradientToSoftmaxInput = true;
+        if (m_numTokens == 0)
+        {
+            functionValues.SetValue(0);
+            return;
+        }
+
         // compute the class posteriors
         m_clsLogSoftmax.SetValue(InputRef(CLASSPROBINDATA).Value());
-        m_clsLogSoftmax.InplaceLogSoftmax(true);   // log
-        m_clsSoftmax.AssignExpOf(m_clsLogSoftmax); // non-log
+        m_clsLogSoftmax.InplaceLogSoftmax(true); // log
 
-        // create a large workspace to contain all class-conditioned probs concatenated
-        m_totalNbrWords = ForColumnsWithClass([](size_t /*s*/, size_t /*t*/, const FrameRange& /*fr*/, size_t y_t, size_t /*c_t*/, size_t /*sz*/, size_t lft_bnd, size_t nbr_wrd)
-        {
-            if (nbr_wrd == 0)
-                LogicError("ClassBasedCrossEntropyWithSoftmax: Encountered a class of size 0.");
-            if (y_t < lft_bnd || y_t >= lft_bnd + nbr_wrd)
-                LogicError("ClassBasedCrossEntropyWithSoftmax: Word index out of bounds of class-member index range (word not a class member).");
-        });
-        // now m_totalNbrWords = total size of concatenated vector
+        // gather the hidden activations and class log posteriors of the tokens in token order
+        m_tokenInput.DoGatherColumnsOf(/*beta=*/0, m_columnIndices, InputRef(INPUTDATA).Value(), /*alpha=*/1);
+        m_tokenClsLogSoftmax.DoGatherColumnsOf(/*beta=*/0, m_columnIndices, m_clsLogSoftmax, /*alpha=*/1);
 
         // buffer to hold the concatenated class-conditioned prob vectors
         m_softMax.Resize(1, m_totalNbrWords);
         m_logSoftmax.Resize(1, m_totalNbrWords);
 
-        // accumulate objective
-        functionValues.SetValue(0);
-        ForColumnsWithClass([&](size_t s, size_t t, const FrameRange& fr, size_t y_t, size_t c_t, size_t sz, size_t lft_bnd, size_t nbr_wrd)
+        for (const auto& group : m_groups)
         {
-            // now get views of various arrays that correspond to the index range of words belonging to this class
+            // get the weights for the words in this class
+            Matrix<ElemType> weightForClass = InputRef(EMBEDDINGMATRIX).ValueAsMatrix().ColumnSlice(group.lft_bnd, group.nbr_wrd); // [hdSize x nbr_wrd]
+            Matrix<ElemType> obs = m_tokenInput.ColumnSlice(group.firstToken, group.numTokens);                                 // [hdSize x numTokens]
 
-            // get hidden vectors for the words in this class
-            Matrix<ElemType> weightForClass = InputRef(EMBEDDINGMATRIX).ValueAsMatrix().ColumnSlice(lft_bnd, nbr_wrd); // [hdSize x nbr_wrd]
+            // multiply the hidden activations with the slice of the weight matrix for the range of class members
+            Matrix<ElemType> logSoftMax_t = GroupSlice(m_logSoftmax, group);
+            logSoftMax_t.AssignProductOf(obs, true, weightForClass, false); // -> numTokens x nbr_wrd
 
-            // buffer to hold the class-conditional distribution
-            Matrix<ElemType> softMax_t = m_softMax.ColumnSlice(sz, nbr_wrd); // TODO: declare these outside of the loop to avoid the malloc
-            Matrix<ElemType> logSoftMax_t = m_logSoftmax.ColumnSlice(sz, nbr_wrd);
-
-            Matrix<ElemType> obs = InputRef(INPUTDATA).ValueFor(fr); // hidden activation vector for current word token
-
-            // multiply hidden activation with weight matrix (the slice of the weight matrix for the range of class members)
-            // TODO: can we use 'true' here instead? Above transposition hack won't work with row slices. 'obs' not used elsewhere
-            obs.Reshape(1, hdSize);                                                                                // transpose it (make it a column vector)
-            logSoftMax_t.AssignProductOf(obs /*(1 x hdSize)*/, false, weightForClass /*hdSize x nbr_wrd*/, false); // -> 1 x nbr_word
-
-            // log softmax(W x_t)
+            // log softmax(W x_t) for each token
             logSoftMax_t.InplaceLogSoftmax(false);
+        }
 
-            // and non-log version
-            softMax_t.SetValue(logSoftMax_t);
-            softMax_t.InplaceExp();
-            // we now have a column vector of class-conditional probabilities over the class members
-
-            // add  the word's class-conditional log posterior
-            size_t idx_in_class = y_t - lft_bnd;
-            Matrix<ElemType>::AddElementToElement(logSoftMax_t, 0, idx_in_class, functionValues, 0, 0); // (1x1)
-
-            // add the class log posterior probability (for backprop)
-            auto clsLogSoftmax_t = InputRef(CLASSPROBINDATA).DataFor(m_clsLogSoftmax, fr);
-            Matrix<ElemType>::AddElementToElement(clsLogSoftmax_t, c_t, 0, functionValues, 0, 0); // (1x1)
-        });
+        // and non-log version
+        // We now have a row vector of class-conditional probabilities over the class members for each token.
+        m_softMax.AssignExpOf(m_logSoftmax);
 
+        // accumulate objective: the words' class-conditional log posteriors and the classes' log posteriors
+        functionValues.AssignInnerProductOfMatrices(m_logSoftmax, m_targetMask);
+        m_clsObjective.AssignInnerProductOfMatrices(m_tokenClsLogSoftmax, m_classMask);
+        functionValues += m_clsObjective;
         functionValues *= (-1);
 
 #if NANCHECK
         functionValues.HasNan("ClassBasedCrossEntropyWithSoftmax");
 #endif
-        m_needRecomputeGradientToSoftmaxInput = true;
     }
 
     virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
@@ -1699,19 +1967,34 @@ public:
     }
 
 protected:
+    // the class-conditioned probs of all groups concatenated, see ClassGroup
     Matrix<ElemType> m_logSoftmax;
     Matrix<ElemType> m_softMax;
 
     Matrix<ElemType> m_clsLogSoftmax;
-    Matrix<ElemType> m_clsSoftmax;
 
-    // gradient of cross entropy with respect to the input of softmax
-    // a 1 row by \sum_t m_nbrWordsInEachTime[t] vector
-    // one slice of size m_nbrWordsInEachTime[t] saves the input to softmax for word y_t
+    // gradient of cross entropy with respect to the input of softmax, in the same layout as m_softMax
     Matrix<ElemType> m_grdToSoftMaxInput;
     bool m_needRecomputeGradientToSoftmaxInput;
 
+    // the values of the tokens in token order
+    Matrix<ElemType> m_tokenInput;         // [hdSize x m_numTokens]
+    Matrix<ElemType> m_tokenGradient;      // [hdSize x m_numTokens]
+    Matrix<ElemType> m_tokenClsLogSoftmax; // [m_nbrCls x m_numTokens]
+    Matrix<ElemType> m_tokenClsGradient;   // [m_nbrCls x m_numTokens]
+    Matrix<ElemType> m_clsObjective;       // [1 x 1]
+
+    // uploaded by PrepareClassGroups()
+    Matrix<ElemType> m_columnIndices;      // [1 x m_numTokens] column of each token in the minibatch
+    Matrix<ElemType> m_targetMask;         // [1 x m_totalNbrWords] 1 at each token's word in its class-conditioned probs
+    Matrix<ElemType> m_classMask;          // [m_nbrCls x m_numTokens] 1 at each token's class
+    std::vector<ElemType> m_hostColumnIndices;
+    std::vector<ElemType> m_hostTargetMask;
+    std::vector<ElemType> m_hostClassMask;
+
+    std::vector<ClassGroup> m_groups;
     size_t m_nbrCls;
+    size_t m_numTokens;
     size_t m_totalNbrWords;
 };
 
@@ -2254,6 +2537,24 @@ public:
         Matrix<ElemType> sliceInput0Grad = InputRef(0).GradientFor(fr);
         Matrix<ElemType> sliceOutputGrad = GradientFor(fr);
 
+        if (IsEnabled() && RegeneratesMask())
+        {
+            // draw the mask of ForwardProp() again; the matrix was only borrowed from the pool in between
+            m_maskOfDropout->Resize(Input(0)->Value());
+            if (UsesCounterBasedRandomStream())
+            {
+                auto sliceMask = DataFor(*m_maskOfDropout, fr);
+                SetCounterBasedRandomValue(sliceMask, RandomDistribution::Bernoulli, (ElemType)GetDropoutRate(), (ElemType)(1.0 / (1.0 - GetDropoutRate())) /*pre-scaled*/, m_maskRngOffset);
+            }
+            else
+            {
+                auto& rngHandle = GetRNGHandle();
+                rngHandle.RewindToMark();
+                DataFor(*m_maskOfDropout, fr).SetUniformRandomMask((ElemType)GetDropoutRate(), (ElemType)(1.0 / (1.0 - GetDropoutRate())) /*pre-scaled*/, rngHandle);
+                rngHandle.Resume(GetRngOffset());
+            }
+        }
+
         if (InputRef(0).IsGradientInitializedBy(this))
         {
             if (IsEnabled())
@@ -2298,10 +2599,20 @@ public:
         {
             // determine drop-out mask for this minibatch
             auto sliceMask = DataFor(*m_maskOfDropout, fr);
-            sliceMask.SetUniformRandomMask((ElemType)GetDropoutRate(), (ElemType)(1.0 / (1.0 - GetDropoutRate())) /*pre-scaled*/, GetRNGHandle());
+            if (UsesCounterBasedRandomStream())
+            {
+                m_maskRngOffset = GetRngOffset(); // (where BackpropTo() draws the mask again)
+                DrawCounterBasedRandomValue(sliceMask, RandomDistribution::Bernoulli, (ElemType)GetDropoutRate(), (ElemType)(1.0 / (1.0 - GetDropoutRate())) /*pre-scaled*/);
+            }
+            else
+            {
+                if (RegeneratesMask())
+                    GetRNGHandle().Mark(GetRngOffset());
+                sliceMask.SetUniformRandomMask((ElemType)GetDropoutRate(), (ElemType)(1.0 / (1.0 - GetDropoutRate())) /*pre-scaled*/, GetRNGHandle());
+                UpdateRngOffset(GetRngOffset() + sliceMask.GetNumElements());
+            }
             // apply dropout mask
             sliceOutputValue.AssignElementProductOf(sliceMask, sliceInput0Value);
-            UpdateRngOffset(GetRngOffset() + sliceMask.GetNumElements());
         }
     }
 
@@ -2333,6 +2644,21 @@ public:
         RequestMatrixFromPool(m_maskOfDropout, matrixPool);
     }
 
+    // The mask is not kept from ForwardProp() to BackpropTo(), but drawn again from the same position of the random number generator.
+    // This trades a second pass of the generator for one buffer of the input's size per dropout node while the gradients are computed.
+    virtual void ReleaseMatricesAfterForwardProp(MatrixPool& matrixPool)
+    {
+        Base::ReleaseMatricesAfterForwardProp(matrixPool);
+        if (RegeneratesMask())
+            ReleaseMatrixToPool(m_maskOfDropout, matrixPool);
+    }
+
+    virtual void RequestMatricesBeforeBackprop(MatrixPool& matrixPool)
+    {
+        Base::RequestMatricesBeforeBackprop(matrixPool);
+        RequestMatrixFromPool(m_maskOfDropout, matrixPool);
+    }
+
     // release gradient and temp matrices that no longer needed after all the children's gradients are computed.
     virtual void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool)
     {
@@ -2341,7 +2667,12 @@ public:
     }
 
 private:
+    // Inside a loop the mask of each time step is drawn separately, and the steps are backpropagated in reverse order,
+    // so the mask is kept instead.
+    bool RegeneratesMask() const { return !IsPartOfLoop(); }
+
     shared_ptr<Matrix<ElemType>> m_maskOfDropout;
+    uint64_t m_maskRngOffset = 0; // the position of the mask in the counter-based stream
 };
 
 // -----------------------------------------------------------------------
@@ -2808,7 +3139,8 @@ public:
             auto paramLayout = Input(i)->GetSampleLayout();
             if (paramLayout.GetRank() == 2 && paramLayout[0] == 0 && paramLayout[1] == 1 && inputLayout.GetNumElements() > 0) // [0 x 1]
             {
-                size_t total = m_spatial ? inputLayout.GetDims().back() : inputLayout.GetNumElements();
+                // (the channel dimension is the last one in CHW layout and the first one in HWC layout)
+                size_t total = !m_spatial ? inputLayout.GetNumElements() : m_imageLayoutKind == ImageLayoutKind::HWC ? inputLayout[0] : inputLayout.GetDims().back();
                 Input(i)->ValidateInferInputDimsFrom(TensorShape(total, 1));
             }
         }
@@ -2860,14 +3192,6 @@ public:
                     InvalidArgument("%ls: Input[%d] must be a vector of 1 element without dynamic axis.", NodeDescription().c_str(), (int)i);
                 RunCount(); // cache the shared value into the local cache, for 0 checks
             }
-            if (m_spatial && m_imageLayoutKind != CHW)
-            {
-                InvalidArgument(
-                    "%ls %ls currently supports only cuDNN (CHW) data layout. " 
-                    "Please specify imageLayout=\"cudnn\" in BatchNormalization node in your NDL/BrainScript "
-                    "and make sure your input data layout is CHW", NodeName().c_str(), OperationName().c_str());
-            }
-
             if (!m_useCntkEngine)
             {
                 // Fallback to cntk engine on CPU device if cuDnn is not available,
@@ -2898,14 +3222,20 @@ public:
                 InvalidArgument("%ls %ls requires blend time constant to be >= 0.", NodeName().c_str(), OperationName().c_str());
 
             if (m_bnEng == nullptr)
-            {
-                auto shape = GetSampleLayout();
-                m_bnEng = BatchNormEngine<ElemType>::Create(m_deviceId, shape, m_spatial, m_imageLayoutKind,
-                                                            m_useCntkEngine ? BatchNormEngineKind::Cntk : BatchNormEngineKind::CuDnn);
-            }
+                CreateEngine();
         }
     }
 
+private:
+    void CreateEngine()
+    {
+        auto shape = GetSampleLayout();
+        m_bnEng = BatchNormEngine<ElemType>::Create(m_deviceId, shape, m_spatial, m_imageLayoutKind,
+                                                    m_useCntkEngine ? BatchNormEngineKind::Cntk : BatchNormEngineKind::CuDnn,
+                                                    m_syncWorkers);
+    }
+
+public:
     void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) override
     {
         Base::RequestMatricesBeforeForwardProp(matrixPool);
@@ -2942,6 +3272,17 @@ public:
             m_blendTimeConst = blendTimeConstant;
     }
 
+    // Called from the SGD solver for data-parallel training: with workers, the minibatch statistics in training are
+    // computed over the minibatches of all of them (synchronized batch normalization); nullptr turns this off.
+    void SetSyncWorkers(const shared_ptr<MPIWrapper>& syncWorkers)
+    {
+        if (syncWorkers == m_syncWorkers)
+            return;
+        m_syncWorkers = syncWorkers;
+        if (m_bnEng != nullptr) // (otherwise created in validation)
+            CreateEngine();
+    }
+
     // called from CloneFunction(..., parameters="constant")
     // Once called, this node is put into inference mode.
     virtual void FreezeParameters() override // from IFreezable
@@ -3050,6 +3391,7 @@ private:
     bool m_gradientValid = false;
 
     std::unique_ptr<BatchNormEngine<ElemType>> m_bnEng;
+    shared_ptr<MPIWrapper> m_syncWorkers; // workers over whose minibatches the statistics are synchronized, if any
 
     bool m_convertRunningVariancePending;
 };
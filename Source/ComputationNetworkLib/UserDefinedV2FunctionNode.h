@@ -22,6 +22,8 @@ class OutputMultiplexerNode;
 // The actual implementation of the operation itself is external to the CNTK engine.
 // -----------------------------------------------------------------------
 
+// If the external Function implements ::CNTK::UserFunctionKernel, it is computed directly on the
+// (packed) values and gradients of the engine, instead of through Value objects.
 // TODO: We currently only support external nodes that cannot be part of CNTK recurrent loops
 template <class ElemType>
 class UserDefinedV2FunctionNode final : public ComputationNodeNonLooping<ElemType>, public MultiOutputNode<ElemType>
@@ -33,7 +35,8 @@ class UserDefinedV2FunctionNode final : public ComputationNodeNonLooping<ElemTyp
 
 public:
     UserDefinedV2FunctionNode(DEVICEID_TYPE deviceId, const wstring& name, const ::CNTK::FunctionPtr& externalFunction = nullptr)
-        : Base(deviceId, name), m_externalFunction(externalFunction), MultiOutputNode<ElemType>(externalFunction ? externalFunction->Outputs().size() : 0)
+        : Base(deviceId, name), m_externalFunction(externalFunction), MultiOutputNode<ElemType>(externalFunction ? externalFunction->Outputs().size() : 0),
+          m_kernel(dynamic_cast<::CNTK::UserFunctionKernel*>(externalFunction.get())), m_kernelBackpropPending(false)
     {
         if (!m_externalFunction)
             LogicError("UserDefinedV2FunctionNode ctor should never be called with externalFunction == nullptr");
@@ -49,6 +52,12 @@ public:
     {
         this->m_outputsValue[0] = m_value;
 
+        if (m_kernel)
+        {
+            ForwardPropKernel();
+            return;
+        }
+
         // Get the arguments of the external function
         auto arguments = m_externalFunction->Arguments();
         std::unordered_map<::CNTK::Variable, ::CNTK::ValuePtr> argumentValues;
@@ -124,6 +133,16 @@ public:
 
     virtual void BackpropToNonLooping(size_t /*inputIndex*/) override
     {
+        if (m_kernel)
+        {
+            // the kernel computes the gradients of all inputs at once
+            if (m_kernelBackpropPending)
+                BackpropKernel();
+
+            m_kernelBackpropPending = false;
+            return;
+        }
+
         if (m_currentBackpropStatePtr == nullptr)
             return;
 
@@ -149,13 +168,7 @@ public:
             outputGradientValues.insert({ output, gradientValue });
         }
 
-        std::vector<::CNTK::Variable> externalFunctionUniqueInputs;
-        auto externalFunctionInputs = m_externalFunction->Inputs();
-        for (auto input : externalFunctionInputs)
-        {
-            if (std::find(externalFunctionUniqueInputs.begin(), externalFunctionUniqueInputs.end(), input) == externalFunctionUniqueInputs.end())
-                externalFunctionUniqueInputs.push_back(input);
-        }
+        auto externalFunctionUniqueInputs = UniqueInputs();
 
         std::unordered_map<::CNTK::Variable, ::CNTK::ValuePtr> inputGradientValues;
         for (size_t i = 0; i < externalFunctionUniqueInputs.size(); ++i)
@@ -212,6 +225,9 @@ public:
             }
 
             auto outputNDShape = output.Shape();
+            if (m_kernel && isFinalValidationPass && outputNDShape.HasUnboundDimension())
+                LogicError("The output shape '%S' of the user defined Function '%S' computed by its kernel must be fully defined.", outputNDShape.AsString().c_str(), m_externalFunction->AsString().c_str());
+
             if (layoutNotInitialized)
             {
                 auto outputDynamicAxes = output.DynamicAxes();
@@ -220,6 +236,17 @@ public:
                     this->m_outputsHasNewMBLayout[i] = true;
                     this->m_outputsMBLayout[i] = nullptr;
                 }
+                else if (m_kernel)
+                {
+                    // the kernel computes on the packed inputs, so its outputs have the layout of the inputs
+                    auto uniqueInputs = UniqueInputs();
+                    auto inputWithLayout = std::find_if(uniqueInputs.begin(), uniqueInputs.end(), [](const ::CNTK::Variable& input) { return !input.DynamicAxes().empty(); });
+                    if ((inputWithLayout == uniqueInputs.end()) || (inputWithLayout->DynamicAxes() != outputDynamicAxes))
+                        LogicError("The output '%S' of the user defined Function '%S' computed by its kernel must have the dynamic axes of its inputs.", output.AsString().c_str(), m_externalFunction->AsString().c_str());
+
+                    this->m_outputsMBLayout[i] = InputRef(inputWithLayout - uniqueInputs.begin()).GetMBLayout();
+                    this->m_outputsHasNewMBLayout[i] = false;
+                }
                 else
                 {
                     this->m_outputsMBLayout[i] = make_shared<MBLayout>(); // this generates a new layout
@@ -247,8 +274,94 @@ public:
     }
 
 private:
+    // the inputs of the external function, in the order of the inputs of this node
+    std::vector<::CNTK::Variable> UniqueInputs() const
+    {
+        std::vector<::CNTK::Variable> externalFunctionUniqueInputs;
+        auto externalFunctionInputs = m_externalFunction->Inputs();
+        for (auto input : externalFunctionInputs)
+        {
+            if (std::find(externalFunctionUniqueInputs.begin(), externalFunctionUniqueInputs.end(), input) == externalFunctionUniqueInputs.end())
+                externalFunctionUniqueInputs.push_back(input);
+        }
+        return externalFunctionUniqueInputs;
+    }
+
+    std::vector<::CNTK::NDArrayViewPtr> InputValueViews()
+    {
+        std::vector<::CNTK::NDArrayViewPtr> views;
+        for (size_t i = 0; i < GetNumInputs(); ++i)
+            views.push_back(::CNTK::Utils::GetNDArrayViewAliasOfCNTKImplMatrix(::CNTK::AsNDShape(InputRef(i).GetSampleLayout()), InputRef(i).Value(), InputRef(i).GetMBLayout(), /*readOnly=*/ true));
+        return views;
+    }
+
+    std::vector<::CNTK::NDArrayViewPtr> OutputValueViews(bool readOnly)
+    {
+        std::vector<::CNTK::NDArrayViewPtr> views;
+        for (size_t i = 0; i < this->m_numOutputs; ++i)
+            views.push_back(::CNTK::Utils::GetNDArrayViewAliasOfCNTKImplMatrix(::CNTK::AsNDShape(this->m_outputsShape[i]), *this->m_outputsValue[i], this->m_outputsMBLayout[i], readOnly));
+        return views;
+    }
+
+    // Computes the outputs in place: The kernel writes into views of the output matrices, without Value objects.
+    void ForwardPropKernel()
+    {
+        for (size_t i = 0; i < this->m_numOutputs; ++i)
+        {
+            auto& layout = this->m_outputsMBLayout[i];
+            this->m_outputsValue[i]->Resize(this->m_outputsShape[i].GetNumElements(), layout ? layout->GetNumCols() : 1);
+        }
+
+        m_kernel->ForwardKernel(InputValueViews(), OutputValueViews(/*readOnly=*/ false), Environment().IsTraining());
+        m_kernelBackpropPending = Environment().IsTraining();
+    }
+
+    // Accumulates into the input gradients in place. The gaps of the input values and output gradients are
+    // masked to zero, so that a kernel that reduces over the minibatch (e.g. for the gradient of a weight)
+    // does not have to know the layout.
+    void BackpropKernel()
+    {
+        this->m_outputsGradient[0] = m_gradient;
+
+        auto outputs = m_externalFunction->Outputs();
+        std::vector<::CNTK::NDArrayViewPtr> outputGradients(outputs.size());
+        for (size_t i = 0; i < outputs.size(); ++i)
+        {
+            if (!outputs[i].NeedsGradient() || !this->m_outputsGradient[i])
+                continue;
+
+            auto& layout = this->m_outputsMBLayout[i];
+            if (layout)
+                MaskMissingColumnsToZero(*this->m_outputsGradient[i], layout, FrameRange(layout));
+
+            outputGradients[i] = ::CNTK::Utils::GetNDArrayViewAliasOfCNTKImplMatrix(::CNTK::AsNDShape(this->m_outputsShape[i]), *this->m_outputsGradient[i], layout, /*readOnly=*/ true);
+        }
+
+        if (std::none_of(outputGradients.begin(), outputGradients.end(), [](const ::CNTK::NDArrayViewPtr& view) { return view != nullptr; }))
+            return;
+
+        std::vector<::CNTK::NDArrayViewPtr> inputGradients(GetNumInputs());
+        for (size_t i = 0; i < GetNumInputs(); ++i)
+        {
+            auto& input = InputRef(i);
+            if (input.HasMBLayout())
+                input.MaskMissingValueColumnsToZero(FrameRange(input.GetMBLayout()));
+
+            if (!input.NeedsGradient())
+                continue;
+
+            input.LazyZeroGradient(this); // set gradient to 0 if this is the first time
+            inputGradients[i] = ::CNTK::Utils::GetNDArrayViewAliasOfCNTKImplMatrix(::CNTK::AsNDShape(input.GetSampleLayout()), input.Gradient(), input.GetMBLayout(), /*readOnly=*/ false);
+        }
+
+        m_kernel->BackwardKernel(InputValueViews(), OutputValueViews(/*readOnly=*/ true), outputGradients, inputGradients);
+    }
+
     ::CNTK::FunctionPtr m_externalFunction;
     ::CNTK::BackPropStatePtr m_currentBackpropStatePtr;
+
+    ::CNTK::UserFunctionKernel* m_kernel; // the external function, if it computes on the buffers of the engine
+    bool m_kernelBackpropPending;         // the kernel has computed the outputs for training, and not yet the gradients
 };
 
 template class UserDefinedV2FunctionNode<float>;
@@ -268,6 +268,7 @@ void CNTKEvalExtended<ElemType>::StartForwardEvaluation(const std::vector<wstrin
     }
 
     m_started = true;
+    m_streamsPrepared = false;
 }
 
 template<typename ElemType>
@@ -300,9 +301,10 @@ VariableSchema CNTKEvalExtended<ElemType>::GetInputSchema() const
     return inputLayouts;
 }
 
+// set the inputs and run the forward pass
 template<typename ElemType>
 template<template<typename> class ValueContainer>
-void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<ElemType, ValueContainer> >& inputs, std::vector<ValueBuffer<ElemType, ValueContainer> >& outputs, bool resetRNN)
+void CNTKEvalExtended<ElemType>::ForwardInputsT(const std::vector<ValueBuffer<ElemType, ValueContainer> >& inputs, bool resetRNN)
 {
     if (!m_started)
         RuntimeError("ForwardPass() called before StartForwardEvaluation()");
@@ -310,9 +312,6 @@ void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<Elem
     if (inputs.size() != (size_t)std::distance(m_inputMatrices.begin(), m_inputMatrices.end()))
         RuntimeError("Expected %d inputs, but got %d.", (int)std::distance(m_inputMatrices.begin(), m_inputMatrices.end()), (int)inputs.size());
 
-    if (outputs.size() != m_outputNodes.size())
-        RuntimeError("Expected %d outputs, but got %d.", (int)m_outputNodes.size(), (int)outputs.size());
-
     size_t i = 0;
     for (auto& inputNode : m_inputNodes)
     {
@@ -372,36 +371,82 @@ void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<Elem
 
     ComputationNetwork::BumpEvalTimeStamp(m_inputNodes);
     this->m_net->ForwardProp(m_outputNodes);
+}
 
-    for (size_t i2 = 0; i2 < m_outputNodes.size(); ++i2)
+// copy the given matrix, the output of 'node' or a reduction of it, into the output buffer
+template<typename ElemType>
+template<template<typename> class ValueContainer>
+/*static*/ void CNTKEvalExtended<ElemType>::CopyOutput(const ComputationNodeBasePtr& node, const Matrix<ElemType>& matrix, ValueBuffer<ElemType, ValueContainer>& output)
+{
+    auto pMBLayout = node->GetMBLayout();
+    if (!pMBLayout)
     {
-        auto node = m_outputNodes[i2];
-        
-        shared_ptr<Matrix<ElemType>> outputMatrix = dynamic_pointer_cast<Matrix<ElemType>>(node->ValuePtr());
-        auto pMBLayout = node->GetMBLayout();
-        if (!pMBLayout)
-        {
-            pMBLayout = make_shared<MBLayout>();
-            pMBLayout->InitAsFrameMode(1); // treat this as if we have one single sample
-        }
+        pMBLayout = make_shared<MBLayout>();
+        pMBLayout->InitAsFrameMode(1); // treat this as if we have one single sample
+    }
+
+    const auto& seq = pMBLayout->GetAllSequences();
+    if (seq.size() != 1)
+        RuntimeError("Only 1 output sequence supported by this API");
+
+    ValueContainer<ElemType>& vec = output.m_buffer;
+
+    size_t numElements = matrix.GetNumElements();
+
+    if (vec.capacity() < numElements)
+    {
+        // Bad luck - we can't reallocate memory of an external object at this point.
+        RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+    }
+
+    vec.resize(numElements);
+    ElemType* data = const_cast<ElemType*>(vec.data());
+    matrix.CopyToArray(data, numElements);
+}
+
+template<typename ElemType>
+template<template<typename> class ValueContainer>
+void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<ElemType, ValueContainer> >& inputs, std::vector<ValueBuffer<ElemType, ValueContainer> >& outputs, bool resetRNN)
+{
+    if (outputs.size() != m_outputNodes.size())
+        RuntimeError("Expected %d outputs, but got %d.", (int)m_outputNodes.size(), (int)outputs.size());
+
+    ForwardInputsT(inputs, resetRNN);
+
+    for (size_t i = 0; i < m_outputNodes.size(); ++i)
+    {
+        auto node = m_outputNodes[i];
+        CopyOutput(node, *dynamic_pointer_cast<Matrix<ElemType>>(node->ValuePtr()), outputs[i]);
+    }
+}
 
-        const auto& seq = pMBLayout->GetAllSequences();
-        if (seq.size() != 1)
-            RuntimeError("Only 1 output sequence supported by this API");
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPassTopK(const Values<ElemType>& inputs, size_t k, Values<ElemType>& topValues, Values<ElemType>& topIndices)
+{
+    if (topValues.size() != m_outputNodes.size() || topIndices.size() != m_outputNodes.size())
+        RuntimeError("Expected %d outputs, but got %d values and %d indices.", (int)m_outputNodes.size(), (int)topValues.size(), (int)topIndices.size());
 
-        ValueContainer<ElemType>& vec = outputs[i2].m_buffer;
+    for (const auto& node : m_outputNodes)
+    {
+        size_t dim = node->GetSampleLayout().GetNumElements();
+        if (k == 0 || k > dim)
+            InvalidArgument("ForwardPassTopK: k (%d) must be between 1 and the dimension of output '%ls' (%d).", (int)k, node->GetName().c_str(), (int)dim);
+    }
 
-        size_t numElements = outputMatrix->GetNumElements();
+    ForwardInputsT(inputs, true);
 
-        if (vec.capacity() < numElements)
+    for (size_t i = 0; i < m_outputNodes.size(); ++i)
+    {
+        auto node = m_outputNodes[i];
+        auto outputMatrix = dynamic_pointer_cast<Matrix<ElemType>>(node->ValuePtr());
+        if (!m_topKValues || m_topKValues->GetDeviceId() != outputMatrix->GetDeviceId())
         {
-            // Bad luck - we can't reallocate memory of an external object at this point.
-            RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+            m_topKValues.reset(new Matrix<ElemType>(outputMatrix->GetDeviceId()));
+            m_topKIndices.reset(new Matrix<ElemType>(outputMatrix->GetDeviceId()));
         }
-
-        vec.resize(numElements);
-        ElemType* data = const_cast<ElemType*>(vec.data());
-        outputMatrix->CopyToArray(data, numElements);
+        outputMatrix->VectorMax(*m_topKIndices, *m_topKValues, /*isColWise=*/true, (int)k);
+        CopyOutput(node, *m_topKValues, topValues[i]);
+        CopyOutput(node, *m_topKIndices, topIndices[i]);
     }
 }
 
@@ -429,6 +474,326 @@ void CNTKEvalExtended<ElemType>::ForwardPass(const ValueRefs<ElemType>& inputs,
     ForwardPassT(inputs, outputs, resetRNN);
 }
 
+// collect the nodes that carry state from one chunk of a stream to the next, and forget all streams
+template <typename ElemType>
+void CNTKEvalExtended<ElemType>::PrepareStreams()
+{
+    m_streamStateNodes.clear();
+    m_streamStates.clear();
+    m_streamSlots.clear();
+    m_freeStreamSlots.clear();
+    m_numStreamSlots = 0;
+
+    set<ComputationNodeBasePtr> visited;
+    for (const auto& outputNode : m_outputNodes)
+    {
+        for (const auto& node : this->m_net->GetAllNodesForRoot(outputNode))
+        {
+            if (!visited.insert(node).second || !dynamic_pointer_cast<IStatefulNode>(node))
+                continue;
+            auto pastValueNode = dynamic_pointer_cast<PastValueNode<ElemType>>(node);
+            if (!pastValueNode || pastValueNode->TimeStep() != 1)
+                RuntimeError("ForwardPassStreams: %ls %ls operation is not supported, only PastValue with timeStep=1 can carry state across chunks.",
+                             node->NodeName().c_str(), node->OperationName().c_str());
+            m_streamStateNodes.push_back(pastValueNode);
+            m_streamStates.push_back(make_shared<Matrix<ElemType>>(node->GetSampleLayout().GetNumElements(), 0, node->GetDeviceId()));
+        }
+    }
+    m_forkedStreamStates.clear();
+    m_streamsPrepared = true;
+}
+
+// The chunks of all streams of a call are evaluated as the parallel sequences of one minibatch: stream s is sequence s,
+// padded with a gap to the longest chunk. A continuing stream is a sequence that began one frame before the minibatch,
+// and that frame is imported into the PastValue nodes from the stream's column of m_streamStates; after the forward
+// pass, that column is set to the value of the stream's last frame.
+template <typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPassStreams(const std::vector<size_t>& streamIds, const std::vector<Values<ElemType>>& inputs, std::vector<Values<ElemType>>& outputs)
+{
+    if (!m_started)
+        RuntimeError("ForwardPassStreams() called before StartForwardEvaluation()");
+    if (!m_streamsPrepared)
+        PrepareStreams();
+
+    const size_t numStreams = streamIds.size();
+    if (numStreams == 0)
+        RuntimeError("ForwardPassStreams: Expected at least one stream.");
+    if (inputs.size() != numStreams || outputs.size() != numStreams)
+        RuntimeError("ForwardPassStreams: Expected inputs and outputs for %d streams, but got %d and %d.", (int)numStreams, (int)inputs.size(), (int)outputs.size());
+    if (set<size_t>(streamIds.begin(), streamIds.end()).size() != numStreams)
+        RuntimeError("ForwardPassStreams: The stream ids must be distinct.");
+
+    // determine the length of each chunk
+    vector<size_t> numFrames(numStreams);
+    for (size_t s = 0; s < numStreams; s++)
+    {
+        if (inputs[s].size() != m_inputNodes.size())
+            RuntimeError("ForwardPassStreams: Expected %d inputs, but got %d for stream %d.", (int)m_inputNodes.size(), (int)inputs[s].size(), (int)streamIds[s]);
+        if (outputs[s].size() != m_outputNodes.size())
+            RuntimeError("ForwardPassStreams: Expected %d outputs, but got %d for stream %d.", (int)m_outputNodes.size(), (int)outputs[s].size(), (int)streamIds[s]);
+        for (size_t i = 0; i < m_inputNodes.size(); i++)
+        {
+            const auto& buffer = inputs[s][i];
+            auto type = dynamic_pointer_cast<Matrix<ElemType>>(m_inputNodes[i]->ValuePtr())->GetMatrixType();
+            size_t numRows = m_inputNodes[i]->GetSampleLayout().GetNumElements();
+            size_t numCols;
+            if (type == MatrixType::DENSE)
+            {
+                if (buffer.m_buffer.size() % numRows != 0)
+                    RuntimeError("Input %ls: Expected input data to be a multiple of %" PRIu64 ", but it is %" PRIu64 ".",
+                                 m_inputNodes[i]->GetName().c_str(), numRows, buffer.m_buffer.size());
+                numCols = buffer.m_buffer.size() / numRows;
+            }
+            else
+            {
+                if (buffer.m_colIndices.size() < 1 || buffer.m_colIndices[0] != 0 || buffer.m_colIndices.back() != buffer.m_indices.size() || buffer.m_buffer.size() != buffer.m_indices.size())
+                    RuntimeError("Input %ls: Invalid sparse input for stream %d.", m_inputNodes[i]->GetName().c_str(), (int)streamIds[s]);
+                numCols = buffer.m_colIndices.size() - 1;
+            }
+            if (numCols < 1)
+                RuntimeError("Input %ls: Expected at least one frame for stream %d.", m_inputNodes[i]->GetName().c_str(), (int)streamIds[s]);
+            if (i > 0 && numCols != numFrames[s])
+                RuntimeError("Input %ls: Expected %d frames for stream %d like the other inputs, but got %d.", m_inputNodes[i]->GetName().c_str(), (int)numFrames[s], (int)streamIds[s], (int)numCols);
+            numFrames[s] = numCols;
+        }
+    }
+    const size_t numTimeSteps = *max_element(numFrames.begin(), numFrames.end());
+
+    // assign the state columns; new streams get a free one
+    vector<bool> isContinued(numStreams);
+    vector<ElemType> slots(numStreams);
+    for (size_t s = 0; s < numStreams; s++)
+    {
+        isContinued[s] = m_streamSlots.find(streamIds[s]) != m_streamSlots.end();
+        slots[s] = (ElemType)GetOrAddStreamSlot(streamIds[s]);
+    }
+    GrowStreamStates();
+
+    // the layouts of the minibatch and of the frame carried over from the previous chunks
+    auto pMBLayout = make_shared<MBLayout>();
+    pMBLayout->Init(numStreams, numTimeSteps);
+    auto pDelayedMBLayout = make_shared<MBLayout>();
+    pDelayedMBLayout->Init(numStreams, 1);
+    for (size_t s = 0; s < numStreams; s++)
+    {
+        pMBLayout->AddSequence(s, s, isContinued[s] ? -1 : 0, numFrames[s]);
+        if (numFrames[s] < numTimeSteps)
+            pMBLayout->AddGap(s, numFrames[s], numTimeSteps);
+        if (isContinued[s])
+            pDelayedMBLayout->AddSequence(s, s, -1, 1);
+        else
+            pDelayedMBLayout->AddGap(s, 0, 1);
+    }
+
+    // interleave the frames of the streams, column t * numStreams + s holding frame t of stream s
+    const size_t numCols = numTimeSteps * numStreams;
+    for (size_t i = 0; i < m_inputNodes.size(); i++)
+    {
+        auto& inputNode = m_inputNodes[i];
+        auto matrix = dynamic_pointer_cast<Matrix<ElemType>>(inputNode->ValuePtr());
+        size_t numRows = inputNode->GetSampleLayout().GetNumElements();
+        inputNode->GetMBLayout()->CopyFrom(pMBLayout);
+
+        if (matrix->GetMatrixType() == MatrixType::DENSE)
+        {
+            vector<ElemType> data(numRows * numCols, 0);
+            for (size_t s = 0; s < numStreams; s++)
+                for (size_t t = 0; t < numFrames[s]; t++)
+                    memcpy(&data[(t * numStreams + s) * numRows], inputs[s][i].m_buffer.data() + t * numRows, sizeof(ElemType) * numRows);
+            matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), data.data(), matrixFlagNormal);
+        }
+        else
+        {
+            vector<int> colIndices(1, 0);
+            vector<int> rowIndices;
+            vector<ElemType> values;
+            for (size_t t = 0; t < numTimeSteps; t++)
+            {
+                for (size_t s = 0; s < numStreams; s++)
+                {
+                    if (t < numFrames[s])
+                    {
+                        const auto& buffer = inputs[s][i];
+                        for (int k = buffer.m_colIndices[t]; k < buffer.m_colIndices[t + 1]; k++)
+                        {
+                            rowIndices.push_back(buffer.m_indices[k]);
+                            values.push_back(buffer.m_buffer[k]);
+                        }
+                    }
+                    colIndices.push_back((int)rowIndices.size());
+                }
+            }
+            matrix->SetMatrixFromCSCFormat(colIndices.data(), rowIndices.data(), values.data(), values.size(), numRows, numCols);
+        }
+    }
+
+    // import the state of the continued streams
+    DEVICEID_TYPE deviceId = this->m_net->GetDeviceId();
+    Matrix<ElemType> streamColumns(deviceId);
+    streamColumns.SetValue(1, numStreams, deviceId, slots.data(), matrixFlagNormal);
+    for (size_t k = 0; k < m_streamStateNodes.size(); k++)
+        m_streamStateNodes[k]->ImportStreamStates(*m_streamStates[k], streamColumns, pDelayedMBLayout);
+
+    ComputationNetwork::BumpEvalTimeStamp(m_inputNodes);
+    this->m_net->ForwardProp(m_outputNodes);
+
+    // keep the last frame of each stream
+    if (!m_streamStateNodes.empty())
+    {
+        vector<ElemType> frameColumns(m_streamStates[0]->GetNumCols(), -1);
+        for (size_t s = 0; s < numStreams; s++)
+            frameColumns[(size_t)slots[s]] = (ElemType)((numFrames[s] - 1) * numStreams + s);
+        Matrix<ElemType> frameColumnsMatrix(deviceId);
+        frameColumnsMatrix.SetValue(1, frameColumns.size(), deviceId, frameColumns.data(), matrixFlagNormal);
+        for (size_t k = 0; k < m_streamStateNodes.size(); k++)
+            m_streamStateNodes[k]->ExportStreamStates(*m_streamStates[k], frameColumnsMatrix);
+    }
+
+    // hand out the frames of each stream
+    for (size_t o = 0; o < m_outputNodes.size(); o++)
+    {
+        auto node = m_outputNodes[o];
+        auto outputMatrix = dynamic_pointer_cast<Matrix<ElemType>>(node->ValuePtr());
+        auto pOutputMBLayout = node->GetMBLayout();
+        if (!pOutputMBLayout || pOutputMBLayout->GetNumParallelSequences() != numStreams)
+            RuntimeError("ForwardPassStreams: Output '%ls' must have one sequence per stream.", node->GetName().c_str());
+
+        size_t numRows = outputMatrix->GetNumRows();
+        vector<ElemType> data(outputMatrix->GetNumElements());
+        ElemType* dataPtr = data.data();
+        size_t dataSize = data.size();
+        outputMatrix->CopyToArray(dataPtr, dataSize);
+        for (size_t s = 0; s < numStreams; s++)
+            outputs[s][o].m_buffer.resize(0);
+        for (const auto& seq : pOutputMBLayout->GetAllSequences())
+        {
+            if (seq.seqId == GAP_SEQUENCE_ID)
+                continue;
+            auto& vec = outputs[seq.s][o].m_buffer;
+            size_t tBegin = (size_t)max(seq.tBegin, (ptrdiff_t)0);
+            size_t tEnd = min(seq.tEnd, pOutputMBLayout->GetNumTimeSteps());
+            size_t numElements = vec.size() + (tEnd - tBegin) * numRows;
+            if (vec.capacity() < numElements)
+                RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+            for (size_t t = tBegin; t < tEnd; t++)
+            {
+                const ElemType* frame = &data[(t * numStreams + seq.s) * numRows];
+                vec.insert(vec.end(), frame, frame + numRows);
+            }
+        }
+    }
+}
+
+template <typename ElemType>
+size_t CNTKEvalExtended<ElemType>::GetOrAddStreamSlot(size_t streamId)
+{
+    auto iter = m_streamSlots.find(streamId);
+    if (iter != m_streamSlots.end())
+        return iter->second;
+
+    size_t slot;
+    if (!m_freeStreamSlots.empty())
+    {
+        slot = m_freeStreamSlots.back();
+        m_freeStreamSlots.pop_back();
+    }
+    else
+        slot = m_numStreamSlots++;
+    m_streamSlots.insert(make_pair(streamId, slot));
+    return slot;
+}
+
+// make room for m_numStreamSlots columns in m_streamStates
+template <typename ElemType>
+void CNTKEvalExtended<ElemType>::GrowStreamStates()
+{
+    for (auto& states : m_streamStates)
+    {
+        size_t capacity = states->GetNumCols();
+        if (capacity >= m_numStreamSlots)
+            continue;
+        auto grown = make_shared<Matrix<ElemType>>(states->GetNumRows(), max(2 * capacity, m_numStreamSlots), states->GetDeviceId());
+        grown->SetValue(0);
+        if (capacity > 0)
+            grown->SetColumnSlice(*states, 0, capacity);
+        states = grown;
+    }
+}
+
+// The state columns of all slots are gathered at once into a second matrix, every target slot from its source slot and every
+// other slot from itself, so that sources may be targets as well.
+template <typename ElemType>
+void CNTKEvalExtended<ElemType>::ForkStreams(const std::vector<size_t>& sourceStreamIds, const std::vector<size_t>& targetStreamIds)
+{
+    if (!m_started)
+        RuntimeError("ForkStreams() called before StartForwardEvaluation()");
+    if (!m_streamsPrepared)
+        PrepareStreams();
+
+    if (sourceStreamIds.size() != targetStreamIds.size())
+        RuntimeError("ForkStreams: Expected as many source streams as target streams, but got %d and %d.", (int)sourceStreamIds.size(), (int)targetStreamIds.size());
+    if (set<size_t>(targetStreamIds.begin(), targetStreamIds.end()).size() != targetStreamIds.size())
+        RuntimeError("ForkStreams: The target stream ids must be distinct.");
+    if (sourceStreamIds.empty())
+        return;
+
+    vector<size_t> sourceSlots(sourceStreamIds.size());
+    for (size_t i = 0; i < sourceStreamIds.size(); i++)
+    {
+        auto iter = m_streamSlots.find(sourceStreamIds[i]);
+        if (iter == m_streamSlots.end())
+            RuntimeError("ForkStreams: Stream %d does not exist.", (int)sourceStreamIds[i]);
+        sourceSlots[i] = iter->second;
+    }
+    vector<size_t> targetSlots(targetStreamIds.size());
+    for (size_t i = 0; i < targetStreamIds.size(); i++)
+        targetSlots[i] = GetOrAddStreamSlot(targetStreamIds[i]);
+    GrowStreamStates();
+    if (m_streamStates.empty())
+        return;
+
+    vector<ElemType> columns(m_streamStates[0]->GetNumCols());
+    for (size_t j = 0; j < columns.size(); j++)
+        columns[j] = (ElemType)j;
+    for (size_t i = 0; i < targetSlots.size(); i++)
+        columns[targetSlots[i]] = (ElemType)sourceSlots[i];
+
+    DEVICEID_TYPE deviceId = this->m_net->GetDeviceId();
+    Matrix<ElemType> columnsMatrix(deviceId);
+    columnsMatrix.SetValue(1, columns.size(), deviceId, columns.data(), matrixFlagNormal);
+    if (m_forkedStreamStates.size() != m_streamStates.size())
+        m_forkedStreamStates.resize(m_streamStates.size());
+    for (size_t k = 0; k < m_streamStates.size(); k++)
+    {
+        if (!m_forkedStreamStates[k])
+            m_forkedStreamStates[k] = make_shared<Matrix<ElemType>>(m_streamStates[k]->GetNumRows(), 0, m_streamStates[k]->GetDeviceId());
+        m_forkedStreamStates[k]->DoGatherColumnsOf(/*beta=*/0, columnsMatrix, *m_streamStates[k], /*alpha=*/1);
+        swap(m_forkedStreamStates[k], m_streamStates[k]);
+    }
+}
+
+template <typename ElemType>
+void CNTKEvalExtended<ElemType>::EndStream(size_t streamId)
+{
+    auto iter = m_streamSlots.find(streamId);
+    if (iter == m_streamSlots.end())
+        return;
+    m_freeStreamSlots.push_back(iter->second);
+    m_streamSlots.erase(iter);
+}
+
+template <typename ElemType>
+IEvaluateModelExtended<ElemType>* CNTKEvalExtended<ElemType>::Clone()
+{
+    if (!this->m_net)
+        RuntimeError("Clone() called before the network was created");
+
+    auto clone = new CNTKEvalExtended<ElemType>();
+    clone->m_config = this->m_config;
+    clone->m_net = this->m_net->template CloneSharingParameters<ElemType>();
+    return clone;
+}
+
 template <typename ElemType>
 void CNTKEvalExtended<ElemType>::Destroy()
 {
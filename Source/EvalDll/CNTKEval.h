@@ -19,6 +19,7 @@
 #include "EvalWriter.h"
 
 #include "ComputationNetwork.h"
+#include "RecurrentNodes.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -91,7 +92,7 @@ class CNTKEvalExtended : public CNTKEvalBase<ElemType>, public IEvaluateModelExt
 {
 public:
     CNTKEvalExtended() : CNTKEvalBase<ElemType>(), 
-        m_started(false){}
+        m_started(false), m_streamsPrepared(false), m_numStreamSlots(0){}
 
     virtual VariableSchema GetOutputSchema() const override;
 
@@ -107,6 +108,16 @@ public:
 
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) override;
 
+    virtual void ForwardPassTopK(const Values<ElemType>& inputs, size_t k, Values<ElemType>& topValues, Values<ElemType>& topIndices) override;
+
+    virtual void ForwardPassStreams(const std::vector<size_t>& streamIds, const std::vector<Values<ElemType>>& inputs, std::vector<Values<ElemType>>& outputs) override;
+
+    virtual void ForkStreams(const std::vector<size_t>& sourceStreamIds, const std::vector<size_t>& targetStreamIds) override;
+
+    virtual void EndStream(size_t streamId) override;
+
+    virtual IEvaluateModelExtended<ElemType>* Clone() override;
+
     virtual void Destroy() override;
 
     virtual void CreateNetwork(const std::string& networkDescription) override
@@ -127,9 +138,31 @@ private:
     StreamMinibatchInputs m_inputMatrices;
     bool m_started;
 
+    // state of ForwardPassStreams(): the carried-over values of every PastValue node, with one column per stream slot
+    bool m_streamsPrepared;
+    std::vector<shared_ptr<DelayedValueNodeBase<ElemType, -1>>> m_streamStateNodes;
+    std::vector<shared_ptr<Matrix<ElemType>>> m_streamStates; // [k] belongs to m_streamStateNodes[k]
+    std::map<size_t, size_t> m_streamSlots;                   // stream id -> column in m_streamStates
+    std::vector<size_t> m_freeStreamSlots;
+    size_t m_numStreamSlots;                                  // slots in use or free; m_streamStates may have more columns
+    std::vector<shared_ptr<Matrix<ElemType>>> m_forkedStreamStates; // the other buffer of m_streamStates, for ForkStreams()
+
+    void PrepareStreams();
+    size_t GetOrAddStreamSlot(size_t streamId);
+    void GrowStreamStates();
+
+    std::unique_ptr<Matrix<ElemType>> m_topKValues; // device buffers of ForwardPassTopK()
+    std::unique_ptr<Matrix<ElemType>> m_topKIndices;
+
+    template<template<typename> class ValueContainer> 
+    void ForwardInputsT(const std::vector < ValueBuffer<ElemType, ValueContainer> >& inputs, bool resetRNN);
+
     template<template<typename> class ValueContainer> 
     void ForwardPassT(const std::vector < ValueBuffer<ElemType, ValueContainer> >& inputs,
                       std::vector < ValueBuffer<ElemType, ValueContainer> >& outputs, bool resetRNN);
 
+    template<template<typename> class ValueContainer>
+    static void CopyOutput(const ComputationNodeBasePtr& node, const Matrix<ElemType>& matrix, ValueBuffer<ElemType, ValueContainer>& output);
+
 };
 } } }
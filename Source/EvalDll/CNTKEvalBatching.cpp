@@ -0,0 +1,158 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CNTKEvalBatching.cpp - batching of concurrent evaluation requests
+//
+
+#define EVAL_EXPORTS // creating the exports here
+#include "Basics.h"
+#include "Eval.h"
+#include "CNTKEvalBatching.h"
+
+#include <algorithm>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template <typename ElemType>
+const std::vector<double> CNTKEvalBatching<ElemType>::s_latencyBucketsMs = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 };
+
+template <typename ElemType>
+CNTKEvalBatching<ElemType>::CNTKEvalBatching(IEvaluateModelExtended<ElemType>* model, size_t maxBatchSize, double maxLatencyMs)
+    : m_model(model),
+      m_maxBatchSize(maxBatchSize),
+      m_maxLatency(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(maxLatencyMs))),
+      m_stopping(false),
+      m_nextStreamId(0),
+      m_latencyCounts(s_latencyBucketsMs.size() + 1, 0)
+{
+    if (!model)
+        InvalidArgument("GetEvalBatching: No model given.");
+    if (maxBatchSize < 1)
+        InvalidArgument("GetEvalBatching: maxBatchSize must be at least 1.");
+    if (maxLatencyMs < 0)
+        InvalidArgument("GetEvalBatching: maxLatencyMs must not be negative.");
+    m_worker = std::thread([this]() { EvaluateBatches(); });
+}
+
+template <typename ElemType>
+void CNTKEvalBatching<ElemType>::ForwardPass(const Values<ElemType>& inputs, Values<ElemType>& outputs)
+{
+    // const cast: The inputs are moved into the batch and back, the caller being blocked in the meantime.
+    Request request{ const_cast<Values<ElemType>*>(&inputs), &outputs, Clock::now(), false, nullptr };
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_stopping)
+        RuntimeError("ForwardPass() called after Destroy()");
+    m_queue.push_back(&request);
+    m_requestsPending.notify_one();
+    m_requestsDone.wait(lock, [&request]() { return request.done; });
+
+    double latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - request.submitTime).count();
+    size_t bucket = std::upper_bound(s_latencyBucketsMs.begin(), s_latencyBucketsMs.end(), latencyMs) - s_latencyBucketsMs.begin();
+    m_latencyCounts[bucket]++;
+    lock.unlock();
+
+    if (request.error)
+        std::rethrow_exception(request.error);
+}
+
+template <typename ElemType>
+void CNTKEvalBatching<ElemType>::EvaluateBatches()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_requestsPending.wait(lock, [this]() { return !m_queue.empty() || m_stopping; });
+        if (m_queue.empty()) // (stopping)
+            break;
+
+        // wait for more requests until the batch is full or its oldest request is due
+        auto deadline = m_queue.front()->submitTime + m_maxLatency;
+        m_requestsPending.wait_until(lock, deadline, [this]() { return m_queue.size() >= m_maxBatchSize || m_stopping; });
+
+        size_t batchSize = std::min(m_queue.size(), m_maxBatchSize);
+        std::vector<Request*> batch(m_queue.begin(), m_queue.begin() + batchSize);
+        m_queue.erase(m_queue.begin(), m_queue.begin() + batchSize);
+
+        lock.unlock();
+        EvaluateBatch(batch);
+        lock.lock();
+
+        for (auto request : batch)
+            request->done = true;
+        m_requestsDone.notify_all();
+    }
+}
+
+// Every request is a stream of its own, which is ended right away, so that requests do not share recurrent state.
+template <typename ElemType>
+void CNTKEvalBatching<ElemType>::EvaluateBatch(const std::vector<Request*>& batch)
+{
+    std::vector<size_t> streamIds;
+    std::vector<Values<ElemType>> inputs;
+    std::vector<Values<ElemType>> outputs;
+    for (auto request : batch)
+    {
+        streamIds.push_back(m_nextStreamId++);
+        inputs.push_back(std::move(*request->inputs));
+        outputs.push_back(std::move(*request->outputs));
+    }
+
+    std::exception_ptr error;
+    try
+    {
+        m_model->ForwardPassStreams(streamIds, inputs, outputs);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        m_model->EndStream(streamIds[i]);
+        *batch[i]->inputs = std::move(inputs[i]);
+        *batch[i]->outputs = std::move(outputs[i]);
+        batch[i]->error = error;
+    }
+}
+
+template <typename ElemType>
+void CNTKEvalBatching<ElemType>::GetLatencyHistogram(std::vector<double>& upperBoundsMs, std::vector<size_t>& counts) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    upperBoundsMs = s_latencyBucketsMs;
+    counts = m_latencyCounts;
+}
+
+template <typename ElemType>
+void CNTKEvalBatching<ElemType>::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_requestsPending.notify_one();
+    }
+    m_worker.join();
+    delete this;
+}
+
+template <typename ElemType>
+void EVAL_API GetEvalBatching(IEvaluateModelExtended<ElemType>* model, size_t maxBatchSize, double maxLatencyMs, IEvaluateModelBatching<ElemType>** pbatching)
+{
+    *pbatching = new CNTKEvalBatching<ElemType>(model, maxBatchSize, maxLatencyMs);
+}
+
+extern "C" EVAL_API void GetEvalBatchingF(IEvaluateModelExtended<float>* model, size_t maxBatchSize, double maxLatencyMs, IEvaluateModelBatching<float>** pbatching)
+{
+    GetEvalBatching(model, maxBatchSize, maxLatencyMs, pbatching);
+}
+extern "C" EVAL_API void GetEvalBatchingD(IEvaluateModelExtended<double>* model, size_t maxBatchSize, double maxLatencyMs, IEvaluateModelBatching<double>** pbatching)
+{
+    GetEvalBatching(model, maxBatchSize, maxLatencyMs, pbatching);
+}
+
+template class CNTKEvalBatching<double>;
+template class CNTKEvalBatching<float>;
+}}}
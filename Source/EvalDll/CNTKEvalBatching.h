@@ -0,0 +1,65 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CNTKEvalBatching.h - batching of concurrent evaluation requests (see IEvaluateModelBatching in Eval.h)
+//
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Eval.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template <typename ElemType>
+class CNTKEvalBatching : public IEvaluateModelBatching<ElemType>
+{
+public:
+    CNTKEvalBatching(IEvaluateModelExtended<ElemType>* model, size_t maxBatchSize, double maxLatencyMs);
+
+    virtual void ForwardPass(const Values<ElemType>& inputs, Values<ElemType>& outputs) override;
+
+    virtual void GetLatencyHistogram(std::vector<double>& upperBoundsMs, std::vector<size_t>& counts) const override;
+
+    virtual void Destroy() override;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Request
+    {
+        Values<ElemType>* inputs;  // (moved into the batch and back while it is evaluated)
+        Values<ElemType>* outputs;
+        Clock::time_point submitTime;
+        bool done;
+        std::exception_ptr error;
+    };
+
+    void EvaluateBatches(); // the worker thread
+    void EvaluateBatch(const std::vector<Request*>& batch);
+
+    IEvaluateModelExtended<ElemType>* m_model;
+    const size_t m_maxBatchSize;
+    const Clock::duration m_maxLatency;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_requestsPending; // signaled when a request is queued, or when stopping
+    std::condition_variable m_requestsDone;    // signaled when a batch has been evaluated
+    std::deque<Request*> m_queue;
+    bool m_stopping;
+    size_t m_nextStreamId;
+
+    static const std::vector<double> s_latencyBucketsMs;
+    std::vector<size_t> m_latencyCounts; // [i] corresponds to s_latencyBucketsMs[i], plus one for the rest
+
+    std::thread m_worker;
+};
+
+}}}
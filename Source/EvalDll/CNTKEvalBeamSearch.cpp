@@ -0,0 +1,303 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CNTKEvalBeamSearch.cpp - beam search decoding with a recurrent model
+//
+
+#define EVAL_EXPORTS // creating the exports here
+#include "Basics.h"
+#include "Eval.h"
+#include "CNTKEvalBeamSearch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template <typename ElemType>
+CNTKEvalBeamSearch<ElemType>::CNTKEvalBeamSearch(IEvaluateModelExtended<ElemType>* model, const std::wstring& tokenInputName, size_t beamWidth, size_t maxLength, size_t endToken,
+                                                 bool applyLogSoftmax, double lengthPenalty)
+    : m_model(model),
+      m_beamWidth(beamWidth),
+      m_maxLength(maxLength),
+      m_endToken(endToken),
+      m_applyLogSoftmax(applyLogSoftmax),
+      m_lengthPenalty(lengthPenalty),
+      m_nextStreamId(0)
+{
+    if (!model)
+        InvalidArgument("GetBeamSearchDecoder: No model given.");
+    if (beamWidth < 1)
+        InvalidArgument("GetBeamSearchDecoder: beamWidth must be at least 1.");
+    if (maxLength < 1)
+        InvalidArgument("GetBeamSearchDecoder: maxLength must be at least 1.");
+
+    m_inputSchema = model->GetInputSchema();
+    auto tokenInput = std::find_if(m_inputSchema.begin(), m_inputSchema.end(), [&](const VariableLayout& layout) { return layout.m_name == tokenInputName; });
+    if (tokenInput == m_inputSchema.end())
+        InvalidArgument("GetBeamSearchDecoder: The model has no input '%ls'.", tokenInputName.c_str());
+    m_tokenInput = tokenInput - m_inputSchema.begin();
+    m_vocabularySize = tokenInput->m_numElements;
+
+    VariableSchema outputSchema = model->GetOutputSchema();
+    if (outputSchema.size() != 1 || outputSchema[0].m_numElements != m_vocabularySize)
+        InvalidArgument("GetBeamSearchDecoder: The model must have a single output with a score for each of the %d tokens of the input '%ls'.",
+                        (int)m_vocabularySize, tokenInputName.c_str());
+    if (endToken >= m_vocabularySize)
+        InvalidArgument("GetBeamSearchDecoder: The end token %d is not in the vocabulary of %d tokens.", (int)endToken, (int)m_vocabularySize);
+}
+
+// the input of a hypothesis for a step: its last token, and the last frame of the prefix for the other inputs
+template <typename ElemType>
+void CNTKEvalBeamSearch<ElemType>::StepInputs(const Values<ElemType>& prefix, size_t token, Values<ElemType>& inputs) const
+{
+    inputs.resize(m_inputSchema.size());
+    for (size_t i = 0; i < m_inputSchema.size(); i++)
+    {
+        auto& buffer = inputs[i];
+        const bool isSparse = m_inputSchema[i].m_storageType == VariableLayout::Sparse;
+        if (i == m_tokenInput && isSparse)
+        {
+            buffer.m_buffer.assign(1, 1);
+            buffer.m_indices.assign(1, (int)token);
+            buffer.m_colIndices = { 0, 1 };
+        }
+        else if (i == m_tokenInput)
+        {
+            buffer.m_buffer.assign(m_vocabularySize, 0);
+            buffer.m_buffer[token] = 1;
+        }
+        else if (isSparse)
+        {
+            const auto& source = prefix[i];
+            const size_t numCols = source.m_colIndices.size() - 1;
+            const int begin = source.m_colIndices[numCols - 1], end = source.m_colIndices[numCols];
+            buffer.m_buffer.assign(source.m_buffer.begin() + begin, source.m_buffer.begin() + end);
+            buffer.m_indices.assign(source.m_indices.begin() + begin, source.m_indices.begin() + end);
+            buffer.m_colIndices = { 0, end - begin };
+        }
+        else
+        {
+            const auto& source = prefix[i].m_buffer;
+            buffer.m_buffer.assign(source.end() - m_inputSchema[i].m_numElements, source.end());
+        }
+    }
+}
+
+// Replaces the live hypotheses of a request by the best extensions of them by one token. The first extension of a hypothesis
+// continues its stream, every other one is forked from it; the streams of hypotheses without live extensions are ended.
+template <typename ElemType>
+void CNTKEvalBeamSearch<ElemType>::ExtendHypotheses(Request& request, const std::vector<const ElemType*>& scores, std::vector<size_t>& forkSources, std::vector<size_t>& forkTargets)
+{
+    const size_t beamWidth = m_beamWidth - request.finished.size();
+    const size_t numTop = std::min(beamWidth, m_vocabularySize);
+
+    std::vector<Candidate> candidates;
+    for (size_t j = 0; j < request.live.size(); j++)
+    {
+        const ElemType* score = scores[j];
+        m_logProbabilities.assign(score, score + m_vocabularySize);
+        if (m_applyLogSoftmax)
+        {
+            const ElemType maxScore = *std::max_element(m_logProbabilities.begin(), m_logProbabilities.end());
+            double sum = 0;
+            for (auto s : m_logProbabilities)
+                sum += exp((double)(s - maxScore));
+            const ElemType logSum = (ElemType)(maxScore + log(sum));
+            for (auto& s : m_logProbabilities)
+                s -= logSum;
+        }
+
+        // only the best numTop extensions of each hypothesis can be among the best numTop of all
+        m_topTokens.resize(m_vocabularySize);
+        std::iota(m_topTokens.begin(), m_topTokens.end(), (size_t)0);
+        std::partial_sort(m_topTokens.begin(), m_topTokens.begin() + numTop, m_topTokens.end(),
+                          [&](size_t a, size_t b) { return m_logProbabilities[a] > m_logProbabilities[b]; });
+        for (size_t n = 0; n < numTop; n++)
+            candidates.push_back(Candidate{ request.live[j].score + m_logProbabilities[m_topTokens[n]], j, m_topTokens[n] });
+    }
+    const size_t numSelected = std::min(beamWidth, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + numSelected, candidates.end(),
+                      [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+
+    std::vector<Hypothesis> live;
+    std::vector<bool> continued(request.live.size(), false);
+    for (size_t n = 0; n < numSelected; n++)
+    {
+        const Candidate& candidate = candidates[n];
+        const Hypothesis& parent = request.live[candidate.parent];
+        if (candidate.token == m_endToken)
+        {
+            request.finished.push_back(BeamSearchHypothesis{ parent.tokens, candidate.score });
+            continue;
+        }
+
+        Hypothesis hypothesis{ 0, parent.tokens, candidate.score };
+        hypothesis.tokens.push_back(candidate.token);
+        if (hypothesis.tokens.size() >= m_maxLength)
+        {
+            request.finished.push_back(BeamSearchHypothesis{ hypothesis.tokens, hypothesis.score });
+            continue;
+        }
+
+        if (!continued[candidate.parent])
+        {
+            continued[candidate.parent] = true;
+            hypothesis.streamId = parent.streamId;
+        }
+        else
+        {
+            hypothesis.streamId = m_nextStreamId++;
+            forkSources.push_back(parent.streamId);
+            forkTargets.push_back(hypothesis.streamId);
+        }
+        live.push_back(std::move(hypothesis));
+    }
+
+    for (size_t j = 0; j < request.live.size(); j++)
+    {
+        if (!continued[j])
+            m_model->EndStream(request.live[j].streamId);
+    }
+    request.live.swap(live);
+}
+
+template <typename ElemType>
+void CNTKEvalBeamSearch<ElemType>::EndStreams(std::vector<Request>& requests)
+{
+    for (auto& request : requests)
+    {
+        for (const auto& hypothesis : request.live)
+            m_model->EndStream(hypothesis.streamId);
+        request.live.clear();
+    }
+}
+
+template <typename ElemType>
+void CNTKEvalBeamSearch<ElemType>::Decode(const std::vector<Values<ElemType>>& prefixes, std::vector<std::vector<BeamSearchHypothesis>>& results)
+{
+    VariableSchema outputSchema = m_model->GetOutputSchema();
+    std::vector<Request> requests(prefixes.size());
+    std::vector<size_t> streamIds;
+    std::vector<std::vector<size_t>> outputsOfRequest(requests.size()); // [r][j]: index into outputs of live hypothesis j of request r
+    std::vector<Values<ElemType>> outputs;
+    try
+    {
+        // the prefixes are evaluated as new streams, the scores of the first token being those of their last frame
+        for (size_t r = 0; r < requests.size(); r++)
+        {
+            const auto& tokenBuffer = prefixes[r].size() > m_tokenInput ? prefixes[r][m_tokenInput] : ValueBuffer<ElemType, Vector>();
+            const size_t numFrames = m_inputSchema[m_tokenInput].m_storageType == VariableLayout::Sparse ?
+                                     std::max(tokenBuffer.m_colIndices.size(), (size_t)1) - 1 : tokenBuffer.m_buffer.size() / m_vocabularySize;
+            if (numFrames == 0)
+                InvalidArgument("Decode: The prefix of request %d has no frames.", (int)r);
+
+            requests[r].prefix = &prefixes[r];
+            requests[r].live.push_back(Hypothesis{ m_nextStreamId++, {}, 0 });
+            streamIds.push_back(requests[r].live[0].streamId);
+            outputs.push_back(outputSchema.CreateBuffers<ElemType>({ numFrames }));
+            outputsOfRequest[r].assign(1, r);
+        }
+        if (!requests.empty())
+            m_model->ForwardPassStreams(streamIds, prefixes, outputs);
+
+        std::vector<Values<ElemType>> inputs;
+        std::vector<size_t> forkSources, forkTargets;
+        std::vector<const ElemType*> scores;
+        for (;;)
+        {
+            forkSources.clear();
+            forkTargets.clear();
+            for (size_t r = 0; r < requests.size(); r++)
+            {
+                if (requests[r].live.empty())
+                    continue;
+                scores.clear();
+                for (size_t o : outputsOfRequest[r])
+                {
+                    const auto& buffer = outputs[o][0].m_buffer;
+                    scores.push_back(buffer.data() + buffer.size() - m_vocabularySize);
+                }
+                ExtendHypotheses(requests[r], scores, forkSources, forkTargets);
+            }
+            // the states of the hypotheses are moved on the device, before any stream advances
+            m_model->ForkStreams(forkSources, forkTargets);
+
+            // all live hypotheses of all requests advance by one token in a single forward pass
+            streamIds.clear();
+            inputs.clear();
+            for (size_t r = 0; r < requests.size(); r++)
+            {
+                outputsOfRequest[r].clear();
+                for (const auto& hypothesis : requests[r].live)
+                {
+                    outputsOfRequest[r].push_back(streamIds.size());
+                    streamIds.push_back(hypothesis.streamId);
+                    inputs.push_back(Values<ElemType>());
+                    StepInputs(*requests[r].prefix, hypothesis.tokens.back(), inputs.back());
+                }
+            }
+            if (streamIds.empty())
+                break;
+            // (created one by one, as copies of a buffer need not keep its capacity)
+            while (outputs.size() < streamIds.size())
+                outputs.push_back(outputSchema.CreateBuffers<ElemType>({ 1 }));
+            outputs.resize(streamIds.size());
+            m_model->ForwardPassStreams(streamIds, inputs, outputs);
+        }
+    }
+    catch (...)
+    {
+        EndStreams(requests);
+        throw;
+    }
+
+    // the finished hypotheses by their score per length (of the scored tokens, which include the end token unless it was cut off)
+    results.assign(requests.size(), std::vector<BeamSearchHypothesis>());
+    for (size_t r = 0; r < requests.size(); r++)
+    {
+        auto& finished = requests[r].finished;
+        std::vector<double> rank(finished.size());
+        for (size_t n = 0; n < finished.size(); n++)
+        {
+            const bool endsWithEndToken = finished[n].m_tokens.size() < m_maxLength;
+            const size_t length = finished[n].m_tokens.size() + (endsWithEndToken ? 1 : 0);
+            rank[n] = finished[n].m_score / pow((double)length, m_lengthPenalty);
+        }
+        std::vector<size_t> order(finished.size());
+        std::iota(order.begin(), order.end(), (size_t)0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return rank[a] > rank[b]; });
+        for (size_t n : order)
+            results[r].push_back(std::move(finished[n]));
+    }
+}
+
+template <typename ElemType>
+void CNTKEvalBeamSearch<ElemType>::Destroy()
+{
+    delete this;
+}
+
+template <typename ElemType>
+void EVAL_API GetBeamSearchDecoder(IEvaluateModelExtended<ElemType>* model, const std::wstring& tokenInputName, size_t beamWidth, size_t maxLength, size_t endToken,
+                                   bool applyLogSoftmax, double lengthPenalty, IBeamSearchDecoder<ElemType>** pdecoder)
+{
+    *pdecoder = new CNTKEvalBeamSearch<ElemType>(model, tokenInputName, beamWidth, maxLength, endToken, applyLogSoftmax, lengthPenalty);
+}
+
+extern "C" EVAL_API void GetBeamSearchDecoderF(IEvaluateModelExtended<float>* model, const wchar_t* tokenInputName, size_t beamWidth, size_t maxLength, size_t endToken,
+                                               bool applyLogSoftmax, double lengthPenalty, IBeamSearchDecoder<float>** pdecoder)
+{
+    GetBeamSearchDecoder(model, std::wstring(tokenInputName), beamWidth, maxLength, endToken, applyLogSoftmax, lengthPenalty, pdecoder);
+}
+extern "C" EVAL_API void GetBeamSearchDecoderD(IEvaluateModelExtended<double>* model, const wchar_t* tokenInputName, size_t beamWidth, size_t maxLength, size_t endToken,
+                                               bool applyLogSoftmax, double lengthPenalty, IBeamSearchDecoder<double>** pdecoder)
+{
+    GetBeamSearchDecoder(model, std::wstring(tokenInputName), beamWidth, maxLength, endToken, applyLogSoftmax, lengthPenalty, pdecoder);
+}
+
+template class CNTKEvalBeamSearch<double>;
+template class CNTKEvalBeamSearch<float>;
+}}}
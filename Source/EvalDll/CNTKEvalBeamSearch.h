@@ -0,0 +1,69 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CNTKEvalBeamSearch.h - beam search decoding with a recurrent model (see IBeamSearchDecoder in Eval.h)
+//
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Eval.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template <typename ElemType>
+class CNTKEvalBeamSearch : public IBeamSearchDecoder<ElemType>
+{
+public:
+    CNTKEvalBeamSearch(IEvaluateModelExtended<ElemType>* model, const std::wstring& tokenInputName, size_t beamWidth, size_t maxLength, size_t endToken,
+                       bool applyLogSoftmax, double lengthPenalty);
+
+    virtual void Decode(const std::vector<Values<ElemType>>& prefixes, std::vector<std::vector<BeamSearchHypothesis>>& results) override;
+
+    virtual void Destroy() override;
+
+private:
+    struct Hypothesis
+    {
+        size_t streamId;
+        std::vector<size_t> tokens;
+        double score;
+    };
+
+    struct Request
+    {
+        const Values<ElemType>* prefix;
+        std::vector<Hypothesis> live;
+        std::vector<BeamSearchHypothesis> finished;
+    };
+
+    // a hypothesis extended by a token
+    struct Candidate
+    {
+        double score;
+        size_t parent; // index into Request::live
+        size_t token;
+    };
+
+    void StepInputs(const Values<ElemType>& prefix, size_t token, Values<ElemType>& inputs) const;
+    void ExtendHypotheses(Request& request, const std::vector<const ElemType*>& scores, std::vector<size_t>& forkSources, std::vector<size_t>& forkTargets);
+    void EndStreams(std::vector<Request>& requests);
+
+    IEvaluateModelExtended<ElemType>* m_model;
+    VariableSchema m_inputSchema;
+    size_t m_tokenInput; // index into m_inputSchema
+    size_t m_vocabularySize;
+    const size_t m_beamWidth;
+    const size_t m_maxLength;
+    const size_t m_endToken;
+    const bool m_applyLogSoftmax;
+    const double m_lengthPenalty;
+    size_t m_nextStreamId;
+
+    std::vector<ElemType> m_logProbabilities; // of one hypothesis
+    std::vector<size_t> m_topTokens;          // of one hypothesis
+};
+
+}}}
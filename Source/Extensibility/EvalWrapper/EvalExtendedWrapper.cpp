@@ -182,6 +182,8 @@ public:
         {
             pin_ptr <IEvaluateModelExtended<ElemType>*> p_eval = &m_eval;
             GetEvalExtended<ElemType>(p_eval);
+            m_pinnedStdInputs = nullptr;
+            m_pinnedStdOutputs = nullptr;
         }
         catch (const exception& ex)
         {
@@ -333,6 +335,143 @@ public:
         }
     }
 
+    //
+    // Pins the given input and output buffers for the ForwardPass(resetRNN) calls that follow, so that these hand the
+    // managed memory to the native evaluation as it is, without pinning it (or allocating anything) on every call.
+    // The inputs are read from, and the outputs written into, the same arrays each time, with the Size of the inputs
+    // at the time of the call; the outputs may take up to the length of their Buffer. The buffers stay pinned until
+    // UnpinBuffers(), the next PinBuffers() or Dispose(); their arrays must not be replaced in the meantime.
+    // Called after StartForwardEvaluation()
+    //
+    void PinBuffers(cli::array<ValueBuffer<ElemType>^>^ inputs, cli::array<ValueBuffer<ElemType>^>^ outputs)
+    {
+        if (m_eval == nullptr)
+        {
+            throw gcnew ObjectDisposedException("Object has been disposed.");
+        }
+
+        UnpinBuffers();
+        if (inputs == nullptr || outputs == nullptr)
+        {
+            throw gcnew ArgumentNullException(inputs == nullptr ? "inputs" : "outputs");
+        }
+
+        m_pinnedGCHandleList = gcnew List<GCHandle>;
+        m_pinnedInputs = inputs;
+        m_pinnedOutputs = outputs;
+        m_pinnedArrays = gcnew List<Object^>;
+        m_pinnedStdInputs = new Native::ValueRefs<ElemType>();
+        m_pinnedStdOutputs = new Native::ValueRefs<ElemType>();
+        try
+        {
+            TransferVectorsToValueBuffers(inputs, *m_pinnedStdInputs, m_pinnedGCHandleList, StorageType::Sparse);
+            TransferVectorsToValueBuffers(outputs, *m_pinnedStdOutputs, m_pinnedGCHandleList, StorageType::Dense);
+        }
+        catch (Exception^)
+        {
+            UnpinBuffers();
+            throw;
+        }
+
+        // (to detect arrays that have been replaced since they were pinned)
+        for each (auto item in inputs)
+        {
+            m_pinnedArrays->Add(item->Buffer);
+            m_pinnedArrays->Add(item->Indices);
+            m_pinnedArrays->Add(item->ColIndices);
+        }
+        for each (auto item in outputs)
+        {
+            m_pinnedArrays->Add(item->Buffer);
+            m_pinnedArrays->Add(item->Indices);
+            m_pinnedArrays->Add(item->ColIndices);
+        }
+    }
+
+    //
+    // Releases the buffers pinned by PinBuffers().
+    //
+    void UnpinBuffers()
+    {
+        if (m_pinnedGCHandleList != nullptr)
+        {
+            for each (auto h in m_pinnedGCHandleList)
+            {
+                h.Free();
+            }
+            m_pinnedGCHandleList = nullptr;
+        }
+
+        delete m_pinnedStdInputs;
+        m_pinnedStdInputs = nullptr;
+        delete m_pinnedStdOutputs;
+        m_pinnedStdOutputs = nullptr;
+        m_pinnedInputs = nullptr;
+        m_pinnedOutputs = nullptr;
+        m_pinnedArrays = nullptr;
+    }
+
+    //
+    // Forward Pass - as above, with the buffers given to PinBuffers().
+    //
+    void ForwardPass(bool resetRNN)
+    {
+        if (m_eval == nullptr)
+        {
+            throw gcnew ObjectDisposedException("Object has been disposed.");
+        }
+
+        if (m_pinnedGCHandleList == nullptr)
+        {
+            throw gcnew CNTKRuntimeException("No buffers have been pinned for ForwardPass, see PinBuffers", String::Empty);
+        }
+
+        int k = 0;
+        for each (auto item in m_pinnedInputs)
+        {
+            if (!Object::ReferenceEquals(item->Buffer, m_pinnedArrays[k++]) ||
+                !Object::ReferenceEquals(item->Indices, m_pinnedArrays[k++]) ||
+                !Object::ReferenceEquals(item->ColIndices, m_pinnedArrays[k++]))
+            {
+                throw gcnew CNTKRuntimeException("A buffer pinned by PinBuffers has been replaced", String::Empty);
+            }
+        }
+        for each (auto item in m_pinnedOutputs)
+        {
+            if (!Object::ReferenceEquals(item->Buffer, m_pinnedArrays[k++]) ||
+                !Object::ReferenceEquals(item->Indices, m_pinnedArrays[k++]) ||
+                !Object::ReferenceEquals(item->ColIndices, m_pinnedArrays[k++]))
+            {
+                throw gcnew CNTKRuntimeException("A buffer pinned by PinBuffers has been replaced", String::Empty);
+            }
+        }
+
+        // the sizes of the inputs may have changed since the last call, and the outputs may take their whole buffer again
+        for (int i = 0; i < m_pinnedInputs->Length; ++i)
+        {
+            SetValueBufferSizes(m_pinnedInputs[i], &(*m_pinnedStdInputs)[i], StorageType::Sparse);
+        }
+        for (int i = 0; i < m_pinnedOutputs->Length; ++i)
+        {
+            SetValueBufferSizes(m_pinnedOutputs[i], &(*m_pinnedStdOutputs)[i], StorageType::Dense);
+        }
+
+        try
+        {
+            m_eval->ForwardPass(*m_pinnedStdInputs, *m_pinnedStdOutputs, resetRNN);
+
+            // Update actual output size.
+            for (int i = 0; i < m_pinnedOutputs->Length; ++i)
+            {
+                m_pinnedOutputs[i]->Size = (int)(*m_pinnedStdOutputs)[i].m_buffer.m_size;
+            }
+        }
+        catch (const exception& ex)
+        {
+            throw GetCustomException(ex);
+        }
+    }
+
     ~ModelEvaluationExtended()
     {
         if (m_eval == nullptr)
@@ -346,6 +485,7 @@ public:
 protected:
     !ModelEvaluationExtended()
     {
+        UnpinBuffers();
         if (m_eval != nullptr)
         {
             m_eval->Destroy();
@@ -357,6 +497,14 @@ private:
     // Native model evaluation instance
     IEvaluateModelExtended<ElemType> *m_eval;
 
+    // The buffers pinned by PinBuffers(), and their native references
+    List<GCHandle>^ m_pinnedGCHandleList;
+    cli::array<ValueBuffer<ElemType>^>^ m_pinnedInputs;
+    cli::array<ValueBuffer<ElemType>^>^ m_pinnedOutputs;
+    List<Object^>^ m_pinnedArrays;
+    Native::ValueRefs<ElemType>* m_pinnedStdInputs;
+    Native::ValueRefs<ElemType>* m_pinnedStdOutputs;
+
     /// <summary> Throws a CLR exception based on a native exception</summary>
     /// <param name="ex">The native exception to throw as a CLR exception</param>
     /// <returns>A CLR exception</returns>
@@ -443,7 +591,8 @@ private:
         GCHandle h = GCHandle::Alloc(itemBuffer, GCHandleType::Pinned);
         pinnedGCHandleList->Add(h);
         ElemType* pp = reinterpret_cast<ElemType *>(h.AddrOfPinnedObject().ToPointer());
-        vb->m_buffer.InitFrom(pp, bufferSize, storageType == StorageType::Sparse ? bufferSize : 0);
+        // (an output may take the whole buffer, which may be larger than the size of the last output written into it)
+        vb->m_buffer.InitFrom(pp, storageType == StorageType::Sparse ? bufferSize : itemBuffer->Length, storageType == StorageType::Sparse ? bufferSize : 0);
     }
 
     void PinIndices(cli::array<int>^ itemBuffer, List<GCHandle>^ pinnedGCHandleList, Native::ValueBuffer<ElemType, Native::VectorRef>* vb, StorageType storageType, int bufferSize)
@@ -462,6 +611,23 @@ private:
         vb->m_colIndices.InitFrom(pp, bufferSize, storageType == StorageType::Sparse ? bufferSize : 0);
     }
 
+    // Sets the sizes of the native references to pinned buffers, as TransferVectorsToValueBuffers() does
+    void SetValueBufferSizes(ValueBuffer<ElemType>^ item, Native::ValueBuffer<ElemType, Native::VectorRef>* vb, StorageType storageType)
+    {
+        int numElements = item->Size;
+        int bufferSize = item->ColIndices != nullptr ? item->ColIndices[item->Size - 1] : item->Size;
+
+        vb->m_buffer.InitFrom(vb->m_buffer.data(), storageType == StorageType::Sparse ? bufferSize : item->Buffer->Length, storageType == StorageType::Sparse ? bufferSize : 0);
+        if (item->Indices != nullptr)
+        {
+            vb->m_indices.InitFrom(vb->m_indices.data(), bufferSize, storageType == StorageType::Sparse ? bufferSize : 0);
+        }
+        if (item->ColIndices != nullptr)
+        {
+            vb->m_colIndices.InitFrom(vb->m_colIndices.data(), numElements, storageType == StorageType::Sparse ? numElements : 0);
+        }
+    }
+
     void TransferVectorsToValueBuffers(cli::array<ValueBuffer<ElemType>^>^ list, Native::ValueRefs<ElemType>& valueRefs, List<GCHandle>^ pinnedGCHandleList, StorageType storageType)
     {
         for each (auto item in list)
@@ -552,6 +718,9 @@ void EmitExtended()
     f.GetOutputSchema();
     f.StartForwardEvaluation(nullptr);
     f.ForwardPass(nullptr, nullptr);
+    f.PinBuffers(nullptr, nullptr);
+    f.ForwardPass(true);
+    f.UnpinBuffers();
 
     ModelEvaluationExtendedD d;
     d.CreateNetwork("");
@@ -559,6 +728,9 @@ void EmitExtended()
     d.GetOutputSchema();
     d.StartForwardEvaluation(nullptr);
     d.ForwardPass(nullptr, nullptr);
+    d.PinBuffers(nullptr, nullptr);
+    d.ForwardPass(true);
+    d.UnpinBuffers();
 
     VariableSchema sc;
     sc.CreateBuffers<float>();
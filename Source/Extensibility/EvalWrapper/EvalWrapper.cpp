@@ -494,12 +494,12 @@ private:
     shared_ptr<std::vector<ElemType>> CopyList(List<ElemType>^ list)
     {
         shared_ptr<std::vector<ElemType>> lower(new std::vector<ElemType>());
-        if (list != nullptr)
+        if (list != nullptr && list->Count > 0)
         {
-            for each (ElemType item in list)
-            {
-                lower->push_back(item);
-            }
+            // one bulk copy from a pinned array instead of one call per item
+            cli::array<ElemType>^ items = list->ToArray();
+            pin_ptr<ElemType> p = &items[0];
+            lower->assign(p, p + items->Length);
         }
         return lower;
     }
@@ -547,11 +547,12 @@ private:
                 throw gcnew NullReferenceException("No output value available.");
             }
 
+            // Copy output to CLI structure (looking up the list once, rather than for every item)
+            List<ElemType>^ output = item.Value;
             int index = 0;
-            // Copy output to CLI structure
             for (auto& vec : *pVec)
             {
-                outputs[item.Key][index++] = vec;
+                output[index++] = vec;
             }
         }
     }
@@ -0,0 +1,70 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Conversion of matrix elements to and from bfloat16 storage, shared by the CPU and GPU implementations.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#pragma push_macro("BFLOAT16_DECL")
+#ifndef BFLOAT16_DECL // to make these accessible to CUDA kernels, say '#define BFLOAT16_DECL __device__ __host__'
+#define BFLOAT16_DECL
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// BFloat16 -- the upper 16 bits of a float: the exponent range of float at 8 bits of precision
+// Used for storing optimizer state (e.g. the moments of Adam) at a fraction of the memory. Values are rounded
+// stochastically (rounded up with the probability of the truncated fraction), so that the small increments of
+// exponentially smoothed averages are not lost on average. The random bits are a hash of a seed and the element index,
+// which gives the same result on CPU and GPU, and needs no random number generator state.
+// A matrix stores 2 (float) or 4 (double) bfloat16 numbers per element.
+struct BFloat16
+{
+    template <class ElemType>
+    static size_t NumPackedElements(size_t numElements)
+    {
+        return (numElements * sizeof(uint16_t) + sizeof(ElemType) - 1) / sizeof(ElemType);
+    }
+
+    static inline BFLOAT16_DECL uint32_t RandomBits(unsigned long seed, size_t index)
+    {
+        // (a variant of the 'lowbias32' integer hash)
+        uint32_t x = (uint32_t)seed ^ ((uint32_t)index * 0x9e3779b9u) ^ (uint32_t)((unsigned long long)index >> 32);
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    static inline BFLOAT16_DECL uint16_t Round(float value, uint32_t randomBits)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        if ((bits & 0x7f800000u) != 0x7f800000u) // (Inf and NaN are truncated)
+        {
+            // A carry into the exponent correctly rounds up to the next power of two (or to Inf beyond the largest float).
+            bits += randomBits & 0xffffu;
+        }
+        return (uint16_t)(bits >> 16);
+    }
+
+    static inline BFLOAT16_DECL float ToFloat(uint16_t value)
+    {
+        uint32_t bits = (uint32_t)value << 16;
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+};
+
+}}}
+
+#pragma pop_macro("BFLOAT16_DECL")
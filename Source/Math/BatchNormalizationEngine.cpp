@@ -6,6 +6,8 @@
 #include "stdafx.h"
 #include "BatchNormalizationEngine.h"
 #include "CuDnnFactories.h"
+#include "TensorView.h"
+#include "MPIWrapper.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -117,6 +119,229 @@ protected:
 template class CntkBatchNormEngine<float>;
 template class CntkBatchNormEngine<double>;
 
+// Spatial batch normalization in the HWC (legacy) layout. The channels are innermost, so a minibatch is normalized
+// like non-spatial batch normalization of a [C x WHN] matrix, which is what this engine passes to the engine it wraps.
+template <class ElemType>
+class HwcBatchNormEngine : public BatchNormEngine<ElemType>
+{
+public:
+    using Base = BatchNormEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    HwcBatchNormEngine(DEVICEID_TYPE deviceId, const TensorShape& inOutT, std::unique_ptr<BatchNormEngine<ElemType>>&& channelEngine)
+                       : Base(deviceId, inOutT, /*spatial=*/true, ImageLayoutKind::HWC), m_channelEngine(std::move(channelEngine))
+    {
+    }
+
+protected:
+    using Base::m_inOutT;
+
+    void EnsureCompatible() override
+    {
+    }
+
+    void ForwardCore(const Mat& in, const Mat& scale, const Mat& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, Mat& runMean, Mat& runVariance,
+                     Mat& out, double epsilon, Mat& savedMean, Mat& savedInvStdDev) override
+    {
+        Mat inPixels = AsPixels(in);
+        Mat outPixels = AsPixels(out);
+        m_channelEngine->Forward(inPixels, scale, bias, inferenceOnly, expAvgFactor, blendFactor, runMean, runVariance, outPixels, epsilon, savedMean, savedInvStdDev);
+    }
+
+    void BackwardCore(const Mat& in, const Mat& srcGrad, Mat& grad, const Mat& scale, double blendFactor, const Mat& savedMean, const Mat& savedInvStdDev,
+                      Mat& scaleGrad, Mat& biasGrad, bool accumulateDataGrad) override
+    {
+        Mat gradPixels = AsPixels(grad);
+        m_channelEngine->Backward(AsPixels(in), AsPixels(srcGrad), gradPixels, scale, blendFactor, savedMean, savedInvStdDev, scaleGrad, biasGrad, accumulateDataGrad);
+    }
+
+private:
+    // view of a minibatch with one column per pixel
+    Mat AsPixels(const Mat& m) const
+    {
+        Mat pixels = m.ColumnSlice(0, m.GetNumCols());
+        pixels.Reshape(m_inOutT[0], m.GetNumElements() / m_inOutT[0]);
+        return pixels;
+    }
+
+    std::unique_ptr<BatchNormEngine<ElemType>> m_channelEngine;
+};
+
+template class HwcBatchNormEngine<float>;
+template class HwcBatchNormEngine<double>;
+
+// Synchronized batch normalization for data-parallel training: the minibatch statistics are those of the minibatches
+// of all workers together, which keeps them usable when each worker only sees a few samples.
+// Each worker reduces its minibatch to per-feature sums of the values and of their squares, which are summed across
+// the workers in a single all-reduce (together with the sample counts). The normalization with the resulting
+// statistics is done by the wrapped engine in its inference mode. In backprop, the per-feature sums of the gradient
+// and of its product with the normalized input are summed across the workers in the same way. The gradients for
+// scale and bias remain those of the local minibatch, since the distributed SGD aggregates them like all parameters.
+template <class ElemType>
+class SyncBatchNormEngine : public BatchNormEngine<ElemType>
+{
+public:
+    using Base = BatchNormEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    SyncBatchNormEngine(DEVICEID_TYPE deviceId, const TensorShape& inOutT, bool spatial, ImageLayoutKind imageLayout,
+                        std::unique_ptr<BatchNormEngine<ElemType>>&& engine, const MPIWrapperPtr& mpi)
+                        : Base(deviceId, inOutT, spatial, imageLayout), m_engine(std::move(engine)), m_mpi(mpi),
+                          m_stats(std::make_shared<Mat>(deviceId)), m_xHat(std::make_shared<Mat>(deviceId)),
+                          m_coefficients(deviceId), m_unused(deviceId), m_numSamples(0)
+    {
+    }
+
+protected:
+    using Base::m_deviceId;
+
+    void EnsureCompatible() override
+    {
+        // (the wrapped engine checks in its own Forward() and Backward())
+    }
+
+    void ForwardCore(const Mat& in, const Mat& scale, const Mat& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, Mat& runMean, Mat& runVariance,
+                     Mat& out, double epsilon, Mat& savedMean, Mat& savedInvStdDev) override
+    {
+        // without minibatch statistics there is nothing to synchronize
+        if (inferenceOnly || (expAvgFactor == 0 && blendFactor == 1))
+        {
+            m_engine->Forward(in, scale, bias, inferenceOnly, expAvgFactor, blendFactor, runMean, runVariance, out, epsilon, savedMean, savedInvStdDev);
+            return;
+        }
+
+        const size_t numFeatures = scale.GetNumRows();
+        const size_t spatialSize = in.GetNumRows() / numFeatures;
+        const TensorShape dataShape(spatialSize, numFeatures, in.GetNumCols());
+        const TensorShape statsShape(1, numFeatures, 1);
+
+        m_stats->Resize(numFeatures, 2);
+        StatisticView(0, statsShape).AssignCopyOf(View(in, dataShape));
+        StatisticView(1, statsShape).AssignSqrOf(View(in, dataShape));
+        m_numSamples = AllReduceStatistics((double)(spatialSize * in.GetNumCols()));
+
+        // minibatch mean and (biased) variance
+        savedMean.Resize(numFeatures, 1);
+        savedInvStdDev.Resize(numFeatures, 1);
+        m_coefficients.Resize(numFeatures, 1);
+        auto mean = View(savedMean, statsShape);
+        auto variance = View(m_coefficients, statsShape);
+        mean.AssignCopyOf(StatisticView(0, statsShape), (ElemType)(1 / m_numSamples));
+        variance.AssignSqrOf(mean);
+        variance.DoCopyOf(-1, StatisticView(1, statsShape), (ElemType)(1 / m_numSamples)); // E[x^2] - E[x]^2
+        m_coefficients.InplaceTruncateBottom(0);                                            // (against rounding)
+
+        // update the running statistics, keeping the unbiased variance like the other engines
+        if (expAvgFactor != 0)
+        {
+            const double unbiasing = m_numSamples > 1 ? m_numSamples / (m_numSamples - 1) : 0;
+            View(runMean, statsShape).DoCopyOf((ElemType)(1 - expAvgFactor), mean, (ElemType)expAvgFactor);
+            View(runVariance, statsShape).DoCopyOf((ElemType)(1 - expAvgFactor), variance, (ElemType)(expAvgFactor * unbiasing));
+        }
+
+        // the mean and inverse standard deviation used for the normalization, blended with the running ones
+        savedInvStdDev.AssignValuesOf(m_coefficients);
+        savedInvStdDev += (ElemType)epsilon;
+        savedInvStdDev.InplaceSqrt().ElementInverse();
+        if (blendFactor != 0)
+        {
+            mean.DoCopyOf((ElemType)(1 - blendFactor), View(runMean, statsShape), (ElemType)blendFactor);
+            m_coefficients.AssignValuesOf(runVariance);
+            m_coefficients += (ElemType)epsilon;
+            m_coefficients.InplaceSqrt().ElementInverse();
+            View(savedInvStdDev, statsShape).DoCopyOf((ElemType)(1 - blendFactor), View(m_coefficients, statsShape), (ElemType)blendFactor);
+        }
+
+        // The wrapped engine normalizes with a given variance, from which it gets the inverse standard deviation back.
+        m_coefficients.AssignElementPowerOf(savedInvStdDev, 2).ElementInverse();
+        m_coefficients -= (ElemType)epsilon;
+        m_engine->Forward(in, scale, bias, /*inferenceOnly=*/true, /*expAvgFactor=*/0, /*blendFactor=*/1, savedMean, m_coefficients,
+                          out, epsilon, m_unused, m_unused); // (these are not produced in inference mode)
+    }
+
+    void BackwardCore(const Mat& in, const Mat& srcGrad, Mat& grad, const Mat& scale, double blendFactor, const Mat& savedMean, const Mat& savedInvStdDev,
+                      Mat& scaleGrad, Mat& biasGrad, bool accumulateDataGrad) override
+    {
+        // normalized with the running statistics only, which do not depend on the minibatch
+        if (blendFactor == 1)
+        {
+            m_engine->Backward(in, srcGrad, grad, scale, blendFactor, savedMean, savedInvStdDev, scaleGrad, biasGrad, accumulateDataGrad);
+            return;
+        }
+
+        const size_t numFeatures = scale.GetNumRows();
+        const size_t spatialSize = in.GetNumRows() / numFeatures;
+        const TensorShape dataShape(spatialSize, numFeatures, in.GetNumCols());
+        const TensorShape statsShape(1, numFeatures, 1);
+
+        // normalized input
+        m_xHat->Resize(in.GetNumRows(), in.GetNumCols());
+        auto xHat = TensorView<ElemType>(m_xHat, dataShape);
+        auto dy = View(srcGrad, dataShape);
+        xHat.AssignDifferenceOf(View(in, dataShape), View(savedMean, statsShape));
+        xHat.AssignElementwiseProductOf(xHat, View(savedInvStdDev, statsShape));
+
+        // gradients for scale and bias of the local minibatch, and summed across the workers
+        m_stats->Resize(numFeatures, 2);
+        StatisticView(0, statsShape).AssignElementwiseProductOf(dy, xHat);
+        StatisticView(1, statsShape).AssignCopyOf(dy);
+        scaleGrad.AssignValuesOf(m_stats->ColumnSlice(0, 1));
+        biasGrad.AssignValuesOf(m_stats->ColumnSlice(1, 1));
+        AllReduceStatistics(0);
+
+        // grad = scale * invStdDev * (dy - mbStatsWeight * (sum(dy) + xHat * sum(dy * xHat)) / numSamples), with the sums over all workers
+        const ElemType mbStatsWeight = (ElemType)(1 - blendFactor); // weight for the contribution from the minibatch statistics
+        m_coefficients.Resize(numFeatures, 1);
+        auto gain = View(m_coefficients, statsShape);
+        gain.AssignElementwiseProductOf(View(scale, statsShape), View(savedInvStdDev, statsShape));
+        StatisticView(0, statsShape).AssignElementwiseProductOf(StatisticView(0, statsShape), gain, (ElemType)(-mbStatsWeight / m_numSamples));
+        StatisticView(1, statsShape).AssignElementwiseProductOf(StatisticView(1, statsShape), gain, (ElemType)(-mbStatsWeight / m_numSamples));
+        auto dx = View(grad, dataShape);
+        dx.DoElementwiseProductOf(accumulateDataGrad ? (ElemType)1 : (ElemType)0, dy, gain, 1);
+        xHat.AssignElementwiseProductOf(xHat, StatisticView(0, statsShape));
+        dx.AddSumOf(xHat, StatisticView(1, statsShape));
+    }
+
+private:
+    static TensorView<ElemType> View(const Mat& m, const TensorShape& shape)
+    {
+        return TensorView<ElemType>(std::make_shared<Mat>(m.AsReference()), shape);
+    }
+
+    TensorView<ElemType> StatisticView(size_t index, const TensorShape& shape) const
+    {
+        return TensorView<ElemType>(std::make_shared<Mat>(m_stats->ColumnSlice(index, 1)), shape);
+    }
+
+    // Sums m_stats across the workers, with one transfer to the host and back. The local sample count is summed along, and returned.
+    double AllReduceStatistics(double numLocalSamples)
+    {
+        const size_t numStats = m_stats->GetNumElements();
+        m_hostStats.resize(numStats + 1);
+        ElemType* hostStats = m_hostStats.data();
+        size_t capacity = m_hostStats.size();
+        m_stats->CopyToArray(hostStats, capacity);
+        m_hostStats[numStats] = (ElemType)numLocalSamples;
+        m_mpi->AllReduce(m_hostStats.data(), m_hostStats.size());
+        m_stats->SetValue(m_stats->GetNumRows(), m_stats->GetNumCols(), m_deviceId, m_hostStats.data());
+        return (double)m_hostStats[numStats];
+    }
+
+    std::unique_ptr<BatchNormEngine<ElemType>> m_engine;
+    MPIWrapperPtr m_mpi;
+    std::shared_ptr<Mat> m_stats; // [numFeatures x 2] per-feature sums
+    std::shared_ptr<Mat> m_xHat;
+    Mat m_coefficients;           // [numFeatures x 1] temporary
+    Mat m_unused;
+    std::vector<ElemType> m_hostStats;
+    double m_numSamples;          // of the last minibatch, over all workers
+};
+
+template class SyncBatchNormEngine<float>;
+template class SyncBatchNormEngine<double>;
+
 template <typename T> bool HasFlag(T src, T testFlag)
 {
     return ((int)src & (int)testFlag) != 0;
@@ -125,8 +350,20 @@ template <typename T> bool HasFlag(T src, T testFlag)
 template <class ElemType>
 std::unique_ptr<BatchNormEngine<ElemType>> BatchNormEngine<ElemType>::Create(DEVICEID_TYPE deviceId, const TensorShape& inOutT,
                                                                              bool spatial, ImageLayoutKind imageLayout,
-                                                                             BatchNormEngineKind enabledEngines)
+                                                                             BatchNormEngineKind enabledEngines,
+                                                                             const MPIWrapperPtr& syncWorkers)
 {
+    if (spatial && imageLayout == ImageLayoutKind::HWC)
+        return std::make_unique<HwcBatchNormEngine<ElemType>>(deviceId, inOutT, Create(deviceId, TensorShape(inOutT[0]), /*spatial=*/false, ImageLayoutKind::CHW, enabledEngines, syncWorkers));
+
+    if (syncWorkers && syncWorkers->NumNodesInUse() > 1)
+    {
+        if (GetMathLibTraceLevel() > 0)
+            fprintf(stderr, "Synchronizing batch normalization statistics across %d workers.\n", (int)syncWorkers->NumNodesInUse());
+
+        return std::make_unique<SyncBatchNormEngine<ElemType>>(deviceId, inOutT, spatial, imageLayout, Create(deviceId, inOutT, spatial, imageLayout, enabledEngines), syncWorkers);
+    }
+
     // Use CNTK as default batch norm engine.
     if (HasFlag(enabledEngines, BatchNormEngineKind::Cntk))
     {
@@ -10,6 +10,8 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+class MPIWrapper;
+
 //-------------------------------------------------------------
 // Batch normalization engine interface.
 //-------------------------------------------------------------
@@ -40,9 +42,12 @@ public:
     void Backward(const Mat& in, const Mat& srcGrad, Mat& grad, const Mat& scale, double blendFactor, const Mat& saveMean, const Mat& saveInvStdDev,
                   Mat& scaleGrad, Mat& biasGrad, bool accumulateDataGrad);
 
+    // If 'syncWorkers' is given and has more than one worker, the minibatch statistics in training are those of the
+    // union of the minibatches of all workers (synchronized batch normalization for data-parallel training).
     static std::unique_ptr<BatchNormEngine<ElemType>> Create(DEVICEID_TYPE deviceId, const TensorShape& inOutT,
                                                              bool spatial, ImageLayoutKind imageLayout,
-                                                             BatchNormEngineKind enabledEngines = BatchNormEngineKind::All);
+                                                             BatchNormEngineKind enabledEngines = BatchNormEngineKind::All,
+                                                             const std::shared_ptr<MPIWrapper>& syncWorkers = nullptr);
 
     DISABLE_COPY_AND_MOVE(BatchNormEngine);
 
@@ -552,8 +552,8 @@ FORCEINLINE void BlockHandlerAVX::HandleBlock128x4(int currBlock, int startRow,
 FORCEINLINE void BlockHandlerAVX::HandleBlock128x1(int currBlock, int startRow, int k, int n, short* newA, short* B,  
         int blockCnt, __m256i* resultStorage, VectorT* /*subtractMe*/)
 {
-    int aOffset = RowToColOffsetRewrittenA(startRow, currBlock, 128, 4, k);
-    int aOffset2 = RowToColOffsetRewrittenA(startRow, currBlock + 1, 128, 4, k);
+    int aOffset = RowToColOffsetRewrittenA(startRow, currBlock, 128, 1, k);
+    int aOffset2 = RowToColOffsetRewrittenA(startRow, currBlock + 1, 128, 1, k);
     short* currA = &newA[aOffset];
     short* currA2 = &newA[aOffset2];
     LOADAVX_128x1;
@@ -578,7 +578,7 @@ FORCEINLINE void BlockHandlerAVX::HandleBlock128x1(int currBlock, int startRow,
         {
             kernelavx128x1(
                     r0b0a2, r0b0b2, r0b0c2, r0b0d2, r0b0e2, r0b0f2, r0b0g2, r0b0h2,
-                    currB2, &accum1);
+                    currB2, &accum2);
         }
 
         resultStorage[RowColToOffset(0, c, n)] = _mm256_add_epi32( resultStorage[RowColToOffset(0, c, n)], _mm256_add_epi32(accum1,  accum2));
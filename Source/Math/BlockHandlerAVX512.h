@@ -0,0 +1,259 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full licence information.
+//
+#pragma once
+#include "BlockMultiplierPlatform.h"
+#include <immintrin.h>
+#include <emmintrin.h>
+#include <assert.h>
+#include <cstdint>
+#define FOR_CNTK
+#ifdef FOR_CNTK
+#include "CommonMatrix.h"
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Block handler for 16-bit integer matrices based on the AVX-512 (F + BW) instruction set.
+// Needs a Skylake-SP or newer processor; use IsSupported() to check before instantiating
+// a BlockMultiplier with it. When SUPPORT_AVX512VNNI is defined (Cascade Lake or newer), the
+// multiply/accumulate pairs are fused into a single vpdpwssd instruction, which produces exactly
+// the same 32-bit lanes as vpmaddwd followed by vpaddd.
+// Blocks of 8 are handled with SSE registers, blocks of 16 with the lower half of a zmm register.
+class MATH_API BlockHandlerAVX512
+{
+
+    private:
+        //USE SSE for the blocks of 8, borrowed from BlockHandlerSSE
+        FORCEINLINE static void kernelsse8x4(__m128i xmmRow0, __m128i xmmRow1, __m128i xmmRow2, __m128i xmmRow3,
+                short* B, __m128i* return1, __m128i* return2, __m128i* return3, __m128i* return4);
+        FORCEINLINE static void kernelsse8x1(__m128i xmmRow0,
+                short* B, __m128i* return1);
+
+        // accum + (pairwise 16-bit products of a and b, summed into 32-bit lanes)
+        FORCEINLINE static __m512i MultiplyAdd(__m512i accum, __m512i a, __m512i b);
+
+        // Loads part 'part' (32 values each) of a block; blocks of 16 are loaded into the lower half, zeroing the upper one.
+        template <int blockSize> FORCEINLINE static __m512i LoadBlock(const short* p, int part);
+
+        // Multiplies rowsPerBlock rows of A by every column of B for 'blockCnt' consecutive blocks of the
+        // common dimension, accumulating into resultStorage. All of the HandleBlockNxM functions forward here.
+        template <int blockSize, int rowsPerBlock> FORCEINLINE static void HandleBlock(int currBlock, int startRow, int k, int n,
+                short* newA, short* B, int blockCnt, __m512i* resultStorage);
+
+        static int RowToColOffsetRewrittenB(int col, int kOffset, int blockSize, int origCols);
+        static int RowToColOffsetRewrittenA(int row, int kOffset, int blockSize, int rowsPerBlock, int origCols);
+        static void DumpM512(__m512i dumpMe);
+    public:
+        typedef __m512i VectorT;
+        typedef int16_t ScalarAT;
+        typedef int16_t ScalarBT;
+        typedef int32_t ScalarCT;
+
+        // Whether the processor (and the OS, which has to save the zmm state) supports this handler.
+        static bool IsSupported();
+
+        FORCEINLINE static void HandleBlock8x4(int currBlock, int startRow, int k, int n, short* newA, short* B,
+                int blockCnt, __m128i* resultStorage);
+        FORCEINLINE static void HandleBlock16x4(int currBlock, int startRow, int k, int n, short* newA, short* B,
+                int blockCnt, __m512i* resultStorage);
+        FORCEINLINE static void HandleBlock32x4(int currBlock, int startRow, int k, int n, short* newA, short* B,
+                int blockCnt, __m512i* resultStorage);
+        FORCEINLINE static void HandleBlock64x4(int currBlock, int startRow, int k, int n, short* newA, short* B,
+                int blockCnt, __m512i* resultStorage);
+        FORCEINLINE static void HandleBlock128x4(int currBlock, int startRow, int k, int n, short* newA, short* B,
+                int blockCnt, __m512i* resultStorage, VectorT* subtractMe);
+
+        FORCEINLINE static void HandleBlock8x1(int currBlock, int startRow, int k, int n, short* newA, short* B,
+                int blockCnt, __m128i* resultStorage);
+        FORCEINLINE static void HandleBlock16x1(int currBlock, int startRow, int k, int n, short* newA, short* B,
+                int blockCnt, __m512i* resultStorage);
+        FORCEINLINE static void HandleBlock32x1(int currBlock, int startRow, int k, int n, short* newA, short* B,
+                int blockCnt, __m512i* resultStorage);
+        FORCEINLINE static void HandleBlock64x1(int currBlock, int startRow, int k, int n, short* newA, short* B,
+                int blockCnt, __m512i* resultStorage);
+        FORCEINLINE static void HandleBlock128x1(int currBlock, int startRow, int k, int n, short* newA, short* B,
+                int blockCnt, __m512i* resultStorage, VectorT* subtractMe);
+
+        static VectorT* PrepareExtraB(const ScalarBT* /*prepareMe*/, int /*k*/, int /*n*/)
+        {
+            return nullptr;
+        }
+        static void FreePreparedB(VectorT* freeMe) { freeMe;  assert(nullptr == freeMe); }
+};
+
+FORCEINLINE void BlockHandlerAVX512::HandleBlock8x4(int currBlock, int startRow, int k, int n, short* newA, short* B,
+        int /*blockCnt*/, __m128i* resultStorage)
+{
+    int aOffset = RowToColOffsetRewrittenA(startRow, currBlock, 8, 4, k);
+    short* currA = &newA[aOffset];
+    __m128i r0b0a = _mm_load_si128((__m128i*)currA);
+    __m128i r1b0a = _mm_load_si128((__m128i*)currA + 1);
+    __m128i r2b0a = _mm_load_si128((__m128i*)currA + 2);
+    __m128i r3b0a = _mm_load_si128((__m128i*)currA + 3);
+    for (int c = 0; c < n; ++c)
+    {
+        short* currB = &B[RowToColOffsetRewrittenB(c, currBlock, 8, n)];
+        __m128i accum1 = _mm_set_epi32(0, 0, 0, 0);
+        __m128i accum2 = _mm_set_epi32(0, 0, 0, 0);
+        __m128i accum3 = _mm_set_epi32(0, 0, 0, 0);
+        __m128i accum4 = _mm_set_epi32(0, 0, 0, 0);
+        kernelsse8x4(r0b0a, r1b0a, r2b0a, r3b0a,
+                currB, &accum1, &accum2, &accum3, &accum4);
+
+        resultStorage[RowColToOffset(0, c, n)] = _mm_add_epi32(resultStorage[RowColToOffset(0, c, n)], accum1);
+        resultStorage[RowColToOffset(1, c, n)] = _mm_add_epi32(resultStorage[RowColToOffset(1, c, n)], accum2);
+        resultStorage[RowColToOffset(2, c, n)] = _mm_add_epi32(resultStorage[RowColToOffset(2, c, n)], accum3);
+        resultStorage[RowColToOffset(3, c, n)] = _mm_add_epi32(resultStorage[RowColToOffset(3, c, n)], accum4);
+    }
+}
+
+FORCEINLINE void BlockHandlerAVX512::HandleBlock8x1(int currBlock, int startRow, int k, int n, short* newA, short* B,
+        int /*blockCnt*/, __m128i* resultStorage)
+{
+    int aOffset = RowToColOffsetRewrittenA(startRow, currBlock, 8, 1, k);
+    short* currA = &newA[aOffset];
+    __m128i r0b0a = _mm_load_si128((__m128i*)currA);
+    for (int c = 0; c < n; ++c)
+    {
+        short* currB = &B[RowToColOffsetRewrittenB(c, currBlock, 8, n)];
+        __m128i accum1 = _mm_set_epi32(0, 0, 0, 0);
+        kernelsse8x1(r0b0a,
+                currB, &accum1);
+
+        resultStorage[RowColToOffset(0, c, n)] = _mm_add_epi32(resultStorage[RowColToOffset(0, c, n)], accum1);
+    }
+}
+
+FORCEINLINE void BlockHandlerAVX512::HandleBlock16x4(int currBlock, int startRow, int k, int n, short* newA, short* B,
+        int /*blockCnt*/, __m512i* resultStorage)
+{
+    HandleBlock<16, 4>(currBlock, startRow, k, n, newA, B, 1, resultStorage);
+}
+
+FORCEINLINE void BlockHandlerAVX512::HandleBlock16x1(int currBlock, int startRow, int k, int n, short* newA, short* B,
+        int /*blockCnt*/, __m512i* resultStorage)
+{
+    HandleBlock<16, 1>(currBlock, startRow, k, n, newA, B, 1, resultStorage);
+}
+
+FORCEINLINE void BlockHandlerAVX512::HandleBlock32x4(int currBlock, int startRow, int k, int n, short* newA, short* B,
+        int /*blockCnt*/, __m512i* resultStorage)
+{
+    HandleBlock<32, 4>(currBlock, startRow, k, n, newA, B, 1, resultStorage);
+}
+
+FORCEINLINE void BlockHandlerAVX512::HandleBlock32x1(int currBlock, int startRow, int k, int n, short* newA, short* B,
+        int /*blockCnt*/, __m512i* resultStorage)
+{
+    HandleBlock<32, 1>(currBlock, startRow, k, n, newA, B, 1, resultStorage);
+}
+
+FORCEINLINE void BlockHandlerAVX512::HandleBlock64x4(int currBlock, int startRow, int k, int n, short* newA, short* B,
+        int /*blockCnt*/, __m512i* resultStorage)
+{
+    HandleBlock<64, 4>(currBlock, startRow, k, n, newA, B, 1, resultStorage);
+}
+
+FORCEINLINE void BlockHandlerAVX512::HandleBlock64x1(int currBlock, int startRow, int k, int n, short* newA, short* B,
+        int /*blockCnt*/, __m512i* resultStorage)
+{
+    HandleBlock<64, 1>(currBlock, startRow, k, n, newA, B, 1, resultStorage);
+}
+
+FORCEINLINE void BlockHandlerAVX512::HandleBlock128x4(int currBlock, int startRow, int k, int n, short* newA, short* B,
+        int blockCnt, __m512i* resultStorage, VectorT* /*subtractMe*/)
+{
+    HandleBlock<128, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+}
+
+FORCEINLINE void BlockHandlerAVX512::HandleBlock128x1(int currBlock, int startRow, int k, int n, short* newA, short* B,
+        int blockCnt, __m512i* resultStorage, VectorT* /*subtractMe*/)
+{
+    HandleBlock<128, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+}
+
+template <int blockSize, int rowsPerBlock>
+FORCEINLINE void BlockHandlerAVX512::HandleBlock(int currBlock, int startRow, int k, int n, short* newA, short* B,
+        int blockCnt, __m512i* resultStorage)
+{
+    // Number of zmm registers holding one row (or one column) of a block
+    const int parts = blockSize < 32 ? 1 : blockSize / 32;
+
+    // One block at a time: a 128x4 block already takes 16 of the 32 zmm registers,
+    // so holding two of them (as the AVX handler does) would only cause spills.
+    for (int b = 0; b < blockCnt; ++b)
+    {
+        short* currA = &newA[RowToColOffsetRewrittenA(startRow, currBlock + b, blockSize, rowsPerBlock, k)];
+        __m512i rows[rowsPerBlock][parts];
+        for (int r = 0; r < rowsPerBlock; ++r)
+            for (int p = 0; p < parts; ++p)
+                rows[r][p] = LoadBlock<blockSize>(currA + r * blockSize, p);
+
+        for (int c = 0; c < n; ++c)
+        {
+            short* currB = &B[RowToColOffsetRewrittenB(c, currBlock + b, blockSize, n)];
+
+            //The gain comes when we have all the row values loaded up
+            //together and we multiply them all times each column, saving m_rowsPerBlock column
+            //loads.
+            __m512i accum[rowsPerBlock];
+            for (int r = 0; r < rowsPerBlock; ++r)
+                accum[r] = _mm512_setzero_si512();
+
+            for (int p = 0; p < parts; ++p)
+            {
+                __m512i col = LoadBlock<blockSize>(currB, p);
+                for (int r = 0; r < rowsPerBlock; ++r)
+                    accum[r] = MultiplyAdd(accum[r], rows[r][p], col);
+            }
+
+            for (int r = 0; r < rowsPerBlock; ++r)
+                resultStorage[RowColToOffset(r, c, n)] = _mm512_add_epi32(resultStorage[RowColToOffset(r, c, n)], accum[r]);
+        }
+    }
+}
+
+template <int blockSize>
+FORCEINLINE __m512i BlockHandlerAVX512::LoadBlock(const short* p, int part)
+{
+    if (blockSize == 16)
+        return _mm512_maskz_loadu_epi16(0xFFFF, p);
+    return _mm512_load_si512((const __m512i*)p + part);
+}
+
+FORCEINLINE __m512i BlockHandlerAVX512::MultiplyAdd(__m512i accum, __m512i a, __m512i b)
+{
+#ifdef SUPPORT_AVX512VNNI
+    return _mm512_dpwssd_epi32(accum, a, b);
+#else
+    return _mm512_add_epi32(accum, _mm512_madd_epi16(a, b));
+#endif
+}
+
+FORCEINLINE void BlockHandlerAVX512::kernelsse8x1(__m128i xmmRow0,
+        short* B, __m128i* return1)
+{
+    __m128i xmmCol0 = _mm_load_si128((__m128i*)B);
+    __m128i result1 = _mm_madd_epi16(xmmRow0, xmmCol0);
+    *return1 = result1;
+}
+
+FORCEINLINE void BlockHandlerAVX512::kernelsse8x4(__m128i xmmRow0, __m128i xmmRow1, __m128i xmmRow2, __m128i xmmRow3,
+        short* B, __m128i* return1, __m128i* return2, __m128i* return3, __m128i* return4)
+{
+    __m128i xmmCol0 = _mm_load_si128((__m128i*)B);
+
+    __m128i result1 = _mm_madd_epi16(xmmRow0, xmmCol0);
+    __m128i result2 = _mm_madd_epi16(xmmRow1, xmmCol0);
+    __m128i result3 = _mm_madd_epi16(xmmRow2, xmmCol0);
+    __m128i result4 = _mm_madd_epi16(xmmRow3, xmmCol0);
+
+    *return1 = result1;
+    *return2 = result2;
+    *return3 = result3;
+    *return4 = result4;
+}
+
+}}}
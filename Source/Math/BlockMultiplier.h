@@ -23,6 +23,9 @@
 #ifdef SUPPORT_AVX2
 #include "BlockHandlerAVX.h"
 #endif
+#ifdef SUPPORT_AVX512
+#include "BlockHandlerAVX512.h"
+#endif
 //#define STDTHREAD
 #define OPENMPTHREAD
 #ifdef STDTHREAD
@@ -73,9 +76,10 @@ template<typename BlockHandlerT>struct HandlerArgs
 // multiplication. Blocks of A and B (the LHS and RHS of the multiplication)
 // are then handed off to a class implementing the BlockHandlerT interface.
 // Implementations are provided for multiplying 16-bit integer matrices using
-// the SSE and AVX2 instruction sets. To compile for AVX2, you need to add the /arch:AVX2
+// the SSE, AVX2 and AVX-512 instruction sets. To compile for AVX2, you need to add the /arch:AVX2
 // flag to the compiler. Note that the AVX2 code only runs on Haswell or better processors,
-// will throw illegal instruction on other machines.
+// will throw illegal instruction on other machines. The same holds for AVX-512 (SUPPORT_AVX512,
+// Skylake-SP or better); see CpuSupportsInstructionSet() for checking this at runtime.
 // To use the code, first call PrepareB, which rewrites B in block order and returns
 // a pointer to the rewritten block (don't forget to call FreePreparedB on it when you're done
 // multiplying by that matrix). Then you can call MultiplyMatrices().
@@ -182,7 +186,7 @@ template<typename BlockHandlerT> class BlockMultiplier
         static void BlockHandler128x4Thread(HandlerArgs<BlockHandlerT> ha)
         {
             // Accumulate full row results locally b/f writing to C
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, alignof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock * ha.n);
             const int blocksAtOnce = 2;
 
@@ -221,7 +225,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler64x4Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, alignof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * 4 * ha.n);
             int32_t* transC = ha.transC;
 
@@ -254,7 +258,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler32x4Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, alignof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * 4 * ha.n);
             int32_t* transC = ha.transC;
 
@@ -287,7 +291,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler16x4Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*) ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, 16);
+            VectorT* resultStorage = (VectorT*) ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, alignof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * 4 * ha.n);
             int32_t* transC = ha.transC;
             for (int currBlock = 0; currBlock < ha.blocks; ++currBlock)
@@ -355,7 +359,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler128x1Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 64);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, alignof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock * ha.n);
             const int blocksAtOnce = 2;
             int32_t* transC = ha.transC;
@@ -379,7 +383,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler64x1Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, alignof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock * ha.n);
             int32_t* transC = ha.transC;
 
@@ -403,7 +407,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler32x1Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, alignof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock * ha.n);
             int32_t* transC = ha.transC;
 
@@ -427,7 +431,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler16x1Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, alignof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock  * ha.n);
             int32_t* transC = ha.transC;
 
@@ -545,10 +549,38 @@ template<typename BlockHandlerT> class BlockMultiplier
         }
 #endif
 
+#ifdef SUPPORT_AVX512
+        //Same as above, for AVX-512 registers. AVX-512 has per-lane masks, so we
+        //blend with those instead of the sign bits.
+        FORCEINLINE static __m512i my_adds_epi32(__m512i a, __m512i b)
+        {
+            __m512i int_min = _mm512_set1_epi32(0x80000000);
+            __m512i int_max = _mm512_set1_epi32(0x7FFFFFFF);
+            __m512i zero = _mm512_setzero_si512();
+            __m512i res = _mm512_add_epi32(a, b);
+            // Overflow iff a and b have the same sign and the sign of res differs from it.
+            __m512i overflow = _mm512_andnot_si512(_mm512_xor_si512(a, b), _mm512_xor_si512(a, res));
+            __mmask16 sat_mask = _mm512_cmplt_epi32_mask(overflow, zero);
+            __m512i saturated = _mm512_mask_blend_epi32(_mm512_cmplt_epi32_mask(a, zero), int_max, int_min);
+            return _mm512_mask_blend_epi32(sat_mask, res, saturated);
+        }
+
+        //Same as above, for AVX-512 registers
+        FORCEINLINE static int32_t my_hadd(__m512i hAddMe)
+        {
+            // Swap the 256-bit halves, then the 128-bit lanes within them, then proceed as for SSE
+            __m512i res1 = my_adds_epi32(hAddMe, _mm512_shuffle_i32x4(hAddMe, hAddMe, _MM_SHUFFLE(1, 0, 3, 2)));
+            __m512i res2 = my_adds_epi32(res1, _mm512_shuffle_i32x4(res1, res1, _MM_SHUFFLE(2, 3, 0, 1)));
+            __m512i res3 = my_adds_epi32(res2, _mm512_shuffle_epi32(res2, _MM_PERM_BADC));
+            __m512i res4 = my_adds_epi32(res3, _mm512_shuffle_epi32(res3, _MM_PERM_CDAB));
+            return _mm_cvtsi128_si32(_mm512_castsi512_si128(res4));
+        }
+#endif
+
 
         int m_numThreads;
 
-        BlockMultiplier(int numThreads = 1) 
+        BlockMultiplier(int numThreads = 1) : m_pBlockHandlerBInfo(nullptr)
         {
             SetNumThreads(numThreads);
         }
@@ -558,18 +590,14 @@ template<typename BlockHandlerT> class BlockMultiplier
             m_numThreads = threads;
 #ifdef STDTHREAD
             m_pPool.reset(new StdThreadPool<HandlerArgs<BlockHandlerT>>(threads));
-#else
-#ifdef OPENMPTHREAD
-            m_oldNumThreads = omp_get_num_threads();
-            omp_set_num_threads(threads);
-#endif
 #endif
+            // (with OpenMP, the threads are given to the parallel loops of MultiplyMatrices(), rather than set for
+            // the whole process, which would change the threads of all other parallel loops as well)
         }
 
         ~BlockMultiplier()
         {
             BlockHandlerT::FreePreparedB(m_pBlockHandlerBInfo);
-            omp_set_num_threads(m_oldNumThreads);
         }
         static ScalarAT* CreateMatrixA(int m, int n, ScalarAT initVal = 0);
         static ScalarBT* CreateMatrixB(int m, int n, ScalarBT initVal = 0);
@@ -580,7 +608,6 @@ template<typename BlockHandlerT> class BlockMultiplier
         // For now we assume m, k and n are all multiples of kernelsize.
         void MultiplyMatrices(ScalarAT* A, int m, int k, ScalarBT* B, int n, int32_t* C, ScalarAT alpha = 1, ScalarBT beta = 0);
         static const int MAXRANGE = 1 << 13;
-        int m_oldNumThreads;
 };
 
 template<typename BlockHandlerT> typename BlockMultiplier<BlockHandlerT>::ScalarAT* BlockMultiplier<BlockHandlerT>::CreateMatrixA(int m, int n, ScalarAT initVal)
@@ -928,16 +955,18 @@ template<typename BlockHandlerT> void BlockMultiplier<BlockHandlerT>::MultiplyMa
                 {
 
 #ifdef OPENMPTHREAD
-#pragma omp parallel for
+#pragma omp parallel for num_threads(m_numThreads)
 #endif
                     for (int startRow = 0; startRow < m; startRow += 4)
                     {
-                        ha.startRow = startRow;
+                        // Each thread needs its own copy; ha itself is shared by the parallel loop.
+                        HandlerArgs<BlockHandlerT> threadArgs = ha;
+                        threadArgs.startRow = startRow;
 #ifdef STDTHREAD
-                        m_pPool->QueueAndWake(ha, currBlockInfo.fourFn);
+                        m_pPool->QueueAndWake(threadArgs, currBlockInfo.fourFn);
 #else
 #ifdef OPENMPTHREAD
-                        currBlockInfo.fourFn(ha);
+                        currBlockInfo.fourFn(threadArgs);
 #endif
 #endif
                     }
@@ -950,16 +979,18 @@ template<typename BlockHandlerT> void BlockMultiplier<BlockHandlerT>::MultiplyMa
                 else if (rowsPerBlock == 1)
                 {
 #ifdef OPENMPTHREAD
-#pragma omp parallel for
+#pragma omp parallel for num_threads(m_numThreads)
 #endif
                     for (int startRow = 0; startRow < m; ++startRow)
                     {
-                        ha.startRow = startRow;
+                        // Each thread needs its own copy; ha itself is shared by the parallel loop.
+                        HandlerArgs<BlockHandlerT> threadArgs = ha;
+                        threadArgs.startRow = startRow;
 #ifdef STDTHREAD
-                        m_pPool->QueueAndWake(ha, currBlockInfo.oneFn);
+                        m_pPool->QueueAndWake(threadArgs, currBlockInfo.oneFn);
 #else
 #ifdef OPENMPTHREAD
-                        currBlockInfo.oneFn(ha);
+                        currBlockInfo.oneFn(threadArgs);
 #endif
 #endif
                     }
@@ -17,3 +17,71 @@
 #endif
 #endif
 
+// Runtime detection of the instruction sets used by the block handlers, so that a
+// block handler is only picked on processors (and operating systems) that support it.
+#if !defined(__aarch64__)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+enum class BlockHandlerInstructionSet
+{
+    AVX2,
+    AVX512,     // AVX-512 foundation + byte/word instructions
+    AVX512VNNI  // ... plus the vector neural network instructions (vpdpwssd)
+};
+
+inline unsigned long long BlockMultiplierXgetbv()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+inline bool CpuSupportsInstructionSet(BlockHandlerInstructionSet instructionSet)
+{
+    // eax, ebx, ecx, edx of cpuid leaves 1 and 7
+    unsigned int leaf1[4], leaf7[4];
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7)
+        return false;
+    __cpuidex(regs, 1, 0);
+    for (int i = 0; i < 4; ++i)
+        leaf1[i] = (unsigned int)regs[i];
+    __cpuidex(regs, 7, 0);
+    for (int i = 0; i < 4; ++i)
+        leaf7[i] = (unsigned int)regs[i];
+#else
+    if (__get_cpuid_max(0, nullptr) < 7)
+        return false;
+    __cpuid_count(1, 0, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+    __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+#endif
+    // The OS has to enable xgetbv (OSXSAVE) and save the ymm (and for AVX-512 also the opmask and zmm) state.
+    const unsigned int osxsave = 1u << 27;
+    if ((leaf1[2] & osxsave) == 0)
+        return false;
+    const unsigned long long ymmState = 0x6, zmmState = 0xE6;
+    unsigned long long xcr0 = BlockMultiplierXgetbv();
+
+    const unsigned int avx2 = 1u << 5, avx512f = 1u << 16, avx512bw = 1u << 30, avx512vnni = 1u << 11;
+    switch (instructionSet)
+    {
+    case BlockHandlerInstructionSet::AVX2:
+        return (leaf7[1] & avx2) && (xcr0 & ymmState) == ymmState;
+    case BlockHandlerInstructionSet::AVX512:
+        return (leaf7[1] & avx512f) && (leaf7[1] & avx512bw) && (xcr0 & zmmState) == zmmState;
+    case BlockHandlerInstructionSet::AVX512VNNI:
+        return CpuSupportsInstructionSet(BlockHandlerInstructionSet::AVX512) && (leaf7[2] & avx512vnni);
+    }
+    return false;
+}
+#endif
@@ -14,6 +14,7 @@
 #include <ctime>
 #include <limits.h>
 #include "QuantizedOperations.h"
+#include "PackedGemmCache.h"
 
 //#include "GPUMatrix.h"
 //#include "CPUSparseMatrix.h"
@@ -99,6 +100,13 @@ public:
     void Adam(CPUMatrix<ElemType>& gradients, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample,
               ElemType momentum, ElemType adaWeight, ElemType adaMul, ElemType epsilon, bool unitGainMomentum, bool adamax=false);
 
+    // see MultiTensorUpdate.h; 'smoothedGradients' are nullptr for the vanilla SGD
+    static void MultiTensorUpdate(const MultiTensorUpdateParams<ElemType>& params, const std::vector<CPUMatrix<ElemType>*>& values,
+                                  const std::vector<CPUMatrix<ElemType>*>& gradients, const std::vector<CPUMatrix<ElemType>*>& smoothedGradients);
+
+    CPUMatrix<ElemType>& AssignPackedBFloat16Of(const CPUMatrix<ElemType>& a, unsigned long seed);
+    CPUMatrix<ElemType>& AssignUnpackedBFloat16Of(const CPUMatrix<ElemType>& packed);
+
     ElemType RmsProp(CPUMatrix<ElemType>& gradients,
                      ElemType RMS_GAMMA,
                      ElemType RMS_WGT_INC,
@@ -160,6 +168,8 @@ public:
     void SetGumbelRandomValue(RNGHandle& rngHandle, const ElemType loc, const ElemType scale);
     void SetGaussianRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED);
     void SetTruncatedNormalRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED);
+    // element i is a function of (seed, offset + i) only (see CounterBasedRandom.h), so the values are the same for any number of threads and on the GPU
+    void SetCounterBasedRandomValue(RandomDistribution distribution, const ElemType a, const ElemType b, unsigned long seed = USE_TIME_BASED_SEED, uint64_t offset = 0);
     void SetUniformRandomMask(const ElemType maskRate, const ElemType scaleValue, RNGHandle& rngHandle);
     void AddGaussianRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED);
 
@@ -413,10 +423,11 @@ public:
     // static BLAS functions
     static void SVD(const CPUMatrix<ElemType>& A, CPUMatrix<ElemType>& SIGMA, CPUMatrix<ElemType>& U, CPUMatrix<ElemType>& VT, CPUMatrix<ElemType>& W);
 
-    static void MultiplyAndWeightedAdd(ElemType alpha, const CPUMatrix<ElemType>& a, const bool transposeA, const CPUMatrix<ElemType>& b, const bool transposeB, ElemType beta, CPUMatrix<ElemType>& c, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier=nullptr);
+    static void MultiplyAndWeightedAdd(ElemType alpha, const CPUMatrix<ElemType>& a, const bool transposeA, const CPUMatrix<ElemType>& b, const bool transposeB, ElemType beta, CPUMatrix<ElemType>& c, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier=nullptr, shared_ptr<PackedGemmCache<ElemType>> pPackedA=nullptr);
     static void MultiplyAndAdd(const CPUMatrix<ElemType>& a, const bool transposeA, const CPUMatrix<ElemType>& b, const bool transposeB, CPUMatrix<ElemType>& c);
     static void Multiply(const CPUMatrix<ElemType>& a, const bool transposeA, const CPUMatrix<ElemType>& b, const bool transposeB, CPUMatrix<ElemType>& c);
     static void Multiply(const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b, CPUMatrix<ElemType>& c);
+    static void BatchedMultiplyAndWeightedAdd(ElemType alpha, const CPUMatrix<ElemType>& a, const bool transposeA, const CPUMatrix<ElemType>& b, const bool transposeB, ElemType beta, CPUMatrix<ElemType>& c, const size_t m, const size_t n, const size_t k);
     static void Multiply1x1AndWeightedAdd(ElemType alpha, const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b, ElemType beta, CPUMatrix<ElemType>& c);
 
     static void ColumnwiseScaleAndWeightedAdd(ElemType alpha, const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& v, ElemType beta, CPUMatrix<ElemType>& c);
@@ -454,6 +465,10 @@ public:
                   const std::array<size_t, 4>& offsets,
                   const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& regularStrides,
                   const SmallVector<size_t>& reducingOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
+    void TensorOp(ElemType beta, const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b, const CPUMatrix<ElemType>& c, ElemType alpha, const ElementWiseProgram& program,
+                  const std::array<size_t, 4>& offsets,
+                  const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                  const SmallVector<size_t>& reducingOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
 
     int Argmin() const;
     int Argmax() const;
@@ -479,6 +494,12 @@ public:
     // extract out a row from a, assign it to [this].
     CPUMatrix<ElemType>& GetARowByIndex(const CPUMatrix<ElemType>& a, const size_t index);
     static void ConductRowElementMultiplyWithShift(const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b, CPUMatrix<ElemType>& c, const size_t shift, bool bFirstmatrixfixed);
+    static void CosSimilarityWithNegativeSamples(const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b, CPUMatrix<ElemType>& invNormA, CPUMatrix<ElemType>& invNormB, CPUMatrix<ElemType>& c, const size_t shift, const size_t negNumber);
+    static void AddCosSimilarityWithNegativeSamplesGradient(const size_t inputIndex, const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b, const CPUMatrix<ElemType>& invNormA, const CPUMatrix<ElemType>& invNormB,
+                                                            const CPUMatrix<ElemType>& c, const CPUMatrix<ElemType>& cGradient, CPUMatrix<ElemType>& gradient, const size_t shift, const size_t negNumber);
+    static void LambdaRankMetrics(const CPUMatrix<ElemType>& gains, const CPUMatrix<ElemType>& scores, const CPUMatrix<ElemType>& queryBegins, CPUMatrix<ElemType>& ranks, CPUMatrix<ElemType>& metrics);
+    static void AddLambdaRankGradient(const CPUMatrix<ElemType>& gains, const CPUMatrix<ElemType>& scores, const CPUMatrix<ElemType>& queryBegins, const CPUMatrix<ElemType>& ranks, const CPUMatrix<ElemType>& metrics,
+                                      const ElemType sigma, CPUMatrix<ElemType>& gradient);
     CPUMatrix<ElemType>& AssignElementProductOfWithShift(const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b, const size_t shift);
 
 public:
@@ -493,13 +514,9 @@ public:
         size_t numRows, numCols;
         int format;
         stream >> matrixName >> format >> numRows >> numCols;
-        ElemType* d_array = new ElemType[numRows * numCols];
-        for (size_t i = 0; i < numRows * numCols; ++i)
-            stream >> d_array[i];
+        us.RequireSize(numRows, numCols);
+        stream.ReadArray(us.Data(), numRows * numCols);
         stream.GetMarker(fileMarkerEndSection, std::wstring(L"EMAT"));
-        us.SetValue(numRows, numCols, d_array, matrixFlagNormal);
-
-        delete[] d_array;
         return stream;
     }
     friend File& operator<<(File& stream, const CPUMatrix<ElemType>& us)
@@ -512,8 +529,7 @@ public:
         stream << s << format;
 
         stream << us.m_numRows << us.m_numCols;
-        for (size_t i = 0; i < us.GetNumElements(); ++i)
-            stream << us.Data()[i];
+        stream.WriteArray(us.Data(), us.GetNumElements());
         stream.PutMarker(fileMarkerEndSection, std::wstring(L"EMAT"));
         return stream;
     }
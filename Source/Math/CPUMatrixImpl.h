@@ -12,6 +12,10 @@
 
 #include "CPUMatrix.h"
 #include "TensorOps.h"
+#include "BFloat16.h"
+#include "MultiTensorUpdate.h"
+#include "CounterBasedRandom.h"
+#include "LambdaRank.h"
 #include <assert.h>
 #include <stdexcept>
 #include <omp.h>
@@ -1120,6 +1124,20 @@ void CPUMatrix<ElemType>::SetTruncatedNormalRandomValue(const ElemType mean, con
     }
 }
 
+template <class ElemType>
+void CPUMatrix<ElemType>::SetCounterBasedRandomValue(RandomDistribution distribution, const ElemType a, const ElemType b, unsigned long seed, uint64_t offset)
+{
+    if (IsEmpty())
+        LogicError("SetCounterBasedRandomValue: Matrix is empty.");
+
+    const uint64_t key = seed == USE_TIME_BASED_SEED ? (uint64_t)time(NULL) : (uint64_t)seed;
+    ElemType* data = Data();
+    const long long n = (long long)GetNumElements();
+#pragma omp parallel for
+    for (long long i = 0; i < n; i++)
+        data[i] = CounterBasedRandom::Value(distribution, a, b, key, offset + (uint64_t)i);
+}
+
 template <class ElemType>
 void CPUMatrix<ElemType>::AddGaussianRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed)
 {
@@ -1356,6 +1374,58 @@ void CPUMatrix<ElemType>::Adam(CPUMatrix<ElemType>& gradients, CPUMatrix<ElemTyp
     }
 }
 
+template <class ElemType>
+/*static*/ void CPUMatrix<ElemType>::MultiTensorUpdate(const MultiTensorUpdateParams<ElemType>& params, const std::vector<CPUMatrix<ElemType>*>& values,
+                                                       const std::vector<CPUMatrix<ElemType>*>& gradients, const std::vector<CPUMatrix<ElemType>*>& smoothedGradients)
+{
+    std::vector<MultiTensorChunk<ElemType>> chunks;
+    for (size_t i = 0; i < values.size(); i++)
+        params.AppendChunks(values[i]->Data(), gradients[i]->Data(), smoothedGradients[i] ? smoothedGradients[i]->Data() : nullptr, values[i]->GetNumElements(), chunks);
+
+    // (one parallel loop over the chunks of all parameters)
+#pragma omp parallel for
+    for (long k = 0; k < (long)chunks.size(); k++)
+    {
+        const auto& chunk = chunks[k];
+        for (int i = 0; i < chunk.size; i++)
+            params.Update(chunk, i);
+    }
+}
+
+template <class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignPackedBFloat16Of(const CPUMatrix<ElemType>& a, unsigned long seed)
+{
+    if (this == &a)
+        LogicError("AssignPackedBFloat16Of: The source and target must not be the same matrix.");
+
+    size_t n = a.GetNumElements();
+    RequireSize(BFloat16::NumPackedElements<ElemType>(n), 1);
+
+    const ElemType* values = a.Data();
+    uint16_t* packed = reinterpret_cast<uint16_t*>(Data());
+#pragma omp parallel for
+    for (long i = 0; i < (long)n; i++)
+        packed[i] = BFloat16::Round((float)values[i], BFloat16::RandomBits(seed, i));
+
+    return *this;
+}
+
+template <class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignUnpackedBFloat16Of(const CPUMatrix<ElemType>& packed)
+{
+    size_t n = GetNumElements();
+    if (packed.GetNumElements() != BFloat16::NumPackedElements<ElemType>(n))
+        LogicError("AssignUnpackedBFloat16Of: The packed matrix does not match the dimensions of the target matrix.");
+
+    const uint16_t* packedValues = reinterpret_cast<const uint16_t*>(packed.Data());
+    ElemType* values = Data();
+#pragma omp parallel for
+    for (long i = 0; i < (long)n; i++)
+        values[i] = (ElemType)BFloat16::ToFloat(packedValues[i]);
+
+    return *this;
+}
+
 template <class ElemType>
 ElemType CPUMatrix<ElemType>::RmsProp(CPUMatrix<ElemType>& gradients,
                                       ElemType RMS_GAMMA,
@@ -3628,30 +3698,31 @@ void CPUMatrix<ElemType>::VectorMax(CPUMatrix<ElemType>& maxIndexes, CPUMatrix<E
         }
         else
         {
-            std::vector<int> indices(m);
-            int i = 0;
-            std::generate(indices.begin(), indices.end(), [&i]
-                          {
-                              return i++;
-                          });
-
-            const ElemType* curVal =            Data();
-            ElemType* curIdx       = maxIndexes.Data();
-            ElemType* curMax       =  maxValues.Data();
-            for (int icol = 0; icol < n; icol++, curVal += m, curIdx += topK, curMax += topK)
+            const ElemType* data = Data();
+#pragma omp parallel
             {
-                // Partial sort, descending order.
-                std::nth_element(indices.begin(), indices.begin() + topK, indices.end(),
-                                 [curVal](const int& a, const int& b)
-                                 {
-                                     return curVal[a] > curVal[b];
-                                 });
-                // REVIEW alexeyk: the following produces warning (see SCL_SECURE_NO_WARNINGS) so use loop instead.
-                // std::transform(indices.begin(), indices.begin() + topK, curIdx, [](const int& a) { return static_cast<ElemType>(a); });
-                for (int i2 = 0; i2 < topK; i2++)
+                std::vector<int> indices(m);
+#pragma omp for
+                for (int icol = 0; icol < n; icol++)
                 {
-                    curIdx[i2] = static_cast<ElemType>(indices[i2]);
-                    curMax[i2] = curVal[indices[i2]];
+                    const ElemType* curVal = data + (size_t)icol * m;
+                    ElemType* curIdx = maxIndexes.Data() + (size_t)icol * topK;
+                    ElemType* curMax = maxValues.Data() + (size_t)icol * topK;
+                    for (int i = 0; i < m; i++)
+                        indices[i] = i;
+                    // Partial sort, descending order, ties go to the smaller index (as on the GPU).
+                    std::partial_sort(indices.begin(), indices.begin() + topK, indices.end(),
+                                      [curVal](const int& a, const int& b)
+                                      {
+                                          return curVal[a] > curVal[b] || (curVal[a] == curVal[b] && a < b);
+                                      });
+                    // REVIEW alexeyk: the following produces warning (see SCL_SECURE_NO_WARNINGS) so use loop instead.
+                    // std::transform(indices.begin(), indices.begin() + topK, curIdx, [](const int& a) { return static_cast<ElemType>(a); });
+                    for (int i2 = 0; i2 < topK; i2++)
+                    {
+                        curIdx[i2] = static_cast<ElemType>(indices[i2]);
+                        curMax[i2] = curVal[indices[i2]];
+                    }
                 }
             }
         }
@@ -4517,177 +4588,117 @@ void CPUMatrix<ElemType>::MaxROIPoolingForward(const size_t numRois, const size_
 {
     size_t roiOutputSize = pooledHeight * pooledWidth * channels;
 
+    // one parallel loop over the ROIs of all images (nested parallel regions would run serially after the first level)
 #pragma omp parallel for
-    for (int imgIdx = 0; imgIdx < numImg; imgIdx++)
+    for (long n = 0; n < (long)(numImg * numRois); n++)
     {
+        const size_t imgIdx = n / numRois;
+        const size_t roiIdx = n % numRois;
         auto img = ColumnSlice(imgIdx, 1);
         auto rois = roiData.ColumnSlice(imgIdx, 1);
-#pragma omp parallel for
-        for (int roiIdx = 0; roiIdx < numRois; roiIdx++)
-        {
-            // each ROI is 4 elements: (x, y, w, h).
-            int base = roiIdx * 4;
+        // each ROI is 4 elements: (x, y, w, h).
+        int base = roiIdx * 4;
 
-            // roi points represent the absolute location of the roi
-            // in the original image.
-            ElemType scX1 = rois(base, (ElemType)0);
-            ElemType scY1 = rois(base + (ElemType)1, (ElemType)0);
-            ElemType scX2 = rois(base + (ElemType)2, (ElemType)0);
-            ElemType scY2 = rois(base + (ElemType)3, (ElemType)0);
+        // roi points represent the absolute location of the roi
+        // in the original image.
+        ElemType scX1 = rois(base, (ElemType)0);
+        ElemType scY1 = rois(base + (ElemType)1, (ElemType)0);
+        ElemType scX2 = rois(base + (ElemType)2, (ElemType)0);
+        ElemType scY2 = rois(base + (ElemType)3, (ElemType)0);
 
-            // compute actual spatial location of the ROI in our featuremap.
-            size_t x1 = (size_t)round(scX1 * spatialScale);
-            size_t y1 = (size_t)round(scY1 * spatialScale);
-            size_t x2 = (size_t)round(scX2 * spatialScale);
-            size_t y2 = (size_t)round(scY2 * spatialScale);
+        // compute actual spatial location of the ROI in our featuremap.
+        size_t x1 = (size_t)round(scX1 * spatialScale);
+        size_t y1 = (size_t)round(scY1 * spatialScale);
+        size_t x2 = (size_t)round(scX2 * spatialScale);
+        size_t y2 = (size_t)round(scY2 * spatialScale);
 
-            ElemType roiW = (ElemType)max(x2 - x1 + 1, (size_t)1);
-            ElemType roiH = (ElemType)max(y2 - y1 + 1, (size_t)1);
+        ElemType roiW = (ElemType)max(x2 - x1 + 1, (size_t)1);
+        ElemType roiH = (ElemType)max(y2 - y1 + 1, (size_t)1);
 
-            const ElemType winW = roiW / (ElemType)pooledWidth;
-            const ElemType winH = roiH / (ElemType)pooledHeight;
+        const ElemType winW = roiW / (ElemType)pooledWidth;
+        const ElemType winH = roiH / (ElemType)pooledHeight;
 
-            // inspired by Ross Girshick fast-rcnn caffe cpu: https://github.com/rbgirshick/fast-rcnn
-            // loop over spatial locations in output.
-#pragma omp parallel for
-            for (int outw = 0; outw < pooledWidth; outw++)
+        // inspired by Ross Girshick fast-rcnn caffe cpu: https://github.com/rbgirshick/fast-rcnn
+        // loop over spatial locations in output.
+        for (int outw = 0; outw < pooledWidth; outw++)
+        {
+            for (int outh = 0; outh < pooledHeight; outh++)
             {
-                for (int outh = 0; outh < pooledHeight; outh++)
-                {
-                    // compute the top left corner of the input
-                    // spatial window corresponding to this output unit
-                    size_t hstart = (size_t)floor(outh * winH);
-                    size_t wstart = (size_t)floor(outw * winW);
+                // compute the top left corner of the input
+                // spatial window corresponding to this output unit
+                size_t hstart = (size_t)floor(outh * winH);
+                size_t wstart = (size_t)floor(outw * winW);
 
-                    // compute bottom right corner (not included)
-                    size_t hend = (size_t)ceil((outh + 1) * winH);
-                    size_t wend = (size_t)ceil((outw + 1) * winW);
+                // compute bottom right corner (not included)
+                size_t hend = (size_t)ceil((outh + 1) * winH);
+                size_t wend = (size_t)ceil((outw + 1) * winW);
 
-                    // offset window based on ROI top left corner.
-                    // these indices are into the input slice.
-                    hstart = min(max(hstart + y1, (size_t)0), height);
-                    wstart = min(max(wstart + x1, (size_t)0), width);
-                    hend = min(max(hend + y1, (size_t)0), height);
-                    wend = min(max(wend + x1, (size_t)0), width);
+                // offset window based on ROI top left corner.
+                // these indices are into the input slice.
+                hstart = min(max(hstart + y1, (size_t)0), height);
+                wstart = min(max(wstart + x1, (size_t)0), width);
+                hend = min(max(hend + y1, (size_t)0), height);
+                wend = min(max(wend + x1, (size_t)0), width);
 
-                    bool isempty = (hend <= hstart) || (wend <= wstart);
+                bool isempty = (hend <= hstart) || (wend <= wstart);
 
-                    for (size_t c = 0; c < channels; c++)
-                    {
-                        // [W x H x C x R x N]; R = ROIs per image
-                        size_t outputIdx = roiIdx * roiOutputSize + outw + outh * pooledWidth + c * pooledHeight * pooledWidth;
-                        size_t maxidx = 0;
-                        ElemType maxval = isempty ? (ElemType)0 : -FLT_MAX;
-                        size_t baseIdx = c * height * width;
+                for (size_t c = 0; c < channels; c++)
+                {
+                    // [W x H x C x R x N]; R = ROIs per image
+                    size_t outputIdx = roiIdx * roiOutputSize + outw + outh * pooledWidth + c * pooledHeight * pooledWidth;
+                    ptrdiff_t maxidx = -1; // (-1 for an empty window, as in the GPU implementation)
+                    ElemType maxval = isempty ? (ElemType)0 : -FLT_MAX;
+                    size_t baseIdx = c * height * width;
 
-                        for (size_t h = hstart; h < hend; h++)
+                    for (size_t h = hstart; h < hend; h++)
+                    {
+                        for (size_t w = wstart; w < wend; w++)
                         {
-                            for (size_t w = wstart; w < wend; w++)
+                            // stored argmax indices are relative to the current channel.
+                            size_t dataIdx = w + h * width;
+                            if (img(baseIdx + dataIdx, 0) > maxval)
                             {
-                                // stored argmax indices are relative to the current channel.
-                                size_t dataIdx = w + h * width;
-                                if (img(baseIdx + dataIdx, 0) > maxval)
-                                {
-                                    maxval = img(baseIdx + dataIdx, 0);
-                                    maxidx = dataIdx;
-                                }
+                                maxval = img(baseIdx + dataIdx, 0);
+                                maxidx = (ptrdiff_t)dataIdx;
                             }
                         }
-                        output(outputIdx, imgIdx) = maxval;
-                        argmax(outputIdx, imgIdx) = maxidx;
                     }
+                    output(outputIdx, imgIdx) = maxval;
+                    argmax(outputIdx, imgIdx) = (ElemType)maxidx;
                 }
             }
         }
     }
 }
 
-// This function loops over locations in the input to the ROIPoolingNode (image locations).
-// It loops over the ROIs corresponding to that image, seeing which ones could contain the current location
-// in their output. For each ROI, it checks the argmax data to see if that ROI indeed chose
-// this pixel location as the maximum. If so, it increments the gradient term for the input location.
+// This function loops over locations in the output of the ROIPoolingNode and adds their gradient to the input
+// location that the forward pass chose as the maximum of the window (argmax is relative to the channel, and -1 for
+// an empty window). The work is proportional to the size of the output rather than to the size of the input times
+// the number of ROIs; the channels of the images are distributed over the threads, so no two write the same location.
 template <class ElemType>
 void CPUMatrix<ElemType>::MaxROIPoolingBackward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
-                                                const size_t pooledWidth, const size_t pooledHeight, const CPUMatrix<ElemType>& roiData, CPUMatrix<ElemType>& grad, 
-                                                CPUMatrix<ElemType>& argmax, double spatialScale) const
+                                                const size_t pooledWidth, const size_t pooledHeight, const CPUMatrix<ElemType>& /*roiData*/, CPUMatrix<ElemType>& grad,
+                                                CPUMatrix<ElemType>& argmax, double /*spatialScale*/) const
 {
-    // loop over images in the batch.
+    const size_t pooledSize = pooledWidth * pooledHeight;
 #pragma omp parallel for
-    for (int imgIdx = 0; imgIdx < numImg; imgIdx++)
+    for (long n = 0; n < (long)(numImg * channels); n++)
     {
-        // ROIs for this image. length 4*numRois;
-        auto rois = roiData.ColumnSlice(imgIdx, 1).Data();
-        // gradient values for all ROIs from this image. length numRois*pooledHeight*pooledWidth*channels;
-        auto pooledGrad = ColumnSlice(imgIdx, 1).Data();
-        auto argmaxCol = argmax.ColumnSlice(imgIdx, 1).Data();
-
-        // loop over spatial locations in the image.
-#pragma omp parallel for
-        for (int w = 0; w < width; w++)
+        const size_t imgIdx = n / channels;
+        const size_t c = n % channels;
+        // [W x H x C x N]
+        ElemType* gradChannel = grad.Data() + imgIdx * grad.GetNumRows() + c * height * width;
+        for (size_t roiN = 0; roiN < numRois; roiN++)
         {
-#pragma omp parallel for
-            for (int h = 0; h < width; h++)
+            // go right up to channel c of the current ROI: [PW x PH x C x R x N]
+            size_t offset = imgIdx * GetNumRows() + (roiN * channels + c) * pooledSize;
+            const ElemType* offsetPoolGrad = Data() + offset;
+            const ElemType* offsetArgmax = argmax.Data() + imgIdx * argmax.GetNumRows() + (roiN * channels + c) * pooledSize;
+            for (size_t k = 0; k < pooledSize; k++)
             {
-                // loop over the ROIs seeing which ones contain this location.
-                for (int roiN = 0; roiN < numRois; roiN++)
-                {
-                    // each ROI is 4 elements: (x, y, w, h).
-                    int roiOffset = roiN * 4;
-
-                    // ROI data points represent the absolute location of the roi
-                    // in the original image.
-                    size_t roiStartW = (size_t)round(rois[roiOffset + 0] * spatialScale);
-                    size_t roiStartH = (size_t)round(rois[roiOffset + 1] * spatialScale);
-                    size_t roiEndW = (size_t)round(rois[roiOffset + 2] * spatialScale);
-                    size_t roiEndH = (size_t)round(rois[roiOffset + 3] * spatialScale);
-
-                    size_t roiWidth = max(roiEndW - roiStartW + 1, (size_t)1);
-                    size_t roiHeight = max(roiEndH - roiStartH + 1, (size_t)1);
-
-                    // skip this ROI if it doesn't contain the current input location.
-                    const bool inROI = (w >= roiStartW && w < roiStartW + roiWidth &&
-                        h >= roiStartH && h < roiStartH + roiHeight);
-                    if (!inROI)
-                        continue;
-
-                    ElemType winH = (ElemType)roiHeight / (ElemType)pooledHeight;
-                    ElemType winW = (ElemType)roiWidth / (ElemType)pooledWidth;
-
-                    // what pooled nodes in the output for this ROI could have pooled this input location?
-                    size_t phstart = (size_t)((h - roiStartH) / winH);
-                    size_t pwstart = (size_t)((w - roiStartW) / winW);
-                    size_t phend = (size_t)(ceil((h - roiStartH + 1) / winH));
-                    size_t pwend = (size_t)(ceil((w - roiStartW + 1) / winW));
-
-                    phstart = min(max(phstart, (size_t)0), pooledHeight);
-                    phend = min(max(phend, (size_t)0), pooledHeight);
-                    pwstart = min(max(pwstart, (size_t)0), pooledWidth);
-                    pwend = min(max(pwend, (size_t)0), pooledWidth);
-
-                    for (size_t c = 0; c < channels; c++)
-                    {
-                        ElemType gradient = 0;
-                        // [W x H x C x N]
-                        size_t index = w + h*width + c*height*width;
-                        // go right up to channel c of the current ROI.
-                        size_t offset = (roiN * channels + c) * pooledWidth * pooledHeight;
-                        const ElemType* offsetPoolGrad = pooledGrad + offset;
-                        const ElemType* offsetArgmax = argmaxCol + offset;
-                        for (size_t ph = phstart; ph < phend; ph++)
-                        {
-                            for (size_t pw = pwstart; pw < pwend; pw++)
-                            {
-                                if ((size_t)offsetArgmax[ph * pooledWidth + pw] == (w + h * width))
-                                {
-                                    gradient += offsetPoolGrad[ph * pooledWidth + pw];
-                                }
-                            }
-                        }
-
-#pragma omp atomic
-                        grad(index, imgIdx) += gradient;
-                    }
-                }
+                ptrdiff_t maxidx = (ptrdiff_t)offsetArgmax[k];
+                if (maxidx >= 0)
+                    gradChannel[maxidx] += offsetPoolGrad[k];
             }
         }
     }
@@ -4865,9 +4876,11 @@ void CPUMatrix<ElemType>::BatchNormalizationBackward(const CPUMatrix<ElemType>&
 /// <param name="transposeB">Whether matrix b is transposed</param>
 /// <param name="beta">Scalar</param>
 /// <param name="c">Resulting matrix, user is responsible for allocating this</param>
+/// <param name="pQuantizedMultiplier">If not null, the product is computed by this quantized multiplier</param>
+/// <param name="pPackedA">If not null, a is known not to change between calls and its packed copy is kept here, see PackedGemmCache</param>
 template <class ElemType>
 void CPUMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const CPUMatrix<ElemType>& a, const bool transposeA, const CPUMatrix<ElemType>& b, const bool transposeB,
-                                                 ElemType beta, CPUMatrix<ElemType>& c, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier)
+                                                 ElemType beta, CPUMatrix<ElemType>& c, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier, shared_ptr<PackedGemmCache<ElemType>> pPackedA)
 {
     if (a.IsEmpty() || b.IsEmpty())
         return;
@@ -4918,6 +4931,42 @@ void CPUMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const CPUMatrix
 
     ldc = (int) c.GetNumRows();
 
+#ifdef USE_MKL
+    if (pQuantizedMultiplier == nullptr && pPackedA != nullptr)
+    {
+        const ElemType* packedA = pPackedA->Get(a.Data(), m, n, k, transposeA, alpha);
+        if (sizeof(ElemType) == sizeof(double))
+        {
+            if (packedA == nullptr)
+            {
+                double* packed = cblas_dgemm_alloc(CblasAMatrix, m, n, k);
+                if (packed == nullptr)
+                    RuntimeError("CPUMatrix<ElemType>::MultiplyAndWeightedAdd : Failed to allocate memory for the packed matrix.");
+                cblas_dgemm_pack(CblasColMajor, CblasAMatrix, mklTransA, m, n, k, alpha, reinterpret_cast<double*>(a.Data()), lda, packed);
+                pPackedA->Set(shared_ptr<ElemType>(reinterpret_cast<ElemType*>(packed), [](ElemType* p) { cblas_dgemm_free(reinterpret_cast<double*>(p)); }), a.Data(), m, n, k, transposeA, alpha);
+                packedA = reinterpret_cast<ElemType*>(packed);
+            }
+            cblas_dgemm_compute(CblasColMajor, CblasPacked, mklTransB, m, n, k, reinterpret_cast<const double*>(packedA), lda, reinterpret_cast<double*>(b.Data()), ldb, beta, reinterpret_cast<double*>(c.Data()), ldc);
+        }
+        else
+        {
+            if (packedA == nullptr)
+            {
+                float* packed = cblas_sgemm_alloc(CblasAMatrix, m, n, k);
+                if (packed == nullptr)
+                    RuntimeError("CPUMatrix<ElemType>::MultiplyAndWeightedAdd : Failed to allocate memory for the packed matrix.");
+#pragma warning(suppress : 4244)
+                cblas_sgemm_pack(CblasColMajor, CblasAMatrix, mklTransA, m, n, k, alpha, reinterpret_cast<float*>(a.Data()), lda, packed);
+                pPackedA->Set(shared_ptr<ElemType>(reinterpret_cast<ElemType*>(packed), [](ElemType* p) { cblas_sgemm_free(reinterpret_cast<float*>(p)); }), a.Data(), m, n, k, transposeA, alpha);
+                packedA = reinterpret_cast<ElemType*>(packed);
+            }
+#pragma warning(suppress : 4244)
+            cblas_sgemm_compute(CblasColMajor, CblasPacked, mklTransB, m, n, k, reinterpret_cast<const float*>(packedA), lda, reinterpret_cast<float*>(b.Data()), ldb, beta, reinterpret_cast<float*>(c.Data()), ldc);
+        }
+        return;
+    }
+#endif
+
     if (pQuantizedMultiplier == nullptr)
     {
         if (sizeof(ElemType) == sizeof(double))
@@ -4940,6 +4989,77 @@ void CPUMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const CPUMatrix
     }
 }
 
+/// <summary>Batched matrix-matrix multiply with col-major matrices: c_i = alpha * op(a_i) * op(b_i) + beta * c_i</summary>
+/// Column i of a, b and c holds the i-th matrix of the batch, stored column-major: a_i is m x k (k x m if transposed),
+/// b_i is k x n (n x k if transposed) and c_i is m x n. a or b may consist of a single column, which is then used for all items.
+template <class ElemType>
+void CPUMatrix<ElemType>::BatchedMultiplyAndWeightedAdd(ElemType alpha, const CPUMatrix<ElemType>& a, const bool transposeA, const CPUMatrix<ElemType>& b, const bool transposeB,
+                                                        ElemType beta, CPUMatrix<ElemType>& c, const size_t m, const size_t n, const size_t k)
+{
+    const size_t batchSize = max(a.GetNumCols(), b.GetNumCols());
+    if (a.GetNumRows() != m * k || b.GetNumRows() != k * n ||
+        (a.GetNumCols() != batchSize && a.GetNumCols() != 1) || (b.GetNumCols() != batchSize && b.GetNumCols() != 1))
+        InvalidArgument("CPUMatrix<ElemType>::BatchedMultiplyAndWeightedAdd : The batches of a and b do not match the product dimensions.");
+
+    if (beta == 0)
+        c.RequireSize(m * n, batchSize);
+    else
+        c.VerifySize(m * n, batchSize); // Can't resize if beta != 0
+
+    if (a.IsEmpty() || b.IsEmpty())
+        return;
+
+    const size_t strideA = a.GetNumCols() == 1 ? 0 : m * k;
+    const size_t strideB = b.GetNumCols() == 1 ? 0 : k * n;
+    const ElemType* dataA = a.Data();
+    const ElemType* dataB = b.Data();
+    ElemType* dataC = c.Data();
+
+    // Larger products are handed to BLAS one at a time, which parallelizes each of them.
+    if (m * n * k > 4096)
+    {
+        CBLAS_TRANSPOSE mklTransA = transposeA ? CBLAS_TRANSPOSE::CblasTrans : CBLAS_TRANSPOSE::CblasNoTrans;
+        CBLAS_TRANSPOSE mklTransB = transposeB ? CBLAS_TRANSPOSE::CblasTrans : CBLAS_TRANSPOSE::CblasNoTrans;
+        int lda = (int) (transposeA ? k : m);
+        int ldb = (int) (transposeB ? n : k);
+        for (size_t i = 0; i < batchSize; i++)
+        {
+            if (sizeof(ElemType) == sizeof(double))
+            {
+                cblas_dgemm((CBLAS_ORDER) (int)MatrixOrder::ColMajor, mklTransA, mklTransB, (int) m, (int) n, (int) k, alpha, reinterpret_cast<const double*>(dataA + i * strideA), lda,
+                            reinterpret_cast<const double*>(dataB + i * strideB), ldb, beta, reinterpret_cast<double*>(dataC + i * m * n), (int) m);
+            }
+            else
+            {
+#pragma warning(suppress : 4244)
+                cblas_sgemm((CBLAS_ORDER) (int)MatrixOrder::ColMajor, mklTransA, mklTransB, (int) m, (int) n, (int) k, alpha, reinterpret_cast<const float*>(dataA + i * strideA), lda,
+                            reinterpret_cast<const float*>(dataB + i * strideB), ldb, beta, reinterpret_cast<float*>(dataC + i * m * n), (int) m);
+            }
+        }
+        return;
+    }
+
+    // Small products are dominated by the overhead of a BLAS call, so they are computed directly, in parallel over the batch.
+#pragma omp parallel for
+    for (long i = 0; i < (long) batchSize; i++)
+    {
+        const ElemType* pa = dataA + i * strideA;
+        const ElemType* pb = dataB + i * strideB;
+        ElemType* pc = dataC + i * m * n;
+        for (size_t col = 0; col < n; col++)
+        {
+            for (size_t row = 0; row < m; row++)
+            {
+                ElemType sum = 0;
+                for (size_t l = 0; l < k; l++)
+                    sum += (transposeA ? pa[l + row * k] : pa[row + l * m]) * (transposeB ? pb[col + l * n] : pb[l + col * k]);
+                // don't read c if beta is 0, it may not be initialized
+                pc[row + col * m] = beta == 0 ? alpha * sum : alpha * sum + beta * pc[row + col * m];
+            }
+        }
+    }
+}
+
 template <class ElemType>
 void CPUMatrix<ElemType>::Multiply1x1AndWeightedAdd(ElemType alpha, const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b,
                                                     ElemType beta, CPUMatrix<ElemType>& c)
@@ -5912,6 +6032,175 @@ void CPUMatrix<ElemType>::InnerProductWithShiftNeg(const CPUMatrix<ElemType>& a,
     }
 }
 
+// negative sample i of column j of a is column (j + shift + i - 1) % n of b, the positive one (i = 0) column j
+template <class ElemType>
+void CPUMatrix<ElemType>::CosSimilarityWithNegativeSamples(const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b, CPUMatrix<ElemType>& invNormA, CPUMatrix<ElemType>& invNormB, CPUMatrix<ElemType>& c, const size_t shift, const size_t negNumber)
+{
+    if (a.IsEmpty() || b.IsEmpty())
+        LogicError("CosSimilarityWithNegativeSamples: one of the input matrices is empty.");
+    if (a.GetNumRows() != b.GetNumRows() || a.GetNumCols() != b.GetNumCols())
+        InvalidArgument("CosSimilarityWithNegativeSamples: Matrices a and b should have same dimension.");
+
+    const long m = (long) a.GetNumRows();
+    const long n = (long) a.GetNumCols();
+    invNormA.RequireSize(1, n);
+    invNormB.RequireSize(1, n);
+    c.RequireSize(negNumber + 1, n);
+
+#pragma omp parallel for
+    for (long j = 0; j < n; j++)
+    {
+        const ElemType* aj = a.Data() + a.LocateColumn(j);
+        const ElemType* bj = b.Data() + b.LocateColumn(j);
+        ElemType sumA = 0, sumB = 0;
+        for (long k = 0; k < m; k++)
+        {
+            sumA += aj[k] * aj[k];
+            sumB += bj[k] * bj[k];
+        }
+        // (as AssignElementInverseOf() of the norms)
+        invNormA(0, j) = 1 / max(sqrt(sumA), (ElemType) EPS_IN_INVERSE);
+        invNormB(0, j) = 1 / max(sqrt(sumB), (ElemType) EPS_IN_INVERSE);
+    }
+
+#pragma omp parallel for
+    for (long j = 0; j < n; j++)
+    {
+        const ElemType* aj = a.Data() + a.LocateColumn(j);
+        for (long i = 0; i <= (long) negNumber; i++)
+        {
+            const long s = i == 0 ? j : (long) ((j + shift + i - 1) % n);
+            const ElemType* bs = b.Data() + b.LocateColumn(s);
+            ElemType sum = 0;
+            for (long k = 0; k < m; k++)
+                sum += aj[k] * bs[k];
+            c(i, j) = sum * invNormA(0, j) * invNormB(0, s);
+        }
+    }
+}
+
+// The gradient of c(i, j) = <x, y> / (|x| |y|) w.r.t. x is y / (|x| |y|) - c(i, j) x / |x|^2, and likewise for y. Each column of the
+// gradient is summed over the samples it is part of, so that the columns can be computed independently of each other.
+template <class ElemType>
+void CPUMatrix<ElemType>::AddCosSimilarityWithNegativeSamplesGradient(const size_t inputIndex, const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b, const CPUMatrix<ElemType>& invNormA, const CPUMatrix<ElemType>& invNormB,
+                                                                      const CPUMatrix<ElemType>& c, const CPUMatrix<ElemType>& cGradient, CPUMatrix<ElemType>& gradient, const size_t shift, const size_t negNumber)
+{
+    const long m = (long) a.GetNumRows();
+    const long n = (long) a.GetNumCols();
+    if (gradient.GetNumRows() != m || gradient.GetNumCols() != n || c.GetNumRows() != negNumber + 1 || cGradient.GetNumRows() != negNumber + 1)
+        InvalidArgument("AddCosSimilarityWithNegativeSamplesGradient: The dimensions of the matrices do not match.");
+
+    const CPUMatrix<ElemType>& self = inputIndex == 0 ? a : b;
+    const CPUMatrix<ElemType>& other = inputIndex == 0 ? b : a;
+    const CPUMatrix<ElemType>& invNormSelf = inputIndex == 0 ? invNormA : invNormB;
+    const CPUMatrix<ElemType>& invNormOther = inputIndex == 0 ? invNormB : invNormA;
+
+#pragma omp parallel for
+    for (long j = 0; j < n; j++)
+    {
+        const ElemType* selfj = self.Data() + self.LocateColumn(j);
+        ElemType* gradj = gradient.Data() + gradient.LocateColumn(j);
+        ElemType selfCoef = 0;
+        for (long i = 0; i <= (long) negNumber; i++)
+        {
+            // the column of the other input that column j is paired with in sample i, and the column of c that holds the pair
+            const long shifted = i == 0 ? 0 : (long) ((shift + i - 1) % n);
+            const long o = inputIndex == 0 ? (j + shifted) % n : (j + n - shifted) % n;
+            const long col = inputIndex == 0 ? j : o;
+            const ElemType g = cGradient(i, col);
+            selfCoef += g * c(i, col);
+            const ElemType otherCoef = g * invNormSelf(0, j) * invNormOther(0, o);
+            const ElemType* othero = other.Data() + other.LocateColumn(o);
+            for (long k = 0; k < m; k++)
+                gradj[k] += otherCoef * othero[k];
+        }
+        selfCoef *= invNormSelf(0, j) * invNormSelf(0, j);
+        for (long k = 0; k < m; k++)
+            gradj[k] -= selfCoef * selfj[k];
+    }
+}
+
+// the rank of each url is the number of urls of its query that precede it
+template <class ElemType>
+void CPUMatrix<ElemType>::LambdaRankMetrics(const CPUMatrix<ElemType>& gains, const CPUMatrix<ElemType>& scores, const CPUMatrix<ElemType>& queryBegins, CPUMatrix<ElemType>& ranks, CPUMatrix<ElemType>& metrics)
+{
+    const long n = (long) gains.GetNumElements();
+    const long numQueries = (long) queryBegins.GetNumElements() - 1;
+    if (scores.GetNumElements() != n || numQueries < 0 || (long) queryBegins.Data()[numQueries] != n)
+        InvalidArgument("LambdaRankMetrics: The dimensions of the matrices do not match.");
+
+    ranks.RequireSize(1, n);
+    metrics.RequireSize(2, numQueries);
+    const ElemType* g = gains.Data();
+    const ElemType* s = scores.Data();
+    ElemType* r = ranks.Data();
+
+#pragma omp parallel for schedule(dynamic)
+    for (long q = 0; q < numQueries; q++)
+    {
+        const long begin = (long) queryBegins.Data()[q];
+        const long end = (long) queryBegins.Data()[q + 1];
+        ElemType idealMetric = 0, metric = 0;
+        for (long i = begin; i < end; i++)
+        {
+            long rank = 0;
+            for (long j = begin; j < end; j++)
+            {
+                if (j != i && LambdaRank::Precedes(s[j], g[j], j, s[i], g[i], i))
+                    rank++;
+            }
+            r[i] = (ElemType) rank;
+            idealMetric += g[i] / (ElemType) log(2.0 + (i - begin));
+            metric += g[i] / (ElemType) log(2.0 + rank);
+        }
+        metrics(0, q) = idealMetric;
+        metrics(1, q) = metric;
+    }
+}
+
+// The lambda of a pair (i, j) is added to url i and subtracted from url j, for the urls i with a gain above the smallest of
+// their query and the urls j after them. Each url sums the lambdas of its own pairs, so that the urls are independent.
+template <class ElemType>
+void CPUMatrix<ElemType>::AddLambdaRankGradient(const CPUMatrix<ElemType>& gains, const CPUMatrix<ElemType>& scores, const CPUMatrix<ElemType>& queryBegins, const CPUMatrix<ElemType>& ranks, const CPUMatrix<ElemType>& metrics,
+                                                const ElemType sigma, CPUMatrix<ElemType>& gradient)
+{
+    const long n = (long) gains.GetNumElements();
+    const long numQueries = (long) queryBegins.GetNumElements() - 1;
+    if (scores.GetNumElements() != n || ranks.GetNumElements() != n || gradient.GetNumElements() != n || metrics.GetNumElements() != 2 * numQueries)
+        InvalidArgument("AddLambdaRankGradient: The dimensions of the matrices do not match.");
+
+    const ElemType* g = gains.Data();
+    const ElemType* s = scores.Data();
+    const ElemType* r = ranks.Data();
+    ElemType* grad = gradient.Data();
+
+#pragma omp parallel for schedule(dynamic)
+    for (long q = 0; q < numQueries; q++)
+    {
+        const long begin = (long) queryBegins.Data()[q];
+        const long end = (long) queryBegins.Data()[q + 1];
+        if (begin == end)
+            continue;
+        const ElemType minGain = g[end - 1];
+        const ElemType idealMetric = metrics(0, q);
+        for (long u = begin; u < end; u++)
+        {
+            ElemType sum = 0;
+            for (long i = begin; i < u; i++)
+            {
+                if (g[i] > minGain)
+                    sum -= LambdaRank::PairLambda(g[i], s[i], r[i], g[u], s[u], r[u], idealMetric, sigma);
+            }
+            if (g[u] > minGain)
+            {
+                for (long j = u + 1; j < end; j++)
+                    sum += LambdaRank::PairLambda(g[u], s[u], r[u], g[j], s[j], r[j], idealMetric, sigma);
+            }
+            grad[u] += sum;
+        }
+    }
+}
+
 template <class ElemType>
 CPUMatrix<ElemType>& CPUMatrix<ElemType>::GetARowByIndex(const CPUMatrix<ElemType>& a, size_t index)
 {
@@ -6089,7 +6378,7 @@ void CPUMatrix<ElemType>::RCRFBackwardCompute(const CPUMatrix<ElemType>& alpha,
 };
 
 // Calculate alpha in forward-backward calculation. equation (6), (7) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
-// GPU x dimension corresponds to utterances, y dimension corresponds to phone sequence in each utterance
+// for one frame of one utterance; AssignCTCScore() runs the recursions of different utterances in parallel
 // prob (input): the posterior output from the network
 // alpha (output): alpha for forward-backward calculation. 
 // phoneSeq (input): phone ID sequence for each utterance in this minibatch, each col is one utterance 
@@ -6099,7 +6388,7 @@ void CPUMatrix<ElemType>::RCRFBackwardCompute(const CPUMatrix<ElemType>& alpha,
 // uttBeginFrame(input): the position of the first frame of each utterance in the minibatch channel. We need this because each channel may contain more than one utterance.
 // uttPhoneNum (input): the phone number of each utterance. The size of this vector =  the number of all utterances in this minibatch
 // numChannels (input): channel number in this minibatch
-// uttNum (input): number of utterances
+// uttId (input): utterance to process
 // t (input): time stamp to process
 // maxPhoneNum (input): the max number of phones between utterances
 // totalPhoneNum (input): the total number of phones of all utterances
@@ -6119,99 +6408,95 @@ void _assignAlphaScore(
     const std::vector<size_t>& uttBeginFrame,
     const std::vector<size_t>& uttPhoneNum,
     size_t numChannels,
-    const size_t uttNum,
+    const size_t uttId,
     const size_t  t,
     const size_t maxPhoneNum, // Maximum length of utterance in this MB
     const size_t totalPhoneNum, // Total number of phones
     const size_t blankTokenId,
     const int delayConstraint)
 {
-    for (size_t uttId = 0;uttId < uttNum;uttId++) {
+    // Number of phones and frames in this utterance
+    size_t frameNum = uttFrameNum[uttId];
+    if (t >= frameNum) return;
 
-        // Number of phones and frames in this utterance
-        size_t frameNum = uttFrameNum[uttId];
-        if (t >= frameNum) continue;
+    size_t phoneNum = uttPhoneNum[uttId];
 
-        size_t phoneNum = uttPhoneNum[uttId];
+    for (int phoneSeqId = 1;phoneSeqId < phoneNum - 1;phoneSeqId++) {
+        // Index of the label in the sequence
 
-#pragma omp parallel for
-        for (int phoneSeqId = 1;phoneSeqId < phoneNum - 1;phoneSeqId++) {
-            // Index of the label in the sequence
+        // Current and previous phone indices in phoneSeq matrix
+        size_t labelid = uttId*maxPhoneNum + phoneSeqId;
 
-            // Current and previous phone indices in phoneSeq matrix
-            size_t labelid = uttId*maxPhoneNum + phoneSeqId;
+        // Actual current phone label
+        size_t phoneId = (size_t)(phoneSeq[labelid]);
 
-            // Actual current phone label
-            size_t phoneId = (size_t)(phoneSeq[labelid]);
-
-            // Index of the current frame in minibatch
-            size_t timeId = (t + uttBeginFrame[uttId])*numChannels + uttToChanInd[uttId];
+        // Index of the current frame in minibatch
+        size_t timeId = (t + uttBeginFrame[uttId])*numChannels + uttToChanInd[uttId];
 
-            // Index of probability of observing phoneId at frame timeId
-            size_t probId = timeId*totalPhoneNum + phoneId;
+        // Index of probability of observing phoneId at frame timeId
+        size_t probId = timeId*totalPhoneNum + phoneId;
 
-            size_t alphaId = maxPhoneNum* timeId + phoneSeqId; // alpha_t(s)
+        size_t alphaId = maxPhoneNum* timeId + phoneSeqId; // alpha_t(s)
 
-            if (t == 0)
+        if (t == 0)
+        {
+            // Initialize recursion
+            if (phoneSeqId == 1 || phoneSeqId == 2)
             {
-                // Initialize recursion
-                if (phoneSeqId == 1 || phoneSeqId == 2)
-                {
-                    alphaScore[alphaId] = prob[probId];
-                }
+                alphaScore[alphaId] = prob[probId];
             }
-            else
+        }
+        else
+        {
+            if (phoneSeqId >= 1)
             {
-                if (phoneSeqId >= 1)
+                size_t timeId_1 = timeId - numChannels; // Index corresponding to (t-1)
+                size_t alphaId_0 = maxPhoneNum* timeId_1 + phoneSeqId; // alpha_{t-1}(s)
+                size_t alphaId_1 = alphaId_0 - 1; // alpha_{t-1}(s-1)
+                size_t alphaId_2 = alphaId_0 - 2; // alpha_{t-1}(s-2)
+                ElemType x = LZERO;
+
+                ElemType ascore;
+                if (phoneSeqId > 2)
                 {
-                    size_t timeId_1 = timeId - numChannels; // Index corresponding to (t-1)
-                    size_t alphaId_0 = maxPhoneNum* timeId_1 + phoneSeqId; // alpha_{t-1}(s)
-                    size_t alphaId_1 = alphaId_0 - 1; // alpha_{t-1}(s-1)
-                    size_t alphaId_2 = alphaId_0 - 2; // alpha_{t-1}(s-2)
-                    ElemType x = LZERO;
-
-                    ElemType ascore;
-                    if (phoneSeqId > 2)
+                    size_t labelid_2 = labelid - 2;
+                    // if current label is not blank and not equal prev non-blank label
+                    if ((size_t)(phoneSeq[labelid]) != blankTokenId && phoneId != (size_t)(phoneSeq[labelid_2]))
                     {
-                        size_t labelid_2 = labelid - 2;
-                        // if current label is not blank and not equal prev non-blank label
-                        if ((size_t)(phoneSeq[labelid]) != blankTokenId && phoneId != (size_t)(phoneSeq[labelid_2]))
-                        {
-                            x = LogAdd(x, alphaScore[alphaId_2]);
-                        }
+                        x = LogAdd(x, alphaScore[alphaId_2]);
                     }
+                }
 
-                    if (phoneSeqId > 1)
-                    {
-                        x = LogAdd(x, alphaScore[alphaId_1]);
-                    }
+                if (phoneSeqId > 1)
+                {
+                    x = LogAdd(x, alphaScore[alphaId_1]);
+                }
 
-                    x = LogAdd(x, alphaScore[alphaId_0]);
+                x = LogAdd(x, alphaScore[alphaId_0]);
 
-                    if (phoneId != SIZE_MAX)
-                        ascore = prob[probId]; // Probability of observing given label at given time
-                    else
-                        ascore = 0;
-                    alphaScore[alphaId] = (ElemType)x + ascore;
-                    if (delayConstraint != -1)
+                if (phoneId != SIZE_MAX)
+                    ascore = prob[probId]; // Probability of observing given label at given time
+                else
+                    ascore = 0;
+                alphaScore[alphaId] = (ElemType)x + ascore;
+                if (delayConstraint != -1)
+                {
+                    size_t labelid_r = labelid + 2;
+                    size_t phoneBoundId_r = (size_t)(phoneBound[labelid_r]);
+                    if (phoneId == blankTokenId)
                     {
-                        size_t labelid_r = labelid + 2;
-                        size_t phoneBoundId_r = (size_t)(phoneBound[labelid_r]);
-                        if (phoneId == blankTokenId)
-                        {
-                            // only constraint right side
-                            if (t > phoneBoundId_r + delayConstraint - 1)
-                                alphaScore[alphaId] = LZERO;
-                        }
-                        else if (phoneId != blankTokenId)
-                        {
-                            if (t > phoneBoundId_r + delayConstraint)
-                                alphaScore[alphaId] = LZERO;
-                        }
+                        // only constraint right side
+                        if (t > phoneBoundId_r + delayConstraint - 1)
+                            alphaScore[alphaId] = LZERO;
+                    }
+                    else if (phoneId != blankTokenId)
+                    {
+                        if (t > phoneBoundId_r + delayConstraint)
+                            alphaScore[alphaId] = LZERO;
                     }
                 }
-
             }
+
         }
     }
 }
@@ -6229,81 +6514,77 @@ void _assignBetaScore(
     const std::vector<size_t>& uttBeginFrame,
     const std::vector<size_t>& uttPhoneNum,
     const size_t numChannels,
-    const size_t uttNum,
+    const size_t uttId,
     const long  t,
     const size_t maxPhoneNum,
     const size_t totalPhoneNum,
     const size_t blankTokenId,
     const int delayConstraint)
 {
-    for (size_t uttId = 0;uttId < uttNum;uttId++) {
+    // Number of phones and frames in this utterance
+    size_t frameNum = uttFrameNum[uttId];
+    if (t >= frameNum) return;
 
-        // Number of phones and frames in this utterance
-        size_t frameNum = uttFrameNum[uttId];
-        if (t >= frameNum) continue;
+    size_t phoneNum = uttPhoneNum[uttId];
 
-        size_t phoneNum = uttPhoneNum[uttId];
+    for (int phoneSeqId = 1;phoneSeqId < phoneNum - 1;phoneSeqId++) {
 
-#pragma omp parallel for
-        for (int phoneSeqId = 1;phoneSeqId < phoneNum - 1;phoneSeqId++) {
+        size_t labelid = uttId*maxPhoneNum + phoneSeqId;
+        size_t labelid_2 = labelid + 2;
+        size_t phoneId = (LONG64)(phoneSeq[labelid]);
+        size_t timeId = (t + uttBeginFrame[uttId])*numChannels + uttToChanInd[uttId];
+        size_t probId = timeId*totalPhoneNum + phoneId;
+        size_t betaid = maxPhoneNum* timeId + phoneSeqId;
+        size_t timeId_1 = timeId + numChannels;
+        size_t betaid_0 = maxPhoneNum* timeId_1 + phoneSeqId;
+        size_t betaid_1 = betaid_0 + 1;
+        size_t betaid_2 = betaid_0 + 2;
 
-            size_t labelid = uttId*maxPhoneNum + phoneSeqId;
-            size_t labelid_2 = labelid + 2;
-            size_t phoneId = (LONG64)(phoneSeq[labelid]);
-            size_t timeId = (t + uttBeginFrame[uttId])*numChannels + uttToChanInd[uttId];
-            size_t probId = timeId*totalPhoneNum + phoneId;
-            size_t betaid = maxPhoneNum* timeId + phoneSeqId;
-            size_t timeId_1 = timeId + numChannels;
-            size_t betaid_0 = maxPhoneNum* timeId_1 + phoneSeqId;
-            size_t betaid_1 = betaid_0 + 1;
-            size_t betaid_2 = betaid_0 + 2;
-
-            if (t == frameNum - 1)
+        if (t == frameNum - 1)
+        {
+            if (phoneSeqId == phoneNum - 3 || phoneSeqId == phoneNum - 2)
             {
-                if (phoneSeqId == phoneNum - 3 || phoneSeqId == phoneNum - 2)
-                {
-                    betaScore[betaid] = prob[probId];
-                }
+                betaScore[betaid] = prob[probId];
             }
-            else
+        }
+        else
+        {
+            if (phoneSeqId >= 1)
             {
-                if (phoneSeqId >= 1)
+                ElemType x = LZERO;
+                ElemType ascore;
+                if (phoneSeqId < phoneNum - 3)
                 {
-                    ElemType x = LZERO;
-                    ElemType ascore;
-                    if (phoneSeqId < phoneNum - 3)
+                    if (phoneSeq[labelid] != blankTokenId && phoneId != phoneSeq[labelid_2])
                     {
-                        if (phoneSeq[labelid] != blankTokenId && phoneId != phoneSeq[labelid_2])
-                        {
-                            x = LogAdd(x, betaScore[betaid_2]);
-                        }
+                        x = LogAdd(x, betaScore[betaid_2]);
                     }
+                }
 
-                    if (phoneSeqId < phoneNum - 2)
-                    {
-                        x = LogAdd(x, betaScore[betaid_1]);
-                    }
+                if (phoneSeqId < phoneNum - 2)
+                {
+                    x = LogAdd(x, betaScore[betaid_1]);
+                }
 
-                    x = LogAdd(x, betaScore[betaid_0]);
+                x = LogAdd(x, betaScore[betaid_0]);
 
-                    if (phoneId != SIZE_MAX)
-                        ascore = prob[probId];
-                    else
-                        ascore = 0;
-                    betaScore[betaid] = (ElemType)x + ascore;
-                    if (delayConstraint != -1)
+                if (phoneId != SIZE_MAX)
+                    ascore = prob[probId];
+                else
+                    ascore = 0;
+                betaScore[betaid] = (ElemType)x + ascore;
+                if (delayConstraint != -1)
+                {
+                    size_t phoneBoundId_r = (size_t)(phoneBound[labelid_2]);
+                    if (phoneId == blankTokenId)
                     {
-                        size_t phoneBoundId_r = (size_t)(phoneBound[labelid_2]);
-                        if (phoneId == blankTokenId)
-                        {
-                            if (t > phoneBoundId_r + delayConstraint - 1)
-                                betaScore[betaid] = LZERO;
-                        }
-                        else if (phoneId != blankTokenId)
-                        {
-                            if (t > phoneBoundId_r + delayConstraint)
-                                betaScore[betaid] = LZERO;
-                        }
+                        if (t > phoneBoundId_r + delayConstraint - 1)
+                            betaScore[betaid] = LZERO;
+                    }
+                    else if (phoneId != blankTokenId)
+                    {
+                        if (t > phoneBoundId_r + delayConstraint)
+                            betaScore[betaid] = LZERO;
                     }
                 }
             }
@@ -6401,16 +6682,22 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignCTCScore(
         // Max number of phones in utterances in this minibatch
         size_t maxPhoneNum = phoneSeq.GetNumRows();
 
-        for (size_t t = 0; t < maxFrameNum; t++)
+        // The recursions of different utterances are independent, so each thread runs them for whole utterances.
+        // (Parallelizing over the labels of a frame instead costs a fork/join per frame and utterance for little work.)
+#pragma omp parallel for schedule(dynamic)
+        for (long uttId = 0; uttId < (long)uttNum; uttId++)
         {
-            _assignAlphaScore(prob.Data(), alpha.Data(), phoneSeq.Data(), phoneBoundary.Data(), uttToChanInd,
-                uttFrameNum, uttBeginFrame, uttPhoneNum, numParallelSequences, uttNum, t, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
-        }
+            for (size_t t = 0; t < uttFrameNum[uttId]; t++)
+            {
+                _assignAlphaScore(prob.Data(), alpha.Data(), phoneSeq.Data(), phoneBoundary.Data(), uttToChanInd,
+                    uttFrameNum, uttBeginFrame, uttPhoneNum, numParallelSequences, uttId, t, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
+            }
 
-        for (LONG64 t = maxFrameNum - 1; t >= 0; t--)
-        {
-            _assignBetaScore(prob.Data(), beta.Data(), phoneSeq.Data(), phoneBoundary.Data(), uttToChanInd,
-                uttFrameNum, uttBeginFrame, uttPhoneNum, numParallelSequences, uttNum, t, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
+            for (LONG64 t = uttFrameNum[uttId] - 1; t >= 0; t--)
+            {
+                _assignBetaScore(prob.Data(), beta.Data(), phoneSeq.Data(), phoneBoundary.Data(), uttToChanInd,
+                    uttFrameNum, uttBeginFrame, uttPhoneNum, numParallelSequences, uttId, (long)t, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
+            }
         }
 
         std::vector<ElemType> scores(uttNum);
@@ -6858,61 +7145,108 @@ struct TensorOpIteration
     }
 };
 
-// Special version for innermost loop with strides all being 1 and no further reduction. Compiler can use SSE.
+// Below this many elements per innermost loop, the cost of starting OpenMP threads exceeds the work.
+static const size_t c_minTensorOpElementsForOpenMP = 4096;
+
+// Special version for innermost loop with strides all being 1 and no further reduction. Compiler can use SSE/AVX.
 // This is a very common case, e.g. adding vectors or computing the Sigmoid.
-template <class ElemType, typename OPFN, typename ReductionOp>
-struct TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, 0 /*innermost loop*/>
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N>
+struct TensorOpIteration<ElemType, OPFN, ReductionOp, N, true /*vectorizable*/, -1 /*no reduction*/, 0 /*innermost loop*/>
 {
-    static inline void Loop(ElemType beta, array<ElemType*, 3> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
-                            const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 3>& regularStrides,
-                            const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 3>& reducingStrides)
+    static inline void Loop(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
+                            const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides,
+                            const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
     {
-        ElemType* pa = pointers[0];
-        ElemType* pb = pointers[1];
-        ElemType* pc = pointers[2];
         size_t K = regularOpDims[0];
         // special-case beta and alpha to allow the compiler to short-circuit it
         if (beta != 0)
-#pragma omp parallel for
-            for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(beta, array<ElemType*, 3>{pa + k, pb + k, pc + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+            ElementLoop<true /*useBeta*/, true /*useAlpha*/>(beta, pointers, alpha, opfn, K);
         else if (alpha != 1)
-#pragma omp parallel for
-            for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 3>{pa + k, pb + k, pc + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+            ElementLoop<false /*useBeta*/, true /*useAlpha*/>(0, pointers, alpha, opfn, K);
         else
-#pragma omp parallel for
-            for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 3>{pa + k, pb + k, pc + k}, 1, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
-        // TODO: According to Amit, the VS compiler is not able to vectorize into lambdas. Solution: change the lambda to take an N, or to implement the loop inside (with 1 element by default).
+            ElementLoop<false /*useBeta*/, false /*useAlpha*/>(0, pointers, 1, opfn, K);
+    }
+
+private:
+    // the loop body is the scalar version (TensorOpIteration<..., -1>) with the pointers advanced by a hard-coded 1
+    template <bool useBeta, bool useAlpha>
+    static inline void ElementLoop(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, const OPFN& opfn, size_t K)
+    {
         // TODO: The signedness of k (required for omp) causes an extra sign-extend.
-        // TODO: OMP adds LOTS of overhead. Do we need a guard, a min size when to use it?
+#pragma omp parallel for if (K >= c_minTensorOpElementsForOpenMP)
+        for (int k = 0; k < (int) K; k++)
+        {
+            array<ElemType*, N> pp;
+            for (size_t i = 0; i < N; i++) // N = a small constant, this will be unrolled
+                pp[i] = pointers[i] + k;
+            ElemType val = opfn(pp);
+            if (useAlpha)
+                val *= alpha;
+            if (useBeta)
+                val += beta * *pp[N - 1];
+            *pp[N - 1] = val;
+        }
     }
 };
-// and unary
-template <class ElemType, typename OPFN, typename ReductionOp>
-struct TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, 0 /*innermost loop*/>
+
+// Special version for innermost loop with strides all being 1 and a reduction over a single, outer dimension, e.g. the
+// sum over the columns of a matrix (the gradient of a bias). Rather than striding through the reduced dimension separately
+// for each output element, this walks it in the outer loop over a block of outputs, so that all accesses are contiguous.
+// Each output is still aggregated (in double) in the same order as TensorOpReduction does, so the results are identical.
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N>
+struct TensorOpIteration<ElemType, OPFN, ReductionOp, N, true /*vectorizable*/, 0 /*one reduction*/, 0 /*innermost loop*/>
 {
-    static inline void Loop(ElemType beta, array<ElemType*, 2> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
-                            const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides,
-                            const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 2>& reducingStrides)
+    static inline void Loop(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
+                            const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides,
+                            const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
     {
-        ElemType* pa = pointers[0];
-        ElemType* pb = pointers[1];
+        const size_t blockSize = 256;
         size_t K = regularOpDims[0];
-        // special-case beta and alpha to allow the compiler to short-circuit it
-        if (beta != 0)
-#pragma omp parallel for
-            for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(beta, array<ElemType*, 2>{pa + k, pb + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
-        else if (alpha != 1)
-#pragma omp parallel for
-            for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 2>{pa + k, pb + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
-        else
-#pragma omp parallel for
-            for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 2>{pa + k, pb + k}, 1, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+        size_t J = reducingOpDims[0];
+        array<ptrdiff_t, N - 1> strides; // N-1 because last one is the result pointer, which is not reduced
+        for (size_t i = 0; i < N - 1; i++)
+            strides[i] = reducingStrides[i][0];
+
+#pragma omp parallel for if (K * J >= c_minTensorOpElementsForOpenMP)
+        for (int block = 0; block < (int) ((K + blockSize - 1) / blockSize); block++)
+        {
+            double aggregate[blockSize];
+            size_t begin = block * blockSize;
+            size_t end = min(K, begin + blockSize);
+            array<ElemType*, N> pp;
+            for (size_t i = 0; i < N; i++)
+                pp[i] = pointers[i] + begin;
+
+            for (size_t k = 0; k < end - begin; k++)
+                aggregate[k] = opfn(Advanced(pp, k));
+            for (size_t j = 1; j < J; j++)
+            {
+                for (size_t i = 0; i < N - 1; i++)
+                    pp[i] += strides[i];
+                for (size_t k = 0; k < end - begin; k++)
+                    aggregate[k] = reductionOp(aggregate[k], opfn(Advanced(pp, k)));
+            }
+
+            // same as the scalar version (TensorOpIteration<..., -1>)
+            ElemType* pout = pp[N - 1];
+            for (size_t k = 0; k < end - begin; k++)
+            {
+                ElemType val = (ElemType) aggregate[k];
+                val *= alpha;
+                if (beta != 0)
+                    val += beta * pout[k];
+                pout[k] = val;
+            }
+        }
+    }
+
+private:
+    static inline array<ElemType*, N> Advanced(const array<ElemType*, N>& pointers, size_t k)
+    {
+        array<ElemType*, N> pp;
+        for (size_t i = 0; i < N; i++)
+            pp[i] = pointers[i] + k;
+        return pp;
     }
 };
 
@@ -6994,7 +7328,16 @@ static void TensorOpWithRegularLoop(ElemType beta, const array<ElemType*, N>& po
     case 2:
         return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, 1, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     case 1:
-        return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, 0, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+    {
+        // if all leading dimensions are 1 and the reduction is over an outer dimension, we can reduce a block of outputs at once
+        bool leadingAllOne = true;
+        for (size_t i = 0; i < N; i++)
+            leadingAllOne &= k >= 0 && regularStrides[i][0] == 1;
+        if (leadingAllOne && reducingOpDims[0] > 1)
+            return TensorOpIteration<ElemType, OPFN, ReductionOp, N, true /*vectorizable*/, 0, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+        else
+            return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, 0, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+    }
     case 0:
     {
         // if all leading dimensions are 1, we can let the compiler do some unrolling
@@ -7073,6 +7416,50 @@ static void TensorOpWithFn(ElemType beta, array<ElemType*, N> pointers, ElemType
     }
 }
 
+// check whether a unary tensor op is a copy that swaps the stride-1 axis, i.e. a (batched) matrix transpose
+// c[i0 + i1 * ldc] = a[i1 + i0 * lda] for i0 < regularOpDims[0], i1 < regularOpDims[1], and an optional third (batch) dimension.
+static bool IsTensorTranspose(const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides, const SmallVector<size_t>& reducingOpDims)
+{
+    if (!reducingOpDims.empty() || (regularOpDims.size() != 2 && regularOpDims.size() != 3))
+        return false;
+    const auto& aStrides = regularStrides[0];
+    const auto& cStrides = regularStrides[1];
+    if (cStrides[0] != 1 || aStrides[1] != 1 ||
+        aStrides[0] < (ptrdiff_t)regularOpDims[1] || cStrides[1] < (ptrdiff_t)regularOpDims[0])
+        return false;
+    return regularOpDims.size() == 2 || (aStrides[2] >= 0 && cStrides[2] > 0);
+}
+
+// transposes in square blocks, so that the strided reads of a block stay in the cache while its columns are written
+template <class ElemType>
+static void TensorTransposeBlocked(ElemType beta, const ElemType* a, ElemType* c, ElemType alpha,
+                                   size_t n0, size_t n1, size_t lda, size_t ldc, size_t batch, size_t batchStrideA, size_t batchStrideC)
+{
+    const size_t blockSize = 32;
+    const size_t numBlocks1 = (n1 + blockSize - 1) / blockSize;
+#pragma omp parallel for
+    for (long b = 0; b < (long)(batch * numBlocks1); b++)
+    {
+        const ElemType* pa = a + (b / numBlocks1) * batchStrideA;
+        ElemType* pc = c + (b / numBlocks1) * batchStrideC;
+        const size_t i1Begin = (b % numBlocks1) * blockSize;
+        const size_t i1End = min(i1Begin + blockSize, n1);
+        for (size_t i0Begin = 0; i0Begin < n0; i0Begin += blockSize)
+        {
+            const size_t i0End = min(i0Begin + blockSize, n0);
+            for (size_t i1 = i1Begin; i1 < i1End; i1++)
+            {
+                for (size_t i0 = i0Begin; i0 < i0End; i0++)
+                {
+                    ElemType val = alpha * pa[i1 + i0 * lda];
+                    ElemType& out = pc[i0 + i1 * ldc];
+                    out = beta == 0 ? val : beta * out + val; // if beta is 0, then out is not read
+                }
+            }
+        }
+    }
+}
+
 // -----------------------------------------------------------------------
 // entry points from Matrix.cpp; also map op to a lambda
 // -----------------------------------------------------------------------
@@ -7101,6 +7488,15 @@ void CPUMatrix<ElemType>::TensorOp(ElemType beta, const CPUMatrix<ElemType>& a,
                               },                                                       \
                               reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides)
 
+    // special case: copy that swaps the stride-1 axis (e.g. TransposeDimensions); the element-by-element loop would read it with a large stride
+    if (op == ElementWiseOperator::opCopy && a.Data() != Data() && IsTensorTranspose(regularOpDims, regularStrides, reducingOpDims))
+    {
+        const bool batched = regularOpDims.size() == 3;
+        return TensorTransposeBlocked(beta, a.Data() + offsets[0], Data() + offsets[1], alpha, regularOpDims[0], regularOpDims[1],
+                                      (size_t)regularStrides[0][0], (size_t)regularStrides[1][1],
+                                      batched ? regularOpDims[2] : 1, batched ? (size_t)regularStrides[0][2] : 0, batched ? (size_t)regularStrides[1][2] : 0);
+    }
+
     array<ElemType*, 2> pointers = {a.Data(), Data()};
     switch (op)
     {
@@ -7166,6 +7562,24 @@ void CPUMatrix<ElemType>::TensorOp(ElemType beta, const CPUMatrix<ElemType>& a,
     }
 }
 
+// perform a fused sequence of element-wise ops in a single pass over the tensors
+template <class ElemType>
+void CPUMatrix<ElemType>::TensorOp(ElemType beta, const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b, const CPUMatrix<ElemType>& c, ElemType alpha, const ElementWiseProgram& program,
+                                   const array<size_t, 4>& offsets,
+                                   const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                                   const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 4>& reducingStrides)
+{
+    if (program.numSteps == 0 || program.numSteps > ElementWiseProgram::MaxSteps)
+        InvalidArgument("TensorOp: Invalid number of steps (%d) in element-wise program.", (int) program.numSteps);
+
+    array<ElemType*, 4> pointers = {a.Data(), b.Data(), c.Data(), Data()};
+    TensorOpWithFn(beta, pointers, alpha, [&program](const array<ElemType*, 4>& pp)
+                   {
+                       return EvaluateElementWiseProgram(program, (*(pp[0])), (*(pp[1])), (*(pp[2])));
+                   },
+                   ElementWiseOperator::opSum, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+}
+
 template <class ElemType>
 int CPUMatrix<ElemType>::Argmin() const
 {
@@ -7381,6 +7795,28 @@ template short* CPUMatrix<short>::CopyToArray(void) const;
 template void CPUMatrix<short>::CopySection(size_t numRows, size_t numCols, short* dst, size_t colStride) const;
 template void CPUMatrix<short>::Reshape(const size_t, const size_t);
 
+// Support <half>
+template CPUMatrix<half>::CPUMatrix(const size_t numRows, const size_t numCols);
+template CPUMatrix<half>::CPUMatrix(const size_t numRows, const size_t numCols, half* pArray, const size_t matrixFlags);
+template CPUMatrix<half>::CPUMatrix();
+template CPUMatrix<half>::CPUMatrix(CPUMatrix<half> const&);
+template CPUMatrix<half>::CPUMatrix(CPUMatrix<half>&&);
+template size_t CPUMatrix<half>::LocateElement(size_t, size_t) const;
+template CPUMatrix<half> CPUMatrix<half>::ColumnSlice(size_t startColumn, size_t numCols) const;
+template CPUMatrix<half>& CPUMatrix<half>::operator=(CPUMatrix<half>&&);
+template void CPUMatrix<half>::SetValue(const half);
+template void CPUMatrix<half>::SetValue(const size_t numRows, const size_t numCols, half* pArray, size_t matrixFlags);
+template void CPUMatrix<half>::SetValue(CPUMatrix<half> const&);
+//template void CPUMatrix<half>::SetValue(GPUMatrix<half> const&);
+//template void CPUMatrix<half>::SetValue(CPUSparseMatrix<half> const&);
+//template void CPUMatrix<half>::SetValue(GPUSparseMatrix<half> const&);
+template void CPUMatrix<half>::RequireSize(const size_t numRows, const size_t numCols, bool growOnly);
+template void CPUMatrix<half>::Resize(const size_t numRows, const size_t numCols, bool growOnly);
+template half* CPUMatrix<half>::CopyToArray(void) const;
+template void CPUMatrix<half>::CopySection(size_t numRows, size_t numCols, half* dst, size_t colStride) const;
+template void CPUMatrix<half>::Reshape(const size_t, const size_t);
+template size_t CPUMatrix<half>::CopyToArray(half*& arrayCopyTo, size_t& currentArraySize) const;
+
 template CPUMatrix<int>::CPUMatrix(const size_t, const size_t, int*, const size_t);
 
 }}}
@@ -23,8 +23,27 @@ public:
         return m_generator;
     }
 
+    // the generator cannot seek cheaply, so these keep copies of its state
+    virtual void Mark(uint64_t /*offset*/) override
+    {
+        m_markedGenerator = m_generator;
+    }
+
+    virtual void RewindToMark() override
+    {
+        m_resumeGenerator = m_generator;
+        m_generator = m_markedGenerator;
+    }
+
+    virtual void Resume(uint64_t /*offset*/) override
+    {
+        m_generator = m_resumeGenerator;
+    }
+
 private:
     std::mt19937_64 m_generator;
+    std::mt19937_64 m_markedGenerator;
+    std::mt19937_64 m_resumeGenerator;
 };
 
 }}}
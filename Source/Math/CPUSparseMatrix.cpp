@@ -14,6 +14,7 @@
 #include <math.h>
 #include "CPUMatrix.h"
 #include "CPUSparseMatrix.h"
+#include "LazySparseUpdate.h"
 #include <random>
 #include <chrono>
 #include <iostream>
@@ -233,6 +234,87 @@ CPUSparseMatrix<ElemType>& CPUSparseMatrix<ElemType>::AssignOneHot(const CPUMatr
     return *this;
 }
 
+// this(:, indices(i)) += values(:, i), into a matrixFormatSparseBlockCol matrix whose blocks are the columns that are hit.
+// The (column, position) pairs are sorted, so that repeated indices are summed once per column in the order of their
+// positions, and the columns are then independent. As ScatterValues(), NaN and negative indices are skipped.
+template <class ElemType>
+CPUSparseMatrix<ElemType>& CPUSparseMatrix<ElemType>::ScatterToIndices(const CPUMatrix<ElemType>& values, const CPUMatrix<ElemType>& indices, size_t row_elements)
+{
+    if (!OwnBuffer())
+        LogicError("Cannot modify since the buffer is managed externally.");
+
+    if (indices.IsEmpty() || values.IsEmpty())
+        LogicError("ScatterToIndices: input matrix is empty.");
+
+    if (GetFormat() != matrixFormatSparseBlockCol || row_elements != GetNumRows() || values.GetNumElements() != row_elements * indices.GetNumElements())
+        NOT_IMPLEMENTED;
+
+    const size_t numRows = GetNumRows();
+    const size_t numCols = GetNumCols();
+    vector<pair<size_t, size_t>> columns;
+    columns.reserve(indices.GetNumElements());
+    for (size_t i = 0; i < indices.GetNumElements(); i++)
+    {
+        const ElemType col = indices.Data()[i];
+        if (std::isnan(col) || col < 0)
+            continue;
+        if ((size_t) col >= numCols)
+            InvalidArgument("ScatterToIndices: Indices map out of bounds. %ld >= %ld", (long int) col, (long int) numCols);
+        columns.push_back(make_pair((size_t) col, i));
+    }
+    sort(columns.begin(), columns.end());
+
+    // as MultiplyAndAdd(), the new columns get blocks after the existing ones
+    size_t blockSizePrev = GetBlockSize();
+    if (blockSizePrev == 0)
+        RequireSizeAndAllocate(numRows, numCols, 0, true); // allocate for blockIds
+
+    map<size_t, size_t> col2BlockId;
+    for (size_t blockId = 0; blockId < blockSizePrev; blockId++)
+        col2BlockId[GetBlockIds()[blockId]] = blockId;
+
+    vector<size_t> segmentBegins, segmentBlockIds;
+    size_t blockSizeCurr = blockSizePrev;
+    for (size_t k = 0; k < columns.size(); k++)
+    {
+        if (k > 0 && columns[k].first == columns[k - 1].first)
+            continue;
+        size_t col = columns[k].first;
+        if (col2BlockId.find(col) == col2BlockId.end())
+        {
+            col2BlockId[col] = blockSizeCurr;
+            GetBlockIds()[blockSizeCurr] = col;
+            blockSizeCurr++;
+        }
+        segmentBegins.push_back(k);
+        segmentBlockIds.push_back(col2BlockId[col]);
+    }
+    segmentBegins.push_back(columns.size());
+
+    if (blockSizeCurr > blockSizePrev)
+    {
+        RequireSizeAndAllocate(numRows, numCols, numRows * blockSizeCurr, true, true);
+        SetBlockSize(blockSizeCurr);
+        memset(Data() + numRows * blockSizePrev, 0, sizeof(ElemType) * numRows * (blockSizeCurr - blockSizePrev));
+    }
+
+    ElemType* data = Data();
+    const ElemType* valueData = values.Data();
+#pragma omp parallel for
+    for (long s = 0; s < (long) segmentBlockIds.size(); s++)
+    {
+        ElemType* block = data + segmentBlockIds[s] * numRows;
+        for (size_t k = segmentBegins[s]; k < segmentBegins[s + 1]; k++)
+        {
+            const ElemType* v = valueData + columns[k].second * numRows;
+            for (size_t j = 0; j < numRows; j++)
+                block[j] += v[j];
+        }
+    }
+
+    return *this;
+}
+
 #pragma endregion Constructors and Destructor
 
 #pragma region Basic Operators
@@ -249,7 +331,7 @@ void CPUSparseMatrix<ElemType>::SetValue(const size_t row, const size_t col, con
         LogicError("CPUSparseMatrix:  unsupported SetValue() call.");
     }
 
-    if ((GetFormat() == MatrixFormat::matrixFormatSparseCSC) && ((*this)(row, col) == v))
+    if ((*this)(row, col) == v)
         return;
 
     let nz = NzCount();
@@ -290,7 +372,8 @@ void CPUSparseMatrix<ElemType>::SetValue(const size_t row, const size_t col, con
     }
     // Note we don't have m_nz anymore. In order for the change from m_nz to
     // NzCount to make sense, we need to propogate nz+1 to all col slices.
-    for (size_t max = c + 1; max < m_numCols + 1; max++)
+    size_t numCompressed = (GetFormat() == matrixFormatSparseCSC) ? m_numCols : m_numRows;
+    for (size_t max = c + 1; max < numCompressed + 1; max++)
     {
         SecondaryIndexLocation()[max] = CPUSPARSE_INDEX_TYPE(nz + 1);
     }
@@ -603,7 +686,7 @@ void CPUSparseMatrix<ElemType>::AssignColumnSliceToDense(CPUMatrix<ElemType>& sl
     if (startColumn + numCols > m_numCols)
         InvalidArgument("The slice (%d+%d) is out of range of the source matrix (%d).", (int) startColumn, (int) numCols, (int) m_numCols);
 
-    if ((GetFormat() != MatrixFormat::matrixFormatSparseCSC) && (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol))
+    if ((GetFormat() != MatrixFormat::matrixFormatSparseCSC) && (GetFormat() != MatrixFormat::matrixFormatSparseCSR) && (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol))
         NOT_IMPLEMENTED;
 
     // We can either error out or RequireSize. Because RequireSize will error out if it's not allowed, I think this makes more sense.
@@ -627,6 +710,22 @@ void CPUSparseMatrix<ElemType>::AssignColumnSliceToDense(CPUMatrix<ElemType>& sl
             }
         }
     }
+    else if (GetFormat() == MatrixFormat::matrixFormatSparseCSR)
+    {
+#pragma omp parallel for
+        for (long i = 0; i < (long)m_numRows; i++)
+        {
+            long start = (long)SecondaryIndexLocation()[i];
+            long end = (long)SecondaryIndexLocation()[i + 1];
+
+            for (long p = start; p < end; p++)
+            {
+                size_t j = GetUnCompIndex()[p];
+                if (j >= startColumn && j < startColumn + numCols)
+                    slice((size_t)i, j - startColumn) = Buffer()[(size_t)p];
+            }
+        }
+    }
     else
     {
         CPUSparseMatrix<ElemType> sparseSlice = ColumnSlice(startColumn, numCols);
@@ -920,8 +1019,7 @@ public:
         if (sparse.IsEmpty() || dense.IsEmpty())
             return;
 
-        // TODO: Implement CSR as a transposition of b, like we do for GPU.
-        if (sparse.GetFormat() != matrixFormatSparseCSC)
+        if (sparse.GetFormat() != matrixFormatSparseCSC && sparse.GetFormat() != matrixFormatSparseCSR)
             NOT_IMPLEMENTED;
 
         // Up to here we have:
@@ -929,48 +1027,76 @@ public:
         // * Initialized the output matrix c
 
         // Now do the actual multiplication.
-        ElemType* valueBuffer = sparse.Buffer() + *sparse.SecondaryIndexLocation(); // Points to the value buffer of the current view (i.e. buffer containing values of non-zero elements).
-        int* rowIndexBuffer = sparse.MajorIndexLocation();                          // Points to the index buffer of the current view (i.e. buffer containing indices of non-zero elements).
-        size_t iNonzero = 0;                                                           // Number of nonzero elements handled so far for current slice view.
-        int numPreviosNonzero = sparse.SecondaryIndexLocation()[0];                 // Total number of nonzero values handled in previous slices.
+        // A CSR matrix is stored like the CSC matrix of its transpose, i.e. its compressed (secondary) index runs over
+        // the rows instead of the columns.
+        const bool isCSR = sparse.GetFormat() == matrixFormatSparseCSR;
+        const long numCompressed = (long) (isCSR ? sparse.GetNumRows() : sparse.GetNumCols());
+        const CPUSPARSE_INDEX_TYPE* compressedIndex = sparse.SecondaryIndexLocation();
+        const CPUSPARSE_INDEX_TYPE* majorIndex = sparse.MajorIndexLocation(); // (relative to the first nonzero element of the view)
+        const ElemType* valueBuffer = sparse.Data();                          // (relative to the first nonzero element of the view)
+        const CPUSPARSE_INDEX_TYPE firstNonzero = compressedIndex[0];
+
+        // Adds the product of the sparse element at (outerIndexSparse, innerIndex) with the dense elements at
+        // [beginDense, endDense) of the outer dimension of the dense matrix to c.
+        auto addProducts = [&](size_t outerIndexSparse, size_t innerIndex, ElemType sparseVal, size_t beginDense, size_t endDense)
+        {
+            // Loop over the outer index of the dense matrix
+            for (size_t outerIndexDense = beginDense; outerIndexDense < endDense; outerIndexDense++)
+            {
+                // Determine the row index of the dense input matrix.
+                // Below if-statements are evaluated at compile time.
+                ElemType denseVal;
+                if      ( denseTimesSparse && !transposeA) denseVal = dense(outerIndexDense,      innerIndex);
+                else if ( denseTimesSparse &&  transposeA) denseVal = dense(     innerIndex, outerIndexDense);
+                else if (!denseTimesSparse && !transposeB) denseVal = dense(     innerIndex, outerIndexDense);
+                else if (!denseTimesSparse &&  transposeB) denseVal = dense(outerIndexDense,      innerIndex);
+
+                // Update matrix c.
+                if (denseTimesSparse)
+                    c(outerIndexDense, outerIndexSparse) += alpha * denseVal * sparseVal;
+                else /*Sparse times dense */
+                    c(outerIndexSparse, outerIndexDense) += alpha * denseVal * sparseVal;
+            }
+        };
 
-        // Loop over columns of the sparse matrix
-        for (size_t colSparse = 0; colSparse < sparse.GetNumCols(); colSparse++)
+        // Adds the products of the nonzero elements of the compressed index j (a column for CSC, a row for CSR).
+        auto addProductsOfCompressedIndex = [&](long j, size_t beginDense, size_t endDense)
         {
-            size_t numNonzeroInSparseCol = sparse.SecondaryIndexLocation()[colSparse + 1] - numPreviosNonzero;
-            // Loop over the nonzero rows of the current column of the sparse matrix
-            for (; iNonzero < numNonzeroInSparseCol; iNonzero++)
+            for (CPUSPARSE_INDEX_TYPE p = compressedIndex[j] - firstNonzero; p < compressedIndex[j + 1] - firstNonzero; p++)
             {
-                size_t rowSparse = rowIndexBuffer[iNonzero]; // RowLocation
-                ElemType sparseVal = valueBuffer[iNonzero];
+                size_t rowSparse = isCSR ? (size_t) j : (size_t) majorIndex[p];
+                size_t colSparse = isCSR ? (size_t) majorIndex[p] : (size_t) j;
 
                 // Determine the index of the 'outer' dimension of the sparse matrix and the common inner index.
-                size_t outerIndexSparse;
-                size_t innerIndex;
                 // Below if-statements are evaluated at compile time.
-                if      ( denseTimesSparse && !transposeB) { outerIndexSparse = colSparse; innerIndex = rowSparse; }
-                else if ( denseTimesSparse &&  transposeB) { outerIndexSparse = rowSparse; innerIndex = colSparse; }
-                else if (!denseTimesSparse && !transposeA) { outerIndexSparse = rowSparse; innerIndex = colSparse; }
-                else if (!denseTimesSparse &&  transposeA) { outerIndexSparse = colSparse; innerIndex = rowSparse; }
+                if      ( denseTimesSparse && !transposeB) addProducts(colSparse, rowSparse, valueBuffer[p], beginDense, endDense);
+                else if ( denseTimesSparse &&  transposeB) addProducts(rowSparse, colSparse, valueBuffer[p], beginDense, endDense);
+                else if (!denseTimesSparse && !transposeA) addProducts(rowSparse, colSparse, valueBuffer[p], beginDense, endDense);
+                else if (!denseTimesSparse &&  transposeA) addProducts(colSparse, rowSparse, valueBuffer[p], beginDense, endDense);
+            }
+        };
 
-                // Loop over the outer index of the dense matrix
-                for (size_t outerIndexDense = 0; outerIndexDense < outerDimensionDense; outerIndexDense++)
-                {
-                    // Determine the row index of the dense input matrix.
-                    // Below if-statements are evaluated at compile time.
-                    ElemType denseVal;
-                    if      ( denseTimesSparse && !transposeA) denseVal = dense(outerIndexDense,      innerIndex);
-                    else if ( denseTimesSparse &&  transposeA) denseVal = dense(     innerIndex, outerIndexDense);
-                    else if (!denseTimesSparse && !transposeB) denseVal = dense(     innerIndex, outerIndexDense);
-                    else if (!denseTimesSparse &&  transposeB) denseVal = dense(outerIndexDense,      innerIndex);
-                    
-
-                    // Update matrix c.
-                    if (denseTimesSparse)
-                        c(outerIndexDense, outerIndexSparse) += alpha * denseVal * sparseVal;
-                    else /*Sparse times dense */
-                        c(outerIndexSparse, outerIndexDense) += alpha * denseVal * sparseVal;
-                }
+        // The threads must not write to the same elements of c. If the outer index of the sparse matrix is its compressed
+        // index, the threads split the compressed index. Otherwise, they split the outer dimension of the dense matrix in
+        // blocks, each of which is small enough to stay in the cache while all nonzero elements are multiplied with it.
+        const bool isOuterIndexSparseColumn = (denseTimesSparse && !transposeB) || (!denseTimesSparse && transposeA);
+        if (isOuterIndexSparseColumn != isCSR)
+        {
+#pragma omp parallel for schedule(dynamic, 64)
+            for (long j = 0; j < numCompressed; j++)
+                addProductsOfCompressedIndex(j, 0, outerDimensionDense);
+        }
+        else
+        {
+            const size_t denseBlockSize = 64;
+            const long numDenseBlocks = (long) ((outerDimensionDense + denseBlockSize - 1) / denseBlockSize);
+#pragma omp parallel for
+            for (long block = 0; block < numDenseBlocks; block++)
+            {
+                size_t beginDense = block * denseBlockSize;
+                size_t endDense = min(beginDense + denseBlockSize, outerDimensionDense);
+                for (long j = 0; j < numCompressed; j++)
+                    addProductsOfCompressedIndex(j, beginDense, endDense);
             }
         }
     }
@@ -1115,7 +1241,7 @@ void CPUSparseMatrix<ElemType>::ColumnwiseScaleAndWeightedAdd(ElemType alpha, co
     if (v.GetNumRows() != 1 && v.GetNumCols() != 1)
         InvalidArgument("the argument v must be a vector"); // v is a vector
 
-    if (a.GetFormat() != matrixFormatSparseCSC)
+    if (a.GetFormat() != matrixFormatSparseCSC && a.GetFormat() != matrixFormatSparseCSR)
         NOT_IMPLEMENTED;
 
     if (beta == 0)
@@ -1128,15 +1254,20 @@ void CPUSparseMatrix<ElemType>::ColumnwiseScaleAndWeightedAdd(ElemType alpha, co
 
     const ElemType* vd = v.Data();
 
+    // (for CSR, the compressed index runs over the rows)
+    const bool isCSR = a.GetFormat() == matrixFormatSparseCSR;
+    const long numCompressed = (long) (isCSR ? a.GetNumRows() : a.GetNumCols());
+
 #pragma omp parallel for
-    for (long col = 0; col < (long)a.GetNumCols(); col++)
+    for (long j = 0; j < numCompressed; j++)
     {
-        auto start = a.SecondaryIndexLocation()[col];
-        auto end = a.SecondaryIndexLocation()[col + 1];
+        auto start = a.SecondaryIndexLocation()[j];
+        auto end = a.SecondaryIndexLocation()[j + 1];
 
         for (auto p = start; p < end; p++)
         {
-            auto row = a.MajorIndexLocation()[p];
+            size_t row = isCSR ? (size_t) j : (size_t) a.GetUnCompIndex()[p];
+            size_t col = isCSR ? (size_t) a.GetUnCompIndex()[p] : (size_t) j;
             ElemType val = a.Buffer()[p];
 
             if (beta == 0) // don't even read the memory if beta is 0
@@ -1161,16 +1292,18 @@ void CPUSparseMatrix<ElemType>::ScaleAndAdd(const ElemType alpha, const CPUSpars
         InvalidArgument("CPUSparseMatrix::ScaleAndAdd: The dimensions of a and b must match.");
     }
 
+    // (each thread handles different columns for CSC and block-column, and different rows for CSR and block-row)
     if (lhs.GetFormat() == MatrixFormat::matrixFormatSparseCSC || lhs.GetFormat() == MatrixFormat::matrixFormatSparseCSR)
     {
-        size_t col_num = (lhs.GetFormat() == MatrixFormat::matrixFormatSparseCSC) ? lhs.GetNumCols() : lhs.GetNumRows();
-        for (size_t j = 0; j < col_num; j++)
+        long col_num = (long) ((lhs.GetFormat() == MatrixFormat::matrixFormatSparseCSC) ? lhs.GetNumCols() : lhs.GetNumRows());
+#pragma omp parallel for
+        for (long j = 0; j < col_num; j++)
         {
             size_t start = lhs.SecondaryIndexLocation()[j];
             size_t end = lhs.SecondaryIndexLocation()[j + 1];
             for (size_t p = start; p < end; p++)
             {
-                size_t i = lhs.MajorIndexLocation()[p];
+                size_t i = lhs.GetUnCompIndex()[p];
                 ElemType val = lhs.Buffer()[p];
                 size_t r = (lhs.GetFormat() == MatrixFormat::matrixFormatSparseCSC) ? i : j;
                 size_t c = (lhs.GetFormat() == MatrixFormat::matrixFormatSparseCSC) ? j : i;
@@ -1180,7 +1313,8 @@ void CPUSparseMatrix<ElemType>::ScaleAndAdd(const ElemType alpha, const CPUSpars
     }
     else if (lhs.GetFormat() == MatrixFormat::matrixFormatSparseBlockCol || lhs.GetFormat() == MatrixFormat::matrixFormatSparseBlockRow)
     {
-        for (size_t j = 0; j < lhs.GetBlockSize(); j++)
+#pragma omp parallel for
+        for (long j = 0; j < (long) lhs.GetBlockSize(); j++)
         {
             size_t i = lhs.GetBlockIds()[j] - lhs.GetBlockIdShift();
             size_t len = (lhs.GetFormat() == MatrixFormat::matrixFormatSparseBlockCol) ? lhs.GetNumRows() : lhs.GetNumCols();
@@ -1201,6 +1335,66 @@ void CPUSparseMatrix<ElemType>::ScaleAndAdd(const ElemType alpha, const CPUSpars
     }
 }
 
+// sparse += sparse, for matrixFormatSparseBlockCol (e.g. to sum the sparse gradients of several workers)
+// As MultiplyAndAdd(), the columns of lhs that c does not have yet get new blocks after the existing ones.
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::ScaleAndAdd(const ElemType alpha, const CPUSparseMatrix<ElemType>& lhs, CPUSparseMatrix<ElemType>& c)
+{
+    if (!c.OwnBuffer())
+        LogicError("Cannot modify since the buffer is managed externally.");
+
+    if (lhs.IsEmpty() || c.IsEmpty())
+        LogicError("ScaleAndAdd:  one of the input matrix is empty.");
+
+    if (lhs.GetNumRows() != c.GetNumRows() || lhs.GetNumCols() != c.GetNumCols())
+        InvalidArgument("CPUSparseMatrix::ScaleAndAdd: The dimensions of a and b must match.");
+
+    if (lhs.GetFormat() != matrixFormatSparseBlockCol || c.GetFormat() != matrixFormatSparseBlockCol)
+        NOT_IMPLEMENTED;
+
+    const size_t numRows = c.GetNumRows();
+    size_t blockSizePrev = c.GetBlockSize();
+    if (blockSizePrev == 0)
+        c.RequireSizeAndAllocate(numRows, c.GetNumCols(), 0, true); // allocate for blockIds
+
+    map<size_t, size_t> col2BlockId;
+    for (size_t blockId = 0; blockId < blockSizePrev; blockId++)
+        col2BlockId[c.GetBlockIds()[blockId]] = blockId;
+
+    vector<size_t> lhsBlockToBlockId(lhs.GetBlockSize());
+    size_t blockSizeCurr = blockSizePrev;
+    for (size_t j = 0; j < lhs.GetBlockSize(); j++)
+    {
+        size_t col = lhs.GetBlockIds()[j] - lhs.GetBlockIdShift();
+        if (col2BlockId.find(col) == col2BlockId.end())
+        {
+            col2BlockId[col] = blockSizeCurr;
+            c.GetBlockIds()[blockSizeCurr] = col;
+            blockSizeCurr++;
+        }
+        lhsBlockToBlockId[j] = col2BlockId[col];
+    }
+
+    if (blockSizeCurr > blockSizePrev)
+    {
+        c.RequireSizeAndAllocate(numRows, c.GetNumCols(), numRows * blockSizeCurr, true, true);
+        c.SetBlockSize(blockSizeCurr);
+        memset(c.Data() + numRows * blockSizePrev, 0, sizeof(ElemType) * numRows * (blockSizeCurr - blockSizePrev));
+    }
+
+    // (the blocks of lhs are distinct columns, hence go to distinct blocks of c)
+    ElemType* data = c.Data();
+    const ElemType* lhsData = lhs.Data();
+#pragma omp parallel for
+    for (long j = 0; j < (long) lhsBlockToBlockId.size(); j++)
+    {
+        ElemType* block = data + lhsBlockToBlockId[j] * numRows;
+        const ElemType* lhsBlock = lhsData + j * numRows;
+        for (size_t i = 0; i < numRows; i++)
+            block[i] += alpha * lhsBlock[i];
+    }
+}
+
 template <class ElemType>
 /*static*/ bool CPUSparseMatrix<ElemType>::AreEqual(const CPUSparseMatrix<ElemType>& a, const CPUSparseMatrix<ElemType>& b, const ElemType threshold)
 {
@@ -1241,46 +1435,68 @@ void CPUSparseMatrix<ElemType>::InnerProduct(const CPUSparseMatrix<ElemType>& a,
     if (m != k || n != l)
         InvalidArgument("InnerProduct: Matrices a and b should have same dimension.");
 
-    if (isColWise) // col-wise
-    {
-        c.RequireSize(1, n);
+    if (a.GetFormat() != matrixFormatSparseCSC && a.GetFormat() != matrixFormatSparseCSR)
+        NOT_IMPLEMENTED;
 
-#pragma omp parallel for
-        foreach_column(j, c)
-        {
-            ElemType sum = 0;
-            for (CPUSPARSE_INDEX_TYPE iRow = a.ColLocation()[j]; iRow < a.ColLocation()[j+1]; ++iRow)
-            {
-                size_t row = a.RowLocation()[iRow];
-                sum += a.Data()[iRow] * b(row, j);
-            }
-            c(0, j) = sum;
-        }
-    }
+    if (isColWise)
+        c.RequireSize(1, n);
     else
-    {
         c.RequireSize(m, 1);
+    c.SetValue(0);
+
+    // c[j] = sum_i a(i, j) * b(i, j) for col-wise, and c[i] = sum_j a(i, j) * b(i, j) for row-wise
+    // The threads split the compressed index of a (the columns for CSC, the rows for CSR). If it is the index of c, each
+    // thread sums up its own elements of c, otherwise they are accumulated atomically.
+    const bool isCSR = a.GetFormat() == matrixFormatSparseCSR;
+    const bool isOutputCompressed = isColWise != isCSR;
+    const long numCompressed = isCSR ? m : n;
+    ElemType* cData = c.Data();
 
 #pragma omp parallel for
-        foreach_row(i, c)
+    for (long j = 0; j < numCompressed; j++)
+    {
+        ElemType sum = 0;
+        for (CPUSPARSE_INDEX_TYPE p = a.SecondaryIndexLocation()[j]; p < a.SecondaryIndexLocation()[j + 1]; ++p)
         {
-            ElemType sum = 0;
-            for(CPUSPARSE_INDEX_TYPE j = 0; j < n; ++j)
+            size_t row = isCSR ? (size_t) j : (size_t) a.GetUnCompIndex()[p];
+            size_t col = isCSR ? (size_t) a.GetUnCompIndex()[p] : (size_t) j;
+            ElemType product = a.Buffer()[p] * b(row, col);
+            if (isOutputCompressed)
+                sum += product;
+            else
             {
-                for (CPUSPARSE_INDEX_TYPE iRow = a.ColLocation()[j]; iRow < a.ColLocation()[j + 1]; ++iRow)
-                {
-                    if (a.RowLocation()[iRow] == i)
-                    {
-                        sum += a.Data()[iRow] * b(i, j);
-                        break;
-                    }
-                }
+                ElemType* cElement = cData + (isColWise ? col : row);
+#pragma omp atomic
+                *cElement += product;
             }
-            c(i, 0) = sum;
         }
+        if (isOutputCompressed)
+            cData[j] = sum;
     }
 }
 
+// Sizes the state 'c' of a lazy update of this gradient (numStateCols times its size, followed by the step
+// counters) and starts the next step. Returns the step counters.
+template <class ElemType>
+ElemType* CPUSparseMatrix<ElemType>::BeginLazyUpdate(CPUMatrix<ElemType>& c, size_t numStateCols) const
+{
+    if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
+        LogicError("Lazy updates are only implemented for the block-sparse column format.");
+
+    size_t numColsNeeded = numStateCols * GetNumCols() + LazySparseUpdate::NumStepCols(GetNumRows(), GetNumCols());
+    if (c.IsEmpty() || c.GetNumCols() < numColsNeeded)
+    {
+        c.RequireSize(GetNumRows(), numColsNeeded);
+        c.SetValue(0.0);
+    }
+    if (c.GetNumRows() != GetNumRows() || c.GetNumCols() != numColsNeeded)
+        LogicError("The matrix gradients does not have expected dimensions.");
+
+    ElemType* steps = c.Data() + numStateCols * GetNumElements();
+    LazySparseUpdate::AdvanceStep(steps, GetNumCols());
+    return steps;
+}
+
 // A helper method used in MomentumSGDUpdate and NesterovAcceleratedMomentumSGDUpdate.
 // Modifies the smoothed gradients "c", as well as the current gradients "this" on which this method is invoked. 
 // Classic momentum (unitGainFactor == 1.0):
@@ -1288,13 +1504,17 @@ void CPUSparseMatrix<ElemType>::InnerProduct(const CPUSparseMatrix<ElemType>& a,
 // Unit-gain momentum (unitGainFactor == 1.0 - momentum):
 // 1) c = momentum * c + (1.0 - momentum) * this
 // 2) this = c
+// With 'lazy', c of each column is first decayed by the steps the column had no gradient.
 // TODO: NormalGrad is a misnomer here. Come up with a better name.
 template <class ElemType>
-void CPUSparseMatrix<ElemType>::NormalGrad(CPUMatrix<ElemType>& c, const ElemType momentum, bool unitGainMomentum)
+void CPUSparseMatrix<ElemType>::NormalGrad(CPUMatrix<ElemType>& c, const ElemType momentum, bool unitGainMomentum, bool lazy)
 {
     const auto unitGainFactor = ElemType(unitGainMomentum ? (1.0 - momentum) : 1.0);
 
-    if (c.IsEmpty())
+    ElemType* steps = nullptr;
+    if (lazy)
+        steps = BeginLazyUpdate(c, 1);
+    else if (c.IsEmpty())
     {
         c.RequireSize(GetNumRows(), GetNumCols());
         c.SetValue(0.0);
@@ -1309,12 +1529,18 @@ void CPUSparseMatrix<ElemType>::NormalGrad(CPUMatrix<ElemType>& c, const ElemTyp
             size_t i = GetBlockIds()[j] - GetBlockIdShift();
             size_t len = (isSparseBlockCol) ? GetNumRows() : GetNumCols();
             size_t start = j * len;
+            ElemType decay = 1;
+            if (steps)
+            {
+                decay = pow(momentum, LazySparseUpdate::NumMissedSteps(steps, i, GetNumCols()));
+                LazySparseUpdate::SetUpdated(steps, i, GetNumCols());
+            }
             for (size_t p = start; p < start + len; p++)
             {
                 ElemType val = Buffer()[p];
                 size_t row = (isSparseBlockCol) ? (p - start) : i;
                 size_t col = (isSparseBlockCol) ? i : (p - start);
-                c(row, col) = unitGainFactor * val + momentum * c(row, col);
+                c(row, col) = unitGainFactor * val + momentum * decay * c(row, col);
                 Buffer()[p] = c(row, col);
             }
         }
@@ -1394,6 +1620,147 @@ ElemType CPUSparseMatrix<ElemType>::Adagrad(CPUMatrix<ElemType>& c, const bool n
         return 1;
 }
 
+// Calls update(denseIndex, gradient, numMissedSteps) for the elements that FSAdagrad() and Adam() update.
+// Without 'steps' that is every element of the parameter, with a zero gradient outside of the blocks.
+// With 'steps' (a lazy update), that is only the elements of the blocks, together with the number of steps that
+// the column of the element had no gradient.
+template <class ElemType>
+template <class UpdateFn>
+void CPUSparseMatrix<ElemType>::ForEachBlockSparseColUpdate(ElemType* steps, const UpdateFn& update) const
+{
+    size_t len = GetNumRows();
+    size_t numCols = GetNumCols();
+    if (steps)
+    {
+#pragma omp parallel for
+        for (long j = 0; j < (long) GetBlockSize(); j++)
+        {
+            size_t col = GetBlockIds()[j] - GetBlockIdShift();
+            ElemType numMissedSteps = LazySparseUpdate::NumMissedSteps(steps, col, numCols);
+            LazySparseUpdate::SetUpdated(steps, col, numCols);
+            const ElemType* blockValues = Buffer() + j * len;
+            for (size_t row = 0; row < len; row++)
+                update(col * len + row, blockValues[row], numMissedSteps);
+        }
+    }
+    else
+    {
+        vector<const ElemType*> colValues(numCols, nullptr);
+        for (size_t j = 0; j < GetBlockSize(); j++)
+            colValues[GetBlockIds()[j] - GetBlockIdShift()] = Buffer() + j * len;
+#pragma omp parallel for
+        for (long col = 0; col < (long) numCols; col++)
+        {
+            const ElemType* blockValues = colValues[col];
+            for (size_t row = 0; row < len; row++)
+                update(col * len + row, blockValues ? blockValues[row] : 0, (ElemType) 0);
+        }
+    }
+}
+
+// see CPUMatrix::FSAdagrad()
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::FSAdagrad(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample,
+                                          ElemType momentum, ElemType adaWeight, ElemType adaMul, bool unitGainMomentum, bool lazy)
+{
+    if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
+        NOT_IMPLEMENTED;
+
+    auto unitGainFactor = ElemType(unitGainMomentum ? (1.0 - momentum) : 1.0);
+
+    ElemType* steps = nullptr;
+    if (lazy)
+        steps = BeginLazyUpdate(c, 2);
+    else
+    {
+        size_t numColsNeeded = 2 * GetNumCols();
+        if (c.IsEmpty() || (c.GetNumCols() < numColsNeeded))
+        {
+            c.RequireSize(GetNumRows(), numColsNeeded);
+            c.SetValue(0.0);
+        }
+        if (c.GetNumRows() != GetNumRows() || c.GetNumCols() != numColsNeeded)
+            LogicError("The matrix gradients does not have expected dimensions.");
+    }
+
+    size_t n = GetNumElements();
+    ElemType* smoothAda = c.Data();
+    ElemType* smoothMom = c.Data() + n;
+    ElemType* val = functionValues.Data();
+    ForEachBlockSparseColUpdate(steps, [=](size_t i, ElemType g, ElemType numMissedSteps)
+    {
+        ElemType adaSqr = adaWeight * pow(adaWeight, numMissedSteps) * smoothAda[i] + (1.0f - adaWeight) * g * g;
+        smoothAda[i] = adaSqr;
+        if (adaSqr != 0.0f)
+        {
+            ElemType ada = sqrt(adaSqr);
+            ElemType w = adaMul * ((ElemType) 1.0 / ada);
+
+            if (w > 10.0f)
+                w = 10.0f;
+            g *= w;
+        }
+
+        if (momentum > 0.0f)
+        {
+            g = momentum * pow(momentum, numMissedSteps) * smoothMom[i] + unitGainFactor * g;
+            smoothMom[i] = g;
+        }
+
+        g *= learnRatePerSample;
+        val[i] -= g;
+    });
+}
+
+// see CPUMatrix::Adam()
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::Adam(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample,
+                                     ElemType momentum, ElemType adaWeight, ElemType adaMul, ElemType epsilon, bool unitGainMomentum, bool adamax, bool lazy)
+{
+    if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
+        NOT_IMPLEMENTED;
+
+    auto unitGainFactor = ElemType(unitGainMomentum ? (1.0 - momentum) : 1.0);
+
+    ElemType* steps = nullptr;
+    if (lazy)
+        steps = BeginLazyUpdate(c, 2);
+    else
+    {
+        size_t numColsNeeded = 2 * GetNumCols();
+        if (c.IsEmpty() || (c.GetNumCols() < numColsNeeded))
+        {
+            c.RequireSize(GetNumRows(), numColsNeeded);
+            c.SetValue(0.0);
+        }
+        if (c.GetNumRows() != GetNumRows() || c.GetNumCols() != numColsNeeded)
+            LogicError("The matrix gradients does not have expected dimensions.");
+    }
+
+    size_t n = GetNumElements();
+    ElemType* smoothAda = c.Data();
+    ElemType* smoothMom = c.Data() + n;
+    ElemType* val = functionValues.Data();
+    ForEachBlockSparseColUpdate(steps, [=](size_t i, ElemType g, ElemType numMissedSteps)
+    {
+        ElemType adaDecay = adaWeight * pow(adaWeight, numMissedSteps);
+        ElemType ada;
+        if (!adamax)
+        {
+            ElemType adaSqr = adaDecay * smoothAda[i] + (1.0f - adaWeight) * g * g;
+            smoothAda[i] = adaSqr;
+            ada = sqrt(adaSqr);
+        }
+        else
+            ada = smoothAda[i] = std::max(adaDecay * smoothAda[i], std::abs(g));
+
+        ElemType w = adaMul * (ElemType)(1.0 / (ada + epsilon));
+        g = momentum * pow(momentum, numMissedSteps) * smoothMom[i] + unitGainFactor * g;
+        smoothMom[i] = g;
+        val[i] -= g * w * learnRatePerSample;
+    });
+}
+
 template <class ElemType>
 void CPUSparseMatrix<ElemType>::AdaDelta(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learningRate, ElemType rho, ElemType epsilon)
 {
@@ -1822,6 +2189,29 @@ template void CPUSparseMatrix<short>::AssignColumnSliceToDense(CPUMatrix<short>&
 template CPUSparseMatrix<short>& CPUSparseMatrix<short>::operator=(const CPUSparseMatrix<short>& deepCopyFrom);
 template void CPUSparseMatrix<short>::ScaleAndAdd(short, class Microsoft::MSR::CNTK::CPUSparseMatrix<short> const &, class Microsoft::MSR::CNTK::CPUMatrix<short> &);
 
+// Support <half>
+template CPUSparseMatrix<half>::CPUSparseMatrix(const MatrixFormat format, const size_t numRows, const size_t numCols, const size_t size);
+template CPUSparseMatrix<half>::CPUSparseMatrix(MatrixFormat);
+template CPUSparseMatrix<half>::CPUSparseMatrix(CPUSparseMatrix<half> const&);
+template CPUSparseMatrix<half>::CPUSparseMatrix(CPUSparseMatrix<half>&&);
+template CPUSparseMatrix<half>& CPUSparseMatrix<half>::operator=(CPUSparseMatrix<half>&& moveFrom);
+template void CPUSparseMatrix<half>::SetValue(size_t, size_t, half);
+//template void CPUSparseMatrix<half>::SetValue(CPUMatrix<half> const&);
+//template void CPUSparseMatrix<half>::SetValue(GPUMatrix<half> const&);
+template void CPUSparseMatrix<half>::SetValue(CPUSparseMatrix<half> const&);
+//template void CPUSparseMatrix<half>::SetValue(GPUSparseMatrix<half> const&);
+template half* CPUSparseMatrix<half>::Data() const;
+template void CPUSparseMatrix<half>::Reset(void);
+template void CPUSparseMatrix<half>::Resize(const size_t, const size_t, const size_t, const bool);
+template void CPUSparseMatrix<half>::RequireSizeAndAllocate(const size_t, const size_t, const size_t, const bool, bool);
+template void CPUSparseMatrix<half>::RequireSizeAndAllocate(const size_t, const size_t, const size_t, const MatrixFormat, const bool, bool);
+template CPUSparseMatrix<half>::~CPUSparseMatrix();
+template CPUSparseMatrix<half> CPUSparseMatrix<half>::ColumnSlice(size_t startColumn, size_t numCols) const;
+template CPUMatrix<half> CPUSparseMatrix<half>::CopyColumnSliceToDense(size_t startColumn, size_t numCols) const;
+template void CPUSparseMatrix<half>::AssignColumnSliceToDense(CPUMatrix<half>&, size_t startColumn, size_t numCols) const;
+template CPUSparseMatrix<half>& CPUSparseMatrix<half>::operator=(const CPUSparseMatrix<half>& deepCopyFrom);
+template void CPUSparseMatrix<half>::ScaleAndAdd(half, class Microsoft::MSR::CNTK::CPUSparseMatrix<half> const &, class Microsoft::MSR::CNTK::CPUMatrix<half> &);
+
 template CPUSparseMatrix<int>::CPUSparseMatrix(const MatrixFormat, const size_t, const size_t, const size_t);
 template CPUSparseMatrix<int>::~CPUSparseMatrix();
 
@@ -95,6 +95,7 @@ public:
 
     CPUSparseMatrix<ElemType>& DoGatherColumnsOf(ElemType beta, const CPUMatrix<ElemType>& idx, const CPUSparseMatrix<ElemType>& a, ElemType alpha);
     CPUSparseMatrix<ElemType>& DoScatterColumnsOf(ElemType beta, const CPUMatrix<ElemType>& idx, const CPUSparseMatrix<ElemType>& a, ElemType alpha);
+    CPUSparseMatrix<ElemType>& ScatterToIndices(const CPUMatrix<ElemType>& values, const CPUMatrix<ElemType>& indices, size_t row_elements);
 
     size_t BufferSize() const
     {
@@ -137,6 +138,7 @@ public:
     static void ColumnwiseScaleAndWeightedAdd(ElemType alpha, const CPUSparseMatrix<ElemType>& a, const CPUMatrix<ElemType>& v, ElemType beta, CPUMatrix<ElemType>& c);
 
     static void ScaleAndAdd(const ElemType alpha, const CPUSparseMatrix<ElemType>& lhs, CPUMatrix<ElemType>& c);
+    static void ScaleAndAdd(const ElemType alpha, const CPUSparseMatrix<ElemType>& lhs, CPUSparseMatrix<ElemType>& c);
 
     static bool AreEqual(const CPUSparseMatrix<ElemType>& a, const CPUSparseMatrix<ElemType>& b, const ElemType threshold = 1e-8);
 
@@ -198,14 +200,15 @@ public:
             RuntimeError("Position outside matrix dimensions");
         }
 
-        if (GetFormat() == MatrixFormat::matrixFormatSparseCSC)
+        if (GetFormat() == MatrixFormat::matrixFormatSparseCSC || GetFormat() == MatrixFormat::matrixFormatSparseCSR)
         {
-            size_t start = SecondaryIndexLocation()[col];
-            size_t end = SecondaryIndexLocation()[col + 1];
+            const bool isCSR = GetFormat() == MatrixFormat::matrixFormatSparseCSR;
+            size_t start = SecondaryIndexLocation()[isCSR ? row : col];
+            size_t end = SecondaryIndexLocation()[(isCSR ? row : col) + 1];
             for (size_t p = start; p < end; p++)
             {
-                size_t i = MajorIndexLocation()[p];
-                if (i == row)
+                size_t i = GetUnCompIndex()[p];
+                if (i == (isCSR ? col : row))
                 {
                     return ((ElemType*)Buffer())[p];
                 }
@@ -229,10 +232,18 @@ public:
     }
 
 public:
-    void NormalGrad(CPUMatrix<ElemType>& c, const ElemType momentum, bool unitGainMomentum = true);
+    // 'lazy' only updates the state of the columns of the gradient, see LazySparseUpdate.h
+    void NormalGrad(CPUMatrix<ElemType>& c, const ElemType momentum, bool unitGainMomentum = true, bool lazy = false);
     ElemType Adagrad(CPUMatrix<ElemType>& c, const bool needAveMultiplier);
+    void FSAdagrad(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul, bool unitGainMomentum, bool lazy = false);
+    void Adam(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul, ElemType epsilon, bool unitGainMomentum, bool adamax, bool lazy = false);
     void AdaDelta(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learningRate, ElemType rho, ElemType epsilon);
 
+private:
+    ElemType* BeginLazyUpdate(CPUMatrix<ElemType>& c, size_t numStateCols) const;
+    template <class UpdateFn>
+    void ForEachBlockSparseColUpdate(ElemType* steps, const UpdateFn& update) const;
+
 public:
     CPUSparseMatrix<ElemType>& InplaceTruncateTop(const ElemType threshold);
     CPUSparseMatrix<ElemType>& InplaceTruncateBottom(const ElemType threshold);
@@ -0,0 +1,245 @@
+#include "stdafx.h"
+#include "CUDACachingMemAllocator.h"
+#include "BestGpu.h" // for CPUONLY
+#include "Basics.h"
+#include <map>
+#ifndef CPUONLY
+#include <cuda_runtime_api.h>
+cudaStream_t MATH_API GetStream(); // (defined in GPUMatrix.cu)
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+bool CUDACachingMemAllocator::s_enabled = false;
+
+void CUDACachingMemAllocator::SetEnabled(bool enabled)
+{
+    s_enabled = enabled;
+}
+
+bool CUDACachingMemAllocator::IsEnabled()
+{
+    return s_enabled;
+}
+
+static std::mutex s_instancesMutex;
+static std::map<int, CUDACachingMemAllocator*> s_instances;
+
+/*static*/ CUDACachingMemAllocator& CUDACachingMemAllocator::GetInstance(int deviceId)
+{
+    std::lock_guard<std::mutex> lock(s_instancesMutex);
+    auto& instance = s_instances[deviceId];
+    if (!instance)
+        instance = new CUDACachingMemAllocator(deviceId); // (never deleted, see header)
+    return *instance;
+}
+
+/*static*/ CUDACachingMemAllocator* CUDACachingMemAllocator::TryGetInstance(int deviceId)
+{
+    std::lock_guard<std::mutex> lock(s_instancesMutex);
+    auto iter = s_instances.find(deviceId);
+    return iter != s_instances.end() ? iter->second : nullptr;
+}
+
+/*static*/ void CUDACachingMemAllocator::TrimAll()
+{
+    std::lock_guard<std::mutex> lock(s_instancesMutex);
+    for (auto& instance : s_instances)
+        instance.second->Trim();
+}
+
+/*static*/ void CUDACachingMemAllocator::PrintAllStatistics()
+{
+    std::lock_guard<std::mutex> lock(s_instancesMutex);
+    for (auto& instance : s_instances)
+        instance.second->PrintStatistics();
+}
+
+// Requests are rounded up to 4 buckets per power of two (but at least 512 bytes, the granularity cudaMalloc() works
+// with anyway), which bounds the waste per buffer to 25% while making reuse likely across slightly varying sizes,
+// e.g. for minibatches of variable-length sequences.
+/*static*/ size_t CUDACachingMemAllocator::RoundUpToBucketSize(size_t size)
+{
+    const size_t minBlockSize = 512;
+    if (size <= minBlockSize)
+        return minBlockSize;
+    size_t powerOfTwo = 1;
+    while (powerOfTwo <= size / 2)
+        powerOfTwo *= 2;
+    const size_t granularity = std::max(minBlockSize, powerOfTwo / 4);
+    return (size + granularity - 1) / granularity * granularity;
+}
+
+CUDACachingMemAllocator::CUDACachingMemAllocator(int deviceID)
+    : m_deviceID(deviceID), m_statistics()
+{
+}
+
+void* CUDACachingMemAllocator::Malloc(size_t size)
+{
+#ifndef CPUONLY
+    return Malloc(size, GetStream());
+#else
+    return Malloc(size, nullptr);
+#endif
+}
+
+void* CUDACachingMemAllocator::Malloc(size_t size, CUstream_st* stream)
+{
+    if (size == 0)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_statistics.numMallocs++;
+
+    const size_t bucketSize = RoundUpToBucketSize(size);
+    void* p = nullptr;
+    auto& freeBlocks = m_freeLists[stream][bucketSize];
+    if (!freeBlocks.empty())
+    {
+        p = freeBlocks.back();
+        freeBlocks.pop_back();
+        m_statistics.numCacheHits++;
+        m_statistics.bytesCached -= bucketSize;
+    }
+    else
+    {
+        p = CudaMalloc(bucketSize);
+        m_blocks[p].size = bucketSize;
+        m_blocks[p].stream = stream;
+    }
+    m_blocks[p].requestedSize = size;
+
+    m_statistics.bytesRequested += size;
+    m_statistics.bytesInUse += bucketSize;
+    m_statistics.peakBytesInUse = std::max(m_statistics.peakBytesInUse, m_statistics.bytesInUse);
+    m_statistics.peakBytesReserved = std::max(m_statistics.peakBytesReserved, m_statistics.BytesReserved());
+    return p;
+}
+
+void CUDACachingMemAllocator::Free(void* p)
+{
+    if (p == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto iter = m_blocks.find(p);
+    if (iter == m_blocks.end())
+        LogicError("CUDACachingMemAllocator: Attempted to free a buffer that was not allocated by this allocator (device %d).", m_deviceID);
+    const auto& block = iter->second;
+
+    // return it to the free list of its stream; work on that stream that still uses it is done before any later reuse
+    m_freeLists[block.stream][block.size].push_back(p);
+
+    m_statistics.bytesRequested -= block.requestedSize;
+    m_statistics.bytesInUse -= block.size;
+    m_statistics.bytesCached += block.size;
+}
+
+bool CUDACachingMemAllocator::Owns(void* p) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_blocks.find(p) != m_blocks.end();
+}
+
+size_t CUDACachingMemAllocator::Trim()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return TrimNoLock();
+}
+
+CUDACachingMemAllocator::Statistics CUDACachingMemAllocator::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+void CUDACachingMemAllocator::PrintStatistics() const
+{
+    const auto stats = GetStatistics();
+    const double numBytesPerMB = 1 << 20;
+    fprintf(stderr, "GPU memory cache on DeviceId = %d: %d allocations (%.1f%% cache hits), %d cudaMalloc, %d cudaFree; in use %.1f MB (peak %.1f MB), cached %.1f MB, peak reserved %.1f MB, fragmentation %.1f%%\n",
+            m_deviceID, (int)stats.numMallocs, stats.numMallocs == 0 ? 0.0 : 100.0 * stats.numCacheHits / stats.numMallocs,
+            (int)stats.numCudaMallocs, (int)stats.numCudaFrees,
+            stats.bytesInUse / numBytesPerMB, stats.peakBytesInUse / numBytesPerMB, stats.bytesCached / numBytesPerMB,
+            stats.peakBytesReserved / numBytesPerMB, 100.0 * stats.Fragmentation());
+}
+
+#ifndef CPUONLY
+
+// sets the device for the current scope, since we may be called for a device other than the current one
+class ScopedCudaDevice
+{
+    int m_previousDeviceId;
+public:
+    ScopedCudaDevice(int deviceId)
+    {
+        cudaGetDevice(&m_previousDeviceId);
+        if (m_previousDeviceId != deviceId)
+            cudaSetDevice(deviceId);
+    }
+    ~ScopedCudaDevice() { cudaSetDevice(m_previousDeviceId); }
+};
+
+void* CUDACachingMemAllocator::CudaMalloc(size_t size)
+{
+    ScopedCudaDevice scopedDevice(m_deviceID);
+    void* p = nullptr;
+    cudaError_t rc = cudaMalloc(&p, size);
+    if (rc == cudaErrorMemoryAllocation && m_statistics.bytesCached > 0)
+    {
+        // out of memory: give the cached buffers back, which may be of the wrong sizes or streams, and try again
+        cudaGetLastError(); // (clear the error)
+        TrimNoLock();
+        rc = cudaMalloc(&p, size);
+    }
+    if (rc == cudaErrorMemoryAllocation)
+    {
+        cudaGetLastError(); // (clear the error, so that the next CUDA call does not report it)
+        ThrowFormatted<DeviceOutOfMemoryError>("CUDACachingMemAllocator: Failed to allocate %llu bytes on DeviceId = %d with %d MB in use: %s (cuda error %d)",
+                                               (unsigned long long)size, m_deviceID, (int)(m_statistics.bytesInUse >> 20), cudaGetErrorString(rc), (int)rc);
+    }
+    if (rc != cudaSuccess)
+        RuntimeError("CUDACachingMemAllocator: Failed to allocate %d bytes on DeviceId = %d with %d MB in use: %s (cuda error %d)",
+                     (int)size, m_deviceID, (int)(m_statistics.bytesInUse >> 20), cudaGetErrorString(rc), (int)rc);
+    m_statistics.numCudaMallocs++;
+    return p;
+}
+
+size_t CUDACachingMemAllocator::TrimNoLock()
+{
+    ScopedCudaDevice scopedDevice(m_deviceID);
+    size_t bytesReleased = 0;
+    for (auto& streamFreeList : m_freeLists)
+    {
+        for (auto& bucket : streamFreeList.second)
+        {
+            for (auto p : bucket.second)
+            {
+                cudaFree(p);
+                m_blocks.erase(p);
+                m_statistics.numCudaFrees++;
+                bytesReleased += bucket.first;
+            }
+        }
+    }
+    m_freeLists.clear();
+    m_statistics.bytesCached -= bytesReleased;
+    return bytesReleased;
+}
+
+#else // CPUONLY
+
+void* CUDACachingMemAllocator::CudaMalloc(size_t)
+{
+    RuntimeError("CUDACachingMemAllocator: Device memory cannot be allocated in a CPU-only build.");
+}
+
+size_t CUDACachingMemAllocator::TrimNoLock()
+{
+    return 0;
+}
+
+#endif
+
+} } }
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "MemAllocator.h"
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct CUstream_st; // cudaStream_t is a CUstream_st*; we don't want to include the CUDA headers here
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+#ifdef _WIN32
+#ifdef MATH_EXPORTS
+#define MATH_API __declspec(dllexport)
+#else
+#define MATH_API __declspec(dllimport)
+#endif
+#else // no DLLs on Linux
+#define MATH_API
+#endif
+
+// CUDACachingMemAllocator -- caching allocator for device memory
+// Freed buffers are not returned to CUDA but kept in free lists, bucketed by size and separated by the stream the buffer
+// was allocated on, and handed out again for requests of the same bucket on the same stream. Since work on a stream is
+// executed in order, a buffer freed by one operation can be reused by the next without synchronizing the device.
+// cudaMalloc() is thus only called on a cache miss, and cudaFree() only by Trim(), which is also done automatically
+// before retrying a cudaMalloc() that failed.
+// There is one instance per device, see GetInstance(). TracingGPUMemoryAllocator uses it when enabled via SetEnabled().
+class MATH_API CUDACachingMemAllocator : public MemAllocator
+{
+public:
+    struct Statistics
+    {
+        size_t numMallocs;         // number of Malloc() calls
+        size_t numCacheHits;       // number of Malloc() calls that were served from the cache
+        size_t numCudaMallocs;     // number of calls to cudaMalloc()
+        size_t numCudaFrees;       // number of calls to cudaFree()
+        size_t bytesRequested;     // bytes requested by the buffers currently in use
+        size_t bytesInUse;         // bytes of the buffers currently in use (>= bytesRequested, due to rounding to the bucket size)
+        size_t bytesCached;        // bytes held in the free lists
+        size_t peakBytesInUse;
+        size_t peakBytesReserved;  // peak of bytesInUse + bytesCached, i.e. of the memory obtained from cudaMalloc()
+
+        size_t BytesReserved() const { return bytesInUse + bytesCached; }
+        // fraction of the reserved memory that does not hold requested data
+        double Fragmentation() const { return BytesReserved() == 0 ? 0.0 : 1.0 - (double)bytesRequested / BytesReserved(); }
+    };
+
+    CUDACachingMemAllocator(int deviceID);
+
+    int GetDeviceId() const { return m_deviceID; }
+
+    // allocate on the stream currently used by the GPU routines (see GetStream())
+    void* Malloc(size_t size) override;
+    void* Malloc(size_t size, CUstream_st* stream);
+    void Free(void* p) override;
+    bool Owns(void* p) const;
+
+    // release all cached buffers of this device to CUDA; returns the number of bytes released
+    size_t Trim();
+
+    Statistics GetStatistics() const;
+    void PrintStatistics() const;
+
+    // bucket size a request of 'size' bytes is rounded up to
+    static size_t RoundUpToBucketSize(size_t size);
+
+    // per-device instances, created on first use
+    // They are deliberately never destroyed, as they may outlive the CUDA runtime at process exit.
+    static CUDACachingMemAllocator& GetInstance(int deviceId);
+    static CUDACachingMemAllocator* TryGetInstance(int deviceId); // nullptr if no instance has been created for this device
+    static void TrimAll();
+    static void PrintAllStatistics();
+
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled();
+
+private:
+    struct Block
+    {
+        size_t size;          // bucket size
+        size_t requestedSize; // size requested by the user
+        CUstream_st* stream;  // stream the block was allocated on; it is only reused for this stream
+    };
+    typedef std::unordered_map<size_t, std::vector<void*>> FreeList; // bucket size -> free blocks
+
+    void* CudaMalloc(size_t size);
+    size_t TrimNoLock();
+
+    int m_deviceID;
+    mutable std::mutex m_mutex;
+    std::unordered_map<void*, Block> m_blocks; // all blocks obtained from cudaMalloc(), in use or cached
+    std::unordered_map<CUstream_st*, FreeList> m_freeLists;
+    Statistics m_statistics;
+
+    static bool s_enabled;
+};
+
+} } }
@@ -15,6 +15,7 @@
 
 #include "Basics.h"
 #include "basetypes.h"
+#include "half.hpp"
 #include <string>
 #include <stdint.h>
 #include <memory>
@@ -180,6 +181,31 @@ enum ElementWiseOperator
     Macro(ElementwiseProductWithPowExponentDerivative); \
     Macro(ElementwiseProductWithPowBaseDerivative);
 
+// -----------------------------------------------------------------------
+// ElementWiseProgram -- a short straight-line sequence of unary/binary element-wise ops,
+// evaluated per element in a single pass (used for fusing chains of element-wise nodes).
+// Registers 0..2 hold the (up to) three inputs; step i writes its result to register MaxInputs + i.
+// The value of the last step is the result of the program.
+// This is a POD, so that it can be passed by value to a CUDA kernel.
+// -----------------------------------------------------------------------
+
+struct ElementWiseProgram
+{
+    static const size_t MaxInputs = 3;
+    static const size_t MaxSteps = 8;
+    static const size_t MaxRegisters = MaxInputs + MaxSteps;
+
+    struct Step
+    {
+        ElementWiseOperator op;
+        unsigned char arg0; // register index of the first argument
+        unsigned char arg1; // register index of the second argument (binary ops only)
+    };
+
+    Step steps[MaxSteps];
+    unsigned char numSteps;
+};
+
 // -----------------------------------------------------------------------
 // various enums to describe
 // -----------------------------------------------------------------------
@@ -221,6 +247,25 @@ enum MatrixFlags
     matrixFlagSetValueOnDevice = 1 << bitPosSetValueOnDevice, // SetValue() call has a buffer that is already on the device
 };
 
+// how Matrix::Write() stores the values of a dense matrix; Matrix::Read() converts them back into ElemType on load
+enum class MatrixStorageFormat : int
+{
+    full = 0,          // the values as they are
+    float16 = 1,       // half precision values
+    int8PerRow = 2,    // 8-bit integers, with the maximum absolute value of each row as its scale
+    int8PerColumn = 3, // 8-bit integers, with the maximum absolute value of each column as its scale
+};
+
+// the distributions of SetCounterBasedRandomValue()
+enum class RandomDistribution : int
+{
+    Uniform,
+    Normal,
+    TruncatedNormal, // normal, without the values more than two standard deviations from the mean
+    Gumbel,
+    Bernoulli,       // 0 with a given probability, a given value otherwise (as SetUniformRandomMask())
+};
+
 // -----------------------------------------------------------------------
 // BaseMatrixStorage -- base class for all matrix types (CPU, GPU) x (dense, sparse)
 // -----------------------------------------------------------------------
@@ -308,86 +308,32 @@ __global__ void kMaxROIPoolingForward(const int totalIterations,
     }
 }
 
-// The kernel operates on one location in the input to the ROIPoolingNode (one image location).
-// It loops over the ROIs corresponding to that image, seeing which ones could contain the location
-// in their output. For each ROI, it checks the argmax data to see if that ROI indeed chose
-// this pixel location as the maximum. If so, it increments the gradient term for the input location.
+// The kernel operates on one location in the output of the ROIPoolingNode and adds its gradient to the input
+// location that the forward pass chose as the maximum of its window (argmax is relative to the channel, and -1 for
+// an empty window). This is proportional to the size of the output, while looping over the ROIs that could contain
+// each input location is proportional to the size of the input times the number of ROIs. The atomics only collide
+// for input locations that are the maximum of several windows.
+// pooledGrad: gradient of the pooled ROIs    [PW x PH x C x numROIs x N]
+// argmax: max positions                      [PW x PH x C x numROIs x N]
+// grad: gradient of the images               [W x H x C x N]
 template <typename ElemType>
 __global__ void kMaxROIPoolingBackward(const int totalIterations,
-    const int numROIs, const int numImg,
-    const int channels, const int width, const int height,
+    const int numROIs, const int channels, const int width, const int height,
     const int pooledWidth, const int pooledHeight, const ElemType* pooledGrad,
-    const ElemType* roiData, ElemType* grad, const ElemType* argmax, double spatialScale)
+    ElemType* grad, const ElemType* argmax)
 {
-    // index loops over all input locations (locations in the original input tensor).
+    // index loops over all totalRois*c*pooledHeight*pooledWidth output locations.
     for (int index = blockIdx.x * blockDim.x + threadIdx.x;
         index < (totalIterations); index += blockDim.x * gridDim.x)
     {
-        // images are laid out [W x H x C x N]
-        // (n, c, h, w) is an element in the input image
-        int w = index % width;
-        int h = (index / width) % height;
-        int c = (index / width / height) % channels;
-        int n = index / width / height / channels;
-
-        // compute range of ROIs corresponding to this image:
-        int roiMin = n * numROIs;
-        int roiMax = (n + 1) * numROIs;
-
-        ElemType gradient = 0;
-        for (int roiN = roiMin; roiN < roiMax; roiN++)
-        {
-            // each ROI is 4 elements: (x, y, w, h)
-            const ElemType* roiOffset = roiData + roiN * 4;
-
-            // ROI data is absolute pixel value in the original image size
-            int roiStartW = (int)(round_(roiOffset[0] * spatialScale));
-            int roiStartH = (int)(round_(roiOffset[1] * spatialScale));
-            int roiEndW = (int)(round_(roiOffset[2] * spatialScale));
-            int roiEndH = (int)(round_(roiOffset[3] * spatialScale));
-
-            int roiWidth = max(roiEndW - roiStartW + 1, (int)1);
-            int roiHeight = max(roiEndH - roiStartH + 1, (int)1);
-
-            // skip this ROI if it doesn't contain our input location.
-            const bool inROI = (w >= roiStartW && w < roiStartW + roiWidth &&
-                h >= roiStartH && h < roiStartH + roiHeight);
-            if (!inROI)
-                continue;
-
-            ElemType winH = (ElemType)roiHeight / (ElemType)pooledHeight;
-            ElemType winW = (ElemType)roiWidth / (ElemType)pooledWidth;
-
-            // what pooled nodes in the output for this ROI could have pooled this input location?
-            // we use int here since the computation can yield a negative result
-            int phstart = (int)((float)(h - roiStartH) / winH);
-            int pwstart = (int)((float)(w - roiStartW) / winW);
-            int phend = (int)(ceilf((float)(h - roiStartH + 1) / winH));
-            int pwend = (int)(ceilf((float)(w - roiStartW + 1) / winW));
-
-            phstart = min(max(phstart, 0), pooledHeight);
-            pwstart = min(max(pwstart, 0), pooledWidth);
-            phend = min(max(phend, 0), pooledHeight);
-            pwend = min(max(pwend, 0), pooledWidth);
-
-            // go right up to this channel of this ROI.
-            int offset = (roiN * channels + c) * pooledWidth * pooledHeight;
-            const ElemType* offsetPoolGrad = pooledGrad + offset;
-            const ElemType* offsetArgmax = argmax + offset;
+        int maxidx = (int)argmax[index];
+        if (maxidx < 0)
+            continue;
 
-            for (int ph = phstart; ph < phend; ph++)
-            {
-                for (int pw = pwstart; pw < pwend; pw++)
-                {
-                    if ((int)offsetArgmax[ph * pooledWidth + pw] == (h * width + w))
-                    {
-                        gradient += offsetPoolGrad[ph * pooledWidth + pw];
-                    }
-                }
-            }
-        }
-
-        atomicAdd(&grad[index], gradient);
+        int c = (index / pooledWidth / pooledHeight) % channels;
+        int n = index / pooledWidth / pooledHeight / channels;
+        int imgIdx = n / numROIs;
+        atomicAdd(&grad[(imgIdx * channels + c) * height * width + maxidx], pooledGrad[index]);
     }
 }
 
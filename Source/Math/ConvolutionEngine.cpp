@@ -6,6 +6,12 @@
 #include "stdafx.h"
 #include "ConvolutionEngine.h"
 #include "CuDnnFactories.h"
+#ifdef _MSC_VER
+#include <intrin.h> // for __popcnt64
+#endif
+#ifdef SUPPORT_AVX512VPOPCNTDQ
+#include <immintrin.h>
+#endif
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -854,6 +860,840 @@ public:
     }
 };
 
+//------------------------------------------------------------------
+// Winograd convolution engine implementation.
+// Computes the forward pass of 2D convolutions with 3x3 kernels and stride 1 with the minimal filtering
+// algorithm F(2x2, 3x3) (Fast Algorithms for Convolutional Neural Networks; Lavin, Gray), which needs 16 instead of
+// 36 multiplications per 2x2 output tile and channel.
+// Other geometries, the backward methods and pooling are done by the GEMM engine (and the reference engine, respectively).
+//------------------------------------------------------------------
+template <class ElemType>
+class WinogradConvolutionEngine : public GemmConvolutionEngine<ElemType>
+{
+public:
+    using Base = GemmConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    WinogradConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind, bool poolIncludePad)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad)
+    {
+    }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_maxTempMemSizeInSamples;
+
+    // Using the notation of GemmConvolutionEngine, with P = N * ceil(W'/2) * ceil(H'/2) the number of 2x2 output tiles
+    // in the minibatch, the forward method consists of 4 parts:
+    // 1. Transforming the 3x3 kernel weights g of each input and output map: U = G g G^T -> 16 matrices [C x K]
+    // 2. Transforming the 4x4 input tiles d (which overlap by 2) of each map: V = B^T d B -> 16 matrices [C x P]
+    // 3. Performing one matrix multiplication for each of the 16 elements of a transformed tile: U^T * V -> [K x P]
+    // 4. Transforming the results back into 2x2 output tiles: Y = A^T M A -> [W'H'K x N]
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) override
+    {
+        if (!IsSupported(*m_geometry))
+            return Base::ForwardCore(in, kernel, out, workspace);
+
+        const auto& inT = m_geometry->InputShape();
+        const auto& outT = m_geometry->OutputShape();
+        Dims dims;
+        dims.inW = inT[0];
+        dims.inH = inT[1];
+        dims.mapInCount = inT[2];
+        dims.outW = outT[0];
+        dims.outH = outT[1];
+        dims.mapOutCount = outT[2];
+        dims.padW = m_geometry->GetLowerPad(0);
+        dims.padH = m_geometry->GetLowerPad(1);
+        dims.tilesW = (dims.outW + 1) / 2;
+        dims.tilesH = (dims.outH + 1) / 2;
+        size_t C = dims.mapInCount;
+        size_t K = dims.mapOutCount;
+
+        size_t batchSize = in.GetNumCols();
+        size_t subBatchSize = m_maxTempMemSizeInSamples == 0 ? batchSize : min(batchSize, m_maxTempMemSizeInSamples);
+        size_t tilesPerSample = dims.tilesW * dims.tilesH;
+        size_t maxTiles = subBatchSize * tilesPerSample;
+
+        // Reserve space for the transformed kernel weights, inputs and outputs.
+        workspace.Resize(1, TileSize * (C * K + C * maxTiles + K * maxTiles));
+        auto kernTran = workspace.ColumnSlice(0, TileSize * C * K);
+        kernTran.Reshape(C, TileSize * K);
+        TransformKernel(kernel.Data(), dims, kernTran.Data());
+
+        for (size_t start = 0; start < batchSize; start += subBatchSize)
+        {
+            size_t curBatchSize = min(subBatchSize, batchSize - start);
+            size_t P = curBatchSize * tilesPerSample;
+            auto inTran = workspace.ColumnSlice(TileSize * C * K, TileSize * C * P);
+            inTran.Reshape(C, TileSize * P);
+            auto outTran = workspace.ColumnSlice(TileSize * (C * K + C * maxTiles), TileSize * K * P);
+            outTran.Reshape(K, TileSize * P);
+
+            TransformInput(in.ColumnSlice(start, curBatchSize).Data(), curBatchSize, dims, inTran.Data());
+            for (size_t i = 0; i < TileSize; i++)
+            {
+                auto outTranSlice = outTran.ColumnSlice(i * P, P);
+                Mat::Multiply(kernTran.ColumnSlice(i * K, K), true, inTran.ColumnSlice(i * P, P), false, outTranSlice);
+            }
+            auto outSlice = out.ColumnSlice(start, curBatchSize);
+            TransformOutput(outTran.Data(), curBatchSize, dims, outSlice.Data());
+        }
+    }
+
+public:
+    // geometries the Winograd algorithm is used for: 2D, 3x3 kernel spanning all input maps, stride 1
+    static bool IsSupported(const ConvolveGeometry& geometry)
+    {
+        const auto& inT = geometry.InputShape();
+        const auto& kernT = geometry.KernelShape();
+        const auto& outT = geometry.OutputShape();
+        return inT.GetRank() == 3 && kernT.GetRank() == 3 && outT.GetRank() == 3 &&
+               kernT[0] == 3 && kernT[1] == 3 && kernT[2] == inT[2] &&
+               geometry.GetStride(0) == 1 && geometry.GetStride(1) == 1 &&
+               geometry.GetLowerPad(2) == 0 && outT[2] == geometry.GetMapCount(2) &&
+               find(begin(geometry.Sharing()), end(geometry.Sharing()), false) == end(geometry.Sharing());
+    }
+
+private:
+    static const size_t TileSize = 16; // 4x4 elements of a transformed tile
+
+    struct Dims
+    {
+        size_t inW, inH, mapInCount;
+        size_t outW, outH, mapOutCount;
+        int padW, padH;
+        size_t tilesW, tilesH;
+    };
+
+    // U = G g G^T for the 3x3 kernel slice g of each pair of input map c and output map k (weights are laid out as [XYC x K]).
+    // The result is stored as matrix i [C x K] for element i of the 4x4 tile.
+    static void TransformKernel(const ElemType* kernel, const Dims& dims, ElemType* result)
+    {
+        size_t C = dims.mapInCount;
+        size_t K = dims.mapOutCount;
+#pragma omp parallel for
+        for (int k = 0; k < (int)K; k++)
+        {
+            for (size_t c = 0; c < C; c++)
+            {
+                const ElemType* g = kernel + 9 * (c + C * k);
+                ElemType t[4][3]; // G g
+                for (size_t y = 0; y < 3; y++)
+                {
+                    ElemType g0 = g[3 * y], g1 = g[1 + 3 * y], g2 = g[2 + 3 * y];
+                    t[0][y] = g0;
+                    t[1][y] = (g0 + g1 + g2) / 2;
+                    t[2][y] = (g0 - g1 + g2) / 2;
+                    t[3][y] = g2;
+                }
+                for (size_t x = 0; x < 4; x++)
+                {
+                    ElemType* u = result + c + C * k + x * C * K;
+                    u[0 * 4 * C * K] = t[x][0];
+                    u[1 * 4 * C * K] = (t[x][0] + t[x][1] + t[x][2]) / 2;
+                    u[2 * 4 * C * K] = (t[x][0] - t[x][1] + t[x][2]) / 2;
+                    u[3 * 4 * C * K] = t[x][2];
+                }
+            }
+        }
+    }
+
+    // V = B^T d B for the 4x4 input tile d of each tile and input map, zero outside of the input.
+    // The result is stored as matrix i [C x P] for element i of the 4x4 tile.
+    static void TransformInput(const ElemType* in, size_t batchSize, const Dims& dims, ElemType* result)
+    {
+        size_t C = dims.mapInCount;
+        size_t mapInSize = dims.inW * dims.inH;
+        size_t tilesPerSample = dims.tilesW * dims.tilesH;
+        size_t P = batchSize * tilesPerSample;
+#pragma omp parallel for
+        for (int p = 0; p < (int)P; p++)
+        {
+            size_t n = p / tilesPerSample;
+            size_t tileW = (p % tilesPerSample) % dims.tilesW;
+            size_t tileH = (p % tilesPerSample) / dims.tilesW;
+            ptrdiff_t x0 = (ptrdiff_t)(2 * tileW) - dims.padW;
+            ptrdiff_t y0 = (ptrdiff_t)(2 * tileH) - dims.padH;
+            for (size_t c = 0; c < C; c++)
+            {
+                const ElemType* map = in + mapInSize * (c + C * n);
+                ElemType d[4][4];
+                for (size_t y = 0; y < 4; y++)
+                {
+                    for (size_t x = 0; x < 4; x++)
+                    {
+                        ptrdiff_t ix = x0 + x;
+                        ptrdiff_t iy = y0 + y;
+                        bool inside = ix >= 0 && ix < (ptrdiff_t)dims.inW && iy >= 0 && iy < (ptrdiff_t)dims.inH;
+                        d[x][y] = inside ? map[ix + dims.inW * iy] : 0;
+                    }
+                }
+                ElemType t[4][4]; // B^T d
+                for (size_t y = 0; y < 4; y++)
+                {
+                    t[0][y] = d[0][y] - d[2][y];
+                    t[1][y] = d[1][y] + d[2][y];
+                    t[2][y] = d[2][y] - d[1][y];
+                    t[3][y] = d[1][y] - d[3][y];
+                }
+                for (size_t x = 0; x < 4; x++)
+                {
+                    ElemType* v = result + c + C * p + x * C * P;
+                    v[0 * 4 * C * P] = t[x][0] - t[x][2];
+                    v[1 * 4 * C * P] = t[x][1] + t[x][2];
+                    v[2 * 4 * C * P] = t[x][2] - t[x][1];
+                    v[3 * 4 * C * P] = t[x][1] - t[x][3];
+                }
+            }
+        }
+    }
+
+    // Y = A^T M A for the 4x4 tile M of each tile and output map, dropping the outputs beyond the border of odd sized maps.
+    static void TransformOutput(const ElemType* tiles, size_t batchSize, const Dims& dims, ElemType* out)
+    {
+        size_t K = dims.mapOutCount;
+        size_t mapOutSize = dims.outW * dims.outH;
+        size_t tilesPerSample = dims.tilesW * dims.tilesH;
+        size_t P = batchSize * tilesPerSample;
+#pragma omp parallel for
+        for (int p = 0; p < (int)P; p++)
+        {
+            size_t n = p / tilesPerSample;
+            size_t tileW = (p % tilesPerSample) % dims.tilesW;
+            size_t tileH = (p % tilesPerSample) / dims.tilesW;
+            for (size_t k = 0; k < K; k++)
+            {
+                ElemType t[2][4]; // A^T M
+                for (size_t y = 0; y < 4; y++)
+                {
+                    const ElemType* m = tiles + k + K * p + 4 * y * K * P;
+                    ElemType m0 = m[0], m1 = m[K * P], m2 = m[2 * K * P], m3 = m[3 * K * P];
+                    t[0][y] = m0 + m1 + m2;
+                    t[1][y] = m1 - m2 - m3;
+                }
+                ElemType* map = out + mapOutSize * (k + K * n);
+                for (size_t x = 0; x < 2; x++)
+                {
+                    size_t ox = 2 * tileW + x;
+                    if (ox >= dims.outW)
+                        continue;
+                    ElemType y0 = t[x][0] + t[x][1] + t[x][2];
+                    ElemType y1 = t[x][1] - t[x][2] - t[x][3];
+                    size_t oy = 2 * tileH;
+                    map[ox + dims.outW * oy] = y0;
+                    if (oy + 1 < dims.outH)
+                        map[ox + dims.outW * (oy + 1)] = y1;
+                }
+            }
+        }
+    }
+};
+
+//------------------------------------------------------------------
+// Binary convolution engine implementation.
+// Convolves the signs (+1 for values >= 0, -1 otherwise) of the inputs and the kernel weights, as in binarized
+// networks (XNOR-Net; Rastegari, Ordonez, Redmon, Farhadi). For 2D convolutions with kernels spanning all input maps,
+// the forward method packs the signs of the input maps of each pixel of the inputs and kernels into bits, so that
+// a dot product of C values becomes C/64 XOR and popcount operations: the number of values minus twice the number
+// of differing signs (padding contributes nothing, as with zeros). Other geometries are done by the GEMM engine on
+// the binarized operands.
+// The backward methods use the straight-through estimator, i.e. they are the GEMM engine's with the binarized
+// kernel (for the data gradient) or input (for the kernel gradient).
+//------------------------------------------------------------------
+template <class ElemType>
+class BinaryConvolutionEngine : public GemmConvolutionEngine<ElemType>
+{
+public:
+    using Base = GemmConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    BinaryConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind, bool poolIncludePad)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad),
+        m_binaryIn(deviceId), m_binaryKernel(deviceId)
+    {
+    }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_deviceId;
+    using Base::m_imageLayout;
+
+    void EnsureCompatible() override
+    {
+        if (m_imageLayout != ImageLayoutKind::CHW)
+            LogicError("Binary convolution engine supports only CHW/cudnn layout.");
+        if (m_deviceId >= 0)
+            LogicError("Binary convolution engine currently supports only CPU device.");
+        if (find(begin(m_geometry->Sharing()), end(m_geometry->Sharing()), false) != end(m_geometry->Sharing()))
+            LogicError("Binary convolution engine supports only convolutions with full sharing.");
+    }
+
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) override
+    {
+        if (!IsSupported(*m_geometry))
+            return Base::ForwardCore(Binarize(in, m_binaryIn), Binarize(kernel, m_binaryKernel), out, workspace);
+
+        const auto& inT = m_geometry->InputShape();
+        const auto& kernT = m_geometry->KernelShape();
+        const auto& outT = m_geometry->OutputShape();
+        Dims dims;
+        dims.inW = inT[0];
+        dims.inH = inT[1];
+        dims.kW = kernT[0];
+        dims.kH = kernT[1];
+        dims.mapInCount = kernT[2];
+        dims.mapOutCount = outT[2];
+        dims.words = (dims.mapInCount + 63) / 64;
+        size_t outW = outT[0];
+        size_t mapOutSize = outW * outT[1];
+        size_t strideW = m_geometry->GetStride(0), strideH = m_geometry->GetStride(1);
+        ptrdiff_t padW = m_geometry->GetLowerPad(0), padH = m_geometry->GetLowerPad(1);
+
+        size_t batchSize = in.GetNumCols();
+        PackKernel(kernel.Data(), dims);
+        PackInput(in.Data(), batchSize, dims);
+
+        // The signs of the input maps of a pixel are in consecutive words, so that those of the pixels of a row
+        // of the kernel, inside of the input, can be compared at once.
+        size_t K = dims.mapOutCount;
+        size_t rowWords = dims.kW * dims.words;
+        size_t kernelWords = dims.kH * rowWords;
+        size_t sampleWords = dims.inW * dims.inH * dims.words;
+        const uint64_t* kernelBits = m_kernelBits.data();
+        const uint64_t* inputBits = m_inputBits.data();
+        ElemType* outData = out.Data();
+        ptrdiff_t inW = dims.inW, inH = dims.inH, kW = dims.kW, kH = dims.kH;
+        int P = (int)(batchSize * mapOutSize);
+#pragma omp parallel for
+        for (int p = 0; p < P; p++)
+        {
+            size_t n = p / mapOutSize;
+            size_t ox = (p % mapOutSize) % outW;
+            size_t oy = (p % mapOutSize) / outW;
+            ptrdiff_t x0 = (ptrdiff_t)(ox * strideW) - padW;
+            ptrdiff_t y0 = (ptrdiff_t)(oy * strideH) - padH;
+            ptrdiff_t xBegin = max<ptrdiff_t>(0, -x0), xEnd = min<ptrdiff_t>(kW, inW - x0);
+            ptrdiff_t yBegin = max<ptrdiff_t>(0, -y0), yEnd = min<ptrdiff_t>(kH, inH - y0);
+            if (xEnd < xBegin)
+                xEnd = xBegin;
+            if (yEnd < yBegin)
+                yEnd = yBegin;
+            int numValid = (int)(dims.mapInCount * (xEnd - xBegin) * (yEnd - yBegin));
+            size_t runWords = (xEnd - xBegin) * dims.words;
+
+            const uint64_t* sampleBits = inputBits + sampleWords * n + (x0 + xBegin) * dims.words;
+            ElemType* result = outData + mapOutSize * K * n + ox + outW * oy;
+            for (size_t k = 0; k < K; k++)
+            {
+                const uint64_t* kern = kernelBits + kernelWords * k + xBegin * dims.words;
+                int numDifferent = 0;
+                for (ptrdiff_t y = yBegin; y < yEnd; y++)
+                    numDifferent += CountDifferentSigns(sampleBits + (y0 + y) * inW * dims.words, kern + y * rowWords, runWords);
+                result[mapOutSize * k] = (ElemType)(numValid - 2 * numDifferent);
+            }
+        }
+    }
+
+    void BackwardDataCore(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool accumulateGradient, Mat& workspace) override
+    {
+        Base::BackwardDataCore(srcGrad, Binarize(kernel, m_binaryKernel), grad, accumulateGradient, workspace);
+    }
+
+    void BackwardKernelCore(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool accumulateGradient, bool allowReuse, Mat& workspace) override
+    {
+        Base::BackwardKernelCore(srcGrad, Binarize(in, m_binaryIn), kernelGrad, accumulateGradient, allowReuse, workspace);
+    }
+
+public:
+    // geometries the bit-packed forward method is used for: 2D, kernel spanning all input maps
+    static bool IsSupported(const ConvolveGeometry& geometry)
+    {
+        const auto& inT = geometry.InputShape();
+        const auto& kernT = geometry.KernelShape();
+        const auto& outT = geometry.OutputShape();
+        return inT.GetRank() == 3 && kernT.GetRank() == 3 && outT.GetRank() == 3 &&
+               kernT[2] == inT[2] && geometry.GetLowerPad(2) == 0 && outT[2] == geometry.GetMapCount(2) &&
+               find(begin(geometry.Sharing()), end(geometry.Sharing()), false) == end(geometry.Sharing());
+    }
+
+private:
+    static const Mat& Binarize(const Mat& src, Mat& result)
+    {
+        result.Resize(src.GetNumRows(), src.GetNumCols());
+        const ElemType* s = src.Data();
+        ElemType* r = result.Data();
+        int n = (int)src.GetNumElements();
+#pragma omp parallel for
+        for (int i = 0; i < n; i++)
+            r[i] = s[i] < 0 ? (ElemType)-1 : (ElemType)1;
+        return result;
+    }
+
+    struct Dims
+    {
+        size_t inW, inH, kW, kH;
+        size_t mapInCount, mapOutCount;
+        size_t words; // 64-bit words for the signs of the input maps of a pixel
+    };
+
+    // sign bits of the kernel weights (laid out as [XYC x K]) as [words x XY x K], bit c % 64 of word c / 64 for map c
+    void PackKernel(const ElemType* kernel, const Dims& dims)
+    {
+        size_t kernelSize = dims.kW * dims.kH;
+        size_t C = dims.mapInCount;
+        m_kernelBits.assign(dims.words * kernelSize * dims.mapOutCount, 0);
+#pragma omp parallel for
+        for (int k = 0; k < (int)dims.mapOutCount; k++)
+        {
+            uint64_t* bits = m_kernelBits.data() + dims.words * kernelSize * k;
+            for (size_t c = 0; c < C; c++)
+            {
+                const ElemType* map = kernel + kernelSize * (c + C * k);
+                for (size_t i = 0; i < kernelSize; i++)
+                    bits[i * dims.words + c / 64] |= (uint64_t)(map[i] < 0) << (c % 64);
+            }
+        }
+    }
+
+    // sign bits of the inputs (laid out as [WHC x N]) as [words x WH x N]
+    void PackInput(const ElemType* in, size_t batchSize, const Dims& dims)
+    {
+        size_t mapInSize = dims.inW * dims.inH;
+        size_t C = dims.mapInCount;
+        m_inputBits.assign(dims.words * mapInSize * batchSize, 0);
+#pragma omp parallel for
+        for (int r = 0; r < (int)(batchSize * dims.inH); r++)
+        {
+            size_t n = r / dims.inH;
+            size_t iy = r % dims.inH;
+            uint64_t* bits = m_inputBits.data() + dims.words * (mapInSize * n + dims.inW * iy);
+            for (size_t c = 0; c < C; c++)
+            {
+                const ElemType* row = in + mapInSize * (c + C * n) + dims.inW * iy;
+                for (size_t ix = 0; ix < dims.inW; ix++)
+                    bits[ix * dims.words + c / 64] |= (uint64_t)(row[ix] < 0) << (c % 64);
+            }
+        }
+    }
+
+    static inline int PopCount(uint64_t x)
+    {
+#ifdef _MSC_VER
+        return (int)__popcnt64(x);
+#else
+        return __builtin_popcountll(x);
+#endif
+    }
+
+    // number of bits in which a and b differ
+    static inline int CountDifferentSigns(const uint64_t* a, const uint64_t* b, size_t words)
+    {
+        int count = 0;
+        size_t w = 0;
+#ifdef SUPPORT_AVX512VPOPCNTDQ
+        if (words >= 8)
+        {
+            __m512i counts = _mm512_setzero_si512();
+            for (; w + 8 <= words; w += 8)
+                counts = _mm512_add_epi64(counts, _mm512_popcnt_epi64(_mm512_xor_si512(_mm512_loadu_si512(a + w), _mm512_loadu_si512(b + w))));
+            count = (int)_mm512_reduce_add_epi64(counts);
+        }
+#endif
+        for (; w < words; w++)
+            count += PopCount(a[w] ^ b[w]);
+        return count;
+    }
+
+    Mat m_binaryIn;
+    Mat m_binaryKernel;
+    std::vector<uint64_t> m_kernelBits;
+    std::vector<uint64_t> m_inputBits;
+};
+
+//------------------------------------------------------------------
+// Depthwise convolution engine implementation.
+// Computes 2D grouped convolutions with one input map per group (ConvolveGeometry::Groups() equal to the number of
+// input maps C, as in depthwise-separable convolutions) directly on the CPU. Output map k is the correlation of input
+// map k % C with kernel k, which is accumulated from rows of the input map that are shifted and scaled by one kernel
+// weight at a time, so that the innermost loops run over consecutive pixels (and vectorize for stride 1).
+// The GEMM engine does not support such geometries (the kernels are not shared along the maps), and its unrolled
+// input would only have X * Y rows per output map.
+// Other geometries are done by the reference engine.
+//------------------------------------------------------------------
+template <class ElemType>
+class DepthwiseConvolutionEngine : public ReferenceConvolutionEngine<ElemType>
+{
+public:
+    using Base = ReferenceConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    DepthwiseConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind, bool poolIncludePad)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad)
+    {
+    }
+
+protected:
+    using Base::IsGpu;
+
+    using Base::m_geometry;
+    using Base::m_deviceId;
+    using Base::m_imageLayout;
+
+    void EnsureCompatible() override
+    {
+        if (m_imageLayout != ImageLayoutKind::CHW)
+            LogicError("Depthwise convolution engine supports only CHW/cudnn layout.");
+        if (IsGpu(m_deviceId))
+            LogicError("Depthwise convolution engine currently supports only CPU device.");
+    }
+
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) override
+    {
+        if (!IsSupported(*m_geometry))
+            return Base::ForwardCore(in, kernel, out, workspace);
+
+        Dims d = GetDims();
+        const ElemType* inData = in.Data();
+        const ElemType* kernelData = kernel.Data();
+        ElemType* outData = out.Data();
+        int maps = (int)(in.GetNumCols() * d.mapOutCount);
+#pragma omp parallel for
+        for (int p = 0; p < maps; p++)
+        {
+            size_t n = p / d.mapOutCount;
+            size_t k = p % d.mapOutCount;
+            const ElemType* src = inData + n * d.inW * d.inH * d.mapInCount + (k % d.mapInCount) * d.inW * d.inH;
+            const ElemType* w = kernelData + k * d.kW * d.kH;
+            ElemType* dst = outData + n * d.outW * d.outH * d.mapOutCount + k * d.outW * d.outH;
+            std::fill(dst, dst + d.outW * d.outH, (ElemType)0);
+            for (size_t y = 0; y < d.outH; y++)
+            {
+                for (size_t j = 0; j < d.kH; j++)
+                {
+                    int inY = (int)(y * d.sH + j) - d.padH;
+                    if (inY < 0 || inY >= (int)d.inH)
+                        continue;
+                    for (size_t i = 0; i < d.kW; i++)
+                    {
+                        size_t begin, end;
+                        ValidOutputRange(d, i, begin, end);
+                        if (begin < end)
+                            AddScaled(dst + y * d.outW + begin, 1, src + inY * d.inW + begin * d.sW + i - d.padW, d.sW, w[i + d.kW * j], end - begin);
+                    }
+                }
+            }
+        }
+    }
+
+    void BackwardDataCore(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool accumulateGradient, Mat& workspace) override
+    {
+        if (!IsSupported(*m_geometry))
+            return Base::BackwardDataCore(srcGrad, kernel, grad, accumulateGradient, workspace);
+
+        // each input map receives the gradients of its output maps k = c + C * m
+        Dims d = GetDims();
+        const ElemType* srcGradData = srcGrad.Data();
+        const ElemType* kernelData = kernel.Data();
+        ElemType* gradData = grad.Data();
+        int maps = (int)(srcGrad.GetNumCols() * d.mapInCount);
+#pragma omp parallel for
+        for (int p = 0; p < maps; p++)
+        {
+            size_t n = p / d.mapInCount;
+            size_t c = p % d.mapInCount;
+            ElemType* dst = gradData + n * d.inW * d.inH * d.mapInCount + c * d.inW * d.inH;
+            for (size_t k = c; k < d.mapOutCount; k += d.mapInCount)
+            {
+                const ElemType* src = srcGradData + n * d.outW * d.outH * d.mapOutCount + k * d.outW * d.outH;
+                const ElemType* w = kernelData + k * d.kW * d.kH;
+                for (size_t y = 0; y < d.outH; y++)
+                {
+                    for (size_t j = 0; j < d.kH; j++)
+                    {
+                        int inY = (int)(y * d.sH + j) - d.padH;
+                        if (inY < 0 || inY >= (int)d.inH)
+                            continue;
+                        for (size_t i = 0; i < d.kW; i++)
+                        {
+                            size_t begin, end;
+                            ValidOutputRange(d, i, begin, end);
+                            if (begin < end)
+                                AddScaled(dst + inY * d.inW + begin * d.sW + i - d.padW, d.sW, src + y * d.outW + begin, 1, w[i + d.kW * j], end - begin);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void BackwardKernelCore(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool accumulateGradient, bool allowReuse, Mat& workspace) override
+    {
+        if (!IsSupported(*m_geometry))
+            return Base::BackwardKernelCore(srcGrad, in, kernelGrad, accumulateGradient, allowReuse, workspace);
+
+        // each kernel is only used by its output map, so that the kernels can be computed in parallel
+        Dims d = GetDims();
+        const ElemType* srcGradData = srcGrad.Data();
+        const ElemType* inData = in.Data();
+        ElemType* kernelGradData = kernelGrad.Data();
+        size_t batchSize = in.GetNumCols();
+#pragma omp parallel for
+        for (int k = 0; k < (int)d.mapOutCount; k++)
+        {
+            ElemType* w = kernelGradData + k * d.kW * d.kH;
+            for (size_t n = 0; n < batchSize; n++)
+            {
+                const ElemType* src = inData + n * d.inW * d.inH * d.mapInCount + (k % d.mapInCount) * d.inW * d.inH;
+                const ElemType* g = srcGradData + n * d.outW * d.outH * d.mapOutCount + k * d.outW * d.outH;
+                for (size_t y = 0; y < d.outH; y++)
+                {
+                    for (size_t j = 0; j < d.kH; j++)
+                    {
+                        int inY = (int)(y * d.sH + j) - d.padH;
+                        if (inY < 0 || inY >= (int)d.inH)
+                            continue;
+                        for (size_t i = 0; i < d.kW; i++)
+                        {
+                            size_t begin, end;
+                            ValidOutputRange(d, i, begin, end);
+                            if (begin < end)
+                                w[i + d.kW * j] += Dot(src + inY * d.inW + begin * d.sW + i - d.padW, d.sW, g + y * d.outW + begin, end - begin);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+public:
+    // geometries this engine computes: 2D, one input map per group
+    static bool IsSupported(const ConvolveGeometry& geometry)
+    {
+        const auto& inT = geometry.InputShape();
+        const auto& kernT = geometry.KernelShape();
+        const auto& outT = geometry.OutputShape();
+        return inT.GetRank() == 3 && kernT.GetRank() == 3 && outT.GetRank() == 3 &&
+               kernT[2] == 1 && geometry.Groups() == inT[2];
+    }
+
+    static bool IsSupported(DEVICEID_TYPE deviceId, const ConvolveGeometry& geometry, PoolKind poolKind)
+    {
+        return deviceId < 0 && poolKind == PoolKind::None && IsSupported(geometry);
+    }
+
+private:
+    struct Dims
+    {
+        size_t inW, inH, mapInCount;
+        size_t outW, outH, mapOutCount;
+        size_t kW, kH, sW, sH;
+        int padW, padH;
+    };
+
+    Dims GetDims() const
+    {
+        const auto& inT = m_geometry->InputShape();
+        const auto& kernT = m_geometry->KernelShape();
+        const auto& outT = m_geometry->OutputShape();
+        Dims d;
+        d.inW = inT[0];
+        d.inH = inT[1];
+        d.mapInCount = inT[2];
+        d.outW = outT[0];
+        d.outH = outT[1];
+        d.mapOutCount = outT[2];
+        d.kW = kernT[0];
+        d.kH = kernT[1];
+        d.sW = m_geometry->GetStride(0);
+        d.sH = m_geometry->GetStride(1);
+        d.padW = m_geometry->GetLowerPad(0);
+        d.padH = m_geometry->GetLowerPad(1);
+        return d;
+    }
+
+    // the output columns [begin, end) whose input column x * sW + i - padW for kernel column i is inside the input
+    static void ValidOutputRange(const Dims& d, size_t i, size_t& begin, size_t& end)
+    {
+        int offset = (int)i - d.padW;
+        int stride = (int)d.sW;
+        int first = offset >= 0 ? 0 : (-offset + stride - 1) / stride;
+        int last = (int)d.inW - 1 - offset; // (largest x * sW)
+        begin = (size_t)first;
+        end = last < 0 ? 0 : (std::min)(d.outW, (size_t)(last / stride + 1));
+    }
+
+    // dst[x * dstStride] += w * src[x * srcStride]
+    static void AddScaled(ElemType* dst, size_t dstStride, const ElemType* src, size_t srcStride, ElemType w, size_t count)
+    {
+        if (dstStride == 1 && srcStride == 1)
+        {
+            for (size_t x = 0; x < count; x++)
+                dst[x] += w * src[x];
+        }
+        else
+        {
+            for (size_t x = 0; x < count; x++)
+                dst[x * dstStride] += w * src[x * srcStride];
+        }
+    }
+
+    // sum of a[x * aStride] * b[x]
+    static ElemType Dot(const ElemType* a, size_t aStride, const ElemType* b, size_t count)
+    {
+        ElemType sum = 0;
+        if (aStride == 1)
+        {
+            for (size_t x = 0; x < count; x++)
+                sum += a[x] * b[x];
+        }
+        else
+        {
+            for (size_t x = 0; x < count; x++)
+                sum += a[x * aStride] * b[x];
+        }
+        return sum;
+    }
+};
+
+//------------------------------------------------------------------
+// HWC convolution engine implementation.
+// Runs 2D convolutions in the HWC (legacy) layout with cuDNN, whose tensor-core kernels are fastest on NHWC data, so
+// that chains of HWC nodes are not slowed down by the legacy engine. Data stays HWC; only the weights, which the legacy
+// engine stores as [K x XYC] with K innermost, are transposed to the [XYC x K] layout of cuDNN around each call.
+// The legacy engine enumerates the pixels of an HWC image with the second tensor dimension innermost, so cuDNN is given
+// the geometry with the first two dimensions swapped, which matches the legacy engine also for non-square images.
+// Sparse inputs and pooling are left to the legacy engine.
+//------------------------------------------------------------------
+template <class ElemType>
+class HwcConvolutionEngine : public ConvolutionEngine<ElemType>
+{
+public:
+    using Base = ConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    HwcConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind,
+                         bool forceDeterministicAlgorithms, bool poolIncludePad)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad),
+        m_cuDnnEngine(CuDnnConvolutionEngineFactory<ElemType>::Create(SwapSpatialDims(*geometry), deviceId, imageLayout, maxTempMemSizeInSamples, poolKind,
+                                                                      forceDeterministicAlgorithms, poolIncludePad)),
+        m_legacyEngine(std::make_unique<LegacyConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad)),
+        m_kernelTransposed(deviceId), m_kernelGradTransposed(deviceId)
+    {
+    }
+
+    static bool IsSupported(DEVICEID_TYPE deviceId, ConvolveGeometryPtr geometry, PoolKind poolKind)
+    {
+        return poolKind == PoolKind::None && geometry->InputShape().GetRank() == 3 && geometry->Groups() == 1 &&
+               CuDnnConvolutionEngineFactory<ElemType>::IsSupported(deviceId, SwapSpatialDims(*geometry), poolKind);
+    }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_deviceId;
+    using Base::m_imageLayout;
+
+    void EnsureCompatible() override
+    {
+        if (m_imageLayout != ImageLayoutKind::HWC)
+            RuntimeError("HWC convolution engine supports only HWC/legacy layout.");
+    }
+
+    void EnsureConvolutionInitialized() override
+    {
+    }
+
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) override
+    {
+        if (in.GetMatrixType() != MatrixType::DENSE)
+        {
+            m_legacyEngine->Forward(in, kernel, out, workspace);
+            return;
+        }
+        m_kernelTransposed.AssignTransposeOf(kernel);
+        m_cuDnnEngine->Forward(in, m_kernelTransposed, out, workspace);
+    }
+
+    void BackwardDataCore(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool accumulateGradient, Mat& workspace) override
+    {
+        m_kernelTransposed.AssignTransposeOf(kernel);
+        m_cuDnnEngine->BackwardData(srcGrad, m_kernelTransposed, grad, accumulateGradient, workspace);
+    }
+
+    void BackwardKernelCore(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool accumulateGradient, bool allowReuse, Mat& workspace) override
+    {
+        if (in.GetMatrixType() != MatrixType::DENSE)
+        {
+            m_legacyEngine->BackwardKernel(srcGrad, in, kernelGrad, accumulateGradient, allowReuse, workspace);
+            return;
+        }
+        m_kernelGradTransposed.Resize(kernelGrad.GetNumCols(), kernelGrad.GetNumRows());
+        m_cuDnnEngine->BackwardKernel(srcGrad, in, m_kernelGradTransposed, /*accumulateGradient=*/false, allowReuse, workspace);
+        if (accumulateGradient)
+        {
+            m_kernelTransposed.AssignTransposeOf(m_kernelGradTransposed);
+            kernelGrad += m_kernelTransposed;
+        }
+        else
+            kernelGrad.AssignTransposeOf(m_kernelGradTransposed);
+    }
+
+    void EnsurePoolingInitialized() override
+    {
+    }
+
+    void ForwardPoolingCore(const Mat& in, Mat& out) override
+    {
+        m_legacyEngine->ForwardPooling(in, out);
+    }
+
+    void BackwardPoolingCore(const Mat& out, const Mat& srcGrad, const Mat& in, Mat& grad, bool accumulateGradient) override
+    {
+        m_legacyEngine->BackwardPooling(out, srcGrad, in, grad, accumulateGradient);
+    }
+
+    void MaxUnpoolingCore(const Mat& out, const Mat& poolIn, Mat& in) override
+    {
+        m_legacyEngine->MaxUnpooling(out, poolIn, in);
+    }
+
+private:
+    static TensorShape SwapSpatialDims(const TensorShape& shape)
+    {
+        if (shape.GetRank() < 2)
+            return shape;
+        auto dims = shape.GetDims();
+        std::swap(dims[0], dims[1]);
+        return TensorShape(dims);
+    }
+
+    static ConvolveGeometryPtr SwapSpatialDims(const ConvolveGeometry& g)
+    {
+        auto sharing = g.Sharing();
+        auto autoPad = g.AutoPad();
+        if (sharing.size() > 1)
+            sharing.swap(sharing[0], sharing[1]);
+        if (autoPad.size() > 1)
+            autoPad.swap(autoPad[0], autoPad[1]);
+        auto swapped = std::make_shared<ConvolveGeometry>(SwapSpatialDims(g.InputShape()), SwapSpatialDims(g.KernelShape()), SwapSpatialDims(g.MapCount()),
+                                                          SwapSpatialDims(g.Stride()), sharing, autoPad, SwapSpatialDims(g.LowerPad()), SwapSpatialDims(g.UpperPad()));
+        if (swapped->OutputShape() != SwapSpatialDims(g.OutputShape())) // (the geometry was created with ceilOutDim)
+            swapped = std::make_shared<ConvolveGeometry>(SwapSpatialDims(g.InputShape()), SwapSpatialDims(g.KernelShape()), SwapSpatialDims(g.MapCount()),
+                                                         SwapSpatialDims(g.Stride()), sharing, autoPad, SwapSpatialDims(g.LowerPad()), SwapSpatialDims(g.UpperPad()),
+                                                         /*ceilOutDim=*/true);
+        return swapped;
+    }
+
+    std::unique_ptr<ConvolutionEngine<ElemType>> m_cuDnnEngine;
+    std::unique_ptr<ConvolutionEngine<ElemType>> m_legacyEngine;
+    Mat m_kernelTransposed;
+    Mat m_kernelGradTransposed;
+};
+
 template <class ElemType>
 std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId,
                                                                                  ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind,
@@ -867,9 +1707,28 @@ std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create
     // can be called from places like MEL with default parameters and never be used. 
     // The check will be done later in engine's EnsureCompatible call if the egnine is actually used.
     auto engStr = (std::string)(*geometry);
-    // Only legacy engine supports HWC layout.
+    // The binary engine computes a different function than the others, so it is used whenever it is asked for
+    // (its EnsureCompatible() checks the configuration once it is used).
+    if (isEnabled(ConvolutionEngineKind::Binary))
+    {
+        if (GetMathLibTraceLevel() > 0)
+            fprintf(stderr, "%lsusing binary convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+        return std::make_unique<BinaryConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad);
+    }
+
+    // Only legacy engine supports HWC layout, and cuDNN for dense 2D convolution (through the HWC engine).
     if (imageLayout == ImageLayoutKind::HWC)
     {
+        if (isEnabled(ConvolutionEngineKind::CuDnn) && isEnabled(ConvolutionEngineKind::Legacy) &&
+            HwcConvolutionEngine<ElemType>::IsSupported(deviceId, geometry, poolKind))
+        {
+            if (GetMathLibTraceLevel() > 0)
+                fprintf(stderr, "%lsusing cuDNN convolution engine with HWC layout for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+            return std::make_unique<HwcConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, forceDeterministicAlgorithms, poolIncludePad);
+        }
+
         if (!isEnabled(ConvolutionEngineKind::Legacy))
             RuntimeError("Trying to use Legacy convolution engine when it's disabled.");
 
@@ -889,6 +1748,25 @@ std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create
         return CuDnnConvolutionEngineFactory<ElemType>::Create(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, forceDeterministicAlgorithms, poolIncludePad);
     }
 
+    // Depthwise convolutions on the CPU, which the GEMM engine does not support.
+    if (isEnabled(ConvolutionEngineKind::Depthwise) && DepthwiseConvolutionEngine<ElemType>::IsSupported(deviceId, *geometry, poolKind))
+    {
+        if (GetMathLibTraceLevel() > 0)
+            fprintf(stderr, "%lsusing depthwise convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+        return std::make_unique<DepthwiseConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad);
+    }
+
+    // The Winograd engine falls back to GEMM for geometries it does not support, and is thus only preferred for those it does.
+    if (isEnabled(ConvolutionEngineKind::Winograd) && GemmConvolutionEngine<ElemType>::IsSupported(deviceId, geometry) &&
+        (WinogradConvolutionEngine<ElemType>::IsSupported(*geometry) || !isEnabled(ConvolutionEngineKind::Gemm)))
+    {
+        if (GetMathLibTraceLevel() > 0)
+            fprintf(stderr, "%lsusing Winograd convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+        return std::make_unique<WinogradConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad);
+    }
+
     if (isEnabled(ConvolutionEngineKind::Gemm) && GemmConvolutionEngine<ElemType>::IsSupported(deviceId, geometry))
     {
         if (GetMathLibTraceLevel() > 0)
@@ -22,8 +22,12 @@ enum class ConvolutionEngineKind
     CuDnn     = 1 << 1, // cuDNN, works only for 2D/3D convos with full sharing.
     Legacy    = 1 << 2, // Legacy, for backwards compatibility. REVIEW alexeyk: implement sparse version and remove Legacy altogether.
     Gemm      = 1 << 3, // Uses convolution unrolling+GEMM technique. Works only for convos with full sharing.
+    Winograd  = 1 << 4, // Winograd F(2x2, 3x3) for the forward pass of 2D 3x3 convos with stride 1 on CPU, GEMM for everything else.
+    Binary    = 1 << 5, // Binary (XNOR) convolution of the signs of inputs and weights on CPU, with bit-packed operands for 2D convos.
+                        // Not part of All, as it computes a different function.
+    Depthwise = 1 << 6, // Direct computation of 2D grouped convos with one input map per group (see ConvolveGeometry::Groups()) on CPU.
 
-    All       = Reference | CuDnn | Legacy | Gemm
+    All       = Reference | CuDnn | Legacy | Gemm | Winograd | Depthwise
 };
 
 enum class PoolKind
@@ -66,8 +70,8 @@ public:
 
     DISABLE_COPY_AND_MOVE(ConvolutionEngine);
 
-    // REVIEW alexeyk: This is not enough as there should be invalidation of auto-tuner state in cuDNN engine. Fine for now if it works.
-    void SetmMaxTempMemSizeInSamples(const size_t maxTempMemSizeInSamples)
+    // engines that auto-tune against the workspace limit (cuDNN) redo the tuning when it changes
+    virtual void SetmMaxTempMemSizeInSamples(const size_t maxTempMemSizeInSamples)
     {
         m_maxTempMemSizeInSamples = maxTempMemSizeInSamples;
     }
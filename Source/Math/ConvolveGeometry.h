@@ -76,6 +76,9 @@ public:
     // Number of kernels (equal to MapCount if sharing is all true values).
     size_t KernelCount() const { return m_kernelCount; }
 
+    // Number of convolution groups (see ComputeGroups()), 1 for an ordinary convolution.
+    size_t Groups() const { return m_groups; }
+
     ConvolveGeometry(const TensorShape& inputShape, const TensorShape& kernelShape, const TensorShape& mapCount, const TensorShape& stride,
                      const BoolVec& sharing, const BoolVec& autoPad, const TensorShape& lowerPad, const TensorShape& upperPad, const bool ceilOutDim = false)
                      : m_inputShape(inputShape), m_kernelShape(kernelShape), m_mapCount(mapCount), m_stride(stride), m_sharing(sharing),
@@ -98,6 +101,8 @@ public:
         size_t dimCount = inputShape.GetRank();
         size_t kernelSize = kernelShape.GetNumElements();
 
+        m_groups = ComputeGroups(m_inputShape, m_kernelShape, m_mapCount, m_stride, m_sharing, m_autoPad, m_lowerPad, m_upperPad);
+
         // Compute the total number of kernels.
         m_kernelCount = 1;
         for (size_t i = 0; i < dimCount; i++)
@@ -409,6 +414,36 @@ public:
         return (kernSize - 1) - (kernSize - 1) / 2 - (extra - center); 
     }
 
+    // Computes the number of groups G of a grouped convolution, in which input maps c and output maps k are split into
+    // G consecutive groups of C/G input maps each, and output map k only depends on the input maps of group g = k % G.
+    // This is a convolution whose kernels span C/G input maps, step by C/G over the input maps, are shared along all
+    // other dimensions but not along the maps, and whose map count M counts the output maps per group. Output map
+    // (and kernel) k = g + G * m is map m of group g. With C/G == 1 (and M == 1) this is a depthwise convolution.
+    // Returns 1 for any other geometry.
+    static size_t ComputeGroups(const TensorShape& inputShape, const TensorShape& kernelShape, const TensorShape& mapCount, const TensorShape& stride,
+                                const BoolVec& sharing, const BoolVec& autoPad, const TensorShape& lowerPad, const TensorShape& upperPad)
+    {
+        size_t rank = inputShape.GetRank();
+        if (rank < 2 || kernelShape.GetRank() != rank)
+            return 1;
+        size_t last = rank - 1;
+        for (size_t i = 0; i < rank; i++)
+        {
+            if (sharing[sharing.size() == 1 ? 0 : i] != (i != last))
+                return 1;
+            if (i != last && mapCount.GetRank() > 1 && mapCount[i] != 1)
+                return 1;
+        }
+        size_t mapsPerGroup = kernelShape[last];
+        if (mapsPerGroup == 0 || mapsPerGroup >= inputShape[last] || inputShape[last] % mapsPerGroup != 0 ||
+            stride[stride.GetRank() == 1 ? 0 : last] != mapsPerGroup)
+            return 1;
+        if (!autoPad[autoPad.size() == 1 ? 0 : last] &&
+            (lowerPad[lowerPad.GetRank() == 1 ? 0 : last] != 0 || upperPad[upperPad.GetRank() == 1 ? 0 : last] != 0))
+            return 1;
+        return inputShape[last] / mapsPerGroup;
+    }
+
     // Computes output shape given input shape and other convolution parameters.
     static TensorShape ComputeOutputShape(const TensorShape& inputShape, const TensorShape& kernelShape, const TensorShape& mapCount, const TensorShape& stride,
                                           const BoolVec& sharing, const BoolVec& autoPad, const TensorShape& lowerPad, const TensorShape& upperPad, const bool ceilOutDim = false)
@@ -558,6 +593,8 @@ public:
         res << AutoPad().back() << ")";
         res << ", LowerPad: " << (string)LowerPad();
         res << ", UpperPad: " << (string)UpperPad();
+        if (Groups() > 1)
+            res << ", Groups: " << Groups();
         return res.str();
     }
 
@@ -594,6 +631,7 @@ private:
     int m_originIndex;
 
     size_t m_kernelCount;
+    size_t m_groups;
 };
 
 using ConvolveGeometryPtr = std::shared_ptr<ConvolveGeometry>;
@@ -0,0 +1,99 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// A counter-based random number generator, shared by the CPU and GPU implementations of SetCounterBasedRandomValue().
+//
+
+#pragma once
+
+#include "CommonMatrix.h"
+#include <cmath>
+#include <cstdint>
+
+#pragma push_macro("COUNTER_BASED_RANDOM_DECL")
+#ifndef COUNTER_BASED_RANDOM_DECL // to make these accessible to CUDA kernels, say '#define COUNTER_BASED_RANDOM_DECL __device__ __host__'
+#define COUNTER_BASED_RANDOM_DECL
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// CounterBasedRandom -- Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC'11)
+// A random number is a function of (seed, counter) rather than the next state of a sequential generator, so the value of
+// each element of a matrix is determined by the seed and the element's index alone. It can thus be computed by one CUDA
+// thread per element or by any number of CPU threads, and the result does not depend on either. The transcendental
+// functions of the normal distributions are computed in double precision, so that CPU and GPU agree up to rounding.
+struct CounterBasedRandom
+{
+    // the four 32-bit random numbers for counter (c0, c1, c2, c3) under the key 'seed'
+    static inline COUNTER_BASED_RANDOM_DECL void Philox4x32(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint64_t seed, uint32_t r[4])
+    {
+        uint32_t k0 = (uint32_t)seed;
+        uint32_t k1 = (uint32_t)(seed >> 32);
+        for (int round = 0; round < 10; round++)
+        {
+            if (round > 0)
+            {
+                k0 += 0x9E3779B9; // the Weyl sequence that bumps the key between the rounds
+                k1 += 0xBB67AE85;
+            }
+            const uint64_t p0 = (uint64_t)0xD2511F53 * c0;
+            const uint64_t p1 = (uint64_t)0xCD9E8D57 * c2;
+            const uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+            const uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+            c1 = (uint32_t)p1;
+            c3 = (uint32_t)p0;
+            c0 = n0;
+            c2 = n2;
+        }
+        r[0] = c0;
+        r[1] = c1;
+        r[2] = c2;
+        r[3] = c3;
+    }
+
+    // uniform in (0, 1], from 24 resp. 53 random bits
+    static inline COUNTER_BASED_RANDOM_DECL float ToUniform01(float, uint32_t x, uint32_t)
+    {
+        return ((x >> 8) + 1) * (1.0f / 16777216.0f);
+    }
+    static inline COUNTER_BASED_RANDOM_DECL double ToUniform01(double, uint32_t x, uint32_t y)
+    {
+        return ((((uint64_t)x << 21) | (y >> 11)) + 1) * (1.0 / 9007199254740992.0);
+    }
+
+    // the value of element 'index' of a matrix filled under 'seed'
+    // 'a' and 'b' are the bounds for Uniform, mean and standard deviation for Normal and TruncatedNormal, location and
+    // scale for Gumbel, and the probability of 0 and the value otherwise for Bernoulli.
+    // TruncatedNormal, as SetTruncatedNormalRandomValue(), rejects values more than two standard deviations from the mean;
+    // each attempt uses the next counter.
+    template <class ElemType>
+    static inline COUNTER_BASED_RANDOM_DECL ElemType Value(RandomDistribution distribution, ElemType a, ElemType b, uint64_t seed, uint64_t index)
+    {
+        uint32_t r[4];
+        for (uint32_t attempt = 0;; attempt++)
+        {
+            Philox4x32((uint32_t)index, (uint32_t)(index >> 32), attempt, 0, seed, r);
+            if (distribution == RandomDistribution::Uniform)
+                return a + (b - a) * ToUniform01(ElemType(), r[0], r[1]);
+            if (distribution == RandomDistribution::Bernoulli)
+                return ToUniform01(ElemType(), r[0], r[1]) <= a ? 0 : b;
+            if (distribution == RandomDistribution::Gumbel) // (u in the open interval (0, 1), so that the value is finite)
+            {
+                const double u = ((((uint64_t)r[0] << 21) | (r[1] >> 11)) + 0.5) * (1.0 / 9007199254740992.0);
+                return a - b * (ElemType)log(-log(u));
+            }
+
+            // Box-Muller
+            const double u1 = ToUniform01(ElemType(), r[0], r[1]);
+            const double u2 = ToUniform01(ElemType(), r[2], r[3]);
+            const double z = sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+            if (distribution == RandomDistribution::Normal || (z >= -2.0 && z <= 2.0)) // (acceptance probability of about 0.9545)
+                return a + b * (ElemType)z;
+        }
+    }
+};
+
+}}}
+
+#pragma pop_macro("COUNTER_BASED_RANDOM_DECL")
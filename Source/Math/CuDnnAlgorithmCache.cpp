@@ -0,0 +1,94 @@
+#include "stdafx.h"
+#include "CuDnnAlgorithmCache.h"
+#include "Basics.h"
+#include "fileutil.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+std::mutex CuDnnAlgorithmCache::s_mutex;
+std::unordered_map<std::string, CuDnnAlgorithmCache::Entry> CuDnnAlgorithmCache::s_entries;
+std::wstring CuDnnAlgorithmCache::s_cacheFile;
+uint64_t CuDnnAlgorithmCache::s_cacheFileOffset = 0;
+
+void CuDnnAlgorithmCache::SetCacheFile(const std::wstring& path)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_cacheFile = path;
+    s_cacheFileOffset = 0;
+    size_t numEntries = s_entries.size();
+    ReadNewEntries();
+    if (s_entries.size() > numEntries)
+        fprintf(stderr, "CuDnnAlgorithmCache: loaded %d convolution algorithms from %ls.\n", (int) (s_entries.size() - numEntries), path.c_str());
+}
+
+// The file has one line per key: the algorithm, a tab, the workspace size in bytes, a tab, and the key.
+// Reading stops at a line without a newline, which another process may still be writing; it is read on the next call.
+void CuDnnAlgorithmCache::ReadNewEntries()
+{
+    if (s_cacheFile.empty() || !fexists(s_cacheFile))
+        return;
+
+    FILE* f = fopenOrDie(s_cacheFile, L"rb");
+    fsetpos(f, s_cacheFileOffset);
+    char buf[4096];
+    while (fgets(buf, _countof(buf), f) != nullptr)
+    {
+        std::string line = buf;
+        if (line.empty() || line.back() != '\n')
+            break;
+        s_cacheFileOffset = fgetpos(f);
+
+        line.pop_back();
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        auto tab1 = line.find('\t');
+        auto tab2 = tab1 == std::string::npos ? std::string::npos : line.find('\t', tab1 + 1);
+        if (tab2 == std::string::npos || tab1 == 0)
+            continue; // (malformed line)
+        Entry entry;
+        entry.algo = atoi(line.substr(0, tab1).c_str());
+        entry.workspaceSize = (size_t) strtoull(line.substr(tab1 + 1, tab2 - tab1 - 1).c_str(), nullptr, 10);
+        s_entries[line.substr(tab2 + 1)] = entry;
+    }
+    fclose(f);
+}
+
+bool CuDnnAlgorithmCache::Lookup(const std::string& key, int& algo, size_t& workspaceSize)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto iter = s_entries.find(key);
+    if (iter == s_entries.end())
+    {
+        // another process may have found it in the meantime
+        ReadNewEntries();
+        iter = s_entries.find(key);
+        if (iter == s_entries.end())
+            return false;
+    }
+    algo = iter->second.algo;
+    workspaceSize = iter->second.workspaceSize;
+    return true;
+}
+
+void CuDnnAlgorithmCache::Record(const std::string& key, int algo, size_t workspaceSize)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_entries[key] = Entry{ algo, workspaceSize };
+    if (s_cacheFile.empty())
+        return;
+
+    // a single write of the whole line, so that lines of concurrent processes do not interleave
+    std::string line = msra::strfun::strprintf("%d\t%llu\t%s\n", algo, (unsigned long long) workspaceSize, key.c_str());
+    FILE* f = fopenOrDie(s_cacheFile, L"ab");
+    fwrite(line.data(), 1, line.size(), f);
+    fclose(f);
+}
+
+void CuDnnAlgorithmCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_entries.clear();
+    s_cacheFileOffset = 0; // (the entries of the file are read again on the next miss)
+}
+
+}}}
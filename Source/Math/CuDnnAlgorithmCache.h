@@ -0,0 +1,62 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+#ifdef _WIN32
+#ifdef MATH_EXPORTS
+#define MATH_API __declspec(dllexport)
+#else
+#define MATH_API __declspec(dllimport)
+#endif
+#else // no DLLs on Linux
+#define MATH_API
+#endif
+
+// CuDnnAlgorithmCache -- remembers the convolution algorithms found by cudnnFind*()
+// Running cudnnFind*() for forward, backward-data and backward-filter convolution is expensive (it times every algorithm),
+// and CuDnnConvolutionEngine does it for every convolution node and every new minibatch size. The results only depend on
+// the GPU model, the cuDNN version, the element type and the geometry of the convolution, so they are cached under a key
+// made of these (see CuDnnConvolutionEngine), together with the workspace size the algorithm needs. Nodes with the same
+// geometry, e.g. the repeated blocks of a residual network, thus share one search.
+// If a cache file is set, the known entries are loaded from it and new ones are appended, so that later runs start
+// without searching. Several processes can share a file: entries are appended as whole lines, and a process that misses
+// in its cache first reads what other processes have added since.
+class MATH_API CuDnnAlgorithmCache
+{
+public:
+    // load the entries from 'path' (if it exists) and append all new ones to it; an empty path disables the file
+    static void SetCacheFile(const std::wstring& path);
+
+    // returns false if the key has not been searched yet
+    static bool Lookup(const std::string& key, int& algo, size_t& workspaceSize);
+    static void Record(const std::string& key, int algo, size_t workspaceSize);
+
+    static void Clear();
+
+private:
+    struct Entry
+    {
+        int algo;
+        size_t workspaceSize;
+    };
+
+    static void ReadNewEntries(); // (requires s_mutex to be held)
+
+    static std::mutex s_mutex;
+    static std::unordered_map<std::string, Entry> s_entries;
+    static std::wstring s_cacheFile;
+    static uint64_t s_cacheFileOffset; // the part of the file that has been read
+};
+
+}}}
@@ -22,7 +22,7 @@ public:
     CuDnnBatchNormEngine(DEVICEID_TYPE deviceId, const TensorShape& inOutT,
                         bool spatial, ImageLayoutKind imageLayout)
                         : Base(deviceId, inOutT, spatial, imageLayout),
-                        m_cudnn(CuDnn::Instance()),
+                        m_cudnn(CuDnn::Instance(deviceId)),
                         m_inOutCuDnnT(GetInOutTensor(inOutT), CuDnnTensor::GetDataType<ElemType>()),
                         m_scaleBiasCuDnnT(GetScaleBiasTensor(inOutT, spatial), CuDnnTensor::GetDataType<ElemType>()),
                         m_cudnnEpsilon(CUDNN_BN_MIN_EPSILON)
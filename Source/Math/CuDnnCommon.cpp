@@ -6,6 +6,8 @@
 #include "stdafx.h"
 #include "GPUMatrix.h"
 #include "CuDnnCommon.h"
+#include <map>
+#include <mutex>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -17,6 +19,8 @@ template <>
 const float Consts<float>::Zero = 0;
 template <>
 const double Consts<double>::Zero = 0;
+const float Consts<half>::One = 1;
+const float Consts<half>::Zero = 0;
 
 CuDnnTensor::CuDnnTensor()
     : m_tensor(nullptr)
@@ -52,9 +56,9 @@ void CuDnnTensor::Set(const TensorShape& src, cudnnDataType_t dataType)
         dims[dims.size() - 1 - i] = (int)src[i];
         strides[dims.size() - 1 - i] = (int)stridesSrc[i];
     }
-    // Set "minibatch"(aka N) dimension.
+    // Set "minibatch"(aka N) dimension. Samples are dense, whatever the order of their dimensions (see CuDnnConvolutionEngine).
     dims[0] = 1;
-    strides[0] = strides[1] * dims[1];
+    strides[0] = (int)src.GetNumElements();
     CUDNN_CALL(cudnnSetTensorNdDescriptor(m_tensor, dataType, (int)dims.size(), dims.data(), strides.data()));
 }
 
@@ -80,39 +84,56 @@ cudnnDataType_t CuDnnTensor::GetDataType()
         return CUDNN_DATA_FLOAT;
     else if (typeid(ElemType) == typeid(double))
         return CUDNN_DATA_DOUBLE;
+    else if (typeid(ElemType) == typeid(half))
+        return CUDNN_DATA_HALF;
     else
-        InvalidArgument("cuDNN engine currently supports only single and double precision data types.");
+        InvalidArgument("cuDNN engine currently supports only single, double and half precision data types.");
 }
 
 template cudnnDataType_t CuDnnTensor::GetDataType<float>();
 template cudnnDataType_t CuDnnTensor::GetDataType<double>();
+template cudnnDataType_t CuDnnTensor::GetDataType<half>();
 
-CuDnn::ptr_t CuDnn::Instance()
+// the handle for 'deviceId' (or the current device if negative)
+// There is one handle per device, since a handle is bound to the device that is current when it is created.
+CuDnn::ptr_t CuDnn::Instance(DEVICEID_TYPE deviceId)
 {
-    auto createNew = []()
-    {
-        int deviceId;
+    if (deviceId < 0)
         CUDA_CALL(cudaGetDevice(&deviceId));
+
+    auto createNew = [deviceId]()
+    {
         cudaDeviceProp props = {0};
         if (cudaGetDeviceProperties(&props, deviceId) != cudaSuccess || props.major < 3)
             RuntimeError("cuDNN requires device with compute capability 3.0 or higher.");
+        int currentDevice;
+        CUDA_CALL(cudaGetDevice(&currentDevice));
+        PrepareDevice(deviceId);
         cudnnHandle_t* cudnn = new cudnnHandle_t;
         CUDNN_CALL(cudnnCreate(cudnn));
         CUDNN_CALL(cudnnSetStream(*cudnn, GetStream()));
+        PrepareDevice(currentDevice);
         return cudnn;
     };
 
-    static std::shared_ptr<cudnnHandle_t> m_instance = std::shared_ptr<cudnnHandle_t>(createNew(), [](cudnnHandle_t* src)
+    static std::mutex s_mutex;
+    static std::map<DEVICEID_TYPE, ptr_t> s_instances;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto& instance = s_instances[deviceId];
+    if (!instance)
     {
-        assert(*src != nullptr);
-        auto err = cudnnDestroy(*src);
-        assert(err == CUDNN_STATUS_SUCCESS);
+        instance = std::shared_ptr<cudnnHandle_t>(createNew(), [](cudnnHandle_t* src)
+        {
+            assert(*src != nullptr);
+            auto err = cudnnDestroy(*src);
+            assert(err == CUDNN_STATUS_SUCCESS);
 #ifdef NDEBUG
-        UNUSED(err);
+            UNUSED(err);
 #endif
-        delete src;
-    });
-    return m_instance;
+            delete src;
+        });
+    }
+    return instance;
 }
 
 } } }
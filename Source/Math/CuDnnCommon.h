@@ -7,6 +7,7 @@
 
 #include "Basics.h"
 #include "TensorShape.h"
+#include "CommonMatrix.h"
 #include <cudnn.h>
 #if CUDNN_MAJOR < 5
 #error CNTK requires the NVIDIA cuDNN library 5.0 or higher to build, cf. https://docs.microsoft.com/en-us/cognitive-toolkit/Setup-CNTK-on-Windows#cudnn or https://docs.microsoft.com/en-us/cognitive-toolkit/Setup-CNTK-on-Linux#cudnn for installation instructions.
@@ -39,7 +40,7 @@ private:
 struct CuDnn final
 {
     using ptr_t = std::shared_ptr<cudnnHandle_t>;
-    static ptr_t Instance();
+    static ptr_t Instance(DEVICEID_TYPE deviceId = -1);
 
     DISABLE_COPY_AND_MOVE(CuDnn);
 };
@@ -51,4 +52,12 @@ struct Consts
     static const ElemType One;
 };
 
+// cuDNN expects the alpha/beta scaling factors in single precision for half-precision tensors
+template <>
+struct Consts<half>
+{
+    static const float Zero;
+    static const float One;
+};
+
 } } }
@@ -10,6 +10,7 @@
 #include <typeinfo>
 #include <typeindex>
 #include "CuDnnCommon.h"
+#include "CuDnnAlgorithmCache.h"
 
 template <>
 const char* CudaErrString<cudnnStatus_t>(cudnnStatus_t x)
@@ -20,6 +21,8 @@ const char* CudaErrString<cudnnStatus_t>(cudnnStatus_t x)
 // A note on the formats: CNTK originally used NHWC for input/output tensors and CHWN for kernels.
 // Such formats have very limited support in cuDNN and not used in other frameworks.
 // CNTK with cuDNN by default uses NCHW formats for both inputs/outputs and kernels.
+// With ImageLayoutKind::HWC the inputs/outputs are NHWC, which is described to cuDNN by the strides of the tensors;
+// the kernels are still NCHW (the HWC engine in ConvolutionEngine.cpp transposes them from the legacy layout).
 #define TENSOR_FORMAT CUDNN_TENSOR_NCHW
 #define FILTER_FORMAT CUDNN_TENSOR_NCHW
 
@@ -50,8 +53,8 @@ public:
         SmallVector<int> dims(dim_size, 1);
         for (int i = 0; i < filt_size -1; i++)
             dims[dim_size - 1 - i] = (int)filt[i];
-        // Set map count(aka K) dimension.
-        dims[0] = (int)mapCount;
+        // Set map count(aka K) dimension, which for grouped convolutions are the maps of all groups.
+        dims[0] = (int)(mapCount * geometry.Groups());
         dims[1] = (int)filt[filt_size - 1];
         CUDNN_CALL(cudnnSetFilterNdDescriptor(m_kernel, dataType, FILTER_FORMAT, (int)dim_size, dims.data()));
     }
@@ -101,6 +104,10 @@ public:
         CUDNN_CALL(cudnnSetConvolutionNdDescriptor(m_conv, (int)dim_size, pad.data(),
                                                    stride.data(), upscale.data(),
                                                    CUDNN_CROSS_CORRELATION, dataType));
+#if CUDNN_MAJOR >= 7
+        if (geometry.Groups() > 1)
+            CUDNN_CALL(cudnnSetConvolutionGroupCount(m_conv, (int)geometry.Groups()));
+#endif
     }
 
     ~CuDnnConv()
@@ -198,7 +205,7 @@ public:
     CuDnnConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout,
                            size_t maxTempMemSizeInSamples, PoolKind poolKind, bool forceDeterministicAlgorithms, bool poolIncludePad)
         : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, poolIncludePad),
-          m_cudnn(CuDnn::Instance()),
+          m_cudnn(CuDnn::Instance(deviceId)),
           m_dataType(CuDnnTensor::GetDataType<ElemType>()),
           m_forceDeterministicAlgorithms(forceDeterministicAlgorithms)
     {
@@ -217,12 +224,31 @@ public:
         }
         inputDims[0] = inShape[0]; 
         outputDims[0] = outShape[0]; 
-        m_inT.Set(TensorShape(inputDims), m_dataType);
-        m_outT.Set(TensorShape(outputDims), m_dataType);
+        if (imageLayout == ImageLayoutKind::HWC)
+        {
+            m_inT.Set(ChannelsInnermost(TensorShape(inputDims)), m_dataType);
+            m_outT.Set(ChannelsInnermost(TensorShape(outputDims)), m_dataType);
+        }
+        else
+        {
+            m_inT.Set(TensorShape(inputDims), m_dataType);
+            m_outT.Set(TensorShape(outputDims), m_dataType);
+        }
     }
 
     virtual bool ImplementsGradientOverwriteOptimization() const override { return true; }
 
+    void SetmMaxTempMemSizeInSamples(const size_t maxTempMemSizeInSamples) override
+    {
+        if (maxTempMemSizeInSamples == m_maxTempMemSizeInSamples)
+            return;
+        Base::SetmMaxTempMemSizeInSamples(maxTempMemSizeInSamples);
+        // the workspaces were sized for the old limit
+        m_fwdAlgo.Invalidate();
+        m_backDataAlgo.Invalidate();
+        m_backFiltAlgo.Invalidate();
+    }
+
 protected:
     using Base::m_geometry;
     using Base::m_deviceId;
@@ -233,8 +259,8 @@ protected:
 
     void EnsureCompatible() override
     {
-        if (m_imageLayout != ImageLayoutKind::CHW)
-            RuntimeError("cuDNN convolution engine supports only CHW/cudnn layout.");
+        if (m_imageLayout != ImageLayoutKind::CHW && (m_imageLayout != ImageLayoutKind::HWC || m_geometry->InputShape().GetRank() != 3))
+            RuntimeError("cuDNN convolution engine supports only CHW/cudnn layout, and HWC layout for 2D convolution.");
         if (!IsGpu(m_deviceId))
             RuntimeError("cuDNN convolution engine supports GPU devices only.");
     }
@@ -294,7 +320,7 @@ protected:
             }
             return err; 
         }; 
-        FindBestAlgo(batchSize, m_fwdAlgo, workspaceSizeFinder, deterministicFinder, finder, staticFinder, workspace);
+        FindBestAlgo("forward", batchSize, m_fwdAlgo, workspaceSizeFinder, deterministicFinder, finder, staticFinder, workspace);
         // Perform forward convolution operation.
         CUDNN_CALL(cudnnConvolutionForward(*m_cudnn, &C::One, m_inT, ptr(in), *m_kernelT, ptr(kernel), *m_conv, m_fwdAlgo.selectedAlgo, ptr(workspace), workspace.BufferSize(), &C::Zero, m_outT, ptr(out)));
     }
@@ -356,7 +382,7 @@ protected:
             }
             return err;
         }; 
-        FindBestAlgo(batchSize, m_backDataAlgo, workspaceSizeFinder, deterministicFinder, finder, staticFinder, workspace);
+        FindBestAlgo("backwardData", batchSize, m_backDataAlgo, workspaceSizeFinder, deterministicFinder, finder, staticFinder, workspace);
         // Compute gradients with respect to the output tensor (data).
         CUDNN_CALL(cudnnConvolutionBackwardData(*m_cudnn, &C::One, *m_kernelT, ptr(kernel), m_outT, ptr(srcGrad), *m_conv, m_backDataAlgo.selectedAlgo, ptr(workspace), workspace.BufferSize(), accumulateGradient ? &C::One : &C::Zero, m_inT, ptr(grad)));
     }
@@ -418,7 +444,7 @@ protected:
             }
             return err;
         }; 
-        FindBestAlgo(batchSize, m_backFiltAlgo, workspaceSizeFinder, deterministicFinder, finder, staticFinder, workspace);
+        FindBestAlgo("backwardFilter", batchSize, m_backFiltAlgo, workspaceSizeFinder, deterministicFinder, finder, staticFinder, workspace);
         // Compute gradients with respect to the output tensor (data).
         CUDNN_CALL(cudnnConvolutionBackwardFilter(*m_cudnn, &C::One, m_inT, ptr(in), m_outT, ptr(srcGrad), *m_conv, m_backFiltAlgo.selectedAlgo, ptr(workspace), workspace.BufferSize(), accumulateGradient ? &C::One : &C::Zero, *m_kernelT, ptr(kernelGrad)));
     }
@@ -460,8 +486,24 @@ private:
 
     static const int MaxAlgoCount = 10;
 
+    // The same dimensions with the channels (the last dimension) stored innermost: [W x H x C] with strides [C, WC, 1].
+    static TensorShape ChannelsInnermost(const TensorShape& shape)
+    {
+        size_t rank = shape.GetRank();
+        SmallVector<size_t> dims(rank);
+        std::vector<size_t> permutation(rank);
+        for (size_t i = 0; i < rank; i++)
+        {
+            dims[i] = shape[(i + rank - 1) % rank];
+            permutation[i] = (i + 1) % rank;
+        }
+        TensorShape result(dims);
+        result.PermuteDimsInPlace(permutation);
+        return result;
+    }
+
     template <typename TAlgo, typename TWorkspaceSizeFinder, typename TDeterministicFinder, typename TFinder, typename TStaticFinder>
-    void FindBestAlgo(size_t batchSize, TAlgo& algo, TWorkspaceSizeFinder workspaceSizeFinder, TDeterministicFinder deterministicFinder, TFinder finder, TStaticFinder staticFinder, Mat& workspace)
+    void FindBestAlgo(const char* direction, size_t batchSize, TAlgo& algo, TWorkspaceSizeFinder workspaceSizeFinder, TDeterministicFinder deterministicFinder, TFinder finder, TStaticFinder staticFinder, Mat& workspace)
     {
         m_inT.UpdateBatchSize(batchSize);
         m_outT.UpdateBatchSize(batchSize);
@@ -524,6 +566,30 @@ private:
             size_t inputSampleSize = m_geometry->InputShape().GetNumElements();
             size_t maxMem = m_maxTempMemSizeInSamples == 0 ? (std::numeric_limits<size_t>::max)() : inputSampleSize * m_maxTempMemSizeInSamples * sizeof(ElemType);
 
+            // reuse the result of an earlier search for the same convolution, by this or another node, or in an earlier run
+            const std::string cacheKey = AlgorithmCacheKey(direction, batchSize);
+            int cachedAlgo;
+            size_t cachedWorkspaceSize;
+            if (CuDnnAlgorithmCache::Lookup(cacheKey, cachedAlgo, cachedWorkspaceSize) && cachedWorkspaceSize <= maxMem)
+            {
+                try
+                {
+                    if (cachedWorkspaceSize > curSize)
+                        workspace.Resize((cachedWorkspaceSize + sizeof(ElemType) - 1) / sizeof(ElemType), 1, 0, false);
+                    algo.MBSizeForCurrentWorkspace = batchSize;
+                    algo.MBSizeForCurrentAlgo = batchSize;
+                    algo.selectedAlgo = (decltype(algo.selectedAlgo)) cachedAlgo;
+                    algo.maxAlgo = algo.selectedAlgo;
+                    algo.autotuningState = AutotuningState::Running;
+                    algo.AlgoWorkspaceSize = cachedWorkspaceSize;
+                    return;
+                }
+                catch (...)
+                {   // not enough memory for the workspace of the cached algorithm: search for one that fits
+                    fprintf(stderr, "Cannot allocate the workspace of the cached algorithm, searching again for convolution\n");
+                }
+            }
+
             try
             {   // first try allocate as much to run FindEX, this may fail when accumulate is on (in which case additional memory is allocated in finder()), thus we do try...catch...
                 size_t free, total, resizeTo = 0;
@@ -549,6 +615,7 @@ private:
                 algo.maxAlgo = algo.selectedAlgo;
                 algo.autotuningState = AutotuningState::Running;
                 algo.AlgoWorkspaceSize = (*res).memory;
+                CuDnnAlgorithmCache::Record(cacheKey, (int) algo.selectedAlgo, algo.AlgoWorkspaceSize);
                 if (algo.AlgoWorkspaceSize < curSize)   // need to shrink the workspace
                     workspace.Resize((curSize + sizeof(ElemType) - 1) / sizeof(ElemType), 1, 0, false);
                 else
@@ -569,6 +636,7 @@ private:
                     algo.maxAlgo = algo.selectedAlgo;
                     algo.autotuningState = AutotuningState::Running;
                     algo.AlgoWorkspaceSize = (*res).memory;
+                    CuDnnAlgorithmCache::Record(cacheKey, (int) algo.selectedAlgo, algo.AlgoWorkspaceSize);
                 } 
                 catch (...) 
                 {   // fails again, let's fall back to cudnnGet
@@ -596,6 +664,15 @@ private:
         return;
     }
 
+    // key of the algorithms found for this convolution in CuDnnAlgorithmCache
+    std::string AlgorithmCacheKey(const char* direction, size_t batchSize) const
+    {
+        cudaDeviceProp props = {0};
+        CUDA_CALL(cudaGetDeviceProperties(&props, m_deviceId));
+        return msra::strfun::strprintf("%s|cuDNN %d|%s|%d bytes|batch %d|", props.name, (int) cudnnGetVersion(), direction, (int) sizeof(ElemType), (int) batchSize) +
+               (std::string) *m_geometry;
+    }
+
     static ElemType* ptr(Mat& src)
     {
         return src.Data();
@@ -635,6 +712,16 @@ private:
             // Should remain reasonable performance when minibatch size changes frequently (e.g. distributed reading).
             return (autotuningState != AutotuningState::Running || batchSize != MBSizeForCurrentAlgo);
         }
+
+        // make the next call to FindBestAlgo() release the workspace and tune from scratch, as for a larger batch size
+        void Invalidate()
+        {
+            if (autotuningState == AutotuningState::Init)
+                return;
+            autotuningState = AutotuningState::Running;
+            MBSizeForCurrentAlgo = 0;
+            maxMBSizeSeen = 0;
+        }
     };
 
     CuDnn::ptr_t m_cudnn;
@@ -685,8 +772,15 @@ bool CuDnnConvolutionEngineFactory<ElemType>::IsSupported(DEVICEID_TYPE deviceId
     // cuDNN supports 2D and 3D convolutions at the moment with full sharing.
     // In case map count size > 1, then it should have all ones except last dimension.
     // If pooling is requested, then cuDNN supports only 2D/3D inputs and 2D pooling kernels.
+    // Grouped convolutions (see ConvolveGeometry::Groups()) are supported as of cuDNN 7 if there is one output map
+    // per group, as otherwise cuDNN orders the output maps by group (k = g * M + m) rather than k = g + G * m.
+#if CUDNN_MAJOR >= 7
+    bool grouped = poolKind == PoolKind::None && geometry->Groups() > 1 && geometry->GetMapCount(inputRank - 1) == 1;
+#else
+    bool grouped = false;
+#endif
     bool retVal = (inputRank <= 4 &&
-                   std::find(begin(sharing), end(sharing), false) == sharing.end() &&
+                   (std::find(begin(sharing), end(sharing), false) == sharing.end() || grouped) &&
                    mapCount.GetNumElements() == mapCount[mapRank - 1] &&
                    (poolKind == PoolKind::None ||
                    inputRank <= 3 && (kernelRank < 3 || kernel[2] == 1)));
@@ -8,8 +8,10 @@
 #include "GPUMatrix.h"
 #include "TensorShape.h"
 #include "TensorView.h"
+#include <algorithm>
 #include <typeinfo>
 #include <typeindex>
+#include <type_traits>
 #include "CuDnnCommon.h"
 #include "CuDnnRNN.h"
 
@@ -66,7 +68,8 @@ void CuDnnRNNExecutor<ElemType>::ForwardCore(
     const GPUMatrix<ElemType>& inputX, GPUMatrix<ElemType>& outputY,
     const vector<size_t>& numSequencesForFrame,
     const RnnAttributes& rnnAttributes,
-    GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace
+    GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace,
+    bool inferenceOnly
     )
 {
     // test that the RNN shape is correct
@@ -80,8 +83,37 @@ void CuDnnRNNExecutor<ElemType>::ForwardCore(
     SetDescriptors(m_xDim, numSequencesForFrame, xDesc);
     SetDescriptors(m_yDim, numSequencesForFrame, yDesc);
 
-    // ensure workspace and reserve are large enough
     m_seqLength = numSequencesForFrame.size();
+
+    wDesc = make_unique<CuDnnFilter<ElemType>>(*m_rnnT, xDesc[0]);
+    if (wDesc->GetSize() != weightsW.GetNumElements())
+        InvalidArgument("RNN needs %ld parameters, but %ld were allocated", wDesc->GetSize(), weightsW.GetNumElements());
+
+    m_forwardInferenceOnly = inferenceOnly;
+    m_BackwardDataCalledYet = false;
+
+    if (inferenceOnly)
+    {
+        // Without a backward pass there is no reserve space; only the workspace is needed.
+        if (UsePersistentKernels(numSequencesForFrame))
+        {
+            if (!m_persistentRnnT)
+                m_persistentRnnT = std::make_unique<CuDnnRNN<ElemType>>(rnnAttributes, /*persistent=*/true);
+            cudnnStatus_t status = ForwardInference(*m_persistentRnnT, weightsW, inputX, outputY, workspace);
+            if (status != CUDNN_STATUS_NOT_SUPPORTED)
+            {
+                CUDNN_CALL(status);
+                return;
+            }
+            // the limits of the persistent kernels depend on the GPU and the cell type; use the standard algorithm from now on
+            m_persistentSupported = false;
+            m_persistentRnnT.reset();
+        }
+        CUDNN_CALL(ForwardInference(*m_rnnT, weightsW, inputX, outputY, workspace));
+        return;
+    }
+
+    // ensure workspace and reserve are large enough
     size_t workSize;
     size_t reserveSize;
 
@@ -97,10 +129,6 @@ void CuDnnRNNExecutor<ElemType>::ForwardCore(
     reserve.Resize(reserveSize, 1);
     workspace.Resize(workSize, 1);
 
-    wDesc = make_unique<CuDnnFilter<ElemType>>(*m_rnnT, xDesc[0]);
-    if (wDesc->GetSize() != weightsW.GetNumElements())
-        InvalidArgument("RNN needs %ld parameters, but %ld were allocated", wDesc->GetSize(), weightsW.GetNumElements());
-
     CUDNN_CALL(cudnnRNNForwardTraining(
         *m_cudnn, *m_rnnT,
         (int)m_seqLength,
@@ -113,7 +141,58 @@ void CuDnnRNNExecutor<ElemType>::ForwardCore(
         0, 0,
         workspace.Data(), workspace.GetNumElements()*sizeof(ElemType),
         reserve.Data(), reserve.GetNumElements()*sizeof(ElemType)));
-    m_BackwardDataCalledYet = false;
+}
+
+// the forward pass without reserve space, with the standard or the persistent algorithm
+// The status is returned rather than checked, so that ForwardCore() can fall back from the persistent kernels.
+template <class ElemType>
+cudnnStatus_t CuDnnRNNExecutor<ElemType>::ForwardInference(const CuDnnRNN<ElemType>& rnn,
+    const GPUMatrix<ElemType>& weightsW, const GPUMatrix<ElemType>& inputX, GPUMatrix<ElemType>& outputY, GPUMatrix<ElemType>& workspace)
+{
+    size_t workSize;
+    cudnnStatus_t status = cudnnGetRNNWorkspaceSize(*m_cudnn, rnn, (int)m_seqLength, xDesc.data(), &workSize);
+    if (status != CUDNN_STATUS_SUCCESS)
+        return status;
+    workspace.Resize((workSize + sizeof(ElemType) - 1) / sizeof(ElemType), 1);
+
+    return cudnnRNNForwardInference(
+        *m_cudnn, rnn,
+        (int)m_seqLength,
+        xDesc.data(), inputX.Data(),
+        0, 0,
+        0, 0,
+        *wDesc, weightsW.Data(),
+        yDesc.data(), outputY.Data(),
+        0, 0,
+        0, 0,
+        workspace.Data(), workspace.GetNumElements()*sizeof(ElemType));
+}
+
+// The persistent kernels need cuDNN 6 and a GPU of compute capability 6.0 or higher, and are used for single precision only.
+template <class ElemType>
+bool CuDnnRNNExecutor<ElemType>::PersistentKernelsSupported()
+{
+#if CUDNN_MAJOR >= 6
+    if (!std::is_same<ElemType, float>::value)
+        return false;
+    int deviceId;
+    cudaDeviceProp props = {0};
+    return cudaGetDevice(&deviceId) == cudaSuccess && cudaGetDeviceProperties(&props, deviceId) == cudaSuccess && props.major >= 6;
+#else
+    return false;
+#endif
+}
+
+// The persistent kernels pay off where the launches of the standard algorithm dominate, i.e. for few sequences, and
+// need the recurrent weights of a layer to fit on chip, which bounds the hidden size.
+template <class ElemType>
+bool CuDnnRNNExecutor<ElemType>::UsePersistentKernels(const vector<size_t>& numSequencesForFrame) const
+{
+    const size_t maxNumSequences = 32;
+    const size_t maxHiddenSize = 1024;
+    if (!m_persistentSupported || numSequencesForFrame.empty() || m_rnnT->GetNumHidden() > maxHiddenSize)
+        return false;
+    return *max_element(numSequencesForFrame.begin(), numSequencesForFrame.end()) <= maxNumSequences;
 }
 
 template <class ElemType>
@@ -127,6 +206,9 @@ void CuDnnRNNExecutor<ElemType>::BackwardDataCore(
     if (!m_rnnT->IsCompatible(rnnAttributes))
         LogicError("RNN Layout has changed during processing");
 
+    if (m_forwardInferenceOnly)
+        LogicError("RNN BackwardData called after a forward pass in inference mode");
+
     if (!m_BackwardDataCalledYet)
     {
         CUDNN_CALL(cudnnRNNBackwardData(
@@ -74,11 +74,26 @@ private:
     }
 
 public:
-    CuDnnRNN(const RnnAttributes& rnnAttributes)
+    // 'persistent' selects the persistent kernels of cuDNN 6 and higher (CUDNN_RNN_ALGO_PERSIST_STATIC), which keep the
+    // recurrent weights on chip for all time steps. The parameter layout does not depend on the algorithm.
+    CuDnnRNN(const RnnAttributes& rnnAttributes, bool persistent = false)
         : m_rnnDesc(nullptr), m_dropout(0.0f), m_rnnAttributes(rnnAttributes),
         m_dataType(CuDnnTensor::GetDataType<ElemType>())
     {
         CUDNN_CALL(cudnnCreateRNNDescriptor(&m_rnnDesc));
+#if CUDNN_MAJOR >= 6
+        CUDNN_CALL(cudnnSetRNNDescriptor_v6(*CuDnn::Instance(), m_rnnDesc,
+            (int)m_rnnAttributes.m_hiddenSize,
+            (int)m_rnnAttributes.m_numLayers,
+            m_dropout,
+            CUDNN_LINEAR_INPUT, // We can also skip the input matrix transformation
+            m_rnnAttributes.m_bidirectional ? CUDNN_BIDIRECTIONAL : CUDNN_UNIDIRECTIONAL,
+            GetMode(),
+            persistent ? CUDNN_RNN_ALGO_PERSIST_STATIC : CUDNN_RNN_ALGO_STANDARD,
+            m_dataType));
+#else
+        if (persistent)
+            LogicError("Persistent RNN kernels require cuDNN 6 or higher.");
         CUDNN_CALL(cudnnSetRNNDescriptor(m_rnnDesc,
             (int)m_rnnAttributes.m_hiddenSize,
             (int)m_rnnAttributes.m_numLayers,
@@ -87,6 +102,7 @@ public:
             m_rnnAttributes.m_bidirectional ? CUDNN_BIDIRECTIONAL : CUDNN_UNIDIRECTIONAL,
             GetMode(),
             m_dataType));
+#endif
     }
 
     ~CuDnnRNN()
@@ -111,7 +127,7 @@ public:
     bool isBidirectional() const { return m_rnnAttributes.m_bidirectional; }
 
     size_t GetNumLayers() { return m_rnnAttributes.m_numLayers; }
-    size_t GetNumHidden() { return m_rnnAttributes.m_hiddenSize; }
+    size_t GetNumHidden() const { return m_rnnAttributes.m_hiddenSize; }
 
     DISABLE_COPY_AND_MOVE(CuDnnRNN);
 };
@@ -188,12 +204,16 @@ public:
         m_xDim(xDim), m_yDim(yDim),
         m_seqLength(0),
         m_dataType(CuDnnTensor::GetDataType<ElemType>()),
-        m_BackwardDataCalledYet(false)
+        m_BackwardDataCalledYet(false),
+        m_forwardInferenceOnly(false),
+        m_persistentSupported(PersistentKernelsSupported())
     {
         m_rnnT = std::make_unique<CuDnnRNN<ElemType>>(rnnAttributes);
     }
 
-    void ForwardCore(const GPUMatrix<ElemType>& weightsW, const GPUMatrix<ElemType>& inputX, GPUMatrix<ElemType>& outputY, const vector<size_t>& numSequencesForFrame, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
+    // With 'inferenceOnly', the forward pass runs cudnnRNNForwardInference(), which needs no reserve space, and the
+    // backward functions must not be called until the next forward pass in training mode.
+    void ForwardCore(const GPUMatrix<ElemType>& weightsW, const GPUMatrix<ElemType>& inputX, GPUMatrix<ElemType>& outputY, const vector<size_t>& numSequencesForFrame, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace, bool inferenceOnly);
     void BackwardWeightsCore(const GPUMatrix<ElemType>& inputX, const GPUMatrix<ElemType>& outputY, GPUMatrix<ElemType>& dw, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
     void BackwardDataCore(const GPUMatrix<ElemType>& outputY, const GPUMatrix<ElemType>& outputDY, const GPUMatrix<ElemType>& w, GPUMatrix<ElemType>& dx, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
 
@@ -214,9 +234,16 @@ private:
 
     void SetDescriptors(size_t dim, const vector<size_t>& numSequencesForFrame, vector<cudnnTensorDescriptor_t>& descriptors);
 
+    cudnnStatus_t ForwardInference(const CuDnnRNN<ElemType>& rnn, const GPUMatrix<ElemType>& weightsW, const GPUMatrix<ElemType>& inputX, GPUMatrix<ElemType>& outputY, GPUMatrix<ElemType>& workspace);
+    static bool PersistentKernelsSupported();
+    bool UsePersistentKernels(const vector<size_t>& numSequencesForFrame) const;
+
 private:
     std::unique_ptr<CuDnnRNN<ElemType>> m_rnnT;
+    std::unique_ptr<CuDnnRNN<ElemType>> m_persistentRnnT; // created on the first inference pass that qualifies, see UsePersistentKernels()
     bool m_BackwardDataCalledYet;
+    bool m_forwardInferenceOnly;
+    bool m_persistentSupported; // cleared when cuDNN rejects the persistent kernels for this RNN
     size_t m_seqLength;
 };
 
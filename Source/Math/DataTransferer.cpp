@@ -14,4 +14,9 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         return std::make_shared<PrefetchGPUDataTransferer>(deviceId);
     }
 
+    DataTransfererPtr CreateOffloadDataTransferer(int deviceId)
+    {
+        return std::make_shared<OffloadGPUDataTransferer>(deviceId);
+    }
+
 } } }
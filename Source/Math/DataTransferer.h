@@ -59,10 +59,26 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         // Synchronizes CPU to GPU stream with recorded comput sync event.
         virtual void WaitForSyncPointOnAssignStreamAsync() = 0;
 
+        // Synchronizes the compute stream with the event recorded by RecordGPUToCPUCopy(), without blocking the CPU.
+        virtual void WaitForCopyGPUToCPUOnComputeStreamAsync() = 0;
+
+        // Synchronizes the compute stream with the event recorded by RecordCPUToGPUCopy(), without blocking the CPU.
+        virtual void WaitForCopyCPUToGPUOnComputeStreamAsync() = 0;
+
+        // The time in microseconds that the compute stream waited at the last WaitForCopyCPUToGPUOnComputeStreamAsync(), i.e. the
+        // part of the CPU to GPU copies that was not hidden behind the computation, and the total time of these copies.
+        // Waits until the compute stream has passed that point. Returns false if there is nothing (new) to report.
+        virtual bool GetExposedCopyCPUToGPUTime(long long& /*exposedMicroseconds*/, long long& /*totalMicroseconds*/) { return false; }
+
         virtual ~DataTransferer() {}
     };
 
     typedef std::shared_ptr<DataTransferer> DataTransfererPtr;
 
     MATH_API DataTransfererPtr CreatePrefetchDataTransferer(int deviceId);
+
+    // A transferer whose copies in either direction run on streams of their own, so that they overlap with the computation
+    // and with each other, e.g. to offload node values to host memory during training. The streams are shared by all
+    // such transferers of a device, the events are not.
+    MATH_API DataTransfererPtr CreateOffloadDataTransferer(int deviceId);
 }}}
@@ -2,6 +2,8 @@
 #include "Basics.h"
 #include "GPUDataTransferer.h"
 #include "GPUMatrix.h"
+#include <map>
+#include <mutex>
 
 #pragma comment(lib, "cudart.lib")
 
@@ -131,6 +133,18 @@ void GranularGPUDataTransferer::WaitForSyncPointOnAssignStreamAsync()
     cudaStreamWaitEvent(GetAssignStream(), m_syncEvent, 0 /*flags 'must be 0'*/) || "cudaStreamWaitEvent failed";
 }
 
+void GranularGPUDataTransferer::WaitForCopyGPUToCPUOnComputeStreamAsync()
+{
+    PrepareDevice(m_deviceId);
+    cudaStreamWaitEvent(GetStream(), m_fetchCompleteEvent, 0 /*flags 'must be 0'*/) || "cudaStreamWaitEvent failed";
+}
+
+void GranularGPUDataTransferer::WaitForCopyCPUToGPUOnComputeStreamAsync()
+{
+    PrepareDevice(m_deviceId);
+    cudaStreamWaitEvent(GetStream(), m_assignCompleteEvent, 0 /*flags 'must be 0'*/) || "cudaStreamWaitEvent failed";
+}
+
 //// GPUDataTransferer
 
 // same but for event
@@ -200,9 +214,49 @@ void GPUDataTransferer::WaitForCopyCPUToGPUAsync()
 
 /// PrefetchGPUDataTransferer
 
-PrefetchGPUDataTransferer::PrefetchGPUDataTransferer(int deviceId) : GranularGPUDataTransferer(deviceId, nullptr, nullptr, true)
+PrefetchGPUDataTransferer::PrefetchGPUDataTransferer(int deviceId)
+    : GranularGPUDataTransferer(deviceId, nullptr, nullptr, true), m_hasTiming(false)
 {
      cudaStreamCreateWithFlags(&m_stream, cudaStreamNonBlocking) || "cudaStreamCreateWithFlags failed (PrefetchGPUDataTransferer ctor)";
+     for (auto ev : { &m_copyBeginEvent, &m_copyEndEvent, &m_waitBeginEvent, &m_waitEndEvent })
+         cudaEventCreate(ev) || "cudaEventCreate failed (PrefetchGPUDataTransferer ctor)";
+}
+
+void PrefetchGPUDataTransferer::WaitForSyncPointOnAssignStreamAsync()
+{
+    GranularGPUDataTransferer::WaitForSyncPointOnAssignStreamAsync();
+    cudaEventRecord(m_copyBeginEvent, GetAssignStream()) || "cudaEventRecord failed";
+}
+
+void PrefetchGPUDataTransferer::RecordCPUToGPUCopy()
+{
+    GranularGPUDataTransferer::RecordCPUToGPUCopy();
+    cudaEventRecord(m_copyEndEvent, GetAssignStream()) || "cudaEventRecord failed";
+}
+
+void PrefetchGPUDataTransferer::WaitForCopyCPUToGPUOnComputeStreamAsync()
+{
+    PrepareDevice(m_deviceId);
+    cudaEventRecord(m_waitBeginEvent, GetStream()) || "cudaEventRecord failed";
+    GranularGPUDataTransferer::WaitForCopyCPUToGPUOnComputeStreamAsync();
+    cudaEventRecord(m_waitEndEvent, GetStream()) || "cudaEventRecord failed";
+    m_hasTiming = true;
+}
+
+bool PrefetchGPUDataTransferer::GetExposedCopyCPUToGPUTime(long long& exposedMicroseconds, long long& totalMicroseconds)
+{
+    if (!m_hasTiming)
+        return false;
+    m_hasTiming = false;
+
+    PrepareDevice(m_deviceId);
+    cudaEventSynchronize(m_waitEndEvent) || "cudaEventSynchronize failed";
+    float exposedMs, totalMs;
+    cudaEventElapsedTime(&exposedMs, m_waitBeginEvent, m_waitEndEvent) || "cudaEventElapsedTime failed";
+    cudaEventElapsedTime(&totalMs, m_copyBeginEvent, m_copyEndEvent) || "cudaEventElapsedTime failed";
+    exposedMicroseconds = (long long)(exposedMs * 1000);
+    totalMicroseconds = (long long)(totalMs * 1000);
+    return true;
 }
 
 PrefetchGPUDataTransferer::~PrefetchGPUDataTransferer()
@@ -217,6 +271,8 @@ PrefetchGPUDataTransferer::~PrefetchGPUDataTransferer()
         return;
     }
 
+    for (auto ev : { m_copyBeginEvent, m_copyEndEvent, m_waitBeginEvent, m_waitEndEvent })
+        cudaEventDestroy(ev);
     auto code = cudaStreamDestroy(m_stream);
     if (code != cudaSuccess)
     {
@@ -225,4 +281,29 @@ PrefetchGPUDataTransferer::~PrefetchGPUDataTransferer()
     }
 }
 
+/// OffloadGPUDataTransferer
+
+OffloadGPUDataTransferer::OffloadGPUDataTransferer(int deviceId)
+    : GranularGPUDataTransferer(deviceId, nullptr, nullptr, true), m_streams(GetStreams(deviceId))
+{
+}
+
+/*static*/ const OffloadGPUDataTransferer::Streams& OffloadGPUDataTransferer::GetStreams(int deviceId)
+{
+    // BUGBUG: like the streams of GPUDataTransferer, these are never destroyed
+    static std::map<int, Streams> s_streams;
+    static std::mutex s_mutex;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto iter = s_streams.find(deviceId);
+    if (iter == s_streams.end())
+    {
+        PrepareDevice(deviceId);
+        Streams streams;
+        cudaStreamCreateWithFlags(&streams.fetchStream, cudaStreamNonBlocking) || "cudaStreamCreateWithFlags failed (OffloadGPUDataTransferer)";
+        cudaStreamCreateWithFlags(&streams.assignStream, cudaStreamNonBlocking) || "cudaStreamCreateWithFlags failed (OffloadGPUDataTransferer)";
+        iter = s_streams.insert(std::make_pair(deviceId, streams)).first;
+    }
+    return iter->second;
+}
+
 }}}
@@ -46,6 +46,9 @@ public:
     void WaitForSyncPointOnFetchStreamAsync() override;
     void WaitForSyncPointOnAssignStreamAsync() override;
 
+    void WaitForCopyGPUToCPUOnComputeStreamAsync() override;
+    void WaitForCopyCPUToGPUOnComputeStreamAsync() override;
+
 #ifndef CPUONLY
 private:
     // Not owned by this class, are always injected.
@@ -129,16 +132,30 @@ private:
 #endif // !CPUONLY
 };
 
+// The copies of the input prefetching run on a stream of their own. The transferer also times them and the wait of the compute
+// stream for them (see GetExposedCopyCPUToGPUTime()).
 class PrefetchGPUDataTransferer : public GranularGPUDataTransferer
 {
 public:
     PrefetchGPUDataTransferer(int deviceId);
     ~PrefetchGPUDataTransferer();
 
+    void WaitForSyncPointOnAssignStreamAsync() override;
+    void RecordCPUToGPUCopy() override;
+    void WaitForCopyCPUToGPUOnComputeStreamAsync() override;
+    bool GetExposedCopyCPUToGPUTime(long long& exposedMicroseconds, long long& totalMicroseconds) override;
+
 private:
 #ifndef CPUONLY
     cudaStream_t m_stream;
 
+    // timing events: the copies are between the first two, the compute stream waits for them between the others
+    cudaEvent_t m_copyBeginEvent;
+    cudaEvent_t m_copyEndEvent;
+    cudaEvent_t m_waitBeginEvent;
+    cudaEvent_t m_waitEndEvent;
+    bool m_hasTiming;
+
     virtual const cudaStream_t& GetAssignStream() const override
     {
         return m_stream;
@@ -148,4 +165,35 @@ private:
     DISABLE_COPY_AND_MOVE(PrefetchGPUDataTransferer);
 };
 
+// see CreateOffloadDataTransferer()
+class OffloadGPUDataTransferer : public GranularGPUDataTransferer
+{
+public:
+    OffloadGPUDataTransferer(int deviceId);
+
+private:
+#ifndef CPUONLY
+    struct Streams
+    {
+        cudaStream_t fetchStream;
+        cudaStream_t assignStream;
+    };
+    static const Streams& GetStreams(int deviceId);
+
+    const Streams& m_streams;
+
+    virtual const cudaStream_t& GetAssignStream() const override
+    {
+        return m_streams.assignStream;
+    }
+
+    virtual const cudaStream_t& GetFetchStream() const override
+    {
+        return m_streams.fetchStream;
+    }
+#endif
+
+    DISABLE_COPY_AND_MOVE(OffloadGPUDataTransferer);
+};
+
 }}}
\ No newline at end of file
@@ -14,6 +14,8 @@
 //#include "GPUSparseMatrix.h"
 #include "GPUTensor.h"
 #include "CommonMatrix.h"
+#include "CUDACachingMemAllocator.h"
+#include "GPUMemoryTimeline.h"
 #define TENSOR_OPS_DECL __device__ __host__
 #include "TensorOps.h"
 #include "device_launch_parameters.h"
@@ -24,6 +26,7 @@
 #include "cublas_v2.h"
 #include <assert.h>
 #include <memory>
+#include <mutex>
 #include "CntkBatchNormalization.cuh"
 #include "Convolution.cuh"
 #include "CuDnnRNN.h"
@@ -206,11 +209,20 @@ AllocatedElemType* TracingGPUMemoryAllocator::Allocate(int deviceId, size_t numE
 template <typename AllocatedElemType>
 void TracingGPUMemoryAllocator::Free(int deviceId, AllocatedElemType* bufferPtr, bool ignoreCUDARetCode /*= false*/)
 {
-    PrepareDevice(deviceId);
-    if (ignoreCUDARetCode)
-        cudaFree((void*) bufferPtr);
+    GPUMemoryTimeline::OnFree(deviceId, bufferPtr);
+
+    // buffers from the caching allocator go back to its cache (this also works if caching was disabled in the meantime)
+    auto cachingAllocator = CUDACachingMemAllocator::TryGetInstance(deviceId);
+    if (cachingAllocator && cachingAllocator->Owns((void*) bufferPtr))
+        cachingAllocator->Free((void*) bufferPtr);
     else
-        CUDA_CALL(cudaFree((void*) bufferPtr));
+    {
+        PrepareDevice(deviceId);
+        if (ignoreCUDARetCode)
+            cudaFree((void*) bufferPtr);
+        else
+            CUDA_CALL(cudaFree((void*) bufferPtr));
+    }
 
     if (IsTraceEnabled())
     {
@@ -230,7 +242,29 @@ AllocatedElemType* TracingGPUMemoryAllocator::AllocateNoTrace(int deviceId, size
     // In case numElements is odd we allocate a buffer with one more element. The reason is 
     // we might call curandGenerateNormal (e.g. for Gaussian noise injection) which would fail
     // if the number of elements it needs to generate is odd.
-    CUDA_CALL(cudaMalloc((void**) &deviceBufferPtr, sizeof(AllocatedElemType) * AsMultipleOf(numElements, 2)));
+    size_t numBytes = sizeof(AllocatedElemType) * AsMultipleOf(numElements, 2);
+    try
+    {
+        if (CUDACachingMemAllocator::IsEnabled())
+            deviceBufferPtr = (AllocatedElemType*) CUDACachingMemAllocator::GetInstance(deviceId).Malloc(numBytes);
+        else
+        {
+            cudaError_t rc = cudaMalloc((void**) &deviceBufferPtr, numBytes);
+            if (rc == cudaErrorMemoryAllocation)
+            {
+                cudaGetLastError(); // (clear the error, so that the next CUDA call does not report it)
+                ThrowFormatted<DeviceOutOfMemoryError>("TracingGPUMemoryAllocator: Failed to allocate %llu bytes on DeviceId = %d: %s",
+                                                       (unsigned long long)numBytes, deviceId, cudaGetErrorString(rc));
+            }
+            CudaCall(rc, "cudaMalloc((void**) &deviceBufferPtr, numBytes)", "CUDA", cudaSuccess);
+        }
+    }
+    catch (...)
+    {
+        GPUMemoryTimeline::OnAllocationFailure(deviceId, numBytes);
+        throw;
+    }
+    GPUMemoryTimeline::OnAllocate(deviceId, deviceBufferPtr, numBytes);
 
     return deviceBufferPtr;
 }
@@ -1180,6 +1214,18 @@ void GPUMatrix<ElemType>::SetValue(const GPUMatrix<ElemType>& deepCopyFrom)
     SetValue(deepCopyFrom.GetNumRows(), deepCopyFrom.GetNumCols(), deepCopyFrom.GetComputeDeviceId(), deepCopyFrom.Data(), matrixFlagSetValueOnDevice);
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::SetValueFromPeer(const GPUMatrix<ElemType>& deepCopyFrom)
+{
+    if (deepCopyFrom.GetComputeDeviceId() == GetComputeDeviceId())
+        return SetValue(deepCopyFrom);
+
+    RequireSize(deepCopyFrom.GetNumRows(), deepCopyFrom.GetNumCols());
+    // Without peer access (see ChangeDeviceTo()), the CUDA driver stages the copy through host memory.
+    if (GetNumElements() > 0)
+        CUDA_CALL(cudaMemcpyPeer(Data(), GetComputeDeviceId(), deepCopyFrom.Data(), deepCopyFrom.GetComputeDeviceId(), sizeof(ElemType) * GetNumElements()));
+}
+
 #if 0
 template <class ElemType>
 void GPUMatrix<ElemType>::SetValue(const CPUMatrix<ElemType>& /*deepCopyFrom*/)
@@ -1263,6 +1309,70 @@ void GPUMatrix<ElemType>::SetValue(const size_t numRows, const size_t numCols, i
     SetFormat(matrixFormatDense);
 }
 
+// Large matrices (e.g. the parameters of a model that is being loaded) are read in chunks into two pinned host buffers,
+// and each chunk is uploaded asynchronously while the next one is read from the file. The last upload is still in
+// flight when ReadValues() returns, i.e. while the caller goes on reading the rest of the model.
+// The buffers are shared by all GPU matrices, and kept for the lifetime of the process.
+class PinnedReadStagingBuffers
+{
+    static const size_t s_bufferSize = 8 * 1024 * 1024; // bytes per buffer
+
+    std::mutex m_mutex;
+    char* m_buffers[2];
+    cudaEvent_t m_uploaded[2]; // recorded after the upload from the buffer, on the device of the upload
+    bool m_uploadPending[2];
+    size_t m_next;
+
+public:
+    PinnedReadStagingBuffers()
+        : m_next(0)
+    {
+        for (size_t i = 0; i < 2; i++)
+        {
+            CUDA_CALL(cudaHostAlloc((void**) &m_buffers[i], s_bufferSize, cudaHostAllocPortable));
+            m_uploadPending[i] = false;
+        }
+    }
+
+    template <class ElemType>
+    void Read(File& stream, ElemType* deviceData, size_t numElements)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const size_t chunkSize = s_bufferSize / sizeof(ElemType);
+        for (size_t offset = 0; offset < numElements; offset += chunkSize)
+        {
+            size_t i = m_next;
+            m_next = 1 - m_next;
+            if (m_uploadPending[i]) // wait until the buffer can be reused
+            {
+                CUDA_CALL(cudaEventSynchronize(m_uploaded[i]));
+                CUDA_CALL(cudaEventDestroy(m_uploaded[i]));
+                m_uploadPending[i] = false;
+            }
+
+            ElemType* buffer = (ElemType*) m_buffers[i];
+            size_t n = min(chunkSize, numElements - offset);
+            stream.ReadArray(buffer, n);
+            CUDA_CALL(cudaMemcpyAsync(deviceData + offset, buffer, n * sizeof(ElemType), cudaMemcpyHostToDevice, t_stream));
+            // (events can only be recorded on the device they were created on, hence one per upload)
+            CUDA_CALL(cudaEventCreateWithFlags(&m_uploaded[i], cudaEventDisableTiming));
+            CUDA_CALL(cudaEventRecord(m_uploaded[i], t_stream));
+            m_uploadPending[i] = true;
+        }
+    }
+};
+
+template <class ElemType>
+void GPUMatrix<ElemType>::ReadValues(File& stream, const size_t numRows, const size_t numCols)
+{
+    static PinnedReadStagingBuffers* stagingBuffers = new PinnedReadStagingBuffers(); // (never freed, see above)
+
+    RequireSize(numRows, numCols);
+    PrepareDevice();
+    stagingBuffers->Read(stream, Data(), GetNumElements());
+    SetFormat(matrixFormatDense);
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::SetDiagonalValue(const ElemType v)
 {
@@ -1442,6 +1552,17 @@ void GPUMatrix<ElemType>::SetTruncatedNormalRandomValue(const ElemType mean, con
     }
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::SetCounterBasedRandomValue(RandomDistribution distribution, const ElemType a, const ElemType b, unsigned long seed, uint64_t offset)
+{
+    // no generator state: each element is computed from the seed and offset plus its index (see CounterBasedRandom.h)
+    PrepareDevice();
+    const uint64_t key = seed == USE_TIME_BASED_SEED ? (uint64_t)time(NULL) : (uint64_t)seed;
+    size_t N = GetNumElements();
+    size_t blocksPerGrid = min((size_t)ceil(N / (double)GridDim::maxThreadsPerBlock), (size_t)65535); // (the kernel loops over the rest)
+    _setCounterBasedRandomValue<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(Data(), N, distribution, a, b, key, offset);
+}
+
 //maskRate: percentage of values masked out (similar to dropout rate)
 //scaleValue: which scale value to set to the left ones (unmasked items).
 template <class ElemType>
@@ -1562,6 +1683,61 @@ void GPUMatrix<ElemType>::Adam(GPUMatrix<ElemType>& gradients,
         learnRatePerSample, momentum, adaWeight, adaMul, epsilon, unitGainMomentum, adamax);
 }
 
+template <class ElemType>
+/*static*/ void GPUMatrix<ElemType>::MultiTensorUpdate(const MultiTensorUpdateParams<ElemType>& params, const std::vector<GPUMatrix<ElemType>*>& values,
+                                                       const std::vector<GPUMatrix<ElemType>*>& gradients, const std::vector<GPUMatrix<ElemType>*>& smoothedGradients)
+{
+    std::vector<MultiTensorChunk<ElemType>> chunks;
+    for (size_t i = 0; i < values.size(); i++)
+        params.AppendChunks(values[i]->Data(), gradients[i]->Data(), smoothedGradients[i] ? smoothedGradients[i]->Data() : nullptr, values[i]->GetNumElements(), chunks);
+    if (chunks.empty())
+        return;
+
+    values[0]->PrepareDevice();
+    SyncGuard syncGuard;
+    MultiTensorChunkTable<ElemType> table;
+    for (size_t begin = 0; begin < chunks.size(); begin += MultiTensorChunkTable<ElemType>::MaxChunks)
+    {
+        table.numChunks = (int)min(chunks.size() - begin, (size_t)MultiTensorChunkTable<ElemType>::MaxChunks);
+        std::copy(chunks.begin() + begin, chunks.begin() + begin + table.numChunks, table.chunks);
+        _multiTensorUpdate<ElemType><<<table.numChunks, GridDim::maxThreadsPerBlock, 0, t_stream>>>(params, table);
+    }
+}
+
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignPackedBFloat16Of(const GPUMatrix<ElemType>& a, unsigned long seed)
+{
+    if (this == &a)
+        LogicError("AssignPackedBFloat16Of: The source and target must not be the same matrix.");
+
+    size_t n = a.GetNumElements();
+    RequireSize(BFloat16::NumPackedElements<ElemType>(n), 1);
+    if (n == 0)
+        return *this;
+
+    PrepareDevice();
+    int blocksPerGrid = (n + GridDim::maxThreadsPerBlock - 1) / GridDim::maxThreadsPerBlock;
+    SyncGuard syncGuard;
+    _assignPackedBFloat16Of<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(n, a.Data(), reinterpret_cast<uint16_t*>(Data()), seed);
+    return *this;
+}
+
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignUnpackedBFloat16Of(const GPUMatrix<ElemType>& packed)
+{
+    size_t n = GetNumElements();
+    if (packed.GetNumElements() != BFloat16::NumPackedElements<ElemType>(n))
+        LogicError("AssignUnpackedBFloat16Of: The packed matrix does not match the dimensions of the target matrix.");
+    if (n == 0)
+        return *this;
+
+    PrepareDevice();
+    int blocksPerGrid = (n + GridDim::maxThreadsPerBlock - 1) / GridDim::maxThreadsPerBlock;
+    SyncGuard syncGuard;
+    _assignUnpackedBFloat16Of<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(n, reinterpret_cast<const uint16_t*>(packed.Data()), Data());
+    return *this;
+}
+
 template <class ElemType>
 ElemType GPUMatrix<ElemType>::RmsProp(GPUMatrix<ElemType>& gradients,
                                       ElemType RMS_GAMMA,
@@ -2957,6 +3133,15 @@ void GPUMatrix<ElemType>::VectorMax(GPUMatrix<ElemType>& maxIndexes, GPUMatrix<E
     maxValues.RequireSize(topK, n);
     maxIndexes.RequireSize(topK, n);
 
+    // For a small k, a dedicated kernel selects the top k of each column, without sorting the whole matrix.
+    const int TopKBlockSize = 64;
+    const int TopKMax = 32;
+    if (topK <= TopKMax)
+    {
+        _vectorMaxTopK<TopKBlockSize, TopKMax><<<n, TopKBlockSize, 0, t_stream>>>(us.Data(), maxIndexes.Data(), maxValues.Data(), m, topK);
+        return;
+    }
+
     // To sort matrix columns we use 2-pass _stable_ sort algorithm:
     // 1. Sort by values (descending) with corresponding row/col indexes.
     // 2. Sort by col indices (ascending) with corresponding values/row indices.
@@ -3360,17 +3545,17 @@ void GPUMatrix<ElemType>::MaxROIPoolingForward(const size_t numRois, const size_
 
 template <class ElemType>
 void GPUMatrix<ElemType>::MaxROIPoolingBackward(const size_t numRois, const size_t numImg, const size_t channels, const size_t width, const size_t height,
-                                                const size_t pooledWidth, const size_t pooledHeight, const GPUMatrix<ElemType>& roiData, GPUMatrix<ElemType>& grad, 
-                                                GPUMatrix<ElemType>& argmax, double spatialScale) const
+                                                const size_t pooledWidth, const size_t pooledHeight, const GPUMatrix<ElemType>& /*roiData*/, GPUMatrix<ElemType>& grad,
+                                                GPUMatrix<ElemType>& argmax, double /*spatialScale*/) const
 {
     PrepareDevice();
     SyncGuard syncGuard;
 
-    int count = numImg * channels * height * width;
+    int count = numRois * numImg * channels * pooledHeight * pooledWidth;
     const int blockSize = GridDim::maxThreadsPerBlock;
     auto numThreads = dim3((int)floor((double)(count + blockSize - 1) / blockSize));
-    kMaxROIPoolingBackward<<<numThreads, blockSize, 0, t_stream>>>(count, numRois, numImg, channels, width, height, 
-                                                                   pooledWidth, pooledHeight, Data(), roiData.Data(), grad.Data(), argmax.Data(), spatialScale);
+    kMaxROIPoolingBackward<<<numThreads, blockSize, 0, t_stream>>>(count, numRois, channels, width, height,
+                                                                   pooledWidth, pooledHeight, Data(), grad.Data(), argmax.Data());
 }
 
 template <class ElemType>
@@ -3506,12 +3691,12 @@ void GPUMatrix<ElemType>::BatchNormalizationBackward(const GPUMatrix<ElemType>&
 #pragma region RNN Functions
 
 template <class ElemType>
-void GPUMatrix<ElemType>::RNNForward(const GPUMatrix<ElemType> &inputX, const GPUMatrix<ElemType> &paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace)
+void GPUMatrix<ElemType>::RNNForward(const GPUMatrix<ElemType> &inputX, const GPUMatrix<ElemType> &paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace, bool inferenceOnly)
 {
     // numLayers, hiddenSize are input parameters
     if (!m_rnnExecutor)
         m_rnnExecutor = std::make_unique<CuDnnRNNExecutor<ElemType>>(xDim, yDim, rnnAttributes);
-    m_rnnExecutor->ForwardCore(paramW, inputX, *this, numSequencesForFrame, rnnAttributes, reserve, workspace);
+    m_rnnExecutor->ForwardCore(paramW, inputX, *this, numSequencesForFrame, rnnAttributes, reserve, workspace, inferenceOnly);
 }
 
 template <class ElemType>
@@ -3540,6 +3725,19 @@ static cublasStatus_t cublas_gemm(cublasHandle_t handle, cublasOperation_t trans
 {
     return cublasDgemm(handle, transa, transb, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
 }
+#if CUDA_VERSION >= 8000
+// float/double overloads of cublasSgemmStridedBatched()/cublasDgemmStridedBatched()
+static cublasStatus_t cublas_gemmStridedBatched(cublasHandle_t handle, cublasOperation_t transa, cublasOperation_t transb, int m, int n, int k, const float* alpha, const float* A, int lda, long long strideA,
+                                                const float* B, int ldb, long long strideB, const float* beta, float* C, int ldc, long long strideC, int batchCount)
+{
+    return cublasSgemmStridedBatched(handle, transa, transb, m, n, k, alpha, A, lda, strideA, B, ldb, strideB, beta, C, ldc, strideC, batchCount);
+}
+static cublasStatus_t cublas_gemmStridedBatched(cublasHandle_t handle, cublasOperation_t transa, cublasOperation_t transb, int m, int n, int k, const double* alpha, const double* A, int lda, long long strideA,
+                                                const double* B, int ldb, long long strideB, const double* beta, double* C, int ldc, long long strideC, int batchCount)
+{
+    return cublasDgemmStridedBatched(handle, transa, transb, m, n, k, alpha, A, lda, strideA, B, ldb, strideB, beta, C, ldc, strideC, batchCount);
+}
+#endif
 static cublasStatus_t cublas_axpy(cublasHandle_t handle, int n, const float* alpha, const float* x, int incx, float* y, int incy)
 {
     return cublasSaxpy(handle, n, alpha, x, incx, y, incy);
@@ -3577,6 +3775,44 @@ void GPUMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const GPUMatrix
     CUBLAS_CALL(cublas_gemm(cuHandle, transA, transB, m, n, k, &alpha, a.Data(), (int) a.m_numRows, b.Data(), (int) b.m_numRows, &beta, c.Data(), (int) c.m_numRows));
 }
 
+// Batched version of MultiplyAndWeightedAdd(), see CPUMatrix<ElemType>::BatchedMultiplyAndWeightedAdd() for the layout of the batches.
+template <class ElemType>
+void GPUMatrix<ElemType>::BatchedMultiplyAndWeightedAdd(ElemType alpha, const GPUMatrix<ElemType>& a, const bool transposeA, const GPUMatrix<ElemType>& b, const bool transposeB,
+                                                        ElemType beta, GPUMatrix<ElemType>& c, const size_t m, const size_t n, const size_t k)
+{
+    a.PrepareDevice();
+    if ((a.GetComputeDeviceId() != b.GetComputeDeviceId()) || (b.GetComputeDeviceId() != c.GetComputeDeviceId())) // different GPUs
+        InvalidArgument("All matrices must be on the same GPU");
+
+    const size_t batchSize = max(a.m_numCols, b.m_numCols);
+    if (a.m_numRows != m * k || b.m_numRows != k * n ||
+        (a.m_numCols != batchSize && a.m_numCols != 1) || (b.m_numCols != batchSize && b.m_numCols != 1))
+        InvalidArgument("GPUMatrix<ElemType>::BatchedMultiplyAndWeightedAdd : The batches of a and b do not match the product dimensions.");
+
+    if (beta == 0)
+        c.RequireSize(m * n, batchSize);
+    else
+        c.VerifySize(m * n, batchSize); // Can't resize if beta != 0
+
+    if (a.IsEmpty() || b.IsEmpty())
+        return;
+
+    cublasHandle_t cuHandle = GetCublasHandle(b.GetComputeDeviceId());
+    cublasOperation_t transA = transposeA ? CUBLAS_OP_T : CUBLAS_OP_N;
+    cublasOperation_t transB = transposeB ? CUBLAS_OP_T : CUBLAS_OP_N;
+    int lda = (int) (transposeA ? k : m);
+    int ldb = (int) (transposeB ? n : k);
+    // a stride of 0 reuses a single matrix for the whole batch
+    long long strideA = a.m_numCols == 1 ? 0 : (long long) (m * k);
+    long long strideB = b.m_numCols == 1 ? 0 : (long long) (k * n);
+#if CUDA_VERSION >= 8000
+    CUBLAS_CALL(cublas_gemmStridedBatched(cuHandle, transA, transB, (int) m, (int) n, (int) k, &alpha, a.Data(), lda, strideA, b.Data(), ldb, strideB, &beta, c.Data(), (int) m, (long long) (m * n), (int) batchSize));
+#else
+    for (size_t i = 0; i < batchSize; i++)
+        CUBLAS_CALL(cublas_gemm(cuHandle, transA, transB, (int) m, (int) n, (int) k, &alpha, a.Data() + i * strideA, lda, b.Data() + i * strideB, ldb, &beta, c.Data() + i * m * n, (int) m));
+#endif
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::Multiply1x1AndWeightedAdd(ElemType alpha, const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, ElemType beta, GPUMatrix<ElemType>& c)
 {
@@ -4489,6 +4725,84 @@ void GPUMatrix<ElemType>::InnerProductWithShiftNeg(const GPUMatrix<ElemType>& a,
     }
 }
 
+// fused in two kernels: the inverse norms of the columns, and all similarities of a column in one block
+template <class ElemType>
+void GPUMatrix<ElemType>::CosSimilarityWithNegativeSamples(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, GPUMatrix<ElemType>& invNormA, GPUMatrix<ElemType>& invNormB, GPUMatrix<ElemType>& c, const size_t shift, const size_t negNumber)
+{
+    if (a.GetComputeDeviceId() != b.GetComputeDeviceId() || b.GetComputeDeviceId() != c.GetComputeDeviceId()) // different GPUs
+        InvalidArgument("All matrices must be on the same GPU");
+    if (a.IsEmpty() || b.IsEmpty())
+        LogicError("CosSimilarityWithNegativeSamples: one of the input matrices is empty.");
+    if (a.GetNumRows() != b.GetNumRows() || a.GetNumCols() != b.GetNumCols())
+        InvalidArgument("CosSimilarityWithNegativeSamples: Matrices a and b should have same dimension.");
+
+    const CUDA_LONG numRows = (CUDA_LONG) a.GetNumRows();
+    const CUDA_LONG n = (CUDA_LONG) a.GetNumCols();
+    invNormA.RequireSize(1, n);
+    invNormB.RequireSize(1, n);
+    c.RequireSize(negNumber + 1, n);
+
+    c.PrepareDevice();
+    const int threadsPerBlock = numRows >= 256 ? 256 : numRows >= 64 ? 64 : 32;
+    _columnInverseNorms<ElemType><<<dim3(n, 2), threadsPerBlock, 0, t_stream>>>(a.Data(), b.Data(), invNormA.Data(), invNormB.Data(), numRows);
+    _cosSimilarityWithNegativeSamples<ElemType><<<n, threadsPerBlock, 0, t_stream>>>(a.Data(), b.Data(), invNormA.Data(), invNormB.Data(), c.Data(), numRows, n, (CUDA_LONG) shift, (CUDA_LONG) negNumber + 1);
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::AddCosSimilarityWithNegativeSamplesGradient(const size_t inputIndex, const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, const GPUMatrix<ElemType>& invNormA, const GPUMatrix<ElemType>& invNormB,
+                                                                      const GPUMatrix<ElemType>& c, const GPUMatrix<ElemType>& cGradient, GPUMatrix<ElemType>& gradient, const size_t shift, const size_t negNumber)
+{
+    const CUDA_LONG numRows = (CUDA_LONG) a.GetNumRows();
+    const CUDA_LONG n = (CUDA_LONG) a.GetNumCols();
+    if (gradient.GetNumRows() != numRows || gradient.GetNumCols() != n || c.GetNumRows() != negNumber + 1 || cGradient.GetNumRows() != negNumber + 1)
+        InvalidArgument("AddCosSimilarityWithNegativeSamplesGradient: The dimensions of the matrices do not match.");
+
+    const GPUMatrix<ElemType>& self = inputIndex == 0 ? a : b;
+    const GPUMatrix<ElemType>& other = inputIndex == 0 ? b : a;
+    const GPUMatrix<ElemType>& invNormSelf = inputIndex == 0 ? invNormA : invNormB;
+    const GPUMatrix<ElemType>& invNormOther = inputIndex == 0 ? invNormB : invNormA;
+
+    gradient.PrepareDevice();
+    const int threadsPerBlock = numRows >= 256 ? 256 : numRows >= 64 ? 64 : 32;
+    const size_t sharedMemSize = (negNumber + 1) * (2 * sizeof(ElemType) + sizeof(CUDA_LONG));
+    _addCosSimilarityWithNegativeSamplesGradient<ElemType><<<n, threadsPerBlock, sharedMemSize, t_stream>>>((CUDA_LONG) inputIndex, self.Data(), other.Data(), invNormSelf.Data(), invNormOther.Data(),
+                                                                                                          c.Data(), cGradient.Data(), gradient.Data(), numRows, n, (CUDA_LONG) shift, (CUDA_LONG) negNumber + 1);
+}
+
+// one block per query; a query of LambdaRankNode has tens to hundreds of urls, so the quadratic work of its pairs is
+// spread over the threads of the block instead of sorting the urls first
+template <class ElemType>
+void GPUMatrix<ElemType>::LambdaRankMetrics(const GPUMatrix<ElemType>& gains, const GPUMatrix<ElemType>& scores, const GPUMatrix<ElemType>& queryBegins, GPUMatrix<ElemType>& ranks, GPUMatrix<ElemType>& metrics)
+{
+    const CUDA_LONG n = (CUDA_LONG) gains.GetNumElements();
+    const CUDA_LONG numQueries = (CUDA_LONG) queryBegins.GetNumElements() - 1;
+    if (scores.GetNumElements() != n || numQueries < 0)
+        InvalidArgument("LambdaRankMetrics: The dimensions of the matrices do not match.");
+
+    ranks.RequireSize(1, n);
+    metrics.RequireSize(2, numQueries);
+    if (numQueries == 0)
+        return;
+
+    metrics.PrepareDevice();
+    _lambdaRankMetrics<ElemType><<<numQueries, 256, 0, t_stream>>>(gains.Data(), scores.Data(), queryBegins.Data(), ranks.Data(), metrics.Data());
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::AddLambdaRankGradient(const GPUMatrix<ElemType>& gains, const GPUMatrix<ElemType>& scores, const GPUMatrix<ElemType>& queryBegins, const GPUMatrix<ElemType>& ranks, const GPUMatrix<ElemType>& metrics,
+                                                const ElemType sigma, GPUMatrix<ElemType>& gradient)
+{
+    const CUDA_LONG n = (CUDA_LONG) gains.GetNumElements();
+    const CUDA_LONG numQueries = (CUDA_LONG) queryBegins.GetNumElements() - 1;
+    if (scores.GetNumElements() != n || ranks.GetNumElements() != n || gradient.GetNumElements() != n || metrics.GetNumElements() != 2 * numQueries)
+        InvalidArgument("AddLambdaRankGradient: The dimensions of the matrices do not match.");
+    if (numQueries <= 0)
+        return;
+
+    gradient.PrepareDevice();
+    _addLambdaRankGradient<ElemType><<<numQueries, 256, 0, t_stream>>>(gains.Data(), scores.Data(), queryBegins.Data(), ranks.Data(), metrics.Data(), sigma, gradient.Data());
+}
+
 template <class ElemType>
 GPUMatrix<ElemType>& GPUMatrix<ElemType>::GetARowByIndex(const GPUMatrix<ElemType>& a, const size_t m)
 {
@@ -4555,55 +4869,45 @@ GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignCTCScore(const GPUMatrix<ElemTyp
         // Max number of phones in utterances in this minibatch
         size_t maxPhoneNum = phoneSeq.GetNumRows();
 
-        size_t *gpuFrameNum;
-        CUDA_CALL(cudaMalloc((void **)&gpuFrameNum, uttNum * sizeof(size_t)));
-        CUDA_CALL(cudaMemcpy(gpuFrameNum, uttFrameNum.data(), uttNum * sizeof(size_t), cudaMemcpyHostToDevice));
-
-        size_t *gpuPhoneNum;
-        CUDA_CALL(cudaMalloc((void **)&gpuPhoneNum, uttNum * sizeof(size_t)));
-        CUDA_CALL(cudaMemcpy(gpuPhoneNum, uttPhoneNum.data(), uttNum * sizeof(size_t), cudaMemcpyHostToDevice));
-
-        size_t *gpuBeginFrame;
-        CUDA_CALL(cudaMalloc((void **)&gpuBeginFrame, uttNum * sizeof(size_t)));
-        CUDA_CALL(cudaMemcpy(gpuBeginFrame, uttBeginFrame.data(), uttNum * sizeof(size_t), cudaMemcpyHostToDevice));
-
-        size_t *gpuUttToChanInd;
-        CUDA_CALL(cudaMalloc((void **)&gpuUttToChanInd, uttNum * sizeof(size_t)));
-        CUDA_CALL(cudaMemcpy(gpuUttToChanInd, uttToChanInd.data(), uttNum * sizeof(size_t), cudaMemcpyHostToDevice));
-
-        cudaEvent_t done = nullptr;
-        CUDA_CALL(cudaEventCreate(&done));
-        dim3 thread_tail(DEFAULT_THREAD_PER_DIM, DEFAULT_THREAD_PER_DIM);
-        // x dimension is for utterances
-        // y dimention is for phone sequence in each utterance
-        // Ensure that we allocate correct number of blocks for given number of utterances and max number of phones in those utterances 
-        dim3 block_tail((uttNum + DEFAULT_THREAD_PER_DIM - 1) / DEFAULT_THREAD_PER_DIM, (maxPhoneNum + DEFAULT_THREAD_PER_DIM - 1) / DEFAULT_THREAD_PER_DIM);
-        for (long t = 0; t < maxFrameNum; t++)
-        {
-            _assignAlphaScore << <block_tail, thread_tail, 0, t_stream >> >(prob.Data(), alpha.Data(), phoneSeq.Data(), phoneBoundary.Data(), gpuUttToChanInd,
-                gpuFrameNum, gpuBeginFrame, gpuPhoneNum, numParallelSequences, uttNum, t, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
-        }
+        // the per-utterance vectors go to the GPU in a single allocation and copy
+        std::vector<size_t> uttInfo;
+        uttInfo.reserve(4 * uttNum);
+        uttInfo.insert(uttInfo.end(), uttFrameNum.begin(), uttFrameNum.end());
+        uttInfo.insert(uttInfo.end(), uttPhoneNum.begin(), uttPhoneNum.end());
+        uttInfo.insert(uttInfo.end(), uttBeginFrame.begin(), uttBeginFrame.end());
+        uttInfo.insert(uttInfo.end(), uttToChanInd.begin(), uttToChanInd.end());
+        size_t *gpuUttInfo;
+        CUDA_CALL(cudaMalloc((void **)&gpuUttInfo, uttInfo.size() * sizeof(size_t)));
+        CUDA_CALL(cudaMemcpy(gpuUttInfo, uttInfo.data(), uttInfo.size() * sizeof(size_t), cudaMemcpyHostToDevice));
+        size_t *gpuFrameNum = gpuUttInfo;
+        size_t *gpuPhoneNum = gpuUttInfo + uttNum;
+        size_t *gpuBeginFrame = gpuUttInfo + 2 * uttNum;
+        size_t *gpuUttToChanInd = gpuUttInfo + 3 * uttNum;
+
+        // The alpha and beta recursions run in a single launch each, with one thread block per utterance that steps
+        // through the frames itself, instead of one launch per frame for all utterances.
+        // The threads of a block share the labels of the utterance.
+        const size_t labelThreads = (min)((size_t)GridDim::maxThreadsPerBlock, (maxPhoneNum + 31) / 32 * 32);
+        _assignAlphaScore << <uttNum, labelThreads, 0, t_stream >> >(prob.Data(), alpha.Data(), phoneSeq.Data(), phoneBoundary.Data(), gpuUttToChanInd,
+            gpuFrameNum, gpuBeginFrame, gpuPhoneNum, numParallelSequences, uttNum, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
+
+        _assignBetaScore << <uttNum, labelThreads, 0, t_stream >> >(prob.Data(), beta.Data(), phoneSeq.Data(), phoneBoundary.Data(), gpuUttToChanInd,
+            gpuFrameNum, gpuBeginFrame, gpuPhoneNum, numParallelSequences, uttNum, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
 
-        for (long t = maxFrameNum - 1; t >= 0; t--)
-        {
-            _assignBetaScore << <block_tail, thread_tail, 0, t_stream >> >(prob.Data(), beta.Data(), phoneSeq.Data(), phoneBoundary.Data(), gpuUttToChanInd,
-                gpuFrameNum, gpuBeginFrame, gpuPhoneNum, numParallelSequences, uttNum, t, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
-        }
-        
         ElemType zerVar = 0.0;
         totalScore.SetColumn(&zerVar, 0);
         _assignTotalScore << <uttNum, 1, 0, t_stream >> > (beta.Data(), totalScore.Data(), uttNum, gpuUttToChanInd, gpuBeginFrame, numParallelSequences, maxPhoneNum);
 
+        dim3 thread_tail(DEFAULT_THREAD_PER_DIM, DEFAULT_THREAD_PER_DIM);
         dim3 block_tail_2((uttNum + DEFAULT_THREAD_PER_DIM - 1) / DEFAULT_THREAD_PER_DIM, (maxFrameNum + DEFAULT_THREAD_PER_DIM - 1) / DEFAULT_THREAD_PER_DIM);
 
         _assignCTCScore << < block_tail_2, thread_tail, 0, t_stream >> >(Data(), prob.Data(), alpha.Data(), beta.Data(), phoneSeq.Data(), uttNum, gpuUttToChanInd,
             gpuBeginFrame, gpuPhoneNum, gpuFrameNum, numParallelSequences, maxPhoneNum, totalPhoneNum);
 
-        CUDA_CALL(cudaFree(gpuFrameNum));
-        CUDA_CALL(cudaFree(gpuPhoneNum));
-        CUDA_CALL(cudaFree(gpuBeginFrame));
-        CUDA_CALL(cudaFree(gpuUttToChanInd));
+        CUDA_CALL(cudaFree(gpuUttInfo));
 
+        cudaEvent_t done = nullptr;
+        CUDA_CALL(cudaEventCreate(&done));
         CUDA_CALL(cudaEventRecord(done));
         CUDA_CALL(cudaEventSynchronize(done));
         CUDA_CALL(cudaEventDestroy(done));
@@ -4840,6 +5144,20 @@ static shared_ptr<GPUMatrix<ElemType>> GetOnesVector(size_t N, DEVICEID_TYPE dev
     return p;
 }
 
+// check whether a unary tensor op is a copy that swaps the stride-1 axis, i.e. a (batched) matrix transpose
+// c[i0 + i1 * ldc] = a[i1 + i0 * lda] for i0 < regularOpDims[0], i1 < regularOpDims[1], and an optional third (batch) dimension.
+static bool IsTensorTranspose(const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides, const SmallVector<size_t>& reducingOpDims)
+{
+    if (!reducingOpDims.empty() || (regularOpDims.size() != 2 && regularOpDims.size() != 3))
+        return false;
+    const auto& aStrides = regularStrides[0];
+    const auto& cStrides = regularStrides[1];
+    if (cStrides[0] != 1 || aStrides[1] != 1 ||
+        aStrides[0] < (ptrdiff_t)regularOpDims[1] || cStrides[1] < (ptrdiff_t)regularOpDims[0])
+        return false;
+    return regularOpDims.size() == 2 || (aStrides[2] >= 0 && cStrides[2] > 0);
+}
+
 // perform unary operation 'op' on a giving 'this', reinterpreting the matrices as tensors as specified by the dims and strides
 // This binds the N-ariness to a template parameter N, and gets the data pointers out from the matrix objects.
 template <class ElemType>
@@ -4897,11 +5215,29 @@ void GPUMatrix<ElemType>::TensorOp(ElemType beta, const GPUMatrix<ElemType>& a,
         return;
     }
 
+    // special case: copy that swaps the stride-1 axis (e.g. TransposeDimensions), i.e. a (batched) matrix transpose
+    // The regular kernel would either read or write uncoalesced; the tiled kernel does both coalesced.
+    else if (op == ElementWiseOperator::opCopy && a.Data() != Data() && IsTensorTranspose(regularOpDims, regularStrides, reducingOpDims))
+    {
+        const bool batched = regularOpDims.size() == 3;
+        const size_t n0 = regularOpDims[0];
+        const size_t n1 = regularOpDims[1];
+        const size_t batch = batched ? regularOpDims[2] : 1;
+        dim3 blocksPerGrid((unsigned int)((n0 + TRANSPOSE_TILE_DIM - 1) / TRANSPOSE_TILE_DIM), (unsigned int)((n1 + TRANSPOSE_TILE_DIM - 1) / TRANSPOSE_TILE_DIM), (unsigned int)batch);
+        if (blocksPerGrid.y <= 65535 && blocksPerGrid.z <= 65535 && n0 < INT_MAX && n1 < INT_MAX)
+        {
+            SyncGuard syncGuard;
+            _transposeTiled<ElemType><<<blocksPerGrid, dim3(TRANSPOSE_TILE_DIM, TRANSPOSE_BLOCK_ROWS), 0, t_stream>>>(beta, a.Data() + offsets[0], Data() + offsets[1], alpha,
+                (CUDA_LONG)n0, (CUDA_LONG)n1, (size_t)regularStrides[0][0], (size_t)regularStrides[1][1],
+                batched ? (size_t)regularStrides[0][2] : 0, batched ? (size_t)regularStrides[1][2] : 0);
+            return;
+        }
+    }
+
     // TODO: Add a special case for tensor bias reduction. cudnn is ~7% faster on Image/QuickE2E.
 
     // regular case
-    else
-        return TensorOpN<ElemType, 2>(beta, array<ElemType*, 2>{a.Data(), Data()}, alpha, op, reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+    return TensorOpN<ElemType, 2>(beta, array<ElemType*, 2>{a.Data(), Data()}, alpha, op, reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
 }
 
 // perform binary operation 'op' on a and b giving 'this', reinterpreting the matrices as tensors as specified by the dims and strides
@@ -4937,6 +5273,22 @@ void GPUMatrix<ElemType>::TensorOp(ElemType beta, const GPUMatrix<ElemType>& a,
     return TensorOpN<ElemType, 4>(beta, array<ElemType*, 4>{a.Data(), b.Data(), c.Data(), Data()}, alpha, op, reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
 }
 
+// perform a fused sequence of element-wise ops in a single kernel launch
+template <class ElemType>
+void GPUMatrix<ElemType>::TensorOp(ElemType beta, const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, const GPUMatrix<ElemType>& c, ElemType alpha, const ElementWiseProgram& program,
+                                   const array<size_t, 4>& offsets,
+                                   const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                                   const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 4>& /*reducingStrides*/)
+{
+    if (program.numSteps == 0 || program.numSteps > ElementWiseProgram::MaxSteps)
+        InvalidArgument("TensorOp: Invalid number of steps (%d) in element-wise program.", (int) program.numSteps);
+
+    a.PrepareDevice();
+    if (a.GetComputeDeviceId() != GetComputeDeviceId() || b.GetComputeDeviceId() != GetComputeDeviceId() || c.GetComputeDeviceId() != GetComputeDeviceId())
+        InvalidArgument("All matrices must be on the same GPU");
+    return TensorElementWiseProgram<ElemType>(beta, array<ElemType*, 4>{a.Data(), b.Data(), c.Data(), Data()}, alpha, program, offsets, regularOpDims, regularStrides, reducingOpDims);
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::TensorArgOp(const GPUMatrix<ElemType>& a, ElementWiseOperator reductionOp,
                                       const array<size_t, 2>& offsets,
@@ -4987,6 +5339,7 @@ template void GPUMatrix<char>::SetValue(const char);
 template void GPUMatrix<char>::SetValue(const size_t numRows, const size_t numCols, int deviceId, char* pArray, size_t matrixFlags, DataTransferer* transferer);
 //template void GPUMatrix<char>::SetValue(CPUMatrix<char> const&);
 template void GPUMatrix<char>::SetValue(GPUMatrix<char> const&);
+template void GPUMatrix<char>::SetValueFromPeer(GPUMatrix<char> const&);
 //template void GPUMatrix<char>::SetValue(CPUSparseMatrix<char> const&);
 //template void GPUMatrix<char>::SetValue(GPUSparseMatrix<char> const&);
 template void GPUMatrix<char>::CopySection(size_t numRows, size_t numCols, char* dst, size_t colStride) const;
@@ -5012,6 +5365,7 @@ template void GPUMatrix<short>::SetValue(const short);
 template void GPUMatrix<short>::SetValue(const size_t numRows, const size_t numCols, int deviceId, short* pArray, size_t matrixFlags, DataTransferer* transferer);
 //template void GPUMatrix<short>::SetValue(CPUMatrix<short> const&);
 template void GPUMatrix<short>::SetValue(GPUMatrix<short> const&);
+template void GPUMatrix<short>::SetValueFromPeer(GPUMatrix<short> const&);
 //template void GPUMatrix<short>::SetValue(CPUSparseMatrix<short> const&);
 //template void GPUMatrix<short>::SetValue(GPUSparseMatrix<short> const&);
 template void GPUMatrix<short>::CopySection(size_t numRows, size_t numCols, short* dst, size_t colStride) const;
@@ -5019,6 +5373,33 @@ template void GPUMatrix<short>::Reshape(const size_t, const size_t);
 template GPUMatrix<short>& GPUMatrix<short>::operator*=(short);
 template DEVICEID_TYPE GPUMatrix<short>::PrepareDevice(DEVICEID_TYPE deviceId) const;
 
+// Support <half>
+template GPUMatrix<half>::GPUMatrix(const size_t numRows, const size_t numCols, int deviceId);
+template GPUMatrix<half>::GPUMatrix(const size_t numRows, const size_t numCols, int deviceId, half* pArray, const size_t matrixFlags);
+template GPUMatrix<half>::GPUMatrix(const GPUMatrix<half>&);
+template GPUMatrix<half>::GPUMatrix(GPUMatrix<half>&&);
+template half* GPUMatrix<half>::CopyToArray() const;
+template void GPUMatrix<half>::ChangeDeviceTo(int);
+template void GPUMatrix<half>::Resize(size_t, size_t, bool);
+template void GPUMatrix<half>::RequireSize(size_t, size_t, bool);
+
+template GPUMatrix<half>::~GPUMatrix();
+template GPUMatrix<half> GPUMatrix<half>::ColumnSlice(size_t startColumn, size_t numCols) const;
+template GPUMatrix<half>& GPUMatrix<half>::operator=(GPUMatrix<half>&&);
+template GPUMatrix<half>::GPUMatrix(int);
+template void GPUMatrix<half>::SetValue(const half);
+template void GPUMatrix<half>::SetValue(const size_t numRows, const size_t numCols, int deviceId, half* pArray, size_t matrixFlags, DataTransferer* transferer);
+//template void GPUMatrix<half>::SetValue(CPUMatrix<half> const&);
+template void GPUMatrix<half>::SetValue(GPUMatrix<half> const&);
+template void GPUMatrix<half>::SetValueFromPeer(GPUMatrix<half> const&);
+//template void GPUMatrix<half>::SetValue(CPUSparseMatrix<half> const&);
+//template void GPUMatrix<half>::SetValue(GPUSparseMatrix<half> const&);
+template void GPUMatrix<half>::CopySection(size_t numRows, size_t numCols, half* dst, size_t colStride) const;
+template void GPUMatrix<half>::Reshape(const size_t, const size_t);
+template GPUMatrix<half>& GPUMatrix<half>::operator*=(half);
+template DEVICEID_TYPE GPUMatrix<half>::PrepareDevice(DEVICEID_TYPE deviceId) const;
+template size_t GPUMatrix<half>::CopyToArray(half*& arrayCopyTo, size_t& currentArraySize) const;
+
 template GPUMatrix<int>::GPUMatrix(const size_t, const size_t, int, int*, const size_t);
 template GPUMatrix<int>::~GPUMatrix();
 
@@ -5026,6 +5407,7 @@ template int* TracingGPUMemoryAllocator::Allocate<int>(int, size_t);
 template size_t* TracingGPUMemoryAllocator::Allocate<size_t>(int, size_t);
 template long* TracingGPUMemoryAllocator::Allocate<long>(int, size_t);
 template short* TracingGPUMemoryAllocator::Allocate<short>(int, size_t);
+template half* TracingGPUMemoryAllocator::Allocate<half>(int, size_t);
 template char* TracingGPUMemoryAllocator::Allocate<char>(int, size_t);
 template float* TracingGPUMemoryAllocator::Allocate<float>(int, size_t);
 template double* TracingGPUMemoryAllocator::Allocate<double>(int, size_t);
@@ -5033,6 +5415,7 @@ template double* TracingGPUMemoryAllocator::Allocate<double>(int, size_t);
 template void TracingGPUMemoryAllocator::Free<int>(int, int*, bool);
 template void TracingGPUMemoryAllocator::Free<size_t>(int, size_t*, bool);
 template void TracingGPUMemoryAllocator::Free<short>(int, short*, bool);
+template void TracingGPUMemoryAllocator::Free<half>(int, half*, bool);
 template void TracingGPUMemoryAllocator::Free<char>(int, char*, bool);
 template void TracingGPUMemoryAllocator::Free<float>(int, float*, bool);
 template void TracingGPUMemoryAllocator::Free<double>(int, double*, bool);
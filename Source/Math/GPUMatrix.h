@@ -123,6 +123,7 @@ public:
 void PrepareDevice(DEVICEID_TYPE deviceId);
 
 template<class ElemType> class CuDnnRNNExecutor;
+template <class ElemType> struct MultiTensorUpdateParams;
 
 template <class ElemType>
 class MATH_API GPUMatrix : public BaseMatrix<ElemType>
@@ -232,6 +233,13 @@ public:
     void Adam(GPUMatrix<ElemType>& gradients, GPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample,
               ElemType momentum, ElemType adaWeight, ElemType adaMul, ElemType epsilon, bool unitGainMomentum, bool adamax=false);
 
+    // see MultiTensorUpdate.h; 'smoothedGradients' are nullptr for the vanilla SGD
+    static void MultiTensorUpdate(const MultiTensorUpdateParams<ElemType>& params, const std::vector<GPUMatrix<ElemType>*>& values,
+                                  const std::vector<GPUMatrix<ElemType>*>& gradients, const std::vector<GPUMatrix<ElemType>*>& smoothedGradients);
+
+    GPUMatrix<ElemType>& AssignPackedBFloat16Of(const GPUMatrix<ElemType>& a, unsigned long seed);
+    GPUMatrix<ElemType>& AssignUnpackedBFloat16Of(const GPUMatrix<ElemType>& packed);
+
     ElemType RmsProp(GPUMatrix<ElemType>& gradients, 
                      ElemType RMS_GAMMA, 
                      ElemType RMS_WGT_INC, 
@@ -268,9 +276,12 @@ public:
 
     //void SetValue(const CPUMatrix<ElemType>& deepCopyFrom);
     void SetValue(const GPUMatrix<ElemType>& deepCopyFrom);
+    void SetValueFromPeer(const GPUMatrix<ElemType>& deepCopyFrom); // like SetValue(), but keeps this matrix on its device if the source is on another one
     //void SetValue(const CPUSparseMatrix<ElemType>& deepCopyFrom);
     //void SetValue(const GPUSparseMatrix<ElemType>& deepCopyFrom);
     void SetValue(const size_t numRows, const size_t numCols, int deviceId, ElemType* pArray, size_t matrixFlags = matrixFlagNormal, DataTransferer* transferer = nullptr);
+    // reads numRows x numCols elements (column-major) from the stream, see operator>>()
+    void ReadValues(File& stream, const size_t numRows, const size_t numCols);
 
     void SetDiagonalValue(const ElemType v);
     void SetDiagonalValue(const GPUMatrix<ElemType>& vector);
@@ -280,6 +291,7 @@ public:
     void SetGumbelRandomValue(RNGHandle& rngHandle, const ElemType loc, const ElemType scale);
     void SetGaussianRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED);
     void SetTruncatedNormalRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED); 
+    void SetCounterBasedRandomValue(RandomDistribution distribution, const ElemType a, const ElemType b, unsigned long seed = USE_TIME_BASED_SEED, uint64_t offset = 0);
     void SetUniformRandomMask(const ElemType maskRate, const ElemType scaleValue, RNGHandle& rngHandle);
 
     GPUMatrix<ElemType>& AssignOneHot(const GPUMatrix<ElemType>& a, vector<size_t>& shape, size_t axis);
@@ -516,7 +528,7 @@ public:
                                     GPUMatrix<ElemType>& scaleGrad, GPUMatrix<ElemType>& biasGrad) const;
 
     // RNN support functions
-    void RNNForward(const GPUMatrix<ElemType>& inputX, const GPUMatrix<ElemType>& paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const struct RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
+    void RNNForward(const GPUMatrix<ElemType>& inputX, const GPUMatrix<ElemType>& paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const struct RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace, bool inferenceOnly);
     void RNNBackwardData(const GPUMatrix<ElemType>& outputDY, const GPUMatrix<ElemType>& paramW, GPUMatrix<ElemType>& outputDX, const struct RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
     void RNNBackwardWeights(const GPUMatrix<ElemType>& inputX, const GPUMatrix<ElemType>& outputY, GPUMatrix<ElemType>& dw, const struct RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace);
 
@@ -526,6 +538,7 @@ public:
     static void MultiplyAndAdd(const GPUMatrix<ElemType>& a, const bool transposeA, const GPUMatrix<ElemType>& b, const bool transposeB, GPUMatrix<ElemType>& c);
     static void Multiply(const GPUMatrix<ElemType>& a, const bool transposeA, const GPUMatrix<ElemType>& b, const bool transposeB, GPUMatrix<ElemType>& c);
     static void Multiply(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, GPUMatrix<ElemType>& c);
+    static void BatchedMultiplyAndWeightedAdd(ElemType alpha, const GPUMatrix<ElemType>& a, const bool transposeA, const GPUMatrix<ElemType>& b, const bool transposeB, ElemType beta, GPUMatrix<ElemType>& c, const size_t m, const size_t n, const size_t k);
     static void Multiply1x1AndWeightedAdd(ElemType alpha, const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, ElemType beta, GPUMatrix<ElemType>& c);
 
     static void ColumnwiseScaleAndWeightedAdd(ElemType alpha, const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& v, ElemType beta, GPUMatrix<ElemType>& c);
@@ -565,6 +578,10 @@ public:
                   const std::array<size_t, 4>& offsets,
                   const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& regularStrides,
                   const SmallVector<size_t>& reducingOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
+    void TensorOp(ElemType beta, const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, const GPUMatrix<ElemType>& c, ElemType alpha, const ElementWiseProgram& program,
+                  const std::array<size_t, 4>& offsets,
+                  const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                  const SmallVector<size_t>& reducingOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
 
     void TensorArgOp(const GPUMatrix<ElemType>& a, ElementWiseOperator reductionOp,
                      const std::array<size_t, 2>& offsets,
@@ -590,6 +607,12 @@ public:
     static void InnerProductWithShiftNeg(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, GPUMatrix<ElemType>& c, const size_t shift, const size_t nt);
     GPUMatrix<ElemType>& GetARowByIndex(const GPUMatrix<ElemType>& a, const size_t m);
     static void ConductRowElementMultiplyWithShift(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, GPUMatrix<ElemType>& c, const size_t shift, const bool isafixed);
+    static void CosSimilarityWithNegativeSamples(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, GPUMatrix<ElemType>& invNormA, GPUMatrix<ElemType>& invNormB, GPUMatrix<ElemType>& c, const size_t shift, const size_t negNumber);
+    static void AddCosSimilarityWithNegativeSamplesGradient(const size_t inputIndex, const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, const GPUMatrix<ElemType>& invNormA, const GPUMatrix<ElemType>& invNormB,
+                                                            const GPUMatrix<ElemType>& c, const GPUMatrix<ElemType>& cGradient, GPUMatrix<ElemType>& gradient, const size_t shift, const size_t negNumber);
+    static void LambdaRankMetrics(const GPUMatrix<ElemType>& gains, const GPUMatrix<ElemType>& scores, const GPUMatrix<ElemType>& queryBegins, GPUMatrix<ElemType>& ranks, GPUMatrix<ElemType>& metrics);
+    static void AddLambdaRankGradient(const GPUMatrix<ElemType>& gains, const GPUMatrix<ElemType>& scores, const GPUMatrix<ElemType>& queryBegins, const GPUMatrix<ElemType>& ranks, const GPUMatrix<ElemType>& metrics,
+                                      const ElemType sigma, GPUMatrix<ElemType>& gradient);
 
     GPUMatrix<ElemType>& AssignElementProductOfWithShift(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, const size_t shift);
 
@@ -618,12 +641,16 @@ public:
         size_t numRows, numCols;
         int format;
         stream >> matrixNameDummy >> format >> numRows >> numCols;
-        ElemType* d_array = new ElemType[numRows * numCols];
-        for (size_t i = 0; i < numRows * numCols; ++i)
-            stream >> d_array[i];
+        if (!(format & matrixFormatRowMajor))
+            us.ReadValues(stream, numRows, numCols);
+        else
+        {
+            ElemType* d_array = new ElemType[numRows * numCols];
+            stream.ReadArray(d_array, numRows * numCols);
+            us.SetValue(numRows, numCols, us.GetComputeDeviceId(), d_array, matrixFlagNormal | format);
+            delete[] d_array;
+        }
         stream.GetMarker(fileMarkerEndSection, std::wstring(L"EMAT"));
-        us.SetValue(numRows, numCols, us.GetComputeDeviceId(), d_array, matrixFlagNormal | format);
-        delete[] d_array;
         return stream;
     }
     friend File& operator<<(File& stream, const GPUMatrix<ElemType>& us)
@@ -638,9 +665,8 @@ public:
 
         stream << us.m_numRows << us.m_numCols;
         ElemType* pArray = us.CopyToArray();
-        for (size_t i = 0; i < us.GetNumElements(); ++i)
-            stream << pArray[i];
-        
+        stream.WriteArray(pArray, us.GetNumElements());
+
         delete[] pArray;
 
         stream.PutMarker(fileMarkerEndSection, std::wstring(L"EMAT"));
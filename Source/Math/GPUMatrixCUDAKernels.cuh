@@ -14,6 +14,26 @@
 #include "CommonMatrix.h"
 #include "GPUMatrix.h"
 #include "TensorOps.h" // for exp_() etc.
+#pragma push_macro("LAZY_UPDATE_DECL")
+#define LAZY_UPDATE_DECL __device__ __host__
+#include "LazySparseUpdate.h"
+#pragma pop_macro("LAZY_UPDATE_DECL")
+#pragma push_macro("BFLOAT16_DECL")
+#define BFLOAT16_DECL __device__ __host__
+#include "BFloat16.h"
+#pragma pop_macro("BFLOAT16_DECL")
+#pragma push_macro("MULTI_TENSOR_UPDATE_DECL")
+#define MULTI_TENSOR_UPDATE_DECL __device__ __host__
+#include "MultiTensorUpdate.h"
+#pragma pop_macro("MULTI_TENSOR_UPDATE_DECL")
+#pragma push_macro("COUNTER_BASED_RANDOM_DECL")
+#define COUNTER_BASED_RANDOM_DECL __device__ __host__
+#include "CounterBasedRandom.h"
+#pragma pop_macro("COUNTER_BASED_RANDOM_DECL")
+#pragma push_macro("LAMBDA_RANK_DECL")
+#define LAMBDA_RANK_DECL __device__ __host__
+#include "LambdaRank.h"
+#pragma pop_macro("LAMBDA_RANK_DECL")
 #include "device_functions.h"
 #include <cuda_runtime.h>
 #include <assert.h>
@@ -1691,6 +1711,21 @@ __global__ void _truncated_normal_transform(
     a[id] = normcdfinv(a[id] * (high - low) + low) * sigma + mean;
 }
 
+// a grid-stride loop, since the large parameters this is used for may have more elements than there are threads
+template <class ElemType>
+__global__ void _setCounterBasedRandomValue(
+    ElemType* a,
+    const size_t N,
+    const RandomDistribution distribution,
+    const ElemType p1,
+    const ElemType p2,
+    const uint64_t seed,
+    const uint64_t offset)
+{
+    for (size_t id = (size_t)blockDim.x * blockIdx.x + threadIdx.x; id < N; id += (size_t)blockDim.x * gridDim.x)
+        a[id] = CounterBasedRandom::Value(distribution, p1, p2, seed, offset + (uint64_t)id);
+}
+
 template <class ElemType>
 __global__ void _gumbelFromUniform(
     ElemType* a,
@@ -3164,6 +3199,130 @@ __global__ void _dense1DConvMultSparseCSCTransposeAndAddToDense(
     }
 }
 
+// Dense x sparse CSC products whose work is split by nonzero elements rather than by columns, so that columns with
+// many nonzeros (long documents) do not leave most of the GPU idle. Each block takes SPMM_NZ_PER_BLOCK consecutive
+// nonzeros (blockIdx.x) for blockDim.x rows of c (blockIdx.y). The blocks beyond the last nonzero, which is only
+// known on the GPU, return at once.
+#define SPMM_NZ_PER_BLOCK 256
+
+// loads the nonzeros of the block, and their columns, into shared memory; returns the number of them
+template <class ElemType>
+__device__ int _loadSparseCSCNzBlock(const int n, const ElemType* bnzValues, const GPUSPARSE_INDEX_TYPE* rowIndex, const GPUSPARSE_INDEX_TYPE* colCSCIndex,
+                                     GPUSPARSE_INDEX_TYPE* nzRows, GPUSPARSE_INDEX_TYPE* nzCols, ElemType* nzValues)
+{
+    const int nzBegin = colCSCIndex[0] + blockIdx.x * SPMM_NZ_PER_BLOCK;
+    const int numNz = min(SPMM_NZ_PER_BLOCK, colCSCIndex[n] - nzBegin);
+    for (int t = threadIdx.x; t < numNz; t += blockDim.x)
+    {
+        const int j = nzBegin + t;
+        // the column of nonzero j: the last one that starts at or before j (empty columns start where the next one does)
+        int lo = 0;
+        int hi = n - 1;
+        while (lo < hi)
+        {
+            int mid = (lo + hi + 1) / 2;
+            if (colCSCIndex[mid] <= j)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        nzCols[t] = lo;
+        nzRows[t] = rowIndex[j];
+        nzValues[t] = bnzValues[j];
+    }
+    __syncthreads();
+    return numNz;
+}
+
+// c += alpha * op(a) * b, where c has been scaled by beta beforehand
+// The columns that lie entirely in the nonzeros of a block are only written by that block; the first and the last one
+// may be shared with the neighbouring blocks, and are added to atomically.
+template <class ElemType>
+__global__ void _denseMultSparseCSCAndAddToDenseNzBalanced(
+    const int m, // rowDense
+    const int k, // colDense
+    const int n, // colSparse
+    const ElemType alpha,
+    const ElemType* a, // dense
+    const bool transposeA,
+    const ElemType* bnzValues, // sparse nz values
+    const GPUSPARSE_INDEX_TYPE* rowIndex,
+    const GPUSPARSE_INDEX_TYPE* colCSCIndex,
+    ElemType* c // dense target
+    )
+{
+    __shared__ GPUSPARSE_INDEX_TYPE nzRows[SPMM_NZ_PER_BLOCK];
+    __shared__ GPUSPARSE_INDEX_TYPE nzCols[SPMM_NZ_PER_BLOCK];
+    __shared__ ElemType nzValues[SPMM_NZ_PER_BLOCK];
+
+    if (colCSCIndex[0] + (int)blockIdx.x * SPMM_NZ_PER_BLOCK >= colCSCIndex[n]) // (the same for all threads of the block)
+        return;
+    const int numNz = _loadSparseCSCNzBlock(n, bnzValues, rowIndex, colCSCIndex, nzRows, nzCols, nzValues);
+
+    const int rowInC = blockIdx.y * blockDim.x + threadIdx.x;
+    if (rowInC >= m)
+        return;
+
+    const int firstCol = nzCols[0];
+    const int lastCol = nzCols[numNz - 1];
+    int col = firstCol;
+    ElemType s = 0;
+    for (int t = 0; t <= numNz; t++)
+    {
+        if (t == numNz || nzCols[t] != col)
+        {
+            ElemType* target = &c[IDX2C(rowInC, col, m)];
+            if (col == firstCol || col == lastCol)
+                atomicAdd(target, alpha * s);
+            else
+                *target += alpha * s;
+            if (t == numNz)
+                break;
+            col = nzCols[t];
+            s = 0;
+        }
+        const int i = nzRows[t];
+        s += (transposeA ? a[IDX2C(i, rowInC, k)] : a[IDX2C(rowInC, i, m)]) * nzValues[t];
+    }
+}
+
+// c += alpha * op(a) * b^T
+// The nonzeros of a block are in different rows of b, i.e. columns of c, so each one is added atomically, as in
+// _dense1DConvMultSparseCSCTransposeAndAddToDense(), but in a single launch rather than one per column of b.
+template <class ElemType>
+__global__ void _denseMultSparseCSCTransposeAndAddToDenseNzBalanced(
+    const int m, // rowDense
+    const int k, // colDense
+    const int n, // colSparse
+    const ElemType alpha,
+    const ElemType* a, // dense
+    const bool transposeA,
+    const ElemType* bnzValues, // sparse nz values
+    const GPUSPARSE_INDEX_TYPE* rowIndex,
+    const GPUSPARSE_INDEX_TYPE* colCSCIndex,
+    ElemType* c // dense target
+    )
+{
+    __shared__ GPUSPARSE_INDEX_TYPE nzRows[SPMM_NZ_PER_BLOCK];
+    __shared__ GPUSPARSE_INDEX_TYPE nzCols[SPMM_NZ_PER_BLOCK];
+    __shared__ ElemType nzValues[SPMM_NZ_PER_BLOCK];
+
+    if (colCSCIndex[0] + (int)blockIdx.x * SPMM_NZ_PER_BLOCK >= colCSCIndex[n])
+        return;
+    const int numNz = _loadSparseCSCNzBlock(n, bnzValues, rowIndex, colCSCIndex, nzRows, nzCols, nzValues);
+
+    const int rowInC = blockIdx.y * blockDim.x + threadIdx.x;
+    if (rowInC >= m)
+        return;
+
+    for (int t = 0; t < numNz; t++)
+    {
+        const int i = nzCols[t]; // column of b, i.e. row of b^T
+        const ElemType aValue = transposeA ? a[IDX2C(i, rowInC, k)] : a[IDX2C(rowInC, i, m)];
+        atomicAdd(&c[IDX2C(rowInC, nzRows[t], m)], alpha * aValue * nzValues[t]);
+    }
+}
+
 template <class ElemType>
 __global__ void _columnwiseScaleAndWeightedAdd(
     ElemType alpha,
@@ -3311,6 +3470,47 @@ __global__ void _determineBlockIds(
     }
 }
 
+// called before _determineBlockIds by GPUSparseMatrix::ScatterToIndices(): the key (the column, or numCols if the index is
+// skipped) and the position of each index, and the columns with values
+template <class ElemType>
+__global__ void _findColsOfIndices(
+    const ElemType* indices, int* keys, int* positions, GPUSPARSE_INDEX_TYPE* col2BlockIds, const int numCols, const CUDA_LONG numIndices)
+{
+    const CUDA_LONG i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i >= numIndices)
+        return;
+
+    const ElemType col = indices[i];
+    const bool valid = col >= 0 && col < numCols; // (false for NaN)
+    keys[i] = valid ? (int) col : numCols;
+    positions[i] = (int) i;
+    if (valid && col2BlockIds[(int) col] == Id_NotAssigned)
+        col2BlockIds[(int) col] = Id_Pending;
+}
+
+// After the pairs of ScatterToIndices() are sorted by column, the thread of row 'row' of the first pair of each column sums
+// that row of the values of all pairs of the column. No two threads write the same element.
+template <class ElemType>
+__global__ void _scatterSortedToSparseBlockCol(
+    const int* sortedKeys, const int* sortedPositions, const ElemType* values, const GPUSPARSE_INDEX_TYPE* col2BlockIds,
+    ElemType* resultValues, const int numRows, const int numCols, const CUDA_LONG numIndices)
+{
+    const CUDA_LONG index = blockIdx.x * blockDim.x + threadIdx.x;
+    if (index >= numIndices * numRows)
+        return;
+
+    const CUDA_LONG k = index / numRows;
+    const int row = index % numRows;
+    const int col = sortedKeys[k];
+    if (col == numCols || (k > 0 && sortedKeys[k - 1] == col))
+        return;
+
+    ElemType sum = 0;
+    for (CUDA_LONG j = k; j < numIndices && sortedKeys[j] == col; j++)
+        sum += values[(size_t) sortedPositions[j] * numRows + row];
+    resultValues[(size_t) col2BlockIds[col] * numRows + row] += sum;
+}
+
 // backward pass from hidden layer to feature weight
 //result (sparse BlockCol)= alpha * (lhs (dense) X rhs^T (sparse CSC)
 //assume resultValues are 0-initialized
@@ -4105,7 +4305,8 @@ __global__ void _normalGradForSparseBlock(
     ElemType* lhsValues, // lhs is blockCol or blockRow
     const GPUSPARSE_INDEX_TYPE* blockIds,
     ElemType* rhs,
-    bool unitGainMomentum)
+    bool unitGainMomentum,
+    const ElemType* lazySteps) // step counters of lazy updates (blockCol only), or nullptr
 {
     const ElemType unitGainFactor = unitGainMomentum ? (1.0 - momentum) : 1.0;
     const CUDA_LONG index = blockIdx.x * blockDim.x + threadIdx.x;
@@ -4126,7 +4327,10 @@ __global__ void _normalGradForSparseBlock(
         col = index - numCols * blockId;
         row = blockIds[blockId];
     }
-    rhs[IDX2C(row, col, numRows)] = unitGainFactor * lhsValues[index] + momentum * rhs[IDX2C(row, col, numRows)];
+    ElemType decay = momentum;
+    if (lazySteps)
+        decay *= pow_(momentum, LazySparseUpdate::NumMissedSteps(lazySteps, col, numCols));
+    rhs[IDX2C(row, col, numRows)] = unitGainFactor * lhsValues[index] + decay * rhs[IDX2C(row, col, numRows)];
     lhsValues[index] = rhs[IDX2C(row, col, numRows)];
 }
 
@@ -4720,6 +4924,196 @@ __global__ void _assignElementProductOfWithShiftNeg(
     }
 }
 
+// The kernels of CosSimilarityWithNegativeSamples(). Each block computes one column, the threads of a block stride over its rows,
+// and the partial sums of the threads are reduced in shared memory. blockDim.x must be a power of 2 (and at most 512).
+template <class ElemType>
+__device__ ElemType _blockSum(ElemType* partials, ElemType v)
+{
+    partials[threadIdx.x] = v;
+    __syncthreads();
+    for (int i = blockDim.x / 2; i > 0; i /= 2)
+    {
+        if (threadIdx.x < i)
+            partials[threadIdx.x] += partials[threadIdx.x + i];
+        __syncthreads();
+    }
+    ElemType sum = partials[0];
+    __syncthreads(); // (before 'partials' is used again)
+    return sum;
+}
+
+// the inverse norms of the columns of a (blockIdx.y == 0) resp. b (blockIdx.y == 1)
+template <class ElemType>
+__global__ void _columnInverseNorms(
+    const ElemType* a,
+    const ElemType* b,
+    ElemType* invNormA,
+    ElemType* invNormB,
+    const CUDA_LONG numRows)
+{
+    __shared__ ElemType partials[512];
+    const ElemType* col = (blockIdx.y == 0 ? a : b) + (size_t)blockIdx.x * numRows;
+    ElemType sum = 0;
+    for (CUDA_LONG k = threadIdx.x; k < numRows; k += blockDim.x)
+        sum += col[k] * col[k];
+    sum = _blockSum(partials, sum);
+    if (threadIdx.x == 0)
+    {
+        ElemType norm = sqrt(sum);
+        (blockIdx.y == 0 ? invNormA : invNormB)[blockIdx.x] = 1 / (norm < (ElemType) EPS_IN_INVERSE ? (ElemType) EPS_IN_INVERSE : norm); // (as AssignElementInverseOf())
+    }
+}
+
+// all cosine similarities of column j of a: with column j of b, and with the negative samples (j + shift + i - 1) % n
+template <class ElemType>
+__global__ void _cosSimilarityWithNegativeSamples(
+    const ElemType* a,
+    const ElemType* b,
+    const ElemType* invNormA,
+    const ElemType* invNormB,
+    ElemType* c,
+    const CUDA_LONG numRows,
+    const CUDA_LONG n,
+    const CUDA_LONG shift,
+    const CUDA_LONG numSamples) // negNumber + 1
+{
+    __shared__ ElemType partials[512];
+    const CUDA_LONG j = blockIdx.x;
+    const ElemType* aj = a + (size_t)j * numRows;
+    for (CUDA_LONG i = 0; i < numSamples; i++)
+    {
+        const CUDA_LONG s = i == 0 ? j : (j + shift + i - 1) % n;
+        const ElemType* bs = b + (size_t)s * numRows;
+        ElemType sum = 0;
+        for (CUDA_LONG k = threadIdx.x; k < numRows; k += blockDim.x)
+            sum += aj[k] * bs[k];
+        sum = _blockSum(partials, sum);
+        if (threadIdx.x == 0)
+            c[IDX2C(i, j, numSamples)] = sum * invNormA[j] * invNormB[s];
+    }
+}
+
+// gradient(:, j) += the gradient w.r.t. column j of a (inputIndex 0) or b (inputIndex 1), see CPUMatrix
+// The coefficients of the columns of the other input are computed first, into shared memory [numSamples] of each.
+template <class ElemType>
+__global__ void _addCosSimilarityWithNegativeSamplesGradient(
+    const CUDA_LONG inputIndex,
+    const ElemType* self,
+    const ElemType* other,
+    const ElemType* invNormSelf,
+    const ElemType* invNormOther,
+    const ElemType* c,
+    const ElemType* cGradient,
+    ElemType* gradient,
+    const CUDA_LONG numRows,
+    const CUDA_LONG n,
+    const CUDA_LONG shift,
+    const CUDA_LONG numSamples)
+{
+    extern __shared__ char sharedBuffer[];
+    ElemType* otherCoefs = (ElemType*)sharedBuffer;
+    ElemType* cCoefs = otherCoefs + numSamples;
+    CUDA_LONG* otherCols = (CUDA_LONG*)(cCoefs + numSamples);
+
+    const CUDA_LONG j = blockIdx.x;
+    for (CUDA_LONG i = threadIdx.x; i < numSamples; i += blockDim.x)
+    {
+        const CUDA_LONG shifted = i == 0 ? 0 : (shift + i - 1) % n;
+        const CUDA_LONG o = inputIndex == 0 ? (j + shifted) % n : (j + n - shifted) % n;
+        const CUDA_LONG col = inputIndex == 0 ? j : o; // the column of c that holds the pair
+        const ElemType g = cGradient[IDX2C(i, col, numSamples)];
+        otherCoefs[i] = g * invNormSelf[j] * invNormOther[o];
+        cCoefs[i] = g * c[IDX2C(i, col, numSamples)];
+        otherCols[i] = o;
+    }
+    __syncthreads();
+
+    ElemType selfCoef = 0;
+    for (CUDA_LONG i = 0; i < numSamples; i++)
+        selfCoef += cCoefs[i];
+    selfCoef *= invNormSelf[j] * invNormSelf[j];
+
+    const ElemType* selfj = self + (size_t)j * numRows;
+    ElemType* gradj = gradient + (size_t)j * numRows;
+    for (CUDA_LONG k = threadIdx.x; k < numRows; k += blockDim.x)
+    {
+        ElemType sum = -selfCoef * selfj[k];
+        for (CUDA_LONG i = 0; i < numSamples; i++)
+            sum += otherCoefs[i] * other[(size_t)otherCols[i] * numRows + k];
+        gradj[k] += sum;
+    }
+}
+
+// The kernels of LambdaRankMetrics() and AddLambdaRankGradient(). Each block computes one query, the threads of a block stride
+// over its urls, see CPUMatrix. blockDim.x must be a power of 2 (and at most 512).
+template <class ElemType>
+__global__ void _lambdaRankMetrics(
+    const ElemType* gains,
+    const ElemType* scores,
+    const ElemType* queryBegins,
+    ElemType* ranks,
+    ElemType* metrics)
+{
+    __shared__ ElemType partials[512];
+    const CUDA_LONG q = blockIdx.x;
+    const CUDA_LONG begin = (CUDA_LONG) queryBegins[q];
+    const CUDA_LONG end = (CUDA_LONG) queryBegins[q + 1];
+    ElemType idealMetric = 0, metric = 0;
+    for (CUDA_LONG i = begin + threadIdx.x; i < end; i += blockDim.x)
+    {
+        CUDA_LONG rank = 0;
+        for (CUDA_LONG j = begin; j < end; j++)
+        {
+            if (j != i && LambdaRank::Precedes(scores[j], gains[j], (long) j, scores[i], gains[i], (long) i))
+                rank++;
+        }
+        ranks[i] = (ElemType) rank;
+        idealMetric += gains[i] / (ElemType) log(2.0 + (i - begin));
+        metric += gains[i] / (ElemType) log(2.0 + rank);
+    }
+    idealMetric = _blockSum(partials, idealMetric);
+    metric = _blockSum(partials, metric);
+    if (threadIdx.x == 0)
+    {
+        metrics[IDX2C(0, q, 2)] = idealMetric;
+        metrics[IDX2C(1, q, 2)] = metric;
+    }
+}
+
+template <class ElemType>
+__global__ void _addLambdaRankGradient(
+    const ElemType* gains,
+    const ElemType* scores,
+    const ElemType* queryBegins,
+    const ElemType* ranks,
+    const ElemType* metrics,
+    const ElemType sigma,
+    ElemType* gradient)
+{
+    const CUDA_LONG q = blockIdx.x;
+    const CUDA_LONG begin = (CUDA_LONG) queryBegins[q];
+    const CUDA_LONG end = (CUDA_LONG) queryBegins[q + 1];
+    if (begin == end)
+        return;
+    const ElemType minGain = gains[end - 1];
+    const ElemType idealMetric = metrics[IDX2C(0, q, 2)];
+    for (CUDA_LONG u = begin + threadIdx.x; u < end; u += blockDim.x)
+    {
+        ElemType sum = 0;
+        for (CUDA_LONG i = begin; i < u; i++)
+        {
+            if (gains[i] > minGain)
+                sum -= LambdaRank::PairLambda(gains[i], scores[i], ranks[i], gains[u], scores[u], ranks[u], idealMetric, sigma);
+        }
+        if (gains[u] > minGain)
+        {
+            for (CUDA_LONG j = u + 1; j < end; j++)
+                sum += LambdaRank::PairLambda(gains[u], scores[u], ranks[u], gains[j], scores[j], ranks[j], idealMetric, sigma);
+        }
+        gradient[u] += sum;
+    }
+}
+
 template <class ElemType>
 __global__ void _innerProductWithShiftNeg(
     ElemType* c,
@@ -5164,6 +5558,94 @@ __global__ void _copyTopKResults(const uint64_t* indexes, const ElemType* values
     maxValues[id] = values[icol * crow + irow];
 }
 
+// Per-column top-k for small k, without sorting the matrix. One block per column: each thread keeps the topK largest
+// values of its strided part of the column as a sorted list, then the lists are merged pairwise in shared memory.
+// The results are sorted in descending order. Ties go to the smaller row index, as with the sort-based implementation.
+// Entries with index -1 are empty, and rank below everything.
+template <class ElemType>
+__device__ __forceinline__ bool _topKPrecedes(ElemType v1, int i1, ElemType v2, int i2)
+{
+    if (i2 < 0)
+        return i1 >= 0;
+    if (i1 < 0)
+        return false;
+    return v1 > v2 || (v1 == v2 && i1 < i2);
+}
+
+template <int BlockSize, int MaxTopK, class ElemType>
+__global__ void _vectorMaxTopK(const ElemType* us, ElemType* maxIndexes, ElemType* maxValues, CUDA_LONG crow, int topK)
+{
+    __shared__ ElemType values[BlockSize * MaxTopK];
+    __shared__ int indexes[BlockSize * MaxTopK];
+
+    const ElemType* col = us + (size_t)blockIdx.x * crow;
+    ElemType v[MaxTopK];
+    int idx[MaxTopK];
+    for (int k = 0; k < topK; k++)
+    {
+        v[k] = 0;
+        idx[k] = -1;
+    }
+
+    // insert this thread's values into its sorted list
+    for (CUDA_LONG irow = threadIdx.x; irow < crow; irow += BlockSize)
+    {
+        ElemType val = col[irow];
+        if (!_topKPrecedes(val, (int)irow, v[topK - 1], idx[topK - 1]))
+            continue;
+        int k = topK - 1;
+        for (; k > 0 && _topKPrecedes(val, (int)irow, v[k - 1], idx[k - 1]); k--)
+        {
+            v[k] = v[k - 1];
+            idx[k] = idx[k - 1];
+        }
+        v[k] = val;
+        idx[k] = (int)irow;
+    }
+    for (int k = 0; k < topK; k++)
+    {
+        values[threadIdx.x * topK + k] = v[k];
+        indexes[threadIdx.x * topK + k] = idx[k];
+    }
+    __syncthreads();
+
+    // merge the lists of threads tid and tid + stride into the one of tid
+    for (int stride = BlockSize / 2; stride > 0; stride /= 2)
+    {
+        if (threadIdx.x < stride)
+        {
+            const int a = threadIdx.x * topK;
+            const int b = (threadIdx.x + stride) * topK;
+            int ia = 0, ib = 0;
+            for (int k = 0; k < topK; k++)
+            {
+                if (_topKPrecedes(values[a + ia], indexes[a + ia], values[b + ib], indexes[b + ib]))
+                {
+                    v[k] = values[a + ia];
+                    idx[k] = indexes[a + ia++];
+                }
+                else
+                {
+                    v[k] = values[b + ib];
+                    idx[k] = indexes[b + ib++];
+                }
+            }
+            for (int k = 0; k < topK; k++)
+            {
+                values[a + k] = v[k];
+                indexes[a + k] = idx[k];
+            }
+        }
+        __syncthreads();
+    }
+
+    for (int k = threadIdx.x; k < topK; k += BlockSize)
+    {
+        maxValues[(size_t)blockIdx.x * topK + k] = values[k];
+        maxIndexes[(size_t)blockIdx.x * topK + k] = (ElemType)indexes[k];
+    }
+}
+
 template <int BlockSize, class ElemType>
 __global__ void _assignNumOfDiffCol(const ElemType* a, const ElemType* b, ElemType* c, CUDA_LONG crowB, CUDA_LONG ccol)
 {
@@ -5216,6 +5698,33 @@ __global__ void _maskColumnsValue(ElemType* a, const char* columnsMask, CUDA_LON
     }
 }
 
+template <class ElemType>
+__global__ void _assignPackedBFloat16Of(CUDA_LONG size, const ElemType* values, uint16_t* packed, unsigned long seed)
+{
+    CUDA_LONG idx = blockIdx.x * blockDim.x + threadIdx.x;
+    CUDA_LONG stride = blockDim.x * gridDim.x;
+    for (; idx < size; idx += stride)
+        packed[idx] = BFloat16::Round((float)values[idx], BFloat16::RandomBits(seed, idx));
+}
+
+template <class ElemType>
+__global__ void _assignUnpackedBFloat16Of(CUDA_LONG size, const uint16_t* packed, ElemType* values)
+{
+    CUDA_LONG idx = blockIdx.x * blockDim.x + threadIdx.x;
+    CUDA_LONG stride = blockDim.x * gridDim.x;
+    for (; idx < size; idx += stride)
+        values[idx] = (ElemType)BFloat16::ToFloat(packed[idx]);
+}
+
+// a block per chunk of the table, see MultiTensorUpdate.h
+template <class ElemType>
+__global__ void _multiTensorUpdate(const MultiTensorUpdateParams<ElemType> params, const MultiTensorChunkTable<ElemType> table)
+{
+    const MultiTensorChunk<ElemType>& chunk = table.chunks[blockIdx.x];
+    for (int i = threadIdx.x; i < chunk.size; i += blockDim.x)
+        params.Update(chunk, i);
+}
+
 template <class ElemType>
 __global__ void _adam(CUDA_LONG size, ElemType* grad, ElemType* smoothAda, ElemType* smoothMom, ElemType* val,
     ElemType lr, ElemType mom, ElemType adaWeight, ElemType adaMul, ElemType epsilon, bool unitGainMomentum, bool adamax)
@@ -5311,6 +5820,106 @@ __global__ void _adam4BlockSparseCol(CUDA_LONG size,
     }
 }
 
+// lazy updates of block-sparse column gradients, see LazySparseUpdate.h
+template <class ElemType>
+__global__ void _advanceLazyUpdateStep(ElemType* steps, const size_t numCols)
+{
+    LazySparseUpdate::AdvanceStep(steps, numCols);
+}
+
+// to be launched after the update kernel, which reads the step of the last update
+template <class ElemType>
+__global__ void _setLazyUpdated(ElemType* steps, const GPUSPARSE_INDEX_TYPE* blockId2ColOrRow, const size_t numBlocks, const size_t numCols)
+{
+    CUDA_LONG blockId = blockIdx.x * blockDim.x + threadIdx.x;
+    if (blockId >= numBlocks)
+        return;
+    LazySparseUpdate::SetUpdated(steps, blockId2ColOrRow[blockId], numCols);
+}
+
+// like _fsadagrad4BlockSparseCol, but only for the nz elements of the blocks (one thread each)
+template <class ElemType>
+__global__ void _fsadagrad4BlockSparseColLazy(CUDA_LONG nz,
+    ElemType* grad_bsc, const GPUSPARSE_INDEX_TYPE* blockId2ColOrRow, const size_t len, const size_t numCols, const ElemType* steps,
+    ElemType* smoothAda, ElemType* smoothMom, ElemType* val,
+    ElemType lr, ElemType mom, ElemType adaWeight, ElemType adaMul, bool unitGainMomentum)
+{
+    const ElemType unitGainFactor = unitGainMomentum ? (1.0 - mom) : 1.0;
+    CUDA_LONG id = blockIdx.x * blockDim.x + threadIdx.x;
+    if (id >= nz)
+        return;
+    CUDA_LONG blockId = id / len;
+    CUDA_LONG col = blockId2ColOrRow[blockId];
+    CUDA_LONG idx = col * len + (id - blockId * len);
+    ElemType numMissedSteps = LazySparseUpdate::NumMissedSteps(steps, col, numCols);
+
+    ElemType g = grad_bsc[id];
+    ElemType adaSqr = adaWeight * pow_(adaWeight, numMissedSteps) * smoothAda[idx] + (1.0f - adaWeight) * g * g;
+    smoothAda[idx] = adaSqr;
+    if (adaSqr != 0.0f)
+    {
+        ElemType w;
+        if (sizeof(ElemType) == sizeof(double))
+        {
+            w = adaMul * rsqrt(adaSqr);
+        }
+        else
+        {
+            w = adaMul * rsqrtf(adaSqr);
+        }
+
+        if (w > 10.0f)
+            w = 10.0f;
+        g *= w;
+    }
+
+    if (mom > 0.0f)
+    {
+        g = mom * pow_(mom, numMissedSteps) * smoothMom[idx] + unitGainFactor * g;
+        smoothMom[idx] = g;
+    }
+
+    g *= lr;
+    val[idx] -= g;
+}
+
+// like _adam4BlockSparseCol, but only for the nz elements of the blocks (one thread each)
+template <class ElemType>
+__global__ void _adam4BlockSparseColLazy(CUDA_LONG nz,
+    ElemType* grad_bsc, const GPUSPARSE_INDEX_TYPE* blockId2ColOrRow, const size_t len, const size_t numCols, const ElemType* steps,
+    ElemType* smoothAda, ElemType* smoothMom, ElemType* val,
+    ElemType lr, ElemType mom, ElemType adaWeight, ElemType adaMul, ElemType epsilon, bool unitGainMomentum, bool adamax)
+{
+    const ElemType unitGainFactor = unitGainMomentum ? (1.0 - mom) : 1.0;
+    CUDA_LONG id = blockIdx.x * blockDim.x + threadIdx.x;
+    if (id >= nz)
+        return;
+    CUDA_LONG blockId = id / len;
+    CUDA_LONG col = blockId2ColOrRow[blockId];
+    CUDA_LONG idx = col * len + (id - blockId * len);
+    ElemType numMissedSteps = LazySparseUpdate::NumMissedSteps(steps, col, numCols);
+    ElemType adaDecay = adaWeight * pow_(adaWeight, numMissedSteps);
+
+    ElemType g = grad_bsc[id];
+    ElemType w;
+    if (!adamax)
+    {
+        ElemType adaSqr = adaDecay * smoothAda[idx] + (1.0f - adaWeight) * g * g;
+        smoothAda[idx] = adaSqr;
+        w = adaMul / (sqrt_(adaSqr) + epsilon);
+    }
+    else
+    {
+        smoothAda[idx] = max(adaDecay * smoothAda[idx], fabs_(g));
+        w = adaMul / smoothAda[idx];
+    }
+
+    g = mom * pow_(mom, numMissedSteps) * smoothMom[idx] + unitGainFactor * g;
+    smoothMom[idx] = g;
+    g = lr*g*w;
+    val[idx] -= g;
+}
+
 template <class ElemType>
 __global__ void _adadelta(CUDA_LONG size, ElemType* grad, ElemType* smoothAda, ElemType* smoothX2, ElemType* val,
     ElemType learningRate, ElemType rho, ElemType epsilon)
@@ -5368,7 +5977,9 @@ __global__ void _adadelta4BlockSparseCol(CUDA_LONG size,
 }
 
 // Calculate alpha in forward-backward calculation. equation (6), (7) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
-// GPU x dimension corresponds to utterances, y dimension corresponds to phone sequence in each utterance
+// One thread block per utterance: the threads of a block stride over the labels of the utterance (phone sequence),
+// and the block steps through all frames of the utterance, synchronizing between frames. This way the recursion of all
+// utterances of the minibatch takes a single kernel launch, instead of one launch per frame.
 // prob (input): the posterior output from the network
 // alpha (output): alpha for forward-backward calculation. 
 // phoneSeq (input): phone ID sequence for each utterance in this minibatch, each col is one utterance 
@@ -5379,7 +5990,6 @@ __global__ void _adadelta4BlockSparseCol(CUDA_LONG size,
 // uttPhoneNum (input): the phone number of each utterance. The size of this vector =  the number of all utterances in this minibatch
 // numChannels (input): channel number in this minibatch
 // uttNum (input): number of utterances
-// t (input): time stamp to process
 // maxPhoneNum (input): the max number of phones between utterances
 // totalPhoneNum (input): the total number of phones of all utterances
 // blankTokenId (input): id of the CTC blank token
@@ -5387,34 +5997,24 @@ __global__ void _adadelta4BlockSparseCol(CUDA_LONG size,
 //      Alpha and Beta scores outside of the delay boundary are set to zero.
 //      Setting this parameter smaller will result in shorted delay between label output during decoding.
 //      delayConstraint=-1 means no constraint
+// This helper computes alpha_t(s) for a single label s at frame t; the kernel _assignAlphaScore follows it.
 template<class ElemType>
-__global__ void _assignAlphaScore(
+__device__ void _assignAlphaScoreOfLabel(
     const ElemType *prob,
     ElemType *alphaScore,
     ElemType *phoneSeq,
     ElemType *phoneBound,
     const size_t *uttToChanInd,
-    const size_t *uttFrameNum,
     const size_t *uttBeginFrame,
-    const size_t *uttPhoneNum,
     size_t numChannels,
-    const size_t uttNum,
-    const size_t  t,
-    const size_t maxPhoneNum, // Maximum length of utterance in this MB
-    const size_t totalPhoneNum, // Total number of phones
+    const LONG64 uttId,
+    const LONG64 t,
+    const LONG64 phoneSeqId,
+    const size_t maxPhoneNum,
+    const size_t totalPhoneNum,
     const size_t blankTokenId,
     const int delayConstraint)
 {
-    LONG64 uttId = blockDim.x * blockIdx.x + threadIdx.x;
-    // Index of the label in the sequence
-    LONG64 phoneSeqId = blockDim.y * blockIdx.y + threadIdx.y;
-
-    // Number of phones and frames in this utterance
-    LONG64 phoneNum = uttPhoneNum[uttId]; 
-    LONG64 frameNum = uttFrameNum[uttId];
-
-    if (uttId >= uttNum || phoneSeqId >= phoneNum - 1 || t >= frameNum || phoneSeqId == 0) return;
-
     // Current and previous phone indices in phoneSeq matrix
     LONG64 labelid = uttId*maxPhoneNum + phoneSeqId;
     LONG64 labelid_2 = labelid - 2;
@@ -5491,34 +6091,63 @@ __global__ void _assignAlphaScore(
     }
 }
 
-// Calculate beta in forward-backward calculation, equation (10), (11) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
-// See _assignAlphaScore for the explanation of parameters
+// one thread block per utterance, see above
 template<class ElemType>
-__global__ void _assignBetaScore(
+__global__ void _assignAlphaScore(
     const ElemType *prob,
-    ElemType *betaScore,
+    ElemType *alphaScore,
     ElemType *phoneSeq,
     ElemType *phoneBound,
     const size_t *uttToChanInd,
     const size_t *uttFrameNum,
     const size_t *uttBeginFrame,
     const size_t *uttPhoneNum,
-    const size_t numChannels,
+    size_t numChannels,
     const size_t uttNum,
-    const size_t  t,
-    const size_t maxPhoneNum,
-    const size_t totalPhoneNum,
+    const size_t maxPhoneNum, // Maximum length of utterance in this MB
+    const size_t totalPhoneNum, // Total number of phones
     const size_t blankTokenId,
     const int delayConstraint)
 {
-    LONG64 uttId = blockDim.x * blockIdx.x + threadIdx.x;
-    // Index of the label in the sequence
-    LONG64 phoneSeqId = blockDim.y * blockIdx.y + threadIdx.y;
+    LONG64 uttId = blockIdx.x;
+    if (uttId >= uttNum) return; // (uniformly for the whole block)
+
+    // Number of phones and frames in this utterance
     LONG64 phoneNum = uttPhoneNum[uttId];
     LONG64 frameNum = uttFrameNum[uttId];
 
-    if (uttId >= uttNum || phoneSeqId >= phoneNum - 1 || t >= frameNum || phoneSeqId == 0) return;
+    for (LONG64 t = 0; t < frameNum; t++)
+    {
+        // Index of the label in the sequence
+        for (LONG64 phoneSeqId = 1 + threadIdx.x; phoneSeqId < phoneNum - 1; phoneSeqId += blockDim.x)
+            _assignAlphaScoreOfLabel(prob, alphaScore, phoneSeq, phoneBound, uttToChanInd, uttBeginFrame, numChannels,
+                                     uttId, t, phoneSeqId, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
+        __syncthreads(); // alpha_t must be complete before alpha_{t+1} is computed from it
+    }
+}
 
+// Calculate beta in forward-backward calculation, equation (10), (11) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
+// See _assignAlphaScore for the explanation of parameters
+// This helper computes beta_t(s) for a single label s at frame t; the kernel _assignBetaScore follows it.
+template<class ElemType>
+__device__ void _assignBetaScoreOfLabel(
+    const ElemType *prob,
+    ElemType *betaScore,
+    ElemType *phoneSeq,
+    ElemType *phoneBound,
+    const size_t *uttToChanInd,
+    const size_t *uttBeginFrame,
+    const size_t numChannels,
+    const LONG64 uttId,
+    const LONG64 t,
+    const LONG64 phoneSeqId,
+    const LONG64 phoneNum,
+    const LONG64 frameNum,
+    const size_t maxPhoneNum,
+    const size_t totalPhoneNum,
+    const size_t blankTokenId,
+    const int delayConstraint)
+{
     LONG64 labelid = uttId*maxPhoneNum + phoneSeqId;
     LONG64 labelid_2 = labelid + 2;
     LONG64 phoneId = (LONG64)(phoneSeq[labelid]);
@@ -5581,6 +6210,40 @@ __global__ void _assignBetaScore(
     }
 }
 
+// one thread block per utterance, stepping backwards through its frames, see _assignAlphaScore
+template<class ElemType>
+__global__ void _assignBetaScore(
+    const ElemType *prob,
+    ElemType *betaScore,
+    ElemType *phoneSeq,
+    ElemType *phoneBound,
+    const size_t *uttToChanInd,
+    const size_t *uttFrameNum,
+    const size_t *uttBeginFrame,
+    const size_t *uttPhoneNum,
+    const size_t numChannels,
+    const size_t uttNum,
+    const size_t maxPhoneNum,
+    const size_t totalPhoneNum,
+    const size_t blankTokenId,
+    const int delayConstraint)
+{
+    LONG64 uttId = blockIdx.x;
+    if (uttId >= uttNum) return; // (uniformly for the whole block)
+
+    LONG64 phoneNum = uttPhoneNum[uttId];
+    LONG64 frameNum = uttFrameNum[uttId];
+
+    for (LONG64 t = frameNum - 1; t >= 0; t--)
+    {
+        // Index of the label in the sequence
+        for (LONG64 phoneSeqId = 1 + threadIdx.x; phoneSeqId < phoneNum - 1; phoneSeqId += blockDim.x)
+            _assignBetaScoreOfLabel(prob, betaScore, phoneSeq, phoneBound, uttToChanInd, uttBeginFrame, numChannels,
+                                    uttId, t, phoneSeqId, phoneNum, frameNum, maxPhoneNum, totalPhoneNum, blankTokenId, delayConstraint);
+        __syncthreads(); // beta_t must be complete before beta_{t-1} is computed from it
+    }
+}
+
 // Calculate derivative, equation (15) in ftp://ftp.idsia.ch/pub/juergen/icml2006.pdf
 // See _assignAlphaScore for the explanation of parameters
 template<class ElemType>
@@ -5748,6 +6411,48 @@ __global__ void _assignOneHotAsSparse(ElemType *indices,
     }
 }
 
+// tiled transpose of a batch of matrices: c[i0 + i1 * ldc] = beta * c[i0 + i1 * ldc] + alpha * a[i1 + i0 * lda]
+// Each block transposes one tile through shared memory, so that both the reads from a and the writes to c are coalesced.
+// blockDim = (TRANSPOSE_TILE_DIM, TRANSPOSE_BLOCK_ROWS), gridDim = (tiles along i0, tiles along i1, batch)
+#define TRANSPOSE_TILE_DIM 32
+#define TRANSPOSE_BLOCK_ROWS 8
+template <class ElemType>
+__global__ void _transposeTiled(ElemType beta, const ElemType* a, ElemType* c, ElemType alpha,
+                                const CUDA_LONG n0, const CUDA_LONG n1, const size_t lda, const size_t ldc, const size_t batchStrideA, const size_t batchStrideC)
+{
+    __shared__ ElemType tile[TRANSPOSE_TILE_DIM][TRANSPOSE_TILE_DIM + 1]; // padded against shared-memory bank conflicts when reading columns
+
+    a += blockIdx.z * batchStrideA;
+    c += blockIdx.z * batchStrideC;
+    const CUDA_LONG tile0 = blockIdx.x * TRANSPOSE_TILE_DIM;
+    const CUDA_LONG tile1 = blockIdx.y * TRANSPOSE_TILE_DIM;
+
+    // read the tile, consecutive threads reading consecutive elements of a
+    CUDA_LONG i1 = tile1 + threadIdx.x;
+    for (CUDA_LONG k = threadIdx.y; k < TRANSPOSE_TILE_DIM; k += TRANSPOSE_BLOCK_ROWS)
+    {
+        const CUDA_LONG i0 = tile0 + k;
+        if (i0 < n0 && i1 < n1)
+            tile[k][threadIdx.x] = a[i1 + i0 * lda];
+    }
+    __syncthreads();
+
+    // write it transposed, consecutive threads writing consecutive elements of c
+    const CUDA_LONG i0 = tile0 + threadIdx.x;
+    for (CUDA_LONG k = threadIdx.y; k < TRANSPOSE_TILE_DIM; k += TRANSPOSE_BLOCK_ROWS)
+    {
+        i1 = tile1 + k;
+        if (i0 < n0 && i1 < n1)
+        {
+            ElemType* out = c + i0 + i1 * ldc;
+            ElemType val = alpha * tile[threadIdx.x][k];
+            if (beta != 0) // if beta is 0, then out is not read
+                val += beta * *out;
+            *out = val;
+        }
+    }
+}
+
 }}}
 
 #endif // !CPUONLY
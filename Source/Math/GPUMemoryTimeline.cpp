@@ -0,0 +1,235 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GPUMemoryTimeline.cpp -- optional tracing of the GPU allocations, see GPUMemoryTimeline.h
+//
+
+#include "stdafx.h"
+#include "GPUMemoryTimeline.h"
+#include "Basics.h"
+#include "fileutil.h"
+#include "Platform.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+using namespace std;
+
+// owner of the allocations made on this thread, see ScopedGPUMemoryOwner (POD, for __declspec(thread))
+static THREAD_LOCAL const wchar_t* t_ownerNodeName = nullptr;
+static THREAD_LOCAL bool t_ownerBackprop = false;
+
+static const wchar_t* c_noOwner = L"(outside of node evaluation)";
+
+// the timeline is capped, so that a long run does not trace itself out of host memory
+static const size_t c_maxTimelineEvents = 1 << 20;
+
+struct LiveAllocation
+{
+    int deviceId;
+    size_t bytes;
+    wstring owner;
+    double allocatedMs;
+};
+
+struct TimelineEvent
+{
+    double ms;
+    int deviceId;
+    long long bytes; // negative for frees
+    size_t liveBytes;
+    wstring owner;
+};
+
+struct DeviceUsage
+{
+    size_t liveBytes;
+    size_t peakBytes;
+};
+
+static atomic<bool> s_enabled(false);
+static mutex s_mutex; // controls access to all of the following
+static wstring s_timelinePath;
+static size_t s_topN = 20;
+static chrono::steady_clock::time_point s_startTime;
+static unordered_map<const void*, LiveAllocation> s_liveAllocations;
+static map<int, DeviceUsage> s_deviceUsage;
+static vector<TimelineEvent> s_timeline;
+static bool s_timelineTruncated = false;
+
+static double ElapsedMs()
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - s_startTime).count();
+}
+
+static wstring CurrentOwner()
+{
+    if (!t_ownerNodeName)
+        return c_noOwner;
+    return wstring(t_ownerNodeName) + (t_ownerBackprop ? L" (backprop)" : L" (forward)");
+}
+
+// s_mutex must be held
+static void AppendEvent(int deviceId, long long bytes, size_t liveBytes, const wstring& owner)
+{
+    if (s_timeline.size() >= c_maxTimelineEvents)
+    {
+        if (!s_timelineTruncated)
+            fprintf(stderr, "WARNING: GPUMemoryTimeline: More than %d events, the rest of the timeline is not recorded.\n", (int)c_maxTimelineEvents);
+        s_timelineTruncated = true;
+        return;
+    }
+    s_timeline.push_back({ ElapsedMs(), deviceId, bytes, liveBytes, owner });
+}
+
+/*static*/ void GPUMemoryTimeline::Enable(const wstring& timelinePath, size_t topN)
+{
+    lock_guard<mutex> lock(s_mutex);
+    s_timelinePath = timelinePath;
+    s_topN = topN;
+    if (!s_enabled)
+    {
+        s_startTime = chrono::steady_clock::now();
+        s_liveAllocations.clear();
+        s_deviceUsage.clear();
+        s_timeline.clear();
+        s_timelineTruncated = false;
+    }
+    s_enabled = true;
+}
+
+/*static*/ void GPUMemoryTimeline::Disable()
+{
+    s_enabled = false;
+}
+
+/*static*/ bool GPUMemoryTimeline::IsEnabled()
+{
+    return s_enabled;
+}
+
+/*static*/ void GPUMemoryTimeline::OnAllocate(int deviceId, const void* ptr, size_t bytes)
+{
+    if (!s_enabled)
+        return;
+    auto owner = CurrentOwner();
+    lock_guard<mutex> lock(s_mutex);
+    auto& usage = s_deviceUsage[deviceId];
+    usage.liveBytes += bytes;
+    usage.peakBytes = (max)(usage.peakBytes, usage.liveBytes);
+    s_liveAllocations[ptr] = { deviceId, bytes, owner, ElapsedMs() };
+    AppendEvent(deviceId, (long long)bytes, usage.liveBytes, owner);
+}
+
+/*static*/ void GPUMemoryTimeline::OnFree(int deviceId, const void* ptr)
+{
+    if (!s_enabled)
+        return;
+    lock_guard<mutex> lock(s_mutex);
+    auto iter = s_liveAllocations.find(ptr);
+    if (iter == s_liveAllocations.end())
+        return; // allocated before tracing was enabled
+    auto& usage = s_deviceUsage[deviceId];
+    usage.liveBytes -= iter->second.bytes;
+    AppendEvent(deviceId, -(long long)iter->second.bytes, usage.liveBytes, iter->second.owner);
+    s_liveAllocations.erase(iter);
+}
+
+/*static*/ void GPUMemoryTimeline::OnAllocationFailure(int deviceId, size_t bytes)
+{
+    if (!s_enabled)
+        return;
+    size_t topN;
+    wstring timelinePath;
+    {
+        lock_guard<mutex> lock(s_mutex);
+        topN = s_topN;
+        timelinePath = s_timelinePath;
+    }
+    fprintf(stderr, "\nGPUMemoryTimeline: Failed to allocate %.1f MB on GPU %d while evaluating %ls.\n",
+            bytes / 1048576.0, deviceId, CurrentOwner().c_str());
+    PrintLiveAllocations(stderr, topN);
+    if (!timelinePath.empty())
+    {
+        try
+        {
+            WriteTimeline(timelinePath);
+        }
+        catch (const exception& e) // (must not hide the allocation failure)
+        {
+            fprintf(stderr, "WARNING: GPUMemoryTimeline: Cannot write the timeline: %s\n", e.what());
+        }
+    }
+}
+
+/*static*/ void GPUMemoryTimeline::WriteTimeline(const wstring& path)
+{
+    lock_guard<mutex> lock(s_mutex);
+    FILE* f = fopenOrDie(path, L"w");
+    fprintf(f, "timeMs,device,bytes,liveBytes,owner\n");
+    for (const auto& event : s_timeline)
+        fprintf(f, "%.3f,%d,%lld,%llu,\"%ls\"\n", event.ms, event.deviceId, event.bytes, (unsigned long long)event.liveBytes, event.owner.c_str());
+    fcloseOrDie(f);
+    fprintf(stderr, "GPUMemoryTimeline: Wrote %d events to %ls.\n", (int)s_timeline.size(), path.c_str());
+}
+
+/*static*/ void GPUMemoryTimeline::PrintLiveAllocations(FILE* f, size_t topN)
+{
+    lock_guard<mutex> lock(s_mutex);
+    for (const auto& usage : s_deviceUsage)
+        fprintf(f, "GPUMemoryTimeline: GPU %d: %.1f MB live (peak %.1f MB) in traced allocations.\n",
+                usage.first, usage.second.liveBytes / 1048576.0, usage.second.peakBytes / 1048576.0);
+
+    vector<const pair<const void* const, LiveAllocation>*> allocations;
+    map<wstring, pair<size_t, size_t>> bytesByOwner; // [owner] -> (bytes, number of allocations)
+    for (const auto& allocation : s_liveAllocations)
+    {
+        allocations.push_back(&allocation);
+        auto& total = bytesByOwner[allocation.second.owner];
+        total.first += allocation.second.bytes;
+        total.second++;
+    }
+
+    sort(allocations.begin(), allocations.end(), [](const pair<const void* const, LiveAllocation>* a, const pair<const void* const, LiveAllocation>* b)
+    {
+        return a->second.bytes > b->second.bytes;
+    });
+    fprintf(f, "GPUMemoryTimeline: Largest %d of %d live allocations:\n", (int)(min)(topN, allocations.size()), (int)allocations.size());
+    for (size_t i = 0; i < allocations.size() && i < topN; i++)
+    {
+        const auto& allocation = allocations[i]->second;
+        fprintf(f, "    %10.1f MB  GPU %d  allocated at %10.1f ms by %ls\n",
+                allocation.bytes / 1048576.0, allocation.deviceId, allocation.allocatedMs, allocation.owner.c_str());
+    }
+
+    vector<pair<wstring, pair<size_t, size_t>>> owners(bytesByOwner.begin(), bytesByOwner.end());
+    sort(owners.begin(), owners.end(), [](const pair<wstring, pair<size_t, size_t>>& a, const pair<wstring, pair<size_t, size_t>>& b)
+    {
+        return a.second.first > b.second.first;
+    });
+    fprintf(f, "GPUMemoryTimeline: Owners holding the most live memory:\n");
+    for (size_t i = 0; i < owners.size() && i < topN; i++)
+        fprintf(f, "    %10.1f MB in %5d allocations by %ls\n", owners[i].second.first / 1048576.0, (int)owners[i].second.second, owners[i].first.c_str());
+}
+
+ScopedGPUMemoryOwner::ScopedGPUMemoryOwner(const wchar_t* nodeName, bool backprop)
+    : m_prevNodeName(t_ownerNodeName), m_prevBackprop(t_ownerBackprop)
+{
+    t_ownerNodeName = nodeName;
+    t_ownerBackprop = backprop;
+}
+
+ScopedGPUMemoryOwner::~ScopedGPUMemoryOwner()
+{
+    t_ownerNodeName = m_prevNodeName;
+    t_ownerBackprop = m_prevBackprop;
+}
+
+}}}
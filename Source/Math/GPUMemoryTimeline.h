@@ -0,0 +1,54 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// GPUMemoryTimeline.h -- optional tracing of the GPU allocations of TracingGPUMemoryAllocator
+//
+// When enabled, every device allocation is recorded with its size, the time it was made, and its owner, which is the
+// node whose evaluation (forward or backprop) triggered it, see ScopedGPUMemoryOwner. Buffers handed out by the
+// MatrixPool are shared between nodes, so the owner is the node that first needed the memory, not every node using it.
+// Every allocation and free is also appended to a timeline of the live bytes per device.
+//
+// If an allocation fails, the largest live allocations and the owners holding the most memory are printed to stderr,
+// and the timeline is written as CSV (timeMs,device,bytes,liveBytes,owner) if a file was given to Enable().
+//
+
+#pragma once
+
+#include "CommonMatrix.h" // for MATH_API
+#include <cstdio>
+#include <string>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+class MATH_API GPUMemoryTimeline
+{
+public:
+    // start recording; allocations that are live already are not known and thus not reported
+    static void Enable(const std::wstring& timelinePath = std::wstring(), size_t topN = 20);
+    static void Disable();
+    static bool IsEnabled();
+
+    // called by TracingGPUMemoryAllocator
+    static void OnAllocate(int deviceId, const void* ptr, size_t bytes);
+    static void OnFree(int deviceId, const void* ptr);
+    static void OnAllocationFailure(int deviceId, size_t bytes);
+
+    static void WriteTimeline(const std::wstring& path);
+    static void PrintLiveAllocations(FILE* f, size_t topN);
+};
+
+// Scoped object that makes the given node the owner of the allocations made on this thread while it lives.
+// Scopes nest; the innermost one wins. nodeName must outlive the scope.
+class MATH_API ScopedGPUMemoryOwner
+{
+public:
+    ScopedGPUMemoryOwner(const wchar_t* nodeName, bool backprop);
+    ~ScopedGPUMemoryOwner();
+
+private:
+    const wchar_t* m_prevNodeName;
+    bool m_prevBackprop;
+};
+
+}}}
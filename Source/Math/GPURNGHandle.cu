@@ -11,7 +11,7 @@
 namespace Microsoft { namespace MSR { namespace CNTK {
 
 GPURNGHandle::GPURNGHandle(int deviceId, uint64_t seed, uint64_t offset)
-    : RNGHandle(deviceId)
+    : RNGHandle(deviceId), m_markedOffset(offset)
 {
     unsigned long long cudaSeed = seed;
     if (GetMathLibTraceLevel() > 0)
@@ -33,4 +33,20 @@ GPURNGHandle::GPURNGHandle(int deviceId, uint64_t seed, uint64_t offset)
         CURAND_CALL(curandDestroyGenerator(m_generator));
 }
 
+// curand can seek to any offset; the generator state is set up again when the next values are drawn
+/*virtual*/ void GPURNGHandle::Mark(uint64_t offset)
+{
+    m_markedOffset = offset;
+}
+
+/*virtual*/ void GPURNGHandle::RewindToMark()
+{
+    CURAND_CALL(curandSetGeneratorOffset(m_generator, m_markedOffset));
+}
+
+/*virtual*/ void GPURNGHandle::Resume(uint64_t offset)
+{
+    CURAND_CALL(curandSetGeneratorOffset(m_generator, offset));
+}
+
 }}}
@@ -21,6 +21,10 @@ public:
     GPURNGHandle(int deviceId, uint64_t seed, uint64_t offset = 0);
     virtual ~GPURNGHandle();
 
+    virtual void Mark(uint64_t offset) override;
+    virtual void RewindToMark() override;
+    virtual void Resume(uint64_t offset) override;
+
 #ifndef CPUONLY
     curandGenerator_t Generator()
     {
@@ -30,6 +34,7 @@ public:
 private:
     curandGenerator_t m_generator;
 #endif // !CPUONLY
+    uint64_t m_markedOffset;
 };
 
 }}}
@@ -743,7 +743,9 @@ void GPUSparseMatrix<ElemType>::RequireSizeAndAllocate(const size_t numRows, con
     size_t bufferSizeNeeded = BufferSizeNeeded(numRows, numCols, numNZElemToReserve, matrixFormat);
     bool reallocate = (BufferSizeAllocated() < bufferSizeNeeded || (!growOnly && BufferSizeAllocated() > bufferSizeNeeded));
 
-    if (reallocate)
+    // The buffer may be large enough while the layout reserves less non-zero elements than required
+    // (see SetMatrixFromCSCFormat), Allocate() then recomputes the layout for the whole buffer.
+    if (reallocate || GetSizeAllocated() < numNZElemToReserve)
         Allocate(numRows, numCols, numNZElemToReserve, growOnly, keepExistingValues);
 
 }
@@ -926,6 +928,19 @@ void GPUSparseMatrix<ElemType>::SetMatrixFromCSCFormat(const CPUSPARSE_INDEX_TYP
         // Here we have to wait for them to finish.
         transferer->RecordComputeStreamSyncPoint();
         transferer->WaitForSyncPointOnAssignStreamAsync();
+
+        // If the host arrays are laid out as our buffer (values, row indices, column starts back to back, as
+        // the reader packs them), the layout is shrunk to exactly nz elements and the matrix is set with a single copy.
+        if (sizeof(CPUSPARSE_INDEX_TYPE) == sizeof(GPUSPARSE_INDEX_TYPE) &&
+            (const char*)h_Row == (const char*)(h_Val + nz) &&
+            h_CSCCol == h_Row + nz)
+        {
+            assert(BufferSizeAllocated() >= BufferSizeNeeded(numRows, numCols, nz, matrixFormatSparseCSC));
+            SetSizeAllocated(nz);
+            transferer->CopyCPUToGPUAsync(h_Val, BufferSizeNeeded(numRows, numCols, nz, matrixFormatSparseCSC), 1, Buffer());
+            return;
+        }
+
         transferer->CopyCPUToGPUAsync(h_Val, nz, sizeof(ElemType), Data());
     }
     else
@@ -1046,6 +1061,9 @@ void GPUSparseMatrix<ElemType>::GetMatrixFromCSCFormat(GPUSPARSE_INDEX_TYPE*& h_
 
 #pragma region Static BLAS Functions
 
+// average number of nonzeros per column of a CSC matrix from which dense x sparse products split the work by nonzeros
+static const size_t SpMMMinNzPerColumnForNzBalancing = 8;
+
 // dense X sparse = dense
 template <class ElemType>
 void GPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const GPUMatrix<ElemType>& lhs, const bool transposeA,
@@ -1079,7 +1097,31 @@ void GPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const GPU
     c.PrepareDevice();
     if (rhs.GetFormat() == MatrixFormat::matrixFormatSparseCSC)
     {
-        ConvolveAndWeightedAdd(alpha, lhs, transposeA, rhs, transposeB, beta, c, 1, 1, false, false);
+        // The kernels that split the work by nonzeros need c to be scaled by beta first, and atomic adds, which does
+        // not pay off for a few nonzeros per column (one-hot inputs), where the work per column is balanced anyway.
+        // (The number of nonzeros is only known on the GPU; the allocated size is an upper bound of it.)
+        const int numRhsCols = (int) rhs.GetNumCols();
+        if (transposeB || rhs.GetSizeAllocated() >= SpMMMinNzPerColumnForNzBalancing * rhs.GetNumCols())
+        {
+            if (beta == 0)
+                c.SetValue(0);
+            else if (beta != 1)
+                GPUMatrix<ElemType>::Scale(beta, c);
+
+            dim3 blocksPerGrid((unsigned int) ((rhs.GetSizeAllocated() + SPMM_NZ_PER_BLOCK - 1) / SPMM_NZ_PER_BLOCK),
+                               (unsigned int) ((m + GridDim::maxThreadsPerBlock - 1) / GridDim::maxThreadsPerBlock));
+            SyncGuard syncGuard;
+            if (!transposeB)
+                _denseMultSparseCSCAndAddToDenseNzBalanced<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(
+                    m, k, numRhsCols, alpha, reinterpret_cast<const ElemType*>(lhs.Data()), transposeA,
+                    reinterpret_cast<const ElemType*>(rhs.Buffer()), rhs.RowLocation(), rhs.ColLocation(), reinterpret_cast<ElemType*>(c.Data()));
+            else
+                _denseMultSparseCSCTransposeAndAddToDenseNzBalanced<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(
+                    m, k, numRhsCols, alpha, reinterpret_cast<const ElemType*>(lhs.Data()), transposeA,
+                    reinterpret_cast<const ElemType*>(rhs.Buffer()), rhs.RowLocation(), rhs.ColLocation(), reinterpret_cast<ElemType*>(c.Data()));
+        }
+        else
+            ConvolveAndWeightedAdd(alpha, lhs, transposeA, rhs, transposeB, beta, c, 1, 1, false, false);
     }
     else if (rhs.GetFormat() == matrixFormatSparseCSR)
     {
@@ -1462,12 +1504,48 @@ GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::InplaceSoftThreshold(const
 // 1) c = momentum * c + (1.0 - momentum) * this
 // 2) this = c
 // TODO: NormalGrad is a misnomer here. Come up with a better name.
+// Sizes the state 'c' of a lazy update of this gradient (numStateCols times its size, followed by the step
+// counters) and starts the next step. Returns the step counters.
+template <class ElemType>
+ElemType* GPUSparseMatrix<ElemType>::BeginLazyUpdate(GPUMatrix<ElemType>& c, size_t numStateCols) const
+{
+    if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
+        LogicError("Lazy updates are only implemented for the block-sparse column format.");
+
+    size_t numColsNeeded = numStateCols * GetNumCols() + LazySparseUpdate::NumStepCols(GetNumRows(), GetNumCols());
+    if (c.IsEmpty() || c.GetNumCols() < numColsNeeded)
+    {
+        c.RequireSize(GetNumRows(), numColsNeeded);
+        c.SetValue(0.0);
+    }
+    if (c.GetNumRows() != GetNumRows() || c.GetNumCols() != numColsNeeded)
+        LogicError("The matrix gradients does not have expected dimensions.");
+
+    ElemType* steps = c.Data() + numStateCols * GetNumElements();
+    _advanceLazyUpdateStep<ElemType><<<1, 1>>>(steps, GetNumCols());
+    return steps;
+}
+
+// to be called after the update, see _setLazyUpdated
+template <class ElemType>
+void GPUSparseMatrix<ElemType>::EndLazyUpdate(ElemType* steps) const
+{
+    size_t numBlocks = GetBlockSize();
+    if (numBlocks == 0)
+        return;
+    int blocksPerGrid = (int) ((numBlocks + GridDim::maxThreadsPerBlock - 1) / GridDim::maxThreadsPerBlock);
+    _setLazyUpdated<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock>>>(steps, BlockId2ColOrRow(), numBlocks, GetNumCols());
+}
+
 template <class ElemType>
-void GPUSparseMatrix<ElemType>::NormalGrad(GPUMatrix<ElemType>& c, const ElemType momentum, bool unitGainMomentum)
+void GPUSparseMatrix<ElemType>::NormalGrad(GPUMatrix<ElemType>& c, const ElemType momentum, bool unitGainMomentum, bool lazy)
 {
     VerifyWritable(__FUNCTION__);
 
-    if (c.IsEmpty())
+    ElemType* steps = nullptr;
+    if (lazy)
+        steps = BeginLazyUpdate(c, 1);
+    else if (c.IsEmpty())
     {
         c.RequireSize(GetNumRows(), GetNumCols());
         c.SetValue(0.0);
@@ -1489,7 +1567,10 @@ void GPUSparseMatrix<ElemType>::NormalGrad(GPUMatrix<ElemType>& c, const ElemTyp
             Data(),
             BlockId2ColOrRow(),
             c.Data(),
-            unitGainMomentum);
+            unitGainMomentum,
+            steps);
+        if (steps)
+            EndLazyUpdate(steps);
     }
     else
     {
@@ -1562,13 +1643,31 @@ void GPUSparseMatrix<ElemType>::FSAdagrad(
     ElemType momentum,
     ElemType adaWeight,
     ElemType adaMul,
-    bool unitGainMomentum)
+    bool unitGainMomentum,
+    bool lazy)
 {
     if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
     {
         NOT_IMPLEMENTED;
     }
 
+    if (lazy)
+    {
+        ElemType* steps = BeginLazyUpdate(c, 2);
+        size_t n = GetNumElements();
+        let nz = NzCount();
+        if (nz > 0)
+        {
+            int blocksPerGrid = (int) ((nz + GridDim::maxThreadsPerBlock - 1) / GridDim::maxThreadsPerBlock);
+            _fsadagrad4BlockSparseColLazy<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock>>>(
+                nz, Data(), BlockId2ColOrRow(), GetNumRows(), GetNumCols(), steps,
+                c.Data(), c.Data() + n, functionValues.Data(),
+                learnRatePerSample, momentum, adaWeight, adaMul, unitGainMomentum);
+        }
+        EndLazyUpdate(steps);
+        return;
+    }
+
     size_t numColsNeeded = 2 * GetNumCols();
 
     if (c.IsEmpty() || (c.GetNumCols() < numColsNeeded))
@@ -1597,13 +1696,31 @@ void GPUSparseMatrix<ElemType>::Adam(
     ElemType adaMul,
     ElemType epsilon,
     bool unitGainMomentum,
-    bool adamax)
+    bool adamax,
+    bool lazy)
 {
     if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
     {
         NOT_IMPLEMENTED;
     }
 
+    if (lazy)
+    {
+        ElemType* steps = BeginLazyUpdate(c, 2);
+        size_t n = GetNumElements();
+        let nz = NzCount();
+        if (nz > 0)
+        {
+            int blocksPerGrid = (int) ((nz + GridDim::maxThreadsPerBlock - 1) / GridDim::maxThreadsPerBlock);
+            _adam4BlockSparseColLazy<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock>>>(
+                nz, Data(), BlockId2ColOrRow(), GetNumRows(), GetNumCols(), steps,
+                c.Data(), c.Data() + n, functionValues.Data(),
+                learnRatePerSample, momentum, adaWeight, adaMul, epsilon, unitGainMomentum, adamax);
+        }
+        EndLazyUpdate(steps);
+        return;
+    }
+
     size_t numColsNeeded = 2 * GetNumCols();
 
     if (c.IsEmpty() || (c.GetNumCols() < numColsNeeded))
@@ -2960,6 +3077,81 @@ GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::AssignOneHot(const GPUMatr
     return *this;
 }
 
+// this(:, indices(i)) += values(:, i), into a matrixFormatSparseBlockCol matrix whose blocks are the columns that are hit
+// Instead of atomic adds for repeated indices (as GPUMatrix::ScatterToIndices()), the (column, position) pairs are sorted
+// by a stable radix sort, and each thread sums one row of the values of one column, in the order of their positions.
+// The result is thus deterministic. NaN, negative and out-of-bounds indices are skipped.
+template <class ElemType>
+GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::ScatterToIndices(const GPUMatrix<ElemType>& values, const GPUMatrix<ElemType>& indices, size_t row_elements)
+{
+    VerifyWritable(__FUNCTION__);
+
+    if (indices.IsEmpty() || values.IsEmpty())
+        LogicError("ScatterToIndices: input matrix is empty.");
+
+    if (GetFormat() != matrixFormatSparseBlockCol || row_elements != GetNumRows() || values.GetNumElements() != row_elements * indices.GetNumElements())
+        NOT_IMPLEMENTED;
+
+    const int m = (int) GetNumRows();
+    const int n = (int) GetNumCols();
+    const CUDA_LONG numIndices = (CUDA_LONG) indices.GetNumElements();
+
+    PrepareDevice();
+    SyncGuard syncGuard;
+
+    // as MultiplyAndAdd(), the new columns get blocks after the existing ones
+    size_t blockSizePrev = GetBlockSize();
+    if (blockSizePrev == 0)
+    {
+        Resize(m, n, 0);
+        CUDA_CALL(cudaMemset(ColOrRow2BlockId(), Id_NotAssigned, sizeof(GPUSPARSE_INDEX_TYPE) * (n)));
+        CUDA_CALL(cudaMemset(BlockId2ColOrRow(), Id_NotAssigned, sizeof(GPUSPARSE_INDEX_TYPE) * (n)));
+    }
+
+    // the keys (columns, n for skipped indices) and the positions, before and after sorting
+    int* keys = TracingGPUMemoryAllocator::Allocate<int>(GetComputeDeviceId(), 4 * (size_t) numIndices);
+    int* sortedKeys = keys + numIndices;
+    int* positions = sortedKeys + numIndices;
+    int* sortedPositions = positions + numIndices;
+
+    int blocksPerGrid = (int) ceil(((double) numIndices) / GridDim::maxThreadsPerBlock);
+    _findColsOfIndices<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(indices.Data(), keys, positions, ColOrRow2BlockId(), n, numIndices);
+
+    size_t* blockSize = TracingGPUMemoryAllocator::Allocate<size_t>(GetComputeDeviceId(), 1);
+    CUDA_CALL(cudaMemcpy(blockSize, &blockSizePrev, sizeof(size_t), cudaMemcpyHostToDevice));
+    blocksPerGrid = (int) ceil(((double) n) / GridDim::maxThreadsPerBlock);
+    _determineBlockIds<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(BlockId2ColOrRow(), ColOrRow2BlockId(), n, blockSize);
+
+    size_t blockSizeCurr;
+    CUDA_CALL(cudaMemcpy(&blockSizeCurr, blockSize, sizeof(size_t), cudaMemcpyDeviceToHost));
+    TracingGPUMemoryAllocator::Free<size_t>(GetComputeDeviceId(), blockSize);
+    SetBlockSize(blockSizeCurr);
+
+    if (blockSizeCurr > blockSizePrev)
+    {
+        // zero initialize new blocks
+        RequireSizeAndAllocate(m, n, m * blockSizeCurr, true, true); // we need to keep the col2blockid and blockid2col info when resizing.
+        CUDA_CALL(cudaMemset(Data() + m * blockSizePrev, 0, sizeof(ElemType) * m * (blockSizeCurr - blockSizePrev)));
+    }
+
+    // only the bits of the keys up to n are sorted
+    int endBit = 1;
+    while (endBit < 31 && (1 << endBit) <= n)
+        endBit++;
+    size_t cbtemp = 0;
+    CUDA_CALL(cub::DeviceRadixSort::SortPairs(nullptr, cbtemp, keys, sortedKeys, positions, sortedPositions, numIndices, 0, endBit, t_stream));
+    char* temp = TracingGPUMemoryAllocator::Allocate<char>(GetComputeDeviceId(), cbtemp);
+    CUDA_CALL(cub::DeviceRadixSort::SortPairs(temp, cbtemp, keys, sortedKeys, positions, sortedPositions, numIndices, 0, endBit, t_stream));
+
+    CUDA_LONG N = numIndices * m;
+    blocksPerGrid = (int) ceil(((double) N) / GridDim::maxThreadsPerBlock);
+    _scatterSortedToSparseBlockCol<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock, 0, t_stream>>>(sortedKeys, sortedPositions, values.Data(), ColOrRow2BlockId(), Data(), m, n, numIndices);
+
+    TracingGPUMemoryAllocator::Free<char>(GetComputeDeviceId(), temp);
+    TracingGPUMemoryAllocator::Free<int>(GetComputeDeviceId(), keys);
+    return *this;
+}
+
 template <class ElemType>
 GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::AssignTruncateTopOf(const GPUSparseMatrix<ElemType>& a, const ElemType threshold)
 {
@@ -3115,6 +3307,31 @@ template void GPUSparseMatrix<short>::Reshape(const size_t, const size_t);
 template void GPUSparseMatrix<short>::ScaleAndAdd(short, GPUSparseMatrix<short> const &, GPUMatrix<short> &);
 template void GPUSparseMatrix<short>::ColumnwiseScaleAndWeightedAdd(short, const GPUSparseMatrix<short>&, const GPUMatrix<short>&, short, GPUMatrix<short>&);
 
+// Support <half>
+template GPUSparseMatrix<half>::GPUSparseMatrix(DEVICEID_TYPE, const MatrixFormat);
+template GPUSparseMatrix<half>::GPUSparseMatrix(const size_t, const size_t, const size_t, DEVICEID_TYPE, const MatrixFormat);
+template GPUSparseMatrix<half>::GPUSparseMatrix(GPUSparseMatrix<half> const&);
+template GPUSparseMatrix<half>::GPUSparseMatrix(GPUSparseMatrix<half>&&);
+template void GPUSparseMatrix<half>::SetValue(CPUSparseMatrix<half> const&);
+template void GPUSparseMatrix<half>::SetValue(GPUSparseMatrix<half> const&);
+template void GPUSparseMatrix<half>::SetValue(GPUMatrix<half> const&);
+//template void GPUSparseMatrix<half>::SetValue(CPUMatrix<half> const&);
+template GPUMatrix<half> GPUSparseMatrix<half>::CopyToDenseMatrix() const;
+template void GPUSparseMatrix<half>::CopyToDenseMatrix(GPUMatrix<half>&) const;
+template void GPUSparseMatrix<half>::CopyToCPUSparseMatrix(CPUSparseMatrix<half>&) const;
+template void GPUSparseMatrix<half>::ChangeDeviceTo(int);
+template void GPUSparseMatrix<half>::Resize(const size_t, const size_t, const size_t, const bool);
+template void GPUSparseMatrix<half>::RequireSizeAndAllocate(const size_t, const size_t, const size_t, const bool, const bool);
+template void GPUSparseMatrix<half>::Reset();
+template GPUSPARSE_INDEX_TYPE GPUSparseMatrix<half>::SecondaryIndexValueAt(size_t) const;
+template GPUSparseMatrix<half>::~GPUSparseMatrix();
+template GPUSparseMatrix<half> GPUSparseMatrix<half>::ColumnSlice(size_t, size_t) const;
+template GPUMatrix<half> GPUSparseMatrix<half>::CopyColumnSliceToDense(size_t, size_t) const;
+template GPUSparseMatrix<half>& GPUSparseMatrix<half>::operator=(GPUSparseMatrix<half>&&);
+template void GPUSparseMatrix<half>::Reshape(const size_t, const size_t);
+template void GPUSparseMatrix<half>::ScaleAndAdd(half, GPUSparseMatrix<half> const &, GPUMatrix<half> &);
+template void GPUSparseMatrix<half>::ColumnwiseScaleAndWeightedAdd(half, const GPUSparseMatrix<half>&, const GPUMatrix<half>&, half, GPUMatrix<half>&);
+
 template GPUSparseMatrix<int>::GPUSparseMatrix(DEVICEID_TYPE, const MatrixFormat);
 template GPUSparseMatrix<int>::~GPUSparseMatrix();
 template void GPUSparseMatrix<int>::RequireSizeAndAllocate(const size_t, const size_t, const size_t, const bool, const bool);
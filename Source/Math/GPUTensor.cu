@@ -17,11 +17,13 @@
 #define TENSOR_OPS_DECL __device__ __host__
 #include "TensorOps.h"
 #include "fast_divmod.h"
+#include "TensorOpAutotuner.h"
 #include <cuda.h>
 #include <cuda_runtime.h>
 #include "cublas_v2.h"
 #include <assert.h>
 #include <limits.h>
+#include <limits>
 
 // use fast divisor
 #define USE_FAST_DIVMOD
@@ -865,11 +867,20 @@ static shared_ptr<ElemType> GetReductionBuffer(size_t N)
     return reductionBuffersCache[deviceId];
 }
 
-// All dimensions (N-ariness, number of input dimensions K and number of reduction dimensions M) are bound to template parameters now.
 template <class ElemType, C_size_t N, C_int M, C_int K>
 static void LaunchTensorOpWithReduction(ElemType beta, array<ElemType*, N> pointerVector, ElemType alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
                                         const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrideVectors,
-                                        const SmallVector<size_t>& reducingOpDimVector, const array<SmallVector<ptrdiff_t>, N>& reducingStrideVectors)
+                                        const SmallVector<size_t>& reducingOpDimVector, const array<SmallVector<ptrdiff_t>, N>& reducingStrideVectors);
+
+// Launch a reduction with a given configuration (see LaunchTensorOpWithReduction() for how it is chosen):
+//  - numReductionChunks = 0: one thread per output element, reducing in an inner loop
+//  - numReductionChunks > 0: that many thread blocks work on each output element, each reducing its chunk in parallel over its threads
+// All dimensions (N-ariness, number of input dimensions K and number of reduction dimensions M) are bound to template parameters now.
+template <class ElemType, C_size_t N, C_int M, C_int K>
+static void LaunchTensorOpWithReductionConfig(int numReductionChunks,
+                                              ElemType beta, array<ElemType*, N> pointerVector, ElemType alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+                                              const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrideVectors,
+                                              const SmallVector<size_t>& reducingOpDimVector, const array<SmallVector<ptrdiff_t>, N>& reducingStrideVectors)
 {
     // copy all parameters to CUDA-compatible data structures
     FixedArray<ElemType*, N> pointers(pointerVector);
@@ -904,24 +915,11 @@ static void LaunchTensorOpWithReduction(ElemType beta, array<ElemType*, N> point
     CUDA_LONG NN = (CUDA_LONG) numElements; // linear space identifying each individual output element
     SyncGuard syncGuard;
 
-    // do some optimization for reductions
-    //  - example: 30 GPU procs, warp size 32 --> 960 GPU cores
-    //  - NN elements must be computed, each involving a reduction over reductionDim elements
-    // Cases:
-    //  - #output elements NN >= GPU cores  -->  use one proc per element, do reduction in inner loop
-    //    E.g. if >=960 elements are computed, each gets its own GPU thread.
-    //  - reduction dimension would benefit from multiple blocks  -->  multiple blocks work on a single output element
-    //    E.g.
-    //     - gradient of adding a bias: reducing to a bias, e.g. 512-dim
-    //     - gradient of scalar multiplication: big elementwise product reduced to a scalar (big dot product, e.g. [1024 x 1024] = 1M elements)
-    //     - softmax in seq-2-seq attention model: reduce over length of attention window (e.g. 20)
-    //     - summation of criterion value: scalar reduction over a few hundred or thousand samples in the minibatch
     C_size_t reductionDim = 1; // number of elements to reduce over
     for (C_size_t k = 0; k < reducingOpDimVector.size(); k++)
         reductionDim *= (C_size_t) reducingOpDimVector[k];
     GridDim grid(NN);
     let& props = GridDim::GetDeviceProps();
-    bool disableParallelReduction = false;                       // (for debugging)
 
     // === arg based reduction, one thread per output element
     if ((reductionOp == ElementWiseOperator::opArgmax) ||
@@ -933,12 +931,8 @@ static void LaunchTensorOpWithReduction(ElemType beta, array<ElemType*, N> point
             reducingOpDims, reducingStrides,
             regularOpStrideDivmod, reducingOpDimDivmod);
     }
-    // === simple case: NN large, one thread per output element
-    else if (reductionDim == 1 ||                                     // no reduction
-             grid.m_blocksPerGrid >= props.multiProcessorCount ||     // enough output elements to fill all multiprocs
-             reductionDim * numElements <= 2 * props.warpSize ||      // trivial operation not worth the trouble (2* because the more complex one also needs 2 kernel launches)
-             disableParallelReduction ||                              // (for debugging)
-             reductionDim * numElements <= props.multiProcessorCount) // recursive call from reduction below
+    // === simple case: one thread per output element
+    else if (numReductionChunks == 0)
     {
         // we got enough elements to generate: do one element per thread, and reduction inside
         _launchTensorOp<ElemType, N, M, K><<<grid.m_blocksPerGrid, grid.m_threadsPerBlock, 0, t_stream>>>(
@@ -974,8 +968,7 @@ static void LaunchTensorOpWithReduction(ElemType beta, array<ElemType*, N> point
         //          and K * NN = on the order of NN, but generally a bit larger due to rounding.
 
         // By how much do we underutilize?
-        // We increase #blocks by that factor by breaking reduction into that many chunks.
-        let numReductionChunks = max(props.multiProcessorCount / NN, 1); // only >1 for NN < multiProcessorCount
+        // We increase #blocks by that factor by breaking reduction into that many chunks (numReductionChunks).
 
         // distribute NN over block X and Y
         let blockXOverBy = CeilDiv(NN, props.maxGridSize[0]);
@@ -1007,7 +1000,7 @@ static void LaunchTensorOpWithReduction(ElemType beta, array<ElemType*, N> point
         else
         {
             // we get here if NN <= #multiprocs
-            assert(NN <= props.multiProcessorCount && numBlocksX == NN && numBlocksY == 1);
+            assert(NN * numReductionChunks <= props.multiProcessorCount && numBlocksX == NN && numBlocksY == 1);
             // dims are:
             //  - numBlocksZ = numReductionChunks = how many multiprocs work together to produce one output element
             //  - numBlocksX = NN = number of output elements
@@ -1101,6 +1094,162 @@ static void LaunchTensorOpWithReduction(ElemType beta, array<ElemType*, N> point
     }
 }
 
+// Signature of a reduction for the autotuner. Everything that influences the speed of the kernels must be part of it.
+template <class ElemType, C_size_t N>
+static string ReductionSignature(ElementWiseOperator op, ElementWiseOperator reductionOp,
+                                 const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrideVectors,
+                                 const SmallVector<size_t>& reducingOpDimVector, const array<SmallVector<ptrdiff_t>, N>& reducingStrideVectors)
+{
+    let& props = GridDim::GetDeviceProps();
+    string signature = msra::strfun::strprintf("%s|%d|%d|%d", props.name, (int) sizeof(ElemType), (int) op, (int) reductionOp);
+    signature += "|dims";
+    for (auto dim : regularOpDims)
+        signature += msra::strfun::strprintf(" %d", (int) dim);
+    signature += "|reducing";
+    for (auto dim : reducingOpDimVector)
+        signature += msra::strfun::strprintf(" %d", (int) dim);
+    for (C_size_t i = 0; i < N; i++)
+    {
+        signature += "|strides";
+        for (auto stride : regularStrideVectors[i])
+            signature += msra::strfun::strprintf(" %d", (int) stride);
+        signature += " /";
+        for (auto stride : reducingStrideVectors[i])
+            signature += msra::strfun::strprintf(" %d", (int) stride);
+    }
+    return signature;
+}
+
+// Time the candidate launch configurations of a reduction once per signature, and return the fastest (see TensorOpAutotuner).
+// The candidates are: one thread per output element; one block per output element; and, for fewer output elements than
+// multiprocs, 2, 4, ... blocks per output element up to the number that fills all multiprocs (which is also the size of
+// the reduction buffer, see GetReductionBuffer()).
+template <class ElemType, C_size_t N, C_int M, C_int K>
+static int GetAutotunedReductionChunks(int defaultNumReductionChunks, ElemType alpha, const array<ElemType*, N>& pointerVector, ElementWiseOperator op, ElementWiseOperator reductionOp,
+                                       const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrideVectors,
+                                       const SmallVector<size_t>& reducingOpDimVector, const array<SmallVector<ptrdiff_t>, N>& reducingStrideVectors)
+{
+    let signature = ReductionSignature<ElemType, N>(op, reductionOp, regularOpDims, regularStrideVectors, reducingOpDimVector, reducingStrideVectors);
+    int numReductionChunks;
+    if (TensorOpAutotuner::Lookup(signature, numReductionChunks))
+        return numReductionChunks;
+
+    let& props = GridDim::GetDeviceProps();
+    C_size_t numElements = 1;
+    SmallVector<ptrdiff_t> denseStrides; // strides of the output elements in a dense layout
+    for (C_size_t k = 0; k < regularOpDims.size(); k++)
+    {
+        denseStrides.push_back((ptrdiff_t) numElements);
+        numElements *= (C_size_t) regularOpDims[k];
+    }
+    C_size_t reductionDim = 1;
+    for (C_size_t k = 0; k < reducingOpDimVector.size(); k++)
+        reductionDim *= (C_size_t) reducingOpDimVector[k];
+    CUDA_LONG NN = (CUDA_LONG) numElements;
+
+    vector<int> candidates{ 0, 1 };
+    for (int chunks = 2; chunks <= props.multiProcessorCount / NN && chunks <= reductionDim; chunks *= 2)
+        candidates.push_back(chunks);
+    if (find(candidates.begin(), candidates.end(), defaultNumReductionChunks) == candidates.end())
+        candidates.push_back(defaultNumReductionChunks);
+
+    // The candidates write to a dense scratch output with beta = 0, so that the actual output is not touched
+    // (it may be accumulated into, and may even be one of the inputs).
+    shared_ptr<ElemType> scratch = AllocateReductionBuffer<ElemType>(NN);
+    auto pointerVector1 = pointerVector;
+    pointerVector1[N - 1] = scratch.get();
+    auto regularStrideVectors1 = regularStrideVectors;
+    regularStrideVectors1[N - 1] = denseStrides;
+
+    const int numRepetitions = 3;
+    cudaEvent_t start, stop;
+    CUDA_CALL(cudaEventCreate(&start));
+    CUDA_CALL(cudaEventCreate(&stop));
+    int best = defaultNumReductionChunks;
+    float bestTime = numeric_limits<float>::max();
+    for (let chunks : candidates)
+    {
+        // the first launch is not timed, since it may include one-time costs such as the allocation of the reduction buffer
+        for (int i = 0; i <= numRepetitions; i++)
+        {
+            if (i == 1)
+                CUDA_CALL(cudaEventRecord(start, t_stream));
+            LaunchTensorOpWithReductionConfig<ElemType, N, M, K>(chunks, /*beta=*/0, pointerVector1, alpha, op, reductionOp,
+                                                                 regularOpDims, regularStrideVectors1, reducingOpDimVector, reducingStrideVectors);
+        }
+        CUDA_CALL(cudaEventRecord(stop, t_stream));
+        CUDA_CALL(cudaEventSynchronize(stop));
+        float time;
+        CUDA_CALL(cudaEventElapsedTime(&time, start, stop));
+        if (time < bestTime)
+        {
+            bestTime = time;
+            best = chunks;
+        }
+    }
+    CUDA_CALL(cudaEventDestroy(start));
+    CUDA_CALL(cudaEventDestroy(stop));
+
+    TensorOpAutotuner::Record(signature, best);
+    return best;
+}
+
+// Choose the launch configuration of a reduction and launch it.
+template <class ElemType, C_size_t N, C_int M, C_int K>
+static void LaunchTensorOpWithReduction(ElemType beta, array<ElemType*, N> pointerVector, ElemType alpha, ElementWiseOperator op, ElementWiseOperator reductionOp,
+                                        const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrideVectors,
+                                        const SmallVector<size_t>& reducingOpDimVector, const array<SmallVector<ptrdiff_t>, N>& reducingStrideVectors)
+{
+    C_size_t numElements = 1;
+    for (C_size_t k = 0; k < regularOpDims.size(); k++)
+        numElements *= (C_size_t) regularOpDims[k];
+    CUDA_LONG NN = (CUDA_LONG) numElements; // linear space identifying each individual output element
+
+    // do some optimization for reductions
+    //  - example: 30 GPU procs, warp size 32 --> 960 GPU cores
+    //  - NN elements must be computed, each involving a reduction over reductionDim elements
+    // Cases:
+    //  - #output elements NN >= GPU cores  -->  use one proc per element, do reduction in inner loop
+    //    E.g. if >=960 elements are computed, each gets its own GPU thread.
+    //  - reduction dimension would benefit from multiple blocks  -->  multiple blocks work on a single output element
+    //    E.g.
+    //     - gradient of adding a bias: reducing to a bias, e.g. 512-dim
+    //     - gradient of scalar multiplication: big elementwise product reduced to a scalar (big dot product, e.g. [1024 x 1024] = 1M elements)
+    //     - softmax in seq-2-seq attention model: reduce over length of attention window (e.g. 20)
+    //     - summation of criterion value: scalar reduction over a few hundred or thousand samples in the minibatch
+
+    C_size_t reductionDim = 1; // number of elements to reduce over
+    for (C_size_t k = 0; k < reducingOpDimVector.size(); k++)
+        reductionDim *= (C_size_t) reducingOpDimVector[k];
+    GridDim grid(NN);
+    let& props = GridDim::GetDeviceProps();
+    bool disableParallelReduction = false;                       // (for debugging)
+
+    // cases that are always done by one thread per output element
+    bool useOneThreadPerElement = reductionOp == ElementWiseOperator::opArgmax ||             // arg based reduction
+                                  reductionOp == ElementWiseOperator::opArgmin ||
+                                  reductionDim == 1 ||                                      // no reduction
+                                  reductionDim * numElements <= 2 * props.warpSize ||       // trivial operation not worth the trouble (2* because the more complex one also needs 2 kernel launches)
+                                  disableParallelReduction ||                               // (for debugging)
+                                  reductionDim * numElements <= props.multiProcessorCount;  // recursive call from reduction below
+
+    int numReductionChunks = 0; // one thread per output element
+    if (!useOneThreadPerElement)
+    {
+        // If there are enough output elements to fill all multiprocs, each gets its own thread.
+        // Otherwise we underutilize the multiprocs, and increase #blocks by that factor by breaking the reduction into that many chunks.
+        if (grid.m_blocksPerGrid < props.multiProcessorCount)
+            numReductionChunks = max(props.multiProcessorCount / NN, 1); // only >1 for NN < multiProcessorCount
+        // The above is a guess that can be far off, e.g. when reducing along an axis with a large stride. Let the autotuner measure instead.
+        if (TensorOpAutotuner::IsEnabled())
+            numReductionChunks = GetAutotunedReductionChunks<ElemType, N, M, K>(numReductionChunks, alpha, pointerVector, op, reductionOp,
+                                                                                regularOpDims, regularStrideVectors, reducingOpDimVector, reducingStrideVectors);
+    }
+
+    LaunchTensorOpWithReductionConfig<ElemType, N, M, K>(numReductionChunks, beta, pointerVector, alpha, op, reductionOp,
+                                                          regularOpDims, regularStrideVectors, reducingOpDimVector, reducingStrideVectors);
+}
+
 // -----------------------------------------------------------------------
 // kernel and launch  --linear unary
 // -----------------------------------------------------------------------
@@ -1168,6 +1317,75 @@ void LaunchUnaryTensorOp(ElemType beta, const ElemType* pa, ElemType* pb, ElemTy
     }
 }
 
+// -----------------------------------------------------------------------
+// kernel and launch  --fused element-wise program, no reduction
+// -----------------------------------------------------------------------
+
+// Each thread computes one output element by evaluating the entire program on its three input elements,
+// so that a chain of element-wise ops costs a single read of the inputs and a single write of the output.
+template <class ElemType, C_int K>
+__global__ void _launchElementWiseProgram(ElemType beta, FixedArray<ElemType*, 4> pointers, ElemType alpha, ElementWiseProgram program,
+                                          FixedArray<C_unsigned_int, K> regularOpStrides, FixedMatrix<C_int, 4, K> regularStrides, CUDA_LONG numElements,
+                                          FixedArray<fast_divmod, K> regularOpStrideDivmod)
+{
+    CUDA_LONG id = GridDim::GetLinearThreadId();
+    if (id >= numElements)
+        return;
+    // map id (location on grid) to the element pointers, same as TensorOpElement
+    #pragma unroll
+    for (C_int k = K - 1; k > 0; k--)
+    {
+#ifndef USE_FAST_DIVMOD
+        C_size_t stride = regularOpStrides[(C_size_t) k];
+        C_size_t index = id / stride;
+        id = id - stride * index;
+#else
+        C_size_t index;
+        regularOpStrideDivmod[k].divmod(id, index, id);
+#endif
+        #pragma unroll
+        for (C_size_t i = 0; i < 4; i++)
+            pointers[i] += index * regularStrides(i, (C_size_t) k);
+    }
+    if (K > 0) // k = 0: op stride is guaranteed to be 1
+    {
+        #pragma unroll
+        for (C_size_t i = 0; i < 4; i++)
+            pointers[i] += id * regularStrides(i, 0);
+    }
+    ElemType val = alpha * EvaluateElementWiseProgram(program, *pointers[0], *pointers[1], *pointers[2]);
+    auto* pout = pointers[3];
+    if (beta != 0) // (skip memory access if not needed, and allow for ignoring NaNs)
+        val += beta * *pout;
+    *pout = val;
+}
+
+template <class ElemType, C_int K>
+static void LaunchElementWiseProgram(ElemType beta, const array<ElemType*, 4>& pointerVector, ElemType alpha, const ElementWiseProgram& program,
+                                     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrideVectors)
+{
+    // copy all parameters to CUDA-compatible data structures
+    FixedArray<ElemType*, 4> pointers(pointerVector);
+    SmallVector<C_size_t> regularOpStrideVector;
+    SmallVector<fast_divmod> regularOpStrideDivmodVector;
+    C_size_t numElements = 1;
+    for (C_size_t k = 0; k < regularOpDims.size(); k++)
+    {
+        regularOpStrideVector.push_back(numElements);
+        regularOpStrideDivmodVector.push_back(fast_divmod(numElements));
+        numElements *= (C_size_t) regularOpDims[k];
+    }
+    FixedArray<C_unsigned_int, K> regularOpStrides(regularOpStrideVector);
+    FixedMatrix<C_int, 4, K> regularStrides(regularStrideVectors);
+    FixedArray<fast_divmod, K> regularOpStrideDivmod(regularOpStrideDivmodVector);
+
+    // launch the kernel
+    CUDA_LONG NN = (CUDA_LONG) numElements;
+    SyncGuard syncGuard;
+    GridDim grid(NN);
+    _launchElementWiseProgram<ElemType, K><<<grid.m_blocksPerGrid, grid.m_threadsPerBlock, 0, t_stream>>>(beta, pointers, alpha, program, regularOpStrides, regularStrides, grid.m_N, regularOpStrideDivmod);
+}
+
 // -----------------------------------------------------------------------
 // map runtime parameters N to template parameters
 // -----------------------------------------------------------------------
@@ -1220,6 +1438,36 @@ void TensorOpN(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, Elem
     }
 }
 
+// fused element-wise program over three inputs and one output
+// The fused chains never reduce (all inputs are broadcast against the output), so only the regular loop is supported.
+template <class ElemType>
+void TensorElementWiseProgram(ElemType beta, array<ElemType*, 4> pointers, ElemType alpha, const ElementWiseProgram& program,
+                              const array<size_t, 4>& offsets,
+                              const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                              const SmallVector<size_t>& reducingOpDims)
+{
+    if (!reducingOpDims.empty())
+        InvalidArgument("TensorOp: Element-wise programs do not support reduction.");
+    for (C_size_t i = 0; i < 4; i++)
+        pointers[i] += offsets[i];
+    size_t dims = regularOpDims.size();
+    switch (dims)
+    {
+    case 4:
+        return LaunchElementWiseProgram<ElemType, 4>(beta, pointers, alpha, program, regularOpDims, regularStrides);
+    case 3:
+        return LaunchElementWiseProgram<ElemType, 3>(beta, pointers, alpha, program, regularOpDims, regularStrides);
+    case 2:
+        return LaunchElementWiseProgram<ElemType, 2>(beta, pointers, alpha, program, regularOpDims, regularStrides);
+    case 1:
+        return LaunchElementWiseProgram<ElemType, 1>(beta, pointers, alpha, program, regularOpDims, regularStrides);
+    case 0:
+        return LaunchElementWiseProgram<ElemType, 0>(beta, pointers, alpha, program, regularOpDims, regularStrides);
+    default:
+        LogicError("TensorOp: %d non-flattened input dimensions are not supported.", (C_int) dims);
+    }
+}
+
 //------------------------------------------------------------------------
 // explicit instantiations--these are being called from GPUMatrix.cu
 //------------------------------------------------------------------------
@@ -1249,6 +1497,15 @@ template void TensorOpN<double, 4>(double beta, array<double*, 4> pointers, doub
                                    const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
                                    const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
 
+template void TensorElementWiseProgram<float>(float beta, array<float*, 4> pointers, float alpha, const ElementWiseProgram& program,
+                                              const array<size_t, 4>& offsets,
+                                              const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                                              const SmallVector<size_t>& reducingOpDims);
+template void TensorElementWiseProgram<double>(double beta, array<double*, 4> pointers, double alpha, const ElementWiseProgram& program,
+                                               const array<size_t, 4>& offsets,
+                                               const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                                               const SmallVector<size_t>& reducingOpDims);
+
 template void LaunchUnaryTensorOp(float beta, const float* pa, float* pb, float alpha, ElementWiseOperator op, size_t regularOpDim);
 template void LaunchUnaryTensorOp(double beta, const double* pa, double* pb, double alpha, ElementWiseOperator op, size_t regularOpDim);
 
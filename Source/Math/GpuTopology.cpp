@@ -0,0 +1,140 @@
+#include "stdafx.h"
+#include "GpuTopology.h"
+#include "Basics.h"
+#include "BestGpu.h" // for CPUONLY
+#ifndef CPUONLY
+#include <cuda_runtime_api.h>
+#include <nvml.h>
+#pragma comment(lib, "nvml.lib")
+#endif
+#include <algorithm>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+bool GpuTopology::s_enabled = false;
+
+void GpuTopology::SetEnabled(bool enabled)
+{
+    s_enabled = enabled;
+}
+
+bool GpuTopology::IsEnabled()
+{
+    return s_enabled;
+}
+
+std::vector<int> GpuTopology::RingOrder(const std::vector<int>& deviceIds)
+{
+    std::vector<int> order;
+    std::vector<int> remaining = deviceIds;
+    while (!remaining.empty())
+    {
+        size_t next = 0;
+        if (!order.empty())
+        {
+            int bestDistance = Distance(order.back(), remaining[0]);
+            for (size_t i = 1; i < remaining.size(); i++)
+            {
+                int distance = Distance(order.back(), remaining[i]);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    next = i;
+                }
+            }
+        }
+        order.push_back(remaining[next]);
+        remaining.erase(remaining.begin() + next);
+    }
+    return order;
+}
+
+#ifndef CPUONLY
+
+static bool InitNvml()
+{
+    static bool initialized = (nvmlInit() == NVML_SUCCESS); // (never shut down, NVML counts the initializations)
+    return initialized;
+}
+
+// NVML and CUDA number the devices differently; match them by their PCI bus id
+static bool GetNvmlDevice(int deviceId, nvmlDevice_t& device)
+{
+    if (deviceId < 0 || !InitNvml())
+        return false;
+
+    char pciBusId[32];
+    if (cudaDeviceGetPCIBusId(pciBusId, (int)sizeof(pciBusId), deviceId) != cudaSuccess)
+        return false;
+
+    return nvmlDeviceGetHandleByPciBusId(pciBusId, &device) == NVML_SUCCESS;
+}
+
+static bool HasNvLink(nvmlDevice_t from, nvmlDevice_t to)
+{
+#ifdef NVML_NVLINK_MAX_LINKS
+    nvmlPciInfo_t toPci;
+    if (nvmlDeviceGetPciInfo(to, &toPci) != NVML_SUCCESS)
+        return false;
+
+    for (unsigned int link = 0; link < NVML_NVLINK_MAX_LINKS; link++)
+    {
+        nvmlEnableState_t isActive;
+        nvmlPciInfo_t remotePci;
+        if (nvmlDeviceGetNvLinkState(from, link, &isActive) != NVML_SUCCESS || isActive != NVML_FEATURE_ENABLED)
+            continue;
+        if (nvmlDeviceGetNvLinkRemotePciInfo(from, link, &remotePci) == NVML_SUCCESS &&
+            remotePci.domain == toPci.domain && remotePci.bus == toPci.bus && remotePci.device == toPci.device)
+            return true;
+    }
+#else
+    UNUSED(from);
+    UNUSED(to);
+#endif
+    return false;
+}
+
+int GpuTopology::Distance(int deviceA, int deviceB)
+{
+    if (deviceA == deviceB)
+        return 0;
+
+    nvmlDevice_t a, b;
+    if (!GetNvmlDevice(deviceA, a) || !GetNvmlDevice(deviceB, b))
+        return UnknownDistance;
+
+    if (HasNvLink(a, b))
+        return 1;
+
+    // NVML_TOPOLOGY_INTERNAL (0) ... NVML_TOPOLOGY_SYSTEM (50), in steps of 10 (Linux only)
+    nvmlGpuTopologyLevel_t level;
+    if (nvmlDeviceGetTopologyCommonAncestor(a, b, &level) != NVML_SUCCESS)
+        return UnknownDistance;
+
+    return 2 + (int)level / 10;
+}
+
+bool GpuTopology::BindCurrentThreadToDevice(int deviceId)
+{
+    nvmlDevice_t device;
+    if (!GetNvmlDevice(deviceId, device))
+        return false;
+
+    return nvmlDeviceSetCpuAffinity(device) == NVML_SUCCESS; // (Linux only)
+}
+
+#else // CPUONLY
+
+int GpuTopology::Distance(int deviceA, int deviceB)
+{
+    return (deviceA == deviceB) ? 0 : UnknownDistance;
+}
+
+bool GpuTopology::BindCurrentThreadToDevice(int /*deviceId*/)
+{
+    return false;
+}
+
+#endif
+
+}}}
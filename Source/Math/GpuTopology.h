@@ -0,0 +1,52 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+#ifdef _WIN32
+#ifdef MATH_EXPORTS
+#define MATH_API __declspec(dllexport)
+#else
+#define MATH_API __declspec(dllimport)
+#endif
+#else // no DLLs on Linux
+#define MATH_API
+#endif
+
+// GpuTopology -- how the GPUs of this machine are connected, as reported by NVML
+// The GPUs of a multi-GPU server are connected by NVLink, or through PCIe switches, the host bridge of a CPU, or the
+// interconnect between the CPU sockets, in increasing order of cost. When enabled, this is used to give the ranks on a
+// host GPUs that are next to each other, to bind each rank to the CPUs (and with it the memory) of its GPU's NUMA node,
+// and to order the NCCL ring so that it crosses the slow links as rarely as possible.
+class MATH_API GpuTopology
+{
+public:
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled();
+
+    static const int UnknownDistance = 100;
+
+    // 0 for the same GPU, 1 for GPUs connected by NVLink, then increasing with the PCIe/CPU level through which the GPUs
+    // are connected (same board, one PCIe switch, several switches, host bridge, NUMA node, across sockets).
+    static int Distance(int deviceA, int deviceB);
+
+    // Orders the devices such that neighbours (including the last and the first) are close, starting with the first
+    // device and appending the closest remaining one; ties keep the given order.
+    static std::vector<int> RingOrder(const std::vector<int>& deviceIds);
+
+    // Binds the calling thread to the CPUs closest to the GPU. Threads created by it later inherit the binding, and memory
+    // it touches first is allocated on that NUMA node, so this should be done before the readers and their buffers are
+    // created. Returns false if the binding is not supported (e.g. on Windows).
+    static bool BindCurrentThreadToDevice(int deviceId);
+
+private:
+    static bool s_enabled;
+};
+
+}}}
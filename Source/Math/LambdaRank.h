@@ -0,0 +1,61 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// The pairwise terms of LambdaRankNode, shared by the CPU and GPU implementations of LambdaRankMetrics() and AddLambdaRankGradient().
+//
+
+#pragma once
+
+#include <cmath>
+
+#pragma push_macro("LAMBDA_RANK_DECL")
+#ifndef LAMBDA_RANK_DECL // to make these accessible to CUDA kernels, say '#define LAMBDA_RANK_DECL __device__ __host__'
+#define LAMBDA_RANK_DECL
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// LambdaRank ("From RankNet to LambdaRank to LambdaMART: An Overview") for the urls of one query, which are sorted by
+// descending gain. Url i is ranked at position rank_i by its score, with the discount log(2 + rank_i).
+struct LambdaRank
+{
+    // whether url a is ranked before url b: by descending score, and for equal scores (or NaN) by ascending gain, as
+    // LambdaRankNode::Url::operator<. The remaining ties are broken by the position in the query, so that the ranks of
+    // a query do not depend on the order in which they are computed.
+    template <class ElemType>
+    static inline LAMBDA_RANK_DECL bool Precedes(ElemType scoreA, ElemType gainA, long a, ElemType scoreB, ElemType gainB, long b)
+    {
+        if (IsBefore(scoreA, gainA, scoreB, gainB))
+            return true;
+        if (IsBefore(scoreB, gainB, scoreA, gainA))
+            return false;
+        return a < b;
+    }
+
+    // the lambda of the pair (i, j) of urls, where i comes before j in the query: sigmoid term times |delta NDCG| of swapping
+    // them, which is 0 for (nearly) equal gains and for queries without any gain
+    template <class ElemType>
+    static inline LAMBDA_RANK_DECL ElemType PairLambda(ElemType gainI, ElemType scoreI, ElemType rankI, ElemType gainJ, ElemType scoreJ, ElemType rankJ, ElemType idealMetric, ElemType sigma)
+    {
+        if (fabs((double) (gainI - gainJ)) < 0.0000001 || idealMetric == 0)
+            return 0;
+        const double discountI = log(2.0 + rankI);
+        const double discountJ = log(2.0 + rankJ);
+        const double deltaNdcg = fabs((gainI - gainJ) * (discountI - discountJ) / (discountI * discountJ) / idealMetric);
+        return (ElemType) (-sigma / (1 + exp((double) (sigma * (scoreI - scoreJ)))) * deltaNdcg);
+    }
+
+private:
+    template <class ElemType>
+    static inline LAMBDA_RANK_DECL bool IsBefore(ElemType scoreA, ElemType gainA, ElemType scoreB, ElemType gainB)
+    {
+        if (scoreA == scoreB || scoreA != scoreA || scoreB != scoreB) // (x != x for NaN)
+            return gainA < gainB;
+        return scoreA > scoreB;
+    }
+};
+
+}}}
+
+#pragma pop_macro("LAMBDA_RANK_DECL")
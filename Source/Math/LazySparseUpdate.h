@@ -0,0 +1,73 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Bookkeeping of the lazy learner updates of block-sparse gradients, shared by the CPU and GPU implementations.
+//
+
+#pragma once
+
+#include <cstddef>
+
+#pragma push_macro("LAZY_UPDATE_DECL")
+#ifndef LAZY_UPDATE_DECL // to make these accessible to CUDA kernels, say '#define LAZY_UPDATE_DECL __device__ __host__'
+#define LAZY_UPDATE_DECL
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// LazySparseUpdate -- per-column step counters for updating only the columns of a parameter that have a gradient
+// A gradient in matrixFormatSparseBlockCol format (e.g. of an embedding multiplied with one-hot input) only has a few
+// of the parameter's columns. The regular momentum, FSAdaGrad and Adam updates still decay the optimizer state of all
+// columns in every step. The lazy updates only touch the columns of the gradient: before a column is updated, its
+// state is decayed by the steps it has missed (with the current momentum, as the schedule of the missed steps is not
+// known), which gives the same state as the regular update for a constant momentum. The parameter values of the
+// missed steps are not applied, i.e. a column that has no gradient does not move.
+// The step counters are kept behind the optimizer state in the same matrix, so that they are saved and restored with
+// it: for a parameter of numCols columns, 2 * (numCols + 1) elements hold the step of the last update of each column
+// and the current step. A step is stored as two elements (step / StepBase and step % StepBase), so that it is exact in
+// float, too.
+struct LazySparseUpdate
+{
+    static const int StepBase = 1 << 20;
+
+    // number of columns of numRows elements needed for the step counters
+    static size_t NumStepCols(size_t numRows, size_t numCols)
+    {
+        return (2 * (numCols + 1) + numRows - 1) / numRows;
+    }
+
+    // start the next step; 'steps' are the counters of a parameter of numCols columns
+    template <class ElemType>
+    static inline LAZY_UPDATE_DECL void AdvanceStep(ElemType* steps, size_t numCols)
+    {
+        ElemType* now = steps + 2 * numCols;
+        now[1] += 1;
+        if (now[1] >= StepBase)
+        {
+            now[0] += 1;
+            now[1] = 0;
+        }
+    }
+
+    // the number of steps since the last update of the column, not counting the current one
+    template <class ElemType>
+    static inline LAZY_UPDATE_DECL ElemType NumMissedSteps(const ElemType* steps, size_t col, size_t numCols)
+    {
+        const ElemType* now = steps + 2 * numCols;
+        const ElemType* last = steps + 2 * col;
+        return (now[0] - last[0]) * StepBase + (now[1] - last[1]) - 1;
+    }
+
+    template <class ElemType>
+    static inline LAZY_UPDATE_DECL void SetUpdated(ElemType* steps, size_t col, size_t numCols)
+    {
+        const ElemType* now = steps + 2 * numCols;
+        steps[2 * col]     = now[0];
+        steps[2 * col + 1] = now[1];
+    }
+};
+
+}}}
+
+#pragma pop_macro("LAZY_UPDATE_DECL")
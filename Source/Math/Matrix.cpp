@@ -11,6 +11,7 @@
 #include "CPUSparseMatrix.h"
 #include "GPUMatrix.h"
 #include "GPUSparseMatrix.h"
+#include "MultiTensorUpdate.h"
 #include "File.h"
 #include <assert.h>
 #include <math.h>
@@ -634,6 +635,51 @@ void Matrix<ElemType>::Read(File& stream)
             M.SetDataLocation(GPU, SPARSE);
         }
     }
+    else if (type == 'q') // see Write(stream, storageFormat)
+    {
+        stream.GetMarker(fileMarkerBeginSection, std::wstring(L"BMAT"));
+        int storageFormat;
+        size_t numRows, numCols;
+        stream >> storageFormat >> numRows >> numCols;
+        const size_t numElements = numRows * numCols;
+        vector<ElemType> values(numElements);
+        if (storageFormat == (int) MatrixStorageFormat::float16)
+        {
+            vector<uint16_t> bits(numElements);
+            stream.ReadArray(bits.data(), numElements);
+            for (size_t k = 0; k < numElements; k++)
+                values[k] = (ElemType) (float) half::FromBits(bits[k]);
+        }
+        else if (storageFormat == (int) MatrixStorageFormat::int8PerRow || storageFormat == (int) MatrixStorageFormat::int8PerColumn)
+        {
+            const bool perRow = storageFormat == (int) MatrixStorageFormat::int8PerRow;
+            vector<float> scales(perRow ? numRows : numCols);
+            vector<int8_t> quantized(numElements);
+            stream.ReadArray(scales.data(), scales.size());
+            stream.ReadArray(quantized.data(), numElements);
+            for (size_t j = 0; j < numCols; j++)
+                for (size_t i = 0; i < numRows; i++)
+                    values[j * numRows + i] = (ElemType) (quantized[j * numRows + i] * scales[perRow ? i : j]);
+        }
+        else
+            LogicError("Read: Input file corrupt (invalid matrix storage format %d).", storageFormat);
+        stream.GetMarker(fileMarkerEndSection, std::wstring(L"EMAT"));
+
+        if (M.GetDeviceId() < 0)
+        {
+            if (!M.m_CPUMatrix)
+                M.m_CPUMatrix = make_shared<CPUMatrix<ElemType>>();
+            M.m_CPUMatrix->SetValue(numRows, numCols, values.data(), matrixFlagNormal);
+            M.SetDataLocation(CPU, DENSE);
+        }
+        else
+        {
+            if (!M.m_GPUMatrix)
+                M.m_GPUMatrix = make_shared<GPUMatrix<ElemType>>(M.GetDeviceId());
+            M.m_GPUMatrix->SetValue(numRows, numCols, M.GetDeviceId(), values.data(), matrixFlagNormal);
+            M.SetDataLocation(GPU, DENSE);
+        }
+    }
     else
         LogicError("Read: Input file corrupt (invalid matrix type field 0x%02d, should be 'f' or 'd').", type);
 }
@@ -660,6 +706,61 @@ void Matrix<ElemType>::Write(File& stream) const
     }
 }
 
+// Writes the values of a dense matrix in a smaller format (as type 'q'), which Read() converts back into ElemType.
+// The int8 formats are symmetric, with one scale (the maximum absolute value / 127) per row or column.
+template <class ElemType>
+void Matrix<ElemType>::Write(File& stream, MatrixStorageFormat storageFormat) const
+{
+    if (storageFormat == MatrixStorageFormat::full || GetMatrixType() != MatrixType::DENSE || IsEmpty())
+    {
+        Write(stream);
+        return;
+    }
+
+    const size_t numRows = GetNumRows();
+    const size_t numCols = GetNumCols();
+    const size_t numElements = numRows * numCols;
+    unique_ptr<ElemType[]> values(CopyToArray());
+
+    stream << 'q';
+    stream.PutMarker(fileMarkerBeginSection, std::wstring(L"BMAT"));
+    stream << (int) storageFormat << numRows << numCols;
+    if (storageFormat == MatrixStorageFormat::float16)
+    {
+        vector<uint16_t> bits(numElements);
+        for (size_t k = 0; k < numElements; k++)
+            bits[k] = half((float) values[k]).ToBits();
+        stream.WriteArray(bits.data(), numElements);
+    }
+    else if (storageFormat == MatrixStorageFormat::int8PerRow || storageFormat == MatrixStorageFormat::int8PerColumn)
+    {
+        const bool perRow = storageFormat == MatrixStorageFormat::int8PerRow;
+        vector<float> scales(perRow ? numRows : numCols, 0.0f);
+        for (size_t j = 0; j < numCols; j++)
+            for (size_t i = 0; i < numRows; i++)
+            {
+                float& scale = scales[perRow ? i : j];
+                scale = max(scale, (float) fabs(values[j * numRows + i]));
+            }
+        for (auto& scale : scales)
+            scale /= 127;
+
+        vector<int8_t> quantized(numElements);
+        for (size_t j = 0; j < numCols; j++)
+            for (size_t i = 0; i < numRows; i++)
+            {
+                const float scale = scales[perRow ? i : j];
+                const float q = scale > 0 ? roundf((float) values[j * numRows + i] / scale) : 0.0f;
+                quantized[j * numRows + i] = (int8_t) max(-127.0f, min(127.0f, q));
+            }
+        stream.WriteArray(scales.data(), scales.size());
+        stream.WriteArray(quantized.data(), numElements);
+    }
+    else
+        InvalidArgument("Write: Invalid matrix storage format %d.", (int) storageFormat);
+    stream.PutMarker(fileMarkerEndSection, std::wstring(L"EMAT"));
+}
+
 #pragma endregion Constructors, destructors and other static matrix builders
 
 #pragma region Basic Operators
@@ -985,6 +1086,15 @@ void Matrix<ElemType>::SwitchToMatrixType(MatrixType newMatrixType, MatrixFormat
 template <class ElemType>
 void Matrix<ElemType>::CopyElementsFromDenseToSparse(CPUMatrix<ElemType>& from, CPUSparseMatrix<ElemType>& dest)
 {
+    // (SetValue() must be called column by column for CSC and row by row for CSR)
+    if (dest.GetFormat() == matrixFormatSparseCSR)
+    {
+        foreach_row (row, from)
+            foreach_column (col, from)
+                dest.SetValue(row, col, from(row, col));
+        return;
+    }
+
     foreach_coord (row, col, from)
     {
         auto val = from(row, col);
@@ -1184,6 +1294,11 @@ template <>
 {
     return 0;
 } // (needed for completeness and to pass unit tests)
+template <>
+/*static*/ half Matrix<half>::MakeNan(size_t /*payload*/)
+{
+    return std::numeric_limits<half>::quiet_NaN();
+}
 
 template <class ElemType>
 void Matrix<ElemType>::MaskColumnsValue(const Matrix<char>& columnsMask, ElemType val, size_t numColsPerMaskEntry)
@@ -1278,7 +1393,7 @@ void Matrix<ElemType>::AssignValuesOf(const Matrix<ElemType>& deepCopyFrom)
             // Set GPUMatrix from:
             DISPATCH_MATRIX_ON_FLAG(&deepCopyFrom, nullptr,
                 { m_GPUMatrix->SetValue(deepCopyFrom.GetNumRows(), deepCopyFrom.GetNumCols(), this->GetDeviceId(), deepCopyFrom.m_CPUMatrix->Data()); },
-                { m_GPUMatrix->SetValue(*deepCopyFrom.m_GPUMatrix); },
+                { m_GPUMatrix->SetValueFromPeer(*deepCopyFrom.m_GPUMatrix); },
                 {
                     CPUMatrix<ElemType> tempCPUDenseMatrix(deepCopyFrom.GetNumRows(), deepCopyFrom.GetNumCols());
                     deepCopyFrom.m_CPUSparseMatrix->AssignColumnSliceToDense(tempCPUDenseMatrix, 0, deepCopyFrom.GetNumCols());
@@ -1309,6 +1424,7 @@ void Matrix<ElemType>::AssignValuesOf(const Matrix<ElemType>& deepCopyFrom)
 // If this is ever used for something that needs performance, it should not be too hard (but labor) to implement this efficiently.
 static void DoCastAssignValuesOf(Matrix<float>&  target, const Matrix<float>&  other) { target.AssignValuesOf(other); }
 static void DoCastAssignValuesOf(Matrix<double>& target, const Matrix<double>& other) { target.AssignValuesOf(other); }
+static void DoCastAssignValuesOf(Matrix<half>&   target, const Matrix<half>&   other) { target.AssignValuesOf(other); }
 template<class ElemType>
 static void CopyToVector(const Matrix<ElemType>& source, vector<ElemType>& sourceData)
 {
@@ -1364,7 +1480,10 @@ void Matrix<ElemType>::CastAssignValuesOf(const MatrixBase& other) /*override*/
     const Matrix<double> * otherd = dynamic_cast<const Matrix<double>*>(&other);
     if (otherd)
         return DoCastAssignValuesOf(*this, *otherd);
-    LogicError("CastAssignValuesOf: Only accepts float and double matrices.");
+    const Matrix<half> * otherh = dynamic_cast<const Matrix<half>*>(&other);
+    if (otherh)
+        return DoCastAssignValuesOf(*this, *otherh);
+    LogicError("CastAssignValuesOf: Only accepts float, double and half matrices.");
 }
 
 template<>
@@ -1421,6 +1540,34 @@ void Matrix<ElemType>::SetMatrixFromCSCFormat(const CPUSPARSE_INDEX_TYPE* h_CSCC
         { m_GPUSparseMatrix->SetMatrixFromCSCFormat(h_CSCCol, h_Row, h_Val, nz, numRows, numCols, false, -1, transferer); });
 }
 
+template <class ElemType>
+void Matrix<ElemType>::CopyToCSCFormat(std::vector<CPUSPARSE_INDEX_TYPE>& colStarts, std::vector<CPUSPARSE_INDEX_TYPE>& rowIndices, std::vector<ElemType>& values) const
+{
+    if (GetMatrixType() != SPARSE || GetFormat() != matrixFormatSparseCSC)
+        InvalidArgument("CopyToCSCFormat: The matrix must be in sparse CSC format.");
+
+    // GPU matrices are copied to the CPU first
+    Matrix<ElemType> cpuCopy(CPUDEVICE);
+    const CPUSparseMatrix<ElemType>* cpuSparse;
+    if (GetCurrentMatrixLocation() == CPU || GetCurrentMatrixLocation() == BOTH)
+        cpuSparse = m_CPUSparseMatrix.get();
+    else
+    {
+        cpuCopy = DeepClone();
+        cpuCopy.TransferToDeviceIfNotThere(CPUDEVICE, /*isBeingMoved=*/true, /*emptyTransfer=*/false, /*updatePreferredDevice=*/false);
+        cpuSparse = cpuCopy.m_CPUSparseMatrix.get();
+    }
+
+    const size_t numCols = cpuSparse->GetNumCols();
+    const CPUSPARSE_INDEX_TYPE* secondaryIndex = cpuSparse->SecondaryIndexLocation(); // (of a column-slice view, it does not start at 0)
+    colStarts.resize(numCols + 1);
+    for (size_t j = 0; j <= numCols; j++)
+        colStarts[j] = secondaryIndex[j] - secondaryIndex[0];
+    const size_t nz = colStarts[numCols];
+    rowIndices.assign(cpuSparse->MajorIndexLocation(), cpuSparse->MajorIndexLocation() + nz);
+    values.assign(cpuSparse->Data(), cpuSparse->Data() + nz);
+}
+
 template <class ElemType>
 void Matrix<ElemType>::SetDiagonalValue(const ElemType v)
 {
@@ -1571,6 +1718,23 @@ void Matrix<ElemType>::SetTruncatedNormalRandomValue(const ElemType mean, const
         NOT_IMPLEMENTED);
 }
 
+template <class ElemType>
+void Matrix<ElemType>::SetCounterBasedRandomValue(RandomDistribution distribution, const ElemType a, const ElemType b, unsigned long seed, uint64_t offset)
+{
+    if (distribution == RandomDistribution::Bernoulli ? !(a >= 0 && a <= 1) : distribution == RandomDistribution::Uniform ? !(a < b) : !(b > 0))
+        InvalidArgument("SetCounterBasedRandomValue: low must be less than high, sigma resp. scale must be a positive value, and the probability must be in [0, 1].");
+
+    if (IsEmpty())
+        return;
+
+    DISPATCH_MATRIX_ON_FLAG(this,
+        this,
+        m_CPUMatrix->SetCounterBasedRandomValue(distribution, a, b, seed, offset),
+        m_GPUMatrix->SetCounterBasedRandomValue(distribution, a, b, seed, offset),
+        NOT_IMPLEMENTED,
+        NOT_IMPLEMENTED);
+}
+
 template <class ElemType>
 void Matrix<ElemType>::AddGaussianRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed)
 {
@@ -1640,7 +1804,8 @@ void Matrix<ElemType>::MomentumSGDUpdate(Matrix<ElemType>& gradients,
                                          Matrix<ElemType>& smoothedGradients,
                                          ElemType learnRatePerSample,
                                          ElemType momentum,
-                                         bool unitGainMomentum)
+                                         bool unitGainMomentum,
+                                         bool lazySparseUpdate)
 {
     DecideAndMoveToRightDevice(smoothedGradients, gradients, *this);
 
@@ -1668,16 +1833,16 @@ void Matrix<ElemType>::MomentumSGDUpdate(Matrix<ElemType>& gradients,
             // 1) sg_t = momentum * sg_{t-1} + (1.0 - momentum) * g_{t-1}
             // 2) g'_{t-1} = sg_t
             // 3) w_t = w_{t-1} - learnRatePerSample * g'_{t-1}
-            if (momentum != 0)
+            if (momentum != 0 || lazySparseUpdate) // (the lazy update also counts the steps)
             {
-                gradients.m_CPUSparseMatrix->NormalGrad(*smoothedGradients.m_CPUMatrix, momentum, unitGainMomentum);
+                gradients.m_CPUSparseMatrix->NormalGrad(*smoothedGradients.m_CPUMatrix, momentum, unitGainMomentum, lazySparseUpdate);
             }
             ScaleAndAdd(-learnRatePerSample, gradients, *this);
         },
         { 
-            if (momentum != 0)
+            if (momentum != 0 || lazySparseUpdate) // (the lazy update also counts the steps)
             {
-                gradients.m_GPUSparseMatrix->NormalGrad(*smoothedGradients.m_GPUMatrix, momentum, unitGainMomentum);
+                gradients.m_GPUSparseMatrix->NormalGrad(*smoothedGradients.m_GPUMatrix, momentum, unitGainMomentum, lazySparseUpdate);
             }
             ScaleAndAdd(-learnRatePerSample, gradients, *this);
         });
@@ -1760,7 +1925,7 @@ ElemType Matrix<ElemType>::Adagrad(Matrix<ElemType>& gradients, const bool needA
 //  - the model itself
 template <class ElemType>
 void Matrix<ElemType>::FSAdagradUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& functionValues, const double targetAdagradAvDenom_x_sqrtAdagradSqrFrames,
-                                       const double learnRatePerSample, const double meanMomentum, const double varMomentum, bool unitGainMomentum)
+                                       const double learnRatePerSample, const double meanMomentum, const double varMomentum, bool unitGainMomentum, bool lazySparseUpdate)
 {
     DISPATCH_MATRIX_ON_FLAG(&gradients, &gradients,
         { 
@@ -1775,11 +1940,16 @@ void Matrix<ElemType>::FSAdagradUpdate(Matrix<ElemType>& gradients, Matrix<ElemT
                                    (ElemType)targetAdagradAvDenom_x_sqrtAdagradSqrFrames, unitGainMomentum);
             SetDataLocation(GPU); 
         },
-        { NOT_IMPLEMENTED; },
+        {
+            gradients.m_CPUSparseMatrix->FSAdagrad(*m_CPUMatrix, *functionValues.m_CPUMatrix,
+                                                   (ElemType)learnRatePerSample, (ElemType)meanMomentum, (ElemType)varMomentum,
+                                                   (ElemType)targetAdagradAvDenom_x_sqrtAdagradSqrFrames, unitGainMomentum, lazySparseUpdate);
+            SetDataLocation(CPU);
+        },
         {
             gradients.m_GPUSparseMatrix->FSAdagrad(*m_GPUMatrix, *functionValues.m_GPUMatrix, 
                                                    (ElemType)learnRatePerSample, (ElemType)meanMomentum, (ElemType)varMomentum,
-                                                   (ElemType)targetAdagradAvDenom_x_sqrtAdagradSqrFrames, unitGainMomentum);
+                                                   (ElemType)targetAdagradAvDenom_x_sqrtAdagradSqrFrames, unitGainMomentum, lazySparseUpdate);
             SetDataLocation(GPU); 
         });
 
@@ -1792,7 +1962,7 @@ void Matrix<ElemType>::FSAdagradUpdate(Matrix<ElemType>& gradients, Matrix<ElemT
 ///
 template <class ElemType>
 void Matrix<ElemType>::AdamUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& functionValues, const double smoothedCount,
-    const double learnRatePerSample, const double meanMomentum, const double varMomentum, const double epsilon, bool unitGainMomentum, bool adamax)
+    const double learnRatePerSample, const double meanMomentum, const double varMomentum, const double epsilon, bool unitGainMomentum, bool adamax, bool lazySparseUpdate)
 {
     // Bias correction
     let biasCorrection = adamax? (ElemType)(1. / (1- pow(meanMomentum, smoothedCount))) : (ElemType)(sqrt(1- pow(varMomentum, smoothedCount))/(1- pow(meanMomentum, smoothedCount)));
@@ -1810,15 +1980,138 @@ void Matrix<ElemType>::AdamUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>&
         biasCorrection, (ElemType)epsilon, unitGainMomentum, adamax);
         SetDataLocation(GPU);
     },
-    { NOT_IMPLEMENTED; },
+    { gradients.m_CPUSparseMatrix->Adam(*m_CPUMatrix, *functionValues.m_CPUMatrix,
+        (ElemType)learnRatePerSample, (ElemType)meanMomentum,
+        (ElemType)varMomentum, biasCorrection, (ElemType)epsilon, unitGainMomentum, adamax, lazySparseUpdate);
+        SetDataLocation(CPU); },
     { gradients.m_GPUSparseMatrix->Adam(*m_GPUMatrix, *functionValues.m_GPUMatrix, 
         (ElemType)learnRatePerSample, (ElemType)meanMomentum, 
-        (ElemType)varMomentum, biasCorrection, (ElemType)epsilon, unitGainMomentum, adamax); 
+        (ElemType)varMomentum, biasCorrection, (ElemType)epsilon, unitGainMomentum, adamax, lazySparseUpdate); 
         SetDataLocation(GPU); });
 
     // Note: Since both 'this' and gradients are changed, we must call SetDataLocation() on 'this' as well.
 }
 
+template <class ElemType>
+/*static*/ void Matrix<ElemType>::MultiSGDUpdate(const std::vector<Matrix<ElemType>*>& parameters, const std::vector<Matrix<ElemType>*>& gradients, ElemType learnRatePerSample)
+{
+    MultiTensorUpdate(MultiTensorUpdateParams<ElemType>::SGD(learnRatePerSample), parameters, gradients, std::vector<Matrix<ElemType>*>());
+}
+
+template <class ElemType>
+/*static*/ void Matrix<ElemType>::MultiMomentumSGDUpdate(const std::vector<Matrix<ElemType>*>& parameters, const std::vector<Matrix<ElemType>*>& gradients, const std::vector<Matrix<ElemType>*>& smoothedGradients,
+                                                         ElemType learnRatePerSample, ElemType momentum, bool unitGainMomentum, bool nesterov)
+{
+    MultiTensorUpdate(MultiTensorUpdateParams<ElemType>::MomentumSGD(learnRatePerSample, momentum, unitGainMomentum, nesterov), parameters, gradients, smoothedGradients);
+}
+
+template <class ElemType>
+/*static*/ void Matrix<ElemType>::MultiAdamUpdate(const std::vector<Matrix<ElemType>*>& parameters, const std::vector<Matrix<ElemType>*>& gradients, const std::vector<Matrix<ElemType>*>& smoothedGradients, const double smoothedCount,
+                                                  const double learnRatePerSample, const double meanMomentum, const double varMomentum, const double epsilon, bool unitGainMomentum, bool adamax)
+{
+    MultiTensorUpdate(MultiTensorUpdateParams<ElemType>::Adam(smoothedCount, learnRatePerSample, meanMomentum, varMomentum, epsilon, unitGainMomentum, adamax),
+                      parameters, gradients, smoothedGradients);
+}
+
+template <class ElemType>
+/*static*/ void Matrix<ElemType>::MultiTensorUpdate(const MultiTensorUpdateParams<ElemType>& params, const std::vector<Matrix<ElemType>*>& parameters, const std::vector<Matrix<ElemType>*>& gradients,
+                                                    const std::vector<Matrix<ElemType>*>& smoothedGradients)
+{
+    const bool hasSmoothedGradients = (params.type != MultiTensorUpdateType::SGD);
+    if ((gradients.size() != parameters.size()) || (hasSmoothedGradients && (smoothedGradients.size() != parameters.size())))
+        InvalidArgument("MultiTensorUpdate: The numbers of parameters, gradients and smoothed gradients differ.");
+    if (parameters.empty())
+        return;
+
+    // everything is moved to the device of the first parameter
+    const int deviceId = parameters[0]->GetDeviceId();
+    std::vector<Matrix<ElemType>*> updated; // (the matrices written to)
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+        if ((parameters[i]->GetMatrixType() != MatrixType::DENSE) || (gradients[i]->GetMatrixType() != MatrixType::DENSE) ||
+            (hasSmoothedGradients && (smoothedGradients[i]->GetMatrixType() != MatrixType::DENSE)))
+            NOT_IMPLEMENTED;
+
+        const size_t numElements = parameters[i]->GetNumElements();
+        if (gradients[i]->GetNumElements() != numElements)
+            LogicError("MultiTensorUpdate: The gradient of parameter %d does not have the dimensions of the parameter.", (int)i);
+        if (hasSmoothedGradients && (smoothedGradients[i]->GetNumElements() < params.NumSmoothedElements(numElements)))
+            LogicError("MultiTensorUpdate: The smoothed gradient of parameter %d has fewer than %d elements.", (int)i, (int)params.NumSmoothedElements(numElements));
+
+        parameters[i]->TransferToDeviceIfNotThere(deviceId, true);
+        gradients[i]->TransferToDeviceIfNotThere(deviceId, true);
+        updated.push_back(parameters[i]);
+        if (hasSmoothedGradients)
+        {
+            smoothedGradients[i]->TransferToDeviceIfNotThere(deviceId, true);
+            updated.push_back(smoothedGradients[i]);
+        }
+    }
+
+    if (deviceId < 0)
+    {
+        std::vector<CPUMatrix<ElemType>*> values, gradientValues, smoothedValues;
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            values.push_back(parameters[i]->m_CPUMatrix.get());
+            gradientValues.push_back(gradients[i]->m_CPUMatrix.get());
+            smoothedValues.push_back(hasSmoothedGradients ? smoothedGradients[i]->m_CPUMatrix.get() : nullptr);
+        }
+        CPUMatrix<ElemType>::MultiTensorUpdate(params, values, gradientValues, smoothedValues);
+    }
+    else
+    {
+        std::vector<GPUMatrix<ElemType>*> values, gradientValues, smoothedValues;
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            values.push_back(parameters[i]->m_GPUMatrix.get());
+            gradientValues.push_back(gradients[i]->m_GPUMatrix.get());
+            smoothedValues.push_back(hasSmoothedGradients ? smoothedGradients[i]->m_GPUMatrix.get() : nullptr);
+        }
+        GPUMatrix<ElemType>::MultiTensorUpdate(params, values, gradientValues, smoothedValues);
+    }
+
+    for (auto matrix : updated)
+        matrix->SetDataLocation(deviceId < 0 ? CPU : GPU, DENSE);
+}
+
+template <class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::AssignPackedBFloat16Of(const Matrix<ElemType>& a, unsigned long seed)
+{
+    if (a.GetMatrixType() != MatrixType::DENSE)
+        NOT_IMPLEMENTED;
+
+    DecideAndMoveToRightDevice(a, *this);
+    SwitchToMatrixType(MatrixType::DENSE, matrixFormatDense, false);
+
+    DISPATCH_MATRIX_ON_FLAG(&a,
+                            this,
+                            m_CPUMatrix->AssignPackedBFloat16Of(*a.m_CPUMatrix, seed),
+                            m_GPUMatrix->AssignPackedBFloat16Of(*a.m_GPUMatrix, seed),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+
+    return *this;
+}
+
+template <class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::AssignUnpackedBFloat16Of(const Matrix<ElemType>& packed)
+{
+    if ((packed.GetMatrixType() != MatrixType::DENSE) || (GetMatrixType() != MatrixType::DENSE))
+        NOT_IMPLEMENTED;
+
+    DecideAndMoveToRightDevice(packed, *this);
+
+    DISPATCH_MATRIX_ON_FLAG(&packed,
+                            this,
+                            m_CPUMatrix->AssignUnpackedBFloat16Of(*packed.m_CPUMatrix),
+                            m_GPUMatrix->AssignUnpackedBFloat16Of(*packed.m_GPUMatrix),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+
+    return *this;
+}
+
 template <class ElemType>
 ElemType Matrix<ElemType>::RmsProp(Matrix<ElemType>& gradients,
                                    ElemType RMS_GAMMA,
@@ -3404,7 +3697,22 @@ Matrix<ElemType>& Matrix<ElemType>::ScatterToIndices(const Matrix<ElemType>& val
 {
     if (indices.IsEmpty() || values.IsEmpty())
         LogicError("ScatterAccordingIndices: input matrix is empty.");
-    
+
+    // a sparse target (matrixFormatSparseBlockCol) receives the summed values of the columns that are hit
+    if (GetMatrixType() == SPARSE)
+    {
+        if (values.GetMatrixType() != DENSE || indices.GetMatrixType() != DENSE)
+            NOT_IMPLEMENTED;
+
+        DISPATCH_MATRIX_ON_FLAG(this,
+                                this,
+                                NOT_IMPLEMENTED,
+                                NOT_IMPLEMENTED,
+                                m_CPUSparseMatrix->ScatterToIndices(*values.m_CPUMatrix, *indices.m_CPUMatrix, row_elements),
+                                m_GPUSparseMatrix->ScatterToIndices(*values.m_GPUMatrix, *indices.m_GPUMatrix, row_elements));
+        return *this;
+    }
+
     DISPATCH_MATRIX_ON_FLAG(&values,
                             this,
                             m_CPUMatrix->ScatterToIndices(*values.m_CPUMatrix, *indices.m_CPUMatrix, row_elements),
@@ -4727,7 +5035,7 @@ void Matrix<ElemType>::BatchNormalizationBackward(const Matrix<ElemType>& in, Ma
 }
 
 template <class ElemType>
-void Matrix<ElemType>::RNNForward(const Matrix<ElemType> &inputX, const Matrix<ElemType> &paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const RnnAttributes& rnnAttributes, Matrix<ElemType>& reserve, Matrix<ElemType>& workspace)
+void Matrix<ElemType>::RNNForward(const Matrix<ElemType> &inputX, const Matrix<ElemType> &paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const RnnAttributes& rnnAttributes, Matrix<ElemType>& reserve, Matrix<ElemType>& workspace, bool inferenceOnly)
 {
     DecideAndMoveToRightDevice(*this, inputX, paramW);
     // move reserve/workspace to the consensus device
@@ -4737,7 +5045,7 @@ void Matrix<ElemType>::RNNForward(const Matrix<ElemType> &inputX, const Matrix<E
     DISPATCH_MATRIX_ON_FLAG(this,
                             this,
                             NOT_IMPLEMENTED,
-                            m_GPUMatrix->RNNForward(*(inputX.m_GPUMatrix), *(paramW.m_GPUMatrix), xDim, yDim, numSequencesForFrame, rnnAttributes, *(reserve.m_GPUMatrix), *(workspace.m_GPUMatrix)),
+                            m_GPUMatrix->RNNForward(*(inputX.m_GPUMatrix), *(paramW.m_GPUMatrix), xDim, yDim, numSequencesForFrame, rnnAttributes, *(reserve.m_GPUMatrix), *(workspace.m_GPUMatrix), inferenceOnly),
                             NOT_IMPLEMENTED,
                             NOT_IMPLEMENTED);
 }
@@ -4814,7 +5122,7 @@ void Matrix<ElemType>::SVD(const Matrix<ElemType>& A, Matrix<ElemType>& SIGMA, M
 /// <param name="c">Resulting matrix, user is responsible for allocating this</param>
 template <class ElemType>
 void Matrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const Matrix<ElemType>& a, const bool transposeA, const Matrix<ElemType>& b, const bool transposeB,
-                                              ElemType beta, Matrix<ElemType>& c, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier)
+                                              ElemType beta, Matrix<ElemType>& c, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier, shared_ptr<PackedGemmCache<ElemType>> pPackedA)
 {
     DecideAndMoveToRightDevice(a, b, c);
 
@@ -4875,7 +5183,7 @@ void Matrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const Matrix<ElemT
             else // CPU, DENSE * DENSE -> DENSE (matrix c enforced to be DENSE)
             {
                 c.SwitchToMatrixType(MatrixType::DENSE, matrixFormatDense, false);
-                CPUMatrix<ElemType>::MultiplyAndWeightedAdd(alpha, *a.m_CPUMatrix, transposeA, *b.m_CPUMatrix, transposeB, beta, *c.m_CPUMatrix, pQuantizedMultiplier);
+                CPUMatrix<ElemType>::MultiplyAndWeightedAdd(alpha, *a.m_CPUMatrix, transposeA, *b.m_CPUMatrix, transposeB, beta, *c.m_CPUMatrix, pQuantizedMultiplier, pPackedA);
                 c.SetDataLocation(CPU, DENSE);
             }
         }
@@ -4962,6 +5270,28 @@ void Matrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const Matrix<ElemT
     }
 }
 
+/// <summary>Batched matrix-matrix multiply with col-major matrices: c_i = alpha * op(a_i) * op(b_i) + beta * c_i</summary>
+/// Column i of a, b and c holds the i-th matrix of the batch: a_i is m x k (k x m if transposed), b_i is k x n (n x k if transposed)
+/// and c_i is m x n. a or b may consist of a single column, which is then used for every item of the batch.
+/// This replaces a loop of tiny MultiplyAndWeightedAdd() calls, e.g. one per sample, by one call.
+template <class ElemType>
+/*static*/ void Matrix<ElemType>::BatchedMultiplyAndWeightedAdd(ElemType alpha, const Matrix<ElemType>& a, const bool transposeA, const Matrix<ElemType>& b, const bool transposeB,
+                                                                ElemType beta, Matrix<ElemType>& c, const size_t m, const size_t n, const size_t k)
+{
+    DecideAndMoveToRightDevice(a, b, c);
+
+    if (a.GetMatrixType() != MatrixType::DENSE || b.GetMatrixType() != MatrixType::DENSE)
+        NOT_IMPLEMENTED;
+
+    c.SwitchToMatrixType(MatrixType::DENSE, matrixFormatDense, false);
+    DISPATCH_MATRIX_ON_FLAG(&c,
+                            &c,
+                            CPUMatrix<ElemType>::BatchedMultiplyAndWeightedAdd(alpha, *a.m_CPUMatrix, transposeA, *b.m_CPUMatrix, transposeB, beta, *c.m_CPUMatrix, m, n, k),
+                            GPUMatrix<ElemType>::BatchedMultiplyAndWeightedAdd(alpha, *a.m_GPUMatrix, transposeA, *b.m_GPUMatrix, transposeB, beta, *c.m_GPUMatrix, m, n, k),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+}
+
 template <class ElemType>
 /*static*/ void Matrix<ElemType>::Multiply1x1AndWeightedAdd(ElemType alpha, const Matrix<ElemType>& a, const Matrix<ElemType>& b, ElemType beta, Matrix<ElemType>& c)
 {
@@ -5076,7 +5406,7 @@ template <class ElemType>
         DISPATCH_MATRIX_ON_FLAG(&c, &c,
             { CPUMatrix<ElemType>::ScaleAndAdd(alpha, *a.m_CPUMatrix, *c.m_CPUMatrix); },
             { GPUMatrix<ElemType>::ScaleAndAdd(alpha, *a.m_GPUMatrix, *c.m_GPUMatrix); },
-            { NOT_IMPLEMENTED; },
+            { CPUSparseMatrix<ElemType>::ScaleAndAdd(alpha, *a.m_CPUSparseMatrix, *c.m_CPUSparseMatrix); },
             { GPUSparseMatrix<ElemType> b = move(*c.m_GPUSparseMatrix); GPUSparseMatrix<ElemType>::ScaleAndAdd(alpha, *a.m_GPUSparseMatrix, 1, b, *c.m_GPUSparseMatrix); });
     }
     else
@@ -5694,6 +6024,89 @@ void Matrix<ElemType>::InnerProductWithShiftNeg(const Matrix<ElemType>& a, const
                             NOT_IMPLEMENTED);
 }
 
+template <class ElemType>
+void Matrix<ElemType>::CosSimilarityWithNegativeSamples(const Matrix<ElemType>& a, const Matrix<ElemType>& b, Matrix<ElemType>& invNormA, Matrix<ElemType>& invNormB, Matrix<ElemType>& c, size_t shift, size_t negNumber)
+{
+    if (a.IsEmpty() || b.IsEmpty())
+        LogicError("CosSimilarityWithNegativeSamples: one of the input matrices is empty.");
+
+    DecideAndMoveToRightDevice(a, b, c, invNormA);
+    invNormB._transferToDevice(c.GetDeviceId());
+
+    if (a.GetMatrixType() != DENSE || b.GetMatrixType() != DENSE)
+        NOT_IMPLEMENTED;
+
+    c.SwitchToMatrixType(DENSE, matrixFormatDense, false);
+    invNormA.SwitchToMatrixType(DENSE, matrixFormatDense, false);
+    invNormB.SwitchToMatrixType(DENSE, matrixFormatDense, false);
+
+    DISPATCH_MATRIX_ON_FLAG(&c,
+                            &c,
+                            CPUMatrix<ElemType>::CosSimilarityWithNegativeSamples(*a.m_CPUMatrix, *b.m_CPUMatrix, *invNormA.m_CPUMatrix, *invNormB.m_CPUMatrix, *c.m_CPUMatrix, shift, negNumber),
+                            GPUMatrix<ElemType>::CosSimilarityWithNegativeSamples(*a.m_GPUMatrix, *b.m_GPUMatrix, *invNormA.m_GPUMatrix, *invNormB.m_GPUMatrix, *c.m_GPUMatrix, shift, negNumber),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+}
+
+template <class ElemType>
+void Matrix<ElemType>::AddCosSimilarityWithNegativeSamplesGradient(size_t inputIndex, const Matrix<ElemType>& a, const Matrix<ElemType>& b, const Matrix<ElemType>& invNormA, const Matrix<ElemType>& invNormB,
+                                                                   const Matrix<ElemType>& c, const Matrix<ElemType>& cGradient, Matrix<ElemType>& gradient, size_t shift, size_t negNumber)
+{
+    if (inputIndex > 1)
+        InvalidArgument("AddCosSimilarityWithNegativeSamplesGradient: inputIndex must be 0 or 1.");
+
+    DecideAndMoveToRightDevice(a, b, c, gradient);
+    DecideAndMoveToRightDevice(cGradient, invNormA, invNormB, gradient);
+
+    if (a.GetMatrixType() != DENSE || b.GetMatrixType() != DENSE || gradient.GetMatrixType() != DENSE)
+        NOT_IMPLEMENTED;
+
+    DISPATCH_MATRIX_ON_FLAG(&gradient,
+                            nullptr,
+                            CPUMatrix<ElemType>::AddCosSimilarityWithNegativeSamplesGradient(inputIndex, *a.m_CPUMatrix, *b.m_CPUMatrix, *invNormA.m_CPUMatrix, *invNormB.m_CPUMatrix, *c.m_CPUMatrix, *cGradient.m_CPUMatrix, *gradient.m_CPUMatrix, shift, negNumber),
+                            GPUMatrix<ElemType>::AddCosSimilarityWithNegativeSamplesGradient(inputIndex, *a.m_GPUMatrix, *b.m_GPUMatrix, *invNormA.m_GPUMatrix, *invNormB.m_GPUMatrix, *c.m_GPUMatrix, *cGradient.m_GPUMatrix, *gradient.m_GPUMatrix, shift, negNumber),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+}
+
+template <class ElemType>
+void Matrix<ElemType>::LambdaRankMetrics(const Matrix<ElemType>& gains, const Matrix<ElemType>& scores, const Matrix<ElemType>& queryBegins, Matrix<ElemType>& ranks, Matrix<ElemType>& metrics)
+{
+    DecideAndMoveToRightDevice(gains, scores, queryBegins, ranks);
+    metrics._transferToDevice(ranks.GetDeviceId());
+
+    if (gains.GetMatrixType() != DENSE || scores.GetMatrixType() != DENSE || queryBegins.GetMatrixType() != DENSE)
+        NOT_IMPLEMENTED;
+
+    ranks.SwitchToMatrixType(DENSE, matrixFormatDense, false);
+    metrics.SwitchToMatrixType(DENSE, matrixFormatDense, false);
+
+    DISPATCH_MATRIX_ON_FLAG(&ranks,
+                            nullptr,
+                            CPUMatrix<ElemType>::LambdaRankMetrics(*gains.m_CPUMatrix, *scores.m_CPUMatrix, *queryBegins.m_CPUMatrix, *ranks.m_CPUMatrix, *metrics.m_CPUMatrix),
+                            GPUMatrix<ElemType>::LambdaRankMetrics(*gains.m_GPUMatrix, *scores.m_GPUMatrix, *queryBegins.m_GPUMatrix, *ranks.m_GPUMatrix, *metrics.m_GPUMatrix),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+}
+
+template <class ElemType>
+void Matrix<ElemType>::AddLambdaRankGradient(const Matrix<ElemType>& gains, const Matrix<ElemType>& scores, const Matrix<ElemType>& queryBegins, const Matrix<ElemType>& ranks, const Matrix<ElemType>& metrics,
+                                             ElemType sigma, Matrix<ElemType>& gradient)
+{
+    DecideAndMoveToRightDevice(gains, scores, queryBegins, gradient);
+    DecideAndMoveToRightDevice(ranks, metrics, gradient);
+
+    if (gains.GetMatrixType() != DENSE || scores.GetMatrixType() != DENSE || gradient.GetMatrixType() != DENSE)
+        NOT_IMPLEMENTED;
+
+    DISPATCH_MATRIX_ON_FLAG(&gradient,
+                            nullptr,
+                            CPUMatrix<ElemType>::AddLambdaRankGradient(*gains.m_CPUMatrix, *scores.m_CPUMatrix, *queryBegins.m_CPUMatrix, *ranks.m_CPUMatrix, *metrics.m_CPUMatrix, sigma, *gradient.m_CPUMatrix),
+                            GPUMatrix<ElemType>::AddLambdaRankGradient(*gains.m_GPUMatrix, *scores.m_GPUMatrix, *queryBegins.m_GPUMatrix, *ranks.m_GPUMatrix, *metrics.m_GPUMatrix, sigma, *gradient.m_GPUMatrix),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+}
+
 template <class ElemType>
 Matrix<ElemType>& Matrix<ElemType>::GetARowByIndex(const Matrix<ElemType>& a, size_t index)
 {
@@ -5977,6 +6390,24 @@ void Matrix<ElemType>::TensorOp(ElemType beta, const Matrix<ElemType>& a, const
                             NOT_IMPLEMENTED,
                             NOT_IMPLEMENTED);
 }
+
+template <class ElemType>
+void Matrix<ElemType>::TensorOp(ElemType beta, const Matrix<ElemType>& a, const Matrix<ElemType>& b, const Matrix<ElemType>& c, ElemType alpha, const ElementWiseProgram& program,
+                                const array<size_t, 4>& offsets,
+                                const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                                const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 4>& reducingStrides)
+{
+    VerifyIsDense(*this) && VerifyIsDense(a) && VerifyIsDense(b) && VerifyIsDense(c);
+
+    DecideAndMoveToRightDevice(*this, a, b, c);
+
+    DISPATCH_MATRIX_ON_FLAG(this,
+                            this,
+                            m_CPUMatrix->TensorOp(beta, *a.m_CPUMatrix, *b.m_CPUMatrix, *c.m_CPUMatrix, alpha, program, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides),
+                            m_GPUMatrix->TensorOp(beta, *a.m_GPUMatrix, *b.m_GPUMatrix, *c.m_GPUMatrix, alpha, program, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+}
 template <class ElemType>
 void Matrix<ElemType>::TensorArgOp(const Matrix<ElemType>& a, ElementWiseOperator reductionOp,
                                    const array<size_t, 2>& offsets,
@@ -6052,6 +6483,33 @@ template void Matrix<short>::Resize(const size_t numRows, const size_t numCols,
 template void Matrix<short>::Reshape(const size_t, const size_t);
 template short* Matrix<short>::CopyToArray(void) const;
 
+// Matrix<half> methods -- half is a storage type for now, so only the methods needed to allocate, move and convert are instantiated
+template Matrix<half>::Matrix(DEVICEID_TYPE);
+template Matrix<half>::Matrix(Matrix<half>&&);
+template Matrix<half>::Matrix(const size_t numRows, const size_t numCols, DEVICEID_TYPE deviceId, const MatrixType matrixType, const MatrixFormat matrixFormat, const size_t nnz);
+template Matrix<half>::Matrix(const size_t numRows, const size_t numCols, half* pArray, DEVICEID_TYPE deviceId, const size_t matrixFlags, const size_t nnz);
+template Matrix<half>::~Matrix();
+template Matrix<half>& Matrix<half>::operator=(Matrix<half>&& moveFrom);
+template half* Matrix<half>::Data() const;
+template int Matrix<half>::GetDeviceId() const;
+template size_t Matrix<half>::GetNumElements() const;
+template Matrix<half> Matrix<half>::ColumnSlice(size_t startColumn, size_t numCols) const;
+template void Matrix<half>::_transferToDevice(int id_to, bool isBeingMoved, bool emptyTransfer) const;
+template void Matrix<half>::TransferToDeviceIfNotThere(int id_to, bool isBeingMoved, bool emptyTransfer, bool updatePreferredDevice) const;
+template size_t Matrix<half>::GetNumRows() const;
+template size_t Matrix<half>::GetNumCols() const;
+template void Matrix<half>::SetValue(const half);
+template void Matrix<half>::SetValue(size_t numRows, const size_t numCols, int deviceId, half* pArray, size_t matrixFlags, DataTransferer* transferer);
+//template void Matrix<half>::SetValue(const Matrix<half>&, MatrixFormat);
+template void Matrix<half>::SetValue(const Matrix<half>&);
+template void Matrix<half>::AssignValuesOf(const Matrix<half>&);
+template void Matrix<half>::CastAssignValuesOf(const MatrixBase& other);
+template bool Matrix<half>::IsEmpty() const;
+template void Matrix<half>::Resize(const size_t numRows, const size_t numCols, const size_t numNZElemToReserve, bool growOnly);
+template void Matrix<half>::Reshape(const size_t, const size_t);
+template half* Matrix<half>::CopyToArray(void) const;
+template size_t Matrix<half>::CopyToArray(half*& arrayCopyTo, size_t& currentArraySize) const;
+
 template Matrix<int>::Matrix(const size_t, const size_t, int*, DEVICEID_TYPE, const size_t, const size_t);
 
 }}}
@@ -20,6 +20,7 @@
 #include <array>
 #include <initializer_list>
 #include "QuantizedOperations.h"
+#include "PackedGemmCache.h"
 
 // Forward declarations
 namespace CNTK
@@ -52,6 +53,7 @@ template <class ElemType> class CPUMatrix;
 template <class ElemType> class GPUSparseMatrix;
 template <class ElemType> class CPUSparseMatrix;
 template <class ElemType> class DeviceBoundNumber;
+template <class ElemType> struct MultiTensorUpdateParams;
 
 // <ElemType>-agnostic base class
 struct /*interface*/ MATH_API MatrixBase
@@ -149,6 +151,8 @@ private:
     void Init(DEVICEID_TYPE deviceID);
     void SetDataLocation(CurrentDataLocation location, MatrixType type = UNDETERMINED) const;
     void ShallowCopyFrom(const Matrix<ElemType>& other);
+    static void MultiTensorUpdate(const MultiTensorUpdateParams<ElemType>& params, const std::vector<Matrix<ElemType>*>& parameters, const std::vector<Matrix<ElemType>*>& gradients,
+                                  const std::vector<Matrix<ElemType>*>& smoothedGradients);
 
 public:
     // down-cast to make life easier
@@ -205,20 +209,35 @@ public:
     void AssignDiagonalValuesTo(Matrix<ElemType>& diag) const;
 
     void SGDUpdate(Matrix<ElemType>& gradients, ElemType learnRatePerSample);
-    void MomentumSGDUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& smoothedGradients, ElemType learnRatePerSample, ElemType momentum, bool unitGainMomentum = true);
+    // 'lazySparseUpdate' only updates the columns of block-sparse gradients, see LazySparseUpdate.h
+    void MomentumSGDUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& smoothedGradients, ElemType learnRatePerSample, ElemType momentum, bool unitGainMomentum = true, bool lazySparseUpdate = false);
     void NesterovAcceleratedMomentumSGDUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& smoothedGradients, ElemType learnRatePerSample, ElemType momentum, bool unitGainMomentum = true);
 
     ElemType Adagrad(Matrix<ElemType>& gradients, const bool needAveMultiplier);
     void FSAdagradUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& functionValues, const double targetAdagradAvDenom_x_sqrtAdagradSqrFrames,
-                         const double learnRatePerSample, const double meanMomentum, const double varMomentum, bool unitGainMomentum = true);
+                         const double learnRatePerSample, const double meanMomentum, const double varMomentum, bool unitGainMomentum = true, bool lazySparseUpdate = false);
 
     void AdamUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& functionValues, const double smoothedCount,
-        const double learnRatePerSample, const double meanMomentum, const double varMomentum, const double epsilon, bool unitGainMomentum = true, bool adamax = false);
+        const double learnRatePerSample, const double meanMomentum, const double varMomentum, const double epsilon, bool unitGainMomentum = true, bool adamax = false, bool lazySparseUpdate = false);
+
+    // Fused updates of a list of dense parameters with their gradients (and smoothed gradients) on the same device, in a single pass
+    // over all of them rather than a few passes per parameter, see MultiTensorUpdate.h. The gradients are not modified.
+    static void MultiSGDUpdate(const std::vector<Matrix<ElemType>*>& parameters, const std::vector<Matrix<ElemType>*>& gradients, ElemType learnRatePerSample);
+    static void MultiMomentumSGDUpdate(const std::vector<Matrix<ElemType>*>& parameters, const std::vector<Matrix<ElemType>*>& gradients, const std::vector<Matrix<ElemType>*>& smoothedGradients,
+                                       ElemType learnRatePerSample, ElemType momentum, bool unitGainMomentum = true, bool nesterov = false);
+    static void MultiAdamUpdate(const std::vector<Matrix<ElemType>*>& parameters, const std::vector<Matrix<ElemType>*>& gradients, const std::vector<Matrix<ElemType>*>& smoothedGradients, const double smoothedCount,
+                                const double learnRatePerSample, const double meanMomentum, const double varMomentum, const double epsilon, bool unitGainMomentum = true, bool adamax = false);
 
     ElemType RmsProp(Matrix<ElemType>& gradients, ElemType RMS_GAMMA, ElemType RMS_WGT_INC, ElemType RMS_WGT_MAX, ElemType RMS_WGT_DEC, ElemType RMS_WGT_MIN, const bool needAveMultiplier, const bool initialized);
 
     void AdaDeltaUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& functionvalues, ElemType learningRatePerSample, ElemType rho, ElemType epsilon);
 
+    // Stores the elements of the dense matrix 'a' as bfloat16 numbers rounded stochastically with the 'seed' (see BFloat16.h); this becomes
+    // a column vector of BFloat16::NumPackedElements<ElemType>(a.GetNumElements()) elements. The reverse is AssignUnpackedBFloat16Of(),
+    // into a matrix that has the dimensions of 'a'.
+    Matrix<ElemType>& AssignPackedBFloat16Of(const Matrix<ElemType>& a, unsigned long seed);
+    Matrix<ElemType>& AssignUnpackedBFloat16Of(const Matrix<ElemType>& packed);
+
     void Resize(const size_t numRows, const size_t numCols, const size_t numNZElemToReserve = 10000, bool growOnly = true); // by default we only reallocate if need to grow
     void Resize(const Matrix<ElemType>& other) // TODO: Should this carry over numNZElemToReserve for sparse matrices?
     {
@@ -282,6 +301,8 @@ public:
     }
     void SetMatrixFromCSCFormat(const CPUSPARSE_INDEX_TYPE* h_CSCCol, const CPUSPARSE_INDEX_TYPE* h_Row, const ElemType* h_Val,
         const size_t nz, const size_t numRows, const size_t numCols, DataTransferer* transferer = nullptr);
+    // the reverse of SetMatrixFromCSCFormat() for a sparse CSC matrix on any device; colStarts begin at 0
+    void CopyToCSCFormat(std::vector<CPUSPARSE_INDEX_TYPE>& colStarts, std::vector<CPUSPARSE_INDEX_TYPE>& rowIndices, std::vector<ElemType>& values) const;
 
     void MaskColumnsValue(const Matrix<char>& columnsMask, ElemType val, size_t numColsPerMaskEntry);
 
@@ -297,6 +318,10 @@ public:
     void SetGumbelRandomValue(RNGHandle& rngHandle, const ElemType loc, const ElemType scale);
     void SetGaussianRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED);
     void SetTruncatedNormalRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED);
+    // random values generated in place on the matrix's device, the same on the CPU (with any number of threads) and the GPU
+    // 'a' and 'b' are the parameters of the distribution (see CounterBasedRandom::Value()); element i is drawn at position offset + i
+    // of the stream of 'seed', so a stream can be continued by the next call, or a range of it drawn again
+    void SetCounterBasedRandomValue(RandomDistribution distribution, const ElemType a, const ElemType b, unsigned long seed = USE_TIME_BASED_SEED, uint64_t offset = 0);
     void SetUniformRandomMask(const ElemType maskRate, const ElemType scaleValue, RNGHandle& rngHandle);
     void AddGaussianRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED);
     Matrix<ElemType>& AssignNoiseContrastiveEstimation(const Matrix<ElemType>& a, const Matrix<ElemType>& b, const Matrix<ElemType>& c, const Matrix<ElemType>& bias, Matrix<ElemType>& tmp);
@@ -551,7 +576,7 @@ public:
     void BatchNormalizationBackward(const Matrix<ElemType>& in, Matrix<ElemType>& grad, const Matrix<ElemType>& scale, double blendFactor, const Matrix<ElemType>& saveMean, const Matrix<ElemType>& saveInvStdDev,
                                     Matrix<ElemType>& scaleGrad, Matrix<ElemType>& biasGrad) const;
 
-    void RNNForward(const Matrix<ElemType>& inputX, const Matrix<ElemType>& paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const struct RnnAttributes& rnnAttributes, Matrix<ElemType>& reserve, Matrix<ElemType>& workspace);
+    void RNNForward(const Matrix<ElemType>& inputX, const Matrix<ElemType>& paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const struct RnnAttributes& rnnAttributes, Matrix<ElemType>& reserve, Matrix<ElemType>& workspace, bool inferenceOnly);
     void RNNBackwardData(const Matrix<ElemType>& outputDY, const Matrix<ElemType>& paramW, Matrix<ElemType>& outputDX, const struct RnnAttributes& rnnAttributes, Matrix<ElemType>& reserve, Matrix<ElemType>& workspace);
     void RNNBackwardWeights(const Matrix<ElemType>& inputX, const Matrix<ElemType>& outputY, Matrix<ElemType>& dw, const struct RnnAttributes& rnnAttributes, Matrix<ElemType>& reserve, Matrix<ElemType>& workspace);
 
@@ -567,10 +592,12 @@ public:
     // singular value decomposition of A as A = U*SIGMA*VT
     static void SVD(const Matrix<ElemType>& A, Matrix<ElemType>& SIGMA, Matrix<ElemType>& U, Matrix<ElemType>& VT, Matrix<ElemType>& W);
 
-    static void MultiplyAndWeightedAdd(ElemType alpha, const Matrix<ElemType>& a, const bool transposeA, const Matrix<ElemType>& b, const bool transposeB, ElemType beta, Matrix<ElemType>& c, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier=nullptr); // SGEMM
+    static void MultiplyAndWeightedAdd(ElemType alpha, const Matrix<ElemType>& a, const bool transposeA, const Matrix<ElemType>& b, const bool transposeB, ElemType beta, Matrix<ElemType>& c, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier=nullptr, shared_ptr<PackedGemmCache<ElemType>> pPackedA=nullptr); // SGEMM
     static void MultiplyAndAdd(const Matrix<ElemType>& a, const bool transposeA, const Matrix<ElemType>& b, const bool transposeB, Matrix<ElemType>& c);
     static void Multiply(const Matrix<ElemType>& a, const bool transposeA, const Matrix<ElemType>& b, const bool transposeB, Matrix<ElemType>& c);
     static void Multiply(const Matrix<ElemType>& a, const Matrix<ElemType>& b, Matrix<ElemType>& c);
+    // batched SGEMM: column i of a, b and c holds the i-th product of the batch, c_i[m x n] = alpha * op(a_i) * op(b_i) + beta * c_i
+    static void BatchedMultiplyAndWeightedAdd(ElemType alpha, const Matrix<ElemType>& a, const bool transposeA, const Matrix<ElemType>& b, const bool transposeB, ElemType beta, Matrix<ElemType>& c, const size_t m, const size_t n, const size_t k);
     static void Multiply1x1AndWeightedAdd(ElemType alpha, const Matrix<ElemType>& a, const Matrix<ElemType>& b, ElemType beta, Matrix<ElemType>& c);
     static void ConvolveAndWeightedAdd(ElemType alpha, const Matrix<ElemType>& a, const bool transposeA, const Matrix<ElemType>& b, const bool transposeB, ElemType beta, Matrix<ElemType>& c, size_t numChannels, size_t horizontalSubsample, bool padding, bool channelwise);
 
@@ -612,6 +639,11 @@ public:
                   const std::array<size_t, 4>& offsets,
                   const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& regularStrides,
                   const SmallVector<size_t>& reducingOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
+    // fused element-wise program over up to three inputs; no reduction other than summation
+    void TensorOp(ElemType beta, const Matrix<ElemType>& a, const Matrix<ElemType>& b, const Matrix<ElemType>& c, ElemType alpha, const ElementWiseProgram& program,
+                  const std::array<size_t, 4>& offsets,
+                  const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                  const SmallVector<size_t>& reducingOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
 
     void TensorArgOp(const Matrix<ElemType>& a, ElementWiseOperator reductionOp,
                      const std::array<size_t, 2>& offsets,
@@ -621,6 +653,7 @@ public:
 public:
     void Read(File& stream);
     void Write(File& stream) const;
+    void Write(File& stream, MatrixStorageFormat storageFormat) const; // lossy unless 'full', e.g. for smaller model files
 
     Matrix<ElemType>& Shift(const Matrix<ElemType>& a, int shift);
 
@@ -629,6 +662,20 @@ public:
     static void InnerProductWithShiftNeg(const Matrix<ElemType>& a, const Matrix<ElemType>& b, Matrix<ElemType>& c, const bool isColWise, size_t shift, size_t negnumber);
     Matrix<ElemType>& GetARowByIndex(const Matrix<ElemType>& a, size_t index);
     static void ConductRowElementMultiplyWithShift(const Matrix<ElemType>& a, const Matrix<ElemType>& b, Matrix<ElemType>& c, size_t shift, bool bFirstmatrixfixed);
+    // the value of CosDistanceWithNegativeSamplesNode in one pass over the inputs: c(0, j) = cos(a(:, j), b(:, j)), and
+    // c(i, j) = cos(a(:, j), b(:, (j + shift + i - 1) % n)) for the negative samples i = 1..negNumber
+    // invNormA and invNormB receive the inverse norms of the columns of a and b (as rows), which the gradient needs.
+    static void CosSimilarityWithNegativeSamples(const Matrix<ElemType>& a, const Matrix<ElemType>& b, Matrix<ElemType>& invNormA, Matrix<ElemType>& invNormB, Matrix<ElemType>& c, size_t shift, size_t negNumber);
+    // add the gradient w.r.t. a (inputIndex 0) or b (inputIndex 1) of the above to 'gradient', given the gradient of c
+    static void AddCosSimilarityWithNegativeSamplesGradient(size_t inputIndex, const Matrix<ElemType>& a, const Matrix<ElemType>& b, const Matrix<ElemType>& invNormA, const Matrix<ElemType>& invNormB,
+                                                            const Matrix<ElemType>& c, const Matrix<ElemType>& cGradient, Matrix<ElemType>& gradient, size_t shift, size_t negNumber);
+    // LambdaRankNode for the queries whose urls are the columns [queryBegins(0, q), queryBegins(0, q + 1)) of the rows 'gains'
+    // and 'scores', each query sorted by descending gain: ranks(0, i) receives the rank of url i in its query by the scores
+    // (see LambdaRank.h), metrics(0, q) the ideal DCG of query q and metrics(1, q) the DCG of the ranking
+    static void LambdaRankMetrics(const Matrix<ElemType>& gains, const Matrix<ElemType>& scores, const Matrix<ElemType>& queryBegins, Matrix<ElemType>& ranks, Matrix<ElemType>& metrics);
+    // add the lambdas of all pairs of urls of each query, given the ranks and metrics of the above, to the gradient of the scores
+    static void AddLambdaRankGradient(const Matrix<ElemType>& gains, const Matrix<ElemType>& scores, const Matrix<ElemType>& queryBegins, const Matrix<ElemType>& ranks, const Matrix<ElemType>& metrics,
+                                      ElemType sigma, Matrix<ElemType>& gradient);
     Matrix<ElemType>& AssignElementProductOfWithShift(const Matrix<ElemType>& a, const Matrix<ElemType>& b, size_t shift);
 
 public:
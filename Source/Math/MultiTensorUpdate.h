@@ -0,0 +1,173 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Fused learner updates of many parameters at once, shared by the CPU and GPU implementations.
+//
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+#pragma push_macro("MULTI_TENSOR_UPDATE_DECL")
+#ifndef MULTI_TENSOR_UPDATE_DECL // to make these accessible to CUDA kernels, say '#define MULTI_TENSOR_UPDATE_DECL __device__ __host__'
+#define MULTI_TENSOR_UPDATE_DECL
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// MultiTensorUpdate -- the SGD, momentum SGD, Nesterov and Adam updates of a list of dense parameters in a single pass
+// Updating the parameters of a model one by one takes a few kernel launches per parameter, which dominates the time of
+// the update for models with many small parameters. Here, the parameters (with their gradients and smoothed gradients)
+// are cut into chunks of at most ChunkSize elements, and a single kernel processes a table of up to MaxChunks chunks,
+// a thread block per chunk. The table is passed as a kernel argument, which is limited to 4 KB.
+// The updates compute the same as SGDUpdate(), MomentumSGDUpdate(), NesterovAcceleratedMomentumSGDUpdate() and
+// AdamUpdate() of Matrix for dense matrices, up to rounding.
+enum class MultiTensorUpdateType
+{
+    SGD,
+    MomentumSGD,
+    Nesterov,
+    Adam,
+    Adamax
+};
+
+template <class ElemType>
+struct MultiTensorChunk
+{
+    static const size_t ChunkSize = 1 << 16;
+
+    ElemType* values;
+    const ElemType* gradients;
+    ElemType* smoothed;       // the smoothed gradients, or the second moments for Adam (nullptr for SGD)
+    ElemType* smoothedMoment; // the first moments for Adam (otherwise nullptr)
+    int size;
+};
+
+template <class ElemType>
+struct MultiTensorChunkTable
+{
+    static const int MaxChunks = 64;
+
+    int numChunks;
+    MultiTensorChunk<ElemType> chunks[MaxChunks];
+};
+
+template <class ElemType>
+struct MultiTensorUpdateParams
+{
+    MultiTensorUpdateType type;
+    ElemType learnRatePerSample;
+    ElemType momentum;
+    ElemType unitGainFactor;
+    ElemType adaWeight;      // (Adam only)
+    ElemType biasCorrection; // (Adam only)
+    ElemType epsilon;        // (Adam only)
+
+    static MultiTensorUpdateParams SGD(ElemType learnRatePerSample)
+    {
+        return{ MultiTensorUpdateType::SGD, learnRatePerSample, 0, 1, 0, 1, 0 };
+    }
+
+    static MultiTensorUpdateParams MomentumSGD(ElemType learnRatePerSample, ElemType momentum, bool unitGainMomentum, bool nesterov)
+    {
+        return{ nesterov ? MultiTensorUpdateType::Nesterov : MultiTensorUpdateType::MomentumSGD,
+                learnRatePerSample, momentum, ElemType(unitGainMomentum ? (1.0 - momentum) : 1.0), 0, 1, 0 };
+    }
+
+    static MultiTensorUpdateParams Adam(double smoothedCount, double learnRatePerSample, double meanMomentum, double varMomentum, double epsilon, bool unitGainMomentum, bool adamax)
+    {
+        // (the bias correction as in Matrix::AdamUpdate())
+        const double biasCorrection = adamax ? (1. / (1 - std::pow(meanMomentum, smoothedCount))) : (std::sqrt(1 - std::pow(varMomentum, smoothedCount)) / (1 - std::pow(meanMomentum, smoothedCount)));
+        return{ adamax ? MultiTensorUpdateType::Adamax : MultiTensorUpdateType::Adam,
+                (ElemType)learnRatePerSample, (ElemType)meanMomentum, ElemType(unitGainMomentum ? (1.0 - meanMomentum) : 1.0),
+                (ElemType)varMomentum, (ElemType)biasCorrection, (ElemType)epsilon };
+    }
+
+    // the number of elements of the smoothed gradient of a parameter of numElements elements
+    size_t NumSmoothedElements(size_t numElements) const
+    {
+        switch (type)
+        {
+        case MultiTensorUpdateType::SGD:         return 0;
+        case MultiTensorUpdateType::MomentumSGD:
+        case MultiTensorUpdateType::Nesterov:    return numElements;
+        default:                                 return 2 * numElements; // (Adam: the second moments, followed by the first moments)
+        }
+    }
+
+    // append the chunks of a parameter of numElements elements
+    void AppendChunks(ElemType* values, const ElemType* gradients, ElemType* smoothed, size_t numElements, std::vector<MultiTensorChunk<ElemType>>& chunks) const
+    {
+        const size_t chunkSize = MultiTensorChunk<ElemType>::ChunkSize;
+        const bool isAdam = (type == MultiTensorUpdateType::Adam) || (type == MultiTensorUpdateType::Adamax);
+        for (size_t begin = 0; begin < numElements; begin += chunkSize)
+        {
+            MultiTensorChunk<ElemType> chunk;
+            chunk.values = values + begin;
+            chunk.gradients = gradients + begin;
+            chunk.smoothed = (type == MultiTensorUpdateType::SGD) ? nullptr : smoothed + begin;
+            chunk.smoothedMoment = isAdam ? smoothed + numElements + begin : nullptr;
+            chunk.size = (int)(std::min)(chunkSize, numElements - begin);
+            chunks.push_back(chunk);
+        }
+    }
+
+    // update element i of the chunk
+    inline MULTI_TENSOR_UPDATE_DECL void Update(const MultiTensorChunk<ElemType>& chunk, int i) const
+    {
+        const ElemType g = chunk.gradients[i];
+        switch (type)
+        {
+        case MultiTensorUpdateType::SGD:
+            // w_t = w_{t-1} - learnRatePerSample * g_{t-1}
+            chunk.values[i] -= learnRatePerSample * g;
+            break;
+        case MultiTensorUpdateType::MomentumSGD:
+        {
+            // sg_t = momentum * sg_{t-1} + learnRatePerSample * unitGainFactor * g_{t-1}
+            // w_t = w_{t-1} - sg_t
+            const ElemType sg = momentum * chunk.smoothed[i] + unitGainFactor * learnRatePerSample * g;
+            chunk.smoothed[i] = sg;
+            chunk.values[i] -= sg;
+            break;
+        }
+        case MultiTensorUpdateType::Nesterov:
+        {
+            // sg_t = momentum * sg_{t-1} + learnRatePerSample * unitGainFactor * g_{t-1}
+            // w_t = w_{t-1} - momentum * sg_t - learnRatePerSample * unitGainFactor * g_{t-1}
+            const ElemType sg = momentum * chunk.smoothed[i] + unitGainFactor * learnRatePerSample * g;
+            chunk.smoothed[i] = sg;
+            chunk.values[i] -= momentum * sg + unitGainFactor * learnRatePerSample * g;
+            break;
+        }
+        default: // Adam and Adamax
+        {
+            ElemType ada;
+            if (type == MultiTensorUpdateType::Adam)
+            {
+                const ElemType adaSqr = adaWeight * chunk.smoothed[i] + (1 - adaWeight) * g * g;
+                chunk.smoothed[i] = adaSqr;
+                ada = (sizeof(ElemType) == sizeof(double)) ? (ElemType)sqrt((double)adaSqr) : (ElemType)sqrtf((float)adaSqr);
+            }
+            else
+            {
+                const ElemType gAbs = (g < 0) ? -g : g;
+                const ElemType decayed = adaWeight * chunk.smoothed[i];
+                ada = chunk.smoothed[i] = (decayed > gAbs) ? decayed : gAbs;
+            }
+            const ElemType m = momentum * chunk.smoothedMoment[i] + unitGainFactor * g;
+            chunk.smoothedMoment[i] = m;
+            chunk.values[i] -= learnRatePerSample * m * biasCorrection / (ada + epsilon);
+            break;
+        }
+        }
+    }
+};
+
+}}}
+
+#pragma pop_macro("MULTI_TENSOR_UPDATE_DECL")
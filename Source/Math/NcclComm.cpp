@@ -5,10 +5,40 @@
 
 #include "NcclComm.h"
 
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+static bool s_hierarchicalAllReduce = false;
+static bool s_enabled = true;
+
+/*static*/ void NcclComm::SetHierarchicalAllReduce(bool enable)
+{
+    s_hierarchicalAllReduce = enable;
+}
+
+/*static*/ bool NcclComm::ShouldUseHierarchicalAllReduce()
+{
+    return s_hierarchicalAllReduce;
+}
+
+/*static*/ void NcclComm::SetEnabled(bool enable)
+{
+    s_enabled = enable;
+}
+
+/*static*/ bool NcclComm::IsEnabled()
+{
+    return s_enabled;
+}
+
+}}}
+
 #ifdef USE_NCCL
 #include "GPUMatrix.h"
+#include "GpuTopology.h"
 #include <nccl.h>
 #include <cuda_runtime.h>
+#include <algorithm>
+#include <cstring>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -19,65 +49,335 @@ static void operator||(cudaError_t rc, const char *msg)
         RuntimeError("%s: %s (cuda error %d)", msg, cudaGetErrorString(rc), (int) rc);
 }
 
+// same for NCCL
+static void operator||(ncclResult_t res, const char *msg)
+{
+    if (res != ncclSuccess)
+        RuntimeError("%s: %s", msg, ncclGetErrorString(res));
+}
+
+// The position of the device in the ring of the devices of the ranks on this host, ordered by the GPU topology.
+static int RingPosition(int deviceId, const std::vector<int>& deviceIds)
+{
+    std::vector<int> order = GpuTopology::RingOrder(deviceIds);
+    return (int)(std::find(order.begin(), order.end(), deviceId) - order.begin());
+}
+
 NcclComm::NcclComm(int deviceId, const MPIWrapperPtr& mpi)
-    : m_ncclComm(nullptr), m_stream(nullptr)
+    : m_ncclComm(nullptr), m_crossHostComm(nullptr), m_stream(nullptr), m_computeDoneEvent(nullptr), m_localRank(0), m_numLocalRanks(1), m_localRootRank(0)
 {
+    if (!IsEnabled())
+    {
+        fprintf(stderr, "NcclComm: disabled\n");
+        return;
+    }
+
     if (mpi->IsMultiHost())
+    {
+        if (!ShouldUseHierarchicalAllReduce() || !InitHierarchical(deviceId, mpi))
+            return;
+    }
+    else
+    {
+        size_t numRanks = mpi->NumNodesInUse();
+        std::vector<int> allDevs(numRanks);
+        mpi->Allgather(&deviceId, 1, MPI_INT, allDevs.data(), 1, MPI_INT);
+
+        for (size_t r = 0; r<numRanks; r++)
+        {
+            if (allDevs[r] == CPUDEVICE)
+            {
+                fprintf(stderr, "NcclComm: disabled, at least one rank using CPU device\n");
+                return;
+            }
+            for (size_t s = 0; s<r; s++)
+                if (allDevs[r] == allDevs[s])
+                {
+                    fprintf(stderr, "NcclComm: disabled, same device used by more than one rank\n");
+                    return;
+                }
+        }
+
+        int ncclRank = (int)mpi->CurrentNodeRank();
+        if (GpuTopology::IsEnabled())
+        {
+            m_ncclRankOfRank.resize(numRanks);
+            ncclRank = RingPosition(deviceId, allDevs);
+            mpi->Allgather(&ncclRank, 1, MPI_INT, m_ncclRankOfRank.data(), 1, MPI_INT);
+        }
+
+        ncclUniqueId ncclId;
+        ncclResult_t res;
+
+        res = ncclGetUniqueId(&ncclId);
+        if (res != ncclSuccess)
+            RuntimeError("NcclComm failed to obtain ncclUniqueId: %s", ncclGetErrorString(res));
+
+        mpi->Bcast(&ncclId, NCCL_UNIQUE_ID_BYTES, MPI_CHAR, 0);
+
+        PrepareDevice(deviceId);
+        res = ncclCommInitRank(&m_ncclComm, numRanks, ncclId, ncclRank);
+        if (res != ncclSuccess)
+            RuntimeError("NcclComm failed to initialize ncclComm_t: %s", ncclGetErrorString(res));
+    }
+
+    // The stream does not synchronize implicitly with the compute stream, so that reductions started during backprop
+    // overlap with it; instead each operation waits for the work already queued on the compute stream, see WaitForComputeStream().
+    cudaStreamCreateWithFlags(&m_stream, cudaStreamNonBlocking)
+        || "cudaStreamCreateWithFlags failed";
+    cudaEventCreateWithFlags(&m_computeDoneEvent, cudaEventDisableTiming)
+        || "cudaEventCreateWithFlags failed";
+    fprintf(stderr, "NcclComm: initialized\n");
+}
+
+NcclComm::NcclComm(int deviceId, const MPIWrapperPtr& mpi, size_t group)
+    : m_ncclComm(nullptr), m_crossHostComm(nullptr), m_stream(nullptr), m_computeDoneEvent(nullptr), m_localRank(0), m_numLocalRanks(1), m_localRootRank(0)
+{
+    if (!IsEnabled())
+    {
+        fprintf(stderr, "NcclComm: disabled\n");
         return;
+    }
 
     size_t numRanks = mpi->NumNodesInUse();
+    size_t myRank = mpi->CurrentNodeRank();
+    int myGroup = (int)group;
+    std::vector<int> allGroups(numRanks), allDevs(numRanks);
+    mpi->Allgather(&myGroup, 1, MPI_INT, allGroups.data(), 1, MPI_INT);
+    mpi->Allgather(&deviceId, 1, MPI_INT, allDevs.data(), 1, MPI_INT);
+    if (std::find(allDevs.begin(), allDevs.end(), CPUDEVICE) != allDevs.end())
+    {
+        fprintf(stderr, "NcclComm: disabled, at least one rank using CPU device\n");
+        return;
+    }
+#if NCCL_MAJOR < 2
+    if (mpi->IsMultiHost())
+    {
+        fprintf(stderr, "NcclComm: disabled, communicators across hosts require NCCL 2 or newer\n");
+        return;
+    }
+#endif
+
+    // the first rank of each group creates the NCCL id of its group
+    size_t groupRoot = std::find(allGroups.begin(), allGroups.end(), myGroup) - allGroups.begin();
+    int groupRank = (int)std::count(allGroups.begin(), allGroups.begin() + myRank, myGroup);
+    int groupSize = (int)std::count(allGroups.begin(), allGroups.end(), myGroup);
+    ncclUniqueId myId;
+    memset(&myId, 0, sizeof(myId));
+    if (groupRoot == myRank)
+        ncclGetUniqueId(&myId) || "NcclComm failed to obtain ncclUniqueId";
+    std::vector<ncclUniqueId> allIds(numRanks);
+    mpi->Allgather(&myId, NCCL_UNIQUE_ID_BYTES, MPI_CHAR, allIds.data(), NCCL_UNIQUE_ID_BYTES, MPI_CHAR);
+
+    PrepareDevice(deviceId);
+    ncclCommInitRank(&m_ncclComm, groupSize, allIds[groupRoot], groupRank) || "NcclComm failed to initialize ncclComm_t";
+    cudaStreamCreateWithFlags(&m_stream, cudaStreamNonBlocking)
+        || "cudaStreamCreateWithFlags failed";
+    cudaEventCreateWithFlags(&m_computeDoneEvent, cudaEventDisableTiming)
+        || "cudaEventCreateWithFlags failed";
+    fprintf(stderr, "NcclComm: initialized for group %d of %d ranks\n", myGroup, groupSize);
+}
+
+NcclComm::NcclComm(const std::vector<int>& deviceIds)
+    : m_ncclComm(nullptr), m_crossHostComm(nullptr), m_stream(nullptr), m_computeDoneEvent(nullptr), m_localRank(0), m_numLocalRanks(1), m_localRootRank(0)
+{
+    if (!IsEnabled())
+    {
+        fprintf(stderr, "NcclComm: disabled\n");
+        return;
+    }
+    for (size_t k = 0; k < deviceIds.size(); k++)
+    {
+        if (deviceIds[k] == CPUDEVICE)
+        {
+            fprintf(stderr, "NcclComm: disabled, at least one CPU device\n");
+            return;
+        }
+        if (std::find(deviceIds.begin(), deviceIds.begin() + k, deviceIds[k]) != deviceIds.begin() + k)
+        {
+            fprintf(stderr, "NcclComm: disabled, same device used more than once\n");
+            return;
+        }
+    }
+
+    // NCCL numbers the ranks in the order of the device list, which is ordered by the GPU topology if enabled
+    std::vector<int> ringOrder = GpuTopology::IsEnabled() ? GpuTopology::RingOrder(deviceIds) : deviceIds;
+    std::vector<ncclComm_t> comms(ringOrder.size());
+    ncclCommInitAll(comms.data(), (int)ringOrder.size(), ringOrder.data()) || "NcclComm failed to initialize ncclComm_t";
+
+    m_localDevices = deviceIds;
+    for (int deviceId : m_localDevices)
+    {
+        int ncclRank = (int)(std::find(ringOrder.begin(), ringOrder.end(), deviceId) - ringOrder.begin());
+        if (deviceId == m_localDevices[0])
+            m_localRootRank = ncclRank;
+        m_localComms.push_back(comms[ncclRank]);
+
+        PrepareDevice(deviceId);
+        cudaStream_t stream;
+        cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking) || "cudaStreamCreateWithFlags failed";
+        m_localStreams.push_back(stream);
+        cudaEvent_t event;
+        cudaEventCreateWithFlags(&event, cudaEventDisableTiming) || "cudaEventCreateWithFlags failed";
+        m_localComputeDoneEvents.push_back(event);
+    }
+    PrepareDevice(m_localDevices[0]);
+    fprintf(stderr, "NcclComm: initialized for %d GPUs of this process\n", (int)m_localDevices.size());
+}
+
+NcclComm::~NcclComm()
+{
+    for (size_t k = 0; k < m_localDevices.size(); k++)
+    {
+        PrepareDevice(m_localDevices[k]);
+        cudaEventDestroy(m_localComputeDoneEvents[k]);
+        cudaStreamDestroy(m_localStreams[k]);
+        ncclCommDestroy(m_localComms[k]);
+    }
+    if (m_computeDoneEvent != nullptr)
+        cudaEventDestroy(m_computeDoneEvent);
+    if (m_stream != nullptr)
+        cudaStreamDestroy(m_stream);
+    if (m_crossHostComm != nullptr)
+        ncclCommDestroy(m_crossHostComm);
+    if (m_ncclComm != nullptr)
+        ncclCommDestroy(m_ncclComm);
+}
+
+// Sets up the communicators for the hierarchical all-reduce. Returns false if that cannot be used for the ranks.
+bool NcclComm::InitHierarchical(int deviceId, const MPIWrapperPtr& mpi)
+{
+#if NCCL_MAJOR >= 2
+    size_t numRanks = mpi->NumNodesInUse();
+    size_t myRank = mpi->CurrentNodeRank();
+
+    const size_t maxNameLength = 256;
+    std::vector<wchar_t> myName(maxNameLength, 0);
+    std::wstring name = mpi->CurrentNodeName();
+    std::copy(name.begin(), name.begin() + std::min(name.size(), maxNameLength - 1), myName.begin());
+    std::vector<wchar_t> allNames(numRanks * maxNameLength);
+    mpi->Allgather(myName.data(), (int)(maxNameLength * sizeof(wchar_t)), MPI_CHAR, allNames.data(), (int)(maxNameLength * sizeof(wchar_t)), MPI_CHAR);
+
     std::vector<int> allDevs(numRanks);
     mpi->Allgather(&deviceId, 1, MPI_INT, allDevs.data(), 1, MPI_INT);
 
-    for (size_t r = 0; r<numRanks; r++)
+    // group the ranks by host, hosts numbered in order of their first rank
+    std::vector<std::wstring> hosts;
+    std::vector<size_t> numRanksOnHost;
+    std::vector<size_t> hostOfRank(numRanks);
+    std::vector<size_t> localRankOfRank(numRanks);
+    for (size_t r = 0; r < numRanks; r++)
+    {
+        std::wstring host(&allNames[r * maxNameLength]);
+        size_t h = std::find(hosts.begin(), hosts.end(), host) - hosts.begin();
+        if (h == hosts.size())
+        {
+            hosts.push_back(host);
+            numRanksOnHost.push_back(0);
+        }
+        hostOfRank[r] = h;
+        localRankOfRank[r] = numRanksOnHost[h]++;
+    }
+
+    for (size_t r = 0; r < numRanks; r++)
     {
         if (allDevs[r] == CPUDEVICE)
         {
             fprintf(stderr, "NcclComm: disabled, at least one rank using CPU device\n");
-            return;
+            return false;
         }
-        for (size_t s = 0; s<r; s++)
-            if (allDevs[r] == allDevs[s])
+        for (size_t s = 0; s < r; s++)
+            if (hostOfRank[r] == hostOfRank[s] && allDevs[r] == allDevs[s])
             {
                 fprintf(stderr, "NcclComm: disabled, same device used by more than one rank\n");
-                return;
+                return false;
             }
     }
+    // the shards of all hosts must line up
+    if (std::find_if(numRanksOnHost.begin(), numRanksOnHost.end(), [&](size_t n) { return n != numRanksOnHost[0]; }) != numRanksOnHost.end())
+    {
+        fprintf(stderr, "NcclComm: disabled, hierarchical all-reduce requires the same number of ranks on every host\n");
+        return false;
+    }
 
-    ncclUniqueId ncclId;
-    ncclResult_t res;
+    size_t myHost = hostOfRank[myRank];
 
-    res = ncclGetUniqueId(&ncclId);
-    if (res != ncclSuccess)
-        RuntimeError("NcclComm failed to obtain ncclUniqueId: %s", ncclGetErrorString(res));
+    // The position of each rank in the ring of its host. The hosts are expected to be alike, so that the shards owned by the
+    // same position line up with the same links on every host.
+    if (GpuTopology::IsEnabled())
+    {
+        std::vector<int> hostDevs;
+        for (size_t r = 0; r < numRanks; r++)
+            if (hostOfRank[r] == myHost)
+                hostDevs.push_back(allDevs[r]);
+        int myPosition = RingPosition(deviceId, hostDevs);
+        std::vector<int> allPositions(numRanks);
+        mpi->Allgather(&myPosition, 1, MPI_INT, allPositions.data(), 1, MPI_INT);
+        for (size_t r = 0; r < numRanks; r++)
+            localRankOfRank[r] = allPositions[r];
+    }
+
+    m_localRank = localRankOfRank[myRank];
+    m_numLocalRanks = numRanksOnHost[0];
 
-    mpi->Bcast(&ncclId, NCCL_UNIQUE_ID_BYTES, MPI_CHAR, 0);
+    // The first rank of each host creates the NCCL id for the ranks on its host, and the ranks of the first host the ids for
+    // the ranks with their local rank across hosts. Everybody picks theirs from the gathered ids.
+    ncclUniqueId myLocalId, myCrossHostId;
+    memset(&myLocalId, 0, sizeof(myLocalId));
+    memset(&myCrossHostId, 0, sizeof(myCrossHostId));
+    if (m_localRank == 0)
+        ncclGetUniqueId(&myLocalId) || "NcclComm failed to obtain ncclUniqueId";
+    if (myHost == 0)
+        ncclGetUniqueId(&myCrossHostId) || "NcclComm failed to obtain ncclUniqueId";
+    std::vector<ncclUniqueId> allLocalIds(numRanks), allCrossHostIds(numRanks);
+    mpi->Allgather(&myLocalId, NCCL_UNIQUE_ID_BYTES, MPI_CHAR, allLocalIds.data(), NCCL_UNIQUE_ID_BYTES, MPI_CHAR);
+    mpi->Allgather(&myCrossHostId, NCCL_UNIQUE_ID_BYTES, MPI_CHAR, allCrossHostIds.data(), NCCL_UNIQUE_ID_BYTES, MPI_CHAR);
+    size_t localRoot = 0, crossHostRoot = 0;
+    for (size_t r = 0; r < numRanks; r++)
+    {
+        if (hostOfRank[r] == myHost && localRankOfRank[r] == 0)
+            localRoot = r;
+        if (hostOfRank[r] == 0 && localRankOfRank[r] == m_localRank)
+            crossHostRoot = r;
+    }
 
     PrepareDevice(deviceId);
-    res = ncclCommInitRank(&m_ncclComm, numRanks, ncclId, mpi->CurrentNodeRank());
-    if (res != ncclSuccess)
-      RuntimeError("NcclComm failed to initialize ncclComm_t: %s", ncclGetErrorString(res));
+    ncclCommInitRank(&m_ncclComm, (int)m_numLocalRanks, allLocalIds[localRoot], (int)m_localRank) || "NcclComm failed to initialize ncclComm_t";
+    ncclCommInitRank(&m_crossHostComm, (int)hosts.size(), allCrossHostIds[crossHostRoot], (int)myHost) || "NcclComm failed to initialize ncclComm_t";
+    fprintf(stderr, "NcclComm: hierarchical all-reduce across %d hosts with %d GPUs each\n", (int)hosts.size(), (int)m_numLocalRanks);
+    return true;
+#else
+    fprintf(stderr, "NcclComm: disabled, hierarchical all-reduce requires NCCL 2 or newer\n");
+    return false;
+#endif
+}
 
-    cudaStreamCreateWithFlags(&m_stream, cudaStreamDefault)
-        || "cudaStreamCreateWithFlags failed";
-    fprintf(stderr, "NcclComm: initialized\n");
+bool NcclComm::IsSupported()
+{
+    return m_ncclComm != nullptr || !m_localComms.empty();
 }
 
-NcclComm::~NcclComm()
+bool NcclComm::IsHierarchical()
 {
-    if (m_stream != nullptr)
-        cudaStreamDestroy(m_stream);
-    if (m_ncclComm != nullptr)
-        ncclCommDestroy(m_ncclComm);
+    return m_crossHostComm != nullptr;
 }
 
-bool NcclComm::IsSupported()
+void NcclComm::WaitForComputeStream()
 {
-    return m_ncclComm != nullptr;
+    cudaEventRecord(m_computeDoneEvent, GetStream()) || "NcclComm: cudaEventRecord failed";
+    cudaStreamWaitEvent(m_stream, m_computeDoneEvent, 0) || "NcclComm: cudaStreamWaitEvent failed";
 }
 
 void NcclComm::AllReduceImpl(void* inputbuffer, void *outputbuffer, size_t count, DataType dtype)
 {
+    WaitForComputeStream();
+
+    if (IsHierarchical())
+    {
+        HierarchicalAllReduceImpl(inputbuffer, outputbuffer, count, dtype);
+        return;
+    }
+
     ncclResult_t res;
     if (dtype == DataType::FLOAT)
     {
@@ -93,12 +393,49 @@ void NcclComm::AllReduceImpl(void* inputbuffer, void *outputbuffer, size_t count
         RuntimeError("NcclComm ncclAllReduce failed: %s", ncclGetErrorString(res));
 }
 
+// The GPUs of this host each own one shard of the buffer, in place in the output buffer. The elements that remain if the
+// count does not divide evenly are reduced as a whole at both levels.
+void NcclComm::HierarchicalAllReduceImpl(void* inputbuffer, void* outputbuffer, size_t count, DataType dtype)
+{
+#if NCCL_MAJOR >= 2
+    ncclDataType_t ncclType = (dtype == DataType::FLOAT) ? ncclFloat : ncclDouble;
+    size_t elementSize = (dtype == DataType::FLOAT) ? sizeof(float) : sizeof(double);
+    char* input = static_cast<char*>(inputbuffer);
+    char* output = static_cast<char*>(outputbuffer);
+
+    size_t shardCount = count / m_numLocalRanks;
+    if (shardCount > 0)
+    {
+        char* shard = output + m_localRank * shardCount * elementSize;
+        ncclReduceScatter(input, shard, shardCount, ncclType, ncclSum, m_ncclComm, m_stream) || "NcclComm ncclReduceScatter failed";
+        ncclAllReduce(shard, shard, shardCount, ncclType, ncclSum, m_crossHostComm, m_stream) || "NcclComm ncclAllReduce failed";
+        ncclAllGather(shard, output, shardCount, ncclType, m_ncclComm, m_stream) || "NcclComm ncclAllGather failed";
+    }
+
+    size_t offset = shardCount * m_numLocalRanks * elementSize;
+    size_t remainderCount = count - shardCount * m_numLocalRanks;
+    if (remainderCount > 0)
+    {
+        ncclAllReduce(input + offset, output + offset, remainderCount, ncclType, ncclSum, m_ncclComm, m_stream) || "NcclComm ncclAllReduce failed";
+        ncclAllReduce(output + offset, output + offset, remainderCount, ncclType, ncclSum, m_crossHostComm, m_stream) || "NcclComm ncclAllReduce failed";
+    }
+#else
+    RuntimeError("NcclComm: hierarchical all-reduce requires NCCL 2 or newer");
+#endif
+}
+
 void NcclComm::BroadcastImpl(void* buffer, size_t count, MPI_Datatype dtype, int root)
 {
+    if (IsHierarchical())
+        RuntimeError("NcclComm: Broadcast is not supported with hierarchical all-reduce");
+
+    WaitForComputeStream();
+
     ncclResult_t res;
     if (dtype == MPI_CHAR)
     {
-        res = ncclBcast(buffer, count, ncclChar, root, m_ncclComm, m_stream);
+        int ncclRoot = m_ncclRankOfRank.empty() ? root : m_ncclRankOfRank[root];
+        res = ncclBcast(buffer, count, ncclChar, ncclRoot, m_ncclComm, m_stream);
     }
     else
     {
@@ -110,9 +447,76 @@ void NcclComm::BroadcastImpl(void* buffer, size_t count, MPI_Datatype dtype, int
     }
 }
 
+void NcclComm::AllGatherImpl(const void* inputbuffer, void* outputbuffer, size_t count, DataType dtype)
+{
+#if NCCL_MAJOR >= 2
+    if (IsHierarchical())
+        RuntimeError("NcclComm: AllGather is not supported with hierarchical all-reduce");
+
+    WaitForComputeStream();
+    ncclDataType_t ncclType = (dtype == DataType::FLOAT) ? ncclFloat : ncclDouble;
+    ncclAllGather(inputbuffer, outputbuffer, count, ncclType, m_ncclComm, m_stream) || "NcclComm ncclAllGather failed";
+#else
+    RuntimeError("NcclComm: AllGather requires NCCL 2 or newer");
+#endif
+}
+
+void NcclComm::ReduceScatterImpl(const void* inputbuffer, void* outputbuffer, size_t count, DataType dtype)
+{
+#if NCCL_MAJOR >= 2
+    if (IsHierarchical())
+        RuntimeError("NcclComm: ReduceScatter is not supported with hierarchical all-reduce");
+
+    WaitForComputeStream();
+    ncclDataType_t ncclType = (dtype == DataType::FLOAT) ? ncclFloat : ncclDouble;
+    ncclReduceScatter(inputbuffer, outputbuffer, count, ncclType, ncclSum, m_ncclComm, m_stream) || "NcclComm ncclReduceScatter failed";
+#else
+    RuntimeError("NcclComm: ReduceScatter requires NCCL 2 or newer");
+#endif
+}
+
+// Each device waits for the work queued on its compute stream; the operations of all devices are issued as one group.
+void NcclComm::LocalCollectiveImpl(const std::vector<std::vector<void*>>& buffersOfDevices, const std::vector<size_t>& counts, DataType dtype, bool reduce)
+{
+    ncclDataType_t ncclType = (dtype == DataType::FLOAT) ? ncclFloat : ncclDouble;
+    for (size_t k = 0; k < m_localDevices.size(); k++)
+    {
+        PrepareDevice(m_localDevices[k]);
+        cudaEventRecord(m_localComputeDoneEvents[k], GetStream()) || "NcclComm: cudaEventRecord failed";
+        cudaStreamWaitEvent(m_localStreams[k], m_localComputeDoneEvents[k], 0) || "NcclComm: cudaStreamWaitEvent failed";
+    }
+#if NCCL_MAJOR >= 2
+    ncclGroupStart() || "NcclComm ncclGroupStart failed";
+#endif
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        for (size_t k = 0; k < m_localDevices.size(); k++)
+        {
+            PrepareDevice(m_localDevices[k]);
+            void* buffer = buffersOfDevices[k][i];
+            if (reduce)
+                ncclReduce(buffer, buffer, counts[i], ncclType, ncclSum, m_localRootRank, m_localComms[k], m_localStreams[k]) || "NcclComm ncclReduce failed";
+            else
+                ncclBcast(buffer, counts[i], ncclType, m_localRootRank, m_localComms[k], m_localStreams[k]) || "NcclComm ncclBcast failed";
+        }
+    }
+#if NCCL_MAJOR >= 2
+    ncclGroupEnd() || "NcclComm ncclGroupEnd failed";
+#endif
+    PrepareDevice(m_localDevices[0]);
+}
+
 void NcclComm::Sync()
 {
-    cudaStreamSynchronize(m_stream) || "NcclComm: cudaStreamSynchronize failed";
+    if (m_stream != nullptr)
+        cudaStreamSynchronize(m_stream) || "NcclComm: cudaStreamSynchronize failed";
+    for (size_t k = 0; k < m_localDevices.size(); k++)
+    {
+        PrepareDevice(m_localDevices[k]);
+        cudaStreamSynchronize(m_localStreams[k]) || "NcclComm: cudaStreamSynchronize failed";
+    }
+    if (!m_localDevices.empty())
+        PrepareDevice(m_localDevices[0]);
 }
 
 }}} // end namespaces
@@ -122,6 +526,10 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
 NcclComm::NcclComm(int /*deviceId*/, const MPIWrapperPtr& /*mpi*/) { }
 
+NcclComm::NcclComm(int /*deviceId*/, const MPIWrapperPtr& /*mpi*/, size_t /*group*/) { }
+
+NcclComm::NcclComm(const std::vector<int>& /*deviceIds*/) { }
+
 NcclComm::~NcclComm() { }
 
 bool NcclComm::IsSupported()
@@ -129,6 +537,11 @@ bool NcclComm::IsSupported()
     return false;
 }
 
+bool NcclComm::IsHierarchical()
+{
+    return false;
+}
+
 void NcclComm::Sync() { }
 
 }}} // end namespaces
@@ -16,6 +16,7 @@
 
 // Forward declare CUDA stuff
 typedef struct CUstream_st* cudaStream_t;
+typedef struct CUevent_st* cudaEvent_t;
 typedef struct ncclComm* ncclComm_t;
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -26,15 +27,47 @@ class NcclComm
 private:
     enum class DataType : int {FLOAT, DOUBLE};
     void AllReduceImpl(void* inputbuffer, void* outputbuffer, size_t count, DataType dtype);
+    void HierarchicalAllReduceImpl(void* inputbuffer, void* outputbuffer, size_t count, DataType dtype);
     void BroadcastImpl(void* buffer, size_t count, MPI_Datatype dtype, int root);
+    void AllGatherImpl(const void* inputbuffer, void* outputbuffer, size_t count, DataType dtype);
+    void ReduceScatterImpl(const void* inputbuffer, void* outputbuffer, size_t count, DataType dtype);
+    void LocalCollectiveImpl(const std::vector<std::vector<void*>>& buffersOfDevices, const std::vector<size_t>& counts, DataType dtype, bool reduce);
+    void WaitForComputeStream();
+    bool InitHierarchical(int deviceId, const MPIWrapperPtr& mpi);
     cudaStream_t m_stream;
-    ncclComm_t m_ncclComm;
+    cudaEvent_t m_computeDoneEvent;
+    ncclComm_t m_ncclComm;      // all ranks, or in hierarchical mode the ranks on this host
+    ncclComm_t m_crossHostComm; // hierarchical mode only: the ranks with the same local rank on all hosts
+    size_t m_localRank;
+    size_t m_numLocalRanks;
+    std::vector<int> m_ncclRankOfRank; // the position of each rank in the NCCL ring, if ordered by the GPU topology
+    // single-process mode: a communicator, stream and event for each device of this process, in the order of m_localDevices
+    std::vector<int> m_localDevices;
+    std::vector<ncclComm_t> m_localComms;
+    std::vector<cudaStream_t> m_localStreams;
+    std::vector<cudaEvent_t> m_localComputeDoneEvents;
+    int m_localRootRank; // the rank of the first device in the NCCL ring
 #endif
 
 public:
     NcclComm(int deviceId, const MPIWrapperPtr& mpiComm);
+    // A communicator among the ranks that pass the same 'group' (all ranks must call this), numbered in the order of their
+    // ranks, e.g. the workers that hold the shards of a TensorParallelTimes node. Supports AllReduce(), AllGather() and ReduceScatter().
+    NcclComm(int deviceId, const MPIWrapperPtr& mpiComm, size_t group);
+    // Single-process mode, for the GPUs in 'deviceIds' that are all driven by this process; see LocalReduce() and LocalBroadcast().
+    NcclComm(const std::vector<int>& deviceIds);
     ~NcclComm();
     bool IsSupported();
+    bool IsHierarchical();
+
+    // Two-level all-reduce for ranks on multiple hosts: reduce-scatter among the GPUs of each host, all-reduce of each
+    // shard across hosts, then all-gather on each host, which divides the bytes sent across hosts by the GPUs per host.
+    // Without it, NCCL is only used if all ranks are on a single host. Must be set before the NcclComm is constructed.
+    static void SetHierarchicalAllReduce(bool enable);
+    static bool ShouldUseHierarchicalAllReduce();
+    // NCCL cannot survive the failure of a rank, so elastic training falls back to MPI. Must be set before the NcclComm is constructed.
+    static void SetEnabled(bool enable);
+    static bool IsEnabled();
     void Sync(); // waits for outstanding reductions to complete
     
     template <typename ElemType>
@@ -74,6 +107,28 @@ public:
 #endif
     }
 
+    // concatenates the 'count' elements of each rank in 'outputBuffer', in the order of the ranks
+    template <typename ElemType>
+    void AllGather(const ElemType* inputBuffer, ElemType* outputBuffer, size_t count)
+    {
+#ifdef USE_NCCL
+        AllGatherImpl(inputBuffer, outputBuffer, count, GetDataType<ElemType>());
+#else
+        RuntimeError("NcclComm: CNTK was built without NCCL support.");
+#endif
+    }
+
+    // sums the input buffers of 'count' times the number of ranks elements, of which each rank receives its part 'count'
+    template <typename ElemType>
+    void ReduceScatter(const ElemType* inputBuffer, ElemType* outputBuffer, size_t count)
+    {
+#ifdef USE_NCCL
+        ReduceScatterImpl(inputBuffer, outputBuffer, count, GetDataType<ElemType>());
+#else
+        RuntimeError("NcclComm: CNTK was built without NCCL support.");
+#endif
+    }
+
     void Broadcast(void* buffer, size_t count, MPI_Datatype dtype, int root)
     {
 #ifdef USE_NCCL
@@ -83,6 +138,68 @@ public:
 #endif
     }
 
+    // Single-process mode: sums the buffers of all devices into those of the first one. 'buffersOfDevices' has the
+    // buffers of each device, in the order of the devices; the buffers of the devices correspond to each other.
+    template <typename ElemType>
+    void LocalReduce(const std::vector<std::vector<Matrix<ElemType>*>>& buffersOfDevices)
+    {
+        LocalCollective(buffersOfDevices, /*reduce=*/true);
+    }
+
+    // Single-process mode: copies the buffers of the first device to those of the others.
+    template <typename ElemType>
+    void LocalBroadcast(const std::vector<std::vector<Matrix<ElemType>*>>& buffersOfDevices)
+    {
+        LocalCollective(buffersOfDevices, /*reduce=*/false);
+    }
+
+private:
+#ifdef USE_NCCL
+    template <typename ElemType>
+    static DataType GetDataType()
+    {
+        if (std::is_same<ElemType, double>::value)
+            return DataType::DOUBLE;
+        else if (!std::is_same<ElemType, float>::value)
+            RuntimeError("NcclComm Unsupported reduction type");
+        return DataType::FLOAT;
+    }
+#endif
+
+    template <typename ElemType>
+    void LocalCollective(const std::vector<std::vector<Matrix<ElemType>*>>& buffersOfDevices, bool reduce)
+    {
+#ifdef USE_NCCL
+        DataType dtype = DataType::FLOAT;
+        if (std::is_same<ElemType, double>::value)
+            dtype = DataType::DOUBLE;
+        else if (!std::is_same<ElemType, float>::value)
+            RuntimeError("NcclComm Unsupported reduction type");
+
+        if (buffersOfDevices.size() != m_localDevices.size())
+            LogicError("NcclComm: Buffers of %d devices were passed to a communicator of %d devices.", (int)buffersOfDevices.size(), (int)m_localDevices.size());
+        std::vector<std::vector<void*>> buffers(buffersOfDevices.size());
+        std::vector<size_t> counts;
+        for (const auto& matrix : buffersOfDevices[0])
+            counts.push_back(matrix->GetNumElements());
+        for (size_t k = 0; k < buffersOfDevices.size(); k++)
+        {
+            if (buffersOfDevices[k].size() != counts.size())
+                LogicError("NcclComm: The devices have different numbers of buffers.");
+            for (size_t i = 0; i < counts.size(); i++)
+            {
+                const auto& matrix = buffersOfDevices[k][i];
+                if (matrix->GetNumElements() != counts[i] || matrix->GetDeviceId() != m_localDevices[k] || matrix->GetMatrixType() != MatrixType::DENSE)
+                    LogicError("NcclComm: Buffer %d of device %d does not match that of the first device.", (int)i, m_localDevices[k]);
+                buffers[k].push_back(matrix->Data());
+            }
+        }
+        LocalCollectiveImpl(buffers, counts, dtype, reduce);
+#else
+        RuntimeError("NcclComm: CNTK was built without NCCL support.");
+#endif
+    }
+
 #pragma warning( pop )
 };
 
@@ -25,6 +25,11 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
 void PrepareDevice(DEVICEID_TYPE deviceId);
 
+std::pair<size_t, size_t> TracingGPUMemoryAllocator::GetFreeAndTotalMemoryInMBs(int deviceId)
+{
+    return {0, 0};
+}
+
 template <class ElemType>
 GPUSPARSE_INDEX_TYPE GPUSparseMatrix<ElemType>::SecondaryIndexValueAt(size_t idx) const
 {
@@ -250,7 +255,7 @@ GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::InplaceTruncate(const Elem
 
 // normal update for smoothed gradients c and current gradients (this)
 template <class ElemType>
-void GPUSparseMatrix<ElemType>::NormalGrad(GPUMatrix<ElemType>& c, const ElemType momentum, bool unitGainMomentum)
+void GPUSparseMatrix<ElemType>::NormalGrad(GPUMatrix<ElemType>& c, const ElemType momentum, bool unitGainMomentum, bool lazy)
 {
 }
 template <class ElemType>
@@ -260,12 +265,12 @@ ElemType GPUSparseMatrix<ElemType>::Adagrad(GPUMatrix<ElemType>& c, const bool n
 }
 
 template<class ElemType>
-void GPUSparseMatrix<ElemType>::FSAdagrad(GPUMatrix<ElemType>&, GPUMatrix<ElemType>&, ElemType, ElemType, ElemType, ElemType, bool)
+void GPUSparseMatrix<ElemType>::FSAdagrad(GPUMatrix<ElemType>&, GPUMatrix<ElemType>&, ElemType, ElemType, ElemType, ElemType, bool, bool)
 {
 }
 
 template<class ElemType>
-void GPUSparseMatrix<ElemType>::Adam(GPUMatrix<ElemType>& c, GPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul, ElemType epsilon, bool unitGainMomentum, bool adamax)
+void GPUSparseMatrix<ElemType>::Adam(GPUMatrix<ElemType>& c, GPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul, ElemType epsilon, bool unitGainMomentum, bool adamax, bool lazy)
 {
 }
 
@@ -746,9 +751,16 @@ GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::AssignOneHot(const GPUMatr
     return *this;
 }
 
+template <class ElemType>
+GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::ScatterToIndices(const GPUMatrix<ElemType>& values, const GPUMatrix<ElemType>& indices, size_t row_elements)
+{
+    return *this;
+}
+
 #pragma endregion Helper Functions
 
 template class MATH_API GPUSparseMatrix<short>;
+template class MATH_API GPUSparseMatrix<half>;
 template class MATH_API GPUSparseMatrix<char>;
 template class MATH_API GPUSparseMatrix<float>;
 template class MATH_API GPUSparseMatrix<double>;
@@ -1054,6 +1066,10 @@ template <class ElemType>
 void GPUMatrix<ElemType>::SetValue(GPUMatrix<ElemType> const&)
 {
 }
+template <class ElemType>
+void GPUMatrix<ElemType>::SetValueFromPeer(GPUMatrix<ElemType> const&)
+{
+}
 #if 0
 template <class ElemType>
 void GPUMatrix<ElemType>::SetValue(CPUSparseMatrix<ElemType> const&)
@@ -1070,6 +1086,11 @@ void GPUMatrix<ElemType>::SetValue(const size_t numRows, const size_t numCols, i
 {
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::ReadValues(File& stream, const size_t numRows, const size_t numCols)
+{
+}
+
 template <class ElemType>
 void GPUMatrix<ElemType>::SetDiagonalValue(const ElemType v)
 {
@@ -1110,6 +1131,11 @@ void GPUMatrix<ElemType>::SetTruncatedNormalRandomValue(const ElemType mean, con
 {
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::SetCounterBasedRandomValue(RandomDistribution distribution, const ElemType a, const ElemType b, unsigned long seed, uint64_t offset)
+{
+}
+
 //maskRate: percentage of values masked out (similar to dropout rate)
 //scaleValue: which scale value to set to the left ones (unmasked items).
 template <class ElemType>
@@ -1135,6 +1161,24 @@ void GPUMatrix<ElemType>::Adam(GPUMatrix<ElemType>& gradients, GPUMatrix<ElemTyp
 
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::MultiTensorUpdate(const MultiTensorUpdateParams<ElemType>& params, const std::vector<GPUMatrix<ElemType>*>& values,
+                                            const std::vector<GPUMatrix<ElemType>*>& gradients, const std::vector<GPUMatrix<ElemType>*>& smoothedGradients)
+{
+}
+
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignPackedBFloat16Of(const GPUMatrix<ElemType>& /*a*/, unsigned long /*seed*/)
+{
+    return *this;
+}
+
+template <class ElemType>
+GPUMatrix<ElemType>& GPUMatrix<ElemType>::AssignUnpackedBFloat16Of(const GPUMatrix<ElemType>& /*packed*/)
+{
+    return *this;
+}
+
 template <class ElemType>
 ElemType GPUMatrix<ElemType>::RmsProp(GPUMatrix<ElemType>& gradients, ElemType RMS_GAMMA, ElemType RMS_WGT_INC, ElemType RMS_WGT_MAX, ElemType RMS_WGT_DEC, ElemType RMS_WGT_MIN, const bool needAveMultiplier, const bool initialized)
 {
@@ -1631,6 +1675,28 @@ void GPUMatrix<ElemType>::ConductRowElementMultiplyWithShift(const GPUMatrix<Ele
 {
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::CosSimilarityWithNegativeSamples(const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, GPUMatrix<ElemType>& invNormA, GPUMatrix<ElemType>& invNormB, GPUMatrix<ElemType>& c, const size_t shift, const size_t negNumber)
+{
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::AddCosSimilarityWithNegativeSamplesGradient(const size_t inputIndex, const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, const GPUMatrix<ElemType>& invNormA, const GPUMatrix<ElemType>& invNormB,
+                                                                      const GPUMatrix<ElemType>& c, const GPUMatrix<ElemType>& cGradient, GPUMatrix<ElemType>& gradient, const size_t shift, const size_t negNumber)
+{
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::LambdaRankMetrics(const GPUMatrix<ElemType>& gains, const GPUMatrix<ElemType>& scores, const GPUMatrix<ElemType>& queryBegins, GPUMatrix<ElemType>& ranks, GPUMatrix<ElemType>& metrics)
+{
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::AddLambdaRankGradient(const GPUMatrix<ElemType>& gains, const GPUMatrix<ElemType>& scores, const GPUMatrix<ElemType>& queryBegins, const GPUMatrix<ElemType>& ranks, const GPUMatrix<ElemType>& metrics,
+                                                const ElemType sigma, GPUMatrix<ElemType>& gradient)
+{
+}
+
 template <class ElemType>
 DeviceBoundNumber<ElemType> GPUMatrix<ElemType>::Sum_AsDeviceBoundNum() const
 {
@@ -1945,7 +2011,7 @@ void GPUMatrix<ElemType>::BatchNormalizationBackward(const GPUMatrix<ElemType>&
 }
 
 template <class ElemType>
-void GPUMatrix<ElemType>::RNNForward(const GPUMatrix<ElemType> &inputX, const GPUMatrix<ElemType> &paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace)
+void GPUMatrix<ElemType>::RNNForward(const GPUMatrix<ElemType> &inputX, const GPUMatrix<ElemType> &paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const RnnAttributes& rnnAttributes, GPUMatrix<ElemType>& reserve, GPUMatrix<ElemType>& workspace, bool inferenceOnly)
 {
 }
 
@@ -1968,6 +2034,11 @@ void GPUMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const GPUMatrix
 {
 }
 template <class ElemType>
+void GPUMatrix<ElemType>::BatchedMultiplyAndWeightedAdd(ElemType alpha, const GPUMatrix<ElemType>& /*a*/, const bool transposeA, const GPUMatrix<ElemType>& /*b*/, const bool transposeB,
+                                                        ElemType beta, GPUMatrix<ElemType>& c, const size_t m, const size_t n, const size_t k)
+{
+}
+template <class ElemType>
 void GPUMatrix<ElemType>::Multiply1x1AndWeightedAdd(ElemType alpha, const GPUMatrix<ElemType>& lhs, const GPUMatrix<ElemType>& rhs, ElemType beta, GPUMatrix<ElemType>& c)
 {
 }
@@ -2143,6 +2214,13 @@ void GPUMatrix<ElemType>::TensorOp(ElemType beta, const GPUMatrix<ElemType>& a,
 {
 }
 template <class ElemType>
+void GPUMatrix<ElemType>::TensorOp(ElemType beta, const GPUMatrix<ElemType>& a, const GPUMatrix<ElemType>& b, const GPUMatrix<ElemType>& c, ElemType alpha, const ElementWiseProgram& program,
+                                   const array<size_t, 4>& offsets,
+                                   const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                                   const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 4>& reducingStrides)
+{
+}
+template <class ElemType>
 void GPUMatrix<ElemType>::TensorArgOp(const GPUMatrix<ElemType>& a, ElementWiseOperator reductionOp,
                                       const array<size_t, 2>& offsets,
                                       const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides,
@@ -2330,10 +2408,24 @@ void GranularGPUDataTransferer::WaitForSyncPointOnFetchStreamAsync() {}
 
 void GranularGPUDataTransferer::WaitForSyncPointOnAssignStreamAsync() {}
 
+void GranularGPUDataTransferer::WaitForCopyGPUToCPUOnComputeStreamAsync() {}
+
+void GranularGPUDataTransferer::WaitForCopyCPUToGPUOnComputeStreamAsync() {}
+
 PrefetchGPUDataTransferer::PrefetchGPUDataTransferer(int /*deviceId*/) : GranularGPUDataTransferer() {}
 
 PrefetchGPUDataTransferer::~PrefetchGPUDataTransferer() {}
 
+void PrefetchGPUDataTransferer::WaitForSyncPointOnAssignStreamAsync() {}
+
+void PrefetchGPUDataTransferer::RecordCPUToGPUCopy() {}
+
+void PrefetchGPUDataTransferer::WaitForCopyCPUToGPUOnComputeStreamAsync() {}
+
+bool PrefetchGPUDataTransferer::GetExposedCopyCPUToGPUTime(long long&, long long&) { return false; }
+
+OffloadGPUDataTransferer::OffloadGPUDataTransferer(int /*deviceId*/) : GranularGPUDataTransferer() {}
+
 GPUDataTransferer::GPUDataTransferer(int, bool){}
 GPUDataTransferer::~GPUDataTransferer(){}
 void GPUDataTransferer::CopyGPUToCPUAsync(void*, size_t, void*){}
@@ -2346,7 +2438,7 @@ void GPUDataTransferer::WaitForCopyCPUToGPUAsync(){}
 #pragma region GPURNGHandle functions
 
 GPURNGHandle::GPURNGHandle(int deviceId, uint64_t seed, uint64_t offset)
-    : RNGHandle(deviceId)
+    : RNGHandle(deviceId), m_markedOffset(offset)
 {
 }
 
@@ -2354,9 +2446,22 @@ GPURNGHandle::GPURNGHandle(int deviceId, uint64_t seed, uint64_t offset)
 {
 }
 
+/*virtual*/ void GPURNGHandle::Mark(uint64_t offset)
+{
+}
+
+/*virtual*/ void GPURNGHandle::RewindToMark()
+{
+}
+
+/*virtual*/ void GPURNGHandle::Resume(uint64_t offset)
+{
+}
+
 #pragma endregion GPURNGHandle functions
 
 template class GPUMatrix<short>;
+template class GPUMatrix<half>;
 template class GPUMatrix<char>;
 template class GPUMatrix<float>;
 template class GPUMatrix<double>;
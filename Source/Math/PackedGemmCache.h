@@ -0,0 +1,71 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+#include <cstdint>
+#include <memory>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Packed copy of the left operand of a dense CPU matrix product, for operands that do not change between calls
+// (e.g. the weights of a TimesNode during inference). The BLAS library otherwise repacks the operand into its internal
+// panel layout on every call, which dominates small-minibatch products.
+// The owner reports writes to the operand through SetSourceTimeStamp(); the packed copy is rebuilt by
+// CPUMatrix::MultiplyAndWeightedAdd() whenever the time stamp, the memory or the shape of the product changes.
+// Packing is only implemented for MKL (cblas_?gemm_pack); with other BLAS libraries the cache is ignored.
+template <class ElemType>
+class PackedGemmCache
+{
+public:
+    PackedGemmCache() : m_sourceTimeStamp(0)
+    {
+        Invalidate();
+    }
+
+    void SetSourceTimeStamp(uint64_t timeStamp) { m_sourceTimeStamp = timeStamp; }
+
+    void Invalidate()
+    {
+        m_packed.reset();
+        m_source = nullptr;
+        m_m = m_n = m_k = 0;
+        m_transpose = false;
+        m_alpha = 0;
+        m_packedTimeStamp = 0;
+    }
+
+    // Returns the packed copy if it was built from this operand for this product, otherwise nullptr.
+    // The packing scales by alpha, so it is part of the key.
+    const ElemType* Get(const ElemType* source, int m, int n, int k, bool transpose, ElemType alpha) const
+    {
+        if (!m_packed || m_source != source || m_m != m || m_n != n || m_k != k || m_transpose != transpose ||
+            m_alpha != alpha || m_packedTimeStamp != m_sourceTimeStamp)
+            return nullptr;
+        return m_packed.get();
+    }
+
+    // The deleter of 'packed' releases the memory of the BLAS library.
+    void Set(std::shared_ptr<ElemType> packed, const ElemType* source, int m, int n, int k, bool transpose, ElemType alpha)
+    {
+        m_packed = packed;
+        m_source = source;
+        m_m = m;
+        m_n = n;
+        m_k = k;
+        m_transpose = transpose;
+        m_alpha = alpha;
+        m_packedTimeStamp = m_sourceTimeStamp;
+    }
+
+private:
+    std::shared_ptr<ElemType> m_packed;
+    const ElemType* m_source;
+    int m_m, m_n, m_k;
+    bool m_transpose;
+    ElemType m_alpha;
+    uint64_t m_packedTimeStamp;
+    uint64_t m_sourceTimeStamp;
+};
+
+}}}
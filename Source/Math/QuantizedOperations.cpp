@@ -0,0 +1,106 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "QuantizedOperations.h"
+#include <omp.h>
+
+// The block handlers are based on the SSE/AVX intrinsics available on intel platforms
+// (see BlockHandlerSSE.cpp); on ARM64 we fall back to a plain loop.
+#if !defined(__aarch64__)
+#include "BlockMultiplier.h"
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+#if !defined(__aarch64__)
+
+template <class BlockHandlerT>
+class ShortBlockMultiplierImpl : public ShortBlockMultiplier
+{
+    BlockMultiplier<BlockHandlerT> m_multiplier;
+    const char* m_instructionSetName;
+
+public:
+    ShortBlockMultiplierImpl(int numThreads, const char* instructionSetName) :
+        m_multiplier(numThreads), m_instructionSetName(instructionSetName)
+    {
+    }
+
+    virtual short* PrepareB(short* B, int k, int n) override
+    {
+        return m_multiplier.PrepareB(B, k, n);
+    }
+
+    virtual void FreePreparedB(short* preparedB) override
+    {
+        m_multiplier.FreeMatrix(preparedB);
+    }
+
+    virtual void Multiply(short* A, int m, int k, short* preparedB, int n, int32_t* C) override
+    {
+        m_multiplier.MultiplyMatrices(A, m, k, preparedB, n, C);
+    }
+
+    virtual const char* GetInstructionSetName() const override
+    {
+        return m_instructionSetName;
+    }
+};
+
+std::unique_ptr<ShortBlockMultiplier> CreateShortBlockMultiplier()
+{
+    int numThreads = omp_get_max_threads();
+#ifdef SUPPORT_AVX512
+    if (BlockHandlerAVX512::IsSupported())
+        return std::unique_ptr<ShortBlockMultiplier>(new ShortBlockMultiplierImpl<BlockHandlerAVX512>(numThreads, "AVX512"));
+#endif
+#ifdef SUPPORT_AVX2
+    if (CpuSupportsInstructionSet(BlockHandlerInstructionSet::AVX2))
+        return std::unique_ptr<ShortBlockMultiplier>(new ShortBlockMultiplierImpl<BlockHandlerAVX>(numThreads, "AVX2"));
+#endif
+    return std::unique_ptr<ShortBlockMultiplier>(new ShortBlockMultiplierImpl<BlockHandlerSSE>(numThreads, "SSE"));
+}
+
+#else
+
+// Naive product, for platforms without a block handler.
+class ShortReferenceMultiplier : public ShortBlockMultiplier
+{
+public:
+    virtual short* PrepareB(short* B, int /*k*/, int /*n*/) override
+    {
+        return B;
+    }
+
+    virtual void FreePreparedB(short* /*preparedB*/) override
+    {
+    }
+
+    virtual void Multiply(short* A, int m, int k, short* preparedB, int n, int32_t* C) override
+    {
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++)
+            {
+                int32_t dotProduct = 0;
+                for (int l = 0; l < k; l++)
+                    dotProduct += A[i * k + l] * preparedB[l * n + j];
+                C[i * n + j] = dotProduct;
+            }
+    }
+
+    virtual const char* GetInstructionSetName() const override
+    {
+        return "none";
+    }
+};
+
+std::unique_ptr<ShortBlockMultiplier> CreateShortBlockMultiplier()
+{
+    return std::unique_ptr<ShortBlockMultiplier>(new ShortReferenceMultiplier());
+}
+
+#endif
+
+}}}
@@ -4,9 +4,45 @@
 //
 #pragma once
 #include "Quantizers.h"
+#include <cstdint>
+#include <memory>
+
+#ifdef _WIN32
+#ifdef MATH_EXPORTS
+#define MATH_API __declspec(dllexport)
+#else
+#define MATH_API __declspec(dllimport)
+#endif
+#else // no DLLs on Linux
+#define MATH_API
+#endif
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// Product of two row-major 16-bit integer matrices, C[m,n] = A[m,k] * B[k,n], with 32-bit (saturated) results.
+// This is the interface of the BlockMultiplier that QuantizedMultiplier runs on; the block handler behind it is
+// chosen by CreateShortBlockMultiplier().
+class ShortBlockMultiplier
+{
+public:
+    virtual ~ShortBlockMultiplier() {}
+
+    // Rewrites B[k,n] in the block order Multiply() expects. The result must be released with FreePreparedB().
+    virtual short* PrepareB(short* B, int k, int n) = 0;
+    virtual void FreePreparedB(short* preparedB) = 0;
+
+    // C[m,n] = A[m,k] * B[k,n], where preparedB was returned by PrepareB(B, k, n).
+    virtual void Multiply(short* A, int m, int k, short* preparedB, int n, int32_t* C) = 0;
+
+    // Name of the instruction set of the block handler in use, e.g. "AVX512".
+    virtual const char* GetInstructionSetName() const = 0;
+};
+
+// Creates the block multiplier for the widest instruction set that is both compiled into this build
+// (SSE always; AVX2 and AVX-512 with SUPPORT_AVX2 / SUPPORT_AVX512) and supported by the processor we run on.
+// It uses as many threads as OpenMP does.
+MATH_API std::unique_ptr<ShortBlockMultiplier> CreateShortBlockMultiplier();
+
 
 // Quantized product of two dense matrices A and B, where each matrix has its own quantizer.
 // This class handles quantization of both matrices, product and de-quantization of the result.
@@ -29,9 +65,17 @@ class QuantizedMultiplier
 
     bool m_firstPass;
 
+    // Integer product. CNTK matrices are column-major, i.e. the block multiplier (which is row-major) sees
+    // A[m,k] as A'[k,m] and computes C' = B' * A'. A' is its right-hand side, which it rewrites in
+    // block order: m_pPreparedA. Rewriting the constant weights only once is what makes it fast.
+    unique_ptr<ShortBlockMultiplier> m_pBlockMultiplier;
+    short* m_pPreparedA;
+    vector<int32_t> m_pMatC;
+
 public: 
     QuantizedMultiplier(shared_ptr<QuantizerBase<ElemType, short>> pQuantizerA, bool isAConstant, shared_ptr<QuantizerBase<ElemType, short>> pQuantizerB, bool isBConstant) :
-        m_pQuantizerA(pQuantizerA), m_pQuantizerB(pQuantizerB), m_isAConstant(isAConstant), m_isBConstant(isBConstant), m_firstPass(true)
+        m_pQuantizerA(pQuantizerA), m_pQuantizerB(pQuantizerB), m_isAConstant(isAConstant), m_isBConstant(isBConstant), m_firstPass(true),
+        m_pBlockMultiplier(CreateShortBlockMultiplier()), m_pPreparedA(nullptr)
     {
         if (isAConstant && isBConstant)
             LogicError("Quantized multiplication is applied to two constant matrices -- it is highly inefficient. Better approach is to replace the operation with the resulting matrix.");
@@ -41,6 +85,12 @@ public:
     {
     };
 
+    ~QuantizedMultiplier()
+    {
+        if (m_pPreparedA != nullptr)
+            m_pBlockMultiplier->FreePreparedB(m_pPreparedA);
+    }
+
     // A[m,k]*B[k,n] = C[m,n]
     void Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C)
     {
@@ -49,7 +99,13 @@ public:
         {
             m_pMatA.resize(m*k);
             ArrayRef<short> refMatA(m_pMatA.data(), m_pMatA.size());
+            // Channels of A are its rows, which are also the rows of C, so C is de-quantized with the same scales
+            m_pQuantizerA->SetNumChannels(m);
             m_pQuantizerA->Quantize(ArrayRef<ElemType>(A, m_pMatA.size()), refMatA);
+
+            if (m_pPreparedA != nullptr)
+                m_pBlockMultiplier->FreePreparedB(m_pPreparedA);
+            m_pPreparedA = m_pBlockMultiplier->PrepareB(m_pMatA.data(), k, m);
         }
         
         if (!m_isBConstant || m_firstPass)
@@ -62,19 +118,11 @@ public:
         m_firstPass = false;
 
         // Do multiply
-        // Naive inefficient product, just for demonstation
-        // TODO: replace with an efficient version, e.g. IPG, block multiplier, Eigen, gemmlowp, etc.
-        for (size_t i = 0; i < m; i++)
-            for (size_t j = 0; j < n; j++)
-            {
-                int dotProduct=0;
-                for (size_t l = 0; l < k; l++)
-                {
-                    // CNTK is using column-major storage
-                    dotProduct += m_pMatA[i + l*m] * m_pMatB[l + k*j];
-                }
-                C[i + j*m] = (ElemType)dotProduct;
-            }
+        // CNTK is using column-major storage, so this is C'[n,m] = B'[n,k] * A'[k,m] in row-major terms.
+        m_pMatC.assign(m*n, 0);
+        m_pBlockMultiplier->Multiply(m_pMatB.data(), n, k, m_pPreparedA, m, m_pMatC.data());
+        for (size_t i = 0; i < m_pMatC.size(); i++)
+            C[i] = (ElemType)m_pMatC[i];
 
         // De-quantize
         int mn = m*n;
@@ -21,6 +21,9 @@ public:
     virtual void Dequantize(const ArrayRef<RawType>& input, ArrayRef<RawType>& output) = 0;
     virtual void Dequantize(const RawType* input, RawType* output, size_t size) = 0;
 
+    // Number of rows of the (column-major) collections passed to Quantize and Dequantize.
+    // Only used by quantizers that keep a separate scale per row, see PerChannelSymmetricQuantizer.
+    virtual void SetNumChannels(size_t /*numChannels*/) {}
 
 protected:
     QuantizedType rangeMax;
@@ -104,4 +107,89 @@ private:
     }
 };
 
-}}}
\ No newline at end of file
+// Symmetric quantizer with a separate scale per channel, i.e. per row of a column-major matrix
+// (element i belongs to channel i % numChannels). For the weights of a matrix product a channel is an output
+// row, so each row gets the whole quantized range no matter how large the values in the other rows are.
+// The product can be de-quantized with the same quantizer, since its rows are the same channels.
+// Quantization of each channel is done as in SymmetricQuantizer.
+template <class RawType, class QuantizedType>
+class PerChannelSymmetricQuantizer : public QuantizerBase<RawType, QuantizedType>
+{
+    std::vector<RawType> m_quantizeFactors;
+    std::vector<RawType> m_inverseQuantizerFactors;
+    size_t m_numChannels;
+
+    // See SymmetricQuantizer
+    size_t m_bitShift;
+public:
+    PerChannelSymmetricQuantizer(size_t bitShift) : m_bitShift(bitShift), m_numChannels(1)
+    {
+    }
+
+    virtual void SetNumChannels(size_t numChannels) override
+    {
+        if (numChannels == 0)
+            InvalidArgument("PerChannelSymmetricQuantizer: the number of channels must be positive.");
+        m_numChannels = numChannels;
+    }
+
+    virtual void Quantize(const ArrayRef<RawType>& input, ArrayRef<QuantizedType>& output)
+    {
+        if (input.size() == 0)
+            return;
+        assert(input.size() == output.size());
+        if (input.size() % m_numChannels != 0)
+            LogicError("PerChannelSymmetricQuantizer: %d values cannot be split into %d channels.", (int)input.size(), (int)m_numChannels);
+
+        // Absolute max per channel
+        std::vector<RawType> absoluteMax(m_numChannels, 0);
+        for (size_t i = 0; i < input.size(); i++)
+        {
+            RawType& channelMax = absoluteMax[i % m_numChannels];
+            channelMax = std::max(channelMax, std::abs(input[i]));
+        }
+
+        m_quantizeFactors.resize(m_numChannels);
+        m_inverseQuantizerFactors.resize(m_numChannels);
+        for (size_t c = 0; c < m_numChannels; c++)
+        {
+            RawType shiftedMax = absoluteMax[c] * (1 << m_bitShift);
+            if (shiftedMax == 0)
+            {
+                // Whole channel is 0's
+                m_quantizeFactors[c] = 0;
+                m_inverseQuantizerFactors[c] = 0;
+            }
+            else
+            {
+                m_quantizeFactors[c] = this->rangeMax / shiftedMax;
+                m_inverseQuantizerFactors[c] = 1 / m_quantizeFactors[c];
+            }
+        }
+
+        for (size_t i = 0; i < input.size(); i++)
+        {
+            output[i] = (QuantizedType)round(input[i] * m_quantizeFactors[i % m_numChannels]);
+        }
+    }
+
+    virtual void Dequantize(const ArrayRef<RawType>& input, ArrayRef<RawType>& output)
+    {
+        assert(input.size() == output.size());
+
+        Dequantize(input.data(), output.data(), input.size());
+    }
+
+    virtual void Dequantize(const RawType* input, RawType* output, size_t size)
+    {
+        if (size % m_numChannels != 0 || m_inverseQuantizerFactors.size() != m_numChannels)
+            LogicError("PerChannelSymmetricQuantizer: Dequantize does not match the channels of the last Quantize.");
+
+        for (size_t i = 0; i < size; i++)
+        {
+            output[i] = input[i] * m_inverseQuantizerFactors[i % m_numChannels];
+        }
+    }
+};
+
+}}}
@@ -24,6 +24,14 @@ public:
         return m_deviceId;
     }
 
+    // drawing the same values again
+    // Mark() remembers the current position of the generator, which is 'offset' values into its sequence.
+    // RewindToMark() moves the generator back there, so that the values drawn since Mark() are drawn again.
+    // Resume() then moves it to the position 'offset' values into its sequence, where it was before rewinding.
+    virtual void Mark(uint64_t offset) = 0;
+    virtual void RewindToMark() = 0;
+    virtual void Resume(uint64_t offset) = 0;
+
 protected:
     RNGHandle(DEVICEID_TYPE deviceId)
         : m_deviceId(deviceId)
@@ -0,0 +1,75 @@
+#include "stdafx.h"
+#include "TensorOpAutotuner.h"
+#include "Basics.h"
+#include "fileutil.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+bool TensorOpAutotuner::s_enabled = false;
+std::mutex TensorOpAutotuner::s_mutex;
+std::unordered_map<std::string, int> TensorOpAutotuner::s_configs;
+std::wstring TensorOpAutotuner::s_cacheFile;
+
+void TensorOpAutotuner::SetEnabled(bool enabled)
+{
+    s_enabled = enabled;
+}
+
+bool TensorOpAutotuner::IsEnabled()
+{
+    return s_enabled;
+}
+
+// The file has one line per signature: the configuration, a tab, and the signature.
+// Later lines win, so a file that was appended to by several runs is still consistent.
+void TensorOpAutotuner::SetCacheFile(const std::wstring& path)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_cacheFile = path;
+    if (path.empty() || !fexists(path))
+        return;
+
+    FILE* f = fopenOrDie(path, L"rb");
+    size_t numEntries = 0;
+    while (!feof(f))
+    {
+        std::string line = fgetline(f);
+        auto tab = line.find('\t');
+        if (tab == std::string::npos || tab == 0)
+            continue; // (e.g. an empty last line)
+        s_configs[line.substr(tab + 1)] = atoi(line.substr(0, tab).c_str());
+        numEntries++;
+    }
+    fclose(f);
+    fprintf(stderr, "TensorOpAutotuner: loaded %d launch configurations from %ls.\n", (int) numEntries, path.c_str());
+}
+
+bool TensorOpAutotuner::Lookup(const std::string& signature, int& config)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto iter = s_configs.find(signature);
+    if (iter == s_configs.end())
+        return false;
+    config = iter->second;
+    return true;
+}
+
+void TensorOpAutotuner::Record(const std::string& signature, int config)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_configs[signature] = config;
+    if (s_cacheFile.empty())
+        return;
+
+    FILE* f = fopenOrDie(s_cacheFile, L"ab");
+    fprintf(f, "%d\t%s\n", config, signature.c_str());
+    fclose(f);
+}
+
+void TensorOpAutotuner::Clear()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_configs.clear();
+}
+
+}}}
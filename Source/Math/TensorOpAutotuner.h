@@ -0,0 +1,55 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+#ifdef _WIN32
+#ifdef MATH_EXPORTS
+#define MATH_API __declspec(dllexport)
+#else
+#define MATH_API __declspec(dllimport)
+#endif
+#else // no DLLs on Linux
+#define MATH_API
+#endif
+
+// TensorOpAutotuner -- remembers the fastest launch configuration of GPU tensor reductions
+// The launch configuration of a reduction in GPUTensor.cu (one thread per output element, or one or several thread blocks
+// reducing each output element in parallel) is chosen by heuristics that only look at the number of output elements and
+// the size of the reduction. They can be far off when the reduced axis has a large stride, e.g. when reducing over the
+// sequence axis. When enabled, the first reduction of a given signature (device, element type, operation, dimensions and
+// strides) times each candidate configuration once, and all later ones with the same signature use the fastest.
+// The results are kept for the lifetime of the process. If a cache file is set, known results are loaded from it and new
+// ones are appended to it, so that later runs skip the timing and are reproducible (the configuration decides the order in
+// which a reduction adds up its elements).
+class MATH_API TensorOpAutotuner
+{
+public:
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled();
+
+    // load the entries from 'path' (if it exists) and append all new ones to it; an empty path disables the file
+    static void SetCacheFile(const std::wstring& path);
+
+    // returns false if the signature has not been tuned yet
+    static bool Lookup(const std::string& signature, int& config);
+    static void Record(const std::string& signature, int config);
+
+    static void Clear();
+
+private:
+    static bool s_enabled;
+    static std::mutex s_mutex;
+    static std::unordered_map<std::string, int> s_configs;
+    static std::wstring s_cacheFile;
+};
+
+}}}
@@ -335,6 +335,41 @@ DefTernaryOp(ElementwiseProductWithPowBaseDerivative, a * c * OpPow(b, c - 1));
 
 #pragma pop_macro("DefTernaryOp")
 
+// -----------------------------------------------------------------------
+// evaluate an ElementWiseProgram for a single element
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+DECL ElemType EvaluateElementWiseProgram(const ElementWiseProgram& program, ElemType a, ElemType b, ElemType c)
+{
+    ElemType regs[ElementWiseProgram::MaxRegisters];
+    regs[0] = a;
+    regs[1] = b;
+    regs[2] = c;
+    for (size_t i = 0; i < program.numSteps; i++)
+    {
+        const ElementWiseProgram::Step& step = program.steps[i];
+        const ElemType x = regs[step.arg0];
+        const ElemType y = regs[step.arg1];
+        ElemType& r = regs[ElementWiseProgram::MaxInputs + i];
+        switch (step.op)
+        {
+#pragma push_macro("CaseUnaryProgramOp")
+#define CaseUnaryProgramOp(oper) \
+        case ElementWiseOperator::op##oper: r = Op##oper(x); break
+            ForAllUnaryOps(CaseUnaryProgramOp);
+#pragma pop_macro("CaseUnaryProgramOp")
+#pragma push_macro("CaseBinaryProgramOp")
+#define CaseBinaryProgramOp(oper) \
+        case ElementWiseOperator::op##oper: r = Op##oper(x, y); break
+            ForAllBinaryOps(CaseBinaryProgramOp);
+#pragma pop_macro("CaseBinaryProgramOp")
+        default: r = 0; // (ops are validated when the program is built)
+        }
+    }
+    return program.numSteps > 0 ? regs[ElementWiseProgram::MaxInputs + program.numSteps - 1] : a;
+}
+
 }}}
 #pragma pop_macro("DECL")
 #pragma pop_macro("TENSOR_OPS_DECL")
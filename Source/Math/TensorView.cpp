@@ -36,13 +36,31 @@ using namespace std;
 // construction
 // -------------------------------------------------------------------
 
-// main constructor (all constructors except the default one route through this)
+// cast a type-agnostic SOB to the Matrix<ElemType> it must be
+template <class ElemType>
+static shared_ptr<Matrix<ElemType>> TypedSOB(const MatrixBasePtr& sob)
+{
+    auto typedSOB = dynamic_pointer_cast<Matrix<ElemType>>(sob);
+    if (!typedSOB)
+        LogicError("TensorView: Attempted to create a TensorView<ElemType> on a storage object of a different ElemType.");
+    return typedSOB;
+}
+
 template <class ElemType>
 TensorView<ElemType>::TensorView(const MatrixBasePtr& sob, const TensorShape& shape)
-    : m_sob(dynamic_pointer_cast<Matrix<ElemType>>(sob)), m_shape(shape)
+    : TensorView(TypedSOB<ElemType>(sob), shape)
+{
+}
+
+// main constructor (all constructors except the default one route through this)
+// Nodes create TensorViews for every operation and, inside loops, for every time step, so the typed SOB is taken as is,
+// without the dynamic cast and the reference counting of a conversion from and to MatrixBasePtr.
+template <class ElemType>
+TensorView<ElemType>::TensorView(const shared_ptr<Matrix<ElemType>>& sob, const TensorShape& shape)
+    : m_sob(sob), m_shape(shape)
 {
     if (!m_sob)
-        LogicError("TensorView: Attempted to create a TensorView<ElemType> on a storage object of a different ElemType.");
+        LogicError("TensorView: Attempted to create a TensorView on an empty storage object.");
 #ifdef _DEBUG
     // check bounds of TensorShape against underlying storage object
     // This is useful to detect errors like passing a matrix from the wrong input.
@@ -285,6 +303,21 @@ void TensorView<ElemType>::DoTernaryOpOf(ElemType beta, const TensorView& a, con
     GetSOB().TensorOp(beta, a.GetSOB(), b.GetSOB(), c.GetSOB(), alpha, op, reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
 }
 
+template <class ElemType>
+void TensorView<ElemType>::DoElementWiseProgramOf(ElemType beta, const TensorView& a, const TensorView& b, const TensorView& c, ElemType alpha, const ElementWiseProgram& program)
+{
+    array<size_t, 4> offsets;
+    array<SmallVector<ptrdiff_t>, 4> regularStrides, reducingStrides;
+    SmallVector<size_t> regularOpDims, reducingOpDims;
+    PrepareTensorOperands<ElemType, 4>(array<TensorShape, 4>{a.GetShape(), b.GetShape(), c.GetShape(), GetShape()}, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+
+    // output cannot be input when reducing
+    if (reducingOpDims.size() > 0)
+        CheckDifferentObject(a, *this) && CheckDifferentObject(b, *this) && CheckDifferentObject(c, *this);
+
+    GetSOB().TensorOp(beta, a.GetSOB(), b.GetSOB(), c.GetSOB(), alpha, program, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+}
+
 template <class ElemType>
 void TensorView<ElemType>::DoArgReductionOpOf(const TensorView& a, ElementWiseOperator reductionOp)
 {
@@ -369,7 +402,7 @@ shared_ptr<Matrix<ElemType>> TensorView<ElemType>::AsMatrix() const
 }
 
 template <class ElemType>
-void TensorView<ElemType>::DoMatrixProductOf(ElemType beta, bool transC, const TensorView& a, bool transA, const TensorView& b, bool transB, ElemType alpha, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier)
+void TensorView<ElemType>::DoMatrixProductOf(ElemType beta, bool transC, const TensorView& a, bool transA, const TensorView& b, bool transB, ElemType alpha, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier, shared_ptr<PackedGemmCache<ElemType>> pPackedA)
 {
     // determine integration dimension offset
     auto shapeA = a.m_shape;
@@ -400,8 +433,8 @@ void TensorView<ElemType>::DoMatrixProductOf(ElemType beta, bool transC, const T
     auto C =   Reshaped(shapeC).AsMatrix();
     // and go
     if (!transC)
-        Matrix<ElemType>::MultiplyAndWeightedAdd(alpha, *A, transA, *B, transB, beta, *C, pQuantizedMultiplier);
-    else // C' = A * B  <==>  C = (A * B)' = B' * A'
+        Matrix<ElemType>::MultiplyAndWeightedAdd(alpha, *A, transA, *B, transB, beta, *C, pQuantizedMultiplier, pPackedA);
+    else // C' = A * B  <==>  C = (A * B)' = B' * A'   (a is the right operand here, so its packed copy cannot be used)
         Matrix<ElemType>::MultiplyAndWeightedAdd(alpha, *B, !transB, *A, !transA, beta, *C, pQuantizedMultiplier);
 }
 
@@ -31,6 +31,8 @@ public:
     // -------------------------------------------------------------------
 
     // reinterpret a matrix storage object (SOB) as a TensorView with a given TensorShape  --this is the main constructor
+    TensorView(const shared_ptr<Matrix<ElemType>>& sob, const TensorShape& shape);
+    // same for a type-agnostic SOB, which must be a Matrix<ElemType>
     TensorView(const MatrixBasePtr& sob, const TensorShape& shape);
 #if 0
     // cast a Matrix as a 2D TensorView (without shape change)
@@ -134,6 +136,9 @@ public:
     void DoBinaryOpOf (ElemType beta, const TensorView& a, const TensorView& b,                      ElemType alpha, ElementWiseOperator op, ElementWiseOperator reductionOp);
     void DoTernaryOpOf(ElemType beta, const TensorView& a, const TensorView& b, const TensorView& c, ElemType alpha, ElementWiseOperator op, ElementWiseOperator reductionOp);
 
+    // fused element-wise program over up to three inputs (unused inputs may alias a used one)
+    void DoElementWiseProgramOf(ElemType beta, const TensorView& a, const TensorView& b, const TensorView& c, ElemType alpha, const ElementWiseProgram& program);
+
     // -------------------------------------------------------------------
     // arg based operations
     // -------------------------------------------------------------------
@@ -149,8 +154,8 @@ public:
     // If beta == 0, c is not read out, i.e. it can be uninitialized or contain NaNs.
     // -------------------------------------------------------------------
 
-    void DoMatrixProductOf(ElemType beta, bool transC, const TensorView& a, bool transA, const TensorView& b, bool transB, ElemType alpha, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier = nullptr);
-    void AssignMatrixProductOf(           bool transC, const TensorView& a, bool transA, const TensorView& b, bool transB, ElemType alpha = 1.0f, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier = nullptr) { DoMatrixProductOf(0, transC, a, transA, b, transB, alpha, pQuantizedMultiplier); }
+    void DoMatrixProductOf(ElemType beta, bool transC, const TensorView& a, bool transA, const TensorView& b, bool transB, ElemType alpha, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier = nullptr, shared_ptr<PackedGemmCache<ElemType>> pPackedA = nullptr);
+    void AssignMatrixProductOf(           bool transC, const TensorView& a, bool transA, const TensorView& b, bool transB, ElemType alpha = 1.0f, shared_ptr<QuantizedMultiplier<ElemType>> pQuantizedMultiplier = nullptr, shared_ptr<PackedGemmCache<ElemType>> pPackedA = nullptr) { DoMatrixProductOf(0, transC, a, transA, b, transB, alpha, pQuantizedMultiplier, pPackedA); }
     void AddMatrixProductOf   (           bool transC, const TensorView& a, bool transA, const TensorView& b, bool transB, ElemType alpha = 1.0f) { DoMatrixProductOf(1.0f, transC, a, transA, b, transB, alpha); }
 
     shared_ptr<Matrix<ElemType>> AsMatrix() const;
@@ -0,0 +1,164 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// half.hpp -- 16-bit IEEE 754 floating-point storage type, usable on both CPU and CUDA side.
+//
+// 'half' is a storage type. All arithmetic is carried out in float: values convert implicitly to
+// float, and are rounded back (round-to-nearest-even) when assigned. On the GPU the conversion maps to
+// the hardware instructions; on the CPU it is done in software.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if !defined(CPUONLY) && defined(__CUDACC__)
+#include <cuda_fp16.h>
+#endif
+
+#pragma push_macro("HALF_DECL")
+#ifdef __CUDACC__
+#define HALF_DECL __host__ __device__ inline
+#else
+#define HALF_DECL inline
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+class half
+{
+    uint16_t m_bits;
+
+    // software conversions, used on the host side
+    static HALF_DECL uint16_t FloatToBits(float f)
+    {
+        uint32_t x;
+        memcpy(&x, &f, sizeof(x));
+        const uint32_t sign = (x >> 16) & 0x8000;
+        const uint32_t absx = x & 0x7fffffff;
+
+        if (absx >= 0x7f800000) // Inf or NaN (keep NaN a quiet NaN)
+            return (uint16_t)(sign | 0x7c00 | (absx > 0x7f800000 ? 0x0200 | ((absx >> 13) & 0x3ff) : 0));
+        if (absx >= 0x477ff000) // rounds to a value beyond the largest half (65504) -> Inf
+            return (uint16_t)(sign | 0x7c00);
+        if (absx < 0x38800000) // result is a half denormal (or zero)
+        {
+            if (absx < 0x33000000) // less than half the smallest denormal -> signed zero
+                return (uint16_t)sign;
+            const uint32_t shift = 126 - (absx >> 23);               // 14..24
+            const uint32_t mant = (absx & 0x007fffff) | 0x00800000; // with implicit leading 1
+            uint32_t bits = mant >> shift;
+            const uint32_t rest = mant & ((1u << shift) - 1);
+            const uint32_t halfway = 1u << (shift - 1);
+            if (rest > halfway || (rest == halfway && (bits & 1)))
+                bits++;
+            return (uint16_t)(sign | bits);
+        }
+        // normal number: rebias exponent and round the mantissa to 10 bits
+        uint32_t bits = ((absx - 0x38000000) >> 13);
+        const uint32_t rest = absx & 0x1fff;
+        if (rest > 0x1000 || (rest == 0x1000 && (bits & 1)))
+            bits++; // may carry into the exponent, which is the correct result
+        return (uint16_t)(sign | bits);
+    }
+
+    static HALF_DECL float BitsToFloat(uint16_t h)
+    {
+        const uint32_t sign = ((uint32_t)h & 0x8000) << 16;
+        uint32_t exponent = ((uint32_t)h >> 10) & 0x1f;
+        uint32_t mant = (uint32_t)h & 0x3ff;
+        uint32_t x;
+        if (exponent == 0x1f) // Inf or NaN
+            x = sign | 0x7f800000 | (mant << 13);
+        else if (exponent != 0) // normal number
+            x = sign | ((exponent + 112) << 23) | (mant << 13);
+        else if (mant == 0) // signed zero
+            x = sign;
+        else // denormal: normalize it
+        {
+            exponent = 113;
+            while ((mant & 0x400) == 0)
+            {
+                mant <<= 1;
+                exponent--;
+            }
+            x = sign | (exponent << 23) | ((mant & 0x3ff) << 13);
+        }
+        float f;
+        memcpy(&f, &x, sizeof(f));
+        return f;
+    }
+
+public:
+    half() = default; // (must stay trivial, so that half arrays can be used in CUDA __shared__ memory and memcpy'ed)
+
+    HALF_DECL half(float f)
+    {
+#if defined(__CUDA_ARCH__) && !defined(CPUONLY)
+        __half h = __float2half(f);
+        memcpy(&m_bits, &h, sizeof(m_bits));
+#else
+        m_bits = FloatToBits(f);
+#endif
+    }
+    // any other arithmetic type goes through float (e.g. '(ElemType)0' or '(ElemType)numSamples')
+    template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    HALF_DECL half(T v) : half((float)v) { }
+
+    HALF_DECL operator float() const
+    {
+#if defined(__CUDA_ARCH__) && !defined(CPUONLY)
+        __half h;
+        memcpy(&h, &m_bits, sizeof(m_bits));
+        return __half2float(h);
+#else
+        return BitsToFloat(m_bits);
+#endif
+    }
+
+    // raw access to the 16-bit pattern, e.g. for serialization
+    static HALF_DECL half FromBits(uint16_t bits) { half h; h.m_bits = bits; return h; }
+    HALF_DECL uint16_t ToBits() const { return m_bits; }
+
+    HALF_DECL half& operator+=(float v) { return *this = half((float)*this + v); }
+    HALF_DECL half& operator-=(float v) { return *this = half((float)*this - v); }
+    HALF_DECL half& operator*=(float v) { return *this = half((float)*this * v); }
+    HALF_DECL half& operator/=(float v) { return *this = half((float)*this / v); }
+    HALF_DECL half operator-() const { return FromBits(m_bits ^ 0x8000); }
+};
+
+static_assert(sizeof(half) == 2, "half must be a 16-bit type");
+
+}}}
+
+namespace std {
+
+// numeric_limits for half, as needed by e.g. loss-scaling overflow checks and NaN initialization
+template <>
+class numeric_limits<Microsoft::MSR::CNTK::half>
+{
+    typedef Microsoft::MSR::CNTK::half half;
+public:
+    static const bool is_specialized = true;
+    static const bool is_signed = true;
+    static const bool is_integer = false;
+    static const bool is_exact = false;
+    static const bool has_infinity = true;
+    static const bool has_quiet_NaN = true;
+    static const int digits = 11;
+    static const int max_exponent = 16;
+    static HALF_DECL half min() { return half::FromBits(0x0400); }     // 6.10352e-05
+    static HALF_DECL half lowest() { return half::FromBits(0xfbff); }  // -65504
+    static HALF_DECL half max() { return half::FromBits(0x7bff); }     // 65504
+    static HALF_DECL half epsilon() { return half::FromBits(0x1400); } // 0.000976562
+    static HALF_DECL half infinity() { return half::FromBits(0x7c00); }
+    static HALF_DECL half quiet_NaN() { return half::FromBits(0x7e00); }
+};
+
+}
+
+#pragma pop_macro("HALF_DECL")
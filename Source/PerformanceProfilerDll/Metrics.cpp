@@ -0,0 +1,324 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Registry of live training metrics, and its export in the Prometheus text format over HTTP.
+//
+
+#ifndef _CRT_SECURE_NO_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+#endif
+#define _CRT_NONSTDC_NO_DEPRECATE // make VS accept POSIX functions without _
+
+#ifdef _WIN32
+#include <winsock2.h> // (must come before Windows.h, which Basics.h may include)
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "Metrics.h"
+#include "Basics.h"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <stdio.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+using namespace std;
+
+// Upper bounds of the histogram buckets, for times in seconds; the last bucket (+Inf) is implicit
+static const double c_histogramBounds[] = { 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50, 100 };
+static const size_t c_numHistogramBounds = sizeof(c_histogramBounds) / sizeof(c_histogramBounds[0]);
+
+struct MetricRecord
+{
+    MetricType              type;
+    double                  value;          // counter or gauge value; sum of the observations for histograms
+    long long               count;          // histograms only
+    double                  max;            // histograms only
+    vector<long long>       bucketCounts;   // histograms only, not cumulative; the last one is +Inf
+};
+
+// All metrics, by name
+static map<string, MetricRecord> g_metrics;
+
+// Mutex controlling access to g_metrics
+static mutex g_metricsMutex;
+
+static const char* MetricTypeName(MetricType type)
+{
+    switch (type)
+    {
+    case MetricType::Counter:   return "counter";
+    case MetricType::Gauge:     return "gauge";
+    default:                    return "histogram";
+    }
+}
+
+//
+// Get the metric record of the given name, creating it if needed. g_metricsMutex must be held.
+//
+static MetricRecord& GetMetricRecord(const char* name, MetricType type)
+{
+    auto iter = g_metrics.find(name);
+    if (iter == g_metrics.end())
+    {
+        bool isValidName = name[0] != '\0' && !isdigit((unsigned char)name[0]);
+        for (const char* p = name; *p && isValidName; p++)
+            isValidName = isalnum((unsigned char)*p) || *p == '_' || *p == ':';
+        if (!isValidName)
+            LogicError("Metrics: '%s' is not a valid metric name.", name);
+
+        MetricRecord record = { type, 0.0, 0, 0.0 };
+        if (type == MetricType::Histogram)
+            record.bucketCounts.assign(c_numHistogramBounds + 1, 0);
+        iter = g_metrics.insert(make_pair(string(name), record)).first;
+    }
+    else if (iter->second.type != type)
+        LogicError("Metrics: Metric '%s' is a %s, not a %s.", name, MetricTypeName(iter->second.type), MetricTypeName(type));
+    return iter->second;
+}
+
+void PERF_PROFILER_API MetricsCounterAdd(const char* name, double value)
+{
+    lock_guard<mutex> lock(g_metricsMutex);
+    GetMetricRecord(name, MetricType::Counter).value += value;
+}
+
+void PERF_PROFILER_API MetricsGaugeSet(const char* name, double value)
+{
+    lock_guard<mutex> lock(g_metricsMutex);
+    GetMetricRecord(name, MetricType::Gauge).value = value;
+}
+
+void PERF_PROFILER_API MetricsHistogramObserve(const char* name, double value)
+{
+    size_t bucket = upper_bound(c_histogramBounds, c_histogramBounds + c_numHistogramBounds, value) - c_histogramBounds;
+    if (bucket > 0 && c_histogramBounds[bucket - 1] == value) // (the bounds are inclusive)
+        bucket--;
+
+    lock_guard<mutex> lock(g_metricsMutex);
+    auto& record = GetMetricRecord(name, MetricType::Histogram);
+    record.max = record.count == 0 ? value : (max)(record.max, value);
+    record.value += value;
+    record.count++;
+    record.bucketCounts[bucket]++;
+}
+
+vector<MetricValue> PERF_PROFILER_API MetricsSnapshot()
+{
+    lock_guard<mutex> lock(g_metricsMutex);
+    vector<MetricValue> result;
+    result.reserve(g_metrics.size());
+    for (const auto& metric : g_metrics)
+        result.push_back({ metric.first, metric.second.type, metric.second.value, metric.second.count, metric.second.max });
+    return result;
+}
+
+string PERF_PROFILER_API MetricsPrometheusText()
+{
+    lock_guard<mutex> lock(g_metricsMutex);
+    string text;
+    char buf[256];
+    for (const auto& metric : g_metrics)
+    {
+        const char* name = metric.first.c_str();
+        const auto& record = metric.second;
+        text += string("# TYPE ") + name + " " + MetricTypeName(record.type) + "\n";
+        if (record.type != MetricType::Histogram)
+        {
+            sprintf(buf, "%s %.17g\n", name, record.value);
+            text += buf;
+            continue;
+        }
+
+        long long cumulativeCount = 0;
+        for (size_t i = 0; i < c_numHistogramBounds; i++)
+        {
+            cumulativeCount += record.bucketCounts[i];
+            sprintf(buf, "%s_bucket{le=\"%g\"} %lld\n", name, c_histogramBounds[i], cumulativeCount);
+            text += buf;
+        }
+        sprintf(buf, "%s_bucket{le=\"+Inf\"} %lld\n", name, record.count);
+        text += buf;
+        sprintf(buf, "%s_sum %.17g\n%s_count %lld\n", name, record.value, name, record.count);
+        text += buf;
+    }
+    return text;
+}
+
+//
+// HTTP endpoint
+//
+
+#ifdef _WIN32
+typedef SOCKET SocketType;
+static const SocketType c_invalidSocket = INVALID_SOCKET;
+static void CloseSocket(SocketType s) { closesocket(s); }
+#define MSG_NOSIGNAL 0
+#else
+typedef int SocketType;
+static const SocketType c_invalidSocket = -1;
+static void CloseSocket(SocketType s) { close(s); }
+#endif
+
+static void SendAll(SocketType client, const string& data)
+{
+    for (size_t sent = 0; sent < data.size();)
+    {
+        int rc = send(client, data.data() + sent, (int)(data.size() - sent), MSG_NOSIGNAL);
+        if (rc <= 0)
+            return; // (the client went away)
+        sent += rc;
+    }
+}
+
+//
+// Read the request header and answer it. Only GET /metrics is served.
+//
+static void HandleHttpRequest(SocketType client)
+{
+#ifdef _WIN32
+    DWORD timeout = 1000;
+#else
+    timeval timeout = { 1, 0 };
+#endif
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+
+    string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == string::npos && request.size() < 8192)
+    {
+        int rc = recv(client, buf, sizeof(buf), 0);
+        if (rc <= 0)
+            break;
+        request.append(buf, rc);
+    }
+
+    string status, contentType, body;
+    if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 13, "GET /metrics?") == 0)
+    {
+        status = "200 OK";
+        contentType = "text/plain; version=0.0.4";
+        body = MetricsPrometheusText();
+    }
+    else
+    {
+        status = "404 Not Found";
+        contentType = "text/plain";
+        body = "Not found. The metrics are served on /metrics.\n";
+    }
+    SendAll(client, "HTTP/1.0 " + status + "\r\nContent-Type: " + contentType + "\r\nContent-Length: " + to_string(body.size()) +
+                    "\r\nConnection: close\r\n\r\n" + body);
+}
+
+//
+// The endpoint thread accepts one connection at a time, and checks for stop requests a few times per second.
+//
+struct HttpEndpoint
+{
+    thread              serverThread;
+    atomic<bool>        stopRequested;
+    int                 port;
+
+    HttpEndpoint() : stopRequested(false), port(0) {}
+    ~HttpEndpoint() { Stop(); }
+
+    void Serve(SocketType listenSocket)
+    {
+        while (!stopRequested)
+        {
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(listenSocket, &readSet);
+            timeval timeout = { 0, 250000 };
+            if (select((int)listenSocket + 1, &readSet, nullptr, nullptr, &timeout) <= 0)
+                continue;
+
+            SocketType client = accept(listenSocket, nullptr, nullptr);
+            if (client == c_invalidSocket)
+                continue;
+            HandleHttpRequest(client);
+            CloseSocket(client);
+        }
+        CloseSocket(listenSocket);
+    }
+
+    void Stop()
+    {
+        if (!serverThread.joinable())
+            return;
+        stopRequested = true;
+        serverThread.join();
+        stopRequested = false;
+    }
+};
+
+static HttpEndpoint g_httpEndpoint;
+
+// Mutex serializing MetricsStartHttpEndpoint() and MetricsStopHttpEndpoint()
+static mutex g_httpEndpointMutex;
+
+bool PERF_PROFILER_API MetricsStartHttpEndpoint(int port)
+{
+    lock_guard<mutex> lock(g_httpEndpointMutex);
+    if (g_httpEndpoint.serverThread.joinable())
+    {
+        if (g_httpEndpoint.port == port)
+            return true;
+        fprintf(stderr, "Warning: Metrics: The HTTP endpoint is running on port %d already.\n", g_httpEndpoint.port);
+        return false;
+    }
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        fprintf(stderr, "Warning: Metrics: Cannot initialize Winsock, the HTTP endpoint is off.\n");
+        return false;
+    }
+#endif
+
+    SocketType listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == c_invalidSocket)
+    {
+        fprintf(stderr, "Warning: Metrics: Cannot create a socket, the HTTP endpoint is off.\n");
+        return false;
+    }
+
+    int reuseAddress = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuseAddress, sizeof(reuseAddress));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((unsigned short)port);
+    if (bind(listenSocket, (const sockaddr*)&address, sizeof(address)) != 0 || listen(listenSocket, 16) != 0)
+    {
+        fprintf(stderr, "Warning: Metrics: Cannot listen on port %d, the HTTP endpoint is off.\n", port);
+        CloseSocket(listenSocket);
+        return false;
+    }
+
+    g_httpEndpoint.port = port;
+    g_httpEndpoint.serverThread = thread([listenSocket]() { g_httpEndpoint.Serve(listenSocket); });
+    fprintf(stderr, "Metrics: Serving the live metrics on http://<host>:%d/metrics.\n", port);
+    return true;
+}
+
+void PERF_PROFILER_API MetricsStopHttpEndpoint()
+{
+    lock_guard<mutex> lock(g_httpEndpointMutex);
+    g_httpEndpoint.Stop();
+}
+
+}}}
@@ -0,0 +1,93 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Registry of live training metrics (throughput, memory, reader stalls, gradient aggregation time), which are
+// exported while training runs, unlike the reports of the profiler, which are written when it is torn down.
+//
+// Metrics Usage
+//
+// There are three kinds of metrics, all identified by a name, and created on first use:
+//  - counters, which only increase (e.g. the number of samples processed), see MetricsCounterAdd();
+//  - gauges, which hold the latest value of a quantity (e.g. samples per second), see MetricsGaugeSet();
+//  - histograms, which accumulate observations into fixed buckets (e.g. the time of each gradient aggregation),
+//    see MetricsHistogramObserve(), or the scoped object ScopeMetricsTimer for times in seconds.
+// Names follow the Prometheus conventions, [a-zA-Z_:][a-zA-Z0-9_:]*, with the unit as suffix, e.g. "_seconds".
+// Updating a metric takes a lock and a map lookup, so it is meant for events per minibatch, not per element.
+//
+// The metrics can be read with MetricsSnapshot() (SGD writes them to TensorBoard this way), and served in the
+// Prometheus text format by a small HTTP server on all interfaces, see MetricsStartHttpEndpoint(), e.g. for
+// 'curl http://<host>:<port>/metrics'.
+//
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "PerformanceProfiler.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+enum class MetricType
+{
+    Counter,
+    Gauge,
+    Histogram
+};
+
+//
+// Value of a metric, as returned by MetricsSnapshot()
+//
+struct MetricValue
+{
+    std::string     name;
+    MetricType      type;
+    double          value;            // counter or gauge value; sum of the observations for histograms
+    long long       count;            // number of observations (histograms only)
+    double          max;              // largest observation (histograms only)
+
+    double Mean() const { return count > 0 ? value / count : 0.0; }
+};
+
+void PERF_PROFILER_API MetricsCounterAdd(const char* name, double value = 1.0);
+void PERF_PROFILER_API MetricsGaugeSet(const char* name, double value);
+void PERF_PROFILER_API MetricsHistogramObserve(const char* name, double value);
+
+//
+// All metrics, ordered by name.
+//
+std::vector<MetricValue> PERF_PROFILER_API MetricsSnapshot();
+
+//
+// All metrics in the Prometheus text exposition format (version 0.0.4).
+//
+std::string PERF_PROFILER_API MetricsPrometheusText();
+
+//
+// Serve MetricsPrometheusText() on GET /metrics from a background thread. Returns false, with a warning,
+// if the port cannot be opened, or if the endpoint is running on another port already.
+//
+bool PERF_PROFILER_API MetricsStartHttpEndpoint(int port);
+void PERF_PROFILER_API MetricsStopHttpEndpoint();
+
+//
+// Scoped helper that observes the time of its scope, in seconds, in a histogram.
+//
+struct ScopeMetricsTimer
+{
+    ScopeMetricsTimer(const char* histogramName) : m_histogramName(histogramName), m_begin(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopeMetricsTimer()
+    {
+        MetricsHistogramObserve(m_histogramName, std::chrono::duration<double>(std::chrono::steady_clock::now() - m_begin).count());
+    }
+
+private:
+    const char* m_histogramName;
+    std::chrono::steady_clock::time_point m_begin;
+};
+
+}}}
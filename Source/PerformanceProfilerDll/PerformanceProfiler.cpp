@@ -17,8 +17,16 @@
 #include "fileutil.h"
 #include "TimerUtility.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 #include <stdio.h>
 #ifndef CPUONLY
 #include <cuda_runtime_api.h>
@@ -28,6 +36,7 @@
 #include <Windows.h>
 #else
 #include <sys/syscall.h>
+#include <dlfcn.h>
 #endif 
 
 
@@ -40,6 +49,7 @@ enum FixedEventType
 {
     profilerEvtTime = 0,
     profilerEvtThroughput,
+    profilerEvtRatio,
     profilerEvtSeparator
 };
 
@@ -67,6 +77,25 @@ static const FixedEventDesc c_fixedEvtDesc[profilerEvtMax] = {
     { "", profilerEvtSeparator, false },                            // profilerSepSpace2
 
     { "Prefetch Minibatch", profilerEvtTime, false },               // profilerEvtPrefetchMinibatch
+    { "Wait for Data Chunk", profilerEvtTime, false },              // profilerEvtChunkWait
+    { "Load Data Chunk", profilerEvtTime, false },                  // profilerEvtChunkLoad
+    { "Exposed Input Transfer", profilerEvtRatio, false },          // profilerEvtInputTransferExposed
+
+    { "", profilerEvtSeparator, false },                            // profilerSepSpace3
+    { "Recurrent Networks", profilerEvtSeparator, false },          // profilerSepRecurrent
+    { "", profilerEvtSeparator, false },                            // profilerSepSpace4
+
+    { "RNN Pack Sequences", profilerEvtTime, true },                // profilerEvtRNNPackSequences
+    { "RNN Padding Efficiency", profilerEvtRatio, false },          // profilerEvtRNNPaddingEfficiency
+
+    { "", profilerEvtSeparator, false },                            // profilerSepSpace5
+    { "Communication", profilerEvtSeparator, false },               // profilerSepCommunication
+    { "", profilerEvtSeparator, false },                            // profilerSepSpace6
+
+    { "MPI AllReduce", profilerEvtTime, false },                    // profilerEvtMPIAllReduce
+    { "MPI Wait", profilerEvtTime, false },                         // profilerEvtMPIWait
+    { "NCCL AllReduce Launch", profilerEvtTime, false },            // profilerEvtNcclAllReduce
+    { "NCCL Sync", profilerEvtTime, false },                        // profilerEvtNcclSync
 };
 
 
@@ -78,6 +107,8 @@ struct FixedEventRecord
     long long       min;          // time (ns) or throughput (kB/s)
     long long       max;          // time (ns) or throughput (kB/s)
     long long       totalBytes;   // used only for throughput events
+    long long       totalNumerator;   // used only for ratio events
+    long long       totalDenominator; // used only for ratio events
 };
 
 //
@@ -92,6 +123,48 @@ struct CustomEventRecord
 };
 
 
+//
+// Node profiling data of a node of the network.
+//
+struct NodeEventRecord
+{
+    std::wstring    operationName;
+    int             forwardCnt;       // number of forward passes
+    int             backwardCnt;      // number of backward passes
+    double          forwardSeconds;
+    double          backwardSeconds;
+    double          flops;            // estimated floating point operations of all passes
+    long long       bytes;            // largest memory allocation seen
+};
+
+//
+// A node event in progress, between ProfilerNodeBegin() and ProfilerNodeEnd()
+//
+struct NodeEventState
+{
+    int             deviceId;
+    long long       beginClock;
+#ifndef CPUONLY
+    cudaEvent_t     beginEvent;       // used only for GPU nodes
+#endif
+};
+
+#ifndef CPUONLY
+//
+// A GPU node event that has ended, but whose CUDA events may not have completed yet
+//
+struct PendingNodeEvent
+{
+    std::wstring    nodeName;
+    std::wstring    operationName;
+    bool            backprop;
+    double          flops;
+    long long       bytes;
+    cudaEvent_t     beginEvent;
+    cudaEvent_t     endEvent;
+};
+#endif
+
 //
 // Global state of the profiler
 //
@@ -107,6 +180,17 @@ struct ProfilerState
     unsigned long long      customEventBufferBytes;      // Number of bytes allocated for the custom event buffer
     unsigned long long      customEventOffset;           // Offset to current place in buffer
     unique_ptr<char[]>      customEventBuffer;           // Pointer to custom event buffer
+    unsigned int            mainThreadId;                // Thread that initialized the profiler
+    double                  wallClockOffset;             // Wall-clock time (in microseconds since the epoch) minus Clock time
+    bool                    profileNodes;                // Time the forward and backward passes of each node
+    std::wstring            nodeReportFileName;          // File the node summaries are appended to
+    std::map<std::wstring, NodeEventRecord> nodeEvents;  // Node profiling data, by node name
+    std::vector<NodeEventState> nodeStates;              // Node events in progress, indexed by stateId
+    std::vector<long long>  freeNodeStates;              // Unused entries of nodeStates
+#ifndef CPUONLY
+    std::deque<PendingNodeEvent> pendingNodeEvents;      // GPU node events not read yet, in the order they were recorded
+    std::vector<cudaEvent_t> freeCudaEvents;             // CUDA events for reuse
+#endif
 };
 
 
@@ -116,14 +200,29 @@ static unique_ptr<ProfilerState> g_profilerState;
 // Mutex controlling access to g_profilerState
 static std::mutex g_mutex;
 
+// NVTX ranges (see ProfilerEnableNvtx()). The NVTX library is loaded at run time, so that it is
+// neither a build nor a run-time dependency when the ranges are off.
+typedef int (*NvtxRangePushAFunc)(const char*);
+typedef int (*NvtxRangePopFunc)();
+static std::atomic<bool> g_nvtxEnabled(false);
+static NvtxRangePushAFunc g_nvtxRangePushA = nullptr;
+static NvtxRangePopFunc g_nvtxRangePop = nullptr;
+
+// Continuous profiling (see ProfilerContinuousInit()). The flag is checked by every fixed event before anything else.
+static std::atomic<bool> g_continuousEnabled(false);
+
 // Forward declarations
 unsigned int GetThreadId();
+void ProfilerContinuousRecord(const int eventId, const long long beginClock, const long long endClock, const long long bytes);
 
 void ProfilerGenerateReport(const std::wstring& fileName, struct tm* timeInfo);
 void FormatTimeStr(char* str, size_t strLen, double value);
 void FormatThroughputStr(char* str, size_t strLen, double value);
+void FormatRatioStr(char* str, size_t strLen, double value);
 void FormatBytesStr(char* str, size_t strLen, long long bytes);
 void ProfilerGenerateDetailFile(const std::wstring& fileName);
+void ProfilerGenerateTraceFile(const std::wstring& fileName);
+void ProfilerGenerateNodeReport(const std::wstring& fileName, const std::string& title);
 
 
 double TicksToSeconds(long long ticks)
@@ -145,9 +244,10 @@ double TicksSqToSecondsSq(double ticksSq)
 // customEventBufferBytes: Size of the custom event buffer.
 // logSuffix: Suffix string to append to log file names.
 // syncGpu: Wait for GPU to complete processing for each profiling event with syncGpu flag set.
+// profileNodes: Time the forward and backward pass of each node of the network.
 //
 void PERF_PROFILER_API ProfilerInit(const std::wstring& profilerDir, const unsigned long long customEventBufferBytes,
-    const std::wstring& logSuffix, const bool syncGpu)
+    const std::wstring& logSuffix, const bool syncGpu, const bool profileNodes)
 {
     if (g_profilerState != nullptr)
     {
@@ -166,6 +266,23 @@ void PERF_PROFILER_API ProfilerInit(const std::wstring& profilerDir, const unsig
     g_profilerState->syncGpu = syncGpu;
     g_profilerState->enabled = false;
 
+    // Clock time stamps are only comparable within a process; the timeline uses the wall-clock time
+    // instead, so that the timelines of several processes (of a distributed job) can be merged.
+    g_profilerState->mainThreadId = GetThreadId();
+    auto wallClock = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch());
+    g_profilerState->wallClockOffset = (double)wallClock.count() - 1000000.0 * TicksToSeconds(Clock::GetTimeStamp());
+
+    g_profilerState->profileNodes = profileNodes;
+    if (profileNodes)
+    {
+        // Get current time as yyyy-mm-dd_hh-mm-ss
+        time_t currentTime;
+        time(&currentTime);
+        wchar_t timeStr[32];
+        wcsftime(timeStr, sizeof(timeStr) / sizeof(timeStr[0]), L"%Y-%m-%d_%H-%M-%S", localtime(&currentTime));
+        g_profilerState->nodeReportFileName = profilerDir + L"/" + std::wstring(timeStr) + L"_nodes_" + logSuffix + L".txt";
+    }
+
     if (_wmkdir(g_profilerState->profilerDir.c_str()) == -1 && errno != EEXIST)
     {
         RuntimeError("Error: ProfilerInit: Cannot create directory <%ls>.\n", g_profilerState->profilerDir.c_str());
@@ -255,6 +372,9 @@ long long PERF_PROFILER_API ProfilerTimeBegin()
 
 void PERF_PROFILER_API ProfilerTimeEnd(const long long stateId, const int eventId)
 {
+    if (g_continuousEnabled.load(std::memory_order_relaxed))
+        ProfilerContinuousRecord(eventId, stateId, Clock::GetTimeStamp(), 0);
+
     // A nullptr state indicates that the profiler is globally disabled, and not initialized
     if (g_profilerState == nullptr)
         return;
@@ -313,6 +433,9 @@ void PERF_PROFILER_API ProfilerThroughputEnd(const long long stateId, const int
 {
     long long endClock = Clock::GetTimeStamp();
 
+    if (g_continuousEnabled.load(std::memory_order_relaxed))
+        ProfilerContinuousRecord(eventId, stateId, endClock, bytes);
+
     // A nullptr state indicates that the profiler is globally disabled, and not initialized
     if (g_profilerState == nullptr)
         return;
@@ -342,6 +465,197 @@ void PERF_PROFILER_API ProfilerThroughputEnd(const long long stateId, const int
 }
 
 
+//
+// Record a ratio, e.g. the fraction of useful work. The report shows the statistics of the
+// recorded ratios, and as the total the ratio of the sums of all numerators and denominators.
+// Can only be used with fixed events.
+//
+void PERF_PROFILER_API ProfilerRatio(const int eventId, const long long numerator, const long long denominator)
+{
+    // A nullptr state indicates that the profiler is globally disabled, and not initialized
+    if (g_profilerState == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    if (!g_profilerState->enabled || denominator == 0)
+        return;
+
+    // Use parts per million to record the ratio as an integer
+    long long ppm = numerator * 1000000 / denominator;
+    if (g_profilerState->fixedEvents[eventId].cnt == 0)
+    {
+        g_profilerState->fixedEvents[eventId].min = ppm;
+        g_profilerState->fixedEvents[eventId].max = ppm;
+    }
+    g_profilerState->fixedEvents[eventId].min = std::min(ppm, g_profilerState->fixedEvents[eventId].min);
+    g_profilerState->fixedEvents[eventId].max = std::max(ppm, g_profilerState->fixedEvents[eventId].max);
+    g_profilerState->fixedEvents[eventId].sum += ppm;
+    g_profilerState->fixedEvents[eventId].sumsq += (double)ppm * (double)ppm;
+    g_profilerState->fixedEvents[eventId].totalNumerator += numerator;
+    g_profilerState->fixedEvents[eventId].totalDenominator += denominator;
+    g_profilerState->fixedEvents[eventId].cnt++;
+}
+
+
+//
+// Internal helper functions for node profiling. These are called with g_mutex locked.
+//
+void ProfilerNodeRecord(const std::wstring& nodeName, const std::wstring& operationName, const bool backprop,
+    const double seconds, const double flops, const long long bytes)
+{
+    auto& record = g_profilerState->nodeEvents[nodeName];
+    record.operationName = operationName;
+    if (backprop)
+    {
+        record.backwardCnt++;
+        record.backwardSeconds += seconds;
+    }
+    else
+    {
+        record.forwardCnt++;
+        record.forwardSeconds += seconds;
+    }
+    record.flops += flops;
+    record.bytes = std::max(bytes, record.bytes);
+}
+
+#ifndef CPUONLY
+cudaEvent_t ProfilerGetCudaEvent()
+{
+    cudaEvent_t event;
+    if (!g_profilerState->freeCudaEvents.empty())
+    {
+        event = g_profilerState->freeCudaEvents.back();
+        g_profilerState->freeCudaEvents.pop_back();
+    }
+    else if (cudaEventCreate(&event) != cudaSuccess)
+    {
+        RuntimeError("Error: ProfilerNodeBegin: Cannot create a CUDA event.\n");
+    }
+    return event;
+}
+
+// Read the GPU node events that have completed, in recording order. If wait is set, wait for all of them.
+void ProfilerReadNodeEvents(const bool wait)
+{
+    auto& pendingEvents = g_profilerState->pendingNodeEvents;
+    while (!pendingEvents.empty())
+    {
+        const auto& event = pendingEvents.front();
+        if (wait)
+            cudaEventSynchronize(event.endEvent);
+        else if (cudaEventQuery(event.endEvent) != cudaSuccess)
+            break; // (events complete in the order they were recorded on the stream)
+
+        float milliseconds = 0;
+        cudaEventElapsedTime(&milliseconds, event.beginEvent, event.endEvent);
+        ProfilerNodeRecord(event.nodeName, event.operationName, event.backprop, milliseconds / 1000.0, event.flops, event.bytes);
+
+        g_profilerState->freeCudaEvents.push_back(event.beginEvent);
+        g_profilerState->freeCudaEvents.push_back(event.endEvent);
+        pendingEvents.pop_front();
+    }
+}
+#endif
+
+
+//
+// Measure the forward or backward pass of a node of the network.
+// ProfilerNodeBegin() returns a stateId that is passed to ProfilerNodeEnd(), or -1 if node profiling is off.
+//
+long long PERF_PROFILER_API ProfilerNodeBegin(const int deviceId)
+{
+    // A nullptr state indicates that the profiler is globally disabled, and not initialized
+    if (g_profilerState == nullptr || !g_profilerState->profileNodes)
+        return -1;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    if (!g_profilerState->enabled)
+        return -1;
+
+    NodeEventState state;
+    state.deviceId = deviceId;
+#ifndef CPUONLY
+    if (deviceId >= 0)
+    {
+        state.beginEvent = ProfilerGetCudaEvent();
+        cudaEventRecord(state.beginEvent, 0);
+    }
+#endif
+
+    long long stateId;
+    if (g_profilerState->freeNodeStates.empty())
+    {
+        stateId = (long long)g_profilerState->nodeStates.size();
+        g_profilerState->nodeStates.push_back(state);
+    }
+    else
+    {
+        stateId = g_profilerState->freeNodeStates.back();
+        g_profilerState->freeNodeStates.pop_back();
+        g_profilerState->nodeStates[stateId] = state;
+    }
+
+    g_profilerState->nodeStates[stateId].beginClock = Clock::GetTimeStamp();
+    return stateId;
+}
+
+
+void PERF_PROFILER_API ProfilerNodeEnd(const long long stateId, const std::wstring& nodeName, const std::wstring& operationName,
+    const bool backprop, const double flops, const long long bytes)
+{
+    long long endClock = Clock::GetTimeStamp();
+
+    // A nullptr state indicates that the profiler is globally disabled, and not initialized
+    if (stateId < 0 || g_profilerState == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    NodeEventState state = g_profilerState->nodeStates[stateId];
+    g_profilerState->freeNodeStates.push_back(stateId);
+
+#ifndef CPUONLY
+    if (state.deviceId >= 0)
+    {
+        PendingNodeEvent event = { nodeName, operationName, backprop, flops, bytes, state.beginEvent, ProfilerGetCudaEvent() };
+        cudaEventRecord(event.endEvent, 0);
+        g_profilerState->pendingNodeEvents.push_back(event);
+
+        ProfilerReadNodeEvents(/*wait=*/false);
+        return;
+    }
+#endif
+
+    ProfilerNodeRecord(nodeName, operationName, backprop, TicksToSeconds(endClock - state.beginClock), flops, bytes);
+}
+
+
+//
+// Append the summary of the node events recorded since the last call to the node report, and reset them.
+//
+void PERF_PROFILER_API ProfilerNodeSummary(const std::string& title)
+{
+    // A nullptr state indicates that the profiler is globally disabled, and not initialized
+    if (g_profilerState == nullptr || !g_profilerState->profileNodes)
+        return;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+#ifndef CPUONLY
+    ProfilerReadNodeEvents(/*wait=*/true);
+#endif
+
+    if (g_profilerState->nodeEvents.empty())
+        return;
+
+    ProfilerGenerateNodeReport(g_profilerState->nodeReportFileName, title);
+    g_profilerState->nodeEvents.clear();
+}
+
+
 //
 // Generate reports and release all resources.
 //
@@ -351,6 +665,13 @@ void PERF_PROFILER_API ProfilerClose()
     if (g_profilerState == nullptr)
         return;
 
+    // Summarize the node events since the last summary
+    ProfilerNodeSummary("Remaining node events");
+#ifndef CPUONLY
+    for (auto event : g_profilerState->freeCudaEvents)
+        cudaEventDestroy(event);
+#endif
+
     // Get current time as yyyy-mm-dd_hh-mm-ss
     time_t currentTime;
     time(&currentTime);
@@ -366,10 +687,490 @@ void PERF_PROFILER_API ProfilerClose()
     fileName = g_profilerState->profilerDir + L"/" + std::wstring(timeStr) + L"_detail_" + g_profilerState->logSuffix + L".csv";
     ProfilerGenerateDetailFile(fileName);
 
+    // Generate timeline
+    fileName = g_profilerState->profilerDir + L"/" + std::wstring(timeStr) + L"_trace_" + g_profilerState->logSuffix + L".json";
+    ProfilerGenerateTraceFile(fileName);
+
     g_profilerState.reset();
 }
 
 
+//
+// Turn NVTX ranges on or off.
+//
+bool PERF_PROFILER_API ProfilerEnableNvtx(bool enable)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    if (enable && g_nvtxRangePushA == nullptr)
+    {
+#ifdef _WIN32
+        HMODULE module = LoadLibraryA("nvToolsExt64_1.dll");
+        if (module != NULL)
+        {
+            g_nvtxRangePushA = (NvtxRangePushAFunc)GetProcAddress(module, "nvtxRangePushA");
+            g_nvtxRangePop = (NvtxRangePopFunc)GetProcAddress(module, "nvtxRangePop");
+        }
+#else
+        void* module = dlopen("libnvToolsExt.so.1", RTLD_LAZY);
+        if (module == nullptr)
+            module = dlopen("libnvToolsExt.so", RTLD_LAZY);
+        if (module != nullptr)
+        {
+            g_nvtxRangePushA = (NvtxRangePushAFunc)dlsym(module, "nvtxRangePushA");
+            g_nvtxRangePop = (NvtxRangePopFunc)dlsym(module, "nvtxRangePop");
+        }
+#endif
+        if (g_nvtxRangePushA == nullptr || g_nvtxRangePop == nullptr)
+        {
+            fprintf(stderr, "Warning: Performance Profiler: Cannot load the NVTX library, NVTX ranges are off.\n");
+            g_nvtxRangePushA = nullptr;
+            return false;
+        }
+    }
+
+    g_nvtxEnabled = enable;
+    return enable;
+}
+
+bool PERF_PROFILER_API ProfilerNvtxEnabled()
+{
+    return g_nvtxEnabled.load(std::memory_order_relaxed);
+}
+
+
+//
+// Push and pop a (nested) NVTX range, if NVTX ranges are on.
+//
+bool PERF_PROFILER_API ProfilerRangePush(const char* description)
+{
+    if (!g_nvtxEnabled.load(std::memory_order_relaxed))
+        return false;
+
+    g_nvtxRangePushA(description);
+    return true;
+}
+
+bool PERF_PROFILER_API ProfilerRangePush(const int eventId)
+{
+    return ProfilerRangePush(c_fixedEvtDesc[eventId].eventDescription);
+}
+
+void PERF_PROFILER_API ProfilerRangePop()
+{
+    g_nvtxRangePop();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Continuous profiling.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// An entry of a ring buffer. It is written by the thread that owns the ring buffer and read by the aggregation
+// thread (and ProfilerContinuousDump()) without a lock: seq is the index of the event plus one once the entry is
+// complete, and 0 while it is being written, so that the reader can tell whether it read a consistent entry.
+//
+struct ContinuousEventSlot
+{
+    std::atomic<unsigned long long> seq;
+    std::atomic<int>        eventId;
+    std::atomic<long long>  beginClock;
+    std::atomic<long long>  endClock;
+    std::atomic<long long>  bytes;       // used only for throughput events
+};
+
+struct ContinuousEvent
+{
+    int             eventId;
+    long long       beginClock;
+    long long       endClock;
+    long long       bytes;
+};
+
+//
+// The ring buffer of the most recent events of a thread
+//
+struct ContinuousEventRing
+{
+    static const unsigned long long capacity = 64 * 1024; // (a power of 2)
+
+    ContinuousEventRing(unsigned int threadId) : threadId(threadId), slots(new ContinuousEventSlot[capacity]), head(0), aggregated(0)
+    {
+        for (unsigned long long i = 0; i < capacity; i++)
+            slots[i].seq.store(0, std::memory_order_relaxed);
+    }
+
+    unsigned int                            threadId;
+    std::unique_ptr<ContinuousEventSlot[]>  slots;
+    std::atomic<unsigned long long>         head;        // Number of events written
+    unsigned long long                      aggregated;  // Number of events seen by the aggregation thread
+
+    // Read event 'index', if it has not been overwritten since
+    bool Read(unsigned long long index, ContinuousEvent& event) const
+    {
+        const auto& slot = slots[index & (capacity - 1)];
+        unsigned long long seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != index + 1)
+            return false;
+        event.eventId = slot.eventId.load(std::memory_order_relaxed);
+        event.beginClock = slot.beginClock.load(std::memory_order_relaxed);
+        event.endClock = slot.endClock.load(std::memory_order_relaxed);
+        event.bytes = slot.bytes.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.seq.load(std::memory_order_relaxed) == seq;
+    }
+};
+
+//
+// Statistics of a fixed event over the current interval
+//
+struct ContinuousEventStats
+{
+    long long       cnt;
+    long long       sumTicks;
+    long long       maxTicks;
+    long long       totalBytes;  // used only for throughput events
+};
+
+//
+// State of continuous profiling
+//
+struct ContinuousProfilerState
+{
+    std::wstring            profilerDir;                 // Directory where summaries/dumps are saved
+    std::wstring            logSuffix;                   // Suffix to append to file names
+    int                     summarySeconds;              // Interval of the summaries
+    int                     dumpSeconds;                 // Seconds of events in a dump
+    double                  slowdownFactor;              // Dump when the minibatch time exceeds the baseline by this factor (0: off)
+    double                  wallClockOffset;             // Wall-clock time (in microseconds since the epoch) minus Clock time
+    std::vector<std::shared_ptr<ContinuousEventRing>> rings; // Ring buffers of all threads that recorded events
+    ContinuousEventStats    stats[profilerEvtMax];       // Statistics of the current interval
+    long long               intervalBeginClock;          // Begin of the current interval
+    long long               lostEvents;                  // Events of the current interval overwritten before they were aggregated
+    double                  baselineMinibatchSeconds;    // Mean minibatch time of the previous intervals (0: none yet)
+    bool                    slowdownDumped;              // A slowdown has been dumped and has not recovered yet
+    bool                    stop;                        // Tells the aggregation thread to exit
+    std::condition_variable wakeUp;
+    std::thread             aggregationThread;
+};
+
+// Mutex controlling access to g_continuousState. It is not taken for recording an event,
+// except for the first event of a thread.
+static std::mutex g_continuousMutex;
+static unique_ptr<ContinuousProfilerState> g_continuousState;
+
+// Each ProfilerContinuousInit() starts a new generation, in which each thread registers a new ring buffer.
+static std::atomic<unsigned int> g_continuousGeneration(0);
+static thread_local std::shared_ptr<ContinuousEventRing> t_continuousRing;
+static thread_local unsigned int t_continuousGeneration = 0;
+
+// Set by SIGUSR2, polled by the aggregation thread
+static volatile std::sig_atomic_t g_continuousDumpSignaled = 0;
+
+#ifndef _WIN32
+extern "C" void ProfilerContinuousSignalHandler(int)
+{
+    g_continuousDumpSignaled = 1;
+}
+#endif
+
+void ProfilerContinuousRecord(const int eventId, const long long beginClock, const long long endClock, const long long bytes)
+{
+    unsigned int generation = g_continuousGeneration.load(std::memory_order_relaxed);
+    if (t_continuousGeneration != generation || t_continuousRing == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(g_continuousMutex);
+        if (g_continuousState == nullptr)
+            return;
+        t_continuousRing = std::make_shared<ContinuousEventRing>(GetThreadId());
+        t_continuousGeneration = generation;
+        g_continuousState->rings.push_back(t_continuousRing);
+    }
+
+    auto& ring = *t_continuousRing;
+    unsigned long long index = ring.head.load(std::memory_order_relaxed);
+    auto& slot = ring.slots[index & (ContinuousEventRing::capacity - 1)];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.eventId.store(eventId, std::memory_order_relaxed);
+    slot.beginClock.store(beginClock, std::memory_order_relaxed);
+    slot.endClock.store(endClock, std::memory_order_relaxed);
+    slot.bytes.store(bytes, std::memory_order_relaxed);
+    slot.seq.store(index + 1, std::memory_order_release);
+    ring.head.store(index + 1, std::memory_order_release);
+}
+
+//
+// Internal helper functions of continuous profiling. These are called with g_continuousMutex locked.
+// They run in the background of a production job, so they report errors as warnings rather than throwing.
+//
+
+// Add the events recorded since the last call to the statistics of the current interval.
+void ProfilerContinuousAggregate()
+{
+    for (auto& ring : g_continuousState->rings)
+    {
+        unsigned long long head = ring->head.load(std::memory_order_acquire);
+        unsigned long long first = ring->aggregated;
+        if (head - first > ContinuousEventRing::capacity)
+        {
+            g_continuousState->lostEvents += head - first - ContinuousEventRing::capacity;
+            first = head - ContinuousEventRing::capacity;
+        }
+
+        ContinuousEvent event;
+        for (unsigned long long index = first; index < head; index++)
+        {
+            if (!ring->Read(index, event))
+            {
+                g_continuousState->lostEvents++;
+                continue;
+            }
+            auto& stats = g_continuousState->stats[event.eventId];
+            long long ticks = event.endClock - event.beginClock;
+            stats.cnt++;
+            stats.sumTicks += ticks;
+            stats.maxTicks = std::max(ticks, stats.maxTicks);
+            stats.totalBytes += event.bytes;
+        }
+        ring->aggregated = head;
+    }
+}
+
+// Write the events of the last dumpSeconds in the Chrome trace event format, as ProfilerGenerateTraceFile().
+void ProfilerContinuousWriteDump(const char* reason)
+{
+    time_t currentTime;
+    time(&currentTime);
+    wchar_t timeStr[32];
+    wcsftime(timeStr, sizeof(timeStr) / sizeof(timeStr[0]), L"%Y-%m-%d_%H-%M-%S", localtime(&currentTime));
+    std::wstring fileName = g_continuousState->profilerDir + L"/" + std::wstring(timeStr) + L"_" + msra::strfun::utf16(reason) +
+                            L"_trace_" + g_continuousState->logSuffix + L".json";
+
+    FILE* f = _wfopen(fileName.c_str(), L"wt");
+    if (f == NULL)
+    {
+        fprintf(stderr, "Warning: Performance Profiler: Cannot create file <%ls>, the events are not dumped.\n", fileName.c_str());
+        return;
+    }
+
+    int processId = (int)wcstol(g_continuousState->logSuffix.c_str(), nullptr, 10);
+    fprintf(f, "[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Rank %d\"}},\n", processId, processId);
+
+    long long cutoffClock = Clock::GetTimeStamp() - (long long)g_continuousState->dumpSeconds * Clock::GetTicksPerSecond();
+    size_t numEvents = 0;
+    for (const auto& ring : g_continuousState->rings)
+    {
+        unsigned long long head = ring->head.load(std::memory_order_acquire);
+        unsigned long long first = head > ContinuousEventRing::capacity ? head - ContinuousEventRing::capacity : 0;
+        ContinuousEvent event;
+        for (unsigned long long index = first; index < head; index++)
+        {
+            if (!ring->Read(index, event) || event.endClock < cutoffClock)
+                continue;
+
+            double beginMicroseconds = g_continuousState->wallClockOffset + 1000000.0 * TicksToSeconds(event.beginClock);
+            double durationMicroseconds = 1000000.0 * TicksToSeconds(event.endClock - event.beginClock);
+            fprintf(f, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n",
+                c_fixedEvtDesc[event.eventId].eventDescription, processId, ring->threadId, beginMicroseconds, durationMicroseconds);
+            numEvents++;
+        }
+    }
+
+    fclose(f);
+    fprintf(stderr, "Performance Profiler: dumped %d events of the last %d seconds (%s) to <%ls>.\n",
+        (int)numEvents, g_continuousState->dumpSeconds, reason, fileName.c_str());
+}
+
+// Append the summary of the current interval to the summary file, check for a slowdown, and start the next interval.
+void ProfilerContinuousWriteSummary(const long long endClock)
+{
+    std::wstring fileName = g_continuousState->profilerDir + L"/continuous_summary_" + g_continuousState->logSuffix + L".txt";
+    FILE* f = _wfopen(fileName.c_str(), L"at");
+    if (f == NULL)
+        fprintf(stderr, "Warning: Performance Profiler: Cannot open file <%ls>, the summary is not written.\n", fileName.c_str());
+
+    double intervalSeconds = TicksToSeconds(endClock - g_continuousState->intervalBeginClock);
+    if (f)
+    {
+        time_t currentTime;
+        time(&currentTime);
+        char timeStr[32];
+        strftime(timeStr, sizeof(timeStr), "%Y/%m/%d %H:%M:%S", localtime(&currentTime));
+        fprintf(f, "%s: %.1f seconds", timeStr, intervalSeconds);
+        if (g_continuousState->lostEvents > 0)
+            fprintf(f, ", %lld events lost", g_continuousState->lostEvents);
+        fprintf(f, "\n");
+    }
+
+    for (int evtIdx = 0; evtIdx < profilerEvtMax && f; evtIdx++)
+    {
+        const auto& stats = g_continuousState->stats[evtIdx];
+        if (stats.cnt == 0)
+            continue;
+
+        char meanStr[32], maxStr[32];
+        FormatTimeStr(meanStr, sizeof(meanStr), TicksToSeconds(stats.sumTicks) / stats.cnt);
+        FormatTimeStr(maxStr, sizeof(maxStr), TicksToSeconds(stats.maxTicks));
+        fprintf(f, "    %-26s: %10lld %10.2f/s  mean %s  max %s", c_fixedEvtDesc[evtIdx].eventDescription,
+            stats.cnt, stats.cnt / std::max(intervalSeconds, 1e-9), meanStr, maxStr);
+        if (c_fixedEvtDesc[evtIdx].eventType == profilerEvtThroughput && stats.sumTicks > 0)
+        {
+            char throughputStr[32];
+            FormatThroughputStr(throughputStr, sizeof(throughputStr), stats.totalBytes / 1000.0 / TicksToSeconds(stats.sumTicks));
+            fprintf(f, "  %s", throughputStr);
+        }
+        fprintf(f, "\n");
+    }
+
+    if (f)
+        fclose(f);
+
+    // Slowdown detection on the minibatch time. A slowdown is dumped once; the baseline only follows the intervals
+    // without a slowdown, so that it stays the reference until the job recovers.
+    const auto& minibatch = g_continuousState->stats[profilerEvtMainMinibatch];
+    if (g_continuousState->slowdownFactor > 0 && minibatch.cnt > 0)
+    {
+        double minibatchSeconds = TicksToSeconds(minibatch.sumTicks) / minibatch.cnt;
+        double baseline = g_continuousState->baselineMinibatchSeconds;
+        if (baseline > 0 && minibatchSeconds > g_continuousState->slowdownFactor * baseline)
+        {
+            if (!g_continuousState->slowdownDumped)
+            {
+                fprintf(stderr, "Performance Profiler: mean minibatch time %.3f ms is more than %.1f times %.3f ms of the previous intervals.\n",
+                    minibatchSeconds * 1000.0, g_continuousState->slowdownFactor, baseline * 1000.0);
+                ProfilerContinuousWriteDump("slowdown");
+                g_continuousState->slowdownDumped = true;
+            }
+        }
+        else
+        {
+            g_continuousState->baselineMinibatchSeconds = baseline > 0 ? 0.5 * (baseline + minibatchSeconds) : minibatchSeconds;
+            g_continuousState->slowdownDumped = false;
+        }
+    }
+
+    memset(g_continuousState->stats, 0, sizeof(g_continuousState->stats));
+    g_continuousState->lostEvents = 0;
+    g_continuousState->intervalBeginClock = endClock;
+}
+
+void ProfilerContinuousAggregationLoop()
+{
+    std::unique_lock<std::mutex> lock(g_continuousMutex);
+    auto& state = *g_continuousState;
+    while (!state.stop)
+    {
+        // Aggregate every second, so that the ring buffers need only hold a second of events for the summaries
+        state.wakeUp.wait_for(lock, std::chrono::seconds(1));
+        if (state.stop)
+            break;
+
+        ProfilerContinuousAggregate();
+
+        if (g_continuousDumpSignaled)
+        {
+            g_continuousDumpSignaled = 0;
+            ProfilerContinuousWriteDump("signal");
+        }
+
+        long long now = Clock::GetTimeStamp();
+        if (TicksToSeconds(now - state.intervalBeginClock) >= state.summarySeconds)
+            ProfilerContinuousWriteSummary(now);
+    }
+}
+
+
+//
+// Start continuous profiling.
+//
+void PERF_PROFILER_API ProfilerContinuousInit(const std::wstring& profilerDir, const std::wstring& logSuffix,
+    const int summarySeconds, const int dumpSeconds, const double slowdownFactor)
+{
+    std::lock_guard<std::mutex> lock(g_continuousMutex);
+
+    if (g_continuousState != nullptr)
+    {
+        RuntimeError("Error: ProfilerContinuousInit: Continuous profiling already initialized.\n");
+    }
+    if (summarySeconds <= 0 || dumpSeconds <= 0 || slowdownFactor < 0)
+    {
+        InvalidArgument("ProfilerContinuousInit: The summary and dump intervals must be positive, and the slowdown factor must not be negative.");
+    }
+    if (_wmkdir(profilerDir.c_str()) == -1 && errno != EEXIST)
+    {
+        RuntimeError("Error: ProfilerContinuousInit: Cannot create directory <%ls>.\n", profilerDir.c_str());
+    }
+
+    g_continuousState.reset(new ContinuousProfilerState());
+    g_continuousState->profilerDir = profilerDir;
+    g_continuousState->logSuffix = logSuffix;
+    g_continuousState->summarySeconds = summarySeconds;
+    g_continuousState->dumpSeconds = dumpSeconds;
+    g_continuousState->slowdownFactor = slowdownFactor;
+    auto wallClock = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch());
+    g_continuousState->wallClockOffset = (double)wallClock.count() - 1000000.0 * TicksToSeconds(Clock::GetTimeStamp());
+    memset(g_continuousState->stats, 0, sizeof(g_continuousState->stats));
+    g_continuousState->intervalBeginClock = Clock::GetTimeStamp();
+    g_continuousState->lostEvents = 0;
+    g_continuousState->baselineMinibatchSeconds = 0;
+    g_continuousState->slowdownDumped = false;
+    g_continuousState->stop = false;
+    g_continuousState->aggregationThread = std::thread(ProfilerContinuousAggregationLoop);
+
+#ifndef _WIN32
+    g_continuousDumpSignaled = 0;
+    signal(SIGUSR2, ProfilerContinuousSignalHandler);
+#endif
+
+    g_continuousGeneration++;
+    g_continuousEnabled = true;
+}
+
+
+//
+// Write the events of the last dumpSeconds to a timeline file now.
+//
+void PERF_PROFILER_API ProfilerContinuousDump(const char* reason)
+{
+    std::lock_guard<std::mutex> lock(g_continuousMutex);
+
+    if (g_continuousState == nullptr)
+        return;
+
+    ProfilerContinuousWriteDump(reason);
+}
+
+
+//
+// Write the summary of the last (partial) interval and stop continuous profiling.
+//
+void PERF_PROFILER_API ProfilerContinuousClose()
+{
+    g_continuousEnabled = false;
+
+    std::unique_lock<std::mutex> lock(g_continuousMutex);
+    if (g_continuousState == nullptr)
+        return;
+
+#ifndef _WIN32
+    signal(SIGUSR2, SIG_DFL);
+#endif
+
+    g_continuousState->stop = true;
+    g_continuousState->wakeUp.notify_one();
+    lock.unlock();
+    g_continuousState->aggregationThread.join();
+    lock.lock();
+
+    ProfilerContinuousAggregate();
+    ProfilerContinuousWriteSummary(Clock::GetTimeStamp());
+    g_continuousState.reset();
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Utility functions.
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -474,6 +1275,37 @@ void ProfilerGenerateReport(const std::wstring& fileName, struct tm* timeInfo)
                 fprintfOrDie(f, "%s", str);
             }
             break;
+
+        case profilerEvtRatio:
+            if (g_profilerState->fixedEvents[evtIdx].cnt > 0)
+            {
+                printLine = true;
+                fprintfOrDie(f, "%-26s: ", c_fixedEvtDesc[evtIdx].eventDescription);
+
+                char str[32];
+
+                double mean = ((double)g_profilerState->fixedEvents[evtIdx].sum / (double)g_profilerState->fixedEvents[evtIdx].cnt);
+                FormatRatioStr(str, sizeof(str), mean);
+                fprintfOrDie(f, "%s ", str);
+
+                double stdDev = g_profilerState->fixedEvents[evtIdx].sumsq - (pow((double)g_profilerState->fixedEvents[evtIdx].sum, 2.0) / (double)g_profilerState->fixedEvents[evtIdx].cnt);
+                if (stdDev < 0.0) stdDev = 0.0;
+                stdDev = sqrt(stdDev / (double)g_profilerState->fixedEvents[evtIdx].cnt);
+                FormatRatioStr(str, sizeof(str), stdDev);
+                fprintfOrDie(f, "%s ", str);
+
+                FormatRatioStr(str, sizeof(str), (double)g_profilerState->fixedEvents[evtIdx].min);
+                fprintfOrDie(f, "%s ", str);
+
+                FormatRatioStr(str, sizeof(str), (double)g_profilerState->fixedEvents[evtIdx].max);
+                fprintfOrDie(f, "%s ", str);
+
+                fprintfOrDie(f, "%16d ", g_profilerState->fixedEvents[evtIdx].cnt);
+
+                FormatRatioStr(str, sizeof(str), 1000000.0 * g_profilerState->fixedEvents[evtIdx].totalNumerator / g_profilerState->fixedEvents[evtIdx].totalDenominator);
+                fprintfOrDie(f, "%s", str);
+            }
+            break;
         
         case profilerEvtSeparator:
             printLine = true;
@@ -508,6 +1340,11 @@ void FormatThroughputStr(char* str, size_t strLen, double kbps)
     sprintf_s(str, strLen, "%11.3f MBps", kbps / 1000.0);
 }
 
+void FormatRatioStr(char* str, size_t strLen, double ppm)
+{
+    sprintf_s(str, strLen, "%14.2f %%", ppm / 10000.0);
+}
+
 void FormatBytesStr(char* str, size_t strLen, long long bytes)
 {
     // kB = 1024 bytes, MB = 1024*1024 bytes
@@ -555,17 +1392,167 @@ void ProfilerGenerateDetailFile(const std::wstring& fileName)
 }
 
 
+//
+// Generate timeline in the Chrome trace event format.
+//
+void ProfilerGenerateTraceFile(const std::wstring& fileName)
+{
+    FILE* f = _wfopen(fileName.c_str(), L"wt");
+    if (f == NULL)
+    {
+        RuntimeError("Error: ProfilerGenerateTraceFile: Cannot create file <%ls>.\n", fileName.c_str());
+    }
+
+    // One process per rank (the log suffix is the rank in distributed jobs)
+    int processId = (int)wcstol(g_profilerState->logSuffix.c_str(), nullptr, 10);
+
+    fprintfOrDie(f, "[\n");
+    fprintfOrDie(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Rank %d\"}},\n", processId, processId);
+    fprintfOrDie(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"Main Thread\"}},\n", processId, g_profilerState->mainThreadId);
+
+    char* eventPtr = g_profilerState->customEventBuffer.get();
+    std::string name;
+    while (eventPtr < (g_profilerState->customEventBuffer.get() + g_profilerState->customEventOffset))
+    {
+        char* descriptionStr = eventPtr;
+        eventPtr += strlen(descriptionStr) + 1;
+
+        CustomEventRecord* eventRecord = (CustomEventRecord*)eventPtr;
+        eventPtr += sizeof(CustomEventRecord);
+
+        // Escape the description for a JSON string
+        name.clear();
+        for (const char* c = descriptionStr; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                name.push_back('\\');
+            name.push_back(*c);
+        }
+
+        double beginMicroseconds = g_profilerState->wallClockOffset + 1000000.0 * TicksToSeconds(eventRecord->beginClock);
+        double durationMicroseconds = 1000000.0 * TicksToSeconds(eventRecord->endClock - eventRecord->beginClock);
+        fprintfOrDie(f, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n",
+            name.c_str(), processId, eventRecord->threadId, beginMicroseconds, durationMicroseconds);
+    }
+
+    fclose(f);
+}
+
+
+//
+// Append a node summary to the node report: the time, estimated throughput and memory, per operation type
+// and for the most expensive nodes, in descending order of time.
+//
+void ProfilerGenerateNodeReport(const std::wstring& fileName, const std::string& title)
+{
+    const size_t maxNodesInReport = 20;
+
+    struct Line
+    {
+        std::wstring    description;
+        std::wstring    operationName;  // (nodes only)
+        NodeEventRecord record;
+        int             nodeCnt;
+    };
+
+    // Accumulate the records of the nodes per operation type
+    std::map<std::wstring, Line> operations;
+    std::vector<Line> nodes;
+    double totalSeconds = 0.0;
+    for (const auto& nodeEvent : g_profilerState->nodeEvents)
+    {
+        const auto& record = nodeEvent.second;
+        auto& operation = operations[record.operationName];
+        operation.description = record.operationName;
+        operation.record.forwardCnt += record.forwardCnt;
+        operation.record.backwardCnt += record.backwardCnt;
+        operation.record.forwardSeconds += record.forwardSeconds;
+        operation.record.backwardSeconds += record.backwardSeconds;
+        operation.record.flops += record.flops;
+        operation.record.bytes += record.bytes;
+        operation.nodeCnt++;
+
+        nodes.push_back(Line{ nodeEvent.first, record.operationName, record, 1 });
+        totalSeconds += record.forwardSeconds + record.backwardSeconds;
+    }
+
+    std::vector<Line> lines;
+    for (const auto& operation : operations)
+        lines.push_back(operation.second);
+
+    auto byTime = [](const Line& a, const Line& b)
+    {
+        return (a.record.forwardSeconds + a.record.backwardSeconds) > (b.record.forwardSeconds + b.record.backwardSeconds);
+    };
+    std::sort(lines.begin(), lines.end(), byTime);
+    std::sort(nodes.begin(), nodes.end(), byTime);
+    if (nodes.size() > maxNodesInReport)
+        nodes.resize(maxNodesInReport);
+
+    FILE* f = _wfopen(fileName.c_str(), L"at");
+    if (f == NULL)
+    {
+        RuntimeError("Error: ProfilerGenerateNodeReport: Cannot open file <%ls>.\n", fileName.c_str());
+    }
+
+    auto printLine = [&](const Line& line, bool isNode)
+    {
+        char str[32];
+        fprintfOrDie(f, "%-26ls: ", line.description.c_str());
+
+        FormatTimeStr(str, sizeof(str), line.record.forwardSeconds);
+        fprintfOrDie(f, "%s ", str);
+        FormatTimeStr(str, sizeof(str), line.record.backwardSeconds);
+        fprintfOrDie(f, "%s ", str);
+
+        double seconds = line.record.forwardSeconds + line.record.backwardSeconds;
+        FormatRatioStr(str, sizeof(str), totalSeconds > 0.0 ? 1000000.0 * seconds / totalSeconds : 0.0);
+        fprintfOrDie(f, "%s ", str);
+
+        fprintfOrDie(f, "%16.3f ", seconds > 0.0 ? line.record.flops / seconds / 1e9 : 0.0);
+
+        FormatBytesStr(str, sizeof(str), line.record.bytes);
+        fprintfOrDie(f, "%s ", str);
+
+        fprintfOrDie(f, "%16d ", line.record.forwardCnt + line.record.backwardCnt);
+        if (isNode)
+            fprintfOrDie(f, "%ls\n", line.operationName.c_str());
+        else
+            fprintfOrDie(f, "%16d\n", line.nodeCnt);
+    };
+
+    fprintfOrDie(f, "CNTK Performance Profiler Node Report: %s\n\n", title.c_str());
+
+    fprintfOrDie(f, "Operation.................. ....Forward Time ...Backward Time ...........Share .........GFLOP/s ..........Memory ...........Count ...........Nodes\n\n");
+    for (const auto& line : lines)
+        printLine(line, /*isNode=*/false);
+
+    fprintfOrDie(f, "\nNode....................... ....Forward Time ...Backward Time ...........Share .........GFLOP/s ..........Memory ...........Count Operation\n\n");
+    for (const auto& line : nodes)
+        printLine(line, /*isNode=*/true);
+
+    fprintfOrDie(f, "\n\n");
+    fclose(f);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Scoped helpers.
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void ProfilerContext::Init(const std::wstring& profilerDir, const unsigned long long customEventBufferBytes, const std::wstring& logSuffix, const bool syncGpu)
+void ProfilerContext::Init(const std::wstring& profilerDir, const unsigned long long customEventBufferBytes, const std::wstring& logSuffix, const bool syncGpu, const bool profileNodes)
+{
+    ProfilerInit(profilerDir, customEventBufferBytes, logSuffix, syncGpu, profileNodes);
+}
+
+void ProfilerContext::InitContinuous(const std::wstring& profilerDir, const std::wstring& logSuffix, const int summarySeconds, const int dumpSeconds, const double slowdownFactor)
 {
-    ProfilerInit(profilerDir, customEventBufferBytes, logSuffix, syncGpu);
+    ProfilerContinuousInit(profilerDir, logSuffix, summarySeconds, dumpSeconds, slowdownFactor);
 }
 
 ProfilerContext::~ProfilerContext()
 {
+    ProfilerContinuousClose();
     ProfilerClose();
 }
 
@@ -574,17 +1561,24 @@ ScopeProfile::ScopeProfile(int eventId)
 {
     m_eventId = eventId;
     m_description = nullptr;
+    m_rangePushed = ProfilerRangePush(eventId);
     m_stateId = ProfilerTimeBegin();
 }
 
 ScopeProfile::ScopeProfile(const char* description)
 {
     m_description = description;
+    m_rangePushed = ProfilerRangePush(description);
     m_stateId = ProfilerTimeBegin();
 }
 
 ScopeProfile::~ScopeProfile()
 {
+    if (m_rangePushed)
+    {
+        ProfilerRangePop();
+    }
+
     if (m_description)
     {
         ProfilerTimeEnd(m_stateId, m_description);
@@ -596,6 +1590,20 @@ ScopeProfile::~ScopeProfile()
 }
 
 
+ScopeRange::ScopeRange(const char* description)
+{
+    m_rangePushed = ProfilerRangePush(description);
+}
+
+ScopeRange::~ScopeRange()
+{
+    if (m_rangePushed)
+    {
+        ProfilerRangePop();
+    }
+}
+
+
 ScopeThroughput::ScopeThroughput(int eventId, long long bytes)
 {
     m_bytes = bytes;
@@ -26,6 +26,31 @@
 // and ProfilerThroughputEnd() calls should be used. The throughput APIs can only be used
 // with fixed events.
 //
+// When node profiling is turned on in ProfilerInit(), the forward and backward passes of each
+// node of a network are timed with ProfilerNodeBegin() and ProfilerNodeEnd(), and summarized per
+// operation type by ProfilerNodeSummary().
+//
+// For the timelines of NVIDIA Nsight Systems, NVTX ranges can be pushed around sections of code
+// with ProfilerRangePush() and ProfilerRangePop(), or the scoped object ScopeRange, once they have
+// been turned on with ProfilerEnableNvtx(). ScopeProfile also pushes a range. This is independent
+// of ProfilerInit(). When NVTX ranges are off, these calls only check a flag.
+//
+// At the time when the profiler is torn down, a timeline of all the recorded time events is also written
+// in the Chrome trace event format (open it in chrome://tracing). There is one process per rank, and one
+// row per thread. Timestamps are wall-clock microseconds, so the files of the ranks of a distributed job
+// can be merged: each file is a JSON array that is left open, with one event per line, and the files can
+// be concatenated after removing the first line ("[") of all but the first of them.
+//
+// Continuous profiling
+//
+// For production jobs, ProfilerContinuousInit() turns on a mode that is independent of ProfilerInit() and
+// ProfilerEnable(). The fixed time and throughput events are recorded, without GPU sync and without a lock,
+// into a ring buffer per thread that keeps the most recent events. A background thread aggregates them into a
+// summary of the count, rate, mean and max time of each event per interval (a minute by default), which is
+// appended to a text file. The events of the last seconds still in the ring buffers are written as a timeline
+// (see below) by ProfilerContinuousDump(), when the process receives SIGUSR2 (not on Windows), and when the
+// mean minibatch time of an interval exceeds that of the previous intervals by a given factor.
+//
 // CNTK specifics
 //
 // The profiler is turned off during the very first epoch to avoid polluting profile data with
@@ -73,6 +98,25 @@ enum ProfilerEvents
 
     // Data reader events
     profilerEvtPrefetchMinibatch,           // Prefetching the next minibatch in a background thread
+    profilerEvtChunkWait,                   // Waiting for a data chunk that has not been prefetched (yet)
+    profilerEvtChunkLoad,                   // Loading a data chunk from the deserializer (in a prefetch thread, or when waiting)
+    profilerEvtInputTransferExposed,        // Fraction of the time of the input copies to the GPU that the computation waited for
+    // Recurrent networks header (dummy events)
+    profilerSepSpace3,
+    profilerSepRecurrent,
+    profilerSepSpace4,
+    // Recurrent networks events
+    profilerEvtRNNPackSequences,            // Packing the sequences of an OptimizedRNNStack for cuDNN and unpacking the result
+    profilerEvtRNNPaddingEfficiency,        // Fraction of the columns of an OptimizedRNNStack minibatch that are not gaps
+    // Communication header (dummy events)
+    profilerSepSpace5,
+    profilerSepCommunication,
+    profilerSepSpace6,
+    // Communication events
+    profilerEvtMPIAllReduce,                // Blocking MPI all-reduce
+    profilerEvtMPIWait,                     // Waiting for asynchronous MPI all-reduces to complete
+    profilerEvtNcclAllReduce,               // Launching NCCL all-reduces (they run asynchronously on the GPU)
+    profilerEvtNcclSync,                    // Waiting for the NCCL all-reduces to complete
 
     profilerEvtMax
 };
@@ -84,9 +128,10 @@ enum ProfilerEvents
 // customEventBufferBytes: Bytes to allocate for the custom event buffer.
 // logSuffix: Suffix string to append to log files.
 // syncGpu: Wait for GPU to complete processing for each profiling event.
+// profileNodes: Time the forward and backward pass of each node of the network.
 //
 void PERF_PROFILER_API ProfilerInit(const std::wstring& profilerDir, const unsigned long long customEventBufferBytes,
-    const std::wstring& logSuffix, const bool syncGpu);
+    const std::wstring& logSuffix, const bool syncGpu, const bool profileNodes = false);
 
 
 //
@@ -122,18 +167,83 @@ long long PERF_PROFILER_API ProfilerThroughputBegin();
 void PERF_PROFILER_API ProfilerThroughputEnd(const long long stateId, const int eventId, const long long bytes);
 
 
+//
+// Record a ratio, e.g. the fraction of useful work. The report shows the statistics of the
+// recorded ratios, and as the total the ratio of the sums of all numerators and denominators.
+// Can only be used with fixed events.
+//
+void PERF_PROFILER_API ProfilerRatio(const int eventId, const long long numerator, const long long denominator);
+
+//
+// Measure the forward or backward pass of a node of the network.
+// ProfilerNodeBegin() returns a stateId that is passed to ProfilerNodeEnd(), or -1 if node profiling is
+// off, in which case ProfilerNodeEnd() need not be called. On the GPU (deviceId >= 0), the time is measured
+// with CUDA events recorded on the default stream. The GPU is not synced; the events are read once they
+// have completed, at the latest in ProfilerNodeSummary().
+// flops: Estimated number of floating point operations of the pass.
+// bytes: Memory allocated for the node.
+//
+long long PERF_PROFILER_API ProfilerNodeBegin(const int deviceId);
+void PERF_PROFILER_API ProfilerNodeEnd(const long long stateId, const std::wstring& nodeName, const std::wstring& operationName,
+    const bool backprop, const double flops, const long long bytes);
+
+//
+// Append the summary of the node events recorded since the last call, per operation type and for the
+// most expensive nodes, to the node report, and reset them. This is typically called at the end of an epoch.
+//
+void PERF_PROFILER_API ProfilerNodeSummary(const std::string& title);
+
 //
 // Generate reports and release all resources.
 //
 void PERF_PROFILER_API ProfilerClose();
 
 
+//
+// Start continuous profiling.
+// profilerDir: Directory where the summaries and the timeline dumps will be saved.
+// logSuffix: Suffix string to append to the file names.
+// summarySeconds: Interval of the summaries.
+// dumpSeconds: How many of the most recent seconds of events a dump contains (as far as they are still in the ring buffers).
+// slowdownFactor: Dump when the mean minibatch time of an interval is this many times that of the previous intervals; 0 is off.
+//
+void PERF_PROFILER_API ProfilerContinuousInit(const std::wstring& profilerDir, const std::wstring& logSuffix,
+    const int summarySeconds = 60, const int dumpSeconds = 30, const double slowdownFactor = 0);
+
+//
+// Write the events of the last dumpSeconds to a timeline file now. reason is recorded in the file name.
+//
+void PERF_PROFILER_API ProfilerContinuousDump(const char* reason);
+
+//
+// Write the summary of the last (partial) interval and stop continuous profiling.
+//
+void PERF_PROFILER_API ProfilerContinuousClose();
+
+
+//
+// Turn NVTX ranges on or off. Turning them on loads the NVTX library (nvToolsExt); returns false,
+// and leaves them off, if it cannot be loaded.
+//
+bool PERF_PROFILER_API ProfilerEnableNvtx(bool enable);
+bool PERF_PROFILER_API ProfilerNvtxEnabled();
+
+//
+// Push and pop a (nested) NVTX range, if NVTX ranges are on.
+// ProfilerRangePush() returns whether the range was pushed; only then ProfilerRangePop() is to be called.
+//
+bool PERF_PROFILER_API ProfilerRangePush(const char* description);
+bool PERF_PROFILER_API ProfilerRangePush(const int eventId);
+void PERF_PROFILER_API ProfilerRangePop();
+
+
 //
 // Scoped profiler instantiation.
 //
 struct PERF_PROFILER_API ProfilerContext
 {
-    void Init(const std::wstring& profilerDir = L"", const unsigned long long customEventBufferBytes = (32 * 1024 * 1024), const std::wstring& logSuffix = L"", const bool syncGpu = false);
+    void Init(const std::wstring& profilerDir = L"", const unsigned long long customEventBufferBytes = (32 * 1024 * 1024), const std::wstring& logSuffix = L"", const bool syncGpu = false, const bool profileNodes = false);
+    void InitContinuous(const std::wstring& profilerDir, const std::wstring& logSuffix, const int summarySeconds = 60, const int dumpSeconds = 30, const double slowdownFactor = 0);
     ~ProfilerContext();
 };
 
@@ -151,12 +261,26 @@ private:
     unsigned long long  m_stateId;
     int                 m_eventId;
     const char*         m_description;
+    bool                m_rangePushed;
 };
 
 #define PROFILE_SCOPE(eventId)      ScopeProfile __sp##eventId(eventId);
 #define PROFILE_FUNCTION            ScopeProfile __fsp(__FUNCTION__);
 
 
+//
+// Scoped NVTX range.
+//
+struct PERF_PROFILER_API ScopeRange
+{
+    ScopeRange(const char* description);
+    ~ScopeRange();
+
+private:
+    bool                m_rangePushed;
+};
+
+
 
 //
 // Scoped throughput profiling.
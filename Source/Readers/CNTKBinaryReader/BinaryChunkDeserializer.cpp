@@ -19,7 +19,7 @@ enum class MatrixEncodingType : unsigned char
 {
     dense = 0,
     sparse_csc = 1,
-    // TODO: compressed_sparse_csc = 2, // indices are encoded as var-ints
+    compressed_sparse_csc = 2, // indices are delta and var-int encoded
 };
 
 
@@ -70,6 +70,9 @@ BinaryChunkDeserializer::BinaryChunkDeserializer(const BinaryConfigHelper& helpe
     SetTraceLevel(helper.GetTraceLevel());
 
     Initialize(helper.GetRename(), helper.GetElementType());
+
+    if (helper.ShouldUseMemoryMapping())
+        MapFile();
 }
 
 
@@ -130,6 +133,8 @@ void BinaryChunkDeserializer::Initialize(const std::map<std::wstring, std::wstri
             m_deserializers[i] = make_shared<DenseBinaryDataDeserializer>(m_file, precision);
         else if (type == MatrixEncodingType::sparse_csc)
             m_deserializers[i] = make_shared<SparseBinaryDataDeserializer>(m_file, precision);
+        else if (type == MatrixEncodingType::compressed_sparse_csc)
+            m_deserializers[i] = make_shared<CompressedSparseBinaryDataDeserializer>(m_file, precision);
         else
             RuntimeError("Unknown encoding type %u requested.", (unsigned int)type);
 
@@ -178,10 +183,17 @@ void BinaryChunkDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, std::ve
     auto numberOfSequences = m_chunkTable->GetNumSequences(chunkId);
     unique_ptr<uint32_t[]> numSamplesPerSequence(new uint32_t[numberOfSequences]);
 
-    // Seek to the start of the chunk
-    CNTKBinaryFileHelper::SeekOrDie(m_file, offset, SEEK_SET);
-    // read 'numberOfSequences' unsigned ints
-    CNTKBinaryFileHelper::ReadOrDie(numSamplesPerSequence.get(), sizeof(uint32_t), numberOfSequences, m_file);
+    if (m_mappedFile)
+    {
+        memcpy(numSamplesPerSequence.get(), m_mappedFile->Data(offset, sizeof(uint32_t) * numberOfSequences), sizeof(uint32_t) * numberOfSequences);
+    }
+    else
+    {
+        // Seek to the start of the chunk
+        CNTKBinaryFileHelper::SeekOrDie(m_file, offset, SEEK_SET);
+        // read 'numberOfSequences' unsigned ints
+        CNTKBinaryFileHelper::ReadOrDie(numSamplesPerSequence.get(), sizeof(uint32_t), numberOfSequences, m_file);
+    }
 
     auto startId = m_chunkTable->GetStartIndex(chunkId);
     for (decltype(numberOfSequences) i = 0; i < numberOfSequences; i++)
@@ -216,8 +228,27 @@ unique_ptr<byte[]> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
 }
 
 
+void BinaryChunkDeserializer::MapFile()
+{
+    m_mappedFile = make_shared<MappedFile>(m_filename);
+
+    if (m_traceLevel > 0)
+        fprintf(stderr, "BinaryChunkDeserializer: mapped '%ls' (%" PRIu64 " bytes) into memory.\n", m_filename.c_str(), m_mappedFile->Size());
+}
+
 ChunkPtr BinaryChunkDeserializer::GetChunk(ChunkIdType chunkId)
 {
+    if (m_mappedFile)
+    {
+        // No need to read anything, the chunk data is used directly from the mapping. The randomizer requests the chunks
+        // of its window ahead of their use (and prefetches the next one), so this is where the OS is asked to page in
+        // the chunk, while the pages of released chunks are dropped again (see ~BinaryDataChunk()).
+        auto offset = m_chunkTable->GetDataStartOffset(chunkId);
+        auto size = m_chunkTable->GetChunkSize(chunkId);
+        m_mappedFile->WillNeed(offset, size);
+        return make_shared<BinaryDataChunk>(chunkId, m_chunkTable->GetNumSequences(chunkId), m_mappedFile, offset, size, m_deserializers);
+    }
+
     // Read the chunk into memory
     unique_ptr<byte[]> buffer = ReadChunk(chunkId);
 
@@ -108,6 +108,9 @@ private:
     // Reads a chunk from disk into buffer
     unique_ptr<byte[]> ReadChunk(ChunkIdType chunkId);
 
+    // Maps the input file into memory; from then on chunks point into the mapping instead of being read.
+    void MapFile();
+
     BinaryChunkDeserializer(const wstring& filename);
 
     void SetTraceLevel(unsigned int traceLevel);
@@ -115,6 +118,7 @@ private:
 private:
     const wstring m_filename;
     FILE* m_file;
+    shared_ptr<MappedFile> m_mappedFile; // (only when memory mapping is used)
 
     int64_t m_headerOffset, m_chunkTableOffset;
 
@@ -34,6 +34,8 @@ public:
 
     bool ShouldKeepDataInMemory() const { return m_keepDataInMemory; }
 
+    bool ShouldUseMemoryMapping() const { return m_useMemoryMapping; }
+
     DataType GetElementType() const { return m_elementType; }
 
     DISABLE_COPY_AND_MOVE(BinaryConfigHelper);
@@ -48,6 +50,7 @@ private:
     bool m_sampleBasedRandomizationWindow;
     unsigned int m_traceLevel;
     bool m_keepDataInMemory; // if true the whole dataset is kept in memory
+    bool m_useMemoryMapping; // if true the file is mapped into memory, and chunks are not read but point into the mapping
 };
 
 }
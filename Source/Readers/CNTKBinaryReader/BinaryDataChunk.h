@@ -23,16 +23,42 @@ public:
         : m_chunkId(chunkId),
         m_numSequences(numSequences), 
         m_buffer(std::move(buffer)), 
+        m_chunkData(m_buffer.get()),
+        m_dataOffset(0),
+        m_dataSize(0),
         m_deserializers(deserializer)
-    { }
+    {
+        ParseChunk();
+    }
+
+    // Chunk whose data is 'size' bytes at 'offset' in the mapped file. The sequences point directly into the mapping.
+    explicit BinaryDataChunk(ChunkIdType chunkId,
+        size_t numSequences,
+        shared_ptr<MappedFile> mappedFile,
+        int64_t offset,
+        uint64_t size,
+        std::vector<BinaryDataDeserializerPtr> deserializer)
+        : m_chunkId(chunkId),
+        m_numSequences(numSequences),
+        m_mappedFile(mappedFile),
+        m_chunkData(mappedFile->Data(offset, size)),
+        m_dataOffset(offset),
+        m_dataSize(size),
+        m_deserializers(deserializer)
+    {
+        ParseChunk();
+    }
+
+    ~BinaryDataChunk()
+    {
+        // The pages of mapped data are not needed anymore once the chunk is released by the randomizer.
+        if (m_mappedFile)
+            m_mappedFile->DontNeed(m_dataOffset, m_dataSize);
+    }
 
     // Gets a sequence using its index inside the chunk.
     void GetSequence(size_t sequenceIdx, std::vector<SequenceDataPtr>& result) override
     {
-        // Check if we've already parsed the chunk. If not, parse it.
-        if (m_data.size() == 0)
-            ParseChunk();
-
         assert(m_data.size() != 0);
 
         // resize the output to have the same dimensionality
@@ -51,6 +77,9 @@ public:
     }
 
 protected:
+    // Parses the chunk when it is created, rather than on the first sequence requested, so that the values that have
+    // to be converted or decoded are so in the thread that loads (or prefetches) the chunk, and not concurrently
+    // by the threads that get its sequences.
     void ParseChunk()
     {
         m_data.resize(m_deserializers.size());
@@ -59,7 +88,7 @@ protected:
         size_t bytesProcessed = 0;
         // Now call all of the deserializers on the chunk, in order
         for (size_t i = 0; i < m_deserializers.size(); i++)
-            bytesProcessed += m_deserializers[i]->GetSequenceDataForChunk(m_numSequences, m_buffer.get() + bytesProcessed, m_data[i]);
+            bytesProcessed += m_deserializers[i]->GetSequenceDataForChunk(m_numSequences, m_chunkData + bytesProcessed, m_data[i]);
     }
 
     // chunk id (copied from the descriptor)
@@ -72,11 +101,18 @@ protected:
     // This is the actual chunk read from disk. We will call back to the deserializer for it to be deserialized
     unique_ptr<byte[]> m_buffer;
 
+    // Alternatively, the file the chunk is mapped from (kept alive while the chunk's sequences are in use).
+    shared_ptr<MappedFile> m_mappedFile;
+
+    // The chunk data, either m_buffer or within the mapped file, and for the latter its location in the file.
+    const byte* m_chunkData;
+    int64_t m_dataOffset;
+    uint64_t m_dataSize;
+
     // This is the deserializer who knows how to interpret the m_data chunk that we read in
     std::vector<BinaryDataDeserializerPtr> m_deserializers;
     
-    // The parsed data. We will parse each chunk once, and store the data here. 
-    // If we want to delay parsing, we will add that later as/if needed.
+    // The parsed data. We will parse each chunk once, and store the data here.
     std::vector<std::vector<SequenceDataPtr>> m_data;
 };
 
@@ -10,6 +10,7 @@
 #include "CorpusDescriptor.h"
 #include "BinaryDataChunk.h"
 #include "FileHelper.h"
+#include "half.hpp"
 
 namespace CNTK {
 
@@ -27,6 +28,7 @@ public:
         if (precision != DataType::Float && precision != DataType::Double)
             LogicError("Unsupported precision type %u.", (unsigned int)precision);
 
+        // (half precision values are converted to the precision when the chunk is read)
         if ((m_dataType == ReaderDataType::tfloat && precision != DataType::Float) ||
             (m_dataType == ReaderDataType::tdouble && precision != DataType::Double))
             LogicError("Unsupported combination of the input data type %u and precision %u. "
@@ -35,7 +37,9 @@ public:
         m_precision = precision;
     }
 
-    virtual size_t GetSequenceDataForChunk(size_t numSequences, void* data, std::vector<SequenceDataPtr>& result) = 0;
+    // Creates the sequences of 'numSequences' from 'data', which point into 'data' (i.e. the data is not copied and
+    // has to outlive them); returns the number of bytes consumed.
+    virtual size_t GetSequenceDataForChunk(size_t numSequences, const void* data, std::vector<SequenceDataPtr>& result) = 0;
 
     virtual StorageFormat GetStorageFormat() = 0;
 
@@ -60,7 +64,9 @@ public:
             return sizeof(float);
         if (m_dataType == ReaderDataType::tdouble)
             return sizeof(double);
-        
+        if (m_dataType == ReaderDataType::tfloat16)
+            return sizeof(uint16_t);
+
         LogicError("Unsupported input data type %u.", (unsigned int)m_dataType);
     }
 
@@ -70,9 +76,10 @@ protected:
     {
         tfloat = 0,
         tdouble = 1,
+        tfloat16 = 2, // IEEE half precision, converted to the precision when read
         // TODO: 
-        // tbool = 2, 1 bit per value (one-hot data)
-        // tbyte = 3, 1 byte per value
+        // tbool = 3, 1 bit per value (one-hot data)
+        // tbyte = 4, 1 byte per value
     };
 
     virtual ~BinaryDataDeserializer() = default;
@@ -90,7 +97,7 @@ protected:
     void ReadDataType(FILE* file)
     {
         CNTKBinaryFileHelper::ReadOrDie(&m_dataType, sizeof(m_dataType), 1, file);
-        if (m_dataType> ReaderDataType::tdouble)
+        if (m_dataType > ReaderDataType::tfloat16)
             RuntimeError("Unsupported input data type %u.", (unsigned int)m_dataType);
     }
 
@@ -99,6 +106,35 @@ protected:
         CNTKBinaryFileHelper::ReadOrDie(&m_sampleDimension, sizeof(m_sampleDimension), 1, file);
     }
 
+    // Size of a value in the precision of the stream (i.e. after it is read).
+    size_t SizeOfPrecision()
+    {
+        return m_precision == DataType::Float ? sizeof(float) : sizeof(double);
+    }
+
+    // Returns whether the values are stored in a different type than the precision, and so have to be converted
+    // (rather than being used in place).
+    bool ValuesNeedConversion()
+    {
+        return m_dataType == ReaderDataType::tfloat16;
+    }
+
+    // Converts 'count' stored values from 'source' into values of the precision in 'target'.
+    void ConvertValues(const char* source, size_t count, std::vector<char>& target)
+    {
+        target.resize(count * SizeOfPrecision());
+        for (size_t i = 0; i < count; i++)
+        {
+            uint16_t bits;
+            memcpy(&bits, source + i * sizeof(uint16_t), sizeof(bits));
+            float value = Microsoft::MSR::CNTK::half::FromBits(bits);
+            if (m_precision == DataType::Float)
+                ((float*)target.data())[i] = value;
+            else
+                ((double*)target.data())[i] = value;
+        }
+    }
+
     struct DenseInputStreamBuffer : DenseSequenceData
     {
         const void* GetDataBuffer() override
@@ -111,9 +147,10 @@ protected:
             return m_sampleShape;
         }
 
-        void* m_data;
+        const void* m_data;
         DataType m_dataType;
         NDShape m_sampleShape;
+        std::vector<char> m_convertedData; // (only when the stored values are converted)
     };
 
     struct SparseInputStreamBuffer : SparseSequenceData
@@ -133,8 +170,10 @@ protected:
             return m_sampleShape;
         }
 
-        void* m_data;
+        const void* m_data;
         NDShape m_sampleShape;
+        std::vector<char> m_convertedData;      // (only when the stored values are converted)
+        std::vector<IndexType> m_decodedIndices;  // (only when the indices are not used in place)
     };
 
     DataType m_precision;
@@ -152,7 +191,7 @@ public:
 
     virtual  StorageFormat GetStorageFormat() override { return StorageFormat::Dense; }
 
-    size_t GetSequenceDataForChunk(size_t numSequences, void* data, std::vector<SequenceDataPtr>& result)
+    size_t GetSequenceDataForChunk(size_t numSequences, const void* data, std::vector<SequenceDataPtr>& result) override
     {
         size_t valueSize = SizeOfDataType();
         result.resize(numSequences);
@@ -160,13 +199,20 @@ public:
         for (size_t i = 0; i < numSequences; i++)
         {
             shared_ptr<DenseInputStreamBuffer> sequenceDataPtr = make_shared<DenseInputStreamBuffer>();
-            sequenceDataPtr->m_numberOfSamples = *(uint32_t*)((char*)data + offset);
+            sequenceDataPtr->m_numberOfSamples = *(const uint32_t*)((const char*)data + offset);
             offset += sizeof(uint32_t);
-            sequenceDataPtr->m_data = (char*)data + offset;
+            size_t numValues = m_sampleDimension * sequenceDataPtr->m_numberOfSamples;
+            if (ValuesNeedConversion())
+            {
+                ConvertValues((const char*)data + offset, numValues, sequenceDataPtr->m_convertedData);
+                sequenceDataPtr->m_data = sequenceDataPtr->m_convertedData.data();
+            }
+            else
+                sequenceDataPtr->m_data = (const char*)data + offset;
             sequenceDataPtr->m_sampleShape = GetSampleShape();
             sequenceDataPtr->m_elementType = m_precision;
             result[i]  = sequenceDataPtr;
-            offset += m_sampleDimension * valueSize * sequenceDataPtr->m_numberOfSamples;
+            offset += valueSize * numValues;
         }
 
         return offset;
@@ -191,17 +237,17 @@ public:
     // sequence[numSequences], where each sequence consists of:
     //   uint32_t: numSamples
     //   uint32_t: nnz for the sequence
-    //   ElemType[nnz]: the values for the sparse sequences
+    //   ElemType[nnz]: the values for the sparse sequences (of the data type of the stream)
     //   int32_t[nnz]: the row offsets for the sparse sequences
     //   int32_t[numSamples]: sizes (nnz counts) for each sample in the sequence
-    size_t GetSequenceDataForChunk(size_t numSequences, void* data, std::vector<SequenceDataPtr>& result)
+    size_t GetSequenceDataForChunk(size_t numSequences, const void* data, std::vector<SequenceDataPtr>& result) override
     {
         size_t offset = 0;
         result.resize(numSequences);
         for (size_t i = 0; i < numSequences; i++)
         {
             shared_ptr<SparseInputStreamBuffer> sequenceDataPtr = make_shared<SparseInputStreamBuffer>();
-            offset += GetSequenceData((char*)data + offset, sequenceDataPtr);
+            offset += GetSequenceData((const char*)data + offset, sequenceDataPtr);
             sequenceDataPtr->m_sampleShape = GetSampleShape();
             sequenceDataPtr->m_elementType = m_precision;
             result[i] = sequenceDataPtr;
@@ -210,42 +256,132 @@ public:
         return offset;
     }
 
-    size_t GetSequenceData(void* data, shared_ptr<SparseInputStreamBuffer>& sequence)
+    virtual size_t GetSequenceData(const void* data, shared_ptr<SparseInputStreamBuffer>& sequence)
     {
-        size_t valueSize = SizeOfDataType();
-        size_t offset = 0;
+        size_t offset = ReadSequenceHeader(data, sequence);
+
+        // the rest of this sequence
+        // Since we're not templating on ElemType, we use void for the values. Note that this is the only place
+        // this deserializer uses ElemType, the rest are int32_t for this deserializer.
+        // The data is already properly packed, so just use it.
+        offset += ReadValues((const char*)data + offset, sequence);
+
+        // The indices are supposed to be correctly packed (i.e., in increasing order)
+        // (following half precision values, they may not be aligned, and are copied instead)
+        if (ValuesNeedConversion())
+        {
+            sequence->m_decodedIndices.resize(sequence->m_totalNnzCount);
+            memcpy(sequence->m_decodedIndices.data(), (const char*)data + offset, sizeof(int32_t) * sequence->m_totalNnzCount);
+            sequence->m_indices = sequence->m_decodedIndices.data();
+        }
+        else
+            sequence->m_indices = (int32_t*)((const char*)data + offset);
+        offset += sizeof(int32_t) * sequence->m_totalNnzCount;
+
+        offset += ReadNnzCounts((const char*)data + offset, sequence);
+        return offset;
+    }
+
+protected:
+    // Reads the number of samples and the total nnz count of the sequence; returns the number of bytes consumed.
+    size_t ReadSequenceHeader(const void* data, shared_ptr<SparseInputStreamBuffer>& sequence)
+    {
+        uint32_t header[2];
+        memcpy(header, data, sizeof(header));
 
         // The very first value in the buffer is the number of samples in this sequence.
-        sequence->m_numberOfSamples = *(uint32_t*)data;
-        offset += sizeof(uint32_t);
+        sequence->m_numberOfSamples = header[0];
 
         // Next is the total number of elements in all of the samples.
-        uint32_t nnz = *(uint32_t*)((char*)data + offset);
+        uint32_t nnz = header[1];
         if (IndexType(nnz) < 0) 
         {
             RuntimeError("NNZ count is too large for an IndexType value.");
         }
         sequence->m_totalNnzCount = nnz;
-        offset += sizeof(uint32_t);
+        return sizeof(header);
+    }
 
-        // the rest of this sequence
-        // Since we're not templating on ElemType, we use void for the values. Note that this is the only place
-        // this deserializer uses ElemType, the rest are int32_t for this deserializer.
-        // The data is already properly packed, so just use it.
-        sequence->m_data = (char*)data + offset;
-        offset += valueSize * sequence->m_totalNnzCount;
+    size_t ReadValues(const char* data, shared_ptr<SparseInputStreamBuffer>& sequence)
+    {
+        if (ValuesNeedConversion())
+        {
+            ConvertValues(data, sequence->m_totalNnzCount, sequence->m_convertedData);
+            sequence->m_data = sequence->m_convertedData.data();
+        }
+        else
+            sequence->m_data = data;
+        return SizeOfDataType() * sequence->m_totalNnzCount;
+    }
 
-        // The indices are supposed to be correctly packed (i.e., in increasing order)
-        sequence->m_indices = (int32_t*)((char*)data + offset);
-        offset += sizeof(int32_t) * sequence->m_totalNnzCount;
-        
-        int32_t* begin = (int32_t*)((char*)data + offset);
-        offset += sizeof(int32_t) * sequence->m_numberOfSamples;
-        int32_t* end = (int32_t*)((char*)data + offset);
-        
-        sequence->m_nnzCounts.reserve(sequence->m_numberOfSamples);
-        sequence->m_nnzCounts.assign(begin, end);
+    size_t ReadNnzCounts(const char* data, shared_ptr<SparseInputStreamBuffer>& sequence)
+    {
+        sequence->m_nnzCounts.resize(sequence->m_numberOfSamples);
+        memcpy(sequence->m_nnzCounts.data(), data, sizeof(int32_t) * sequence->m_numberOfSamples);
+        return sizeof(int32_t) * sequence->m_numberOfSamples;
+    }
+};
+
+// Sparse data whose indices are delta and var-int encoded, which usually takes a byte or two per index instead of four.
+// The format of data is as for the sparse data, except for the indices: 
+//   uint32_t: the number of bytes of the encoded indices
+//   byte[]: the encoded indices, for each sample the difference of each index to the previous one in the sample
+//           (to 0 for the first one, so the indices of each sample have to be in increasing order), 7 bits per byte
+//           starting with the lowest ones, and the high bit set on all but the last byte of a difference
+//   int32_t[numSamples]: sizes (nnz counts) for each sample in the sequence
+class CompressedSparseBinaryDataDeserializer : public SparseBinaryDataDeserializer
+{
+public:
+    using SparseBinaryDataDeserializer::SparseBinaryDataDeserializer;
+
+    size_t GetSequenceData(const void* data, shared_ptr<SparseInputStreamBuffer>& sequence) override
+    {
+        size_t offset = ReadSequenceHeader(data, sequence);
+        offset += ReadValues((const char*)data + offset, sequence);
+
+        uint32_t numIndexBytes;
+        memcpy(&numIndexBytes, (const char*)data + offset, sizeof(numIndexBytes));
+        offset += sizeof(numIndexBytes);
+        const unsigned char* encoded = (const unsigned char*)data + offset;
+        offset += numIndexBytes;
+
+        offset += ReadNnzCounts((const char*)data + offset, sequence);
+
+        // Now that the samples are known, the indices can be decoded.
+        sequence->m_decodedIndices.resize(sequence->m_totalNnzCount);
+        IndexType* indices = sequence->m_decodedIndices.data();
+        size_t position = 0, numDecoded = 0;
+        for (auto count : sequence->m_nnzCounts)
+        {
+            if (count < 0 || numDecoded + count > sequence->m_totalNnzCount)
+                RuntimeError("Invalid nnz count %d of a sample (the total nnz count of the sequence is %u).",
+                    (int)count, (unsigned int)sequence->m_totalNnzCount);
+
+            uint32_t index = 0;
+            for (IndexType j = 0; j < count; j++)
+            {
+                uint32_t delta = 0;
+                for (int shift = 0;; shift += 7)
+                {
+                    if (position == numIndexBytes || shift > 28)
+                        RuntimeError("Invalid encoding of the sparse indices of a sequence.");
+                    unsigned char b = encoded[position++];
+                    delta |= (uint32_t)(b & 0x7f) << shift;
+                    if ((b & 0x80) == 0)
+                        break;
+                }
+                index += delta;
+                if (index >= m_sampleDimension)
+                    RuntimeError("Sparse index %u exceeds the sample dimension %u.", index, m_sampleDimension);
+                indices[numDecoded++] = (IndexType)index;
+            }
+        }
+
+        if (numDecoded != sequence->m_totalNnzCount)
+            RuntimeError("The nnz counts of the samples do not add up to the total nnz count (%u) of a sequence.",
+                (unsigned int)sequence->m_totalNnzCount);
 
+        sequence->m_indices = indices;
         return offset;
     }
 };
@@ -45,7 +45,7 @@ CNTKBinaryReader::CNTKBinaryReader(const ConfigParameters& config)
                 << window 
                 << configHelper.UseSampleBasedRandomizationWindow() ? " samples" : " chunks";
             int verbosity = config(L"verbosity", 0);
-            m_sequenceEnumerator = make_shared<BlockRandomizer>(
+            auto randomizer = make_shared<BlockRandomizer>(
                 verbosity, /* verbosity */
                 window,  /* randomizationRangeInSamples */
                 m_deserializer, /* deserializer */
@@ -54,11 +54,16 @@ CNTKBinaryReader::CNTKBinaryReader(const ConfigParameters& config)
                  0, /*maxNumberOfInvalidSequences */
                 configHelper.UseSampleBasedRandomizationWindow() /*sampleBasedRandomizationWindow */,
                 GetRandomSeed(config) /*seedOffset*/);
+            randomizer->SetPrefetchConfiguration(config(L"numPrefetchChunks", (size_t)1), config(L"prefetchBufferSizeInBytes", (size_t)0), config(L"numPrefetchThreads", (size_t)1));
+            randomizer->SetSequenceLengthBuckets(GetSequenceLengthBuckets(config));
+            m_sequenceEnumerator = randomizer;
         }
         else
         {
             log << " | without randomization";
-            m_sequenceEnumerator = std::make_shared<NoRandomizer>(m_deserializer);
+            auto randomizer = std::make_shared<NoRandomizer>(m_deserializer);
+            randomizer->SetPrefetchConfiguration(config(L"numPrefetchChunks", (size_t)1), config(L"prefetchBufferSizeInBytes", (size_t)0), config(L"numPrefetchThreads", (size_t)1));
+            m_sequenceEnumerator = randomizer;
         }
 
         m_packer = std::make_shared<SequencePacker>( m_sequenceEnumerator,
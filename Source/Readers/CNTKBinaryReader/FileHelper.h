@@ -18,14 +18,13 @@
 #include <stdio.h>
 #ifdef __WINDOWS__
 #endif
-#ifdef __unix__
-#include <sys/types.h>
-#include <sys/stat.h>
-#endif
 #include <errno.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <assert.h>
 #include "Basics.h"
+#include "fileutil.h"
+#include "MappedFile.h"
 
 namespace CNTK {
 
@@ -61,7 +60,7 @@ public:
 
     static FILE* openOrDie(const string& pathname, const char* mode)
     {
-        FILE* f = fopen(pathname.c_str(), mode);
+        FILE* f = fopen(fetchRemoteFile(pathname).c_str(), mode);
         if (!f)
             RuntimeError("Error opening file '%s': %s.", pathname.c_str(), strerror(errno));
         return f;
@@ -69,7 +68,7 @@ public:
 
     static FILE* OpenOrDie(const wstring& pathname, const wchar_t* mode)
     {
-        FILE* f = _wfopen(pathname.c_str(), mode);
+        FILE* f = _wfopen(fetchRemoteFile(pathname).c_str(), mode);
         if (!f)
             RuntimeError("Error opening file '%ls': %s.", pathname.c_str(), strerror(errno));
         return f;
@@ -42,16 +42,21 @@ CNTKTextFormatReader::CNTKTextFormatReader(const ConfigParameters& config)
         {
             // TODO: drop "verbosity", use config.traceLevel() instead. 
             int verbosity = config(L"verbosity", 0); 
-            m_sequenceEnumerator = make_shared<BlockRandomizer>(verbosity, window, m_deserializer,
-                                                                /*shouldPrefetch =*/ true,
-                                                                /*multithreadedGetNextSequences =*/ false,
-                                                                /*maxNumberOfInvalidSequences =*/ 0,
-                                                                /*sampleBasedRandomizationWindow =*/ configHelper.UseSampleBasedRandomizationWindow(),
-                                                                /*seedOffset =*/ GetRandomSeed(config));
+            auto randomizer = make_shared<BlockRandomizer>(verbosity, window, m_deserializer,
+                                                           /*shouldPrefetch =*/ true,
+                                                           /*multithreadedGetNextSequences =*/ false,
+                                                           /*maxNumberOfInvalidSequences =*/ 0,
+                                                           /*sampleBasedRandomizationWindow =*/ configHelper.UseSampleBasedRandomizationWindow(),
+                                                           /*seedOffset =*/ GetRandomSeed(config));
+            randomizer->SetPrefetchConfiguration(config(L"numPrefetchChunks", (size_t)1), config(L"prefetchBufferSizeInBytes", (size_t)0), config(L"numPrefetchThreads", (size_t)1));
+            randomizer->SetSequenceLengthBuckets(GetSequenceLengthBuckets(config));
+            m_sequenceEnumerator = randomizer;
         }
         else
         {
-            m_sequenceEnumerator = make_shared<NoRandomizer>(m_deserializer);
+            auto randomizer = make_shared<NoRandomizer>(m_deserializer);
+            randomizer->SetPrefetchConfiguration(config(L"numPrefetchChunks", (size_t)1), config(L"prefetchBufferSizeInBytes", (size_t)0), config(L"numPrefetchThreads", (size_t)1));
+            m_sequenceEnumerator = randomizer;
         }
 
         if (configHelper.IsInFrameMode()) 
@@ -10,6 +10,7 @@
 #include "DataReader.h"
 #include "ReaderShim.h"
 #include "CNTKTextFormatReader.h"
+#include "TextCorpusDeserializer.h"
 #include "HeapMemoryProvider.h"
 #include "StringUtil.h"
 #include "V2Dependencies.h"
@@ -53,6 +54,10 @@ extern "C" DATAREADER_API bool CreateDeserializer(DataDeserializerPtr& deseriali
         else // double
             deserializer = make_shared<TextParser<double>>(corpus, TextConfigHelper(deserializerConfig), primary);
     }
+    else if (type == L"TextSequenceDeserializer")
+    {
+        deserializer = make_shared<TextCorpusDeserializer>(corpus, deserializerConfig, primary);
+    }
     else
         InvalidArgument("Unknown deserializer type '%ls'", type.c_str());
 
@@ -0,0 +1,309 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <algorithm>
+#include <string.h>
+#include "PerfectHashVocabulary.h"
+#include "IndexCache.h"
+#include "fileutil.h"
+
+namespace CNTK {
+
+using namespace std;
+
+const uint64_t PerfectHashVocabulary::s_magic;
+const uint32_t PerfectHashVocabulary::s_version;
+const uint32_t PerfectHashVocabulary::Empty;
+const size_t PerfectHashVocabulary::NotFound;
+
+// Final mixing step of MurmurHash3, spreads the bits of h over the whole word.
+static inline uint64_t Mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// FNV-1a of the characters of the word, mixed.
+static inline uint64_t HashWord(const char* word, size_t length, uint64_t seed)
+{
+    uint64_t h = 14695981039346656037ULL ^ Mix(seed + 1);
+    for (size_t i = 0; i < length; i++)
+    {
+        h ^= (uint8_t)word[i];
+        h *= 1099511628211ULL;
+    }
+    return Mix(h);
+}
+
+static inline uint64_t SlotOf(uint64_t hash, uint32_t displacement, uint64_t numSlots)
+{
+    return Mix(hash + (displacement + 1ULL) * 0x9e3779b97f4a7c15ULL) % numSlots;
+}
+
+PerfectHashVocabulary::PerfectHashVocabulary(const wstring& vocabularyFile)
+    : m_header(nullptr)
+{
+    uint64_t vocabularySize;
+    int64_t modificationTime;
+    if (!IndexCache::TryGetFileInfo(vocabularyFile, vocabularySize, modificationTime))
+        RuntimeError("Cannot open the vocabulary file '%ls'.", vocabularyFile.c_str());
+
+    const wstring cacheFile = vocabularyFile + L".phash";
+    if (TryMap(cacheFile, vocabularySize, modificationTime))
+        return;
+
+    Build(vocabularyFile, vocabularySize, modificationTime);
+    Save(cacheFile);
+}
+
+size_t PerfectHashVocabulary::ImageSize(const Header& header)
+{
+    size_t tables = sizeof(Header) + (size_t)(header.m_numBuckets + header.m_numSlots) * sizeof(uint32_t);
+    tables = (tables + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+    return tables + (size_t)(header.m_numWords + 1) * sizeof(uint64_t) + (size_t)header.m_wordsSize;
+}
+
+void PerfectHashVocabulary::Attach(const byte* data)
+{
+    m_header = (const Header*)data;
+    m_displacements = (const uint32_t*)(data + sizeof(Header));
+    m_slots = m_displacements + m_header->m_numBuckets;
+    size_t tables = sizeof(Header) + (size_t)(m_header->m_numBuckets + m_header->m_numSlots) * sizeof(uint32_t);
+    tables = (tables + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+    m_wordOffsets = (const uint64_t*)(data + tables);
+    m_words = (const char*)(m_wordOffsets + m_header->m_numWords + 1);
+}
+
+bool PerfectHashVocabulary::TryMap(const wstring& cacheFile, uint64_t vocabularySize, int64_t modificationTime)
+{
+    uint64_t cacheSize;
+    int64_t cacheTime;
+    if (!IndexCache::TryGetFileInfo(cacheFile, cacheSize, cacheTime) || cacheSize < sizeof(Header))
+        return false;
+
+    unique_ptr<MappedFile> file(new MappedFile(cacheFile));
+    const Header& header = *(const Header*)file->Data(0, sizeof(Header));
+    bool valid = header.m_magic == s_magic &&
+                 header.m_version == s_version &&
+                 header.m_vocabularySize == vocabularySize &&
+                 header.m_modificationTime == modificationTime &&
+                 header.m_numBuckets > 0 && header.m_numSlots >= header.m_numWords &&
+                 ImageSize(header) == file->Size();
+    if (!valid)
+    {
+        fprintf(stderr, "PerfectHashVocabulary: Vocabulary cache '%ls' is out of date, rebuilding it.\n", cacheFile.c_str());
+        return false;
+    }
+
+    m_file = move(file);
+    Attach(m_file->Data(0, m_file->Size()));
+    fprintf(stderr, "PerfectHashVocabulary: Mapped %" PRIu64 " words from '%ls'.\n", m_header->m_numWords, cacheFile.c_str());
+    return true;
+}
+
+void PerfectHashVocabulary::Build(const wstring& vocabularyFile, uint64_t vocabularySize, int64_t modificationTime)
+{
+    if (vocabularySize == 0)
+        RuntimeError("Vocabulary file '%ls' is empty.", vocabularyFile.c_str());
+
+    // The words, as ranges of the text.
+    MappedFile text(vocabularyFile);
+    const char* begin = (const char*)text.Data(0, text.Size());
+    const char* end = begin + text.Size();
+    if (end - begin >= 3 && memcmp(begin, "\xEF\xBB\xBF", 3) == 0)
+        begin += 3;
+    vector<pair<const char*, uint32_t>> words;
+    uint64_t wordsSize = 0;
+    for (const char* line = begin; line < end;)
+    {
+        const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+        if (!lineEnd)
+            lineEnd = end;
+        const char* word = line;
+        while (word < lineEnd && (*word == ' ' || *word == '\t' || *word == '\r'))
+            word++;
+        const char* wordEnd = word;
+        while (wordEnd < lineEnd && *wordEnd != ' ' && *wordEnd != '\t' && *wordEnd != '\r')
+            wordEnd++;
+        if (wordEnd > word)
+        {
+            words.push_back(make_pair(word, (uint32_t)(wordEnd - word)));
+            wordsSize += wordEnd - word;
+        }
+        line = lineEnd + 1;
+    }
+    if (words.empty())
+        RuntimeError("Vocabulary file '%ls' has no words.", vocabularyFile.c_str());
+    if (words.size() >= Empty)
+        RuntimeError("Vocabulary file '%ls' has too many words (%zu).", vocabularyFile.c_str(), words.size());
+
+    Header header = {};
+    header.m_magic = s_magic;
+    header.m_version = s_version;
+    header.m_vocabularySize = vocabularySize;
+    header.m_modificationTime = modificationTime;
+    header.m_numWords = words.size();
+    header.m_numBuckets = words.size() / 4 + 1;                 // four words per bucket on average
+    header.m_numSlots = words.size() + words.size() / 4 + 1;    // load factor 0.8, so that the last buckets find free slots quickly
+    header.m_wordsSize = wordsSize;
+    const size_t numWords = words.size(), numBuckets = (size_t)header.m_numBuckets, numSlots = (size_t)header.m_numSlots;
+
+    vector<uint64_t> hashes(numWords);
+    vector<uint32_t> displacements(numBuckets);
+    vector<uint32_t> slots;
+    vector<size_t> bucketStart(numBuckets + 1);
+    vector<uint32_t> bucketWords(numWords); // the words, grouped by bucket
+    vector<size_t> order(numBuckets);
+    vector<uint64_t> candidates;
+    const uint32_t maxDisplacement = 1 << 20;
+    bool found = false;
+    for (uint64_t seed = 0; seed < 16 && !found; seed++)
+    {
+        header.m_seed = seed;
+        for (size_t i = 0; i < numWords; i++)
+            hashes[i] = HashWord(words[i].first, words[i].second, seed);
+
+        fill(bucketStart.begin(), bucketStart.end(), 0);
+        for (size_t i = 0; i < numWords; i++)
+            bucketStart[hashes[i] % numBuckets + 1]++;
+        for (size_t b = 0; b < numBuckets; b++)
+            bucketStart[b + 1] += bucketStart[b];
+        vector<size_t> fillPosition(bucketStart.begin(), bucketStart.end() - 1);
+        for (size_t i = 0; i < numWords; i++)
+            bucketWords[fillPosition[hashes[i] % numBuckets]++] = (uint32_t)i;
+
+        // the largest buckets first, while most slots are still free
+        for (size_t b = 0; b < numBuckets; b++)
+            order[b] = b;
+        sort(order.begin(), order.end(), [&](size_t a, size_t b) { return bucketStart[a + 1] - bucketStart[a] > bucketStart[b + 1] - bucketStart[b]; });
+
+        slots.assign(numSlots, Empty);
+        fill(displacements.begin(), displacements.end(), 0);
+        found = true;
+        for (size_t b : order)
+        {
+            const uint32_t* members = bucketWords.data() + bucketStart[b];
+            const size_t size = bucketStart[b + 1] - bucketStart[b];
+            if (size == 0)
+                break;
+
+            // words with the same hash cannot be separated by any displacement
+            bool separable = true;
+            for (size_t i = 0; i < size && separable; i++)
+                for (size_t j = i + 1; j < size && separable; j++)
+                {
+                    const auto& a = words[members[i]];
+                    const auto& c = words[members[j]];
+                    if (a.second == c.second && memcmp(a.first, c.first, a.second) == 0)
+                        RuntimeError("Vocabulary file '%ls' has the word '%s' more than once.", vocabularyFile.c_str(), string(a.first, a.second).c_str());
+                    separable = hashes[members[i]] != hashes[members[j]];
+                }
+
+            bool placed = false;
+            for (uint32_t d = 0; separable && d < maxDisplacement && !placed; d++)
+            {
+                candidates.clear();
+                placed = true;
+                for (size_t i = 0; i < size && placed; i++)
+                {
+                    uint64_t slot = SlotOf(hashes[members[i]], d, numSlots);
+                    placed = slots[slot] == Empty && find(candidates.begin(), candidates.end(), slot) == candidates.end();
+                    candidates.push_back(slot);
+                }
+                if (placed)
+                {
+                    displacements[b] = d;
+                    for (size_t i = 0; i < size; i++)
+                        slots[candidates[i]] = members[i];
+                }
+            }
+            if (!placed)
+            {
+                found = false; // try again with another seed
+                break;
+            }
+        }
+    }
+    if (!found)
+        RuntimeError("Failed to build a perfect hash function for the vocabulary file '%ls'.", vocabularyFile.c_str());
+
+    // the image of the sidecar file
+    m_image.assign((ImageSize(header) + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+    byte* data = (byte*)m_image.data();
+    memcpy(data, &header, sizeof(header));
+    Attach(data);
+    memcpy((uint32_t*)m_displacements, displacements.data(), numBuckets * sizeof(uint32_t));
+    memcpy((uint32_t*)m_slots, slots.data(), numSlots * sizeof(uint32_t));
+    uint64_t* wordOffsets = (uint64_t*)m_wordOffsets;
+    char* wordChars = (char*)m_words;
+    wordOffsets[0] = 0;
+    for (size_t i = 0; i < numWords; i++)
+    {
+        memcpy(wordChars + wordOffsets[i], words[i].first, words[i].second);
+        wordOffsets[i + 1] = wordOffsets[i] + words[i].second;
+    }
+
+    fprintf(stderr, "PerfectHashVocabulary: Built the hash function for %zu words of '%ls'.\n", numWords, vocabularyFile.c_str());
+}
+
+void PerfectHashVocabulary::Save(const wstring& cacheFile) const
+{
+    // Write to a temporary file first, so that concurrent readers (e.g. the other workers of a distributed job)
+    // never see a partially written cache.
+    const wstring tempFile = cacheFile + L".tmp" + to_wstring(GetCurrentProcessId());
+    FILE* f = _wfopen(tempFile.c_str(), L"wb");
+    bool ok = f != nullptr;
+    if (f)
+    {
+        const size_t size = ImageSize(*m_header);
+        ok = fwrite(m_image.data(), size, 1, f) == 1;
+        ok = (fclose(f) == 0) && ok;
+        try
+        {
+            if (ok)
+                renameOrDie(tempFile, cacheFile);
+            else
+                unlinkOrDie(tempFile);
+        }
+        catch (const exception&)
+        {
+            ok = false;
+        }
+    }
+
+    if (!ok)
+        fprintf(stderr, "WARNING: Cannot write the vocabulary cache '%ls', the hash function will be rebuilt on the next run.\n", cacheFile.c_str());
+}
+
+size_t PerfectHashVocabulary::Lookup(const char* word, size_t length) const
+{
+    const uint64_t hash = HashWord(word, length, m_header->m_seed);
+    const uint32_t displacement = m_displacements[hash % m_header->m_numBuckets];
+    const uint32_t id = m_slots[SlotOf(hash, displacement, m_header->m_numSlots)];
+    if (id == Empty)
+        return NotFound;
+
+    // the slot holds the only word of the vocabulary with this hash, but the word may not be in the vocabulary at all
+    const uint64_t begin = m_wordOffsets[id];
+    if (m_wordOffsets[id + 1] - begin != length || memcmp(m_words + begin, word, length) != 0)
+        return NotFound;
+    return id;
+}
+
+string PerfectHashVocabulary::Word(size_t id) const
+{
+    if (id >= m_header->m_numWords)
+        RuntimeError("PerfectHashVocabulary: Unknown word id %zu.", id);
+    return string(m_words + m_wordOffsets[id], (size_t)(m_wordOffsets[id + 1] - m_wordOffsets[id]));
+}
+
+}
@@ -0,0 +1,86 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+namespace CNTK {
+
+// A read-only vocabulary of words and their ids, looked up with a perfect hash function ("hash and displace"):
+// the words are distributed into buckets by their hash, and each bucket has a displacement that sends all of its words
+// to distinct slots. A lookup therefore hashes the word once and compares it with the single word in its slot.
+// The tables and the words are stored in a binary sidecar file ("<vocabulary file>.phash"), which is built from the
+// text vocabulary on first use and memory mapped on later runs (so that the processes on a machine share it).
+class PerfectHashVocabulary
+{
+public:
+    static const size_t NotFound = SIZE_MAX;
+
+    // Loads a vocabulary with one word per line (the first field of the line, the rest, e.g. a count, is ignored).
+    // The id of a word is its line number, not counting empty lines.
+    explicit PerfectHashVocabulary(const std::wstring& vocabularyFile);
+
+    size_t Size() const { return (size_t)m_header->m_numWords; }
+
+    // Returns the id of the word, or NotFound if it is not in the vocabulary.
+    size_t Lookup(const char* word, size_t length) const;
+
+    size_t Lookup(const std::string& word) const { return Lookup(word.data(), word.size()); }
+
+    std::string Word(size_t id) const;
+
+private:
+    // The layout of the sidecar file: the header, followed by the displacements of the buckets (uint32), the word id
+    // of each slot (uint32, Empty for unused slots), the offsets of the words (uint64, one more than words, aligned
+    // to 8 bytes) and the characters of the words.
+    struct Header
+    {
+        uint64_t m_magic;
+        uint32_t m_version;
+        uint32_t m_reserved;
+        uint64_t m_vocabularySize;    // of the text vocabulary file the tables were built from
+        int64_t m_modificationTime;   // of the text vocabulary file
+        uint64_t m_seed;
+        uint64_t m_numWords;
+        uint64_t m_numBuckets;
+        uint64_t m_numSlots;
+        uint64_t m_wordsSize;
+    };
+
+    static const uint64_t s_magic = 0x7668705f6b746e63U; // "cntk_phv"
+    static const uint32_t s_version = 1;
+    static const uint32_t Empty = UINT32_MAX;
+
+    static size_t ImageSize(const Header& header);
+
+    // Maps the sidecar file if it is valid for the vocabulary file.
+    bool TryMap(const std::wstring& cacheFile, uint64_t vocabularySize, int64_t modificationTime);
+
+    // Reads the text vocabulary and builds the tables in m_image.
+    void Build(const std::wstring& vocabularyFile, uint64_t vocabularySize, int64_t modificationTime);
+
+    void Save(const std::wstring& cacheFile) const;
+
+    // Sets the table pointers into the image starting at 'data'.
+    void Attach(const byte* data);
+
+    std::unique_ptr<MappedFile> m_file; // the mapped sidecar file, if valid
+    std::vector<uint64_t> m_image;      // otherwise the tables built in memory (uint64_t for the alignment)
+
+    const Header* m_header;
+    const uint32_t* m_displacements;
+    const uint32_t* m_slots;
+    const uint64_t* m_wordOffsets;
+    const char* m_words;
+
+    DISABLE_COPY_AND_MOVE(PerfectHashVocabulary);
+};
+
+}
@@ -0,0 +1,360 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <algorithm>
+#include <future>
+#include <string.h>
+#include <thread>
+#include "TextCorpusDeserializer.h"
+#include "IndexCache.h"
+#include "ReaderConstants.h"
+#include "StringUtil.h"
+#include "Globals.h"
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+// Sparse one-hot words of a sequence.
+template <class ElemType>
+struct WordSequenceData : SparseSequenceData
+{
+    vector<ElemType> m_values;
+    vector<SparseIndexType> m_indexBuffer;
+    const NDShape& m_wordShape;
+
+    WordSequenceData(const int32_t* ids, size_t numberOfWords, const NDShape& wordShape)
+        : m_values(numberOfWords, 1), m_indexBuffer(ids, ids + numberOfWords), m_wordShape(wordShape)
+    {
+        m_nnzCounts.resize(numberOfWords, static_cast<SparseIndexType>(1));
+        m_numberOfSamples = (uint32_t)numberOfWords;
+        m_totalNnzCount = static_cast<SparseIndexType>(numberOfWords);
+        m_indices = m_indexBuffer.data();
+    }
+
+    const void* GetDataBuffer() override
+    {
+        return m_values.data();
+    }
+
+    const NDShape& GetSampleShape() override
+    {
+        return m_wordShape;
+    }
+};
+
+static inline bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+TextCorpusDeserializer::TextCorpusDeserializer(CorpusDescriptorPtr corpus, const ConfigParameters& cfg, bool primary)
+    : DataDeserializerBase(primary),
+      m_corpus(corpus),
+      m_maxShift(0)
+{
+    m_verbosity = cfg(L"traceLevel", 1);
+    wstring precision = cfg(L"precision", L"float");
+    m_elementType = AreEqualIgnoreCase(precision, L"float") ? DataType::Float : DataType::Double;
+
+    m_vocabulary = make_unique<PerfectHashVocabulary>(msra::strfun::utf16(cfg(L"vocabulary")));
+    auto findWord = [&](const wchar_t* option)
+    {
+        string word = cfg(option, "");
+        if (word.empty())
+            return PerfectHashVocabulary::NotFound;
+        size_t id = m_vocabulary->Lookup(word);
+        if (id == PerfectHashVocabulary::NotFound)
+            InvalidArgument("TextCorpusDeserializer: The %ls '%s' is not in the vocabulary.", option, word.c_str());
+        return id;
+    };
+    m_unknownWord = findWord(L"unknownWord");
+    m_sentenceBegin = findWord(L"sentenceBegin");
+    m_sentenceEnd = findWord(L"sentenceEnd");
+
+    ConfigParameters input = cfg(L"input");
+    for (const auto& name : input.GetMemberIds())
+    {
+        ConfigParameters streamConfig = input(name);
+        StreamInformation stream;
+        stream.m_id = m_streams.size();
+        stream.m_name = name;
+        stream.m_sampleLayout = NDShape({ m_vocabulary->Size() });
+        stream.m_elementType = m_elementType;
+        stream.m_storageFormat = StorageFormat::SparseCSC;
+        m_streams.push_back(stream);
+        m_shifts.push_back(streamConfig(L"shift", (size_t)0));
+        m_maxShift = max(m_maxShift, m_shifts.back());
+    }
+    if (m_streams.empty())
+        InvalidArgument("TextCorpusDeserializer: No input streams are configured.");
+
+    m_file = msra::strfun::utf16(cfg(L"file"));
+    uint64_t fileSize;
+    int64_t modificationTime;
+    if (!IndexCache::TryGetFileInfo(m_file, fileSize, modificationTime))
+        RuntimeError("Cannot open the input file '%ls'.", m_file.c_str());
+    if (fileSize == 0)
+        RuntimeError("Input file '%ls' is empty.", m_file.c_str());
+    m_corpusFile = make_unique<MappedFile>(m_file);
+
+    m_index = make_unique<Index>(cfg(L"chunkSizeInBytes", g_32MB), m_primary);
+    BuildIndex(cfg(L"cacheIndex", false), cfg(L"numIndexingThreads", (size_t)0));
+}
+
+void TextCorpusDeserializer::BuildIndex(bool cacheIndex, size_t numThreads)
+{
+    // (the number of samples of a line depends on the words added to it and the shifts)
+    IndexCachePtr cache;
+    if (cacheIndex)
+    {
+        string parameters = "TextCorpusDeserializer sentenceBegin=" + to_string(m_sentenceBegin != PerfectHashVocabulary::NotFound) +
+                            " sentenceEnd=" + to_string(m_sentenceEnd != PerfectHashVocabulary::NotFound) + " maxShift=" + to_string(m_maxShift);
+        cache = make_shared<IndexCache>(m_file, parameters);
+        uint32_t flags;
+        if (cache->TryLoad(m_corpus, *m_index, flags))
+        {
+            m_index->MapSequenceKeyToLocation();
+            return;
+        }
+    }
+
+    // Split the corpus into ranges of whole lines, which are scanned concurrently.
+    const uint64_t fileSize = m_corpusFile->Size();
+    const char* data = (const char*)m_corpusFile->Data(0, fileSize);
+    numThreads = Globals::GetNumReaderWorkerThreads(numThreads);
+    const size_t numRanges = max((size_t)1, min(numThreads, (size_t)(fileSize / (16 * 1024 * 1024))));
+    vector<uint64_t> boundaries(1, fileSize >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0 ? 3 : 0);
+    for (size_t i = 1; i < numRanges; i++)
+    {
+        const uint64_t splitPoint = fileSize / numRanges * i;
+        const char* lineBreak = (const char*)memchr(data + splitPoint, '\n', fileSize - splitPoint);
+        const uint64_t boundary = lineBreak ? lineBreak - data + 1 : fileSize;
+        if (boundary > boundaries.back() && boundary < fileSize)
+            boundaries.push_back(boundary);
+    }
+    boundaries.push_back(fileSize);
+
+    vector<future<vector<Line>>> tasks;
+    for (size_t i = 0; i + 1 < boundaries.size(); i++)
+    {
+        tasks.push_back(async(launch::async, [this](uint64_t begin, uint64_t end)
+        {
+            vector<Line> lines;
+            ScanLines(begin, end, lines);
+            return lines;
+        }, boundaries[i], boundaries[i + 1]));
+    }
+
+    // Add the lines to the index in the order of the corpus; the key of a line is its line number.
+    const size_t addedWords = (m_sentenceBegin != PerfectHashVocabulary::NotFound ? 1 : 0) + (m_sentenceEnd != PerfectHashVocabulary::NotFound ? 1 : 0);
+    size_t lineNumber = 0, numberOfSequences = 0, numberOfSamples = 0, numberOfSkipped = 0;
+    for (auto& task : tasks)
+    {
+        vector<Line> lines = task.get();
+        for (const auto& line : lines)
+        {
+            const size_t key = m_corpus->IsNumericSequenceKeys() ? lineNumber : m_corpus->KeyToId(to_string(lineNumber));
+            lineNumber++;
+            const size_t numberOfWords = line.m_numberOfWords + addedWords;
+            if (line.m_numberOfWords == 0 || numberOfWords <= m_maxShift)
+            {
+                numberOfSkipped += line.m_numberOfWords > 0;
+                continue;
+            }
+
+            m_index->AddSequence(SequenceDescriptor{ key, (uint32_t)(numberOfWords - m_maxShift) }, line.m_offset, line.m_offset + line.m_sizeInBytes);
+            numberOfSequences++;
+            numberOfSamples += numberOfWords - m_maxShift;
+        }
+    }
+    m_index->MapSequenceKeyToLocation();
+
+    if (numberOfSkipped)
+        fprintf(stderr, "WARNING: '%zu' lines are too short for the shift of the streams and will be skipped.\n", numberOfSkipped);
+    if (m_index->IsEmpty())
+        RuntimeError("TextCorpusDeserializer: No sequences in the input file '%ls'.", m_file.c_str());
+    if (m_verbosity)
+        fprintf(stderr, "TextCorpusDeserializer: indexed '%zu' sequences with '%zu' samples of '%ls' in %zu ranges, grouped into '%zu' chunks\n",
+                numberOfSequences, numberOfSamples, m_file.c_str(), boundaries.size() - 1, m_index->Chunks().size());
+
+    if (cache)
+        cache->Save(m_corpus, *m_index);
+}
+
+void TextCorpusDeserializer::ScanLines(uint64_t begin, uint64_t end, vector<Line>& lines) const
+{
+    const char* data = (const char*)m_corpusFile->Data(begin, end - begin);
+    const char* rangeEnd = data + (end - begin);
+    for (const char* p = data; p < rangeEnd;)
+    {
+        const char* lineEnd = (const char*)memchr(p, '\n', rangeEnd - p);
+        if (!lineEnd)
+            lineEnd = rangeEnd;
+
+        Line line;
+        line.m_offset = begin + (p - data);
+        if ((uint64_t)(lineEnd - p) > UINT32_MAX)
+            RuntimeError("Line at the offset %" PRIu64 " of the input file '%ls' is too long.", line.m_offset, m_file.c_str());
+        line.m_sizeInBytes = (uint32_t)(lineEnd - p);
+        line.m_numberOfWords = 0;
+        bool inWord = false;
+        for (; p < lineEnd; p++)
+        {
+            const bool isWord = !IsSpace(*p);
+            line.m_numberOfWords += isWord && !inWord;
+            inWord = isWord;
+        }
+        lines.push_back(line);
+        p = lineEnd + 1;
+    }
+}
+
+void TextCorpusDeserializer::LookupWords(const char* line, size_t size, vector<int32_t>& ids) const
+{
+    if (m_sentenceBegin != PerfectHashVocabulary::NotFound)
+        ids.push_back((int32_t)m_sentenceBegin);
+    const char* end = line + size;
+    for (const char* p = line; p < end;)
+    {
+        while (p < end && IsSpace(*p))
+            p++;
+        const char* word = p;
+        while (p < end && !IsSpace(*p))
+            p++;
+        if (p == word)
+            break;
+
+        size_t id = m_vocabulary->Lookup(word, p - word);
+        if (id == PerfectHashVocabulary::NotFound)
+        {
+            if (m_unknownWord == PerfectHashVocabulary::NotFound)
+                RuntimeError("TextCorpusDeserializer: The word '%s' of the input file '%ls' is not in the vocabulary; please configure an 'unknownWord'.",
+                             string(word, p - word).c_str(), m_file.c_str());
+            id = m_unknownWord;
+        }
+        ids.push_back((int32_t)id);
+    }
+    if (m_sentenceEnd != PerfectHashVocabulary::NotFound)
+        ids.push_back((int32_t)m_sentenceEnd);
+}
+
+// Gets information about available chunks.
+vector<ChunkInfo> TextCorpusDeserializer::ChunkInfos()
+{
+    const auto& chunks = m_index->Chunks();
+    vector<ChunkInfo> result;
+    result.reserve(chunks.size());
+    for (ChunkIdType i = 0; i < chunks.size(); ++i)
+    {
+        ChunkInfo cd;
+        cd.m_id = i;
+        cd.m_numberOfSamples = chunks[i].NumSamples();
+        cd.m_numberOfSequences = chunks[i].Sequences().size();
+        result.push_back(cd);
+    }
+    return result;
+}
+
+// Gets sequences for a particular chunk.
+void TextCorpusDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, vector<SequenceInfo>& result)
+{
+    const auto& sequences = m_index->Chunks()[chunkId].Sequences();
+    result.reserve(sequences.size());
+    for (size_t i = 0; i < sequences.size(); ++i)
+    {
+        SequenceInfo info;
+        info.m_chunkId = chunkId;
+        info.m_indexInChunk = i;
+        info.m_numberOfSamples = sequences[i].m_numberOfSamples;
+        info.m_key.m_sequence = sequences[i].m_key;
+        info.m_key.m_sample = 0;
+        result.push_back(info);
+    }
+}
+
+// The word ids of the lines of a chunk. Given up to the randomizer.
+class TextCorpusDeserializer::TextCorpusChunk : public Chunk
+{
+public:
+    TextCorpusChunk(TextCorpusDeserializer* parent, ChunkIdType chunkId) : m_parent(parent), m_chunk(parent->m_index->Chunks()[chunkId])
+    {
+        // Let the system read in the whole chunk before the lines are split, and drop it from the process afterwards,
+        // the ids are copied into the chunk.
+        const auto& file = *m_parent->m_corpusFile;
+        file.WillNeed(m_chunk.m_offset, m_chunk.SizeInBytes());
+
+        const auto& sequences = m_chunk.Sequences();
+        m_ids.reserve(m_chunk.NumSamples() + sequences.size() * m_parent->m_maxShift);
+        m_firstId.reserve(sequences.size() + 1);
+        for (const auto& sequence : sequences)
+        {
+            m_firstId.push_back(m_ids.size());
+            const uint64_t offset = m_chunk.m_offset + sequence.OffsetInChunk();
+            m_parent->LookupWords((const char*)file.Data(offset, sequence.SizeInBytes()), sequence.SizeInBytes(), m_ids);
+            if (m_ids.size() - m_firstId.back() != sequence.m_numberOfSamples + m_parent->m_maxShift)
+                RuntimeError("TextCorpusDeserializer: The input file '%ls' has changed since it was indexed.", m_parent->m_file.c_str());
+        }
+        m_firstId.push_back(m_ids.size());
+
+        file.DontNeed(m_chunk.m_offset, m_chunk.SizeInBytes());
+        if (m_parent->m_verbosity > 1)
+            fprintf(stderr, "TextCorpusDeserializer: looked up %zu words of chunk %u\n", m_ids.size(), (unsigned int)chunkId);
+    }
+
+    // Gets data for the sequence.
+    virtual void GetSequence(size_t sequenceIndex, vector<SequenceDataPtr>& result) override
+    {
+        const auto& sequence = m_chunk.Sequences()[sequenceIndex];
+        for (size_t i = 0; i < m_parent->m_streams.size(); i++)
+        {
+            const int32_t* ids = m_ids.data() + m_firstId[sequenceIndex] + m_parent->m_shifts[i];
+            SparseSequenceDataPtr data;
+            if (m_parent->m_elementType == DataType::Double)
+                data = make_shared<WordSequenceData<double>>(ids, sequence.m_numberOfSamples, m_parent->m_streams[i].m_sampleLayout);
+            else
+                data = make_shared<WordSequenceData<float>>(ids, sequence.m_numberOfSamples, m_parent->m_streams[i].m_sampleLayout);
+            data->m_key.m_sequence = sequence.m_key;
+            result.push_back(data);
+        }
+    }
+
+private:
+    TextCorpusDeserializer* m_parent;
+    const ChunkDescriptor& m_chunk;
+    vector<int32_t> m_ids;      // of all lines of the chunk
+    vector<size_t> m_firstId;   // index into m_ids per line, and the end
+
+    DISABLE_COPY_AND_MOVE(TextCorpusChunk);
+};
+
+// Gets a data chunk with the specified chunk id.
+ChunkPtr TextCorpusDeserializer::GetChunk(ChunkIdType chunkId)
+{
+    return make_shared<TextCorpusChunk>(this, chunkId);
+}
+
+// Gets sequence description by its key.
+bool TextCorpusDeserializer::GetSequenceInfo(const SequenceInfo& primary, SequenceInfo& result)
+{
+    assert(!m_primary);
+    auto found = m_index->GetSequenceByKey(primary.m_key.m_sequence);
+    if (!get<0>(found))
+        return false;
+
+    const auto& sequence = m_index->Chunks()[get<1>(found)].Sequences()[get<2>(found)];
+    result.m_chunkId = get<1>(found);
+    result.m_indexInChunk = get<2>(found);
+    result.m_numberOfSamples = sequence.m_numberOfSamples;
+    result.m_key.m_sequence = sequence.m_key;
+    result.m_key.m_sample = 0;
+    return true;
+}
+
+}
@@ -0,0 +1,84 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "DataDeserializerBase.h"
+#include "Config.h"
+#include "CorpusDescriptor.h"
+#include "Indexer.h"
+#include "MappedFile.h"
+#include "PerfectHashVocabulary.h"
+
+namespace CNTK {
+
+// Deserializer of a plain text corpus with one sentence per line ("TextSequenceDeserializer"), e.g. for language model
+// training, as a replacement of the LMSequenceReader and LUSequenceReader for the reader pipeline with randomization,
+// prefetching and distributed reading. Each line is a sequence of the ids of its words in the vocabulary (one word per
+// line of the vocabulary file), optionally between a sentence begin and end word; words that are not in the vocabulary
+// become the unknown word. Empty lines are skipped.
+// Nothing is loaded up front: the corpus is memory mapped and indexed into chunks of whole lines (in parallel, and
+// cached next to the corpus if 'cacheIndex' is set), the vocabulary is memory mapped (see PerfectHashVocabulary),
+// and the lines are only split and looked up when their chunk is requested.
+// Every stream exposes the words of a line as one-hot vectors, shifted by its 'shift' (e.g. 0 for the features,
+// 1 for the labels); all streams have the same number of samples, the number of words minus the largest shift.
+class TextCorpusDeserializer : public DataDeserializerBase
+{
+public:
+    TextCorpusDeserializer(CorpusDescriptorPtr corpus, const ConfigParameters& config, bool primary);
+
+    // Get information about chunks.
+    virtual std::vector<ChunkInfo> ChunkInfos() override;
+
+    // Get information about particular chunk.
+    virtual void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result) override;
+
+    // Retrieves data for a chunk.
+    virtual ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+    // Gets sequence description by the primary one.
+    virtual bool GetSequenceInfo(const SequenceInfo& primary, SequenceInfo&) override;
+
+private:
+    class TextCorpusChunk;
+
+    // A line, as found by the scan of the corpus.
+    struct Line
+    {
+        uint64_t m_offset;
+        uint32_t m_sizeInBytes; // without the line break
+        uint32_t m_numberOfWords;
+    };
+
+    // Builds the index of the corpus, unless it can be loaded from the cache.
+    void BuildIndex(bool cacheIndex, size_t numThreads);
+
+    // Finds the lines in the range [begin, end) of the corpus; the range starts at the beginning of a line.
+    void ScanLines(uint64_t begin, uint64_t end, std::vector<Line>& lines) const;
+
+    // Gets the word ids of a line, with the sentence begin and end words.
+    void LookupWords(const char* line, size_t size, std::vector<int32_t>& ids) const;
+
+    CorpusDescriptorPtr m_corpus;
+    std::wstring m_file;
+    int m_verbosity;
+
+    std::unique_ptr<MappedFile> m_corpusFile;
+    std::unique_ptr<PerfectHashVocabulary> m_vocabulary;
+    size_t m_unknownWord;   // id, or PerfectHashVocabulary::NotFound if unknown words are an error
+    size_t m_sentenceBegin; // ids of the words added to each line, or NotFound for none
+    size_t m_sentenceEnd;
+
+    DataType m_elementType;
+    std::vector<size_t> m_shifts; // per stream
+    size_t m_maxShift;
+
+    std::unique_ptr<Index> m_index;
+};
+
+}
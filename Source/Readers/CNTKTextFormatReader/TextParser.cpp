@@ -7,6 +7,9 @@
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 #include <cfloat>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 #include "Indexer.h"
 #include "TextParser.h"
 #include "TextReaderConstants.h"
@@ -23,6 +26,123 @@ inline bool IsDigit(char c)
     return '0' <= c && c <= '9';
 }
 
+// Returns the first position in [begin, end) that holds one of the characters c1 and c2, or end if there is none.
+// Compares 16 characters at a time where SSE2 is available.
+inline const char* FindFirstOf(const char* begin, const char* end, char c1, char c2)
+{
+    const char* p = begin;
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i v1 = _mm_set1_epi8(c1);
+    const __m128i v2 = _mm_set1_epi8(c2);
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i chars = _mm_loadu_si128((const __m128i*)p);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chars, v1), _mm_cmpeq_epi8(chars, v2)));
+        if (mask != 0)
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return p + index;
+#else
+            return p + __builtin_ctz(mask);
+#endif
+        }
+    }
+#endif
+    for (; p != end; ++p)
+    {
+        if (*p == c1 || *p == c2)
+            break;
+    }
+    return p;
+}
+
+// Parses the floating point number at the start of [begin, end), without any of the bookkeeping of
+// TextParser::TryReadRealNumber() (which implements the same grammar as a state machine, one character at a time).
+// The arithmetic is the same as well, so that both produce identical values.
+// Returns the position after the number, or nullptr if the number is malformed or not followed by another
+// character within [begin, end). The caller then falls back to the state machine, which also reports the error.
+inline const char* TryParseRealNumber(const char* begin, const char* end, double& value)
+{
+    const char* p = begin;
+    bool negative = false;
+    if (p != end && isSign(*p))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+    if (p == end || !IsDigit(*p))
+        return nullptr;
+
+    double number = 0;
+    for (; p != end && IsDigit(*p); ++p)
+        number = number * 10 + (*p - '0');
+    if (p == end)
+        return nullptr;
+
+    double coefficient;
+    if (*p == '.')
+    {
+        ++p;
+        if (p == end)
+            return nullptr;
+        if (!IsDigit(*p))
+        {
+            value = negative ? -number : number;
+            return p;
+        }
+        coefficient = number;
+        number = 0;
+        double divider = 1;
+        for (; p != end && IsDigit(*p); ++p)
+        {
+            number = number * 10 + (*p - '0');
+            divider *= 10;
+        }
+        if (p == end)
+            return nullptr;
+        coefficient += (number / divider);
+        if (!isE(*p))
+        {
+            value = negative ? -coefficient : coefficient;
+            return p;
+        }
+        if (negative)
+            coefficient = -coefficient;
+    }
+    else if (isE(*p))
+    {
+        coefficient = negative ? -number : number;
+    }
+    else
+    {
+        value = negative ? -number : number;
+        return p;
+    }
+
+    // exponent: an optional sign and a nonempty sequence of digits
+    ++p;
+    if (p != end && isSign(*p))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+    else
+        negative = false;
+    if (p == end || !IsDigit(*p))
+        return nullptr;
+
+    number = 0;
+    for (; p != end && IsDigit(*p); ++p)
+        number = number * 10 + (*p - '0');
+    if (p == end)
+        return nullptr;
+
+    value = coefficient * pow(10.0, negative ? -number : number);
+    return p;
+}
+
 enum State
 {
     Init = 0,
@@ -67,6 +187,8 @@ TextParser(corpus, helper.GetFilePath(), helper.GetStreams(), primary)
     SetMaxAllowedErrors(helper.GetMaxAllowedErrors());
     SetChunkSize(helper.GetChunkSize());
     SetSkipSequenceIds(helper.ShouldSkipSequenceIds());
+    SetCacheIndex(helper.ShouldCacheIndex());
+    SetNumIndexingThreads(helper.GetNumIndexingThreads());
 
     Initialize();
 }
@@ -91,6 +213,8 @@ TextParser<ElemType>::TextParser(CorpusDescriptorPtr corpus, const std::wstring&
     m_hadWarnings(false),
     m_numAllowedErrors(0),
     m_skipSequenceIds(false),
+    m_cacheIndex(false),
+    m_numIndexingThreads(1),
     m_numRetries(5),
     m_corpus(corpus)
 {
@@ -184,6 +308,10 @@ void TextParser<ElemType>::Initialize()
         }
 
         m_indexer = make_unique<Indexer>(m_file, m_primary, m_skipSequenceIds, NAME_PREFIX, m_chunkSizeBytes, mainStreamAlias);
+        if (m_cacheIndex)
+            m_indexer->EnableCache(m_filename);
+        if (m_numIndexingThreads != 1)
+            m_indexer->EnableParallelBuild(m_filename, m_numIndexingThreads);
         m_indexer->Build(m_corpus);
     });
 
@@ -943,14 +1071,15 @@ void TextParser<ElemType>::SkipToNextInput(size_t& bytesToRead)
 {
     while (bytesToRead && CanRead())
     {
-        char c = *m_pos;
         // skip everything until we hit either an input marker or the end of row.
-        if (c == NAME_PREFIX || c == ROW_DELIMITER)
+        const char* end = m_pos + min(bytesToRead, (size_t)(m_bufferEnd - m_pos));
+        const char* next = FindFirstOf(m_pos, end, NAME_PREFIX, ROW_DELIMITER);
+        bytesToRead -= (next - m_pos);
+        m_pos = next;
+        if (next != end)
         {
             return;
         }
-        ++m_pos;
-        --bytesToRead;
     }
 }
 
@@ -1027,6 +1156,20 @@ bool TextParser<ElemType>::TryReadUint64(size_t& value, size_t& bytesToRead)
 template <class ElemType>
 bool TextParser<ElemType>::TryReadRealNumber(ElemType& value, size_t& bytesToRead)
 {
+    // Fast path for the common case of a well-formed number within the current buffer.
+    if (bytesToRead && CanRead())
+    {
+        double number;
+        const char* next = TryParseRealNumber(m_pos, m_pos + min(bytesToRead, (size_t)(m_bufferEnd - m_pos)), number);
+        if (next)
+        {
+            value = static_cast<ElemType>(number);
+            bytesToRead -= (next - m_pos);
+            m_pos = next;
+            return true;
+        }
+    }
+
     State state = State::Init;
     double coefficient = .0, number = .0, divider = .0;
     bool negative = false;
@@ -1276,6 +1419,18 @@ void TextParser<ElemType>::SetSkipSequenceIds(bool skip)
     m_skipSequenceIds = skip;
 }
 
+template <class ElemType>
+void TextParser<ElemType>::SetCacheIndex(bool cache)
+{
+    m_cacheIndex = cache;
+}
+
+template <class ElemType>
+void TextParser<ElemType>::SetNumIndexingThreads(size_t numThreads)
+{
+    m_numIndexingThreads = numThreads;
+}
+
 template <class ElemType>
 void TextParser<ElemType>::SetChunkSize(size_t size)
 {
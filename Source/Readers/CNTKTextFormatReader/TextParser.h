@@ -133,6 +133,8 @@ private:
     bool m_hadWarnings;
     unsigned int m_numAllowedErrors;
     bool m_skipSequenceIds;
+    bool m_cacheIndex;
+    size_t m_numIndexingThreads;
     unsigned int m_numRetries; // specifies the number of times an unsuccessful
                                // file operation should be repeated (default value is 5).
 
@@ -202,6 +204,10 @@ private:
 
     void SetSkipSequenceIds(bool skip);
 
+    void SetCacheIndex(bool cache);
+
+    void SetNumIndexingThreads(size_t numThreads);
+
     void SetChunkSize(size_t size);
 
     void SetNumRetries(unsigned int numRetries);
@@ -13,6 +13,7 @@
 
 #include "CompositeDataReader.h"
 #include "Bundler.h"
+#include "DiskChunkCache.h"
 #include "BlockRandomizer.h"
 #include "NoRandomizer.h"
 #include "FramePacker.h"
@@ -39,10 +40,13 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
     bool isActionWrite = AreEqualIgnoreCase(action, L"write");
 
     // By default, we use numeric sequence keys (i.e., for cbf, ctf, image and base64 readers).
-    // For MLF and HTK deserializers, we use non-numeric (string) sequence keys.
+    // For MLF, HTK, audio and Kaldi deserializers, we use non-numeric (string) sequence keys.
     bool useNumericSequenceKeys = true;
     if (ContainsDeserializer(config, L"HTKFeatureDeserializer") ||
-        ContainsDeserializer(config, L"HTKMLFDeserializer")) 
+        ContainsDeserializer(config, L"HTKMLFDeserializer") ||
+        ContainsDeserializer(config, L"AudioFeatureDeserializer") ||
+        ContainsDeserializer(config, L"KaldiFeatureDeserializer") ||
+        ContainsDeserializer(config, L"KaldiAlignmentDeserializer")) 
     {
         useNumericSequenceKeys = false;
     }
@@ -102,6 +106,17 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
         deserializer = std::make_shared<Bundler>(config, deserializer, m_deserializers, cleanse);
     }
 
+    // Optionally keeping the decoded chunks on local disk, so that only the first sweep reads and decodes the input.
+    // With diskCacheShared, the workers of a distributed job on the same host share the cache (e.g. in /dev/shm),
+    // and each chunk is decoded by one of them.
+    std::wstring diskCacheDirectory = config(L"diskCacheDirectory", L"");
+    if (!diskCacheDirectory.empty())
+    {
+        size_t diskCacheSizeInMB = config(L"diskCacheSizeInMB", (size_t)0); // 0: no limit
+        bool diskCacheShared = config(L"diskCacheShared", false);
+        deserializer = std::make_shared<DiskChunkCache>(deserializer, diskCacheDirectory, (uint64_t)diskCacheSizeInMB * 1024 * 1024, diskCacheShared);
+    }
+
     int verbosity = config(L"verbosity", 0);
 
     // Pick up the randomizer, always picking up no randomization for the write mode.
@@ -113,7 +128,8 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
     // By default do not use omp threads for deserialization of sequences.
     // It makes sense to put it to true for cases when deserialization is CPU intensive,
     // i.e. decompression of images.
-    bool multiThreadedDeserialization = config(L"multiThreadedDeserialization", ContainsDeserializer(config, L"ImageDeserializer"));
+    bool multiThreadedDeserialization = config(L"multiThreadedDeserialization",
+        ContainsDeserializer(config, L"ImageDeserializer") || ContainsDeserializer(config, L"ImagePackDeserializer"));
     if (randomize)
     {
         // By default randomizing the whole data set.
@@ -147,12 +163,18 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
         }
 
         bool shouldPrefetch = true;
-        m_sequenceEnumerator = std::make_shared<BlockRandomizer>(verbosity, randomizationWindow, deserializer, shouldPrefetch, 
+        auto randomizer = std::make_shared<BlockRandomizer>(verbosity, randomizationWindow, deserializer, shouldPrefetch, 
             multiThreadedDeserialization, maxErrors, sampleBasedRandomizationWindow, GetRandomSeed(config));
+        randomizer->SetPrefetchConfiguration(config(L"numPrefetchChunks", (size_t)1), config(L"prefetchBufferSizeInBytes", (size_t)0), config(L"numPrefetchThreads", (size_t)1));
+        randomizer->SetSequenceLengthBuckets(GetSequenceLengthBuckets(config));
+        randomizer->SetBalancedChunkDistribution(config(L"balancedChunkDistribution", false));
+        m_sequenceEnumerator = randomizer;
     }
     else
     {
-        m_sequenceEnumerator = std::make_shared<NoRandomizer>(deserializer, multiThreadedDeserialization, maxErrors);
+        auto randomizer = std::make_shared<NoRandomizer>(deserializer, multiThreadedDeserialization, maxErrors);
+        randomizer->SetPrefetchConfiguration(config(L"numPrefetchChunks", (size_t)1), config(L"prefetchBufferSizeInBytes", (size_t)0), config(L"numPrefetchThreads", (size_t)1));
+        m_sequenceEnumerator = randomizer;
     }
 
     // In case when there are transforms, applying them to the data.
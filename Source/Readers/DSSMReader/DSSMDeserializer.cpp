@@ -0,0 +1,167 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include "DSSMDeserializer.h"
+#include "MappedChunk.h"
+#include "SequenceData.h"
+#include "StringUtil.h"
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+// A chunk of rows, used directly from the mapping; the sequences point to the values and indices in the file.
+class DSSMDeserializer::DSSMChunk : public MappedChunk
+{
+    const ChunkDescriptor& m_descriptor;
+    DSSMDeserializer& m_deserializer;
+
+public:
+    DSSMChunk(const ChunkDescriptor& descriptor, DSSMDeserializer& parent)
+        : MappedChunk(parent.m_file, descriptor.m_offset, descriptor.SizeInBytes()),
+          m_descriptor(descriptor), m_deserializer(parent)
+    {}
+
+    void GetSequence(size_t sequenceIndex, std::vector<SequenceDataPtr>& result) override
+    {
+        const auto& sequence = m_descriptor.Sequences()[sequenceIndex];
+        const byte* row = m_data + sequence.OffsetInChunk();
+
+        const int32_t nnz = *(const int32_t*)row;
+        if (nnz < 0 || (size_t)nnz > m_deserializer.m_streams[0].m_sampleLayout[0] ||
+            sizeof(int32_t) + nnz * (m_deserializer.m_elementSize + sizeof(int32_t)) > sequence.SizeInBytes())
+            RuntimeError("DSSMDeserializer: Invalid number of non-zero values (%d) in row %" PRIu64 " of the file '%ls'.",
+                         nnz, sequence.m_key, m_deserializer.m_fileName.c_str());
+
+        const byte* values = row + sizeof(int32_t);
+        const byte* indices = values + nnz * m_deserializer.m_elementSize;
+        auto data = std::make_shared<SparseSequenceView>(values, (const SparseIndexType*)indices, nnz, m_deserializer.m_streams[0].m_sampleLayout);
+        data->m_elementType = m_deserializer.m_precision;
+        data->m_key = { sequence.m_key, 0 };
+        result.assign(1, data);
+    }
+};
+
+DSSMDeserializer::DSSMDeserializer(CorpusDescriptorPtr corpus, const ConfigParameters& config, bool primary)
+    : DataDeserializerBase(primary)
+{
+    if (corpus && !corpus->IsNumericSequenceKeys())
+        InvalidArgument("DSSMDeserializer: Non-numeric sequence keys are not supported, the keys are the row numbers.");
+
+    m_fileName = (const wstring&)config(L"file");
+    m_verbosity = config(L"verbosity", 0);
+
+    string precision = config("precision", "float");
+    m_precision = AreEqualIgnoreCase(precision, "float") ? DataType::Float : DataType::Double;
+    m_elementSize = m_precision == DataType::Float ? sizeof(float) : sizeof(double);
+
+    std::vector<std::wstring> featureNames;
+    std::vector<std::wstring> labelNames;
+    GetFileConfigNames(config, featureNames, labelNames);
+    if (featureNames.size() != 1)
+        RuntimeError("DSSMDeserializer: Please specify a single feature section (with 'dim'), '%d' found.", (int)featureNames.size());
+
+    ConfigParameters featureConfig = config(featureNames[0]);
+    size_t dim = featureConfig(L"dim");
+    if (SparseIndexType(dim) < 0 || (size_t)SparseIndexType(dim) != dim)
+        RuntimeError("DSSMDeserializer: Dimension (%" PRIu64 ") of feature '%ls' is too large for an index type value.", dim, featureNames[0].c_str());
+
+    StreamInformation stream;
+    stream.m_id = 0;
+    stream.m_name = featureNames[0];
+    stream.m_storageFormat = StorageFormat::SparseCSC;
+    stream.m_elementType = m_precision;
+    stream.m_sampleLayout = NDShape({ dim });
+    m_streams.push_back(stream);
+
+    m_file = std::make_shared<MappedFile>(m_fileName);
+    BuildIndex(config(L"chunkSizeInBytes", (size_t)32 * 1024 * 1024));
+}
+
+void DSSMDeserializer::BuildIndex(size_t chunkSize)
+{
+    const size_t headerSize = sizeof(int64_t) + sizeof(int32_t) + sizeof(int64_t);
+    const uint64_t fileSize = m_file->Size();
+    if (fileSize < headerSize)
+        RuntimeError("DSSMDeserializer: The file '%ls' is too small for its header.", m_fileName.c_str());
+
+    // (the header is packed, its values are not aligned)
+    int64_t numRows;
+    memcpy(&numRows, m_file->Data(0, sizeof(int64_t)), sizeof(int64_t));
+    if (numRows <= 0 || (uint64_t)numRows > (fileSize - headerSize) / sizeof(int64_t))
+        RuntimeError("DSSMDeserializer: Invalid number of rows (%" PRId64 ") in the file '%ls'.", numRows, m_fileName.c_str());
+
+    const uint64_t dataStart = headerSize + numRows * sizeof(int64_t);
+    const byte* offsets = m_file->Data(headerSize, numRows * sizeof(int64_t));
+
+    // The rows themselves are not read here (but only once their chunk is used), so the index comes at the cost
+    // of reading the offsets.
+    m_index = std::make_unique<Index>(chunkSize, m_primary);
+    for (int64_t i = 0; i < numRows; i++)
+    {
+        int64_t begin, end;
+        memcpy(&begin, offsets + i * sizeof(int64_t), sizeof(int64_t));
+        if (i + 1 < numRows)
+            memcpy(&end, offsets + (i + 1) * sizeof(int64_t), sizeof(int64_t));
+        else
+            end = fileSize - dataStart;
+
+        if (begin < 0 || end < begin + (int64_t)sizeof(int32_t) || dataStart + end > fileSize)
+            RuntimeError("DSSMDeserializer: Invalid offset of row %" PRId64 " in the file '%ls'.", i, m_fileName.c_str());
+
+        m_index->AddSequence(SequenceDescriptor{ (size_t)i, 1 }, dataStart + begin, dataStart + end);
+    }
+
+    m_file->DontNeed(0, fileSize);
+    m_index->MapSequenceKeyToLocation();
+
+    if (m_verbosity > 0)
+        fprintf(stderr, "DSSMDeserializer: %" PRId64 " rows in %zu chunks in the file '%ls'.\n",
+                numRows, m_index->Chunks().size(), m_fileName.c_str());
+}
+
+std::vector<ChunkInfo> DSSMDeserializer::ChunkInfos()
+{
+    std::vector<ChunkInfo> result;
+    result.reserve(m_index->Chunks().size());
+    for (const auto& chunk : m_index->Chunks())
+    {
+        ChunkInfo c;
+        c.m_id = (ChunkIdType)result.size();
+        c.m_numberOfSamples = c.m_numberOfSequences = chunk.Sequences().size();
+        result.push_back(c);
+    }
+    return result;
+}
+
+void DSSMDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result)
+{
+    const auto& sequences = m_index->Chunks()[chunkId].Sequences();
+    result.reserve(sequences.size());
+    for (size_t i = 0; i < sequences.size(); i++)
+    {
+        SequenceInfo info;
+        info.m_chunkId = chunkId;
+        info.m_indexInChunk = i;
+        info.m_numberOfSamples = 1;
+        info.m_key = { sequences[i].m_key, 0 };
+        result.push_back(info);
+    }
+}
+
+ChunkPtr DSSMDeserializer::GetChunk(ChunkIdType chunkId)
+{
+    return std::make_shared<DSSMChunk>(m_index->Chunks()[chunkId], *this);
+}
+
+bool DSSMDeserializer::GetSequenceInfoByKey(const SequenceKey& key, SequenceInfo& result)
+{
+    return DataDeserializerBase::GetSequenceInfoByKey(*m_index, key, result);
+}
+
+}
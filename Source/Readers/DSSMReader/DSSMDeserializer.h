@@ -0,0 +1,59 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "DataDeserializerBase.h"
+#include "Config.h"
+#include "CorpusDescriptor.h"
+#include "Indexer.h"
+#include "MappedFile.h"
+
+namespace CNTK {
+
+// Deserializer for the binary files of the DSSM reader (one for the queries, one for the documents),
+// which are used directly from a memory mapping.
+// The file starts with the number of rows (int64), the number of columns (int32) and the total number of
+// non-zero values (int64), followed by the offset of each row (int64, relative to the end of the offsets),
+// and the rows: the number of non-zero values (int32), the values (of the configured 'precision') and their
+// row indices (int32).
+// The config has a single feature section ('dim') as for the DSSM reader, exposed as a sparse stream. The chunks
+// are 'chunkSizeInBytes' (32MB by default). The sequence keys are the row numbers, so that the deserializers
+// of the query and the document files can be bundled.
+class DSSMDeserializer : public DataDeserializerBase
+{
+public:
+    DSSMDeserializer(CorpusDescriptorPtr corpus, const Microsoft::MSR::CNTK::ConfigParameters& config, bool primary);
+
+    // Get chunk descriptions.
+    std::vector<ChunkInfo> ChunkInfos() override;
+
+    // Gets sequence descriptions for the chunk.
+    void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result) override;
+
+    // Get a chunk by id.
+    ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+protected:
+    // Gets sequence description by key.
+    bool GetSequenceInfoByKey(const SequenceKey& key, SequenceInfo& result) override;
+
+private:
+    class DSSMChunk;
+
+    // Builds the index from the row offsets of the file.
+    void BuildIndex(size_t chunkSize);
+
+    std::wstring m_fileName;
+    std::shared_ptr<MappedFile> m_file;
+    std::unique_ptr<Index> m_index;
+    DataType m_precision;
+    size_t m_elementSize;
+    unsigned int m_verbosity;
+
+    DISABLE_COPY_AND_MOVE(DSSMDeserializer);
+};
+
+}
@@ -0,0 +1,592 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "AudioDeserializer.h"
+#include "HTKSequenceData.h"
+#include "Basics.h"
+#include "fileutil.h"
+#include "StringUtil.h"
+#include "Globals.h"
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string.h>
+#include <unordered_set>
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+// Layout of the samples in an audio file.
+struct AudioFileFormat
+{
+    size_t m_dataOffset = 0;
+    size_t m_numberOfSamples = 0; // per channel
+    unsigned int m_channels = 1;
+    unsigned int m_bytesPerSample = 2;
+    bool m_isFloat = false;
+};
+
+static bool HasExtension(const string& path, const char* extension)
+{
+    const size_t length = strlen(extension);
+    return path.size() >= length && AreEqualIgnoreCase(path.substr(path.size() - length), string(extension));
+}
+
+static unsigned int ReadLittleEndian(const unsigned char* p, size_t bytes)
+{
+    unsigned int v = 0;
+    for (size_t i = 0; i < bytes; i++)
+        v |= (unsigned int)p[i] << (8 * i);
+    return v;
+}
+
+// Determines the sample layout of a wave file from its header, or of a headerless file from its size.
+static AudioFileFormat ReadAudioFormat(FILE* f, const string& path, size_t expectedSampleRate)
+{
+    AudioFileFormat format;
+    if (HasExtension(path, ".raw") || HasExtension(path, ".pcm"))
+    {
+        format.m_numberOfSamples = filesize(f) / 2;
+        return format;
+    }
+    if (HasExtension(path, ".flac"))
+        RuntimeError("AudioDeserializer: FLAC files are not supported, please convert '%s' to wave.", path.c_str());
+
+    unsigned char header[12];
+    freadOrDie(header, 1, sizeof(header), f);
+    if (memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0)
+        RuntimeError("AudioDeserializer: '%s' is not a RIFF wave file.", path.c_str());
+
+    bool hasFormat = false;
+    for (;;)
+    {
+        unsigned char chunkHeader[8];
+        if (fread(chunkHeader, 1, sizeof(chunkHeader), f) != sizeof(chunkHeader))
+            RuntimeError("AudioDeserializer: wave file '%s' has no data chunk.", path.c_str());
+        const size_t chunkSize = ReadLittleEndian(chunkHeader + 4, 4);
+        if (memcmp(chunkHeader, "data", 4) == 0)
+        {
+            if (!hasFormat)
+                RuntimeError("AudioDeserializer: wave file '%s' has no format chunk before its data.", path.c_str());
+            format.m_dataOffset = (size_t)ftell(f);
+            format.m_numberOfSamples = (min)(chunkSize, filesize(f) - format.m_dataOffset) / (format.m_bytesPerSample * format.m_channels);
+            return format;
+        }
+
+        if (memcmp(chunkHeader, "fmt ", 4) == 0)
+        {
+            if (chunkSize < 16 || chunkSize > 1024)
+                RuntimeError("AudioDeserializer: wave file '%s' has a malformed format chunk.", path.c_str());
+            vector<unsigned char> fmt(chunkSize + (chunkSize & 1));
+            freadOrDie(fmt.data(), 1, fmt.size(), f);
+            unsigned int formatTag = ReadLittleEndian(&fmt[0], 2);
+            if (formatTag == 0xFFFE && chunkSize >= 26) // WAVE_FORMAT_EXTENSIBLE, the format is in the sub format GUID
+                formatTag = ReadLittleEndian(&fmt[24], 2);
+            format.m_channels = ReadLittleEndian(&fmt[2], 2);
+            const size_t sampleRate = ReadLittleEndian(&fmt[4], 4);
+            const unsigned int bitsPerSample = ReadLittleEndian(&fmt[14], 2);
+            format.m_bytesPerSample = bitsPerSample / 8;
+            format.m_isFloat = formatTag == 3;
+
+            if (!((formatTag == 1 && bitsPerSample == 16) || (formatTag == 3 && bitsPerSample == 32)) || format.m_channels == 0)
+                RuntimeError("AudioDeserializer: wave file '%s' has an unsupported format (tag %u, %u bits, %u channels), "
+                             "only 16 bit PCM and 32 bit float are supported.", path.c_str(), formatTag, bitsPerSample, format.m_channels);
+            if (sampleRate != expectedSampleRate)
+                RuntimeError("AudioDeserializer: wave file '%s' has a sample rate of %zu Hz, expected are %zu Hz.", path.c_str(), sampleRate, expectedSampleRate);
+            hasFormat = true;
+        }
+        else
+        {
+            fseekOrDie(f, (long)(chunkSize + (chunkSize & 1)), SEEK_CUR);
+        }
+    }
+}
+
+// Reads the samples of the first channel of an audio file as floats in the 16 bit range.
+// (The samples are stored little endian, as are the supported platforms.)
+static void ReadAudio(const string& path, size_t expectedSampleRate, vector<float>& samples)
+{
+    FILE* f = fopenOrDie(path, "rb");
+    AudioFileFormat format = ReadAudioFormat(f, path, expectedSampleRate);
+    fseekOrDie(f, (long)format.m_dataOffset, SEEK_SET);
+
+    vector<char> data(format.m_numberOfSamples * format.m_channels * format.m_bytesPerSample);
+    if (!data.empty())
+        freadOrDie(data.data(), 1, data.size(), f);
+    fcloseOrDie(f);
+
+    samples.resize(format.m_numberOfSamples);
+    const size_t stride = format.m_channels * format.m_bytesPerSample;
+    for (size_t i = 0; i < format.m_numberOfSamples; i++)
+    {
+        const char* p = data.data() + i * stride;
+        if (format.m_isFloat)
+        {
+            float v;
+            memcpy(&v, p, sizeof(v));
+            samples[i] = v * 32768.0f;
+        }
+        else
+        {
+            int16_t v;
+            memcpy(&v, p, sizeof(v));
+            samples[i] = v;
+        }
+    }
+}
+
+// Number of samples of a signal of the given length after resampling it for a speed change by the given factor.
+static size_t PerturbedLength(size_t numberOfSamples, float speed)
+{
+    if (speed == 1 || numberOfSamples == 0)
+        return numberOfSamples;
+    return (size_t)((numberOfSamples - 1) / speed) + 1;
+}
+
+// Changes the speed (and pitch, as a tape played faster or slower) by resampling with linear interpolation.
+static void PerturbSpeed(const vector<float>& samples, float speed, vector<float>& result)
+{
+    result.resize(PerturbedLength(samples.size(), speed));
+    for (size_t i = 0; i < result.size(); i++)
+    {
+        const double position = i * (double)speed;
+        const size_t j = (size_t)position;
+        const float fraction = (float)(position - j);
+        result[i] = j + 1 < samples.size() ? samples[j] + fraction * (samples[j + 1] - samples[j]) : samples[j];
+    }
+}
+
+static size_t Hash(size_t v)
+{
+    return (size_t)(((uint64_t)v * 0x9E3779B97F4A7C15ull) >> 16);
+}
+
+AudioDeserializer::AudioDeserializer(
+    CorpusDescriptorPtr corpus,
+    const ConfigParameters& cfg,
+    bool primary)
+    : DataDeserializerBase(primary),
+      m_corpus(corpus),
+      m_verbosity(0),
+      m_chunkLoads(0)
+{
+    // TODO: This should be read in one place, potentially given by SGD.
+    m_frameMode = (ConfigValue)cfg("frameMode", "true");
+
+    m_verbosity = cfg(L"verbosity", 0);
+
+    ConfigParameters input = cfg(L"input");
+    auto inputName = input.GetMemberIds().front();
+    std::wstring precision = cfg(L"precision", L"float");
+    m_elementType = AreEqualIgnoreCase(precision, L"float") ? DataType::Float : DataType::Double;
+
+    ConfigParameters streamConfig = input(inputName);
+    ConfigHelper config(streamConfig);
+
+    LogMelFilterbankConfig featureConfig;
+    featureConfig.m_numberOfBins = config.GetFeatureDimension();
+    featureConfig.m_sampleRate = (size_t)(int)streamConfig(L"sampleRate", (int)featureConfig.m_sampleRate);
+    featureConfig.m_frameLengthMs = streamConfig(L"frameLengthMs", featureConfig.m_frameLengthMs);
+    featureConfig.m_frameShiftMs = streamConfig(L"frameShiftMs", featureConfig.m_frameShiftMs);
+    featureConfig.m_lowFrequency = streamConfig(L"lowFrequency", featureConfig.m_lowFrequency);
+    featureConfig.m_highFrequency = streamConfig(L"highFrequency", featureConfig.m_highFrequency);
+    featureConfig.m_preemphasis = streamConfig(L"preemphasis", featureConfig.m_preemphasis);
+    m_filterbank.reset(new LogMelFilterbank(featureConfig));
+    m_sampleRate = featureConfig.m_sampleRate;
+
+    m_contextWindow = config.GetContextWindow();
+    m_dimension = m_filterbank->Dimension() * (1 + m_contextWindow.first + m_contextWindow.second);
+
+    floatargvector speedFactors = streamConfig(L"speedPerturbation", "1.0");
+    m_speedFactors.assign(&speedFactors[0], &speedFactors[0] + speedFactors.size());
+    for (float speed : m_speedFactors)
+        if (speed <= 0)
+            InvalidArgument("AudioDeserializer: speed perturbation factors must be positive.");
+
+    floatargvector gainRange = streamConfig(L"volumePerturbation", "1.0");
+    if (gainRange.size() < 1 || gainRange.size() > 2 || gainRange[0] <= 0 || gainRange[gainRange.size() - 1] < gainRange[0])
+        InvalidArgument("AudioDeserializer: volumePerturbation must be a gain or a range of gains min:max with 0 < min <= max.");
+    m_minGain = gainRange[0];
+    m_maxGain = gainRange[gainRange.size() - 1];
+
+    fprintf(stderr, "AudioDeserializer: computing %zu log mel filterbank features per frame of %zu samples with a shift of %zu samples at %zu Hz\n",
+            m_filterbank->Dimension(), m_filterbank->FrameLength(), m_filterbank->FrameShift(), m_sampleRate);
+
+    InitializeChunkInfos(config);
+    InitializeStreams(inputName);
+}
+
+// Initializes chunks based on the configuration and the lengths of the audio files.
+void AudioDeserializer::InitializeChunkInfos(ConfigHelper& config)
+{
+    string scriptPath = config.GetScpFilePath();
+    string rootPath = config.GetRootPath();
+    string scpDir = config.GetScpDir();
+
+    fprintf(stderr, "Reading script file %s ...", scriptPath.c_str());
+
+    ifstream scp(scriptPath.c_str());
+    if (!scp)
+        RuntimeError("Failed to open input file: %s", scriptPath.c_str());
+
+    vector<Utterance> utterances;
+    {
+        string line;
+        while (getline(scp, line))
+        {
+            if (line.empty())
+                continue;
+            config.AdjustUtterancePath(rootPath, scpDir, line);
+
+            string key;
+            auto pos = line.find('=');
+            if (pos != string::npos)
+            {
+                key = line.substr(0, pos);
+                line = line.substr(pos + 1);
+            }
+            else
+            {
+                // same as for HTK features: the key is the file name without directory and extension
+                auto begin = line.find_last_of("/\\");
+                key = line.substr(begin == string::npos ? 0 : begin + 1);
+                key = key.substr(0, key.find_last_of('.'));
+            }
+
+            if (!m_corpus->IsIncluded(key))
+                continue;
+
+            Utterance utterance;
+            utterance.m_path = line;
+            utterance.m_id = m_corpus->KeyToId(key);
+            utterance.m_numberOfFrames = 0;
+            utterance.m_speed = m_speedFactors[Hash(utterance.m_id) % m_speedFactors.size()];
+            utterances.push_back(move(utterance));
+        }
+    }
+
+    if (scp.bad())
+        RuntimeError("An error occurred while reading input file: %s", scriptPath.c_str());
+
+    fprintf(stderr, " %zu entries\n", utterances.size());
+
+    // The number of frames is needed upfront, for the randomizer; only the headers are read here.
+    exception_ptr error;
+    mutex errorMutex;
+#pragma omp parallel for schedule(dynamic) num_threads(Globals::GetNumReaderOmpThreads())
+    for (long i = 0; i < (long)utterances.size(); i++)
+    {
+        try
+        {
+            auto& utterance = utterances[i];
+            msra::util::attempt(5, [&]()
+            {
+                FILE* f = fopenOrDie(utterance.m_path, "rb");
+                AudioFileFormat format = ReadAudioFormat(f, utterance.m_path, m_sampleRate);
+                fcloseOrDie(f);
+                size_t numberOfFrames = m_filterbank->NumberOfFrames(PerturbedLength(format.m_numberOfSamples, utterance.m_speed));
+                if (numberOfFrames > SequenceLenMax)
+                    RuntimeError("Maximum number of samples per sequence exceeded");
+                utterance.m_numberOfFrames = (uint32_t)numberOfFrames;
+            });
+        }
+        catch (...) // (exceptions must not leave the parallel region)
+        {
+            lock_guard<mutex> lock(errorMutex);
+            if (!error)
+                error = current_exception();
+        }
+    }
+    if (error)
+        rethrow_exception(error);
+
+    // TODO: We should be able to configure IO chunks based on size.
+    // We have 100 frames in a second, and a chunk constitutes of 15 minutes (as for HTK features).
+    const size_t ChunkFrames = 15 * 60 * 100; // number of frames to target for each chunk
+
+    unordered_set<size_t> uniqueIds;
+    size_t totalNumberOfFrames = 0, numberOfUtterances = 0, numberOfDuplicates = 0, numberOfEmpty = 0;
+    for (auto& utterance : utterances)
+    {
+        if (!uniqueIds.insert(utterance.m_id).second)
+        {
+            numberOfDuplicates++;
+            continue;
+        }
+        if (utterance.m_numberOfFrames == 0)
+        {
+            if (m_verbosity)
+                fprintf(stderr, "AudioDeserializer: skipping '%s', it is shorter than a frame\n", utterance.m_path.c_str());
+            numberOfEmpty++;
+            continue;
+        }
+
+        // if exceeding current entry--create a new one
+        if (m_chunks.empty() || m_chunks.back().m_totalFrames > ChunkFrames)
+            m_chunks.push_back(AudioChunkInfo());
+
+        auto& chunk = m_chunks.back();
+        if (!m_primary)
+            m_keyToChunkLocation.push_back(make_tuple(utterance.m_id, (ChunkIdType)(m_chunks.size() - 1), (uint32_t)chunk.m_utterances.size()));
+
+        chunk.m_firstFrame.push_back(chunk.m_totalFrames);
+        chunk.m_totalFrames += utterance.m_numberOfFrames;
+        totalNumberOfFrames += utterance.m_numberOfFrames;
+        numberOfUtterances++;
+        chunk.m_utterances.push_back(move(utterance));
+    }
+
+    sort(m_keyToChunkLocation.begin(), m_keyToChunkLocation.end(),
+        [](const tuple<size_t, ChunkIdType, uint32_t>& a, const tuple<size_t, ChunkIdType, uint32_t>& b)
+    {
+        return get<0>(a) < get<0>(b);
+    });
+
+    if (numberOfDuplicates)
+        fprintf(stderr, "WARNING: Number of duplicates is '%zu'. Only the first of each will be used. Consider switching to numeric sequence ids.\n", numberOfDuplicates);
+    if (numberOfEmpty)
+        fprintf(stderr, "WARNING: '%zu' utterances are shorter than a frame and will be skipped.\n", numberOfEmpty);
+
+    if (numberOfUtterances == 0)
+        RuntimeError("AudioDeserializer: No utterances to process.");
+
+    fprintf(stderr,
+        "AudioDeserializer: selected '%zu' utterances (%.1f hours) grouped into '%zu' chunks, "
+        "average chunk size: %.1f utterances, %.1f frames\n",
+        numberOfUtterances,
+        totalNumberOfFrames * m_filterbank->FrameShift() / (3600.0 * m_sampleRate),
+        m_chunks.size(),
+        numberOfUtterances / (double)m_chunks.size(),
+        totalNumberOfFrames / (double)m_chunks.size());
+}
+
+// Describes exposed stream - a single stream of features, as the HTKDeserializer.
+void AudioDeserializer::InitializeStreams(const wstring& featureName)
+{
+    StreamInformation stream;
+    stream.m_id = 0;
+    stream.m_name = featureName;
+    stream.m_sampleLayout = NDShape({ m_dimension });
+    stream.m_elementType = m_elementType;
+    stream.m_storageFormat = StorageFormat::Dense;
+    m_streams.push_back(stream);
+}
+
+// Gets information about available chunks.
+vector<ChunkInfo> AudioDeserializer::ChunkInfos()
+{
+    vector<ChunkInfo> chunks;
+    chunks.reserve(m_chunks.size());
+    for (ChunkIdType i = 0; i < m_chunks.size(); ++i)
+    {
+        ChunkInfo cd;
+        cd.m_id = i;
+        cd.m_numberOfSamples = m_chunks[i].m_totalFrames;
+        // In frame mode, each frame is represented as sequence.
+        cd.m_numberOfSequences = m_frameMode ? m_chunks[i].m_totalFrames : m_chunks[i].m_utterances.size();
+        chunks.push_back(cd);
+    }
+    return chunks;
+}
+
+// Gets sequences for a particular chunk.
+void AudioDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, vector<SequenceInfo>& result)
+{
+    const auto& chunk = m_chunks[chunkId];
+    result.reserve(m_frameMode ? chunk.m_totalFrames : chunk.m_utterances.size());
+    size_t offsetInChunk = 0;
+    for (const auto& utterance : chunk.m_utterances)
+    {
+        SequenceInfo f;
+        f.m_chunkId = chunkId;
+        f.m_key.m_sequence = utterance.m_id;
+        if (m_frameMode)
+        {
+            for (uint32_t k = 0; k < utterance.m_numberOfFrames; ++k)
+            {
+                f.m_key.m_sample = k;
+                f.m_indexInChunk = offsetInChunk++;
+                f.m_numberOfSamples = 1;
+                result.push_back(f);
+            }
+        }
+        else
+        {
+            f.m_key.m_sample = 0;
+            f.m_indexInChunk = offsetInChunk++;
+            f.m_numberOfSamples = utterance.m_numberOfFrames;
+            result.push_back(f);
+        }
+    }
+}
+
+void AudioDeserializer::ComputeFeatures(const Utterance& utterance, size_t chunkLoad, vector<float>& samples, vector<float>& features,
+                                        LogMelFilterbank::Workspace& workspace) const
+{
+    msra::util::attempt(5, [&]()
+    {
+        ReadAudio(utterance.m_path, m_sampleRate, samples);
+    });
+
+    const float* signal = samples.data();
+    size_t numberOfSamples = samples.size();
+    vector<float> perturbed;
+    if (utterance.m_speed != 1)
+    {
+        PerturbSpeed(samples, utterance.m_speed, perturbed);
+        signal = perturbed.data();
+        numberOfSamples = perturbed.size();
+    }
+
+    // Volume perturbation scales the power spectrum by gain^2, i.e. shifts the log energies by 2 log(gain).
+    float logGain = 0;
+    if (m_minGain != 1 || m_maxGain != 1)
+    {
+        mt19937 rng((unsigned int)Hash(utterance.m_id ^ Hash(chunkLoad)));
+        logGain = 2 * log(uniform_real_distribution<float>(m_minGain, m_maxGain)(rng));
+    }
+
+    m_filterbank->Compute(signal, numberOfSamples, logGain, features, workspace);
+    if (features.size() != utterance.m_numberOfFrames * m_filterbank->Dimension())
+        RuntimeError("AudioDeserializer: '%s' has changed since the reader was initialized.", utterance.m_path.c_str());
+}
+
+// Represents the features of all utterances of a chunk in memory. Given up to the randomizer.
+class AudioDeserializer::AudioChunk : public Chunk, boost::noncopyable
+{
+public:
+    AudioChunk(AudioDeserializer* parent, ChunkIdType chunkId) : m_parent(parent), m_chunkInfo(parent->m_chunks[chunkId])
+    {
+        const size_t chunkLoad = m_parent->m_chunkLoads++;
+        m_features.resize(m_chunkInfo.m_utterances.size());
+
+        // The utterances are independent; each thread has its own sample and FFT buffers.
+        exception_ptr error;
+        mutex errorMutex;
+#pragma omp parallel num_threads(Globals::GetNumReaderOmpThreads())
+        {
+            LogMelFilterbank::Workspace workspace;
+            vector<float> samples;
+#pragma omp for schedule(dynamic)
+            for (long i = 0; i < (long)m_features.size(); i++)
+            {
+                try
+                {
+                    m_parent->ComputeFeatures(m_chunkInfo.m_utterances[i], chunkLoad, samples, m_features[i], workspace);
+                }
+                catch (...) // (exceptions must not leave the parallel region)
+                {
+                    lock_guard<mutex> lock(errorMutex);
+                    if (!error)
+                        error = current_exception();
+                }
+            }
+        }
+        if (error)
+            rethrow_exception(error);
+
+        if (m_parent->m_verbosity)
+            fprintf(stderr, "AudioDeserializer: computed the features of %zu utterances (%zu frames) of chunk %u\n",
+                    m_features.size(), m_chunkInfo.m_totalFrames, (unsigned int)chunkId);
+    }
+
+    // Gets data for the sequence.
+    virtual void GetSequence(size_t sequenceId, vector<SequenceDataPtr>& result) override
+    {
+        size_t utteranceIndex = sequenceId;
+        size_t firstFrame = 0;
+        if (m_parent->m_frameMode)
+        {
+            const auto& starts = m_chunkInfo.m_firstFrame;
+            utteranceIndex = upper_bound(starts.begin(), starts.end(), sequenceId) - starts.begin() - 1;
+            firstFrame = sequenceId - starts[utteranceIndex];
+        }
+
+        const auto& utterance = m_chunkInfo.m_utterances[utteranceIndex];
+        const size_t sequenceLength = m_parent->m_frameMode ? 1 : utterance.m_numberOfFrames;
+
+        DenseSequenceDataPtr sequence;
+        if (m_parent->m_elementType == DataType::Double)
+            sequence = m_parent->FillSequenceData(m_parent->m_doubleBuffers, m_features[utteranceIndex], utterance.m_numberOfFrames, firstFrame, sequenceLength);
+        else
+            sequence = m_parent->FillSequenceData(m_parent->m_floatBuffers, m_features[utteranceIndex], utterance.m_numberOfFrames, firstFrame, sequenceLength);
+
+        sequence->m_key.m_sequence = utterance.m_id;
+        result.push_back(sequence);
+    }
+
+private:
+    AudioDeserializer* m_parent;
+    const AudioChunkInfo& m_chunkInfo;
+    vector<vector<float>> m_features; // per utterance, one column per frame
+};
+
+// Gets a data chunk with the specified chunk id.
+ChunkPtr AudioDeserializer::GetChunk(ChunkIdType chunkId)
+{
+    return make_shared<AudioChunk>(this, chunkId);
+}
+
+// Creates the features of a sequence, each frame augmented with its neighbors (repeating the first and last frame at the boundaries).
+template <class ElemType>
+DenseSequenceDataPtr AudioDeserializer::FillSequenceData(conc_stack<vector<ElemType>>& buffers, const vector<float>& utteranceFeatures,
+                                                         size_t numberOfFrames, size_t firstFrame, size_t sequenceLength)
+{
+    const size_t frameDimension = m_filterbank->Dimension();
+    auto features = make_shared<HTKSequenceData<ElemType>>(buffers, m_dimension, sequenceLength, m_streams.front().m_sampleLayout);
+    for (size_t i = 0; i < sequenceLength; i++)
+    {
+        auto destination = features->col(i);
+        const long frame = (long)(firstFrame + i);
+        for (long n = -(long)m_contextWindow.first; n <= (long)m_contextWindow.second; n++)
+        {
+            const long source = (min)((max)(frame + n, 0L), (long)numberOfFrames - 1);
+            const float* sourceFrame = utteranceFeatures.data() + source * frameDimension;
+            copy(sourceFrame, sourceFrame + frameDimension, destination.begin() + (n + m_contextWindow.first) * frameDimension);
+        }
+    }
+    return features;
+}
+
+// Gets sequence description by its key.
+bool AudioDeserializer::GetSequenceInfo(const SequenceInfo& primary, SequenceInfo& d)
+{
+    assert(!m_primary);
+    auto found = lower_bound(m_keyToChunkLocation.begin(), m_keyToChunkLocation.end(), make_tuple(primary.m_key.m_sequence, (ChunkIdType)0, (uint32_t)0),
+        [](const tuple<size_t, ChunkIdType, uint32_t>& a, const tuple<size_t, ChunkIdType, uint32_t>& b)
+    {
+        return get<0>(a) < get<0>(b);
+    });
+
+    if (found == m_keyToChunkLocation.end() || get<0>(*found) != primary.m_key.m_sequence)
+        return false;
+
+    const auto& chunk = m_chunks[get<1>(*found)];
+    const size_t utteranceIndex = get<2>(*found);
+    const auto& utterance = chunk.m_utterances[utteranceIndex];
+
+    d.m_chunkId = get<1>(*found);
+    d.m_numberOfSamples = m_frameMode ? 1 : utterance.m_numberOfFrames;
+    if (m_frameMode)
+    {
+        if (primary.m_key.m_sample >= utterance.m_numberOfFrames)
+            RuntimeError("Sequence with key '%s' has '%d' frame(s), whereas the primary sequence expects at least '%d' frames",
+                m_corpus->IdToKey(primary.m_key.m_sequence).c_str(), (int)utterance.m_numberOfFrames, (int)primary.m_key.m_sample + 1);
+        d.m_indexInChunk = chunk.m_firstFrame[utteranceIndex] + primary.m_key.m_sample;
+    }
+    else
+    {
+        d.m_indexInChunk = utteranceIndex;
+    }
+    return true;
+}
+
+}
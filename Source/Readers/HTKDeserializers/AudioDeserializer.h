@@ -0,0 +1,109 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "DataDeserializerBase.h"
+#include "Config.h"
+#include "CorpusDescriptor.h"
+#include "ConfigHelper.h"
+#include "ConcStack.h"
+#include "LogMelFilterbank.h"
+#include <atomic>
+#include <memory>
+#include <boost/noncopyable.hpp>
+
+namespace CNTK {
+
+// Class represents a deserializer of raw audio that computes log mel filterbank features on the fly.
+// The script file lists the audio files in the same "key=path" form as for the HTKDeserializer, the features are
+// computed when a chunk is loaded, in the reader's prefetch thread, and exposed in the same stream layout
+// as the HTKDeserializer exposes HTK features (including context window and frame mode).
+// Supported are RIFF wave files with 16 bit PCM or 32 bit float samples, and headerless 16 bit PCM (.raw, .pcm).
+// Optionally, the audio is perturbed in speed (per utterance, one factor out of a given set) and in volume
+// (per utterance and chunk load, a random gain out of a given range).
+class AudioDeserializer : public DataDeserializerBase, private boost::noncopyable
+{
+public:
+    AudioDeserializer(CorpusDescriptorPtr corpus, const ConfigParameters& config, bool primary);
+
+    // Get information about chunks.
+    virtual std::vector<ChunkInfo> ChunkInfos() override;
+
+    // Get information about particular chunk.
+    virtual void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result) override;
+
+    // Retrieves data for a chunk.
+    virtual ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+    // Gets sequence description by the primary one.
+    virtual bool GetSequenceInfo(const SequenceInfo& primary, SequenceInfo&) override;
+
+private:
+    class AudioChunk;
+
+    struct Utterance
+    {
+        std::string m_path;
+        size_t m_id;
+        uint32_t m_numberOfFrames;
+        float m_speed; // speed perturbation factor, 1 for none
+    };
+
+    struct AudioChunkInfo
+    {
+        std::vector<Utterance> m_utterances;
+        std::vector<size_t> m_firstFrame; // index of the first frame of each utterance inside the chunk
+        size_t m_totalFrames = 0;
+    };
+
+    // Initialization functions.
+    void InitializeChunkInfos(ConfigHelper& config);
+    void InitializeStreams(const std::wstring& featureName);
+
+    // Reads and perturbs the audio of an utterance and computes its features (without context window).
+    void ComputeFeatures(const Utterance& utterance, size_t chunkLoad, std::vector<float>& samples, std::vector<float>& features,
+                         LogMelFilterbank::Workspace& workspace) const;
+
+    // Creates the features of a sequence with context window, in a buffer taken from the given pool.
+    template <class ElemType>
+    DenseSequenceDataPtr FillSequenceData(Microsoft::MSR::CNTK::conc_stack<std::vector<ElemType>>& buffers, const std::vector<float>& utteranceFeatures,
+                                          size_t numberOfFrames, size_t firstFrame, size_t sequenceLength);
+
+    CorpusDescriptorPtr m_corpus;
+    int m_verbosity;
+
+    // Flag that indicates whether a single speech frames should be exposed as a sequence.
+    bool m_frameMode;
+
+    // Type of the features.
+    DataType m_elementType;
+
+    // Feature computation, shared by all threads.
+    std::unique_ptr<LogMelFilterbank> m_filterbank;
+    size_t m_sampleRate;
+
+    // Dimension of the exposed features, including the context window.
+    size_t m_dimension;
+    std::pair<size_t, size_t> m_contextWindow;
+
+    // Perturbation.
+    std::vector<float> m_speedFactors;
+    float m_minGain;
+    float m_maxGain;
+    std::atomic<size_t> m_chunkLoads; // seeds the volume perturbation, so that it differs between loads of a chunk
+
+    std::vector<AudioChunkInfo> m_chunks;
+
+    // Used to correlate a sequence key with the utterance inside the chunk when deserializer is running not in primary mode.
+    // <key, chunkid, offset inside chunk>, sorted by key to be able to retrieve by binary search.
+    std::vector<std::tuple<size_t, ChunkIdType, uint32_t>> m_keyToChunkLocation;
+
+    // Pools of sequence buffers, reused by the sequences of all chunks (see HTKSequenceData).
+    Microsoft::MSR::CNTK::conc_stack<std::vector<float>> m_floatBuffers;
+    Microsoft::MSR::CNTK::conc_stack<std::vector<double>> m_doubleBuffers;
+};
+
+}
@@ -16,6 +16,8 @@
 #include "HeapMemoryProvider.h"
 #include "HTKDeserializer.h"
 #include "MLFDeserializer.h"
+#include "AudioDeserializer.h"
+#include "KaldiDeserializer.h"
 #include "StringUtil.h"
 #include "V2Dependencies.h"
 
@@ -65,6 +67,18 @@ extern "C" DATAREADER_API bool CreateDeserializer(DataDeserializerPtr& deseriali
     {
         deserializer = make_shared<MLFDeserializer>(corpus, deserializerConfig, primary);
     }
+    else if (type == L"AudioFeatureDeserializer")
+    {
+        deserializer = make_shared<AudioDeserializer>(corpus, deserializerConfig, primary);
+    }
+    else if (type == L"KaldiFeatureDeserializer")
+    {
+        deserializer = make_shared<KaldiDeserializer>(corpus, deserializerConfig, primary, /*alignments=*/false);
+    }
+    else if (type == L"KaldiAlignmentDeserializer")
+    {
+        deserializer = make_shared<KaldiDeserializer>(corpus, deserializerConfig, primary, /*alignments=*/true);
+    }
     else
     {
         // Unknown type.
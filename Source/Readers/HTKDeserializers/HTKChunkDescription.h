@@ -11,6 +11,9 @@
 #include "HTKFeaturesIO.h"
 #include "UtteranceDescription.h"
 #include "ssematrix.h"
+#include "Globals.h"
+#include <exception>
+#include <mutex>
 
 namespace CNTK {
 
@@ -134,18 +137,42 @@ public:
 
         try
         {
-            // feature reader (we reinstantiate it for each block, i.e. we reopen the file actually)
-            // if this is the first feature read ever, we explicitly open the first file to get the information such as feature dimension
-            htkfeatreader reader;
-
-            // read all utterances; if they are in the same archive, htkfeatreader will be efficient in not closing the file
             m_frames.resize(featureDimension, m_totalFrames);
-            foreach_index(i, m_utterances)
+
+            // The utterances are decoded in parallel, split into runs of consecutive utterances. Each run has its own
+            // feature reader (we reinstantiate it for each block, i.e. we reopen the file actually); if the utterances of
+            // a run are in the same archive, htkfeatreader will be efficient in not closing the file.
+            // There are a few runs per reader thread, so that the threads stay busy when the utterance lengths vary.
+            const size_t numberOfUtterances = m_utterances.size();
+            const int numberOfThreads = (int)std::min<size_t>(Microsoft::MSR::CNTK::Globals::GetNumReaderOmpThreads(), numberOfUtterances);
+            const size_t numberOfRuns = std::min<size_t>(4 * (size_t)numberOfThreads, numberOfUtterances);
+
+            std::exception_ptr error;
+            std::mutex errorMutex;
+#pragma omp parallel for schedule(dynamic) num_threads(numberOfThreads)
+            for (long run = 0; run < (long)numberOfRuns; run++)
             {
-                // read features for this file
-                auto framesWrapper = GetUtteranceFrames(i);
-                reader.read(m_utterances[i].GetPath(), featureKind, samplePeriod, framesWrapper);
+                try
+                {
+                    htkfeatreader reader;
+                    const size_t begin = numberOfUtterances * run / numberOfRuns;
+                    const size_t end = numberOfUtterances * (run + 1) / numberOfRuns;
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        // read features for this file
+                        auto framesWrapper = GetUtteranceFrames(i);
+                        reader.read(m_utterances[i].GetPath(), featureKind, samplePeriod, framesWrapper);
+                    }
+                }
+                catch (...) // (exceptions must not leave the parallel region)
+                {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
             }
+            if (error)
+                std::rethrow_exception(error);
 
             if (verbosity)
             {
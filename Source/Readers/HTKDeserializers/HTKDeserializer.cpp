@@ -5,6 +5,7 @@
 
 #include "stdafx.h"
 #include "HTKDeserializer.h"
+#include "HTKSequenceData.h"
 #include "ConfigHelper.h"
 #include "Basics.h"
 #include "StringUtil.h"
@@ -405,104 +406,6 @@ ChunkPtr HTKDeserializer::GetChunk(ChunkIdType chunkId)
     return make_shared<HTKChunk>(this, chunkId);
 };
 
-// A matrix that stores all samples of a sequence without padding (differently from ssematrix).
-// The number of columns equals the number of samples in the sequence.
-// The number of rows equals the size of the feature vector of a sample (= dimensions).
-class FeatureMatrix
-{
-public:
-    FeatureMatrix(size_t numRows, size_t numColumns) : m_numRows(numRows), m_numColumns(numColumns)
-    {
-        m_data.resize(m_numRows * m_numColumns);
-    }
-
-    // Returns a reference to the column.
-    inline array_ref<float> col(size_t column)
-    {
-        return array_ref<float>(m_data.data() + m_numRows * column, m_numRows);
-    }
-
-    // Gets pointer to the data.
-    inline float* GetData()
-    {
-        return m_data.data();
-    }
-
-    // Gets the number of columns. It equals the number of samples in the sequence/utterance.
-    inline size_t GetNumberOfColumns() const
-    {
-        return m_numColumns;
-    }
-
-    // Gets total size in elements of stored features.
-    inline size_t GetTotalSize() const
-    {
-        return m_data.size();
-    }
-
-private:
-    // Features
-    std::vector<float> m_data;
-    // Number of rows = dimension of the feature
-    size_t m_numRows;
-    // Number of columns = number of samples in utterance.
-    size_t m_numColumns;
-};
-
-// This class stores sequence data for HTK for floats.
-struct HTKFloatSequenceData : DenseSequenceData
-{
-    HTKFloatSequenceData(FeatureMatrix&& data, const NDShape& frameShape) : m_buffer(data), m_frameShape(frameShape)
-    {
-        m_numberOfSamples = (uint32_t)data.GetNumberOfColumns();
-        if (m_numberOfSamples != data.GetNumberOfColumns())
-        {
-            RuntimeError("Maximum number of samples per sequence exceeded.");
-        }
-    }
-
-    const void* GetDataBuffer() override
-    {
-        return m_buffer.GetData();
-    }
-
-    const NDShape& GetSampleShape() override
-    {
-        return m_frameShape;
-    }
-
-private:
-    FeatureMatrix m_buffer;
-    const NDShape& m_frameShape;
-};
-
-// This class stores sequence data for HTK for doubles.
-struct HTKDoubleSequenceData : DenseSequenceData
-{
-    HTKDoubleSequenceData(FeatureMatrix& data, const NDShape& frameShape)
-        : m_buffer(data.GetData(), data.GetData() + data.GetTotalSize()),
-          m_frameShape(frameShape)
-    {
-        m_numberOfSamples = (uint32_t)data.GetNumberOfColumns();
-        if (m_numberOfSamples != data.GetNumberOfColumns())
-            RuntimeError("Maximum number of samples per sequence exceeded.");
-    }
-
-    const void* GetDataBuffer() override
-    {
-        return m_buffer.data();
-    }
-
-    const NDShape& GetSampleShape() override
-    {
-        return m_frameShape;
-    }
-
-private:
-    std::vector<double> m_buffer;
-    const NDShape& m_frameShape;
-};
-
 // Copies a source into a destination with the specified destination offset.
 static void CopyToOffset(const const_array_ref<float>& source, array_ref<float>& destination, size_t offset)
 {
@@ -510,14 +413,21 @@ static void CopyToOffset(const const_array_ref<float>& source, array_ref<float>&
     memcpy_s((char*)destination.begin() + sourceSize * offset, sourceSize, &source.front(), sourceSize);
 }
 
+// Same for double features, converting on the fly.
+static void CopyToOffset(const const_array_ref<float>& source, array_ref<double>& destination, size_t offset)
+{
+    std::copy(source.begin(), source.end(), destination.begin() + source.size() * offset);
+}
+
 // TODO: Move augmentation to the separate class outside of deserializer.
 // TODO: Check the CNTK Book why different left and right extents are not supported.
 // Augments a frame with a given index with frames to the left and right of it.
+template <class ElemType>
 static void AugmentNeighbors(const MatrixAsVectorOfVectors& utterance,
                              size_t frameIndex,
                              const size_t leftExtent,
                              const size_t rightExtent,
-                             array_ref<float>& destination)
+                             array_ref<ElemType>& destination)
 {
     CopyToOffset(utterance[frameIndex], destination, leftExtent);
 
@@ -536,6 +446,31 @@ static void AugmentNeighbors(const MatrixAsVectorOfVectors& utterance,
     }
 }
 
+// Creates the (augmented) features of a sequence in a buffer from the pool.
+template <class ElemType>
+DenseSequenceDataPtr HTKDeserializer::FillSequenceData(conc_stack<std::vector<ElemType>>& buffers, const HTKChunkInfo& chunkInfo,
+                                                       size_t utteranceIndex, size_t id, size_t utteranceLength,
+                                                       const MatrixAsVectorOfVectors& utteranceFrames)
+{
+    auto features = make_shared<HTKSequenceData<ElemType>>(buffers, m_dimension, utteranceLength, m_streams.front().m_sampleLayout);
+    if (m_frameMode)
+    {
+        // For frame mode augment a single frame.
+        size_t frameIndex = id - chunkInfo.GetStartFrameIndexInsideChunk(utteranceIndex);
+        auto fillIn = features->col(0);
+        AugmentNeighbors(utteranceFrames, frameIndex, m_augmentationWindow.first, m_augmentationWindow.second, fillIn);
+    }
+    else
+    {
+        for (size_t resultingIndex = 0; resultingIndex < utteranceLength; ++resultingIndex)
+        {
+            auto fillIn = features->col(resultingIndex);
+            AugmentNeighbors(utteranceFrames, m_expandToPrimary ? 0 : resultingIndex, m_augmentationWindow.first, m_augmentationWindow.second, fillIn);
+        }
+    }
+    return features;
+}
+
 // Get a sequence by its chunk id and sequence id.
 // Sequence ids are guaranteed to be unique inside a chunk.
 void HTKDeserializer::GetSequenceById(ChunkIdType chunkId, size_t id, vector<SequenceDataPtr>& r)
@@ -563,29 +498,12 @@ void HTKDeserializer::GetSequenceById(ChunkIdType chunkId, size_t id, vector<Seq
         utteranceLength = r.front()->m_numberOfSamples;
     }
 
-    FeatureMatrix features(m_dimension, utteranceLength);
-    if (m_frameMode)
-    {
-        // For frame mode augment a single frame.
-        size_t frameIndex = id - chunkInfo.GetStartFrameIndexInsideChunk(utteranceIndex);
-        auto fillIn = features.col(0);
-        AugmentNeighbors(utteranceFramesWrapper, frameIndex, m_augmentationWindow.first, m_augmentationWindow.second, fillIn);
-    }
-    else
-    {
-        for (size_t resultingIndex = 0; resultingIndex < utteranceLength; ++resultingIndex)
-        {
-            auto fillIn = features.col(resultingIndex);
-            AugmentNeighbors(utteranceFramesWrapper, m_expandToPrimary ? 0 : resultingIndex, m_augmentationWindow.first, m_augmentationWindow.second, fillIn);
-        }
-    }
-
     // Copy features to the sequence depending on the type.
     DenseSequenceDataPtr result;
     if (m_elementType == DataType::Double)
-        result = make_shared<HTKDoubleSequenceData>(features, m_streams.front().m_sampleLayout);
+        result = FillSequenceData(m_doubleBuffers, chunkInfo, utteranceIndex, id, utteranceLength, utteranceFramesWrapper);
     else if (m_elementType == DataType::Float)
-        result = make_shared<HTKFloatSequenceData>(std::move(features), m_streams.front().m_sampleLayout);
+        result = FillSequenceData(m_floatBuffers, chunkInfo, utteranceIndex, id, utteranceLength, utteranceFramesWrapper);
     else
         LogicError("Currently, HTK Deserializer supports only double and float types.");
 
@@ -11,10 +11,13 @@
 #include "UtteranceDescription.h"
 #include "HTKChunkDescription.h"
 #include "ConfigHelper.h"
+#include "ConcStack.h"
 #include <boost/noncopyable.hpp>
 
 namespace CNTK {
 
+class MatrixAsVectorOfVectors;
+
 // Class represents an HTK deserializer.
 // Provides a set of chunks/sequences to the upper layers.
 class HTKDeserializer : public DataDeserializerBase, private boost::noncopyable
@@ -50,6 +53,12 @@ private:
     // Gets sequence by its chunk id and id inside the chunk.
     void GetSequenceById(ChunkIdType chunkId, size_t id, std::vector<SequenceDataPtr>&);
 
+    // Creates the features of a sequence, in a buffer taken from the given pool.
+    template <class ElemType>
+    DenseSequenceDataPtr FillSequenceData(Microsoft::MSR::CNTK::conc_stack<std::vector<ElemType>>& buffers, const HTKChunkInfo& chunkInfo,
+                                          size_t utteranceIndex, size_t id, size_t utteranceLength,
+                                          const MatrixAsVectorOfVectors& utteranceFrames);
+
     // Dimension of features.
     size_t m_dimension;
 
@@ -82,6 +91,10 @@ private:
     // A flag that indicates whether the utterance should be extended to match the lenght of the utterance from the primary deserializer.
     // TODO: This should be moved to the packers when deserializers work in sequence mode only.
     bool m_expandToPrimary;
+
+    // Pools of sequence buffers, reused by the sequences of all chunks (see HTKSequenceData).
+    Microsoft::MSR::CNTK::conc_stack<std::vector<float>> m_floatBuffers;
+    Microsoft::MSR::CNTK::conc_stack<std::vector<double>> m_doubleBuffers;
 };
 
 typedef std::shared_ptr<HTKDeserializer> HTKDeserializerPtr;
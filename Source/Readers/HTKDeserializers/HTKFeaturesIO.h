@@ -23,6 +23,9 @@
 #include "simplesenonehmm.h"
 #include <array>
 #include <ReaderUtil.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 namespace CNTK {
 
@@ -410,6 +413,51 @@ private:
         this->vecbytesize = H.sampsize;
         this->hascrcc = hascrcc2;
     }
+
+    // decompress a vector of 16-bit values: v[k] = (x[k] + b[k]) / a[k], with the bytes of x[k] swapped if needed
+    // Eight values at a time where SSE2 is available; the division is kept (rather than a multiplication by 1/a[k])
+    // so that the results are the same as those of the scalar loop.
+    static void decompress(const short* x, const float* a, const float* b, float* v, size_t n, bool byteswapping)
+    {
+        size_t k = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+        for (; k + 8 <= n; k += 8)
+        {
+            __m128i shorts = _mm_loadu_si128((const __m128i*)(x + k));
+            if (byteswapping)
+                shorts = _mm_or_si128(_mm_slli_epi16(shorts, 8), _mm_srli_epi16(shorts, 8));
+            // sign-extend to 32 bits by moving each value into the upper half of a lane and shifting it back
+            const __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(shorts, shorts), 16));
+            const __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(shorts, shorts), 16));
+            _mm_storeu_ps(v + k, _mm_div_ps(_mm_add_ps(lo, _mm_loadu_ps(b + k)), _mm_loadu_ps(a + k)));
+            _mm_storeu_ps(v + k + 4, _mm_div_ps(_mm_add_ps(hi, _mm_loadu_ps(b + k + 4)), _mm_loadu_ps(a + k + 4)));
+        }
+#endif
+        for (; k < n; k++)
+            v[k] = ((byteswapping ? swapshort(x[k]) : x[k]) + b[k]) / a[k];
+    }
+
+    // widen a vector of bytes (idx format) to float, sixteen at a time where SSE2 is available
+    static void widen(const unsigned char* x, float* v, size_t n)
+    {
+        size_t k = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+        const __m128i zero = _mm_setzero_si128();
+        for (; k + 16 <= n; k += 16)
+        {
+            const __m128i bytes = _mm_loadu_si128((const __m128i*)(x + k));
+            const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+            const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+            _mm_storeu_ps(v + k, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+            _mm_storeu_ps(v + k + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+            _mm_storeu_ps(v + k + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+            _mm_storeu_ps(v + k + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+        }
+#endif
+        for (; k < n; k++)
+            v[k] = (float)x[k];
+    }
+
     void close() // force close the open file --use this in case of read failure
     {
         f = NULL; // assigning a new FILE* to f will close the old FILE* if any
@@ -492,19 +540,15 @@ public:
             // read into temp vector
             freadOrDie(tmpByteVector, featdim, f);
             v.resize(featdim);
-            foreach_index(k, v)
-                v[k] = (float)tmpByteVector[k];
+            widen(tmpByteVector.data(), v.data(), featdim);
         }
         else // need to decompress
         {
             // read into temp vector
             freadOrDie(tmp, featdim, f);
-            if (needbyteswapping)
-                msra::util::byteswap(tmp);
-            // 'decompress' it
+            // 'decompress' it, swapping the bytes on the way
             v.resize(tmp.size());
-            foreach_index(k, v)
-                v[k] = (tmp[k] + b[k]) / a[k];
+            decompress(tmp.data(), a.data(), b.data(), v.data(), tmp.size(), needbyteswapping);
         }
         curframe++;
     }
@@ -114,16 +114,21 @@ HTKMLFReader::HTKMLFReader(const ConfigParameters& readerConfig)
     // TODO: this should be bool. Change when config per deserializer is allowed.
     if (AreEqualIgnoreCase(readMethod, std::wstring(L"blockRandomize")))
     {
-        m_sequenceEnumerator = std::make_shared<BlockRandomizer>(verbosity, window, bundler, 
+        auto randomizer = std::make_shared<BlockRandomizer>(verbosity, window, bundler, 
             /*shouldPrefetch =*/ true,
             /*multithreadedGetNextSequences =*/ false, // default
             /*maxNumberOfInvalidSequences =*/ 0, // default
             /*sampleBasedRandomizationWindow =*/ true, // default
             GetRandomSeed(readerConfig));
+        randomizer->SetPrefetchConfiguration(readerConfig(L"numPrefetchChunks", (size_t)1), readerConfig(L"prefetchBufferSizeInBytes", (size_t)0), readerConfig(L"numPrefetchThreads", (size_t)1));
+        randomizer->SetSequenceLengthBuckets(GetSequenceLengthBuckets(readerConfig));
+        m_sequenceEnumerator = randomizer;
     }
     else if (AreEqualIgnoreCase(readMethod, std::wstring(L"none")))
     {
-        m_sequenceEnumerator = std::make_shared<NoRandomizer>(bundler);
+        auto randomizer = std::make_shared<NoRandomizer>(bundler);
+        randomizer->SetPrefetchConfiguration(readerConfig(L"numPrefetchChunks", (size_t)1), readerConfig(L"prefetchBufferSizeInBytes", (size_t)0), readerConfig(L"numPrefetchThreads", (size_t)1));
+        m_sequenceEnumerator = randomizer;
     }
     else
     {
@@ -0,0 +1,66 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// HTKSequenceData.h -- dense sequence data in pooled buffers, used by the feature deserializers
+//
+
+#pragma once
+
+#include "DataDeserializer.h"
+#include "ConcStack.h"
+#include "simple_checked_arrays.h"
+#include <vector>
+
+namespace CNTK {
+
+// Sequence data of HTK features: all samples of a sequence without padding (differently from ssematrix), one column per sample.
+// The buffer is taken from a pool of the deserializer and given back on destruction, so that (once the pool is warmed up)
+// reading a sequence does not allocate its payload; this matters especially in frame mode, with a sequence per frame.
+template <class ElemType>
+struct HTKSequenceData : DenseSequenceData
+{
+    HTKSequenceData(Microsoft::MSR::CNTK::conc_stack<std::vector<ElemType>>& buffers, size_t dimension, size_t numberOfSamples, const NDShape& frameShape)
+        : m_buffers(buffers), m_dimension(dimension), m_frameShape(frameShape)
+    {
+        m_numberOfSamples = (uint32_t)numberOfSamples;
+        if (m_numberOfSamples != numberOfSamples)
+            RuntimeError("Maximum number of samples per sequence exceeded.");
+
+        m_buffer = m_buffers.pop_or_create([]() { return std::vector<ElemType>(); });
+        m_buffer.resize(m_dimension * numberOfSamples);
+    }
+
+    ~HTKSequenceData()
+    {
+        // Giving the memory back.
+        m_buffers.push(std::move(m_buffer));
+    }
+
+    // Returns a reference to the column.
+    array_ref<ElemType> col(size_t column)
+    {
+        return array_ref<ElemType>(m_buffer.data() + m_dimension * column, m_dimension);
+    }
+
+    const void* GetDataBuffer() override
+    {
+        return m_buffer.data();
+    }
+
+    const NDShape& GetSampleShape() override
+    {
+        return m_frameShape;
+    }
+
+private:
+    Microsoft::MSR::CNTK::conc_stack<std::vector<ElemType>>& m_buffers;
+    std::vector<ElemType> m_buffer;
+    // Number of rows = dimension of the feature
+    size_t m_dimension;
+    const NDShape& m_frameShape;
+
+    DISABLE_COPY_AND_MOVE(HTKSequenceData);
+};
+
+}
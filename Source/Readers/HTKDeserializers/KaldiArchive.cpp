@@ -0,0 +1,238 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "KaldiArchive.h"
+#include <fstream>
+#include <string.h>
+
+namespace CNTK {
+
+using namespace std;
+
+vector<KaldiScpEntry> ReadKaldiScp(const string& path)
+{
+    ifstream scp(path.c_str());
+    if (!scp)
+        RuntimeError("Failed to open input file: %s", path.c_str());
+
+    vector<KaldiScpEntry> entries;
+    string line;
+    size_t lineNumber = 0;
+    while (getline(scp, line))
+    {
+        lineNumber++;
+        auto keyBegin = line.find_first_not_of(" \t\r");
+        if (keyBegin == string::npos)
+            continue;
+        auto keyEnd = line.find_first_of(" \t", keyBegin);
+        auto locationBegin = keyEnd == string::npos ? string::npos : line.find_first_not_of(" \t", keyEnd);
+        auto locationEnd = line.find_last_not_of(" \t\r");
+        if (locationBegin == string::npos)
+            RuntimeError("Kaldi script file '%s', line %zu: expected '<key> <archive>:<offset>'.", path.c_str(), lineNumber);
+
+        string location = line.substr(locationBegin, locationEnd + 1 - locationBegin);
+        if (location.back() == '|')
+            RuntimeError("Kaldi script file '%s', line %zu: pipes are not supported, please write the data into an archive first.", path.c_str(), lineNumber);
+
+        // The archive path may contain colons itself (e.g. a drive letter), the offset follows the last one.
+        auto colon = location.find_last_of(':');
+        char* end = nullptr;
+        unsigned long long offset = colon == string::npos ? 0 : strtoull(location.c_str() + colon + 1, &end, 10);
+        if (colon == string::npos || colon + 1 == location.size() || *end != 0 || location.find('[') != string::npos)
+            RuntimeError("Kaldi script file '%s', line %zu: expected an archive offset in '%s' (ranges are not supported).",
+                         path.c_str(), lineNumber, location.c_str());
+
+        KaldiScpEntry entry;
+        entry.m_key = line.substr(keyBegin, keyEnd - keyBegin);
+        entry.m_archive = location.substr(0, colon);
+        entry.m_offset = offset;
+        entries.push_back(move(entry));
+    }
+
+    if (scp.bad())
+        RuntimeError("An error occurred while reading input file: %s", path.c_str());
+    return entries;
+}
+
+// Reads a value of a basic type as written by Kaldi's WriteBasicType in binary mode: a byte with its size, then the value.
+static int32_t ReadKaldiInt32(const uint8_t*& p, const uint8_t* end, const string& name)
+{
+    if (end - p < 5 || *p != sizeof(int32_t))
+        RuntimeError("Kaldi object '%s' is malformed: expected a 32 bit integer.", name.c_str());
+    int32_t value;
+    memcpy(&value, p + 1, sizeof(value));
+    p += 5;
+    return value;
+}
+
+KaldiObjectHeader ParseKaldiHeader(const uint8_t* data, size_t available, const string& name)
+{
+    if (available < 2 || data[0] != 0 || data[1] != 'B')
+        RuntimeError("Kaldi object '%s' is not in binary format; text archives (ark,t) are not supported.", name.c_str());
+
+    const uint8_t* p = data + 2;
+    const uint8_t* end = data + available;
+    auto isToken = [&](const char* token)
+    {
+        const size_t length = strlen(token);
+        return (size_t)(end - p) > length && memcmp(p, token, length) == 0 && p[length] == ' ';
+    };
+
+    KaldiObjectHeader header;
+    header.m_minValue = 0;
+    header.m_range = 0;
+    size_t elementBytes = 0;
+    if (isToken("FM") || isToken("DM"))
+    {
+        header.m_format = *p == 'F' ? KaldiObjectFormat::FloatMatrix : KaldiObjectFormat::DoubleMatrix;
+        elementBytes = *p == 'F' ? sizeof(float) : sizeof(double);
+        p += 3;
+        int32_t rows = ReadKaldiInt32(p, end, name);
+        int32_t columns = ReadKaldiInt32(p, end, name);
+        if (rows < 0 || columns < 0)
+            RuntimeError("Kaldi matrix '%s' has a negative size.", name.c_str());
+        header.m_rows = rows;
+        header.m_columns = columns;
+    }
+    else if (isToken("CM") || isToken("CM2") || isToken("CM3"))
+    {
+        header.m_format = p[2] == ' ' ? KaldiObjectFormat::CompressedMatrix :
+                          p[2] == '2' ? KaldiObjectFormat::CompressedMatrix2 : KaldiObjectFormat::CompressedMatrix3;
+        p += header.m_format == KaldiObjectFormat::CompressedMatrix ? 3 : 4;
+
+        // The global header without its format field: minimum, range, rows, columns.
+        if (end - p < 16)
+            RuntimeError("Kaldi compressed matrix '%s' is truncated.", name.c_str());
+        int32_t rows, columns;
+        memcpy(&header.m_minValue, p, 4);
+        memcpy(&header.m_range, p + 4, 4);
+        memcpy(&rows, p + 8, 4);
+        memcpy(&columns, p + 12, 4);
+        p += 16;
+        if (rows < 0 || columns < 0)
+            RuntimeError("Kaldi matrix '%s' has a negative size.", name.c_str());
+        header.m_rows = rows;
+        header.m_columns = columns;
+        elementBytes = header.m_format == KaldiObjectFormat::CompressedMatrix2 ? 2 : 1;
+    }
+    else if (end - p >= 1 && *p == sizeof(int32_t))
+    {
+        // (vectors have no token, only their size)
+        header.m_format = KaldiObjectFormat::Int32Vector;
+        int32_t size = ReadKaldiInt32(p, end, name);
+        if (size < 0)
+            RuntimeError("Kaldi vector '%s' has a negative size.", name.c_str());
+        header.m_rows = size;
+        header.m_columns = 1;
+        elementBytes = 1 + sizeof(int32_t); // each element is written with its size
+    }
+    else
+    {
+        RuntimeError("Kaldi object '%s' has an unsupported type; supported are matrices (FM, DM, CM, CM2, CM3) and int32 vectors.", name.c_str());
+    }
+
+    header.m_headerSize = p - data;
+    header.m_sizeInBytes = header.m_headerSize + (size_t)header.m_rows * header.m_columns * elementBytes;
+    if (header.m_format == KaldiObjectFormat::CompressedMatrix)
+        header.m_sizeInBytes += (size_t)header.m_columns * 4 * sizeof(uint16_t); // per column percentiles
+    return header;
+}
+
+// Dequantization of the "CM" format: each column has four percentiles, between which the bytes interpolate linearly.
+static inline float PercentileToFloat(const KaldiObjectHeader& header, uint16_t value)
+{
+    return header.m_minValue + header.m_range * 1.52590218966964e-05f * value;
+}
+
+static inline float ByteToFloat(float p0, float p25, float p75, float p100, uint8_t value)
+{
+    if (value <= 64)
+        return p0 + (p25 - p0) * value * (1 / 64.0f);
+    if (value <= 192)
+        return p25 + (p75 - p25) * (value - 64) * (1 / 128.0f);
+    return p75 + (p100 - p75) * (value - 192) * (1 / 63.0f);
+}
+
+void DecodeKaldiMatrix(const KaldiObjectHeader& header, const uint8_t* data, vector<float>& frames)
+{
+    const size_t rows = header.m_rows;
+    const size_t columns = header.m_columns;
+    const uint8_t* p = data + header.m_headerSize;
+    frames.resize(rows * columns);
+
+    switch (header.m_format)
+    {
+    case KaldiObjectFormat::FloatMatrix:
+        memcpy(frames.data(), p, frames.size() * sizeof(float));
+        break;
+
+    case KaldiObjectFormat::DoubleMatrix:
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            double value;
+            memcpy(&value, p + i * sizeof(double), sizeof(double));
+            frames[i] = (float)value;
+        }
+        break;
+
+    case KaldiObjectFormat::CompressedMatrix:
+    {
+        const uint8_t* bytes = p + columns * 4 * sizeof(uint16_t);
+        for (size_t c = 0; c < columns; c++, bytes += rows)
+        {
+            uint16_t percentiles[4];
+            memcpy(percentiles, p + c * sizeof(percentiles), sizeof(percentiles));
+            const float p0 = PercentileToFloat(header, percentiles[0]);
+            const float p25 = PercentileToFloat(header, percentiles[1]);
+            const float p75 = PercentileToFloat(header, percentiles[2]);
+            const float p100 = PercentileToFloat(header, percentiles[3]);
+            for (size_t r = 0; r < rows; r++)
+                frames[r * columns + c] = ByteToFloat(p0, p25, p75, p100, bytes[r]);
+        }
+        break;
+    }
+
+    case KaldiObjectFormat::CompressedMatrix2:
+    {
+        const float increment = header.m_range * (float)(1.0 / 65535.0);
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            uint16_t value;
+            memcpy(&value, p + i * sizeof(uint16_t), sizeof(uint16_t));
+            frames[i] = header.m_minValue + value * increment;
+        }
+        break;
+    }
+
+    case KaldiObjectFormat::CompressedMatrix3:
+    {
+        const float increment = header.m_range * (float)(1.0 / 255.0);
+        for (size_t i = 0; i < frames.size(); i++)
+            frames[i] = header.m_minValue + p[i] * increment;
+        break;
+    }
+
+    default:
+        LogicError("DecodeKaldiMatrix: the object is not a matrix.");
+    }
+}
+
+void DecodeKaldiVector(const KaldiObjectHeader& header, const uint8_t* data, vector<int32_t>& values)
+{
+    if (header.m_format != KaldiObjectFormat::Int32Vector)
+        LogicError("DecodeKaldiVector: the object is not an int32 vector.");
+
+    const uint8_t* p = data + header.m_headerSize;
+    values.resize(header.m_rows);
+    for (size_t i = 0; i < values.size(); i++, p += 1 + sizeof(int32_t))
+    {
+        if (*p != sizeof(int32_t))
+            RuntimeError("Kaldi int32 vector is malformed at element %zu.", i);
+        memcpy(&values[i], p + 1, sizeof(int32_t));
+    }
+}
+
+}
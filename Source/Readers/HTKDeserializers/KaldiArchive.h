@@ -0,0 +1,59 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "Basics.h"
+
+namespace CNTK {
+
+// Location of an object in a Kaldi archive, as given by a line "<key> <archive>:<offset>" of a Kaldi script (.scp) file.
+struct KaldiScpEntry
+{
+    std::string m_key;
+    std::string m_archive;
+    uint64_t m_offset;
+};
+
+// Reads a Kaldi script file. Only entries that point into archives are supported (no pipes, no whole files).
+std::vector<KaldiScpEntry> ReadKaldiScp(const std::string& path);
+
+// Binary encodings of the objects in a Kaldi archive that can be read.
+enum class KaldiObjectFormat
+{
+    FloatMatrix,        // "FM", row major floats
+    DoubleMatrix,       // "DM", row major doubles
+    CompressedMatrix,   // "CM", one byte per element, quantized by per column percentiles, column major
+    CompressedMatrix2,  // "CM2", two bytes per element, quantized globally, row major
+    CompressedMatrix3,  // "CM3", one byte per element, quantized globally, row major
+    Int32Vector,        // an int32 vector as written by the Int32VectorWriter, e.g. the pdf ids of an alignment
+};
+
+// Describes an object of a Kaldi archive; a vector is described as a matrix with a single column.
+struct KaldiObjectHeader
+{
+    KaldiObjectFormat m_format;
+    uint32_t m_rows;          // frames
+    uint32_t m_columns;       // features per frame
+    size_t m_headerSize;      // number of bytes before the data
+    size_t m_sizeInBytes;     // number of bytes of the whole object, including the header
+    float m_minValue;         // (compressed matrices only) the quantization range
+    float m_range;
+};
+
+// Parses the header of the binary Kaldi object starting at 'data' (the offset given by the script file),
+// of which 'available' bytes can be accessed. 'name' identifies the object in error messages.
+KaldiObjectHeader ParseKaldiHeader(const uint8_t* data, size_t available, const std::string& name);
+
+// Decodes a matrix into its rows, one after the other (i.e. each frame is a column in CNTK terms).
+void DecodeKaldiMatrix(const KaldiObjectHeader& header, const uint8_t* data, std::vector<float>& frames);
+
+// Decodes an int32 vector.
+void DecodeKaldiVector(const KaldiObjectHeader& header, const uint8_t* data, std::vector<int32_t>& values);
+
+}
@@ -0,0 +1,487 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "KaldiDeserializer.h"
+#include "HTKSequenceData.h"
+#include "SequenceData.h"
+#include "Basics.h"
+#include "StringUtil.h"
+#include "Globals.h"
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+static float s_oneFloat = 1.0;
+static double s_oneDouble = 1.0;
+
+// Sparse one-hot labels of an utterance.
+template <class ElemType>
+struct KaldiLabelSequenceData : SparseSequenceData
+{
+    vector<ElemType> m_values;
+    vector<IndexType> m_indexBuffer;
+    const NDShape& m_frameShape;
+
+    KaldiLabelSequenceData(const vector<int32_t>& labels, const NDShape& frameShape)
+        : m_values(labels.size(), 1), m_indexBuffer(labels.begin(), labels.end()), m_frameShape(frameShape)
+    {
+        m_nnzCounts.resize(labels.size(), static_cast<IndexType>(1));
+        m_numberOfSamples = (uint32_t)labels.size();
+        m_totalNnzCount = static_cast<IndexType>(labels.size());
+        m_indices = m_indexBuffer.data();
+    }
+
+    const void* GetDataBuffer() override
+    {
+        return m_values.data();
+    }
+
+    const NDShape& GetSampleShape() override
+    {
+        return m_frameShape;
+    }
+};
+
+KaldiDeserializer::KaldiDeserializer(
+    CorpusDescriptorPtr corpus,
+    const ConfigParameters& cfg,
+    bool primary,
+    bool alignments)
+    : DataDeserializerBase(primary),
+      m_corpus(corpus),
+      m_verbosity(0),
+      m_alignments(alignments),
+      m_contextWindow(0, 0)
+{
+    // TODO: This should be read in one place, potentially given by SGD.
+    m_frameMode = (ConfigValue)cfg("frameMode", "true");
+
+    m_verbosity = cfg(L"verbosity", 0);
+
+    ConfigParameters input = cfg(L"input");
+    auto inputName = input.GetMemberIds().front();
+    std::wstring precision = cfg(L"precision", L"float");
+    m_elementType = AreEqualIgnoreCase(precision, L"float") ? DataType::Float : DataType::Double;
+
+    ConfigParameters streamConfig = input(inputName);
+    ConfigHelper config(streamConfig);
+    if (m_alignments)
+    {
+        m_frameDimension = 1;
+        m_dimension = config.GetLabelDimension();
+    }
+    else
+    {
+        m_frameDimension = config.GetFeatureDimension();
+        m_contextWindow = config.GetContextWindow();
+        m_dimension = m_frameDimension * (1 + m_contextWindow.first + m_contextWindow.second);
+    }
+
+    InitializeChunkInfos(config, m_frameDimension);
+    InitializeStreams(inputName);
+    if (m_alignments && m_frameMode)
+        InitializeReadOnlyArrayOfLabels();
+}
+
+// Initializes chunks based on the script file and the headers of the objects in the archives.
+void KaldiDeserializer::InitializeChunkInfos(ConfigHelper& config, size_t frameDimension)
+{
+    string scriptPath = config.GetScpFilePath();
+    fprintf(stderr, "Reading Kaldi script file %s ...", scriptPath.c_str());
+    vector<KaldiScpEntry> entries = ReadKaldiScp(scriptPath);
+    fprintf(stderr, " %zu entries\n", entries.size());
+
+    vector<Utterance> utterances;
+    vector<const KaldiScpEntry*> utteranceEntries;
+    utterances.reserve(entries.size());
+    utteranceEntries.reserve(entries.size());
+    unordered_map<string, uint32_t> archiveIndices;
+    for (const auto& entry : entries)
+    {
+        if (!m_corpus->IsIncluded(entry.m_key))
+            continue;
+
+        auto archive = archiveIndices.find(entry.m_archive);
+        if (archive == archiveIndices.end())
+        {
+            archive = archiveIndices.insert(make_pair(entry.m_archive, (uint32_t)m_archives.size())).first;
+            m_archives.push_back(unique_ptr<MappedFile>(new MappedFile(msra::strfun::utf16(entry.m_archive))));
+        }
+
+        Utterance utterance;
+        utterance.m_id = m_corpus->KeyToId(entry.m_key);
+        utterance.m_offset = entry.m_offset;
+        utterance.m_archive = archive->second;
+        utterance.m_numberOfFrames = 0;
+        utterance.m_sizeInBytes = 0;
+        utterances.push_back(utterance);
+        utteranceEntries.push_back(&entry);
+    }
+
+    // The number of frames is needed upfront, for the randomizer; only the headers are read here.
+    exception_ptr error;
+    mutex errorMutex;
+#pragma omp parallel for schedule(dynamic, 256) num_threads(Globals::GetNumReaderOmpThreads())
+    for (long i = 0; i < (long)utterances.size(); i++)
+    {
+        try
+        {
+            auto& utterance = utterances[i];
+            const auto& archive = *m_archives[utterance.m_archive];
+            const auto& entry = *utteranceEntries[i];
+            const string& name = entry.m_key;
+            if (utterance.m_offset >= archive.Size())
+                RuntimeError("Kaldi object '%s' is beyond the end of its archive '%s'.", name.c_str(), entry.m_archive.c_str());
+
+            const uint64_t available = (min)(archive.Size() - utterance.m_offset, (uint64_t)64);
+            KaldiObjectHeader header = ParseKaldiHeader(archive.Data(utterance.m_offset, available), (size_t)available, name);
+            if (utterance.m_offset + header.m_sizeInBytes > archive.Size())
+                RuntimeError("Kaldi object '%s' is truncated in its archive '%s'.", name.c_str(), entry.m_archive.c_str());
+            if (header.m_sizeInBytes > UINT32_MAX || header.m_rows > SequenceLenMax)
+                RuntimeError("Kaldi object '%s' is too large (%zu bytes, %u frames).", name.c_str(), header.m_sizeInBytes, (unsigned int)header.m_rows);
+            if (m_alignments != (header.m_format == KaldiObjectFormat::Int32Vector))
+                RuntimeError("Kaldi object '%s' is %s, expected %s.", name.c_str(),
+                             m_alignments ? "a matrix" : "a vector", m_alignments ? "an int32 vector of class ids" : "a feature matrix");
+            if (header.m_columns != frameDimension)
+                RuntimeError("Kaldi matrix '%s' has %u columns, whereas the configured feature dimension is %zu.",
+                             name.c_str(), (unsigned int)header.m_columns, frameDimension);
+
+            utterance.m_numberOfFrames = header.m_rows;
+            utterance.m_sizeInBytes = (uint32_t)header.m_sizeInBytes;
+        }
+        catch (...) // (exceptions must not leave the parallel region)
+        {
+            lock_guard<mutex> lock(errorMutex);
+            if (!error)
+                error = current_exception();
+        }
+    }
+    if (error)
+        rethrow_exception(error);
+
+    // TODO: We should be able to configure IO chunks based on size.
+    // We have 100 frames in a second, and a chunk constitutes of 15 minutes (as for HTK features).
+    const size_t ChunkFrames = 15 * 60 * 100; // number of frames to target for each chunk
+
+    unordered_set<size_t> uniqueIds;
+    size_t totalNumberOfFrames = 0, numberOfUtterances = 0, numberOfDuplicates = 0, numberOfEmpty = 0;
+    for (auto& utterance : utterances)
+    {
+        if (!uniqueIds.insert(utterance.m_id).second)
+        {
+            numberOfDuplicates++;
+            continue;
+        }
+        if (utterance.m_numberOfFrames == 0)
+        {
+            numberOfEmpty++;
+            continue;
+        }
+
+        // if exceeding current entry--create a new one
+        if (m_chunks.empty() || m_chunks.back().m_totalFrames > ChunkFrames)
+            m_chunks.push_back(KaldiChunkInfo());
+
+        auto& chunk = m_chunks.back();
+        if (!m_primary)
+            m_keyToChunkLocation.push_back(make_tuple(utterance.m_id, (ChunkIdType)(m_chunks.size() - 1), (uint32_t)chunk.m_utterances.size()));
+
+        chunk.m_firstFrame.push_back(chunk.m_totalFrames);
+        chunk.m_totalFrames += utterance.m_numberOfFrames;
+        totalNumberOfFrames += utterance.m_numberOfFrames;
+        numberOfUtterances++;
+        chunk.m_utterances.push_back(utterance);
+    }
+
+    sort(m_keyToChunkLocation.begin(), m_keyToChunkLocation.end(),
+        [](const tuple<size_t, ChunkIdType, uint32_t>& a, const tuple<size_t, ChunkIdType, uint32_t>& b)
+    {
+        return get<0>(a) < get<0>(b);
+    });
+
+    if (numberOfDuplicates)
+        fprintf(stderr, "WARNING: Number of duplicates is '%zu'. Only the first of each will be used. Consider switching to numeric sequence ids.\n", numberOfDuplicates);
+    if (numberOfEmpty)
+        fprintf(stderr, "WARNING: '%zu' utterances have no frames and will be skipped.\n", numberOfEmpty);
+
+    if (numberOfUtterances == 0)
+        RuntimeError("KaldiDeserializer: No utterances to process.");
+
+    fprintf(stderr,
+        "KaldiDeserializer: selected '%zu' utterances with '%zu' frames from '%zu' archives grouped into '%zu' chunks, "
+        "average chunk size: %.1f utterances, %.1f frames\n",
+        numberOfUtterances,
+        totalNumberOfFrames,
+        m_archives.size(),
+        m_chunks.size(),
+        numberOfUtterances / (double)m_chunks.size(),
+        totalNumberOfFrames / (double)m_chunks.size());
+}
+
+// Describes exposed stream - a single stream of features or labels.
+void KaldiDeserializer::InitializeStreams(const wstring& name)
+{
+    StreamInformation stream;
+    stream.m_id = 0;
+    stream.m_name = name;
+    stream.m_sampleLayout = NDShape({ m_dimension });
+    stream.m_elementType = m_elementType;
+    stream.m_storageFormat = m_alignments ? StorageFormat::SparseCSC : StorageFormat::Dense;
+    m_streams.push_back(stream);
+}
+
+void KaldiDeserializer::InitializeReadOnlyArrayOfLabels()
+{
+    m_categories.reserve(m_dimension);
+    m_categoryIndices.reserve(m_dimension);
+    for (size_t i = 0; i < m_dimension; ++i)
+    {
+        auto category = make_shared<CategorySequenceData>(m_streams.front().m_sampleLayout);
+        m_categoryIndices.push_back(static_cast<IndexType>(i));
+        category->m_indices = &(m_categoryIndices[i]);
+        category->m_nnzCounts.resize(1);
+        category->m_nnzCounts[0] = 1;
+        category->m_totalNnzCount = 1;
+        category->m_numberOfSamples = 1;
+        if (m_elementType == DataType::Float)
+            category->m_data = &s_oneFloat;
+        else
+            category->m_data = &s_oneDouble;
+        m_categories.push_back(category);
+    }
+}
+
+// Gets information about available chunks.
+vector<ChunkInfo> KaldiDeserializer::ChunkInfos()
+{
+    vector<ChunkInfo> chunks;
+    chunks.reserve(m_chunks.size());
+    for (ChunkIdType i = 0; i < m_chunks.size(); ++i)
+    {
+        ChunkInfo cd;
+        cd.m_id = i;
+        cd.m_numberOfSamples = m_chunks[i].m_totalFrames;
+        // In frame mode, each frame is represented as sequence.
+        cd.m_numberOfSequences = m_frameMode ? m_chunks[i].m_totalFrames : m_chunks[i].m_utterances.size();
+        chunks.push_back(cd);
+    }
+    return chunks;
+}
+
+// Gets sequences for a particular chunk.
+void KaldiDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, vector<SequenceInfo>& result)
+{
+    const auto& chunk = m_chunks[chunkId];
+    result.reserve(m_frameMode ? chunk.m_totalFrames : chunk.m_utterances.size());
+    size_t offsetInChunk = 0;
+    for (const auto& utterance : chunk.m_utterances)
+    {
+        SequenceInfo f;
+        f.m_chunkId = chunkId;
+        f.m_key.m_sequence = utterance.m_id;
+        if (m_frameMode)
+        {
+            for (uint32_t k = 0; k < utterance.m_numberOfFrames; ++k)
+            {
+                f.m_key.m_sample = k;
+                f.m_indexInChunk = offsetInChunk++;
+                f.m_numberOfSamples = 1;
+                result.push_back(f);
+            }
+        }
+        else
+        {
+            f.m_key.m_sample = 0;
+            f.m_indexInChunk = offsetInChunk++;
+            f.m_numberOfSamples = utterance.m_numberOfFrames;
+            result.push_back(f);
+        }
+    }
+}
+
+// Represents the decoded utterances of a chunk in memory. Given up to the randomizer.
+class KaldiDeserializer::KaldiChunk : public Chunk, boost::noncopyable
+{
+public:
+    KaldiChunk(KaldiDeserializer* parent, ChunkIdType chunkId) : m_parent(parent), m_chunkInfo(parent->m_chunks[chunkId])
+    {
+        const auto& utterances = m_chunkInfo.m_utterances;
+        if (m_parent->m_alignments)
+            m_labels.resize(utterances.size());
+        else
+            m_features.resize(utterances.size());
+
+        // Let the system read in all objects of the chunk before they are decoded (in parallel),
+        // and drop them from the process afterwards, they are copied into the chunk.
+        for (const auto& utterance : utterances)
+            m_parent->m_archives[utterance.m_archive]->WillNeed(utterance.m_offset, utterance.m_sizeInBytes);
+
+        exception_ptr error;
+        mutex errorMutex;
+#pragma omp parallel for schedule(dynamic) num_threads(Globals::GetNumReaderOmpThreads())
+        for (long i = 0; i < (long)utterances.size(); i++)
+        {
+            try
+            {
+                Decode(i);
+            }
+            catch (...) // (exceptions must not leave the parallel region)
+            {
+                lock_guard<mutex> lock(errorMutex);
+                if (!error)
+                    error = current_exception();
+            }
+        }
+        if (error)
+            rethrow_exception(error);
+
+        for (const auto& utterance : utterances)
+            m_parent->m_archives[utterance.m_archive]->DontNeed(utterance.m_offset, utterance.m_sizeInBytes);
+
+        if (m_parent->m_verbosity)
+            fprintf(stderr, "KaldiDeserializer: decoded %zu utterances (%zu frames) of chunk %u\n",
+                    utterances.size(), m_chunkInfo.m_totalFrames, (unsigned int)chunkId);
+    }
+
+    // Gets data for the sequence.
+    virtual void GetSequence(size_t sequenceId, vector<SequenceDataPtr>& result) override
+    {
+        size_t utteranceIndex = sequenceId;
+        size_t firstFrame = 0;
+        if (m_parent->m_frameMode)
+        {
+            const auto& starts = m_chunkInfo.m_firstFrame;
+            utteranceIndex = upper_bound(starts.begin(), starts.end(), sequenceId) - starts.begin() - 1;
+            firstFrame = sequenceId - starts[utteranceIndex];
+        }
+
+        const auto& utterance = m_chunkInfo.m_utterances[utteranceIndex];
+        if (m_parent->m_alignments)
+        {
+            if (m_parent->m_frameMode)
+            {
+                result.push_back(m_parent->m_categories[m_labels[utteranceIndex][firstFrame]]);
+                return;
+            }
+
+            SparseSequenceDataPtr sequence;
+            if (m_parent->m_elementType == DataType::Double)
+                sequence = make_shared<KaldiLabelSequenceData<double>>(m_labels[utteranceIndex], m_parent->m_streams.front().m_sampleLayout);
+            else
+                sequence = make_shared<KaldiLabelSequenceData<float>>(m_labels[utteranceIndex], m_parent->m_streams.front().m_sampleLayout);
+            sequence->m_key.m_sequence = utterance.m_id;
+            result.push_back(sequence);
+            return;
+        }
+
+        const size_t sequenceLength = m_parent->m_frameMode ? 1 : utterance.m_numberOfFrames;
+        DenseSequenceDataPtr sequence;
+        if (m_parent->m_elementType == DataType::Double)
+            sequence = m_parent->FillSequenceData(m_parent->m_doubleBuffers, m_features[utteranceIndex], utterance.m_numberOfFrames, firstFrame, sequenceLength);
+        else
+            sequence = m_parent->FillSequenceData(m_parent->m_floatBuffers, m_features[utteranceIndex], utterance.m_numberOfFrames, firstFrame, sequenceLength);
+
+        sequence->m_key.m_sequence = utterance.m_id;
+        result.push_back(sequence);
+    }
+
+private:
+    void Decode(size_t index)
+    {
+        const auto& utterance = m_chunkInfo.m_utterances[index];
+        const byte* data = m_parent->m_archives[utterance.m_archive]->Data(utterance.m_offset, utterance.m_sizeInBytes);
+        const string name = m_parent->m_corpus->IdToKey(utterance.m_id);
+        KaldiObjectHeader header = ParseKaldiHeader(data, utterance.m_sizeInBytes, name);
+        if (header.m_sizeInBytes != utterance.m_sizeInBytes || header.m_rows != utterance.m_numberOfFrames)
+            RuntimeError("Kaldi object '%s' has changed since the reader was initialized.", name.c_str());
+
+        if (!m_parent->m_alignments)
+        {
+            DecodeKaldiMatrix(header, data, m_features[index]);
+            return;
+        }
+
+        auto& labels = m_labels[index];
+        DecodeKaldiVector(header, data, labels);
+        for (auto label : labels)
+            if (label < 0 || (size_t)label >= m_parent->m_dimension)
+                RuntimeError("Kaldi alignment '%s' has the class id %d, whereas the label dimension is %zu.", name.c_str(), (int)label, m_parent->m_dimension);
+    }
+
+    KaldiDeserializer* m_parent;
+    const KaldiChunkInfo& m_chunkInfo;
+    vector<vector<float>> m_features; // per utterance, one column per frame
+    vector<vector<int32_t>> m_labels; // per utterance, one class id per frame
+};
+
+// Gets a data chunk with the specified chunk id.
+ChunkPtr KaldiDeserializer::GetChunk(ChunkIdType chunkId)
+{
+    return make_shared<KaldiChunk>(this, chunkId);
+}
+
+// Creates the features of a sequence, each frame augmented with its neighbors (repeating the first and last frame at the boundaries).
+template <class ElemType>
+DenseSequenceDataPtr KaldiDeserializer::FillSequenceData(conc_stack<vector<ElemType>>& buffers, const vector<float>& utteranceFeatures,
+                                                         size_t numberOfFrames, size_t firstFrame, size_t sequenceLength)
+{
+    const size_t frameDimension = m_frameDimension;
+    auto features = make_shared<HTKSequenceData<ElemType>>(buffers, m_dimension, sequenceLength, m_streams.front().m_sampleLayout);
+    for (size_t i = 0; i < sequenceLength; i++)
+    {
+        auto destination = features->col(i);
+        const long frame = (long)(firstFrame + i);
+        for (long n = -(long)m_contextWindow.first; n <= (long)m_contextWindow.second; n++)
+        {
+            const long source = (min)((max)(frame + n, 0L), (long)numberOfFrames - 1);
+            const float* sourceFrame = utteranceFeatures.data() + source * frameDimension;
+            copy(sourceFrame, sourceFrame + frameDimension, destination.begin() + (n + m_contextWindow.first) * frameDimension);
+        }
+    }
+    return features;
+}
+
+// Gets sequence description by its key.
+bool KaldiDeserializer::GetSequenceInfo(const SequenceInfo& primary, SequenceInfo& d)
+{
+    assert(!m_primary);
+    auto found = lower_bound(m_keyToChunkLocation.begin(), m_keyToChunkLocation.end(), make_tuple(primary.m_key.m_sequence, (ChunkIdType)0, (uint32_t)0),
+        [](const tuple<size_t, ChunkIdType, uint32_t>& a, const tuple<size_t, ChunkIdType, uint32_t>& b)
+    {
+        return get<0>(a) < get<0>(b);
+    });
+
+    if (found == m_keyToChunkLocation.end() || get<0>(*found) != primary.m_key.m_sequence)
+        return false;
+
+    const auto& chunk = m_chunks[get<1>(*found)];
+    const size_t utteranceIndex = get<2>(*found);
+    const auto& utterance = chunk.m_utterances[utteranceIndex];
+
+    d.m_chunkId = get<1>(*found);
+    d.m_numberOfSamples = m_frameMode ? 1 : utterance.m_numberOfFrames;
+    if (m_frameMode)
+    {
+        if (primary.m_key.m_sample >= utterance.m_numberOfFrames)
+            RuntimeError("Sequence with key '%s' has '%d' frame(s), whereas the primary sequence expects at least '%d' frames",
+                m_corpus->IdToKey(primary.m_key.m_sequence).c_str(), (int)utterance.m_numberOfFrames, (int)primary.m_key.m_sample + 1);
+        d.m_indexInChunk = chunk.m_firstFrame[utteranceIndex] + primary.m_key.m_sample;
+    }
+    else
+    {
+        d.m_indexInChunk = utteranceIndex;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,111 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "DataDeserializerBase.h"
+#include "Config.h"
+#include "CorpusDescriptor.h"
+#include "ConfigHelper.h"
+#include "ConcStack.h"
+#include "MappedFile.h"
+#include "KaldiArchive.h"
+#include <memory>
+#include <boost/noncopyable.hpp>
+
+namespace CNTK {
+
+// Class represents a deserializer of Kaldi archives, as an alternative to the Kaldi2Reader for the reader pipeline
+// with randomization, prefetching and distributed reading.
+// The utterances are given by a Kaldi script file ("<key> <archive>:<offset>" per line), which serves as the index:
+// the archives are memory mapped, and only the headers at the given offsets are read up front.
+// Two kinds of streams are supported:
+//  - features (KaldiFeatureDeserializer): float, double or compressed matrices with one row per frame,
+//    exposed as the HTKDeserializer exposes HTK features (including context window and frame mode);
+//  - alignments (KaldiAlignmentDeserializer): int32 vectors with one class id (e.g. pdf id) per frame, as written by ali-to-pdf,
+//    exposed as the MLFDeserializer exposes labels.
+// Only binary archives are supported, no pipes and no text archives.
+class KaldiDeserializer : public DataDeserializerBase, private boost::noncopyable
+{
+public:
+    KaldiDeserializer(CorpusDescriptorPtr corpus, const ConfigParameters& config, bool primary, bool alignments);
+
+    // Get information about chunks.
+    virtual std::vector<ChunkInfo> ChunkInfos() override;
+
+    // Get information about particular chunk.
+    virtual void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result) override;
+
+    // Retrieves data for a chunk.
+    virtual ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+    // Gets sequence description by the primary one.
+    virtual bool GetSequenceInfo(const SequenceInfo& primary, SequenceInfo&) override;
+
+private:
+    class KaldiChunk;
+
+    struct Utterance
+    {
+        size_t m_id;
+        uint64_t m_offset;          // of the object in its archive
+        uint32_t m_archive;         // index into m_archives
+        uint32_t m_numberOfFrames;
+        uint32_t m_sizeInBytes;     // of the object, including its header
+    };
+
+    struct KaldiChunkInfo
+    {
+        std::vector<Utterance> m_utterances;
+        std::vector<size_t> m_firstFrame; // index of the first frame of each utterance inside the chunk
+        size_t m_totalFrames = 0;
+    };
+
+    // Initialization functions.
+    void InitializeChunkInfos(ConfigHelper& config, size_t dimension);
+    void InitializeStreams(const std::wstring& name);
+    void InitializeReadOnlyArrayOfLabels();
+
+    // Creates the features of a sequence with context window, in a buffer taken from the given pool.
+    template <class ElemType>
+    DenseSequenceDataPtr FillSequenceData(Microsoft::MSR::CNTK::conc_stack<std::vector<ElemType>>& buffers, const std::vector<float>& utteranceFeatures,
+                                          size_t numberOfFrames, size_t firstFrame, size_t sequenceLength);
+
+    CorpusDescriptorPtr m_corpus;
+    int m_verbosity;
+
+    // True for a stream of alignments, false for features.
+    bool m_alignments;
+
+    // Flag that indicates whether a single speech frames should be exposed as a sequence.
+    bool m_frameMode;
+
+    // Type of the exposed data.
+    DataType m_elementType;
+
+    // Features per frame in the archives, and the exposed dimension (with context window for features, number of classes for alignments).
+    size_t m_frameDimension;
+    size_t m_dimension;
+    std::pair<size_t, size_t> m_contextWindow;
+
+    // The archives, mapped for the lifetime of the deserializer.
+    std::vector<std::unique_ptr<MappedFile>> m_archives;
+
+    std::vector<KaldiChunkInfo> m_chunks;
+
+    // Used to correlate a sequence key with the utterance inside the chunk when deserializer is running not in primary mode.
+    // <key, chunkid, offset inside chunk>, sorted by key to be able to retrieve by binary search.
+    std::vector<std::tuple<size_t, ChunkIdType, uint32_t>> m_keyToChunkLocation;
+
+    // Pools of sequence buffers, reused by the sequences of all chunks (see HTKSequenceData).
+    Microsoft::MSR::CNTK::conc_stack<std::vector<float>> m_floatBuffers;
+    Microsoft::MSR::CNTK::conc_stack<std::vector<double>> m_doubleBuffers;
+
+    // Read-only one-hot labels of all classes, exposed in frame mode (as by the MLFDeserializer).
+    std::vector<SparseSequenceDataPtr> m_categories;
+    std::vector<IndexType> m_categoryIndices;
+};
+
+}
@@ -0,0 +1,220 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "LogMelFilterbank.h"
+#include "Basics.h"
+#include <algorithm>
+#include <cmath>
+
+namespace CNTK {
+
+using namespace std;
+
+static const double Pi = 3.14159265358979323846;
+
+static double HzToMel(double hz)
+{
+    return 1127.0 * log(1.0 + hz / 700.0);
+}
+
+LogMelFilterbank::LogMelFilterbank(const LogMelFilterbankConfig& config)
+    : m_config(config)
+{
+    if (m_config.m_highFrequency <= 0)
+        m_config.m_highFrequency = m_config.m_sampleRate / 2.0;
+
+    m_frameLength = (size_t)(m_config.m_sampleRate * m_config.m_frameLengthMs / 1000 + 0.5);
+    m_frameShift = (size_t)(m_config.m_sampleRate * m_config.m_frameShiftMs / 1000 + 0.5);
+    if (m_frameLength < 2 || m_frameShift == 0)
+        InvalidArgument("LogMelFilterbank: frame length (%.1f ms) and frame shift (%.1f ms) are too short for the sample rate %zu.",
+                        m_config.m_frameLengthMs, m_config.m_frameShiftMs, m_config.m_sampleRate);
+    if (m_config.m_numberOfBins == 0)
+        InvalidArgument("LogMelFilterbank: the number of mel bins must not be 0.");
+    if (m_config.m_lowFrequency < 0 || m_config.m_lowFrequency >= m_config.m_highFrequency || m_config.m_highFrequency > m_config.m_sampleRate / 2.0)
+        InvalidArgument("LogMelFilterbank: invalid frequency range %.1f..%.1f Hz for the sample rate %zu.",
+                        m_config.m_lowFrequency, m_config.m_highFrequency, m_config.m_sampleRate);
+
+    m_fftSize = 4;
+    while (m_fftSize < m_frameLength)
+        m_fftSize *= 2;
+    const size_t halfSize = m_fftSize / 2;
+
+    m_window.resize(m_frameLength);
+    for (size_t i = 0; i < m_frameLength; i++)
+        m_window[i] = (float)(0.54 - 0.46 * cos(2 * Pi * i / (m_frameLength - 1)));
+
+    size_t log2HalfSize = 0;
+    while (((size_t)1 << log2HalfSize) < halfSize)
+        log2HalfSize++;
+    m_bitReversal.resize(halfSize);
+    for (size_t i = 0; i < halfSize; i++)
+    {
+        size_t reversed = 0;
+        for (size_t bit = 0; bit < log2HalfSize; bit++)
+            if (i & ((size_t)1 << bit))
+                reversed |= (size_t)1 << (log2HalfSize - 1 - bit);
+        m_bitReversal[i] = reversed;
+    }
+
+    m_twiddleRe.resize(halfSize);
+    m_twiddleIm.resize(halfSize);
+    for (size_t h = 1; h < halfSize; h *= 2)
+    {
+        for (size_t j = 0; j < h; j++)
+        {
+            m_twiddleRe[h + j] = (float)cos(-Pi * j / h);
+            m_twiddleIm[h + j] = (float)sin(-Pi * j / h);
+        }
+    }
+
+    m_realTwiddleRe.resize(halfSize + 1);
+    m_realTwiddleIm.resize(halfSize + 1);
+    for (size_t k = 0; k <= halfSize; k++)
+    {
+        m_realTwiddleRe[k] = (float)cos(-2 * Pi * k / m_fftSize);
+        m_realTwiddleIm[k] = (float)sin(-2 * Pi * k / m_fftSize);
+    }
+
+    // Triangular filters, equally spaced on the mel scale, over the power spectrum bins 0..halfSize.
+    const size_t numberOfBins = m_config.m_numberOfBins;
+    const double lowMel = HzToMel(m_config.m_lowFrequency);
+    const double melStep = (HzToMel(m_config.m_highFrequency) - lowMel) / (numberOfBins + 1);
+    m_filterBegin.resize(numberOfBins);
+    m_filterWeights.resize(numberOfBins);
+    for (size_t b = 0; b < numberOfBins; b++)
+    {
+        const double left = lowMel + b * melStep;
+        const double center = left + melStep;
+        const double right = center + melStep;
+        m_filterBegin[b] = 0;
+        for (size_t k = 0; k <= halfSize; k++)
+        {
+            const double mel = HzToMel((double)k * m_config.m_sampleRate / m_fftSize);
+            if (mel <= left || mel >= right)
+                continue;
+            if (m_filterWeights[b].empty())
+                m_filterBegin[b] = k;
+            // (bins between those with a non-zero weight cannot have a zero weight, so the weights are contiguous)
+            m_filterWeights[b].push_back((float)(mel <= center ? (mel - left) / melStep : (right - mel) / melStep));
+        }
+        if (m_filterWeights[b].empty())
+            InvalidArgument("LogMelFilterbank: mel bin %zu covers no FFT bin, use fewer bins or a longer frame.", b);
+    }
+}
+
+void LogMelFilterbank::HalfSizeFFT(float* re, float* im) const
+{
+    const size_t n = m_bitReversal.size();
+    for (size_t i = 0; i < n; i++)
+    {
+        const size_t j = m_bitReversal[i];
+        if (i < j)
+        {
+            swap(re[i], re[j]);
+            swap(im[i], im[j]);
+        }
+    }
+
+    // Radix-2 butterflies on the split arrays; the loop over j has unit stride in all of its arrays and no
+    // dependencies between iterations, so that the compiler vectorizes it.
+    for (size_t h = 1; h < n; h *= 2)
+    {
+        const float* wr = m_twiddleRe.data() + h;
+        const float* wi = m_twiddleIm.data() + h;
+        for (size_t k = 0; k < n; k += 2 * h)
+        {
+            float* r0 = re + k;
+            float* i0 = im + k;
+            float* r1 = re + k + h;
+            float* i1 = im + k + h;
+            for (size_t j = 0; j < h; j++)
+            {
+                const float tr = r1[j] * wr[j] - i1[j] * wi[j];
+                const float ti = r1[j] * wi[j] + i1[j] * wr[j];
+                r1[j] = r0[j] - tr;
+                i1[j] = i0[j] - ti;
+                r0[j] += tr;
+                i0[j] += ti;
+            }
+        }
+    }
+}
+
+void LogMelFilterbank::ComputeFrame(const float* samples, float logGain, float* features, Workspace& workspace) const
+{
+    const size_t halfSize = m_fftSize / 2;
+    float* frame = workspace.m_frame.data();
+
+    float mean = 0;
+    for (size_t i = 0; i < m_frameLength; i++)
+        mean += samples[i];
+    mean /= m_frameLength;
+    for (size_t i = 0; i < m_frameLength; i++)
+        frame[i] = samples[i] - mean;
+
+    const float preemphasis = m_config.m_preemphasis;
+    if (preemphasis != 0)
+    {
+        for (size_t i = m_frameLength - 1; i > 0; i--)
+            frame[i] -= preemphasis * frame[i - 1];
+        frame[0] -= preemphasis * frame[0];
+    }
+
+    for (size_t i = 0; i < m_frameLength; i++)
+        frame[i] *= m_window[i];
+    fill(frame + m_frameLength, frame + m_fftSize, 0.0f);
+
+    // Real FFT of size N through a complex FFT of size N/2 of z[n] = x[2n] + i x[2n+1]:
+    // X[k] = E[k] + e^(-2 pi i k / N) O[k] with E[k] = (Z[k] + conj(Z[N/2-k])) / 2 and O[k] = (Z[k] - conj(Z[N/2-k])) / 2i.
+    float* re = workspace.m_re.data();
+    float* im = workspace.m_im.data();
+    for (size_t i = 0; i < halfSize; i++)
+    {
+        re[i] = frame[2 * i];
+        im[i] = frame[2 * i + 1];
+    }
+    HalfSizeFFT(re, im);
+
+    float* power = workspace.m_power.data();
+    for (size_t k = 0; k <= halfSize; k++)
+    {
+        const size_t a = k % halfSize;
+        const size_t b = (halfSize - k) % halfSize;
+        const float er = (re[a] + re[b]) / 2;
+        const float ei = (im[a] - im[b]) / 2;
+        const float orr = (im[a] + im[b]) / 2;
+        const float oi = (re[b] - re[a]) / 2;
+        const float xr = er + m_realTwiddleRe[k] * orr - m_realTwiddleIm[k] * oi;
+        const float xi = ei + m_realTwiddleRe[k] * oi + m_realTwiddleIm[k] * orr;
+        power[k] = xr * xr + xi * xi;
+    }
+
+    for (size_t b = 0; b < m_filterWeights.size(); b++)
+    {
+        const float* weights = m_filterWeights[b].data();
+        const float* bins = power + m_filterBegin[b];
+        float energy = 0;
+        for (size_t i = 0; i < m_filterWeights[b].size(); i++)
+            energy += weights[i] * bins[i];
+        features[b] = log((max)(energy, m_config.m_energyFloor)) + logGain;
+    }
+}
+
+void LogMelFilterbank::Compute(const float* samples, size_t numberOfSamples, float logGain, vector<float>& features, Workspace& workspace) const
+{
+    workspace.m_frame.resize(m_fftSize);
+    workspace.m_re.resize(m_fftSize / 2);
+    workspace.m_im.resize(m_fftSize / 2);
+    workspace.m_power.resize(m_fftSize / 2 + 1);
+
+    const size_t numberOfFrames = NumberOfFrames(numberOfSamples);
+    const size_t dimension = Dimension();
+    features.resize(numberOfFrames * dimension);
+    for (size_t t = 0; t < numberOfFrames; t++)
+        ComputeFrame(samples + t * m_frameShift, logGain, features.data() + t * dimension, workspace);
+}
+
+}
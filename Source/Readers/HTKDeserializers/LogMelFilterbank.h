@@ -0,0 +1,102 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// LogMelFilterbank.h -- computation of log mel filterbank features from raw audio samples
+//
+
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+namespace CNTK {
+
+// Parameters of the log mel filterbank computation.
+// The defaults match the common 25 ms / 10 ms speech front end.
+struct LogMelFilterbankConfig
+{
+    size_t m_sampleRate = 16000;
+    double m_frameLengthMs = 25;
+    double m_frameShiftMs = 10;
+    size_t m_numberOfBins = 80;
+    double m_lowFrequency = 20;
+    double m_highFrequency = 0;  // 0 means the Nyquist frequency
+    float m_preemphasis = 0.97f; // 0 to disable
+    float m_energyFloor = 1e-10f; // floor of the filterbank energies before the log
+};
+
+// Computes log mel filterbank features of an utterance frame by frame:
+// DC removal, pre-emphasis, Hamming window, real FFT of the next power of two, power spectrum,
+// triangular mel filters, log.
+// All tables (window, twiddle factors, filters) are computed once in the constructor; Compute() only
+// reads them, so that a single instance can be shared by all reader threads, each with its own Workspace.
+class LogMelFilterbank
+{
+public:
+    // Per-thread scratch memory of Compute(). Kept across calls so that computing features does not allocate.
+    class Workspace
+    {
+        friend class LogMelFilterbank;
+        std::vector<float> m_frame;
+        std::vector<float> m_re;
+        std::vector<float> m_im;
+        std::vector<float> m_power;
+    };
+
+    explicit LogMelFilterbank(const LogMelFilterbankConfig& config);
+
+    size_t Dimension() const
+    {
+        return m_config.m_numberOfBins;
+    }
+
+    size_t FrameLength() const
+    {
+        return m_frameLength;
+    }
+
+    size_t FrameShift() const
+    {
+        return m_frameShift;
+    }
+
+    // Number of frames of an utterance with the given number of samples (frames do not extend beyond the signal).
+    size_t NumberOfFrames(size_t numberOfSamples) const
+    {
+        return numberOfSamples < m_frameLength ? 0 : 1 + (numberOfSamples - m_frameLength) / m_frameShift;
+    }
+
+    // Computes the features of all NumberOfFrames(numberOfSamples) frames into 'features', one column of Dimension()
+    // values per frame. 'logGain' is added to the log energies, it implements a volume change by exp(logGain / 2).
+    void Compute(const float* samples, size_t numberOfSamples, float logGain, std::vector<float>& features, Workspace& workspace) const;
+
+private:
+    void ComputeFrame(const float* samples, float logGain, float* features, Workspace& workspace) const;
+
+    // In-place complex FFT of size m_fftSize / 2 over split real and imaginary arrays.
+    void HalfSizeFFT(float* re, float* im) const;
+
+    LogMelFilterbankConfig m_config;
+    size_t m_frameLength;
+    size_t m_frameShift;
+    size_t m_fftSize;
+
+    std::vector<float> m_window;
+
+    // Tables of the half-size complex FFT: the bit reversal permutation, and the twiddle factors of all stages,
+    // those of the stage with butterflies of half size h at [h, 2h), so that the inner loop reads them contiguously.
+    std::vector<size_t> m_bitReversal;
+    std::vector<float> m_twiddleRe;
+    std::vector<float> m_twiddleIm;
+
+    // Twiddle factors e^(-2 pi i k / m_fftSize) that combine the half-size FFT into the real FFT.
+    std::vector<float> m_realTwiddleRe;
+    std::vector<float> m_realTwiddleIm;
+
+    // Mel filters: the weights of bin b apply to the power spectrum from m_filterBegin[b] on.
+    std::vector<size_t> m_filterBegin;
+    std::vector<std::vector<float>> m_filterWeights;
+};
+
+}
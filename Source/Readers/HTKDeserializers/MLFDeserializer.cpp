@@ -6,10 +6,12 @@
 #include "stdafx.h"
 #include <limits>
 #include "MLFDeserializer.h"
+#include "MLFLabelCache.h"
 #include "ConfigHelper.h"
 #include "SequenceData.h"
 #include "StringUtil.h"
 #include "ReaderConstants.h"
+#include "Globals.h"
 
 namespace CNTK {
 
@@ -74,11 +76,15 @@ protected:
     vector<char> m_buffer;   // Buffer for the whole chunk
     vector<bool> m_valid;    // Bit mask whether the parsed sequence is valid.
     MLFUtteranceParser m_parser;
+    vector<vector<MLFFrameRange>> m_cachedSequences; // Runs of the sequences, if read from the label cache instead of m_buffer.
 
     const MLFDeserializer& m_deserializer;
     const ChunkDescriptor& m_descriptor;     // Current chunk descriptor.
 
-    ChunkBase(const MLFDeserializer& deserializer, const ChunkDescriptor& descriptor, const wstring& fileName, const StateTablePtr& states)
+    // 'labelCache' is null if the labels are to be parsed from the MLF file, else they are read from the cache,
+    // where the chunk has the index 'chunkIndexInFile'.
+    ChunkBase(const MLFDeserializer& deserializer, const ChunkDescriptor& descriptor, const wstring& fileName, const StateTablePtr& states,
+              const MLFLabelCache* labelCache, size_t chunkIndexInFile)
         : m_parser(states),
           m_descriptor(descriptor),
           m_deserializer(deserializer)
@@ -86,27 +92,41 @@ protected:
         if (descriptor.Sequences().empty() || !descriptor.SizeInBytes())
             LogicError("Empty chunks are not supported.");
 
-        auto f = shared_ptr<FILE>(fopenOrDie(fileName, L"rbS"), [](FILE *f) { if (f) fclose(f); });
-        size_t sizeInBytes =
-            descriptor.Sequences().back().OffsetInChunk() + descriptor.Sequences().back().SizeInBytes();
-
-        // Make sure we always have 0 at the end for buffer overrun.
-        m_buffer.resize(sizeInBytes + 1);
-        m_buffer[sizeInBytes] = 0;
-
-        auto chunkOffset = descriptor.m_offset;
-
-        // Seek and read chunk into memory.
-        int rc = _fseeki64(f.get(), chunkOffset, SEEK_SET);
-        if (rc)
-            RuntimeError("Error seeking to position '%" PRId64 "' in the input file '%ls', error code '%d'", chunkOffset, fileName.c_str(), rc);
-
-        freadOrDie(m_buffer.data(), 1, sizeInBytes, f.get());
+        if (labelCache)
+        {
+            m_cachedSequences.resize(descriptor.Sequences().size());
+            labelCache->ReadChunk(chunkIndexInFile, m_cachedSequences);
+        }
+        else
+            ReadMLFChunk(fileName, descriptor, m_buffer);
 
         // all sequences are valid by default.
         m_valid.resize(m_descriptor.Sequences().size(), true);
     }
 
+    // Gets the runs of a sequence, parsing it from the buffer or taking it from the label cache.
+    // Returns false (after a warning) if the sequence cannot be parsed.
+    bool ParseSequence(const SequenceDescriptor& sequence, size_t index, vector<MLFFrameRange>& utterance)
+    {
+        bool parsed;
+        if (!m_cachedSequences.empty())
+        {
+            utterance = move(m_cachedSequences[index]);
+            parsed = !utterance.empty();
+        }
+        else
+        {
+            auto start = m_buffer.data() + sequence.OffsetInChunk();
+            auto end = start + sequence.SizeInBytes();
+            auto absoluteOffset = m_descriptor.m_offset + sequence.OffsetInChunk();
+            parsed = m_parser.Parse(boost::make_iterator_range(start, end), utterance, absoluteOffset);
+        }
+
+        if (!parsed)
+            fprintf(stderr, "WARNING: Cannot parse the utterance '%s'\n", KeyOf(sequence).c_str());
+        return parsed;
+    }
+
     string KeyOf(const SequenceDescriptor& s)
     {
         return m_deserializer.m_corpus->IdToKey(s.m_key);
@@ -117,6 +137,8 @@ protected:
         // Make sure we do not keep unnecessary memory after sequences have been parsed.
         vector<char> tmp;
         m_buffer.swap(tmp);
+        vector<vector<MLFFrameRange>> cached;
+        m_cachedSequences.swap(cached);
     }
 };
 
@@ -126,12 +148,13 @@ class MLFDeserializer::SequenceChunk : public MLFDeserializer::ChunkBase
     vector<vector<MLFFrameRange>> m_sequences; // Each sequence is a vector of sequential frame ranges.
 
 public:
-    SequenceChunk(const MLFDeserializer& parent, const ChunkDescriptor& descriptor, const wstring& fileName, StateTablePtr states)
-        : ChunkBase(parent, descriptor, fileName, states)
+    SequenceChunk(const MLFDeserializer& parent, const ChunkDescriptor& descriptor, const wstring& fileName, StateTablePtr states,
+                  const MLFLabelCache* labelCache, size_t chunkIndexInFile)
+        : ChunkBase(parent, descriptor, fileName, states, labelCache, chunkIndexInFile)
     {
         m_sequences.resize(m_descriptor.Sequences().size());
 
-#pragma omp parallel for schedule(dynamic)
+#pragma omp parallel for schedule(dynamic) num_threads(Globals::GetNumReaderOmpThreads())
         for (int i = 0; i < descriptor.Sequences().size(); ++i)
             CacheSequence(descriptor.Sequences()[i], i);
 
@@ -140,15 +163,9 @@ public:
 
     void CacheSequence(const SequenceDescriptor& sequence, size_t index)
     {
-        auto start = m_buffer.data() + sequence.OffsetInChunk();
-        auto end = start + sequence.SizeInBytes();
-
         vector<MLFFrameRange> utterance;
-        auto absoluteOffset = m_descriptor.m_offset + sequence.OffsetInChunk();
-        bool parsed = m_parser.Parse(boost::make_iterator_range(start, end), utterance, absoluteOffset);
-        if (!parsed) // cannot parse
+        if (!ParseSequence(sequence, index, utterance)) // cannot parse
         {
-            fprintf(stderr, "WARNING: Cannot parse the utterance '%s'\n", KeyOf(sequence).c_str());
             m_valid[index] = false;
             return;
         }
@@ -216,14 +233,15 @@ class MLFDeserializer::FrameChunk : public MLFDeserializer::ChunkBase
     vector<ClassIdType> m_classIds;
 
 public:
-    FrameChunk(const MLFDeserializer& parent, const ChunkDescriptor& descriptor, const wstring& fileName, StateTablePtr states)
-        : ChunkBase(parent, descriptor, fileName, states)
+    FrameChunk(const MLFDeserializer& parent, const ChunkDescriptor& descriptor, const wstring& fileName, StateTablePtr states,
+               const MLFLabelCache* labelCache, size_t chunkIndexInFile)
+        : ChunkBase(parent, descriptor, fileName, states, labelCache, chunkIndexInFile)
     {
         // Preallocate a big array for filling in class ids for the whole chunk.
         m_classIds.resize(m_descriptor.NumSamples());
 
         // Parse the data on different threads to avoid locking during GetSequence calls.
-#pragma omp parallel for schedule(dynamic)
+#pragma omp parallel for schedule(dynamic) num_threads(Globals::GetNumReaderOmpThreads())
         for (int i = 0; i < descriptor.Sequences().size(); ++i)
             CacheSequence(descriptor.Sequences()[i], i);
 
@@ -261,16 +279,10 @@ public:
     // Parses and caches sequence in the buffer for GetSequence fast retrieval.
     void CacheSequence(const SequenceDescriptor& sequence, size_t index)
     {
-        auto start = m_buffer.data() + sequence.OffsetInChunk();
-        auto end = start + sequence.SizeInBytes();
-
         vector<MLFFrameRange> utterance;
-        auto absoluteOffset = m_descriptor.m_offset + sequence.OffsetInChunk();
-        bool parsed = m_parser.Parse(boost::make_iterator_range(start, end), utterance, absoluteOffset);
-        if (!parsed)
+        if (!ParseSequence(sequence, index, utterance))
         {
             m_valid[index] = false;
-            fprintf(stderr, "WARNING: Cannot parse the utterance %s\n", KeyOf(sequence).c_str());
             return;
         }
 
@@ -302,6 +314,9 @@ MLFDeserializer::MLFDeserializer(CorpusDescriptorPtr corpus, const ConfigParamet
     // Same behavior as for the old deserializer - keep almost all in memory,
     // because there are a lot of none aligned sets.
     m_chunkSizeBytes = cfg(L"chunkSizeInBytes", g_64MB);
+    m_cacheLabels = cfg(L"cacheLabels", false);
+    m_cacheIndex = cfg(L"cacheIndex", false) || m_cacheLabels; // (the label cache is only valid together with the index)
+    m_numIndexingThreads = cfg(L"numIndexingThreads", (size_t)1);
 
     ConfigParameters input = cfg("input");
     auto inputName = input.GetMemberIds().front();
@@ -346,6 +361,9 @@ MLFDeserializer::MLFDeserializer(CorpusDescriptorPtr corpus, const ConfigParamet
     // Same behavior as for the old deserializer - keep almost all in memory,
     // because there are a lot of none aligned sets.
     m_chunkSizeBytes = labelConfig(L"chunkSizeInBytes", g_64MB);
+    m_cacheLabels = labelConfig(L"cacheLabels", false);
+    m_cacheIndex = labelConfig(L"cacheIndex", false) || m_cacheLabels; // (the label cache is only valid together with the index)
+    m_numIndexingThreads = labelConfig(L"numIndexingThreads", (size_t)1);
 
     wstring precision = labelConfig(L"precision", L"float");;
     m_elementType = AreEqualIgnoreCase(precision, L"float") ? DataType::Float : DataType::Double;
@@ -384,12 +402,25 @@ void MLFDeserializer::InitializeChunkInfos(CorpusDescriptorPtr corpus, const Con
         {
             auto file = shared_ptr<FILE>(fopenOrDie(path, L"rbS"), [](FILE *f) { if (f) fclose(f); });
             indexer = make_shared<MLFIndexer>(file.get(), m_frameMode, m_chunkSizeBytes);
+            if (m_cacheIndex)
+                indexer->EnableCache(path);
+            if (m_numIndexingThreads != 1)
+                indexer->EnableParallelBuild(path, m_numIndexingThreads);
             indexer->Build(corpus);
         });
 
         m_mlfFiles.push_back(path);
         m_indexers.push_back(make_pair(path, indexer));
 
+        MLFLabelCachePtr labelCache;
+        if (m_cacheLabels)
+        {
+            labelCache = make_shared<MLFLabelCache>(path, stateListPath);
+            if (!labelCache->LoadOrBuild(indexer->GetIndex(), m_stateTable))
+                labelCache = nullptr; // parse the text when loading chunks
+        }
+        m_labelCaches.push_back(labelCache);
+
         // Build auxiliary for GetSequenceByKey.
         const auto& index = indexer->GetIndex();
         for (uint32_t chunkIndex = 0; chunkIndex < index.Chunks().size(); ++chunkIndex)
@@ -485,12 +516,15 @@ ChunkPtr MLFDeserializer::GetChunk(ChunkIdType chunkId)
     attempt(5, [this, &result, chunkId]()
     {
         auto chunk = m_chunks[chunkId];
-        auto& fileName = m_mlfFiles[m_chunkToFileIndex[chunk]];
+        auto fileIndex = m_chunkToFileIndex[chunk];
+        auto& fileName = m_mlfFiles[fileIndex];
+        const MLFLabelCache* labelCache = m_labelCaches[fileIndex].get();
+        size_t chunkIndexInFile = chunk - m_indexers[fileIndex].second->GetIndex().Chunks().data();
 
         if (m_frameMode)
-            result = make_shared<FrameChunk>(*this, *chunk, fileName, m_stateTable);
+            result = make_shared<FrameChunk>(*this, *chunk, fileName, m_stateTable, labelCache, chunkIndexInFile);
         else
-            result = make_shared<SequenceChunk>(*this, *chunk, fileName, m_stateTable);
+            result = make_shared<SequenceChunk>(*this, *chunk, fileName, m_stateTable, labelCache, chunkIndexInFile);
     });
 
     return result;
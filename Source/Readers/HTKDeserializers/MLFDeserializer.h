@@ -10,6 +10,7 @@
 #include "CorpusDescriptor.h"
 #include "MLFUtils.h"
 #include "MLFIndexer.h"
+#include "MLFLabelCache.h"
 
 namespace CNTK {
 
@@ -79,10 +80,22 @@ private:
     // Track phone boundaries
     bool m_withPhoneBoundaries;
 
+    // If true, the indices of the MLF files are cached next to them (see IndexCache).
+    bool m_cacheIndex;
+
+    // If true, the parsed labels of the MLF files are cached next to them as well (see MLFLabelCache); implies m_cacheIndex.
+    bool m_cacheLabels;
+
+    // Number of threads the indices of the MLF files are built with (0 - one per hardware thread).
+    size_t m_numIndexingThreads;
+
     StateTablePtr m_stateTable;
 
     std::vector<std::pair<std::wstring, MLFIndexerPtr>> m_indexers;
     std::vector<std::wstring> m_mlfFiles;
+
+    // Label caches of the MLF files (null where not enabled or not available).
+    std::vector<MLFLabelCachePtr> m_labelCaches;
 };
 
 }
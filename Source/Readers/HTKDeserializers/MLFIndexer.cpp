@@ -6,8 +6,12 @@
 #define _CRT_SECURE_NO_WARNINGS
 #define _SCL_SECURE_NO_WARNINGS
 #include "MLFIndexer.h"
+#include "IndexCache.h"
 #include "MLFUtils.h"
 #include "ReaderUtil.h"
+#include "Globals.h"
+#include <future>
+#include <thread>
 
 namespace CNTK {
 
@@ -17,11 +21,24 @@ namespace CNTK {
         m_maxBufferSize(bufferSize),
         m_file(file),
         m_fileOffsetStart(0),
+        m_bytesToRead(SIZE_MAX),
         m_done(false),
-        m_index(chunkSize, true, frameMode)
+        m_index(chunkSize, true, frameMode),
+        m_numThreads(1),
+        m_minRangeSize(0)
     {
         if (!m_file)
             RuntimeError("Input file not open for reading");
+        m_fileOffsetEnd = filesize(m_file);
+    }
+
+    void MLFIndexer::SetRange(int64_t begin, int64_t end)
+    {
+        assert(m_buffer.empty() && m_fileOffsetStart == 0);
+        fsetpos(m_file, begin);
+        m_fileOffsetStart = begin;
+        m_fileOffsetEnd = end;
+        m_bytesToRead = static_cast<size_t>(end - begin);
     }
 
     void MLFIndexer::RefillBuffer()
@@ -38,9 +55,10 @@ namespace CNTK {
         // Copy last partial line if it was left during the last read.
         memcpy(&m_buffer[0], m_lastPartialLineInBuffer.data(), m_lastPartialLineInBuffer.size());
 
-        size_t bytesRead = fread(&m_buffer[0] + m_lastPartialLineInBuffer.size(), 1, m_buffer.size() - m_lastPartialLineInBuffer.size(), m_file);
+        size_t bytesRead = fread(&m_buffer[0] + m_lastPartialLineInBuffer.size(), 1, std::min(m_buffer.size() - m_lastPartialLineInBuffer.size(), m_bytesToRead), m_file);
         if (bytesRead == (size_t)-1)
             RuntimeError("Could not read from the input file.");
+        m_bytesToRead -= bytesRead;
 
         if (bytesRead == 0) // End of file reached.
         {
@@ -87,25 +105,139 @@ namespace CNTK {
         return distance(line.begin(), line.end()) == 1 && *line.begin() == '.';
     }
 
+    void MLFIndexer::EnableCache(const std::wstring& inputFile)
+    {
+        m_cache = make_shared<IndexCache>(inputFile, "MLFIndexer");
+    }
+
+    void MLFIndexer::EnableParallelBuild(const std::wstring& inputFile, size_t numThreads, size_t minRangeSize)
+    {
+        m_inputFile = inputFile;
+        m_numThreads = Microsoft::MSR::CNTK::Globals::GetNumReaderWorkerThreads(numThreads);
+        m_minRangeSize = minRangeSize;
+    }
+
+    void MLFIndexer::Build(CorpusDescriptorPtr corpus)
+    {
+        if (!m_index.IsEmpty())
+            return;
+
+        uint32_t flags;
+        if (m_cache && m_cache->TryLoadOrLock(corpus, m_index, flags))
+            return;
+
+        const size_t numRanges = std::min(m_numThreads, m_minRangeSize > 0 ? (size_t)m_fileOffsetEnd / m_minRangeSize : 1);
+        if (numRanges > 1)
+            BuildInParallel(corpus, numRanges);
+        else
+            BuildIndex(corpus);
+
+        if (m_cache)
+            m_cache->Save(corpus, m_index);
+    }
+
+    void MLFIndexer::BuildInParallel(CorpusDescriptorPtr corpus, size_t numRanges)
+    {
+        // The buffer has to hold complete lines only, so the utterance boundaries are looked for with a smaller one.
+        const size_t boundaryBufferSize = std::min(m_maxBufferSize, (size_t)1024 * 1024);
+        auto createIndexer = [&](FILE* file, int64_t begin, int64_t end, size_t bufferSize)
+        {
+            auto indexer = std::make_unique<MLFIndexer>(file, m_index.m_trackFirstSamples, m_index.m_maxChunkSize, bufferSize);
+            indexer->SetRange(begin, end);
+            return indexer;
+        };
+
+        // Split the input into ranges of whole utterances.
+        std::vector<int64_t> boundaries(1, 0);
+        for (size_t i = 1; i < numRanges; i++)
+        {
+            int64_t splitPoint = m_fileOffsetEnd / numRanges * i;
+            int64_t boundary = createIndexer(m_file, splitPoint - 1, m_fileOffsetEnd, boundaryBufferSize)->FindNextUtteranceBoundary();
+            if (boundary > boundaries.back() && boundary < m_fileOffsetEnd)
+                boundaries.push_back(boundary);
+        }
+        boundaries.push_back(m_fileOffsetEnd);
+        numRanges = boundaries.size() - 1;
+
+        // Index the ranges concurrently, each from its own file handle and with its own corpus; the keys are
+        // registered with the actual corpus when merging, in the order of the input.
+        // (The files are declared first, so that they are closed after all tasks are done, even if one fails.)
+        std::vector<shared_ptr<FILE>> files;
+        std::vector<CorpusDescriptorPtr> corpora;
+        std::vector<std::future<std::unique_ptr<MLFIndexer>>> tasks;
+        for (size_t i = 0; i < numRanges; i++)
+        {
+            files.push_back(shared_ptr<FILE>(fopenOrDie(m_inputFile, L"rbS"), [](FILE* f) { fclose(f); }));
+            corpora.push_back(make_shared<CorpusDescriptor>(corpus->IsNumericSequenceKeys()));
+            auto rangeSize = static_cast<size_t>(boundaries[i + 1] - boundaries[i]);
+            auto indexer = createIndexer(files.back().get(), boundaries[i], boundaries[i + 1], std::min(m_maxBufferSize, rangeSize));
+            tasks.push_back(std::async(std::launch::async, [](std::unique_ptr<MLFIndexer>&& indexer, CorpusDescriptorPtr corpus)
+            {
+                indexer->BuildIndex(corpus);
+                return std::move(indexer);
+            }, std::move(indexer), corpora.back()));
+        }
+
+        // Merge the indices in the order of the ranges.
+        for (size_t i = 0; i < numRanges; i++)
+        {
+            auto indexer = tasks[i].get();
+            auto rangeCorpus = corpora[i];
+            if (corpus->IsNumericSequenceKeys())
+                m_index.Append(indexer->GetIndex(), [](size_t id) { return id; });
+            else
+                m_index.Append(indexer->GetIndex(), [corpus, rangeCorpus](size_t id) { return corpus->KeyToId(rangeCorpus->IdToKey(id)); });
+        }
+
+        fprintf(stderr, "MLFIndexer: Indexed %zu ranges of the MLF file '%ls' in parallel.\n", numRanges, m_inputFile.c_str());
+    }
+
+    int64_t MLFIndexer::FindNextUtteranceBoundary()
+    {
+        vector<boost::iterator_range<char*>> lines;
+        bool firstLine = true;
+        for (RefillBuffer(); !m_done; RefillBuffer())
+        {
+            ReadLines(m_buffer, lines);
+            for (const auto& line : lines)
+            {
+                // The first line starts before the range (or is empty) and is skipped.
+                if (firstLine)
+                {
+                    firstLine = false;
+                    continue;
+                }
+
+                if (SingleDot(line))
+                {
+                    // The buffer only contains complete lines, i.e. the dot is followed by a new line.
+                    auto next = static_cast<char*>(memchr(line.end(), '\n', m_buffer.data() + m_buffer.size() - line.end()));
+                    assert(next != nullptr);
+                    return m_fileOffsetStart + (next + 1 - m_buffer.data());
+                }
+            }
+        }
+        return m_fileOffsetEnd;
+    }
+
     // Building an index of the MLF file:
     //     MLF file -> MLF Header [MLF Utterance]+
     //     MLF Utterance -> Key EOL [Frame Range EOL]+ "." EOL
     // MLF file should start with the MLF header (State::Header -> State:UtteranceKey).
     // Each utterance starts with an utterance key (State::UtteranceKey -> State::UtteranceFrames).
     // End of utterance is indicated by a single dot on a line (State::UtteranceFrames -> State::UtteranceKey)
-    void MLFIndexer::Build(CorpusDescriptorPtr corpus)
+    void MLFIndexer::BuildIndex(CorpusDescriptorPtr corpus)
     {
-        if (!m_index.IsEmpty())
-            return;
+        m_index.Reserve(m_fileOffsetEnd - m_fileOffsetStart);
 
-        m_index.Reserve(filesize(m_file));
+        // Only the beginning of the file has a header; ranges start with an utterance (see BuildInParallel()).
+        State currentState = m_fileOffsetStart == 0 ? State::Header : State::UtteranceKey;
 
         RefillBuffer(); // read the first block of data
         if (m_done)
             RuntimeError("Input file is empty");
 
         size_t id = 0;
-        State currentState = State::Header;
         vector<boost::iterator_range<char*>> lines, tokens;
         bool isValid = true;                    // Flag indicating whether the current sequence is valid.
         size_t lastNonEmptyString = 0;          // Needed to parse information about last frame
@@ -19,6 +19,14 @@ namespace CNTK {
 
         void Build(CorpusDescriptorPtr corpus);
 
+        // Makes Build() load the index from the index cache of the given MLF file (the one being indexed)
+        // if it is up to date, and otherwise save it there (see IndexCache).
+        void EnableCache(const std::wstring& inputFile);
+
+        // Makes Build() split the given MLF file (the one being indexed) into ranges of whole utterances,
+        // which are indexed concurrently (see Indexer::EnableParallelBuild()).
+        void EnableParallelBuild(const std::wstring& inputFile, size_t numThreads, size_t minRangeSize = 16 * 1024 * 1024);
+
         // Returns input data index (chunk and sequence metadata)
         const Index& GetIndex() const { return m_index; }
 
@@ -36,12 +44,35 @@ namespace CNTK {
         const size_t m_maxBufferSize;             // Max allowed buffer size.
         std::vector<char> m_buffer;               // Buffer for data.
         int64_t m_fileOffsetStart;                // Current start offset in file that is mapped to m_buffer.
+        int64_t m_fileOffsetEnd;                  // End of the input (or of the range being indexed, see SetRange()).
+        size_t m_bytesToRead;                     // Number of bytes that are left to be read from the file.
         std::string m_lastPartialLineInBuffer;    // Partial string from the previous read of m_buffer.
 
         Index m_index;
 
+        // cache to load the index from / save it to, if enabled
+        IndexCachePtr m_cache;
+
+        // input file and number of threads for building the index in parallel (see EnableParallelBuild())
+        std::wstring m_inputFile;
+        size_t m_numThreads;
+        size_t m_minRangeSize;
+
         std::string m_lastNonEmptyLine;           // Last non empty estring, used for parsing sequence length.
 
+        // Builds the index from the input file.
+        void BuildIndex(CorpusDescriptorPtr corpus);
+
+        // Builds the index from the given number of ranges of the input file in parallel.
+        void BuildInParallel(CorpusDescriptorPtr corpus, size_t numRanges);
+
+        // Restricts indexing to the part [begin, end) of the input file.
+        void SetRange(int64_t begin, int64_t end);
+
+        // Returns the offset of the line following the first utterance end (a single dot line) that starts
+        // after the beginning of the range set by SetRange() (the end of the range if there is none).
+        int64_t FindNextUtteranceBoundary();
+
         // fills up the buffer with data from file, all previously buffered data
         // will be overwritten.
         void RefillBuffer();
@@ -0,0 +1,266 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <string.h>
+#include "MLFLabelCache.h"
+#include "IndexCache.h"
+#include "fileutil.h"
+#include "Globals.h"
+
+namespace CNTK {
+
+using namespace std;
+
+const uint64_t MLFLabelCache::s_magic;
+const uint32_t MLFLabelCache::s_version;
+const uint32_t MLFLabelCache::s_invalidSequence;
+
+MLFLabelCache::MLFLabelCache(const wstring& mlfFile, const wstring& stateListPath)
+    : m_mlfFile(mlfFile), m_stateListPath(stateListPath), m_cacheFile(mlfFile + L".labels")
+{
+}
+
+bool MLFLabelCache::TryGetParameters(string& parameters) const
+{
+    uint64_t size;
+    int64_t modificationTime;
+    if (!IndexCache::TryGetFileInfo(m_mlfFile, size, modificationTime))
+        return false;
+    parameters = "mlf:" + to_string(size) + ":" + to_string(modificationTime);
+
+    if (!m_stateListPath.empty())
+    {
+        if (!IndexCache::TryGetFileInfo(m_stateListPath, size, modificationTime))
+            return false;
+        parameters += ";stateList:" + msra::strfun::utf8(m_stateListPath) + ":" +
+                      to_string(size) + ":" + to_string(modificationTime);
+    }
+    return true;
+}
+
+bool MLFLabelCache::LoadOrBuild(const Index& index, const StateTablePtr& states)
+{
+    if (TryLoad(index))
+        return true;
+    return Build(index, states);
+}
+
+bool MLFLabelCache::TryLoad(const Index& index)
+{
+    string parameters;
+    if (!TryGetParameters(parameters))
+        return false;
+
+    auto file = shared_ptr<FILE>(_wfopen(m_cacheFile.c_str(), L"rb"), [](FILE* f) { if (f) fclose(f); });
+    if (!file)
+        return false;
+
+    CacheReader reader(file.get());
+    bool valid = reader.Read<uint64_t>() == s_magic &&
+                 reader.Read<uint32_t>() == s_version &&
+                 reader.ReadString() == parameters &&
+                 reader.Read<uint64_t>() == index.Chunks().size();
+    for (size_t i = 0; valid && i < index.Chunks().size(); i++)
+        valid = reader.Read<uint32_t>() == index.Chunks()[i].Sequences().size();
+    if (!valid || !reader.Ok())
+    {
+        fprintf(stderr, "MLFLabelCache: Label cache '%ls' is out of date, rebuilding it.\n", m_cacheFile.c_str());
+        return false;
+    }
+
+    // The table of the chunk ranges is at the end, followed by its offset and the magic number.
+    uint64_t tableOffset = 0;
+    valid = _fseeki64(file.get(), -(int64_t)(2 * sizeof(uint64_t)), SEEK_END) == 0 &&
+            (tableOffset = reader.Read<uint64_t>(), reader.Read<uint64_t>() == s_magic) &&
+            _fseeki64(file.get(), tableOffset, SEEK_SET) == 0;
+    vector<pair<uint64_t, uint64_t>> chunkRanges(index.Chunks().size());
+    for (size_t i = 0; valid && i < chunkRanges.size(); i++)
+    {
+        chunkRanges[i].first = reader.Read<uint64_t>();
+        chunkRanges[i].second = reader.Read<uint64_t>();
+        valid = chunkRanges[i].first + chunkRanges[i].second <= tableOffset;
+    }
+    if (!valid || !reader.Ok())
+    {
+        fprintf(stderr, "WARNING: Label cache '%ls' is truncated or corrupt, rebuilding it.\n", m_cacheFile.c_str());
+        return false;
+    }
+
+    m_chunkRanges.swap(chunkRanges);
+    fprintf(stderr, "MLFLabelCache: Using the labels of '%ls' cached in '%ls'.\n", m_mlfFile.c_str(), m_cacheFile.c_str());
+    return true;
+}
+
+// Appends the runs of a sequence to the chunk record: the number of runs, their numbers of frames, their class ids.
+static void AppendSequence(const vector<MLFFrameRange>& utterance, bool valid, uint32_t invalidSequence, vector<char>& record)
+{
+    const uint32_t numRuns = valid ? (uint32_t)utterance.size() : invalidSequence;
+    const size_t begin = record.size();
+    record.resize(begin + sizeof(uint32_t) + (valid ? utterance.size() * (sizeof(uint32_t) + sizeof(ClassIdType)) : 0));
+    char* p = record.data() + begin;
+    memcpy(p, &numRuns, sizeof(numRuns));
+    p += sizeof(numRuns);
+    if (!valid)
+        return;
+    for (const auto& range : utterance)
+    {
+        const uint32_t numFrames = range.NumFrames();
+        memcpy(p, &numFrames, sizeof(numFrames));
+        p += sizeof(numFrames);
+    }
+    for (const auto& range : utterance)
+    {
+        const ClassIdType classId = range.ClassId();
+        memcpy(p, &classId, sizeof(classId));
+        p += sizeof(classId);
+    }
+}
+
+bool MLFLabelCache::Build(const Index& index, const StateTablePtr& states)
+{
+    string parameters;
+    if (!TryGetParameters(parameters))
+        return false;
+
+    fprintf(stderr, "MLFLabelCache: Parsing all labels of '%ls' for the label cache '%ls'...\n", m_mlfFile.c_str(), m_cacheFile.c_str());
+
+    // Write to a temporary file first, so that concurrent readers (e.g. the other workers of a distributed job)
+    // never see a partially written cache.
+    const wstring tempFile = m_cacheFile + L".tmp" + to_wstring(GetCurrentProcessId());
+    FILE* f = _wfopen(tempFile.c_str(), L"wb");
+    if (!f)
+    {
+        fprintf(stderr, "WARNING: Cannot write the label cache '%ls', the labels will be parsed when they are loaded.\n", m_cacheFile.c_str());
+        return false;
+    }
+
+    CacheWriter writer(f);
+    writer.Write(s_magic);
+    writer.Write(s_version);
+    writer.Write(parameters);
+    writer.Write((uint64_t)index.Chunks().size());
+    for (const auto& chunk : index.Chunks())
+        writer.Write((uint32_t)chunk.Sequences().size());
+    uint64_t offset = sizeof(s_magic) + sizeof(s_version) + sizeof(uint32_t) + parameters.size() + sizeof(uint64_t) +
+                      index.Chunks().size() * sizeof(uint32_t);
+
+    // Chunk by chunk, so that only the labels of a single chunk are in memory; the sequences of a chunk are parsed in parallel.
+    MLFUtteranceParser parser(states);
+    vector<char> buffer, record;
+    vector<pair<uint64_t, uint64_t>> chunkRanges;
+    chunkRanges.reserve(index.Chunks().size());
+    for (const auto& chunk : index.Chunks())
+    {
+        ReadMLFChunk(m_mlfFile, chunk, buffer);
+
+        vector<vector<MLFFrameRange>> utterances(chunk.Sequences().size());
+        vector<char> parsed(utterances.size());
+#pragma omp parallel for schedule(dynamic) num_threads(Microsoft::MSR::CNTK::Globals::GetNumReaderOmpThreads())
+        for (int i = 0; i < (int)utterances.size(); ++i)
+        {
+            const auto& sequence = chunk.Sequences()[i];
+            auto start = buffer.data() + sequence.OffsetInChunk();
+            auto end = start + sequence.SizeInBytes();
+            parsed[i] = parser.Parse(boost::make_iterator_range(start, end), utterances[i], chunk.m_offset + sequence.OffsetInChunk());
+        }
+
+        record.clear();
+        for (size_t i = 0; i < utterances.size(); ++i)
+            AppendSequence(utterances[i], parsed[i] != 0, s_invalidSequence, record);
+        writer.Write(record.data(), record.size());
+        chunkRanges.push_back(make_pair(offset, (uint64_t)record.size()));
+        offset += record.size();
+    }
+
+    for (const auto& range : chunkRanges)
+    {
+        writer.Write(range.first);
+        writer.Write(range.second);
+    }
+    writer.Write(offset); // offset of the table of chunk ranges
+    writer.Write(s_magic);
+
+    bool ok = writer.Ok();
+    ok = (fclose(f) == 0) && ok;
+    try
+    {
+        if (ok)
+            renameOrDie(tempFile, m_cacheFile);
+        else
+            unlinkOrDie(tempFile);
+    }
+    catch (const exception&)
+    {
+        ok = false;
+    }
+
+    if (!ok)
+    {
+        fprintf(stderr, "WARNING: Cannot write the label cache '%ls', the labels will be parsed when they are loaded.\n", m_cacheFile.c_str());
+        return false;
+    }
+
+    m_chunkRanges.swap(chunkRanges);
+    return true;
+}
+
+void MLFLabelCache::ReadChunk(size_t chunkIndex, vector<vector<MLFFrameRange>>& sequences) const
+{
+    const auto& range = m_chunkRanges[chunkIndex];
+    vector<char> record((size_t)range.second);
+    {
+        auto f = shared_ptr<FILE>(fopenOrDie(m_cacheFile, L"rbS"), [](FILE* f) { if (f) fclose(f); });
+        int rc = _fseeki64(f.get(), range.first, SEEK_SET);
+        if (rc)
+            RuntimeError("Error seeking to position '%" PRIu64 "' in the label cache '%ls', error code '%d'", range.first, m_cacheFile.c_str(), rc);
+        if (!record.empty())
+            freadOrDie(record.data(), 1, record.size(), f.get());
+    }
+
+    const char* p = record.data();
+    const char* end = p + record.size();
+    auto read = [&](void* value, size_t size)
+    {
+        if ((size_t)(end - p) < size)
+            RuntimeError("Label cache '%ls' is corrupt (chunk %zu), please delete it.", m_cacheFile.c_str(), chunkIndex);
+        memcpy(value, p, size);
+        p += size;
+    };
+
+    for (auto& utterance : sequences)
+    {
+        utterance.clear();
+        uint32_t numRuns;
+        read(&numRuns, sizeof(numRuns));
+        if (numRuns == s_invalidSequence)
+            continue;
+
+        // (runs are consecutive and start at frame 0, as verified by the parser)
+        const char* frames = p;
+        if ((size_t)(end - p) < numRuns * (sizeof(uint32_t) + sizeof(ClassIdType)))
+            RuntimeError("Label cache '%ls' is corrupt (chunk %zu), please delete it.", m_cacheFile.c_str(), chunkIndex);
+        const char* classIds = frames + numRuns * sizeof(uint32_t);
+        p = classIds + numRuns * sizeof(ClassIdType);
+
+        utterance.reserve(numRuns);
+        uint32_t firstFrame = 0;
+        for (uint32_t i = 0; i < numRuns; i++)
+        {
+            uint32_t numFrames;
+            ClassIdType classId;
+            memcpy(&numFrames, frames + i * sizeof(uint32_t), sizeof(numFrames));
+            memcpy(&classId, classIds + i * sizeof(ClassIdType), sizeof(classId));
+            utterance.push_back(MLFFrameRange(firstFrame, numFrames, classId));
+            firstFrame += numFrames;
+        }
+    }
+    if (p != end)
+        RuntimeError("Label cache '%ls' is corrupt (chunk %zu), please delete it.", m_cacheFile.c_str(), chunkIndex);
+}
+
+}
@@ -0,0 +1,56 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Indexer.h"
+#include "MLFUtils.h"
+
+namespace CNTK {
+
+// Persists the parsed labels of an MLF file in a sidecar file ("<mlf file>.labels"), so that loading a chunk reads
+// the state id runs of its utterances with a single read instead of parsing their text.
+// The runs of a chunk are stored together, in the order of the chunks and sequences of the index of the MLF file,
+// so the cache is only valid together with that index: it records the number of sequences of every chunk and is
+// rebuilt if they differ, as well as if the MLF file or the state list changed (size or modification time).
+// Sequences that cannot be parsed are stored as such, and are invalid when read from the cache as well.
+class MLFLabelCache
+{
+public:
+    MLFLabelCache(const std::wstring& mlfFile, const std::wstring& stateListPath);
+
+    // Opens the cache if it is up to date for the index, otherwise parses every chunk of the MLF file and writes it.
+    // Returns false if there is no valid cache afterwards (e.g. because the directory of the MLF file is read-only).
+    bool LoadOrBuild(const Index& index, const StateTablePtr& states);
+
+    // Reads the runs of all sequences of a chunk of the index; an empty vector marks a sequence that could not be parsed.
+    void ReadChunk(size_t chunkIndex, std::vector<std::vector<MLFFrameRange>>& sequences) const;
+
+private:
+    bool TryLoad(const Index& index);
+    bool Build(const Index& index, const StateTablePtr& states);
+
+    // Everything the cached labels depend on except the index: the MLF file and the state list with their versions.
+    bool TryGetParameters(std::string& parameters) const;
+
+    std::wstring m_mlfFile;
+    std::wstring m_stateListPath;
+    std::wstring m_cacheFile;
+
+    // Offset and size of each chunk's runs in the cache file.
+    std::vector<std::pair<uint64_t, uint64_t>> m_chunkRanges;
+
+    static const uint64_t s_magic = 0x6c62616c5f6b746eU; // "ntk_labl"
+    static const uint32_t s_version = 1;
+    static const uint32_t s_invalidSequence = UINT32_MAX; // number of runs of a sequence that could not be parsed
+
+    DISABLE_COPY_AND_MOVE(MLFLabelCache);
+};
+
+typedef std::shared_ptr<MLFLabelCache> MLFLabelCachePtr;
+
+}
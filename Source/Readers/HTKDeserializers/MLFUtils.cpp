@@ -216,4 +216,25 @@ namespace CNTK {
         return true;
     }
 
+
+    void ReadMLFChunk(const wstring& fileName, const ChunkDescriptor& descriptor, vector<char>& buffer)
+    {
+        auto f = shared_ptr<FILE>(fopenOrDie(fileName, L"rbS"), [](FILE *f) { if (f) fclose(f); });
+        size_t sizeInBytes =
+            descriptor.Sequences().back().OffsetInChunk() + descriptor.Sequences().back().SizeInBytes();
+
+        // Make sure we always have 0 at the end for buffer overrun.
+        buffer.resize(sizeInBytes + 1);
+        buffer[sizeInBytes] = 0;
+
+        auto chunkOffset = descriptor.m_offset;
+
+        // Seek and read chunk into memory.
+        int rc = _fseeki64(f.get(), chunkOffset, SEEK_SET);
+        if (rc)
+            RuntimeError("Error seeking to position '%" PRId64 "' in the input file '%ls', error code '%d'", chunkOffset, fileName.c_str(), rc);
+
+        freadOrDie(buffer.data(), 1, sizeInBytes, f.get());
+    }
+
 }
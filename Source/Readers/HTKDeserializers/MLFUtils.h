@@ -54,6 +54,12 @@ namespace CNTK {
         ClassIdType m_classId;     // numeric state id
 
     public:
+        MLFFrameRange() {}
+
+        MLFFrameRange(uint32_t firstFrame, uint32_t numFrames, ClassIdType classId)
+            : m_firstFrame(firstFrame), m_numFrames(numFrames), m_classId(classId)
+        {}
+
         // Parses format with original HTK state align MLF format and state list and builds an MLFFrameRange.
         void Build(const vector<boost::iterator_range<char*>>& tokens, const unordered_map<std::string, size_t>& stateTable, size_t byteOffset);
 
@@ -84,4 +90,7 @@ namespace CNTK {
         bool Parse(const boost::iterator_range<char*>& utteranceData, std::vector<MLFFrameRange>& result, size_t sequenceOffset);
     };
 
+    // Reads the text of all sequences of a chunk of an MLF file into the buffer, followed by a 0 (against buffer overruns).
+    void ReadMLFChunk(const std::wstring& fileName, const ChunkDescriptor& descriptor, std::vector<char>& buffer);
+
 }
@@ -88,7 +88,7 @@ namespace CNTK {
                     KeyOf(sequence).c_str(), classId, labelDimension);
 
             // Let's find the end of the label, we still expect to find the data afterwards.
-            currentSequence = strstr(currentSequence, "\t");
+            currentSequence = strchr(currentSequence, '\t');
             if (!currentSequence)
                 RuntimeError("No data found for sequence '%s' in the input file '%ls'", KeyOf(sequence).c_str(), m_deserializer.m_fileName.c_str());
 
@@ -96,7 +96,7 @@ namespace CNTK {
 
             // Let's get the image.
             const char* imageStart = currentSequence;
-            currentSequence = strstr(currentSequence, "\n");
+            currentSequence = strchr(currentSequence, '\n');
             if (!currentSequence)
                 RuntimeError("Empty image for sequence '%s'", KeyOf(sequence).c_str());
 
@@ -104,7 +104,8 @@ namespace CNTK {
             while (currentSequence > imageStart &&  !IsBase64Char(*(currentSequence - 1)))
                 currentSequence--;
 
-            std::vector<char> decodedImage;
+            // The image is decoded from the chunk into a pooled buffer, which can be returned as soon as the image is decoded.
+            auto decodedImage = m_deserializer.m_decodeBuffers.pop_or_create([]() { return std::vector<char>(); });
             cv::Mat image;
             if (!DecodeBase64(imageStart, currentSequence, decodedImage))
             {
@@ -112,8 +113,9 @@ namespace CNTK {
             }
             else
             {
-                image = cv::imdecode(decodedImage, m_deserializer.m_grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+                image = m_deserializer.m_decoder.Decode(reinterpret_cast<const unsigned char*>(decodedImage.data()), decodedImage.size());
             }
+            m_deserializer.m_decodeBuffers.push(std::move(decodedImage));
 
             m_deserializer.PopulateSequenceData(image, classId, copyId, { sequence.m_key, 0 }, result);
         }
@@ -9,6 +9,7 @@
 #include "Config.h"
 #include "CorpusDescriptor.h"
 #include "Indexer.h"
+#include "ConcStack.h"
 
 namespace CNTK {
 
@@ -36,6 +37,9 @@ namespace CNTK {
         std::unique_ptr<Indexer> m_indexer;
         std::shared_ptr<FILE> m_dataFile;
         std::wstring m_fileName;
+
+        // Buffers for the decoded images, reused across sequences and threads.
+        Microsoft::MSR::CNTK::conc_stack<std::vector<char>> m_decodeBuffers;
     };
 
 }
@@ -6,6 +6,7 @@
 #pragma once
 #include <opencv2/core/mat.hpp>
 #include "Config.h"
+#include "ImageDecoder.h"
 #ifdef USE_ZIP
 #include <zip.h>
 #include <unordered_map>
@@ -24,7 +25,7 @@ public:
     virtual ~ByteReader() = default;
 
     virtual void Register(const MultiMap& sequences) = 0;
-    virtual cv::Mat Read(size_t seqId, const std::string& path, bool grayscale) = 0;
+    virtual cv::Mat Read(size_t seqId, const std::string& path, const ImageDecoder& decoder) = 0;
 
     DISABLE_COPY_AND_MOVE(ByteReader);
 };
@@ -36,7 +37,7 @@ public:
     {}
 
     void Register(const MultiMap&) override {}
-    cv::Mat Read(size_t seqId, const std::string& path, bool grayscale) override;
+    cv::Mat Read(size_t seqId, const std::string& path, const ImageDecoder& decoder) override;
 
     std::string m_expandDirectory;
 };
@@ -48,7 +49,7 @@ public:
     ZipByteReader(const std::string& zipPath);
 
     void Register(const std::map<std::string, std::vector<size_t>>& sequences) override;
-    cv::Mat Read(size_t seqId, const std::string& path, bool grayscale) override;
+    cv::Mat Read(size_t seqId, const std::string& path, const ImageDecoder& decoder) override;
 
 private:
     using ZipPtr = std::unique_ptr<zip_t, void(*)(zip_t*)>;
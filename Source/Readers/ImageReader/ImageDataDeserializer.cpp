@@ -14,6 +14,7 @@
 #include "TimerUtility.h"
 #include "ImageTransformers.h"
 #include "ImageUtil.h"
+#include "fileutil.h"
 
 namespace CNTK {
 
@@ -36,7 +37,7 @@ public:
         assert(sequenceIndex == 0 && sequenceIndex == m_description.m_indexInChunk);
         UNUSED(sequenceIndex);
 
-        auto cvImage = m_deserializer.ReadImage(m_description.m_key.m_sequence, m_description.m_path, m_deserializer.m_grayscale);
+        auto cvImage = m_deserializer.ReadImage(m_description.m_key.m_sequence, m_description.m_path);
         if (!cvImage.data)
             RuntimeError("Cannot open file '%s'", m_description.m_path.c_str());
 
@@ -74,6 +75,8 @@ ImageDataDeserializer::ImageDataDeserializer(const ConfigParameters& config)
     m_streams = configHelper.GetStreams();
     assert(m_streams.size() == 2);
     m_grayscale = configHelper.UseGrayscale();
+    intargvector minDecodedSize = config(L"minDecodedSize", "0");
+    m_decoder = ImageDecoder(m_grayscale, minDecodedSize[0], minDecodedSize[1]);
     auto& label = m_streams[configHelper.GetLabelStreamId()];
     auto& feature = m_streams[configHelper.GetFeatureStreamId()];
 
@@ -286,22 +289,22 @@ void ImageDataDeserializer::RegisterByteReader(size_t seqId, const std::string&
 #endif
 }
 
-cv::Mat ImageDataDeserializer::ReadImage(size_t seqId, const std::string& path, bool grayscale)
+cv::Mat ImageDataDeserializer::ReadImage(size_t seqId, const std::string& path)
 {
     assert(!path.empty());
 
     ImageDataDeserializer::SeqReaderMap::const_iterator r;
     if (m_readers.empty() || (r = m_readers.find(seqId)) == m_readers.end())
-        return m_defaultReader->Read(seqId, path, grayscale);
-    return (*r).second->Read(seqId, path, grayscale);
+        return m_defaultReader->Read(seqId, path, m_decoder);
+    return (*r).second->Read(seqId, path, m_decoder);
 }
 
-cv::Mat FileByteReader::Read(size_t, const std::string& seqPath, bool grayscale)
+cv::Mat FileByteReader::Read(size_t, const std::string& seqPath, const ImageDecoder& decoder)
 {
     assert(!seqPath.empty());
     auto path = Expand3Dots(seqPath, m_expandDirectory);
 
-    return cv::imread(path, grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+    return decoder.Read(fetchRemoteFile(path));
 }
 
 bool ImageDataDeserializer::GetSequenceInfoByKey(const SequenceKey& key, SequenceInfo& result)
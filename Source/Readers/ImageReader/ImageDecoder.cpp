@@ -0,0 +1,120 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "ImageDecoder.h"
+#include "Basics.h"
+
+namespace CNTK {
+
+// Gets the size of a JPEG image from its frame header, without decoding it.
+// Returns false if the data is not a JPEG image or the frame header cannot be found.
+static bool GetJpegSize(const unsigned char* data, size_t size, int& width, int& height)
+{
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) // start of image
+        return false;
+
+    size_t pos = 2;
+    while (pos + 4 <= size)
+    {
+        if (data[pos] != 0xFF)
+            return false;
+
+        const unsigned char marker = data[pos + 1];
+        if (marker == 0xFF) // fill byte
+        {
+            pos++;
+            continue;
+        }
+
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) // markers without a segment
+        {
+            pos += 2;
+            continue;
+        }
+
+        if (marker == 0xD9 || marker == 0xDA) // end of image or start of scan before any frame header
+            return false;
+
+        const size_t length = ((size_t)data[pos + 2] << 8) | data[pos + 3];
+        if (length < 2)
+            return false;
+
+        // SOF0 to SOF15, except DHT, JPG and DAC which share the range
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+        {
+            if (pos + 9 > size)
+                return false;
+
+            height = (data[pos + 5] << 8) | data[pos + 6];
+            width = (data[pos + 7] << 8) | data[pos + 8];
+            return width > 0 && height > 0;
+        }
+
+        pos += 2 + length;
+    }
+    return false;
+}
+
+ImageDecoder::ImageDecoder(bool grayscale, int minWidth, int minHeight)
+    : m_grayscale(grayscale), m_minWidth(minWidth), m_minHeight(minHeight)
+{
+    if (minWidth < 0 || minHeight < 0)
+        InvalidArgument("The minimum decoded image size must not be negative.");
+}
+
+int ImageDecoder::ReadMode(const unsigned char* data, size_t size) const
+{
+    int width, height;
+    if (!UsesReducedDecoding() || !GetJpegSize(data, size, width, height))
+        return m_grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR;
+
+    // libjpeg rounds the scaled sizes up
+    for (int scale : { 8, 4, 2 })
+    {
+        if ((width + scale - 1) / scale < m_minWidth || (height + scale - 1) / scale < m_minHeight)
+            continue;
+
+        switch (scale)
+        {
+        case 8:
+            return m_grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_8 : cv::IMREAD_REDUCED_COLOR_8;
+        case 4:
+            return m_grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_COLOR_4;
+        default:
+            return m_grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_2 : cv::IMREAD_REDUCED_COLOR_2;
+        }
+    }
+    return m_grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR;
+}
+
+cv::Mat ImageDecoder::Decode(const unsigned char* data, size_t size) const
+{
+    if (size == 0)
+        return cv::Mat();
+
+    cv::Mat encoded(1, (int)size, CV_8UC1, const_cast<unsigned char*>(data));
+    return cv::imdecode(encoded, ReadMode(data, size));
+}
+
+cv::Mat ImageDecoder::Read(const std::string& path) const
+{
+    if (!UsesReducedDecoding())
+        return cv::imread(path, m_grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+
+    // The size of a JPEG image is only known from its header, so the file is decoded from memory.
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return cv::Mat();
+
+    std::vector<unsigned char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return Decode(contents.data(), contents.size());
+}
+
+}
@@ -0,0 +1,43 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <string>
+#include <opencv2/core/mat.hpp>
+
+namespace CNTK {
+
+// Decodes compressed images with OpenCV, in color or in grayscale.
+// If a minimum size is given, JPEG images are decoded at the smallest of the scales 1/2, 1/4 and 1/8 at which
+// they are still at least that wide and high (or at full size if they are not even that large): libjpeg then
+// scales the DCT coefficients while decoding, which saves most of the inverse DCT and color conversion work
+// when the transforms reduce the images to a much smaller size anyway. Other formats are always decoded at full size.
+class ImageDecoder
+{
+public:
+    explicit ImageDecoder(bool grayscale = false, int minWidth = 0, int minHeight = 0);
+
+    // Decodes an image from memory. Returns an empty matrix if the data cannot be decoded.
+    cv::Mat Decode(const unsigned char* data, size_t size) const;
+
+    // Decodes an image from a file. Returns an empty matrix if the file cannot be read or decoded.
+    cv::Mat Read(const std::string& path) const;
+
+    bool UsesReducedDecoding() const
+    {
+        return m_minWidth > 0 || m_minHeight > 0;
+    }
+
+private:
+    // Gets the OpenCV read mode for the given encoded image.
+    int ReadMode(const unsigned char* data, size_t size) const;
+
+    bool m_grayscale;
+    int m_minWidth;
+    int m_minHeight;
+};
+
+}
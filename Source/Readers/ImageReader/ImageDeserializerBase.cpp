@@ -71,6 +71,10 @@ using namespace Microsoft::MSR::CNTK;
 
         m_grayscale = config(L"grayscale", false);
 
+        // Width and height the images are at least needed at by the transforms, for decoding JPEG images at a reduced size.
+        intargvector minDecodedSize = config(L"minDecodedSize", "0");
+        m_decoder = ImageDecoder(m_grayscale, minDecodedSize[0], minDecodedSize[1]);
+
         // TODO: multiview should be done on the level of randomizer/transformers - it is responsiblity of the
         // TODO: randomizer to collect how many copies each transform needs and request same sequence several times.
         m_multiViewCrop = config(L"multiViewCrop", false);
@@ -9,6 +9,7 @@
 #include "Config.h"
 #include "CorpusDescriptor.h"
 #include "ImageUtil.h"
+#include "ImageDecoder.h"
 
 namespace CNTK {
 
@@ -43,6 +44,9 @@ namespace CNTK {
         // Flag whether images shall be loaded in grayscale.
         bool m_grayscale;
 
+        // Decoder of the images.
+        ImageDecoder m_decoder;
+
         // Verbosity.
         int m_verbosity;
 
@@ -0,0 +1,243 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <opencv2/opencv.hpp>
+#include "ImagePackDeserializer.h"
+#include "ImageTransformers.h"
+#include "ReaderUtil.h"
+#include "fileutil.h"
+
+namespace CNTK {
+    using namespace Microsoft::MSR::CNTK;
+
+    const uint64_t ImagePackDeserializer::s_magic;
+    const uint32_t ImagePackDeserializer::s_version;
+
+    // A chunk of a pack, read into memory with a single read; images are decoded on GetSequence().
+    class ImagePackDeserializer::ImageChunk : public Chunk
+    {
+        const ChunkDescriptor& m_descriptor;
+        size_t m_firstImageIndex;
+        ImagePackDeserializer& m_deserializer;
+        Shard& m_shard;
+        std::vector<uint8_t> m_buffer;
+
+    public:
+        ImageChunk(const ChunkDescriptor& descriptor, size_t firstImageIndex, ImagePackDeserializer& parent, Shard& shard)
+            : m_descriptor(descriptor), m_firstImageIndex(firstImageIndex), m_deserializer(parent), m_shard(shard)
+        {
+            if (descriptor.Sequences().empty() || !descriptor.SizeInBytes())
+                LogicError("Empty chunks are not supported.");
+
+            // (images excluded from the corpus may leave gaps, which are read as well)
+            const auto& last = descriptor.Sequences().back();
+            m_buffer.resize(last.OffsetInChunk() + last.SizeInBytes());
+
+            std::lock_guard<std::mutex> lock(m_shard.m_fileMutex);
+            // Let's see if the open descriptor has problems.
+            if (ferror(m_shard.m_file.get()) != 0)
+                m_shard.m_file.reset(fopenOrDie(m_shard.m_fileName.c_str(), L"rbS"), [](FILE* f) { if (f) fclose(f); });
+
+            fsetpos(m_shard.m_file.get(), descriptor.m_offset);
+            freadOrDie(m_buffer.data(), m_buffer.size(), 1, m_shard.m_file.get());
+        }
+
+        void GetSequence(size_t sequenceIndex, std::vector<SequenceDataPtr>& result) override
+        {
+            const size_t innerSequenceIndex = m_deserializer.m_multiViewCrop ? sequenceIndex / ImageDeserializerBase::NumMultiViewCopies : sequenceIndex;
+            const size_t copyId = m_deserializer.m_multiViewCrop ? sequenceIndex % ImageDeserializerBase::NumMultiViewCopies : 0;
+
+            const auto& sequence = m_descriptor.Sequences()[innerSequenceIndex];
+            const size_t classId = m_shard.m_classIds[m_firstImageIndex + innerSequenceIndex];
+
+            cv::Mat image = m_deserializer.m_decoder.Decode(m_buffer.data() + sequence.OffsetInChunk(), sequence.SizeInBytes());
+
+            m_deserializer.PopulateSequenceData(image, classId, copyId, { sequence.m_key, 0 }, result);
+        }
+    };
+
+    ImagePackDeserializer::ImagePackDeserializer(CorpusDescriptorPtr corpus, const ConfigParameters& config, bool primary)
+        : ImageDeserializerBase(corpus, config, primary), m_numChunks(0)
+    {
+        ConfigArray files(config(L"file"), ',');
+        std::vector<std::wstring> fileNames = (stringargvector)files;
+        if (fileNames.empty())
+            InvalidArgument("ImagePackDeserializer: No image pack files given.");
+
+        const size_t chunkSize = config(L"chunkSizeInBytes", (size_t)32 * 1024 * 1024);
+        for (const auto& fileName : fileNames)
+        {
+            m_shards.push_back(std::make_unique<Shard>());
+            auto& shard = *m_shards.back();
+            shard.m_fileName = fileName;
+            shard.m_firstChunkId = (ChunkIdType)m_numChunks;
+
+            attempt(5, [this, &shard, corpus, chunkSize]()
+            {
+                LoadShard(shard, corpus, chunkSize);
+            });
+
+            m_numChunks += shard.m_index->Chunks().size();
+            if (m_numChunks > std::numeric_limits<ChunkIdType>::max())
+                RuntimeError("ImagePackDeserializer: Maximum number of chunks exceeded.");
+        }
+    }
+
+    void ImagePackDeserializer::LoadShard(Shard& shard, CorpusDescriptorPtr corpus, size_t chunkSize)
+    {
+        shard.m_file.reset(fopenOrDie(shard.m_fileName, L"rbS"), [](FILE* f) { if (f) fclose(f); });
+        shard.m_index = std::make_unique<Index>(chunkSize, m_primary);
+        shard.m_classIds.clear();
+        shard.m_firstImageIndex.clear();
+
+        FILE* f = shard.m_file.get();
+        const uint64_t fileSize = filesize(f);
+
+        uint64_t magic;
+        uint32_t version;
+        uint64_t numImages;
+        freadOrDie(&magic, sizeof(magic), 1, f);
+        freadOrDie(&version, sizeof(version), 1, f);
+        freadOrDie(&numImages, sizeof(numImages), 1, f);
+        if (magic != s_magic)
+            RuntimeError("ImagePackDeserializer: '%ls' is not an image pack.", shard.m_fileName.c_str());
+        if (version != s_version)
+            RuntimeError("ImagePackDeserializer: Unsupported version %u of the image pack '%ls', expected version %u.", version, shard.m_fileName.c_str(), s_version);
+        if (numImages == 0 || numImages > fileSize) // (every image takes at least one byte of the pack)
+            RuntimeError("ImagePackDeserializer: The image pack '%ls' is empty or corrupt.", shard.m_fileName.c_str());
+
+        const size_t labelDimension = m_labelGenerator->LabelDimension();
+        shard.m_classIds.reserve(numImages);
+        std::string key;
+        uint64_t expectedOffset = 0;
+        for (uint64_t i = 0; i < numImages; i++)
+        {
+            uint32_t keySize;
+            freadOrDie(&keySize, sizeof(keySize), 1, f);
+            if (keySize > fileSize)
+                RuntimeError("ImagePackDeserializer: The image pack '%ls' is corrupt.", shard.m_fileName.c_str());
+            key.resize(keySize);
+            if (keySize > 0)
+                freadOrDie(&key[0], keySize, 1, f);
+
+            uint32_t classId;
+            uint64_t offset;
+            uint32_t size;
+            freadOrDie(&classId, sizeof(classId), 1, f);
+            freadOrDie(&offset, sizeof(offset), 1, f);
+            freadOrDie(&size, sizeof(size), 1, f);
+
+            if (classId >= labelDimension)
+                RuntimeError("Image '%s' has invalid class id '%u'. It is exceeding the label dimension of '%zu'. Image pack '%ls'.",
+                             key.c_str(), classId, labelDimension, shard.m_fileName.c_str());
+
+            // The images have to be stored back to back, so that a chunk is a contiguous region of the file.
+            if (i == 0)
+                expectedOffset = offset;
+            if (size == 0 || offset != expectedOffset || offset + size > fileSize)
+                RuntimeError("ImagePackDeserializer: Invalid location of image '%s' in the image pack '%ls'.", key.c_str(), shard.m_fileName.c_str());
+            expectedOffset = offset + size;
+
+            // Skipping images that are not included in corpus.
+            if (!corpus->IsIncluded(key))
+                continue;
+
+            const size_t numChunks = shard.m_index->Chunks().size();
+            shard.m_index->AddSequence(SequenceDescriptor{ corpus->KeyToId(key), 1 }, offset, offset + size);
+            if (shard.m_index->Chunks().size() != numChunks) // the image starts a new chunk
+                shard.m_firstImageIndex.push_back(shard.m_classIds.size());
+            shard.m_classIds.push_back(classId);
+        }
+
+        if (shard.m_index->IsEmpty())
+            RuntimeError("ImagePackDeserializer: None of the images of the image pack '%ls' is included in the corpus.", shard.m_fileName.c_str());
+        if (fgetpos(f) > shard.m_index->Chunks().front().m_offset)
+            RuntimeError("ImagePackDeserializer: The images in the image pack '%ls' overlap with its table.", shard.m_fileName.c_str());
+
+        shard.m_index->MapSequenceKeyToLocation();
+
+        if (m_verbosity > 0)
+            fprintf(stderr, "ImagePackDeserializer: %" PRIu64 " images in %zu chunks in the image pack '%ls'.\n",
+                    numImages, shard.m_index->Chunks().size(), shard.m_fileName.c_str());
+    }
+
+    std::pair<ImagePackDeserializer::Shard*, ChunkIdType> ImagePackDeserializer::FindChunk(ChunkIdType chunkId)
+    {
+        if (chunkId >= m_numChunks)
+            LogicError("ImagePackDeserializer: Invalid chunk id %u.", chunkId);
+
+        auto shard = std::upper_bound(m_shards.begin(), m_shards.end(), chunkId,
+            [](ChunkIdType id, const std::unique_ptr<Shard>& s) { return id < s->m_firstChunkId; });
+        assert(shard != m_shards.begin());
+        --shard;
+        return std::make_pair(shard->get(), chunkId - (*shard)->m_firstChunkId);
+    }
+
+    std::vector<ChunkInfo> ImagePackDeserializer::ChunkInfos()
+    {
+        // In case of multi crop the deserializer provides the same sequence NumMultiViewCopies times.
+        size_t sequencesPerInitialSequence = m_multiViewCrop ? ImageDeserializerBase::NumMultiViewCopies : 1;
+        std::vector<ChunkInfo> result;
+        result.reserve(m_numChunks);
+        for (const auto& shard : m_shards)
+        {
+            for (const auto& chunk : shard->m_index->Chunks())
+            {
+                ChunkInfo c;
+                c.m_id = (ChunkIdType)result.size();
+                c.m_numberOfSamples = c.m_numberOfSequences = chunk.Sequences().size() * sequencesPerInitialSequence;
+                result.push_back(c);
+            }
+        }
+        return result;
+    }
+
+    void ImagePackDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result)
+    {
+        auto location = FindChunk(chunkId);
+        const auto& chunk = location.first->m_index->Chunks()[location.second];
+        size_t sequenceCopies = m_multiViewCrop ? NumMultiViewCopies : 1;
+        result.reserve(sequenceCopies * chunk.Sequences().size());
+        size_t currentId = 0;
+        for (const auto& s : chunk.Sequences())
+        {
+            for (size_t i = 0; i < sequenceCopies; ++i)
+            {
+                result.push_back(
+                {
+                    currentId,
+                    s.m_numberOfSamples,
+                    chunkId,
+                    { s.m_key, 0 }
+                });
+
+                currentId++;
+            }
+        }
+    }
+
+    ChunkPtr ImagePackDeserializer::GetChunk(ChunkIdType chunkId)
+    {
+        auto location = FindChunk(chunkId);
+        auto& shard = *location.first;
+        return std::make_shared<ImageChunk>(shard.m_index->Chunks()[location.second], shard.m_firstImageIndex[location.second], *this, shard);
+    }
+
+    bool ImagePackDeserializer::GetSequenceInfoByKey(const SequenceKey& key, SequenceInfo& r)
+    {
+        for (const auto& shard : m_shards)
+        {
+            if (DataDeserializerBase::GetSequenceInfoByKey(*shard->m_index, key, r))
+            {
+                r.m_chunkId += shard->m_firstChunkId;
+                return true;
+            }
+        }
+        return false;
+    }
+}
@@ -0,0 +1,74 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <mutex>
+#include "ImageDeserializerBase.h"
+#include "Config.h"
+#include "CorpusDescriptor.h"
+#include "Indexer.h"
+
+namespace CNTK {
+
+    // Deserializer for image packs: files that hold the encoded images (e.g. JPEGs) of a data set back to back,
+    // preceded by a table with the key, the class id and the location of each image. Instead of opening a file
+    // (or zip entry) per image, a chunk is a contiguous region of a pack that is read with a single sequential read,
+    // which is what slow (rotational or network) storage needs. Since the table is read as a whole, no indexing
+    // pass over the data is needed either.
+    // A data set can be split into several packs (shards), given as a comma separated list in 'file'; chunks
+    // never span shards. The chunk size is configured with 'chunkSizeInBytes' (32MB by default).
+    // Packs are created from map files with Scripts/map2imagepack.py.
+    //
+    // Layout of a pack (all numbers little endian):
+    //   header:  magic (uint64, "CNTK_IPK"), version (uint32), number of images (uint64)
+    //   table:   for each image, the size of its key (uint32), the key (UTF-8), its class id (uint32),
+    //            the offset of the encoded image in the file (uint64) and its size in bytes (uint32)
+    //   data:    the encoded images, in the order of the table
+    class ImagePackDeserializer : public ImageDeserializerBase
+    {
+    public:
+        ImagePackDeserializer(CorpusDescriptorPtr corpus, const Microsoft::MSR::CNTK::ConfigParameters& config, bool primary);
+
+        // Get a chunk by id.
+        ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+        // Get chunk descriptions.
+        std::vector<ChunkInfo> ChunkInfos() override;
+
+        // Gets sequence descriptions for the chunk.
+        void SequenceInfosForChunk(ChunkIdType, std::vector<SequenceInfo>&) override;
+
+        // Gets sequence description by key.
+        bool GetSequenceInfoByKey(const SequenceKey&, SequenceInfo&) override;
+
+        static const uint64_t s_magic = 0x4b50495f4b544e43U; // "CNTK_IPK"
+        static const uint32_t s_version = 1;
+
+    private:
+        class ImageChunk;
+
+        struct Shard
+        {
+            std::wstring m_fileName;
+            std::shared_ptr<FILE> m_file;
+            std::mutex m_fileMutex;                // chunks of a shard may be read concurrently (see prefetching)
+            std::unique_ptr<Index> m_index;
+            std::vector<uint32_t> m_classIds;      // class ids, in the order of the images in the shard
+            std::vector<size_t> m_firstImageIndex; // position of the first image of each chunk in the shard
+            ChunkIdType m_firstChunkId;            // (global) id of the first chunk of the shard
+        };
+
+        // Reads the table of a shard, building its index.
+        void LoadShard(Shard& shard, CorpusDescriptorPtr corpus, size_t chunkSize);
+
+        // Shard of the chunk, and the index of the chunk within it.
+        std::pair<Shard*, ChunkIdType> FindChunk(ChunkIdType chunkId);
+
+        std::vector<std::unique_ptr<Shard>> m_shards;
+        size_t m_numChunks;
+    };
+
+}
@@ -14,6 +14,7 @@
 #include "FramePacker.h"
 #include <omp.h>
 #include "TransformController.h"
+#include "Globals.h"
 
 namespace CNTK {
 
@@ -34,10 +35,12 @@ ImageReader::ImageReader(const ConfigParameters& config)
     m_streams = configHelper.GetStreams();
     assert(m_streams.size() == 2);
 
+    // The threads decoding and transforming the images are limited, rather than all OpenMP threads of the process
+    // (which would limit the math kernels as well).
     int threadCount = configHelper.GetCpuThreadCount();
     if (threadCount > 0)
     {
-        omp_set_num_threads(threadCount);
+        Globals::SetNumReaderThreads(threadCount);
     }
 
     auto deserializer = std::make_shared<ImageDataDeserializer>(config);
@@ -21,6 +21,39 @@ namespace CNTK {
 
 using namespace Microsoft::MSR::CNTK;
 
+// Replaces each value of the image by f(value, channel), computed in ElemType.
+// An 8-bit image (as decoded) is converted to ElemType in the same pass, instead of converting it first and
+// then going over the floating point image again.
+template <typename ElemType, typename F>
+static void TransformPixelValues(cv::Mat& mat, F f)
+{
+    const int channels = mat.channels();
+    if (mat.depth() == CV_8U)
+    {
+        cv::Mat result(mat.rows, mat.cols, CV_MAKETYPE(cv::DataType<ElemType>::depth, channels));
+        for (int row = 0; row < mat.rows; row++)
+        {
+            const uint8_t* src = mat.ptr<uint8_t>(row);
+            ElemType* dst = result.ptr<ElemType>(row);
+            for (int col = 0; col < mat.cols; col++)
+                for (int c = 0; c < channels; c++, src++, dst++)
+                    *dst = f((ElemType)*src, c);
+        }
+        mat = result;
+    }
+    else
+    {
+        assert(mat.depth() == cv::DataType<ElemType>::depth);
+        for (int row = 0; row < mat.rows; row++)
+        {
+            ElemType* p = mat.ptr<ElemType>(row);
+            for (int col = 0; col < mat.cols; col++)
+                for (int c = 0; c < channels; c++, p++)
+                    *p = f(*p, c);
+        }
+    }
+}
+
 // Transforms a single sequence as open cv dense image. Called once per sequence.
 SequenceDataPtr ImageTransformerBase::Transform(SequenceDataPtr sequence)
 {
@@ -622,17 +655,14 @@ void IntensityTransformer::Apply(uint8_t, cv::Mat &mat)
     if (m_eigVal.empty() || m_eigVec.empty() || m_stdDev == 0.0)
         return;
 
-    // Have to convert to float.
-    int type = m_precision == DataType::Float ? CV_32F : CV_64F;
-    if (mat.type() != type)
-        mat.convertTo(mat, type);
+    // Have to convert to float; 8-bit images are converted while applying the transform.
+    if (mat.depth() != CV_8U)
+        ConvertToFloatingPointIfRequired(mat);
 
-    if (mat.type() == CV_64FC(mat.channels()))
+    if (ExpectedOpenCVPrecision() == CV_64F)
         Apply<double>(mat);
-    else if (mat.type() == CV_32FC(mat.channels()))
-        Apply<float>(mat);
     else
-        RuntimeError("Unsupported type");
+        Apply<float>(mat);
 }
 
 template <typename ElemType>
@@ -655,17 +685,15 @@ void IntensityTransformer::Apply(cv::Mat &mat)
     cv::Mat shifts = m_eigVec * alphas.t();
 
     // For multi-channel images data is in BGR format.
-    size_t cdst = mat.rows * mat.cols * mat.channels();
-    ElemType* pdstBase = reinterpret_cast<ElemType*>(mat.data);
-    for (ElemType* pdst = pdstBase; pdst < pdstBase + cdst;)
+    assert(mat.channels() <= 3);
+    float channelShifts[3];
+    for (int c = 0; c < mat.channels(); c++)
+        channelShifts[c] = shifts.at<float>(mat.channels() - c - 1);
+
+    TransformPixelValues<ElemType>(mat, [&channelShifts](ElemType value, int c)
     {
-        for (int c = 0; c < mat.channels(); c++)
-        {
-            float shift = shifts.at<float>(mat.channels() - c - 1);
-            *pdst = std::min(std::max(*pdst + shift, (ElemType)0), (ElemType)255);
-            pdst++;
-        }
-    }
+        return std::min(std::max(value + channelShifts[c], (ElemType)0), (ElemType)255);
+    });
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -695,15 +723,14 @@ void ColorTransformer::Apply(uint8_t, cv::Mat &mat)
     if (m_brightnessRadius == 0.0 && m_contrastRadius == 0.0 && m_saturationRadius == 0.0)
         return;
 
-    // Have to convert to float
-    ConvertToFloatingPointIfRequired(mat);
+    // Have to convert to float; 8-bit images are converted while changing brightness and contrast, if these are jittered.
+    if (mat.depth() != CV_8U)
+        ConvertToFloatingPointIfRequired(mat);
 
-    if (mat.type() == CV_64FC(mat.channels()))
+    if (ExpectedOpenCVPrecision() == CV_64F)
         Apply<double>(mat);
-    else if (mat.type() == CV_32FC(mat.channels()))
-        Apply<float>(mat);
     else
-        RuntimeError("Unsupported type");
+        Apply<float>(mat);
 }
 
 template <typename ElemType>
@@ -736,14 +763,14 @@ void ColorTransformer::Apply(cv::Mat &mat)
 
         // Could potentially use mat.convertTo(mat, -1, alpha, beta) 
         // but it does not do range checking for single/double precision matrix. saturate_cast won't work either.
-        size_t count = mat.rows * mat.cols * mat.channels();
-        ElemType* pbase = reinterpret_cast<ElemType*>(mat.data);
-        for (ElemType* p = pbase; p < pbase + count; p++)
+        TransformPixelValues<ElemType>(mat, [alpha, beta](ElemType value, int)
         {
-            *p = std::min(std::max(*p * alpha + beta, (ElemType)0), (ElemType)255);
-        }
+            return std::min(std::max(value * alpha + beta, (ElemType)0), (ElemType)255);
+        });
     }
 
+    ConvertToFloatingPointIfRequired(mat); // (if only the saturation is jittered)
+
     if (m_saturationRadius > 0 && mat.channels() == 3)
     {
         UniRealT d(-m_saturationRadius, m_saturationRadius);
@@ -91,7 +91,7 @@ void ZipByteReader::Register(const MultiMap& sequences)
     RuntimeError("Cannot retrieve image data for some sequences. For more detail, please see the log file.");
 }
 
-cv::Mat ZipByteReader::Read(size_t seqId, const std::string& path, bool grayscale)
+cv::Mat ZipByteReader::Read(size_t seqId, const std::string& path, const ImageDecoder& decoder)
 {
     // Find index of the file in .zip file.
     auto r = m_seqIdToIndex.find(seqId);
@@ -135,7 +135,7 @@ cv::Mat ZipByteReader::Read(size_t seqId, const std::string& path, bool grayscal
     });
     m_zips.push(std::move(zipFile));
 
-    cv::Mat img = cv::imdecode(contents, grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+    cv::Mat img = decoder.Decode(contents.data(), size);
     assert(nullptr != img.data);
     m_workspace.push(std::move(contents));
     return img;
@@ -9,6 +9,7 @@
 #define DATAREADER_EXPORTS
 #include "DataReader.h"
 #include "LibSVMBinaryReader.h"
+#include "LibSVMBinaryDeserializer.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -22,3 +23,20 @@ extern "C" DATAREADER_API void GetReaderD(IDataReader** preader)
 }
 
 }}}
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+extern "C" DATAREADER_API bool CreateDeserializer(DataDeserializerPtr& deserializer, const std::wstring& type, const ConfigParameters& deserializerConfig, CorpusDescriptorPtr corpus, bool primary)
+{
+    if (type == L"LibSVMBinaryDeserializer")
+        deserializer = std::make_shared<LibSVMBinaryDeserializer>(corpus, deserializerConfig, primary);
+    else
+        InvalidArgument("Unknown deserializer type '%ls'", type.c_str());
+
+    // Deserializer created.
+    return true;
+}
+
+}
@@ -0,0 +1,296 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <limits>
+#include "LibSVMBinaryDeserializer.h"
+#include "MappedChunk.h"
+#include "SequenceData.h"
+#include "StringUtil.h"
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+// A chunk of blocks, used directly from the mapping; the sequences point to the values and indices in the file.
+class LibSVMBinaryDeserializer::LibSVMBinaryChunk : public MappedChunk
+{
+    struct Feature
+    {
+        const byte* m_values;
+        const SparseIndexType* m_rowIndices;
+        const SparseIndexType* m_colStarts;
+    };
+
+    struct Block
+    {
+        size_t m_firstSequence;
+        std::vector<Feature> m_features;
+        std::vector<const byte*> m_labels;
+    };
+
+    const ChunkDescription& m_description;
+    LibSVMBinaryDeserializer& m_deserializer;
+    std::vector<Block> m_blocks;
+
+public:
+    LibSVMBinaryChunk(const ChunkDescription& description, LibSVMBinaryDeserializer& parent)
+        : MappedChunk(parent.m_file, description.m_offset, description.m_size),
+          m_description(description), m_deserializer(parent)
+    {
+        // Only the locations of the arrays of the blocks are parsed here.
+        const auto& streams = m_deserializer.m_streams;
+        const size_t elementSize = m_deserializer.m_elementSize;
+        size_t firstSequence = 0;
+        m_blocks.resize(description.m_numBlocks);
+        for (size_t i = 0; i < description.m_numBlocks; i++)
+        {
+            const int64_t blockOffset = m_deserializer.m_blockOffsets[description.m_firstBlock + i];
+            const int64_t blockEnd = m_deserializer.m_blockOffsets[description.m_firstBlock + i + 1];
+            const byte* block = m_data + (blockOffset - m_offset);
+            const byte* end = m_data + (blockEnd - m_offset);
+
+            const int32_t numSamples = *(const int32_t*)block;
+            const byte* position = block + sizeof(int32_t);
+
+            auto& b = m_blocks[i];
+            b.m_firstSequence = firstSequence;
+            for (size_t j = 0; j < streams.size(); j++)
+            {
+                if (j < m_deserializer.m_numFeatures)
+                {
+                    const int32_t nnz = *(const int32_t*)position;
+                    Feature f;
+                    f.m_values = position + sizeof(int32_t);
+                    f.m_rowIndices = (const SparseIndexType*)(f.m_values + nnz * elementSize);
+                    f.m_colStarts = f.m_rowIndices + nnz;
+                    position = (const byte*)(f.m_colStarts + numSamples + 1);
+                    if (nnz < 0 || position > end || f.m_colStarts[numSamples] != nnz)
+                        RuntimeError("LibSVMBinaryDeserializer: Invalid layout of feature '%ls' in block %" PRIu64 " of the file '%ls'.",
+                                     streams[j].m_name.c_str(), description.m_firstBlock + i, m_deserializer.m_fileName.c_str());
+                    b.m_features.push_back(f);
+                }
+                else
+                {
+                    b.m_labels.push_back(position);
+                    position += numSamples * streams[j].m_sampleLayout.TotalSize() * elementSize;
+                    if (position > end)
+                        RuntimeError("LibSVMBinaryDeserializer: Invalid layout of label '%ls' in block %" PRIu64 " of the file '%ls'.",
+                                     streams[j].m_name.c_str(), description.m_firstBlock + i, m_deserializer.m_fileName.c_str());
+                }
+            }
+            firstSequence += numSamples;
+        }
+    }
+
+    void GetSequence(size_t sequenceIndex, std::vector<SequenceDataPtr>& result) override
+    {
+        auto block = std::upper_bound(m_blocks.begin(), m_blocks.end(), sequenceIndex,
+                                      [](size_t index, const Block& b) { return index < b.m_firstSequence; }) - 1;
+        const size_t column = sequenceIndex - block->m_firstSequence;
+        const SequenceKey key = { m_description.m_firstSample + sequenceIndex, 0 };
+
+        const auto& streams = m_deserializer.m_streams;
+        const size_t elementSize = m_deserializer.m_elementSize;
+        result.resize(streams.size());
+        for (size_t j = 0; j < streams.size(); j++)
+        {
+            if (j < m_deserializer.m_numFeatures)
+            {
+                const auto& f = block->m_features[j];
+                const SparseIndexType start = f.m_colStarts[column];
+                auto data = std::make_shared<SparseSequenceView>(f.m_values + start * elementSize, f.m_rowIndices + start,
+                                                                 f.m_colStarts[column + 1] - start, streams[j].m_sampleLayout);
+                data->m_elementType = m_deserializer.m_precision;
+                data->m_key = key;
+                result[j] = data;
+            }
+            else
+            {
+                const size_t dim = streams[j].m_sampleLayout.TotalSize();
+                auto data = std::make_shared<DenseSequenceView>(block->m_labels[j - m_deserializer.m_numFeatures] + column * dim * elementSize,
+                                                                streams[j].m_sampleLayout);
+                data->m_elementType = m_deserializer.m_precision;
+                data->m_key = key;
+                result[j] = data;
+            }
+        }
+    }
+};
+
+LibSVMBinaryDeserializer::LibSVMBinaryDeserializer(CorpusDescriptorPtr corpus, const ConfigParameters& config, bool primary)
+    : DataDeserializerBase(primary)
+{
+    if (corpus && !corpus->IsNumericSequenceKeys())
+        InvalidArgument("LibSVMBinaryDeserializer: Non-numeric sequence keys are not supported, the keys are the sample numbers.");
+
+    m_fileName = (const wstring&)config(L"file");
+    m_verbosity = config(L"verbosity", 0);
+
+    string precision = config("precision", "float");
+    m_precision = AreEqualIgnoreCase(precision, "float") ? DataType::Float : DataType::Double;
+    m_elementSize = m_precision == DataType::Float ? sizeof(float) : sizeof(double);
+
+    std::map<std::wstring, std::wstring> rename;
+    for (const auto& id : config.GetMemberIds())
+    {
+        if (!config.CanBeConfigRecord(id))
+            continue;
+        const ConfigParameters& section = config(id);
+        if (section.ExistsCurrent(L"rename"))
+            rename.emplace(id, (const wstring&)section(L"rename"));
+    }
+
+    m_file = std::make_shared<MappedFile>(m_fileName);
+    Initialize(rename, config(L"chunkSizeInBytes", (size_t)32 * 1024 * 1024));
+}
+
+void LibSVMBinaryDeserializer::Initialize(const std::map<std::wstring, std::wstring>& rename, size_t chunkSize)
+{
+    int64_t position = 0;
+    // (the header is packed, its values are not aligned)
+    auto read = [&](void* value, size_t size)
+    {
+        memcpy(value, m_file->Data(position, size), size);
+        position += size;
+    };
+
+    int64_t numSamples, numBlocks;
+    int32_t numFeatures, numLabels;
+    read(&numSamples, sizeof(numSamples));
+    read(&numBlocks, sizeof(numBlocks));
+    read(&numFeatures, sizeof(numFeatures));
+    read(&numLabels, sizeof(numLabels));
+    if (numSamples <= 0 || numBlocks <= 0 || (uint64_t)numBlocks > m_file->Size() / sizeof(int64_t) || numFeatures < 0 || numLabels < 0 || numFeatures + numLabels == 0)
+        RuntimeError("LibSVMBinaryDeserializer: Invalid header of the file '%ls'.", m_fileName.c_str());
+
+    m_numFeatures = numFeatures;
+    for (int32_t i = 0; i < numFeatures + numLabels; i++)
+    {
+        int32_t length, dim;
+        read(&length, sizeof(length));
+        if (length <= 0)
+            RuntimeError("LibSVMBinaryDeserializer: Invalid name of input %d in the file '%ls'.", (int)i, m_fileName.c_str());
+        std::string name((const char*)m_file->Data(position, length), length);
+        position += length;
+        read(&dim, sizeof(dim));
+        if (dim <= 0)
+            RuntimeError("LibSVMBinaryDeserializer: Invalid dimension (%d) of input '%s' in the file '%ls'.", (int)dim, name.c_str(), m_fileName.c_str());
+
+        StreamInformation stream;
+        stream.m_id = i;
+        stream.m_name = msra::strfun::utf16(name);
+        auto renamed = rename.find(stream.m_name);
+        if (renamed != rename.end())
+            stream.m_name = renamed->second;
+        stream.m_storageFormat = i < numFeatures ? StorageFormat::SparseCSC : StorageFormat::Dense;
+        stream.m_elementType = m_precision;
+        stream.m_sampleLayout = NDShape({ (size_t)dim });
+        m_streams.push_back(stream);
+    }
+
+    const int64_t dataStart = position + numBlocks * sizeof(int64_t);
+    const int64_t fileSize = (int64_t)m_file->Size();
+    m_blockOffsets.resize(numBlocks + 1);
+    read(m_blockOffsets.data(), numBlocks * sizeof(int64_t));
+    for (auto& offset : m_blockOffsets)
+        offset += dataStart;
+    m_blockOffsets[numBlocks] = fileSize;
+
+    // Only the number of samples of each block is read here, the blocks themselves are parsed once their chunk is used.
+    size_t firstSample = 0;
+    for (int64_t i = 0; i < numBlocks; i++)
+    {
+        const int64_t offset = m_blockOffsets[i];
+        const uint64_t size = m_blockOffsets[i + 1] - offset;
+        if (offset < dataStart || m_blockOffsets[i + 1] < offset + (int64_t)sizeof(int32_t) || m_blockOffsets[i + 1] > fileSize)
+            RuntimeError("LibSVMBinaryDeserializer: Invalid offset of block %" PRId64 " in the file '%ls'.", i, m_fileName.c_str());
+
+        int32_t blockSamples;
+        memcpy(&blockSamples, m_file->Data(offset, sizeof(int32_t)), sizeof(int32_t));
+        if (blockSamples <= 0)
+            RuntimeError("LibSVMBinaryDeserializer: Invalid number of samples (%d) in block %" PRId64 " of the file '%ls'.", (int)blockSamples, i, m_fileName.c_str());
+
+        if (m_chunks.empty() || m_chunks.back().m_size + size > chunkSize)
+        {
+            if (std::numeric_limits<ChunkIdType>::max() <= m_chunks.size())
+                RuntimeError("Maximum number of chunks exceeded.");
+            m_chunks.push_back(ChunkDescription{ offset, 0, (size_t)i, 0, firstSample, 0 });
+        }
+
+        auto& chunk = m_chunks.back();
+        chunk.m_size += size;
+        chunk.m_numBlocks++;
+        chunk.m_numSamples += blockSamples;
+        firstSample += blockSamples;
+    }
+
+    if (firstSample != (size_t)numSamples)
+        RuntimeError("LibSVMBinaryDeserializer: The blocks of the file '%ls' have %" PRIu64 " samples, but its header %" PRId64 ".",
+                     m_fileName.c_str(), firstSample, numSamples);
+
+    m_file->DontNeed(0, fileSize);
+
+    if (m_verbosity > 0)
+        fprintf(stderr, "LibSVMBinaryDeserializer: %" PRId64 " samples in %" PRId64 " blocks and %zu chunks in the file '%ls'.\n",
+                numSamples, numBlocks, m_chunks.size(), m_fileName.c_str());
+}
+
+std::vector<ChunkInfo> LibSVMBinaryDeserializer::ChunkInfos()
+{
+    std::vector<ChunkInfo> result;
+    result.reserve(m_chunks.size());
+    for (const auto& chunk : m_chunks)
+    {
+        ChunkInfo c;
+        c.m_id = (ChunkIdType)result.size();
+        c.m_numberOfSamples = c.m_numberOfSequences = chunk.m_numSamples;
+        result.push_back(c);
+    }
+    return result;
+}
+
+void LibSVMBinaryDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result)
+{
+    const auto& chunk = m_chunks[chunkId];
+    result.reserve(chunk.m_numSamples);
+    for (size_t i = 0; i < chunk.m_numSamples; i++)
+    {
+        SequenceInfo info;
+        info.m_chunkId = chunkId;
+        info.m_indexInChunk = i;
+        info.m_numberOfSamples = 1;
+        info.m_key = { chunk.m_firstSample + i, 0 };
+        result.push_back(info);
+    }
+}
+
+ChunkPtr LibSVMBinaryDeserializer::GetChunk(ChunkIdType chunkId)
+{
+    return std::make_shared<LibSVMBinaryChunk>(m_chunks[chunkId], *this);
+}
+
+bool LibSVMBinaryDeserializer::GetSequenceInfoByKey(const SequenceKey& key, SequenceInfo& result)
+{
+    if (m_primary)
+        LogicError("Matching by sequence key is not supported for primary deserilalizer.");
+
+    // The samples are numbered in the order of the chunks.
+    auto chunk = std::upper_bound(m_chunks.begin(), m_chunks.end(), key.m_sequence,
+                                  [](size_t sample, const ChunkDescription& c) { return sample < c.m_firstSample; });
+    if (chunk == m_chunks.begin() || key.m_sequence >= chunk[-1].m_firstSample + chunk[-1].m_numSamples)
+        return false;
+
+    --chunk;
+    result.m_chunkId = (ChunkIdType)(chunk - m_chunks.begin());
+    result.m_indexInChunk = key.m_sequence - chunk->m_firstSample;
+    result.m_numberOfSamples = 1;
+    result.m_key = key;
+    return true;
+}
+
+}
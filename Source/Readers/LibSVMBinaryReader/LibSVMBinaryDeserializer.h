@@ -0,0 +1,72 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "DataDeserializerBase.h"
+#include "Config.h"
+#include "CorpusDescriptor.h"
+#include "MappedFile.h"
+
+namespace CNTK {
+
+// Deserializer for the binary files of the LibSVMBinary reader, which are used directly from a memory mapping.
+// The file starts with the number of samples (int64), the number of blocks (int64), the number of features and
+// labels (int32 each) and, for each of them, its name (int32 length and the characters) and its dimension (int32),
+// followed by the offset of each block (int64, relative to the end of the offsets), and the blocks of samples.
+// A block holds its number of samples (int32); for each feature, the number of non-zero values (int32), the values
+// (of the configured 'precision'), their row indices (int32) and the column starts of the samples (int32, number
+// of samples + 1); and for each label the dense values of the samples (of the configured 'precision').
+// The features are exposed as sparse and the labels as dense streams, named as in the file unless renamed with
+// a 'rename' entry in a config section of the same name (as for the LibSVMBinary reader).
+// A chunk consists of whole blocks and is 'chunkSizeInBytes' (32MB by default). The sequence keys are the
+// sample numbers.
+class LibSVMBinaryDeserializer : public DataDeserializerBase
+{
+public:
+    LibSVMBinaryDeserializer(CorpusDescriptorPtr corpus, const Microsoft::MSR::CNTK::ConfigParameters& config, bool primary);
+
+    // Get chunk descriptions.
+    std::vector<ChunkInfo> ChunkInfos() override;
+
+    // Gets sequence descriptions for the chunk.
+    void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result) override;
+
+    // Get a chunk by id.
+    ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+protected:
+    // Gets sequence description by key.
+    bool GetSequenceInfoByKey(const SequenceKey& key, SequenceInfo& result) override;
+
+private:
+    class LibSVMBinaryChunk;
+
+    struct ChunkDescription
+    {
+        int64_t m_offset;     // offset of the first block of the chunk in the file
+        uint64_t m_size;      // size of its blocks in bytes
+        size_t m_firstBlock;
+        size_t m_numBlocks;
+        size_t m_firstSample; // number of the first sample of the chunk in the file
+        size_t m_numSamples;
+    };
+
+    // Reads the header and groups the blocks into chunks.
+    void Initialize(const std::map<std::wstring, std::wstring>& rename, size_t chunkSize);
+
+    std::wstring m_fileName;
+    std::shared_ptr<MappedFile> m_file;
+    std::vector<ChunkDescription> m_chunks;
+    std::vector<int64_t> m_blockOffsets; // offsets of the blocks in the file, with the end of the file as the last
+    size_t m_numFeatures;
+    DataType m_precision;
+    size_t m_elementSize;
+    unsigned int m_verbosity;
+
+    DISABLE_COPY_AND_MOVE(LibSVMBinaryDeserializer);
+};
+
+}
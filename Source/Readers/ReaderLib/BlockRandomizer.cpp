@@ -10,9 +10,14 @@
 #include "BlockRandomizer.h"
 #include <algorithm>
 #include <utility>
+#include <queue>
+#include <functional>
 
 #include "DataReader.h"
 #include "ExceptionCapture.h"
+#include "PerformanceProfiler.h"
+#include "Metrics.h"
+#include "Globals.h"
 
 namespace CNTK {
 
@@ -34,15 +39,23 @@ BlockRandomizer::BlockRandomizer(
       m_sweepSizeInSamples(0),
       m_chunkRandomizer(std::make_shared<ChunkRandomizer>(deserializer, randomizationRange, sampleBasedRandomizationWindow)),
       m_multithreadedGetNextSequences(multithreadedGetNextSequence),
-      m_prefetchedChunk(ChunkIdMax),
+      m_maxPrefetchedChunks(1),
+      m_maxPrefetchedBytes(0),
+      m_numPrefetchThreads(1),
+      m_numPrefetchStarvations(0),
       m_cleaner(maxNumberOfInvalidSequences),
-      m_seedOffset(seedOffset)
+      m_seedOffset(seedOffset),
+      m_balancedChunkDistribution(false),
+      m_chunkWorkersSweep(SIZE_MAX),
+      m_chunkWorkersNumberOfWorkers(0)
 {
     assert(deserializer != nullptr);
 
     m_launchType = shouldPrefetch ? launch::async : launch::deferred;
 
     m_streams = m_deserializer->StreamInfos();
+    m_estimatedBytesPerSample = EstimatedBytesPerSample(m_streams);
+
     m_sequenceRandomizer = std::make_shared<SequenceRandomizer>(verbosity, m_deserializer, m_chunkRandomizer);
 
     // Calculate total number of samples.
@@ -120,6 +133,35 @@ void BlockRandomizer::PrepareNewSweepIfNeeded(size_t samplePosition)
     }
 }
 
+// Assigns each chunk, in randomized order, to the worker with the fewest samples so far (the lowest rank among equals).
+// All workers compute the same assignment from the same randomization. At any position in the sweep the sample counts
+// of the workers differ by at most the size of the largest chunk, so the workers stay balanced within each minibatch
+// as far as the randomization window allows.
+void BlockRandomizer::AssignChunksToWorkers()
+{
+    const auto& chunks = m_chunkRandomizer->GetRandomizedChunks();
+    const size_t numberOfWorkers = m_config.m_numberOfWorkers;
+
+    // (samples, rank) of the workers, least loaded first
+    typedef std::pair<size_t, size_t> WorkerLoad;
+    std::priority_queue<WorkerLoad, std::vector<WorkerLoad>, std::greater<WorkerLoad>> loads;
+    for (size_t rank = 0; rank < numberOfWorkers; ++rank)
+        loads.push({ 0, rank });
+
+    m_chunkWorkers.resize(chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        WorkerLoad least = loads.top();
+        loads.pop();
+
+        m_chunkWorkers[i] = least.second;
+        loads.push({ least.first + chunks[i].m_original->m_numberOfSamples, least.second });
+    }
+
+    m_chunkWorkersSweep = m_sweep;
+    m_chunkWorkersNumberOfWorkers = numberOfWorkers;
+}
+
 // Gets next sequences not exceeding global and local sample counts.
 Sequences BlockRandomizer::GetNextSequences(size_t globalSampleCount, size_t localSampleCount)
 {
@@ -205,13 +247,16 @@ std::pair<size_t, size_t> BlockRandomizer::LoadSequenceData(size_t globalSampleC
     auto process = [&](int i) -> void {
         const auto& description = m_sequenceBuffer[i];
         std::vector<SequenceDataPtr> sequenceData;
-        auto it = m_chunks.find(description.m_chunk->m_original->m_id);
+        auto it = m_chunks.find(m_chunkRandomizer->GetRandomizedChunks()[description.m_chunkId].m_original->m_id);
         if (it == m_chunks.end())
         {
             LogicError("Invalid chunk requested.");
         }
 
         it->second->GetSequence(description.m_indexInOriginalChunk, sequenceData);
+        if (m_sequenceTransform && IsValidSequence(sequenceData))
+            m_sequenceTransform(sequenceData);
+
         for (int j = 0; j < m_streams.size(); ++j)
         {
             assert(offset + i < data[j].size());
@@ -219,23 +264,25 @@ std::pair<size_t, size_t> BlockRandomizer::LoadSequenceData(size_t globalSampleC
         }
     };
 
-    if (m_multithreadedGetNextSequences)
-    {
-        ExceptionCapture capture;
-#pragma omp parallel for schedule(dynamic)
-        for (int i = 0; i < m_sequenceBuffer.size(); ++i)
-            capture.SafeRun(process, i);
-        capture.RethrowIfHappened();
-    }
-    else
     {
-        for (int i = 0; i < m_sequenceBuffer.size(); ++i)
-            process(i);
+        ReaderStageTimer timer("cntk_reader_decode_seconds");
+        if (m_multithreadedGetNextSequences)
+        {
+            ExceptionCapture capture;
+#pragma omp parallel for schedule(dynamic) num_threads(Microsoft::MSR::CNTK::Globals::GetNumReaderOmpThreads())
+            for (int i = 0; i < m_sequenceBuffer.size(); ++i)
+                capture.SafeRun(process, i);
+            capture.RethrowIfHappened();
+        }
+        else
+        {
+            for (int i = 0; i < m_sequenceBuffer.size(); ++i)
+                process(i);
+        }
     }
 
     // Now it is safe to start the new chunk prefetch.
-    ChunkIdType chunkToPrefetchNext = GetChunkToPrefetch(windowRange);
-    Prefetch(chunkToPrefetchNext);
+    Prefetch(windowRange);
 
     return { numGlobalSamples, numLocalSamples };
 }
@@ -282,7 +329,7 @@ std::tuple<bool, bool, size_t, size_t> BlockRandomizer::GetNextSequenceDescripti
         [&, this](const RandomizedSequenceDescription& s)
     {
         auto sequenceLength = s.m_numberOfSamples;
-        bool isLocal = s.m_chunk->m_chunkId % m_config.m_numberOfWorkers == m_config.m_workerRank; 
+        bool isLocal = IsLocalChunk(s.m_chunkId);
 
         // TODO: should we just drop this flag and return false if we cannot fulfil this request?
         if (!atLeastOneSequenceNeeded) 
@@ -366,7 +413,7 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
     for (size_t i = windowRange.m_begin; i < windowRange.m_end; ++i)
     {
         auto const& chunk = m_chunkRandomizer->GetRandomizedChunks()[i];
-        if (chunk.m_chunkId % m_config.m_numberOfWorkers != m_config.m_workerRank)
+        if (!IsLocalChunk(chunk.m_chunkId))
         {
             continue;
         }
@@ -395,31 +442,14 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
         }
 
         auto const& chunk = m_chunkRandomizer->GetRandomizedChunks()[i];
-        if (chunk.m_original->m_id == m_prefetchedChunk && m_prefetch.valid())
-        {
-            // Taking prefetched chunk.
-            m_chunks[chunk.m_original->m_id] = m_prefetch.get();
-            if (m_verbosity >= Information)
-                fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: paged in prefetched chunk %u (original chunk: %u), now %" PRIu64 " chunks in memory\n",
-                chunk.m_chunkId,
-                chunk.m_original->m_id,
-                ++numLoadedChunks);
-        }
-        else
-        {
-            // Make sure we have no outstanding prefetches.
-            if (m_prefetch.valid())
-            {
-                m_prefetch.wait();
-            }
-
-            m_chunks[chunk.m_original->m_id] = m_deserializer->GetChunk(chunk.m_original->m_id);
-            if (m_verbosity >= Information)
-                fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: paged in randomized chunk %u (original chunk: %u), now %" PRIu64 " chunks in memory\n",
-                chunk.m_chunkId,
-                chunk.m_original->m_id,
-                ++numLoadedChunks);
-        }
+        bool prefetched = false;
+        m_chunks[chunk.m_original->m_id] = GetChunk(chunk.m_original->m_id, prefetched);
+        if (m_verbosity >= Information)
+            fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: paged in %s chunk %u (original chunk: %u), now %" PRIu64 " chunks in memory\n",
+            prefetched ? "prefetched" : "randomized",
+            chunk.m_chunkId,
+            chunk.m_original->m_id,
+            ++numLoadedChunks);
     }
 
     if (m_verbosity >= Notification)
@@ -429,45 +459,138 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
                 m_chunkRandomizer->GetRandomizedChunks()[windowRange.m_end - 1].m_chunkId);
 }
 
-// Identifies chunk id that should be prefetched.
-ChunkIdType BlockRandomizer::GetChunkToPrefetch(const ClosedOpenChunkInterval& windowRange)
+ChunkPtr BlockRandomizer::GetChunk(ChunkIdType chunkId, bool& prefetched)
 {
-    ChunkIdType toBePrefetched = ChunkIdMax;
-    auto current = windowRange.m_end;
-    while (current < m_chunkRandomizer->GetRandomizedChunks().size())
+    auto it = std::find_if(m_prefetchedChunks.begin(), m_prefetchedChunks.end(),
+                           [chunkId](const PrefetchedChunk& c) { return c.m_id == chunkId; });
+    prefetched = it != m_prefetchedChunks.end();
+
+    // the depth of the prefetch queue: the chunks that are loaded when one is needed
+    Microsoft::MSR::CNTK::MetricsHistogramObserve("cntk_reader_ready_chunks", (double)std::count_if(m_prefetchedChunks.begin(), m_prefetchedChunks.end(), [](const PrefetchedChunk& c)
     {
-        const auto& chunk = m_chunkRandomizer->GetRandomizedChunks()[current];
-        if (chunk.m_chunkId % m_config.m_numberOfWorkers == m_config.m_workerRank &&
-            m_chunks.find(chunk.m_original->m_id) == m_chunks.end())
+        return c.m_data.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }));
+
+    // Waiting for a chunk that is not (yet) prefetched stalls the reader, which is reported as prefetch starvation.
+    bool starving = !prefetched || it->m_data.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    auto profilerState = starving ? Microsoft::MSR::CNTK::ProfilerTimeBegin() : 0;
+    auto waitBegin = std::chrono::steady_clock::now();
+
+    ChunkPtr result;
+    if (prefetched)
+    {
+        // Taking prefetched chunk.
+        result = it->m_data.get();
+        m_prefetchedChunks.erase(it);
+    }
+    else
+    {
+        // Make sure we have no outstanding prefetches, unless the deserializer supports concurrent loading.
+        if (m_numPrefetchThreads <= 1)
         {
-            toBePrefetched = chunk.m_original->m_id;
-            break;
+            for (auto& c : m_prefetchedChunks)
+                c.m_data.wait();
         }
-        ++current;
+
+        Microsoft::MSR::CNTK::ScopeProfile profile(Microsoft::MSR::CNTK::profilerEvtChunkLoad);
+        ReaderStageTimer timer("cntk_reader_chunk_load_seconds");
+        result = m_deserializer->GetChunk(chunkId);
+    }
+
+    if (starving)
+    {
+        Microsoft::MSR::CNTK::ProfilerTimeEnd(profilerState, Microsoft::MSR::CNTK::profilerEvtChunkWait);
+        Microsoft::MSR::CNTK::MetricsHistogramObserve("cntk_reader_chunk_wait_seconds", std::chrono::duration<double>(std::chrono::steady_clock::now() - waitBegin).count());
+        m_numPrefetchStarvations++;
+        if (m_verbosity >= Information)
+            fprintf(stderr, "BlockRandomizer::GetChunk: waited for original chunk %u (%" PRIu64 " times so far)\n", chunkId, m_numPrefetchStarvations);
     }
-    return toBePrefetched;
+
+    return result;
 }
 
-// Performs io prefetch of the specified chunk if needed.
-void BlockRandomizer::Prefetch(ChunkIdType chunkId)
+// Identifies the chunks that should be prefetched.
+std::vector<size_t> BlockRandomizer::GetChunksToPrefetch(const ClosedOpenChunkInterval& windowRange)
 {
-    // Start new prefetch if necessary.
-    if (m_prefetchedChunk != chunkId && chunkId != ChunkIdMax)
+    std::vector<size_t> result;
+    size_t totalSize = 0;
+    const auto& chunks = m_chunkRandomizer->GetRandomizedChunks();
+    for (size_t current = windowRange.m_end; current < chunks.size() && result.size() < m_maxPrefetchedChunks; ++current)
     {
-        // Wait to make sure there is no outstanding prefetches.
-        if (m_prefetch.valid())
-        {
-            m_prefetch.wait();
-        }
+        const auto& chunk = chunks[current];
+        if (!IsLocalChunk(chunk.m_chunkId) ||
+            m_chunks.find(chunk.m_original->m_id) != m_chunks.end())
+            continue;
+
+        totalSize += EstimatedChunkSize(chunk);
+        if (!result.empty() && m_maxPrefetchedBytes > 0 && totalSize > m_maxPrefetchedBytes)
+            break;
+        result.push_back(current);
+    }
+    return result;
+}
+
+// Performs io prefetch of the chunks following the window if needed.
+void BlockRandomizer::Prefetch(const ClosedOpenChunkInterval& windowRange)
+{
+    auto toBePrefetched = GetChunksToPrefetch(windowRange);
+    const auto& chunks = m_chunkRandomizer->GetRandomizedChunks();
+
+    // Drop the chunks that are not going to be needed next anymore (e.g. after re-randomization for a new sweep).
+    // (Destroying the future waits for the chunk, if it is still being loaded.)
+    auto isToBePrefetched = [&](ChunkIdType id)
+    {
+        return std::any_of(toBePrefetched.begin(), toBePrefetched.end(), [&](size_t i) { return chunks[i].m_original->m_id == id; });
+    };
+    m_prefetchedChunks.erase(std::remove_if(m_prefetchedChunks.begin(), m_prefetchedChunks.end(),
+                                            [&](const PrefetchedChunk& c) { return !isToBePrefetched(c.m_id); }),
+                             m_prefetchedChunks.end());
 
-        m_prefetchedChunk = chunkId;
-        m_prefetch = std::async(m_launchType, [this, chunkId]() { return m_deserializer->GetChunk(chunkId); });
+    // Start new prefetches, as long as there are loader threads available.
+    size_t numLoading = std::count_if(m_prefetchedChunks.begin(), m_prefetchedChunks.end(), [](const PrefetchedChunk& c)
+    {
+        return c.m_data.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    });
+    for (size_t i : toBePrefetched)
+    {
+        if (numLoading >= m_numPrefetchThreads)
+            break;
+
+        ChunkIdType chunkId = chunks[i].m_original->m_id;
+        if (std::any_of(m_prefetchedChunks.begin(), m_prefetchedChunks.end(), [chunkId](const PrefetchedChunk& c) { return c.m_id == chunkId; }))
+            continue;
+
+        m_prefetchedChunks.push_back(PrefetchedChunk{ chunkId, EstimatedChunkSize(chunks[i]),
+                                                      std::async(m_launchType, [this, chunkId]() -> ChunkPtr
+                                                      {
+                                                          Microsoft::MSR::CNTK::ScopeProfile profile(Microsoft::MSR::CNTK::profilerEvtChunkLoad);
+                                                          ReaderStageTimer timer("cntk_reader_chunk_load_seconds");
+                                                          return m_deserializer->GetChunk(chunkId);
+                                                      }) });
+        numLoading++;
 
         if (m_verbosity >= Debug)
-            fprintf(stderr, "BlockRandomizer::Prefetch: prefetching original chunk: %u\n", chunkId);
+            fprintf(stderr, "BlockRandomizer::Prefetch: prefetching original chunk: %u (%" PRIu64 " chunks in the prefetch queue)\n",
+                    chunkId, m_prefetchedChunks.size());
     }
 }
 
+void BlockRandomizer::SetPrefetchConfiguration(size_t maxChunks, size_t maxBytes, size_t numThreads)
+{
+    if (maxChunks == 0 || numThreads == 0)
+        InvalidArgument("BlockRandomizer: The number of chunks to prefetch and the number of prefetch threads must be positive.");
+
+    m_maxPrefetchedChunks = maxChunks;
+    m_maxPrefetchedBytes = maxBytes;
+    m_numPrefetchThreads = Microsoft::MSR::CNTK::Globals::GetNumReaderWorkerThreads(numThreads);
+}
+
+void BlockRandomizer::SetSequenceLengthBuckets(const std::vector<size_t>& boundaries)
+{
+    m_sequenceRandomizer->SetLengthBuckets(boundaries);
+    m_sweep = SIZE_MAX; // (re-randomize with the buckets)
+}
+
 void BlockRandomizer::SetState(const std::map<std::wstring, size_t>& state)
 {
     auto it = state.find(g_minibatchSourcePosition);
@@ -496,4 +619,13 @@ void BlockRandomizer::SetConfiguration(const ReaderConfiguration& config)
     *((ReaderConfiguration*)&m_config) = config;
 }
 
+bool BlockRandomizer::SetSequenceTransform(const SequenceTransform& transform)
+{
+    if (!m_multithreadedGetNextSequences)
+        return false;
+
+    m_sequenceTransform = transform;
+    return true;
+}
+
 }
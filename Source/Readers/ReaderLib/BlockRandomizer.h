@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <deque>
 #include <vector>
 
 #include "SequenceEnumerator.h"
@@ -65,9 +66,10 @@ public:
 
     ~BlockRandomizer()
     {
-        if (m_prefetch.valid())
+        for (auto& chunk : m_prefetchedChunks)
         {
-            m_prefetch.wait();
+            if (chunk.m_data.valid())
+                chunk.m_data.wait();
         }
     }
 
@@ -75,6 +77,41 @@ public:
 
     void SetConfiguration(const ReaderConfiguration& config) override;
 
+    bool SetSequenceTransform(const SequenceTransform& transform) override;
+
+    // Configures the prefetch of the chunks that are going to be needed next (by default one chunk at a time):
+    // at most maxChunks chunks with an estimated memory size of at most maxBytes in total (0 - no limit; at least one
+    // chunk is prefetched in any case) are kept in a queue, and up to numThreads of them are loaded concurrently.
+    // numThreads > 1 requires a deserializer that supports concurrent GetChunk() calls.
+    void SetPrefetchConfiguration(size_t maxChunks, size_t maxBytes, size_t numThreads);
+
+    // Changes the number of chunks of the prefetch configuration, at the next prefetch.
+    size_t GetNumPrefetchChunks() const override
+    {
+        return m_maxPrefetchedChunks;
+    }
+
+    bool SetNumPrefetchChunks(size_t numChunks) override
+    {
+        if (numChunks == 0)
+            InvalidArgument("BlockRandomizer: The number of chunks to prefetch must be positive.");
+        m_maxPrefetchedChunks = numChunks;
+        return true;
+    }
+
+    // Groups sequences of similar length within the randomization window (see SequenceRandomizer::SetLengthBuckets()),
+    // which reduces the padding of minibatches of sequences. Must be called before the first epoch is started.
+    void SetSequenceLengthBuckets(const std::vector<size_t>& boundaries);
+
+    // In distributed reading, assigns the chunks of each sweep to the workers so that all workers get about the same
+    // number of samples at any point of the sweep (see AssignChunksToWorkers()), instead of assigning them round robin
+    // by their randomized position, which gives the workers unequal shares of the samples when the chunk sizes vary.
+    void SetBalancedChunkDistribution(bool balanced)
+    {
+        m_balancedChunkDistribution = balanced;
+        m_chunkWorkersSweep = SIZE_MAX;
+    }
+
 private:
     // Load data for chunks if needed.
     void LoadDataChunks(const ClosedOpenChunkInterval& windowRange);
@@ -97,11 +134,34 @@ private:
     // Prepares a new sweep if needed.
     void PrepareNewSweepIfNeeded(size_t samplePosition);
 
-    // Performs io prefetch of the specified chunk if needed.
-    void Prefetch(ChunkIdType chunkId);
+    // Whether the randomized chunk belongs to this worker.
+    bool IsLocalChunk(ChunkIdType chunkId)
+    {
+        if (!m_balancedChunkDistribution)
+            return chunkId % m_config.m_numberOfWorkers == m_config.m_workerRank;
+
+        if (m_chunkWorkersSweep != m_sweep || m_chunkWorkersNumberOfWorkers != m_config.m_numberOfWorkers)
+            AssignChunksToWorkers();
+        return m_chunkWorkers[chunkId] == m_config.m_workerRank;
+    }
+
+    // Assigns the randomized chunks of the current sweep to the workers for the balanced chunk distribution.
+    void AssignChunksToWorkers();
+
+    // Performs io prefetch of the chunks following the given window if needed.
+    void Prefetch(const ClosedOpenChunkInterval& windowRange);
 
-    // Returns next candidate for the prefetch in the given range.
-    ChunkIdType GetChunkToPrefetch(const ClosedOpenChunkInterval& windowRange);
+    // Returns the chunks (randomized chunks indices) that should be prefetched after the given range.
+    std::vector<size_t> GetChunksToPrefetch(const ClosedOpenChunkInterval& windowRange);
+
+    // Returns the chunk with the given original chunk id, taken from the prefetch queue if it is there.
+    ChunkPtr GetChunk(ChunkIdType chunkId, bool& prefetched);
+
+    // Estimated memory size of a chunk, for the prefetch budget.
+    size_t EstimatedChunkSize(const RandomizedChunk& chunk) const
+    {
+        return chunk.m_original->m_numberOfSamples * m_estimatedBytesPerSample;
+    }
 
     // Global sample position on the timeline.
     size_t m_globalSamplePosition;
@@ -135,12 +195,22 @@ private:
     // Exposed streams.
     std::vector<StreamInformation> m_streams;
 
+    // Balanced chunk distribution, see SetBalancedChunkDistribution(): the workers of the randomized chunks,
+    // for the given sweep and number of workers.
+    bool m_balancedChunkDistribution;
+    std::vector<size_t> m_chunkWorkers;
+    size_t m_chunkWorkersSweep;
+    size_t m_chunkWorkersNumberOfWorkers;
+
     // A map of data chunks from original chunk id into chunk.
     std::map<size_t, ChunkPtr> m_chunks;
 
     // Whether to get sequences using multiple thread.
     bool m_multithreadedGetNextSequences;
 
+    // Applied to each sequence after it has been read, see SetSequenceTransform().
+    SequenceTransform m_sequenceTransform;
+
     // General configuration
     // TODO generalize those for ReaderLib / Reader / CNTK
     enum VerbosityLevel
@@ -153,12 +223,26 @@ private:
 
     int m_verbosity;
 
-    // Prefetch future.
-    std::future<ChunkPtr> m_prefetch;
+    // A chunk that is being or has been prefetched.
+    struct PrefetchedChunk
+    {
+        ChunkIdType m_id;              // original chunk id
+        size_t m_estimatedSize;        // estimated memory size in bytes
+        std::future<ChunkPtr> m_data;
+    };
+
+    // Prefetch queue, in the order the chunks are going to be needed.
+    std::deque<PrefetchedChunk> m_prefetchedChunks;
     // Whether to have async or deferred prefetch.
     launch m_launchType;
-    // Prefetched original chunk id.
-    ChunkIdType m_prefetchedChunk;
+    // Prefetch limits, see SetPrefetchConfiguration().
+    size_t m_maxPrefetchedChunks;
+    size_t m_maxPrefetchedBytes;
+    size_t m_numPrefetchThreads;
+    // Estimate of the memory a sample takes, see EstimatedBytesPerSample().
+    size_t m_estimatedBytesPerSample;
+    // Number of times a chunk was needed that had not been (completely) prefetched.
+    size_t m_numPrefetchStarvations;
 
     // Current loaded chunks.
     ClosedOpenChunkInterval m_currentWindowRange;
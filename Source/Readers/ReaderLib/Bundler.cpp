@@ -8,6 +8,8 @@
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 #include <set>
+#include <map>
+#include <future>
 
 namespace CNTK {
 
@@ -232,6 +234,37 @@ class Bundler::BundlingChunk : public Chunk
 
     DISABLE_COPY_AND_MOVE(BundlingChunk);
 
+    // Creates the sequence mapping of a non driving deserializer and requires its underlying chunks.
+    // All keys are resolved first, so that each underlying chunk is looked up only once.
+    void MapSecondarySequences(size_t deserializerIndex, const std::vector<SequenceInfo>& sequences, const std::set<size_t>& invalid)
+    {
+        auto& deserializer = m_parent->m_deserializers[deserializerIndex];
+        const size_t numberOfDeserializers = m_parent->m_deserializers.size();
+
+        // Exposed sequence indices per underlying chunk.
+        std::map<ChunkIdType, std::vector<size_t>> chunkSequences;
+        SequenceInfo s;
+        for (size_t sequenceIndex = 0; sequenceIndex < sequences.size(); ++sequenceIndex)
+        {
+            if (invalid.find(sequenceIndex) != invalid.end())
+            {
+                continue;
+            }
+
+            size_t currentIndex = sequenceIndex * numberOfDeserializers + deserializerIndex;
+            deserializer->GetSequenceInfo(sequences[sequenceIndex], s);
+            m_sequenceToSequence[currentIndex] = s.m_indexInChunk;
+            chunkSequences[s.m_chunkId].push_back(currentIndex);
+        }
+
+        for (const auto& c : chunkSequences)
+        {
+            ChunkPtr secondaryChunk = m_parent->GetSecondaryChunk(deserializerIndex, c.first);
+            for (size_t currentIndex : c.second)
+                m_innerChunks[currentIndex] = secondaryChunk;
+        }
+    }
+
 public:
     BundlingChunk(size_t numberOfInputs, Bundler* parent, ChunkIdType chunkId)
         : m_numberOfInputs(numberOfInputs), m_parent(parent), m_chunkId(chunkId)
@@ -244,10 +277,21 @@ public:
         sequences.reserve(original.m_numberOfSequences);
 
         // Creating chunk mapping.
+        // The chunks of the other deserializers are loaded concurrently with the one of the driving deserializer.
         m_parent->m_primaryDeserializer->SequenceInfosForChunk(original.m_id, sequences);
-        ChunkPtr drivingChunk = m_parent->m_primaryDeserializer->GetChunk(original.m_id);
         m_sequenceToSequence.resize(deserializers.size() * sequences.size());
         m_innerChunks.resize(deserializers.size() * sequences.size());
+
+        std::vector<std::future<void>> secondaryLoads;
+        for (size_t deserializerIndex = 1; deserializerIndex < deserializers.size(); ++deserializerIndex)
+        {
+            secondaryLoads.push_back(std::async(std::launch::async, [this, &sequences, &chunk, deserializerIndex]()
+            {
+                MapSecondarySequences(deserializerIndex, sequences, chunk.m_invalid);
+            }));
+        }
+
+        ChunkPtr drivingChunk = m_parent->m_primaryDeserializer->GetChunk(original.m_id);
         for (size_t sequenceIndex = 0; sequenceIndex < sequences.size(); ++sequenceIndex)
         {
             if (chunk.m_invalid.find(sequenceIndex) != chunk.m_invalid.end())
@@ -260,32 +304,8 @@ public:
             m_innerChunks[currentIndex] = drivingChunk;
         }
 
-        // Creating sequence mapping and requiring underlying chunks.
-        SequenceInfo s;
-        for (size_t deserializerIndex = 1; deserializerIndex < deserializers.size(); ++deserializerIndex)
-        {
-            auto& chunkTable = m_parent->m_weakChunkTable[deserializerIndex];
-            for (size_t sequenceIndex = 0; sequenceIndex < sequences.size(); ++sequenceIndex)
-            {
-                if (chunk.m_invalid.find(sequenceIndex) != chunk.m_invalid.end())
-                {
-                    continue;
-                }
-
-                size_t currentIndex = sequenceIndex * deserializers.size() + deserializerIndex;
-                deserializers[deserializerIndex]->GetSequenceInfo(sequences[sequenceIndex], s);
-                m_sequenceToSequence[currentIndex] = s.m_indexInChunk;
-
-                ChunkPtr secondaryChunk = chunkTable[s.m_chunkId].lock();
-                if (!secondaryChunk)
-                {
-                    secondaryChunk = deserializers[deserializerIndex]->GetChunk(s.m_chunkId);
-                    chunkTable[s.m_chunkId] = secondaryChunk;
-                }
-
-                m_innerChunks[currentIndex] = secondaryChunk;
-            }
-        }
+        for (auto& load : secondaryLoads)
+            load.get();
     }
 
     // Gets sequence by its index.
@@ -301,6 +321,28 @@ public:
     }
 };
 
+ChunkPtr Bundler::GetSecondaryChunk(size_t deserializerIndex, ChunkIdType chunkId)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_weakChunkTableMutex);
+        ChunkPtr chunk = m_weakChunkTable[deserializerIndex][chunkId].lock();
+        if (chunk)
+            return chunk;
+    }
+
+    // Loading outside of the lock, so that other deserializers and chunks are not blocked.
+    ChunkPtr chunk = m_deserializers[deserializerIndex]->GetChunk(chunkId);
+
+    std::lock_guard<std::mutex> lock(m_weakChunkTableMutex);
+    auto& entry = m_weakChunkTable[deserializerIndex][chunkId];
+    ChunkPtr loaded = entry.lock();
+    if (loaded) // loaded for another bundling chunk in the meantime
+        return loaded;
+
+    entry = chunk;
+    return chunk;
+}
+
 // Get chunk data by id.
 ChunkPtr Bundler::GetChunk(ChunkIdType chunkId)
 {
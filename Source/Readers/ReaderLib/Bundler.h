@@ -6,6 +6,7 @@
 #pragma once
 
 #include <set>
+#include <mutex>
 #include "DataDeserializerBase.h"
 #include "Config.h"
 
@@ -45,6 +46,9 @@ private:
     // Creates chunk descriptions based on chunks of underlying deserializers.
     void CreateChunkDescriptions();
 
+    // Gets a chunk of a non driving deserializer, loading it only if it is not in use by another bundling chunk.
+    ChunkPtr GetSecondaryChunk(size_t deserializerIndex, ChunkIdType chunkId);
+
     // Underlying deserializers.
     std::vector<DataDeserializerPtr> m_deserializers;
 
@@ -69,6 +73,7 @@ private:
     // A table of loaded chunks to make sure we do not load same chunk twice.
     // Inner vector is the table of chunk id into weak pointer, the outer vector has an element per deserializer.
     std::vector<std::vector<std::weak_ptr<Chunk>>> m_weakChunkTable;
+    std::mutex m_weakChunkTableMutex; // bundling chunks can be created concurrently by the prefetch threads
 
     // General configuration
     int m_verbosity;
@@ -48,6 +48,13 @@ public:
         return m_numericSequenceKeys;
     }
 
+    // True if symbolic keys are mapped to ids by registering them (i.e. the ids depend on the order
+    // in which the keys are seen).
+    bool UsesKeyRegistry() const
+    {
+        return !m_numericSequenceKeys && !m_useHash;
+    }
+
     // By default include all sequences.
     CorpusDescriptor(bool numericSequenceKeys, bool useHash = false)
         : m_includeAll(true), m_numericSequenceKeys(numericSequenceKeys), m_useHash(useHash)
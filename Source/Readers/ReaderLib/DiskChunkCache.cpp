@@ -0,0 +1,425 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "DiskChunkCache.h"
+#include "fileutil.h"
+
+namespace CNTK {
+
+// A chunk file consists of
+//   uint64 numIndices, numStreams
+//   uint64 offsets[numIndices * numStreams]   offset of the record of each sequence (by index in chunk) and stream, 0 if none
+// followed by the records, each aligned to 8 bytes:
+//   uint64 keySequence; uint32 keySample, numberOfSamples, isValid, rank; uint64 dims[rank]
+//   for sparse streams: uint32 totalNnzCount, padding; int32 nnzCounts[numberOfSamples], indices[totalNnzCount]; padding
+//   the elements
+struct CachedSequenceHeader
+{
+    uint64_t m_keySequence;
+    uint32_t m_keySample;
+    uint32_t m_numberOfSamples;
+    uint32_t m_isValid;
+    uint32_t m_rank;
+};
+
+static size_t AlignedSize(size_t size)
+{
+    return (size + 7) / 8 * 8;
+}
+
+template <class T>
+static void Append(std::vector<char>& buffer, const T* data, size_t count)
+{
+    const char* bytes = reinterpret_cast<const char*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T) * count);
+}
+
+static void Align(std::vector<char>& buffer)
+{
+    buffer.resize(AlignedSize(buffer.size()), 0);
+}
+
+// Sequences pointing into the mapped chunk file, which they keep alive.
+struct CachedDenseSequence : DenseSequenceData
+{
+    CachedDenseSequence(const std::shared_ptr<MappedFile>& file) : m_file(file) {}
+
+    const void* GetDataBuffer() override { return m_data; }
+    const NDShape& GetSampleShape() override { return m_sampleShape; }
+
+    NDShape m_sampleShape;
+    const void* m_data = nullptr;
+    std::shared_ptr<MappedFile> m_file;
+};
+
+struct CachedSparseSequence : SparseSequenceData
+{
+    CachedSparseSequence(const std::shared_ptr<MappedFile>& file) : m_file(file) {}
+
+    const void* GetDataBuffer() override { return m_data; }
+    const NDShape& GetSampleShape() override { return m_sampleShape; }
+
+    NDShape m_sampleShape;
+    const void* m_data = nullptr;
+    std::shared_ptr<MappedFile> m_file;
+};
+
+class CachedChunkData : public Chunk
+{
+public:
+    CachedChunkData(const std::shared_ptr<MappedFile>& file, const std::vector<StreamInformation>& streams)
+        : m_file(file), m_streams(streams)
+    {
+        const uint64_t* header = reinterpret_cast<const uint64_t*>(m_file->Data(0, 2 * sizeof(uint64_t)));
+        m_numIndices = header[0];
+        if (header[1] != m_streams.size())
+            LogicError("DiskChunkCache: unexpected number of streams in a chunk file.");
+        m_offsets = reinterpret_cast<const uint64_t*>(m_file->Data(2 * sizeof(uint64_t), m_numIndices * m_streams.size() * sizeof(uint64_t)));
+    }
+
+    void GetSequence(size_t sequenceIndex, std::vector<SequenceDataPtr>& result) override
+    {
+        if (sequenceIndex >= m_numIndices)
+            LogicError("DiskChunkCache: sequence index %zu is outside of the cached chunk.", sequenceIndex);
+
+        result.resize(m_streams.size());
+        for (size_t s = 0; s < m_streams.size(); s++)
+        {
+            uint64_t offset = m_offsets[sequenceIndex * m_streams.size() + s];
+            if (offset == 0)
+                LogicError("DiskChunkCache: sequence index %zu was not cached.", sequenceIndex);
+
+            const auto* header = reinterpret_cast<const CachedSequenceHeader*>(m_file->Data(offset, sizeof(CachedSequenceHeader)));
+            offset += sizeof(CachedSequenceHeader);
+            const auto* dims = reinterpret_cast<const uint64_t*>(m_file->Data(offset, header->m_rank * sizeof(uint64_t)));
+            offset += header->m_rank * sizeof(uint64_t);
+            NDShape sampleShape = header->m_rank > 0 ? NDShape(std::vector<size_t>(dims, dims + header->m_rank)) : m_streams[s].m_sampleLayout;
+            const size_t elementSize = DataTypeSize(m_streams[s].m_elementType);
+
+            SequenceDataPtr sequence;
+            if (m_streams[s].m_storageFormat == StorageFormat::Dense)
+            {
+                auto dense = std::make_shared<CachedDenseSequence>(m_file);
+                const size_t dataSize = header->m_isValid ? elementSize * sampleShape.TotalSize() * header->m_numberOfSamples : 0;
+                dense->m_data = m_file->Data(offset, dataSize);
+                dense->m_sampleShape = sampleShape;
+                sequence = dense;
+            }
+            else
+            {
+                auto sparse = std::make_shared<CachedSparseSequence>(m_file);
+                const uint32_t totalNnzCount = *reinterpret_cast<const uint32_t*>(m_file->Data(offset, sizeof(uint32_t)));
+                offset += 2 * sizeof(uint32_t);
+                const auto* nnzCounts = reinterpret_cast<const SparseIndexType*>(m_file->Data(offset, header->m_numberOfSamples * sizeof(SparseIndexType)));
+                offset += header->m_numberOfSamples * sizeof(SparseIndexType);
+                sparse->m_nnzCounts.assign(nnzCounts, nnzCounts + header->m_numberOfSamples);
+                sparse->m_totalNnzCount = totalNnzCount;
+                // read-only, like the static data of e.g. CategorySequenceData
+                sparse->m_indices = const_cast<SparseIndexType*>(reinterpret_cast<const SparseIndexType*>(m_file->Data(offset, totalNnzCount * sizeof(SparseIndexType))));
+                offset = AlignedSize(offset + totalNnzCount * sizeof(SparseIndexType));
+                sparse->m_data = m_file->Data(offset, elementSize * totalNnzCount);
+                sparse->m_sampleShape = sampleShape;
+                sequence = sparse;
+            }
+
+            sequence->m_numberOfSamples = header->m_numberOfSamples;
+            sequence->m_elementType = m_streams[s].m_elementType;
+            sequence->m_isValid = !!header->m_isValid;
+            sequence->m_key = SequenceKey(header->m_keySequence, header->m_keySample);
+            result[s] = sequence;
+        }
+    }
+
+private:
+    std::shared_ptr<MappedFile> m_file;
+    std::vector<StreamInformation> m_streams;
+    uint64_t m_numIndices;
+    const uint64_t* m_offsets;
+};
+
+enum class LockResult
+{
+    acquired,
+    busy,   // held by another process (or thread)
+    failed, // cannot be created, e.g. in a read-only directory
+};
+
+// Creates the lock file of a chunk of a shared cache, which exists while the chunk is being written.
+static LockResult TryCreateLockFile(const std::wstring& path)
+{
+#ifdef _WIN32
+    int fd = _wopen(path.c_str(), _O_CREAT | _O_EXCL | _O_WRONLY, _S_IREAD | _S_IWRITE);
+#else
+    int fd = open(wtocharpath(path).c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+#endif
+    if (fd < 0)
+        return errno == EEXIST ? LockResult::busy : LockResult::failed;
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+    return LockResult::acquired;
+}
+
+const int DiskChunkCache::s_sharedChunkWaitSeconds;
+
+DiskChunkCache::DiskChunkCache(DataDeserializerPtr deserializer, const std::wstring& directory, uint64_t maxSizeInBytes, bool shared)
+    : m_deserializer(deserializer),
+      m_streams(deserializer->StreamInfos()),
+      m_maxSizeInBytes(maxSizeInBytes),
+      m_sizeInBytes(0),
+      m_writeFailed(false),
+      m_shared(shared)
+{
+    // Each cache (e.g. of the training and of the cross-validation reader) has a directory of its own. The processes
+    // sharing a cache create their readers in the same order, so that they agree on the directory of each.
+    static std::atomic<int> s_numCaches(0);
+    if (m_shared)
+        m_directory = directory + L"/shared_" + std::to_wstring(s_numCaches++);
+    else
+        m_directory = directory + L"/" + std::to_wstring(GetCurrentProcessId()) + L"_" + std::to_wstring(s_numCaches++);
+}
+
+DiskChunkCache::~DiskChunkCache()
+{
+    for (const auto& chunk : m_chunks)
+    {
+        if (chunk.second.m_owned)
+            _wunlink(chunk.second.m_path.c_str());
+    }
+#ifdef _WIN32
+    _wrmdir(m_directory.c_str());
+#else
+    rmdir(wtocharpath(m_directory).c_str());
+#endif
+}
+
+ChunkPtr DiskChunkCache::GetChunk(ChunkIdType chunkId)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_chunks.find(chunkId);
+        if (it != m_chunks.end())
+        {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.m_lruPosition);
+            if (!it->second.m_file)
+                it->second.m_file = std::make_shared<MappedFile>(it->second.m_path);
+            it->second.m_file->WillNeed(0, it->second.m_size);
+            return std::make_shared<CachedChunkData>(it->second.m_file, m_streams);
+        }
+        if (m_writeFailed || (m_shared && m_unsharedChunks.find(chunkId) != m_unsharedChunks.end()))
+            return m_deserializer->GetChunk(chunkId);
+    }
+
+    std::wstring path = m_directory + L"/chunk" + std::to_wstring(chunkId) + L".bin";
+    bool locked = false;
+    if (m_shared)
+    {
+        ChunkPtr published = TryGetSharedChunk(chunkId, path, locked);
+        if (published)
+            return published;
+        if (!locked)
+            return m_deserializer->GetChunk(chunkId);
+    }
+    // the other processes wait for the chunk while its lock file exists
+    struct Unlocker
+    {
+        std::wstring path;
+        bool locked;
+        ~Unlocker() { if (locked) _wunlink(path.c_str()); }
+    } unlocker{ path + L".lock", locked };
+
+    ChunkPtr chunk = m_deserializer->GetChunk(chunkId);
+
+    // A shared chunk is written to a temporary file first, so that the other processes never map it partially written.
+    const std::wstring writePath = m_shared ? path + L".tmp" + std::to_wstring(GetCurrentProcessId()) : path;
+    uint64_t size;
+    try
+    {
+        size = WriteChunk(chunkId, chunk, writePath);
+        if (m_shared)
+            renameOrDie(writePath, path);
+    }
+    catch (const std::exception& e)
+    {
+        _wunlink(writePath.c_str());
+        std::lock_guard<std::mutex> lock(m_mutex);
+        fprintf(stderr, "DiskChunkCache: no more chunks are cached in '%ls', since writing one failed: %s\n", m_directory.c_str(), e.what());
+        m_writeFailed = true;
+        return chunk;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_maxSizeInBytes > 0 && size > m_maxSizeInBytes)
+    {
+        _wunlink(path.c_str()); // would not fit on its own
+        return chunk;
+    }
+    if (m_chunks.find(chunkId) != m_chunks.end()) // (cached by another thread in the meantime)
+        return chunk;
+    MakeRoomFor(size);
+    m_lru.push_front(chunkId);
+    m_chunks[chunkId] = CachedChunk{ path, size, nullptr, m_lru.begin(), /*owned=*/true };
+    m_sizeInBytes += size;
+    return chunk;
+}
+
+ChunkPtr DiskChunkCache::TryGetSharedChunk(ChunkIdType chunkId, const std::wstring& path, bool& locked)
+{
+    const std::wstring lockPath = path + L".lock";
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(s_sharedChunkWaitSeconds);
+    locked = false;
+    msra::files::make_intermediate_dirs(path);
+    auto notShared = [&](const char* reason) -> ChunkPtr
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        fprintf(stderr, "DiskChunkCache: chunk %u is not shared in '%ls', since %s.\n", (unsigned int)chunkId, m_directory.c_str(), reason);
+        m_unsharedChunks.insert(chunkId);
+        return nullptr;
+    };
+    for (;; std::this_thread::sleep_for(std::chrono::milliseconds(10)))
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return notShared("it was not published in time");
+
+        if (fexists(path))
+        {
+            std::shared_ptr<MappedFile> file;
+            try
+            {
+                file = std::make_shared<MappedFile>(path);
+            }
+            catch (const std::exception&)
+            {
+                continue; // (e.g. evicted by its owner in the meantime)
+            }
+            auto chunk = std::make_shared<CachedChunkData>(file, m_streams);
+            file->WillNeed(0, file->Size());
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_chunks.find(chunkId) == m_chunks.end())
+            {
+                MakeRoomFor(file->Size());
+                m_lru.push_front(chunkId);
+                m_chunks[chunkId] = CachedChunk{ path, file->Size(), file, m_lru.begin(), /*owned=*/false };
+                m_sizeInBytes += file->Size();
+            }
+            return chunk;
+        }
+
+        auto result = TryCreateLockFile(lockPath);
+        if (result == LockResult::acquired)
+        {
+            if (!fexists(path)) // (else it was published just before)
+            {
+                locked = true;
+                return nullptr;
+            }
+            _wunlink(lockPath.c_str());
+        }
+
+        if (result == LockResult::failed)
+            return notShared("its lock file cannot be created");
+    }
+}
+
+uint64_t DiskChunkCache::WriteChunk(ChunkIdType chunkId, const ChunkPtr& chunk, const std::wstring& path)
+{
+    std::vector<SequenceInfo> sequences;
+    m_deserializer->SequenceInfosForChunk(chunkId, sequences);
+    size_t numIndices = 0;
+    for (const auto& s : sequences)
+        numIndices = std::max(numIndices, s.m_indexInChunk + 1);
+
+    const size_t numStreams = m_streams.size();
+    std::vector<uint64_t> offsets(numIndices * numStreams, 0);
+    std::vector<char> buffer((2 + offsets.size()) * sizeof(uint64_t));
+    std::vector<SequenceDataPtr> data;
+    for (const auto& s : sequences)
+    {
+        data.clear();
+        chunk->GetSequence(s.m_indexInChunk, data);
+        if (data.size() != numStreams)
+            LogicError("DiskChunkCache: unexpected number of streams in a sequence.");
+
+        for (size_t i = 0; i < numStreams; i++)
+        {
+            const auto& sequence = data[i];
+            offsets[s.m_indexInChunk * numStreams + i] = buffer.size();
+
+            NDShape sampleShape = sequence->m_isValid ? sequence->GetSampleShape() : NDShape();
+            CachedSequenceHeader header = { sequence->m_key.m_sequence, sequence->m_key.m_sample, sequence->m_numberOfSamples,
+                                            (uint32_t)sequence->m_isValid, (uint32_t)sampleShape.Rank() };
+            Append(buffer, &header, 1);
+            std::vector<uint64_t> dims(sampleShape.Dimensions().begin(), sampleShape.Dimensions().end());
+            Append(buffer, dims.data(), dims.size());
+
+            const size_t elementSize = DataTypeSize(m_streams[i].m_elementType);
+            if (m_streams[i].m_storageFormat == StorageFormat::Dense)
+            {
+                if (sequence->m_isValid)
+                    Append(buffer, (const char*)sequence->GetDataBuffer(), elementSize * sampleShape.TotalSize() * sequence->m_numberOfSamples);
+            }
+            else
+            {
+                auto sparse = std::static_pointer_cast<SparseSequenceData>(sequence);
+                uint32_t nnz[2] = { (uint32_t)sparse->m_totalNnzCount, 0 };
+                Append(buffer, nnz, 2);
+                std::vector<SparseIndexType> nnzCounts(sparse->m_nnzCounts);
+                nnzCounts.resize(sequence->m_numberOfSamples, 0);
+                Append(buffer, nnzCounts.data(), nnzCounts.size());
+                Append(buffer, sparse->m_indices, sparse->m_totalNnzCount);
+                Align(buffer);
+                Append(buffer, (const char*)sequence->GetDataBuffer(), elementSize * sparse->m_totalNnzCount);
+            }
+            Align(buffer);
+        }
+    }
+
+    uint64_t* header = reinterpret_cast<uint64_t*>(buffer.data());
+    header[0] = numIndices;
+    header[1] = numStreams;
+    memcpy(header + 2, offsets.data(), offsets.size() * sizeof(uint64_t));
+
+    msra::files::make_intermediate_dirs(path);
+    auto file = std::shared_ptr<FILE>(fopenOrDie(path, L"wb"), [](FILE* f) { if (f) fclose(f); });
+    fwriteOrDie(buffer.data(), 1, buffer.size(), file.get());
+    if (fflush(file.get()) != 0)
+        RuntimeError("error writing to file '%ls': %s", path.c_str(), strerror(errno));
+    return buffer.size();
+}
+
+void DiskChunkCache::MakeRoomFor(uint64_t size)
+{
+    while (m_maxSizeInBytes > 0 && m_sizeInBytes + size > m_maxSizeInBytes && !m_lru.empty())
+    {
+        auto it = m_chunks.find(m_lru.back());
+        // chunks that are still in use keep their (deleted) file mapped; chunks of other processes are only forgotten
+        if (it->second.m_owned)
+            _wunlink(it->second.m_path.c_str());
+        m_sizeInBytes -= it->second.m_size;
+        m_lru.pop_back();
+        m_chunks.erase(it);
+    }
+}
+
+}
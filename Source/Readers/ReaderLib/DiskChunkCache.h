@@ -0,0 +1,100 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include "DataDeserializer.h"
+#include "MappedFile.h"
+
+namespace CNTK {
+
+// A second cache tier for data sets that are read from slow storage and do not fit in memory.
+// Implemented as a wrapping proxy around a deserializer (like ChunkCache): the sequences of each chunk
+// the deserializer loads are written in decoded form to a file in a directory on local disk, and
+// subsequent requests for the chunk are served from that file (mapped into memory, with the OS reading
+// it in in the background), so that the deserializer only decodes each chunk once.
+// The files take up at most the given disk space; if a new chunk does not fit, the least recently
+// used chunks are evicted. The files are deleted when the cache is destroyed.
+// A shared cache serves the worker processes of a distributed job on the same host (which each request the same
+// chunks, e.g. from the NoRandomizer): the chunk files are published under a name common to all processes, and a
+// chunk one process is writing is waited for by the others, so that each chunk is decoded once per host rather than
+// once per process. With the directory on a memory file system (e.g. /dev/shm), the processes share the decoded
+// data in memory. The size limit then applies to the chunks each process maps, a process only deletes the files it
+// wrote, and the directory must not be shared by different jobs or data sets.
+class DiskChunkCache : public DataDeserializer
+{
+public:
+    // maxSizeInBytes == 0 means no limit
+    DiskChunkCache(DataDeserializerPtr deserializer, const std::wstring& directory, uint64_t maxSizeInBytes, bool shared = false);
+    ~DiskChunkCache();
+
+    virtual std::vector<StreamInformation> StreamInfos() override
+    {
+        return m_streams;
+    }
+
+    virtual std::vector<ChunkInfo> ChunkInfos() override
+    {
+        return m_deserializer->ChunkInfos();
+    }
+
+    virtual void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& descriptions) override
+    {
+        return m_deserializer->SequenceInfosForChunk(chunkId, descriptions);
+    }
+
+    virtual bool GetSequenceInfo(const SequenceInfo& primary, SequenceInfo& description) override
+    {
+        return m_deserializer->GetSequenceInfo(primary, description);
+    }
+
+    // Gets chunk data given its id.
+    virtual ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+private:
+    struct CachedChunk
+    {
+        std::wstring m_path;
+        uint64_t m_size;
+        std::shared_ptr<MappedFile> m_file;
+        std::list<ChunkIdType>::iterator m_lruPosition;
+        bool m_owned; // written by this process, rather than by another one sharing the cache
+    };
+
+    // Of a shared cache: maps the chunk if another process has published it, waiting for it if it is being written.
+    // Otherwise returns nullptr, with 'locked' set if this process is to write the chunk.
+    ChunkPtr TryGetSharedChunk(ChunkIdType chunkId, const std::wstring& path, bool& locked);
+
+    // Writes all sequences of the chunk to a file, and returns its size.
+    uint64_t WriteChunk(ChunkIdType chunkId, const ChunkPtr& chunk, const std::wstring& path);
+
+    // Evicts the least recently used chunks until the given number of bytes fits.
+    void MakeRoomFor(uint64_t size);
+
+    DataDeserializerPtr m_deserializer;
+    std::vector<StreamInformation> m_streams;
+    std::wstring m_directory;
+    const uint64_t m_maxSizeInBytes;
+    uint64_t m_sizeInBytes;
+    bool m_writeFailed; // no more chunks are added after a failure to write one (e.g. the disk is full)
+    const bool m_shared;
+    std::set<ChunkIdType> m_unsharedChunks; // chunks of a shared cache that another process did not publish in time
+
+    // How long to wait for a chunk that another process is writing to a shared cache.
+    static const int s_sharedChunkWaitSeconds = 120;
+
+    std::mutex m_mutex;
+    std::map<ChunkIdType, CachedChunk> m_chunks;
+    std::list<ChunkIdType> m_lru; // most recently used first
+
+    DISABLE_COPY_AND_MOVE(DiskChunkCache);
+};
+
+}
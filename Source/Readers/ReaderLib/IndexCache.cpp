@@ -0,0 +1,312 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define __STDC_FORMAT_MACROS
+#define _CRT_SECURE_NO_WARNINGS
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <chrono>
+#include <thread>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "IndexCache.h"
+#include "fileutil.h"
+
+namespace CNTK {
+
+enum class KeyEncoding : uint8_t
+{
+    id = 0,     // numeric (or hashed) keys, stored as is
+    string = 1, // keys from the corpus registry, stored as strings
+};
+
+static KeyEncoding GetKeyEncoding(const CorpusDescriptorPtr& corpus)
+{
+    return corpus->UsesKeyRegistry() ? KeyEncoding::string : KeyEncoding::id;
+}
+
+static bool RemoveFile(const std::wstring& file)
+{
+#ifdef _WIN32
+    return _wunlink(file.c_str()) == 0;
+#else
+    return unlink(wtocharpath(file).c_str()) == 0;
+#endif
+}
+
+const uint64_t IndexCache::s_magic;
+const uint32_t IndexCache::s_version;
+const int64_t IndexCache::s_staleLockSeconds;
+
+IndexCache::IndexCache(const std::wstring& inputFile, const std::string& parameters)
+    : m_inputFile(inputFile), m_cacheFile(inputFile + L".index"), m_lockFile(m_cacheFile + L".lock"), m_parameters(parameters), m_locked(false)
+{
+}
+
+IndexCache::~IndexCache()
+{
+    Unlock();
+}
+
+IndexCache::LockResult IndexCache::TryLock()
+{
+#ifdef _WIN32
+    int fd = _wopen(m_lockFile.c_str(), _O_CREAT | _O_EXCL | _O_WRONLY, _S_IREAD | _S_IWRITE);
+#else
+    int fd = open(wtocharpath(m_lockFile).c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+#endif
+    if (fd < 0)
+        return errno == EEXIST ? LockResult::busy : LockResult::failed;
+
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+    m_locked = true;
+    return LockResult::acquired;
+}
+
+void IndexCache::Unlock()
+{
+    if (!m_locked)
+        return;
+
+    m_locked = false;
+    RemoveFile(m_lockFile);
+}
+
+/*static*/ bool IndexCache::TryGetFileInfo(const std::wstring& file, uint64_t& size, int64_t& modificationTime)
+{
+#ifdef _WIN32
+    struct _stat64 buf;
+    if (_wstat64(file.c_str(), &buf) != 0)
+        return false;
+#else
+    struct stat buf;
+    if (stat(wtocharpath(file).c_str(), &buf) != 0)
+        return false;
+#endif
+    size = buf.st_size;
+    modificationTime = buf.st_mtime;
+    return true;
+}
+
+bool IndexCache::TryGetInputFileInfo(uint64_t& size, int64_t& modificationTime) const
+{
+    return TryGetFileInfo(m_inputFile, size, modificationTime);
+}
+
+bool IndexCache::TryLoad(CorpusDescriptorPtr corpus, Index& index, uint32_t& flags)
+{
+    assert(index.IsEmpty());
+
+    uint64_t inputSize;
+    int64_t modificationTime;
+    if (!TryGetInputFileInfo(inputSize, modificationTime))
+        return false;
+
+    auto file = std::shared_ptr<FILE>(_wfopen(m_cacheFile.c_str(), L"rb"), [](FILE* f) { if (f) fclose(f); });
+    if (!file)
+        return false;
+
+    CacheReader reader(file.get());
+    bool valid = reader.Read<uint64_t>() == s_magic &&
+                 reader.Read<uint32_t>() == s_version &&
+                 reader.Read<uint64_t>() == inputSize &&
+                 reader.Read<int64_t>() == modificationTime &&
+                 reader.ReadString() == m_parameters &&
+                 reader.Read<uint64_t>() == index.m_maxChunkSize &&
+                 reader.Read<uint8_t>() == (uint8_t)index.m_primary &&
+                 reader.Read<uint8_t>() == (uint8_t)index.m_trackFirstSamples &&
+                 reader.Read<KeyEncoding>() == GetKeyEncoding(corpus);
+    if (!valid || !reader.Ok())
+    {
+        fprintf(stderr, "IndexCache: Index cache '%ls' is out of date, rebuilding it.\n", m_cacheFile.c_str());
+        return false;
+    }
+
+    flags = reader.Read<uint32_t>();
+    const auto numSequences = reader.Read<uint64_t>();
+    const bool keysAreStrings = GetKeyEncoding(corpus) == KeyEncoding::string;
+
+    // Read all of it before touching the corpus, so that a truncated cache does not register any keys.
+    struct CachedSequence
+    {
+        size_t key;
+        uint32_t numberOfSamples;
+        uint64_t offset;
+        uint32_t size;
+    };
+    if (!reader.Ok() || numSequences > inputSize) // (every sequence takes at least one byte of the input)
+    {
+        fprintf(stderr, "WARNING: Index cache '%ls' is corrupt, rebuilding it.\n", m_cacheFile.c_str());
+        return false;
+    }
+    std::vector<CachedSequence> sequences;
+    std::vector<std::string> keys;
+    sequences.reserve(numSequences);
+    for (uint64_t i = 0; i < numSequences && reader.Ok(); i++)
+    {
+        CachedSequence s;
+        if (keysAreStrings)
+        {
+            keys.push_back(reader.ReadString());
+            s.key = 0;
+        }
+        else
+            s.key = reader.Read<uint64_t>();
+        s.numberOfSamples = reader.Read<uint32_t>();
+        s.offset = reader.Read<uint64_t>();
+        s.size = reader.Read<uint32_t>();
+        sequences.push_back(s);
+    }
+    if (!reader.Ok() || reader.Read<uint64_t>() != s_magic || !reader.Ok())
+    {
+        fprintf(stderr, "WARNING: Index cache '%ls' is truncated or corrupt, rebuilding it.\n", m_cacheFile.c_str());
+        return false;
+    }
+
+    for (size_t i = 0; i < sequences.size(); i++)
+    {
+        const auto& s = sequences[i];
+        size_t key = keysAreStrings ? corpus->KeyToId(keys[i]) : s.key;
+        index.AddSequence(SequenceDescriptor{ key, s.numberOfSamples }, s.offset, s.offset + s.size);
+    }
+
+    fprintf(stderr, "IndexCache: Loaded the index of '%ls' (%" PRIu64 " sequences) from '%ls'.\n",
+            m_inputFile.c_str(), numSequences, m_cacheFile.c_str());
+    return true;
+}
+
+bool IndexCache::TryLoadOrLock(CorpusDescriptorPtr corpus, Index& index, uint32_t& flags)
+{
+    uint64_t cacheSize = 0;
+    int64_t cacheTime = 0;
+    TryGetFileInfo(m_cacheFile, cacheSize, cacheTime);
+    if (TryLoad(corpus, index, flags))
+        return true;
+
+    bool waited = false;
+    for (;;)
+    {
+        auto result = TryLock();
+        if (result == LockResult::acquired)
+            break;
+        if (result == LockResult::failed)
+            return false; // build it without a lock, it cannot be saved either
+
+        uint64_t lockSize;
+        int64_t lockTime;
+        if (TryGetFileInfo(m_lockFile, lockSize, lockTime) && time(nullptr) - lockTime > s_staleLockSeconds)
+        {
+            fprintf(stderr, "WARNING: Removing the stale index cache lock '%ls'.\n", m_lockFile.c_str());
+            RemoveFile(m_lockFile);
+            continue;
+        }
+
+        if (!waited)
+        {
+            fprintf(stderr, "IndexCache: Waiting for another process to build the index of '%ls' (remove '%ls' if there is none).\n",
+                    m_inputFile.c_str(), m_lockFile.c_str());
+            waited = true;
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+
+    // Another process may have written the cache in the meantime.
+    uint64_t newCacheSize = 0;
+    int64_t newCacheTime = 0;
+    TryGetFileInfo(m_cacheFile, newCacheSize, newCacheTime);
+    if ((newCacheSize != cacheSize || newCacheTime != cacheTime) && TryLoad(corpus, index, flags))
+    {
+        Unlock();
+        return true;
+    }
+    return false;
+}
+
+void IndexCache::Save(CorpusDescriptorPtr corpus, const Index& index, uint32_t flags)
+{
+    // the other processes only check the cache once the lock is released
+    struct Unlocker
+    {
+        IndexCache& cache;
+        ~Unlocker() { cache.Unlock(); }
+    } unlocker{ *this };
+
+    uint64_t inputSize;
+    int64_t modificationTime;
+    if (!TryGetInputFileInfo(inputSize, modificationTime))
+        return;
+
+    // Write to a temporary file first, so that concurrent readers (e.g. the other workers of a distributed job)
+    // never see a partially written cache.
+    const std::wstring tempFile = m_cacheFile + L".tmp" + std::to_wstring(GetCurrentProcessId());
+    FILE* f = _wfopen(tempFile.c_str(), L"wb");
+    if (!f)
+    {
+        fprintf(stderr, "WARNING: Cannot write the index cache '%ls', the index will be rebuilt on the next run.\n", m_cacheFile.c_str());
+        return;
+    }
+
+    uint64_t numSequences = 0;
+    for (const auto& chunk : index.Chunks())
+        numSequences += chunk.Sequences().size();
+
+    const auto keyEncoding = GetKeyEncoding(corpus);
+    CacheWriter writer(f);
+    writer.Write(s_magic);
+    writer.Write(s_version);
+    writer.Write(inputSize);
+    writer.Write(modificationTime);
+    writer.Write(m_parameters);
+    writer.Write((uint64_t)index.m_maxChunkSize);
+    writer.Write((uint8_t)index.m_primary);
+    writer.Write((uint8_t)index.m_trackFirstSamples);
+    writer.Write(keyEncoding);
+    writer.Write(flags);
+    writer.Write(numSequences);
+    for (const auto& chunk : index.Chunks())
+    {
+        for (const auto& s : chunk.Sequences())
+        {
+            if (keyEncoding == KeyEncoding::string)
+                writer.Write(corpus->IdToKey(s.m_key));
+            else
+                writer.Write((uint64_t)s.m_key);
+            writer.Write(s.m_numberOfSamples);
+            writer.Write((uint64_t)(chunk.m_offset + s.OffsetInChunk()));
+            writer.Write(s.SizeInBytes());
+        }
+    }
+    writer.Write(s_magic);
+
+    bool ok = writer.Ok();
+    ok = (fclose(f) == 0) && ok;
+    try
+    {
+        if (ok)
+            renameOrDie(tempFile, m_cacheFile);
+        else
+            unlinkOrDie(tempFile);
+    }
+    catch (const std::exception&)
+    {
+        ok = false;
+    }
+
+    if (!ok)
+        fprintf(stderr, "WARNING: Cannot write the index cache '%ls', the index will be rebuilt on the next run.\n", m_cacheFile.c_str());
+}
+
+}
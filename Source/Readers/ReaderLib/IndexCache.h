@@ -0,0 +1,145 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include "Indexer.h"
+
+namespace CNTK {
+
+// Writers and readers of the binary cache files of the deserializers (see IndexCache, MLFLabelCache).
+
+// Writes to a file, remembering whether all writes succeeded.
+class CacheWriter
+{
+public:
+    explicit CacheWriter(FILE* f) : m_file(f), m_ok(true) {}
+
+    template <class T>
+    void Write(const T& value) { Write(&value, sizeof(value)); }
+
+    void Write(const std::string& s)
+    {
+        Write((uint32_t)s.size());
+        Write(s.data(), s.size());
+    }
+
+    void Write(const void* data, size_t size)
+    {
+        if (m_ok && size > 0)
+            m_ok = fwrite(data, size, 1, m_file) == 1;
+    }
+
+    bool Ok() const { return m_ok; }
+
+private:
+    FILE* m_file;
+    bool m_ok;
+};
+
+// Reads from a file, remembering whether all reads succeeded.
+class CacheReader
+{
+public:
+    explicit CacheReader(FILE* f) : m_file(f), m_ok(true) {}
+
+    template <class T>
+    T Read()
+    {
+        T value = T();
+        Read(&value, sizeof(value));
+        return value;
+    }
+
+    std::string ReadString()
+    {
+        std::string s(Read<uint32_t>(), '\0');
+        if (m_ok)
+            Read(&s[0], s.size());
+        return s;
+    }
+
+    void Read(void* data, size_t size)
+    {
+        if (m_ok && size > 0)
+            m_ok = fread(data, size, 1, m_file) == 1;
+    }
+
+    bool Ok() const { return m_ok; }
+
+private:
+    FILE* m_file;
+    bool m_ok;
+};
+
+// Persists an index of an input file in a sidecar file ("<input file>.index"), so that the input file does not
+// have to be scanned again on the next run. The cached index is only used if the size and the modification time of the
+// input file, as well as the parameters the index was built with, are the same as when it was written; otherwise
+// it is rebuilt (and the cache rewritten).
+// Sequence keys are stored as strings if the corpus maps them to ids with a registry, and are registered with the
+// corpus again on load (in the original order).
+// Processes that need the same index at the same time (e.g. the workers of a distributed job) build it only once:
+// the first one creates a lock file ("<input file>.index.lock") while it builds and saves the index, and the others
+// wait for the lock to be released and then load the index from the cache.
+class IndexCache
+{
+public:
+    // 'parameters' describes everything (except for the input itself) the index depends on, e.g. the chunk size.
+    IndexCache(const std::wstring& inputFile, const std::string& parameters);
+
+    ~IndexCache();
+
+    // Loads the cached index into the (empty) index; returns false if there is no valid cache for the input.
+    // 'flags' returns the value passed to Save().
+    bool TryLoad(CorpusDescriptorPtr corpus, Index& index, uint32_t& flags);
+
+    // Like TryLoad(), but if there is no valid cache and another process is building the index, waits for it and loads
+    // its index. Returns false if this process has to build the index; it then holds the lock until Save().
+    bool TryLoadOrLock(CorpusDescriptorPtr corpus, Index& index, uint32_t& flags);
+
+    // Writes the index to the cache, and releases the lock. Failures (e.g. due to a read-only input directory) are not fatal.
+    // 'flags' can be used by the indexer to store additional properties of the index.
+    void Save(CorpusDescriptorPtr corpus, const Index& index, uint32_t flags = 0);
+
+    const std::wstring& CacheFile() const { return m_cacheFile; }
+
+    // Size and modification time of a file, which identify the version of an input a cache was written for;
+    // false if they can't be determined.
+    static bool TryGetFileInfo(const std::wstring& file, uint64_t& size, int64_t& modificationTime);
+
+private:
+    // Size and modification time of the input file; false if they can't be determined.
+    bool TryGetInputFileInfo(uint64_t& size, int64_t& modificationTime) const;
+
+    enum class LockResult
+    {
+        acquired,
+        busy,   // held by another process
+        failed, // cannot be created, e.g. in a read-only directory
+    };
+
+    LockResult TryLock();
+    void Unlock();
+
+    std::wstring m_inputFile;
+    std::wstring m_cacheFile;
+    std::wstring m_lockFile;
+    std::string m_parameters;
+    bool m_locked;
+
+    // A lock older than this was left behind by a process that did not finish building the index.
+    static const int64_t s_staleLockSeconds = 15 * 60;
+
+    static const uint64_t s_magic = 0x7864695f6b746e63U; // "cntk_idx"
+    static const uint32_t s_version = 1;
+
+    DISABLE_COPY_AND_MOVE(IndexCache);
+};
+
+typedef std::shared_ptr<IndexCache> IndexCachePtr;
+
+}
@@ -7,6 +7,10 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include <inttypes.h>
 #include "Indexer.h"
+#include "IndexCache.h"
+#include "Globals.h"
+#include <future>
+#include <thread>
 #include <boost/utility/string_ref.hpp>
 #include <boost/algorithm/string.hpp>
 
@@ -20,7 +24,9 @@ Indexer::Indexer(FILE* file, bool primary, bool skipSequenceIds, char streamPref
     m_file(file),
     m_hasSequenceIds(!skipSequenceIds),
     m_index(chunkSize, primary),
-    m_mainStream(mainStream)
+    m_mainStream(mainStream),
+    m_numThreads(1),
+    m_minRangeSize(0)
 {
     if (m_file == nullptr)
         RuntimeError("Input file not open for reading");
@@ -52,6 +58,27 @@ void Indexer::BuildFromLines()
     }
 }
 
+void Indexer::EnableCache(const std::wstring& inputFile)
+{
+    std::string parameters = "Indexer skipSequenceIds=" + std::to_string(!m_hasSequenceIds) +
+                             " streamPrefix=" + std::string(1, m_streamPrefix) + " mainStream=" + m_mainStream;
+    m_cache = make_shared<IndexCache>(inputFile, parameters);
+}
+
+void Indexer::EnableParallelBuild(const std::wstring& inputFile, size_t numThreads, size_t minRangeSize)
+{
+    m_inputFile = inputFile;
+    m_numThreads = Microsoft::MSR::CNTK::Globals::GetNumReaderWorkerThreads(numThreads);
+    m_minRangeSize = std::max(minRangeSize, (size_t)1);
+}
+
+void Indexer::SetRange(int64_t begin, int64_t end)
+{
+    fsetpos(m_file, begin);
+    m_buffer.SetFileRange(begin, end);
+    m_fileSize = end;
+}
+
 void Indexer::Build(CorpusDescriptorPtr corpus)
 {
     if (!m_index.IsEmpty())
@@ -59,13 +86,142 @@ void Indexer::Build(CorpusDescriptorPtr corpus)
         return;
     }
 
-    // Create a lambda to read symbolic or numeric sequence ids,
-    // depending on what the corpus expects.
-    std::function<bool(size_t&)> tryGetSequenceId;
+    uint32_t hasSequenceIds;
+    if (m_cache && m_cache->TryLoadOrLock(corpus, m_index, hasSequenceIds))
+    {
+        m_hasSequenceIds = hasSequenceIds != 0;
+        m_index.MapSequenceKeyToLocation();
+        return;
+    }
+
+    const size_t numRanges = std::min(m_numThreads, m_minRangeSize > 0 ? (size_t)m_fileSize / m_minRangeSize : 1);
+    if (numRanges > 1)
+        BuildInParallel(corpus, numRanges);
+    else
+        BuildIndex(corpus);
+
+    if (m_cache)
+        m_cache->Save(corpus, m_index, m_hasSequenceIds ? 1 : 0);
+}
+
+std::function<bool(size_t&)> Indexer::SequenceIdReader(CorpusDescriptorPtr corpus)
+{
     if (corpus->IsNumericSequenceKeys())
-        tryGetSequenceId = [this](size_t& id) { return TryGetNumericSequenceId(id); };
+        return [this](size_t& id) { return TryGetNumericSequenceId(id); };
     else
-        tryGetSequenceId = [this, corpus](size_t& id) { return TryGetSymbolicSequenceId(id, corpus->KeyToId); };
+        return [this, corpus](size_t& id) { return TryGetSymbolicSequenceId(id, corpus->KeyToId); };
+}
+
+void Indexer::BuildInParallel(CorpusDescriptorPtr corpus, size_t numRanges)
+{
+    // Decide on the format of the input the same way as BuildIndex() does.
+    m_buffer.RefillFrom(m_file);
+    if (m_buffer.Eof())
+        RuntimeError("Input file is empty");
+
+    m_buffer.SkipBOMIfPresent();
+    m_hasSequenceIds = m_hasSequenceIds && *m_buffer.m_current != m_streamPrefix;
+    if (!m_hasSequenceIds && !corpus->IsNumericSequenceKeys())
+        RuntimeError("Corpus expects non-numeric sequence keys present but the input file does not have them."
+            "Please use the configuration to enable numeric keys instead.");
+
+    // Each range has its own corpus, so that symbolic keys can be registered concurrently;
+    // they are registered with the actual corpus when merging, in the order of the input.
+    auto createIndexer = [&](FILE* file, int64_t begin, int64_t end)
+    {
+        auto indexer = std::make_unique<Indexer>(file, true, !m_hasSequenceIds, m_streamPrefix, m_index.m_maxChunkSize, m_mainStream, m_buffer.MaxSize());
+        indexer->SetRange(begin, end);
+        return indexer;
+    };
+    auto createCorpus = [&]() { return std::make_shared<CorpusDescriptor>(corpus->IsNumericSequenceKeys()); };
+
+    // Split the input into ranges of whole sequences (lines, if there are no sequence ids). The boundaries are
+    // found by scanning from the nominal split points to the beginning of the next sequence.
+    std::vector<int64_t> boundaries(1, 0);
+    for (size_t i = 1; i < numRanges; i++)
+    {
+        int64_t splitPoint = m_fileSize / numRanges * i;
+        int64_t boundary = createIndexer(m_file, splitPoint - 1, m_fileSize)->FindNextSequenceStart(createCorpus());
+        if (boundary > boundaries.back() && boundary < m_fileSize)
+            boundaries.push_back(boundary);
+    }
+    boundaries.push_back(m_fileSize);
+    numRanges = boundaries.size() - 1;
+
+    // Index the ranges concurrently, each from its own file handle.
+    // (The files are declared first, so that they are closed after all tasks are done, even if one fails.)
+    std::vector<std::shared_ptr<FILE>> files;
+    std::vector<CorpusDescriptorPtr> corpora;
+    std::vector<std::future<std::unique_ptr<Indexer>>> tasks;
+    for (size_t i = 0; i < numRanges; i++)
+    {
+        files.push_back(std::shared_ptr<FILE>(fopenOrDie(m_inputFile, L"rb"), [](FILE* f) { fclose(f); }));
+        corpora.push_back(createCorpus());
+        auto indexer = createIndexer(files.back().get(), boundaries[i], boundaries[i + 1]);
+        tasks.push_back(std::async(std::launch::async, [](std::unique_ptr<Indexer>&& indexer, CorpusDescriptorPtr corpus)
+        {
+            indexer->BuildIndex(corpus);
+            return std::move(indexer);
+        }, std::move(indexer), corpora.back()));
+    }
+
+    // Merge the indices in the order of the ranges.
+    size_t numLines = 0;
+    for (size_t i = 0; i < numRanges; i++)
+    {
+        auto indexer = tasks[i].get();
+        auto rangeCorpus = corpora[i];
+        std::function<size_t(size_t)> mapKey;
+        if (!m_hasSequenceIds)
+            mapKey = [numLines](size_t lineNumber) { return numLines + lineNumber; };
+        else if (corpus->IsNumericSequenceKeys())
+            mapKey = [](size_t id) { return id; };
+        else
+            mapKey = [corpus, rangeCorpus](size_t id) { return corpus->KeyToId(rangeCorpus->IdToKey(id)); };
+
+        for (const auto& chunk : indexer->GetIndex().Chunks())
+            numLines += chunk.Sequences().size();
+        m_index.Append(indexer->GetIndex(), mapKey);
+    }
+
+    m_index.MapSequenceKeyToLocation();
+
+    fprintf(stderr, "Indexer: Indexed %zu ranges of the input file '%ls' in parallel.\n", numRanges, m_inputFile.c_str());
+}
+
+int64_t Indexer::FindNextSequenceStart(CorpusDescriptorPtr corpus)
+{
+    auto tryGetSequenceId = SequenceIdReader(corpus);
+
+    m_buffer.RefillFrom(m_file);
+    SkipLine(); // skip to the first line that starts after the beginning of the range
+    if (!m_hasSequenceIds)
+        return m_buffer.Eof() ? m_fileSize : m_buffer.GetFileOffset();
+
+    // As in BuildIndex(), a sequence starts with a line that has a sequence id different from the current one;
+    // since the sequence the scan starts in is not known, the first id found only establishes the current one.
+    bool found = false;
+    size_t id = 0, previousId = 0;
+    while (!m_buffer.Eof())
+    {
+        int64_t offset = m_buffer.GetFileOffset();
+        if (tryGetSequenceId(id))
+        {
+            if (found && id != previousId)
+                return offset;
+            previousId = id;
+            found = true;
+        }
+        SkipLine();
+    }
+    return m_fileSize;
+}
+
+void Indexer::BuildIndex(CorpusDescriptorPtr corpus)
+{
+    // Create a lambda to read symbolic or numeric sequence ids,
+    // depending on what the corpus expects.
+    auto tryGetSequenceId = SequenceIdReader(corpus);
 
     m_index.Reserve(m_fileSize);
 
@@ -155,7 +311,7 @@ bool Indexer::SkipLineWithCheck()
     // In this function we always expect the buffer to contain full lines only.
     // The only exception is at the end of the file \n is missing. Let's check this situation.
     if (!pos && currentLine != m_buffer.End() &&
-        filesize(m_file) == m_buffer.GetFileOffset() + m_buffer.Left())
+        m_fileSize == m_buffer.GetFileOffset() + m_buffer.Left())
         pos = m_buffer.End();
 
     if (pos)
@@ -253,6 +409,18 @@ void Index::AddSequence(SequenceDescriptor&& sd, size_t startOffsetInFile, size_
     chunk->AddSequence(std::move(sd), m_trackFirstSamples);
 }
 
+void Index::Append(const Index& other, const std::function<size_t(size_t)>& mapKey)
+{
+    for (const auto& chunk : other.Chunks())
+    {
+        for (const auto& s : chunk.Sequences())
+        {
+            size_t offset = chunk.m_offset + s.OffsetInChunk();
+            AddSequence(SequenceDescriptor{ mapKey(s.m_key), s.m_numberOfSamples }, offset, offset + s.SizeInBytes());
+        }
+    }
+}
+
 std::tuple<bool, uint32_t, uint32_t> Index::GetSequenceByKey(size_t key) const
 {
     auto found = std::lower_bound(m_keyToSequenceInChunk.begin(), m_keyToSequenceInChunk.end(), key,
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <functional>
 #include <vector>
 #include "DataDeserializer.h"
 #include "CorpusDescriptor.h"
@@ -124,6 +125,9 @@ private:
 
 typedef shared_ptr<ChunkDescriptor> ChunkDescriptorPtr;
 
+class IndexCache;
+typedef std::shared_ptr<IndexCache> IndexCachePtr;
+
 // A collection of chunk descriptors, each containing
 // a collection of sequence descriptors for the corresponding
 // chunk of the input data.
@@ -176,6 +180,10 @@ public:
 
     void MapSequenceKeyToLocation();
 
+    // Appends the sequences of the index of a later part of the same input (with the offsets in the input),
+    // mapping their keys with the given function. The chunks are formed as if the sequences were added one by one.
+    void Append(const Index& other, const std::function<size_t(size_t)>& mapKey);
+
     DISABLE_COPY_AND_MOVE(Index);
 };
 
@@ -193,6 +201,17 @@ public:
     // sequences.
     void Build(CorpusDescriptorPtr corpus);
 
+    // Makes Build() load the index from the index cache of the given input file (the one being indexed)
+    // if it is up to date, and otherwise save it there (see IndexCache).
+    void EnableCache(const std::wstring& inputFile);
+
+    // Makes Build() split the given input file (the one being indexed) into ranges of whole sequences, which are
+    // indexed concurrently by 'numThreads' threads (0 - one per hardware thread; at most the reader threads if they
+    // are limited, see Globals::GetNumReaderWorkerThreads()), each with its own file handle, and merged afterwards.
+    // The ranges are at least 'minRangeSize' bytes; smaller files are indexed serially.
+    // The resulting index is the same as when built serially.
+    void EnableParallelBuild(const std::wstring& inputFile, size_t numThreads, size_t minRangeSize = 16 * 1024 * 1024);
+
     // Returns input data index (chunk and sequence metadata)
     const Index& GetIndex() const { return m_index; }
 
@@ -208,7 +227,7 @@ public:
 
 private:
     FILE* m_file;
-    int64_t m_fileSize;
+    int64_t m_fileSize; // (or the end of the range being indexed, see SetRange())
     MemoryBuffer m_buffer;
     bool m_hasSequenceIds; // true, when input contains one sequence per line 
                            // or when sequence id column was ignored during indexing.
@@ -221,6 +240,30 @@ private:
 
     const char m_streamPrefix;
 
+    // cache to load the index from / save it to, if enabled
+    IndexCachePtr m_cache;
+
+    // input file and number of threads for building the index in parallel (see EnableParallelBuild())
+    std::wstring m_inputFile;
+    size_t m_numThreads;
+    size_t m_minRangeSize;
+
+    // Builds the index from the input file.
+    void BuildIndex(CorpusDescriptorPtr corpus);
+
+    // Builds the index from the given number of ranges of the input file in parallel.
+    void BuildInParallel(CorpusDescriptorPtr corpus, size_t numRanges);
+
+    // Restricts indexing to the part [begin, end) of the input file.
+    void SetRange(int64_t begin, int64_t end);
+
+    // Returns the offset of the first sequence that starts after the beginning of the range set by
+    // SetRange() (the end of the range if there is none).
+    int64_t FindNextSequenceStart(CorpusDescriptorPtr corpus);
+
+    // Returns a function that reads a symbolic or numeric sequence id, depending on what the corpus expects.
+    std::function<bool(size_t&)> SequenceIdReader(CorpusDescriptorPtr corpus);
+
     // Moves the buffer position to the beginning of the next line.
     void SkipLine();
 
@@ -0,0 +1,44 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <memory>
+#include "DataDeserializer.h"
+#include "MappedFile.h"
+
+namespace CNTK {
+
+// Base class for chunks whose data is used directly from a memory-mapped file, without reading (copying) it.
+// The randomizer requests the chunks of its window ahead of their use (and prefetches the next one), so the OS
+// is asked to page in the range of the chunk when it is created, and its pages are dropped again once the
+// chunk is released. The sequences of the chunk point into the mapping, which the chunk keeps alive.
+class MappedChunk : public Chunk
+{
+public:
+    ~MappedChunk()
+    {
+        m_file->DontNeed(m_offset, m_size);
+    }
+
+protected:
+    MappedChunk(std::shared_ptr<MappedFile> file, int64_t offset, uint64_t size)
+        : m_file(file), m_offset(offset), m_size(size), m_data(file->Data(offset, size))
+    {
+        m_file->WillNeed(offset, size);
+    }
+
+    std::shared_ptr<MappedFile> m_file;
+    const int64_t m_offset;
+    const uint64_t m_size;
+
+    // Data of the chunk, m_size bytes at m_offset in the file.
+    const byte* m_data;
+
+private:
+    DISABLE_COPY_AND_MOVE(MappedChunk);
+};
+
+}
@@ -0,0 +1,135 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <errno.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <string>
+#ifdef __unix__
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "Basics.h"
+#include "basetypes.h"
+
+namespace CNTK {
+
+// Read-only mapping of a whole binary file into memory, used to hand out chunk data without reading (copying) it.
+// The OS pages the data in on first access; WillNeed()/DontNeed() give it hints about the ranges that are about
+// to be used or that are no longer used, so that only the chunks in use stay resident.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::wstring& pathname)
+        : m_pathname(pathname), m_data(nullptr), m_size(0)
+    {
+#ifdef __WINDOWS__
+        m_file = CreateFileW(pathname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_file == INVALID_HANDLE_VALUE)
+            RuntimeError("Error opening file '%ls' for mapping: error %u.", pathname.c_str(), (unsigned int)GetLastError());
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size))
+            RuntimeError("Error determining the size of file '%ls': error %u.", pathname.c_str(), (unsigned int)GetLastError());
+        m_size = size.QuadPart;
+        m_mapping = CreateFileMappingW(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m_mapping == NULL)
+            RuntimeError("Error mapping file '%ls': error %u.", pathname.c_str(), (unsigned int)GetLastError());
+        m_data = (const byte*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+        if (m_data == nullptr)
+            RuntimeError("Error mapping file '%ls': error %u.", pathname.c_str(), (unsigned int)GetLastError());
+#else
+        m_file = open(wtocharpath(pathname).c_str(), O_RDONLY);
+        if (m_file < 0)
+            RuntimeError("Error opening file '%ls' for mapping: %s.", pathname.c_str(), strerror(errno));
+        struct stat fileStat;
+        if (fstat(m_file, &fileStat) != 0)
+            RuntimeError("Error determining the size of file '%ls': %s.", pathname.c_str(), strerror(errno));
+        m_size = fileStat.st_size;
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+        if (data == MAP_FAILED)
+            RuntimeError("Error mapping file '%ls': %s.", pathname.c_str(), strerror(errno));
+        m_data = (const byte*)data;
+        // Chunks are accessed in randomized order, read-ahead across chunk boundaries is mostly wasted.
+        madvise(data, m_size, MADV_RANDOM);
+        m_pageSize = sysconf(_SC_PAGESIZE);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef __WINDOWS__
+        if (m_data)
+            UnmapViewOfFile(m_data);
+        if (m_mapping != NULL)
+            CloseHandle(m_mapping);
+        CloseHandle(m_file);
+#else
+        if (m_data)
+            munmap((void*)m_data, m_size);
+        close(m_file);
+#endif
+    }
+
+    uint64_t Size() const { return m_size; }
+
+    // Returns a pointer to the data at the given offset, which is valid for as long as the mapping exists.
+    const byte* Data(int64_t offset, uint64_t size) const
+    {
+        if (offset < 0 || offset + size > m_size)
+            RuntimeError("Requested range (%" PRId64 ", %" PRIu64 " bytes) is outside of the mapped file '%ls' (%" PRIu64 " bytes).",
+                offset, size, m_pathname.c_str(), m_size);
+        return m_data + offset;
+    }
+
+    // Starts reading in the given range in the background.
+    void WillNeed(int64_t offset, uint64_t size) const
+    {
+#ifdef __WINDOWS__
+        UNUSED(offset); UNUSED(size); // the pages are read in on first access
+#else
+        uint64_t begin = offset / m_pageSize * m_pageSize;
+        if (size > 0)
+            madvise((void*)(m_data + begin), offset + size - begin, MADV_WILLNEED);
+#endif
+    }
+
+    // Releases the pages of the given range from the process; they are read in again if accessed later.
+    // Pages that are shared with the adjacent ranges are kept.
+    void DontNeed(int64_t offset, uint64_t size) const
+    {
+#ifdef __WINDOWS__
+        UNUSED(offset); UNUSED(size); // the working set is trimmed by the system
+#else
+        uint64_t begin = (offset + m_pageSize - 1) / m_pageSize * m_pageSize;
+        uint64_t end = (offset + size) / m_pageSize * m_pageSize;
+        if (offset + size == m_size)
+            end = m_size;
+        if (end > begin)
+            madvise((void*)(m_data + begin), end - begin, MADV_DONTNEED);
+#endif
+    }
+
+private:
+    std::wstring m_pathname;
+    const byte* m_data;
+    uint64_t m_size;
+#ifdef __WINDOWS__
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_file;
+    uint64_t m_pageSize;
+#endif
+
+    DISABLE_COPY_AND_MOVE(MappedFile);
+};
+
+}
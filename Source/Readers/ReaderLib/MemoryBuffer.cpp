@@ -3,7 +3,9 @@
 // Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
 //
 
+#define __STDC_FORMAT_MACROS
 #define _CRT_SECURE_NO_WARNINGS
+#include <inttypes.h>
 #include "MemoryBuffer.h"
 #include <boost/utility/string_ref.hpp>
 #include <boost/algorithm/string.hpp>
@@ -13,7 +15,17 @@ namespace CNTK {
     using namespace std;
 
     MemoryBuffer::MemoryBuffer(size_t maxSize, bool useCompleteLines) 
-        : m_maxSize(maxSize), m_useCompleteLines(useCompleteLines), m_line(0){}
+        : m_maxSize(maxSize), m_useCompleteLines(useCompleteLines), m_line(0), m_bytesToRead(SIZE_MAX){}
+
+    void MemoryBuffer::SetFileRange(int64_t begin, int64_t end)
+    {
+        assert(m_data.empty() && m_fileOffsetStart == 0);
+        if (begin < 0 || end < begin)
+            LogicError("Invalid file range [%" PRIi64 ", %" PRIi64 ").", begin, end);
+
+        m_fileOffsetStart = begin;
+        m_bytesToRead = static_cast<size_t>(end - begin);
+    }
 
     void MemoryBuffer::RefillFrom(FILE* file)
     {
@@ -25,9 +37,10 @@ namespace CNTK {
 
         if (!m_useCompleteLines)
         {
-            size_t bytesRead = fread(m_data.data(), 1, m_maxSize, file);
+            size_t bytesRead = fread(m_data.data(), 1, std::min(m_maxSize, m_bytesToRead), file);
             if (bytesRead == (size_t)-1)
                 RuntimeError("Could not read from the input file.");
+            m_bytesToRead -= bytesRead;
             m_data.resize(bytesRead);
             if (!bytesRead)
                 m_done = true;
@@ -41,9 +54,10 @@ namespace CNTK {
             // Copy last partial line if it was left during the last read.
             memcpy(&m_data[0], m_lastPartialLineInBuffer.data(), m_lastPartialLineInBuffer.size());
 
-            size_t bytesRead = fread(&m_data[0] + m_lastPartialLineInBuffer.size(), 1, m_data.size() - m_lastPartialLineInBuffer.size(), file);
+            size_t bytesRead = fread(&m_data[0] + m_lastPartialLineInBuffer.size(), 1, std::min(m_data.size() - m_lastPartialLineInBuffer.size(), m_bytesToRead), file);
             if (bytesRead == (size_t)-1)
                 RuntimeError("Could not read from the input file.");
+            m_bytesToRead -= bytesRead;
 
             size_t readBufferSize = m_lastPartialLineInBuffer.size() + bytesRead;
             m_data.resize(readBufferSize);
@@ -38,6 +38,12 @@ public:
     // Refills the buffer from the file.
     void RefillFrom(FILE* file);
 
+    // Restricts the buffer to the part [begin, end) of the file, which is then treated as if it was the whole file.
+    // The file has to be positioned at 'begin', and the buffer must not have been filled yet.
+    void SetFileRange(int64_t begin, int64_t end);
+
+    size_t MaxSize() const { return m_maxSize; }
+
     // Moves the current position to the next line.
     // If no new lines is present, returns null, otherwise returns a new position.
     const char* MoveToNextLine()
@@ -70,6 +76,7 @@ private:
     bool m_useCompleteLines;                     // Flag indicating whether the buffer should only contain complete lines.
     std::string m_lastPartialLineInBuffer;       // Buffer for the partial string to preserve them between two sequential Refills.
     size_t m_line;                               // Current line.
+    size_t m_bytesToRead;                        // Number of bytes that are left to be read from the file.
 };
 
 }
@@ -9,6 +9,9 @@
 #include "NoRandomizer.h"
 #include "DataReader.h"
 #include "ExceptionCapture.h"
+#include "PerformanceProfiler.h"
+#include "Metrics.h"
+#include "Globals.h"
 
 namespace CNTK {
 
@@ -20,10 +23,14 @@ namespace CNTK {
       m_sweepSizeInSamples(0),
       m_currentSequencePositionInChunk(0),
       m_multithreadedGetNextSequences(multithreadedGetNextSequences),
-      m_cleaner(maxNumberOfInvalidSequences)
+      m_cleaner(maxNumberOfInvalidSequences),
+      m_maxPrefetchedChunks(0),
+      m_maxPrefetchedBytes(0),
+      m_numPrefetchThreads(1)
 {
     assert(deserializer != nullptr);
     m_streams = m_deserializer->StreamInfos();
+    m_estimatedBytesPerSample = EstimatedBytesPerSample(m_streams);
     m_chunkDescriptions = m_deserializer->ChunkInfos();
 
     size_t sampleCount = 0;
@@ -205,7 +212,7 @@ Sequences NoRandomizer::GetNextSequences(size_t globalSampleCount, size_t localS
             }
             else
             {
-                chunks[s.m_chunkId] = m_deserializer->GetChunk(s.m_chunkId);
+                chunks[s.m_chunkId] = GetChunk(s.m_chunkId);
             }
         }
     }
@@ -213,6 +220,9 @@ Sequences NoRandomizer::GetNextSequences(size_t globalSampleCount, size_t localS
     // swap current chunks with new ones:
     m_chunks.swap(chunks);
 
+    // Now that the current chunks are known, the following ones can be loaded while these are processed.
+    Prefetch();
+
     auto process = [&](int i) -> void {
         std::vector<SequenceDataPtr> sequence;
         const auto& sequenceDescription = m_sequenceBuffer[i];
@@ -224,6 +234,9 @@ Sequences NoRandomizer::GetNextSequences(size_t globalSampleCount, size_t localS
         }
 
         it->second->GetSequence(sequenceDescription.m_indexInChunk, sequence);
+        if (m_sequenceTransform && IsValidSequence(sequence))
+            m_sequenceTransform(sequence);
+
         for (int j = 0; j < m_streams.size(); ++j)
         {
             result.m_data[j][i] = sequence[j];
@@ -231,24 +244,139 @@ Sequences NoRandomizer::GetNextSequences(size_t globalSampleCount, size_t localS
     };
 
     // TODO: This will be changed, when we move transformers under the (no-) randomizer, should not deal with multithreading here.
-    if (m_multithreadedGetNextSequences)
     {
-        ExceptionCapture capture;
-#pragma omp parallel for schedule(dynamic)
-        for (int i = 0; i < m_sequenceBuffer.size(); ++i)
-            capture.SafeRun(process, i);
-        capture.RethrowIfHappened();
+        ReaderStageTimer timer("cntk_reader_decode_seconds");
+        if (m_multithreadedGetNextSequences)
+        {
+            ExceptionCapture capture;
+#pragma omp parallel for schedule(dynamic) num_threads(Microsoft::MSR::CNTK::Globals::GetNumReaderOmpThreads())
+            for (int i = 0; i < m_sequenceBuffer.size(); ++i)
+                capture.SafeRun(process, i);
+            capture.RethrowIfHappened();
+        }
+        else
+        {
+            for (int i = 0; i < m_sequenceBuffer.size(); ++i)
+                process(i);
+        }
+    }
+
+    m_cleaner.Clean(result);
+    return result;
+}
+
+ChunkPtr NoRandomizer::GetChunk(ChunkIdType chunkId)
+{
+    auto it = std::find_if(m_prefetchedChunks.begin(), m_prefetchedChunks.end(),
+                           [chunkId](const PrefetchedChunk& c) { return c.m_id == chunkId; });
+    bool prefetched = it != m_prefetchedChunks.end();
+
+    // the depth of the prefetch queue: the chunks that are loaded when one is needed
+    if (m_maxPrefetchedChunks > 0)
+    {
+        Microsoft::MSR::CNTK::MetricsHistogramObserve("cntk_reader_ready_chunks", (double)std::count_if(m_prefetchedChunks.begin(), m_prefetchedChunks.end(), [](const PrefetchedChunk& c)
+        {
+            return c.m_data.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }));
+    }
+
+    // Waiting for a chunk that is not (yet) prefetched stalls the reader, which is reported as prefetch starvation.
+    bool starving = m_maxPrefetchedChunks > 0 &&
+                    (!prefetched || it->m_data.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+    auto profilerState = starving ? Microsoft::MSR::CNTK::ProfilerTimeBegin() : 0;
+    auto waitBegin = std::chrono::steady_clock::now();
+
+    ChunkPtr result;
+    if (prefetched)
+    {
+        result = it->m_data.get();
+        m_prefetchedChunks.erase(it);
     }
     else
     {
-        for (int i = 0; i < m_sequenceBuffer.size(); ++i)
-            process(i);
+        // Make sure we have no outstanding prefetches, unless the deserializer supports concurrent loading.
+        if (m_numPrefetchThreads <= 1)
+        {
+            for (auto& c : m_prefetchedChunks)
+                c.m_data.wait();
+        }
+
+        Microsoft::MSR::CNTK::ScopeProfile profile(Microsoft::MSR::CNTK::profilerEvtChunkLoad);
+        ReaderStageTimer timer("cntk_reader_chunk_load_seconds");
+        result = m_deserializer->GetChunk(chunkId);
+    }
+
+    if (starving)
+    {
+        Microsoft::MSR::CNTK::ProfilerTimeEnd(profilerState, Microsoft::MSR::CNTK::profilerEvtChunkWait);
+        Microsoft::MSR::CNTK::MetricsHistogramObserve("cntk_reader_chunk_wait_seconds", std::chrono::duration<double>(std::chrono::steady_clock::now() - waitBegin).count());
     }
 
-    m_cleaner.Clean(result);
     return result;
 }
 
+// Performs io prefetch of the chunks that follow the current ones in the sweep (wrapping around at its end).
+void NoRandomizer::Prefetch()
+{
+    if (m_maxPrefetchedChunks == 0)
+        return;
+
+    // The chunks are needed in their original order, starting with the chunk of the next sequence.
+    std::vector<ChunkIdType> toBePrefetched;
+    size_t totalSize = 0;
+    for (size_t i = 0; i < m_chunkDescriptions.size() && toBePrefetched.size() < m_maxPrefetchedChunks; ++i)
+    {
+        ChunkIdType chunkId = (ChunkIdType)((m_currentChunkPosition + i) % m_chunkDescriptions.size());
+        if (m_chunks.find(chunkId) != m_chunks.end())
+            continue;
+
+        totalSize += m_chunkDescriptions[chunkId].m_numberOfSamples * m_estimatedBytesPerSample;
+        if (!toBePrefetched.empty() && m_maxPrefetchedBytes > 0 && totalSize > m_maxPrefetchedBytes)
+            break;
+        toBePrefetched.push_back(chunkId);
+    }
+
+    // Drop the chunks that are not going to be needed next anymore (e.g. after a change of the position).
+    // (Destroying the future waits for the chunk, if it is still being loaded.)
+    m_prefetchedChunks.erase(std::remove_if(m_prefetchedChunks.begin(), m_prefetchedChunks.end(), [&](const PrefetchedChunk& c)
+                                            {
+                                                return std::find(toBePrefetched.begin(), toBePrefetched.end(), c.m_id) == toBePrefetched.end();
+                                            }),
+                             m_prefetchedChunks.end());
+
+    // Start new prefetches, as long as there are loader threads available.
+    size_t numLoading = std::count_if(m_prefetchedChunks.begin(), m_prefetchedChunks.end(), [](const PrefetchedChunk& c)
+    {
+        return c.m_data.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    });
+    for (ChunkIdType chunkId : toBePrefetched)
+    {
+        if (numLoading >= m_numPrefetchThreads)
+            break;
+
+        if (std::any_of(m_prefetchedChunks.begin(), m_prefetchedChunks.end(), [chunkId](const PrefetchedChunk& c) { return c.m_id == chunkId; }))
+            continue;
+
+        m_prefetchedChunks.push_back(PrefetchedChunk{ chunkId, std::async(std::launch::async, [this, chunkId]() -> ChunkPtr
+                                                      {
+                                                          Microsoft::MSR::CNTK::ScopeProfile profile(Microsoft::MSR::CNTK::profilerEvtChunkLoad);
+                                                          ReaderStageTimer timer("cntk_reader_chunk_load_seconds");
+                                                          return m_deserializer->GetChunk(chunkId);
+                                                      }) });
+        numLoading++;
+    }
+}
+
+void NoRandomizer::SetPrefetchConfiguration(size_t maxChunks, size_t maxBytes, size_t numThreads)
+{
+    if (maxChunks == 0 || numThreads == 0)
+        InvalidArgument("NoRandomizer: The number of chunks to prefetch and the number of prefetch threads must be positive.");
+
+    m_maxPrefetchedChunks = maxChunks;
+    m_maxPrefetchedBytes = maxBytes;
+    m_numPrefetchThreads = Microsoft::MSR::CNTK::Globals::GetNumReaderWorkerThreads(numThreads);
+}
+
 void NoRandomizer::SetState(const std::map<std::wstring, size_t>& state)
 {
     auto it = state.find(g_minibatchSourcePosition);
@@ -299,4 +427,13 @@ void NoRandomizer::SetConfiguration(const ReaderConfiguration& config)
     *((ReaderConfiguration*)&m_config) = config;
 }
 
+bool NoRandomizer::SetSequenceTransform(const SequenceTransform& transform)
+{
+    if (!m_multithreadedGetNextSequences)
+        return false;
+
+    m_sequenceTransform = transform;
+    return true;
+}
+
 }
@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include <deque>
+#include <future>
 #include <vector>
 #include "SequenceEnumerator.h"
 #include "DataDeserializer.h"
@@ -24,6 +26,15 @@ public:
         bool multithreadedGetNextSequences = false,
         size_t maxNumberOfInvalidSequences = 0); // per worker
 
+    ~NoRandomizer()
+    {
+        for (auto& chunk : m_prefetchedChunks)
+        {
+            if (chunk.m_data.valid())
+                chunk.m_data.wait();
+        }
+    }
+
     virtual void StartEpoch(const EpochConfiguration& config) override;
     virtual Sequences GetNextSequences(size_t globalSampleCount, size_t localSampleCount) override;
     virtual std::vector<StreamInformation> GetStreamDescriptions() const override
@@ -36,6 +47,31 @@ public:
 
     void SetConfiguration(const ReaderConfiguration& config) override;
 
+    bool SetSequenceTransform(const SequenceTransform& transform) override;
+
+    // Configures the asynchronous prefetch of the chunks that follow the current one in the sweep (no prefetch by
+    // default), as for BlockRandomizer::SetPrefetchConfiguration(): at most maxChunks chunks with an estimated memory
+    // size of at most maxBytes in total (0 - no limit; at least one chunk is prefetched in any case) are kept in
+    // a queue, and up to numThreads of them are loaded concurrently.
+    // numThreads > 1 requires a deserializer that supports concurrent GetChunk() calls.
+    void SetPrefetchConfiguration(size_t maxChunks, size_t maxBytes, size_t numThreads);
+
+    // Changes the number of chunks of the prefetch configuration, at the next prefetch.
+    size_t GetNumPrefetchChunks() const override
+    {
+        return m_maxPrefetchedChunks;
+    }
+
+    bool SetNumPrefetchChunks(size_t numChunks) override
+    {
+        if (numChunks == 0)
+            InvalidArgument("NoRandomizer: The number of chunks to prefetch must be positive.");
+        if (m_maxPrefetchedChunks == 0) // (prefetching is not configured)
+            return false;
+        m_maxPrefetchedChunks = numChunks;
+        return true;
+    }
+
 private:
     // Gets next sequences not exceeding localSampleCount for this worker and globalSampleCount across workers.
     void GetNextSequenceDescriptions(size_t globalSampleCount, size_t localSampleCount, Sequences& result);
@@ -46,6 +82,12 @@ private:
     // Moves the cursor to the sequence possibly updating the chunk.
     void MoveToNextSequence();
 
+    // Starts loading the chunks that are needed after the current ones.
+    void Prefetch();
+
+    // Returns the chunk with the given id, taken from the prefetch queue if it is there.
+    ChunkPtr GetChunk(ChunkIdType chunkId);
+
     inline size_t GetEndOfEpochPosition() 
     {
         return m_config.m_totalEpochSizeInSamples * (m_config.m_epochIndex + 1);
@@ -57,6 +99,9 @@ private:
     // Useful in case deserializer performs CPU intensive deserialization (e.g. decompression)
     bool m_multithreadedGetNextSequences;
 
+    // Applied to each sequence after it has been read, see SetSequenceTransform().
+    SequenceTransform m_sequenceTransform;
+
     // Stream descriptions
     std::vector<StreamInformation> m_streams;
 
@@ -100,6 +145,22 @@ private:
 
     // Helper class for removing invalid sequences.
     SequenceCleaner m_cleaner;
+
+    // A chunk that is being or has been prefetched.
+    struct PrefetchedChunk
+    {
+        ChunkIdType m_id;
+        std::future<ChunkPtr> m_data;
+    };
+
+    // Prefetch queue, in the order the chunks are going to be needed.
+    std::deque<PrefetchedChunk> m_prefetchedChunks;
+    // Prefetch limits, see SetPrefetchConfiguration().
+    size_t m_maxPrefetchedChunks;
+    size_t m_maxPrefetchedBytes;
+    size_t m_numPrefetchThreads;
+    // Estimate of the memory a sample takes, see EstimatedBytesPerSample().
+    size_t m_estimatedBytesPerSample;
 };
 
 }
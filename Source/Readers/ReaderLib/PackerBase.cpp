@@ -28,6 +28,16 @@ void PackerBase::StreamBuffer::Resize(size_t newSize)
     });
 }
 
+void PackerBase::StreamBuffer::Reserve(size_t requiredSize)
+{
+    if (m_size >= requiredSize)
+        return;
+
+    // Minibatches of variable length sequences differ in size, grow by at least a half
+    // to avoid reallocating on every slightly larger minibatch.
+    Resize(std::max(requiredSize, m_size + m_size / 2));
+}
+
 void PackerBase::SetConfiguration(const ReaderConfiguration& config, const std::vector<MemoryProviderPtr>& memoryProviders)
 {
     // Let's check that memory providers did not change at the start of new epoch.
@@ -30,6 +30,11 @@ protected:
         }
 
         void Resize(size_t newSize);
+
+        // Makes sure the buffer holds at least requiredSize bytes. Grows with some headroom, because
+        // allocations of pinned memory are expensive and freeing it synchronizes with the device,
+        // which stalls the asynchronous copy of the previous minibatch.
+        void Reserve(size_t requiredSize);
     };
 
     PackerBase(CorpusDescriptorPtr corpus,
@@ -62,6 +67,16 @@ protected:
     // (sampleOffset is equal to the sum of sample sizes of all preceding samples).
     void PackDenseSample(char* destination, SequenceDataPtr sequence, size_t sampleOffset, size_t sampleSize);
 
+    // Packs a run of count consecutive dense samples, starting at source, into blocks of memory that are
+    // stride bytes apart (e.g. the time steps of a parallel sequence in the minibatch), starting at destination.
+    static void PackDenseSamples(char* destination, size_t stride, const char* source, size_t sampleSize, size_t count);
+
+    // Packs a run of count consecutive sparse samples of the sequence, starting with the sample sampleIndex whose
+    // first value is at sampleOffset (see PackSparseSampleAsDense()), as dense into blocks of memory that are stride
+    // bytes apart, starting at destination. Returns the offset of the first value after the run.
+    static size_t PackSparseSamplesAsDense(char* destination, size_t stride, SparseSequenceData& sequence,
+        size_t sampleIndex, size_t sampleOffset, size_t sampleSize, size_t elementSize, size_t count);
+
     // Establishes a mapping between id inside the mb layout and the global key in the corpus.
     // Assumes the sequences inside MBLayout have the same order as Sequences.
     void EstablishIdToKey(Minibatch& minibatch, const Sequences& sequences);
@@ -133,4 +148,60 @@ inline void PackerBase::PackDenseSample(char* destination, SequenceDataPtr seque
     memcpy(destination, (const char*)(sequence->GetDataBuffer()) + sampleOffset, sampleSize);
 }
 
+inline void PackerBase::PackDenseSamples(char* destination, size_t stride, const char* source, size_t sampleSize, size_t count)
+{
+    if (stride == sampleSize)
+    {
+        // The destinations are contiguous as well (a single parallel sequence).
+        memcpy(destination, source, count * sampleSize);
+        return;
+    }
+
+    // Samples of a single value (e.g. label or word ids) are copied as such, instead of calling memcpy for each.
+    switch (sampleSize)
+    {
+    case sizeof(float):
+        for (size_t i = 0; i < count; ++i, destination += stride)
+            memcpy(destination, source + i * sizeof(float), sizeof(float));
+        break;
+    case sizeof(double):
+        for (size_t i = 0; i < count; ++i, destination += stride)
+            memcpy(destination, source + i * sizeof(double), sizeof(double));
+        break;
+    default:
+        for (size_t i = 0; i < count; ++i, destination += stride)
+            memcpy(destination, source + i * sampleSize, sampleSize);
+    }
+}
+
+inline size_t PackerBase::PackSparseSamplesAsDense(char* destination, size_t stride, SparseSequenceData& sequence,
+    size_t sampleIndex, size_t sampleOffset, size_t sampleSize, size_t elementSize, size_t count)
+{
+    const char* values = (const char*)sequence.GetDataBuffer();
+    const SparseIndexType* indices = sequence.m_indices;
+    for (size_t i = 0; i < count; ++i, destination += stride)
+    {
+        memset(destination, 0, sampleSize);
+        size_t nonZeroCount = sequence.m_nnzCounts[sampleIndex + i];
+        if (elementSize == sizeof(float))
+        {
+            for (size_t j = sampleOffset; j < sampleOffset + nonZeroCount; ++j)
+            {
+                assert(indices[j] * sizeof(float) < sampleSize);
+                memcpy(destination + indices[j] * sizeof(float), values + j * sizeof(float), sizeof(float));
+            }
+        }
+        else
+        {
+            for (size_t j = sampleOffset; j < sampleOffset + nonZeroCount; ++j)
+            {
+                assert(indices[j] * elementSize < sampleSize);
+                memcpy(destination + indices[j] * elementSize, values + j * elementSize, elementSize);
+            }
+        }
+        sampleOffset += nonZeroCount;
+    }
+    return sampleOffset;
+}
+
 }
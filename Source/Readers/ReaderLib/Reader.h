@@ -119,6 +119,18 @@ public:
     // Set current global position
     virtual void SetState(const std::map<std::wstring, size_t>& state) = 0;
 
+    // The number of chunks the reader prefetches, if it supports changing it between minibatches (see
+    // SequenceEnumerator::SetNumPrefetchChunks()); SetNumPrefetchChunks() returns false if it does not.
+    virtual size_t GetNumPrefetchChunks() const
+    {
+        return 0;
+    }
+
+    virtual bool SetNumPrefetchChunks(size_t)
+    {
+        return false;
+    }
+
     virtual ~Reader() {};
 };
 
@@ -80,4 +80,14 @@ void ReaderBase::SetConfiguration(const ReaderConfiguration& config, const std::
     m_packer->SetConfiguration(config, m_memoryProviders);
 }
 
+size_t ReaderBase::GetNumPrefetchChunks() const
+{
+    return m_sequenceEnumerator->GetNumPrefetchChunks();
+}
+
+bool ReaderBase::SetNumPrefetchChunks(size_t numChunks)
+{
+    return m_sequenceEnumerator->SetNumPrefetchChunks(numChunks);
+}
+
 }
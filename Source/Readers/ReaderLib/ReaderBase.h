@@ -34,6 +34,9 @@ namespace CNTK {
 
         void SetConfiguration(const ReaderConfiguration& config, const std::map<std::wstring, int>& inputDescriptions) override;
 
+        size_t GetNumPrefetchChunks() const override;
+        bool SetNumPrefetchChunks(size_t numChunks) override;
+
         virtual ~ReaderBase() = 0;
 
     protected:
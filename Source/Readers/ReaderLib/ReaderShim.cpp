@@ -12,6 +12,7 @@
 #endif
 
 #include <sstream>
+#include <thread>
 #include "Basics.h"
 
 #define DATAREADER_EXPORTS // creating the exports here
@@ -19,7 +20,10 @@
 #include "ReaderShim.h"
 #include "DataTransferer.h"
 #include "PerformanceProfiler.h"
+#include "Metrics.h"
 #include "Reader.h"
+#include "ReaderUtil.h"
+#include "Globals.h"
 
 namespace CNTK {
 
@@ -33,7 +37,13 @@ ReaderShim<ElemType>::ReaderShim() :
     m_endOfEpoch(false),
     m_endOfSweep(false),
     m_reader(nullptr),
-    m_factory(nullptr)
+    m_factory(nullptr),
+    m_verbosity(0),
+    m_adaptiveReaderThreads(false),
+    m_maxReaderThreads(0),
+    m_maxPrefetchChunks(0),
+    m_epochIndex(0),
+    m_epochReported(true)
 {
 }
 
@@ -67,6 +77,19 @@ void ReaderShim<ElemType>::Init(const ConfigParameters& config)
     if (!m_reader)
         m_reader = m_factory(config);
 
+    // With 'adaptiveReaderThreads' the reader threads (see Globals::SetNumReaderThreads()) are adjusted after each
+    // epoch, between 1 and 'maxReaderThreads' (default: the number of cores), by how long the training waited for the
+    // reader. When the wait is for the chunks rather than for the CPU stages, the number of prefetched chunks is
+    // doubled instead, up to 'maxPrefetchChunks'.
+    m_verbosity = config(L"verbosity", 0);
+    m_adaptiveReaderThreads = config(L"adaptiveReaderThreads", false);
+    m_maxReaderThreads = config(L"maxReaderThreads", 0);
+    if (m_maxReaderThreads <= 0)
+        m_maxReaderThreads = (int)(std::max)(1u, std::thread::hardware_concurrency());
+    m_maxPrefetchChunks = config(L"maxPrefetchChunks", (size_t)8);
+    if (m_adaptiveReaderThreads)
+        Globals::SetNumReaderThreads((std::min)(m_maxReaderThreads, Globals::GetNumReaderOmpThreads()));
+
     m_streams = m_reader->GetStreamDescriptions();
     for (auto i : m_streams)
     {
@@ -195,6 +218,16 @@ void ReaderShim<ElemType>::StartEpoch(const EpochConfiguration& config, const st
     m_reader->StartEpoch(config, inputDescriptions);
 
     m_currentState = m_reader->GetState();
+
+    m_epochBeginMetrics.clear();
+    for (const auto& metric : MetricsSnapshot())
+    {
+        if (metric.type == MetricType::Histogram && metric.name.compare(0, 12, "cntk_reader_") == 0)
+            m_epochBeginMetrics[metric.name] = std::make_pair(metric.value, metric.count);
+    }
+    m_epochIndex = config.m_epochIndex;
+    m_epochBegin = std::chrono::steady_clock::now();
+    m_epochReported = false;
 }
 
 template <class ElemType>
@@ -260,7 +293,11 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
     if (!m_prefetchTask.valid())
         StartAsyncPrefetching();
 
+    // reader stalls: whether the prefetched minibatch was ready, and the time spent waiting for it (see Metrics.h)
+    MetricsGaugeSet("cntk_reader_prefetched_minibatches", m_prefetchTask.wait_for(std::chrono::seconds(0)) == std::future_status::ready ? 1 : 0);
+    std::chrono::steady_clock::time_point waitBegin = std::chrono::steady_clock::now();
     auto result = m_prefetchTask.get();
+    MetricsHistogramObserve("cntk_reader_wait_seconds", std::chrono::duration<double>(std::chrono::steady_clock::now() - waitBegin).count());
 
     // Ok, prefetch is done.
 
@@ -269,6 +306,12 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
 
     m_endOfEpoch = result.m_isEndOfEpoch;
     m_endOfSweep = result.m_isEndOfSweep;
+    if (m_endOfEpoch && !m_epochReported)
+    {
+        m_epochReported = true;
+        ReportEpochReaderStages();
+    }
+
     if (m_endOfEpoch && !result.m_isDataAvailable)
     {
         // No data and end of epoch, simply return.
@@ -330,9 +373,10 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
         StartAsyncPrefetching();
     }
 
-    // Let's wait till the previous memcopy has finished.
+    // The computation must not start before the previous memcopy has finished. This is waited for on the GPU, before the
+    // first use of the inputs, so that the CPU can go on queuing the computation meanwhile.
     if (m_dataTransferers[currentDataTransferIndex])
-        m_dataTransferers[currentDataTransferIndex]->WaitForCopyCPUToGPU();
+        m_dataTransferers[currentDataTransferIndex]->WaitForCopyCPUToGPUOnComputeStreamAsync();
 
     return result.m_isDataAvailable;
 }
@@ -351,6 +395,7 @@ void FillMatrixFromStream(StorageFormat type, Matrix<ElemType>* matrix, size_t n
     {
         // In the sparse case the m_data layout is identical to CUDA's CSC layout
         // (see http://docs.nvidia.com/cuda/cusparse/#compressed-sparse-column-format-csc).
+        // The arrays are back to back, as in the buffer of GPUSparseMatrix, so they are transferred with a single copy.
         size_t* data = reinterpret_cast<size_t*>(stream->m_data);
         size_t nnzCount = *data;
         ElemType* values = reinterpret_cast<ElemType*>(data + 1);
@@ -366,11 +411,22 @@ template <class ElemType>
 typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMinibatch(size_t currentDataTransferIndex)
 {
     PROFILE_SCOPE(profilerEvtPrefetchMinibatch);
+    ReaderStageTimer prefetchTimer("cntk_reader_prefetch_seconds");
 
     // Resetting layouts.
     for (auto& mx : m_prefetchBuffers)
         mx.second.m_mbLayout = std::make_shared<MBLayout>();
 
+    // The last copies of this transferer may still be in flight, since GetMinibatch() does not wait for them on the CPU.
+    // They must be done before the reader can reuse its buffers. Also report how much of them the computation waited for.
+    if (m_dataTransferers[currentDataTransferIndex])
+    {
+        m_dataTransferers[currentDataTransferIndex]->WaitForCopyCPUToGPU();
+        long long exposedMicroseconds, totalMicroseconds;
+        if (m_dataTransferers[currentDataTransferIndex]->GetExposedCopyCPUToGPUTime(exposedMicroseconds, totalMicroseconds))
+            ProfilerRatio(profilerEvtInputTransferExposed, exposedMicroseconds, totalMicroseconds);
+    }
+
     Minibatch minibatch = m_reader->ReadMinibatch();
 
     // If there is no data we can simply return.
@@ -386,6 +442,7 @@ typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMini
 
     m_getKeyById = minibatch.m_getKeyById;
 
+    ReaderStageTimer transferTimer("cntk_reader_transfer_seconds");
     for (auto& mx : m_prefetchBuffers)
     {
         size_t streamId = m_nameToStreamId[mx.first];
@@ -410,6 +467,94 @@ typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMini
     return PrefetchResult{ minibatch.m_endOfSweep, minibatch.m_endOfEpoch, true };
 }
 
+// The stage times are the sums over the threads of the stage, and overlap: decoding includes the transforms that
+// the deserializers apply while reading, and prefetching is all of the reading of the minibatches on the prefetch
+// thread, including the chunks loaded or waited for there.
+template <class ElemType>
+void ReaderShim<ElemType>::ReportEpochReaderStages()
+{
+    const double epochSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_epochBegin).count();
+    if (epochSeconds <= 0)
+        return;
+
+    std::map<std::string, std::pair<double, long long>> epochMetrics;
+    for (const auto& metric : MetricsSnapshot())
+    {
+        if (metric.type != MetricType::Histogram || metric.name.compare(0, 12, "cntk_reader_") != 0)
+            continue;
+        auto begin = m_epochBeginMetrics.find(metric.name);
+        if (begin == m_epochBeginMetrics.end())
+            epochMetrics[metric.name] = std::make_pair(metric.value, metric.count);
+        else
+            epochMetrics[metric.name] = std::make_pair(metric.value - begin->second.first, metric.count - begin->second.second);
+    }
+
+    auto seconds = [&epochMetrics](const char* name)
+    {
+        auto metric = epochMetrics.find(name);
+        return metric != epochMetrics.end() ? metric->second.first : 0.0;
+    };
+    auto mean = [&epochMetrics](const char* name)
+    {
+        auto metric = epochMetrics.find(name);
+        return metric != epochMetrics.end() && metric->second.second > 0 ? metric->second.first / metric->second.second : 0.0;
+    };
+
+    const double waitSeconds = seconds("cntk_reader_wait_seconds");
+    const double chunkWaitSeconds = seconds("cntk_reader_chunk_wait_seconds");
+    const double cpuSeconds = seconds("cntk_reader_decode_seconds") + seconds("cntk_reader_transform_seconds") + seconds("cntk_reader_pack_seconds");
+    const double waitFraction = waitSeconds / epochSeconds;
+
+    if (m_verbosity >= 1 || m_adaptiveReaderThreads)
+        fprintf(stderr, "ReaderShim: epoch %d: waited %.3fs for the reader (%.1f%% of %.3fs); chunk load %.3fs, chunk wait %.3fs, decode %.3fs, transform %.3fs, pack %.3fs, transfer %.3fs; %.1f chunks ready on average\n",
+                (int)m_epochIndex + 1, waitSeconds, 100 * waitFraction, epochSeconds,
+                seconds("cntk_reader_chunk_load_seconds"), chunkWaitSeconds, seconds("cntk_reader_decode_seconds"), seconds("cntk_reader_transform_seconds"),
+                seconds("cntk_reader_pack_seconds"), seconds("cntk_reader_transfer_seconds"), mean("cntk_reader_ready_chunks"));
+
+    if (!m_adaptiveReaderThreads)
+        return;
+
+    // Starved (more than 5% of the epoch waiting): prefetch more chunks if the wait is mostly for them, and add
+    // threads otherwise. Idle (less than 1% waiting, with the prefetching busy for less than half of the epoch): give
+    // a quarter of the threads back to the computation.
+    const int numThreads = Globals::GetNumReaderOmpThreads();
+    if (waitFraction > 0.05)
+    {
+        const size_t numChunks = m_reader->GetNumPrefetchChunks();
+        if (chunkWaitSeconds > cpuSeconds && numChunks > 0 && numChunks < m_maxPrefetchChunks &&
+            m_reader->SetNumPrefetchChunks((std::min)(2 * numChunks, m_maxPrefetchChunks)))
+        {
+            fprintf(stderr, "ReaderShim: the reader is waiting for its chunks, prefetching %d instead of %d chunks\n",
+                    (int)(std::min)(2 * numChunks, m_maxPrefetchChunks), (int)numChunks);
+        }
+        else if (numThreads < m_maxReaderThreads)
+        {
+            Globals::SetNumReaderThreads((std::min)(2 * numThreads, m_maxReaderThreads));
+            fprintf(stderr, "ReaderShim: the training is waiting for the reader, using %d instead of %d reader threads\n",
+                    Globals::GetNumReaderThreads(), numThreads);
+        }
+    }
+    else if (waitFraction < 0.01 && numThreads > 1 && seconds("cntk_reader_prefetch_seconds") < 0.5 * epochSeconds)
+    {
+        Globals::SetNumReaderThreads(numThreads - (std::max)(1, numThreads / 4));
+        fprintf(stderr, "ReaderShim: the reader is ahead of the training, using %d instead of %d reader threads\n",
+                Globals::GetNumReaderThreads(), numThreads);
+    }
+}
+
+template <class ElemType>
+std::vector<InputStreamDescription> ReaderShim<ElemType>::GetStreamDescriptions(int deviceId)
+{
+    std::vector<InputStreamDescription> result;
+    for (const auto& stream : m_streams)
+    {
+        bool isDense = stream.m_storageFormat == StorageFormat::Dense;
+        result.push_back(InputStreamDescription(stream.m_name, deviceId,
+            isDense ? MatrixType::DENSE : MatrixType::SPARSE, isDense ? matrixFormatDense : matrixFormatSparseCSC));
+    }
+    return result;
+}
+
 template <class ElemType>
 bool ReaderShim<ElemType>::DataEnd() { return false; } // Note: Return value never used.
 
@@ -9,8 +9,10 @@
 #pragma once
 
 #include <unordered_map>
+#include <map>
 #include <string>
 #include <future>
+#include <chrono>
 #include "DataReader.h"
 #include "Reader.h"
 
@@ -90,6 +92,8 @@ public:
 
     virtual bool GetMinibatch(MSR_CNTK::StreamMinibatchInputs& matrices) override;
 
+    virtual std::vector<MSR_CNTK::InputStreamDescription> GetStreamDescriptions(int deviceId) override;
+
     virtual bool DataEnd() override;
 
     void CopyMBLayoutTo(MSR_CNTK::MBLayoutPtr) override;
@@ -127,6 +131,10 @@ private:
 
     PrefetchResult PrefetchMinibatch(size_t currentDataTransferIndex);
 
+    // Reports the time of the reader stages in the epoch that has just ended and, with 'adaptiveReaderThreads',
+    // adjusts the reader threads or the number of prefetched chunks for the next one.
+    void ReportEpochReaderStages();
+
     std::future<PrefetchResult> m_prefetchTask;
     ReaderPtr m_reader;
     ReaderFactory m_factory;
@@ -168,6 +176,17 @@ private:
     int m_deviceId;
 
     std::map<std::wstring, size_t> m_currentState;
+
+    // Reader stage times per epoch (see ReportEpochReaderStages()).
+    int m_verbosity;
+    bool m_adaptiveReaderThreads;
+    int m_maxReaderThreads;
+    size_t m_maxPrefetchChunks;
+    size_t m_epochIndex;
+    bool m_epochReported;
+    std::chrono::steady_clock::time_point m_epochBegin;
+    // sum and number of observations of the reader histograms at the beginning of the epoch, by name
+    std::map<std::string, std::pair<double, long long>> m_epochBeginMetrics;
 };
 
 }
@@ -5,10 +5,17 @@
 
 #include "Config.h"
 #include "DataReader.h"
+#include "ReaderUtil.h"
+#include "Metrics.h"
 
 namespace CNTK {
     using namespace Microsoft::MSR::CNTK;
 
+    ReaderStageTimer::~ReaderStageTimer()
+    {
+        MetricsHistogramObserve(m_histogramName, std::chrono::duration<double>(std::chrono::steady_clock::now() - m_begin).count());
+    }
+
     size_t GetRandomizationWindowFromConfig(const ConfigParameters& config)
     {
         wstring randomizeString = config(L"randomize", wstring());
@@ -8,7 +8,11 @@
 #include "Reader.h"
 #include "SequenceEnumerator.h"
 #include "Config.h"
+#include <chrono>
 #include <boost/algorithm/string.hpp>
+#if defined(__SSSE3__) || defined(_M_X64)
+#include <tmmintrin.h>
+#endif
 
 namespace CNTK {
 
@@ -19,10 +23,25 @@ inline size_t GetRandomSeed(const Microsoft::MSR::CNTK::ConfigParameters& config
     return config(L"randomizationSeed", size_t(0));
 }
 
+// Boundaries of the sequence length buckets of the block randomizer, e.g. sequenceLengthBuckets = 10:20:40
+// (see BlockRandomizer::SetSequenceLengthBuckets()). Empty (no bucketing) by default.
+inline std::vector<size_t> GetSequenceLengthBuckets(const Microsoft::MSR::CNTK::ConfigParameters& config)
+{
+    Microsoft::MSR::CNTK::intargvector boundaries = config(L"sequenceLengthBuckets", Microsoft::MSR::CNTK::ConfigParameters::Array(Microsoft::MSR::CNTK::intargvector(std::vector<int>{})));
+    std::vector<size_t> result;
+    for (int boundary : boundaries)
+    {
+        if (boundary <= 0)
+            InvalidArgument("'sequenceLengthBuckets' must be positive.");
+        result.push_back((size_t)boundary);
+    }
+    return result;
+}
+
 static std::vector<unsigned char> FillIndexTable()
 {
     std::vector<unsigned char> indexTable;
-    indexTable.resize(std::numeric_limits<unsigned char>().max());
+    indexTable.resize(std::numeric_limits<unsigned char>().max() + 1);
     char value = 0;
     for (unsigned char i = 'A'; i <= 'Z'; i++)
         indexTable[i] = value++;
@@ -46,34 +65,137 @@ static std::vector<unsigned char> base64DecodeTable = FillIndexTable();
 
 inline bool IsBase64Char(char c)
 {
-    return isalnum(c) || c == '/' || c == '+' || c == '=';
+    return ('A' <= c && c <= 'Z') || ('a' <= c && c <= 'z') || ('0' <= c && c <= '9') || c == '/' || c == '+' || c == '=';
 }
 
-inline bool DecodeBase64(const char* begin, const char* end, std::vector<char>& result)
+#if defined(__SSSE3__) || defined(_M_X64)
+// Decodes 16 base64 characters into the first 12 bytes of the result.
+// Returns false if any of the characters is not in the base64 alphabet (padding included).
+inline bool DecodeBase64Block(const char* input, char* output)
 {
-    assert(std::find_if(begin, end, [](char c) { return !IsBase64Char(c); }) == end);
+    const __m128i chars = _mm_loadu_si128((const __m128i*)input);
+
+    // Maps each character range to its offset from the 6-bit value (characters >= 0x80 are negative and in no range).
+    auto inRange = [&chars](char low, char high) { return _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8(low - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(high + 1), chars)); };
+    const __m128i upper = inRange('A', 'Z');
+    const __m128i lower = inRange('a', 'z');
+    const __m128i digit = inRange('0', '9');
+    const __m128i plus = _mm_cmpeq_epi8(chars, _mm_set1_epi8('+'));
+    const __m128i slash = _mm_cmpeq_epi8(chars, _mm_set1_epi8('/'));
+
+    const __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, plus), slash));
+    if (_mm_movemask_epi8(valid) != 0xFFFF)
+        return false;
+
+    __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+    shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+    const __m128i values = _mm_add_epi8(chars, shift);
+
+    // Packs the four 6-bit values of each 32-bit lane into 24 bits, first pairs of them into 12 bits, then the pairs.
+    const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i packed = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+
+    // The 24 bits of each lane are stored most significant byte first.
+    const __m128i bytes = _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128((__m128i*)output, bytes);
+    return true;
+}
+#endif
 
+// Decodes the base64 characters in [begin, end) into the result, whose capacity is reused.
+// Returns false if the length of the input is not a multiple of 4 or it contains characters outside the base64 alphabet.
+// Decodes 16 characters at a time where SSSE3 is available.
+inline bool DecodeBase64(const char* begin, const char* end, std::vector<char>& result)
+{
     size_t length = end - begin;
     if (length % 4 != 0)
         return false;
 
     result.resize((length * 3) / 4); // Upper bound on the max number of decoded symbols.
-    size_t currentDecodedIndex = 0;
-    while (begin < end)
+    if (length == 0)
+        return true;
+
+    char* output = result.data();
+#if defined(__SSSE3__) || defined(_M_X64)
+    // Each block writes 16 bytes of which 12 are decoded, so it stops 8 characters (6 bytes of the result) early;
+    // this also leaves the padding to the scalar loop.
+    for (; end - begin >= 24; begin += 16, output += 12)
+    {
+        if (!DecodeBase64Block(begin, output))
+            return false;
+    }
+#endif
+
+    // Padding is only allowed in the last two characters.
+    const char* padding = (*(end - 2) == '=') ? end - 2 : ((*(end - 1) == '=') ? end - 1 : end);
+    for (; begin < end; begin += 4)
     {
-        result[currentDecodedIndex++] = base64DecodeTable[*begin] << 2 | base64DecodeTable[*(begin + 1)] >> 4;
-        result[currentDecodedIndex++] = base64DecodeTable[*(begin + 1)] << 4 | base64DecodeTable[*(begin + 2)] >> 2;
-        result[currentDecodedIndex++] = base64DecodeTable[*(begin + 2)] << 6 | base64DecodeTable[*(begin + 3)];
-        begin += 4;
+        auto c0 = static_cast<unsigned char>(begin[0]), c1 = static_cast<unsigned char>(begin[1]), c2 = static_cast<unsigned char>(begin[2]), c3 = static_cast<unsigned char>(begin[3]);
+        for (const char* c = begin; c < begin + 4; c++)
+        {
+            if (c < padding ? (!IsBase64Char(*c) || *c == '=') : *c != '=')
+                return false;
+        }
+
+        *output++ = base64DecodeTable[c0] << 2 | base64DecodeTable[c1] >> 4;
+        *output++ = base64DecodeTable[c1] << 4 | base64DecodeTable[c2] >> 2;
+        *output++ = base64DecodeTable[c2] << 6 | base64DecodeTable[c3];
     }
 
     // In Base 64 each 3 characters are encoded with 4 bytes. Plus there could be padding (last two bytes)
-    size_t resultingLength = (length * 3) / 4 - (*(end - 2) == '=' ? 2 : (*(end - 1) == '=' ? 1 : 0));
+    size_t resultingLength = (length * 3) / 4 - (end - padding);
     result.resize(resultingLength);
     return true;
 }
 
+// Estimate of the memory a sample of the streams takes, e.g. for prefetch budgets
+// (sparse streams are assumed to have one non-zero value per sample).
+inline size_t EstimatedBytesPerSample(const std::vector<StreamInformation>& streams)
+{
+    size_t result = 0;
+    for (const auto& stream : streams)
+    {
+        size_t elementSize = stream.m_elementType == DataType::Double ? sizeof(double) : sizeof(float);
+        if (stream.m_storageFormat == StorageFormat::Dense && !stream.m_sampleLayout.IsUnknown() && !stream.m_sampleLayout.HasUnboundDimension())
+            result += stream.m_sampleLayout.TotalSize() * elementSize;
+        else
+            result += elementSize + sizeof(SparseIndexType);
+    }
+    return result;
+}
+
+// Observes the time of its scope in a histogram of the training metrics (see Metrics.h, which is not available where all
+// headers of the reader library are used), for the stages of reading a minibatch: "cntk_reader_<stage>_seconds" with the
+// stages chunk_load, chunk_wait, decode, transform, pack and transfer. ReaderShim reports them per epoch.
+class ReaderStageTimer
+{
+public:
+    explicit ReaderStageTimer(const char* histogramName)
+        : m_histogramName(histogramName), m_begin(std::chrono::steady_clock::now())
+    {}
+
+    ~ReaderStageTimer();
+
+private:
+    const char* m_histogramName;
+    std::chrono::steady_clock::time_point m_begin;
+};
+
 // Class to clean/keep track of invalid sequences.
+// Whether the data of a sequence is valid in all streams.
+inline bool IsValidSequence(const std::vector<SequenceDataPtr>& sequence)
+{
+    for (const auto& s : sequence)
+    {
+        if (!s->m_isValid)
+            return false;
+    }
+    return true;
+}
+
 class SequenceCleaner
 {
 public:
@@ -39,6 +39,60 @@ namespace CNTK {
 
     typedef std::shared_ptr<CategorySequenceData> CategorySequenceDataPtr;
 
+    // Dense sequence that points to samples stored elsewhere, e.g. in a memory-mapped file.
+    // The data has to stay valid for as long as the chunk of the sequence is in use.
+    struct DenseSequenceView : DenseSequenceData
+    {
+        DenseSequenceView(const void* data, const NDShape& sampleShape, unsigned int numberOfSamples = 1)
+            : DenseSequenceData(numberOfSamples), m_data(data), m_sampleShape(sampleShape)
+        {}
+
+        const void* GetDataBuffer() override
+        {
+            return m_data;
+        }
+
+        const NDShape& GetSampleShape() override
+        {
+            return m_sampleShape;
+        }
+
+    private:
+        const void* m_data;
+
+        // Non-owning reference on the sample shape.
+        const NDShape& m_sampleShape;
+    };
+
+    // Sparse (csc) sequence of a single sample that points to its values and row indices stored elsewhere,
+    // e.g. in a memory-mapped file. The data has to stay valid for as long as the chunk of the sequence is in use.
+    struct SparseSequenceView : SparseSequenceData
+    {
+        SparseSequenceView(const void* values, const SparseIndexType* indices, SparseIndexType nnz, const NDShape& sampleShape)
+            : SparseSequenceData(1), m_data(values), m_sampleShape(sampleShape)
+        {
+            m_indices = const_cast<SparseIndexType*>(indices);
+            m_nnzCounts.assign(1, nnz);
+            m_totalNnzCount = nnz;
+        }
+
+        const void* GetDataBuffer() override
+        {
+            return m_data;
+        }
+
+        const NDShape& GetSampleShape() override
+        {
+            return m_sampleShape;
+        }
+
+    private:
+        const void* m_data;
+
+        // Non-owning reference on the sample shape.
+        const NDShape& m_sampleShape;
+    };
+
     // The class represents a sequence that returns the internal data buffer
     // back to the stack when destroyed.
     template<class TElemType>
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <vector>
+#include <functional>
 #include "DataDeserializer.h"
 #include "Reader.h"
 
@@ -31,6 +32,9 @@ struct Sequences
 class SequenceEnumerator;
 typedef std::shared_ptr<SequenceEnumerator> SequenceEnumeratorPtr;
 
+// A function applied to the data of a single sequence (indexed by stream id) right after it has been read.
+typedef std::function<void(std::vector<SequenceDataPtr>&)> SequenceTransform;
+
 // Sequence enumerator is internal interface used by the packer to get a set of new sequences.
 // It is implemented either by different randomizers or by TransformController that can wrap the randomizer
 // and apply different transforms on top of data.
@@ -58,6 +62,26 @@ public:
     // Gets next sequences up to a maximum count of local and global samples.
     virtual Sequences GetNextSequences(size_t globalSampleCount, size_t localSampleCount) = 0;
 
+    // Asks the enumerator to apply the function to each valid sequence on the thread that has read it,
+    // so that reading (e.g. decoding an image) and transforming a sequence happen in a single parallel pass.
+    // Returns false if the enumerator does not read sequences in parallel; the caller then applies the function itself.
+    virtual bool SetSequenceTransform(const SequenceTransform&)
+    {
+        return false;
+    }
+
+    // The number of chunks that are prefetched, if the enumerator supports changing it while reading (e.g. to adapt
+    // it to the input stalls, see ReaderShim); SetNumPrefetchChunks() returns false if it does not.
+    virtual size_t GetNumPrefetchChunks() const
+    {
+        return 0;
+    }
+
+    virtual bool SetNumPrefetchChunks(size_t)
+    {
+        return false;
+    }
+
     virtual ~SequenceEnumerator()
     {
     }
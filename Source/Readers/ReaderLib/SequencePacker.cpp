@@ -47,6 +47,7 @@ Minibatch SequencePacker::ReadMinibatch()
     if (batch.empty())
         return minibatch;
 
+    ReaderStageTimer timer("cntk_reader_pack_seconds");
     auto& currentBuffer = m_streamBuffers[m_currentBufferIndex];
 
     assert(m_outputStreamDescriptions.size() == batch.size());
@@ -137,10 +138,7 @@ MBLayoutPtr SequencePacker::PackDenseStream(const StreamBatch& batch, size_t str
     size_t sampleSize = GetSampleSize(m_outputStreamDescriptions[streamIndex]);
     auto pMBLayout = CreateMBLayout(batch);
     size_t requiredSize = pMBLayout->GetNumCols() * sampleSize;
-    if (buffer.m_size < requiredSize)
-    {
-        buffer.Resize(requiredSize);
-    }
+    buffer.Reserve(requiredSize);
 
     auto elementSize = DataTypeSize(stream.m_elementType);
 
@@ -235,10 +233,7 @@ MBLayoutPtr SequencePacker::PackSparseStream(const StreamBatch& batch, size_t st
         indexSize * (pMBLayout->GetNumCols() + 1);
 
     auto& buffer = m_streamBuffers[m_currentBufferIndex][streamIndex];
-    if (buffer.m_size < requiredSize)
-    {
-        buffer.Resize(requiredSize);
-    }
+    buffer.Reserve(requiredSize);
 
     auto* destination = buffer.m_data.get();
     // insert the nnzCount as the first element in the buffer.
@@ -250,8 +245,10 @@ MBLayoutPtr SequencePacker::PackSparseStream(const StreamBatch& batch, size_t st
     auto* indicesDst = dataDst + elementSize* nnzCount;
     // column index for the current sample (= number of nnz value packed so far).
     IndexType columnOffset = 0;
-    // a vector to store column index for each sample in the resulting (packed) matrix.
-    vector<IndexType> sparseColumnIndices;
+    // the column indices for each sample in the resulting (packed) matrix follow the row indices,
+    // they are written in place, so that the buffer has exactly the CSC layout of GPUSparseMatrix.
+    auto* columnIndicesDst = reinterpret_cast<IndexType*>(indicesDst + nnzCount * indexSize);
+    auto* const columnIndicesBegin = columnIndicesDst;
     // a vector to keep track of the offsets into each input sequence,
     // there an offset is the number of nnz values packed so far. Current sample
     // values/indices start of the offset position in the sequence data/index array
@@ -278,7 +275,7 @@ MBLayoutPtr SequencePacker::PackSparseStream(const StreamBatch& batch, size_t st
             }
 
             // store the offset of the current column )...
-            sparseColumnIndices.push_back(columnOffset);
+            *columnIndicesDst++ = columnOffset;
 
             auto seqId = sequenceInfo.seqId;
             if (seqId == GAP_SEQUENCE_ID)
@@ -323,15 +320,13 @@ MBLayoutPtr SequencePacker::PackSparseStream(const StreamBatch& batch, size_t st
     assert(indicesDst == dataDst + nnzCount * indexSize);
     // after we packed all samples, the column offset must be equal to the total nnz count.
     assert(columnOffset == nnzCount);
-    sparseColumnIndices.push_back(columnOffset);
+    *columnIndicesDst++ = columnOffset;
     // check that the number of column indices == N + 1 (where N is the number of
     // column in the packed matrix)
-    assert((pMBLayout->GetNumCols() + 1) == sparseColumnIndices.size());
-
-    // verify that there's enough space in the buffer for the array of column indices.
-    assert(indicesDst + sparseColumnIndices.size()*indexSize <= destination + requiredSize);
-    // copy column indices into the buffer.
-    memcpy(indicesDst, sparseColumnIndices.data(), sparseColumnIndices.size() * indexSize);
+    assert((pMBLayout->GetNumCols() + 1) == size_t(columnIndicesDst - columnIndicesBegin));
+    // verify that the column indices did not overrun the buffer.
+    assert(reinterpret_cast<char*>(columnIndicesDst) <= destination + requiredSize);
+    UNUSED(columnIndicesBegin);
 
     return pMBLayout;
 }
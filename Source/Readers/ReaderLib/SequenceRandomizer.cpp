@@ -42,6 +42,17 @@ namespace CNTK {
         m_bufferOriginalSequences.reserve(max);
     }
 
+    void SequenceRandomizer::SetLengthBuckets(const std::vector<size_t>& boundaries)
+    {
+        for (size_t i = 0; i < boundaries.size(); i++)
+        {
+            if (boundaries[i] == 0 || (i > 0 && boundaries[i] <= boundaries[i - 1]))
+                InvalidArgument("SequenceRandomizer: The sequence length bucket boundaries must be positive and ascending.");
+        }
+
+        m_lengthBucketBoundaries = boundaries;
+    }
+
     // Resets the current sweep according to the randomization seed provided.
     void SequenceRandomizer::Reset(size_t randSeed)
     {
@@ -229,9 +240,14 @@ namespace CNTK {
             }
         }
 
+        // The sequences of the chunk are at their final position now. Reordering them within the chunk does not change
+        // the number of samples in the chunk, so the positions of all other chunks stay the same.
+        size_t randomizedChunk = m_randomizedWindowEnd - m_chunkWindowBegin;
+        if (!m_lengthBucketBoundaries.empty())
+            GroupSequencesByLength(m_sequenceWindow[randomizedChunk]);
+
         // Let's recalculate number of samples in the randomized chunks for efficient indexing in seek.
         size_t sampleCount = 0;
-        size_t randomizedChunk = m_randomizedWindowEnd - m_chunkWindowBegin;
         for (size_t index = 0; index < m_sequenceWindow[randomizedChunk].size(); index++)
         {
             sampleCount += m_sequenceWindow[randomizedChunk][index].m_numberOfSamples;
@@ -259,6 +275,24 @@ namespace CNTK {
                 m_randomizationCursor);
     }
 
+    // Reorders the (fully randomized) sequences of a chunk by their length bucket, see SetLengthBuckets().
+    void SequenceRandomizer::GroupSequencesByLength(std::vector<RandomizedSequenceDescription>& sequences)
+    {
+        // The order of the buckets is random, so that the minibatches of a sweep do not go from short to long sequences.
+        std::vector<size_t> bucketOrder(m_lengthBucketBoundaries.size() + 1);
+        for (size_t i = 0; i < bucketOrder.size(); i++)
+            bucketOrder[i] = i;
+        Microsoft::MSR::CNTK::RandomShuffleMT(bucketOrder, m_rng);
+
+        auto bucketRank = [&](const RandomizedSequenceDescription& s)
+        {
+            size_t bucket = std::upper_bound(m_lengthBucketBoundaries.begin(), m_lengthBucketBoundaries.end(), (size_t)s.m_numberOfSamples) - m_lengthBucketBoundaries.begin();
+            return bucketOrder[bucket];
+        };
+        std::stable_sort(sequences.begin(), sequences.end(),
+            [&](const RandomizedSequenceDescription& a, const RandomizedSequenceDescription& b) { return bucketRank(a) < bucketRank(b); });
+    }
+
     // Sets current cursor to the given sample offset.
     // If offset is in the middle of the sequence, the next sequence is picked up.
     // If there is no sequence, an offset outside the sweep is returned.
@@ -328,7 +362,7 @@ namespace CNTK {
     bool SequenceRandomizer::IsValidForPosition(ChunkIdType chunkIndex, const RandomizedSequenceDescription& seqDesc) const
     {
         const auto& chunk = m_randomizedChunks[chunkIndex];
-        return chunk.m_randomizationWindow.m_begin <= seqDesc.m_chunk->m_chunkId && seqDesc.m_chunk->m_chunkId < chunk.m_randomizationWindow.m_end;
+        return chunk.m_randomizationWindow.m_begin <= seqDesc.m_chunkId && seqDesc.m_chunkId < chunk.m_randomizationWindow.m_end;
     }
 
     // Gets randomized chunk index using a sequence position in the sweep.
@@ -356,9 +390,11 @@ namespace CNTK {
         for (size_t k = 0; k < m_bufferOriginalSequences.size(); k++)
         {
             RandomizedSequenceDescription s;
-            s.m_indexInOriginalChunk = m_bufferOriginalSequences[k].m_indexInChunk;
+            s.m_indexInOriginalChunk = (uint32_t)m_bufferOriginalSequences[k].m_indexInChunk;
+            if (s.m_indexInOriginalChunk != m_bufferOriginalSequences[k].m_indexInChunk)
+                RuntimeError("SequenceRandomizer: chunk %u has more than %u sequences.", (unsigned int)chunk.m_original->m_id, (unsigned int)UINT32_MAX);
             s.m_numberOfSamples = m_bufferOriginalSequences[k].m_numberOfSamples;
-            s.m_chunk = &chunk;
+            s.m_chunkId = chunk.m_chunkId;
             chunkSequences.push_back(s);
         }
 
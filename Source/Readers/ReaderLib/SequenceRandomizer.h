@@ -16,12 +16,14 @@
 namespace CNTK {
 
 // Randomized sequence description.
+// There is one per sequence of the randomization window, i.e. one per frame in frame mode, so it is kept to 12 bytes:
+// the randomized chunk is referred to by its index (in ChunkRandomizer::GetRandomizedChunks()) instead of a pointer.
 struct RandomizedSequenceDescription
 {
     // Sequence index in original chunk.
-    size_t m_indexInOriginalChunk;
-    // Randomized chunk this sequence belongs to.
-    const RandomizedChunk* m_chunk;
+    uint32_t m_indexInOriginalChunk;
+    // Index of the randomized chunk this sequence belongs to.
+    ChunkIdType m_chunkId;
     // Number of samples in sequence.
     uint32_t m_numberOfSamples;
 };
@@ -52,6 +54,12 @@ public:
         const std::function<bool(const RandomizedSequenceDescription&)>& callback,
         ClosedOpenChunkInterval& requiredChunks);
 
+    // Groups the sequences of each randomized chunk by length, so that minibatches mix fewer short and long sequences.
+    // The boundaries (ascending) split the sequence lengths into buckets: [1, b0), [b0, b1), ..., [bn, inf).
+    // The buckets of a chunk are returned one after the other, in random order; within a bucket the sequences keep
+    // their randomized order. An empty vector disables the grouping. Takes effect with the next Reset().
+    void SetLengthBuckets(const std::vector<size_t>& boundaries);
+
 private:
     DISABLE_COPY_AND_MOVE(SequenceRandomizer);
 
@@ -76,6 +84,9 @@ private:
     // Release chunks from the chunk window that are not needed anymore.
     void ReleaseChunks();
 
+    // Reorders the (fully randomized) sequences of a chunk by their length bucket, see SetLengthBuckets().
+    void GroupSequencesByLength(std::vector<RandomizedSequenceDescription>& sequences);
+
     DataDeserializerPtr m_deserializer;
 
     // Used only as a buffer to get sequence descriptions without memory reallocation.
@@ -156,6 +167,9 @@ private:
     // General configuration
     int m_verbosity;
 
+    // Boundaries of the sequence length buckets, see SetLengthBuckets().
+    std::vector<size_t> m_lengthBucketBoundaries;
+
     std::mt19937_64 m_rng;
 };
 
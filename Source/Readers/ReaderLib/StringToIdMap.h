@@ -8,8 +8,9 @@
 #include <string>
 #include <memory>
 #include <vector>
-#include <map>
-#include <deque>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
 #include "Basics.h"
 
 namespace CNTK {
@@ -17,78 +18,184 @@ namespace CNTK {
 // This class represents a string registry pattern to share strings between different deserializers if needed.
 // It associates a unique key for a given string.
 // Currently it is implemented in-memory, but can be unloaded to external disk if needed.
+// The strings are stored one after the other in large pages of characters, and looked up through an open addressing
+// hash table of 32-bit ids, so that a string takes a few bytes in addition to its characters
+// (instead of a tree node, a string object and often a separate allocation of its characters).
 // TODO: Move this class to Basics.h when it is required by more than one reader.
 template<class TString>
 class TStringToIdMap
 {
+    typedef typename TString::value_type TChar;
+
 public:
-    TStringToIdMap()
+    TStringToIdMap() : m_slots(s_initialNumberOfSlots, s_emptySlot)
     {}
 
     // Adds string value to the registry.
     void AddValue(const TString& value)
     {
-        auto iter = m_values.insert(std::make_pair(value, m_indexedValues.size()));
-        m_indexedValues.push_back(&((iter.first)->first));
+        AddIfNotExists(value);
     }
 
     // Tries to get a value by id.
     bool TryGet(const TString& value, size_t& id) const
     {
-        const auto& it = m_values.find(value);
-        if (it == m_values.end())
-        {
+        uint32_t slot = m_slots[FindSlot(value.data(), value.size())];
+        if (slot == s_emptySlot)
             return false;
-        }
-        else
-        {
-            id = it->second;
-            return true;
-        }
+
+        id = slot;
+        return true;
     }
 
     // Get integer id for the string value, adding if not exists.
     size_t AddIfNotExists(const TString& value)
     {
-        const auto& it = m_values.find(value);
-        if (it == m_values.end())
+        size_t slot = FindSlot(value.data(), value.size());
+        if (m_slots[slot] != s_emptySlot)
+            return m_slots[slot];
+
+        size_t id = m_locations.size();
+        if (id >= s_emptySlot)
+            RuntimeError("The string registry is limited to %u values.", (unsigned int)s_emptySlot);
+
+        // A new page is started if the value does not fit into the last one. The pages grow up to a maximum size,
+        // and are large enough for any value.
+        if (m_pages.empty() || m_pages.back().capacity() - m_pages.back().size() < value.size())
         {
-            AddValue(value);
-            return m_values[value];
+            if (m_pages.size() > std::numeric_limits<uint32_t>::max())
+                RuntimeError("The string registry is out of pages.");
+
+            size_t pageSize = m_pages.empty() ? s_minPageSize : std::min<size_t>(2 * m_pages.back().capacity(), s_maxPageSize);
+            m_pages.push_back(std::vector<TChar>());
+            m_pages.back().reserve(std::max<size_t>(pageSize, value.size()));
         }
-        return it->second;
+
+        auto& page = m_pages.back();
+        m_locations.push_back(((uint64_t)(m_pages.size() - 1) << 32) | page.size());
+        page.insert(page.end(), value.begin(), value.end());
+        m_slots[slot] = (uint32_t)id;
+
+        // Keeping the load factor at most 3/4.
+        if (m_locations.size() * 4 > m_slots.size() * 3)
+            Rehash(m_slots.size() * 2);
+
+        return id;
     }
 
     // Get integer id for the string value.
     size_t operator[](const TString& value) const
     {
-        const auto& it = m_values.find(value);
-        assert(it != m_values.end());
-        return it->second;
+        size_t id = 0;
+        bool found = TryGet(value, id);
+        assert(found);
+        UNUSED(found);
+        return id;
     }
 
     // Get string value by its integer id.
-    const TString& operator[](size_t id) const
+    TString operator[](size_t id) const
     {
-        if (id >= m_indexedValues.size())
+        if (id >= m_locations.size())
             RuntimeError("Unknown id requested");
-        return *m_indexedValues[id];
+
+        const TChar* begin;
+        size_t length;
+        GetValue(id, begin, length);
+        return TString(begin, length);
     }
 
     // Checks whether the value exists.
     bool Contains(const TString& value) const
     {
-        return m_values.find(value) != m_values.end();
+        return m_slots[FindSlot(value.data(), value.size())] != s_emptySlot;
+    }
+
+    // Number of values in the registry.
+    size_t Size() const
+    {
+        return m_locations.size();
     }
 
 private:
     // TODO: Move NonCopyable as a separate class to Basics.h
     DISABLE_COPY_AND_MOVE(TStringToIdMap);
 
-    std::map<TString, size_t> m_values;
-    std::deque<const TString*> m_indexedValues;
+    static const uint32_t s_emptySlot = std::numeric_limits<uint32_t>::max();
+    static const size_t s_initialNumberOfSlots = 1024; // has to be a power of 2
+    static const size_t s_minPageSize = 64 * 1024;
+    static const size_t s_maxPageSize = 16 * 1024 * 1024;
+
+    // FNV-1a
+    static size_t Hash(const TChar* value, size_t length)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= (uint64_t)value[i];
+            hash *= 1099511628211ull;
+        }
+        return (size_t)(hash ^ (hash >> 32));
+    }
+
+    void GetValue(size_t id, const TChar*& begin, size_t& length) const
+    {
+        // Values of a page follow each other, so a value ends where the next one starts, or at the end of its page.
+        uint64_t location = m_locations[id];
+        const auto& page = m_pages[location >> 32];
+        size_t offset = (size_t)(location & 0xFFFFFFFF);
+        size_t end = (id + 1 < m_locations.size() && (m_locations[id + 1] >> 32) == (location >> 32)) ?
+            (size_t)(m_locations[id + 1] & 0xFFFFFFFF) : page.size();
+
+        begin = page.data() + offset;
+        length = end - offset;
+    }
+
+    // Returns the slot of the value, or the empty slot where it would be added.
+    size_t FindSlot(const TChar* value, size_t length) const
+    {
+        const size_t mask = m_slots.size() - 1;
+        for (size_t slot = Hash(value, length) & mask;; slot = (slot + 1) & mask)
+        {
+            uint32_t id = m_slots[slot];
+            if (id == s_emptySlot)
+                return slot;
+
+            const TChar* begin;
+            size_t existingLength;
+            GetValue(id, begin, existingLength);
+            if (existingLength == length && std::equal(value, value + length, begin))
+                return slot;
+        }
+    }
+
+    void Rehash(size_t numberOfSlots)
+    {
+        m_slots.assign(numberOfSlots, s_emptySlot);
+        const size_t mask = numberOfSlots - 1;
+        for (size_t id = 0; id < m_locations.size(); ++id)
+        {
+            const TChar* begin;
+            size_t length;
+            GetValue(id, begin, length);
+
+            size_t slot = Hash(begin, length) & mask;
+            while (m_slots[slot] != s_emptySlot)
+                slot = (slot + 1) & mask;
+            m_slots[slot] = (uint32_t)id;
+        }
+    }
+
+    std::vector<std::vector<TChar>> m_pages;
+    std::vector<uint64_t> m_locations; // page (high 32 bits) and offset in the page of the value with the id
+    std::vector<uint32_t> m_slots;     // ids of the values, s_emptySlot for empty slots
 };
 
+template<class TString> const uint32_t TStringToIdMap<TString>::s_emptySlot;
+template<class TString> const size_t TStringToIdMap<TString>::s_initialNumberOfSlots;
+template<class TString> const size_t TStringToIdMap<TString>::s_minPageSize;
+template<class TString> const size_t TStringToIdMap<TString>::s_maxPageSize;
+
 typedef TStringToIdMap<std::wstring> WStringToIdMap;
 typedef TStringToIdMap<std::string> StringToIdMap;
 
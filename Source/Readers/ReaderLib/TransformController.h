@@ -10,6 +10,8 @@
 #include "Transformer.h"
 #include "SequenceEnumerator.h"
 #include "ExceptionCapture.h"
+#include "Globals.h"
+#include "ReaderUtil.h"
 
 namespace CNTK {
 
@@ -23,6 +25,9 @@ struct Transformation
 // A class responsible for applying a list of transformers to sequences and stream descriptions.
 // Delegates retrieving of sequences to another sequence provider(such as randomizer) and applies transformations after retrieving.
 // Usually used by the packer to get next set of sequences.
+// If the sequence provider reads sequences in parallel, the transformations are applied by it, right after reading
+// each sequence on the same thread, instead of in a separate parallel pass over the sequences (see SetSequenceTransform()).
+// This saves a synchronization point per minibatch, and the data of a sequence is transformed while it is still in the cache.
 class TransformController : public SequenceEnumerator
 {
 public:
@@ -39,6 +44,17 @@ public:
             transformedStreams[streamId] = t.m_transformer->Transform(transformedStreams[streamId]);
         }
         m_outputStreams = transformedStreams;
+
+        m_transformedByProvider = m_sequenceProvider->SetSequenceTransform([this](std::vector<SequenceDataPtr>& sequence)
+        {
+            Transform(sequence);
+        });
+    }
+
+    ~TransformController()
+    {
+        if (m_transformedByProvider)
+            m_sequenceProvider->SetSequenceTransform(nullptr);
     }
 
     // Returns current position in the global timeline. The returned value is in samples.
@@ -65,6 +81,16 @@ public:
         m_sequenceProvider->SetState(state);
     }
 
+    size_t GetNumPrefetchChunks() const override
+    {
+        return m_sequenceProvider->GetNumPrefetchChunks();
+    }
+
+    bool SetNumPrefetchChunks(size_t numChunks) override
+    {
+        return m_sequenceProvider->SetNumPrefetchChunks(numChunks);
+    }
+
     // Description of streams that the transformer provides.
     virtual std::vector<StreamInformation> GetStreamDescriptions() const override
     {
@@ -77,13 +103,14 @@ public:
     {
         assert(m_sequenceProvider != nullptr);
         Sequences sequences = m_sequenceProvider->GetNextSequences(globalSampleCount, localSampleCount);
-        if (sequences.m_data.empty())
+        if (sequences.m_data.empty() || m_transformedByProvider)
         {
             return sequences;
         }
 
+        ReaderStageTimer timer("cntk_reader_transform_seconds");
         ExceptionCapture capture;
-#pragma omp parallel for schedule(dynamic)
+#pragma omp parallel for schedule(dynamic) num_threads(Microsoft::MSR::CNTK::Globals::GetNumReaderOmpThreads())
         for (int j = 0; j < sequences.m_data.front().size(); ++j)
         {
             capture.SafeRun([this, &sequences](int sequenceId)
@@ -105,6 +132,15 @@ public:
     }
 
 private:
+    // Applies all transformations to the data of a single sequence.
+    void Transform(std::vector<SequenceDataPtr>& sequence)
+    {
+        for (auto& t : m_transformations)
+        {
+            sequence[t.second] = t.first.m_transformer->Transform(sequence[t.second]);
+        }
+    }
+
     size_t GetStreamId(const std::wstring streamName, const std::vector<StreamInformation>& streams) const
     {
         for (const auto& s : streams)
@@ -122,6 +158,9 @@ private:
     SequenceEnumeratorPtr m_sequenceProvider;
     std::vector<StreamInformation> m_outputStreams;
     std::vector<std::pair<Transformation, size_t>> m_transformations;
+
+    // Whether the sequence provider applies the transformations.
+    bool m_transformedByProvider;
 };
 
 }
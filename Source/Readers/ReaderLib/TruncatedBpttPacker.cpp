@@ -53,7 +53,7 @@ public:
         m_length += s->m_numberOfSamples;
     }
 
-    SequenceDataPtr FrontSequence() const
+    const SequenceDataPtr& FrontSequence() const
     {
         assert(!m_sequences.empty());
         return m_sequences.front();
@@ -210,6 +210,7 @@ Minibatch TruncatedBPTTPacker::ReadMinibatch()
         return Minibatch(/*endOfSweep = */false,/*endOfEpoch = */ true);
     }
 
+    ReaderStageTimer timer("cntk_reader_pack_seconds");
     Minibatch result;
 
     // Iterating over the streams/slots and packing them into the minibatch.
@@ -285,8 +286,11 @@ bool TruncatedBPTTPacker::PackSlot(size_t streamIndex, size_t slotIndex, size_t&
         -(int)slot.m_sampleCursor,
         slot.FrontSequence()->m_numberOfSamples - slot.m_sampleCursor);
 
-    // Ok, now fill in the buffer with data.
-    for (size_t currentTimestep = 0; currentTimestep < numberOfSamples; ++currentTimestep)
+    // Ok, now fill in the buffer with data, a run of samples of the same sequence at a time.
+    auto& buffer = m_streamBuffers[m_currentBufferIndex][streamIndex];
+    char* slotData = buffer.m_data.get() + slotIndex * sampleSize;
+    size_t currentTimestep = 0;
+    while (currentTimestep < numberOfSamples)
     {
         // Check if reach the end of the front sequence.
         if (slot.m_sampleCursor >= slot.FrontSequence()->m_numberOfSamples)
@@ -304,34 +308,32 @@ bool TruncatedBPTTPacker::PackSlot(size_t streamIndex, size_t slotIndex, size_t&
                 currentTimestep + slot.FrontSequence()->m_numberOfSamples);
         }
 
-        // Fill in the data from the first sequence in the slot.
-        auto data = slot.FrontSequence();
-        // Get buffer destination for the current sample.
-        auto& buffer = m_streamBuffers[m_currentBufferIndex][streamIndex];
-        auto offset = strideSize * currentTimestep + slotIndex * sampleSize;
-        assert(offset >= 0 && offset < buffer.m_size);
-        char* destination = buffer.m_data.get() + offset;
+        // Fill in the data from the first sequence in the slot, up to its end or the end of the truncation window.
+        const auto& data = slot.FrontSequence();
+        size_t runLength = min(numberOfSamples - currentTimestep, data->m_numberOfSamples - slot.m_sampleCursor);
+        char* destination = slotData + strideSize * currentTimestep;
+        assert(strideSize * (currentTimestep + runLength - 1) + slotIndex * sampleSize < buffer.m_size);
 
-        // Pack the sample.
+        // Pack the samples.
         if (storageType == StorageFormat::Dense)
         {
             assert(slot.m_sampleOffset == slot.m_sampleCursor * sampleSize);
-            PackDenseSample(destination, data, slot.m_sampleOffset, sampleSize);
-            slot.m_sampleOffset += sampleSize;
+            PackDenseSamples(destination, strideSize, (const char*)data->GetDataBuffer() + slot.m_sampleOffset, sampleSize, runLength);
+            slot.m_sampleOffset += runLength * sampleSize;
         }
         else
         {
             assert(storageType == StorageFormat::SparseCSC);
             // TODO: make type casts members of the SparseSequenceData
-            SparseSequenceDataPtr sparseSequence = static_pointer_cast<SparseSequenceData>(data);
-            assert(slot.m_sampleCursor < sparseSequence->m_nnzCounts.size());
-            PackSparseSampleAsDense(destination, sparseSequence, slot.m_sampleCursor, 
-                slot.m_sampleOffset, sampleSize, elementSize);
-            slot.m_sampleOffset += sparseSequence->m_nnzCounts[slot.m_sampleCursor];
-            assert(slot.m_sampleOffset <= sparseSequence->m_totalNnzCount);
+            auto& sparseSequence = static_cast<SparseSequenceData&>(*data);
+            assert(slot.m_sampleCursor + runLength <= sparseSequence.m_nnzCounts.size());
+            slot.m_sampleOffset = PackSparseSamplesAsDense(destination, strideSize, sparseSequence, slot.m_sampleCursor,
+                slot.m_sampleOffset, sampleSize, elementSize, runLength);
+            assert(slot.m_sampleOffset <= sparseSequence.m_totalNnzCount);
         }
 
-        slot.m_sampleCursor++;
+        slot.m_sampleCursor += runLength;
+        currentTimestep += runLength;
     }
 
     // Cleaning up the last sequence we have just read if needed.
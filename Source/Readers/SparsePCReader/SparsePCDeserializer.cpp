@@ -0,0 +1,213 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include "SparsePCDeserializer.h"
+#include "MappedChunk.h"
+#include "SequenceData.h"
+#include "StringUtil.h"
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+// A chunk of records, used directly from the mapping; the sequences point to the values and indices in the file.
+class SparsePCDeserializer::SparsePCChunk : public MappedChunk
+{
+    const ChunkDescriptor& m_descriptor;
+    SparsePCDeserializer& m_deserializer;
+
+public:
+    SparsePCChunk(const ChunkDescriptor& descriptor, SparsePCDeserializer& parent)
+        : MappedChunk(parent.m_file, descriptor.m_offset, descriptor.SizeInBytes()),
+          m_descriptor(descriptor), m_deserializer(parent)
+    {}
+
+    void GetSequence(size_t sequenceIndex, std::vector<SequenceDataPtr>& result) override
+    {
+        const auto& sequence = m_descriptor.Sequences()[sequenceIndex];
+        const auto& streams = m_deserializer.m_streams;
+        const size_t elementSize = m_deserializer.m_elementSize;
+        const byte* record = m_data + sequence.OffsetInChunk();
+
+        result.resize(streams.size());
+        const size_t numFeatures = streams.size() - 1;
+        for (size_t i = 0; i < numFeatures; i++)
+        {
+            const int32_t nnz = *(const int32_t*)record;
+            const byte* values = record + sizeof(int32_t);
+            const byte* indices = values + nnz * elementSize;
+            auto data = std::make_shared<SparseSequenceView>(values, (const SparseIndexType*)indices, nnz, streams[i].m_sampleLayout);
+            data->m_elementType = m_deserializer.m_precision;
+            data->m_key = { sequence.m_key, 0 };
+            result[i] = data;
+            record = indices + nnz * sizeof(int32_t);
+        }
+
+        auto label = std::make_shared<DenseSequenceView>(record, streams[numFeatures].m_sampleLayout);
+        label->m_elementType = m_deserializer.m_precision;
+        label->m_key = { sequence.m_key, 0 };
+        result[numFeatures] = label;
+    }
+};
+
+SparsePCDeserializer::SparsePCDeserializer(CorpusDescriptorPtr corpus, const ConfigParameters& config, bool primary)
+    : DataDeserializerBase(primary)
+{
+    if (corpus && !corpus->IsNumericSequenceKeys())
+        InvalidArgument("SparsePCDeserializer: Non-numeric sequence keys are not supported, the keys are the record numbers.");
+
+    m_fileName = (const wstring&)config(L"file");
+    m_verificationCode = (int32_t)config(L"verificationCode", (size_t)0);
+    m_verbosity = config(L"verbosity", 0);
+
+    string precision = config("precision", "float");
+    m_precision = AreEqualIgnoreCase(precision, "float") ? DataType::Float : DataType::Double;
+    m_elementSize = m_precision == DataType::Float ? sizeof(float) : sizeof(double);
+
+    std::vector<std::wstring> featureNames;
+    std::vector<std::wstring> labelNames;
+    GetFileConfigNames(config, featureNames, labelNames);
+    if (featureNames.empty() || labelNames.size() != 1)
+        RuntimeError("SparsePCDeserializer: Please specify at least one feature section (with 'dim') and exactly one label section, "
+                     "'%d' features, '%d' labels found.", (int)featureNames.size(), (int)labelNames.size());
+
+    // The features are stored in the reverse order of their sections.
+    for (auto name = featureNames.rbegin(); name != featureNames.rend(); ++name)
+    {
+        ConfigParameters featureConfig = config(*name);
+        size_t dim = featureConfig(L"dim");
+        if (SparseIndexType(dim) < 0 || (size_t)SparseIndexType(dim) != dim)
+            RuntimeError("SparsePCDeserializer: Dimension (%" PRIu64 ") of feature '%ls' is too large for an index type value.", dim, name->c_str());
+
+        StreamInformation stream;
+        stream.m_id = m_streams.size();
+        stream.m_name = *name;
+        stream.m_storageFormat = StorageFormat::SparseCSC;
+        stream.m_elementType = m_precision;
+        stream.m_sampleLayout = NDShape({ dim });
+        m_streams.push_back(stream);
+    }
+
+    StreamInformation label;
+    label.m_id = m_streams.size();
+    label.m_name = labelNames[0];
+    label.m_storageFormat = StorageFormat::Dense;
+    label.m_elementType = m_precision;
+    label.m_sampleLayout = NDShape({ 1 });
+    m_streams.push_back(label);
+
+    m_file = std::make_shared<MappedFile>(m_fileName);
+    BuildIndex(config(L"chunkSizeInBytes", (size_t)32 * 1024 * 1024));
+}
+
+void SparsePCDeserializer::BuildIndex(size_t chunkSize)
+{
+    m_index = std::make_unique<Index>(chunkSize, m_primary);
+
+    const uint64_t fileSize = m_file->Size();
+    const size_t numFeatures = m_streams.size() - 1;
+    const size_t trailerSize = m_elementSize + (m_verificationCode != 0 ? sizeof(int32_t) : 0);
+
+    // The records are read in sequence, unlike the chunks later on, so the OS is asked to read ahead
+    // in windows, and the pages of the records that are indexed already are dropped again.
+    const uint64_t readAhead = 16 * 1024 * 1024;
+    uint64_t windowBegin = 0, windowEnd = 0;
+
+    uint64_t offset = 0;
+    size_t numRecords = 0;
+    while (offset < fileSize)
+    {
+        if (offset >= windowEnd)
+        {
+            m_file->DontNeed(windowBegin, windowEnd - windowBegin);
+            windowBegin = windowEnd;
+            windowEnd = std::min(fileSize, offset + readAhead);
+            m_file->WillNeed(windowBegin, windowEnd - windowBegin);
+        }
+
+        const uint64_t recordStart = offset;
+        for (size_t i = 0; i < numFeatures; i++)
+        {
+            if (offset + sizeof(int32_t) > fileSize)
+                RuntimeError("SparsePCDeserializer: Record %" PRIu64 " is truncated in the file '%ls'.", numRecords, m_fileName.c_str());
+
+            const int32_t nnz = *(const int32_t*)m_file->Data(offset, sizeof(int32_t));
+            if (nnz < 0 || (size_t)nnz > m_streams[i].m_sampleLayout[0])
+                RuntimeError("SparsePCDeserializer: Invalid number of non-zero values (%d) of feature '%ls' in record %" PRIu64 " of the file '%ls'.",
+                             nnz, m_streams[i].m_name.c_str(), numRecords, m_fileName.c_str());
+            offset += sizeof(int32_t) + nnz * (m_elementSize + sizeof(int32_t));
+        }
+
+        if (offset + trailerSize > fileSize)
+            RuntimeError("SparsePCDeserializer: Record %" PRIu64 " is truncated in the file '%ls'.", numRecords, m_fileName.c_str());
+        offset += m_elementSize;
+
+        if (m_verificationCode != 0)
+        {
+            int32_t code = *(const int32_t*)m_file->Data(offset, sizeof(int32_t));
+            if (code != m_verificationCode)
+                RuntimeError("SparsePCDeserializer: Verification code of record %" PRIu64 " of the file '%ls' did not match (expected %d, found %d).",
+                             numRecords, m_fileName.c_str(), m_verificationCode, code);
+            offset += sizeof(int32_t);
+        }
+
+        m_index->AddSequence(SequenceDescriptor{ numRecords, 1 }, recordStart, offset);
+        numRecords++;
+    }
+
+    if (m_index->IsEmpty())
+        RuntimeError("SparsePCDeserializer: The file '%ls' is empty.", m_fileName.c_str());
+
+    m_file->DontNeed(windowBegin, fileSize - windowBegin);
+    m_index->MapSequenceKeyToLocation();
+
+    if (m_verbosity > 0)
+        fprintf(stderr, "SparsePCDeserializer: %" PRIu64 " records in %zu chunks in the file '%ls'.\n",
+                numRecords, m_index->Chunks().size(), m_fileName.c_str());
+}
+
+std::vector<ChunkInfo> SparsePCDeserializer::ChunkInfos()
+{
+    std::vector<ChunkInfo> result;
+    result.reserve(m_index->Chunks().size());
+    for (const auto& chunk : m_index->Chunks())
+    {
+        ChunkInfo c;
+        c.m_id = (ChunkIdType)result.size();
+        c.m_numberOfSamples = c.m_numberOfSequences = chunk.Sequences().size();
+        result.push_back(c);
+    }
+    return result;
+}
+
+void SparsePCDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result)
+{
+    const auto& sequences = m_index->Chunks()[chunkId].Sequences();
+    result.reserve(sequences.size());
+    for (size_t i = 0; i < sequences.size(); i++)
+    {
+        SequenceInfo info;
+        info.m_chunkId = chunkId;
+        info.m_indexInChunk = i;
+        info.m_numberOfSamples = 1;
+        info.m_key = { sequences[i].m_key, 0 };
+        result.push_back(info);
+    }
+}
+
+ChunkPtr SparsePCDeserializer::GetChunk(ChunkIdType chunkId)
+{
+    return std::make_shared<SparsePCChunk>(m_index->Chunks()[chunkId], *this);
+}
+
+bool SparsePCDeserializer::GetSequenceInfoByKey(const SequenceKey& key, SequenceInfo& result)
+{
+    return DataDeserializerBase::GetSequenceInfoByKey(*m_index, key, result);
+}
+
+}
@@ -0,0 +1,60 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "DataDeserializerBase.h"
+#include "Config.h"
+#include "CorpusDescriptor.h"
+#include "Indexer.h"
+#include "MappedFile.h"
+
+namespace CNTK {
+
+// Deserializer for the binary files of the SparsePC reader, which are used directly from a memory mapping.
+// The file holds one record per sample: for each feature, in the reverse order of the feature sections of
+// the config (as the SparsePC reader expects the query features first, which are stored last), the number
+// of non-zero values (int32), the values (of the configured 'precision') and their row indices (int32);
+// followed by the label (of the configured 'precision') and, if 'verificationCode' is not zero, that code (int32).
+// The config has the same feature ('dim') and label ('labelDim' or 'labelType') sections as for the SparsePC reader;
+// the features are exposed as sparse streams and the label as a dense stream of dimension 1.
+// The file has no index, so one pass over the mapping builds it; the chunks are 'chunkSizeInBytes' (32MB by default).
+// The sequence keys are the record numbers.
+class SparsePCDeserializer : public DataDeserializerBase
+{
+public:
+    SparsePCDeserializer(CorpusDescriptorPtr corpus, const Microsoft::MSR::CNTK::ConfigParameters& config, bool primary);
+
+    // Get chunk descriptions.
+    std::vector<ChunkInfo> ChunkInfos() override;
+
+    // Gets sequence descriptions for the chunk.
+    void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result) override;
+
+    // Get a chunk by id.
+    ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+protected:
+    // Gets sequence description by key.
+    bool GetSequenceInfoByKey(const SequenceKey& key, SequenceInfo& result) override;
+
+private:
+    class SparsePCChunk;
+
+    // Passes over the records of the file, building the index.
+    void BuildIndex(size_t chunkSize);
+
+    std::wstring m_fileName;
+    std::shared_ptr<MappedFile> m_file;
+    std::unique_ptr<Index> m_index;
+    DataType m_precision;
+    size_t m_elementSize;
+    int32_t m_verificationCode;
+    unsigned int m_verbosity;
+
+    DISABLE_COPY_AND_MOVE(SparsePCDeserializer);
+};
+
+}
@@ -258,6 +258,8 @@ void UCIFastReader<ElemType>::Destroy()
 //  readerType=UCIFastReader
 //  miniBatchMode=Partial
 //  randomize=None
+//  # threads to parse the text with (optional, 0 for all hardware threads, 1 by default)
+//  numParsingThreads=4
 //  features=[
 //    dim=784
 //    start=1
@@ -398,7 +400,14 @@ void UCIFastReader<ElemType>::InitFromConfig(const ConfigRecordType& readerConfi
 
     // Simple heuristic to ensure buffer size and avoid breaking existing experiments.
     size_t bufSize = max(dimFeatures * 16, (size_t) 256 * 1024);
+
+    // with multiple parsing threads, each of them gets a slice of the buffer, so it holds more records
+    size_t numParsingThreads = readerConfig(L"numParsingThreads", (size_t) 1);
+    if (numParsingThreads != 1)
+        bufSize = max(bufSize, (size_t) 4 * 1024 * 1024);
     m_parser->ParseInit(file.c_str(), startFeatures, dimFeatures, startLabels, dimLabels, bufSize);
+    if (numParsingThreads != 1)
+        m_parser->EnableParallelParse(numParsingThreads);
 
     // if we have labels and labels are categorical values, we need a label Mapping file, it will be a file with one label per line
     if (m_labelType == labelCategory)
@@ -7,6 +7,9 @@
 
 #include "stdafx.h"
 #include "Basics.h"
+#include <future>
+#include <thread>
+#include "Globals.h"
 #include "UCIParser.h"
 #include <stdexcept>
 #include <stdint.h>
@@ -263,6 +266,8 @@ void UCIParser<NumType, LabelType>::Init(char customDelimiter, char customDecima
     PrepareStartPosition(0);
     m_fileBuffer = NULL;
     m_pFile = NULL;
+    m_customDelimiter = customDelimiter;
+    m_customDecimalPoint = customDecimalPoint;
     m_stateTable = new DWORD[AllStateMax * 256];
     SetupStateTables(customDelimiter, customDecimalPoint);
 }
@@ -389,7 +394,13 @@ void UCIParser<NumType, LabelType>::ParseInit(LPCWSTR/*TODO: change to C++ type*
 
     // if we have a file already open, cleanup
     if (m_pFile != NULL)
-        UCIParser<NumType, LabelType>::~UCIParser();
+    {
+        fclose(m_pFile);
+        m_pFile = NULL;
+        delete m_fileBuffer;
+        m_fileBuffer = NULL;
+        m_sliceParsers.clear();
+    }
 
     errno_t err = _wfopen_s(&m_pFile, fileName, L"rb");
     if (err)
@@ -467,10 +478,8 @@ size_t UCIParser<NumType, LabelType>::UpdateBuffer()
     size_t saveBytes = m_byteCounter - m_spaceDelimitedStart;
     assert(saveBytes < m_bufferSize);
     if (saveBytes)
-    {
         memcpy_s(m_fileBuffer, m_bufferSize, &m_fileBuffer[m_byteCounter - m_bufferStart - saveBytes], saveBytes);
-        m_bufferStart = m_byteCounter - saveBytes;
-    }
+    m_bufferStart = m_byteCounter - saveBytes;
 
     // read the next block
     size_t bytesToRead = min(m_bufferSize, m_fileSize - m_bufferStart) - saveBytes;
@@ -480,6 +489,49 @@ size_t UCIParser<NumType, LabelType>::UpdateBuffer()
     return bytesRead;
 }
 
+// ShiftBuffer - move the unparsed rest of the buffer to its beginning, and fill up the buffer behind it
+template <typename NumType, typename LabelType>
+void UCIParser<NumType, LabelType>::ShiftBuffer()
+{
+    size_t bufferIndex = m_byteCounter - m_bufferStart;
+    size_t saveBytes = min((int64_t)m_bufferSize, m_fileSize - (int64_t)m_bufferStart) - bufferIndex;
+    memmove(m_fileBuffer, &m_fileBuffer[bufferIndex], saveBytes);
+    m_bufferStart = m_byteCounter;
+
+    size_t bytesToRead = min((int64_t)m_bufferSize, m_fileSize - (int64_t)m_bufferStart) - saveBytes;
+    size_t bytesRead = fread(m_fileBuffer + saveBytes, 1, bytesToRead, m_pFile);
+    if (bytesRead != bytesToRead)
+        RuntimeError("UCIParser::ShiftBuffer - error reading file");
+}
+
+// EnableParallelParse - parse the records in ParseNormal mode on multiple threads, must be called after ParseInit
+// numThreads - number of threads to use, zero means the number of hardware threads (at most the reader threads, see Globals)
+template <typename NumType, typename LabelType>
+void UCIParser<NumType, LabelType>::EnableParallelParse(size_t numThreads)
+{
+    assert(m_pFile != NULL);
+    numThreads = Microsoft::MSR::CNTK::Globals::GetNumReaderWorkerThreads(numThreads);
+
+    // the records are found by their new lines, which a custom delimiter would turn into whitespace
+    if (m_customDelimiter == '\n')
+        numThreads = 1;
+
+    m_sliceParsers.clear();
+    for (size_t i = 0; numThreads > 1 && i < numThreads; i++)
+    {
+        auto parser = std::make_unique<UCIParser<NumType, LabelType>>(m_customDelimiter, m_customDecimalPoint);
+        parser->m_startLabels = m_startLabels;
+        parser->m_dimLabels = m_dimLabels;
+        parser->m_startFeatures = m_startFeatures;
+        parser->m_dimFeatures = m_dimFeatures;
+        parser->m_parseMode = ParseNormal;
+        parser->m_traceLevel = 0;
+        m_sliceParsers.push_back(std::move(parser));
+    }
+    m_sliceNumbers.resize(m_sliceParsers.size());
+    m_sliceLabels.resize(m_sliceParsers.size());
+}
+
 template <typename NumType, typename LabelType>
 void UCIParser<NumType, LabelType>::SetParseMode(ParseMode mode)
 {
@@ -514,6 +566,148 @@ void UCIParser<NumType, LabelType>::SetTraceLevel(int traceLevel)
 // returns - number of records actually read, if the end of file is reached the return value will be < requested records
 template <typename NumType, typename LabelType>
 long UCIParser<NumType, LabelType>::Parse(size_t recordsRequested, std::vector<NumType> *numbers, std::vector<LabelType> *labels)
+{
+    if (!m_sliceParsers.empty() && m_parseMode == ParseNormal)
+        return ParseParallel(recordsRequested, numbers, labels);
+    return ParseRecords(recordsRequested, numbers, labels);
+}
+
+// ParseParallel - parse the complete records of each buffer in slices on multiple threads
+// a record ends with a new line that does not directly follow another one, so the slices start in the EndOfLine state,
+// which is the same state that a single thread would be in at that position
+template <typename NumType, typename LabelType>
+long UCIParser<NumType, LabelType>::ParseParallel(size_t recordsRequested, std::vector<NumType> *numbers, std::vector<LabelType> *labels)
+{
+    // slices smaller than this are not worth a thread
+    const size_t minSliceSize = 64 * 1024;
+
+    long TickStart = GetTickCount();
+    long recordCount = 0;
+
+    // finish the current line first, the slices start after the end of a line
+    if (m_current_state != EndOfLine && recordsRequested > 0)
+        recordCount += ParseRecords(1, numbers, labels);
+
+    while (m_byteCounter < m_fileSize && recordCount < recordsRequested)
+    {
+        size_t bufferIndex = m_byteCounter - m_bufferStart;
+        size_t bufferEnd = min((int64_t)m_bufferSize, m_fileSize - (int64_t)m_bufferStart);
+        bool endOfFile = (int64_t)(m_bufferStart + bufferEnd) == m_fileSize;
+
+        // find the complete records in the buffer, the position after a new line only ends a record if it is followed by something else
+        m_recordEnds.clear();
+        size_t index = bufferIndex;
+        while (index < bufferEnd && recordCount + m_recordEnds.size() < recordsRequested)
+        {
+            const BYTE *newLine = (const BYTE *) memchr(&m_fileBuffer[index], '\n', bufferEnd - index);
+            if (newLine == NULL)
+                break;
+            size_t newLineIndex = newLine - m_fileBuffer;
+            if (newLineIndex > index)
+                m_recordEnds.push_back(newLineIndex + 1);
+            index = newLineIndex + 1;
+        }
+
+        if (m_recordEnds.empty())
+        {
+            // the rest of the file is not a complete record, or a single record does not fit into the buffer: leave it to the state machine
+            if (endOfFile || bufferIndex == 0)
+            {
+                recordCount += ParseRecords(endOfFile ? recordsRequested - recordCount : 1, numbers, labels);
+                continue;
+            }
+            ShiftBuffer();
+            continue;
+        }
+
+        size_t numRecords = m_recordEnds.size();
+        size_t numSlices = min(m_sliceParsers.size(), numRecords);
+        numSlices = std::max((size_t) 1, min(numSlices, (m_recordEnds.back() - bufferIndex) / minSliceSize));
+
+        auto parseSlice = [this, bufferIndex, numRecords, numSlices, numbers, labels](size_t slice) -> long
+        {
+            size_t firstRecord = slice * numRecords / numSlices;
+            size_t endRecord = (slice + 1) * numRecords / numSlices;
+            size_t begin = firstRecord == 0 ? bufferIndex : m_recordEnds[firstRecord - 1];
+            size_t end = m_recordEnds[endRecord - 1];
+            m_sliceNumbers[slice].clear();
+            m_sliceLabels[slice].clear();
+            long sliceRecords = m_sliceParsers[slice]->ParseSlice(&m_fileBuffer[begin], m_bufferStart + begin, end - begin,
+                                                                  numbers ? &m_sliceNumbers[slice] : NULL, labels ? &m_sliceLabels[slice] : NULL);
+            assert(sliceRecords == endRecord - firstRecord);
+            return sliceRecords;
+        };
+
+        std::vector<std::future<long>> tasks;
+        for (size_t slice = 1; slice < numSlices; slice++)
+            tasks.push_back(std::async(std::launch::async, parseSlice, slice));
+        recordCount += parseSlice(0);
+        for (auto &task : tasks)
+            recordCount += task.get();
+
+        // append the records in file order
+        for (size_t slice = 0; slice < numSlices; slice++)
+        {
+            if (numbers != NULL)
+                numbers->insert(numbers->end(), m_sliceNumbers[slice].begin(), m_sliceNumbers[slice].end());
+            if (labels != NULL)
+                labels->insert(labels->end(), m_sliceLabels[slice].begin(), m_sliceLabels[slice].end());
+            m_totalNumbersConverted += m_sliceParsers[slice]->m_totalNumbersConverted;
+        }
+
+        // continue as a single thread would after the last new line
+        m_byteCounter = m_bufferStart + m_recordEnds.back();
+        m_current_state = EndOfLine;
+        m_spaceDelimitedStart = m_byteCounter;
+        m_spaceDelimitedMax = m_byteCounter;
+    }
+
+    if (m_traceLevel > 2)
+        fprintf(stderr, "\n%ld ms, %ld numbers parsed\n\n", GetTickCount() - TickStart, (long) m_totalNumbersConverted);
+    return recordCount;
+}
+
+// ParseSlice - parse the records of a slice of another parser's buffer, which starts after the end of a line
+// data - the first byte of the slice
+// position - file position of the slice
+// size - size of the slice in bytes, it ends after the end of a line
+// returns - number of records read
+template <typename NumType, typename LabelType>
+long UCIParser<NumType, LabelType>::ParseSlice(const BYTE *data, int64_t position, size_t size, std::vector<NumType> *numbers, std::vector<LabelType> *labels)
+{
+    // the slice is the whole "file" of this parser, so the buffer is never updated
+    m_fileBuffer = const_cast<BYTE *>(data);
+    m_bufferStart = position;
+    m_bufferSize = size;
+    m_fileSize = position + size;
+    m_byteCounter = position;
+    m_current_state = EndOfLine;
+    PrepareStartNumber();
+    PrepareStartLine();
+    m_totalNumbersConverted = 0;
+    m_totalLabelsConverted = 0;
+
+    long recordCount;
+    try
+    {
+        recordCount = ParseRecords(size_t(-1), numbers, labels);
+    }
+    catch (...)
+    {
+        m_fileBuffer = NULL;
+        throw;
+    }
+    m_fileBuffer = NULL; // not owned
+    return recordCount;
+}
+
+// ParseRecords - run the state machine over the data
+// recordsRequested - number of records requested
+// numbers - pointer to vector to return the numbers (must be allocated)
+// labels - pointer to vector to return the labels (defaults to null)
+// returns - number of records actually read, if the end of file is reached the return value will be < requested records
+template <typename NumType, typename LabelType>
+long UCIParser<NumType, LabelType>::ParseRecords(size_t recordsRequested, std::vector<NumType> *numbers, std::vector<LabelType> *labels)
 {
     assert(numbers != NULL || m_dimFeatures == 0 || m_parseMode == ParseLineCount);
     assert(labels != NULL || m_dimLabels == 0 || m_parseMode == ParseLineCount);
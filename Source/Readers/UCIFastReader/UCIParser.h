@@ -11,6 +11,7 @@
 #include <assert.h>
 #include <stdint.h>
 #include <algorithm>
+#include <memory>
 
 #ifdef min
 #undef min
@@ -104,6 +105,16 @@ private:
     // last label was a string (for last label processing)
     bool m_lastLabelIsString;
 
+    // custom characters the state tables were set up with (for the slice parsers)
+    char m_customDelimiter;
+    char m_customDecimalPoint;
+
+    // parallel parsing: one parser per slice of the buffer, and the records they return
+    std::vector<std::unique_ptr<UCIParser>> m_sliceParsers;
+    std::vector<std::vector<NumType>> m_sliceNumbers;
+    std::vector<std::vector<LabelType>> m_sliceLabels;
+    std::vector<size_t> m_recordEnds; // buffer indices one past the end of the complete records in the buffer
+
     // vectors to append to
     std::vector<NumType> *m_numbers;  // pointer to vectors to append with numbers
     std::vector<LabelType> *m_labels; // pointer to vector to append with labels (may be numeric)
@@ -132,6 +143,22 @@ private:
     // returns - number of records read
     size_t UpdateBuffer();
 
+    // ShiftBuffer - move the unparsed rest of the buffer to its beginning, and fill up the buffer behind it
+    void ShiftBuffer();
+
+    // ParseRecords - run the state machine over the data, see Parse()
+    long ParseRecords(size_t recordsRequested, std::vector<NumType> *numbers, std::vector<LabelType> *labels);
+
+    // ParseParallel - parse the complete records of each buffer in slices on multiple threads, see Parse()
+    long ParseParallel(size_t recordsRequested, std::vector<NumType> *numbers, std::vector<LabelType> *labels);
+
+    // ParseSlice - parse the records of a slice of another parser's buffer, which starts after the end of a line
+    // data - the first byte of the slice
+    // position - file position of the slice
+    // size - size of the slice in bytes, it ends after the end of a line
+    // returns - number of records read
+    long ParseSlice(const BYTE *data, int64_t position, size_t size, std::vector<NumType> *numbers, std::vector<LabelType> *labels);
+
 public:
     // UCIParser constructor
     UCIParser(char customDelimiter, char customDecimalPoint);
@@ -174,6 +201,11 @@ public:
     // startPosition - file position on which we should start
     void ParseInit(LPCWSTR fileName, size_t startFeatures, size_t dimFeatures, size_t startLabels, size_t dimLabels, size_t bufferSize = 1024 * 256, size_t startPosition = 0);
 
+    // EnableParallelParse - parse the records in ParseNormal mode on multiple threads, must be called after ParseInit
+    // the slices of the buffer are parsed in the same way as by a single thread, and their records are returned in file order
+    // numThreads - number of threads to use, zero means the number of hardware threads
+    void EnableParallelParse(size_t numThreads);
+
     // Parse - Parse the data
     // recordsRequested - number of records requested
     // numbers - pointer to vector to return the numbers (must be allocated)
@@ -2,7 +2,7 @@
 // Copyright (c) Microsoft. All rights reserved.
 // Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
 //
-// ASGDHelper.cpp : Implements ASGDHelper interface. The implementation is based on Multiverso.
+// ASGDHelper.cpp : Implements ASGDHelper interface. The implementations are based on Multiverso, or on MPIWrapper (native parameter server).
 //
 
 #define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
@@ -74,6 +74,26 @@ static void CudaCall(ERRTYPE retCode, const char* exprString, const char* libNam
 #define CUDA_CALL(expr)     (CudaCall((expr), #expr, "CUDA",     cudaSuccess))
 #endif // CPUONLY
 
+// The factor by which the model updates are scaled at the beginning of training, see AdjustLearningRateAtBeginning
+static float AdjustedLearningRateCoefficient(AdjustLearningRateAtBeginning adjustType, double adjustCoefficient, size_t adjustMBNumber, size_t parameterSyncCounter)
+{
+    float f = 1.f;
+    switch (adjustType)
+    {
+    case AdjustLearningRateAtBeginning::None:
+        break;
+    case AdjustLearningRateAtBeginning::Linearly:
+        f = min(f, max(0.f, (float)(adjustCoefficient + (1 - adjustCoefficient) / adjustMBNumber * parameterSyncCounter)));
+        break;
+    case AdjustLearningRateAtBeginning::Staircase:
+        f = min(f, max(0.f, (float)(adjustCoefficient * (parameterSyncCounter / adjustMBNumber + 1))));
+        break;
+    default:
+        break;
+    }
+    return f;
+}
+
 #ifdef ASGD_PARALLEL_SUPPORT
 
 // MultiversoHelper is the implementation of ASGDHelper interface with Multiverso
@@ -485,21 +505,7 @@ private:
 
     float DecayCoefficient()
     {
-        float f = 1.f;
-        switch (m_adjustLearningRateAtBeginningType)
-        {
-        case AdjustLearningRateAtBeginning::None:
-            break;
-        case AdjustLearningRateAtBeginning::Linearly:
-            f = min(f, max(0.f, (float)(m_adjustCoefficient + (1 - m_adjustCoefficient) / m_adjustMBNumber * m_parameterSyncCounter)));
-            break;
-        case AdjustLearningRateAtBeginning::Staircase:
-            f = min(f, max(0.f, (float)(m_adjustCoefficient * (m_parameterSyncCounter / m_adjustMBNumber + 1))));
-            break;
-        default:
-            break;
-        }
-        return f;
+        return AdjustedLearningRateCoefficient(m_adjustLearningRateAtBeginningType, m_adjustCoefficient, m_adjustMBNumber, m_parameterSyncCounter);
     }
 
     float ModelAggregationCoefficient(size_t samplesSinceLastSync)
@@ -625,6 +631,404 @@ public:
     void WaitAsyncBuffer() override { }
 };
 
+#if HAS_MPI
+
+// -----------------------------------------------------------------------
+// MPIParameterServerHelper -- implementation of the ASGDHelper interface with a parameter server built on MPIWrapper
+//
+// The model (the values of all learnable nodes, one after the other) is split into one shard per rank, and each rank
+// runs a server thread for its shard next to its worker. At each sync a worker pushes to every server the change of
+// its model since the last sync, and pulls back the changes of the shard since its last pull, which include the pushes
+// of all other workers in the meantime. Both are sent as (value, index) pairs when few entries changed, which keeps
+// the traffic low for sparse models (e.g. the embeddings of click models).
+// Bounded staleness: a server defers the pull of a worker until no other worker is more than maxStaleness syncs
+// behind it. Workers that wait in WaitAll() do not hold the others back.
+// The server threads call MPI at the same time as the training, which needs MPI_THREAD_MULTIPLE support (see
+// MPIWrapper::RequestMultipleThreadSupport()).
+// -----------------------------------------------------------------------
+template<class ElemType = float>
+class MPIParameterServerHelper : public ASGDHelper<ElemType>
+{
+public:
+    typedef shared_ptr<ComputationNode<ElemType>> ComputationNodePtr;
+
+    MPIParameterServerHelper(const std::list<ComputationNodeBasePtr> & learnableNodes, // Parameters that needs to be train
+        bool useAsyncBuffer,                                                            // Apply the pull of a sync at the next sync, to hide the communication cost
+        bool isSimulatedModelAveragingSGD,                                              // Average the models (no staleness) rather than ASGD
+        AdjustLearningRateAtBeginning adjusttype,
+        double adjustCoef,
+        size_t adjustPerMinibatches,
+        size_t maxStaleness,                                                            // max number of syncs a worker may be ahead of the others
+        int traceLevel,
+        const MPIWrapperPtr& pMPI) :
+        m_pMPI(pMPI), m_numWorkers(pMPI->NumNodesInUse()), m_myRank(pMPI->CurrentNodeRank()),
+        m_useAsyncBuffer(useAsyncBuffer), m_ModelAveragingSGDSimulating(isSimulatedModelAveragingSGD),
+        m_adjustLearningRateAtBeginningType(adjusttype), m_adjustCoefficient(adjustCoef), m_adjustMBNumber(adjustPerMinibatches),
+        m_maxStaleness(isSimulatedModelAveragingSGD ? 0 : maxStaleness), m_traceLevel(traceLevel),
+        m_parameterSyncCounter(0), m_phase(0), m_clock(0), m_pullPending(false)
+    {
+        if (!m_pMPI->SupportsMultipleThreads())
+            RuntimeError("DataParallelASGD: the native parameter server needs MPI with MPI_THREAD_MULTIPLE support, set 'mpiThreadMultiple=true' at the top level of the configuration.");
+
+        m_totalModelSize = 0;
+        for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++)
+        {
+            ComputationNodePtr node = dynamic_pointer_cast<ComputationNode<ElemType>>(*nodeIter);
+            m_tableOffsets.push_back(m_totalModelSize);
+            m_tableLength.push_back(node->Value().GetNumElements());
+            m_totalModelSize += m_tableLength.back();
+        }
+
+        for (size_t rank = 0; rank <= m_numWorkers; rank++)
+            m_shardStart.push_back(m_totalModelSize * rank / m_numWorkers);
+
+        // a dense message is the largest one
+        m_pushBuffers.resize(m_numWorkers);
+        m_pullBuffers.resize(m_numWorkers);
+        size_t maxShardSize = 0;
+        for (size_t rank = 0; rank < m_numWorkers; rank++)
+        {
+            m_pullBuffers[rank].resize(MaxMessageSize(ShardSize(rank)));
+            m_pushBuffers[rank].resize(MaxMessageSize(ShardSize(rank)));
+            maxShardSize = max(maxShardSize, ShardSize(rank));
+        }
+        m_serverReceiveBuffer.resize(MaxMessageSize(maxShardSize));
+        m_serverSendBuffers.assign(m_numWorkers, std::vector<char>(MaxMessageSize(ShardSize(m_myRank))));
+        m_workerRequests.assign(2 * m_numWorkers, MPI_REQUEST_NULL);
+
+        m_localModel.resize(m_totalModelSize);
+        m_serverModel.resize(m_totalModelSize);
+        m_delta.resize(m_totalModelSize);
+    }
+
+    ~MPIParameterServerHelper()
+    {
+        if (!m_serverThread.joinable())
+            return;
+
+        // once all workers are done, no more requests can arrive at the servers
+        WaitAsyncBuffer();
+        m_pMPI->WaitAll();
+
+        MessageHeader stop = { (int)MessageType::Stop, 0, m_phase, m_clock, 0 };
+        MPI_Request request;
+        m_pMPI->Isend(&stop, sizeof(stop), MPI_CHAR, (int)m_myRank, s_requestTag, &request) || MpiFail("MPIParameterServerHelper: MPI_Isend");
+        m_pMPI->Wait(&request, MPI_STATUS_IGNORE) || MpiFail("MPIParameterServerHelper: MPI_Wait");
+        m_serverThread.join();
+    }
+
+    // All workers start from the average of their initial models.
+    void InitModel(const std::list<ComputationNodeBasePtr> & learnableNodes) override
+    {
+        CopyModel(learnableNodes, m_localModel.data());
+        m_pMPI->AllReduce(m_localModel.data(), m_totalModelSize);
+        const ElemType factor = (ElemType)1 / m_numWorkers;
+        std::transform(m_localModel.begin(), m_localModel.end(), m_localModel.begin(), [factor](ElemType v) { return v * factor; });
+        SetModel(learnableNodes, m_localModel.data());
+        m_serverModel = m_localModel;
+
+        // this rank's shard, and what each worker has pulled of it
+        m_shard.assign(m_localModel.begin() + m_shardStart[m_myRank], m_localModel.begin() + m_shardStart[m_myRank + 1]);
+        m_lastPulledShards.assign(m_numWorkers, m_shard);
+        m_workerStates.assign(m_numWorkers, WorkerState());
+        m_serverDelta.resize(m_shard.size());
+
+        m_serverThread = std::thread([this]() { ServerLoop(); });
+        fprintf(stderr, "MPIParameterServerHelper: serving parameters %d..%d of %d (max staleness %d).\n",
+                (int)m_shardStart[m_myRank], (int)m_shardStart[m_myRank + 1], (int)m_totalModelSize, (int)min(m_maxStaleness, (size_t)INT_MAX));
+    }
+
+    bool PushAndPullModel(const std::list<ComputationNodeBasePtr> & learnableNodes, size_t sampleSinceLastSynced) override
+    {
+        m_parameterSyncCounter++;
+        m_reportTimer.Restart();
+
+        // the local progress since the last sync
+        CopyModel(learnableNodes, m_delta.data());
+        std::transform(m_delta.begin(), m_delta.end(), m_localModel.begin(), m_delta.begin(), std::minus<ElemType>());
+        const ElemType factor = m_ModelAveragingSGDSimulating ? (ElemType)1 / m_numWorkers : (ElemType)DecayCoefficient();
+        std::transform(m_delta.begin(), m_delta.end(), m_delta.begin(), [factor](ElemType v) { return v * factor; });
+
+        if (m_useAsyncBuffer)
+        {
+            // continue from the model pulled at the previous sync, with the local progress on top
+            WaitAsyncBuffer();
+            std::transform(m_serverModel.begin(), m_serverModel.end(), m_delta.begin(), m_localModel.begin(), std::plus<ElemType>());
+            PushAndRequestPull();
+        }
+        else
+        {
+            PushAndRequestPull();
+            WaitAsyncBuffer();
+            m_localModel = m_serverModel;
+        }
+        SetModel(learnableNodes, m_localModel.data());
+
+        m_reportTimer.Stop();
+        if (m_traceLevel > 3)
+            fprintf(stderr, "\t\t -- pullAndRequest, %d samples since last sync, Worker <--> parameter servers time %lf \n", (int)sampleSinceLastSynced, m_reportTimer.ElapsedSeconds());
+        return true;
+    }
+
+    // The workers that reach WaitAll() tell the servers that they are idle, so that they do not hold back the others.
+    void WaitAll() override
+    {
+        WaitAsyncBuffer();
+
+        MessageHeader idle = { (int)MessageType::Idle, 0, m_phase, m_clock, 0 };
+        for (size_t rank = 0; rank < m_numWorkers; rank++)
+            m_pMPI->Isend(&idle, sizeof(idle), MPI_CHAR, (int)rank, s_requestTag, &m_workerRequests[rank]) || MpiFail("MPIParameterServerHelper: MPI_Isend");
+        m_pMPI->Waitall((int)m_numWorkers, m_workerRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPIParameterServerHelper: MPI_Waitall");
+
+        m_pMPI->WaitAll();
+        m_phase++;
+        m_clock = 0;
+    }
+
+    // Waits for the pull of the last sync, and applies it to m_serverModel.
+    void WaitAsyncBuffer() override
+    {
+        if (!m_pullPending)
+            return;
+
+        m_pMPI->Waitall((int)m_workerRequests.size(), m_workerRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPIParameterServerHelper: MPI_Waitall");
+        for (size_t rank = 0; rank < m_numWorkers; rank++)
+            AddMessage(m_pullBuffers[rank].data(), m_serverModel.data() + m_shardStart[rank], ShardSize(rank));
+        m_pullPending = false;
+    }
+
+private:
+    enum class MessageType : int
+    {
+        Push,  // worker -> server: the change of the worker's model, and the request to pull the shard
+        Idle,  // worker -> server: the worker waits for the others
+        Stop,  // worker -> its own server: end the server thread
+        Pull   // server -> worker: the change of the shard since the worker's last pull
+    };
+
+    struct MessageHeader
+    {
+        int type;          // MessageType
+        int isSparse;      // the values are followed by their indices
+        size_t phase;      // number of WaitAll() calls of the worker
+        size_t clock;      // number of pushes of the worker since the last WaitAll()
+        size_t numValues;
+    };
+
+    // what a server knows about a worker
+    struct WorkerState
+    {
+        WorkerState() : phase(0), clock(0), isIdle(false), isPullPending(false) { }
+
+        size_t phase;
+        size_t clock;
+        bool isIdle;
+        bool isPullPending;
+    };
+
+    static const int s_requestTag = 0x61;
+    static const int s_replyTag = 0x62;
+
+    size_t ShardSize(size_t rank) const { return m_shardStart[rank + 1] - m_shardStart[rank]; }
+
+    static size_t MaxMessageSize(size_t numValues) { return sizeof(MessageHeader) + numValues * sizeof(ElemType); }
+
+    // Writes the message with the given values into the buffer, and returns its size in bytes. The values go first, to keep them aligned.
+    static int EncodeMessage(std::vector<char>& buffer, MessageType type, size_t phase, size_t clock, const ElemType* values, size_t numValues)
+    {
+        const size_t numNonZeros = std::count_if(values, values + numValues, [](ElemType v) { return v != 0; });
+        const bool isSparse = numValues <= UINT32_MAX && numNonZeros * (sizeof(ElemType) + sizeof(uint32_t)) < numValues * sizeof(ElemType);
+
+        MessageHeader header = { (int)type, isSparse ? 1 : 0, phase, clock, isSparse ? numNonZeros : numValues };
+        memcpy(buffer.data(), &header, sizeof(header));
+        ElemType* outValues = reinterpret_cast<ElemType*>(buffer.data() + sizeof(header));
+        if (!isSparse)
+        {
+            memcpy(outValues, values, numValues * sizeof(ElemType));
+            return (int)MaxMessageSize(numValues);
+        }
+
+        uint32_t* outIndices = reinterpret_cast<uint32_t*>(outValues + numNonZeros);
+        for (size_t i = 0; i < numValues; i++)
+        {
+            if (values[i] != 0)
+            {
+                *outValues++ = values[i];
+                *outIndices++ = (uint32_t)i;
+            }
+        }
+        return (int)(sizeof(header) + numNonZeros * (sizeof(ElemType) + sizeof(uint32_t)));
+    }
+
+    // Adds the values of the message to target[0..numValues).
+    static void AddMessage(const char* buffer, ElemType* target, size_t numValues)
+    {
+        const MessageHeader& header = *reinterpret_cast<const MessageHeader*>(buffer);
+        const ElemType* values = reinterpret_cast<const ElemType*>(buffer + sizeof(header));
+        if (!header.isSparse)
+        {
+            if (header.numValues != numValues)
+                LogicError("MPIParameterServerHelper: received %d values for a shard of %d.", (int)header.numValues, (int)numValues);
+            std::transform(target, target + numValues, values, target, std::plus<ElemType>());
+            return;
+        }
+
+        const uint32_t* indices = reinterpret_cast<const uint32_t*>(values + header.numValues);
+        for (size_t i = 0; i < header.numValues; i++)
+            target[indices[i]] += values[i];
+    }
+
+    void PushAndRequestPull()
+    {
+        m_clock++;
+        for (size_t rank = 0; rank < m_numWorkers; rank++)
+        {
+            int size = EncodeMessage(m_pushBuffers[rank], MessageType::Push, m_phase, m_clock, m_delta.data() + m_shardStart[rank], ShardSize(rank));
+            m_pMPI->Irecv(m_pullBuffers[rank].data(), (int)m_pullBuffers[rank].size(), MPI_CHAR, (int)rank, s_replyTag, &m_workerRequests[m_numWorkers + rank]) || MpiFail("MPIParameterServerHelper: MPI_Irecv");
+            m_pMPI->Isend(m_pushBuffers[rank].data(), size, MPI_CHAR, (int)rank, s_requestTag, &m_workerRequests[rank]) || MpiFail("MPIParameterServerHelper: MPI_Isend");
+        }
+        m_pullPending = true;
+    }
+
+    // The server thread: applies the pushes to the shard, and answers the pulls once the staleness allows it.
+    // requests[0] receives the next message, requests[1 + worker] sends the pull of that worker.
+    void ServerLoop()
+    {
+        std::vector<MPI_Request> requests(1 + m_numWorkers, MPI_REQUEST_NULL);
+        for (;;)
+        {
+            m_pMPI->Irecv(m_serverReceiveBuffer.data(), (int)m_serverReceiveBuffer.size(), MPI_CHAR, MPI_ANY_SOURCE, s_requestTag, &requests[0]) || MpiFail("MPIParameterServerHelper: MPI_Irecv");
+            MPI_Status status;
+            int index = -1;
+            while (index != 0) // the completed sends of pulls need no handling
+                m_pMPI->Waitany((int)requests.size(), requests.data(), &index, &status) || MpiFail("MPIParameterServerHelper: MPI_Waitany");
+
+            const MessageHeader& header = *reinterpret_cast<const MessageHeader*>(m_serverReceiveBuffer.data());
+            if (header.type == (int)MessageType::Stop)
+                break;
+
+            WorkerState& state = m_workerStates[status.MPI_SOURCE];
+            state.phase = header.phase;
+            state.clock = header.clock;
+            state.isIdle = header.type == (int)MessageType::Idle;
+            if (header.type == (int)MessageType::Push)
+            {
+                AddMessage(m_serverReceiveBuffer.data(), m_shard.data(), m_shard.size());
+                state.isPullPending = true;
+            }
+
+            for (size_t worker = 0; worker < m_numWorkers; worker++)
+            {
+                if (m_workerStates[worker].isPullPending && !IsTooStale(m_workerStates[worker]))
+                    SendPull(worker, requests[1 + worker]);
+            }
+        }
+        m_pMPI->Waitall((int)m_numWorkers, &requests[1], MPI_STATUSES_IGNORE) || MpiFail("MPIParameterServerHelper: MPI_Waitall");
+    }
+
+    // Whether a worker would be ahead of another (active) worker by more than m_maxStaleness syncs. A worker still
+    // in a previous phase is already on its way to the next one, where it starts at clock 0.
+    bool IsTooStale(const WorkerState& state) const
+    {
+        for (const auto& other : m_workerStates)
+        {
+            if (other.phase > state.phase || (other.phase == state.phase && other.isIdle))
+                continue;
+
+            size_t otherClock = other.phase == state.phase ? other.clock : 0;
+            if (state.clock > otherClock && state.clock - otherClock > m_maxStaleness)
+                return true;
+        }
+        return false;
+    }
+
+    // Sends the change of the shard since the last pull of the worker. The server applies the same change to its copy
+    // of what the worker pulled as the worker itself does, so that both stay identical.
+    void SendPull(size_t worker, MPI_Request& request)
+    {
+        if (request != MPI_REQUEST_NULL) // the previous pull of this worker, which it has received already
+            m_pMPI->Wait(&request, MPI_STATUS_IGNORE) || MpiFail("MPIParameterServerHelper: MPI_Wait");
+
+        WorkerState& state = m_workerStates[worker];
+        std::vector<ElemType>& lastPulled = m_lastPulledShards[worker];
+        std::transform(m_shard.begin(), m_shard.end(), lastPulled.begin(), m_serverDelta.begin(), std::minus<ElemType>());
+        int size = EncodeMessage(m_serverSendBuffers[worker], MessageType::Pull, state.phase, state.clock, m_serverDelta.data(), m_serverDelta.size());
+        std::transform(lastPulled.begin(), lastPulled.end(), m_serverDelta.begin(), lastPulled.begin(), std::plus<ElemType>());
+
+        m_pMPI->Isend(m_serverSendBuffers[worker].data(), size, MPI_CHAR, (int)worker, s_replyTag, &request) || MpiFail("MPIParameterServerHelper: MPI_Isend");
+        state.isPullPending = false;
+    }
+
+    void CopyModel(const std::list<ComputationNodeBasePtr> & learnableNodes, ElemType* model) const
+    {
+        int i = 0; // indicate the index of learnable nodes
+        for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++, i++)
+        {
+            ComputationNodePtr node = dynamic_pointer_cast<ComputationNode<ElemType>>(*nodeIter);
+            ElemType* px = model + m_tableOffsets[i];
+            size_t length = m_tableLength[i];
+            node->Value().CopyToArray(px, length);
+        }
+    }
+
+    void SetModel(const std::list<ComputationNodeBasePtr> & learnableNodes, ElemType* model) const
+    {
+        int i = 0; // indicate the index of learnable nodes
+        for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++, i++)
+        {
+            ComputationNodePtr node = dynamic_pointer_cast<ComputationNode<ElemType>>(*nodeIter);
+            Matrix<ElemType>& mat = node->Value();
+            mat.SetValue(mat.GetNumRows(), mat.GetNumCols(), mat.GetDeviceId(), model + m_tableOffsets[i]);
+        }
+    }
+
+    float DecayCoefficient()
+    {
+        return AdjustedLearningRateCoefficient(m_adjustLearningRateAtBeginningType, m_adjustCoefficient, m_adjustMBNumber, m_parameterSyncCounter);
+    }
+
+    MPIWrapperPtr m_pMPI;
+    const size_t m_numWorkers;
+    const size_t m_myRank;
+
+    bool m_useAsyncBuffer;
+    bool m_ModelAveragingSGDSimulating;
+    AdjustLearningRateAtBeginning m_adjustLearningRateAtBeginningType;
+    double m_adjustCoefficient;
+    size_t m_adjustMBNumber;
+    const size_t m_maxStaleness;
+    int m_traceLevel;
+    Timer m_reportTimer;
+    size_t m_parameterSyncCounter;
+
+    vector<size_t> m_tableLength;
+    vector<size_t> m_tableOffsets;
+    size_t m_totalModelSize;
+    vector<size_t> m_shardStart; // the shard of rank r is [m_shardStart[r], m_shardStart[r + 1])
+
+    // worker
+    size_t m_phase;
+    size_t m_clock;
+    std::vector<ElemType> m_localModel;  // the model after the last sync
+    std::vector<ElemType> m_serverModel; // the model as last pulled from the servers
+    std::vector<ElemType> m_delta;
+    std::vector<std::vector<char>> m_pushBuffers;
+    std::vector<std::vector<char>> m_pullBuffers;
+    std::vector<MPI_Request> m_workerRequests; // the pushes to each server, then the pulls from each server
+    bool m_pullPending;
+
+    // server (only used by m_serverThread once started)
+    std::thread m_serverThread;
+    std::vector<ElemType> m_shard;
+    std::vector<std::vector<ElemType>> m_lastPulledShards;
+    std::vector<ElemType> m_serverDelta;
+    std::vector<WorkerState> m_workerStates;
+    std::vector<char> m_serverReceiveBuffer;
+    std::vector<std::vector<char>> m_serverSendBuffers;
+};  // Class MPIParameterServerHelper
+
+#endif
+
 template<class ElemType>
 ASGDHelper<ElemType>* NewASGDHelper(
     const std::list<ComputationNodeBasePtr> & learnableNodes,                // Parameters that needs to be train
@@ -635,8 +1039,19 @@ ASGDHelper<ElemType>* NewASGDHelper(
     double adjustCoef,
     size_t adjustPerMinibatches,
     int traceLevel,
-    int syncPerfStats) 
+    int syncPerfStats,
+    bool useNativeParameterServer,
+    size_t maxStaleness,
+    const MPIWrapperPtr& pMPI)
 {
+#if HAS_MPI
+    if (useNativeParameterServer)
+        return new MPIParameterServerHelper<ElemType>(learnableNodes, useAsyncBuffer, isSimulatedModelAveragingSGD,
+                                                      adjusttype, adjustCoef, adjustPerMinibatches, maxStaleness, traceLevel, pMPI);
+#else
+    if (useNativeParameterServer)
+        InvalidArgument("DataParallelASGD: the native parameter server needs a build with MPI.");
+#endif
 #ifdef ASGD_PARALLEL_SUPPORT
     return new MultiversoHelper<ElemType>(learnableNodes, nodeNumRanks, useAsyncBuffer, isSimulatedModelAveragingSGD, 
                                       adjusttype, adjustCoef, adjustPerMinibatches, traceLevel, syncPerfStats);
@@ -655,7 +1070,10 @@ template ASGDHelper<float>* NewASGDHelper<float>(
     double adjustCoef,
     size_t adjustPerMinibatches,
     int traceLevel,
-    int syncPerfStats); 
+    int syncPerfStats,
+    bool useNativeParameterServer,
+    size_t maxStaleness,
+    const MPIWrapperPtr& pMPI);
 
 template ASGDHelper<double>* NewASGDHelper<double>(
     const std::list<ComputationNodeBasePtr> & learnableNodes,
@@ -666,6 +1084,9 @@ template ASGDHelper<double>* NewASGDHelper<double>(
     double adjustCoef,
     size_t adjustPerMinibatches,
     int traceLevel,
-    int syncPerfStats); 
+    int syncPerfStats,
+    bool useNativeParameterServer,
+    size_t maxStaleness,
+    const MPIWrapperPtr& pMPI);
 
 }}} 
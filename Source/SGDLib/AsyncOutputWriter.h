@@ -0,0 +1,357 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// AsyncOutputWriter.h -- writes the outputs of SimpleOutputWriter on a separate thread, while the next minibatch is evaluated
+//
+#pragma once
+
+#include "Basics.h"
+#include "ComputationNode.h"
+#include "CUDAPageLockedMemAllocator.h"
+#include "fileutil.h"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// StagedOutput -- a host copy of the value of an output node, with everything needed to write it
+// The values are in page-locked memory if the node lives on a GPU, which is reused for the following minibatches.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+struct StagedOutput
+{
+    std::shared_ptr<ElemType> data;
+    size_t capacity = 0;
+    size_t numRows = 0;
+    size_t numCols = 0;
+    MBLayoutPtr pMBLayout;               // (a copy, as the layout of the network changes with the next minibatch)
+    TensorShape sampleLayout;
+    std::map<size_t, std::string> keys; // sequence keys by sequence id, if requested
+
+    void CopyFrom(const ComputationNode<ElemType>& node, const std::function<std::string(size_t)>& getKeyById)
+    {
+        const auto& value = node.Value();
+        numRows = value.GetNumRows();
+        numCols = value.GetNumCols();
+        size_t numElements = numRows * numCols;
+        if (numElements > capacity)
+        {
+            int deviceId = value.GetDeviceId();
+            if (deviceId >= 0)
+                data.reset((ElemType*)CUDAPageLockedMemAllocator::Malloc(sizeof(ElemType) * numElements, deviceId), [deviceId](ElemType* p) { CUDAPageLockedMemAllocator::Free(p, deviceId); });
+            else
+                data.reset(new ElemType[numElements], [](ElemType* p) { delete[] p; });
+            capacity = numElements;
+        }
+        if (value.GetMatrixType() == MatrixType::DENSE)
+            value.CopySection(numRows, numCols, data.get(), numRows);
+        else if (numElements > 0)
+        {
+            std::unique_ptr<ElemType[]> dense(value.CopyToArray());
+            memcpy(data.get(), dense.get(), sizeof(ElemType) * numElements);
+        }
+
+        if (node.HasMBLayout())
+        {
+            if (!pMBLayout)
+                pMBLayout = std::make_shared<MBLayout>();
+            pMBLayout->CopyFrom(node.GetMBLayout());
+        }
+        else
+            pMBLayout = nullptr;
+        sampleLayout = node.GetSampleLayout();
+
+        keys.clear();
+        if (getKeyById && pMBLayout)
+        {
+            for (const auto& sequence : pMBLayout->GetAllSequences())
+            {
+                if (sequence.seqId != GAP_SEQUENCE_ID)
+                    keys[sequence.seqId] = getKeyById(sequence.seqId);
+            }
+        }
+    }
+
+    std::function<std::string(size_t)> GetKeyById() const
+    {
+        if (keys.empty())
+            return std::function<std::string(size_t)>();
+        return [this](size_t seqId) { return keys.at(seqId); };
+    }
+};
+
+template <class ElemType>
+struct StagedMinibatch
+{
+    std::vector<StagedOutput<ElemType>> outputs; // one per output node
+    size_t numMBsRun = 0;
+    size_t actualMBSize = 0;
+
+    void CopyFrom(const std::vector<ComputationNodeBasePtr>& nodes, size_t mbIndex, size_t mbSize, const std::function<std::string(size_t)>& getKeyById)
+    {
+        outputs.resize(nodes.size());
+        for (size_t i = 0; i < nodes.size(); i++)
+            outputs[i].CopyFrom(*dynamic_pointer_cast<ComputationNode<ElemType>>(nodes[i]), getKeyById);
+        numMBsRun = mbIndex;
+        actualMBSize = mbSize;
+    }
+};
+
+// -----------------------------------------------------------------------
+// AsyncOutputWriter -- a writer thread with a small number of staging buffers (two, for double buffering)
+// Push() copies the outputs into a free buffer, waiting for the writer thread if there is none, and queues it.
+// The writer thread passes the buffers to the write function in the order they were pushed. An exception of the
+// write function stops the writing and is rethrown by the next Push() or by Finish().
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class AsyncOutputWriter
+{
+public:
+    typedef std::function<void(StagedMinibatch<ElemType>&)> WriteFunction;
+
+    AsyncOutputWriter(WriteFunction write, size_t numBuffers = 2)
+        : m_write(write), m_buffers(numBuffers), m_stop(false)
+    {
+        if (numBuffers == 0)
+            InvalidArgument("AsyncOutputWriter: At least one buffer is needed.");
+        for (size_t i = 0; i < numBuffers; i++)
+            m_freeBuffers.push_back(i);
+        m_thread = std::thread([this]() { WriterLoop(); });
+    }
+
+    ~AsyncOutputWriter()
+    {
+        Stop(); // (errors that were not picked up by Finish() are dropped, we must not throw here)
+    }
+
+    void Push(const std::vector<ComputationNodeBasePtr>& nodes, size_t numMBsRun, size_t actualMBSize, const std::function<std::string(size_t)>& getKeyById)
+    {
+        size_t i;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_freeBuffers.empty() || m_error; });
+            if (m_error)
+                std::rethrow_exception(m_error);
+            i = m_freeBuffers.front();
+            m_freeBuffers.pop_front();
+        }
+        try
+        {
+            m_buffers[i].CopyFrom(nodes, numMBsRun, actualMBSize, getKeyById);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_freeBuffers.push_back(i);
+            throw;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(i);
+        }
+        m_cv.notify_all();
+    }
+
+    // wait until everything is written, and stop the writer thread
+    void Finish()
+    {
+        Stop();
+        if (m_error)
+            std::rethrow_exception(m_error);
+    }
+
+private:
+    void Stop()
+    {
+        if (!m_thread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    void WriterLoop()
+    {
+        for (;;)
+        {
+            size_t i;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return !m_queue.empty() || m_stop; });
+                if (m_queue.empty())
+                    return;
+                i = m_queue.front();
+                m_queue.pop_front();
+            }
+            std::exception_ptr error;
+            try
+            {
+                m_write(m_buffers[i]);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_freeBuffers.push_back(i);
+                if (error)
+                {
+                    m_error = error;
+                    m_queue.clear();
+                }
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    WriteFunction m_write;
+    std::vector<StagedMinibatch<ElemType>> m_buffers;
+    std::deque<size_t> m_freeBuffers;
+    std::deque<size_t> m_queue; // buffers to write, in order
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::exception_ptr m_error;
+    bool m_stop;
+    std::thread m_thread;
+};
+
+// -----------------------------------------------------------------------
+// BinaryOutputFile -- writes the values of one output node in the format of the CNTKBinaryReader, as one dense stream
+// named after the node. Sequences are collected into chunks of about 'chunkSizeInBytes', which are written in one go.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class BinaryOutputFile
+{
+public:
+    BinaryOutputFile(FILE* f, const std::wstring& streamName, size_t chunkSizeInBytes = 32 * 1024 * 1024)
+        : m_file(f), m_streamName(msra::strfun::utf8(streamName)), m_dim(0), m_chunkSizeInBytes(chunkSizeInBytes), m_offset(0)
+    {
+        Append(s_magic);
+        Append(s_version);
+        WriteOut();
+    }
+
+    void Write(const StagedOutput<ElemType>& output)
+    {
+        if (m_dim == 0)
+            m_dim = output.numRows;
+        else if (m_dim != output.numRows)
+            RuntimeError("BinaryOutputFile: The dimension of stream '%s' changed from %d to %d.", m_streamName.c_str(), (int)m_dim, (int)output.numRows);
+
+        MBLayoutPtr pMBLayout = output.pMBLayout;
+        if (!pMBLayout) // no MBLayout: one sequence consisting of the columns
+        {
+            pMBLayout = std::make_shared<MBLayout>();
+            pMBLayout->Init(1, output.numCols);
+            pMBLayout->AddSequence(0, 0, 0, output.numCols);
+        }
+        size_t numParallelSequences = pMBLayout->GetNumParallelSequences();
+        for (const auto& sequence : pMBLayout->GetAllSequences())
+        {
+            if (sequence.seqId == GAP_SEQUENCE_ID)
+                continue;
+            size_t tBegin = sequence.tBegin >= 0 ? sequence.tBegin : 0;
+            size_t tEnd = min(sequence.tEnd, pMBLayout->GetNumTimeSteps());
+            uint32_t numSamples = (uint32_t)(tEnd - tBegin);
+            Append(numSamples);
+            for (size_t t = tBegin; t < tEnd; t++)
+            {
+                const ElemType* column = output.data.get() + (t * numParallelSequences + sequence.s) * m_dim;
+                m_chunkData.insert(m_chunkData.end(), (const char*)column, (const char*)(column + m_dim));
+            }
+            m_chunkLengths.push_back(numSamples);
+            m_chunkNumSamples += numSamples;
+        }
+        if (m_chunkData.size() >= m_chunkSizeInBytes)
+            FlushChunk();
+    }
+
+    // write the last chunk and the header
+    void Close()
+    {
+        FlushChunk();
+        int64_t headerOffset = m_offset;
+        Append(s_magic);
+        Append((uint32_t)m_chunks.size());
+        Append((uint32_t)1);            // number of streams
+        Append((unsigned char)0);       // dense
+        Append((uint32_t)m_streamName.size());
+        m_chunkData.insert(m_chunkData.end(), m_streamName.begin(), m_streamName.end());
+        Append((unsigned char)(sizeof(ElemType) == sizeof(double) ? 1 : 0)); // double or float
+        Append((uint32_t)m_dim);
+        for (const auto& chunk : m_chunks)
+        {
+            Append(chunk.offset);
+            Append(chunk.numSequences);
+            Append(chunk.numSamples);
+        }
+        Append(headerOffset);
+        WriteOut();
+    }
+
+private:
+    struct ChunkInfo
+    {
+        int64_t offset;
+        uint32_t numSequences;
+        uint32_t numSamples;
+    };
+
+    template <class T>
+    void Append(T value)
+    {
+        m_chunkData.insert(m_chunkData.end(), (const char*)&value, (const char*)(&value + 1));
+    }
+
+    void FlushChunk()
+    {
+        if (m_chunkLengths.empty())
+            return;
+        m_chunks.push_back(ChunkInfo{ m_offset, (uint32_t)m_chunkLengths.size(), (uint32_t)m_chunkNumSamples });
+        // the chunk starts with the lengths of its sequences, followed by the sequences themselves
+        fwriteOrDie(m_chunkLengths.data(), sizeof(uint32_t), m_chunkLengths.size(), m_file);
+        m_offset += sizeof(uint32_t) * m_chunkLengths.size();
+        WriteOut();
+        m_chunkLengths.clear();
+        m_chunkNumSamples = 0;
+    }
+
+    void WriteOut()
+    {
+        fwriteOrDie(m_chunkData.data(), 1, m_chunkData.size(), m_file);
+        m_offset += m_chunkData.size();
+        m_chunkData.clear();
+    }
+
+    static const uint64_t s_magic = 0x636e746b5f62696eU; // "cntk_bin"
+    static const uint32_t s_version = 1;
+
+    FILE* m_file;
+    std::string m_streamName;
+    size_t m_dim;
+    size_t m_chunkSizeInBytes;
+    int64_t m_offset;
+    std::vector<char> m_chunkData; // (also used for the file header)
+    std::vector<uint32_t> m_chunkLengths;
+    size_t m_chunkNumSamples = 0;
+    std::vector<ChunkInfo> m_chunks;
+};
+
+}}}
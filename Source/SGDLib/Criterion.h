@@ -9,6 +9,7 @@
 #include "Basics.h"
 #include "Matrix.h"
 #include "TensorView.h"
+#include <algorithm>
 #include <memory> // for pair
 #include <limits> // for isnan() and numeric_limits  --TODO: is that the right header?
 
@@ -109,6 +110,23 @@ struct CriterionAccumulator
         else
             return EpochCriterion(m_aggregateCriterionValues->GetValue(0, i), m_aggregateSampleCounts[i]);
     }
+    // retrieve all accumulated results at once, with a single transfer from the GPU instead of one per criterion
+    void GetCriteria(std::vector<EpochCriterion>& criteria) const
+    {
+        criteria.assign(m_aggregateSampleCounts.size(), EpochCriterion(0, 0));
+        if (std::all_of(m_aggregateSampleCounts.begin(), m_aggregateSampleCounts.end(), [](size_t count) { return count == 0; }))
+            return; // avoid unnecessary GPU access
+
+        m_hostCriterionValues.resize(m_aggregateSampleCounts.size());
+        ElemType* hostValues = m_hostCriterionValues.data();
+        size_t hostSize = m_hostCriterionValues.size();
+        m_aggregateCriterionValues->CopyToArray(hostValues, hostSize); // (no reallocation, the buffer has the right size)
+        for (size_t i = 0; i < criteria.size(); i++)
+        {
+            if (m_aggregateSampleCounts[i] != 0)
+                criteria[i] = EpochCriterion(m_hostCriterionValues[i], m_aggregateSampleCounts[i]);
+        }
+    }
 
 private:
     // shared part of Add() and Assign()
@@ -188,6 +206,7 @@ public:
 private:
     shared_ptr<Matrix<ElemType>> m_aggregateCriterionValues; // [1 x N]
     vector<size_t> m_aggregateSampleCounts;                  // [N]
+    mutable vector<ElemType> m_hostCriterionValues;          // [N] buffer for GetCriteria()
 
     const std::vector<ComputationNodeBasePtr> m_criterionNodes;
     // Criterion nodes that accumulate result themselves.
@@ -480,9 +480,10 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             for (auto x : m_netStatefulNodes)
             {
                 wstring name = x.first;
-                if (m_netStates[name].empty())
+                if (m_netStates[name].size() != actualnumSubminibatches)
                 {
-                    // this only happens in the first minibatch in an epoch
+                    // this only happens in the first minibatch in an epoch, or when the number of subminibatches changes (see SGD's autoSubminibatches)
+                    m_netStates[name].clear();
                     m_netStates[name].resize(actualnumSubminibatches);
                 }
             }
@@ -602,6 +603,31 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             }
         }
 
+        // After a failure in one of the subminibatches: put the full minibatch back into the net, and drop what has been
+        // accumulated, so that the minibatch can be computed again from GetMinibatchIntoCache() on.
+        void RevertToFullMinibatch()
+        {
+            for (auto& x : m_inputMatricesCache)
+            {
+                const wstring& name = x.first;
+                m_netInputMatrixPtr.GetInputMatrix<ElemType>(name).SetValue(m_inputMatricesCache.GetInputMatrix<ElemType>(name));
+            }
+            m_netMBLayoutPtr->CopyFrom(m_MBLayoutCache);
+
+            if (m_hasLattices)
+            {
+                *m_netLatticePtr = m_LatticeCache;
+                *m_netUidPtr = m_uidCache;
+                *m_netExtrauttMapPtr = m_extrauttmapCache;
+                *m_netBoundariesPtr = m_BoundariesCache;
+            }
+
+            for (auto& x : m_cachedGradient)
+                m_cachedGradient.GetInputMatrix<ElemType>(x.first).SetValue(0);
+            m_netCriterionAccumulator->SetValue(0);
+            m_netEvaluationAccumulator->SetValue(0);
+        }
+
         void DoneWithCurrentMinibatch()
         {
             for (auto& x : m_cachedGradient)
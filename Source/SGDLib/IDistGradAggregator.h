@@ -19,6 +19,17 @@ public:
     // Returns a boolean indicating if any samples were processed
     virtual bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool resetState) = 0;
 
+    // Overlapping aggregation with backprop: if supported, the caller may report each gradient of the next AggregateGradients()
+    // call as soon as it is final, by its index into 'gradients', so that aggregation of it can start while backprop continues.
+    // The gradients must be the same as in the previous AggregateGradients() call.
+    virtual bool SupportsOverlappedAggregation() const
+    {
+        return false;
+    }
+    virtual void GradientReady(size_t /*gradientIndex*/)
+    {
+    }
+
     size_t NumProc()
     {
         return m_mpi->NumNodesInUse();
@@ -0,0 +1,487 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// LocalReplicas.h -- data-parallel training on several GPUs, or CPU threads, of a single process
+//
+#pragma once
+
+#include "Basics.h"
+#include "ComputationNetwork.h"
+#include "CPUMatrix.h" // for SetNumThreads()
+#include "DataReaderHelpers.h"
+#include "InputAndParamNodes.h"
+#include "NonlinearityNodes.h" // for DropoutNode
+#include "NcclComm.h"
+#include "ProgressTracing.h"
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// LocalReplicas -- replicas of the network on the other GPUs of this process (SGD option 'localDevices')
+// Each minibatch is read once into the main network, and split by parallel sequences across the main network, which
+// keeps the first share, and the replicas, which compute forward and backprop of theirs concurrently, one thread each.
+// The gradients and criterion values are then summed into the main network, which updates the parameters as without
+// replicas, and the updated parameters are copied back to the replicas. With NCCL, the sum and the copies are a reduce
+// and a broadcast among the GPUs; otherwise they are copies between the devices.
+// On the CPU (SGD option 'localThreads'), the replicas share the parameter values of the main network instead, so there
+// is nothing to copy back, and the threads of the OpenMP kernels are divided among the replicas. Sparse gradients
+// (matrixFormatSparseBlockCol, e.g. of embeddings) are summed as such, so that the update stays sparse.
+// The usage is:
+//     replicas.StartMinibatch(net, inputMatrices, computeGradient); // after reading the minibatch
+//     net->ForwardProp(...); net->Backprop(...);                   // the main network's share
+//     replicas.FinishMinibatch(net, computeGradient);
+//     ... update the parameters of the main network ...
+//     replicas.CopyParametersToReplicas(/*allParameters=*/false);
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class LocalReplicas
+{
+    typedef shared_ptr<ComputationNode<ElemType>> ComputationNodePtr;
+
+    // a thread that runs one task at a time
+    class Worker
+    {
+    public:
+        Worker()
+            : m_stop(false), m_thread([this]() { Loop(); })
+        {
+        }
+
+        ~Worker()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_cv.notify_all();
+            m_thread.join();
+        }
+
+        void Start(const std::function<void()>& task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_task = task;
+            }
+            m_cv.notify_all();
+        }
+
+        // wait for the task, and rethrow its exception if it failed
+        void Wait()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_task; });
+            if (m_error)
+            {
+                auto error = m_error;
+                m_error = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        void Loop()
+        {
+            for (;;)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_cv.wait(lock, [this]() { return m_task || m_stop; });
+                    if (!m_task)
+                        return;
+                    task = m_task;
+                }
+                std::exception_ptr error;
+                try
+                {
+                    task();
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_error = error;
+                    m_task = nullptr;
+                }
+                m_cv.notify_all();
+            }
+        }
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::function<void()> m_task; // the running task, empty if none
+        std::exception_ptr m_error;
+        bool m_stop;
+        std::thread m_thread;
+    };
+
+    struct Replica
+    {
+        ComputationNetworkPtr net;
+        ComputationNodeBasePtr criterionNode;
+        std::vector<ComputationNodeBasePtr> evaluationNodes;
+        std::vector<ComputationNodeBasePtr> forwardPropRoots;
+        StreamMinibatchInputs inputMatrices;
+        StreamMinibatchInputs shares;  // this replica's share of the minibatch, still on the main device
+        MBLayoutPtr pMBLayout;         // ... and its MBLayout
+        std::vector<ComputationNodePtr> parameters;      // in the order of m_parameters
+        std::vector<ComputationNodePtr> learnableNodes;  // in the order of m_learnableNodes
+        bool hasShare;                 // false if the minibatch has fewer parallel sequences than there are devices
+        std::unique_ptr<Worker> worker;
+    };
+
+public:
+    // 'devices' are all GPUs to train on, which must include the device of 'net'; or, for a network on the CPU, CPUDEVICE
+    // once per thread to train on
+    LocalReplicas(const ComputationNetworkPtr& net, const std::vector<DEVICEID_TYPE>& devices,
+                  const ComputationNodeBasePtr& criterionNode, const std::vector<ComputationNodeBasePtr>& evaluationNodes,
+                  size_t maxTempMemSizeInSamplesForCNN, size_t valueOffloadMinSampleSize, double valueOffloadBandwidthRatio,
+                  const std::wstring& tempFileName)
+        : m_net(net), m_criterionNode(criterionNode), m_evaluationNodes(evaluationNodes), m_fullMBLayout(make_shared<MBLayout>()),
+          m_onCPU(net->GetDeviceId() == CPUDEVICE), m_option(m_onCPU ? "localThreads" : "localDevices"), m_numThreadsPerReplica(0), m_prevNumThreads(0)
+    {
+        std::set<DEVICEID_TYPE> seen;
+        for (auto deviceId : devices)
+        {
+            if (m_onCPU)
+            {
+                if (deviceId != CPUDEVICE)
+                    InvalidArgument("localThreads: The network must be on the CPU.");
+                continue;
+            }
+            if (deviceId < 0)
+                InvalidArgument("localDevices: Only GPUs can be used, but %d was specified.", (int)deviceId);
+            if (!seen.insert(deviceId).second)
+                InvalidArgument("localDevices: GPU %d was specified more than once.", (int)deviceId);
+        }
+        if (!m_onCPU && seen.find(net->GetDeviceId()) == seen.end())
+            InvalidArgument("localDevices: The devices must include the device of the network, GPU %d.", (int)net->GetDeviceId());
+        if (!net->ExtractNodesWhichAccumulateResult(set<ComputationNodeBasePtr>(evaluationNodes.begin(), evaluationNodes.end())).empty())
+            InvalidArgument("%s: Evaluation nodes that accumulate their results over the epoch are not supported.", m_option);
+
+        for (const auto& node : net->GetNodesWithType(OperationNameOf(LearnableParameter), criterionNode))
+            m_parameters.push_back(dynamic_pointer_cast<ComputationNode<ElemType>>(node));
+        for (const auto& node : net->LearnableParameterNodes(criterionNode))
+        {
+            if (node->IsParameterUpdateRequired())
+                m_learnableNodes.push_back(dynamic_pointer_cast<ComputationNode<ElemType>>(node));
+        }
+
+        m_devices.push_back(net->GetDeviceId());
+        for (size_t d = m_onCPU ? 1 : 0; d < devices.size(); d++) // (on the CPU, the first thread is the main network's)
+        {
+            auto deviceId = devices[d];
+            if (!m_onCPU && deviceId == net->GetDeviceId())
+                continue;
+            m_devices.push_back(deviceId);
+
+            Replica replica;
+            replica.net = net->CloneToDevice<ElemType>(deviceId, tempFileName);
+            replica.net->Environment().SetOperationMode(NetworkOperationMode::training);
+            if (m_onCPU) // share the parameter values of the main network (before any matrix is allocated from them)
+            {
+                for (const auto& node : m_parameters)
+                    replica.net->GetNodeFromName(node->NodeName())->template As<ComputationNode<ElemType>>()->ValuePtrRef() = node->ValuePtrRef();
+            }
+            replica.criterionNode = replica.net->GetNodeFromName(criterionNode->NodeName());
+            for (const auto& node : evaluationNodes)
+                replica.evaluationNodes.push_back(replica.net->GetNodeFromName(node->NodeName()));
+            replica.forwardPropRoots = replica.evaluationNodes;
+            replica.forwardPropRoots.push_back(replica.criterionNode);
+            replica.net->SetValueOffload(valueOffloadMinSampleSize, valueOffloadBandwidthRatio);
+            replica.net->AllocateAllMatrices(replica.evaluationNodes, {}, replica.criterionNode);
+            ComputationNetwork::SetMaxTempMemSizeForCNN(replica.net, replica.criterionNode, maxTempMemSizeInSamplesForCNN);
+            for (const auto& nodes : { replica.net->FeatureNodes(), replica.net->LabelNodes() })
+            {
+                for (const auto& node : nodes)
+                    replica.inputMatrices.AddInput(node->NodeName(), node->ValuePtr(), node->GetMBLayout(), node->GetSampleLayout());
+            }
+            for (const auto& node : m_parameters)
+                replica.parameters.push_back(dynamic_pointer_cast<ComputationNode<ElemType>>(replica.net->GetNodeFromName(node->NodeName())));
+            for (const auto& node : m_learnableNodes)
+                replica.learnableNodes.push_back(dynamic_pointer_cast<ComputationNode<ElemType>>(replica.net->GetNodeFromName(node->NodeName())));
+            replica.hasShare = false;
+            replica.worker.reset(new Worker());
+            m_replicas.push_back(std::move(replica));
+        }
+
+        if (m_onCPU)
+        {
+            m_prevNumThreads = CPUMatrix<ElemType>::GetMaxNumThreads();
+            m_numThreadsPerReplica = CPUMatrix<ElemType>::SetNumThreads(std::max(1, m_prevNumThreads / (int)m_devices.size()));
+            LOGPRINTF(stderr, "localThreads: training on %d threads, with %d threads each for the kernels.\n", (int)m_devices.size(), m_numThreadsPerReplica);
+        }
+        else
+        {
+            m_nccl = make_shared<NcclComm>(std::vector<int>(m_devices.begin(), m_devices.end()));
+            LOGPRINTF(stderr, "localDevices: training on %d GPUs, with %s.\n", (int)m_devices.size(),
+                      m_nccl->IsSupported() ? "NCCL" : "copies between the devices");
+        }
+        CopyParametersToReplicas(/*allParameters=*/true);
+    }
+
+    ~LocalReplicas()
+    {
+        m_replicas.clear(); // (stops the workers before the rest goes away)
+        if (m_onCPU)
+            CPUMatrix<ElemType>::SetNumThreads(m_prevNumThreads);
+    }
+
+    // the settings of an epoch, which are applied to the main network by SGD; the replicas get distinct random seeds,
+    // as the workers of parallel training
+    void StartEpoch(size_t epoch, size_t maxEpochs, double dropoutRate, double normalizationTimeConstant, double blendTimeConstant)
+    {
+        for (size_t r = 0; r < m_replicas.size(); r++)
+        {
+            const auto& replica = m_replicas[r];
+            double prevDropoutRate = -1, prevNormalizationTimeConstant = -1, prevBlendTimeConstant = -1; // (always set)
+            ComputationNetwork::SetDropoutRate(replica.net, replica.criterionNode, dropoutRate, prevDropoutRate);
+            ComputationNetwork::SetIRngUserSeed(replica.net, replica.criterionNode, (r + 1) * maxEpochs + epoch);
+            ComputationNetwork::SetBatchNormalizationTimeConstants<ElemType>(replica.net, replica.criterionNode,
+                                                                             normalizationTimeConstant, prevNormalizationTimeConstant,
+                                                                             blendTimeConstant, prevBlendTimeConstant);
+            replica.net->StartEvaluateMinibatchLoop(replica.forwardPropRoots);
+        }
+    }
+
+    // Splits the minibatch in the input matrices of the main network; the main network keeps the first share, and the
+    // replicas start forward and (if 'computeGradient') backprop of the others.
+    void StartMinibatch(const ComputationNetworkPtr& net, StreamMinibatchInputs& inputMatrices, bool computeGradient)
+    {
+        auto& pMBLayout = net->GetMBLayoutPtrOfNetwork();
+        for (const auto& iter : inputMatrices)
+        {
+            if (iter.second.pMBLayout != pMBLayout)
+                InvalidArgument("%s: All inputs must have the same MBLayout to split the minibatch across the replicas.", m_option);
+        }
+        m_fullMBLayout->CopyFrom(pMBLayout);
+
+        size_t numShares = min(m_devices.size(), pMBLayout->GetNumParallelSequences());
+        for (size_t r = 0; r < m_replicas.size(); r++)
+        {
+            auto& replica = m_replicas[r];
+            replica.hasShare = r + 1 < numShares;
+            if (!replica.hasShare)
+                continue;
+            replica.shares = StreamMinibatchInputs();
+            DataReaderHelpers::DecimateMinibatch<ElemType>(inputMatrices, replica.shares, pMBLayout, replica.pMBLayout, numShares, r + 1);
+            replica.worker->Start([this, r, computeGradient]() { RunReplica(m_replicas[r], computeGradient); });
+        }
+        DataReaderHelpers::DecimateMinibatchInPlace<ElemType>(inputMatrices, numShares, 0, pMBLayout);
+        DataReaderHelpers::NotifyChangedNodes<ElemType>(net, inputMatrices);
+        net->DetermineActualMBSizeFromFeatures();
+    }
+
+    // Waits for the replicas, sums their criterion values and (if 'computeGradient') gradients into the main network,
+    // and restores its MBLayout to that of the whole minibatch, for counting the samples.
+    void FinishMinibatch(const ComputationNetworkPtr& net, bool computeGradient)
+    {
+        std::exception_ptr error;
+        for (auto& replica : m_replicas)
+        {
+            if (!replica.hasShare)
+                continue;
+            try
+            {
+                replica.worker->Wait();
+            }
+            catch (...)
+            {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+        if (error)
+            std::rethrow_exception(error);
+
+        for (const auto& replica : m_replicas)
+        {
+            if (!replica.hasShare)
+                continue;
+            AddScalarValue(replica.criterionNode, m_criterionNode);
+            for (size_t i = 0; i < m_evaluationNodes.size(); i++)
+                AddScalarValue(replica.evaluationNodes[i], m_evaluationNodes[i]);
+        }
+        if (computeGradient)
+            SumGradients();
+
+        net->GetMBLayoutPtrOfNetwork()->CopyFrom(m_fullMBLayout);
+    }
+
+    // copies the parameters of the main network to the replicas: all of them, or only those that are updated by SGD
+    // On the CPU, the values are shared, and the replicas only learn that they have changed.
+    void CopyParametersToReplicas(bool allParameters)
+    {
+        if (m_replicas.empty())
+            return;
+
+        const auto& mainNodes = allParameters ? m_parameters : m_learnableNodes;
+        if (m_onCPU)
+        {
+            // (nothing to copy)
+        }
+        else if (m_nccl->IsSupported())
+        {
+            std::vector<std::vector<Matrix<ElemType>*>> valuesOfDevices(m_devices.size());
+            for (const auto& node : mainNodes)
+                valuesOfDevices[0].push_back(&node->Value());
+            for (size_t r = 0; r < m_replicas.size(); r++)
+            {
+                for (const auto& node : allParameters ? m_replicas[r].parameters : m_replicas[r].learnableNodes)
+                    valuesOfDevices[r + 1].push_back(&node->Value());
+            }
+            m_nccl->LocalBroadcast(valuesOfDevices);
+            m_nccl->Sync();
+        }
+        else
+        {
+            for (auto& replica : m_replicas)
+            {
+                const auto& nodes = allParameters ? replica.parameters : replica.learnableNodes;
+                for (size_t i = 0; i < nodes.size(); i++)
+                    nodes[i]->Value().AssignValuesOf(mainNodes[i]->Value());
+            }
+        }
+        for (auto& replica : m_replicas)
+        {
+            for (const auto& node : allParameters ? replica.parameters : replica.learnableNodes)
+                node->BumpEvalTimeStamp();
+        }
+    }
+
+private:
+    // runs on the worker of the replica
+    void RunReplica(Replica& replica, bool computeGradient)
+    {
+        if (m_onCPU) // (the number of OpenMP threads is a setting of the calling thread)
+            CPUMatrix<ElemType>::SetNumThreads(m_numThreadsPerReplica);
+
+        for (const auto& iter : replica.shares)
+        {
+            auto& share = replica.shares.template GetInputMatrix<ElemType>(iter.first);
+            share.TransferToDeviceIfNotThere(replica.net->GetDeviceId(), /*isBeingMoved=*/true);
+            replica.inputMatrices.template GetInputMatrix<ElemType>(iter.first).SetValue(share);
+        }
+        replica.shares = StreamMinibatchInputs();
+        replica.net->GetMBLayoutPtrOfNetwork()->CopyFrom(replica.pMBLayout);
+        DataReaderHelpers::NotifyChangedNodes<ElemType>(replica.net, replica.inputMatrices);
+        replica.net->DetermineActualMBSizeFromFeatures();
+
+        // as in SGD::TrainOneEpoch()
+        for (const auto& node : replica.net->GetNodesWithType(OperationNameOf(DropoutNode), replica.criterionNode))
+            node->SetEvalTimeStampOutdatedWrtAll();
+        ComputationNetwork::BumpEvalTimeStamp(replica.net->FeatureNodes());
+        ComputationNetwork::BumpEvalTimeStamp(replica.net->LabelNodes());
+
+        replica.net->ForwardProp(replica.forwardPropRoots);
+        if (computeGradient)
+            replica.net->Backprop(replica.criterionNode);
+    }
+
+    // adds the 1x1 value of 'from' on a replica to that of 'to' in the main network
+    void AddScalarValue(const ComputationNodeBasePtr& from, const ComputationNodeBasePtr& to)
+    {
+        auto& value = to->As<ComputationNode<ElemType>>()->Value();
+        if (!m_scalarBuffer)
+            m_scalarBuffer = make_shared<Matrix<ElemType>>(1, 1, value.GetDeviceId());
+        m_scalarBuffer->AssignValuesOf(from->As<ComputationNode<ElemType>>()->Value());
+        Matrix<ElemType>::AddElementToElement(*m_scalarBuffer, 0, 0, value, 0, 0);
+    }
+
+    // sums the gradients of the replicas with a share of the minibatch into the main network
+    void SumGradients()
+    {
+        std::vector<std::vector<Matrix<ElemType>*>> gradientsOfDevices(m_devices.size());
+        for (size_t i = 0; i < m_learnableNodes.size(); i++)
+        {
+            gradientsOfDevices[0].push_back(&m_learnableNodes[i]->Gradient());
+            for (size_t r = 0; r < m_replicas.size(); r++)
+                gradientsOfDevices[r + 1].push_back(&m_replicas[r].learnableNodes[i]->Gradient());
+        }
+        for (size_t k = 0; k < gradientsOfDevices.size(); k++)
+        {
+            for (size_t i = 0; i < m_learnableNodes.size(); i++)
+            {
+                auto& gradient = *gradientsOfDevices[k][i];
+                bool isSparse = gradient.GetMatrixType() != MatrixType::DENSE;
+                if (isSparse && (!m_onCPU || gradient.GetFormat() != matrixFormatSparseBlockCol))
+                    RuntimeError("%s: The gradient of %ls is sparse, which is not supported%s.", m_option, m_learnableNodes[i]->NodeDescription().c_str(),
+                                 m_onCPU ? " in other formats than block-column" : "");
+                // a device without a share, or a parameter that did not get a gradient, adds zeros
+                bool hasGradient = k == 0 || m_replicas[k - 1].hasShare;
+                if (gradient.GetNumRows() != m_learnableNodes[i]->Value().GetNumRows() || gradient.GetNumCols() != m_learnableNodes[i]->Value().GetNumCols())
+                {
+                    gradient.Resize(m_learnableNodes[i]->Value().GetNumRows(), m_learnableNodes[i]->Value().GetNumCols());
+                    hasGradient = false;
+                }
+                if (!hasGradient && isSparse)
+                    gradient.Reset(); // (no blocks)
+                else if (!hasGradient)
+                    gradient.SetValue(0);
+            }
+        }
+
+        if (m_onCPU)
+        {
+            for (size_t r = 0; r < m_replicas.size(); r++)
+            {
+                if (!m_replicas[r].hasShare)
+                    continue;
+                for (size_t i = 0; i < m_learnableNodes.size(); i++)
+                    Matrix<ElemType>::ScaleAndAdd(1, *gradientsOfDevices[r + 1][i], *gradientsOfDevices[0][i]);
+            }
+        }
+        else if (m_nccl->IsSupported())
+        {
+            m_nccl->LocalReduce(gradientsOfDevices);
+            m_nccl->Sync();
+        }
+        else
+        {
+            if (!m_gradientBuffer)
+                m_gradientBuffer = make_shared<Matrix<ElemType>>(m_net->GetDeviceId());
+            for (size_t r = 0; r < m_replicas.size(); r++)
+            {
+                if (!m_replicas[r].hasShare)
+                    continue;
+                for (size_t i = 0; i < m_learnableNodes.size(); i++)
+                {
+                    m_gradientBuffer->AssignValuesOf(*gradientsOfDevices[r + 1][i]);
+                    *gradientsOfDevices[0][i] += *m_gradientBuffer;
+                }
+            }
+        }
+    }
+
+    ComputationNetworkPtr m_net;
+    ComputationNodeBasePtr m_criterionNode;
+    std::vector<ComputationNodeBasePtr> m_evaluationNodes;
+    std::vector<ComputationNodePtr> m_parameters;     // all LearnableParameters of the criterion, including those that are not updated
+    std::vector<ComputationNodePtr> m_learnableNodes; // the parameters that are updated
+    std::vector<DEVICEID_TYPE> m_devices;             // the device of the main network first, then those of the replicas
+    std::vector<Replica> m_replicas;
+    std::shared_ptr<NcclComm> m_nccl;                 // (not on the CPU)
+    MBLayoutPtr m_fullMBLayout;
+    const bool m_onCPU;                               // the replicas are threads on the CPU, sharing the parameter values
+    const char* const m_option;                       // the SGD option, for messages
+    int m_numThreadsPerReplica;                       // on the CPU, the OpenMP threads of the kernels of each replica
+    int m_prevNumThreads;                             // ... and of the process before
+    std::shared_ptr<Matrix<ElemType>> m_scalarBuffer;   // on the main device
+    std::shared_ptr<Matrix<ElemType>> m_gradientBuffer; // on the main device, without NCCL
+};
+
+}}}
@@ -41,12 +41,17 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         size_t m_localSamplesProcessedSinceLastReport; 
         double m_accumulatedSecondsOnSyncPointInOneEpoch;
         size_t m_syncPointHitCounterInOneEpoch;
+        // communication the workers were blocked on (exposed) vs communication that ran while training continued (overlapped)
+        double m_exposedSecondsOnCommunicationInOneEpoch;
+        double m_overlappedSecondsOnCommunicationInOneEpoch;
+        double m_overlappedSecondsOnCommunicationSinceLastSync;
         Timer  m_Timer; 
 
     public:
         MASGDPerfStats(size_t myRank, size_t numWorkers):
             m_numWorkers(numWorkers), m_myRank(myRank), m_numSyncPerformedInCurrentEpoch(0), m_reportFrequency(1), 
-            m_totalSamplesProcessedSinceLastReport(0), m_localSamplesProcessedSinceLastReport(0)
+            m_totalSamplesProcessedSinceLastReport(0), m_localSamplesProcessedSinceLastReport(0),
+            m_exposedSecondsOnCommunicationInOneEpoch(0), m_overlappedSecondsOnCommunicationInOneEpoch(0), m_overlappedSecondsOnCommunicationSinceLastSync(0)
         {
             m_Timer.Start();
         }
@@ -62,14 +67,32 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             m_numSyncPerformedInCurrentEpoch = 0; 
             m_accumulatedSecondsOnSyncPointInOneEpoch = 0;
             m_syncPointHitCounterInOneEpoch = 0;
+            m_exposedSecondsOnCommunicationInOneEpoch = 0;
+            m_overlappedSecondsOnCommunicationInOneEpoch = 0;
+            m_overlappedSecondsOnCommunicationSinceLastSync = 0;
         }
         void OnEpochEnd()
         {
             m_Timer.Stop();
+            if (m_overlappedSecondsOnCommunicationInOneEpoch > 0)
+            {
+                fprintf(stderr, "\t\t(model aggregation stats): %.2f seconds on comm. exposed, %.2f seconds on comm. overlapped with training in this epoch\n",
+                        m_exposedSecondsOnCommunicationInOneEpoch, m_overlappedSecondsOnCommunicationInOneEpoch);
+            }
+        }
+        // For pipelined model aggregation: the time a model exchange was in flight while training continued. It is
+        // attributed to the next model aggregation reported with OnMAPerformed.
+        void OnCommunicationOverlapped(double secondsOnCommunication)
+        {
+            m_overlappedSecondsOnCommunicationSinceLastSync += secondsOnCommunication;
         }
         void OnMAPerformed(size_t localSamplesProcessedSinceLastSync, size_t totalSamplesProcessedSinceLastSync, float secondsOnCommunication)
         {
             m_numSyncPerformedInCurrentEpoch++;
+            m_exposedSecondsOnCommunicationInOneEpoch += secondsOnCommunication;
+            m_overlappedSecondsOnCommunicationInOneEpoch += m_overlappedSecondsOnCommunicationSinceLastSync;
+            float secondsOnOverlappedCommunication = (float)m_overlappedSecondsOnCommunicationSinceLastSync;
+            m_overlappedSecondsOnCommunicationSinceLastSync = 0;
             m_totalSamplesProcessedSinceLastReport += totalSamplesProcessedSinceLastSync; 
             m_localSamplesProcessedSinceLastReport += localSamplesProcessedSinceLastSync; 
             if ( m_reportFrequency > 0 && 
@@ -82,7 +105,8 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             {
                 ReportMAPerfStats(m_totalSamplesProcessedSinceLastReport, 
                                   m_localSamplesProcessedSinceLastReport, 
-                                  secondsOnCommunication );
+                                  secondsOnCommunication,
+                                  secondsOnOverlappedCommunication);
 
                 m_totalSamplesProcessedSinceLastReport = 0; 
                 m_localSamplesProcessedSinceLastReport = 0; 
@@ -104,7 +128,8 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
         void ReportMAPerfStats( size_t totalSamplesProcessedSinceLastReport, 
                                 size_t localSamplesProcessedSinceLastReport, 
-                                float secondOnCommunication)
+                                float secondOnCommunication,
+                                float secondOnOverlappedCommunication = 0.0f)
         {
             m_Timer.Stop(); 
             double secondsSinceLastReport = m_Timer.ElapsedSeconds(); 
@@ -113,10 +138,20 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             float totalThroughput = secondsSinceLastReport > 0 ? (float)totalSamplesProcessedSinceLastReport / ((float)secondsSinceLastReport * 1000.0f) : 0.0f ; 
             float throughputPerWorker = totalThroughput / m_numWorkers; 
 
-            string prefix = "\t\t(model aggregation stats) %d-th sync: %8.2f seconds since last report (%.2f seconds on comm.); %d samples processed by %d workers (%d by me);\n"
-                            "\t\t(model aggregation stats) %d-th sync: totalThroughput = %.2fk samplesPerSecond , throughputPerWorker = %.2fk samplesPerSecond\n";
-            fprintf(stderr, prefix.c_str(), (int)m_numSyncPerformedInCurrentEpoch, secondsSinceLastReport, secondOnCommunication, (int)totalSamplesProcessedSinceLastReport, (int)m_numWorkers, (int)localSamplesProcessedSinceLastReport,
-                                            (int)m_numSyncPerformedInCurrentEpoch, totalThroughput, throughputPerWorker); 
+            if (secondOnOverlappedCommunication > 0)
+            {
+                fprintf(stderr, "\t\t(model aggregation stats) %d-th sync: %8.2f seconds since last report (%.2f seconds on comm. exposed, %.2f seconds overlapped); %d samples processed by %d workers (%d by me);\n",
+                        (int)m_numSyncPerformedInCurrentEpoch, secondsSinceLastReport, secondOnCommunication, secondOnOverlappedCommunication,
+                        (int)totalSamplesProcessedSinceLastReport, (int)m_numWorkers, (int)localSamplesProcessedSinceLastReport);
+            }
+            else
+            {
+                fprintf(stderr, "\t\t(model aggregation stats) %d-th sync: %8.2f seconds since last report (%.2f seconds on comm.); %d samples processed by %d workers (%d by me);\n",
+                        (int)m_numSyncPerformedInCurrentEpoch, secondsSinceLastReport, secondOnCommunication,
+                        (int)totalSamplesProcessedSinceLastReport, (int)m_numWorkers, (int)localSamplesProcessedSinceLastReport);
+            }
+            fprintf(stderr, "\t\t(model aggregation stats) %d-th sync: totalThroughput = %.2fk samplesPerSecond , throughputPerWorker = %.2fk samplesPerSecond\n",
+                    (int)m_numSyncPerformedInCurrentEpoch, totalThroughput, throughputPerWorker);
         }
     };
     // base class for MA-SGD algorithm family 
@@ -421,4 +456,184 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         }
     };
 
+    // Model averaging with the exchange of the models pipelined with training.
+    // At a sync point the weighted local models are copied into a host buffer and summed with a non-blocking AllReduce,
+    // and training of the next block continues with the local models. At the following sync point the exchange is
+    // completed and applied as a delayed correction
+    //     w <- w + (average(w_k) - w_k)
+    // where w_k is the local snapshot that was sent, i.e. the progress made while the average was in flight is kept.
+    // The aggregation at the end of an epoch is blocking, so that all workers start the next epoch from the same model.
+    // The time an exchange was in flight while training continued is reported as overlapped communication; it is an
+    // upper bound of the communication time actually hidden.
+    template<typename ElemType>
+    class PipelinedModelAveragingSGD : public IMASGD<ElemType>
+    {
+        typedef IMASGD<ElemType> Base; 
+        using Base::m_pMPI;
+        using Base::m_perfReporter;
+        using Base::DownCast;
+
+    public:
+        PipelinedModelAveragingSGD(const MPIWrapperPtr& pMPI, size_t reportFreq, DEVICEID_TYPE devID)
+            : Base(pMPI, reportFreq, devID), m_hasPendingAggregation(false), m_isEpochEnding(false)
+        {
+            fprintf(stderr, "Parallel training (%d workers) using ModelAveraging (pipelined)\n", (int)m_pMPI->NumNodesInUse());
+        }
+
+        ~PipelinedModelAveragingSGD()
+        {
+            // the buffers must outlive the exchange
+            if (m_hasPendingAggregation)
+                m_pMPI->Wait(&m_pendingRequest, MPI_STATUS_IGNORE);
+        }
+
+        void OnEpochEnd(const std::list<ComputationNodeBasePtr>& learnableNodes,
+                        std::list<Matrix<ElemType>>&             smoothedGradient,
+                        size_t                                   samplesSinceLastSync) override
+        {
+            m_isEpochEnding = true;
+            Base::OnEpochEnd(learnableNodes, smoothedGradient, samplesSinceLastSync);
+            m_isEpochEnding = false;
+            if (m_hasPendingAggregation)
+                LogicError("PipelinedModelAveragingSGD: a model aggregation is still pending at the end of the epoch.");
+        }
+
+        void ModelAggregationProcessing(
+            size_t samplesSinceLastSync,                                       /* in */
+            const std::list<ComputationNodeBasePtr>&  learnableNodes,          /* in/out */
+            std::list<Matrix<ElemType>>&              /*smoothedGradient*/,    /* in/out */
+            size_t&                                   totalSamplesProcessed,   /* out */
+            float&                                    secondsOnCommunication   /* out */) override
+        {
+            Timer commTimer; 
+            secondsOnCommunication = 0.0f;
+
+            //----------------------------------------
+            // 1. complete the exchange started at the previous sync point, and apply its correction
+            //----------------------------------------
+            if (m_hasPendingAggregation)
+            {
+                m_overlapTimer.Stop();
+                m_perfReporter.OnCommunicationOverlapped(m_overlapTimer.ElapsedSeconds());
+                commTimer.Start();
+                m_pMPI->Wait(&m_pendingRequest, MPI_STATUS_IGNORE);
+                commTimer.Stop();
+                secondsOnCommunication += (float)commTimer.ElapsedSeconds();
+                m_hasPendingAggregation = false;
+                ApplyAverage(learnableNodes, /*asCorrection=*/true);
+            }
+
+            //----------------------------------------
+            // 2. communicate with other nodes to negotiate contribution weights
+            //----------------------------------------
+            float factor = 0;
+            int   nTotalSamples = samplesSinceLastSync;
+            commTimer.Restart();
+            m_pMPI->AllReduce(&nTotalSamples, 1);
+            commTimer.Stop();
+            secondsOnCommunication += (float)commTimer.ElapsedSeconds();
+
+            if (nTotalSamples <= 0)
+            {
+                // prepare for overflow 
+                factor = 1.0f / m_pMPI->NumNodesInUse();
+                totalSamplesProcessed = samplesSinceLastSync * m_pMPI->NumNodesInUse();
+                // give an estimated one 
+            }
+            else
+            {
+                factor = (samplesSinceLastSync + 0.0f) / nTotalSamples;
+                totalSamplesProcessed = nTotalSamples;
+            }
+
+            //----------------------------------------
+            // 3. take a snapshot of the local models, and start summing the weighted snapshots 
+            //----------------------------------------
+            TakeSnapshot(learnableNodes);
+            m_buffer.resize(m_snapshot.size());
+            for (size_t i = 0; i < m_snapshot.size(); i++)
+                m_buffer[i] = factor * m_snapshot[i];
+
+            commTimer.Restart();
+            m_pMPI->AllReduceAsync(m_buffer.data(), m_buffer.size(), &m_pendingRequest);
+            if (m_isEpochEnding)
+            {
+                m_pMPI->Wait(&m_pendingRequest, MPI_STATUS_IGNORE);
+                commTimer.Stop();
+                secondsOnCommunication += (float)commTimer.ElapsedSeconds();
+                ApplyAverage(learnableNodes, /*asCorrection=*/false);
+            }
+            else
+            {
+                commTimer.Stop();
+                secondsOnCommunication += (float)commTimer.ElapsedSeconds();
+                m_hasPendingAggregation = true;
+                m_overlapTimer.Restart();
+            }
+        }
+
+    private:
+        // copies the values of all parameters into m_snapshot, one after the other
+        void TakeSnapshot(const std::list<ComputationNodeBasePtr>& learnableNodes)
+        {
+            size_t numElements = 0;
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (pBaseNode->IsParameterUpdateRequired())
+                    numElements += DownCast(pBaseNode)->Value().GetNumElements();
+            }
+            m_snapshot.resize(numElements);
+
+            size_t offset = 0;
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                    continue;
+                const Matrix<ElemType>& value = DownCast(pBaseNode)->Value();
+                value.CopySection(value.GetNumRows(), value.GetNumCols(), m_snapshot.data() + offset, value.GetNumRows());
+                offset += value.GetNumElements();
+            }
+        }
+
+        // sets the parameters to the average in m_buffer, or, as a correction, adds the difference of the average and
+        // the snapshot it was computed from
+        void ApplyAverage(const std::list<ComputationNodeBasePtr>& learnableNodes, bool asCorrection)
+        {
+            size_t offset = 0;
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                    continue;
+                Matrix<ElemType>& value = DownCast(pBaseNode)->Value();
+                size_t numElements = value.GetNumElements();
+                if (offset + numElements > m_buffer.size())
+                    LogicError("PipelinedModelAveragingSGD: the parameters changed while their average was computed.");
+                ElemType* average = m_buffer.data() + offset;
+                if (asCorrection)
+                {
+                    const ElemType* snapshot = m_snapshot.data() + offset;
+                    for (size_t i = 0; i < numElements; i++)
+                        average[i] -= snapshot[i];
+                    if (!m_correction)
+                        m_correction = make_shared<Matrix<ElemType>>(value.GetDeviceId());
+                    m_correction->SetValue(value.GetNumRows(), value.GetNumCols(), value.GetDeviceId(), average);
+                    Matrix<ElemType>::ScaleAndAdd((ElemType)1, *m_correction, value);
+                }
+                else
+                {
+                    value.SetValue(value.GetNumRows(), value.GetNumCols(), value.GetDeviceId(), average);
+                }
+                offset += numElements;
+            }
+        }
+
+        std::vector<ElemType>             m_snapshot;   // the local models sent at the last sync point
+        std::vector<ElemType>             m_buffer;     // their weighted sum over all workers, once the exchange completed
+        shared_ptr<Matrix<ElemType>>      m_correction; // device copy of a correction
+        MPI_Request                       m_pendingRequest;
+        bool                              m_hasPendingAggregation;
+        bool                              m_isEpochEnding;
+        Timer                             m_overlapTimer;
+    };
+
 } } }
@@ -13,8 +13,11 @@
 #include "NonlinearityNodes.h"          // for DropoutNode
 #include "SpecialPurposeNodes.h"        // for SequenceWithSoftmaxNode
 #include "DataReaderHelpers.h"
+#include "LocalReplicas.h"
 #include "MatrixQuantizerImpl.h"
 #include "InputAndParamNodes.h"
+#include "ConvolutionalNodes.h"         // for ConvolutionNode
+#include "PreComputeNodes.h"            // for AggregatePreComputedStatistics()
 #include "AccumulatorAggregation.h"
 
 #ifdef CNTK_PARALLEL_TRAINING_SUPPORT
@@ -32,11 +35,16 @@
 
 #include "CNTKLibraryInternals.h"
 #include "SimpleDistGradAggregator.h"
+#include "SparseDistGradAggregator.h"
 #include "V2SimpleDistGradAggregator.h"
 #include "ProgressTracing.h"
 #include "PerformanceProfiler.h"
+#include "Metrics.h"
+#include "CUDACachingMemAllocator.h"
+#include "CUDAPageLockedMemAllocator.h"
 
 #include <map>
+#include <regex>
 #include <set>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -68,8 +76,7 @@ void SGD<ElemType>::Train(shared_ptr<ComputationNetwork> net, DEVICEID_TYPE devi
     else
         fprintf(stderr, "GPU %d.\n", (int) net->GetDeviceId());
 
-    // TODO: BUGBUG: if not starting from checkpoint, need to synchronize initial model
-    // strategy should be to run the initializer above on mpiRank==0, and then broadcast parameters.
+    // Note: if not starting from a checkpoint, TrainOrAdaptModel() broadcasts the initial model of the main node to all workers.
 
     startEpoch = max(startEpoch, 0);
     m_needAdaptRegularization = false;
@@ -202,6 +209,39 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                                       IDataReader* trainSetDataReader,
                                       IDataReader* validationSetDataReader)
 {
+    if (m_hoistLoopInvariants)
+    {
+        size_t numRewritten = net->HoistLoopInvariantTerms<ElemType>();
+        LOGPRINTF(stderr, "hoistLoopInvariants: the loop-invariant terms of %d nodes were moved out of recurrent loops.\n", (int) numRewritten);
+    }
+    if (m_fuseRecurrentCells)
+    {
+        size_t numFused = net->FuseRecurrentCells<ElemType>();
+        LOGPRINTF(stderr, "fuseRecurrentCells: %d element-wise nodes of recurrent cells were fused away.\n", (int) numFused);
+    }
+    if (!m_pipelineDevices.empty())
+    {
+        if (GetParallelizationMethod() != ParallelizationMethod::none)
+            InvalidArgument("pipelineDevices cannot be combined with parallel training.");
+        let& roots = GetTrainCriterionNodes(net);
+        if (!roots.empty())
+        {
+            vector<DEVICEID_TYPE> stageDevices(m_pipelineDevices.begin(), m_pipelineDevices.end());
+            vector<wstring> lastNodesOfStages(m_pipelineStageLastNodes.begin(), m_pipelineStageLastNodes.end());
+            size_t numTransfers = net->PartitionIntoPipelineStages<ElemType>(roots[0], stageDevices, lastNodesOfStages, m_modelPath + L".pipeline.tmp");
+            LOGPRINTF(stderr, "pipelineDevices: the network was partitioned into %d stages, connected by %d device transfers.\n", (int) stageDevices.size(), (int) numTransfers);
+        }
+    }
+    if (!m_localDevices.empty() || m_localThreads > 1)
+    {
+        if (!m_localDevices.empty() && m_localThreads > 1)
+            InvalidArgument("localDevices cannot be combined with localThreads.");
+        if (GetParallelizationMethod() != ParallelizationMethod::none || !m_pipelineDevices.empty())
+            InvalidArgument("localDevices and localThreads cannot be combined with parallel training or pipelineDevices.");
+        if (m_needAdaptRegularization)
+            InvalidArgument("localDevices and localThreads cannot be combined with adaptation regularization.");
+    }
+
     let& criterionNodes = GetTrainCriterionNodes(net);
 
     fprintf(stderr, "\n");
@@ -278,6 +318,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
     additionalNodesToEvaluate.insert(additionalNodesToEvaluate.end(), preComputeNodesList.cbegin(), preComputeNodesList.cend());
 
     // allocate memory for forward and backward computation
+    net->SetValueOffload(m_offloadActivationsLargerThan, m_offloadBandwidthRatio);
     net->AllocateAllMatrices(evaluationNodes, additionalNodesToEvaluate, criterionNodes[0]); // TODO: use criterionNodes.front() throughout
 
     // get feature and label nodes into an array of matrices that will be passed to GetMinibatch()
@@ -332,27 +373,44 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
     // initializing weights and gradient holder
     // only one criterion so far TODO: support multiple ones?
     auto& learnableNodes = net->LearnableParameterNodes(criterionNodes[0]);
+    if (m_contiguousGradients)
+    {
+        size_t numContiguous = net->AllocateContiguousGradients<ElemType>(learnableNodes);
+        LOGPRINTF(stderr, "Placed the gradients of %d of %d parameter tensors into a single matrix.\n", (int) numContiguous, (int) learnableNodes.size());
+    }
     list<Matrix<ElemType>> smoothedGradients;
     vector<double> smoothedCounts; // currently used by FSAdaGradUpdate()
     size_t numParameters = 0;
 
     vector<wstring> nodesToUpdateDescriptions; // for logging only
+    m_sparsityMasks.clear();
+    m_offloadedParameters.clear();
     for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++)
     {
         ComputationNodePtr node = dynamic_pointer_cast<ComputationNode<ElemType>>(*nodeIter);
         // Note: We don't actually need the smoothedGradients if !IsParameterUpdateRequired().
         // However, this is hard to fix since lots of code assumes smoothedGradients to be in the same order as learnableNodes.
         // V2 API fixes this.
+        bool offloadOptimizerState = OffloadsOptimizerState(node);
         smoothedGradients.push_back(Matrix<ElemType>(node->Value().GetNumRows(),
                                                      node->Value().GetNumCols(),
-                                                     net->GetDeviceId()));
+                                                     offloadOptimizerState ? CPUDEVICE : node->GetDeviceId()));
         smoothedCounts.push_back(0);
         if (node->IsParameterUpdateRequired())
         {
             nodesToUpdateDescriptions.push_back(node->NodeDescription() + L" : [" + msra::strfun::utf16(string(node->GetSampleLayout())) + L"]");
             numParameters += node->GetSampleLayout().GetNumElements();
+            if (m_keepParameterSparsity)
+                CreateSparsityMask(node);
+            if (offloadOptimizerState)
+                CreateOffloadedParameter(node);
         }
     }
+    if (m_keepParameterSparsity)
+        LOGPRINTF(stderr, "Keeping the zeros of %d parameter tensors at zero.\n", (int) m_sparsityMasks.size());
+    if (!m_offloadedParameters.empty())
+        LOGPRINTF(stderr, "Keeping the optimizer state of %d parameter tensors in host memory, updating them on the %s.\n",
+                  (int) m_offloadedParameters.size(), m_offloadedUpdateOnCPU ? "CPU" : "GPU");
     size_t numNeedsGradient = 0;
     for (let node : net->GetEvalOrder(criterionNodes[0]))
     {
@@ -407,6 +465,10 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         InitModelAggregationHandler(m_syncStatsTrace, net->GetDeviceId());
     }
 
+    // start all workers from the model of the main node, unless they all loaded the same checkpoint
+    if (m_mpi != nullptr && m_mpi->NumNodesInUse() > 1 && !networkLoadedFromCheckpoint)
+        BroadcastInitialModel(net, learnableNodes);
+
     // precompute mean and invStdDev nodes and save initial model
     // When no precompute, only save if we did not load the model from a 
     // checkpoint but instead built it from a network description
@@ -423,6 +485,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         // the parallel training nodes from colliding to write the same file
         if ((m_mpi == nullptr) || m_mpi->IsMainNode())
             net->Save(GetModelNameForEpoch(int(startEpoch) - 1));
+        net->SaveShards(GetModelNameForEpoch(int(startEpoch) - 1));
     }
 
     if (m_saveBestModelPerCriterion)
@@ -496,10 +559,27 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                                          m_adjustCoefficient,
                                          m_adjustPerMinibatches,
                                          m_traceLevel,
-                                         m_syncStatsTrace));
+                                         m_syncStatsTrace,
+                                         m_useNativeParameterServer,
+                                         m_maxStaleness,
+                                         m_mpi));
         m_pASGDHelper->InitModel(learnableNodes);
     }
 
+    // replicate the network onto the other GPUs, or CPU threads, of this process
+    m_localReplicas.reset();
+    if (!m_localDevices.empty() || m_localThreads > 1)
+    {
+        if (isSequenceTrainingCriterion)
+            InvalidArgument("localDevices and localThreads cannot be used with sequence training.");
+        vector<DEVICEID_TYPE> localDevices(m_localDevices.begin(), m_localDevices.end());
+        if (m_localThreads > 1)
+            localDevices.assign(m_localThreads, CPUDEVICE);
+        m_localReplicas = make_shared<LocalReplicas<ElemType>>(net, localDevices, criterionNodes[0], evaluationNodes,
+                                                               m_maxTempMemSizeInSamplesForCNN, m_offloadActivationsLargerThan, m_offloadBandwidthRatio,
+                                                               m_modelPath + L".replica.tmp");
+    }
+
     // Create TensorBoard writer if needed. When using parallel training, make sure that only Rank 0 actually writes logs.
     ::CNTK::Internal::TensorBoardFileWriterPtr tensorBoardWriter;
     if (!m_tensorBoardLogDir.empty() && (m_mpi == nullptr || m_mpi->CurrentNodeRank() == 0))
@@ -507,8 +587,21 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         tensorBoardWriter = make_shared<::CNTK::Internal::TensorBoardFileWriter>(m_tensorBoardLogDir, net);
     }
 
+    if (m_metricsHttpPort > 0)
+        MetricsStartHttpEndpoint(m_metricsHttpPort + (m_mpi ? (int)m_mpi->CurrentNodeRank() : 0));
+
+    // With a learning-rate search or rollback, all workers read the models of earlier epochs, possibly before the main
+    // node has finished writing them in the background.
+    bool asyncModelSave = m_asyncModelSave || m_deltaCheckpoints;
+    if (asyncModelSave && m_mpi && m_mpi->NumNodesInUse() > 1 && m_autoLearnRateSearchType != LearningRateSearchAlgorithm::None)
+    {
+        LOGPRINTF(stderr, "asyncModelSave: models are saved synchronously, since the learning-rate search of parallel training reads them on all workers.\n");
+        asyncModelSave = false;
+    }
+
     // --- MAIN EPOCH LOOP
     for (int i = startEpoch; i < (int) m_maxEpochs; i++) // TODO: why is this an int, and not a size_t?
+    try
     {
         // Always skip the first epoch for profiling to avoid startup behavior.
         // This has effect only if the profiler is globally enabled (profilerEnabled="true" in the config).
@@ -517,6 +610,9 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
             ProfilerEnable(true);
         }
 
+        if (m_elasticTraining)
+            SaveElasticTrainingState(learnableNodes, smoothedGradients, smoothedCounts, prevCriterion);
+
         // Synchronize all ranks before proceeding to ensure that
         // rank 0 has finished writing the previous model file
         SynchronizeWorkers();
@@ -541,6 +637,11 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         ComputationNetwork::SetBatchNormalizationTimeConstants<ElemType>(net, criterionNodes[0], 
                                                                          m_batchNormalizationTimeConstant[i], prevNormalizationTimeConstant,
                                                                          m_batchNormalizationBlendTimeConstant[i], prevNormalizationBlendTimeConstant);
+        if (m_syncBatchNormalization)
+            ComputationNetwork::SetBatchNormalizationSyncWorkers<ElemType>(net, criterionNodes[0],
+                                                                           UsingParallelTrain(i) && GetParallelizationMethod() == ParallelizationMethod::dataParallelSGD ? m_mpi : nullptr);
+        if (m_localReplicas)
+            m_localReplicas->StartEpoch(i, m_maxEpochs, m_dropoutRates[i], m_batchNormalizationTimeConstant[i], m_batchNormalizationBlendTimeConstant[i]);
         
         // learning rate adjustment
         if (m_autoLearnRateSearchType == LearningRateSearchAlgorithm::None || i < m_learningRatesParam.size())
@@ -581,10 +682,19 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                 // the parallel training nodes from colliding to write the same file
                 if ((m_mpi == nullptr) || m_mpi->IsMainNode())
                     net->Save(m_modelPath);
+                net->SaveShards(m_modelPath);
             }
             break;
         }
 
+        // measure the speed of the candidate minibatch sizes and workspace limits once, before the first epoch
+        if (m_autoTuneThroughput && i == startEpoch)
+        {
+            m_throughputTunedMinibatchSize = TuneForThroughput(net, refNet, refNode, i, trainSetDataReader, learnRatePerSample,
+                                                               featureNodes, labelNodes, criterionNodes, evaluationNodes,
+                                                               inputMatrices, learnableNodes, smoothedGradients, smoothedCounts);
+        }
+
         size_t chosenMinibatchSize;
         size_t actualMinibatchSize;
 
@@ -613,6 +723,11 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                 LOGPRINTF(stderr, "Minibatch size adapted to %d.\n", (int)chosenMinibatchSize);
             m_prevChosenMinibatchSize = chosenMinibatchSize;
         }
+        else if (m_throughputTunedMinibatchSize != 0)
+        {
+            // use the minibatch size chosen by TuneForThroughput()
+            chosenMinibatchSize = m_throughputTunedMinibatchSize;
+        }
         else
         {
             // use the explicitly set minibatch size
@@ -660,6 +775,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                                       epochCriterion, epochEvalErrors,
                                       "", SIZE_MAX, totalMBsSeen, tensorBoardWriter);
         totalTrainingSamplesSeen += epochCriterion.second; // aggregate #training samples, for logging purposes only
+        ProfilerNodeSummary(msra::strfun::strprintf("Epoch[%2d of %d]", i + 1, (int)m_maxEpochs)); // (only if node profiling is on)
 
         timer.Stop();
         double epochTime = timer.ElapsedSeconds();
@@ -810,6 +926,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                         // the parallel training nodes from colliding to write the same file
                         if ((m_mpi == nullptr) || m_mpi->IsMainNode())
                             net->Save(GetModelNameForEpoch(i, true));
+                        net->SaveShards(GetModelNameForEpoch(i, true));
 
                         LOGPRINTF(stderr, "Finished training and saved final model\n\n");
                         break;
@@ -897,9 +1014,10 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                 auto modelName = GetModelNameForEpoch(i);
                 if (m_traceLevel > 0)
                     LOGPRINTF(stderr, "SGD: Saving checkpoint model '%ls'\n", modelName.c_str());
-                net->Save(modelName);
-                if (!m_keepCheckPointFiles)
+                auto deletePreviousCheckPointFiles = [this, i, epochsSinceLastLearnRateAdjust]()
                 {
+                    if (m_keepCheckPointFiles)
+                        return;
                     // delete previous checkpoint file to save space
                     if (m_autoLearnRateSearchType == LearningRateSearchAlgorithm::AdjustAfterEpoch && m_loadBestModel)
                     {
@@ -916,7 +1034,19 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                     {
                         _wunlink(GetCheckPointFileNameForEpoch(i - 1).c_str());
                     }
+                };
+                if (asyncModelSave)
+                {
+                    // The previous checkpoint files are only deleted once the model has been written, so that
+                    // there always is a complete checkpoint to restart from. The final model is always a full one.
+                    net->SaveAsync(modelName, m_deltaCheckpoints && modelName != m_modelPath, deletePreviousCheckPointFiles);
+                }
+                else
+                {
+                    net->Save(modelName);
+                    deletePreviousCheckPointFiles();
                 }
+                net->SaveShards(modelName);
             }
         }
         else
@@ -926,6 +1056,8 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                 // Set i back to the loaded model
                 i -= m_learnRateAdjustInterval;
             }
+            else
+                net->SaveShards(GetModelNameForEpoch(i)); // (each worker saves its own shards)
         }
 
         if (learnRatePerSample < 1e-12)
@@ -934,8 +1066,21 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                       learnRatePerSample);
         }
     }
+    catch (const MpiProcessFailure& failure)
+    {
+        if (!m_elasticTraining)
+            throw;
+
+        net->WaitForAsyncSave(); // the recovery may read the model of the last epoch
+
+        // continue with the surviving workers from the start of the earliest epoch any of them is in
+        i = RecoverFromWorkerFailure(i, failure, learnableNodes, smoothedGradients, smoothedCounts, prevCriterion) - 1;
+        currentNumGradientBits = 0; // (re-)initializes the gradient aggregation for the new number of workers
+    }
     // --- END OF MAIN EPOCH LOOP
 
+    net->WaitForAsyncSave();
+
     // Check if we need to save best model per criterion and this is the main node as well.
     if (m_saveBestModelPerCriterion && ((m_mpi == nullptr) || m_mpi->IsMainNode()))
     {
@@ -965,6 +1110,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
     delete inputMatrices;
     if (m_parallelizationMethod == ParallelizationMethod::dataParallelASGD)
         m_pASGDHelper.reset();
+    m_localReplicas.reset();
 }
 
 // -----------------------------------------------------------------------
@@ -1032,6 +1178,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
     }
 
     std::vector<Matrix<ElemType>*> learnParamsGradients;
+    std::map<ComputationNodeBasePtr, size_t> learnParamsGradientIndices; // [node] -> index into learnParamsGradients
     Profiler profiler(m_numMBsToCUDAProfile);
 
     // resetting this, so profiling is performed for one epoch only
@@ -1063,8 +1210,23 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
     size_t numSubminibatchesNeeded = DataReaderHelpers::GetNumSubminibatchesNeeded<ElemType>(trainSetDataReader, m_maxSamplesInRAM, m_numSubminiBatches, tunedMBSize);
 
     // this is non-trivial, we need a manager object to handle this
-    if (numSubminibatchesNeeded > 1)
+    bool smbDispatcherInitialized = numSubminibatchesNeeded > 1;
+    if (smbDispatcherInitialized)
         smbDispatcher.Init(net, learnableNodes, criterionNodes, evaluationNodes);
+    int numOutOfMemorySplits = 0; // minibatches that ran out of GPU memory and were split into subminibatches (autoSubminibatches)
+
+    // the replicas on the other GPUs of this process start from the current model (which a learning-rate search may have reloaded)
+    if (m_localReplicas)
+    {
+        if (numSubminibatchesNeeded > 1)
+            InvalidArgument("TrainOneEpoch: localDevices and localThreads cannot be combined with sub-minibatches.");
+        m_localReplicas->CopyParametersToReplicas(/*allParameters=*/true);
+    }
+
+    // the parameter shards of sharded nodes (ShardedEmbedding, TensorParallelTimes), whose workers exchange data in every minibatch
+    auto shardedParameters = useParallelTrain ? net->GetShardedParameters() : vector<ComputationNodeBasePtr>();
+    if (!shardedParameters.empty() && (!useGradientAggregation || numSubminibatchesNeeded > 1 || m_localReplicas))
+        InvalidArgument("TrainOneEpoch: Sharded parameters are only supported with data-parallel SGD without sub-minibatches and localDevices.");
 
     // The following is a special feature only supported by the Kaldi2Reader for more efficient sequence training.
     // This attemps to compute the error signal for the whole utterance, which will
@@ -1117,10 +1279,12 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
     // NOTE: the following two local matrices are not used in distGradAgg path
     // assume only one training criterion node for each epoch.
     // The criterion values are accumulated here over the minibatches (without having to pull them off the GPU).
-    CriterionAccumulator<ElemType> localEpochCriterion(criterionNodes, net->GetDeviceId());
+    // (on the device of the criterion nodes, which differs from the network's if it is partitioned into pipeline stages)
+    CriterionAccumulator<ElemType> localEpochCriterion(criterionNodes, criterionNodes[0]->GetDeviceId());
     CriterionAccumulator<ElemType> localEpochEvalErrors(
-        evaluationNodes, net->GetDeviceId(),
+        evaluationNodes, evaluationNodes.empty() ? net->GetDeviceId() : evaluationNodes.front()->GetDeviceId(),
         {evaluationNodesWhichAccumulateResult.begin(), evaluationNodesWhichAccumulateResult.end()});
+    vector<EpochCriterion> localEvalErrors; // the eval errors of one minibatch (distGradAgg path)
 
     // --- MAIN MINIBATCH LOOP
 
@@ -1130,6 +1294,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
 
     EpochCriterion         tensorBoardEpochCriterionLastLogged = epochCriterion;
     vector<EpochCriterion> tensorBoardEpochEvalErrorsLastLogged = epochEvalErrors;
+    map<string, MetricValue> tensorBoardMetricsLastLogged;
 
     // NOTE: For ResNet, the regularization in BatchNormalization should be disabled.
     if (m_disableRegInBatchNormalization) {
@@ -1167,8 +1332,11 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
         size_t actualMBSize = 0;
 
         auto profGetMinibatch = ProfilerTimeBegin();
+        auto rangeGetMinibatch = ProfilerRangePush(profilerEvtMainGetMinibatch); // (NVTX ranges, if on)
         bool wasDataRead = DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(*trainSetDataReader, net, criterionNodes[0],
                                                                                 useDistributedMBReading, useParallelTrain, *inputMatrices, actualMBSize, m_mpi);
+        if (rangeGetMinibatch)
+            ProfilerRangePop();
 
         if (maxNumSamplesExceeded) // Dropping data.
             wasDataRead = false;
@@ -1187,6 +1355,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
 
         ProfilerTimeEnd(profGetMinibatch, profilerEvtMainGetMinibatch);
         auto profForwardBackward = ProfilerTimeBegin();
+        auto rangeForwardBackward = ProfilerRangePush(profilerEvtMainFB);
 
         nSamplesSinceLastModelSync += actualMBSize;
 
@@ -1228,40 +1397,109 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
 
             // do forward and back propagation
 
+            // With local replicas, the main network only computes its share of the minibatch, while the replicas compute the others.
+            bool computeGradient = learnRatePerSample > 0.01 * m_minLearnRate;
+            if (m_localReplicas)
+                m_localReplicas->StartMinibatch(net, *inputMatrices, computeGradient);
+
             // We optionally break the minibatch into sub-minibatches.
             // This, when enabled, is used when a full minibatch does not fit into GPU RAM.
-            size_t actualNumSubminibatches = numSubminibatchesNeeded <= 1 ? 1 : smbDispatcher.GetMinibatchIntoCache(*trainSetDataReader, *net, *inputMatrices, numSubminibatchesNeeded);
-            for (size_t ismb = 0; ismb < actualNumSubminibatches; ismb++)
+            // With autoSubminibatches, a minibatch that runs out of GPU memory is split (further) and computed again.
+            size_t numSubminibatchesOfMinibatch = numSubminibatchesNeeded;
+            for (;;)
             {
-                if (actualNumSubminibatches > 1)
+                size_t actualNumSubminibatches = 1;
+                bool gradientsReported = false; // (once the aggregator has started on the gradients, the minibatch cannot be computed again)
+                try
                 {
-                    smbDispatcher.GetSubMinibatchToNet(ismb); // get sub-minibatch from full-size one
-                    ComputationNetwork::BumpEvalTimeStamp(featureNodes);
-                    ComputationNetwork::BumpEvalTimeStamp(labelNodes);
-                }
+                    if (numSubminibatchesOfMinibatch > 1)
+                        actualNumSubminibatches = smbDispatcher.GetMinibatchIntoCache(*trainSetDataReader, *net, *inputMatrices, numSubminibatchesOfMinibatch);
+                    for (size_t ismb = 0; ismb < actualNumSubminibatches; ismb++)
+                    {
+                        if (actualNumSubminibatches > 1)
+                        {
+                            smbDispatcher.GetSubMinibatchToNet(ismb); // get sub-minibatch from full-size one
+                            ComputationNetwork::BumpEvalTimeStamp(featureNodes);
+                            ComputationNetwork::BumpEvalTimeStamp(labelNodes);
+                        }
 
-                // ===========================================================
-                // forward prop for evaluate eval nodes
-                // ===========================================================
+                        // ===========================================================
+                        // forward prop for evaluate eval nodes
+                        // ===========================================================
 
-                // compute eval node first since when gradient is computed the forward function values
-                // may be changed and need to be recomputed when gradient and function value share the same matrix
-                net->ForwardProp(forwardPropRoots); // the bulk of this evaluation is reused in ComputeGradient() below
+                        // compute eval node first since when gradient is computed the forward function values
+                        // may be changed and need to be recomputed when gradient and function value share the same matrix
+                        net->ForwardProp(forwardPropRoots); // the bulk of this evaluation is reused in ComputeGradient() below
 
-                // ===========================================================
-                // backprop
-                // ===========================================================
+                        // ===========================================================
+                        // backprop
+                        // ===========================================================
 
-                if (learnRatePerSample > 0.01 * m_minLearnRate) // only compute gradient when learning rate is large enough
-                    net->Backprop(criterionNodes[0]);
+                        if (computeGradient) // only compute gradient when learning rate is large enough
+                        {
+                            // Let the aggregator start on the gradients that are final while backprop continues.
+                            // With sub-minibatches, the gradients are only final in the last one.
+                            if (useGradientAggregation && !learnParamsGradients.empty() && m_distGradAgg->SupportsOverlappedAggregation() && ismb + 1 == actualNumSubminibatches)
+                            {
+                                net->Backprop(criterionNodes[0], [&](const ComputationNodeBasePtr& node)
+                                {
+                                    auto iter = learnParamsGradientIndices.find(node);
+                                    if (iter != learnParamsGradientIndices.end())
+                                    {
+                                        gradientsReported = true;
+                                        m_distGradAgg->GradientReady(iter->second);
+                                    }
+                                });
+                            }
+                            else
+                                net->Backprop(criterionNodes[0]);
+                        }
 
-                // house-keeping for sub-minibatching
-                if (actualNumSubminibatches > 1)
-                    smbDispatcher.DoneWithCurrentSubMinibatch(ismb); // page state out
-            }                                                        // end sub-minibatch loop
-            if (actualNumSubminibatches > 1)
-                smbDispatcher.DoneWithCurrentMinibatch();
+                        // house-keeping for sub-minibatching
+                        if (actualNumSubminibatches > 1)
+                            smbDispatcher.DoneWithCurrentSubMinibatch(ismb); // page state out
+                    }                                                        // end sub-minibatch loop
+                    if (actualNumSubminibatches > 1)
+                        smbDispatcher.DoneWithCurrentMinibatch();
+                    break;
+                }
+                catch (const DeviceOutOfMemoryError& e)
+                {
+                    if (!m_autoSubminibatches || m_truncated || m_localReplicas || !shardedParameters.empty() || gradientsReported)
+                        throw;
+
+                    if (actualNumSubminibatches > 1)
+                        smbDispatcher.RevertToFullMinibatch();
+
+                    // a subminibatch consists of whole parallel sequences, see GetMinibatchIntoCache()
+                    size_t numParallelSequences = net->GetMBLayoutPtrOfNetwork()->GetNumParallelSequences();
+                    size_t numSubminibatches = min(max((size_t)2, 2 * actualNumSubminibatches), min(numParallelSequences, m_maxAutoSubminibatches));
+                    if (numSubminibatches <= actualNumSubminibatches)
+                        throw; // cannot split any further
+
+                    if (!smbDispatcherInitialized)
+                    {
+                        smbDispatcher.Init(net, learnableNodes, criterionNodes, evaluationNodes);
+                        smbDispatcherInitialized = true;
+                    }
+
+                    LOGPRINTF(stderr, "WARNING: Minibatch %d ran out of GPU memory in %d subminibatches (%s), computing it again in %d subminibatches.\n",
+                              numMBsRun + 1, (int)actualNumSubminibatches, e.what(), (int)numSubminibatches);
+                    MetricsCounterAdd("cntk_out_of_memory_splits_total");
+                    numSubminibatchesOfMinibatch = numSubminibatches;
+                    numOutOfMemorySplits++;
+                }
+            }
+            if (m_localReplicas)
+                m_localReplicas->FinishMinibatch(net, computeGradient);
         } // if (actualMBSize > 0)
+        else if (useGradientAggregation && !shardedParameters.empty())
+        {
+            // the sharded nodes of the other workers still need this worker's shards
+            net->ForwardPropShardedNodesWithoutLocalData(forwardPropRoots);
+            if (learnRatePerSample > 0.01 * m_minLearnRate)
+                net->BackpropShardedNodesWithoutLocalData(criterionNodes[0]);
+        }
         // WARNING: If actualMBSize == 0, then criterion nodes have NOT been updated, and contain garbage (last MB's) values.
 
         // In case of mini epochs (used for adaptive minibatch size and learning rate),
@@ -1272,8 +1510,11 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
                 maxNumSamplesExceeded = true;
         }
 
+        if (rangeForwardBackward)
+            ProfilerRangePop();
         ProfilerTimeEnd(profForwardBackward, profilerEvtMainFB);
         auto profGradientAgg = ProfilerTimeBegin();
+        auto rangeGradientAgg = ProfilerRangePush(profilerEvtMainGradient);
 
         // for momentum/clipping/regularization/etc., as well as for progress and statistics, we should only count frames that are not gaps
         // #samples according to the default dynamic axis, for use with criterion nodes that do not have an MBLayout
@@ -1306,7 +1547,8 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
                 for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++)
                 {
                     ComputationNodePtr node = dynamic_pointer_cast<ComputationNode<ElemType>>(*nodeIter);
-                    if (node->IsParameterUpdateRequired())
+                    // the gradients of sharded parameters are complete on each worker and differ between them
+                    if (node->IsParameterUpdateRequired() && find(shardedParameters.begin(), shardedParameters.end(), *nodeIter) == shardedParameters.end())
                     {
                         Matrix<ElemType>* currParamsGradient = &(node->Gradient()); // TODO: we can use shared_ptrs now
 
@@ -1318,6 +1560,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
                             currParamsGradient->Resize(currParamsValues->GetNumRows(), currParamsValues->GetNumCols());
                         }
 
+                        learnParamsGradientIndices[*nodeIter] = learnParamsGradients.size();
                         learnParamsGradients.push_back(currParamsGradient);
                     }
                 }
@@ -1330,16 +1573,20 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
 
             // copy all values to be aggregated into the header
             m_gradHeader->numSamples = aggregateNumSamples;
-            m_gradHeader->criterion           = localEpochCriterion.GetCriterion(0).first;
-            m_gradHeader->numSamplesWithLabel = localEpochCriterion.GetCriterion(0).second; // same as aggregateNumSamplesWithLabel
+            let localCriterion = localEpochCriterion.GetCriterion(0);
+            m_gradHeader->criterion           = localCriterion.first;
+            m_gradHeader->numSamplesWithLabel = localCriterion.second; // same as aggregateNumSamplesWithLabel
             assert(m_gradHeader->numSamplesWithLabel == aggregateNumSamplesWithLabel);
+            localEpochEvalErrors.GetCriteria(localEvalErrors);
             for (size_t i = 0; i < evaluationNodes.size(); i++)
-                m_gradHeader->evalErrors[i] = localEpochEvalErrors.GetCriterion(i);
+                m_gradHeader->evalErrors[i] = localEvalErrors[i];
 
             // aggregate
             m_gradHeader->numEvalNode = evaluationNodes.size(); // TODO: rename numEvalNode (plural)
             bool samplesProcessed = m_distGradAgg->AggregateGradients(learnParamsGradients, m_gradHeader.get(), isFirstMinibatch);
             noMoreSamplesToProcess = !samplesProcessed;
+            if (!shardedParameters.empty())
+                net->AggregateShardGradients();
 
             // read out the header--now everything is aggregated
             aggregateNumSamples          = m_gradHeader->numSamples;
@@ -1363,8 +1610,11 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
             }
         }
 
+        if (rangeGradientAgg)
+            ProfilerRangePop();
         ProfilerTimeEnd(profGradientAgg, profilerEvtMainGradient);
         auto profWeights = ProfilerTimeBegin();
+        auto rangeWeights = ProfilerRangePush(profilerEvtMainWeights);
 
         // update model parameters
         if ((aggregateNumSamples > 0) && (learnRatePerSample > m_minLearnRate * 0.01))
@@ -1379,36 +1629,66 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
             if (numSamplesInMinibatch != aggregateNumSamples)
                 fprintf(stderr, "SGD: using true #samples %d instead of MB size %d\n", (int)numSamplesInMinibatch, (int)aggregateNumSamples);
 #endif
-            auto smoothedGradientIter = smoothedGradients.begin();
-            auto smoothedCountIter = smoothedCounts.begin();
-            for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++, smoothedGradientIter++, smoothedCountIter++)
+            // The parameters with offloaded optimizer state are updated last, so that the transfers of their values and
+            // gradients to the host overlap with the updates of the others on the GPU.
+            if (!m_offloadedParameters.empty())
+                StartOffloadedWeightUpdates();
+            for (bool offloaded : { false, true })
             {
-                ComputationNodeBasePtr node = *nodeIter;
-                if (node->IsParameterUpdateRequired())
+                if (offloaded && m_offloadedParameters.empty())
+                    break;
+                if (offloaded)
+                    WaitForOffloadedCopies();
+                auto smoothedGradientIter = smoothedGradients.begin();
+                auto smoothedCountIter = smoothedCounts.begin();
+                for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++, smoothedGradientIter++, smoothedCountIter++)
                 {
+                    ComputationNodeBasePtr node = *nodeIter;
+                    if (node->IsParameterUpdateRequired() && (m_offloadedParameters.find(node) != m_offloadedParameters.end()) == offloaded)
+                    {
 #ifdef _DEBUG
-                    if (smoothedGradientIter->HasNan("TrainOneEpoch/UpdateWeights(): "))
-                        LogicError("%ls %ls operation has NaNs in smoothedGradient.", node->NodeName().c_str(), node->OperationName().c_str());
+                        if (smoothedGradientIter->HasNan("TrainOneEpoch/UpdateWeights(): "))
+                            LogicError("%ls %ls operation has NaNs in smoothedGradient.", node->NodeName().c_str(), node->OperationName().c_str());
 #endif
-                    double nodeDependentLearningRatePerSample = learnRatePerSample * node->GetLearningRateMultiplier();
-                    double nodeDependentRegMultiplier = dynamic_pointer_cast<LearnableParameter<ElemType>>(node)->GetRegMultiplier();
-                    double momentumPerSample = GetMomentumPerSample(epochNumber /*BUGBUG workaround:*/, net->GetMBLayoutPtrOfNetwork()->GetNumParallelSequences());
-                    // TODO: Check why l2Factor is not applied to L1. Bug?
-                    // BUGBUG (Issue #95): Access to net MBLayout can no longer be done if we have multiple input layouts
-                    UpdateWeights(dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value(),
-                                  dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Gradient(),
-                                  *smoothedGradientIter, *smoothedCountIter,
-                                  nodeDependentLearningRatePerSample, momentumPerSample,
-                                  numSamplesInMinibatch,
-                                  m_L2RegWeight * nodeDependentRegMultiplier, m_L1RegWeight * nodeDependentRegMultiplier,
-                                  m_needAveMultiplier, m_useNesterovMomentum);
-                    node->BumpEvalTimeStamp();
+                        double nodeDependentLearningRatePerSample = learnRatePerSample * node->GetLearningRateMultiplier();
+                        double nodeDependentRegMultiplier = dynamic_pointer_cast<LearnableParameter<ElemType>>(node)->GetRegMultiplier();
+                        double momentumPerSample = GetMomentumPerSample(epochNumber /*BUGBUG workaround:*/, net->GetMBLayoutPtrOfNetwork()->GetNumParallelSequences());
+                        // TODO: Check why l2Factor is not applied to L1. Bug?
+                        // BUGBUG (Issue #95): Access to net MBLayout can no longer be done if we have multiple input layouts
+                        if (offloaded)
+                            UpdateOffloadedWeights(node, *smoothedGradientIter, *smoothedCountIter,
+                                                   nodeDependentLearningRatePerSample, momentumPerSample,
+                                                   numSamplesInMinibatch,
+                                                   m_L2RegWeight * nodeDependentRegMultiplier, m_L1RegWeight * nodeDependentRegMultiplier);
+                        else
+                            UpdateWeights(dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value(),
+                                          dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Gradient(),
+                                          *smoothedGradientIter, *smoothedCountIter,
+                                          nodeDependentLearningRatePerSample, momentumPerSample,
+                                          numSamplesInMinibatch,
+                                          m_L2RegWeight * nodeDependentRegMultiplier, m_L1RegWeight * nodeDependentRegMultiplier,
+                                          m_needAveMultiplier, m_useNesterovMomentum);
+                        node->BumpEvalTimeStamp();
+                    }
+                }
+            }
+            if (!m_offloadedParameters.empty())
+                FinishOffloadedWeightUpdates();
+
+            for (auto& node : learnableNodes)
+            {
+                if (node->IsParameterUpdateRequired())
+                {
+                    ApplySparsityMask(node);
 #ifdef _DEBUG
                     if (dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value().HasNan("TrainOneEpoch/UpdateWeights(): "))
                         LogicError("%ls %ls operation has NaNs in functionValues after parameter update.", node->NodeName().c_str(), node->OperationName().c_str());
 #endif
                 }
             }
+
+            if (m_localReplicas)
+                m_localReplicas->CopyParametersToReplicas(/*allParameters=*/false);
         }
 
 
@@ -1447,6 +1727,8 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
         }
 
 
+        if (rangeWeights)
+            ProfilerRangePop();
         ProfilerTimeEnd(profWeights, profilerEvtMainWeights);
         auto profPost = ProfilerTimeBegin();
 
@@ -1455,6 +1737,11 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
         numMBsRun++;
         totalTimeInMBs += timer.ElapsedSeconds();
 
+        // live metrics (see Metrics.h)
+        MetricsCounterAdd("cntk_minibatches_total");
+        MetricsCounterAdd("cntk_samples_total", (double)aggregateNumSamplesWithLabel);
+        MetricsHistogramObserve("cntk_minibatch_seconds", timer.ElapsedSeconds());
+
         bool progressPrintNeeded = numMBsRun <= m_firstMBsToShowResult || (m_numMBsToShowResult && (numMBsRun % m_numMBsToShowResult == 0));
         bool tensorBoardWriteNeeded = tensorBoardWriter && m_tensorBoardNumMBsToLogResult && 
             ((totalMBsSeenBefore + numMBsRun) % m_tensorBoardNumMBsToLogResult == 0);
@@ -1465,8 +1752,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
             // if no aggregation, we directly get the values from the minibatch accumulators
             timer.Restart();
             epochCriterion = localEpochCriterion.GetCriterion(0);
-            for (size_t i = 0; i < epochEvalErrors.size(); i++)
-                epochEvalErrors[i] = localEpochEvalErrors.GetCriterion(i);
+            localEpochEvalErrors.GetCriteria(epochEvalErrors);
             timer.Stop();
 
             // Add the last trailing compute
@@ -1537,6 +1823,9 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
             if (wasProgressPrinted)
                 ProgressTracing::TraceTrainLoss(trainLossSinceLastLogged);
 
+            MetricsGaugeSet("cntk_samples_per_second", trainSamplesSinceLastLogged / totalTimeInMBs);
+            UpdateDeviceMemoryMetrics(net->GetDeviceId());
+
             if (m_traceLevel > 0)
                 fflush(stderr);
 
@@ -1585,6 +1874,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
                     : epochEvalErrors[i] - tensorBoardEpochEvalErrorsLastLogged[i];
                 tensorBoardWriter->WriteValue(L"minibatch/" + nodeName, (float)evalErrorSinceLastLogged.Average(), step);
             }
+            WriteMetricsToTensorBoard(*tensorBoardWriter, step, tensorBoardMetricsLastLogged);
 
             tensorBoardWriter->Flush();
 
@@ -1643,8 +1933,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
     if (!useGradientAggregation)
     {
         epochCriterion = localEpochCriterion.GetCriterion(0);
-        for (size_t i = 0; i < epochEvalErrors.size(); i++)
-            epochEvalErrors[i] = localEpochEvalErrors.GetCriterion(i);
+        localEpochEvalErrors.GetCriteria(epochEvalErrors);
     }
 
     // in case of model averaging, do one more final aggregation of criteria
@@ -1657,8 +1946,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
         // get criteria for this worker
         assert(!useGradientAggregation); // (otherwise the data would not be in localEpochCriterion)
         epochCriterion = localEpochCriterion.GetCriterion(0);
-        for (size_t i = 0; i < epochEvalErrors.size(); i++)
-            epochEvalErrors[i] = localEpochEvalErrors.GetCriterion(i);
+        localEpochEvalErrors.GetCriteria(epochEvalErrors);
 
         // all-reduce epochCriterion and epochEvalErrors over nodes
         m_mpi->AllReduce(&epochCriterion.first,  1);
@@ -1689,6 +1977,9 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
             localEpochEvalErrors, ContainsAccumulatedResult, m_packThresholdSizeInBytes);
     }
 
+    if (numOutOfMemorySplits > 0)
+        LOGPRINTF(stderr, "%d of %d minibatches ran out of GPU memory and were split into subminibatches.\n", numOutOfMemorySplits, numMBsRun);
+
     return numMBsRun;
 }
 
@@ -1701,6 +1992,44 @@ static double MomentumPerMB(double momentumPerSample, size_t minibatchSize)
     return pow(momentumPerSample, minibatchSize);
 }
 
+// set the gauges of the device memory in use, and of the GPU memory cache if it is used (see Metrics.h)
+static void UpdateDeviceMemoryMetrics(DEVICEID_TYPE deviceId)
+{
+    if (deviceId < 0)
+        return;
+
+    const double numBytesPerMB = 1 << 20;
+    auto freeAndTotalMemory = TracingGPUMemoryAllocator::GetFreeAndTotalMemoryInMBs(deviceId);
+    MetricsGaugeSet("cntk_gpu_memory_used_bytes", (freeAndTotalMemory.second - freeAndTotalMemory.first) * numBytesPerMB);
+    auto cachingAllocator = CUDACachingMemAllocator::TryGetInstance(deviceId);
+    if (cachingAllocator)
+    {
+        auto stats = cachingAllocator->GetStatistics();
+        MetricsGaugeSet("cntk_gpu_memory_cache_in_use_bytes", (double)stats.bytesInUse);
+        MetricsGaugeSet("cntk_gpu_memory_cache_cached_bytes", (double)stats.bytesCached);
+    }
+}
+
+// write the live metrics to TensorBoard under "metrics/" (see Metrics.h)
+// Histograms are written as the mean of the observations since the last call, as kept in lastLogged.
+static void WriteMetricsToTensorBoard(::CNTK::Internal::TensorBoardFileWriter& tensorBoardWriter, size_t step, map<string, MetricValue>& lastLogged)
+{
+    for (const auto& metric : MetricsSnapshot())
+    {
+        double value = metric.value;
+        if (metric.type == MetricType::Histogram)
+        {
+            auto iter = lastLogged.find(metric.name);
+            const auto numObservations = metric.count - (iter == lastLogged.end() ? 0 : iter->second.count);
+            if (numObservations == 0)
+                continue;
+            value = (metric.value - (iter == lastLogged.end() ? 0 : iter->second.value)) / numObservations;
+            lastLogged[metric.name] = metric;
+        }
+        tensorBoardWriter.WriteValue(L"metrics/" + msra::strfun::utf16(metric.name), (float)value, step);
+    }
+}
+
 template <class ElemType>
 const std::vector<ComputationNodeBasePtr>& SGD<ElemType>::GetTrainCriterionNodes(ComputationNetworkPtr net)
 {
@@ -1758,10 +2087,19 @@ bool SGD<ElemType>::PreCompute(ComputationNetworkPtr net,
     // trainSetDataReader->StartMinibatchLoop(m_mbSize[0],  0 , m_epochSize); // only based on one epoch
     // To support large dataset, we usually partition whole dataset into several epoch's,
     // so we need to use all the data to do precomputing
-    if (m_useAllDataForPreComputedNode) // using all the data
-        trainSetDataReader->StartMinibatchLoop(m_mbSize[0], 0, inputMatrices->GetStreamDescriptions());
-    else // using only one epoch. Note: One epoch is often enough for feature mean/stddev, but not for estimating priors.
-        trainSetDataReader->StartMinibatchLoop(m_mbSize[0], 0, inputMatrices->GetStreamDescriptions(), m_epochSize);
+    size_t requestedSamples = requestDataSize; // using all the data
+    if (m_numSamplesForPreComputedNode > 0) // a sample budget, taken from the (randomized) start of the data
+        requestedSamples = m_numSamplesForPreComputedNode;
+    else if (!m_useAllDataForPreComputedNode) // using only one epoch. Note: One epoch is often enough for feature mean/stddev, but not for estimating priors.
+        requestedSamples = m_epochSize;
+
+    // With distributed reading, each worker precomputes over its part of the data, and the results are merged.
+    const bool useDistributedMBReading = m_mpi && m_mpi->NumNodesInUse() > 1 && m_enableDistributedMBReading &&
+                                         trainSetDataReader->SupportsDistributedMBRead();
+    if (useDistributedMBReading)
+        trainSetDataReader->StartDistributedMinibatchLoop(m_mbSize[0], 0, m_mpi->CurrentNodeRank(), m_mpi->NumNodesInUse(), inputMatrices->GetStreamDescriptions(), requestedSamples);
+    else
+        trainSetDataReader->StartMinibatchLoop(m_mbSize[0], 0, inputMatrices->GetStreamDescriptions(), requestedSamples);
     net->StartEvaluateMinibatchLoop(nodes);
 
     // initialize
@@ -1770,9 +2108,12 @@ bool SGD<ElemType>::PreCompute(ComputationNetworkPtr net,
 
     const size_t numIterationsBeforePrintingProgress = 100;
     size_t numItersSinceLastPrintOfProgress = 0;
-    size_t actualMBSizeDummy;
-    while (DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(*trainSetDataReader, net, nullptr, false, false, *inputMatrices, actualMBSizeDummy, m_mpi))
+    size_t actualMBSize;
+    while (DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(*trainSetDataReader, net, nullptr, useDistributedMBReading, false, *inputMatrices, actualMBSize, m_mpi))
     {
+        if (actualMBSize == 0) // (a worker's share of a minibatch can be empty)
+            continue;
+
         // TODO: move these into GetMinibatchIntoNetwork()  --but those are passed around; necessary? Can't we get them from 'net'?
         ComputationNetwork::BumpEvalTimeStamp(featureNodes);
         ComputationNetwork::BumpEvalTimeStamp(labelNodes);
@@ -1782,6 +2123,9 @@ bool SGD<ElemType>::PreCompute(ComputationNetworkPtr net,
         numItersSinceLastPrintOfProgress = ProgressTracing::TraceFakeProgress(numIterationsBeforePrintingProgress, numItersSinceLastPrintOfProgress);
     }
 
+    if (useDistributedMBReading)
+        AggregatePreComputedStatistics<ElemType>(nodes, [this](std::vector<double>& values) { m_mpi->AllReduce(values); });
+
     // finalize
     for (auto & node : nodes)
         dynamic_pointer_cast<IPreComputeNode>(node)->MarkComputed(true /*done accumulating*/);
@@ -2170,6 +2514,145 @@ size_t SGD<ElemType>::SearchForBestMinibatchSize(ComputationNetworkPtr net,
     return lastGoodMinibatchSize;
 }
 
+// TuneForThroughput() -- choose the minibatch size and the workspace limit of the convolutions by measured speed
+// Unlike AdaptiveMinibatchSizing(), which looks at the criterion, this is about the speed of the hardware only:
+// every pair of candidates gets a few warm-up minibatches (which allocate the memory and run the cuDNN auto-tuner),
+// and is then timed for m_throughputTuningMinibatches minibatches. Candidates that leave more than
+// m_throughputTuningMemoryFraction of the device memory used, or fail to allocate, do not fit, and neither do larger
+// minibatch sizes after one that does not fit with any workspace limit. Of the candidates that fit, the fastest wins,
+// but a larger one must be faster by m_throughputTuningMinGain, since it costs memory, and large minibatches may
+// need different learning rates. The model is reverted after each candidate.
+template <class ElemType>
+size_t SGD<ElemType>::TuneForThroughput(ComputationNetworkPtr net,
+                                        ComputationNetworkPtr refNet,
+                                        const ComputationNodeBasePtr& refNode,
+                                        const int epochNumber,
+                                        IDataReader* trainSetDataReader,
+                                        const double learnRatePerSample,
+                                        const std::vector<ComputationNodeBasePtr>& featureNodes,
+                                        const std::vector<ComputationNodeBasePtr>& labelNodes,
+                                        const std::vector<ComputationNodeBasePtr>& criterionNodes,
+                                        const std::vector<ComputationNodeBasePtr>& evaluationNodes,
+                                        StreamMinibatchInputs* inputMatrices,
+                                        const std::list<ComputationNodeBasePtr>& learnableNodes,
+                                        std::list<Matrix<ElemType>>& smoothedGradients, vector<double>& smoothedCounts)
+{
+    vector<size_t> minibatchSizes;
+    if (!m_throughputTuningMinibatchSizes.empty())
+    {
+        for (int minibatchSize : m_throughputTuningMinibatchSizes)
+            minibatchSizes.push_back(minibatchSize);
+        sort(minibatchSizes.begin(), minibatchSizes.end());
+    }
+    else
+    {
+        for (size_t factor = 1; factor <= 8; factor *= 2)
+            if (factor == 1 || m_mbSize[epochNumber] * factor <= m_minibatchSizeTuningMax)
+                minibatchSizes.push_back(m_mbSize[epochNumber] * factor);
+    }
+
+    // the workspace limit only matters for convolutions
+    vector<size_t> maxTempMemSizes(1, m_maxTempMemSizeInSamplesForCNN);
+    if (!net->GetNodesWithType(OperationNameOf(ConvolutionNode), criterionNodes[0]).empty())
+        maxTempMemSizes.assign(m_throughputTuningMaxTempMemSizes.begin(), m_throughputTuningMaxTempMemSizes.end());
+
+    // A failed allocation cannot be recovered from in parallel training, since the other workers would wait for the
+    // gradients of this one. The memory limit is then all that keeps the candidates in bounds.
+    const bool isParallel = m_mpi != nullptr && m_mpi->NumNodesInUse() > 1;
+    const DEVICEID_TYPE deviceId = net->GetDeviceId();
+    const double memoryLimitInMB = deviceId >= 0 ? TracingGPUMemoryAllocator::GetFreeAndTotalMemoryInMBs(deviceId).second * m_throughputTuningMemoryFraction
+                                                 : numeric_limits<double>::infinity();
+
+    LOGPRINTF(stderr, "ThroughputTuning: Timing %d minibatches (after %d warm-up minibatches) for %d minibatch sizes and %d workspace limits.\n",
+              (int)m_throughputTuningMinibatches, (int)m_throughputTuningWarmupMinibatches, (int)minibatchSizes.size(), (int)maxTempMemSizes.size());
+
+    size_t bestMinibatchSize = 0;
+    size_t bestMaxTempMemSize = 0;
+    double bestSamplesPerSecond = 0;
+    for (let minibatchSize : minibatchSizes)
+    {
+        bool anyFits = false;
+        for (let maxTempMemSize : maxTempMemSizes)
+        {
+            ComputationNetwork::SetMaxTempMemSizeForCNN(net, criterionNodes[0], maxTempMemSize);
+
+            double samplesPerSecond = 0;
+            double usedMemoryInMB = 0;
+            bool fits = true;
+            try
+            {
+                EpochCriterion epochCriterion;
+                vector<EpochCriterion> epochEvalErrors(evaluationNodes.size());
+                TrainOneEpoch(net, refNet, refNode, epochNumber, m_epochSize, trainSetDataReader, learnRatePerSample, minibatchSize,
+                              featureNodes, labelNodes, criterionNodes, evaluationNodes, inputMatrices, learnableNodes,
+                              smoothedGradients, smoothedCounts, /*out*/ epochCriterion, /*out*/ epochEvalErrors,
+                              "  ThroughputTuning (warm-up):", m_throughputTuningWarmupMinibatches * minibatchSize);
+
+                Timer timer;
+                timer.Start();
+                TrainOneEpoch(net, refNet, refNode, epochNumber, m_epochSize, trainSetDataReader, learnRatePerSample, minibatchSize,
+                              featureNodes, labelNodes, criterionNodes, evaluationNodes, inputMatrices, learnableNodes,
+                              smoothedGradients, smoothedCounts, /*out*/ epochCriterion, /*out*/ epochEvalErrors,
+                              "  ThroughputTuning:", m_throughputTuningMinibatches * minibatchSize);
+                timer.Stop();
+
+                // the epoch criterion counts the samples of all workers; the slowest worker determines the time
+                double seconds = timer.ElapsedSeconds();
+                if (isParallel)
+                    m_mpi->AllReduce(&seconds, 1, MPI_MAX);
+                samplesPerSecond = seconds > 0 ? epochCriterion.second / seconds : 0;
+            }
+            catch (const std::exception& e)
+            {
+                // the smallest candidates must work, as they would have to without tuning
+                if (isParallel || (minibatchSize == minibatchSizes.front() && maxTempMemSize == maxTempMemSizes.front()))
+                    throw;
+                LOGPRINTF(stderr, "ThroughputTuning: minibatchSize = %d, maxTempMemSizeInSamplesForCNN = %d failed: %s\n",
+                          (int)minibatchSize, (int)maxTempMemSize, e.what());
+                fits = false;
+            }
+
+            if (fits && deviceId >= 0)
+            {
+                auto freeAndTotalMemory = TracingGPUMemoryAllocator::GetFreeAndTotalMemoryInMBs(deviceId);
+                usedMemoryInMB = (double)(freeAndTotalMemory.second - freeAndTotalMemory.first);
+                if (isParallel)
+                    m_mpi->AllReduce(&usedMemoryInMB, 1, MPI_MAX);
+                fits = usedMemoryInMB <= memoryLimitInMB;
+            }
+            RevertToModelBeforeEpoch(net, epochNumber, smoothedGradients, smoothedCounts);
+            if (!fits)
+            {
+                if (usedMemoryInMB > 0)
+                    LOGPRINTF(stderr, "ThroughputTuning: minibatchSize = %d, maxTempMemSizeInSamplesForCNN = %d uses %.0f MB, more than the limit of %.0f MB.\n",
+                              (int)minibatchSize, (int)maxTempMemSize, usedMemoryInMB, memoryLimitInMB);
+                continue;
+            }
+
+            anyFits = true;
+            LOGPRINTF(stderr, "ThroughputTuning: minibatchSize = %d, maxTempMemSizeInSamplesForCNN = %d: %.1f samples per second, %.0f MB device memory used.\n",
+                      (int)minibatchSize, (int)maxTempMemSize, samplesPerSecond, usedMemoryInMB);
+            if (bestMinibatchSize == 0 || samplesPerSecond > bestSamplesPerSecond * (1 + m_throughputTuningMinGain))
+            {
+                bestMinibatchSize = minibatchSize;
+                bestMaxTempMemSize = maxTempMemSize;
+                bestSamplesPerSecond = samplesPerSecond;
+            }
+        }
+        if (!anyFits)
+            break;
+    }
+
+    m_maxTempMemSizeInSamplesForCNN = bestMaxTempMemSize;
+    ComputationNetwork::SetMaxTempMemSizeForCNN(net, criterionNodes[0], m_maxTempMemSizeInSamplesForCNN);
+    if (m_needAdaptRegularization && m_adaptationRegType == AdaptationRegType::KL && refNode)
+        ComputationNetwork::SetMaxTempMemSizeForCNN(refNet, refNode, m_maxTempMemSizeInSamplesForCNN);
+
+    LOGPRINTF(stderr, "ThroughputTuning: Chose minibatchSize = %d and maxTempMemSizeInSamplesForCNN = %d (%.1f samples per second).\n",
+              (int)bestMinibatchSize, (int)bestMaxTempMemSize, bestSamplesPerSecond);
+    return bestMinibatchSize;
+}
+
 // run training over a small subset of an epoch, used by automatic LR and MB-size tuning
 template <class ElemType>
 void SGD<ElemType>::TrainOneMiniEpochAndReloadModel(ComputationNetworkPtr net,
@@ -2204,6 +2687,13 @@ void SGD<ElemType>::TrainOneMiniEpochAndReloadModel(ComputationNetworkPtr net,
     fprintf(stderr, "learningRatePerSample = %.8g; minibatchSize = %d\n", learnRatePerSample, (int)minibatchSize);
 
     // go back to where we came from
+    RevertToModelBeforeEpoch(net, epochNumber, smoothedGradients, smoothedCounts);
+}
+
+template <class ElemType>
+void SGD<ElemType>::RevertToModelBeforeEpoch(ComputationNetworkPtr net, const int epochNumber,
+                                             std::list<Matrix<ElemType>>& smoothedGradients, vector<double>& smoothedCounts)
+{
     int baseModelEpoch = epochNumber - 1;
     let path = GetModelNameForEpoch(baseModelEpoch);
     //fprintf(stderr, "Reverting parameters back to %ls\n", path.c_str());
@@ -2258,19 +2748,102 @@ void SGD<ElemType>::AttemptUtteranceDerivativeFeatures(ComputationNetworkPtr net
     }
 }
 
+// Copies the parameters of the main node to all workers. Over NCCL the broadcasts run on the GPUs; otherwise they are
+// staged in host memory and pipelined: the main node copies the next parameter from the GPU while the previous ones are
+// in flight, and the other workers copy each parameter to the GPU as soon as it has arrived. Sharded parameters are
+// skipped, since each worker holds its own shard.
+template <class ElemType>
+void SGD<ElemType>::BroadcastInitialModel(ComputationNetworkPtr net, const std::list<ComputationNodeBasePtr>& learnableNodes)
+{
+    auto shardedParameters = net->GetShardedParameters();
+    vector<Matrix<ElemType>*> values;
+    for (const auto& node : learnableNodes)
+    {
+        if (find(shardedParameters.begin(), shardedParameters.end(), node) != shardedParameters.end())
+            continue;
+        auto& value = dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value();
+        if (value.GetMatrixType() == DENSE && value.GetNumElements() > 0)
+            values.push_back(&value);
+    }
+    if (values.empty())
+        return;
+
+    if (m_traceLevel > 0)
+        LOGPRINTF(stderr, "Broadcasting %d parameter tensors of the initial model from the main node.\n", (int)values.size());
+
+    const int root = (int)m_mpi->MainNodeRank();
+    if (net->GetDeviceId() >= 0 && !m_mpi->IsMultiHost())
+    {
+        NcclComm nccl(net->GetDeviceId(), m_mpi);
+        if (nccl.IsSupported())
+        {
+            for (auto value : values)
+                nccl.Broadcast(value->Data(), value->GetNumElements() * sizeof(ElemType), MPI_CHAR, root);
+            nccl.Sync();
+            return;
+        }
+    }
+
+    // MPI counts are ints, so large parameters are broadcast in several chunks
+    const size_t maxChunkSize = (size_t)numeric_limits<int>::max();
+    vector<unique_ptr<ElemType[]>> buffers(values.size());
+    vector<vector<MPI_Request>> requests(values.size());
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        const size_t numElements = values[i]->GetNumElements();
+        if (m_mpi->IsMainNode())
+        {
+            ElemType* data = nullptr;
+            size_t size = 0;
+            values[i]->CopyToArray(data, size);
+            buffers[i].reset(data);
+        }
+        else
+            buffers[i].reset(new ElemType[numElements]);
+
+        for (size_t start = 0; start < numElements; start += maxChunkSize)
+        {
+            requests[i].push_back(MPI_REQUEST_NULL);
+            m_mpi->Ibcast(buffers[i].get() + start, (int)min(maxChunkSize, numElements - start), MPIWrapper::GetDataType(buffers[i].get()),
+                          root, &requests[i].back()) || MpiFail("BroadcastInitialModel: MPI_Ibcast");
+        }
+    }
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        m_mpi->Waitall((int)requests[i].size(), requests[i].data(), MPI_STATUSES_IGNORE) || MpiFail("BroadcastInitialModel: MPI_Waitall");
+        if (!m_mpi->IsMainNode())
+            values[i]->SetValue(values[i]->GetNumRows(), values[i]->GetNumCols(), values[i]->GetDeviceId(), buffers[i].get());
+        buffers[i].reset();
+    }
+}
+
 template <class ElemType>
 void SGD<ElemType>::InitDistGradAgg(int numEvalNodes, int numGradientBits, int deviceId, int traceLevel)
 {
     assert(GetParallelizationMethod() == ParallelizationMethod::dataParallelSGD);
 
-    if (numGradientBits != (8 * sizeof(ElemType)))
+    if (m_sparseGradientTopKRatio > 0 || m_sparseGradientThreshold > 0)
+    {
+        if (traceLevel > 0)
+        {
+            if (m_sparseGradientTopKRatio > 0)
+                fprintf(stderr, "Initializing dataParallelSGD with sparsified aggregation of the top %.3g%% of gradient entries.\n", 100.0 * m_sparseGradientTopKRatio);
+            else
+                fprintf(stderr, "Initializing dataParallelSGD with sparsified aggregation of gradient entries of magnitude >= %.3g.\n", m_sparseGradientThreshold);
+        }
+        m_distGradAgg = std::make_shared<SparseDistGradAggregator<ElemType>>(m_mpi, m_sparseGradientTopKRatio, m_sparseGradientThreshold, m_syncStatsTrace);
+    }
+    else if (numGradientBits != (8 * sizeof(ElemType)))
     {
         if (traceLevel > 0)
             fprintf(stderr, "Initializing dataParallelSGD for %d-bit quantization.\n", numGradientBits);
 #ifdef CNTK_PARALLEL_TRAINING_SUPPORT
         if (Globals::UseV2Aggregator())
         {
-            auto communicator = ::CNTK::QuantizedMPICommunicator(m_zeroThresholdFor1Bit, true, numGradientBits);
+            auto communicator = m_pipelinedQuantization
+                              ? ::CNTK::PipelinedQuantizedMPICommunicator(m_zeroThresholdFor1Bit, numGradientBits, m_quantizationThresholdSizeInBytes)
+                              : ::CNTK::QuantizedMPICommunicator(m_zeroThresholdFor1Bit, true, numGradientBits);
             m_distGradAgg = std::make_shared<V2AllReduceDistGradAggregator<ElemType>>(communicator, m_bufferedAsyncGradientAggregation, traceLevel, m_syncStatsTrace);
         }
         else
@@ -2283,15 +2856,106 @@ void SGD<ElemType>::InitDistGradAgg(int numEvalNodes, int numGradientBits, int d
     {
         if (traceLevel > 0)
             fprintf(stderr, "Initializing dataParallelSGD with FP%d aggregation.\n", numGradientBits);
+        NcclComm::SetHierarchicalAllReduce(m_hierarchicalAllReduce);
+        NcclComm::SetEnabled(!m_elasticTraining);
         if (Globals::UseV2Aggregator()) // Currently used to check V2 against baselines.
             m_distGradAgg = std::make_shared<V2SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, deviceId, m_syncStatsTrace, ::CNTK::MPICommunicator(m_packThresholdSizeInBytes));
         else
-            m_distGradAgg = std::make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, deviceId, m_syncStatsTrace, m_packThresholdSizeInBytes);
+            m_distGradAgg = std::make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, deviceId, m_syncStatsTrace, m_packThresholdSizeInBytes, m_gradientBucketSizeInBytes);
     }
 
     m_gradHeader.reset(DistGradHeader::Create(numEvalNodes), [](DistGradHeader* ptr) { DistGradHeader::Destroy(ptr); });
 }
 
+// Elastic training: a copy of the parameters and of the learner state at the start of each epoch, with which the
+// surviving workers continue if a worker fails during the epoch.
+template <class ElemType>
+void SGD<ElemType>::SaveElasticTrainingState(const std::list<ComputationNodeBasePtr>& learnableNodes,
+                                             const std::list<Matrix<ElemType>>& smoothedGradients,
+                                             const std::vector<double>& smoothedCounts, double prevCriterion)
+{
+    size_t numElements = 0;
+    for (auto& pBaseNode : learnableNodes)
+        numElements += dynamic_pointer_cast<ComputationNode<ElemType>>(pBaseNode)->Value().GetNumElements();
+    for (auto& smoothedGradient : smoothedGradients)
+        numElements += smoothedGradient.GetNumElements();
+    m_elasticModelState.resize(numElements);
+
+    ElemType* data = m_elasticModelState.data();
+    for (auto& pBaseNode : learnableNodes)
+    {
+        const Matrix<ElemType>& value = dynamic_pointer_cast<ComputationNode<ElemType>>(pBaseNode)->Value();
+        value.CopySection(value.GetNumRows(), value.GetNumCols(), data, value.GetNumRows());
+        data += value.GetNumElements();
+    }
+    for (auto& smoothedGradient : smoothedGradients)
+    {
+        smoothedGradient.CopySection(smoothedGradient.GetNumRows(), smoothedGradient.GetNumCols(), data, smoothedGradient.GetNumRows());
+        data += smoothedGradient.GetNumElements();
+    }
+
+    m_elasticLearnerState = smoothedCounts;
+    m_elasticLearnerState.push_back(prevCriterion);
+}
+
+template <class ElemType>
+void SGD<ElemType>::RestoreElasticTrainingState(const std::list<ComputationNodeBasePtr>& learnableNodes,
+                                                std::list<Matrix<ElemType>>& smoothedGradients,
+                                                std::vector<double>& smoothedCounts, double& prevCriterion)
+{
+    ElemType* data = m_elasticModelState.data();
+    for (auto& pBaseNode : learnableNodes)
+    {
+        Matrix<ElemType>& value = dynamic_pointer_cast<ComputationNode<ElemType>>(pBaseNode)->Value();
+        value.SetValue(value.GetNumRows(), value.GetNumCols(), value.GetDeviceId(), data);
+        data += value.GetNumElements();
+    }
+    for (auto& smoothedGradient : smoothedGradients)
+    {
+        smoothedGradient.SetValue(smoothedGradient.GetNumRows(), smoothedGradient.GetNumCols(), smoothedGradient.GetDeviceId(), data);
+        data += smoothedGradient.GetNumElements();
+    }
+
+    assert(m_elasticLearnerState.size() == smoothedCounts.size() + 1);
+    std::copy(m_elasticLearnerState.begin(), m_elasticLearnerState.end() - 1, smoothedCounts.begin());
+    prevCriterion = m_elasticLearnerState.back();
+}
+
+// Re-forms the communicator from the surviving workers after a worker failed, and returns the epoch to continue with.
+// The readers are repartitioned for the new number of workers by StartMinibatchLoop() at the start of the epoch.
+template <class ElemType>
+int SGD<ElemType>::RecoverFromWorkerFailure(int epochNumber, const MpiProcessFailure& failure,
+                                            const std::list<ComputationNodeBasePtr>& learnableNodes,
+                                            std::list<Matrix<ElemType>>& smoothedGradients,
+                                            std::vector<double>& smoothedCounts, double& prevCriterion)
+{
+    const size_t numWorkersBefore = m_mpi->NumNodesInUse();
+    LOGPRINTF(stderr, "A worker failed in epoch %d (%s), continuing with the surviving workers.\n", epochNumber + 1, failure.what());
+    m_mpi->RecoverFromProcessFailure();
+
+    // The survivors may be in different epochs (a worker may have completed the epoch in which another one noticed
+    // the failure), so all of them go back to the earliest one, with the state of the first worker in it.
+    int restartEpoch = epochNumber;
+    m_mpi->AllReduce(&restartEpoch, 1, MPI_MIN);
+    int sourceRank = (epochNumber == restartEpoch) ? (int)m_mpi->CurrentNodeRank() : INT_MAX;
+    m_mpi->AllReduce(&sourceRank, 1, MPI_MIN);
+    m_mpi->Bcast(m_elasticModelState.data(), m_elasticModelState.size(), sourceRank);
+    m_mpi->Bcast(m_elasticLearnerState.data(), m_elasticLearnerState.size(), sourceRank);
+    RestoreElasticTrainingState(learnableNodes, smoothedGradients, smoothedCounts, prevCriterion);
+
+    // the aggregators are set up again for the new number of workers
+    m_distGradAgg.reset();
+    if (m_pMASGDHelper)
+    {
+        m_pMASGDHelper.reset();
+        InitModelAggregationHandler(m_syncStatsTrace, learnableNodes.front()->GetDeviceId());
+    }
+
+    LOGPRINTF(stderr, "Restarting epoch %d with %d of %d workers, this worker is now rank %d.\n",
+              restartEpoch + 1, (int)m_mpi->NumNodesInUse(), (int)numWorkersBefore, (int)m_mpi->CurrentNodeRank());
+    return restartEpoch;
+}
+
 template <class ElemType>
 void SGD<ElemType>::InitModelAggregationHandler(int traceLevel, DEVICEID_TYPE devID)
 {
@@ -2301,7 +2965,10 @@ void SGD<ElemType>::InitModelAggregationHandler(int traceLevel, DEVICEID_TYPE de
     }
     if (GetParallelizationMethod() == ParallelizationMethod::modelAveragingSGD)
     {
-        m_pMASGDHelper = make_shared<BasicModelAveragingSGD<ElemType>>(m_mpi, traceLevel, devID);
+        if (m_pipelinedModelAggregation)
+            m_pMASGDHelper = make_shared<PipelinedModelAveragingSGD<ElemType>>(m_mpi, traceLevel, devID);
+        else
+            m_pMASGDHelper = make_shared<BasicModelAveragingSGD<ElemType>>(m_mpi, traceLevel, devID);
     }
     else if (GetParallelizationMethod() == ParallelizationMethod::blockMomentumSGD)
     {
@@ -2386,7 +3053,7 @@ void SGD<ElemType>::UpdateWeights(Matrix<ElemType>& functionValues, Matrix<ElemT
         if (!useNesterovMomentum)
         {
             functionValues.MomentumSGDUpdate(gradientValues, smoothedGradientValues, 
-                                             ElemType(learnRatePerSample), ElemType(momentum));
+                                             ElemType(learnRatePerSample), ElemType(momentum), /*unitGainMomentum=*/true, m_lazySparseUpdate);
         }
         else
         {
@@ -2410,7 +3077,7 @@ void SGD<ElemType>::UpdateWeights(Matrix<ElemType>& functionValues, Matrix<ElemT
 
         smoothedGradientValues.FSAdagradUpdate(
                                          gradientValues, functionValues, targetAdagradAvDenom_x_sqrtAdagradSqrFrames,
-                                         learnRatePerSample, momentum, varMomentum);
+                                         learnRatePerSample, momentum, varMomentum, /*unitGainMomentum=*/true, m_lazySparseUpdate);
     }
     else if (adpType == GradientsUpdateType::RmsProp)
     {
@@ -2437,6 +3104,151 @@ void SGD<ElemType>::UpdateWeights(Matrix<ElemType>& functionValues, Matrix<ElemT
 #endif
 }
 
+// creates the mask of the non-zero values of a parameter, if it has zeros (e.g. after the "prune" action)
+template <class ElemType>
+void SGD<ElemType>::CreateSparsityMask(const ComputationNodeBasePtr& node)
+{
+    const Matrix<ElemType>& value = dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value();
+    unique_ptr<ElemType[]> data(value.CopyToArray());
+    const size_t numElements = value.GetNumElements();
+    size_t numZeros = 0;
+    for (size_t i = 0; i < numElements; i++)
+    {
+        numZeros += data[i] == 0;
+        data[i] = data[i] != 0 ? 1 : 0;
+    }
+    if (numZeros == 0)
+        return;
+
+    auto mask = make_shared<Matrix<ElemType>>(value.GetDeviceId());
+    mask->SetValue(value.GetNumRows(), value.GetNumCols(), value.GetDeviceId(), data.get());
+    m_sparsityMasks[node] = mask;
+}
+
+// sets the values of a parameter that were zero at the start of the training back to zero after an update
+template <class ElemType>
+void SGD<ElemType>::ApplySparsityMask(const ComputationNodeBasePtr& node)
+{
+    auto iter = m_sparsityMasks.find(node);
+    if (iter != m_sparsityMasks.end())
+        dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value().ElementMultiplyWith(*iter->second);
+}
+
+// Offloading of the optimizer state.
+// With the update on the CPU, StartOffloadedWeightUpdates() starts copying the values and gradients of the offloaded
+// parameters into page-locked host buffers on a separate stream, once the gradients are computed, and
+// WaitForOffloadedCopies() waits for them after the other parameters were updated on the GPU. Each offloaded
+// parameter is then updated on the CPU, and its new value is copied back, again on a separate stream, which
+// FinishOffloadedWeightUpdates() waits for before the next minibatch uses the parameters.
+template <class ElemType>
+bool SGD<ElemType>::OffloadsOptimizerState(const ComputationNodeBasePtr& node) const
+{
+    return !m_offloadOptimizerState.empty() && node->IsParameterUpdateRequired() && (node->GetDeviceId() != CPUDEVICE) &&
+           regex_match(node->NodeName(), wregex(m_offloadOptimizerState));
+}
+
+template <class ElemType>
+void SGD<ElemType>::CreateOffloadedParameter(const ComputationNodeBasePtr& node)
+{
+    DEVICEID_TYPE deviceId = node->GetDeviceId();
+    OffloadedParameter& parameter = m_offloadedParameters[node];
+    if (m_offloadedUpdateOnCPU)
+    {
+        size_t numElements = dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value().GetNumElements();
+        auto allocate = [numElements, deviceId]()
+        {
+            return shared_ptr<ElemType>((ElemType*) CUDAPageLockedMemAllocator::Malloc(sizeof(ElemType) * numElements, deviceId),
+                                        [deviceId](ElemType* p) { CUDAPageLockedMemAllocator::Free(p, deviceId); });
+        };
+        parameter.value = allocate();
+        parameter.gradient = allocate();
+        if (m_offloadTransferers.find(deviceId) == m_offloadTransferers.end())
+            m_offloadTransferers[deviceId] = CreatePrefetchDataTransferer(deviceId);
+    }
+    else if (m_offloadedStateBuffers.find(deviceId) == m_offloadedStateBuffers.end())
+        m_offloadedStateBuffers[deviceId] = make_shared<Matrix<ElemType>>(deviceId);
+}
+
+template <class ElemType>
+void SGD<ElemType>::StartOffloadedWeightUpdates()
+{
+    if (!m_offloadedUpdateOnCPU)
+        return;
+
+    for (auto& transferer : m_offloadTransferers)
+    {
+        transferer.second->RecordComputeStreamSyncPoint();
+        transferer.second->WaitForSyncPointOnFetchStreamAsync();
+    }
+    for (auto& iter : m_offloadedParameters)
+    {
+        if (!iter.first->IsParameterUpdateRequired())
+            continue;
+        auto node = dynamic_pointer_cast<ComputationNode<ElemType>>(iter.first);
+        auto& transferer = m_offloadTransferers.at(node->GetDeviceId());
+        const Matrix<ElemType>& value = node->Value();
+        transferer->CopyGPUToCPUAsync(value.Data(), value.GetNumElements(), sizeof(ElemType), iter.second.value.get());
+        // (sparse gradients are copied when the parameter is updated)
+        const Matrix<ElemType>& gradient = node->Gradient();
+        if (gradient.GetMatrixType() == MatrixType::DENSE)
+            transferer->CopyGPUToCPUAsync(gradient.Data(), gradient.GetNumElements(), sizeof(ElemType), iter.second.gradient.get());
+    }
+    for (auto& transferer : m_offloadTransferers)
+        transferer.second->RecordGPUToCPUCopy();
+}
+
+template <class ElemType>
+void SGD<ElemType>::WaitForOffloadedCopies()
+{
+    for (auto& transferer : m_offloadTransferers)
+        transferer.second->WaitForCopyGPUToCPU();
+}
+
+template <class ElemType>
+void SGD<ElemType>::UpdateOffloadedWeights(const ComputationNodeBasePtr& node, Matrix<ElemType>& smoothedGradient, double& smoothedCount,
+                                           const double learnRatePerSample, const double momentumPerSample, size_t actualMBSize,
+                                           const double L2RegWeight, const double L1RegWeight)
+{
+    Matrix<ElemType>& value = dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value();
+    Matrix<ElemType>& gradient = dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Gradient();
+    if (!m_offloadedUpdateOnCPU)
+    {
+        // stream the state to the device and back
+        Matrix<ElemType>& deviceState = *m_offloadedStateBuffers.at(node->GetDeviceId());
+        deviceState.AssignValuesOf(smoothedGradient);
+        UpdateWeights(value, gradient, deviceState, smoothedCount, learnRatePerSample, momentumPerSample, actualMBSize,
+                      L2RegWeight, L1RegWeight, m_needAveMultiplier, m_useNesterovMomentum);
+        smoothedGradient.AssignValuesOf(deviceState);
+        return;
+    }
+
+    const OffloadedParameter& parameter = m_offloadedParameters.at(node);
+    Matrix<ElemType> hostValue(value.GetNumRows(), value.GetNumCols(), parameter.value.get(), CPUDEVICE, matrixFlagDontOwnBuffer);
+    Matrix<ElemType> hostGradient(gradient.GetNumRows(), gradient.GetNumCols(), parameter.gradient.get(), CPUDEVICE, matrixFlagDontOwnBuffer);
+    Matrix<ElemType> denseGradient(CPUDEVICE);
+    if (gradient.GetMatrixType() != MatrixType::DENSE)
+        denseGradient.AssignValuesOf(gradient);
+
+    UpdateWeights(hostValue, gradient.GetMatrixType() == MatrixType::DENSE ? hostGradient : denseGradient, smoothedGradient, smoothedCount, learnRatePerSample, momentumPerSample, actualMBSize,
+                  L2RegWeight, L1RegWeight, m_needAveMultiplier, m_useNesterovMomentum);
+
+    auto& transferer = m_offloadTransferers.at(node->GetDeviceId());
+    transferer->WaitForSyncPointOnAssignStreamAsync();
+    transferer->CopyCPUToGPUAsync(hostValue.Data(), hostValue.GetNumElements(), sizeof(ElemType), value.Data());
+}
+
+template <class ElemType>
+void SGD<ElemType>::FinishOffloadedWeightUpdates()
+{
+    if (!m_offloadedUpdateOnCPU)
+        return;
+
+    for (auto& transferer : m_offloadTransferers)
+        transferer.second->RecordCPUToGPUCopy();
+    for (auto& transferer : m_offloadTransferers)
+        transferer.second->WaitForCopyCPUToGPU();
+}
+
 // protected:
 template <class ElemType>
 void SGD<ElemType>::ClipGradient(Matrix<ElemType>& gradient, const size_t actualMBSize) const
@@ -2856,7 +3668,6 @@ static LearningRateSearchAlgorithm ParseLearningRateSearchType(const wstring& s)
     else InvalidArgument("autoAdjustLR: Invalid learning rate search type. Valid values are (none | searchBeforeEpoch | adjustAfterEpoch)");
 }
   
-#ifdef ASGD_PARALLEL_SUPPORT
 static AdjustLearningRateAtBeginning AdjustLearningRateAtBeginningType(const wstring& s)
 {
     if      (EqualCI(s.c_str(), L"") || EqualCI(s.c_str(), L"none")) return AdjustLearningRateAtBeginning::None;
@@ -2864,7 +3675,6 @@ static AdjustLearningRateAtBeginning AdjustLearningRateAtBeginningType(const wst
     else if (EqualCI(s.c_str(), L"staircase"))                       return AdjustLearningRateAtBeginning::Staircase;
     else InvalidArgument("AdjustLearningRateatBeginningType: Invalid Type. Valid values are (None | Linearly | Staircase)");
 }
-#endif
   
 template<class ConfigRecordType>
 SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
@@ -2892,6 +3702,17 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_minibatchSizeTuningMax = configAALR(L"minibatchSizeTuningMax", (size_t) 1048576);
     m_minibatchSearchCriterionErrorMargin = configAALR(L"minibatchSearchCriterionErrorMargin", (size_t) 1);
 
+    // AutoTune Throughput Parameters
+    m_autoTuneThroughput = configAALR(L"autoTuneThroughput", false);
+    m_throughputTuningMinibatchSizes = configAALR(L"throughputTuningMinibatchSizes", ConfigRecordType::Array(intargvector(vector<int>{})));
+    m_throughputTuningMaxTempMemSizes = configAALR(L"throughputTuningMaxTempMemSizes", ConfigRecordType::Array(intargvector(vector<int>{0, 256, 32})));
+    m_throughputTuningMinibatches = configAALR(L"throughputTuningMinibatches", (size_t) 20);
+    m_throughputTuningWarmupMinibatches = configAALR(L"throughputTuningWarmupMinibatches", (size_t) 3);
+    m_throughputTuningMemoryFraction = configAALR(L"throughputTuningMemoryFraction", 0.9);
+    m_throughputTuningMinGain = configAALR(L"throughputTuningMinGain", 0.05);
+    if (m_autoTuneThroughput && m_autoAdjustMinibatch)
+        InvalidArgument("autoTuneThroughput and autoAdjustMinibatch cannot be used together.");
+
     m_numPrevLearnRates = configAALR(L"numPrevLearnRates", (size_t) 5);
     m_numBestSearchEpoch = configAALR(L"numBestSearchEpoch", (size_t) 1);
     m_loadBestModel = configAALR(L"loadBestModel", true);
@@ -2905,6 +3726,8 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_truncated = configSGD(L"truncated", false);
     m_maxSamplesInRAM = configSGD(L"maxSamplesInRAM", (size_t) SIZE_MAX);
     m_numSubminiBatches = configSGD(L"numSubminibatches", (size_t) 1);
+    m_autoSubminibatches = configSGD(L"autoSubminibatches", false);
+    m_maxAutoSubminibatches = configSGD(L"maxAutoSubminibatches", (size_t) 64);
 
     m_packThresholdSizeInBytes = configSGD(L"packThresholdSizeInKB", DEFAULT_PACK_THRESHOLD_SIZE_IN_KB) * 1024;
 
@@ -2947,6 +3770,21 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     floatargvector momentumPerSample = configSGD(L"momentumPerSample", ConfigRecordType::Array(floatargvector()));
     floatargvector momentumAsTimeConstant = configSGD(L"momentumAsTimeConstant", ConfigRecordType::Array(floatargvector()));
     bool useNesterovMomentum = configSGD(L"useNAG", false);
+    // only update the optimizer state of the columns of sparse gradients (e.g. of embeddings), see LazySparseUpdate.h
+    m_lazySparseUpdate = configSGD(L"lazySparseUpdate", false);
+    // replace the element-wise parts of LSTM and GRU cells by fused nodes, see ComputationNetwork::FuseRecurrentCells()
+    m_fuseRecurrentCells = configSGD(L"fuseRecurrentCells", false);
+    // compute the input projections of recurrent loops for all frames at once, see ComputationNetwork::HoistLoopInvariantTerms()
+    m_hoistLoopInvariants = configSGD(L"hoistLoopInvariants", false);
+    // place consecutive stages of the network on several devices, see ComputationNetwork::PartitionIntoPipelineStages()
+    m_pipelineDevices = configSGD(L"pipelineDevices", ConfigRecordType::Array(intargvector(vector<int>{})));
+    m_pipelineStageLastNodes = configSGD(L"pipelineStageLastNodes", ConfigRecordType::Array(stringargvector()));
+    // train on several GPUs of this process, on replicas of the network, see LocalReplicas.h
+    m_localDevices = configSGD(L"localDevices", ConfigRecordType::Array(intargvector(vector<int>{})));
+    // ... or on several threads on the CPU, sharing the parameters
+    m_localThreads = configSGD(L"localThreads", (size_t) 0);
+    // let the gradient aggregation reduce the gradients in place, see ComputationNetwork::AllocateContiguousGradients()
+    m_contiguousGradients = configSGD(L"contiguousGradients", false);
 
     m_maxTempMemSizeInSamplesForCNN = configSGD(L"maxTempMemSizeInSamplesForCNN", (size_t) 0);
 
@@ -2962,6 +3800,9 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     // Setting this to 0 disables intermediate progress logging (only per-epoch loss/eval metric are logged).
     // Setting this to any other value (n) will log average loss/eval metric for each n minibatches.
     m_tensorBoardNumMBsToLogResult = configSGD(L"tensorBoardNumMBsToLogResult", m_numMBsToShowResult);
+    // Port to serve the live metrics (throughput, memory, reader and gradient aggregation times) on, in the Prometheus
+    // text format (see Metrics.h). Worker n of a parallel training uses port + n. 0 (default) means no HTTP endpoint.
+    m_metricsHttpPort = configSGD(L"metricsHttpPort", (int)0);
 
     m_gradientClippingWithTruncation = configSGD(L"gradientClippingWithTruncation", true);
     m_clippingThresholdPerSample = configSGD(L"clippingThresholdPerSample", numeric_limits<double>::infinity());
@@ -3017,6 +3858,7 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     }
 
     m_useAllDataForPreComputedNode = configSGD(L"UseAllDataForPreComputedNode", true);
+    m_numSamplesForPreComputedNode = configSGD(L"numSamplesForPreComputedNode", (size_t)0);
 
     // consistency checks
     for (size_t i = 0; i < m_mbSize.size(); i++)
@@ -3119,9 +3961,18 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_numGradientBits = vector<int>{8 * (int)sizeofElemType}; // means no quantization
     m_zeroThresholdFor1Bit = true;
     m_bufferedAsyncGradientAggregation = false;
+    m_gradientBucketSizeInBytes = 0;
+    m_hierarchicalAllReduce = false;
+    m_pipelinedQuantization = false;
+    m_quantizationThresholdSizeInBytes = 0;
+    m_sparseGradientTopKRatio = 0;
+    m_sparseGradientThreshold = 0;
+    m_syncBatchNormalization = false;
     m_enableDistributedMBReading = false;
     m_parallelizationStartEpochNum = 0;
     m_modelAggregationBlockSize = 0; 
+    m_pipelinedModelAggregation = false;
+    m_elasticTraining = false;
 
     if (configSGD.Exists(L"ParallelTrain"))
     {
@@ -3144,6 +3995,14 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
             m_enableDistributedMBReadingNotSpecified = !configParallelTrain.Exists(L"distributedMBReading");
             m_enableDistributedMBReading = configParallelTrain(L"distributedMBReading", false);
             m_syncStatsTrace = configParallelTrain(L"syncPerfStats", (int)0);
+            m_elasticTraining = configParallelTrain(L"elasticTraining", false);
+            if (m_elasticTraining && m_parallelizationMethod == ParallelizationMethod::dataParallelASGD)
+                InvalidArgument("elasticTraining is not supported with dataParallelASGD.");
+            if (m_elasticTraining && !pMPI->EnableFaultTolerance())
+            {
+                fprintf(stderr, "WARNING: elasticTraining is ignored, since the MPI implementation does not support fault tolerance.\n");
+                m_elasticTraining = false;
+            }
 
         if (configParallelTrain.Exists(L"DataParallelSGD"))
         {
@@ -3152,6 +4011,25 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
             m_numGradientBits = configDataParallelSGD(L"gradientBits", ConfigRecordType::Array(intargvector(vector<int>{defaultGradientBits})));
             m_zeroThresholdFor1Bit = configDataParallelSGD(L"useZeroThresholdFor1BitQuantization", true);
             m_bufferedAsyncGradientAggregation = configDataParallelSGD(L"useBufferedAsyncGradientAggregation", false);
+            // aggregate the gradients in buckets of this size, each started as soon as backprop has completed it (0: after backprop)
+            m_gradientBucketSizeInBytes = configDataParallelSGD(L"gradientBucketSizeInKB", (size_t)0) * 1024;
+            // across hosts, use NCCL within and across hosts in two levels instead of MPI
+            m_hierarchicalAllReduce = configDataParallelSGD(L"hierarchicalAllReduce", false);
+            m_pipelinedQuantization = configDataParallelSGD(L"pipelinedQuantization", false);
+            m_quantizationThresholdSizeInBytes = configDataParallelSGD(L"quantizationThresholdSizeInBytes", (size_t)0);
+            // sparsified aggregation with error feedback, as an alternative to quantization (gradientBits)
+            m_sparseGradientTopKRatio = configDataParallelSGD(L"sparseGradientTopKRatio", 0.0);
+            m_sparseGradientThreshold = configDataParallelSGD(L"sparseGradientThreshold", 0.0);
+            m_syncBatchNormalization = configDataParallelSGD(L"syncBatchNormalization", false);
+            if (m_sparseGradientTopKRatio > 0 || m_sparseGradientThreshold > 0)
+            {
+                if (m_sparseGradientTopKRatio > 0 && m_sparseGradientThreshold > 0)
+                    InvalidArgument("Only one of sparseGradientTopKRatio and sparseGradientThreshold can be specified.");
+                if (m_sparseGradientTopKRatio < 0 || m_sparseGradientTopKRatio > 1 || m_sparseGradientThreshold < 0)
+                    InvalidArgument("sparseGradientTopKRatio must be in the range (0, 1], and sparseGradientThreshold must be positive.");
+                if (configDataParallelSGD.Exists(L"gradientBits") || m_bufferedAsyncGradientAggregation)
+                    InvalidArgument("Sparsified gradient aggregation cannot be combined with gradientBits or useBufferedAsyncGradientAggregation.");
+            }
             for (size_t i = 0; i < m_numGradientBits.size(); i++)
             {
                 if (m_numGradientBits[i] < 1 || m_numGradientBits[i] > defaultGradientBits)
@@ -3172,6 +4050,7 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
             }
             else
                 m_modelAggregationBlockSize = 40000 * numMPIWorkers;    // default value 
+            m_pipelinedModelAggregation = configMASGD(L"pipelined", false);
 #if 1           // legacy option 
             if (configMASGD.Exists(L"syncFrequencyInFrames"))
             {
@@ -3247,10 +4126,23 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
 
         if (configParallelTrain.Exists(L"DataParallelASGD"))
         {
-#ifndef ASGD_PARALLEL_SUPPORT
-            InvalidArgument("DataParallelASGD is not enabled in this version.\n");
-#else
             const ConfigRecordType & configDataParallelASGD(configParallelTrain(L"DataParallelASGD", ConfigRecordType::Record()));
+#ifdef ASGD_PARALLEL_SUPPORT
+            wstring parameterServer = configDataParallelASGD(L"parameterServer", L"multiverso");
+#else
+            wstring parameterServer = configDataParallelASGD(L"parameterServer", L"native");
+#endif
+            if (parameterServer == L"native")
+                m_useNativeParameterServer = true;
+            else if (parameterServer == L"multiverso")
+                m_useNativeParameterServer = false;
+            else
+                InvalidArgument("DataParallelASGD: invalid value '%ls' for 'parameterServer', must be 'native' or 'multiverso'.", parameterServer.c_str());
+#ifndef ASGD_PARALLEL_SUPPORT
+            if (!m_useNativeParameterServer)
+                InvalidArgument("DataParallelASGD with Multiverso is not enabled in this version, use parameterServer=\"native\".\n");
+#endif
+            m_maxStaleness = configDataParallelASGD(L"maxStaleness", SIZE_MAX); // syncs, only for the native parameter server
             m_nSyncSamplesPerWorker = configDataParallelASGD(L"syncPeriodPerWorker", ConfigRecordType::Array(intargvector(vector<int>{256})));
 #if 1       // legacy option
             if (configDataParallelASGD.Exists(L"syncPeriod"))
@@ -3262,6 +4154,9 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
 #endif
             m_isAsyncBufferEnabled = configDataParallelASGD(L"UsePipeline", false);
             m_isSimulateMA = configDataParallelASGD(L"SimModelAverage", false); // using parameter server-based version of ModelAveragingSGD
+            m_adjustLearningRateAtBeginning = AdjustLearningRateAtBeginning::None;
+            m_adjustCoefficient = 0.2;
+            m_adjustPerMinibatches = 600;
             if (configDataParallelASGD.Exists(L"AdjustLearningRateAtBeginning")) // adjust learning rate per m_adjustNumInBatch minibatches until to original one,
                                                                                  // this option could be used to takcle the unstableness of DataParallelASGD if you get a chance
             {
@@ -3270,7 +4165,6 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
                 m_adjustCoefficient = configAdjustLearningRateAtBeginning(L"adjustCoefficient", (double)0.1);
                 m_adjustPerMinibatches = configAdjustLearningRateAtBeginning(L"adjustPerMinibatches", (size_t)256);
             }
-#endif
         }
         } // if (!pMPI)
     } // if (configSGD.Exists(L"ParallelTrain"))
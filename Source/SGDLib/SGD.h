@@ -36,6 +36,7 @@ namespace CNTK { namespace Internal {
 namespace Microsoft { namespace MSR { namespace CNTK {
 
 struct BestEpoch;
+template <class ElemType> class LocalReplicas;
 
 enum class LearningRateSearchAlgorithm : int
 {
@@ -132,6 +133,14 @@ protected:
     floatargvector m_momentumParam;
     intargvector m_momentumSpecifiedForMBSize;
     bool m_useNesterovMomentum;
+    bool m_lazySparseUpdate;
+    bool m_fuseRecurrentCells;
+    bool m_hoistLoopInvariants;
+    intargvector m_pipelineDevices;          // if not empty, the devices of the stages of the network, see ComputationNetwork::PartitionIntoPipelineStages()
+    stringargvector m_pipelineStageLastNodes; // optional, the last node of each stage but the last one
+    intargvector m_localDevices;             // if not empty, the GPUs of this process to train on data-parallel, see LocalReplicas.h
+    size_t m_localThreads;                   // if > 1, the number of CPU threads of this process to train on data-parallel, see LocalReplicas.h
+    bool m_contiguousGradients;              // place the gradients of the parameters into one matrix, see ComputationNetwork::AllocateContiguousGradients()
 
     // Determine the MB size used for mapping a given learning-rate or momentum parameter to a per-sample value.
     // MB size is the number of samples across all time steps and parallel sequences.
@@ -200,6 +209,10 @@ protected:
     // default is 1, which means no subminibatch is used
     // if m_maxTempMemSizeInSamples = SIZE_MAX (which means users do not specify the option) and m_numSubminiBatches > 1
     // we divide one minibatch to m_numSubminiBatches subMinibatches
+    bool m_autoSubminibatches;
+    // a minibatch whose forward-backward runs out of GPU memory is split into (twice as many) subminibatches and computed again,
+    // up to m_maxAutoSubminibatches subminibatches; not with truncated BPTT, whose state would be carried over from the failed pass
+    size_t m_maxAutoSubminibatches;
 
     // the number of samples in each epoch (0 means, use all the samples in each epoch).
     size_t m_epochSize;
@@ -241,6 +254,15 @@ protected:
     size_t m_minibatchSizeTuningFrequency;
     size_t m_minibatchSizeTuningMax;
 
+    // tuning of the minibatch size and the convolution workspace limit for throughput, see TuneForThroughput()
+    bool m_autoTuneThroughput;
+    intargvector m_throughputTuningMinibatchSizes;  // candidates; if empty, 1, 2, 4 and 8 times the configured minibatch size
+    intargvector m_throughputTuningMaxTempMemSizes; // candidates for maxTempMemSizeInSamplesForCNN, if there are convolutions
+    size_t m_throughputTuningMinibatches;           // minibatches timed per candidate
+    size_t m_throughputTuningWarmupMinibatches;     // minibatches run before timing, for allocations and cuDNN auto-tuning
+    double m_throughputTuningMemoryFraction;        // candidates must leave the device memory used below this fraction
+    double m_throughputTuningMinGain;               // relative speed-up a larger candidate must give to be chosen
+
     doubleargvector m_dropoutRates;
     doubleargvector m_batchNormalizationTimeConstant;
     doubleargvector m_batchNormalizationBlendTimeConstant;
@@ -262,12 +284,15 @@ protected:
     std::wstring m_tensorBoardLogDir;
     size_t m_tensorBoardNumMBsToLogResult;
 
+    int m_metricsHttpPort;
+
     bool m_doGradientCheck;
     double m_gradientCheckSigDigit;
 
     bool m_doUnitTest;
 
     bool m_useAllDataForPreComputedNode;
+    size_t m_numSamplesForPreComputedNode; // if not 0, the number of samples (across all workers) to precompute over
 
     // Parallel training
     MPIWrapperPtr m_mpi;
@@ -289,13 +314,28 @@ protected:
     // n > 1: Show stats after every n sync
     int m_syncStatsTrace;
 
+    // elastic training: if a worker fails, the surviving workers re-form the communicator and continue from the start of
+    // the epoch (needs an MPI implementation with fault tolerance support, and falls back from NCCL to MPI)
+    bool m_elasticTraining;
+
     // Data parallel SGD training parameters
     intargvector m_numGradientBits;
     bool m_bufferedAsyncGradientAggregation;
     bool m_zeroThresholdFor1Bit;
+    size_t m_gradientBucketSizeInBytes;
+    bool m_hierarchicalAllReduce;
+    // quantized V2 aggregation: quantize each gradient while the previous ones are exchanged, and leave gradients smaller than the threshold unquantized
+    bool m_pipelinedQuantization;
+    size_t m_quantizationThresholdSizeInBytes;
+    // sparsified aggregation: fraction of the entries of each gradient to send, or minimum magnitude of the entries to send
+    double m_sparseGradientTopKRatio;
+    double m_sparseGradientThreshold;
+    // synchronized batch normalization: compute the minibatch statistics of BatchNormalization nodes over the minibatches of all workers
+    bool m_syncBatchNormalization;
 
     // Parallel training related with MA / BM
     size_t m_modelAggregationBlockSize;
+    bool   m_pipelinedModelAggregation; // MA: overlap the exchange of the models with the training of the next block
     bool   m_resetSGDMomentum; 
     bool   m_useNesterovBlockMomentum;
     double m_blockLearningRate; 
@@ -312,6 +352,8 @@ protected:
     AdjustLearningRateAtBeginning m_adjustLearningRateAtBeginning;
     double m_adjustCoefficient;
     size_t m_adjustPerMinibatches;
+    bool m_useNativeParameterServer; // the parameter server built on MPIWrapper rather than Multiverso
+    size_t m_maxStaleness;
 
     // sequence training
     double m_hSmoothingWeight;
@@ -353,6 +395,13 @@ public:
           // TODO: The next few do not belong into SGD any more than the network or reader we operate on. Either move network and reader in here, or move these out.
           m_modelPath((const wstring&) configSGD(L"modelPath")),
           m_keepCheckPointFiles(configSGD(L"keepCheckPointFiles", false)),
+          m_asyncModelSave(configSGD(L"asyncModelSave", false)),
+          m_deltaCheckpoints(configSGD(L"deltaCheckpoints", false)),
+          m_keepParameterSparsity(configSGD(L"keepParameterSparsity", false)),
+          m_offloadOptimizerState((const wstring&) configSGD(L"offloadOptimizerState", L"")),
+          m_offloadedUpdateOnCPU(configSGD(L"offloadedUpdateOnCPU", true)),
+          m_offloadActivationsLargerThan(configSGD(L"offloadActivationsLargerThan", (size_t) 0)),
+          m_offloadBandwidthRatio(configSGD(L"offloadBandwidthRatio", 25.0)),
           m_saveBestModelPerCriterion(configSGD(L"saveBestModelPerCriterion", false)),
           m_trainCriterionNodeName((const wstring&) configSGD(L"trainCriterionNodeName", L"")),
           m_evalCriterionNodeName ((const wstring&) configSGD(L"evalCriterionNodeName", L"")),
@@ -360,6 +409,7 @@ public:
           m_traceNodeNamesCategory(configSGD(L"traceNodeNamesCategory", ConfigRecordType::Array(stringargvector()))),
           m_traceNodeNamesSparse  (configSGD(L"traceNodeNamesSparse",   ConfigRecordType::Array(stringargvector()))),
           m_prevChosenMinibatchSize(0),
+          m_throughputTunedMinibatchSize(0),
           m_lastFinishedEpochTrainLoss(0.0),
           m_distGradAgg(nullptr),
           m_gradHeader(nullptr)
@@ -462,6 +512,26 @@ protected:
                                    std::list<Matrix<ElemType>>& smoothedGradients, std::vector<double> smoothedCounts,
                                    const double learningRateAdjustmentFactor);
 
+    // trains a few minibatches with each candidate minibatch size and workspace limit, and picks the fastest that fits
+    // into device memory; sets the workspace limit, and returns the minibatch size
+    size_t TuneForThroughput(ComputationNetworkPtr net,
+                             ComputationNetworkPtr refNet,
+                             const ComputationNodeBasePtr& refNode,
+                             const int epochNumber,
+                             IDataReader* trainSetDataReader,
+                             const double learnRatePerSample,
+                             const std::vector<ComputationNodeBasePtr>& featureNodes,
+                             const std::vector<ComputationNodeBasePtr>& labelNodes,
+                             const std::vector<ComputationNodeBasePtr>& criterionNodes,
+                             const std::vector<ComputationNodeBasePtr>& evaluationNodes,
+                             StreamMinibatchInputs* inputMatrices,
+                             const std::list<ComputationNodeBasePtr>& learnableNodes,
+                             std::list<Matrix<ElemType>>& smoothedGradients, std::vector<double>& smoothedCounts);
+
+    // restores the model and the optimizer state saved after the epoch before epochNumber
+    void RevertToModelBeforeEpoch(ComputationNetworkPtr net, const int epochNumber,
+                                  std::list<Matrix<ElemType>>& smoothedGradients, std::vector<double>& smoothedCounts);
+
     // uses a small percentage of training data of minibatch to
     // speculatively train with various MB sizes; then picks the best
     size_t SearchForBestMinibatchSize(ComputationNetworkPtr net,
@@ -512,8 +582,20 @@ protected:
                          const size_t totalMBsSeenBefore = 0,
                          ::CNTK::Internal::TensorBoardFileWriterPtr tensorBoardWriter = nullptr);
 
+    void BroadcastInitialModel(ComputationNetworkPtr net, const std::list<ComputationNodeBasePtr>& learnableNodes);
     void InitDistGradAgg(int numEvalNodes, int numGradientBits, int deviceId, int traceLevel);
     void InitModelAggregationHandler(int traceLevel, DEVICEID_TYPE devID);
+
+    void SaveElasticTrainingState(const std::list<ComputationNodeBasePtr>& learnableNodes,
+                                  const std::list<Matrix<ElemType>>& smoothedGradients,
+                                  const std::vector<double>& smoothedCounts, double prevCriterion);
+    void RestoreElasticTrainingState(const std::list<ComputationNodeBasePtr>& learnableNodes,
+                                     std::list<Matrix<ElemType>>& smoothedGradients,
+                                     std::vector<double>& smoothedCounts, double& prevCriterion);
+    int RecoverFromWorkerFailure(int epochNumber, const MpiProcessFailure& failure,
+                                 const std::list<ComputationNodeBasePtr>& learnableNodes,
+                                 std::list<Matrix<ElemType>>& smoothedGradients,
+                                 std::vector<double>& smoothedCounts, double& prevCriterion);
 public:
     // UpdateWeights() - actual weight update, implementing various update rules
     void UpdateWeights(Matrix<ElemType>& functionValues, Matrix<ElemType>& gradientValues,
@@ -523,6 +605,20 @@ public:
                        const double L2RegWeight, const double L1RegWeight,
                        const bool needAveMultiplier,
                        const bool useNesterovMomentum) const;
+
+    // keep the parameters that had zeros at the start of the training sparse, if m_keepParameterSparsity
+    void CreateSparsityMask(const ComputationNodeBasePtr& node);
+    void ApplySparsityMask(const ComputationNodeBasePtr& node);
+
+    // keep the optimizer state of the GPU parameters matching m_offloadOptimizerState in host memory
+    bool OffloadsOptimizerState(const ComputationNodeBasePtr& node) const;
+    void CreateOffloadedParameter(const ComputationNodeBasePtr& node);
+    void StartOffloadedWeightUpdates();
+    void WaitForOffloadedCopies();
+    void UpdateOffloadedWeights(const ComputationNodeBasePtr& node, Matrix<ElemType>& smoothedGradient, double& smoothedCount,
+                                const double learnRatePerSample, const double momentumPerSample, size_t actualMBSize,
+                                const double L2RegWeight, const double L1RegWeight);
+    void FinishOffloadedWeightUpdates();
     // return -1 if nothing exists
     int DetermineStartEpoch(const bool makeMode);
 
@@ -575,6 +671,28 @@ public:
 protected:
     std::wstring m_modelPath;
     bool m_keepCheckPointFiles;
+    bool m_asyncModelSave;    // write the per-epoch models in the background, see ComputationNetwork::SaveAsync()
+    bool m_deltaCheckpoints;  // ... and only the parameters that changed since the first one
+    bool m_keepParameterSparsity; // keep the values of the parameters that are zero at the start (e.g. pruned ones) at zero
+    // masks of the non-zero values of the parameters that have zeros, if m_keepParameterSparsity
+    std::map<ComputationNodeBasePtr, std::shared_ptr<Matrix<ElemType>>> m_sparsityMasks;
+    // Parameters on a GPU whose names match this regex keep their optimizer state (smoothed gradient) in host memory.
+    // The update runs on the CPU, on page-locked copies of the parameter and its gradient; or, if !m_offloadedUpdateOnCPU,
+    // on the GPU, with the state streamed to a device buffer that is shared by all offloaded parameters.
+    std::wstring m_offloadOptimizerState;
+    bool m_offloadedUpdateOnCPU;
+    struct OffloadedParameter
+    {
+        std::shared_ptr<ElemType> value;    // page-locked host copies of the parameter and its gradient
+        std::shared_ptr<ElemType> gradient;
+    };
+    std::map<ComputationNodeBasePtr, OffloadedParameter> m_offloadedParameters;
+    std::map<DEVICEID_TYPE, DataTransfererPtr> m_offloadTransferers;                 // by device
+    std::map<DEVICEID_TYPE, std::shared_ptr<Matrix<ElemType>>> m_offloadedStateBuffers; // by device, if !m_offloadedUpdateOnCPU
+    // activation offload: also offload the values of at least this many elements per sample (0: only those of marked nodes),
+    // with the given ratio of device memory to PCIe bandwidth; see ComputationNetwork::SetValueOffload()
+    size_t m_offloadActivationsLargerThan;
+    double m_offloadBandwidthRatio;
     bool m_saveBestModelPerCriterion;
     // Mapping from criterion to the best epoch on validation data set.
     std::map<std::wstring, BestEpoch> m_criteriaBestEpoch;
@@ -588,6 +706,7 @@ protected:
     std::vector<std::wstring> m_traceNodeNamesSparse;
 
     size_t m_prevChosenMinibatchSize;
+    size_t m_throughputTunedMinibatchSize; // chosen by TuneForThroughput(), 0 if not tuned
     double m_lastFinishedEpochTrainLoss;
 
     std::shared_ptr<IDistGradAggregator<ElemType>> m_distGradAgg;
@@ -595,6 +714,13 @@ protected:
 
     shared_ptr<IMASGD<ElemType>> m_pMASGDHelper;
 
+    // data parallelism across the GPUs of this process, if m_localDevices
+    std::shared_ptr<LocalReplicas<ElemType>> m_localReplicas;
+
+    // elastic training: the parameters and smoothed gradients, and the smoothed counts and previous criterion, at the start of the epoch
+    std::vector<ElemType> m_elasticModelState;
+    std::vector<double> m_elasticLearnerState;
+
 private:
     void MarkDropoutNodesEvalTimeStampAsOutdated(const ComputationNetworkPtr& net, const ComputationNodeBasePtr& criterionNode);
     std::shared_ptr<ASGDHelper<ElemType>> m_pASGDHelper;
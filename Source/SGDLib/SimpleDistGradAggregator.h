@@ -11,9 +11,12 @@
 #include "CUDAPageLockedMemAllocator.h"
 #include "NcclComm.h"
 #include <future>
+#include <algorithm>
 #include "GPUDataTransferer.h"
 #include "TimerUtility.h"
 #include "MatrixQuantizerImpl.h"
+#include "PerformanceProfiler.h"
+#include "Metrics.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -23,9 +26,9 @@ class SimpleDistGradAggregator : public IDistGradAggregator<ElemType>
     UsingIDistGradAggregatorMembers;
 
 public:
-    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int deviceId, int syncStatsTrace, size_t packThresholdSizeInBytes = DEFAULT_PACK_THRESHOLD_SIZE_IN_BYTES)
+    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int deviceId, int syncStatsTrace, size_t packThresholdSizeInBytes = DEFAULT_PACK_THRESHOLD_SIZE_IN_BYTES, size_t bucketSizeInBytes = 0)
         : IDistGradAggregator<ElemType>(mpi), m_useAsyncAggregation(useAsyncAggregation), m_initialized(false), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace),
-        m_iterationCount(0), m_nccl(deviceId, mpi), m_packThresholdSizeInBytes(packThresholdSizeInBytes)
+        m_iterationCount(0), m_nccl(deviceId, mpi), m_packThresholdSizeInBytes(packThresholdSizeInBytes), m_bucketSizeInBytes(bucketSizeInBytes), m_numBucketsLaunched(0)
     {}
 
     ~SimpleDistGradAggregator()
@@ -125,7 +128,210 @@ public:
         }
     }
 
+    // Gradients can only be reported during backprop once the buckets have been set up by the first AggregateGradients() call.
+    bool SupportsOverlappedAggregation() const override
+    {
+        return m_initialized && !m_buckets.empty();
+    }
+
+    // Start aggregating the bucket of this gradient if it was the last one missing in it. Buckets are started strictly in
+    // order, since the collective operations must be issued in the same order on all workers.
+    void GradientReady(size_t gradientIndex) override
+    {
+        if (!SupportsOverlappedAggregation() || m_gradientReady[gradientIndex])
+            return;
+
+        m_gradientReady[gradientIndex] = true;
+        m_buckets[m_bucketOfGradient[gradientIndex]].numPendingGradients--;
+        while (m_numBucketsLaunched < m_buckets.size() && m_buckets[m_numBucketsLaunched].numPendingGradients == 0)
+            LaunchBucket(m_buckets[m_numBucketsLaunched++]);
+    }
+
 private:
+    // A bucket is a group of gradients that is aggregated by a single collective operation, through a contiguous buffer if
+    // it holds more than one gradient. Bucketing is used instead of packing only the small gradients if a bucket size is given.
+    struct GradientBucket
+    {
+        std::vector<size_t> gradientIndices;
+        size_t numElements;
+        std::unique_ptr<Matrix<ElemType>> buffer;
+        bool bufferIsView; // the buffer is the memory of the gradients themselves, so they need not be copied
+        size_t numPendingGradients; // gradients of the current iteration not reported final yet
+
+        // for aggregation through MPI
+        MPI_Request allReduceRequest;
+        std::shared_ptr<ElemType> intermediateCPUBuffer;
+        std::unique_ptr<GPUDataTransferer> gpuDataTransferer;
+
+        GradientBucket() : numElements(0), bufferIsView(false), numPendingGradients(0) {}
+    };
+
+    void InitializeBuckets(const std::vector<Matrix<ElemType>*>& gradients, int deviceId)
+    {
+        // The gradients are in evaluation order, so backprop completes them roughly in reverse order; we fill the buckets
+        // in the same order, such that the first bucket is ready first.
+        m_gradients = gradients;
+        m_bucketOfGradient.resize(gradients.size());
+        for (size_t i = gradients.size(); i-- > 0;)
+        {
+            // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
+            if (gradients[i]->GetMatrixType() != DENSE)
+                RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
+
+            size_t numElements = gradients[i]->GetNumElements();
+            if (m_buckets.empty() || (m_buckets.back().numElements > 0 && sizeof(ElemType) * (m_buckets.back().numElements + numElements) > m_bucketSizeInBytes))
+                m_buckets.push_back(GradientBucket());
+            m_buckets.back().gradientIndices.push_back(i);
+            m_buckets.back().numElements += numElements;
+            m_bucketOfGradient[i] = m_buckets.size() - 1;
+        }
+
+        for (auto& bucket : m_buckets)
+        {
+            if (bucket.gradientIndices.size() > 1)
+            {
+                bucket.buffer = ContiguousView(gradients, bucket.gradientIndices, deviceId);
+                bucket.bufferIsView = (bucket.buffer != nullptr);
+                if (!bucket.bufferIsView)
+                    bucket.buffer.reset(new Matrix<ElemType>(1, bucket.numElements, deviceId));
+            }
+            if (ShouldCopyDataToCPU(deviceId))
+            {
+                bucket.gpuDataTransferer = std::make_unique<GPUDataTransferer>(deviceId, false);
+                bucket.intermediateCPUBuffer = AllocateIntermediateBuffer(deviceId, bucket.numElements);
+            }
+        }
+
+        ResetBuckets();
+    }
+
+    void ResetBuckets()
+    {
+        for (auto& bucket : m_buckets)
+            bucket.numPendingGradients = bucket.gradientIndices.size();
+        m_gradientReady.assign(m_gradients.size(), false);
+        m_numBucketsLaunched = 0;
+    }
+
+    Matrix<ElemType>* GetBucketData(const GradientBucket& bucket)
+    {
+        return bucket.buffer ? bucket.buffer.get() : m_gradients[bucket.gradientIndices[0]];
+    }
+
+    // start the aggregation of a bucket as far as possible without blocking; FinishBuckets() completes it
+    void LaunchBucket(GradientBucket& bucket)
+    {
+        if (bucket.buffer && !bucket.bufferIsView)
+        {
+            size_t offset = 0;
+            for (size_t i : bucket.gradientIndices)
+            {
+                bucket.buffer->ColumnSlice(offset, m_gradients[i]->GetNumElements()).AssignValuesOf(m_gradients[i]->Reshaped(1, m_gradients[i]->GetNumElements()));
+                offset += m_gradients[i]->GetNumElements();
+            }
+        }
+
+        Matrix<ElemType>* data = GetBucketData(bucket);
+        if (m_nccl.IsSupported())
+        {
+            ScopeProfile profile(profilerEvtNcclAllReduce);
+            m_nccl.AllReduce(data->Data(), data->Data(), data->GetNumElements());
+        }
+        else if (ShouldCopyDataToCPU(data->GetDeviceId())) // the reduction is started once the copy has completed, in FinishBuckets()
+            bucket.gpuDataTransferer->CopyGPUToCPUAsync(data->Data(), data->GetNumElements(), bucket.intermediateCPUBuffer.get());
+        else if (UseNonblockingAllReduce())
+            m_mpi->Iallreduce(MPI_IN_PLACE, data->Data(), data->GetNumElements(), MPIWrapper::GetDataType(data->Data()), MPI_SUM, &bucket.allReduceRequest) || MpiFail("MPI_Iallreduce");
+        // else with a CUDA-aware MPI that only takes GPU buffers in blocking calls, the reduction is done in LaunchRemainingBuckets()
+    }
+
+    // start the buckets that have not been started during backprop, and the MPI reductions that wait for the copy to the CPU
+    void LaunchRemainingBuckets()
+    {
+        while (m_numBucketsLaunched < m_buckets.size())
+            LaunchBucket(m_buckets[m_numBucketsLaunched++]);
+
+        if (m_nccl.IsSupported())
+            return;
+        for (auto& bucket : m_buckets)
+        {
+            Matrix<ElemType>* data = GetBucketData(bucket);
+            if (ShouldCopyDataToCPU(data->GetDeviceId()))
+            {
+                bucket.gpuDataTransferer->WaitForCopyGPUToCPUAsync();
+                m_mpi->Iallreduce(MPI_IN_PLACE, bucket.intermediateCPUBuffer.get(), bucket.numElements, MPIWrapper::GetDataType(data->Data()), MPI_SUM, &bucket.allReduceRequest) || MpiFail("MPI_Iallreduce");
+            }
+            else if (!UseNonblockingAllReduce())
+            {
+                ScopeProfile profile(profilerEvtMPIAllReduce);
+                m_mpi->AllReduce(data->Data(), data->GetNumElements());
+            }
+        }
+    }
+
+    // wait for all buckets to be aggregated and copy the results back into the gradients (the NCCL stream is synchronized by the caller)
+    void FinishBuckets()
+    {
+        if (!m_nccl.IsSupported() && UseNonblockingAllReduce())
+        {
+            for (auto& bucket : m_buckets)
+            {
+                {
+                    ScopeProfile profile(profilerEvtMPIWait);
+                    m_mpi->Wait(&bucket.allReduceRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+                }
+                if (bucket.gpuDataTransferer)
+                    bucket.gpuDataTransferer->CopyCPUToGPUAsync(bucket.intermediateCPUBuffer.get(), bucket.numElements, GetBucketData(bucket)->Data());
+            }
+            for (auto& bucket : m_buckets)
+            {
+                if (bucket.gpuDataTransferer)
+                    bucket.gpuDataTransferer->WaitForCopyCPUToGPUAsync();
+            }
+        }
+
+        for (auto& bucket : m_buckets)
+        {
+            if (!bucket.buffer || bucket.bufferIsView)
+                continue;
+            size_t offset = 0;
+            for (size_t i : bucket.gradientIndices)
+            {
+                m_gradients[i]->AssignValuesOf(bucket.buffer->ColumnSlice(offset, m_gradients[i]->GetNumElements()).Reshaped(m_gradients[i]->GetNumRows(), m_gradients[i]->GetNumCols()));
+                offset += m_gradients[i]->GetNumElements();
+            }
+        }
+
+        ResetBuckets();
+    }
+
+    // A matrix over the memory of the given gradients if they tile it without gaps in some order, e.g. because they are
+    // views of one matrix (see ComputationNetwork::AllocateContiguousGradients()); the reduction can then run over them in
+    // place. Since the elements are only summed, the order in which the gradients are laid out does not matter.
+    static std::unique_ptr<Matrix<ElemType>> ContiguousView(const std::vector<Matrix<ElemType>*>& gradients, const std::vector<size_t>& indices, int deviceId)
+    {
+        std::vector<std::pair<ElemType*, size_t>> ranges; // (first element, number of elements)
+        for (size_t i : indices)
+        {
+            if (gradients[i]->GetDeviceId() != deviceId || gradients[i]->GetMatrixType() != DENSE)
+                return nullptr;
+            ranges.push_back(std::make_pair(gradients[i]->Data(), gradients[i]->GetNumElements()));
+        }
+        if (ranges.size() < 2)
+            return nullptr;
+
+        std::sort(ranges.begin(), ranges.end(), [](const std::pair<ElemType*, size_t>& a, const std::pair<ElemType*, size_t>& b)
+        {
+            return std::less<ElemType*>()(a.first, b.first);
+        });
+        for (size_t k = 1; k < ranges.size(); k++)
+        {
+            if (ranges[k - 1].first + ranges[k - 1].second != ranges[k].first)
+                return nullptr;
+        }
+        size_t numElements = ranges.back().first + ranges.back().second - ranges.front().first;
+        return std::make_unique<Matrix<ElemType>>(1, numElements, ranges.front().first, (DEVICEID_TYPE) deviceId, matrixFlagDontOwnBuffer);
+    }
+
     std::shared_ptr<ElemType> AllocateIntermediateBuffer(int deviceID, size_t numElements)
     {
         assert(deviceID >= 0);
@@ -151,6 +357,12 @@ private:
         return true;
     }
 
+    // The reductions are non-blocking, unless the GPU buffers are passed to a CUDA-aware MPI that does not support them in non-blocking collectives.
+    bool UseNonblockingAllReduce()
+    {
+        return !m_mpi->UseGpuGdr() || m_mpi->UseGpuGdrForNonblockingCollectives();
+    }
+
     void ResetState(const std::vector<Matrix<ElemType>*>& gradients, int numEvalNodes, bool resetState)
     {
         // When called the first time let's setup the intermediateCPU buffers for gradient aggregation if needed
@@ -165,58 +377,70 @@ private:
                 m_allocator.reset(new CUDAPageLockedMemAllocator(deviceId));
             }
 
-            size_t packedGradientsSizeInElements = 0;
-            for (size_t i = 0; i < gradients.size(); i++)
+            if (m_bucketSizeInBytes > 0 && !m_useAsyncAggregation)
             {
-                if (!m_useAsyncAggregation && sizeof(ElemType) * gradients[i]->GetNumElements() <= m_packThresholdSizeInBytes)
+                InitializeBuckets(gradients, deviceId);
+            }
+            else
+            {
+                size_t packedGradientsSizeInElements = 0;
+                for (size_t i = 0; i < gradients.size(); i++)
                 {
-                    packedGradientsSizeInElements += gradients[i]->GetNumElements();
-                    m_packedGradientsIndex.push_back(i);
+                    if (!m_useAsyncAggregation && sizeof(ElemType) * gradients[i]->GetNumElements() <= m_packThresholdSizeInBytes)
+                    {
+                        packedGradientsSizeInElements += gradients[i]->GetNumElements();
+                        m_packedGradientsIndex.push_back(i);
+                    }
+                    else
+                    {
+                        m_gradientIndexToAggregate.push_back(i);
+                    }
+
+                    // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
+                    if (gradients[i]->GetMatrixType() != DENSE)
+                        RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
+
+                    if (m_useAsyncAggregation)
+                        m_bufferedGradients[gradients[i]].reset(new Matrix<ElemType>(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), deviceId));
                 }
-                else
+
+                // Packing matrices into continous buffer if not doing async aggregation
+                // If the packed gradients are adjacent in memory, the buffer is a view of them and nothing needs to be copied.
+                m_aggregationBuffer.reset();
+                if (packedGradientsSizeInElements > 0)
                 {
-                    m_gradientIndexToAggregate.push_back(i);
+                    m_aggregationBuffer = ContiguousView(gradients, m_packedGradientsIndex, deviceId);
+                    if (m_aggregationBuffer)
+                        m_packedGradientsIndex.clear(); // (only used for the copies)
+                    else
+                        m_aggregationBuffer.reset(new (std::nothrow) Matrix<ElemType>(1, packedGradientsSizeInElements, deviceId));
                 }
-
-                // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
-                if (gradients[i]->GetMatrixType() != DENSE)
-                    RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
-
-                if (m_useAsyncAggregation)
-                    m_bufferedGradients[gradients[i]].reset(new Matrix<ElemType>(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), deviceId));
-            }
-
-            // Packing matrices into continous buffer if not doing async aggregation
-            m_aggregationBuffer.reset();
-            if (packedGradientsSizeInElements > 0)
-            {
-                m_aggregationBuffer.reset(new (std::nothrow) Matrix<ElemType>(1, packedGradientsSizeInElements, deviceId));
-            }
-            // If no extra continous buffer allocated or using async aggregation
-            if (m_aggregationBuffer == nullptr)
-            {
-                m_gradientIndexToAggregate.clear();
-                m_packedGradientsIndex.clear();
-                packedGradientsSizeInElements = 0;
-                // Reuse "@param m_gradientIndexToAggregate" for following code, if no continous buffer allocated
-                for (size_t i = 0; i < gradients.size(); i++)
+                // If no extra continous buffer allocated or using async aggregation
+                if (m_aggregationBuffer == nullptr)
                 {
-                    m_gradientIndexToAggregate.push_back(i);
+                    m_gradientIndexToAggregate.clear();
+                    m_packedGradientsIndex.clear();
+                    packedGradientsSizeInElements = 0;
+                    // Reuse "@param m_gradientIndexToAggregate" for following code, if no continous buffer allocated
+                    for (size_t i = 0; i < gradients.size(); i++)
+                    {
+                        m_gradientIndexToAggregate.push_back(i);
+                    }
+                }
+                else
+                {
+                    // First element is reserved for continous buffer
+                    m_gradientIndexToAggregate.insert(m_gradientIndexToAggregate.begin(), 1, (size_t)-1);
                 }
-            }
-            else
-            {
-                // First element is reserved for continous buffer
-                m_gradientIndexToAggregate.insert(m_gradientIndexToAggregate.begin(), 1, (size_t)-1);
-            }
 
-            if (ShouldCopyDataToCPU(deviceId))
-            {
-                for (size_t i : m_gradientIndexToAggregate)
+                if (ShouldCopyDataToCPU(deviceId))
                 {
-                    m_gpuDataTransferers.push_back(std::make_unique<GPUDataTransferer>(deviceId, m_useAsyncAggregation));
-                    m_intermediateCPUBuffers.push_back(AllocateIntermediateBuffer(deviceId,
-                        (i == -1) ? packedGradientsSizeInElements : gradients[i]->GetNumElements()));
+                    for (size_t i : m_gradientIndexToAggregate)
+                    {
+                        m_gpuDataTransferers.push_back(std::make_unique<GPUDataTransferer>(deviceId, m_useAsyncAggregation));
+                        m_intermediateCPUBuffers.push_back(AllocateIntermediateBuffer(deviceId,
+                            (i == -1) ? packedGradientsSizeInElements : gradients[i]->GetNumElements()));
+                    }
                 }
             }
 
@@ -251,6 +475,7 @@ private:
 
     void AggregateGradientsImpl(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool showSyncPerfStats)
     {
+        ScopeMetricsTimer metricsTimer("cntk_gradient_aggregation_seconds"); // (see Metrics.h)
         Timer aggregationTimer;
         int deviceId = gradients[0]->GetDeviceId();
         if (showSyncPerfStats)
@@ -261,9 +486,13 @@ private:
         }
 
         size_t numGradMatrices = gradients.size();
+        size_t numBucketsLaunchedDuringBackprop = m_numBucketsLaunched;
 
         if (headerCPU->numSamples == 0)
         {
+            // (backprop is not run without samples, so no bucket can have been started yet)
+            assert(m_numBucketsLaunched == 0);
+
             assert(headerCPU->criterion == 0.0);
             assert(headerCPU->numSamplesWithLabel == 0);
             for (int i = 0; i < headerCPU->numEvalNode; ++i)
@@ -336,21 +565,22 @@ private:
             {
                 allReduceRequests.push_back(MPI_Request());
                 reductionBuffer = (i == -1)? m_aggregationBuffer->Data() : gradients[i]->Data();
-                if (m_mpi->UseGpuGdr() == 0 && deviceId != CPUDEVICE)
+                if (ShouldCopyDataToCPU(deviceId))
                 {
                     m_gpuDataTransferers[allReduceIndex]->WaitForCopyGPUToCPUAsync();
                     reductionBuffer = m_intermediateCPUBuffers[allReduceIndex].get();
                 }
 
-                if (m_mpi->UseGpuGdr() == 0)
+                if (UseNonblockingAllReduce())
                 {
                     m_mpi->Iallreduce(MPI_IN_PLACE, reductionBuffer, (i == -1) ? m_aggregationBuffer->GetNumElements() : gradients[i]->GetNumElements(),
                         MPIWrapper::GetDataType(reductionBuffer), MPI_SUM, &allReduceRequests.back()) || MpiFail("MPI_Iallreduce");
                     allReduceIndex++;
                 }
-                // TODO: Remove this when MPI_Iallreduce with CUDA - aware is supported
+                // the CUDA-aware MPI only takes GPU buffers in blocking calls
                 else
                 {
+                    ScopeProfile profile(profilerEvtMPIAllReduce);
                     m_mpi->AllReduce(reductionBuffer, (i == -1) ? m_aggregationBuffer->GetNumElements() : gradients[i]->GetNumElements());
                 }
             }
@@ -362,8 +592,10 @@ private:
             {
                 ncclReduceGradients.push_back((i == -1) ? m_aggregationBuffer.get() : gradients[i]);
             }
+            ScopeProfile profile(profilerEvtNcclAllReduce);
             m_nccl.AllReduce(ncclReduceGradients);
         }
+        LaunchRemainingBuckets();
 
         // On the main node wait for the headers to arrive and aggregate
         if (m_mpi->IsMainNode())
@@ -391,17 +623,20 @@ private:
 
         if (m_nccl.IsSupported())
         {
+            ScopeProfile profile(profilerEvtNcclSync);
             m_nccl.Sync();
         }
-        // TODO: Remove this when MPI_Iallreduce with CUDA-aware is supported 
-        else if (m_mpi->UseGpuGdr() == 0)
+        else if (UseNonblockingAllReduce())
         {
             // Wait for the allreduce operations to finish and initiate transfer back to the GPU if needed
             size_t gpuDataTransfersIdx = 0; // Index of allReduceRequest for each un-packed gradient
             for (size_t i : m_gradientIndexToAggregate)
             {
-                m_mpi->Wait(&allReduceRequests[gpuDataTransfersIdx], MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
-                if (deviceId != CPUDEVICE)
+                {
+                    ScopeProfile profile(profilerEvtMPIWait);
+                    m_mpi->Wait(&allReduceRequests[gpuDataTransfersIdx], MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+                }
+                if (ShouldCopyDataToCPU(deviceId))
                 {
                     m_gpuDataTransferers[gpuDataTransfersIdx]->CopyCPUToGPUAsync(m_intermediateCPUBuffers[gpuDataTransfersIdx].get(),
                         (i == -1) ? m_aggregationBuffer->GetNumElements() : gradients[i]->GetNumElements(),
@@ -411,13 +646,15 @@ private:
             }
 
             // Wait for copy data from CPU to GPU, if not running on CPU and not NCCL enabled
-            if (deviceId != CPUDEVICE)
+            if (ShouldCopyDataToCPU(deviceId))
             {
                 for (size_t i = 0; i < m_gradientIndexToAggregate.size(); i++)
                     m_gpuDataTransferers[i]->WaitForCopyCPUToGPUAsync();
             }
         }
 
+        FinishBuckets();
+
         // Copy data back to the packed gradients from the continous buffer
         offset = 0;
         for (size_t i : m_packedGradientsIndex)
@@ -435,6 +672,8 @@ private:
             aggregationTimer.Stop();
             double gradientAggregationTime = aggregationTimer.ElapsedSeconds();
             fprintf(stderr, "Actual gradient aggregation time: %.6g\n", gradientAggregationTime);
+            if (!m_buckets.empty())
+                fprintf(stderr, "Gradient buckets started during backprop: %d of %d\n", (int)numBucketsLaunchedDuringBackprop, (int)m_buckets.size());
         }
     }
 
@@ -463,6 +702,15 @@ private:
     std::vector<size_t> m_packedGradientsIndex;
     std::vector<size_t> m_gradientIndexToAggregate;
 
+    // Bucketed aggregation overlapped with backprop, used instead of the packing above if a bucket size (tunable by
+    // "gradientBucketSizeInKB=[value]") is given and not doing async aggregation
+    const size_t m_bucketSizeInBytes;
+    std::vector<GradientBucket> m_buckets;       // in the order they are started
+    std::vector<size_t> m_bucketOfGradient;      // [gradient index] -> bucket index
+    std::vector<Matrix<ElemType>*> m_gradients;  // the gradients the buckets were set up for
+    std::vector<bool> m_gradientReady;           // [gradient index] reported final during backprop of the current iteration
+    size_t m_numBucketsLaunched;                 // buckets [0, m_numBucketsLaunched) have been started
+
     int m_syncStatsTrace;
 
     // Only used for controlling frequency of measuring/showing gradient aggregation perf stats
@@ -93,6 +93,11 @@ public:
 
         bool useParallelTrain = (m_mpi != nullptr);
         bool useDistributedMBReading = useParallelTrain && m_enableDistributedMBReading && dataReader->SupportsDistributedMBRead();
+
+        // The workers only need to run in lockstep, aggregating the results of every minibatch, if sharded nodes exchange
+        // data in every minibatch. Otherwise each worker evaluates its part of the data on its own, and the results are
+        // aggregated once at the end.
+        bool aggregateEachMinibatch = useParallelTrain && HasShardedNodes(evalNodes);
         if (useDistributedMBReading)
             dataReader->StartDistributedMinibatchLoop(mbSize, 0, m_mpi->CurrentNodeRank(), m_mpi->NumNodesInUse(), inputMatrices.GetStreamDescriptions(), testSize);
         else
@@ -121,9 +126,9 @@ public:
         {
             size_t actualMBSize = 0;
             bool wasDataRead = DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(*dataReader, m_net, nullptr, useDistributedMBReading, useParallelTrain, inputMatrices, actualMBSize, m_mpi);
-            // in case of distributed reading, we do a few more loops until all ranks have completed
+            // in case of distributed reading in lockstep, we do a few more loops until all ranks have completed
             // end of epoch
-            if (!wasDataRead && (!useDistributedMBReading || noMoreSamplesToProcess)) 
+            if (!wasDataRead && (!useDistributedMBReading || !aggregateEachMinibatch || noMoreSamplesToProcess))
                 break;
 
             // Note: If !wasDataRead then the data that GetMinibatchIntoNetwork() was supposed to full in are undefined.
@@ -155,43 +160,20 @@ public:
             if (actualNumSubminibatches > 1)
                 smbDispatcher.DoneWithCurrentMinibatch();
             } // if (actualMBSize > 0)
+            else if (useDistributedMBReading)
+                m_net->ForwardPropShardedNodesWithoutLocalData(evalNodes); // (the sharded embeddings of the other workers need this worker's shards)
 
             // BUGBUG (Issue #95): Once we have multiple layouts, this must be done on a per-node basis.
             size_t numSamplesWithLabel = wasDataRead ? m_net->GetNumSamplesWithLabelOfNetwork(actualMBSize) : 0;
             size_t aggregateNumSamplesWithLabel = numSamplesWithLabel;
-            if (useParallelTrain)
+            std::vector<EpochCriterion> minibatchEvalResults;
+            if (aggregateEachMinibatch)
             {
-                if (m_gradHeader == nullptr)
-                {
-                    m_gradHeader.reset(DistGradHeader::Create(evalNodes.size()), [](DistGradHeader* ptr) {
-                        DistGradHeader::Destroy(ptr);
-                    });
-
-                    if (Globals::UseV2Aggregator())
-                        m_distGradAgg = make_shared<V2SimpleDistGradAggregator<ElemType>>(m_mpi, false /*useAsyncAggregation*/, m_net->GetDeviceId(), 0 /*syncStatsTrace*/, ::CNTK::MPICommunicator());
-                    else 
-                        m_distGradAgg = make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, false /*useAsyncAggregation*/, m_net->GetDeviceId(), 0 /*syncStatsTrace*/);
-                }
-
-                m_gradHeader->numEvalNode = evalNodes.size();
-                m_gradHeader->numSamples = actualMBSize;
-                m_gradHeader->numSamplesWithLabel = numSamplesWithLabel;
-                m_gradHeader->criterion = 0.0; // (not used here)
                 for (size_t i = 0; i < evalNodes.size(); i++)
-                    m_gradHeader->evalErrors[i] = localEpochEvalErrors.Assign(i, numSamplesWithLabel).GetCriterion(i);
+                    localEpochEvalErrors.Assign(i, numSamplesWithLabel);
+                localEpochEvalErrors.GetCriteria(minibatchEvalResults);
 
-                // TODO: We are reusing the aggregation logic inside SimpleDistGradAggregator, which has a heavy dependency
-                // on the gradient matrix. At some point we should refactor the aggregator class to be able to only calculating
-                // eval results and then remove this hack.
-                if (learnParamsGradients.size() == 0)
-                {
-                    Matrix<ElemType>* matrix = new Matrix<ElemType>((DEVICEID_TYPE)m_net->GetDeviceId());
-                    learnParamsGradients.push_back(matrix);
-                }
-
-                // Using SimpleDistAggregator for eval results only. At some point we should rename the class to be just
-                // IDistAggregator and SimpleDistAggregator.
-                bool samplesProcessed = m_distGradAgg->AggregateGradients(learnParamsGradients, m_gradHeader.get(), /*resetState =*/ false);
+                bool samplesProcessed = AggregateEvalResults(evalNodes, actualMBSize, numSamplesWithLabel, minibatchEvalResults, learnParamsGradients);
                 noMoreSamplesToProcess = !samplesProcessed;
 
                 aggregateNumSamplesWithLabel = m_gradHeader->numSamplesWithLabel;
@@ -217,16 +199,18 @@ public:
                 if (actualMBSize != 0)
                 {
                     for (int i = 0; i < evalNodes.size(); i++)
-                    {
                         localEpochEvalErrors.Assign(i, numSamplesWithLabel);
+                    localEpochEvalErrors.GetCriteria(minibatchEvalResults);
+                    for (int i = 0; i < evalNodes.size(); i++)
+                    {
                         if (ContainsAccumulatedResult(evalNodes[i]))
                         {
                             // We don't accumulate error in epoch criterion as this node has already accumulated error
                             // for all samples that passed through network in forward pass.
-                            evalResults[i] = localEpochEvalErrors.GetCriterion(i);
+                            evalResults[i] = minibatchEvalResults[i];
                         }
                         else
-                            evalResults[i] += localEpochEvalErrors.GetCriterion(i);
+                            evalResults[i] += minibatchEvalResults[i];
                     }
                 }
             }
@@ -272,6 +256,22 @@ public:
             DisplayEvalStatistics(numMBsRunLastLogged + 1, numMBsRun, numSamplesLastLogged, evalNodes, evalResults, evalResultsLastLogged);
         }
 
+        if (useParallelTrain && !aggregateEachMinibatch)
+        {
+            // the workers have evaluated disjoint parts of the data (the progress shown above was this worker's part)
+            if (AggregateEvalResults(evalNodes, totalEpochSamples, totalEpochSamples, evalResults, learnParamsGradients))
+            {
+                totalEpochSamples = m_gradHeader->numSamplesWithLabel;
+                for (size_t i = 0; i < evalResults.size(); i++)
+                {
+                    if (!ContainsAccumulatedResult(evalNodes[i])) // (these are aggregated below)
+                        evalResults[i] = m_gradHeader->evalErrors[i];
+                }
+            }
+        }
+        for (auto matrix : learnParamsGradients)
+            delete matrix;
+
         if (useParallelTrain && !evalNodesWhichAccumulateResult.empty())
         {
             // Each worker contains accumulated values for part of the data set, we have to aggregate accumulated values
@@ -291,6 +291,52 @@ public:
     }
 
 protected:
+    bool HasShardedNodes(const vector<ComputationNodeBasePtr>& evalNodes) const
+    {
+        for (const auto& evalNode : evalNodes)
+            for (const auto& node : m_net->GetAllNodesForRoot(evalNode))
+                if (dynamic_pointer_cast<IShardedNode>(node))
+                    return true;
+        return false;
+    }
+
+    // Sums the evaluation results of all workers into m_gradHeader. Returns false if no worker processed any samples.
+    bool AggregateEvalResults(const vector<ComputationNodeBasePtr>& evalNodes, size_t numSamples, size_t numSamplesWithLabel,
+                              const std::vector<EpochCriterion>& localEvalResults, std::vector<Matrix<ElemType>*>& learnParamsGradients)
+    {
+        if (m_gradHeader == nullptr)
+        {
+            m_gradHeader.reset(DistGradHeader::Create(evalNodes.size()), [](DistGradHeader* ptr) {
+                DistGradHeader::Destroy(ptr);
+            });
+
+            if (Globals::UseV2Aggregator())
+                m_distGradAgg = make_shared<V2SimpleDistGradAggregator<ElemType>>(m_mpi, false /*useAsyncAggregation*/, m_net->GetDeviceId(), 0 /*syncStatsTrace*/, ::CNTK::MPICommunicator());
+            else 
+                m_distGradAgg = make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, false /*useAsyncAggregation*/, m_net->GetDeviceId(), 0 /*syncStatsTrace*/);
+        }
+
+        m_gradHeader->numEvalNode = evalNodes.size();
+        m_gradHeader->numSamples = numSamples;
+        m_gradHeader->numSamplesWithLabel = numSamplesWithLabel;
+        m_gradHeader->criterion = 0.0; // (not used here)
+        for (size_t i = 0; i < evalNodes.size(); i++)
+            m_gradHeader->evalErrors[i] = localEvalResults[i];
+
+        // TODO: We are reusing the aggregation logic inside SimpleDistGradAggregator, which has a heavy dependency
+        // on the gradient matrix. At some point we should refactor the aggregator class to be able to only calculating
+        // eval results and then remove this hack.
+        if (learnParamsGradients.size() == 0)
+        {
+            Matrix<ElemType>* matrix = new Matrix<ElemType>((DEVICEID_TYPE)m_net->GetDeviceId());
+            learnParamsGradients.push_back(matrix);
+        }
+
+        // Using SimpleDistAggregator for eval results only. At some point we should rename the class to be just
+        // IDistAggregator and SimpleDistAggregator.
+        return m_distGradAgg->AggregateGradients(learnParamsGradients, m_gradHeader.get(), /*resetState =*/ false);
+    }
+
     void DisplayEvalStatistics(const size_t startMBNum, const size_t endMBNum, const size_t numSamplesLastLogged,
                                const vector<ComputationNodeBasePtr>& evalNodes,
                                const EpochCriterion evalResults, const EpochCriterion evalResultsLastLogged, bool displayConvertedValue = false)
@@ -18,6 +18,7 @@
 #include <cstdio>
 #include "ProgressTracing.h"
 #include "ComputationNetworkBuilder.h"
+#include "AsyncOutputWriter.h"
 
 using namespace std;
 
@@ -30,8 +31,15 @@ class SimpleOutputWriter
     typedef shared_ptr<ComputationNode<ElemType>> ComputationNodePtr;
 
 public:
-    SimpleOutputWriter(ComputationNetworkPtr net, int verbosity = 0)
-        : m_net(net), m_verbosity(verbosity)
+    // With an MPI wrapper and distributed reading, WriteOutput() to an output path has each rank read and write a disjoint
+    // shard of the data, to <outputPath>.<node>.rank<N>. When the shards are merged, the main node then concatenates them
+    // in rank order into <outputPath>.<node>; the sequences are not in reader order then, use writeSequenceKey to index them.
+    // With 'asyncWrite', the outputs of a minibatch are copied to host buffers and written by a separate thread (see
+    // AsyncOutputWriter.h), while the next minibatch is evaluated.
+    SimpleOutputWriter(ComputationNetworkPtr net, int verbosity = 0, const MPIWrapperPtr& mpi = nullptr, bool enableDistributedMBReading = false, bool mergeDistributedOutputs = true,
+                       bool asyncWrite = false)
+        : m_net(net), m_verbosity(verbosity), m_mpi(mpi), m_enableDistributedMBReading(enableDistributedMBReading), m_mergeDistributedOutputs(mergeDistributedOutputs),
+        m_asyncWrite(asyncWrite)
     {
     }
 
@@ -59,6 +67,24 @@ public:
         size_t totalEpochSamples = 0;
         std::map<std::wstring, void*, nocase_compare> outputMatrices;
 
+        // the writer thread hands host copies of the outputs to the data writer
+        unique_ptr<AsyncOutputWriter<ElemType>> asyncWriter;
+        if (m_asyncWrite && !doWriterUnitTest)
+        {
+            asyncWriter = make_unique<AsyncOutputWriter<ElemType>>([&](StagedMinibatch<ElemType>& mb)
+            {
+                std::map<std::wstring, void*, nocase_compare> stagedMatrices;
+                std::vector<unique_ptr<Matrix<ElemType>>> matrices;
+                for (size_t i = 0; i < outputNodes.size(); i++)
+                {
+                    auto& output = mb.outputs[i];
+                    matrices.push_back(make_unique<Matrix<ElemType>>(output.numRows, output.numCols, output.data.get(), CPUDEVICE, matrixFlagDontOwnBuffer));
+                    stagedMatrices[outputNodes[i]->NodeName()] = (void*) matrices.back().get();
+                }
+                dataWriter.SaveData(0, stagedMatrices, mb.actualMBSize, mb.actualMBSize, 0);
+            });
+        }
+
         const size_t numIterationsBeforePrintingProgress = 100;
         size_t numItersSinceLastPrintOfProgress = 0;
         size_t actualMBSize;
@@ -70,7 +96,9 @@ public:
             for (int i = 0; i < outputNodes.size(); i++)
                 outputMatrices[outputNodes[i]->NodeName()] = (void*) (&dynamic_pointer_cast<ComputationNode<ElemType>>(outputNodes[i])->Value());
 
-            if (doWriterUnitTest)
+            if (asyncWriter)
+                asyncWriter->Push(outputNodes, 0, actualMBSize, std::function<std::string(size_t)>());
+            else if (doWriterUnitTest)
             {
                 std::map<std::wstring, void*, nocase_compare> inputMatricesUnitTest;
                 for (auto& iter : inputMatrices)
@@ -89,6 +117,9 @@ public:
             dataReader.DataEnd();
         }
 
+        if (asyncWriter)
+            asyncWriter->Finish();
+
         if (m_verbosity > 0)
             fprintf(stderr, "Total Samples Evaluated = %lu\n", (unsigned long)totalEpochSamples);
 
@@ -130,6 +161,22 @@ public:
             valueFormatString, gradient, false, idToKeyMapping);
     }
 
+    // same for a host copy of the output of a node, see AsyncOutputWriter.h
+    void WriteMinibatch(FILE* f, const std::wstring& nodeName, StagedOutput<ElemType>& output,
+        const WriteFormattingOptions & formattingOptions, std::string valueFormatString, std::vector<std::string>& labelMapping, size_t numMBsRun)
+    {
+        const auto sequenceSeparator = formattingOptions.Processed(nodeName, formattingOptions.sequenceSeparator, numMBsRun);
+        const auto sequencePrologue =  formattingOptions.Processed(nodeName, formattingOptions.sequencePrologue,  numMBsRun);
+        const auto sequenceEpilogue =  formattingOptions.Processed(nodeName, formattingOptions.sequenceEpilogue,  numMBsRun);
+        const auto elementSeparator =  formattingOptions.Processed(nodeName, formattingOptions.elementSeparator,  numMBsRun);
+        const auto sampleSeparator =   formattingOptions.Processed(nodeName, formattingOptions.sampleSeparator,   numMBsRun);
+
+        ComputationNode<ElemType>::WriteMinibatchWithFormatting(f, output.data.get(), output.numRows, output.numCols, output.pMBLayout, output.sampleLayout,
+            FrameRange(), SIZE_MAX, SIZE_MAX, formattingOptions.transpose, formattingOptions.isCategoryLabel, formattingOptions.isSparse, labelMapping,
+            sequenceSeparator, sequencePrologue, sequenceEpilogue, elementSeparator, sampleSeparator,
+            valueFormatString, false, output.GetKeyById());
+    }
+
     void InsertNode(std::vector<ComputationNodeBasePtr>& allNodes, ComputationNodeBasePtr parent, ComputationNodeBasePtr newNode)
     {
         newNode->SetInput(0, parent);
@@ -199,6 +246,19 @@ public:
         if ((formattingOptions.isCategoryLabel || formattingOptions.isSparse) && !formattingOptions.labelMappingFile.empty())
             File::LoadLabelFile(formattingOptions.labelMappingFile, labelMapping);
 
+        // each rank writes its own shard; stdout cannot be sharded
+        bool useDistributedMBReading = m_mpi != nullptr && m_mpi->NumNodesInUse() > 1 && m_enableDistributedMBReading && dataReader.SupportsDistributedMBRead();
+        if (useDistributedMBReading && outputPath == L"-")
+        {
+            fprintf(stderr, "WriteOutput: Distributed reading is disabled for writing to stdout.\n");
+            useDistributedMBReading = false;
+        }
+
+        // binary outputs are written in the format of the CNTKBinaryReader, one file per node
+        bool binary = formattingOptions.isBinary;
+        if (binary && (outputPath == L"-" || nodeUnitTest))
+            InvalidArgument("WriteOutput: Binary output cannot be written to stdout or with nodeUnitTest.");
+
         // open output files
         File::MakeIntermediateDirs(outputPath);
         std::map<ComputationNodeBasePtr, shared_ptr<File>> outputStreams; // TODO: why does unique_ptr not work here? Complains about non-existent default_delete()
@@ -207,19 +267,41 @@ public:
             std::wstring nodeOutputPath = outputPath;
             if (nodeOutputPath != L"-")
                 nodeOutputPath += L"." + onode->NodeName();
-            auto f = make_shared<File>(nodeOutputPath, fileOptionsWrite | fileOptionsText);
+            if (useDistributedMBReading)
+                nodeOutputPath += ShardSuffix(m_mpi->CurrentNodeRank());
+            auto f = make_shared<File>(nodeOutputPath, fileOptionsWrite | (binary ? fileOptionsBinary : fileOptionsText));
             outputStreams[onode] = f;
         }
 
+        // Formatted text of the synchronous writer is flushed after each minibatch. Otherwise we use large buffers,
+        // so that the outputs go to disk in large sequential writes.
+        std::map<ComputationNodeBasePtr, shared_ptr<BinaryOutputFile<ElemType>>> binaryFiles;
+        if ((binary || m_asyncWrite) && outputPath != L"-")
+        {
+            for (auto & stream : outputStreams)
+                setvbuf(*stream.second, nullptr, _IOFBF, 4 * 1024 * 1024);
+        }
+        for (auto & onode : outputNodes)
+        {
+            if (binary)
+                binaryFiles[onode] = make_shared<BinaryOutputFile<ElemType>>(*outputStreams[onode], onode->NodeName());
+        }
+
         // evaluate with minibatches
-        dataReader.StartMinibatchLoop(mbSize, 0, inputMatrices.GetStreamDescriptions(), numOutputSamples);
+        if (useDistributedMBReading)
+            dataReader.StartDistributedMinibatchLoop(mbSize, 0, m_mpi->CurrentNodeRank(), m_mpi->NumNodesInUse(), inputMatrices.GetStreamDescriptions(), numOutputSamples);
+        else
+            dataReader.StartMinibatchLoop(mbSize, 0, inputMatrices.GetStreamDescriptions(), numOutputSamples);
 
         m_net->StartEvaluateMinibatchLoop(outputNodes);
 
         size_t totalEpochSamples = 0;
 
+        // (the prologue and epilogue of sharded outputs are written when merging them)
         for (auto & onode : outputNodes)
         {
+            if (useDistributedMBReading || binary)
+                break;
             FILE* f = *outputStreams[onode];
             fprintfOrDie(f, "%s", formattingOptions.prologue.c_str());
         }
@@ -229,19 +311,44 @@ public:
         size_t numItersSinceLastPrintOfProgress = 0;
         char formatChar = !formattingOptions.isCategoryLabel ? 'f' : !formattingOptions.labelMappingFile.empty() ? 's' : 'u';
         std::string valueFormatString = "%" + formattingOptions.precisionFormat + formatChar; // format string used in fprintf() for formatting the values
+        auto getKeyById = writeSequenceKey ? inputMatrices.m_getKeyById : std::function<std::string(size_t)>();
+
+        // writes the host copy of the outputs of a minibatch, on the writer thread with 'asyncWrite'
+        auto writeStagedMinibatch = [&](StagedMinibatch<ElemType>& mb)
+        {
+            for (size_t i = 0; i < outputNodes.size(); i++)
+            {
+                if (binary)
+                    binaryFiles[outputNodes[i]]->Write(mb.outputs[i]);
+                else
+                    WriteMinibatch(*outputStreams[outputNodes[i]], outputNodes[i]->NodeName(), mb.outputs[i], formattingOptions, valueFormatString, labelMapping, mb.numMBsRun);
+            }
+            if (outputPath == L"-")
+                fprintf(stdout, "\n");
+        };
+        unique_ptr<AsyncOutputWriter<ElemType>> asyncWriter;
+        if (m_asyncWrite && !nodeUnitTest)
+            asyncWriter = make_unique<AsyncOutputWriter<ElemType>>(writeStagedMinibatch);
+        StagedMinibatch<ElemType> stagedMinibatch; // (for binary outputs without 'asyncWrite')
 
-        for (size_t numMBsRun = 0; DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(dataReader, m_net, nullptr, false, false, inputMatrices, actualMBSize, nullptr); numMBsRun++)
+        for (size_t numMBsRun = 0; DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(dataReader, m_net, nullptr, useDistributedMBReading, useDistributedMBReading, inputMatrices, actualMBSize, m_mpi); numMBsRun++)
         {
             ComputationNetwork::BumpEvalTimeStamp(inputNodes);
             m_net->ForwardProp(outputNodes);
 
-            for (auto & onode : outputNodes)
+            if (asyncWriter)
+                asyncWriter->Push(outputNodes, numMBsRun, actualMBSize, getKeyById);
+            else if (binary)
+            {
+                stagedMinibatch.CopyFrom(outputNodes, numMBsRun, actualMBSize, getKeyById);
+                writeStagedMinibatch(stagedMinibatch);
+            }
+            else for (auto & onode : outputNodes)
             {
                 // compute the node value
                 // Note: Intermediate values are memoized, so in case of multiple output nodes, we only compute what has not been computed already.
 
                 FILE* file = *outputStreams[onode];
-                auto getKeyById = writeSequenceKey ? inputMatrices.m_getKeyById : std::function<std::string(size_t)>();
                 WriteMinibatch(file, dynamic_pointer_cast<ComputationNode<ElemType>>(onode), formattingOptions, formatChar, valueFormatString, labelMapping, numMBsRun, /* gradient */ false, getKeyById);
 
                 if (nodeUnitTest)
@@ -267,7 +374,7 @@ public:
             totalEpochSamples += actualMBSize;
 
             fprintf(stderr, "Minibatch[%lu]: ActualMBSize = %lu\n", (unsigned long)numMBsRun, (unsigned long)actualMBSize);
-            if (outputPath == L"-") // if we mush all nodes together on stdout, add some visual separator
+            if (outputPath == L"-" && !asyncWriter) // if we mush all nodes together on stdout, add some visual separator
                 fprintf(stdout, "\n");
 
             numItersSinceLastPrintOfProgress = ProgressTracing::TraceFakeProgress(numIterationsBeforePrintingProgress, numItersSinceLastPrintOfProgress);
@@ -277,22 +384,83 @@ public:
             dataReader.DataEnd();
         } // end loop over minibatches
 
+        if (asyncWriter)
+            asyncWriter->Finish();
+
+        for (auto & binaryFile : binaryFiles)
+            binaryFile.second->Close();
+
         for (auto & stream : outputStreams)
         {
+            if (useDistributedMBReading || binary)
+                break;
             FILE* f = *stream.second;
             fprintfOrDie(f, "%s", formattingOptions.epilogue.c_str());
         }
 
-        fprintf(stderr, "Written to %ls*\nTotal Samples Evaluated = %lu\n", outputPath.c_str(), (unsigned long)totalEpochSamples);
+        if (useDistributedMBReading)
+            fprintf(stderr, "Written to %ls*%ls\nTotal Samples Evaluated = %lu\n", outputPath.c_str(), ShardSuffix(m_mpi->CurrentNodeRank()).c_str(), (unsigned long)totalEpochSamples);
+        else
+            fprintf(stderr, "Written to %ls*\nTotal Samples Evaluated = %lu\n", outputPath.c_str(), (unsigned long)totalEpochSamples);
 
         // flush all files (where we can catch errors) so that we can then destruct the handle cleanly without error
         for (auto & iter : outputStreams)
             iter.second->Flush();
+
+        if (useDistributedMBReading)
+        {
+            outputStreams.clear(); // (close the shards before the main node reads them)
+            if (m_mergeDistributedOutputs && binary)
+                fprintf(stderr, "WriteOutput: Binary output shards are not merged, each is a data file of its own.\n");
+            else if (m_mergeDistributedOutputs)
+                MergeOutputShards(outputPath, allOutputNodes, formattingOptions);
+        }
     }
 
 private:
+    static std::wstring ShardSuffix(size_t rank)
+    {
+        return L".rank" + std::to_wstring(rank);
+    }
+
+    // concatenate the output shards of all ranks, in rank order, on the main node, and delete them
+    void MergeOutputShards(const std::wstring& outputPath, const std::vector<ComputationNodeBasePtr>& nodes, const WriteFormattingOptions& formattingOptions)
+    {
+        m_mpi->WaitAll(); // (all shards are complete)
+        if (m_mpi->IsMainNode())
+        {
+            std::vector<char> buffer(1 << 20);
+            for (auto& node : nodes)
+            {
+                std::wstring nodeOutputPath = outputPath + L"." + node->NodeName();
+                File file(nodeOutputPath, fileOptionsWrite | fileOptionsText);
+                FILE* f = file;
+                fprintfOrDie(f, "%s", formattingOptions.prologue.c_str());
+                for (size_t rank = 0; rank < m_mpi->NumNodesInUse(); rank++)
+                {
+                    std::wstring shardPath = nodeOutputPath + ShardSuffix(rank);
+                    FILE* shard = fopenOrDie(shardPath, L"rt");
+                    for (size_t n; (n = fread(buffer.data(), 1, buffer.size(), shard)) > 0;)
+                        fwriteOrDie(buffer.data(), 1, n, f);
+                    if (ferror(shard))
+                        RuntimeError("MergeOutputShards: Error reading '%ls'.", shardPath.c_str());
+                    fcloseOrDie(shard);
+                    unlinkOrDie(shardPath);
+                }
+                fprintfOrDie(f, "%s", formattingOptions.epilogue.c_str());
+                file.Flush();
+            }
+            fprintf(stderr, "Merged the outputs of %d ranks into %ls*\n", (int)m_mpi->NumNodesInUse(), outputPath.c_str());
+        }
+        m_mpi->WaitAll(); // (the merged outputs are visible to every rank when the command is done)
+    }
+
     ComputationNetworkPtr m_net;
     int m_verbosity;
+    MPIWrapperPtr m_mpi;
+    bool m_enableDistributedMBReading;
+    bool m_mergeDistributedOutputs;
+    bool m_asyncWrite;
     void operator=(const SimpleOutputWriter&); // (not assignable)
 };
 
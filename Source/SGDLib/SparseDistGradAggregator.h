@@ -0,0 +1,218 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "IDistGradAggregator.h"
+#include "TimerUtility.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <numeric>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// SparseDistGradAggregator -- gradient aggregation that only exchanges the largest entries of each gradient
+// Each worker selects either the top-k entries by magnitude (a given fraction of each gradient) or all entries whose
+// magnitude reaches a threshold, and exchanges them as (index, value) pairs; the aggregated gradient is the sum of
+// the entries received from all workers. The entries that are not sent are kept as a residual and added to the next
+// gradient (error feedback), as for quantized aggregation, so that small updates are delayed but not lost. This pays
+// off for models where most of the gradient is close to zero in every minibatch, e.g. for large embeddings.
+// The selection is done in CPU memory.
+template <class ElemType>
+class SparseDistGradAggregator : public IDistGradAggregator<ElemType>
+{
+    UsingIDistGradAggregatorMembers;
+
+public:
+    // Exactly one of topKRatio (fraction of entries to send, in (0,1]) and threshold (minimum magnitude to send) is > 0.
+    SparseDistGradAggregator(const MPIWrapperPtr& mpi, double topKRatio, double threshold, int syncStatsTrace)
+        : IDistGradAggregator<ElemType>(mpi), m_topKRatio(topKRatio), m_threshold(threshold), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0), m_initialized(false)
+    {
+        if ((topKRatio > 0) == (threshold > 0) || topKRatio > 1 || topKRatio < 0 || threshold < 0)
+            InvalidArgument("SparseDistGradAggregator: Either a top-k ratio in (0,1] or a positive threshold must be given.");
+    }
+
+    ~SparseDistGradAggregator()
+    {
+        for (size_t i = 0; i < m_allHeaders.size(); ++i)
+            DistGradHeader::Destroy(m_allHeaders[i]);
+    }
+
+    // Aggregate the gradient matrices across all nodes
+    bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool resetState) override
+    {
+        ResetState(gradients, headerCPU->numEvalNode, resetState);
+        bool showSyncPerfStats = (m_syncStatsTrace > 0) && ((m_iterationCount % m_syncStatsTrace) == 0);
+        m_iterationCount++;
+
+        Timer aggregationTimer;
+        if (showSyncPerfStats)
+            aggregationTimer.Start();
+
+        // If the current node did not process any samples, the gradients should be zero'd; the residuals are still sent.
+        if (headerCPU->numSamples == 0)
+        {
+            for (size_t i = 0; i < gradients.size(); ++i)
+                gradients[i]->SetValue(0);
+        }
+
+        size_t numEntriesSent = 0;
+        size_t numEntries = 0;
+        for (size_t i = 0; i < gradients.size(); ++i)
+        {
+            numEntriesSent += SparsifyAndAggregate(*gradients[i], m_residuals[i]);
+            numEntries += gradients[i]->GetNumElements();
+        }
+
+        AggregateHeaders(headerCPU);
+
+        if (showSyncPerfStats)
+        {
+            aggregationTimer.Stop();
+            double gradientAggregationTime = aggregationTimer.ElapsedSeconds();
+            fprintf(stderr, "Actual gradient aggregation time: %.6g (sparse, sent %d of %d entries = %.2f%%)\n",
+                    gradientAggregationTime, (int)numEntriesSent, (int)numEntries, numEntries == 0 ? 0.0 : 100.0 * numEntriesSent / numEntries);
+        }
+
+        return (headerCPU->numSamples != 0);
+    }
+
+private:
+    void ResetState(const std::vector<Matrix<ElemType>*>& gradients, int numEvalNodes, bool resetState)
+    {
+        if (!m_initialized)
+        {
+            m_initialized = true;
+            for (size_t i = 0; i < gradients.size(); i++)
+            {
+                // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
+                if (gradients[i]->GetMatrixType() != DENSE)
+                    RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
+                // (indices are exchanged as int)
+                if (gradients[i]->GetNumElements() > INT_MAX)
+                    RuntimeError("SparseDistGradAggregator: Gradient matrices with more than %d elements are not supported.", INT_MAX);
+
+                m_residuals.push_back(std::vector<ElemType>(gradients[i]->GetNumElements(), 0));
+            }
+
+            for (size_t i = 0; i < NumProc(); ++i)
+                m_allHeaders.push_back(DistGradHeader::Create(numEvalNodes));
+        }
+        else if (resetState)
+        {
+            for (auto& residual : m_residuals)
+                std::fill(residual.begin(), residual.end(), (ElemType)0);
+        }
+    }
+
+    // add the gradient to the residual, send the selected entries of it, and replace the gradient by the sum of the
+    // entries sent by all workers; returns the number of entries sent by this worker
+    size_t SparsifyAndAggregate(Matrix<ElemType>& gradient, std::vector<ElemType>& residual)
+    {
+        const size_t numElements = gradient.GetNumElements();
+        if (numElements == 0)
+            return 0;
+
+        m_denseBuffer.resize(numElements);
+        gradient.CopySection(gradient.GetNumRows(), gradient.GetNumCols(), m_denseBuffer.data(), gradient.GetNumRows());
+        for (size_t j = 0; j < numElements; j++)
+            residual[j] += m_denseBuffer[j];
+
+        // select the entries to send
+        m_indices.clear();
+        if (m_topKRatio > 0)
+        {
+            size_t k = std::min(numElements, std::max((size_t)1, (size_t)std::ceil(m_topKRatio * numElements)));
+            m_indices.resize(numElements);
+            std::iota(m_indices.begin(), m_indices.end(), 0);
+            if (k < numElements)
+            {
+                std::nth_element(m_indices.begin(), m_indices.begin() + k, m_indices.end(), [&residual](int a, int b)
+                {
+                    return std::abs(residual[a]) > std::abs(residual[b]);
+                });
+                m_indices.resize(k);
+            }
+        }
+        else
+        {
+            for (size_t j = 0; j < numElements; j++)
+                if (std::abs(residual[j]) >= m_threshold)
+                    m_indices.push_back((int)j);
+        }
+        m_values.resize(m_indices.size());
+        for (size_t j = 0; j < m_indices.size(); j++)
+        {
+            m_values[j] = residual[m_indices[j]];
+            residual[m_indices[j]] = 0; // sent, i.e. no longer residual
+        }
+        const size_t numEntriesSent = m_indices.size();
+
+        // exchange the entries, padded to the same count for all workers (index -1)
+        int count = (int)numEntriesSent;
+        std::vector<int> allCounts(NumProc());
+        m_mpi->AllGather(&count, 1, allCounts.data(), 1);
+        size_t maxCount = *std::max_element(allCounts.begin(), allCounts.end());
+        m_indices.resize(maxCount, -1);
+        m_values.resize(maxCount, 0);
+        m_allIndices.resize(maxCount * NumProc());
+        m_allValues.resize(maxCount * NumProc());
+        if (maxCount > 0)
+        {
+            m_mpi->AllGather(m_indices.data(), maxCount, m_allIndices.data(), maxCount);
+            m_mpi->AllGather(m_values.data(), maxCount, m_allValues.data(), maxCount);
+        }
+
+        // sum them up, in rank order so that all workers get identical results
+        std::fill(m_denseBuffer.begin(), m_denseBuffer.end(), (ElemType)0);
+        for (size_t r = 0; r < NumProc(); r++)
+        {
+            for (size_t j = r * maxCount; j < r * maxCount + allCounts[r]; j++)
+                m_denseBuffer[m_allIndices[j]] += m_allValues[j];
+        }
+        gradient.SetValue(gradient.GetNumRows(), gradient.GetNumCols(), gradient.GetDeviceId(), m_denseBuffer.data(), matrixFlagNormal);
+
+        return numEntriesSent;
+    }
+
+    // every worker gets all headers and aggregates them in rank order
+    void AggregateHeaders(DistGradHeader* headerCPU)
+    {
+        size_t headerSize = headerCPU->Size();
+        m_headerBuffer.resize(headerSize * NumProc());
+        m_mpi->Allgather(headerCPU, (int)headerSize, MPI_CHAR, m_headerBuffer.data(), (int)headerSize, MPI_CHAR);
+        for (size_t r = 0; r < NumProc(); r++)
+        {
+            memcpy((void*)m_allHeaders[r], m_headerBuffer.data() + r * headerSize, headerSize);
+            headerCPU->Aggregate(m_allHeaders[r], /*add=*/r > 0);
+        }
+    }
+
+private:
+    const double m_topKRatio;
+    const double m_threshold;
+
+    // entries not sent yet, per gradient
+    std::vector<std::vector<ElemType>> m_residuals;
+
+    // buffers, kept to avoid reallocation
+    std::vector<ElemType> m_denseBuffer;
+    std::vector<int> m_indices;
+    std::vector<ElemType> m_values;
+    std::vector<int> m_allIndices;
+    std::vector<ElemType> m_allValues;
+    std::vector<char> m_headerBuffer;
+    std::vector<DistGradHeader*> m_allHeaders;
+
+    int m_syncStatsTrace;
+
+    // Only used for controlling frequency of measuring/showing gradient aggregation perf stats
+    size_t m_iterationCount;
+
+    bool m_initialized;
+};
+
+} } }
@@ -119,6 +119,19 @@ public:
         if (doreferencealign)
             labels.SetValue((ElemType)(0.0f));
 
+        // With PARALLEL_SIL, the GPU forward-backward works off the device copy of the log LLs passed to setloglls(), and
+        // the host copy in 'pred' is only read by the reference alignment and the numerator score. In that case we skip the
+        // per-utterance device-to-host copy and instead compute the numerator score for the whole minibatch on the device,
+        // as the inner product of the log LLs with a sparse one-hot matrix of the reference senones.
+#ifdef PARALLEL_SIL
+        const bool copyLogLLsToHost = m_deviceid == CPUDEVICE || doreferencealign;
+#else
+        const bool copyLogLLsToHost = true;
+#endif
+        std::vector<CPUSPARSE_INDEX_TYPE> numeratorRowOfColumn; // [column] -> reference senone, or -1 for gaps; only if !copyLogLLsToHost
+        if (!copyLogLLsToHost)
+            numeratorRowOfColumn.assign(numcols, -1);
+
         size_t T = numcols / samplesInRecurrentStep; // number of time steps in minibatch
         if (samplesInRecurrentStep > 1)
         {
@@ -139,10 +152,8 @@ public:
             if (samplesInRecurrentStep == 1) // no sequence parallelism
             {
                 tempmatrix = loglikelihood.ColumnSlice(ts, numframes);
-                // if (m_deviceid == CPUDEVICE)
-                {
+                if (copyLogLLsToHost)
                     CopyFromCNTKMatrixToSSEMatrix(tempmatrix, numframes, predstripe);
-                }
 
                 if (m_deviceid != CPUDEVICE)
                     parallellattice.setloglls(tempmatrix);
@@ -175,10 +186,8 @@ public:
                 Microsoft::MSR::CNTK::Matrix<ElemType> loglikelihoodForCurrentParallelUtterance = loglikelihood.ColumnSlice(mapi + (validframes[mapi] * samplesInRecurrentStep), ((numframes - 1) * samplesInRecurrentStep) + 1);
                 tempmatrix.CopyColumnsStrided(loglikelihoodForCurrentParallelUtterance, numframes, samplesInRecurrentStep, 1);
 
-                // if (doreferencealign || m_deviceid == CPUDEVICE)
-                {
+                if (copyLogLLsToHost)
                     CopyFromCNTKMatrixToSSEMatrix(tempmatrix, numframes, predstripe);
-                }
 
                 if (m_deviceid != CPUDEVICE)
                 {
@@ -196,13 +205,25 @@ public:
                 boundaryframenum = 0;
             array_ref<size_t> boundariesstripe(&boundaries[ts], boundaryframenum);
 
+            // the numerator score is accumulated here from the host copy, or computed on the device after the loop
             double numavlogp = 0;
-            foreach_column (t, dengammasstripe) // we do not allocate memory for numgamma now, should be the same as numgammasstripe
+            if (copyLogLLsToHost)
             {
-                const size_t s = uidsstripe[t];
-                numavlogp += predstripe(s, t) / amf;
+                foreach_column (t, dengammasstripe) // we do not allocate memory for numgamma now, should be the same as numgammasstripe
+                {
+                    const size_t s = uidsstripe[t];
+                    numavlogp += predstripe(s, t) / amf;
+                }
+                numavlogp /= numframes;
+            }
+            else
+            {
+                for (size_t t = 0; t < numframes; t++)
+                {
+                    const size_t col = samplesInRecurrentStep > 1 ? (validframes[mapi] + t) * samplesInRecurrentStep + mapi : ts + t;
+                    numeratorRowOfColumn[col] = (CPUSPARSE_INDEX_TYPE) uidsstripe[t];
+                }
             }
-            numavlogp /= numframes;
 
             // auto_timer dengammatimer;
             double denavlogp = lattices[i]->second.forwardbackward(parallellattice,
@@ -247,6 +268,8 @@ public:
             fprintf(stderr, "dengamma value %f\n", denavlogp);
             ts += numframes;
         }
+        if (!copyLogLLsToHost && ts > 0)
+            objectValue += (ElemType) (NumeratorScore(loglikelihood, numeratorRowOfColumn) / amf);
         functionValues.SetValue(objectValue);
     }
 
@@ -384,6 +407,29 @@ public:
     }
 
 private:
+    // sum of the log LLs of the reference senones, over all frames of the minibatch, computed on the device of 'loglikelihood'
+    // rowOfColumn: [column] -> reference senone, or -1 for gap columns
+    double NumeratorScore(const Microsoft::MSR::CNTK::Matrix<ElemType>& loglikelihood, const std::vector<CPUSPARSE_INDEX_TYPE>& rowOfColumn)
+    {
+        std::vector<CPUSPARSE_INDEX_TYPE> colStarts(rowOfColumn.size() + 1, 0);
+        std::vector<CPUSPARSE_INDEX_TYPE> rows;
+        rows.reserve(rowOfColumn.size());
+        for (size_t j = 0; j < rowOfColumn.size(); j++)
+        {
+            if (rowOfColumn[j] >= 0)
+                rows.push_back(rowOfColumn[j]);
+            colStarts[j + 1] = (CPUSPARSE_INDEX_TYPE) rows.size();
+        }
+        if (rows.empty())
+            return 0;
+        std::vector<ElemType> ones(rows.size(), (ElemType) 1);
+
+        Microsoft::MSR::CNTK::Matrix<ElemType> reference(loglikelihood.GetNumRows(), loglikelihood.GetNumCols(), loglikelihood.GetDeviceId(),
+                                                         Microsoft::MSR::CNTK::MatrixType::SPARSE, Microsoft::MSR::CNTK::matrixFormatSparseCSC);
+        reference.SetMatrixFromCSCFormat(colStarts.data(), rows.data(), ones.data(), rows.size(), loglikelihood.GetNumRows(), loglikelihood.GetNumCols());
+        return (double) Microsoft::MSR::CNTK::Matrix<ElemType>::InnerProductOfMatrices(reference, loglikelihood);
+    }
+
     // Helper methods for copying between ssematrix objects and CNTK matrices
     void CopyFromCNTKMatrixToSSEMatrix(const Microsoft::MSR::CNTK::Matrix<ElemType>& src, size_t numCols, msra::math::ssematrixbase& dest)
     {
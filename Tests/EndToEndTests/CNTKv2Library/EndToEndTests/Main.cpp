@@ -22,6 +22,7 @@ void TrainSequenceToSequenceTranslator();
 void TrainTruncatedLSTMAcousticModelClassifier();
 void TestFrameMode();
 void TestDistributedCheckpointing();
+bool RunPerformanceTests(const std::string& baselinePath, bool updateBaselines);
 
 int main(int argc, char *argv[])
 {
@@ -70,6 +71,14 @@ int main(int argc, char *argv[])
             fclose(stdout);
             return 0;
         }
+        else if ((argc == 3 || (argc == 4 && !std::string(argv[3]).compare("update"))) && !std::string(argv[1]).compare("Performance"))
+        {
+            bool passed = RunPerformanceTests(argv[2], argc == 4);
+            fprintf(stderr, "\nCNTKv2Library-Performance tests: %s\n", passed ? "Passed" : "Failed");
+            fflush(stderr);
+            DistributedCommunicator::Finalize();
+            return passed ? 0 : 1;
+        }
         else
         {
             fprintf(stderr, "Wrong number of arguments.\n");
@@ -0,0 +1,363 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Performance.cpp -- throughput regression suite: 'V2LibraryEndToEndTests Performance <baselineFile> [update]'
+//
+// Trains small image, speech, text, language and data-parallel models, like the other end-to-end tests, on synthetic
+// data with fixed seeds, so that the numbers only depend on the build and the machine. For each model it measures
+//  - time_to_first_minibatch_ms: creating the trainer and training the first minibatch (network compilation, memory
+//    allocation, autotuning),
+//  - samples_per_second: labels per second over the timed minibatches (the median of several repetitions),
+//  - peak_gpu_memory_mb: the device memory in use (by the process and any other one) after the minibatches,
+//  - exposed_communication_ms (distributed model only): the time per minibatch of the data-parallel learner over that
+//    of the local learner, i.e. the gradient aggregation that is not hidden behind the computation.
+// The results are compared with the baseline file, which holds lines 'benchmark metric value', and the test fails if
+// any of them is worse than its baseline by more than the tolerance of the metric. With 'update' the results are
+// written as the new baselines instead. Baselines are specific to a machine and a device, so they are not checked in.
+// Run under mpiexec for the communication of the distributed model; only the first worker compares and writes.
+//
+
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+
+#include "CNTKLibrary.h"
+#include <functional>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include "Common.h"
+#include "Image.h"
+
+using namespace CNTK;
+using namespace std;
+using namespace std::placeholders;
+
+namespace
+{
+    const unsigned long g_randomSeed = 1;
+    const size_t g_numWarmupMinibatches = 5;
+    const size_t g_numTimedMinibatches = 50;
+    const size_t g_numRepetitions = 3;
+    const size_t g_numDistinctMinibatches = 4; // synthetic minibatches, generated up front and cycled through
+
+    struct PerformanceModel
+    {
+        Variable features;
+        Variable labels;
+        FunctionPtr output;
+        FunctionPtr trainingLoss;
+        FunctionPtr prediction;
+        std::vector<std::unordered_map<Variable, ValuePtr>> minibatches;
+    };
+
+    // allowed regression of a metric relative to its baseline, and an absolute slack for small values
+    struct Tolerance
+    {
+        bool higherIsBetter;
+        double relative;
+        double absolute;
+    };
+
+    const std::map<std::string, Tolerance> g_tolerances =
+    {
+        { "samples_per_second",         { true,  0.10, 0.0 } },
+        { "time_to_first_minibatch_ms", { false, 0.25, 50.0 } },
+        { "peak_gpu_memory_mb",         { false, 0.05, 16.0 } },
+        { "exposed_communication_ms",   { false, 0.25, 1.0 } },
+    };
+
+    typedef std::map<std::string, std::map<std::string, double>> PerformanceResults; // benchmark -> metric -> value
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point begin)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    double Median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    std::vector<std::vector<size_t>> FixedLengthOneHotSequences(size_t numSequences, size_t sequenceLength, size_t dim)
+    {
+        return GenerateOneHotSequences(std::vector<size_t>(numSequences, sequenceLength), dim);
+    }
+
+    // a convolutional image classifier on 32x32 RGB images, as CifarResNet but shallower
+    PerformanceModel ImageModel(const DeviceDescriptor& device)
+    {
+        const size_t imageDim = 32, numChannels = 3, numOutputClasses = 10, minibatchSize = 64;
+
+        auto features = InputVariable({ imageDim, imageDim, numChannels }, DataType::Float, L"features", { Axis::DefaultBatchAxis() });
+        auto conv1 = ConvBNReLULayer(features, 32, 3, 3, 1, 1, 0.26, 0, 1, 4096, true, device);
+        auto pool1 = Pooling(ConvBNReLULayer(conv1, 32, 3, 3, 1, 1, 1.414, 0, 1, 4096, true, device), PoolingType::Max, { 3, 3, 1 }, { 2, 2, 1 });
+        auto conv2 = ConvBNReLULayer(pool1, 64, 3, 3, 1, 1, 1.414, 0, 1, 4096, true, device);
+        auto pool2 = Pooling(ConvBNReLULayer(conv2, 64, 3, 3, 1, 1, 1.414, 0, 1, 4096, true, device), PoolingType::Max, { 3, 3, 1 }, { 2, 2, 1 });
+        auto outTimesParams = Parameter({ numOutputClasses, pool2->Output().Shape()[0], pool2->Output().Shape()[1], 64 }, DataType::Float, GlorotUniformInitializer(0.4, 1, 0), device);
+        auto output = Plus(Times(outTimesParams, pool2), Parameter({ numOutputClasses }, 0.0f, device), L"classifierOutput");
+
+        auto labels = InputVariable({ numOutputClasses }, true /*isSparse*/, DataType::Float, L"labels", { Axis::DefaultBatchAxis() });
+        PerformanceModel model{ features, labels, output, CrossEntropyWithSoftmax(output, labels), ClassificationError(output, labels) };
+        for (size_t i = 0; i < g_numDistinctMinibatches; ++i)
+        {
+            std::vector<float> images(imageDim * imageDim * numChannels * minibatchSize);
+            for (auto& value : images)
+                value = (float)rand() / RAND_MAX;
+            std::vector<size_t> classes(minibatchSize);
+            for (auto& value : classes)
+                value = rand() % numOutputClasses;
+            model.minibatches.push_back({ { features, Value::CreateBatch(features.Shape(), images, device, true) },
+                                          { labels, Value::CreateBatch<float>(numOutputClasses, classes, device, true) } });
+        }
+        return model;
+    }
+
+    // a frame classifier of stacked LSTMs on acoustic features, as TruncatedLSTMAcousticModel
+    PerformanceModel SpeechModel(const DeviceDescriptor& device)
+    {
+        const size_t featureDim = 40, numOutputClasses = 132, hiddenDim = 256, cellDim = 512, numLSTMLayers = 2;
+        const size_t numSequences = 16, sequenceLength = 100;
+
+        auto features = InputVariable({ featureDim }, DataType::Float, L"features");
+        auto pastValueRecurrenceHook = [](const Variable& x) { return PastValue(x); };
+        FunctionPtr r = features;
+        for (size_t i = 0; i < numLSTMLayers; ++i)
+            r = LSTMPComponentWithSelfStabilization<float>(r, { hiddenDim }, { cellDim }, pastValueRecurrenceHook, pastValueRecurrenceHook, device).first;
+        auto output = FullyConnectedLinearLayer(r, numOutputClasses, device, L"classifierOutput");
+
+        auto labels = InputVariable({ numOutputClasses }, true /*isSparse*/, DataType::Float, L"labels");
+        PerformanceModel model{ features, labels, output, CrossEntropyWithSoftmax(output, labels), ClassificationError(output, labels) };
+        for (size_t i = 0; i < g_numDistinctMinibatches; ++i)
+        {
+            std::vector<size_t> sequenceLengths(numSequences, sequenceLength);
+            model.minibatches.push_back({ { features, GenerateSequences<float>(sequenceLengths, features.Shape(), device, false) },
+                                          { labels, GenerateSequences<float>(sequenceLengths, labels.Shape(), device, true) } });
+        }
+        return model;
+    }
+
+    // a sequence classifier on sparse words of variable length sequences, as SequenceClassification
+    PerformanceModel TextModel(const DeviceDescriptor& device)
+    {
+        const size_t vocabularySize = 2000, numOutputClasses = 5, embeddingDim = 50, hiddenDim = 25, cellDim = 25;
+        const size_t numSequences = 64, maxSequenceLength = 50;
+
+        auto features = InputVariable({ vocabularySize }, true /*isSparse*/, DataType::Float, L"features");
+        auto output = LSTMSequenceClassifierNet(features, numOutputClasses, embeddingDim, hiddenDim, cellDim, device, L"classifierOutput");
+
+        auto labels = InputVariable({ numOutputClasses }, true /*isSparse*/, DataType::Float, L"labels", { Axis::DefaultBatchAxis() });
+        PerformanceModel model{ features, labels, output, CrossEntropyWithSoftmax(output, labels), ClassificationError(output, labels) };
+        for (size_t i = 0; i < g_numDistinctMinibatches; ++i)
+        {
+            auto sequenceLengths = GenerateSequenceLengths(numSequences, maxSequenceLength);
+            std::vector<size_t> classes(numSequences);
+            for (auto& value : classes)
+                value = rand() % numOutputClasses;
+            model.minibatches.push_back({ { features, GenerateSequences<float>(sequenceLengths, features.Shape(), device, true) },
+                                          { labels, Value::CreateBatch<float>(numOutputClasses, classes, device, true) } });
+        }
+        return model;
+    }
+
+    // a word language model: an LSTM over word embeddings that predicts the next word over the whole vocabulary
+    PerformanceModel LanguageModel(const DeviceDescriptor& device)
+    {
+        const size_t vocabularySize = 10000, embeddingDim = 256, hiddenDim = 512, cellDim = 512;
+        const size_t numSequences = 16, sequenceLength = 40;
+
+        auto features = InputVariable({ vocabularySize }, true /*isSparse*/, DataType::Float, L"features");
+        auto pastValueRecurrenceHook = [](const Variable& x) { return PastValue(x); };
+        auto lstm = LSTMPComponentWithSelfStabilization<float>(Embedding(features, embeddingDim, device), { hiddenDim }, { cellDim }, pastValueRecurrenceHook, pastValueRecurrenceHook, device).first;
+        auto output = FullyConnectedLinearLayer(lstm, vocabularySize, device, L"classifierOutput");
+
+        auto labels = InputVariable({ vocabularySize }, true /*isSparse*/, DataType::Float, L"labels");
+        PerformanceModel model{ features, labels, output, CrossEntropyWithSoftmax(output, labels), ClassificationError(output, labels) };
+        for (size_t i = 0; i < g_numDistinctMinibatches; ++i)
+        {
+            model.minibatches.push_back({ { features, Value::Create<float>(vocabularySize, FixedLengthOneHotSequences(numSequences, sequenceLength, vocabularySize), device, true) },
+                                          { labels, Value::Create<float>(vocabularySize, FixedLengthOneHotSequences(numSequences, sequenceLength, vocabularySize), device, true) } });
+        }
+        return model;
+    }
+
+    // a feed-forward classifier with large layers, i.e. much gradient to aggregate per sample, for the data-parallel learner
+    PerformanceModel FeedForwardModel(const DeviceDescriptor& device)
+    {
+        const size_t inputDim = 512, numOutputClasses = 1000, hiddenLayerDim = 1024, numHiddenLayers = 4, minibatchSize = 256;
+
+        auto features = InputVariable({ inputDim }, DataType::Float, L"features", { Axis::DefaultBatchAxis() });
+        auto output = FullyConnectedFeedForwardClassifierNet(features, numOutputClasses, hiddenLayerDim, numHiddenLayers, device, std::bind(Sigmoid, _1, L""), L"classifierOutput");
+
+        auto labels = InputVariable({ numOutputClasses }, true /*isSparse*/, DataType::Float, L"labels", { Axis::DefaultBatchAxis() });
+        PerformanceModel model{ features, labels, output, CrossEntropyWithSoftmax(output, labels), ClassificationError(output, labels) };
+        for (size_t i = 0; i < g_numDistinctMinibatches; ++i)
+        {
+            std::vector<float> samples(inputDim * minibatchSize);
+            for (auto& value : samples)
+                value = (float)rand() / RAND_MAX;
+            std::vector<size_t> classes(minibatchSize);
+            for (auto& value : classes)
+                value = rand() % numOutputClasses;
+            model.minibatches.push_back({ { features, Value::CreateBatch(features.Shape(), samples, device, true) },
+                                          { labels, Value::CreateBatch<float>(numOutputClasses, classes, device, true) } });
+        }
+        return model;
+    }
+
+    // the metrics of training 'model' with the learner made by 'createLearner', and its time per minibatch
+    std::map<std::string, double> MeasureTraining(PerformanceModel& model, const std::function<LearnerPtr(const std::vector<Parameter>&)>& createLearner,
+                                                  const DeviceDescriptor& device, double& millisecondsPerMinibatch)
+    {
+        std::map<std::string, double> metrics;
+
+        auto begin = std::chrono::steady_clock::now();
+        auto trainer = CreateTrainer(model.output, model.trainingLoss, model.prediction, { createLearner(model.output->Parameters()) });
+        trainer->TrainMinibatch(model.minibatches[0], device);
+        trainer->PreviousMinibatchLossAverage(); // (waits for the computation)
+        metrics["time_to_first_minibatch_ms"] = MillisecondsSince(begin);
+
+        for (size_t i = 1; i < g_numWarmupMinibatches; ++i)
+            trainer->TrainMinibatch(model.minibatches[i % model.minibatches.size()], device);
+        trainer->PreviousMinibatchLossAverage();
+
+        std::vector<double> samplesPerSecond, minibatchMilliseconds;
+        for (size_t repetition = 0; repetition < g_numRepetitions; ++repetition)
+        {
+            size_t numSamples = 0;
+            begin = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < g_numTimedMinibatches; ++i)
+            {
+                trainer->TrainMinibatch(model.minibatches[i % model.minibatches.size()], device);
+                numSamples += trainer->PreviousMinibatchSampleCount();
+            }
+            trainer->PreviousMinibatchLossAverage();
+            const double milliseconds = MillisecondsSince(begin);
+            samplesPerSecond.push_back(numSamples * 1000.0 / milliseconds);
+            minibatchMilliseconds.push_back(milliseconds / g_numTimedMinibatches);
+        }
+        metrics["samples_per_second"] = Median(samplesPerSecond);
+        millisecondsPerMinibatch = Median(minibatchMilliseconds);
+
+        if (device.Type() == DeviceKind::GPU)
+            metrics["peak_gpu_memory_mb"] = (double)Internal::GetGPUMemoryUsedInMBs(device);
+
+        return metrics;
+    }
+
+    LearnerPtr PerformanceLearner(const std::vector<Parameter>& parameters)
+    {
+        return MomentumSGDLearner(parameters, LearningRatePerSampleSchedule(0.0005), MomentumAsTimeConstantSchedule(256), /*unitGainMomentum = */true);
+    }
+
+    PerformanceResults RunPerformanceBenchmarks(const DeviceDescriptor& device)
+    {
+        const std::vector<std::pair<std::string, std::function<PerformanceModel(const DeviceDescriptor&)>>> benchmarks =
+        {
+            { "image/convnet", ImageModel },
+            { "speech/lstm", SpeechModel },
+            { "text/lstm-classifier", TextModel },
+            { "lm/lstm", LanguageModel },
+        };
+
+        PerformanceResults results;
+        double millisecondsPerMinibatch;
+        for (const auto& benchmark : benchmarks)
+        {
+            fprintf(stderr, "Running performance benchmark %s.\n", benchmark.first.c_str());
+            Internal::SetFixedRandomSeed(g_randomSeed);
+            srand(g_randomSeed);
+            auto model = benchmark.second(device);
+            results[benchmark.first] = MeasureTraining(model, PerformanceLearner, device, millisecondsPerMinibatch);
+        }
+
+        // The same model and data with the local and the data-parallel learner.
+        fprintf(stderr, "Running performance benchmark distributed/feedforward.\n");
+        Internal::SetFixedRandomSeed(g_randomSeed);
+        srand(g_randomSeed);
+        auto model = FeedForwardModel(device);
+        double localMillisecondsPerMinibatch;
+        MeasureTraining(model, PerformanceLearner, device, localMillisecondsPerMinibatch);
+        auto communicator = MPICommunicator();
+        auto& metrics = results["distributed/feedforward"];
+        metrics = MeasureTraining(model, [communicator](const std::vector<Parameter>& parameters) -> LearnerPtr
+        {
+            return CreateDataParallelDistributedLearner(communicator, PerformanceLearner(parameters), 0);
+        }, device, millisecondsPerMinibatch);
+        metrics["exposed_communication_ms"] = (std::max)(0.0, millisecondsPerMinibatch - localMillisecondsPerMinibatch);
+
+        return results;
+    }
+
+    PerformanceResults ReadBaselines(const std::string& path)
+    {
+        PerformanceResults baselines;
+        std::ifstream stream(path);
+        std::string benchmark, metric;
+        double value;
+        while (stream >> benchmark >> metric >> value)
+            baselines[benchmark][metric] = value;
+        return baselines;
+    }
+
+    void WriteResults(const PerformanceResults& results, FILE* f)
+    {
+        for (const auto& benchmark : results)
+            for (const auto& metric : benchmark.second)
+                fprintf(f, "%s %s %.6g\n", benchmark.first.c_str(), metric.first.c_str(), metric.second);
+    }
+
+    // the number of results that are worse than their baselines by more than the tolerance
+    size_t CompareWithBaselines(const PerformanceResults& results, const PerformanceResults& baselines)
+    {
+        size_t numRegressions = 0;
+        for (const auto& benchmark : results)
+        {
+            for (const auto& metric : benchmark.second)
+            {
+                auto baselineBenchmark = baselines.find(benchmark.first);
+                if (baselineBenchmark == baselines.end() || baselineBenchmark->second.find(metric.first) == baselineBenchmark->second.end())
+                {
+                    fprintf(stderr, "%-24s %-28s %12.6g (no baseline)\n", benchmark.first.c_str(), metric.first.c_str(), metric.second);
+                    continue;
+                }
+
+                const double baseline = baselineBenchmark->second.at(metric.first);
+                const auto& tolerance = g_tolerances.at(metric.first);
+                const double allowed = (std::max)(tolerance.relative * baseline, tolerance.absolute);
+                const bool regressed = tolerance.higherIsBetter ? metric.second < baseline - allowed : metric.second > baseline + allowed;
+                fprintf(stderr, "%-24s %-28s %12.6g baseline %12.6g (%+.1f%%)%s\n", benchmark.first.c_str(), metric.first.c_str(), metric.second, baseline,
+                        baseline != 0 ? 100 * (metric.second - baseline) / baseline : 0.0, regressed ? " REGRESSION" : "");
+                if (regressed)
+                    numRegressions++;
+            }
+        }
+        return numRegressions;
+    }
+}
+
+// Returns false if any of the results has regressed.
+bool RunPerformanceTests(const std::string& baselinePath, bool updateBaselines)
+{
+    auto device = DeviceDescriptor::UseDefaultDevice();
+    auto results = RunPerformanceBenchmarks(device);
+
+    if (MPICommunicator()->CurrentWorker().m_globalRank != 0)
+        return true;
+
+    if (updateBaselines)
+    {
+        FILE* f = fopen(baselinePath.c_str(), "w");
+        if (f == nullptr)
+            ReportFailure("Could not open the baseline file '%s' for writing.", baselinePath.c_str());
+        WriteResults(results, f);
+        fclose(f);
+        fprintf(stderr, "Performance baselines written to '%s'.\n", baselinePath.c_str());
+        return true;
+    }
+
+    size_t numRegressions = CompareWithBaselines(results, ReadBaselines(baselinePath));
+    if (numRegressions > 0)
+        fprintf(stderr, "%d performance results are worse than their baselines.\n", (int)numRegressions);
+    return numRegressions == 0;
+}
@@ -7,6 +7,8 @@
 #include "ComputationNode.h"
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <numeric>
+#include <thread>
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -415,5 +417,305 @@ BOOST_AUTO_TEST_CASE(EvalRNNTest)
     eval->Destroy();
 }
 
+BOOST_AUTO_TEST_CASE(EvalStreamsTest)
+{
+    // A running sum over the frames of a stream, which must continue across the chunks of each stream
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(2) \n"
+        "dh = PastValue(2, o1, timeStep = 1, defaultHiddenActivity = 0) \n"
+        "o1 = Plus(i1, dh) \n"
+        "FeatureNodes = (i1) \n"
+        "outputNodes = (o1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    auto chunk = [](std::vector<float> frames)
+    {
+        Values<float> buffers(1);
+        buffers[0].m_buffer = frames;
+        return buffers;
+    };
+    auto outputsFor = [&](size_t numStreams)
+    {
+        std::vector<Values<float>> outputs;
+        for (size_t s = 0; s < numStreams; s++)
+            outputs.push_back(outputLayouts.CreateBuffers<float>({ 4 }));
+        return outputs;
+    };
+
+    // streams 7 and 3 start with chunks of different lengths
+    std::vector<Values<float>> outputs = outputsFor(2);
+    eval->ForwardPassStreams({ 7, 3 }, { chunk({ 1, 10, 2, 20, 3, 30 }), chunk({ 100, 1000 }) }, outputs);
+    std::vector<float> expected7 = { 1, 10, 3, 30, 6, 60 };
+    std::vector<float> expected3 = { 100, 1000 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputs[0][0].m_buffer.begin(), outputs[0][0].m_buffer.end(), expected7.begin(), expected7.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputs[1][0].m_buffer.begin(), outputs[1][0].m_buffer.end(), expected3.begin(), expected3.end());
+
+    // stream 3 continues together with a new stream 5, in another order
+    outputs = outputsFor(2);
+    eval->ForwardPassStreams({ 5, 3 }, { chunk({ 4, 4 }), chunk({ 1, 1, 2, 2 }) }, outputs);
+    std::vector<float> expected5 = { 4, 4 };
+    expected3 = { 101, 1001, 103, 1003 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputs[0][0].m_buffer.begin(), outputs[0][0].m_buffer.end(), expected5.begin(), expected5.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputs[1][0].m_buffer.begin(), outputs[1][0].m_buffer.end(), expected3.begin(), expected3.end());
+
+    // stream 7 continues alone; ending it and using its id again starts a new stream
+    outputs = outputsFor(1);
+    eval->ForwardPassStreams({ 7 }, { chunk({ 1, 1 }) }, outputs);
+    expected7 = { 7, 61 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputs[0][0].m_buffer.begin(), outputs[0][0].m_buffer.end(), expected7.begin(), expected7.end());
+
+    eval->EndStream(7);
+    eval->ForwardPassStreams({ 7 }, { chunk({ 1, 1 }) }, outputs);
+    expected7 = { 1, 1 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputs[0][0].m_buffer.begin(), outputs[0][0].m_buffer.end(), expected7.begin(), expected7.end());
+
+    eval->Destroy();
+}
+
+BOOST_AUTO_TEST_CASE(EvalForkStreamsTest)
+{
+    // A running sum as in EvalStreamsTest; a forked stream continues from the sum of its source
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(1) \n"
+        "dh = PastValue(1, o1, timeStep = 1, defaultHiddenActivity = 0) \n"
+        "o1 = Plus(i1, dh) \n"
+        "FeatureNodes = (i1) \n"
+        "outputNodes = (o1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    auto chunk = [](std::vector<float> frames)
+    {
+        Values<float> buffers(1);
+        buffers[0].m_buffer = frames;
+        return buffers;
+    };
+    auto outputsFor = [&](size_t numStreams)
+    {
+        std::vector<Values<float>> outputs;
+        for (size_t s = 0; s < numStreams; s++)
+            outputs.push_back(outputLayouts.CreateBuffers<float>({ 2 }));
+        return outputs;
+    };
+
+    std::vector<Values<float>> outputs = outputsFor(2);
+    eval->ForwardPassStreams({ 1, 2 }, { chunk({ 1, 10 }), chunk({ 100 }) }, outputs);
+
+    // stream 3 is started from stream 1, and stream 2 (existing) is overwritten by it as well
+    eval->ForkStreams({ 1, 1 }, { 3, 2 });
+    outputs = outputsFor(3);
+    eval->ForwardPassStreams({ 1, 2, 3 }, { chunk({ 1 }), chunk({ 2 }), chunk({ 3 }) }, outputs);
+    std::vector<float> expected = { 12, 13, 14 };
+    for (size_t s = 0; s < 3; s++)
+        BOOST_CHECK_EQUAL(outputs[s][0].m_buffer[0], expected[s]);
+
+    // streams can swap their states
+    eval->ForkStreams({ 1, 3 }, { 3, 1 });
+    eval->ForwardPassStreams({ 1, 2, 3 }, { chunk({ 0 }), chunk({ 0 }), chunk({ 0 }) }, outputs);
+    expected = { 14, 13, 12 };
+    for (size_t s = 0; s < 3; s++)
+        BOOST_CHECK_EQUAL(outputs[s][0].m_buffer[0], expected[s]);
+
+    BOOST_CHECK_THROW(eval->ForkStreams({ 4 }, { 5 }), std::exception);
+
+    eval->Destroy();
+}
+
+BOOST_AUTO_TEST_CASE(EvalBeamSearchTest)
+{
+    // The scores of the next token are the prefix plus the counts of the tokens so far; token 2 is the end token
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(3) \n"
+        "dh = PastValue(3, o1, timeStep = 1, defaultHiddenActivity = 0) \n"
+        "o1 = Plus(i1, dh) \n"
+        "FeatureNodes = (i1) \n"
+        "outputNodes = (o1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    IBeamSearchDecoder<float>* decoder;
+    GetBeamSearchDecoderF(eval, L"i1", /*beamWidth=*/2, /*maxLength=*/2, /*endToken=*/2, /*applyLogSoftmax=*/false, /*lengthPenalty=*/0, &decoder);
+
+    std::vector<Values<float>> prefixes(2, Values<float>(1));
+    // request 0: the second best first token ends the hypothesis, which leaves a beam of one
+    prefixes[0][0].m_buffer = { 0, -2, -0.5 };
+    // request 1: both first tokens are kept; token 1 can only win the second place from the forked state
+    prefixes[1][0].m_buffer = { 0.5, -0.25, -3 };
+    std::vector<std::vector<BeamSearchHypothesis>> results;
+    decoder->Decode(prefixes, results);
+
+    BOOST_REQUIRE_EQUAL(results.size(), 2);
+    BOOST_REQUIRE_EQUAL(results[0].size(), 2);
+    std::vector<size_t> expected = { 0, 0 };
+    BOOST_CHECK(results[0][0].m_tokens == expected);
+    BOOST_CHECK_EQUAL(results[0][0].m_score, 1);
+    BOOST_CHECK(results[0][1].m_tokens.empty());
+    BOOST_CHECK_EQUAL(results[0][1].m_score, -0.5);
+
+    BOOST_REQUIRE_EQUAL(results[1].size(), 2);
+    BOOST_CHECK(results[1][0].m_tokens == expected);
+    BOOST_CHECK_EQUAL(results[1][0].m_score, 2);
+    expected = { 1, 1 };
+    BOOST_CHECK(results[1][1].m_tokens == expected);
+    BOOST_CHECK_EQUAL(results[1][1].m_score, 0.5);
+
+    decoder->Destroy();
+    eval->Destroy();
+}
+
+BOOST_AUTO_TEST_CASE(EvalBatchingTest)
+{
+    // requests from several threads are batched; each one is a stream of its own, so the running sums must not mix
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(1) \n"
+        "dh = PastValue(1, o1, timeStep = 1, defaultHiddenActivity = 0) \n"
+        "o1 = Plus(i1, dh) \n"
+        "FeatureNodes = (i1) \n"
+        "outputNodes = (o1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    IEvaluateModelBatching<float>* batching;
+    GetEvalBatchingF(eval, /*maxBatchSize=*/4, /*maxLatencyMs=*/10, &batching);
+
+    const size_t numThreads = 8;
+    const size_t numRequests = 10;
+    std::vector<size_t> numWrong(numThreads, 0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < numThreads; i++)
+    {
+        threads.push_back(std::thread([&, i]()
+        {
+            for (size_t k = 0; k < numRequests; k++)
+            {
+                Values<float> inputs(1);
+                inputs[0].m_buffer = { (float)i, (float)k };
+                Values<float> outputs = outputLayouts.CreateBuffers<float>({ 2 });
+                batching->ForwardPass(inputs, outputs);
+                std::vector<float> expected = { (float)i, (float)(i + k) };
+                if (outputs[0].m_buffer != expected)
+                    numWrong[i]++;
+            }
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    for (size_t i = 0; i < numThreads; i++)
+        BOOST_CHECK_EQUAL(numWrong[i], 0);
+
+    std::vector<double> upperBoundsMs;
+    std::vector<size_t> counts;
+    batching->GetLatencyHistogram(upperBoundsMs, counts);
+    BOOST_CHECK_EQUAL(counts.size(), upperBoundsMs.size() + 1);
+    BOOST_CHECK_EQUAL(std::accumulate(counts.begin(), counts.end(), (size_t)0), numThreads * numRequests);
+
+    batching->Destroy();
+    eval->Destroy();
+}
+
+BOOST_AUTO_TEST_CASE(EvalCloneTest)
+{
+    // clones share the parameters and give the same results, also when evaluating concurrently
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(3) \n"
+        "W = Parameter(2, 3, init = \"uniform\", initValueScale = 1) \n"
+        "o1 = Tanh(Times(W, i1)) \n"
+        "FeatureNodes = (i1) \n"
+        "outputNodes = (o1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    Values<float> inputs(1);
+    inputs[0].m_buffer = { 1, 2, 3, -1, 0, 1 };
+    Values<float> expected = outputLayouts.CreateBuffers<float>({ 2 });
+    eval->ForwardPass(inputs, expected);
+
+    const size_t numClones = 4;
+    std::vector<IEvaluateModelExtended<float>*> clones;
+    for (size_t i = 0; i < numClones; i++)
+    {
+        clones.push_back(eval->Clone());
+        clones.back()->StartForwardEvaluation({ outputLayouts[0].m_name });
+    }
+
+    std::vector<size_t> numWrong(numClones, 0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < numClones; i++)
+    {
+        threads.push_back(std::thread([&, i]()
+        {
+            for (size_t k = 0; k < 20; k++)
+            {
+                Values<float> outputs = outputLayouts.CreateBuffers<float>({ 2 });
+                clones[i]->ForwardPass(inputs, outputs);
+                if (outputs[0].m_buffer != expected[0].m_buffer)
+                    numWrong[i]++;
+            }
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    for (size_t i = 0; i < numClones; i++)
+    {
+        BOOST_CHECK_EQUAL(numWrong[i], 0);
+        clones[i]->Destroy();
+    }
+
+    // the original still works after its clones are gone
+    Values<float> outputs = outputLayouts.CreateBuffers<float>({ 2 });
+    eval->ForwardPass(inputs, outputs);
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputs[0].m_buffer.begin(), outputs[0].m_buffer.end(), expected[0].m_buffer.begin(), expected[0].m_buffer.end());
+
+    eval->Destroy();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }}}}
@@ -0,0 +1,140 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Benchmark.cpp -- harness for the kernel micro-benchmarks of MathPerformanceTests, see Benchmark.h
+//
+
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "MatrixQuantizerImpl.h" // for MatrixComputeStreamEvent
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <memory>
+#include <numeric>
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Benchmarks {
+
+static void SynchronizeDevice(DEVICEID_TYPE deviceId)
+{
+    unique_ptr<MatrixComputeStreamEvent> event(MatrixComputeStreamEvent::Create(deviceId));
+    event->SynchronizeEvent();
+}
+
+string BenchmarkRunner::DeviceName(DEVICEID_TYPE deviceId)
+{
+    return deviceId < 0 ? "cpu" : "gpu" + to_string(deviceId);
+}
+
+bool BenchmarkRunner::IsSelected(const string& name, const string& shape) const
+{
+    return m_options.filter.empty() || (name + "/" + shape).find(m_options.filter) != string::npos;
+}
+
+void BenchmarkRunner::Run(const string& name, const string& shape, DEVICEID_TYPE deviceId, const char* elemType,
+                          double flops, double bytes, const function<void()>& fn)
+{
+    if (!IsSelected(name, shape))
+        return;
+
+    fprintf(stderr, "%-32s %-24s %-5s ", name.c_str(), shape.c_str(), DeviceName(deviceId).c_str());
+    vector<double> times; // in ms
+    try
+    {
+        for (size_t i = 0; i < m_options.warmupIterations; i++)
+            fn();
+        SynchronizeDevice(deviceId);
+
+        double totalSeconds = 0;
+        while (times.size() < m_options.minIterations || totalSeconds < m_options.minSeconds)
+        {
+            auto begin = chrono::high_resolution_clock::now();
+            fn();
+            SynchronizeDevice(deviceId);
+            double seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - begin).count();
+            times.push_back(seconds * 1000);
+            totalSeconds += seconds;
+        }
+    }
+    catch (const exception& e)
+    {
+        fprintf(stderr, "skipped: %s\n", e.what());
+        return;
+    }
+
+    BenchmarkResult result;
+    result.name = name;
+    result.shape = shape;
+    result.device = DeviceName(deviceId);
+    result.elemType = elemType;
+    result.iterations = times.size();
+    result.meanMs = accumulate(times.begin(), times.end(), 0.0) / times.size();
+    double sumSqDiff = 0;
+    for (double t : times)
+        sumSqDiff += (t - result.meanMs) * (t - result.meanMs);
+    result.stddevMs = sqrt(sumSqDiff / times.size());
+    sort(times.begin(), times.end());
+    result.minMs = times.front();
+    result.medianMs = times[times.size() / 2];
+    result.gflops = flops / (result.meanMs * 1e6);
+    result.gbytesPerSec = bytes / (result.meanMs * 1e6);
+    m_results.push_back(result);
+
+    fprintf(stderr, "%10.4f ms (median %.4f, min %.4f)", result.meanMs, result.medianMs, result.minMs);
+    if (result.gflops > 0)
+        fprintf(stderr, " %9.2f GFLOP/s", result.gflops);
+    if (result.gbytesPerSec > 0)
+        fprintf(stderr, " %8.2f GB/s", result.gbytesPerSec);
+    fprintf(stderr, "\n");
+}
+
+void BenchmarkRunner::WriteCsv(FILE* f) const
+{
+    fprintf(f, "name,shape,device,elemType,iterations,meanMs,medianMs,minMs,stddevMs,gflops,gbytesPerSec\n");
+    for (const auto& r : m_results)
+        fprintf(f, "%s,%s,%s,%s,%d,%.6f,%.6f,%.6f,%.6f,%.3f,%.3f\n", r.name.c_str(), r.shape.c_str(), r.device.c_str(), r.elemType.c_str(),
+                (int)r.iterations, r.meanMs, r.medianMs, r.minMs, r.stddevMs, r.gflops, r.gbytesPerSec);
+}
+
+void BenchmarkRunner::WriteJson(FILE* f) const
+{
+    // (names and shapes only contain characters that need no escaping)
+    char date[32];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    fprintf(f, "{\n  \"date\": \"%s\",\n  \"benchmarks\": [", date);
+    for (size_t i = 0; i < m_results.size(); i++)
+    {
+        const auto& r = m_results[i];
+        fprintf(f, "%s\n    { \"name\": \"%s\", \"shape\": \"%s\", \"device\": \"%s\", \"elemType\": \"%s\", \"iterations\": %d, "
+                   "\"meanMs\": %.6f, \"medianMs\": %.6f, \"minMs\": %.6f, \"stddevMs\": %.6f, \"gflops\": %.3f, \"gbytesPerSec\": %.3f }",
+                i == 0 ? "" : ",", r.name.c_str(), r.shape.c_str(), r.device.c_str(), r.elemType.c_str(), (int)r.iterations,
+                r.meanMs, r.medianMs, r.minMs, r.stddevMs, r.gflops, r.gbytesPerSec);
+    }
+    fprintf(f, "\n  ]\n}\n");
+}
+
+void BenchmarkRunner::WriteResults() const
+{
+    FILE* f = stdout;
+    if (!m_options.outputPath.empty())
+    {
+        f = fopen(m_options.outputPath.c_str(), "w");
+        if (!f)
+            RuntimeError("Cannot open '%s' for writing the benchmark results.", m_options.outputPath.c_str());
+    }
+
+    if (m_options.format == "json")
+        WriteJson(f);
+    else
+        WriteCsv(f);
+
+    if (f != stdout)
+        fclose(f);
+}
+
+}}}}
@@ -0,0 +1,87 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Benchmark.h -- harness for the kernel micro-benchmarks of MathPerformanceTests
+//
+// Each benchmark times a single kernel launch (or a short fixed sequence of them) on one device. It is run a few
+// times to warm up (autotuners, caches, allocations), and then at least a minimum number of times and for at least
+// a minimum time. The device is synchronized after every iteration, so the times include the launch overhead,
+// which is what small kernels in a network see. The results are written as CSV or JSON, one record per benchmark,
+// with stable names (e.g. "gemm/dense", "1024x1024x1024", "gpu0"), so that they can be compared across releases.
+//
+
+#pragma once
+
+#include "Matrix.h"
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Benchmarks {
+
+struct BenchmarkOptions
+{
+    std::vector<DEVICEID_TYPE> devices;  // devices to run on; CPUDEVICE for the CPU
+    std::string filter;                  // only run the benchmarks whose "name/shape" contains this (all if empty)
+    size_t warmupIterations;
+    size_t minIterations;
+    double minSeconds;                   // run for at least minIterations iterations and minSeconds seconds
+    std::string format;                  // "csv" or "json"
+    std::string outputPath;              // stdout if empty
+
+    BenchmarkOptions() : devices{ CPUDEVICE }, warmupIterations(3), minIterations(10), minSeconds(0.5), format("csv")
+    {
+    }
+};
+
+struct BenchmarkResult
+{
+    std::string name;       // kernel, e.g. "gemm/dense" or "conv/forward/cudnn"
+    std::string shape;      // problem size, e.g. "1024x1024x1024"
+    std::string device;     // "cpu" or "gpu<n>"
+    std::string elemType;   // "float", "double" or "int16"
+    size_t iterations;
+    double meanMs;
+    double medianMs;
+    double minMs;
+    double stddevMs;
+    double gflops;          // per second, from the mean time; 0 if the benchmark did not give an operation count
+    double gbytesPerSec;    // memory traffic per second, from the mean time; 0 if not given
+};
+
+class BenchmarkRunner
+{
+public:
+    BenchmarkRunner(const BenchmarkOptions& options) : m_options(options)
+    {
+    }
+
+    const BenchmarkOptions& Options() const { return m_options; }
+
+    bool IsSelected(const std::string& name, const std::string& shape) const;
+
+    // Time fn, which runs one iteration of the kernel on deviceId. flops and bytes are the operations and the
+    // memory traffic of one iteration (0 if not meaningful). A benchmark that throws is reported as skipped.
+    void Run(const std::string& name, const std::string& shape, DEVICEID_TYPE deviceId, const char* elemType,
+             double flops, double bytes, const std::function<void()>& fn);
+
+    const std::vector<BenchmarkResult>& Results() const { return m_results; }
+
+    // write the results in the format given by the options, to the output file or stdout
+    void WriteResults() const;
+    void WriteCsv(FILE* f) const;
+    void WriteJson(FILE* f) const;
+
+    static std::string DeviceName(DEVICEID_TYPE deviceId);
+
+private:
+    BenchmarkOptions m_options;
+    std::vector<BenchmarkResult> m_results;
+};
+
+// the benchmarks, see MathBenchmarks.cpp
+void RunMathBenchmarks(BenchmarkRunner& runner);
+
+}}}}
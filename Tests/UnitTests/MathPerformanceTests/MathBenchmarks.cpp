@@ -0,0 +1,423 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// MathBenchmarks.cpp -- the kernel micro-benchmarks of MathPerformanceTests, see Benchmark.h
+//
+// The shapes are representative of the layers of common networks (feed-forward and recurrent layers of speech and
+// language models, ResNet convolutions, embeddings). Names and shapes are part of the output format, so do not
+// rename them; add new entries instead.
+//
+
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "TensorView.h"
+#include "ConvolutionEngine.h"
+#include "BatchNormalizationEngine.h"
+#include "QuantizedOperations.h"
+#include "RNNCommon.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Benchmarks {
+
+template <class ElemType> static const char* ElemTypeName();
+template <> const char* ElemTypeName<float>()  { return "float"; }
+template <> const char* ElemTypeName<double>() { return "double"; }
+
+static string ShapeString(const vector<size_t>& dims)
+{
+    ostringstream s;
+    for (size_t i = 0; i < dims.size(); i++)
+        s << (i == 0 ? "" : "x") << dims[i];
+    return s.str();
+}
+
+template <class ElemType>
+static shared_ptr<Matrix<ElemType>> RandomMatrix(size_t rows, size_t cols, DEVICEID_TYPE deviceId, int randomSeed)
+{
+    mt19937 rng(randomSeed);
+    uniform_real_distribution<float> nd(-1, 1);
+    vector<ElemType> init(rows * cols);
+    generate(init.begin(), init.end(), [&] { return (ElemType)nd(rng); });
+    return make_shared<Matrix<ElemType>>(rows, cols, init.data(), deviceId, matrixFlagNormal);
+}
+
+// -----------------------------------------------------------------------
+// GEMM: dense, dense x sparse, and quantized (BlockMultiplier)
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+static void GemmBenchmarks(BenchmarkRunner& runner, DEVICEID_TYPE deviceId)
+{
+    // C[m,n] = A[m,k] * B[k,n], and the products of the backward pass (transposed A or B)
+    struct GemmShape { size_t m, k, n; bool transposeA, transposeB; };
+    const GemmShape shapes[] = {
+        { 1024, 1024, 1024, false, false },
+        { 4096, 4096, 128,  false, false }, // wide feed-forward layer, minibatch of 128
+        { 4096, 4096, 128,  true,  false }, // its gradient with respect to the input
+        { 4096, 128,  4096, false, true  }, // its gradient with respect to the weights
+        { 512,  2048, 32,   false, false }, // small recurrent step
+        { 2048, 512,  1,    false, false }, // matrix-vector product (inference)
+    };
+    for (const auto& s : shapes)
+    {
+        auto A = RandomMatrix<ElemType>(s.transposeA ? s.k : s.m, s.transposeA ? s.m : s.k, deviceId, 1);
+        auto B = RandomMatrix<ElemType>(s.transposeB ? s.n : s.k, s.transposeB ? s.k : s.n, deviceId, 2);
+        Matrix<ElemType> C(s.m, s.n, deviceId);
+        string shape = ShapeString({ s.m, s.k, s.n }) + (s.transposeA ? "/tA" : "") + (s.transposeB ? "/tB" : "");
+        runner.Run("gemm/dense", shape, deviceId, ElemTypeName<ElemType>(),
+                   2.0 * s.m * s.k * s.n, sizeof(ElemType) * (double)(s.m * s.k + s.k * s.n + s.m * s.n), [&]
+        {
+            Matrix<ElemType>::MultiplyAndWeightedAdd(1, *A, s.transposeA, *B, s.transposeB, 0, C);
+        });
+    }
+
+    // embedding: W[m,V] * X[V,n] with one-hot (or few-hot) sparse columns, and the gradient W += G[m,n] * X^T
+    // The bags of words have skewed column lengths: column j has about nnzPerColumn * (n / 4) / (j + 1) nonzeros (up to
+    // the vocabulary), i.e. a few very long documents and many short ones.
+    struct SparseShape { size_t m, vocabulary, n, nnzPerColumn; bool skewed; };
+    const SparseShape sparseShapes[] = {
+        { 512, 100000, 256, 1, false },
+        { 256, 1000000, 1024, 4, false },
+        { 512, 100000, 256, 64, false }, // bags of words of uniform length
+        { 512, 100000, 256, 64, true },
+    };
+    for (const auto& s : sparseShapes)
+    {
+        vector<size_t> columnLengths(s.n, s.nnzPerColumn);
+        if (s.skewed)
+        {
+            double harmonic = 0;
+            for (size_t j = 0; j < s.n; j++)
+                harmonic += 1.0 / (j + 1);
+            for (size_t j = 0; j < s.n; j++)
+                columnLengths[j] = min(s.vocabulary, max((size_t)1, (size_t)(s.nnzPerColumn * s.n / harmonic / (j + 1))));
+            shuffle(columnLengths.begin(), columnLengths.end(), mt19937(6));
+        }
+        vector<CPUSPARSE_INDEX_TYPE> colStarts(s.n + 1), rows;
+        mt19937 rng(3);
+        for (size_t j = 0; j < s.n; j++)
+        {
+            colStarts[j] = (CPUSPARSE_INDEX_TYPE)rows.size();
+            uniform_int_distribution<size_t> rowDistribution(0, s.vocabulary / columnLengths[j] - 1);
+            for (size_t i = 0; i < columnLengths[j]; i++) // (distinct and increasing within a column)
+                rows.push_back((CPUSPARSE_INDEX_TYPE)(i * (s.vocabulary / columnLengths[j]) + rowDistribution(rng)));
+        }
+        const size_t nz = rows.size();
+        colStarts[s.n] = (CPUSPARSE_INDEX_TYPE)nz;
+        vector<ElemType> values(nz, 1);
+        Matrix<ElemType> X(s.vocabulary, s.n, deviceId, MatrixType::SPARSE, MatrixFormat::matrixFormatSparseCSC);
+        X.SetMatrixFromCSCFormat(colStarts.data(), rows.data(), values.data(), nz, s.vocabulary, s.n);
+
+        auto W = RandomMatrix<ElemType>(s.m, s.vocabulary, deviceId, 4);
+        auto G = RandomMatrix<ElemType>(s.m, s.n, deviceId, 5);
+        Matrix<ElemType> C(s.m, s.n, deviceId);
+        string shape = ShapeString({ s.m, s.vocabulary, s.n }) + "/nnz" + to_string(s.nnzPerColumn) + (s.skewed ? "/skewed" : "");
+        runner.Run("gemm/dense*sparse", shape, deviceId, ElemTypeName<ElemType>(),
+                   2.0 * s.m * nz, sizeof(ElemType) * (double)(s.m * nz + s.m * s.n), [&]
+        {
+            Matrix<ElemType>::MultiplyAndWeightedAdd(1, *W, false, X, false, 0, C);
+        });
+        runner.Run("gemm/dense*sparseT", shape, deviceId, ElemTypeName<ElemType>(),
+                   2.0 * s.m * nz, sizeof(ElemType) * (double)(s.m * nz + s.m * s.n), [&]
+        {
+            Matrix<ElemType>::MultiplyAndWeightedAdd(1, *G, false, X, true, 1, *W);
+        });
+    }
+}
+
+// 16-bit integer products of the quantized evaluation path (CPU only)
+static void QuantizedGemmBenchmarks(BenchmarkRunner& runner)
+{
+    const int shapes[][3] = { { 1024, 1024, 1024 }, { 2048, 512, 1 }, { 512, 2048, 32 } }; // m, k, n
+    auto multiplier = CreateShortBlockMultiplier();
+    const string name = string("gemm/int16/") + multiplier->GetInstructionSetName();
+    for (const auto& s : shapes)
+    {
+        const int m = s[0], k = s[1], n = s[2];
+        mt19937 rng(6);
+        uniform_int_distribution<int> nd(-63, 63);
+        vector<short> A(m * k), B(k * n);
+        generate(A.begin(), A.end(), [&] { return (short)nd(rng); });
+        generate(B.begin(), B.end(), [&] { return (short)nd(rng); });
+        vector<int32_t> C(m * n);
+        short* preparedB = multiplier->PrepareB(B.data(), k, n);
+        runner.Run(name, ShapeString({ (size_t)m, (size_t)k, (size_t)n }), CPUDEVICE, "int16",
+                   2.0 * m * k * n, sizeof(short) * (double)(m * k + k * n) + sizeof(int32_t) * (double)(m * n), [&]
+        {
+            multiplier->Multiply(A.data(), m, k, preparedB, n, C.data());
+        });
+        multiplier->FreePreparedB(preparedB);
+    }
+}
+
+// -----------------------------------------------------------------------
+// TensorView: elementwise unary and binary operations, broadcasting, and reductions
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+static void TensorBenchmarks(BenchmarkRunner& runner, DEVICEID_TYPE deviceId)
+{
+    auto createTensor = [deviceId](const TensorShape& shape, int randomSeed) -> TensorView<ElemType>
+    {
+        return TensorView<ElemType>(RandomMatrix<ElemType>(shape.GetNumElements(), 1, deviceId, randomSeed), shape);
+    };
+
+    const vector<vector<size_t>> elementwiseShapes = { { 1024, 4096 }, { 28, 28, 128, 32 }, { 4096, 1 } };
+    for (const auto& dims : elementwiseShapes)
+    {
+        const TensorShape shape(dims);
+        const double numElements = (double)shape.GetNumElements();
+        auto a = createTensor(shape, 1);
+        auto b = createTensor(shape, 2);
+        auto c = createTensor(shape, 3);
+        runner.Run("tensor/unary/sigmoid", ShapeString(dims), deviceId, ElemTypeName<ElemType>(), numElements, 2 * sizeof(ElemType) * numElements, [&]
+        {
+            c.AssignSigmoidOf(a);
+        });
+        runner.Run("tensor/binary/sum", ShapeString(dims), deviceId, ElemTypeName<ElemType>(), numElements, 3 * sizeof(ElemType) * numElements, [&]
+        {
+            c.AssignSumOf(a, b);
+        });
+        runner.Run("tensor/binary/product", ShapeString(dims), deviceId, ElemTypeName<ElemType>(), numElements, 3 * sizeof(ElemType) * numElements, [&]
+        {
+            c.AssignElementwiseProductOf(a, b);
+        });
+    }
+
+    // layer shape and the shape it is broadcast from / reduced to (bias of a feed-forward and of a convolutional layer)
+    const vector<pair<vector<size_t>, vector<size_t>>> broadcastShapes = {
+        { { 2048, 1024 }, { 2048 } },
+        { { 28, 28, 128, 32 }, { 1, 1, 128 } },
+        { { 56, 56, 64, 32 }, { 1, 1, 64 } },
+        { { 1024, 4096 }, { 1 } }, // (full reduction)
+    };
+    for (const auto& dims : broadcastShapes)
+    {
+        const TensorShape layerShape(dims.first), biasShape(dims.second);
+        const double numElements = (double)layerShape.GetNumElements();
+        const string shape = ShapeString(dims.first) + "/" + ShapeString(dims.second);
+        auto input = createTensor(layerShape, 1);
+        auto bias = createTensor(biasShape, 2);
+        auto result = createTensor(layerShape, 3);
+        runner.Run("tensor/broadcast/sum", shape, deviceId, ElemTypeName<ElemType>(), numElements, 2 * sizeof(ElemType) * numElements, [&]
+        {
+            result.AssignSumOf(input, bias);
+        });
+        runner.Run("tensor/reduce/sum", shape, deviceId, ElemTypeName<ElemType>(), numElements, sizeof(ElemType) * numElements, [&]
+        {
+            bias.DoCopyOf(0, input, 1);
+        });
+    }
+}
+
+// -----------------------------------------------------------------------
+// convolution engines and batch normalization engines
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+static void ConvolutionBenchmarks(BenchmarkRunner& runner, DEVICEID_TYPE deviceId)
+{
+    // input width, height, channels; kernel size; number of maps; stride; minibatch size
+    struct ConvShape { size_t w, h, c, kernel, mapCount, stride, n; };
+    const ConvShape shapes[] = {
+        { 224, 224, 3,   7, 64,  2, 16 }, // ResNet stem
+        { 56,  56,  64,  3, 64,  1, 32 }, // ResNet 3x3
+        { 56,  56,  256, 1, 64,  1, 32 }, // ResNet bottleneck 1x1
+        { 14,  14,  256, 3, 256, 1, 32 },
+    };
+    const pair<ConvolutionEngineKind, const char*> engines[] = {
+        { ConvolutionEngineKind::CuDnn, "cudnn" },
+        { ConvolutionEngineKind::Gemm, "gemm" },
+        { ConvolutionEngineKind::Winograd, "winograd" },
+        { ConvolutionEngineKind::Legacy, "legacy" },
+    };
+    for (const auto& s : shapes)
+    {
+        auto geometry = make_shared<ConvolveGeometry>(TensorShape(s.w, s.h, s.c), TensorShape(s.kernel, s.kernel, s.c), TensorShape(s.mapCount),
+                                                      TensorShape(s.stride, s.stride, s.c), ConvolveGeometry::BoolVec{ true },
+                                                      ConvolveGeometry::BoolVec{ true, true, false }, TensorShape(0), TensorShape(0));
+        const size_t kernelSize = geometry->KernelShape().GetNumElements();
+        const size_t inputSize = geometry->InputShape().GetNumElements();
+        const size_t outputSize = geometry->OutputShape().GetNumElements();
+        const double flops = 2.0 * outputSize * kernelSize * s.n; // (for each of the three passes)
+        const string shape = ShapeString({ s.w, s.h, s.c }) + "/k" + to_string(s.kernel) + "m" + to_string(s.mapCount) + "s" + to_string(s.stride) + "/n" + to_string(s.n);
+
+        auto in = RandomMatrix<ElemType>(inputSize, s.n, deviceId, 1);
+        auto kernel = RandomMatrix<ElemType>(s.mapCount, kernelSize, deviceId, 2);
+        auto srcGrad = RandomMatrix<ElemType>(outputSize, s.n, deviceId, 3);
+        Matrix<ElemType> out(outputSize, s.n, deviceId);
+        Matrix<ElemType> grad(inputSize, s.n, deviceId);
+        Matrix<ElemType> kernelGrad(s.mapCount, kernelSize, deviceId);
+        Matrix<ElemType> workspace(deviceId);
+        for (const auto& engine : engines)
+        {
+            const string name = string("conv/") + engine.second;
+            if (!runner.IsSelected(name + "/forward", shape) && !runner.IsSelected(name + "/backwardData", shape) && !runner.IsSelected(name + "/backwardKernel", shape))
+                continue;
+            if ((engine.first == ConvolutionEngineKind::CuDnn && deviceId < 0) || (engine.first == ConvolutionEngineKind::Winograd && deviceId >= 0))
+                continue; // (cuDNN is GPU only, Winograd CPU only)
+
+            unique_ptr<ConvolutionEngine<ElemType>> eng;
+            try
+            {
+                eng = ConvolutionEngine<ElemType>::Create(geometry, deviceId, ImageLayoutKind::CHW, 0, PoolKind::None, engine.first);
+            }
+            catch (const exception& e)
+            {
+                fprintf(stderr, "%-32s %-24s %-5s skipped: %s\n", name.c_str(), shape.c_str(), BenchmarkRunner::DeviceName(deviceId).c_str(), e.what());
+                continue;
+            }
+            runner.Run(name + "/forward", shape, deviceId, ElemTypeName<ElemType>(), flops, 0, [&]
+            {
+                eng->Forward(*in, *kernel, out, workspace);
+            });
+            runner.Run(name + "/backwardData", shape, deviceId, ElemTypeName<ElemType>(), flops, 0, [&]
+            {
+                eng->BackwardData(*srcGrad, *kernel, grad, /*accumulateGradient=*/false, workspace);
+            });
+            runner.Run(name + "/backwardKernel", shape, deviceId, ElemTypeName<ElemType>(), flops, 0, [&]
+            {
+                eng->BackwardKernel(*srcGrad, *in, kernelGrad, /*accumulateGradient=*/false, /*allowReuse=*/false, workspace);
+            });
+        }
+    }
+}
+
+template <class ElemType>
+static void BatchNormBenchmarks(BenchmarkRunner& runner, DEVICEID_TYPE deviceId)
+{
+    // layer shape, spatial, minibatch size
+    struct BatchNormShape { vector<size_t> dims; bool spatial; size_t n; };
+    const BatchNormShape shapes[] = {
+        { { 56, 56, 64 }, true, 32 },
+        { { 14, 14, 256 }, true, 32 },
+        { { 4096 }, false, 256 },
+    };
+    const pair<BatchNormEngineKind, const char*> engines[] = {
+        { BatchNormEngineKind::CuDnn, "cudnn" },
+        { BatchNormEngineKind::Cntk, "cntk" },
+    };
+    for (const auto& s : shapes)
+    {
+        const TensorShape inOutT(s.dims);
+        const size_t numRows = inOutT.GetNumElements();
+        const size_t numScaleRows = s.spatial ? inOutT[inOutT.GetRank() - 1] : numRows;
+        const double bytes = 2.0 * sizeof(ElemType) * numRows * s.n;
+        const string shape = ShapeString(s.dims) + (s.spatial ? "/spatial" : "") + "/n" + to_string(s.n);
+
+        auto in = RandomMatrix<ElemType>(numRows, s.n, deviceId, 1);
+        auto srcGrad = RandomMatrix<ElemType>(numRows, s.n, deviceId, 2);
+        auto scale = RandomMatrix<ElemType>(numScaleRows, 1, deviceId, 3);
+        auto bias = RandomMatrix<ElemType>(numScaleRows, 1, deviceId, 4);
+        Matrix<ElemType> runMean(numScaleRows, 1, deviceId), runVariance(numScaleRows, 1, deviceId);
+        Matrix<ElemType> saveMean(numScaleRows, 1, deviceId), saveInvStdDev(numScaleRows, 1, deviceId);
+        Matrix<ElemType> scaleGrad(numScaleRows, 1, deviceId), biasGrad(numScaleRows, 1, deviceId);
+        Matrix<ElemType> out(numRows, s.n, deviceId), grad(numRows, s.n, deviceId);
+        runMean.SetValue(0);
+        runVariance.SetValue(1);
+        for (const auto& engine : engines)
+        {
+            if ((engine.first == BatchNormEngineKind::CuDnn) && deviceId < 0)
+                continue;
+            const string name = string("batchnorm/") + engine.second;
+            if (!runner.IsSelected(name + "/forward", shape) && !runner.IsSelected(name + "/backward", shape))
+                continue;
+
+            unique_ptr<BatchNormEngine<ElemType>> eng;
+            try
+            {
+                eng = BatchNormEngine<ElemType>::Create(deviceId, inOutT, s.spatial, ImageLayoutKind::CHW, engine.first);
+            }
+            catch (const exception& e)
+            {
+                fprintf(stderr, "%-32s %-24s %-5s skipped: %s\n", name.c_str(), shape.c_str(), BenchmarkRunner::DeviceName(deviceId).c_str(), e.what());
+                continue;
+            }
+            runner.Run(name + "/forward", shape, deviceId, ElemTypeName<ElemType>(), 0, bytes, [&]
+            {
+                eng->Forward(*in, *scale, *bias, /*inferenceOnly=*/false, /*expAvgFactor=*/1, /*blendFactor=*/0, runMean, runVariance, out, 1e-5, saveMean, saveInvStdDev);
+            });
+            runner.Run(name + "/backward", shape, deviceId, ElemTypeName<ElemType>(), 0, 1.5 * bytes, [&]
+            {
+                eng->Backward(*in, *srcGrad, grad, *scale, /*blendFactor=*/0, saveMean, saveInvStdDev, scaleGrad, biasGrad, /*accumulateDataGrad=*/false);
+            });
+        }
+    }
+}
+
+// -----------------------------------------------------------------------
+// cuDNN RNN (GPU only)
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+static void RNNBenchmarks(BenchmarkRunner& runner, DEVICEID_TYPE deviceId)
+{
+    if (deviceId < 0)
+        return;
+
+    // cell, input dimension, hidden size, layers, bidirectional, sequence length, number of sequences
+    struct RNNShape { const wchar_t* cell; size_t inputDim, hiddenSize, numLayers; bool bidirectional; size_t sequenceLength, numSequences; };
+    const RNNShape shapes[] = {
+        { L"lstm", 512,  512,  2, false, 50,  64 },
+        { L"lstm", 80,   512,  4, true,  200, 32 }, // acoustic model
+        { L"gru",  1024, 1024, 1, false, 20,  128 },
+        { L"lstm", 80,   512,  4, false, 16,  4 },  // streaming evaluation
+    };
+    for (const auto& s : shapes)
+    {
+        const RnnAttributes attributes(s.bidirectional, s.numLayers, s.hiddenSize, s.cell, /*axis=*/-1);
+        const size_t outputDim = s.hiddenSize * (s.bidirectional ? 2 : 1);
+        const size_t numFrames = s.sequenceLength * s.numSequences;
+        const auto numParameters = attributes.GetNumParameters(s.inputDim);
+        const vector<size_t> numSequencesForFrame(s.sequenceLength, s.numSequences);
+        // (each parameter is used in one multiply-add per frame)
+        const double flops = 2.0 * numParameters.first * numParameters.second * numFrames;
+        const string shape = msra::strfun::utf8(s.cell) + "/" + ShapeString({ s.inputDim, s.hiddenSize, s.numLayers }) +
+                             (s.bidirectional ? "/bidirectional" : "") + "/T" + to_string(s.sequenceLength) + "n" + to_string(s.numSequences);
+
+        auto x = RandomMatrix<ElemType>(s.inputDim, numFrames, deviceId, 1);
+        auto w = RandomMatrix<ElemType>(numParameters.first, numParameters.second, deviceId, 2);
+        auto dy = RandomMatrix<ElemType>(outputDim, numFrames, deviceId, 3);
+        Matrix<ElemType> y(outputDim, numFrames, deviceId), dx(s.inputDim, numFrames, deviceId);
+        Matrix<ElemType> dw(numParameters.first, numParameters.second, deviceId);
+        Matrix<ElemType> reserve(deviceId), workspace(deviceId);
+        runner.Run("rnn/cudnn/forward", shape, deviceId, ElemTypeName<ElemType>(), flops, 0, [&]
+        {
+            y.RNNForward(*x, *w, s.inputDim, outputDim, numSequencesForFrame, attributes, reserve, workspace, /*inferenceOnly=*/false);
+        });
+        runner.Run("rnn/cudnn/inference", shape, deviceId, ElemTypeName<ElemType>(), flops, 0, [&]
+        {
+            y.RNNForward(*x, *w, s.inputDim, outputDim, numSequencesForFrame, attributes, reserve, workspace, /*inferenceOnly=*/true);
+        });
+        // (the backward pass needs the reserve of the forward pass of the same minibatch)
+        runner.Run("rnn/cudnn/forward+backward", shape, deviceId, ElemTypeName<ElemType>(), 3 * flops, 0, [&]
+        {
+            y.RNNForward(*x, *w, s.inputDim, outputDim, numSequencesForFrame, attributes, reserve, workspace, /*inferenceOnly=*/false);
+            y.RNNBackwardData(*dy, *w, dx, attributes, reserve, workspace);
+            y.RNNBackwardWeights(*x, y, dw, attributes, reserve, workspace);
+        });
+    }
+}
+
+void RunMathBenchmarks(BenchmarkRunner& runner)
+{
+    for (auto deviceId : runner.Options().devices)
+    {
+        GemmBenchmarks<float>(runner, deviceId);
+        GemmBenchmarks<double>(runner, deviceId);
+        if (deviceId < 0)
+            QuantizedGemmBenchmarks(runner);
+        TensorBenchmarks<float>(runner, deviceId);
+        ConvolutionBenchmarks<float>(runner, deviceId);
+        BatchNormBenchmarks<float>(runner, deviceId);
+        RNNBenchmarks<float>(runner, deviceId);
+    }
+}
+
+}}}}
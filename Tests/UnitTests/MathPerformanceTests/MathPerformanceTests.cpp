@@ -11,6 +11,9 @@
 #include "CPUMatrix.h"
 #include "TensorView.h"
 #include "Sequences.h"
+#include "DataTransferer.h"
+#include "CUDAPageLockedMemAllocator.h"
+#include "Benchmark.h"
 #include <chrono>
 #include <iostream>
 #include <vector>
@@ -336,9 +339,149 @@ void MandSTest(int count, int devId)
     delete[] data3;
 }
 
-int wmain()
+// Measures the per-minibatch latency of setting a sparse (CSC) input matrix on the GPU the way the readers do:
+// asynchronously, through a data transferer, from pinned memory. The host data is either laid out as packed by
+// the readers (values, row indices and column starts back to back, set with a single copy) or in separate arrays.
+template <class ElemType>
+void SparseCSCTransferTest(size_t numRows, size_t numCols, size_t nnzPerColumn, int count, int devId)
+{
+    const size_t nz = numCols * nnzPerColumn;
+    const size_t totalSize = nz * sizeof(ElemType) + (nz + numCols + 1) * sizeof(CPUSPARSE_INDEX_TYPE);
+    char* contiguous = (char*)CUDAPageLockedMemAllocator::Malloc(totalSize, devId);
+    char* separate = (char*)CUDAPageLockedMemAllocator::Malloc(totalSize + 2 * 4096, devId);
+
+    ElemType* values = (ElemType*)contiguous;
+    CPUSPARSE_INDEX_TYPE* rows = (CPUSPARSE_INDEX_TYPE*)(values + nz);
+    CPUSPARSE_INDEX_TYPE* columns = rows + nz;
+    for (size_t j = 0; j < numCols; ++j)
+    {
+        columns[j] = (CPUSPARSE_INDEX_TYPE)(j * nnzPerColumn);
+        for (size_t k = 0; k < nnzPerColumn; ++k)
+        {
+            // distinct, increasing row indices per column
+            rows[j * nnzPerColumn + k] = (CPUSPARSE_INDEX_TYPE)((k * (numRows / nnzPerColumn) + rand() % (numRows / nnzPerColumn)));
+            values[j * nnzPerColumn + k] = (ElemType)((1.0 * rand()) / RAND_MAX);
+        }
+    }
+    columns[numCols] = (CPUSPARSE_INDEX_TYPE)nz;
+
+    // the same data, with gaps between the arrays
+    ElemType* separateValues = (ElemType*)separate;
+    CPUSPARSE_INDEX_TYPE* separateRows = (CPUSPARSE_INDEX_TYPE*)(separate + nz * sizeof(ElemType) + 4096);
+    CPUSPARSE_INDEX_TYPE* separateColumns = (CPUSPARSE_INDEX_TYPE*)((char*)(separateRows + nz) + 4096);
+    memcpy(separateValues, values, nz * sizeof(ElemType));
+    memcpy(separateRows, rows, nz * sizeof(CPUSPARSE_INDEX_TYPE));
+    memcpy(separateColumns, columns, (numCols + 1) * sizeof(CPUSPARSE_INDEX_TYPE));
+
+    auto transferer = CreatePrefetchDataTransferer(devId);
+    Matrix<ElemType> input(numRows, numCols, devId, MatrixType::SPARSE, MatrixFormat::matrixFormatSparseCSC);
+
+    cout << "Sparse input " << numRows << "x" << numCols << " with " << nz << " non-zero elements" << endl;
+    for (int contiguousLayout = 1; contiguousLayout >= 0; --contiguousLayout)
+    {
+        auto t_start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < count; ++i)
+        {
+            if (contiguousLayout)
+                input.SetMatrixFromCSCFormat(columns, rows, values, nz, numRows, numCols, transferer.get());
+            else
+                input.SetMatrixFromCSCFormat(separateColumns, separateRows, separateValues, nz, numRows, numCols, transferer.get());
+            transferer->RecordCPUToGPUCopy();
+            transferer->WaitForCopyCPUToGPU();
+        }
+        auto t_end = std::chrono::high_resolution_clock::now();
+        double perMinibatch = std::chrono::duration<double, std::milli>(t_end - t_start).count() / count;
+        cout << (contiguousLayout ? "Packed layout (single copy): " : "Separate arrays: ") << perMinibatch << " ms per minibatch" << endl;
+    }
+
+    CUDAPageLockedMemAllocator::Free(contiguous, devId);
+    CUDAPageLockedMemAllocator::Free(separate, devId);
+}
+
+static void Usage()
 {
+    fprintf(stderr,
+            "Usage: MathPerformanceTests [options]\n"
+            "Runs the kernel micro-benchmarks (GEMM, TensorView, convolution, batch normalization, cuDNN RNN).\n"
+            "  -device <cpu|gpu<n>|all>   device to run on, may be repeated; 'all' is cpu and gpu0 (default: cpu)\n"
+            "  -filter <text>             only run the benchmarks whose name/shape contains text, e.g. 'gemm/dense'\n"
+            "  -format <csv|json>         format of the results (default: csv)\n"
+            "  -output <path>             file to write the results to (default: stdout; progress goes to stderr)\n"
+            "  -warmup <n>                warm-up iterations (default: 3)\n"
+            "  -iterations <n>            minimum number of timed iterations (default: 10)\n"
+            "  -seconds <s>               minimum time to run each benchmark for (default: 0.5)\n");
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+    Benchmarks::BenchmarkOptions options;
+    bool hasDevice = false;
+    for (int i = 1; i < argc; i++)
+    {
+        const wstring arg = argv[i];
+        if (arg == L"-help" || arg == L"-h" || i + 1 >= argc)
+        {
+            Usage();
+            return arg == L"-help" || arg == L"-h" ? 0 : 1;
+        }
+
+        const string value = msra::strfun::utf8(argv[++i]);
+        if (arg == L"-device")
+        {
+            if (!hasDevice)
+                options.devices.clear();
+            hasDevice = true;
+            if (value == "cpu" || value == "all")
+                options.devices.push_back(CPUDEVICE);
+            if (value == "all")
+                options.devices.push_back(0);
+            else if (value.compare(0, 3, "gpu") == 0)
+                options.devices.push_back(atoi(value.c_str() + 3));
+            else if (value != "cpu")
+            {
+                Usage();
+                return 1;
+            }
+        }
+        else if (arg == L"-filter")
+            options.filter = value;
+        else if (arg == L"-format")
+            options.format = value;
+        else if (arg == L"-output")
+            options.outputPath = value;
+        else if (arg == L"-warmup")
+            options.warmupIterations = (size_t)atoi(value.c_str());
+        else if (arg == L"-iterations")
+            options.minIterations = (size_t)(std::max)(1, atoi(value.c_str()));
+        else if (arg == L"-seconds")
+            options.minSeconds = atof(value.c_str());
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+    if (options.format != "csv" && options.format != "json")
+    {
+        Usage();
+        return 1;
+    }
+
+    try
+    {
+        Benchmarks::BenchmarkRunner runner(options);
+        Benchmarks::RunMathBenchmarks(runner);
+        runner.WriteResults();
+    }
+    catch (const exception& e)
+    {
+        fprintf(stderr, "EXCEPTION occurred: %s\n", e.what());
+        return 1;
+    }
+
+    // the original ad-hoc tests
     // MandSTest<float>(100, 2);
+    // SparseCSCTransferTest<float>(1000000, 2048, 50, 1000, 0);
 
     /*cout<<endl<<"********************Matrix SquareMultiplyAndWeightedAdd10TimesAvg TEST********************"<<endl;
     SquareMultiplyAndAdd10TimesAvgTest<float>(4096,10);
@@ -357,3 +500,17 @@ int wmain()
 
     return 0;
 }
+
+#ifdef __UNIX__
+/// UNIX main function converts arguments in UTF-8 encoding and passes to Visual-Studio style wmain() which takes wchar_t strings.
+int main(int argc, char* argv[])
+{
+    vector<wstring> wargs;
+    for (int i = 0; i < argc; ++i)
+        wargs.push_back(msra::strfun::utf16(argv[i]));
+    vector<wchar_t*> wargv;
+    for (auto& warg : wargs)
+        wargv.push_back(&warg[0]);
+    return wmain(argc, wargv.data());
+}
+#endif
@@ -325,6 +325,56 @@ BOOST_AUTO_TEST_CASE(BatchNormalizationBackward)
     }
 }
 
+BOOST_AUTO_TEST_CASE(BatchNormalizationForwardHWC)
+{
+    std::mt19937 rng(0);
+    boost::random::normal_distribution<float> nd;
+
+    // Spatial batch normalization in HWC layout must give the same results as in CHW layout on the transposed images.
+    int deviceId = -1; // (the CPU implements inference only)
+    for (size_t c : {1, 3, 16})
+    for (size_t w : {1, 5})
+    for (size_t h : {3, 7})
+    for (size_t n : {1, 4})
+    {
+        auto engHwc = BNEng::Create(deviceId, TensorShape(c, w, h), true, ImageLayoutKind::HWC, BatchNormEngineKind::Cntk);
+        auto engChw = BNEng::Create(deviceId, TensorShape(w, h, c), true, ImageLayoutKind::CHW, BatchNormEngineKind::Cntk);
+
+        size_t crow = c * w * h;
+        vec bufHwc(crow * n);
+        std::generate(begin(bufHwc), end(bufHwc), [&] { return nd(rng); });
+        vec bufChw(crow * n);
+        for (size_t s = 0; s < n; s++)
+            for (size_t ic = 0; ic < c; ic++)
+                for (size_t ixy = 0; ixy < w * h; ixy++)
+                    bufChw[s * crow + ixy + ic * w * h] = bufHwc[s * crow + ic + ixy * c];
+        SingleMatrix inHwc(crow, n, bufHwc.data(), deviceId, matrixFlagNormal);
+        SingleMatrix inChw(crow, n, bufChw.data(), deviceId, matrixFlagNormal);
+
+        vec buf(c);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix scale(c, 1, buf.data(), deviceId, matrixFlagNormal);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix bias(c, 1, buf.data(), deviceId, matrixFlagNormal);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix runMean(c, 1, buf.data(), deviceId, matrixFlagNormal);
+        std::generate(begin(buf), end(buf), [&] { return 1 + std::abs(nd(rng)); });
+        SingleMatrix runVariance(c, 1, buf.data(), deviceId, matrixFlagNormal);
+
+        SingleMatrix outHwc(crow, n, deviceId);
+        SingleMatrix outChw(crow, n, deviceId);
+        SingleMatrix saveMean(deviceId);
+        SingleMatrix saveInvStdDev(deviceId);
+        engHwc->Forward(inHwc, scale, bias, true, 0, 1, runMean, runVariance, outHwc, 1e-5, saveMean, saveInvStdDev);
+        engChw->Forward(inChw, scale, bias, true, 0, 1, runMean, runVariance, outChw, 1e-5, saveMean, saveInvStdDev);
+
+        for (size_t s = 0; s < n; s++)
+            for (size_t ic = 0; ic < c; ic++)
+                for (size_t ixy = 0; ixy < w * h; ixy++)
+                    BOOST_REQUIRE_CLOSE(outHwc(ic + ixy * c, s), outChw(ixy + ic * w * h, s), 1e-4f);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
@@ -185,5 +185,77 @@ BOOST_AUTO_TEST_CASE(BlockMultiplyTestAllKFourRowsMultiThread)
     TestMultiplierSub<int16_t, int16_t, int32_t, BlockMultiplier<BlockHandlerSSE>>(4, 128 + 64 + 32 + 16 + 8 + 1, 1, 2);
 }
 
+#ifdef SUPPORT_AVX512
+// Multiplies the same signed matrices with the SSE and the AVX-512 handlers and checks that the results are identical.
+static void TestAVX512AgainstSSE(int m, int k, int n, int numThreads)
+{
+    BlockMultiplier<BlockHandlerSSE> sseMult(numThreads);
+    BlockMultiplier<BlockHandlerAVX512> avx512Mult(numThreads);
+
+    int16_t* A = sseMult.CreateMatrixA(m, k);
+    int16_t* B = sseMult.CreateMatrixB(k, n);
+    int32_t* sseC = sseMult.CreateMatrixC(m, n);
+    int32_t* avx512C = avx512Mult.CreateMatrixC(m, n);
+
+    // [-512, 512) keeps k * 512^2 well inside the 32-bit range
+    RandInitIntMatrix<int16_t>(A, m, k, 1024);
+    RandInitIntMatrix<int16_t>(B, k, n, 1024);
+    for (int i = 0; i < m * k; ++i)
+        A[i] -= 512;
+    for (int i = 0; i < k * n; ++i)
+        B[i] -= 512;
+
+    int16_t* ssePreparedB = sseMult.PrepareB(B, k, n);
+    int16_t* avx512PreparedB = avx512Mult.PrepareB(B, k, n);
+    sseMult.MultiplyMatrices(A, m, k, ssePreparedB, n, sseC);
+    avx512Mult.MultiplyMatrices(A, m, k, avx512PreparedB, n, avx512C);
+
+    CompareMatricesAndDump(sseC, avx512C, m, k, n);
+
+    sseMult.FreeMatrix(A);
+    sseMult.FreeMatrix(B);
+    sseMult.FreeMatrix(sseC);
+    sseMult.FreeMatrix(ssePreparedB);
+    avx512Mult.FreeMatrix(avx512C);
+    avx512Mult.FreeMatrix(avx512PreparedB);
+}
+
+// Test that hits all the kernel functions, including several 128 blocks (single row)
+BOOST_AUTO_TEST_CASE(BlockMultiplyTestAVX512AllKSingleRow)
+{
+    if (!BlockHandlerAVX512::IsSupported())
+    {
+        BOOST_TEST_MESSAGE("AVX-512 is not supported by this processor, skipping.");
+        return;
+    }
+    TestMultiplierSub<int16_t, int16_t, int32_t, BlockMultiplier<BlockHandlerAVX512>>(1, 128 + 64 + 32 + 16 + 8 + 1, 1, 1);
+    TestAVX512AgainstSSE(1, 3 * 128 + 64 + 32 + 16 + 8 + 3, 9, 1);
+}
+
+// Test that hits all the kernel functions, including several 128 blocks (four rows)
+BOOST_AUTO_TEST_CASE(BlockMultiplyTestAVX512AllKFourRows)
+{
+    if (!BlockHandlerAVX512::IsSupported())
+    {
+        BOOST_TEST_MESSAGE("AVX-512 is not supported by this processor, skipping.");
+        return;
+    }
+    TestMultiplierSub<int16_t, int16_t, int32_t, BlockMultiplier<BlockHandlerAVX512>>(4, 128 + 64 + 32 + 16 + 8 + 1, 1, 1);
+    TestAVX512AgainstSSE(20, 3 * 128 + 64 + 32 + 16 + 8 + 3, 9, 1);
+}
+
+BOOST_AUTO_TEST_CASE(BlockMultiplyTestAVX512MultiThread)
+{
+    if (!BlockHandlerAVX512::IsSupported())
+    {
+        BOOST_TEST_MESSAGE("AVX-512 is not supported by this processor, skipping.");
+        return;
+    }
+    TestMultiplierSub<int16_t, int16_t, int32_t, BlockMultiplier<BlockHandlerAVX512>>(8, 128, 8, 2);
+    TestAVX512AgainstSSE(7, 3 * 128 + 64 + 32 + 16 + 8 + 3, 9, 2);
+    TestAVX512AgainstSSE(16, 3 * 128 + 64 + 32 + 16 + 8 + 3, 9, 2);
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
 }}}} //end namespaces
@@ -220,6 +220,75 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrixMultiplyAndDiv, RandomSeedFixture)
     BOOST_CHECK(m3.IsEqualTo(m2));
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUMatrixMultiplyWithPackedA, RandomSeedFixture)
+{
+    SMatrix a = SMatrix::RandomUniform(8, 16, -1, 1, IncrementCounter());
+    SMatrix b = SMatrix::RandomUniform(16, 3, -1, 1, IncrementCounter());
+    SMatrix expected, c;
+    auto packedA = make_shared<PackedGemmCache<float>>();
+
+    // The packed copy of a is reused by the second call
+    SMatrix::MultiplyAndWeightedAdd(1, a, false, b, false, 0, expected);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        SMatrix::MultiplyAndWeightedAdd(1, a, false, b, false, 0, c, nullptr, packedA);
+        BOOST_CHECK(c.IsEqualTo(expected, c_epsilonFloatE4));
+    }
+
+    // alpha and transposition are part of the packing
+    SMatrix::MultiplyAndWeightedAdd(2, a, false, b, false, 0, expected);
+    SMatrix::MultiplyAndWeightedAdd(2, a, false, b, false, 0, c, nullptr, packedA);
+    BOOST_CHECK(c.IsEqualTo(expected, c_epsilonFloatE4));
+
+    SMatrix at = a.Transpose();
+    SMatrix::MultiplyAndWeightedAdd(1, at, true, b, false, 0, expected);
+    SMatrix::MultiplyAndWeightedAdd(1, at, true, b, false, 0, c, nullptr, packedA);
+    BOOST_CHECK(c.IsEqualTo(expected, c_epsilonFloatE4));
+
+    // Writes to a are announced by a new time stamp
+    a.SetValue(0.5f);
+    packedA->SetSourceTimeStamp(1);
+    SMatrix::MultiplyAndWeightedAdd(1, a, false, b, false, 0, expected);
+    SMatrix::MultiplyAndWeightedAdd(1, a, false, b, false, 0, c, nullptr, packedA);
+    BOOST_CHECK(c.IsEqualTo(expected, c_epsilonFloatE4));
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixBatchedMultiplyAndWeightedAdd, RandomSeedFixture)
+{
+    // small products are computed directly, large ones by BLAS
+    for (size_t size : { 3, 20 })
+    {
+        const size_t m = size, n = size + 1, k = size + 2, batchSize = 5;
+        for (bool transposeA : { false, true })
+        {
+            for (bool transposeB : { false, true })
+            {
+                for (bool broadcastB : { false, true })
+                {
+                    SMatrix a = SMatrix::RandomUniform(m * k, batchSize, -1, 1, IncrementCounter());
+                    SMatrix b = SMatrix::RandomUniform(k * n, broadcastB ? 1 : batchSize, -1, 1, IncrementCounter());
+                    SMatrix c = SMatrix::RandomUniform(m * n, batchSize, -1, 1, IncrementCounter());
+                    SMatrix expected(c);
+
+                    SMatrix::BatchedMultiplyAndWeightedAdd(2, a, transposeA, b, transposeB, 0.5, c, m, n, k);
+
+                    for (size_t i = 0; i < batchSize; i++)
+                    {
+                        SMatrix ai = a.ColumnSlice(i, 1);
+                        ai.Reshape(transposeA ? k : m, transposeA ? m : k);
+                        SMatrix bi = b.ColumnSlice(broadcastB ? 0 : i, 1);
+                        bi.Reshape(transposeB ? n : k, transposeB ? k : n);
+                        SMatrix ei = expected.ColumnSlice(i, 1);
+                        ei.Reshape(m, n);
+                        SMatrix::MultiplyAndWeightedAdd(2, ai, transposeA, bi, transposeB, 0.5, ei);
+                    }
+                    BOOST_CHECK(c.IsEqualTo(expected, c_epsilonFloatE4));
+                }
+            }
+        }
+    }
+}
+
 BOOST_FIXTURE_TEST_CASE(CPUMatrixElementOperations, RandomSeedFixture)
 {
     // TODO: consider splitting this large test
@@ -1087,6 +1156,207 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrixGatherFromTarget, RandomSeedFixture)
     BOOST_CHECK(m2.IsEqualTo(expect, 1e-6));
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUMatrixUniformRandomMaskRedrawn, RandomSeedFixture)
+{
+    const uint64_t seed = IncrementCounter();
+    auto rngHandle = RNGHandle::Create(CPUDEVICE, seed);
+
+    SMatrix first(20, 7), redrawn(20, 7), next(20, 7), expectedNext(20, 7);
+
+    // a mask drawn again after rewinding equals the first one, and resuming continues the sequence where it was
+    rngHandle->Mark(0);
+    first.SetUniformRandomMask(0.5f, 2.0f, *rngHandle);
+    rngHandle->RewindToMark();
+    redrawn.SetUniformRandomMask(0.5f, 2.0f, *rngHandle);
+    rngHandle->Resume(first.GetNumElements());
+    next.SetUniformRandomMask(0.5f, 2.0f, *rngHandle);
+
+    BOOST_CHECK(redrawn.IsEqualTo(first, 0));
+
+    auto sequentialHandle = RNGHandle::Create(CPUDEVICE, seed);
+    SMatrix skipped(20, 7);
+    skipped.SetUniformRandomMask(0.5f, 2.0f, *sequentialHandle);
+    expectedNext.SetUniformRandomMask(0.5f, 2.0f, *sequentialHandle);
+    BOOST_CHECK(next.IsEqualTo(expectedNext, 0));
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixCosSimilarityWithNegativeSamples, RandomSeedFixture)
+{
+    const size_t dim = 5, n = 7, shift = 2, negNumber = 3;
+    DMatrix a(dim, n), b(dim, n), invNormA, invNormB, c;
+    a.SetUniformRandomValue(-1, 1, IncrementCounter());
+    b.SetUniformRandomValue(-1, 1, IncrementCounter());
+    DMatrix::CosSimilarityWithNegativeSamples(a, b, invNormA, invNormB, c, shift, negNumber);
+    BOOST_CHECK_EQUAL(negNumber + 1, c.GetNumRows());
+    BOOST_CHECK_EQUAL(n, c.GetNumCols());
+
+    // the values are the cosines of the pairs of columns
+    DMatrix dot;
+    DMatrix::InnerProductWithShiftNeg(a, b, dot, true, shift, negNumber);
+    for (size_t j = 0; j < n; j++)
+    {
+        for (size_t i = 0; i <= negNumber; i++)
+        {
+            const size_t s = i == 0 ? j : (j + shift + i - 1) % n;
+            const double normA = sqrt(DMatrix::InnerProductOfMatrices(a.ColumnSlice(j, 1), a.ColumnSlice(j, 1)));
+            const double normB = sqrt(DMatrix::InnerProductOfMatrices(b.ColumnSlice(s, 1), b.ColumnSlice(s, 1)));
+            BOOST_CHECK_CLOSE(dot(i, j) / (normA * normB), c(i, j), 1e-8);
+        }
+    }
+
+    // the gradient matches finite differences of sum(cGradient .* c)
+    DMatrix cGradient(negNumber + 1, n);
+    cGradient.SetUniformRandomValue(-1, 1, IncrementCounter());
+    for (size_t inputIndex = 0; inputIndex < 2; inputIndex++)
+    {
+        DMatrix gradient(dim, n);
+        gradient.SetValue(0);
+        DMatrix::AddCosSimilarityWithNegativeSamplesGradient(inputIndex, a, b, invNormA, invNormB, c, cGradient, gradient, shift, negNumber);
+        DMatrix& input = inputIndex == 0 ? a : b;
+        const double epsilon = 1e-6;
+        foreach_coord (k, j, input)
+        {
+            const double x = input(k, j);
+            DMatrix na, nb, cPlus, cMinus;
+            input(k, j) = x + epsilon;
+            DMatrix::CosSimilarityWithNegativeSamples(a, b, na, nb, cPlus, shift, negNumber);
+            input(k, j) = x - epsilon;
+            DMatrix::CosSimilarityWithNegativeSamples(a, b, na, nb, cMinus, shift, negNumber);
+            input(k, j) = x;
+            cPlus -= cMinus;
+            const double numeric = DMatrix::InnerProductOfMatrices(cPlus, cGradient) / (2 * epsilon);
+            BOOST_CHECK_SMALL(gradient(k, j) - numeric, 1e-6);
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixLambdaRank, RandomSeedFixture)
+{
+    // the example of LambdaRankNode: two queries of three urls each, sorted by descending gain
+    double gainValues[] = {31, 7, 0, 3, 0, 0};
+    double scoreValues[] = {0.9, 0.3, 0.0, 0.4, 0.5, 0.3};
+    double queryBeginValues[] = {0, 3, 6};
+    DMatrix gains(1, 6, gainValues, matrixFlagNormal);
+    DMatrix scores(1, 6, scoreValues, matrixFlagNormal);
+    DMatrix queryBegins(1, 3, queryBeginValues, matrixFlagNormal);
+    DMatrix ranks, metrics;
+    DMatrix::LambdaRankMetrics(gains, scores, queryBegins, ranks, metrics);
+
+    const double expectedRanks[] = {0, 1, 2, 1, 0, 2};
+    for (size_t i = 0; i < 6; i++)
+        BOOST_CHECK_EQUAL(expectedRanks[i], ranks(0, i));
+    BOOST_CHECK_CLOSE(31 / log(2.0) + 7 / log(3.0), metrics(0, 0), 1e-10);
+    BOOST_CHECK_CLOSE(metrics(0, 0), metrics(1, 0), 1e-10);
+    BOOST_CHECK_CLOSE(3 / log(2.0), metrics(0, 1), 1e-10);
+    BOOST_CHECK_CLOSE(3 / log(3.0), metrics(1, 1), 1e-10);
+
+    // the lambdas of the pairs of the second query, which are added to the gradient (url 3 is the only one with a gain)
+    DMatrix gradient(1, 6);
+    gradient.SetValue(1);
+    DMatrix::AddLambdaRankGradient(gains, scores, queryBegins, ranks, metrics, 1, gradient);
+    const double lambda34 = -1 / (1 + exp(0.4 - 0.5)) * (log(3.0) - log(2.0)) / log(3.0);
+    const double lambda35 = -1 / (1 + exp(0.4 - 0.3)) * (log(4.0) - log(3.0)) * log(2.0) / (log(3.0) * log(4.0));
+    BOOST_CHECK_CLOSE(1 + lambda34 + lambda35, gradient(0, 3), 1e-8);
+    BOOST_CHECK_CLOSE(1 - lambda34, gradient(0, 4), 1e-8);
+    BOOST_CHECK_CLOSE(1 - lambda35, gradient(0, 5), 1e-8);
+
+    // the lambdas of a query sum to 0, and the best url is pushed up
+    BOOST_CHECK_SMALL(gradient(0, 0) + gradient(0, 1) + gradient(0, 2) - 3, 1e-10);
+    BOOST_CHECK_LT(gradient(0, 0), 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixCounterBasedRandomValue, RandomSeedFixture)
+{
+    const unsigned long seed = IncrementCounter();
+
+    // the values do not depend on the number of threads
+    SMatrix parallel(300, 400);
+    SMatrix sequential(300, 400);
+    parallel.SetCounterBasedRandomValue(RandomDistribution::Normal, 0, 1, seed);
+    int numThreads = SMatrix::GetMaxNumThreads();
+    SMatrix::SetNumThreads(1);
+    sequential.SetCounterBasedRandomValue(RandomDistribution::Normal, 0, 1, seed);
+    SMatrix::SetNumThreads(numThreads);
+    BOOST_CHECK(parallel.IsEqualTo(sequential, 0));
+
+    // nor on the shape, only on the seed and the index of the element
+    SMatrix reshaped(400, 300);
+    reshaped.SetCounterBasedRandomValue(RandomDistribution::Normal, 0, 1, seed);
+    BOOST_CHECK_EQUAL(0, memcmp(parallel.Data(), reshaped.Data(), sizeof(float) * parallel.GetNumElements()));
+    sequential.SetCounterBasedRandomValue(RandomDistribution::Normal, 0, 1, seed + 1);
+    BOOST_CHECK(!parallel.IsEqualTo(sequential, 0));
+
+    SMatrix m(200, 500);
+    m.SetCounterBasedRandomValue(RandomDistribution::Uniform, -0.5f, 0.5f, seed);
+    foreach_coord (i, j, m)
+    {
+        BOOST_CHECK(m(i, j) > -0.5f && m(i, j) <= 0.5f);
+    }
+    BOOST_CHECK_SMALL(m.SumOfElements() / m.GetNumElements(), 0.01f);
+
+    m.SetCounterBasedRandomValue(RandomDistribution::Normal, 1.0f, 2.0f, seed);
+    double sum = 0, sumSq = 0;
+    foreach_coord (i, j, m)
+    {
+        sum += m(i, j);
+        sumSq += m(i, j) * m(i, j);
+    }
+    const double mean = sum / m.GetNumElements();
+    BOOST_CHECK_CLOSE(mean, 1.0, 2);
+    BOOST_CHECK_CLOSE(sqrt(sumSq / m.GetNumElements() - mean * mean), 2.0, 2);
+
+    m.SetCounterBasedRandomValue(RandomDistribution::TruncatedNormal, 0, 2.0f, seed);
+    foreach_coord (i, j, m)
+    {
+        BOOST_CHECK(m(i, j) >= -4.0f && m(i, j) <= 4.0f);
+    }
+
+    // a stream continued at an offset is the same as the stream drawn in one go
+    SMatrix whole(100, 4);
+    SMatrix first(100, 1);
+    SMatrix rest(100, 3);
+    whole.SetCounterBasedRandomValue(RandomDistribution::Bernoulli, 0.3f, 2.0f, seed);
+    first.SetCounterBasedRandomValue(RandomDistribution::Bernoulli, 0.3f, 2.0f, seed, 0);
+    rest.SetCounterBasedRandomValue(RandomDistribution::Bernoulli, 0.3f, 2.0f, seed, first.GetNumElements());
+    BOOST_CHECK(whole.ColumnSlice(0, 1).IsEqualTo(first, 0));
+    BOOST_CHECK(whole.ColumnSlice(1, 3).IsEqualTo(rest, 0));
+    foreach_coord (i, j, whole)
+    {
+        BOOST_CHECK(whole(i, j) == 0 || whole(i, j) == 2.0f);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixMaxROIPooling, RandomSeedFixture)
+{
+    // a 4 x 4 image of one channel with the values w + 4 h; an ROI (x1, y1, x2, y2) of the whole image and one of its top left 2 x 2 corner
+    SMatrix image(16, 1);
+    for (size_t i = 0; i < 16; i++)
+        image(i, 0) = (float) i;
+    float roiValues[] = {0, 0, 3, 3, 0, 0, 1, 1};
+    SMatrix rois(8, 1, roiValues, matrixFlagNormal);
+    SMatrix output(8, 1);
+    SMatrix argmax(8, 1);
+    image.MaxROIPoolingForward(2, 1, 1, 4, 4, 2, 2, rois, output, argmax, 1.0);
+
+    const float expectedOutput[] = {5, 7, 13, 15, 0, 1, 4, 5};
+    for (size_t i = 0; i < 8; i++)
+    {
+        BOOST_CHECK_EQUAL(expectedOutput[i], output(i, 0));
+        BOOST_CHECK_EQUAL(expectedOutput[i], argmax(i, 0));
+    }
+
+    // the gradient of each window goes to its maximum; location 5 is the maximum of a window of both ROIs
+    float pooledGradValues[] = {1, 2, 3, 4, 1, 1, 1, 1};
+    SMatrix pooledGrad(8, 1, pooledGradValues, matrixFlagNormal);
+    SMatrix grad(16, 1);
+    grad.SetValue(0);
+    pooledGrad.MaxROIPoolingBackward(2, 1, 1, 4, 4, 2, 2, rois, grad, argmax, 1.0);
+
+    const float expectedGrad[] = {1, 1, 0, 0, 1, 2, 0, 2, 0, 0, 0, 0, 0, 3, 0, 4};
+    for (size_t i = 0; i < 16; i++)
+        BOOST_CHECK_EQUAL(expectedGrad[i], grad(i, 0));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
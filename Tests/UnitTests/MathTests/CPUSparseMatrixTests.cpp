@@ -147,6 +147,59 @@ BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixDoGatherColumnsOf, RandomSeedFixture)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixScatterToIndices, RandomSeedFixture)
+{
+    const size_t m = 4;
+    const size_t n = 10;
+    const size_t numIndices = 12;
+
+    // repeated and skipped (negative) indices, scattered twice, into existing and new columns
+    std::vector<double> indexValue(numIndices);
+    for (size_t i = 0; i < numIndices; i++) indexValue[i] = i % 5 == 4 ? -1 : (double)((i * 7) % 4 + (i > 6 ? 5 : 0));
+    DenseMatrix index(1, numIndices, indexValue.data());
+    DenseMatrix expected(m, n);
+    expected.SetValue(0);
+    SparseMatrix sm(MatrixFormat::matrixFormatSparseBlockCol, m, n, 0);
+    for (size_t pass = 0; pass < 2; pass++)
+    {
+        DenseMatrix values(m, numIndices);
+        values.SetUniformRandomValue(-1, 1, IncrementCounter());
+        expected.ScatterToIndices(values, index, m);
+        sm.ScatterToIndices(values, index, m);
+        DenseMatrix result = sm.CopyColumnSliceToDense(0, n);
+        BOOST_CHECK(expected.IsEqualTo(result, c_epsilonFloatE4));
+        index.ColumnSlice(0, 6).InplaceTruncateTop(2); // (only columns that already have blocks)
+    }
+    BOOST_CHECK_EQUAL(7, sm.GetBlockSize());
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixScaleAndAddSparseBlockCol, RandomSeedFixture)
+{
+    const size_t m = 4;
+    const size_t n = 8;
+
+    // c has the columns 1 and 3, a has the columns 3 and 6
+    double cIndexValue[] = { 3, 1, 3 };
+    double aIndexValue[] = { 6, 3 };
+    DenseMatrix cIndex(1, 3, cIndexValue);
+    DenseMatrix aIndex(1, 2, aIndexValue);
+    DenseMatrix cValues(m, 3);
+    DenseMatrix aValues(m, 2);
+    cValues.SetUniformRandomValue(-1, 1, IncrementCounter());
+    aValues.SetUniformRandomValue(-1, 1, IncrementCounter());
+    SparseMatrix c(MatrixFormat::matrixFormatSparseBlockCol, m, n, 0);
+    SparseMatrix a(MatrixFormat::matrixFormatSparseBlockCol, m, n, 0);
+    c.ScatterToIndices(cValues, cIndex, m);
+    a.ScatterToIndices(aValues, aIndex, m);
+
+    DenseMatrix expected = c.CopyColumnSliceToDense(0, n);
+    SparseMatrix::ScaleAndAdd(2, a, expected);
+    SparseMatrix::ScaleAndAdd(2, a, c);
+    DenseMatrix result = c.CopyColumnSliceToDense(0, n);
+    BOOST_CHECK(expected.IsEqualTo(result, c_epsilonFloatE4));
+    BOOST_CHECK_EQUAL(3, c.GetBlockSize());
+}
+
 BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixOneHot, RandomSeedFixture)
 {
     const size_t num_class = 6;
@@ -195,6 +248,72 @@ BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixOneHot, RandomSeedFixture)
     BOOST_CHECK(sm3(4, 3) == 1);
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixCSCAndCSRTimesDense, RandomSeedFixture)
+{
+    const size_t m = 100;
+    const size_t k = 60;
+    const size_t n = 130; // (more than one block of the dense outer dimension)
+
+    DenseMatrix dmS(m, k);
+    dmS.SetUniformRandomValue(-3, 1, IncrementCounter());
+    dmS.InplaceTruncateBottom(0);
+
+    SparseMatrix smCSC(MatrixFormat::matrixFormatSparseCSC, m, k, 0);
+    foreach_column (col, dmS)
+        foreach_row (row, dmS)
+            smCSC.SetValue(row, col, dmS(row, col));
+    SparseMatrix smCSR(MatrixFormat::matrixFormatSparseCSR, m, k, 0);
+    foreach_row (row, dmS)
+        foreach_column (col, dmS)
+            smCSR.SetValue(row, col, dmS(row, col));
+    BOOST_CHECK(smCSR.NzCount() == smCSC.NzCount());
+    BOOST_CHECK(dmS.IsEqualTo(smCSR.CopyColumnSliceToDense(0, k), c_epsilonFloatE4));
+
+    for (const SparseMatrix* sm : { &smCSC, &smCSR })
+    {
+        for (bool transposeS : { false, true })
+        {
+            for (bool transposeD : { false, true })
+            {
+                const size_t innerDim = transposeS ? m : k;
+                const size_t outerDimS = transposeS ? k : m;
+
+                // sparse * dense
+                DenseMatrix dmB = transposeD ? DenseMatrix(n, innerDim) : DenseMatrix(innerDim, n);
+                dmB.SetUniformRandomValue(-1, 1, IncrementCounter());
+                DenseMatrix expected(outerDimS, n);
+                expected.SetUniformRandomValue(-1, 1, IncrementCounter());
+                DenseMatrix result(expected);
+                DenseMatrix::MultiplyAndWeightedAdd(2, dmS, transposeS, dmB, transposeD, 0.5, expected);
+                SparseMatrix::MultiplyAndWeightedAdd(2, *sm, transposeS, dmB, transposeD, 0.5, result);
+                BOOST_CHECK(expected.IsEqualTo(result, c_epsilonFloatE4));
+
+                // dense * sparse
+                DenseMatrix dmA = transposeD ? DenseMatrix(innerDim, n) : DenseMatrix(n, innerDim);
+                dmA.SetUniformRandomValue(-1, 1, IncrementCounter());
+                DenseMatrix::MultiplyAndWeightedAdd(1, dmA, transposeD, dmS, !transposeS, 0, expected);
+                SparseMatrix::MultiplyAndWeightedAdd(1, dmA, transposeD, *sm, !transposeS, 0, result);
+                BOOST_CHECK(expected.IsEqualTo(result, c_epsilonFloatE4));
+            }
+        }
+
+        // InnerProduct and ScaleAndAdd
+        DenseMatrix dmB(m, k);
+        dmB.SetUniformRandomValue(-1, 1, IncrementCounter());
+        for (bool isColWise : { false, true })
+        {
+            DenseMatrix expected, result;
+            DenseMatrix::InnerProduct(dmS, dmB, expected, isColWise);
+            SparseMatrix::InnerProduct(*sm, dmB, result, isColWise);
+            BOOST_CHECK(expected.IsEqualTo(result, c_epsilonFloatE4));
+        }
+        DenseMatrix expected(dmB);
+        DenseMatrix::ScaleAndAdd(3, dmS, expected);
+        SparseMatrix::ScaleAndAdd(3, *sm, dmB);
+        BOOST_CHECK(expected.IsEqualTo(dmB, c_epsilonFloatE4));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
@@ -15,6 +15,7 @@
 #include "../../../Source/Math/GPUMatrix.h"
 #include "../../../Source/Math/ConvolutionEngine.h"
 #include "../../../Source/Math/CuDnnFactories.h"
+#include "../../../Source/Math/CuDnnAlgorithmCache.h"
 #include "common.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
@@ -62,6 +63,10 @@ std::vector<std::tuple<ConvolutionEngineKind, DEVICEID_TYPE, size_t>> GetTestEng
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 0));
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 1));
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 3));
+
+    // Winograd engine. CPU only, uses temp memory.
+    res.push_back(std::make_tuple(ConvolutionEngineKind::Winograd, -1, 0));
+    res.push_back(std::make_tuple(ConvolutionEngineKind::Winograd, -1, 3));
     return res;
 }
 
@@ -233,6 +238,122 @@ BOOST_AUTO_TEST_CASE(ConvolutionForward)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ConvolutionForwardWinograd)
+{
+    std::mt19937 rng(0);
+    boost::random::uniform_int_distribution<> batchSizeG(1, 8);
+    boost::random::normal_distribution<float> nd;
+
+    // compare with the reference engine on CPU, also for geometries that are larger than the generic ones, with and without padding
+    auto configs = GenerateConvTestConfigs();
+    for (size_t inC : {1, 16})
+    {
+        for (bool autoPad : {true, false})
+        {
+            configs.push_back(std::make_shared<ConvolveGeometry>(TensorShape(13, 8, inC),
+                TensorShape(3, 3, inC), TensorShape(8), TensorShape(1, 1, inC),
+                ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{autoPad, autoPad, false},
+                TensorShape(0), TensorShape(0)));
+        }
+    }
+
+    int cpuDeviceId = -1;
+    for (const auto& g : configs)
+    {
+        auto baseEng = ConvEng::Create(g, cpuDeviceId, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Reference);
+        for (size_t maxTempMem : {0, 3})
+        {
+            auto testEng = ConvEng::Create(g, cpuDeviceId, ImageLayoutKind::CHW, maxTempMem, PoolKind::None, ConvolutionEngineKind::Winograd);
+
+            size_t n = batchSizeG(rng);
+            vec buf(g->InputShape().GetNumElements() * n);
+            std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+            SingleMatrix in(g->InputShape().GetNumElements(), n, buf.data(), cpuDeviceId, matrixFlagNormal);
+
+            size_t mapCount = g->GetMapCount(g->InputShape().GetRank() - 1);
+            buf.resize(g->KernelShape().GetNumElements() * mapCount);
+            std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+            SingleMatrix kernel(mapCount, g->KernelShape().GetNumElements(), buf.data(), cpuDeviceId, matrixFlagNormal);
+
+            size_t crowOut = g->OutputShape().GetNumElements();
+            SingleMatrix out(crowOut, n, cpuDeviceId);
+            out.SetValue(std::numeric_limits<float>::quiet_NaN());
+            SingleMatrix outB(crowOut, n, cpuDeviceId);
+
+            SingleMatrix workspace(cpuDeviceId);
+            SingleMatrix workspaceB(cpuDeviceId);
+            testEng->Forward(in, kernel, out, workspace);
+            baseEng->Forward(in, kernel, outB, workspaceB);
+
+            std::stringstream tmsg;
+            tmsg << "Geometry: " << (std::string)(*g) << ", Batch: " << n << ", MaxTempMem: " << maxTempMem;
+            std::string emsg;
+            BOOST_REQUIRE_MESSAGE(!out.HasNan("out"), "out has NaNs, " << tmsg.str());
+            // (the transforms round differently from a direct summation, which matters for outputs close to 0 of the larger geometries)
+            BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, Err<float>::Rel * 4, 1e-5f), "out are not equal, " << tmsg.str() << ". " << emsg);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ConvolutionForwardBinary)
+{
+    std::mt19937 rng(0);
+    boost::random::uniform_int_distribution<> batchSizeG(1, 8);
+    boost::random::normal_distribution<float> nd;
+    auto sign = [](float v) { return v < 0 ? -1.0f : 1.0f; };
+
+    // compare with the reference engine on the signs of the operands, also for more than 64 input maps
+    auto configs = GenerateConvTestConfigs();
+    for (size_t stride : {1, 2})
+    {
+        configs.push_back(std::make_shared<ConvolveGeometry>(TensorShape(11, 7, 160),
+            TensorShape(3, 3, 160), TensorShape(6), TensorShape(stride, stride, 160),
+            ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+            TensorShape(0), TensorShape(0)));
+    }
+
+    int cpuDeviceId = -1;
+    for (const auto& g : configs)
+    {
+        auto baseEng = ConvEng::Create(g, cpuDeviceId, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Reference);
+        for (size_t maxTempMem : {0, 3})
+        {
+            auto testEng = ConvEng::Create(g, cpuDeviceId, ImageLayoutKind::CHW, maxTempMem, PoolKind::None, ConvolutionEngineKind::Binary);
+
+            size_t n = batchSizeG(rng);
+            vec buf(g->InputShape().GetNumElements() * n);
+            std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+            SingleMatrix in(g->InputShape().GetNumElements(), n, buf.data(), cpuDeviceId, matrixFlagNormal);
+            std::transform(begin(buf), end(buf), begin(buf), sign);
+            SingleMatrix inB(g->InputShape().GetNumElements(), n, buf.data(), cpuDeviceId, matrixFlagNormal);
+
+            size_t mapCount = g->GetMapCount(g->InputShape().GetRank() - 1);
+            buf.resize(g->KernelShape().GetNumElements() * mapCount);
+            std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+            SingleMatrix kernel(mapCount, g->KernelShape().GetNumElements(), buf.data(), cpuDeviceId, matrixFlagNormal);
+            std::transform(begin(buf), end(buf), begin(buf), sign);
+            SingleMatrix kernelB(mapCount, g->KernelShape().GetNumElements(), buf.data(), cpuDeviceId, matrixFlagNormal);
+
+            size_t crowOut = g->OutputShape().GetNumElements();
+            SingleMatrix out(crowOut, n, cpuDeviceId);
+            out.SetValue(std::numeric_limits<float>::quiet_NaN());
+            SingleMatrix outB(crowOut, n, cpuDeviceId);
+
+            SingleMatrix workspace(cpuDeviceId);
+            SingleMatrix workspaceB(cpuDeviceId);
+            testEng->Forward(in, kernel, out, workspace);
+            baseEng->Forward(inB, kernelB, outB, workspaceB);
+
+            std::stringstream tmsg;
+            tmsg << "Geometry: " << (std::string)(*g) << ", Batch: " << n << ", MaxTempMem: " << maxTempMem;
+            std::string emsg;
+            BOOST_REQUIRE_MESSAGE(!out.HasNan("out"), "out has NaNs, " << tmsg.str());
+            // (sums of +-1 are exact)
+            BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, 0.0f, 0.0f), "out are not equal, " << tmsg.str() << ". " << emsg);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(ConvolutionBackwardData)
 {
     std::mt19937 rng(0);
@@ -371,6 +492,158 @@ BOOST_AUTO_TEST_CASE(ConvolutionBackwardKernel)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ConvolutionDepthwise)
+{
+    std::mt19937 rng(0);
+    boost::random::uniform_int_distribution<> batchSizeG(1, 8);
+    boost::random::normal_distribution<float> nd;
+
+    // grouped convolutions with one input map per group: the kernel spans one map, and moves by one map without sharing
+    std::vector<ConvolveGeometryPtr> configs;
+    for (size_t inC : {2, 3, 8})
+    {
+        for (size_t mapCount : {1, 2})
+        {
+            for (size_t stride : {1, 2})
+            {
+                for (bool autoPad : {true, false})
+                {
+                    configs.push_back(std::make_shared<ConvolveGeometry>(TensorShape(9, 7, inC),
+                        TensorShape(3, 3, 1), TensorShape(mapCount), TensorShape(stride, stride, 1),
+                        ConvolveGeometry::BoolVec{true, true, false}, ConvolveGeometry::BoolVec{autoPad, autoPad, false},
+                        TensorShape(0), TensorShape(0)));
+                }
+            }
+        }
+    }
+
+    int cpuDeviceId = -1;
+    for (const auto& g : configs)
+    {
+        BOOST_REQUIRE_EQUAL(g->Groups(), g->InputShape()[2]);
+        auto baseEng = ConvEng::Create(g, cpuDeviceId, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Reference);
+        auto testEng = ConvEng::Create(g, cpuDeviceId, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Depthwise);
+
+        size_t n = batchSizeG(rng);
+        size_t crowIn = g->InputShape().GetNumElements();
+        size_t crowOut = g->OutputShape().GetNumElements();
+        vec buf(crowIn * n);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix in(crowIn, n, buf.data(), cpuDeviceId, matrixFlagNormal);
+
+        buf.resize(crowOut * n);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix srcGrad(crowOut, n, buf.data(), cpuDeviceId, matrixFlagNormal);
+
+        // one kernel per output map, i.e. mapCount per group
+        size_t kernelCount = g->GetMapCount(2) * g->Groups();
+        buf.resize(g->KernelShape().GetNumElements() * kernelCount);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix kernel(kernelCount, g->KernelShape().GetNumElements(), buf.data(), cpuDeviceId, matrixFlagNormal);
+
+        SingleMatrix workspace(cpuDeviceId);
+        SingleMatrix workspaceB(cpuDeviceId);
+
+        SingleMatrix out(crowOut, n, cpuDeviceId);
+        out.SetValue(std::numeric_limits<float>::quiet_NaN());
+        SingleMatrix outB(crowOut, n, cpuDeviceId);
+        testEng->Forward(in, kernel, out, workspace);
+        baseEng->Forward(in, kernel, outB, workspaceB);
+
+        SingleMatrix grad(crowIn, n, cpuDeviceId);
+        grad.SetValue(1);
+        SingleMatrix gradB(grad.DeepClone(), cpuDeviceId);
+        testEng->BackwardData(srcGrad, kernel, grad, true, workspace);
+        baseEng->BackwardData(srcGrad, kernel, gradB, true, workspaceB);
+
+        SingleMatrix kernelGrad(kernel.DeepClone(), cpuDeviceId);
+        SingleMatrix kernelGradB(kernel.DeepClone(), cpuDeviceId);
+        testEng->BackwardKernel(srcGrad, in, kernelGrad, true, false, workspace);
+        baseEng->BackwardKernel(srcGrad, in, kernelGradB, true, false, workspaceB);
+
+        std::stringstream tmsg;
+        tmsg << "Geometry: " << (std::string)(*g) << ", Batch: " << n;
+        std::string emsg;
+        BOOST_REQUIRE_MESSAGE(!out.HasNan("out"), "out has NaNs, " << tmsg.str());
+        BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, Err<float>::Rel * 4, Err<float>::Abs * 4), "out are not equal, " << tmsg.str() << ". " << emsg);
+        BOOST_REQUIRE_MESSAGE(CheckEqual(grad, gradB, emsg, Err<float>::Rel * 4, Err<float>::Abs * 4), "grad are not equal, " << tmsg.str() << ". " << emsg);
+        BOOST_REQUIRE_MESSAGE(CheckEqual(kernelGrad, kernelGradB, emsg, Err<float>::Rel * 16, Err<float>::Abs * 16), "kernel are not equal, " << tmsg.str() << ". " << emsg);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ConvolutionHWC)
+{
+    std::mt19937 rng(0);
+    boost::random::uniform_int_distribution<> batchSizeG(1, 8);
+    boost::random::normal_distribution<float> nd;
+
+    auto randomMat = [&](size_t r, size_t c, int deviceId) -> SingleMatrix
+    {
+        vec buf(r * c);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        return SingleMatrix(r, c, buf.data(), deviceId, matrixFlagNormal);
+    };
+
+    // The cuDNN engine with HWC layout (which the default engines select) must compute the same as the legacy engine,
+    // also for non-square images and kernels.
+    int deviceId = 0;
+    for (size_t c : {1, 3})
+    for (size_t w : {7, 9})
+    for (size_t h : {5, 9})
+    for (size_t kW : {3, 5})
+    for (size_t kH : {1, 3})
+    for (size_t stride : {1, 2})
+    for (bool pad : {false, true})
+    {
+        if (stride > kH) // (not supported by the legacy engine)
+            continue;
+        size_t mapCount = 4;
+        auto g = std::make_shared<ConvolveGeometry>(TensorShape(w, h, c), TensorShape(kW, kH, c), TensorShape(mapCount), TensorShape(stride, stride, c),
+                                                    ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{pad, pad, false}, TensorShape(0), TensorShape(0));
+        auto testEng = ConvEng::Create(g, deviceId, ImageLayoutKind::HWC, 0, PoolKind::None);
+        auto baseEng = ConvEng::Create(g, deviceId, ImageLayoutKind::HWC, 0, PoolKind::None, ConvolutionEngineKind::Legacy);
+
+        size_t n = batchSizeG(rng);
+        size_t crowIn = g->InputShape().GetNumElements();
+        size_t crowOut = g->OutputShape().GetNumElements();
+        size_t ckernel = g->KernelShape().GetNumElements();
+        SingleMatrix in = randomMat(crowIn, n, deviceId);
+        SingleMatrix kernel = randomMat(mapCount, ckernel, deviceId);
+        SingleMatrix srcGrad = randomMat(crowOut, n, deviceId);
+
+        SingleMatrix workspace(deviceId);
+        SingleMatrix workspaceB(deviceId);
+
+        SingleMatrix out(crowOut, n, deviceId);
+        SingleMatrix outB(crowOut, n, deviceId);
+        testEng->Forward(in, kernel, out, workspace);
+        baseEng->Forward(in, kernel, outB, workspaceB);
+
+        // The legacy engine always accumulates the gradients.
+        SingleMatrix grad = SingleMatrix::Zeros(crowIn, n, deviceId);
+        SingleMatrix gradB = SingleMatrix::Zeros(crowIn, n, deviceId);
+        testEng->BackwardData(srcGrad, kernel, grad, true, workspace);
+        baseEng->BackwardData(srcGrad, kernel, gradB, true, workspaceB);
+
+        SingleMatrix kernelGrad = randomMat(mapCount, ckernel, deviceId);
+        SingleMatrix kernelGradB(kernelGrad.DeepClone(), deviceId);
+        testEng->BackwardKernel(srcGrad, in, kernelGrad, true, false, workspace);
+        baseEng->BackwardKernel(srcGrad, in, kernelGradB, true, false, workspaceB);
+
+        std::stringstream tmsg;
+        tmsg << "Geometry: " << (std::string)(*g) << ", Batch: " << n;
+        std::string msg = " are not equal, " + tmsg.str();
+
+        float relErr = Err<float>::Rel;
+        float absErr = Err<float>::Abs;
+        std::string emsg;
+
+        BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, relErr * 4, absErr * 14), "out" << msg << ". " << emsg);
+        BOOST_REQUIRE_MESSAGE(CheckEqual(grad, gradB, emsg, relErr * 16, absErr * 16), "grad" << msg << ". " << emsg);
+        BOOST_REQUIRE_MESSAGE(CheckEqual(kernelGrad, kernelGradB, emsg, relErr * 192, absErr * 32), "kernel" << msg << ". " << emsg);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(PoolingForward)
 {
     std::mt19937 rng(0);
@@ -592,6 +865,44 @@ BOOST_AUTO_TEST_CASE(MaxUnpooling)
     }
 }
 
+BOOST_AUTO_TEST_CASE(CuDnnAlgorithmCacheFile)
+{
+    std::wstring fileName(L"CuDnnAlgorithmCache.txt");
+    _wunlink(fileName.c_str());
+
+    // entries of this "process" are written to the file
+    CuDnnAlgorithmCache::SetCacheFile(fileName);
+    CuDnnAlgorithmCache::Record("GPU|forward|geometry 1", 3, 1024);
+    CuDnnAlgorithmCache::Record("GPU|backwardData|geometry 1", 1, 0);
+    CuDnnAlgorithmCache::Record("GPU|forward|geometry 1", 5, (size_t)1 << 33); // a later entry for the same key wins
+
+    // a later run reads them back
+    CuDnnAlgorithmCache::Clear();
+    CuDnnAlgorithmCache::SetCacheFile(fileName);
+    int algo;
+    size_t workspaceSize;
+    BOOST_REQUIRE(CuDnnAlgorithmCache::Lookup("GPU|forward|geometry 1", algo, workspaceSize));
+    BOOST_CHECK_EQUAL(algo, 5);
+    BOOST_CHECK_EQUAL(workspaceSize, (size_t)1 << 33);
+    BOOST_REQUIRE(CuDnnAlgorithmCache::Lookup("GPU|backwardData|geometry 1", algo, workspaceSize));
+    BOOST_CHECK_EQUAL(algo, 1);
+    BOOST_CHECK_EQUAL(workspaceSize, 0);
+    BOOST_CHECK(!CuDnnAlgorithmCache::Lookup("GPU|forward|geometry 2", algo, workspaceSize));
+
+    // entries appended by another process are picked up on a miss, but not a line that is still being written
+    FILE* f = fopen("CuDnnAlgorithmCache.txt", "ab");
+    fputs("2\t4096\tGPU|forward|geometry 2\n7\t0\tGPU|forward|geometry 3", f);
+    fclose(f);
+    BOOST_REQUIRE(CuDnnAlgorithmCache::Lookup("GPU|forward|geometry 2", algo, workspaceSize));
+    BOOST_CHECK_EQUAL(algo, 2);
+    BOOST_CHECK_EQUAL(workspaceSize, 4096);
+    BOOST_CHECK(!CuDnnAlgorithmCache::Lookup("GPU|forward|geometry 3", algo, workspaceSize));
+
+    CuDnnAlgorithmCache::SetCacheFile(L"");
+    CuDnnAlgorithmCache::Clear();
+    _wunlink(fileName.c_str());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
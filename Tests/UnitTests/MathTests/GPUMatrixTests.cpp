@@ -7,6 +7,7 @@
 #include "stdafx.h"
 #include "../../../Source/Math/GPUMatrix.h"
 #include "../../../Source/Math/Matrix.h"
+#include "../../../Source/Math/CUDACachingMemAllocator.h"
 #include "BestGpu.h"
 
 using namespace Microsoft::MSR::CNTK;
@@ -809,6 +810,32 @@ BOOST_FIXTURE_TEST_CASE(GPUMatrixLargeInequality, RandomSeedFixture)
 }
 #endif
 
+BOOST_FIXTURE_TEST_CASE(GPUMatrixCachingAllocator, RandomSeedFixture)
+{
+    BOOST_CHECK_EQUAL(CUDACachingMemAllocator::RoundUpToBucketSize(1), 512);
+    BOOST_CHECK_EQUAL(CUDACachingMemAllocator::RoundUpToBucketSize(1024), 1024);
+    BOOST_CHECK_EQUAL(CUDACachingMemAllocator::RoundUpToBucketSize(1025), 1536);
+    BOOST_CHECK_EQUAL(CUDACachingMemAllocator::RoundUpToBucketSize(5000), 5120);
+    BOOST_CHECK_EQUAL(CUDACachingMemAllocator::RoundUpToBucketSize(3 * 1024 * 1024 + 1), 7 * 512 * 1024);
+
+    CUDACachingMemAllocator::SetEnabled(true);
+    {
+        auto& allocator = CUDACachingMemAllocator::GetInstance(c_deviceIdZero);
+        allocator.Trim();
+        const auto before = allocator.GetStatistics();
+        {
+            GPUMatrix<float> m0(1000, 100, c_deviceIdZero);
+        }
+        // a matrix of a similar size falls into the same bucket and reuses the freed buffer
+        GPUMatrix<float> m1(1000, 99, c_deviceIdZero);
+        const auto after = allocator.GetStatistics();
+        BOOST_CHECK_EQUAL(after.numCudaMallocs - before.numCudaMallocs, 1);
+        BOOST_CHECK_EQUAL(after.numCacheHits - before.numCacheHits, 1);
+    }
+    CUDACachingMemAllocator::SetEnabled(false);
+    CUDACachingMemAllocator::TrimAll();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
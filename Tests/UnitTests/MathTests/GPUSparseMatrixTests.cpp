@@ -261,6 +261,53 @@ BOOST_FIXTURE_TEST_CASE(GPUDenseTimesSparse, RandomSeedFixture)
     BOOST_CHECK(twiceTransposeC.IsEqualTo(matrixC, c_epsilonFloatE4));
 }
 
+// dense x sparse with nonzero counts skewed over the columns (long and empty ones), as for bags of words, so that several
+// blocks share a column, and with more rows than a block has threads
+BOOST_FIXTURE_TEST_CASE(GPUDenseTimesSparseSkewedColumns, RandomSeedFixture)
+{
+    const int numRows = 700, numCols = 40, numDenseRows = 150;
+    const int columnLengths[numCols] = { 3, 0, 600, 1, 0, 0, 2, 257, 1, 5, 0, 300, 2, 2, 1, 0, 0, 0, 9, 4,
+                                         1, 1, 0, 700, 3, 0, 1, 2, 3, 4, 0, 0, 0, 0, 16, 1, 1, 0, 2, 255 };
+    std::vector<int> colStarts(1, 0), rows;
+    std::vector<float> values;
+    for (int j = 0; j < numCols; j++)
+    {
+        for (int i = 0; i < columnLengths[j]; i++)
+        {
+            rows.push_back(i + (numRows - columnLengths[j]) * (j % 2)); // (at the top or the bottom)
+            values.push_back((float) ((i + j) % 11) - 5);
+        }
+        colStarts.push_back((int) rows.size());
+    }
+    GPUSparseMatrix<float> sparse(c_deviceIdZero, matrixFormatSparseCSC);
+    sparse.SetMatrixFromCSCFormat(colStarts.data(), rows.data(), values.data(), rows.size(), numRows, numCols);
+    const GPUMatrix<float> dense = sparse.CopyToDenseMatrix();
+
+    // c = 1.5 * a * s + beta * c, also for a column slice of s, whose nonzeros do not start at 0
+    for (int firstCol : { 0, 2 })
+    {
+        const GPUSparseMatrix<float> s = sparse.ColumnSlice(firstCol, numCols - firstCol);
+        const GPUMatrix<float> d = dense.ColumnSlice(firstCol, numCols - firstCol);
+        const GPUMatrix<float> a = GPUMatrix<float>::RandomUniform(numDenseRows, numRows, c_deviceIdZero, -1, 1, IncrementCounter());
+        for (float beta : { 0.0f, 0.5f })
+        {
+            GPUMatrix<float> c = GPUMatrix<float>::RandomUniform(numDenseRows, numCols - firstCol, c_deviceIdZero, -1, 1, IncrementCounter());
+            GPUMatrix<float> expected(c);
+            GPUSparseMatrix<float>::MultiplyAndWeightedAdd(1.5f, a, false, s, false, beta, c);
+            GPUMatrix<float>::MultiplyAndWeightedAdd(1.5f, a, false, d, false, beta, expected);
+            BOOST_CHECK(c.IsEqualTo(expected, c_epsilonFloatE3));
+        }
+    }
+
+    // c += a * s^T, the gradient of the weights of a * s
+    const GPUMatrix<float> a = GPUMatrix<float>::RandomUniform(numDenseRows, numCols, c_deviceIdZero, -1, 1, IncrementCounter());
+    GPUMatrix<float> c = GPUMatrix<float>::RandomUniform(numDenseRows, numRows, c_deviceIdZero, -1, 1, IncrementCounter());
+    GPUMatrix<float> expected(c);
+    GPUSparseMatrix<float>::MultiplyAndWeightedAdd(1, a, false, sparse, true, 1, c);
+    GPUMatrix<float>::MultiplyAndWeightedAdd(1, a, false, dense, true, 1, expected);
+    BOOST_CHECK(c.IsEqualTo(expected, c_epsilonFloatE3));
+}
+
 BOOST_FIXTURE_TEST_CASE(GPUSparseTimesSparse, RandomSeedFixture)
 {
     GPUSparseMatrix<float> matrixA;
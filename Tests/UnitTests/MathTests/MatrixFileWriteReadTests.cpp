@@ -34,6 +34,22 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrixFileWriteRead, RandomSeedFixture)
     BOOST_CHECK(matrixCpuCopy.IsEqualTo(matrixCpuRead, c_epsilonFloatE5));
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUMatrixBinaryFileWriteRead, RandomSeedFixture)
+{
+    CPUMatrix<float> matrixCpu = CPUMatrix<float>::RandomUniform(430, 100, -26.3f, 30.2f, IncrementCounter());
+
+    std::wstring fileNameCpu(L"MCPU.bin");
+    File fileCpu(fileNameCpu, fileOptionsBinary | fileOptionsReadWrite);
+
+    fileCpu << matrixCpu;
+    fileCpu.SetPosition(0);
+
+    CPUMatrix<float> matrixCpuRead(3, 4);
+    fileCpu >> matrixCpuRead;
+
+    BOOST_CHECK(matrixCpu.IsEqualTo(matrixCpuRead));
+}
+
 BOOST_FIXTURE_TEST_CASE(MatrixFileWriteRead, RandomSeedFixture)
 {
     // Test Matrix in Dense mode
@@ -70,6 +86,31 @@ BOOST_FIXTURE_TEST_CASE(MatrixFileWriteRead, RandomSeedFixture)
     BOOST_CHECK(matrixSparseRead.IsEqualTo(matrixSparseCopy, c_epsilonFloatE5));
 }
 
+BOOST_FIXTURE_TEST_CASE(MatrixQuantizedFileWriteRead, RandomSeedFixture)
+{
+    Matrix<float> matrix = Matrix<float>::RandomUniform(43, 10, CPUDEVICE, -26.3f, 30.2f, IncrementCounter());
+
+    std::wstring fileName(L"MQ.bin");
+    File file(fileName, fileOptionsBinary | fileOptionsReadWrite);
+
+    matrix.Write(file, MatrixStorageFormat::float16);
+    matrix.Write(file, MatrixStorageFormat::int8PerRow);
+    matrix.Write(file, MatrixStorageFormat::int8PerColumn);
+    file.SetPosition(0);
+
+    // the error is at most half a step of the format: 2^-11 relative for float16, (max abs value / 127) / 2 for int8
+    Matrix<float> matrixRead(CPUDEVICE);
+    file >> matrixRead;
+    BOOST_CHECK_EQUAL(43, matrixRead.GetNumRows());
+    BOOST_CHECK_EQUAL(10, matrixRead.GetNumCols());
+    BOOST_CHECK(matrixRead.IsEqualTo(matrix, 0.02f));
+    file >> matrixRead;
+    BOOST_CHECK(matrixRead.IsEqualTo(matrix, 30.2f / 127 / 2 + c_epsilonFloatE5));
+    file >> matrixRead;
+    BOOST_CHECK(matrixRead.IsEqualTo(matrix, 30.2f / 127 / 2 + c_epsilonFloatE5));
+    BOOST_CHECK(!matrixRead.IsEqualTo(matrix, c_epsilonFloatE5));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(GPUMatrixSuite)
@@ -91,6 +132,26 @@ BOOST_FIXTURE_TEST_CASE(GPUMatrixFileWriteRead, RandomSeedFixture)
     BOOST_CHECK(matrixGpuCopy.IsEqualTo(matrixGpuRead, c_epsilonFloatE5));
 }
 
+BOOST_FIXTURE_TEST_CASE(GPUMatrixBinaryFileWriteRead, RandomSeedFixture)
+{
+    // larger than the staging buffers of GPUMatrix::ReadValues(), so that it is uploaded in several chunks
+    GPUMatrix<float> matrixGpu = GPUMatrix<float>::RandomUniform(1500, 1500, c_deviceIdZero, -26.3f, 30.2f, IncrementCounter());
+    GPUMatrix<float> matrixGpu2 = GPUMatrix<float>::RandomUniform(7, 3, c_deviceIdZero, -26.3f, 30.2f, IncrementCounter());
+
+    std::wstring filenameGpu(L"MGPU.bin");
+    File fileGpu(filenameGpu, fileOptionsBinary | fileOptionsReadWrite);
+
+    fileGpu << matrixGpu << matrixGpu2;
+    fileGpu.SetPosition(0);
+
+    GPUMatrix<float> matrixGpuRead(c_deviceIdZero);
+    GPUMatrix<float> matrixGpuRead2(c_deviceIdZero);
+    fileGpu >> matrixGpuRead >> matrixGpuRead2;
+
+    BOOST_CHECK(matrixGpu.IsEqualTo(matrixGpuRead));
+    BOOST_CHECK(matrixGpu2.IsEqualTo(matrixGpuRead2));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
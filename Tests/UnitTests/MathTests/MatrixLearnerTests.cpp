@@ -114,5 +114,155 @@ BOOST_FIXTURE_TEST_CASE(AdaDeltaSparse, MatrixLearnerFixture)
     });
 }
 
+// tests Adam sparse vs. dense
+BOOST_FIXTURE_TEST_CASE(AdamSparse, MatrixLearnerFixture)
+{
+    RunOnDevices([this]()
+    {
+        matSG.AdamUpdate(matG, matM, 1.0, 0.0001, 0.9, 0.999, 1e-8, true);
+        matSGsparse.AdamUpdate(matGsparseBSC, matMsparse, 1.0, 0.0001, 0.9, 0.999, 1e-8, true);
+
+        BOOST_CHECK(matSG.IsEqualTo(matSGsparse, c_epsilonFloatE5));
+        BOOST_CHECK(matM.IsEqualTo(matMsparse, c_epsilonFloatE5));
+    });
+}
+
+// tests the lazy momentum update of a block-sparse gradient vs. dense
+// Both get the gradient, then a step without gradient, then the gradient again. The lazy update skips the middle step,
+// so its smoothed gradient must match the dense one afterwards, and its model must lack the movement of the middle step.
+BOOST_FIXTURE_TEST_CASE(MomentumSGDLazySparse, MatrixLearnerFixture)
+{
+    RunOnDevices([this]()
+    {
+        const int deviceId = matG.GetDeviceId();
+        const float momentum = 0.9f;
+        SingleMatrix sgDense = SingleMatrix::Zeros(dim1, dim2, deviceId);
+        SingleMatrix sgLazy(deviceId);
+        SingleMatrix noGradient = SingleMatrix::Zeros(dim1, dim2, deviceId);
+        SingleMatrix noGradientBSC(dim1, dim2, deviceId, MatrixType::SPARSE, matrixFormatSparseBlockCol);
+        SingleMatrix modelDense(matM.DeepClone());
+        SingleMatrix modelLazy(matM.DeepClone());
+
+        // (the learning rate is 1, for which the dense and the sparse momentum updates are the same)
+        modelDense.MomentumSGDUpdate(matG, sgDense, 1.0f, momentum);
+        modelDense.MomentumSGDUpdate(noGradient, sgDense, 1.0f, momentum);
+        SingleMatrix middleStep(sgDense.DeepClone());
+        modelDense.MomentumSGDUpdate(matG, sgDense, 1.0f, momentum);
+
+        // (the sparse update overwrites the gradient)
+        SingleMatrix gradient1(matGsparseBSC.DeepClone());
+        SingleMatrix gradient3(matGsparseBSC.DeepClone());
+        modelLazy.MomentumSGDUpdate(gradient1, sgLazy, 1.0f, momentum, true, /*lazySparseUpdate=*/true);
+        modelLazy.MomentumSGDUpdate(noGradientBSC, sgLazy, 1.0f, momentum, true, true);
+        modelLazy.MomentumSGDUpdate(gradient3, sgLazy, 1.0f, momentum, true, true);
+
+        BOOST_CHECK(sgDense.IsEqualTo(sgLazy.ColumnSlice(0, dim2), c_epsilonFloatE5));
+        modelDense += middleStep;
+        BOOST_CHECK(modelDense.IsEqualTo(modelLazy, c_epsilonFloatE4));
+    });
+}
+
+// tests the lazy Adam update of a block-sparse gradient vs. dense, see MomentumSGDLazySparse
+BOOST_FIXTURE_TEST_CASE(AdamLazySparse, MatrixLearnerFixture)
+{
+    RunOnDevices([this]()
+    {
+        const int deviceId = matG.GetDeviceId();
+        SingleMatrix sgDense(deviceId);
+        SingleMatrix sgLazy(deviceId);
+        SingleMatrix noGradient = SingleMatrix::Zeros(dim1, dim2, deviceId);
+        SingleMatrix noGradientBSC(dim1, dim2, deviceId, MatrixType::SPARSE, matrixFormatSparseBlockCol);
+        SingleMatrix modelDense(matM.DeepClone());
+        SingleMatrix modelLazy(matM.DeepClone());
+
+        sgDense.AdamUpdate(matG, modelDense, 1.0, 0.0001, 0.9, 0.999, 1e-8, true);
+        sgDense.AdamUpdate(noGradient, modelDense, 2.0, 0.0001, 0.9, 0.999, 1e-8, true);
+        sgDense.AdamUpdate(matG, modelDense, 3.0, 0.0001, 0.9, 0.999, 1e-8, true);
+
+        sgLazy.AdamUpdate(matGsparseBSC, modelLazy, 1.0, 0.0001, 0.9, 0.999, 1e-8, true, false, /*lazySparseUpdate=*/true);
+        sgLazy.AdamUpdate(noGradientBSC, modelLazy, 2.0, 0.0001, 0.9, 0.999, 1e-8, true, false, true);
+        sgLazy.AdamUpdate(matGsparseBSC, modelLazy, 3.0, 0.0001, 0.9, 0.999, 1e-8, true, false, true);
+
+        BOOST_CHECK(sgDense.IsEqualTo(sgLazy.ColumnSlice(0, 2 * dim2), c_epsilonFloatE5));
+
+        // the columns without gradient must not have moved
+        for (size_t j = 0; j < dim2; j++)
+        {
+            if (matG.ColumnSlice(j, 1).MatrixNorm1() == 0)
+                BOOST_CHECK(modelLazy.ColumnSlice(j, 1).IsEqualTo(matM.ColumnSlice(j, 1), 0));
+        }
+    });
+}
+
+// tests the fused updates of several parameters vs. the updates of the parameters one by one
+// (of different sizes, one of which spans several chunks, see MultiTensorUpdate.h)
+BOOST_FIXTURE_TEST_CASE(MultiTensorUpdates, MatrixLearnerFixture)
+{
+    RunOnDevices([this]()
+    {
+        const int deviceId = matG.GetDeviceId();
+        const std::vector<std::pair<size_t, size_t>> dims = { { dim1, dim2 }, { 1, 1 }, { 3, 7 }, { dim1, dim3 } };
+
+        for (int type = 0; type < 4; type++) // SGD, momentum, Nesterov, Adam
+        {
+            std::vector<SingleMatrix> models, fusedModels, gradients, smoothedGradients, fusedSmoothedGradients;
+            for (const auto& dim : dims)
+            {
+                const size_t smoothedCols = (type == 3) ? 2 * dim.second : dim.second;
+                models.push_back(SingleMatrix::RandomGaussian(dim.first, dim.second, deviceId, -1.0f, 1.0f, IncrementCounter()));
+                fusedModels.push_back(models.back().DeepClone());
+                gradients.push_back(SingleMatrix::RandomGaussian(dim.first, dim.second, deviceId, -1.0f, 1.0f, IncrementCounter()));
+                smoothedGradients.push_back(SingleMatrix::RandomUniform(dim.first, smoothedCols, deviceId, 0.0f, 1.0f, IncrementCounter()));
+                fusedSmoothedGradients.push_back(smoothedGradients.back().DeepClone());
+            }
+
+            std::vector<SingleMatrix*> fusedModelPtrs, gradientPtrs, fusedSmoothedGradientPtrs;
+            for (size_t i = 0; i < dims.size(); i++)
+            {
+                fusedModelPtrs.push_back(&fusedModels[i]);
+                gradientPtrs.push_back(&gradients[i]);
+                fusedSmoothedGradientPtrs.push_back(&fusedSmoothedGradients[i]);
+            }
+
+            switch (type)
+            {
+            case 0:
+                SingleMatrix::MultiSGDUpdate(fusedModelPtrs, gradientPtrs, 0.1f);
+                break;
+            case 1:
+            case 2:
+                SingleMatrix::MultiMomentumSGDUpdate(fusedModelPtrs, gradientPtrs, fusedSmoothedGradientPtrs, 0.1f, 0.9f, true, /*nesterov=*/type == 2);
+                break;
+            default:
+                SingleMatrix::MultiAdamUpdate(fusedModelPtrs, gradientPtrs, fusedSmoothedGradientPtrs, 3.0, 0.001, 0.9, 0.999, 1e-8);
+                break;
+            }
+
+            for (size_t i = 0; i < dims.size(); i++)
+            {
+                SingleMatrix gradient(gradients[i].DeepClone()); // (the SGD update on the GPU overwrites the gradient)
+                switch (type)
+                {
+                case 0:
+                    models[i].SGDUpdate(gradient, 0.1f);
+                    break;
+                case 1:
+                    models[i].MomentumSGDUpdate(gradient, smoothedGradients[i], 0.1f, 0.9f, true);
+                    break;
+                case 2:
+                    models[i].NesterovAcceleratedMomentumSGDUpdate(gradient, smoothedGradients[i], 0.1f, 0.9f, true);
+                    break;
+                default:
+                    smoothedGradients[i].AdamUpdate(gradient, models[i], 3.0, 0.001, 0.9, 0.999, 1e-8);
+                    break;
+                }
+
+                BOOST_CHECK(fusedModels[i].IsEqualTo(models[i], c_epsilonFloatE5));
+                BOOST_CHECK(fusedSmoothedGradients[i].IsEqualTo(smoothedGradients[i], c_epsilonFloatE5));
+            }
+        }
+    });
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }}}}
@@ -6,6 +6,8 @@
 #include "../../../Source/Math/Matrix.h"
 #include "../../../Source/Math/CPUMatrix.h"
 #include "../../../Source/Math/Helpers.h"
+#include <algorithm>
+#include <random>
 
 #define IDX2C(i, j, ld) (((j) * (ld)) + (i)) // 0 based indexing
 
@@ -1163,6 +1165,51 @@ BOOST_FIXTURE_TEST_CASE(MatrixVectorMax, RandomSeedFixture)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(MatrixVectorMaxTopKLarge, RandomSeedFixture)
+{
+    // wide columns with many ties; k = 5 uses the dedicated top-k kernel on the GPU, k = 40 the sort
+    const int rows = 3000;
+    const int cols = 7;
+    std::mt19937 rng(17);
+    std::vector<float> src(rows * cols);
+    for (auto& v : src)
+        v = (float)(rng() % 500);
+
+    for (auto topK : {5, 40})
+    {
+        // expected: stable sort of each column in descending order
+        std::vector<float> expectedIdx(topK * cols);
+        std::vector<float> expectedVal(topK * cols);
+        for (int j = 0; j < cols; j++)
+        {
+            const float* col = src.data() + j * rows;
+            std::vector<int> order(rows);
+            for (int i = 0; i < rows; i++)
+                order[i] = i;
+            std::stable_sort(order.begin(), order.end(), [col](int a, int b) { return col[a] > col[b]; });
+            for (int k = 0; k < topK; k++)
+            {
+                expectedIdx[j * topK + k] = (float)order[k];
+                expectedVal[j * topK + k] = col[order[k]];
+            }
+        }
+
+        for (auto deviceId : {CPUDEVICE, c_deviceIdZero})
+        {
+            Matrix<float> expIdx(topK, cols, expectedIdx.data(), deviceId, matrixFlagNormal);
+            Matrix<float> expVal(topK, cols, expectedVal.data(), deviceId, matrixFlagNormal);
+
+            Matrix<float> actual(rows, cols, src.data(), deviceId, matrixFlagNormal);
+            Matrix<float> actualIdx(deviceId);
+            Matrix<float> actualVal(deviceId);
+
+            actual.VectorMax(actualIdx, actualVal, true, topK);
+            BOOST_CHECK(actualIdx.IsEqualTo(expIdx));
+            BOOST_CHECK(actualVal.IsEqualTo(expVal));
+        }
+    }
+}
+
 BOOST_FIXTURE_TEST_CASE(MatrixAssignNumOfDiff, RandomSeedFixture)
 {
     float labels[] = {1.0f, 2.0f, 3.0f};
@@ -1410,6 +1457,33 @@ BOOST_FIXTURE_TEST_CASE(MatrixFSAdagradUpdate_WithAndWithout_UnitGain, RandomSee
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(MatrixHalfCastAssign, RandomSeedFixture)
+{
+    // values that are exactly representable in half precision survive the round trip unchanged
+    const float values[] = { 0.0f, 1.0f, -2.5f, 0.125f, 1024.0f, 65504.0f, -6.103515625e-05f };
+    const size_t numValues = sizeof(values) / sizeof(values[0]);
+    for (size_t i = 0; i < numValues; i++)
+        BOOST_CHECK_EQUAL((float)half(values[i]), values[i]);
+
+    // overflow saturates to infinity, tiny values flush to zero, and rounding is to nearest even
+    BOOST_CHECK(std::isinf((float)half(1e6f)));
+    BOOST_CHECK_EQUAL((float)half(1e-9f), 0.0f);
+    BOOST_CHECK_EQUAL((float)half(2049.0f), 2048.0f);
+    BOOST_CHECK_EQUAL((float)half(2051.0f), 2052.0f);
+
+    SingleMatrix source = SingleMatrix::RandomUniform(3, 4, c_deviceIdZero, -1.0f, 1.0f, IncrementCounter());
+
+    Matrix<half> halfMatrix(c_deviceIdZero);
+    halfMatrix.CastAssignValuesOf(source);
+    BOOST_CHECK_EQUAL(halfMatrix.GetNumRows(), 3);
+    BOOST_CHECK_EQUAL(halfMatrix.GetNumCols(), 4);
+
+    SingleMatrix target(c_deviceIdZero);
+    target.CastAssignValuesOf(halfMatrix);
+    // half has an 11-bit significand, so for |x| < 1 the absolute error is below 2^-11
+    BOOST_CHECK(target.IsEqualTo(source, 1.0f / 2048));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
@@ -51,6 +51,66 @@ BOOST_FIXTURE_TEST_CASE(MultiplyIntToShort, RandomSeedFixture)
 }
 
 
+// Sizes that go through all of the block sizes of the block multiplier, compared against the float product
+BOOST_FIXTURE_TEST_CASE(MultiplyAllBlockSizes, RandomSeedFixture)
+{
+    // A[m,k]*B[k,n] = C[m,n]
+    int m = 12, n = 5, k = 2 * 128 + 64 + 32 + 16 + 8 + 3;
+    std::vector<float> A(m*k), B(k*n), C(m*n);
+    for (auto& a : A)
+        a = (float)(rand() % 201 - 100) / 100;
+    for (auto& b : B)
+        b = (float)(rand() % 201 - 100) / 100;
+
+    // bitShift 4 leaves 11 bits per value, so that k products cannot overflow the 32-bit accumulators
+    shared_ptr<QuantizerBase<float, short>> quantA(new SymmetricQuantizer<float, short>(4));
+    shared_ptr<QuantizerBase<float, short>> quantB(new SymmetricQuantizer<float, short>(4));
+    QuantizedMultiplier<float> mult(quantA, true, quantB, false);
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        mult.Multiply(m, n, k, A.data(), B.data(), C.data());
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++)
+            {
+                float expected = 0;
+                for (int l = 0; l < k; l++)
+                    expected += A[i + l*m] * B[l + k*j];
+                BOOST_CHECK_SMALL(C[i + j*m] - expected, 0.1f);
+            }
+    }
+}
+
+// Rows of A with very different magnitudes keep their precision with a per-channel quantizer for A
+BOOST_FIXTURE_TEST_CASE(MultiplyPerChannel, RandomSeedFixture)
+{
+    // A[m,k]*B[k,n] = C[m,n]
+    int m = 4, n = 3, k = 64;
+    std::vector<float> A(m*k), B(k*n), C(m*n);
+    for (int l = 0; l < k; l++)
+        for (int i = 0; i < m; i++)
+            A[i + l*m] = (float)(rand() % 201 - 100) / 100 * (i % 2 == 0 ? 100.0f : 0.01f);
+    for (auto& b : B)
+        b = (float)(rand() % 201 - 100) / 100;
+
+    shared_ptr<QuantizerBase<float, short>> quantA(new PerChannelSymmetricQuantizer<float, short>(4));
+    shared_ptr<QuantizerBase<float, short>> quantB(new SymmetricQuantizer<float, short>(4));
+    QuantizedMultiplier<float> mult(quantA, true, quantB, false);
+
+    mult.Multiply(m, n, k, A.data(), B.data(), C.data());
+    for (int i = 0; i < m; i++)
+    {
+        float scale = i % 2 == 0 ? 100.0f : 0.01f;
+        for (int j = 0; j < n; j++)
+        {
+            float expected = 0;
+            for (int l = 0; l < k; l++)
+                expected += A[i + l*m] * B[l + k*j];
+            BOOST_CHECK_SMALL((C[i + j*m] - expected) / scale, 0.05f);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
\ No newline at end of file
@@ -75,6 +75,37 @@ BOOST_FIXTURE_TEST_CASE(QuantizeZeros, RandomSeedFixture)
     delete[] outputFloat;
 }
 
+BOOST_FIXTURE_TEST_CASE(FloatToShortPerChannel, RandomSeedFixture)
+{
+    // 2x2 column-major matrix, row 0 is { -10, 5 }, row 1 is { 0.1, -0.025 }
+    float input[4] = { -10.0f, 0.1f, 5.0f, -0.025f };
+    short output[4] = { 0, 0, 0, 0 };
+
+    // Every row gets the whole range
+    short outputCorrect[4] = { -32767, 32767, 16384, -8192 };
+
+    ArrayRef<float> inputAr(input, 4);
+    ArrayRef<short> outputAr(output, 4);
+
+    std::unique_ptr<QuantizerBase<float, short>> quantPtr(new PerChannelSymmetricQuantizer<float, short>(0));
+    quantPtr->SetNumChannels(2);
+    quantPtr->Quantize(inputAr, outputAr);
+    for (size_t i = 0; i < 4; i++)
+        BOOST_CHECK_EQUAL(output[i], outputCorrect[i]);
+
+    float outputFloat[4];
+    for (size_t i = 0; i < 4; i++)
+        outputFloat[i] = (float)output[i];
+
+    float dequantized[4];
+    quantPtr->Dequantize(outputFloat, dequantized, 4);
+    for (size_t i = 0; i < 4; i++)
+        BOOST_CHECK_CLOSE(dequantized[i], input[i], 0.01f);
+
+    // Values that do not split into the channels
+    BOOST_CHECK_THROW(quantPtr->Dequantize(outputFloat, dequantized, 3), std::logic_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
\ No newline at end of file
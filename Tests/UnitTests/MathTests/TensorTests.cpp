@@ -5,6 +5,7 @@
 //
 #include "stdafx.h"
 #include "TensorView.h"
+#include "TensorOpAutotuner.h"
 #include "Sequences.h"
 #include "TensorTestsHelper.h"
 
@@ -85,6 +86,112 @@ BOOST_AUTO_TEST_CASE(BiasGradient2)
     });
 }
 
+BOOST_AUTO_TEST_CASE(AutotunedReduction)
+{
+    Test::TensorTest<float> tensorTester;
+
+    // reductions for which the tuner has several launch configurations to choose from; run twice to also use the tuned ones
+    TensorOpAutotuner::SetEnabled(true);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        // few outputs, reduction over a large outer dimension
+        tensorTester.OneTensorTest("autotuned reduction over outer dimension", 1e-4, [&tensorTester](DEVICEID_TYPE deviceId)
+        {
+            return tensorTester.BiasGradientTest(TensorShape{ 8, 8192 }, TensorShape(8), deviceId);
+        });
+        // many outputs, reduction over the innermost dimension
+        tensorTester.OneTensorTest("autotuned reduction over inner dimension", 1e-4, [&tensorTester](DEVICEID_TYPE deviceId)
+        {
+            return tensorTester.BiasGradientTest(TensorShape{ 512, 1024 }, TensorShape{ 1, 1024 }, deviceId);
+        });
+    }
+    TensorOpAutotuner::SetEnabled(false);
+    TensorOpAutotuner::Clear();
+}
+
+BOOST_AUTO_TEST_CASE(FusedElementwiseProgram)
+{
+    Test::TensorTest<float> tensorTester;
+
+    // fused Sigmoid(a .* b + bias) on GPU vs. CPU
+    tensorTester.OneTensorTest("fused element-wise program (broadcasting)", 1e-6, [&tensorTester](DEVICEID_TYPE deviceId)
+    {
+        return tensorTester.FusedElementwiseTest(TensorShape{ 28, 28, 16, 8 }, TensorShape{ 1, 1, 16 }, true, deviceId);
+    });
+
+    // fused vs. op-by-op on CPU
+    let fused    = tensorTester.FusedElementwiseTest(TensorShape{ 64, 32 }, TensorShape{ 64 }, true,  CPUDEVICE);
+    let unfused  = tensorTester.FusedElementwiseTest(TensorShape{ 64, 32 }, TensorShape{ 64 }, false, CPUDEVICE);
+    BOOST_CHECK(fused.GetSOB().IsEqualTo(unfused.GetSOB(), 1e-6f));
+}
+
+BOOST_AUTO_TEST_CASE(ReductionOverOuterDimension)
+{
+    Test::TensorTest<float> tensorTester;
+
+    // reduce the columns of a matrix with more rows than are reduced at once on the CPU, and compare with a plain loop
+    const size_t rows = 300, cols = 50;
+    let input = tensorTester.CreateTensor(TensorShape{ rows, cols }, 1, CPUDEVICE);
+    for (auto reductionOp : { ElementWiseOperator::opSum, ElementWiseOperator::opMax, ElementWiseOperator::opLogSum })
+    {
+        auto result = tensorTester.CreateTensor(TensorShape{ rows }, 2, CPUDEVICE, true);
+        vector<float> expected(result.GetSOB().Data(), result.GetSOB().Data() + rows);
+        const float* x = input.GetSOB().Data();
+        for (size_t i = 0; i < rows; i++)
+        {
+            double aggregate = x[i];
+            for (size_t j = 1; j < cols; j++)
+            {
+                double v = x[i + j * rows];
+                if (reductionOp == ElementWiseOperator::opSum)
+                    aggregate += v;
+                else if (reductionOp == ElementWiseOperator::opMax)
+                    aggregate = max(aggregate, v);
+                else
+                    aggregate = max(aggregate, v) + log1p(exp(-fabs(aggregate - v)));
+            }
+            expected[i] = 2 * (float) aggregate + 0.5f * expected[i];
+        }
+
+        result.DoUnaryOpOf(0.5f, input, 2.0f, ElementWiseOperator::opCopy, reductionOp);
+
+        const float* y = result.GetSOB().Data();
+        for (size_t i = 0; i < rows; i++)
+            BOOST_CHECK_SMALL(y[i] - expected[i], 1e-4f);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(CopyWithSwappedInnermostDimension)
+{
+    Test::TensorTest<float> tensorTester;
+
+    // copy through a view with the first two dimensions swapped, which changes the stride-1 axis, and compare with a plain loop
+    const size_t rows = 37, cols = 70, batch = 3;
+    let input = tensorTester.CreateTensor(TensorShape{ rows, cols, batch }, 1, CPUDEVICE);
+    auto swappedShape = input.GetShape();
+    swappedShape.SwapDimsInPlace(0, 1);
+    let swapped = TensorView<float>(input, swappedShape);
+    for (float beta : { 0.0f, 0.5f })
+    {
+        auto result = tensorTester.CreateTensor(TensorShape{ cols, rows, batch }, 2, CPUDEVICE, true);
+        vector<float> expected(result.GetSOB().Data(), result.GetSOB().Data() + rows * cols * batch);
+        const float* x = input.GetSOB().Data();
+        for (size_t b = 0; b < batch; b++)
+            for (size_t i = 0; i < rows; i++)
+                for (size_t j = 0; j < cols; j++)
+                {
+                    auto& e = expected[j + i * cols + b * rows * cols];
+                    e = 2 * x[i + j * rows + b * rows * cols] + beta * e;
+                }
+
+        result.DoUnaryOpOf(beta, swapped, 2.0f, ElementWiseOperator::opCopy, ElementWiseOperator::opSum);
+
+        const float* y = result.GetSOB().Data();
+        for (size_t k = 0; k < expected.size(); k++)
+            BOOST_CHECK_SMALL(y[k] - expected[k], 1e-5f);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(ColumnSliceMultAndAdd)
 {
     ColumnSliceMultAndAddTest<float>(2048, 2048, 256, 0);
@@ -87,6 +87,33 @@ struct TensorTest
         result.AssignSumOf(input, bias);
         return result;
     }
+
+    // test fused element-wise program: result = Sigmoid(a .* b + c), with c broadcast
+    // If 'fused' is false, the same is computed op by op, for comparison.
+    TensorView<ElemType> FusedElementwiseTest(TensorShape layerShape, TensorShape biasShape, bool fused, DEVICEID_TYPE deviceId)
+    {
+        int randomSeed = 1;
+        let  a = CreateTensor(layerShape, randomSeed++, deviceId);
+        let  b = CreateTensor(layerShape, randomSeed++, deviceId);
+        let  c = CreateTensor(biasShape, randomSeed++, deviceId);
+        auto result = CreateTensor(layerShape, randomSeed++, deviceId, true);
+        if (fused)
+        {
+            ElementWiseProgram program;
+            program.steps[0] = { ElementWiseOperator::opElementwiseProduct, 0, 1 }; // -> register 3
+            program.steps[1] = { ElementWiseOperator::opSum,                3, 2 }; // -> register 4
+            program.steps[2] = { ElementWiseOperator::opSigmoid,            4, 0 };
+            program.numSteps = 3;
+            result.DoElementWiseProgramOf(0, a, b, c, 1, program);
+        }
+        else
+        {
+            result.AssignElementwiseProductOf(a, b);
+            result.AddCopyOf(c);
+            result.AssignSigmoidOf(result);
+        }
+        return result;
+    }
 };
 
 template <class ElemType>
@@ -0,0 +1,84 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+
+#include "../../../Source/ComputationNetworkLib/ComputationNetwork.h"
+#include <memory>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+const DEVICEID_TYPE c_deviceId = CPUDEVICE;
+
+BOOST_AUTO_TEST_SUITE(MatrixPoolTestSuite)
+
+BOOST_AUTO_TEST_CASE(StaticMemoryPlan)
+{
+    MatrixPool pool;
+    pool.Reset();
+
+    // a lives alone; b and c are live at the same time after a is gone
+    shared_ptr<Matrix<float>> a, b, c, d;
+    pool.RequestAllocate<float>(c_deviceId, &a, 100, /*mbScale=*/true, /*isWorkSpace=*/false);
+    pool.RequestRelease<float>(&a);
+    pool.RequestAllocate<float>(c_deviceId, &b, 60, true, false);
+    pool.RequestAllocate<float>(c_deviceId, &c, 40, true, false);
+    pool.RequestRelease<float>(&b);
+    pool.RequestRelease<float>(&c);
+    // d does not scale with the minibatch size and is never released
+    pool.RequestAllocate<float>(c_deviceId, &d, 7, false, false);
+
+    pool.OptimizedMemoryAllocation();
+
+    const auto& plans = pool.GetMemoryPlans();
+    BOOST_REQUIRE(plans.find(c_deviceId) != plans.end());
+    const auto& plan = plans.at(c_deviceId);
+    BOOST_CHECK_EQUAL(plan.numRequests, 4);
+    BOOST_CHECK_EQUAL(plan.numUnsizedRequests, 0);
+
+    // b and c both fit into the space of a in the arena
+    BOOST_CHECK_EQUAL(plan.perSampleBytes, 100 * sizeof(float));
+    BOOST_CHECK_EQUAL(plan.fixedBytes, 7 * sizeof(float));
+    BOOST_CHECK_EQUAL(plan.PeakBytes(10), (100 * 10 + 7) * sizeof(float));
+
+    // buffer sharing can only hand a's buffer to one of them, and d shares it as well
+    BOOST_CHECK_EQUAL(plan.sharedPerSampleBytes, (100 + 40) * sizeof(float));
+    BOOST_CHECK_EQUAL(plan.sharedFixedBytes, 0);
+    BOOST_CHECK(a == b);
+    BOOST_CHECK(a != c);
+}
+
+BOOST_AUTO_TEST_CASE(ReallocateAfterRelease)
+{
+    MatrixPool pool;
+    pool.Reset();
+
+    // a is released after forward and requested again later (as for a value recomputed during backprop);
+    // b lives in between, c overlaps with the second occupancy of a
+    shared_ptr<Matrix<float>> a, b, c;
+    pool.RequestAllocate<float>(c_deviceId, &a, 100, true, false);
+    pool.RequestRelease<float>(&a);
+    pool.RequestAllocate<float>(c_deviceId, &b, 50, true, false);
+    pool.RequestRelease<float>(&b);
+    pool.RequestReallocate<float>(&a);
+    pool.RequestAllocate<float>(c_deviceId, &c, 30, true, false);
+    pool.RequestRelease<float>(&a);
+    pool.RequestRelease<float>(&c);
+
+    BOOST_REQUIRE(pool.GetMemInfo<float>(&a) != nullptr);
+    BOOST_CHECK_EQUAL(pool.GetMemInfo<float>(&a)->GetOccupancy().size(), 2);
+
+    pool.OptimizedMemoryAllocation();
+
+    BOOST_CHECK(a == b);
+    BOOST_CHECK(a != c);
+    BOOST_CHECK_EQUAL(pool.GetMemoryPlans().at(c_deviceId).perSampleBytes, (100 + 30) * sizeof(float));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
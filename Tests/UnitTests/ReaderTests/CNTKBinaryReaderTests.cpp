@@ -131,6 +131,45 @@ BOOST_AUTO_TEST_CASE(CNTKBinaryReader_50x20_jagged_sequences_sparse)
         true);
 };
 
+// The jagged sequences tests, with the input file mapped into memory (the output is the same)
+BOOST_AUTO_TEST_CASE(CNTKBinaryReader_50x20_jagged_sequences_dense_memory_mapped)
+{
+    HelperRunReaderTest<double>(
+        testDataPath() + "/Config/CNTKBinaryReader/test.cntk",
+        testDataPath() + "/Control/CNTKTextFormatReader/50x20_jagged_sequences_dense.txt",
+        testDataPath() + "/Control/CNTKBinaryReader/50x20_jagged_sequences_dense_memory_mapped_Output.txt",
+        "50x20_jagged_sequences_dense",
+        "reader",
+        508,  // epoch size
+        508,  // mb size 
+        1,  // num epochs
+        1,
+        0,
+        0,
+        1,
+        false, false, true,
+        { L"useMemoryMapping=true" });
+};
+
+BOOST_AUTO_TEST_CASE(CNTKBinaryReader_50x20_jagged_sequences_sparse_memory_mapped)
+{
+    HelperRunReaderTest<float>(
+        testDataPath() + "/Config/CNTKBinaryReader/test.cntk",
+        testDataPath() + "/Control/CNTKTextFormatReader/50x20_jagged_sequences_sparse.txt",
+        testDataPath() + "/Control/CNTKBinaryReader/50x20_jagged_sequences_sparse_memory_mapped_Output.txt",
+        "50x20_jagged_sequences_sparse",
+        "reader",
+        564,  // epoch size
+        564,  // mb size 
+        1,  // num epochs
+        1,
+        0,
+        0,
+        1,
+        true, false, true,
+        { L"useMemoryMapping=true" });
+};
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
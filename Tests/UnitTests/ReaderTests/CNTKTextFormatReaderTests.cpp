@@ -13,6 +13,8 @@
 #define _fileno fileno
 #endif
 #include <cstdio>
+#include <chrono>
+#include <random>
 #include <boost/scope_exit.hpp>
 #include "Common/ReaderTestHelper.h"
 #include "TextParser.h"
@@ -33,13 +35,14 @@ namespace CNTK {
         ChunkPtr m_chunk;
 
         CNTKTextFormatReaderTestRunner(const string& filename,
-            const vector<StreamDescriptor>& streams, unsigned int maxErrors) :
+            const vector<StreamDescriptor>& streams, unsigned int maxErrors, bool cacheIndex = false) :
             m_parser(std::make_shared<CorpusDescriptor>(true), wstring(filename.begin(), filename.end()), streams, true)
         {
             m_parser.SetMaxAllowedErrors(maxErrors);
             m_parser.SetTraceLevel(TextParser<ElemType>::TraceLevel::Info);
             m_parser.SetChunkSize(SIZE_MAX);
             m_parser.SetNumRetries(0);
+            m_parser.SetCacheIndex(cacheIndex);
             m_parser.Initialize();
         }
         // Retrieves a chunk of data.
@@ -47,6 +50,13 @@ namespace CNTK {
         {
             m_chunk = m_parser.GetChunk(0);
         }
+        // Retrieves the descriptions of the sequences in the (only) chunk.
+        vector<SequenceInfo> SequenceInfos()
+        {
+            vector<SequenceInfo> result;
+            m_parser.SequenceInfosForChunk(0, result);
+            return result;
+        }
     };
 }
 
@@ -875,6 +885,189 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_no_trailing_newline_invalid_input)
 };
 
 
+// Parses a generated file with numbers in various notations and compares the values against strtod()
+// (also reports the parsing throughput).
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_number_formats)
+{
+    const size_t sampleDimension = 8;
+    const size_t numLines = 20000;
+
+    vector<StreamDescriptor> streams(1);
+    streams[0].m_alias = "A";
+    streams[0].m_name = L"A";
+    streams[0].m_storageFormat = StorageFormat::Dense;
+    streams[0].m_sampleDimension = sampleDimension;
+
+    string filename = "number_formats.txt";
+    vector<double> expected;
+    {
+        boost::filesystem::remove(filename);
+        std::ofstream file;
+        file.open(filename, std::ofstream::out);
+        const char* formats[] = { "%.0f", "%.6f", "%.4e", "%g", "%+.3f", "%.2E", "%.1f", "%+g" };
+        std::mt19937 rng(123);
+        std::uniform_real_distribution<double> mantissa(-10, 10);
+        std::uniform_int_distribution<int> exponent(-12, 12);
+        for (size_t i = 0; i < numLines; i++)
+        {
+            file << "|A";
+            for (size_t j = 0; j < sampleDimension; j++)
+            {
+                char text[64];
+                snprintf(text, sizeof(text), formats[(i + j) % _countof(formats)], mantissa(rng) * pow(10.0, exponent(rng)));
+                expected.push_back(strtod(text, nullptr));
+                file << (j % 2 ? "\t" : " ") << text;
+            }
+            // an input that is not in the config is skipped
+            if (i == 0)
+                file << " |B 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20";
+            file << "\n";
+        }
+    }
+
+    CNTKTextFormatReaderTestRunner<double> testRunner(filename, streams, 0);
+    auto start = std::chrono::high_resolution_clock::now();
+    testRunner.LoadChunk();
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    BOOST_TEST_MESSAGE("Parsed " << boost::filesystem::file_size(filename) / (1024.0 * 1024.0) << " MB in "
+        << elapsed.count() << " seconds (" << boost::filesystem::file_size(filename) / (1024.0 * 1024.0) / elapsed.count() << " MB/s)");
+
+    for (size_t i = 0; i < numLines; i++)
+    {
+        vector<SequenceDataPtr> data;
+        testRunner.m_chunk->GetSequence(i, data);
+        BOOST_REQUIRE_EQUAL(data[0]->m_numberOfSamples, 1);
+        const double* values = reinterpret_cast<const double*>(data[0]->GetDataBuffer());
+        for (size_t j = 0; j < sampleDimension; j++)
+            BOOST_REQUIRE_CLOSE(values[j], expected[i * sampleDimension + j], 1e-10);
+    }
+};
+
+// Builds the index of a file with index caching enabled, and checks that the index loaded from the cache on the next
+// run is the same, and that the cache is not used once the file has changed.
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_index_cache)
+{
+    vector<StreamDescriptor> streams(1);
+    streams[0].m_alias = "A";
+    streams[0].m_name = L"A";
+    streams[0].m_storageFormat = StorageFormat::Dense;
+    streams[0].m_sampleDimension = 1;
+
+    string filename = "index_cache.txt";
+    string cacheFilename = filename + ".index";
+    auto writeInput = [&](size_t numSequences)
+    {
+        boost::filesystem::remove(filename);
+        std::ofstream file;
+        file.open(filename, std::ofstream::out);
+        for (size_t i = 0; i < numSequences; i++)
+            for (size_t j = 0; j <= i % 3; j++)
+                file << i << " |A " << i * 10 + j << "\n";
+    };
+
+    auto checkSequences = [](const vector<SequenceInfo>& actual, const vector<SequenceInfo>& expected)
+    {
+        BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+        for (size_t i = 0; i < actual.size(); i++)
+        {
+            BOOST_REQUIRE_EQUAL(actual[i].m_indexInChunk, expected[i].m_indexInChunk);
+            BOOST_REQUIRE_EQUAL(actual[i].m_numberOfSamples, expected[i].m_numberOfSamples);
+            BOOST_REQUIRE_EQUAL(actual[i].m_key.m_sequence, expected[i].m_key.m_sequence);
+        }
+    };
+
+    boost::filesystem::remove(cacheFilename);
+    writeInput(10);
+    vector<SequenceInfo> expected;
+    {
+        CNTKTextFormatReaderTestRunner<double> testRunner(filename, streams, 0);
+        expected = testRunner.SequenceInfos();
+    }
+    BOOST_REQUIRE(!boost::filesystem::exists(cacheFilename));
+    {
+        CNTKTextFormatReaderTestRunner<double> testRunner(filename, streams, 0, true);
+        checkSequences(testRunner.SequenceInfos(), expected);
+    }
+    BOOST_REQUIRE(boost::filesystem::exists(cacheFilename));
+    {
+        CNTKTextFormatReaderTestRunner<double> testRunner(filename, streams, 0, true);
+        checkSequences(testRunner.SequenceInfos(), expected);
+
+        testRunner.LoadChunk();
+        vector<SequenceDataPtr> data;
+        testRunner.m_chunk->GetSequence(5, data);
+        BOOST_REQUIRE_EQUAL(data[0]->m_numberOfSamples, 3);
+        BOOST_REQUIRE_EQUAL(reinterpret_cast<const double*>(data[0]->GetDataBuffer())[2], 52.);
+    }
+
+    // the cache must not be used for a different input
+    writeInput(20);
+    {
+        CNTKTextFormatReaderTestRunner<double> testRunner(filename, streams, 0);
+        expected = testRunner.SequenceInfos();
+    }
+    BOOST_REQUIRE_EQUAL(expected.size(), 20);
+    {
+        CNTKTextFormatReaderTestRunner<double> testRunner(filename, streams, 0, true);
+        checkSequences(testRunner.SequenceInfos(), expected);
+    }
+
+    boost::filesystem::remove(cacheFilename);
+};
+
+// Checks that the index built in parallel from several ranges of the input is the same as the one built serially,
+// for inputs with numeric, symbolic and without sequence ids.
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_parallel_indexing)
+{
+    string filename = "parallel_indexing.txt";
+    std::mt19937 rng(7);
+    for (int format = 0; format < 3; format++)
+    {
+        {
+            boost::filesystem::remove(filename);
+            std::ofstream file;
+            file.open(filename, std::ofstream::out);
+            for (size_t i = 0; i < 5000; i++)
+            {
+                for (size_t j = 0; j <= rng() % 4; j++)
+                {
+                    if (format == 1)
+                        file << i << " ";
+                    else if (format == 2)
+                        file << "seq" << i % 1000 << " ";
+                    file << "|A " << i << " " << j << "\n";
+                }
+            }
+        }
+
+        const bool numericKeys = format != 2;
+        vector<tuple<string, uint32_t, size_t, size_t>> sequences[2];
+        vector<size_t> chunkOffsets[2];
+        for (int parallel = 0; parallel < 2; parallel++)
+        {
+            auto corpus = std::make_shared<CorpusDescriptor>(numericKeys);
+            auto f = std::shared_ptr<FILE>(fopenOrDie(filename, "rb"), [](FILE* f) { fclose(f); });
+            Indexer indexer(f.get(), false, false, '|', 4096, "", 1024);
+            if (parallel)
+                indexer.EnableParallelBuild(wstring(filename.begin(), filename.end()), 7, 1000);
+            indexer.Build(corpus);
+            BOOST_REQUIRE_EQUAL(indexer.HasSequenceIds(), format != 0);
+
+            for (const auto& chunk : indexer.GetIndex().Chunks())
+            {
+                chunkOffsets[parallel].push_back(chunk.m_offset);
+                for (const auto& s : chunk.Sequences())
+                    sequences[parallel].emplace_back(corpus->IdToKey(s.m_key), s.m_numberOfSamples, chunk.m_offset + s.OffsetInChunk(), s.SizeInBytes());
+            }
+        }
+
+        BOOST_REQUIRE(chunkOffsets[0].size() > 1);
+        BOOST_REQUIRE(chunkOffsets[0] == chunkOffsets[1]);
+        BOOST_REQUIRE(sequences[0] == sequences[1]);
+    }
+    boost::filesystem::remove(filename);
+};
+
 BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_extra_input_should_be_ignored)
 {
     vector<StreamDescriptor> streams(1);
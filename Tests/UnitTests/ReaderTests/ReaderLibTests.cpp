@@ -6,6 +6,7 @@
 #include "stdafx.h"
 #include <numeric>
 #include <random>
+#include <atomic>
 #include "NoRandomizer.h"
 #include "DataDeserializer.h"
 #include "BlockRandomizer.h"
@@ -16,6 +17,9 @@
 #include "CudaMemoryProvider.h"
 #include "HeapMemoryProvider.h"
 #include "MemoryBuffer.h"
+#include "TransformController.h"
+#include "ReaderUtil.h"
+#include "Globals.h"
 
 #pragma warning(push)
 // disable warning about possible mod 0 operation in uniform_int_distribution
@@ -777,6 +781,386 @@ BOOST_AUTO_TEST_CASE(BlockRandomizerOneEpochWithChunks2)
     BlockRandomizerOneEpochWithChunks2Test(true);
 }
 
+BOOST_AUTO_TEST_CASE(BlockRandomizerPrefetchConfiguration)
+{
+    size_t chunkSizeInSamples = 1000;
+    size_t sweepNumberOfSamples = 50000;
+    uint32_t maxSequenceLength = 100;
+    size_t randomizationWindow = chunkSizeInSamples * 5;
+    auto deserializer = make_shared<SequentialDeserializer>(0, chunkSizeInSamples, sweepNumberOfSamples, maxSequenceLength);
+
+    auto expectedRandomizer = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true, false);
+    vector<float> expected;
+    for (size_t epoch = 0; epoch < 3; epoch++)
+    {
+        auto data = ReadFullEpoch(expectedRandomizer, sweepNumberOfSamples / 2, epoch);
+        expected.insert(expected.end(), data.begin(), data.end());
+    }
+
+    // Deeper prefetching, with and without a memory budget, and with several loader threads
+    // must not change the data that is returned.
+    struct { size_t maxChunks; size_t maxBytes; size_t numThreads; } configurations[] = {
+        { 4, 0, 1 },
+        { 4, 0, 3 },
+        { 8, 2 * chunkSizeInSamples * sizeof(float), 2 },
+        { 8, 1, 2 }, // budget smaller than a single chunk
+    };
+    for (const auto& c : configurations)
+    {
+        auto randomizer = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true, false);
+        randomizer->SetPrefetchConfiguration(c.maxChunks, c.maxBytes, c.numThreads);
+        vector<float> actual;
+        for (size_t epoch = 0; epoch < 3; epoch++)
+        {
+            auto data = ReadFullEpoch(randomizer, sweepNumberOfSamples / 2, epoch);
+            actual.insert(actual.end(), data.begin(), data.end());
+        }
+        BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+    }
+
+    auto randomizer = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true, false);
+    BOOST_CHECK_THROW(randomizer->SetPrefetchConfiguration(0, 0, 1), std::invalid_argument);
+    BOOST_CHECK_THROW(randomizer->SetPrefetchConfiguration(1, 0, 0), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(NoRandomizerPrefetchConfiguration)
+{
+    size_t chunkSizeInSamples = 1000;
+    size_t sweepNumberOfSamples = 20000;
+    uint32_t maxSequenceLength = 100;
+    auto deserializer = make_shared<SequentialDeserializer>(0, chunkSizeInSamples, sweepNumberOfSamples, maxSequenceLength);
+
+    auto expectedRandomizer = make_shared<NoRandomizer>(deserializer);
+    vector<float> expected;
+    for (size_t epoch = 0; epoch < 3; epoch++)
+    {
+        auto data = ReadFullEpoch(expectedRandomizer, sweepNumberOfSamples / 2 + 123, epoch);
+        expected.insert(expected.end(), data.begin(), data.end());
+    }
+
+    // Prefetching (across the sweep boundary) must not change the data that is returned.
+    struct { size_t maxChunks; size_t maxBytes; size_t numThreads; bool multithreaded; } configurations[] = {
+        { 1, 0, 1, false },
+        { 4, 0, 1, false },
+        { 4, 0, 3, true },
+        { 8, 2 * chunkSizeInSamples * sizeof(float), 2, false },
+        { 8, 1, 2, true }, // budget smaller than a single chunk
+    };
+    for (const auto& c : configurations)
+    {
+        auto randomizer = make_shared<NoRandomizer>(deserializer, c.multithreaded);
+        randomizer->SetPrefetchConfiguration(c.maxChunks, c.maxBytes, c.numThreads);
+        vector<float> actual;
+        for (size_t epoch = 0; epoch < 3; epoch++)
+        {
+            auto data = ReadFullEpoch(randomizer, sweepNumberOfSamples / 2 + 123, epoch);
+            actual.insert(actual.end(), data.begin(), data.end());
+        }
+        BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+
+        // Going back to the beginning drops the prefetched chunks that are not needed anymore.
+        auto again = ReadFullEpoch(randomizer, sweepNumberOfSamples / 2 + 123, 0);
+        BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.begin() + again.size(), again.begin(), again.end());
+    }
+
+    auto randomizer = make_shared<NoRandomizer>(deserializer);
+    BOOST_CHECK_THROW(randomizer->SetPrefetchConfiguration(0, 0, 1), std::invalid_argument);
+    BOOST_CHECK_THROW(randomizer->SetPrefetchConfiguration(1, 0, 0), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(ReaderThreadLimit)
+{
+    size_t chunkSizeInSamples = 1000;
+    size_t sweepNumberOfSamples = 10000;
+    uint32_t maxSequenceLength = 100;
+    auto deserializer = make_shared<SequentialDeserializer>(0, chunkSizeInSamples, sweepNumberOfSamples, maxSequenceLength);
+    auto expected = ReadFullEpoch(make_shared<NoRandomizer>(deserializer), sweepNumberOfSamples, 0);
+
+    // Not limited, the readers use the threads they ask for (as many as there are cores if none).
+    BOOST_CHECK_EQUAL(Globals::GetNumReaderWorkerThreads(5), 5);
+    BOOST_CHECK_EQUAL(Globals::GetNumReaderWorkerThreads(0), std::max(1u, std::thread::hardware_concurrency()));
+
+    Globals::SetNumReaderThreads(2);
+    BOOST_CHECK_EQUAL(Globals::GetNumReaderThreads(), 2);
+    BOOST_CHECK_EQUAL(Globals::GetNumReaderWorkerThreads(5), 2);
+    BOOST_CHECK_EQUAL(Globals::GetNumReaderWorkerThreads(1), 1);
+    BOOST_CHECK_EQUAL(Globals::GetNumReaderWorkerThreads(0), 2);
+    BOOST_CHECK_EQUAL(Globals::GetNumReaderOmpThreads(), 2);
+
+    // The limit does not change the data that is returned.
+    auto randomizer = make_shared<NoRandomizer>(deserializer, /*multithreadedGetNextSequences =*/ true);
+    randomizer->SetPrefetchConfiguration(4, 0, 8);
+    auto actual = ReadFullEpoch(randomizer, sweepNumberOfSamples, 0);
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+
+    Globals::SetNumReaderThreads(0);
+}
+
+// A deserializer with chunks of the given numbers of sequences of one sample each, with the values 0 .. N-1.
+class VariableChunkDeserializer : public DataDeserializer
+{
+    vector<size_t> m_chunkBegins;
+    vector<vector<float>> m_sequenceData;
+    vector<StreamInformation> m_streams;
+
+public:
+    VariableChunkDeserializer(const vector<size_t>& chunkSizes)
+    {
+        m_chunkBegins.push_back(0);
+        for (size_t size : chunkSizes)
+            m_chunkBegins.push_back(m_chunkBegins.back() + size);
+        for (size_t i = 0; i < m_chunkBegins.back(); i++)
+            m_sequenceData.push_back(vector<float>(1, (float)i));
+
+        StreamInformation si;
+        si.m_name = L"input";
+        si.m_id = 0;
+        si.m_storageFormat = StorageFormat::Dense;
+        si.m_elementType = DataType::Float;
+        si.m_sampleLayout = NDShape({ 1 });
+        m_streams.push_back(si);
+    }
+
+    vector<StreamInformation> StreamInfos() override
+    {
+        return m_streams;
+    }
+
+    ChunkPtr GetChunk(ChunkIdType chunkId) override
+    {
+        return make_shared<MockChunk>(m_chunkBegins[chunkId], m_chunkBegins[chunkId + 1], m_sequenceData, 1);
+    }
+
+    bool GetSequenceInfo(const SequenceInfo&, SequenceInfo&) override
+    {
+        throw logic_error("Not implemented");
+    }
+
+    vector<ChunkInfo> ChunkInfos() override
+    {
+        vector<ChunkInfo> result;
+        for (ChunkIdType i = 0; i + 1 < m_chunkBegins.size(); i++)
+            result.push_back(ChunkInfo{ i, m_chunkBegins[i + 1] - m_chunkBegins[i], m_chunkBegins[i + 1] - m_chunkBegins[i] });
+        return result;
+    }
+
+    void SequenceInfosForChunk(ChunkIdType chunkId, vector<SequenceInfo>& descriptions) override
+    {
+        for (size_t i = m_chunkBegins[chunkId]; i < m_chunkBegins[chunkId + 1]; i++)
+            descriptions.push_back(SequenceInfo{ i, 1, chunkId, { 0, static_cast<uint32_t>(i) } });
+    }
+};
+
+BOOST_AUTO_TEST_CASE(BlockRandomizerBalancedChunkDistribution)
+{
+    // Every fifth chunk is twenty times larger than the others.
+    vector<size_t> chunkSizes;
+    for (size_t i = 0; i < 40; i++)
+        chunkSizes.push_back(i % 5 == 0 ? 100 : 5);
+    const size_t maxChunkSize = 100;
+    const size_t sweepNumberOfSamples = std::accumulate(chunkSizes.begin(), chunkSizes.end(), (size_t)0);
+    auto deserializer = make_shared<VariableChunkDeserializer>(chunkSizes);
+
+    for (size_t numberOfWorkers : { 2, 3, 7 })
+    {
+        vector<float> allValues;
+        vector<size_t> workerSamples;
+        for (size_t rank = 0; rank < numberOfWorkers; rank++)
+        {
+            auto randomizer = make_shared<BlockRandomizer>(0, 300, deserializer, true, false);
+            randomizer->SetBalancedChunkDistribution(true);
+
+            EpochConfiguration config;
+            config.m_numberOfWorkers = numberOfWorkers;
+            config.m_workerRank = rank;
+            config.m_minibatchSizeInSamples = 50;
+            config.m_totalEpochSizeInSamples = sweepNumberOfSamples;
+            config.m_epochIndex = 0;
+            randomizer->StartEpoch(config);
+
+            size_t samples = 0;
+            for (;;)
+            {
+                auto sequences = randomizer->GetNextSequences(50, 50);
+                if (!sequences.m_data.empty())
+                {
+                    for (auto& s : sequences.m_data[0])
+                    {
+                        allValues.push_back(*(float*)s->GetDataBuffer());
+                        samples += s->m_numberOfSamples;
+                    }
+                }
+                if (sequences.m_endOfEpoch)
+                    break;
+            }
+            workerSamples.push_back(samples);
+        }
+
+        // Each sample is read by exactly one worker, and the workers' shares differ by at most one chunk.
+        sort(allValues.begin(), allValues.end());
+        BOOST_REQUIRE_EQUAL(allValues.size(), sweepNumberOfSamples);
+        for (size_t i = 0; i < allValues.size(); i++)
+            BOOST_REQUIRE_EQUAL(allValues[i], (float)i);
+
+        auto minmax = std::minmax_element(workerSamples.begin(), workerSamples.end());
+        BOOST_CHECK_LE(*minmax.second - *minmax.first, maxChunkSize);
+    }
+}
+
+// Reads an epoch in minibatches of mbSize samples, returning the values and the number of padding frames
+// that the minibatches would have if all their sequences were padded to the longest one.
+static vector<float> ReadEpochMeasuringPadding(SequenceEnumeratorPtr randomizer, size_t epochSize, size_t mbSize, size_t& numPaddingFrames)
+{
+    EpochConfiguration config;
+    config.m_numberOfWorkers = 1;
+    config.m_workerRank = 0;
+    config.m_minibatchSizeInSamples = mbSize;
+    config.m_totalEpochSizeInSamples = epochSize;
+    config.m_epochIndex = 0;
+    randomizer->StartEpoch(config);
+
+    vector<float> values;
+    numPaddingFrames = 0;
+    for (;;)
+    {
+        auto sequences = randomizer->GetNextSequences(mbSize, mbSize);
+        if (sequences.m_data.empty())
+            break;
+        size_t maxLength = 0, numSamples = 0;
+        for (auto& s : sequences.m_data[0])
+        {
+            maxLength = max(maxLength, (size_t)s->m_numberOfSamples);
+            numSamples += s->m_numberOfSamples;
+            float* casted = (float*)s->GetDataBuffer();
+            values.insert(values.end(), casted, casted + s->m_numberOfSamples);
+        }
+        numPaddingFrames += sequences.m_data[0].size() * maxLength - numSamples;
+        if (sequences.m_endOfEpoch)
+            break;
+    }
+    return values;
+}
+
+BOOST_AUTO_TEST_CASE(BlockRandomizerSequenceLengthBuckets)
+{
+    size_t chunkSizeInSamples = 10000;
+    size_t sweepNumberOfSamples = 100000;
+    uint32_t maxSequenceLength = 100;
+    size_t randomizationWindow = chunkSizeInSamples * 4;
+    size_t mbSize = 500;
+    auto deserializer = make_shared<SequentialDeserializer>(0, chunkSizeInSamples, sweepNumberOfSamples, maxSequenceLength);
+
+    size_t paddingWithoutBuckets;
+    auto randomizer = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true, false);
+    auto withoutBuckets = ReadEpochMeasuringPadding(randomizer, sweepNumberOfSamples, mbSize, paddingWithoutBuckets);
+
+    size_t paddingWithBuckets;
+    auto bucketed = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true, false);
+    bucketed->SetSequenceLengthBuckets({ 25, 50, 75 });
+    auto withBuckets = ReadEpochMeasuringPadding(bucketed, sweepNumberOfSamples, mbSize, paddingWithBuckets);
+
+    // the same data in a different order, with much less padding
+    BOOST_CHECK(withBuckets != withoutBuckets);
+    BOOST_CHECK(CheckFullSweep(sweepNumberOfSamples, withBuckets));
+    BOOST_CHECK_LT(paddingWithBuckets * 2, paddingWithoutBuckets);
+
+    // the order is reproducible, also when an epoch is restarted from a checkpointed position
+    size_t padding;
+    auto another = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true, false);
+    another->SetSequenceLengthBuckets({ 25, 50, 75 });
+    auto again = ReadEpochMeasuringPadding(another, sweepNumberOfSamples, mbSize, padding);
+    BOOST_CHECK_EQUAL_COLLECTIONS(withBuckets.begin(), withBuckets.end(), again.begin(), again.end());
+
+    auto firstHalf = ReadFullEpoch(another, sweepNumberOfSamples / 2, 0);
+    auto secondHalf = ReadFullEpoch(another, sweepNumberOfSamples / 2, 1);
+    EpochConfiguration config;
+    config.m_numberOfWorkers = 1;
+    config.m_workerRank = 0;
+    config.m_minibatchSizeInSamples = 1;
+    config.m_totalEpochSizeInSamples = std::numeric_limits<size_t>().max() / 2;
+    config.m_epochIndex = 0;
+    another->StartEpoch(config);
+    std::map<std::wstring, size_t> state;
+    state[g_minibatchSourcePosition] = firstHalf.size();
+    another->SetState(state);
+    auto secondHalfAgain = ReadNextSamples(another, secondHalf.size());
+    BOOST_CHECK_EQUAL_COLLECTIONS(secondHalf.begin(), secondHalf.end(), secondHalfAgain.begin(), secondHalfAgain.end());
+
+    BOOST_CHECK_THROW(bucketed->SetSequenceLengthBuckets({ 20, 10 }), std::invalid_argument);
+    BOOST_CHECK_THROW(bucketed->SetSequenceLengthBuckets({ 0, 10 }), std::invalid_argument);
+}
+
+// Doubles the values of dense float sequences, counting the sequences it has transformed.
+class MockTransformer : public Transformer
+{
+    struct TransformedSequenceData : MockDenseSequenceData
+    {
+        vector<float> m_values;
+    };
+
+public:
+    MockTransformer() : m_numTransformed(0) {}
+
+    void StartEpoch(const EpochConfiguration&) override {}
+
+    StreamInformation Transform(const StreamInformation& inputStream) override
+    {
+        return inputStream;
+    }
+
+    SequenceDataPtr Transform(SequenceDataPtr inputSequence) override
+    {
+        auto& input = static_cast<DenseSequenceData&>(*inputSequence);
+        auto result = make_shared<TransformedSequenceData>();
+        const float* values = static_cast<const float*>(input.GetDataBuffer());
+        for (size_t i = 0; i < input.m_numberOfSamples; i++)
+            result->m_values.push_back(2 * values[i]);
+        result->m_data = result->m_values.data();
+        result->m_sampleShape = input.GetSampleShape();
+        result->m_numberOfSamples = input.m_numberOfSamples;
+        result->m_elementType = input.m_elementType;
+        result->m_key = input.m_key;
+        m_numTransformed++;
+        return result;
+    }
+
+    std::atomic<size_t> m_numTransformed;
+};
+
+BOOST_AUTO_TEST_CASE(TransformControllerAppliesTransformsOnce)
+{
+    vector<float> data(10);
+    iota(data.begin(), data.end(), 0.0f);
+
+    // The transforms are applied by the randomizer when it reads sequences in parallel, and by the controller otherwise.
+    for (bool multithreaded : { false, true })
+    {
+        auto mockDeserializer = make_shared<MockDeserializer>(5, 2, data);
+        auto randomizer = make_shared<BlockRandomizer>(0, 4, mockDeserializer, true, multithreaded);
+        auto transformer = make_shared<MockTransformer>();
+        auto controller = make_shared<TransformController>(vector<Transformation>{ Transformation{ transformer, L"input" } }, randomizer);
+
+        EpochConfiguration epochConfiguration;
+        epochConfiguration.m_numberOfWorkers = 1;
+        epochConfiguration.m_workerRank = 0;
+        epochConfiguration.m_minibatchSizeInSamples = 0;
+        epochConfiguration.m_totalEpochSizeInSamples = data.size();
+        epochConfiguration.m_epochIndex = 0;
+        controller->StartEpoch(epochConfiguration);
+
+        vector<float> expected{ 16, 18, 2, 0, 12, 14, 4, 6, 8, 10 };
+        vector<float> actual;
+        for (int i = 0; i < data.size(); i += 2)
+        {
+            Sequences sequences = controller->GetNextSequences(2, 2);
+            for (const auto& s : sequences.m_data[0])
+                actual.push_back(*((float*)static_cast<DenseSequenceData&>(*s).GetDataBuffer()));
+        }
+        BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+        BOOST_CHECK_EQUAL(transformer->m_numTransformed.load(), data.size());
+    }
+}
+
 void RandomizerChaosMonkeyTest(SequenceEnumerator& randomizer, size_t sweepSize, int seed)
 {
     std::mt19937 rng(seed);
@@ -1017,6 +1401,26 @@ BOOST_AUTO_TEST_CASE(LiteralCorpusDescriptor)
     BOOST_CHECK_NO_THROW(corpus.KeyToId("not a number"));
 }
 
+BOOST_AUTO_TEST_CASE(LiteralCorpusDescriptorRegistersKeys)
+{
+    CorpusDescriptor corpus(false);
+
+    // Enough keys, some of them long, to grow the key table and the pages the keys are stored in.
+    const size_t numberOfKeys = 100000;
+    auto key = [](size_t i) { return std::to_string(i) + std::string(i % 1000 == 0 ? 100000 : i % 7, 'k'); };
+    for (size_t i = 0; i < numberOfKeys; ++i)
+        BOOST_REQUIRE_EQUAL(i, corpus.KeyToId(key(i)));
+
+    BOOST_CHECK_EQUAL(numberOfKeys, corpus.KeyToId(""));
+    for (size_t i = 0; i < numberOfKeys; i += 97)
+    {
+        BOOST_CHECK_EQUAL(i, corpus.KeyToId(key(i)));
+        BOOST_CHECK_EQUAL(key(i), corpus.IdToKey(i));
+    }
+    BOOST_CHECK_EQUAL("", corpus.IdToKey(numberOfKeys));
+    BOOST_CHECK_THROW(corpus.IdToKey(numberOfKeys + 1), std::exception);
+}
+
 BOOST_AUTO_TEST_CASE(CorpusDescriptorFromFile)
 {
     FILE* test = fopen("test.tmp", "w+");
@@ -2122,6 +2526,110 @@ BOOST_AUTO_TEST_CASE(TestTruncatedBpttPacker)
     BOOST_TEST(!mb.m_endOfSweep);
 }
 
+BOOST_AUTO_TEST_CASE(TruncatedBpttPackerPacksAllSamples)
+{
+    size_t sweepNumberOfSamples = 3000;
+    // (a single chunk, because the mock sequences do not keep their chunk alive while they wait in the slots)
+    auto deserializer = make_shared<SequentialDeserializer>(0, sweepNumberOfSamples, sweepNumberOfSamples, 20);
+
+    // With a single and with several parallel sequences, and truncation lengths shorter and longer than the sequences.
+    for (size_t minibatchSize : { 7, 40, 400 })
+    {
+        auto noRandomizer = make_shared<NoRandomizer>(deserializer);
+        auto packer = std::make_shared<TruncatedBPTTPacker>(noRandomizer, deserializer->StreamInfos());
+
+        EpochConfiguration config;
+        config.m_numberOfWorkers = 1;
+        config.m_workerRank = 0;
+        config.m_minibatchSizeInSamples = minibatchSize;
+        config.m_truncationSize = 7;
+        config.m_totalEpochSizeInSweeps = 1;
+        config.m_epochIndex = 0;
+
+        noRandomizer->StartEpoch(config);
+        packer->SetConfiguration(config, std::vector<MemoryProviderPtr> { std::make_shared<HeapMemoryProvider>() });
+
+        // The values of the samples are their positions in the sweep, so the packed sequences must hold
+        // consecutive values, and all of them once.
+        vector<float> actual;
+        while (true)
+        {
+            auto mb = packer->ReadMinibatch();
+            if (mb.m_data.empty())
+                break;
+
+            const auto& layout = mb.m_data[0]->m_layout;
+            const float* data = (const float*)mb.m_data[0]->m_data;
+            for (const auto& sequence : layout->GetAllSequences())
+            {
+                if (sequence.seqId == GAP_SEQUENCE_ID)
+                    continue;
+
+                size_t begin = (size_t)max(sequence.tBegin, (ptrdiff_t)0);
+                size_t end = min((size_t)sequence.tEnd, layout->GetNumTimeSteps());
+                for (size_t t = begin; t < end; ++t)
+                {
+                    float value = data[t * layout->GetNumParallelSequences() + sequence.s];
+                    if (t > begin)
+                        BOOST_REQUIRE_EQUAL(value, actual.back() + 1);
+                    actual.push_back(value);
+                }
+            }
+
+            if (mb.m_endOfEpoch)
+                break;
+        }
+
+        sort(actual.begin(), actual.end());
+        vector<float> expected(sweepNumberOfSamples);
+        iota(expected.begin(), expected.end(), 0.0f);
+        BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(DecodeBase64MatchesEncoding)
+{
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> byteDistribution(0, 255);
+
+    std::vector<char> decoded;
+    // Lengths around the 16 character blocks of the vectorized decoder, with all three paddings.
+    for (size_t length = 0; length < 100; length++)
+    {
+        std::vector<unsigned char> bytes(length);
+        for (auto& b : bytes)
+            b = (unsigned char)byteDistribution(rng);
+
+        std::string encoded;
+        for (size_t i = 0; i < length; i += 3)
+        {
+            uint32_t triple = bytes[i] << 16 | (i + 1 < length ? bytes[i + 1] << 8 : 0) | (i + 2 < length ? bytes[i + 2] : 0);
+            encoded += base64IndexTable[(triple >> 18) & 0x3F];
+            encoded += base64IndexTable[(triple >> 12) & 0x3F];
+            encoded += i + 1 < length ? base64IndexTable[(triple >> 6) & 0x3F] : '=';
+            encoded += i + 2 < length ? base64IndexTable[triple & 0x3F] : '=';
+        }
+
+        BOOST_REQUIRE(DecodeBase64(encoded.data(), encoded.data() + encoded.size(), decoded));
+        BOOST_REQUIRE_EQUAL(decoded.size(), length);
+        BOOST_CHECK(std::equal(bytes.begin(), bytes.end(), decoded.begin(), [](unsigned char b, char d) { return b == (unsigned char)d; }));
+
+        if (encoded.size() >= 4)
+        {
+            // An invalid character anywhere, in a vectorized block or the scalar tail, fails the decoding.
+            std::string invalid = encoded;
+            invalid[encoded.size() / 3] = '*';
+            BOOST_CHECK(!DecodeBase64(invalid.data(), invalid.data() + invalid.size(), decoded));
+            invalid = encoded;
+            invalid[0] = '=';
+            BOOST_CHECK(!DecodeBase64(invalid.data(), invalid.data() + invalid.size(), decoded));
+        }
+    }
+
+    std::string misaligned = "QUJD=";
+    BOOST_CHECK(!DecodeBase64(misaligned.data(), misaligned.data() + misaligned.size(), decoded));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
@@ -645,6 +645,109 @@ void TestChangingParameterValues(size_t rank, const DeviceDescriptor& device)
     }
 }
 
+// Alternating between requested outputs that the Function was not compiled for switches between its computation networks.
+void TestChangingRequestedOutputs(const DeviceDescriptor& device)
+{
+    NDShape shape({ 5 });
+    auto numElements = shape.TotalSize();
+
+    auto param = Parameter(shape, DataType::Float, GlorotUniformInitializer(), device);
+    auto plus = Plus(param, param);
+    auto times = ElementTimes(plus, param);
+
+    auto evaluate = [&](const Variable& output) -> std::vector<float>
+    {
+        std::unordered_map<Variable, ValuePtr> outputs = { { output, nullptr } };
+        times->Forward(std::unordered_map<Variable, ValuePtr>({}), outputs, device);
+        auto cpuView = outputs[output]->Data()->DeepClone(DeviceDescriptor::CPUDevice());
+        return std::vector<float>(cpuView->DataBuffer<float>(), cpuView->DataBuffer<float>() + numElements);
+    };
+
+    for (int iteration = 0; iteration < 3; iteration++)
+    {
+        std::vector<float> newValues(numElements);
+        for (int i = 0; i < numElements; i++)
+            newValues[i] = float(iteration + 1) / (i + 1.0f);
+        param.SetValue(MakeSharedObject<NDArrayView>(shape, newValues, false));
+
+        // (the inner output 'plus' is not an output of the network compiled for 'times')
+        auto timesData = evaluate(times->Output());
+        auto plusData = evaluate(plus->Output());
+        for (int i = 0; i < numElements; i++)
+        {
+            FloatingPointCompare<float>(plusData[i], 2 * newValues[i], "Function output does not match the expected value.");
+            FloatingPointCompare<float>(timesData[i], 2 * newValues[i] * newValues[i], "Function output does not match the expected value.");
+        }
+    }
+}
+
+void TestForwardAsync(const DeviceDescriptor& device)
+{
+    NDShape shape({ 7 });
+    auto numElements = shape.TotalSize();
+
+    auto inputVar = InputVariable(shape, DataType::Float, L"features");
+    auto param = Parameter(shape, DataType::Float, GlorotUniformInitializer(), device);
+    auto times = ElementTimes(Plus(inputVar, param), param);
+
+    std::vector<float> inputData(numElements);
+    for (size_t i = 0; i < numElements; i++)
+        inputData[i] = float(i);
+    auto input = Value::CreateBatch(shape, inputData, device);
+
+    std::unordered_map<Variable, ValuePtr> outputs = { { times->Output(), nullptr } };
+    times->Forward({ { inputVar, input } }, outputs, device);
+    auto expected = outputs[times->Output()]->Data()->DeepClone(DeviceDescriptor::CPUDevice());
+
+    auto result = times->ForwardAsync({ { inputVar, input } }, { { times->Output(), nullptr } }, device);
+    auto actual = result.get().at(times->Output())->Data()->DeepClone(DeviceDescriptor::CPUDevice());
+    for (size_t i = 0; i < numElements; i++)
+        FloatingPointCompare<float>(actual->DataBuffer<float>()[i], expected->DataBuffer<float>()[i], "ForwardAsync output does not match the output of Forward.");
+}
+
+void TestConstantFolding(const DeviceDescriptor& device)
+{
+    NDShape shape({ 2, 3 });
+    auto numElements = shape.TotalSize();
+
+    std::vector<float> constantData(numElements), scaleData(numElements, 2.0f), inputData(numElements);
+    for (size_t i = 0; i < numElements; i++)
+    {
+        constantData[i] = float(i);
+        inputData[i] = 10.0f * i;
+    }
+
+    auto constant = Constant(MakeSharedObject<NDArrayView>(shape, constantData.data(), numElements, DeviceDescriptor::CPUDevice())->DeepClone(device));
+    auto scale = Constant(MakeSharedObject<NDArrayView>(shape, scaleData.data(), numElements, DeviceDescriptor::CPUDevice())->DeepClone(device));
+
+    // A constant subgraph, with a chain of Reshapes restoring the shape, and a Transpose undoing a Transpose
+    auto folded = Reshape(Reshape(ElementTimes(constant, scale), NDShape({ numElements })), shape);
+    auto inputVar = InputVariable(shape, DataType::Float, L"features");
+    auto output = Plus(TransposeAxes(TransposeAxes(inputVar, Axis(0), Axis(1)), Axis(0), Axis(1)), folded);
+
+    auto input = Value::CreateBatch(shape, inputData, device);
+    auto checkOutput = [&](float scaleValue) {
+        std::unordered_map<Variable, ValuePtr> outputs = { { output->Output(), nullptr } };
+        output->Forward({ { inputVar, input } }, outputs, device);
+        auto actual = outputs[output->Output()]->Data()->DeepClone(DeviceDescriptor::CPUDevice());
+        for (size_t i = 0; i < numElements; i++)
+            FloatingPointCompare<float>(actual->DataBuffer<float>()[i], inputData[i] + scaleValue * constantData[i], "Output of the Function with a folded constant subgraph is incorrect.");
+    };
+
+    checkOutput(2.0f);
+
+    // Changing a folded Constant must be reflected in the output
+    std::vector<float> newScaleData(numElements, 3.0f);
+    scale.SetValue(MakeSharedObject<NDArrayView>(shape, newScaleData.data(), numElements, DeviceDescriptor::CPUDevice())->DeepClone(device));
+    checkOutput(3.0f);
+
+    // Same without folding
+    output = output->Clone(ParameterCloningMethod::Share, { { output->Arguments()[0], inputVar } });
+    Internal::DisableConstantFolding();
+    checkOutput(3.0f);
+    Internal::EnableConstantFolding();
+}
+
 void TestRecurrenceShapeInference()
 {
     auto testShapeInferenceInRecurrence = [](size_t inputRank, size_t outputRank) {
@@ -1131,6 +1234,36 @@ BOOST_AUTO_TEST_CASE(ChangingParameterValuesInGPU)
         TestChangingParameterValues<double>(3, DeviceDescriptor::GPUDevice(0));
 }
 
+BOOST_AUTO_TEST_CASE(ChangingRequestedOutputsInCPU)
+{
+    if (ShouldRunOnCpu())
+        TestChangingRequestedOutputs(DeviceDescriptor::CPUDevice());
+}
+
+BOOST_AUTO_TEST_CASE(ForwardAsyncInCPU)
+{
+    if (ShouldRunOnCpu())
+        TestForwardAsync(DeviceDescriptor::CPUDevice());
+}
+
+BOOST_AUTO_TEST_CASE(ForwardAsyncInGPU)
+{
+    if (ShouldRunOnGpu())
+        TestForwardAsync(DeviceDescriptor::GPUDevice(0));
+}
+
+BOOST_AUTO_TEST_CASE(ConstantFoldingInCPU)
+{
+    if (ShouldRunOnCpu())
+        TestConstantFolding(DeviceDescriptor::CPUDevice());
+}
+
+BOOST_AUTO_TEST_CASE(ConstantFoldingInGPU)
+{
+    if (ShouldRunOnGpu())
+        TestConstantFolding(DeviceDescriptor::GPUDevice(0));
+}
+
 BOOST_AUTO_TEST_CASE(TimesNodeShapeInference)
 {
     if (ShouldRunOnCpu())
@@ -106,6 +106,75 @@ void TestAdamLearner(size_t numParameters, size_t numMinibatches, bool unitGainM
     TestUpdate<ElementType>(learner, shape, numMinibatches, device);
 }
 
+template <typename ElementType>
+void TestAdamLearnerWithReducedStateMemory(size_t numParameters, size_t numMinibatches, bool unitGainMomentum, const DeviceDescriptor& device)
+{
+    NDShape shape = { 3, 4 }; // (the second moments of a matrix are factored)
+    auto parameters = CreateParameters<ElementType>(shape, numParameters, device);
+    AdditionalLearningOptions options;
+    options.bfloat16SmoothedGradients = true;
+    options.factoredSecondMoments = true;
+    auto learner = AdamLearner(parameters, LearningRatePerSampleSchedule({ 0.5 }), MomentumAsTimeConstantSchedule({ 10.0, 100.0, 1000.0 }), unitGainMomentum, MomentumPerSampleSchedule(0.99), 1e-8, false, options);
+    TestUpdate<ElementType>(learner, shape, numMinibatches, device);
+
+    // the packed state must survive a checkpoint round trip
+    auto checkpoint = learner->CreateCheckpoint();
+    auto restoredLearner = AdamLearner(parameters, LearningRatePerSampleSchedule({ 0.5 }), MomentumAsTimeConstantSchedule({ 10.0, 100.0, 1000.0 }), unitGainMomentum, MomentumPerSampleSchedule(0.99), 1e-8, false, options);
+    restoredLearner->RestoreFromCheckpoint(checkpoint);
+    TestUpdate<ElementType>(restoredLearner, shape, numMinibatches, device);
+
+    // a checkpoint of full-precision state does not fit
+    auto fullPrecisionLearner = AdamLearner(parameters, LearningRatePerSampleSchedule({ 0.5 }), MomentumAsTimeConstantSchedule({ 10.0, 100.0, 1000.0 }), unitGainMomentum, MomentumPerSampleSchedule(0.99));
+    VerifyException([&fullPrecisionLearner, &checkpoint]() {
+        fullPrecisionLearner->RestoreFromCheckpoint(checkpoint);
+    }, "Was able to restore full-precision learner state from a checkpoint of packed state.");
+}
+
+// The fused update of all parameters must give the same parameter values as the update of the parameters one by one.
+template <typename ElementType>
+void TestFusedUpdates(size_t numParameters, size_t numMinibatches, const DeviceDescriptor& device)
+{
+    typedef function<LearnerPtr(const vector<Parameter>&, AdditionalLearningOptions)> LearnerFactory;
+    const vector<LearnerFactory> learnerFactories = {
+        [](const vector<Parameter>& parameters, AdditionalLearningOptions options) { return SGDLearner(parameters, LearningRatePerSampleSchedule(0.4), options); },
+        [](const vector<Parameter>& parameters, AdditionalLearningOptions options) { return MomentumSGDLearner(parameters, LearningRatePerSampleSchedule(0.4), MomentumAsTimeConstantSchedule(1000), true, options); },
+        [](const vector<Parameter>& parameters, AdditionalLearningOptions options) { return NesterovLearner(parameters, LearningRatePerSampleSchedule(0.4), MomentumAsTimeConstantSchedule(1000), false, options); },
+        [](const vector<Parameter>& parameters, AdditionalLearningOptions options) { return AdamLearner(parameters, LearningRatePerSampleSchedule(0.4), MomentumAsTimeConstantSchedule(1000), true, MomentumPerSampleSchedule(0.99), 1e-8, false, options); },
+    };
+
+    NDShape shape = CreateShape(rng() % maxNumAxes + 1, maxDimSize);
+    for (const auto& learnerFactory : learnerFactories)
+    {
+        auto parameters = CreateParameters<ElementType>(shape, numParameters, device);
+        auto fusedParameters = CreateParameters<ElementType>(shape, numParameters, device); // (the same values)
+
+        AdditionalLearningOptions fusedOptions;
+        fusedOptions.fusedUpdates = true;
+        auto learner = learnerFactory(parameters, AdditionalLearningOptions());
+        auto fusedLearner = learnerFactory(fusedParameters, fusedOptions);
+
+        auto seed = (unsigned long)rng();
+        for (size_t i = 0; i < numMinibatches; i++)
+        {
+            unordered_map<Parameter, NDArrayViewPtr> gradientValues, fusedGradientValues;
+            for (size_t j = 0; j < numParameters; j++)
+            {
+                gradientValues[parameters[j]] = NDArrayView::RandomUniform<ElementType>(shape, -1.0, 1.0, seed + i * numParameters + j, device);
+                fusedGradientValues[fusedParameters[j]] = gradientValues[parameters[j]]->DeepClone();
+            }
+
+            learner->Update(gradientValues, 1);
+            fusedLearner->Update(fusedGradientValues, 1);
+        }
+
+        for (size_t j = 0; j < numParameters; j++)
+        {
+            if (!Internal::AreEqual(*parameters[j].Value(), *fusedParameters[j].Value(), 1e-5, 1e-6))
+                ReportFailure("The fused update gives different parameter values than the update of the parameters one by one.");
+        }
+    }
+}
+
 template <typename ElementType>
 void TestAdamaxLearner(size_t numParameters, size_t numMinibatches, bool unitGainMomentum, const DeviceDescriptor& device)
 {
@@ -441,6 +510,27 @@ BOOST_AUTO_TEST_CASE(CreateAndUpdateAdamLearner)
     }
 }
 
+BOOST_AUTO_TEST_CASE(CreateAndUpdateAdamLearnerWithReducedStateMemory)
+{
+    for (auto& device : devices)
+    {
+        for (auto& gain : unitGain)
+        {
+            TestAdamLearnerWithReducedStateMemory<float>(numParameters, numMinibatches, gain, device);
+            TestAdamLearnerWithReducedStateMemory<double>(numParameters, numMinibatches, gain, device);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FusedUpdates)
+{
+    for (auto& device : devices)
+    {
+        TestFusedUpdates<float>(numParameters, numMinibatches, device);
+        TestFusedUpdates<double>(numParameters, numMinibatches, device);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(CreateAndUpdateUniversalLearner)
 {
     for (auto& device : devices)
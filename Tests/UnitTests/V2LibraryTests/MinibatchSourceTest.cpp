@@ -5,6 +5,7 @@
 #include "stdafx.h"
 #include "CNTKLibrary.h"
 #include "Common.h"
+#include <thread>
 
 using namespace CNTK;
 
@@ -408,6 +409,71 @@ BOOST_AUTO_TEST_CASE(CompareDeserializers)
     }
 }
 
+BOOST_AUTO_TEST_CASE(StreamingMinibatchSourceBatchesRecordsInOrder)
+{
+    StreamInformation features;
+    features.m_name = L"features";
+    features.m_elementType = DataType::Float;
+    features.m_sampleLayout = NDShape({ 2 });
+    StreamingMinibatchSourceConfig config({ features });
+    config.maxQueuedRecords = 4;
+    config.maxLatencyInMilliseconds = 20;
+    auto source = CreateStreamingMinibatchSource(config);
+    const auto& stream = source->StreamInfo(L"features");
+    const auto device = DeviceDescriptor::CPUDevice();
+
+    // record i has a single sample of value i, and the timestamp i seconds
+    auto timestamp = [](size_t i) { return StreamingMinibatchSource::Timestamp(std::chrono::seconds(i)); };
+    auto addRecord = [&](size_t i)
+    {
+        std::vector<float> data(2, (float)i);
+        auto sequence = MakeSharedObject<NDArrayView>(NDShape({ 2, 1 }), data)->DeepClone();
+        return source->AddRecord({ { stream, sequence } }, timestamp(i));
+    };
+    auto checkMinibatch = [&](const std::unordered_map<StreamInformation, MinibatchData>& minibatch, size_t first)
+    {
+        BOOST_REQUIRE(minibatch.size() == 1);
+        const auto& data = minibatch.at(stream);
+        const size_t count = data.numberOfSequences;
+        BOOST_TEST(data.numberOfSamples == count);
+        const float* values = data.data->Data()->DataBuffer<float>();
+        const auto& timestamps = source->LastMinibatchTimestamps();
+        BOOST_REQUIRE(timestamps.size() == count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            BOOST_TEST(values[2 * i] == (float)(first + i));
+            BOOST_TEST((timestamps[i] == timestamp(first + i)));
+        }
+        return count;
+    };
+
+    // a full minibatch is returned at once, the rest of the records once their deadline has passed
+    for (size_t i = 0; i < 4; ++i)
+        BOOST_REQUIRE(addRecord(i));
+    BOOST_TEST(checkMinibatch(source->GetNextMinibatch(3, 0, device), 0) == 3);
+    BOOST_TEST(checkMinibatch(source->GetNextMinibatch(3, 0, device), 3) == 1);
+
+    // the producer is held back while the source is full
+    std::thread producer([&]
+    {
+        for (size_t i = 4; i < 20; ++i)
+            addRecord(i);
+        source->Close();
+    });
+    size_t next = 4;
+    for (;;)
+    {
+        const auto& minibatch = source->GetNextMinibatch(0, 3, device);
+        if (minibatch.empty())
+            break;
+        const size_t count = checkMinibatch(minibatch, next);
+        BOOST_TEST(count <= 3);
+        next += count;
+    }
+    producer.join();
+    BOOST_TEST(next == 20);
+    BOOST_TEST(!addRecord(20));
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -376,6 +376,77 @@ void TestSimpleRecurrence(size_t inputDim,
     }
 }
 
+template <typename ElementType>
+void TestIncrementalRecurrence(const DeviceDescriptor& device)
+{
+    const size_t inputDim = 3;
+    const size_t outputDim = 4;
+    auto inputVar = InputVariable({ inputDim }, AsDataType<ElementType>(), L"input");
+    auto W = Parameter(NDArrayView::RandomUniform<ElementType>({ outputDim, inputDim }, -0.5, 0.5, seed++, device));
+    auto U = Parameter(NDArrayView::RandomUniform<ElementType>({ outputDim, outputDim }, -0.5, 0.5, seed++, device));
+    auto b = Parameter({ outputDim }, (ElementType)0.1, device);
+
+    auto placeholder = PlaceholderVariable(std::initializer_list<size_t>({ outputDim }));
+    auto output = Tanh(Plus(Plus(Times(W, inputVar), Times(U, placeholder)), b), L"output");
+    output = output->ReplacePlaceholders({ { placeholder, PastValue(output) } });
+
+    // evaluate two sequences as a whole
+    std::vector<size_t> sequenceLengths = { 5, 3 };
+    std::vector<std::vector<ElementType>> sequences;
+    for (auto sequenceLength : sequenceLengths)
+    {
+        std::vector<ElementType> sequence(sequenceLength * inputDim);
+        for (auto& value : sequence)
+            value = ((ElementType)rand()) / RAND_MAX;
+        sequences.push_back(sequence);
+    }
+
+    std::unordered_map<Variable, ValuePtr> outputs = { { output, nullptr } };
+    output->Forward({ { inputVar, Value::Create<ElementType>({ inputDim }, sequences, device, true) } }, outputs, device);
+    std::vector<std::vector<ElementType>> expectedOutputs;
+    outputs[output]->CopyVariableValueTo(output, expectedOutputs);
+
+    // and one step at a time, each call evaluating the next step of some of them
+    std::vector<size_t> nextSteps(sequences.size(), 0);
+    auto forwardNextSteps = [&](const std::vector<size_t>& indices) {
+        std::vector<size_t> sequenceIds;
+        std::vector<std::vector<ElementType>> steps;
+        std::vector<bool> sequenceStartFlags;
+        for (auto i : indices)
+        {
+            sequenceIds.push_back(100 + i);
+            steps.push_back(std::vector<ElementType>(sequences[i].begin() + nextSteps[i] * inputDim, sequences[i].begin() + (nextSteps[i] + 1) * inputDim));
+            sequenceStartFlags.push_back(nextSteps[i] == 0);
+        }
+
+        std::unordered_map<Variable, ValuePtr> stepOutputs = { { output, nullptr } };
+        output->ForwardSequences(sequenceIds, { { inputVar, Value::Create<ElementType>({ inputDim }, steps, sequenceStartFlags, device, true) } }, stepOutputs, device);
+        std::vector<std::vector<ElementType>> actualOutputs;
+        stepOutputs[output]->CopyVariableValueTo(output, actualOutputs);
+
+        for (size_t k = 0; k < indices.size(); ++k)
+        {
+            auto i = indices[k];
+            std::vector<ElementType> expectedOutput(expectedOutputs[i].begin() + nextSteps[i] * outputDim, expectedOutputs[i].begin() + (nextSteps[i] + 1) * outputDim);
+            FloatingPointVectorCompare(actualOutputs[k], expectedOutput, "ForwardSequences results do not match the results of Forward for the whole sequences");
+            nextSteps[i]++;
+        }
+    };
+
+    forwardNextSteps({ 0 });
+    forwardNextSteps({ 1, 0 });
+    forwardNextSteps({ 0 });
+    forwardNextSteps({ 0, 1 });
+    forwardNextSteps({ 1, 0 });
+
+    // an ended sequence cannot be continued
+    output->EndSequence(101);
+    VerifyException([&]() {
+        nextSteps[1] = 1;
+        forwardNextSteps({ 1 });
+    }, "Was able to continue a sequence that was ended.");
+}
+
 BOOST_AUTO_TEST_SUITE(RecurrentFunctionSuite)
 
 BOOST_AUTO_TEST_CASE(SimpleRecurrenceInCPU)
@@ -407,6 +478,18 @@ BOOST_AUTO_TEST_CASE(SimpleLargeRecurrenceInGPU)
     }
 }
 
+BOOST_AUTO_TEST_CASE(IncrementalRecurrenceInCPU)
+{
+    if (ShouldRunOnCpu())
+        TestIncrementalRecurrence<float>(DeviceDescriptor::CPUDevice());
+}
+
+BOOST_AUTO_TEST_CASE(IncrementalRecurrenceInGPU)
+{
+    if (ShouldRunOnGpu())
+        TestIncrementalRecurrence<double>(DeviceDescriptor::GPUDevice(0));
+}
+
 BOOST_AUTO_TEST_CASE(RecurrentNetworkCreationInCPU)
 {
     if (ShouldRunOnCpu())
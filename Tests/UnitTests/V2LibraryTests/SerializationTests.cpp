@@ -408,6 +408,15 @@ void TestFunctionSaveAndLoad(const FunctionPtr& function, const DeviceDescriptor
     {
         BOOST_ERROR("TestFunctionSaveAndLoad: original and reloaded functions are not identical.");
     }
+
+    auto mappableFile = L"TestFunctionSaveAndLoad.mappable.out";
+    function->Save(mappableFile, ModelFormat::CNTKv2Mappable);
+    auto mappedFunction = Function::Load(mappableFile, device);
+
+    if (!AreEqual(function, mappedFunction))
+    {
+        BOOST_ERROR("TestFunctionSaveAndLoad: original and reloaded (mappable format) functions are not identical.");
+    }
 }
 
 void TestFunctionsForEquality(const DeviceDescriptor& device)
@@ -958,6 +958,38 @@ void CreateSequenceTestDense(const DeviceDescriptor device, bool readOnly)
 }
 
 
+// Values created from a buffer alias it.
+template <typename ElementType>
+void CreateFromBufferTestDense(const DeviceDescriptor device)
+{
+    size_t numAxes = 3;
+    size_t maxDimSize = 20;
+    NDShape sampleShape = CreateShape(numAxes, maxDimSize);
+    auto sampleSize = sampleShape.TotalSize();
+
+    auto seqLenList = GenerateSequenceLengths(1, 50);
+    auto data = GenerateSequences<ElementType>(seqLenList, sampleShape);
+    auto deviceData = MakeSharedObject<NDArrayView>(sampleShape.AppendShape({ seqLenList[0] }), data[0], false)->DeepClone(device);
+    auto buffer = deviceData->DataBuffer<ElementType>();
+
+    auto testValue = Value::CreateBatch(sampleShape, buffer, data[0].size(), device);
+    BOOST_TEST(testValue->IsReadOnly());
+    BOOST_TEST(testValue->Data()->DataBuffer<ElementType>() == buffer);
+    vector<vector<ElementType>> expectedResult;
+    for (size_t i = 0; i < data[0].size(); i += sampleSize)
+        expectedResult.push_back(vector<ElementType>(data[0].begin() + i, data[0].begin() + i + sampleSize));
+    CheckValue(testValue, sampleShape, expectedResult, vector<size_t>(seqLenList[0], 1));
+
+    testValue = Value::CreateSequence(sampleShape, buffer, data[0].size(), false, device);
+    BOOST_TEST(testValue->IsReadOnly());
+    BOOST_TEST(testValue->Data()->DataBuffer<ElementType>() == buffer);
+    CheckValue(testValue, sampleShape, data, seqLenList, { false });
+
+    VerifyException([&sampleShape, &buffer, &sampleSize, &device]() {
+        Value::CreateBatch(sampleShape, buffer, sampleSize * 2 - 1, device);
+    }, "The expected exception has not been caught: The number of data is not a multiple of the sample size.");
+}
+
 template <typename ElementType>
 void CreateBatchOfSequencesTestDense(const DeviceDescriptor device, bool readOnly)
 {
@@ -1342,6 +1374,24 @@ BOOST_AUTO_TEST_CASE(CreateSequenceDenseInGPU)
     }
 }
 
+BOOST_AUTO_TEST_CASE(CreateFromBufferDenseInCPU)
+{
+    if (!ShouldRunOnCpu())
+        return;
+
+    CreateFromBufferTestDense<float>(DeviceDescriptor::CPUDevice());
+    CreateFromBufferTestDense<double>(DeviceDescriptor::CPUDevice());
+}
+
+BOOST_AUTO_TEST_CASE(CreateFromBufferDenseInGPU)
+{
+    if (ShouldRunOnGpu())
+    {
+        CreateFromBufferTestDense<float>(DeviceDescriptor::GPUDevice(0));
+        CreateFromBufferTestDense<double>(DeviceDescriptor::GPUDevice(0));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(CreateBatchOfSequencesDenseInCPU)
 {
     if (!ShouldRunOnCpu())